@@ -0,0 +1,605 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/ChannelId.h"
+#include "td/telegram/ChatId.h"
+#include "td/telegram/DialogDate.h"
+#include "td/telegram/DialogDb.h"
+#include "td/telegram/DialogId.h"
+#include "td/telegram/FolderId.h"
+#include "td/telegram/Global.h"
+#include "td/telegram/MessageDb.h"
+#include "td/telegram/MessageId.h"
+#include "td/telegram/MessageSearchFilter.h"
+#include "td/telegram/NotificationGroupId.h"
+#include "td/telegram/NotificationGroupKey.h"
+#include "td/telegram/NotificationId.h"
+#include "td/telegram/ServerMessageId.h"
+#include "td/telegram/UserId.h"
+#include "td/telegram/Version.h"
+
+#include "td/db/binlog/Binlog.h"
+#include "td/db/BinlogKeyValue.h"
+#include "td/db/DbKey.h"
+#include "td/db/SqliteConnectionSafe.h"
+#include "td/db/SqliteDb.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
+
+#include "td/utils/as.h"
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Status.h"
+#include "td/utils/Time.h"
+#include "td/utils/TsCerr.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+
+static void usage() {
+  td::TsCerr() << "Generates a synthetic large account in MessageDb and DialogDb and measures latency of the queries "
+                  "sent to them by TDLib.\n";
+  td::TsCerr() << "Usage: bench_account_db [options]\n";
+  td::TsCerr() << "Options:\n";
+  td::TsCerr() << "  -v<N>\tSet verbosity level to N\n";
+  td::TsCerr() << "  -h/--help\tDisplay this information\n";
+  td::TsCerr() << "  -d/--dialogs\tNumber of chats (default is 10000, 100000 for a large account)\n";
+  td::TsCerr() << "  -m/--messages\tTotal number of messages (default is 1000000, 50000000 for a large account)\n";
+  td::TsCerr() << "  -n/--queries\tNumber of queries of every type (default is 1000)\n";
+  td::TsCerr() << "  -s/--seed\tSeed for the account generator (default is 1)\n";
+  td::TsCerr() << "  -f/--database-file\tPath to the database (default is bench_account_db.sqlite)\n";
+  td::TsCerr() << "  -r/--reuse\tReuse the database generated by a previous run with the same parameters\n";
+  std::exit(2);
+}
+
+struct AccountOptions {
+  int dialog_count = 10000;
+  td::int64 message_count = 1000000;
+  int query_count = 1000;
+  td::uint64 seed = 1;
+  td::string database_path = "bench_account_db.sqlite";
+  bool reuse_database = false;
+};
+
+class LatencyStatistics {
+ public:
+  void add(double latency) {
+    latencies_.push_back(latency);
+  }
+
+  td::string to_string() {
+    if (latencies_.empty()) {
+      return "no requests";
+    }
+    std::sort(latencies_.begin(), latencies_.end());
+    double sum = 0.0;
+    for (auto latency : latencies_) {
+      sum += latency;
+    }
+    auto get_percentile = [&](size_t percent) {
+      return latencies_[td::min(latencies_.size() - 1, latencies_.size() * percent / 100)];
+    };
+    return PSTRING() << latencies_.size() << " requests, average " << td::format::as_time(sum / latencies_.size())
+                     << ", median " << td::format::as_time(get_percentile(50)) << ", 90th percentile "
+                     << td::format::as_time(get_percentile(90)) << ", 99th percentile "
+                     << td::format::as_time(get_percentile(99)) << ", max " << td::format::as_time(latencies_.back());
+  }
+
+ private:
+  td::vector<double> latencies_;
+};
+
+// the account is fully determined by the options, so the layout can be recomputed without the database
+class AccountLayout {
+ public:
+  static constexpr td::int32 TIME_SPAN = 3 * 365 * 86400;
+  static constexpr td::int32 THREAD_SIZE = 50;
+  static constexpr int RECENT_NOTIFICATION_COUNT = 20;
+
+  struct Dialog {
+    td::DialogId dialog_id;
+    td::int32 message_count = 0;
+    bool has_notifications = false;
+    bool is_archived = false;
+  };
+
+  explicit AccountLayout(const AccountOptions &options) : start_date_(1600000000) {
+    // message counts follow Zipf's law, so there are a few huge chats and a lot of small ones
+    double harmonic_sum = 0.0;
+    for (int i = 0; i < options.dialog_count; i++) {
+      harmonic_sum += 1.0 / (i + 1);
+    }
+    td::Random::Xorshift128plus random(options.seed);
+    for (int i = 0; i < options.dialog_count; i++) {
+      Dialog dialog;
+      switch (i % 10) {
+        case 0:
+          dialog.dialog_id = td::DialogId(td::ChannelId(static_cast<td::int64>(i + 1)));
+          break;
+        case 1:
+          dialog.dialog_id = td::DialogId(td::ChatId(static_cast<td::int64>(i + 1)));
+          break;
+        default:
+          dialog.dialog_id = td::DialogId(td::UserId(static_cast<td::int64>(i + 1)));
+          break;
+      }
+      dialog.message_count = static_cast<td::int32>(
+          td::max(static_cast<double>(options.message_count) / harmonic_sum / (i + 1), 1.0));
+      dialog.has_notifications = random.fast(0, 4) == 0;
+      dialog.is_archived = random.fast(0, 9) == 0;
+      dialogs_.push_back(dialog);
+    }
+  }
+
+  const td::vector<Dialog> &get_dialogs() const {
+    return dialogs_;
+  }
+
+  // returns a random dialog; frequently used chats are large, so they are chosen more often
+  const Dialog &get_random_dialog(td::Random::Xorshift128plus &random) const {
+    auto x = random.fast(0, 1000000) * 1e-6;
+    auto index = static_cast<size_t>(std::exp(x * std::log(static_cast<double>(dialogs_.size())))) - 1;
+    return dialogs_[td::min(index, dialogs_.size() - 1)];
+  }
+
+  static td::MessageId get_message_id(td::int32 index) {
+    return td::MessageId(td::ServerMessageId(index + 1));
+  }
+
+  td::int32 get_message_date(const Dialog &dialog, td::int32 index) const {
+    return start_date_ + static_cast<td::int32>(static_cast<td::int64>(TIME_SPAN) * index / dialog.message_count);
+  }
+
+  td::int32 get_last_message_date(const Dialog &dialog) const {
+    return get_message_date(dialog, dialog.message_count - 1);
+  }
+
+ private:
+  td::int32 start_date_;
+  td::vector<Dialog> dialogs_;
+};
+
+class AccountDbBench final : public td::Actor {
+ public:
+  explicit AccountDbBench(AccountOptions options) : options_(std::move(options)), layout_(options_) {
+  }
+
+ private:
+  static constexpr int WORD_COUNT = 10000;
+
+  AccountOptions options_;
+  AccountLayout layout_;
+  td::vector<td::string> words_;
+  std::shared_ptr<td::SqliteConnectionSafe> sql_connection_;
+  std::shared_ptr<td::MessageDbSyncSafeInterface> message_db_sync_safe_;
+  std::shared_ptr<td::DialogDbSyncSafeInterface> dialog_db_sync_safe_;
+
+  void start_up() final {
+    // messages can't be parsed outside of the Global context
+    set_context(std::make_shared<td::Global>());
+
+    auto status = run();
+    if (status.is_error()) {
+      LOG(PLAIN) << "Benchmark failed: " << status;
+    }
+    message_db_sync_safe_.reset();
+    dialog_db_sync_safe_.reset();
+    if (sql_connection_ != nullptr) {
+      sql_connection_->close();
+      sql_connection_.reset();
+    }
+    td::Scheduler::instance()->finish();
+    stop();
+  }
+
+  const td::string &get_word(td::Random::Xorshift128plus &random) const {
+    // frequent words have small indices
+    auto x = random.fast(0, 1000000) * 1e-6;
+    return words_[static_cast<size_t>(x * x * x * (WORD_COUNT - 1))];
+  }
+
+  td::string get_text(td::Random::Xorshift128plus &random, int word_count) const {
+    td::string text;
+    for (int i = 0; i < word_count; i++) {
+      if (i != 0) {
+        text += ' ';
+      }
+      text += get_word(random);
+    }
+    return text;
+  }
+
+  // only the prefix of a serialized message, which is parsed by MessageDb, is meaningful
+  static td::BufferSlice get_message_data(td::MessageId message_id, td::int32 date, size_t size) {
+    td::BufferSlice data(td::max(size, static_cast<size_t>(20)));
+    auto ptr = data.as_mutable_slice().begin();
+    td::as<td::int32>(ptr) = static_cast<td::int32>(td::Version::Next) - 1;
+    td::as<td::int32>(ptr + 4) = 0;  // flags
+    td::as<td::int64>(ptr + 8) = message_id.get();
+    td::as<td::int32>(ptr + 16) = date;
+    return data;
+  }
+
+  static td::int32 get_index_mask(td::Random::Xorshift128plus &random) {
+    td::int32 index_mask = 0;
+    auto add_filter = [&index_mask](td::MessageSearchFilter filter) {
+      index_mask |= td::message_search_filter_index_mask(filter);
+    };
+    auto media_type = random.fast(0, 9999);
+    if (media_type < 800) {
+      add_filter(td::MessageSearchFilter::Photo);
+      add_filter(td::MessageSearchFilter::PhotoAndVideo);
+    } else if (media_type < 1000) {
+      add_filter(td::MessageSearchFilter::Video);
+      add_filter(td::MessageSearchFilter::PhotoAndVideo);
+    } else if (media_type < 1300) {
+      add_filter(td::MessageSearchFilter::Document);
+    } else if (media_type < 1500) {
+      add_filter(td::MessageSearchFilter::VoiceNote);
+      add_filter(td::MessageSearchFilter::VoiceAndVideoNote);
+    } else if (media_type < 1550) {
+      add_filter(td::MessageSearchFilter::VideoNote);
+      add_filter(td::MessageSearchFilter::VoiceAndVideoNote);
+    } else if (media_type < 1650) {
+      add_filter(td::MessageSearchFilter::Animation);
+    } else if (media_type < 1750) {
+      add_filter(td::MessageSearchFilter::Audio);
+    }
+    if (random.fast(0, 99) < 5) {
+      add_filter(td::MessageSearchFilter::Url);
+    }
+    if (random.fast(0, 199) == 0) {
+      add_filter(td::MessageSearchFilter::Mention);
+    }
+    if (random.fast(0, 1999) == 0) {
+      add_filter(td::MessageSearchFilter::Pinned);
+    }
+    return index_mask;
+  }
+
+  td::Status open_database(bool is_new) {
+    if (is_new) {
+      td::SqliteDb::destroy(options_.database_path).ignore();
+      td::Binlog::destroy(options_.database_path + ".binlog").ignore();
+    }
+    {
+      TRY_RESULT(db, td::SqliteDb::open_with_key(options_.database_path, true, td::DbKey::empty()));
+      TRY_STATUS(db.exec("PRAGMA encoding=\"UTF-8\""));
+      TRY_STATUS(db.exec("PRAGMA journal_mode=WAL"));
+      if (is_new) {
+        td::BinlogKeyValue<td::Binlog> binlog_pmc;
+        TRY_STATUS(binlog_pmc.init(options_.database_path + ".binlog"));
+        bool dialog_db_was_created = false;
+        TRY_STATUS(db.exec("BEGIN TRANSACTION"));
+        // version 0 means that the databases are created from scratch
+        TRY_STATUS(init_dialog_db(db, 0, binlog_pmc, dialog_db_was_created));
+        TRY_STATUS(init_message_db(db, 0));
+        TRY_STATUS(db.exec("COMMIT TRANSACTION"));
+        binlog_pmc.close();
+        td::Binlog::destroy(options_.database_path + ".binlog").ignore();
+      }
+    }
+    sql_connection_ = std::make_shared<td::SqliteConnectionSafe>(options_.database_path, td::DbKey::empty());
+    message_db_sync_safe_ = td::create_message_db_sync(sql_connection_);
+    dialog_db_sync_safe_ = td::create_dialog_db_sync(sql_connection_);
+    return td::Status::OK();
+  }
+
+  td::Status generate_account() {
+    auto &message_db = message_db_sync_safe_->get();
+    auto &dialog_db = dialog_db_sync_safe_->get();
+    td::Random::Xorshift128plus random(options_.seed * 2 + 1);
+
+    auto start_time = td::Time::now();
+    td::int64 added_message_count = 0;
+    td::int64 search_id = 0;
+    td::int32 unique_message_id = 0;
+    td::int32 notification_id = 0;
+    td::int32 notification_group_id = 0;
+    TRY_STATUS(message_db.begin_write_transaction());
+    for (auto &dialog : layout_.get_dialogs()) {
+      auto is_channel = dialog.dialog_id.get_type() == td::DialogType::Channel;
+      for (td::int32 i = 0; i < dialog.message_count; i++) {
+        auto message_id = AccountLayout::get_message_id(i);
+        auto date = layout_.get_message_date(dialog, i);
+        auto index_mask = get_index_mask(random);
+        td::string text;
+        if (random.fast(0, 9) < 7) {
+          text = get_text(random, random.fast(3, 20));
+        }
+        td::int64 message_search_id = text.empty() ? 0 : ++search_id;
+        td::NotificationId message_notification_id;
+        if (dialog.has_notifications && i + AccountLayout::RECENT_NOTIFICATION_COUNT >= dialog.message_count) {
+          message_notification_id = td::NotificationId(++notification_id);
+        }
+        td::MessageId top_thread_message_id;
+        if (is_channel && i >= AccountLayout::THREAD_SIZE && random.fast(0, 4) == 0) {
+          top_thread_message_id = AccountLayout::get_message_id(i / AccountLayout::THREAD_SIZE *
+                                                                AccountLayout::THREAD_SIZE);
+        }
+        td::int64 random_id = random.fast(0, 9) == 0 ? static_cast<td::int64>(random()) : 0;
+        message_db.add_message({dialog.dialog_id, message_id},
+                               is_channel ? td::ServerMessageId() : td::ServerMessageId(++unique_message_id),
+                               td::DialogId(td::UserId(static_cast<td::int64>(random.fast(1, 1000000)))), random_id, 0,
+                               index_mask, message_search_id, std::move(text), message_notification_id,
+                               top_thread_message_id, get_message_data(message_id, date, random.fast(100, 400)));
+
+        if (++added_message_count % 10000 == 0) {
+          TRY_STATUS(message_db.commit_transaction());
+          TRY_STATUS(message_db.begin_write_transaction());
+          if (added_message_count % 1000000 == 0) {
+            LOG(PLAIN) << "Added " << added_message_count << " messages in "
+                       << td::format::as_time(td::Time::now() - start_time);
+          }
+        }
+      }
+
+      td::vector<td::NotificationGroupKey> notification_groups;
+      auto last_message_date = layout_.get_last_message_date(dialog);
+      if (dialog.has_notifications) {
+        notification_groups.emplace_back(td::NotificationGroupId(++notification_group_id), dialog.dialog_id,
+                                         last_message_date);
+      }
+      auto order = (static_cast<td::int64>(last_message_date) << 32) + dialog.message_count;
+      dialog_db.add_dialog(dialog.dialog_id, dialog.is_archived ? td::FolderId::archive() : td::FolderId::main(),
+                           order, td::BufferSlice(random.fast(200, 1000)), std::move(notification_groups));
+    }
+    TRY_STATUS(message_db.commit_transaction());
+    LOG(PLAIN) << "Generated " << layout_.get_dialogs().size() << " chats with " << added_message_count
+               << " messages in " << td::format::as_time(td::Time::now() - start_time);
+    return td::Status::OK();
+  }
+
+  template <class F>
+  void measure(td::Slice name, const F &f) {
+    LatencyStatistics statistics;
+    td::Random::Xorshift128plus random(options_.seed * 3 + 7);
+    size_t total_result_count = 0;
+    for (int i = 0; i < options_.query_count; i++) {
+      auto &dialog = layout_.get_random_dialog(random);
+      auto start_time = td::Time::now();
+      total_result_count += f(dialog, random);
+      statistics.add(td::Time::now() - start_time);
+    }
+    LOG(PLAIN) << name << ": " << statistics.to_string() << ", " << total_result_count << " results";
+  }
+
+  void run_queries() {
+    auto &message_db = message_db_sync_safe_->get();
+    auto &dialog_db = dialog_db_sync_safe_->get();
+    static const td::MessageSearchFilter media_filters[] = {
+        td::MessageSearchFilter::Photo, td::MessageSearchFilter::PhotoAndVideo, td::MessageSearchFilter::Document,
+        td::MessageSearchFilter::Url, td::MessageSearchFilter::VoiceAndVideoNote};
+    auto get_random_filter = [](td::Random::Xorshift128plus &random) {
+      return media_filters[random.fast(0, static_cast<int>(sizeof(media_filters) / sizeof(media_filters[0])) - 1)];
+    };
+    auto get_random_message_id = [](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      return AccountLayout::get_message_id(random.fast(0, dialog.message_count - 1));
+    };
+
+    measure("History first page", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      td::MessageDbMessagesQuery query;
+      query.dialog_id = dialog.dialog_id;
+      query.from_message_id = td::MessageId::max();
+      query.limit = 50;
+      return message_db.get_messages(std::move(query)).size();
+    });
+    measure("History random page", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      td::MessageDbMessagesQuery query;
+      query.dialog_id = dialog.dialog_id;
+      query.from_message_id = get_random_message_id(dialog, random);
+      query.offset = -25;
+      query.limit = 50;
+      return message_db.get_messages(std::move(query)).size();
+    });
+    measure("Media history page", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      td::MessageDbMessagesQuery query;
+      query.dialog_id = dialog.dialog_id;
+      query.filter = get_random_filter(random);
+      query.from_message_id = get_random_message_id(dialog, random);
+      query.limit = 50;
+      return message_db.get_messages(std::move(query)).size();
+    });
+    measure("Thread history page", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      if (dialog.dialog_id.get_type() != td::DialogType::Channel ||
+          dialog.message_count <= AccountLayout::THREAD_SIZE) {
+        return static_cast<size_t>(0);
+      }
+      td::MessageDbMessagesQuery query;
+      query.dialog_id = dialog.dialog_id;
+      query.top_thread_message_id = AccountLayout::get_message_id(
+          random.fast(1, (dialog.message_count - 1) / AccountLayout::THREAD_SIZE) * AccountLayout::THREAD_SIZE);
+      query.from_message_id = td::MessageId::max();
+      query.limit = 50;
+      return message_db.get_messages(std::move(query)).size();
+    });
+    measure("Sparse message positions", [&](const AccountLayout::Dialog &dialog,
+                                              td::Random::Xorshift128plus &random) {
+      td::MessageDbGetDialogSparseMessagePositionsQuery query;
+      query.dialog_id = dialog.dialog_id;
+      query.filter = get_random_filter(random);
+      query.from_message_id = td::MessageId::max();
+      query.limit = 100;
+      auto r_positions = message_db.get_dialog_sparse_message_positions(std::move(query));
+      return r_positions.is_ok() ? r_positions.ok().positions.size() : static_cast<size_t>(0);
+    });
+    measure("Message calendar", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      td::MessageDbDialogCalendarQuery query;
+      query.dialog_id = dialog.dialog_id;
+      query.filter = get_random_filter(random);
+      query.from_message_id = td::MessageId::max();
+      return message_db.get_dialog_message_calendar(std::move(query)).messages.size();
+    });
+    measure("Message by date", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      auto date = layout_.get_message_date(dialog, random.fast(0, dialog.message_count - 1));
+      auto r_message = message_db.get_dialog_message_by_date(
+          dialog.dialog_id, AccountLayout::get_message_id(0),
+          AccountLayout::get_message_id(dialog.message_count - 1), date);
+      return static_cast<size_t>(r_message.is_ok());
+    });
+    measure("Messages by identifiers", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      td::vector<td::FullMessageId> full_message_ids;
+      for (int i = 0; i < 20; i++) {
+        full_message_ids.emplace_back(dialog.dialog_id, get_random_message_id(dialog, random));
+      }
+      return message_db.get_messages_by_ids(std::move(full_message_ids)).size();
+    });
+    measure("Notification messages", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      return message_db.get_messages_from_notification_id(dialog.dialog_id, td::NotificationId::max(), 20).size();
+    });
+    measure("Global FTS", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      td::MessageDbFtsQuery query;
+      query.query = get_text(random, random.fast(1, 2));
+      query.limit = 50;
+      return message_db.get_messages_fts(std::move(query)).messages.size();
+    });
+    measure("Chat FTS", [&](const AccountLayout::Dialog &dialog, td::Random::Xorshift128plus &random) {
+      td::MessageDbFtsQuery query;
+      query.query = get_text(random, 1);
+      query.dialog_id = dialog.dialog_id;
+      query.limit = 50;
+      return message_db.get_messages_fts(std::move(query)).messages.size();
+    });
+
+    // chat list is always loaded from the beginning
+    LatencyStatistics dialog_list_statistics;
+    for (int i = 0; i < options_.query_count;) {
+      auto order = td::MIN_DIALOG_DATE.get_order();
+      td::DialogId dialog_id;
+      for (; i < options_.query_count; i++) {
+        auto start_time = td::Time::now();
+        auto result = dialog_db.get_dialogs(td::FolderId::main(), order, dialog_id, 100);
+        dialog_list_statistics.add(td::Time::now() - start_time);
+        if (result.dialogs.empty()) {
+          i++;
+          break;
+        }
+        order = result.next_order;
+        dialog_id = result.next_dialog_id;
+      }
+    }
+    LOG(PLAIN) << "Chat list page: " << dialog_list_statistics.to_string();
+
+    LatencyStatistics notification_group_statistics;
+    for (int i = 0; i < options_.query_count; i++) {
+      td::NotificationGroupKey group_key;
+      group_key.last_notification_date = std::numeric_limits<td::int32>::max();
+      auto start_time = td::Time::now();
+      dialog_db.get_notification_groups_by_last_notification_date(group_key, 100);
+      notification_group_statistics.add(td::Time::now() - start_time);
+    }
+    LOG(PLAIN) << "Notification groups: " << notification_group_statistics.to_string();
+  }
+
+  td::Status run() {
+    for (int i = 0; i < WORD_COUNT; i++) {
+      td::Random::Xorshift128plus random(options_.seed + i);
+      td::string word(random.fast(4, 10), '\0');
+      for (auto &c : word) {
+        c = static_cast<char>(random.fast('a', 'z'));
+      }
+      words_.push_back(std::move(word));
+    }
+
+    bool is_new = !options_.reuse_database || td::stat(options_.database_path).is_error();
+    TRY_STATUS(open_database(is_new));
+    if (is_new) {
+      TRY_STATUS(generate_account());
+    }
+    auto r_stat = td::stat(options_.database_path);
+    if (r_stat.is_ok()) {
+      LOG(PLAIN) << "Database size: " << td::format::as_size(r_stat.ok().size_);
+    }
+    run_queries();
+    return td::Status::OK();
+  }
+};
+
+int main(int argc, char **argv) {
+  int new_verbosity_level = VERBOSITY_NAME(FATAL);
+  AccountOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    td::string arg(argv[i]);
+
+    auto get_next_arg = [&i, &arg, argc, argv](bool is_optional = false) {
+      CHECK(arg.size() >= 2);
+      if (arg.size() == 2 || arg[1] == '-') {
+        if (i + 1 < argc && argv[i + 1][0] != '-') {
+          return td::string(argv[++i]);
+        }
+      } else {
+        if (arg.size() > 2) {
+          return arg.substr(2);
+        }
+      }
+      if (!is_optional) {
+        td::TsCerr() << "Error: value is required after " << arg << "\n";
+        usage();
+      }
+      return td::string();
+    };
+    auto get_next_int_arg = [&get_next_arg] {
+      auto r_value = td::to_integer_safe<td::int64>(get_next_arg());
+      if (r_value.is_error() || r_value.ok() < 0) {
+        usage();
+      }
+      return r_value.ok();
+    };
+
+    if (td::begins_with(arg, "-v")) {
+      arg = get_next_arg(true);
+      int new_verbosity = 1;
+      while (arg[0] == 'v') {
+        new_verbosity++;
+        arg = arg.substr(1);
+      }
+      if (!arg.empty()) {
+        new_verbosity += td::to_integer<int>(arg) - (new_verbosity == 1);
+      }
+      new_verbosity_level = VERBOSITY_NAME(FATAL) + new_verbosity;
+    } else if (td::begins_with(arg, "-d") || arg == "--dialogs") {
+      options.dialog_count = static_cast<int>(
+          td::clamp(get_next_int_arg(), static_cast<td::int64>(1), static_cast<td::int64>(10000000)));
+    } else if (td::begins_with(arg, "-m") || arg == "--messages") {
+      options.message_count = get_next_int_arg();
+    } else if (td::begins_with(arg, "-n") || arg == "--queries") {
+      options.query_count = static_cast<int>(td::min(get_next_int_arg(), static_cast<td::int64>(1000000000)));
+    } else if (td::begins_with(arg, "-s") || arg == "--seed") {
+      options.seed = static_cast<td::uint64>(get_next_int_arg());
+    } else if (td::begins_with(arg, "-f") || arg == "--database-file") {
+      options.database_path = get_next_arg();
+    } else if (td::begins_with(arg, "-r") || arg == "--reuse") {
+      options.reuse_database = true;
+    } else {
+      usage();
+    }
+  }
+
+  SET_VERBOSITY_LEVEL(new_verbosity_level);
+
+  td::ConcurrentScheduler sched(0, 0);
+  {
+    auto guard = sched.get_main_guard();
+    td::create_actor<AccountDbBench>("AccountDbBench", std::move(options)).release();
+  }
+  sched.start();
+  while (sched.run_main(10)) {
+  }
+  sched.finish();
+  return 0;
+}
@@ -15,6 +15,9 @@
 #include "td/utils/Promise.h"
 #include "td/utils/SliceBuilder.h"
 
+#include <array>
+#include <atomic>
+
 #if TD_MSVC
 #pragma comment(linker, "/STACK:16777216")
 #endif
@@ -324,6 +327,123 @@ class QueryBench final : public td::Benchmark {
   td::ActorOwn<ServerActor> server_;
 };
 
+class WorkStealingBench final : public td::Benchmark {
+ public:
+  struct WorkerActor final : public td::Actor {
+    static std::atomic<int> left_worker_count_;
+    td::uint32 state = 0;
+
+    void start_up() final {
+      set_migratable(true);
+    }
+
+    void work(int n) {
+      for (int i = 0; i < 10000; i++) {
+        state = state * 1664525 + 1013904223;
+      }
+      if (n <= 0) {
+        if (--left_worker_count_ == 0) {
+          td::Scheduler::instance()->finish();
+        }
+        return;
+      }
+      send_closure_later(actor_id(this), &WorkerActor::work, n - 1);
+    }
+  };
+
+  WorkStealingBench(int thread_n, bool work_stealing) : thread_n_(thread_n), work_stealing_(work_stealing) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "WorkStealing (threads_n = " << thread_n_ << ", work_stealing = " << work_stealing_ << ")";
+  }
+
+  void start_up() final {
+    scheduler_ = td::make_unique<td::ConcurrentScheduler>(thread_n_, 0);
+    if (work_stealing_) {
+      scheduler_->enable_work_stealing();
+    }
+    for (auto &worker : workers_) {
+      // all actors are created on the same scheduler
+      worker = scheduler_->create_actor_unsafe<WorkerActor>(1, "WorkerActor").release();
+    }
+    scheduler_->start();
+  }
+
+  void run(int n) final {
+    WorkerActor::left_worker_count_ = static_cast<int>(workers_.size());
+    {
+      auto guard = scheduler_->get_main_guard();
+      for (auto &worker : workers_) {
+        send_closure(worker, &WorkerActor::work, n / static_cast<int>(workers_.size()));
+      }
+    }
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+  }
+
+  void tear_down() final {
+    scheduler_->finish();
+    scheduler_.reset();
+  }
+
+ private:
+  int thread_n_ = 1;
+  bool work_stealing_ = false;
+  std::array<td::ActorId<WorkerActor>, 64> workers_;
+  td::unique_ptr<td::ConcurrentScheduler> scheduler_;
+};
+
+std::atomic<int> WorkStealingBench::WorkerActor::left_worker_count_;
+
+template <std::size_t payload_size>
+class ClosureSizeBench final : public td::Benchmark {
+ public:
+  struct ReceiverActor final : public td::Actor {
+    int left_ = 0;
+
+    void on_payload(std::array<char, payload_size> payload) {
+      if (--left_ == 0) {
+        td::Scheduler::instance()->finish();
+        return;
+      }
+      // delayed closures are always wrapped into a custom event
+      send_closure_later(actor_id(this), &ReceiverActor::on_payload, payload);
+    }
+  };
+
+  td::string get_description() const final {
+    return PSTRING() << "ClosureSize (payload_size = " << payload_size << ")";
+  }
+
+  void start_up() final {
+    scheduler_ = td::make_unique<td::ConcurrentScheduler>(0, 0);
+    receiver_ = scheduler_->create_actor_unsafe<ReceiverActor>(0, "ReceiverActor").release();
+    scheduler_->start();
+  }
+
+  void run(int n) final {
+    {
+      auto guard = scheduler_->get_main_guard();
+      receiver_.get_actor_unsafe()->left_ = n;
+      send_closure_later(receiver_, &ReceiverActor::on_payload, std::array<char, payload_size>{});
+    }
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+  }
+
+  void tear_down() final {
+    scheduler_->finish();
+    scheduler_.reset();
+  }
+
+ private:
+  td::ActorId<ReceiverActor> receiver_;
+  td::unique_ptr<td::ConcurrentScheduler> scheduler_;
+};
+
 int main() {
   td::init_openssl_threads();
 
@@ -346,4 +466,12 @@ int main() {
   bench(RingBench<0>(504, 2));
   bench(RingBench<1>(504, 2));
   bench(RingBench<2>(504, 2));
+  for (int thread_n : {1, 2, 4, 8}) {
+    bench(WorkStealingBench(thread_n, false));
+    bench(WorkStealingBench(thread_n, true));
+  }
+  bench(ClosureSizeBench<8>());
+  bench(ClosureSizeBench<32>());
+  bench(ClosureSizeBench<128>());
+  bench(ClosureSizeBench<512>());
 }
@@ -0,0 +1,156 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
+#include "td/actor/Coroutine.h"
+
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/Promise.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Status.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<td::uint64> allocation_count{0};
+
+void *operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  auto result = std::malloc(size == 0 ? 1 : size);
+  if (result == nullptr) {
+    std::abort();
+  }
+  return result;
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+class ServerActor final : public td::Actor {
+ public:
+  void query(int x, td::Promise<int> promise) {
+    promise.set_value(x + 1);
+  }
+};
+
+// sequentially sends queries to the server and waits for their results
+template <bool use_coroutine>
+class ClientBench final : public td::Benchmark {
+ public:
+  class ClientActor final : public td::Actor {
+   public:
+    ClientActor(td::ActorId<ServerActor> server, int query_count)
+        : server_(std::move(server)), query_count_(query_count) {
+    }
+
+   private:
+    td::ActorId<ServerActor> server_;
+    int query_count_;
+    int result_ = 0;
+
+    void start_up() final {
+      if (use_coroutine) {
+#if TD_HAVE_CXX20_COROUTINES
+        run_coroutine();
+#endif
+      } else {
+        send_query(0);
+      }
+    }
+
+    void send_query(int i) {
+      if (i == query_count_) {
+        return on_finish();
+      }
+      send_closure(server_, &ServerActor::query, result_,
+                   td::PromiseCreator::lambda([actor_id = actor_id(this), i](td::Result<int> r_result) {
+                     send_closure(actor_id, &ClientActor::on_query_result, i, r_result.move_as_ok());
+                   }));
+    }
+
+    void on_query_result(int i, int result) {
+      result_ = result;
+      send_query(i + 1);
+    }
+
+#if TD_HAVE_CXX20_COROUTINES
+    td::ActorTask run_coroutine() {
+      for (int i = 0; i < query_count_; i++) {
+        auto r_result = co_await td::await_promise<int>(actor_id(this), [&](td::Promise<int> promise) {
+          send_closure(server_, &ServerActor::query, result_, std::move(promise));
+        });
+        result_ = r_result.move_as_ok();
+      }
+      on_finish();
+    }
+#endif
+
+    void on_finish() {
+      CHECK(result_ == query_count_);
+      td::Scheduler::instance()->finish();
+      stop();
+    }
+  };
+
+  td::string get_description() const final {
+    return PSTRING() << "Client " << (use_coroutine ? "coroutine" : "promise chain");
+  }
+
+  void start_up() final {
+    scheduler_ = td::make_unique<td::ConcurrentScheduler>(0, 0);
+    server_ = scheduler_->create_actor_unsafe<ServerActor>(0, "ServerActor");
+    scheduler_->start();
+  }
+
+  void run(int n) final {
+    auto begin_allocation_count = allocation_count.load(std::memory_order_relaxed);
+    scheduler_->create_actor_unsafe<ClientActor>(0, "ClientActor", server_.get(), n).release();
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+    query_count_ += n;
+    total_allocation_count_ += allocation_count.load(std::memory_order_relaxed) - begin_allocation_count;
+  }
+
+  void tear_down() final {
+    {
+      auto guard = scheduler_->get_main_guard();
+      server_.reset();
+    }
+    scheduler_->finish();
+    scheduler_.reset();
+    if (query_count_ != 0) {
+      LOG(PLAIN) << get_description() << ": "
+                 << static_cast<double>(total_allocation_count_) / static_cast<double>(query_count_)
+                 << " allocations per query";
+    }
+  }
+
+ private:
+  td::unique_ptr<td::ConcurrentScheduler> scheduler_;
+  td::ActorOwn<ServerActor> server_;
+  td::uint64 query_count_ = 0;
+  td::uint64 total_allocation_count_ = 0;
+};
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  bench(ClientBench<false>());
+#if TD_HAVE_CXX20_COROUTINES
+  bench(ClientBench<true>());
+#else
+  LOG(PLAIN) << "Coroutines are not supported by the compiler";
+#endif
+}
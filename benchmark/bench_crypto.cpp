@@ -233,6 +233,45 @@ class AesIgeDecryptBench final : public td::Benchmark {
   }
 };
 
+template <bool encrypt>
+class AesIgeMultiBench final : public td::Benchmark {
+ public:
+  static constexpr size_t STREAM_COUNT = 8;
+  alignas(64) unsigned char data[DATA_SIZE];
+  td::UInt256 key;
+  td::UInt256 ivs[STREAM_COUNT];
+
+  std::string get_description() const final {
+    return PSTRING() << "AES IGE OpenSSL " << (encrypt ? "encrypt" : "decrypt") << ' ' << STREAM_COUNT
+                     << " streams [" << (DATA_SIZE >> 10) << "KB]";
+  }
+
+  void start_up() final {
+    std::fill(std::begin(data), std::end(data), static_cast<unsigned char>(123));
+    td::Random::secure_bytes(key.raw, sizeof(key));
+    for (auto &iv : ivs) {
+      td::Random::secure_bytes(iv.raw, sizeof(iv));
+    }
+  }
+
+  void run(int n) final {
+    td::vector<td::MutableSlice> data_slices;
+    td::vector<td::MutableSlice> iv_slices;
+    auto stream_size = DATA_SIZE / STREAM_COUNT;
+    for (size_t i = 0; i < STREAM_COUNT; i++) {
+      data_slices.emplace_back(data + i * stream_size, stream_size);
+      iv_slices.push_back(as_mutable_slice(ivs[i]));
+    }
+    for (int i = 0; i < n; i++) {
+      if (encrypt) {
+        td::aes_ige_encrypt_multi(as_slice(key), iv_slices, data_slices);
+      } else {
+        td::aes_ige_decrypt_multi(as_slice(key), iv_slices, data_slices);
+      }
+    }
+  }
+};
+
 class AesCtrBench final : public td::Benchmark {
  public:
   alignas(64) unsigned char data[DATA_SIZE];
@@ -427,6 +466,42 @@ BENCH(SslRand, "ssl_rand_int32") {
 }
 #endif
 
+#if !TD_THREAD_UNSUPPORTED
+template <bool use_drbg>
+class SecureRandInt64Bench final : public td::Benchmark {
+ public:
+  std::string get_description() const final {
+    return PSTRING() << "secure_int64 " << (use_drbg ? "ChaCha20 DRBG" : "RAND_bytes") << " [3 threads]";
+  }
+
+  void start_up() final {
+    td::Random::set_secure_drbg_enabled(use_drbg);
+  }
+
+  void run(int n) final {
+    std::vector<td::thread> v;
+    std::atomic<td::uint64> sum{0};
+    for (int i = 0; i < 3; i++) {
+      v.emplace_back([&sum, n] {
+        td::uint64 res = 0;
+        for (int j = 0; j < n; j++) {
+          res ^= td::Random::secure_uint64();
+        }
+        sum += res;
+      });
+    }
+    for (auto &x : v) {
+      x.join();
+    }
+    td::do_not_optimize_away(sum.load());
+  }
+
+  void tear_down() final {
+    td::Random::set_secure_drbg_enabled(false);
+  }
+};
+#endif
+
 BENCH(SslRandBuf, "ssl_rand_bytes") {
   td::int32 res = 0;
   std::array<td::int32, 1000> buf;
@@ -501,6 +576,8 @@ int main() {
   td::bench(AesIgeShortBench<false>());
   td::bench(AesIgeEncryptBench());
   td::bench(AesIgeDecryptBench());
+  td::bench(AesIgeMultiBench<true>());
+  td::bench(AesIgeMultiBench<false>());
   td::bench(AesEcbBench());
 
   td::bench(Pbkdf2Bench());
@@ -510,6 +587,8 @@ int main() {
   td::bench(TdRandFastBench());
 #if !TD_THREAD_UNSUPPORTED
   td::bench(SslRandBench());
+  td::bench(SecureRandInt64Bench<false>());
+  td::bench(SecureRandInt64Bench<true>());
 #endif
   td::bench(SslRandBufBench());
 #if OPENSSL_VERSION_NUMBER <= 0x10100000L
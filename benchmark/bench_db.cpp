@@ -21,11 +21,13 @@
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/Random.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 
 #include <memory>
+#include <utility>
 
 template <class KeyValueT>
 class TdKvBench final : public td::Benchmark {
@@ -131,6 +133,143 @@ class SqliteKVBench final : public td::Benchmark {
   }
 };
 
+static td::DbKey get_cipher_profile_key(td::Slice profile_name) {
+  if (profile_name == "plain") {
+    return td::DbKey::empty();
+  }
+  if (profile_name == "password") {
+    return td::DbKey::password("cucumber");
+  }
+  auto key = td::DbKey::raw_key(td::string(32, 'k'));
+  td::DbCipherProfile cipher_profile;
+  if (profile_name == "raw_key_8192_sha1") {
+    cipher_profile.page_size = 8192;
+    cipher_profile.hmac = td::DbCipherProfile::Hmac::Sha1;
+  } else if (profile_name == "raw_key_8192_no_hmac") {
+    cipher_profile.page_size = 8192;
+    cipher_profile.hmac = td::DbCipherProfile::Hmac::None;
+  } else {
+    CHECK(profile_name == "raw_key");
+  }
+  key.set_cipher_profile(cipher_profile);
+  return key;
+}
+
+static void create_cipher_bench_db(td::CSlice path, const td::DbKey &key, int row_count) {
+  td::SqliteDb::destroy(path).ignore();
+  auto db = td::SqliteDb::change_key(path, true, key, td::DbKey::empty()).move_as_ok();
+  db.exec("PRAGMA journal_mode=WAL").ensure();
+  db.exec("CREATE TABLE IF NOT EXISTS KV (k INT8 PRIMARY KEY, v BLOB)").ensure();
+  auto stmt = db.get_statement("INSERT INTO KV (k, v) VALUES(?1, ?2)").move_as_ok();
+  td::string value(500, 'v');
+  db.exec("BEGIN TRANSACTION").ensure();
+  for (int i = 0; i < row_count; i++) {
+    stmt.bind_int64(1, i).ensure();
+    stmt.bind_blob(2, value).ensure();
+    stmt.step().ensure();
+    stmt.reset();
+  }
+  db.exec("COMMIT TRANSACTION").ensure();
+}
+
+// random reads with a tiny page cache, so that every read decrypts pages
+class SqliteCipherReadBench final : public td::Benchmark {
+  td::string profile_name_;
+  td::SqliteDb db_;
+  static constexpr int ROW_COUNT = 20000;
+
+ public:
+  explicit SqliteCipherReadBench(td::string profile_name) : profile_name_(std::move(profile_name)) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "SQLite random read with " << td::tag("cipher_profile", profile_name_);
+  }
+
+  void start_up() final {
+    td::string path = "testdb_cipher.sqlite";
+    auto key = get_cipher_profile_key(profile_name_);
+    create_cipher_bench_db(path, key, ROW_COUNT);
+    db_ = td::SqliteDb::open_with_key(path, false, key).move_as_ok();
+    db_.exec("PRAGMA cache_size = 8").ensure();
+  }
+
+  void run(int n) final {
+    auto stmt = db_.get_statement("SELECT v FROM KV WHERE k = ?1").move_as_ok();
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      stmt.bind_int64(1, td::Random::fast(0, ROW_COUNT - 1)).ensure();
+      stmt.step().ensure();
+      CHECK(stmt.has_row());
+      total_size += stmt.view_blob(0).size();
+      stmt.reset();
+    }
+    td::do_not_optimize_away(total_size);
+  }
+
+  void tear_down() final {
+    db_.close();
+  }
+};
+
+// opening cost is dominated by the key derivation
+class SqliteCipherOpenBench final : public td::Benchmark {
+  td::string profile_name_;
+  td::DbKey key_;
+
+ public:
+  explicit SqliteCipherOpenBench(td::string profile_name) : profile_name_(std::move(profile_name)) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "SQLite open with " << td::tag("cipher_profile", profile_name_);
+  }
+
+  void start_up() final {
+    key_ = get_cipher_profile_key(profile_name_);
+    create_cipher_bench_db("testdb_cipher.sqlite", key_, 10);
+  }
+
+  void run(int n) final {
+    for (int i = 0; i < n; i++) {
+      td::SqliteDb::open_with_key("testdb_cipher.sqlite", false, key_).ensure();
+    }
+  }
+};
+
+// migration of an existing encrypted database between cipher profiles through SqliteDb::change_key
+class SqliteCipherMigrationBench final : public td::Benchmark {
+  td::string from_profile_name_;
+  td::string to_profile_name_;
+
+ public:
+  SqliteCipherMigrationBench(td::string from_profile_name, td::string to_profile_name)
+      : from_profile_name_(std::move(from_profile_name)), to_profile_name_(std::move(to_profile_name)) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "SQLite migration of 10000 rows from cipher profile " << from_profile_name_ << " to "
+                     << to_profile_name_;
+  }
+
+  void start_up() final {
+    create_cipher_bench_db("testdb_cipher.sqlite", get_cipher_profile_key(from_profile_name_), 10000);
+  }
+
+  void run(int n) final {
+    auto from_key = get_cipher_profile_key(from_profile_name_);
+    auto to_key = get_cipher_profile_key(to_profile_name_);
+    for (int i = 0; i < n; i++) {
+      td::SqliteDb::change_key("testdb_cipher.sqlite", false, to_key, from_key).ensure();
+      std::swap(from_key, to_key);
+    }
+    if (n % 2 == 1) {
+      // return the database to the initial profile
+      td::SqliteDb::change_key("testdb_cipher.sqlite", false, to_key, from_key).ensure();
+    }
+  }
+};
+
 static td::Status init_db(td::SqliteDb &db) {
   TRY_STATUS(db.exec("PRAGMA encoding=\"UTF-8\""));
   TRY_STATUS(db.exec("PRAGMA journal_mode=WAL"));
@@ -241,4 +380,10 @@ int main() {
   bench(SqliteKVBench<true>());
   bench(SqliteKeyValueAsyncBench());
   bench(SeqKvBench());
+
+  for (auto profile_name : {"plain", "password", "raw_key", "raw_key_8192_sha1", "raw_key_8192_no_hmac"}) {
+    bench(SqliteCipherOpenBench(profile_name));
+    bench(SqliteCipherReadBench(profile_name));
+  }
+  bench(SqliteCipherMigrationBench("raw_key", "raw_key_8192_no_hmac"));
 }
@@ -0,0 +1,160 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/MessageEntity.h"
+
+#include "td/utils/common.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/Clocks.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <algorithm>
+
+// usage: bench_entities [html|markdown_v2|markdown_v3] [corpus]
+// each non-empty line of the corpus is a separate message, in which "\n" denotes a line break
+// if the corpus isn't specified, random messages, similar to messages sent by bots, are generated
+
+static td::vector<td::string> load_corpus(td::CSlice path) {
+  auto r_content = td::read_file_str(path);
+  if (r_content.is_error()) {
+    LOG(FATAL) << "Failed to read corpus: " << r_content.error();
+  }
+  td::vector<td::string> result;
+  for (auto line : td::full_split(td::Slice(r_content.ok()), '\n')) {
+    line = td::trim(line);
+    if (line.empty()) {
+      continue;
+    }
+    td::string message;
+    for (size_t i = 0; i < line.size(); i++) {
+      if (line[i] == '\\' && i + 1 < line.size() && line[i + 1] == 'n') {
+        message += '\n';
+        i++;
+      } else {
+        message += line[i];
+      }
+    }
+    result.push_back(std::move(message));
+  }
+  return result;
+}
+
+static td::vector<td::string> generate_corpus(td::Slice parse_mode) {
+  bool is_html = parse_mode == "html";
+  const td::vector<td::string> words{"price",         "order",  "status:", "@username",
+                                     "#news",         "$BTC",   "12:34",   "telegram.org",
+                                     "/start",        "Привет", "👍",      "example.com/path?query=1",
+                                     "user@mail.com", "42",     "done."};
+  auto wrap = [is_html](const td::string &text, int kind) -> td::string {
+    if (is_html) {
+      switch (kind) {
+        case 0:
+          return "<b>" + text + "</b>";
+        case 1:
+          return "<i>" + text + "</i>";
+        case 2:
+          return "<code>" + text + "</code>";
+        default:
+          return "<a href=\"https://t.me/\">" + text + "</a>";
+      }
+    }
+    switch (kind) {
+      case 0:
+        return "*" + text + "*";
+      case 1:
+        return "_" + text + "_";
+      case 2:
+        return "`" + text + "`";
+      default:
+        return "[" + text + "](https://t.me/)";
+    }
+  };
+
+  td::vector<td::string> result;
+  for (int i = 0; i < 1000; i++) {
+    td::string message;
+    auto word_count = td::Random::fast(10, 300);
+    for (int j = 0; j < word_count; j++) {
+      td::string word = words[td::Random::fast(0, static_cast<int>(words.size()) - 1)];
+      if (!is_html && parse_mode == "markdown_v2") {
+        td::string escaped_word;
+        for (auto c : word) {
+          if (td::Slice("_*[]()~`>#+-=|{}.!").find(c) != td::Slice::npos) {
+            escaped_word += '\\';
+          }
+          escaped_word += c;
+        }
+        word = std::move(escaped_word);
+      }
+      if (td::Random::fast(0, 9) == 0) {
+        word = wrap(word, td::Random::fast(0, 3));
+      }
+      message += word;
+      message += td::Random::fast(0, 15) == 0 ? '\n' : ' ';
+    }
+    result.push_back(std::move(message));
+  }
+  return result;
+}
+
+static bool parse_message(td::Slice parse_mode, td::string text) {
+  td::vector<td::MessageEntity> entities;
+  if (parse_mode == "markdown_v3") {
+    auto parsed_text = td::parse_markdown_v3(td::FormattedText{std::move(text), {}});
+    text = std::move(parsed_text.text);
+    entities = std::move(parsed_text.entities);
+  } else {
+    auto r_entities = parse_mode == "html" ? td::parse_html(text) : td::parse_markdown_v2(text);
+    if (r_entities.is_error()) {
+      return false;
+    }
+    entities = r_entities.move_as_ok();
+  }
+  return td::fix_formatted_text(text, entities, false, false, false, false, false).is_ok();
+}
+
+int main(int argc, char **argv) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+
+  td::string parse_mode = argc > 1 ? argv[1] : "html";
+  auto corpus = argc > 2 ? load_corpus(td::CSlice(argv[2])) : generate_corpus(parse_mode);
+  if (corpus.empty()) {
+    LOG(FATAL) << "Corpus is empty";
+  }
+
+  const int ITERATION_COUNT = 20;
+  td::vector<double> times_per_kb;
+  size_t total_size = 0;
+  size_t failed_count = 0;
+  double total_time = 0.0;
+  for (int iteration = 0; iteration < ITERATION_COUNT; iteration++) {
+    for (auto &message : corpus) {
+      auto start_time = td::Clocks::monotonic();
+      bool is_ok = parse_message(parse_mode, message);
+      auto time = td::Clocks::monotonic() - start_time;
+      if (iteration == 0) {
+        failed_count += static_cast<size_t>(!is_ok);
+      }
+      total_size += message.size();
+      total_time += time;
+      times_per_kb.push_back(time * 1024 / static_cast<double>(td::max(message.size(), static_cast<size_t>(1))));
+    }
+  }
+
+  std::sort(times_per_kb.begin(), times_per_kb.end());
+  auto get_percentile = [&](size_t percent) {
+    return times_per_kb[td::min(times_per_kb.size() * percent / 100, times_per_kb.size() - 1)] * 1e6;
+  };
+  LOG(PLAIN) << "Parsed " << corpus.size() << " messages in " << parse_mode << " format, " << failed_count
+             << " of them are invalid";
+  LOG(PLAIN) << "Average: " << total_time * 1e6 * 1024 / static_cast<double>(total_size)
+             << " us/KB, p50: " << get_percentile(50) << " us/KB, p99: " << get_percentile(99) << " us/KB";
+  return 0;
+}
@@ -4,13 +4,20 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "td/mtproto/AuthKey.h"
 #include "td/mtproto/DhCallback.h"
 #include "td/mtproto/DhHandshake.h"
+#include "td/mtproto/PacketInfo.h"
+#include "td/mtproto/Transport.h"
 
+#include "td/utils/as.h"
 #include "td/utils/base64.h"
 #include "td/utils/benchmark.h"
 #include "td/utils/common.h"
+#include "td/utils/Random.h"
 #include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Storer.h"
 
 #include <map>
 
@@ -67,6 +74,61 @@ class HandshakeBench final : public td::Benchmark {
   }
 };
 
+// decryption of an unaligned received packet: copying to an aligned buffer and decrypting in place
+// versus decrypting directly into an aligned buffer
+class TransportReadBench final : public td::Benchmark {
+ public:
+  TransportReadBench(size_t data_size, bool is_inplace) : data_size_(data_size), is_inplace_(is_inplace) {
+  }
+
+ private:
+  size_t data_size_;
+  bool is_inplace_;
+  td::mtproto::AuthKey auth_key_;
+  td::string packet_;
+  td::string dest_;
+
+  td::string get_description() const final {
+    return PSTRING() << "TransportRead" << (is_inplace_ ? "CopyInplace" : "OutOfPlace") << " " << data_size_;
+  }
+
+  void start_up() final {
+    auth_key_ = td::mtproto::AuthKey(td::Random::secure_uint64(), td::string(256, 'k'));
+    td::string message(4, '\0');
+    td::as<td::uint32>(&message[0]) = static_cast<td::uint32>(data_size_);
+    message += td::string(data_size_, 'a');
+    auto storer = td::create_storer(message);
+
+    td::mtproto::PacketInfo info;
+    info.type = td::mtproto::PacketInfo::EndToEnd;
+    info.version = 2;
+    info.is_creator = true;
+    auto packet_size = td::mtproto::Transport::write(storer, auth_key_, &info);
+    packet_ = td::string(packet_size + 1, '\0');
+    td::mtproto::Transport::write(storer, auth_key_, &info, td::MutableSlice(packet_).substr(1));
+    dest_ = td::string(packet_size, '\0');
+  }
+
+  void run(int n) final {
+    auto packet = td::Slice(packet_).substr(1);
+    for (int i = 0; i < n; i++) {
+      td::mtproto::PacketInfo info;
+      info.type = td::mtproto::PacketInfo::EndToEnd;
+      info.version = 2;
+      if (is_inplace_) {
+        td::MutableSlice(dest_).copy_from(packet);
+        td::mtproto::Transport::read(td::MutableSlice(dest_), auth_key_, &info).ensure();
+      } else {
+        td::mtproto::Transport::read(packet, dest_, auth_key_, &info).ensure();
+      }
+    }
+  }
+};
+
 int main() {
   td::bench(HandshakeBench());
+  for (size_t data_size : {1024, 65536, 1 << 20}) {
+    td::bench(TransportReadBench(data_size, true));
+    td::bench(TransportReadBench(data_size, false));
+  }
 }
@@ -13,22 +13,43 @@
 #include "td/utils/find_boundary.h"
 #include "td/utils/logging.h"
 
+#include <string>
+#include <utility>
+
 static std::string http_query = "GET / HTTP/1.1\r\nConnection:keep-alive\r\nhost:127.0.0.1:8080\r\n\r\n";
 static const size_t block_size = 2500;
 
+static std::string get_bot_api_query() {
+  std::string content = "chat_id=123456789&text=Hello%2C+world%21&parse_mode=HTML&disable_notification=true";
+  return "POST /bot123456:ABC-DEF1234ghIkl-zyx57W2v1u123ew11/sendMessage HTTP/1.1\r\n"
+         "Host: api.telegram.org\r\nUser-Agent: bench\r\nAccept: */*\r\n"
+         "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+         std::to_string(content.size()) + "\r\nConnection: keep-alive\r\n\r\n" + content;
+}
+
+// ops/sec is the number of parsed requests per second
 class HttpReaderBench final : public td::Benchmark {
+ public:
+  HttpReaderBench(std::string description, std::string query)
+      : description_(std::move(description)), query_(std::move(query)) {
+  }
+
+ private:
+  std::string description_;
+  std::string query_;
+
   std::string get_description() const final {
-    return "HttpReaderBench";
+    return description_;
   }
 
   void run(int n) final {
-    auto cnt = static_cast<int>(block_size / http_query.size());
+    auto cnt = static_cast<int>(td::max(block_size / query_.size(), static_cast<size_t>(1)));
     td::HttpQuery q;
     int parsed = 0;
     int sent = 0;
     for (int i = 0; i < n; i += cnt) {
       for (int j = 0; j < cnt; j++) {
-        writer_.append(http_query);
+        writer_.append(query_);
         sent++;
       }
       reader_.sync_with_writer();
@@ -47,6 +68,7 @@ class HttpReaderBench final : public td::Benchmark {
   td::HttpReader http_reader_;
 
   void start_up() final {
+    writer_ = td::ChainBufferWriter();
     reader_ = writer_.extract_reader();
     http_reader_.init(&reader_, 10000, 0);
   }
@@ -74,6 +96,7 @@ class BufferBench final : public td::Benchmark {
   td::HttpReader http_reader_;
 
   void start_up() final {
+    writer_ = td::ChainBufferWriter();
     reader_ = writer_.extract_reader();
   }
 };
@@ -104,6 +127,7 @@ class FindBoundaryBench final : public td::Benchmark {
   td::HttpReader http_reader_;
 
   void start_up() final {
+    writer_ = td::ChainBufferWriter();
     reader_ = writer_.extract_reader();
   }
 };
@@ -112,5 +136,6 @@ int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   td::bench(BufferBench());
   td::bench(FindBoundaryBench());
-  td::bench(HttpReaderBench());
+  td::bench(HttpReaderBench("HttpReaderBench", http_query));
+  td::bench(HttpReaderBench("HttpReaderBotApiBench", get_bot_api_query()));
 }
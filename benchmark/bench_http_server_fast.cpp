@@ -16,6 +16,7 @@
 #include "td/utils/BufferedFd.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/detail/PollableFd.h"
+#include "td/utils/port/Poll.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
@@ -44,11 +45,9 @@ class HttpEchoConnection final : public td::Actor {
     td::Slice content = "hello world";
     //auto content = td::BufferSlice("hello world");
     hc.init_ok();
-    hc.set_keep_alive();
+    hc.add_header_lines("Connection: keep-alive\r\nServer: TDLib/test\r\nContent-Type: text/html\r\n");
+    hc.add_date();
     hc.set_content_size(content.size());
-    hc.add_header("Server", "TDLib/test");
-    hc.add_header("Date", "Thu Dec 14 01:41:50 2017");
-    hc.add_header("Content-Type:", "text/html");
     auto res = hc.finish(content);
     fd_.output_buffer().append(res.ok());
   }
@@ -83,6 +82,7 @@ class HttpEchoConnection final : public td::Actor {
 };
 
 const int N = 8;
+// every scheduler has its own listener; the kernel distributes connections between them because of SO_REUSEPORT
 class Server final : public td::TcpListener::Callback {
  public:
   void start_up() final {
@@ -90,9 +90,7 @@ class Server final : public td::TcpListener::Callback {
         td::create_actor<td::TcpListener>("Listener", 8082, td::ActorOwn<td::TcpListener::Callback>(actor_id(this)));
   }
   void accept(td::SocketFd fd) final {
-    pos_++;
-    auto scheduler_id = pos_ % (N != 0 ? N : 1) + (N != 0);
-    td::create_actor_on_scheduler<HttpEchoConnection>("HttpEchoConnection", scheduler_id, std::move(fd)).release();
+    td::create_actor<HttpEchoConnection>("HttpEchoConnection", std::move(fd)).release();
   }
   void hangup() final {
     LOG(ERROR) << "Hanging up..";
@@ -101,13 +99,23 @@ class Server final : public td::TcpListener::Callback {
 
  private:
   td::ActorOwn<td::TcpListener> listener_;
-  int pos_{0};
 };
 
-int main() {
+// usage: bench_http_server_fast [epoll|io_uring]
+int main(int argc, char **argv) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  td::Slice backend = argc > 1 ? td::Slice(argv[1]) : td::Slice();
+#if defined(TD_POLL_EPOLL) && TD_USE_IO_URING_POLL
+  td::detail::IoUringPoll::set_io_uring_enabled(backend != "epoll");
+#else
+  if (backend == "io_uring") {
+    LOG(FATAL) << "Poll with io_uring is disabled; rebuild with TD_WITH_IO_URING_POLL";
+  }
+#endif
   auto scheduler = td::make_unique<td::ConcurrentScheduler>(N, 0);
-  scheduler->create_actor_unsafe<Server>(0, "Server").release();
+  for (int scheduler_id = (N != 0); scheduler_id <= N; scheduler_id++) {
+    scheduler->create_actor_unsafe<Server>(scheduler_id, "Server").release();
+  }
   scheduler->start();
   while (scheduler->run_main(10)) {
     // empty
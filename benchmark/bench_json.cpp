@@ -0,0 +1,64 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/ClientJson.h"
+
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
+
+#include <cstring>
+
+// measures throughput of JSON encoding of synchronously returned responses in MB/s
+class JsonExecuteBench final : public td::Benchmark {
+ public:
+  explicit JsonExecuteBench(int entity_count) : entity_count_(entity_count) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "JSON execute with " << entity_count_ << " entities";
+  }
+
+  void start_up() final {
+    td::string text;
+    for (int i = 0; i < entity_count_; i++) {
+      text += PSTRING() << "@username" << i << " #hashtag ";
+    }
+    request_ = PSTRING() << "{\"@type\":\"getTextEntities\",\"text\":\"" << text << "\",\"@extra\":1}";
+  }
+
+  void run(int n) final {
+    auto start_time = td::Time::now();
+    for (int i = 0; i < n; i++) {
+      auto result = td::json_execute(request_);
+      total_size_ += static_cast<double>(std::strlen(result));
+    }
+    total_time_ += td::Time::now() - start_time;
+  }
+
+  void tear_down() final {
+    if (total_time_ > 0) {
+      LOG(PLAIN) << get_description() << ": " << total_size_ / total_time_ / (1 << 20) << " MB/s";
+    }
+  }
+
+ private:
+  int entity_count_;
+  td::string request_;
+  double total_size_ = 0.0;
+  double total_time_ = 0.0;
+};
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  td::json_execute("{\"@type\":\"setLogVerbosityLevel\",\"new_verbosity_level\":0}");
+  for (int entity_count : {10, 1000, 100000}) {
+    td::bench(JsonExecuteBench(entity_count));
+  }
+}
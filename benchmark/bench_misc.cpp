@@ -7,8 +7,13 @@
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/telegram_api.hpp"
 
+#include "td/utils/base64.h"
 #include "td/utils/benchmark.h"
+#include "td/utils/ChainScheduler.h"
 #include "td/utils/common.h"
+#include "td/utils/Gzip.h"
+#include "td/utils/Hints.h"
+#include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
 #include "td/utils/port/EventFd.h"
@@ -17,10 +22,14 @@
 #include "td/utils/port/RwMutex.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 #include "td/utils/ThreadSafeCounter.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/utf8.h"
 
 #if !TD_WINDOWS
 #include <unistd.h>
@@ -102,6 +111,29 @@ BENCH(NewObj, "new struct, then delete") {
   td::do_not_optimize_away(res);
 }
 
+BENCH(SmallLambdaPromise, "create, move and set small lambda promise") {
+  td::int64 res = 0;
+  for (int i = 0; i < n; i++) {
+    td::Promise<td::int32> promise =
+        td::PromiseCreator::lambda([&res, i, j = static_cast<td::int64>(i)](td::int32 value) { res += value + i + j; });
+    auto moved_promise = std::move(promise);
+    moved_promise.set_value(1);
+  }
+  td::do_not_optimize_away(res);
+}
+
+BENCH(BigLambdaPromise, "create, move and set big lambda promise") {
+  td::int64 res = 0;
+  for (int i = 0; i < n; i++) {
+    std::array<td::int64, 16> captures{};
+    td::Promise<td::int32> promise = td::PromiseCreator::lambda(
+        [&res, captures](td::int32 value) { res += value + static_cast<td::int64>(captures.size()); });
+    auto moved_promise = std::move(promise);
+    moved_promise.set_value(1);
+  }
+  td::do_not_optimize_away(res);
+}
+
 #if !TD_THREAD_UNSUPPORTED
 BENCH(ThreadNew, "new struct, then delete in 2 threads") {
   NewObjBench a;
@@ -411,6 +443,490 @@ std::atomic<td::int64> AtomicCounterBench<StrictOrder>::counter_;
 
 #endif
 
+class JsonDecodeBench final : public td::Benchmark {
+ public:
+  JsonDecodeBench(td::string description, td::string json) : description_(std::move(description)), json_(std::move(json)) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "json_decode " << description_ << " of size " << json_.size();
+  }
+
+  void run(int n) final {
+    td::string buffer;
+    for (int i = 0; i < n; i++) {
+      buffer = json_;
+      auto r_value = td::json_decode(buffer);
+      CHECK(r_value.is_ok());
+      td::do_not_optimize_away(r_value.ok().type());
+    }
+  }
+
+ private:
+  td::string description_;
+  td::string json_;
+};
+
+static td::string get_send_message_request(td::Slice text, int request_id) {
+  return PSTRING() << "{\"@type\":\"sendMessage\",\"chat_id\":-1001234567890,\"message_thread_id\":0,"
+                      "\"reply_to\":null,\"options\":{\"@type\":\"messageSendOptions\",\"disable_notification\":"
+                      "false,\"from_background\":false},\"input_message_content\":{\"@type\":\"inputMessageText\","
+                      "\"text\":{\"@type\":\"formattedText\",\"text\":\""
+                   << text
+                   << "\",\"entities\":[{\"@type\":\"textEntity\",\"offset\":0,\"length\":5,\"type\":{\"@type\":"
+                      "\"textEntityTypeBold\"}}]},\"disable_web_page_preview\":true,\"clear_draft\":false}"
+                      ",\"@extra\":"
+                   << request_id << "}";
+}
+
+static void bench_json_decode() {
+  td::string long_text;
+  for (int i = 0; i < 500; i++) {
+    long_text += "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ";
+  }
+  td::string escaped_text;
+  for (int i = 0; i < 500; i++) {
+    escaped_text += "Line \\\"quoted\\\"\\n\\u041f\\u0440\\u0438\\u0432\\u0435\\u0442 ";
+  }
+  td::string batch = "[";
+  for (int i = 0; i < 100; i++) {
+    if (i != 0) {
+      batch += ',';
+    }
+    batch += get_send_message_request("Hello, world!", i);
+  }
+  batch += ']';
+
+  td::bench(JsonDecodeBench("short sendMessage", get_send_message_request("Hello, world!", 1)));
+  td::bench(JsonDecodeBench("long sendMessage", get_send_message_request(long_text, 1)));
+  td::bench(JsonDecodeBench("escaped sendMessage", get_send_message_request(escaped_text, 1)));
+  td::bench(JsonDecodeBench("sendMessage batch", batch));
+}
+
+class Utf8Bench final : public td::Benchmark {
+ public:
+  Utf8Bench(td::string description, td::string text) : description_(std::move(description)), text_(std::move(text)) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "check_utf8 + utf8_length + utf8_utf16_length of " << description_ << " text of size "
+                     << text_.size();
+  }
+
+  void run(int n) final {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      CHECK(td::check_utf8(text_));
+      result += td::utf8_length(text_);
+      result += td::utf8_utf16_length(text_);
+    }
+    td::do_not_optimize_away(result);
+  }
+
+ private:
+  td::string description_;
+  td::string text_;
+};
+
+static void bench_utf8() {
+  td::string ascii_text;
+  td::string cjk_text;
+  for (int i = 0; i < 100; i++) {
+    ascii_text += "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Привет! ";
+    cjk_text += "日本語のテキスト、中文文本。한국어 텍스트 🏟 ";
+  }
+  td::bench(Utf8Bench("short ASCII", "Hello, world!"));
+  td::bench(Utf8Bench("ASCII-heavy", ascii_text));
+  td::bench(Utf8Bench("CJK-heavy", cjk_text));
+}
+
+template <bool is_url>
+class Base64Bench final : public td::Benchmark {
+ public:
+  explicit Base64Bench(size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      data_ += static_cast<char>(td::Random::fast(0, 255));
+    }
+    buffer_.resize(size * 2 + 4);
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << (is_url ? "base64url" : "base64") << " encode + decode of " << data_.size() << " bytes";
+  }
+
+  void run(int n) final {
+    size_t result = 0;
+    auto buffer = td::MutableSlice(buffer_);
+    for (int i = 0; i < n; i++) {
+      auto encoded = is_url ? td::base64url_encode(data_, buffer) : td::base64_encode(data_, buffer);
+      auto r_decoded = is_url ? td::base64url_decode(encoded, buffer.substr(encoded.size()))
+                              : td::base64_decode(encoded, buffer.substr(encoded.size()));
+      CHECK(r_decoded.is_ok());
+      result += r_decoded.ok().size();
+    }
+    td::do_not_optimize_away(result);
+  }
+
+ private:
+  td::string data_;
+  td::string buffer_;
+};
+
+static void bench_base64() {
+  for (size_t size : {16, 1000, 100000}) {
+    td::bench(Base64Bench<false>(size));
+    td::bench(Base64Bench<true>(size));
+  }
+}
+
+#if TD_HAVE_ZLIB
+class GzipDecodeBench final : public td::Benchmark {
+ public:
+  explicit GzipDecodeBench(int message_count) : message_count_(message_count) {
+    // imitate serialized messages: small integers, identifiers and text in UTF-8
+    td::string data;
+    for (int i = 0; i < message_count_; i++) {
+      for (int j = 0; j < 8; j++) {
+        auto value = td::Random::fast(0, j < 4 ? 1000 : 1000000000);
+        data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+      }
+      auto word_count = td::Random::fast(1, 50);
+      for (int j = 0; j < word_count; j++) {
+        static const char *words[] = {"Hello", "world", "Привет", "message", "https://t.me/", "👍", "test", "@user"};
+        data += words[td::Random::fast(0, 7)];
+        data += ' ';
+      }
+    }
+    packed_data_ = td::gzencode(data, 1.0);
+    CHECK(!packed_data_.empty());
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "gzdecode of messages.getHistory-like response with " << message_count_ << " messages";
+  }
+
+  void run(int n) final {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      auto data = td::gzdecode(packed_data_.as_slice());
+      CHECK(!data.empty());
+      result += data.size();
+    }
+    td::do_not_optimize_away(result);
+  }
+
+ private:
+  int message_count_;
+  td::BufferSlice packed_data_;
+};
+
+class GzipEncodeBench final : public td::Benchmark {
+ public:
+  GzipEncodeBench() {
+    for (int i = 0; i < 1000; i++) {
+      query_ += PSTRING() << "query text " << td::Random::fast(0, 1000) << ' ';
+    }
+    query_.resize(16384);
+  }
+
+  td::string get_description() const final {
+    return "gzencode of 16KB query";
+  }
+
+  void run(int n) final {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      result += td::gzencode(query_, 0.9).size();
+    }
+    td::do_not_optimize_away(result);
+  }
+
+ private:
+  td::string query_;
+};
+#endif
+
+static void bench_gzip() {
+#if TD_HAVE_ZLIB
+  td::bench(GzipDecodeBench(100));
+  td::bench(GzipDecodeBench(1000));
+  td::bench(GzipEncodeBench());
+#endif
+}
+
+static const td::Hints &get_bench_hints() {
+  static const td::Hints hints = [] {
+    td::Hints result;
+    td::Random::Xorshift128plus rnd(123);
+    for (int i = 1; i <= 1000000; i++) {
+      td::string name;
+      auto word_count = rnd.fast(1, 3);
+      for (int j = 0; j < word_count; j++) {
+        if (j != 0) {
+          name += ' ';
+        }
+        auto length = rnd.fast(3, 10);
+        for (int k = 0; k < length; k++) {
+          name += static_cast<char>('a' + rnd.fast(0, 25));
+        }
+      }
+      result.add(i, name);
+      result.set_rating(i, rnd.fast(0, 1000000));
+    }
+    return result;
+  }();
+  return hints;
+}
+
+class HintsSearchBench final : public td::Benchmark {
+ public:
+  HintsSearchBench(td::string query, td::int32 limit) : query_(std::move(query)), limit_(limit) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "Hints search \"" << query_ << "\" with limit " << limit_ << " in 1000000 keys";
+  }
+
+  void start_up() final {
+    get_bench_hints();
+  }
+
+  void run(int n) final {
+    auto &hints = get_bench_hints();
+    for (int i = 0; i < n; i++) {
+      auto result = hints.search(query_, limit_);
+      td::do_not_optimize_away(result.first);
+    }
+  }
+
+ private:
+  td::string query_;
+  td::int32 limit_;
+};
+
+static void bench_hints_search() {
+  td::bench(HintsSearchBench("q", 50));
+  td::bench(HintsSearchBench("abc", 50));
+  td::bench(HintsSearchBench("abcde", 50));
+  td::bench(HintsSearchBench("a b", 50));
+  td::bench(HintsSearchBench("qwerty", 10));
+}
+
+class ChainSchedulerBench final : public td::Benchmark {
+ public:
+  ChainSchedulerBench(int task_count, int chain_count) : task_count_(task_count), chain_count_(chain_count) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "ChainScheduler with " << task_count_ << " tasks in " << chain_count_ << " chains";
+  }
+
+  void start_up() final {
+    verbosity_level_ = GET_VERBOSITY_LEVEL();
+    SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  }
+
+  void tear_down() final {
+    SET_VERBOSITY_LEVEL(verbosity_level_);
+  }
+
+  void run(int n) final {
+    for (int i = 0; i < n; i++) {
+      td::ChainScheduler<int> scheduler;
+      for (int j = 0; j < task_count_; j++) {
+        // every 16th task is sent to two chains at once, like a message forwarded to another chat
+        td::ChainScheduler<int>::ChainId chains[2] = {static_cast<td::uint64>(j % chain_count_ + 1),
+                                                      static_cast<td::uint64>((j + 1) % chain_count_ + 1)};
+        scheduler.create_task(td::Span<td::ChainScheduler<int>::ChainId>(chains, j % 16 == 0 ? 2 : 1), j);
+      }
+
+      int finished_count = 0;
+      td::vector<td::ChainScheduler<int>::TaskId> active_tasks;
+      while (finished_count < task_count_) {
+        while (true) {
+          auto o_task = scheduler.start_next_task();
+          if (!o_task) {
+            break;
+          }
+          active_tasks.push_back(o_task.value().task_id);
+        }
+        CHECK(!active_tasks.empty());
+        for (auto task_id : active_tasks) {
+          scheduler.finish_task(task_id);
+          finished_count++;
+        }
+        active_tasks.clear();
+      }
+    }
+  }
+
+ private:
+  int task_count_;
+  int chain_count_;
+  int verbosity_level_ = 0;
+};
+
+class UpdatesDifferenceBuilder {
+ public:
+  void store_int(td::int32 value) {
+    data_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  void store_long(td::int64 value) {
+    data_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  void store_string(td::Slice str) {
+    CHECK(str.size() < (1 << 24));
+    size_t header_size = 1;
+    if (str.size() < 254) {
+      data_ += static_cast<char>(str.size());
+    } else {
+      header_size = 4;
+      store_int(static_cast<td::int32>((str.size() << 8) + 254));
+    }
+    data_.append(str.data(), str.size());
+    data_.append((4 - (header_size + str.size()) % 4) % 4, '\0');
+  }
+
+  void store_vector_header(td::int32 size) {
+    store_int(0x1cb5c415);
+    store_int(size);
+  }
+
+  void store_message(td::int32 id) {
+    store_int(td::telegram_api::message::ID);
+    store_int(256 | 128 | 1024);  // from_id, entities, views and forwards
+    store_int(id);
+    store_int(td::telegram_api::peerUser::ID);
+    store_long(td::Random::fast(1, 1000000000));
+    store_int(td::telegram_api::peerUser::ID);
+    store_long(123456789);
+    store_int(1700000000 + id);
+    td::string text;
+    auto word_count = td::Random::fast(1, 40);
+    for (int i = 0; i < word_count; i++) {
+      text += "word ";
+    }
+    store_string(text);
+    auto entity_count = td::Random::fast(0, 3);
+    store_vector_header(entity_count);
+    for (int i = 0; i < entity_count; i++) {
+      store_int(td::telegram_api::messageEntityBold::ID);
+      store_int(i * 5);
+      store_int(4);
+    }
+    store_int(td::Random::fast(0, 100000));
+    store_int(td::Random::fast(0, 100));
+  }
+
+  void store_update(td::int32 pts) {
+    if (pts % 2 == 0) {
+      store_int(td::telegram_api::updateUserStatus::ID);
+      store_long(td::Random::fast(1, 1000000000));
+      store_int(td::telegram_api::userStatusOffline::ID);
+      store_int(1700000000);
+    } else {
+      store_int(td::telegram_api::updateReadHistoryInbox::ID);
+      store_int(0);
+      store_int(td::telegram_api::peerUser::ID);
+      store_long(td::Random::fast(1, 1000000000));
+      store_int(pts);
+      store_int(0);
+      store_int(pts);
+      store_int(1);
+    }
+  }
+
+  void store_user(td::int64 user_id) {
+    store_int(td::telegram_api::user::ID);
+    store_int(1 | 2 | 4 | 8 | 32 | 64);  // access_hash, names, username, photo and status
+    store_int(0);
+    store_long(user_id);
+    store_long(td::Random::fast(1, 1000000000));
+    store_string("First");
+    store_string("Last");
+    store_string("username");
+    store_int(td::telegram_api::userProfilePhoto::ID);
+    store_int(0);
+    store_long(td::Random::fast(1, 1000000000));
+    store_int(2);
+    store_int(td::telegram_api::userStatusOffline::ID);
+    store_int(1700000000);
+  }
+
+  td::BufferSlice get_updates_difference(int message_count) {
+    data_.clear();
+    store_int(td::telegram_api::updates_difference::ID);
+    store_vector_header(message_count);
+    for (int i = 0; i < message_count; i++) {
+      store_message(i + 1);
+    }
+    store_vector_header(0);
+    store_vector_header(message_count);
+    for (int i = 0; i < message_count; i++) {
+      store_update(i + 1);
+    }
+    store_vector_header(0);
+    store_vector_header(message_count / 10);
+    for (int i = 0; i < message_count / 10; i++) {
+      store_user(i + 1);
+    }
+    store_int(td::telegram_api::updates_state::ID);
+    for (int i = 0; i < 5; i++) {
+      store_int(i + 1);
+    }
+    return td::BufferSlice(data_);
+  }
+
+ private:
+  td::string data_;
+};
+
+class UpdatesDifferenceParseBench final : public td::Benchmark {
+ public:
+  explicit UpdatesDifferenceParseBench(int message_count)
+      : message_count_(message_count), data_(UpdatesDifferenceBuilder().get_updates_difference(message_count)) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "Parse updates.difference with " << message_count_ << " messages of total size "
+                     << data_.size();
+  }
+
+  void run(int n) final {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      td::TlBufferParser parser(&data_);
+      auto difference = td::telegram_api::updates_getDifference::fetch_result(parser);
+      parser.fetch_end();
+      CHECK(parser.get_error() == nullptr);
+      result += difference->get_id();
+    }
+    td::do_not_optimize_away(result);
+  }
+
+  size_t get_size() const {
+    return data_.size();
+  }
+
+ private:
+  int message_count_;
+  td::BufferSlice data_;
+};
+
+static void bench_tl_parse() {
+  for (int message_count : {100, 10000}) {
+    UpdatesDifferenceParseBench bench(message_count);
+    td::bench(bench);
+
+    const int RUN_COUNT = 100;
+    auto time = td::bench_n(bench, RUN_COUNT).first;
+    LOG(ERROR) << "Parse throughput: " << static_cast<double>(bench.get_size()) * RUN_COUNT / time / (1 << 20)
+               << " MB/s";
+  }
+}
+
 class IdDuplicateCheckerOld {
  public:
   static td::string get_description() {
@@ -635,6 +1151,15 @@ class DuplicateCheckerBenchEvenOdd final : public td::Benchmark {
 int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
 
+  bench_json_decode();
+  bench_utf8();
+  bench_base64();
+  bench_gzip();
+  bench_hints_search();
+  td::bench(ChainSchedulerBench(100000, 10000));
+  td::bench(ChainSchedulerBench(100000, 100));
+  bench_tl_parse();
+
   td::bench(DuplicateCheckerBenchEvenOdd<IdDuplicateCheckerNew<1000>>());
   td::bench(DuplicateCheckerBenchEvenOdd<IdDuplicateCheckerNew<300>>());
   td::bench(DuplicateCheckerBenchEvenOdd<IdDuplicateCheckerArray<1000>>());
@@ -700,6 +1225,8 @@ int main() {
 #endif
   td::bench(NewObjBench());
   td::bench(NewIntBench());
+  td::bench(SmallLambdaPromiseBench());
+  td::bench(BigLambdaPromiseBench());
 #if !TD_WINDOWS
   td::bench(PipeBench());
 #endif
@@ -12,11 +12,13 @@
 #include "td/utils/port/thread.h"
 #include "td/utils/queue.h"
 #include "td/utils/Random.h"
+#include "td/utils/SliceBuilder.h"
 
 // TODO: check system calls
 // TODO: all return values must be checked
 
 #include <atomic>
+#include <ctime>
 
 #if TD_PORT_POSIX
 #include <pthread.h>
@@ -847,6 +849,140 @@ class RingBenchmark final : public td::Benchmark {
 };
 #endif
 
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+// compares one-by-one and batched sending through MpscPollableQueue
+// every reader wakeup costs a write to the eventfd by the writer and a read from it by the reader
+class MpscPollableQueueBatchBenchmark final : public td::Benchmark {
+  td::MpscPollableQueue<qvalue_t> queue_;
+  int batch_size_;
+  bool use_batch_;
+  td::int64 reader_wakeup_count_ = 0;
+  td::int64 value_count_ = 0;
+
+ public:
+  MpscPollableQueueBatchBenchmark(int batch_size, bool use_batch) : batch_size_(batch_size), use_batch_(use_batch) {
+  }
+  ~MpscPollableQueueBatchBenchmark() final {
+    if (value_count_ != 0) {
+      auto wakeups_per_value = static_cast<double>(reader_wakeup_count_) / static_cast<double>(value_count_);
+      LOG(PLAIN) << get_description() << ": " << wakeups_per_value * 1000 << " reader wakeups per 1000 values";
+    }
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "MpscPollableQueue " << (use_batch_ ? "writer_put_batch" : "writer_put")
+                     << " (batch_size = " << batch_size_ << ")";
+  }
+
+  void start_up() final {
+    queue_.init();
+  }
+
+  void tear_down() final {
+    queue_.destroy();
+  }
+
+  void run(int n) final {
+    td::thread reader([&] {
+      int left_n = n;
+      while (left_n > 0) {
+        int ready_n = queue_.reader_wait_nonblock();
+        if (ready_n == 0) {
+          reader_wakeup_count_++;
+          queue_.reader_get_event_fd().wait(1000);
+          continue;
+        }
+        left_n -= ready_n;
+        while (ready_n-- > 0) {
+          queue_.reader_get_unsafe();
+        }
+      }
+    });
+
+    td::vector<qvalue_t> values;
+    for (int i = 0; i < n; i += batch_size_) {
+      auto count = td::min(batch_size_, n - i);
+      if (use_batch_) {
+        for (int j = 0; j < count; j++) {
+          values.push_back(i + j);
+        }
+        queue_.writer_put_batch(values);
+      } else {
+        for (int j = 0; j < count; j++) {
+          queue_.writer_put(i + j);
+        }
+      }
+    }
+    reader.join();
+    value_count_ += n;
+  }
+};
+
+// measures round-trip latency between two threads, which wait for each other on MpscPollableQueue,
+// and CPU time spent per round trip; with non-zero spin_count the reader busy-waits before sleeping on the event fd
+class MpscPollableQueuePingPongBenchmark final : public td::Benchmark {
+  td::MpscPollableQueue<qvalue_t> queues_[2];
+  int spin_count_;
+  std::clock_t cpu_time_ = 0;
+  td::int64 round_trip_count_ = 0;
+
+  static qvalue_t get(td::MpscPollableQueue<qvalue_t> &queue, int spin_count) {
+    while (true) {
+      if (queue.reader_wait_nonblock() > 0) {
+        return queue.reader_get_unsafe();
+      }
+      if (spin_count > 0 && queue.reader_spin_wait(spin_count)) {
+        continue;
+      }
+      queue.reader_get_event_fd().wait(1000);
+    }
+  }
+
+ public:
+  explicit MpscPollableQueuePingPongBenchmark(int spin_count) : spin_count_(spin_count) {
+  }
+  ~MpscPollableQueuePingPongBenchmark() final {
+    if (round_trip_count_ != 0) {
+      auto cpu_time_per_round_trip =
+          static_cast<double>(cpu_time_) / CLOCKS_PER_SEC / static_cast<double>(round_trip_count_);
+      LOG(PLAIN) << get_description() << ": " << cpu_time_per_round_trip * 1e9 << "ns of CPU time per round trip";
+    }
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "MpscPollableQueue ping-pong (spin_count = " << spin_count_ << ")";
+  }
+
+  void start_up() final {
+    for (auto &queue : queues_) {
+      queue.init();
+    }
+  }
+
+  void tear_down() final {
+    for (auto &queue : queues_) {
+      queue.destroy();
+    }
+  }
+
+  void run(int n) final {
+    auto begin_cpu_time = std::clock();
+    td::thread echo([&] {
+      for (int i = 0; i < n; i++) {
+        queues_[1].writer_put(get(queues_[0], spin_count_));
+      }
+    });
+    for (int i = 0; i < n; i++) {
+      queues_[0].writer_put(i);
+      CHECK(get(queues_[1], spin_count_) == i);
+    }
+    echo.join();
+    cpu_time_ += std::clock() - begin_cpu_time;
+    round_trip_count_ += n;
+  }
+};
+#endif
+
 /*
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
 static void test_queue() {
@@ -929,4 +1065,14 @@ int main() {
   BENCH_Q(BufferQueue, 100);
 #endif
 #endif
+
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  for (int batch_size : {1, 10, 100}) {
+    td::bench(MpscPollableQueueBatchBenchmark(batch_size, false));
+    td::bench(MpscPollableQueueBatchBenchmark(batch_size, true));
+  }
+  for (int spin_count : {0, 1 << 10, 1 << 14}) {
+    td::bench(MpscPollableQueuePingPongBenchmark(spin_count));
+  }
+#endif
 }
@@ -0,0 +1,169 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "mtproto_server.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/TsCerr.h"
+
+#include <cstdlib>
+#include <memory>
+
+static void usage() {
+  td::TsCerr() << "Sends queries through an MTProto session to an in-process server over an emulated network link "
+                  "and measures throughput and latency.\n";
+  td::TsCerr() << "Usage: bench_session [options]\n";
+  td::TsCerr() << "Options:\n";
+  td::TsCerr() << "  -v<N>\tSet verbosity level to N\n";
+  td::TsCerr() << "  -h/--help\tDisplay this information\n";
+  td::TsCerr() << "  -r/--rtt\tRound-trip time in milliseconds (default is 100)\n";
+  td::TsCerr() << "  -b/--bandwidth\tBandwidth in KB/s in each direction, 0 for unlimited (default is 1000)\n";
+  td::TsCerr() << "  -l/--loss\tSegment loss rate in percents (default is 0)\n";
+  td::TsCerr() << "  -f/--flood-wait\tPercent of queries answered with FLOOD_WAIT_1 (default is 0)\n";
+  td::TsCerr() << "  -t/--processing-time\tServer processing time of a query in milliseconds (default is 0)\n";
+  td::TsCerr() << "  -n/--queries\tNumber of queries (default is 1000)\n";
+  td::TsCerr() << "  -q/--query-size\tSize of a query in bytes (default is 100)\n";
+  td::TsCerr() << "  -a/--answer-size\tSize of an answer in bytes (default is 1000)\n";
+  td::TsCerr() << "  -w/--window\tMaximum number of simultaneously sent queries (default is 100)\n";
+  std::exit(2);
+}
+
+int main(int argc, char **argv) {
+  int new_verbosity_level = VERBOSITY_NAME(FATAL);
+  td::NetworkEmulationOptions options;
+  options.rtt = 0.1;
+  options.bandwidth = 1000 * 1000;
+  int flood_wait_percent = 0;
+  int processing_time = 0;
+  int query_count = 1000;
+  int query_size = 100;
+  int answer_size = 1000;
+  int window = 100;
+
+  for (int i = 1; i < argc; i++) {
+    td::string arg(argv[i]);
+
+    auto get_next_arg = [&i, &arg, argc, argv](bool is_optional = false) {
+      CHECK(arg.size() >= 2);
+      if (arg.size() == 2 || arg[1] == '-') {
+        if (i + 1 < argc && argv[i + 1][0] != '-') {
+          return td::string(argv[++i]);
+        }
+      } else {
+        if (arg.size() > 2) {
+          return arg.substr(2);
+        }
+      }
+      if (!is_optional) {
+        td::TsCerr() << "Error: value is required after " << arg << "\n";
+        usage();
+      }
+      return td::string();
+    };
+    auto get_next_int_arg = [&get_next_arg] {
+      auto r_value = td::to_integer_safe<int>(get_next_arg());
+      if (r_value.is_error() || r_value.ok() < 0) {
+        usage();
+      }
+      return r_value.ok();
+    };
+
+    if (td::begins_with(arg, "-v")) {
+      arg = get_next_arg(true);
+      int new_verbosity = 1;
+      while (arg[0] == 'v') {
+        new_verbosity++;
+        arg = arg.substr(1);
+      }
+      if (!arg.empty()) {
+        new_verbosity += td::to_integer<int>(arg) - (new_verbosity == 1);
+      }
+      new_verbosity_level = VERBOSITY_NAME(FATAL) + new_verbosity;
+    } else if (td::begins_with(arg, "-r") || arg == "--rtt") {
+      options.rtt = get_next_int_arg() * 1e-3;
+    } else if (td::begins_with(arg, "-b") || arg == "--bandwidth") {
+      options.bandwidth = get_next_int_arg() * 1000.0;
+    } else if (td::begins_with(arg, "-l") || arg == "--loss") {
+      options.loss_rate = td::min(get_next_int_arg(), 100) * 0.01;
+    } else if (td::begins_with(arg, "-f") || arg == "--flood-wait") {
+      flood_wait_percent = td::min(get_next_int_arg(), 100);
+    } else if (td::begins_with(arg, "-t") || arg == "--processing-time") {
+      processing_time = get_next_int_arg();
+    } else if (td::begins_with(arg, "-n") || arg == "--queries") {
+      query_count = get_next_int_arg();
+    } else if (td::begins_with(arg, "-q") || arg == "--query-size") {
+      query_size = td::max(get_next_int_arg(), 4);
+    } else if (td::begins_with(arg, "-a") || arg == "--answer-size") {
+      answer_size = td::max(get_next_int_arg(), 4);
+    } else if (td::begins_with(arg, "-w") || arg == "--window") {
+      window = td::max(get_next_int_arg(), 1);
+    } else {
+      usage();
+    }
+  }
+
+  SET_VERBOSITY_LEVEL(new_verbosity_level);
+
+  auto server = std::make_shared<td::MtprotoTestServer>();
+  td::string answer(static_cast<size_t>(answer_size) & ~static_cast<size_t>(3), 'a');
+  server->set_query_handler([&answer](td::Slice query) -> td::Result<td::BufferSlice> {
+    return td::BufferSlice(answer);
+  });
+  server->set_processing_time(processing_time * 1e-3);
+  server->set_flood_wait(flood_wait_percent * 0.01, 1);
+
+  td::vector<td::BufferSlice> queries;
+  for (int i = 0; i < query_count; i++) {
+    queries.emplace_back(td::string(static_cast<size_t>(query_size) & ~static_cast<size_t>(3), 'q'));
+  }
+
+  td::ConcurrentScheduler sched(0, 0);
+  td::Result<td::MtprotoTestClient::Stats> r_stats;
+  {
+    auto guard = sched.get_main_guard();
+    td::create_actor<td::MtprotoTestClient>(
+        "MtprotoTestClient", server, options, std::move(queries), static_cast<size_t>(window),
+        td::PromiseCreator::lambda([&r_stats](td::Result<td::MtprotoTestClient::Stats> result) {
+          r_stats = std::move(result);
+          td::Scheduler::instance()->finish();
+        }))
+        .release();
+  }
+  sched.start();
+  while (sched.run_main(10)) {
+  }
+  sched.finish();
+
+  if (r_stats.is_error()) {
+    LOG(PLAIN) << "Benchmark failed: " << r_stats.error();
+    return 1;
+  }
+  auto stats = r_stats.move_as_ok();
+  const auto &server_stats = server->get_stats();
+  LOG(PLAIN) << "Received " << stats.result_count << " answers and " << stats.error_count << " errors in "
+             << td::format::as_time(stats.total_time) << ": "
+             << static_cast<td::int64>(static_cast<double>(stats.result_count) / td::max(stats.total_time, 1e-9))
+             << " queries/s, " << td::format::as_size(static_cast<td::int64>(
+                                      static_cast<double>(stats.result_bytes) / td::max(stats.total_time, 1e-9)))
+             << "/s";
+  LOG(PLAIN) << "Latency: average " << td::format::as_time(stats.average_latency) << ", maximum "
+             << td::format::as_time(stats.max_latency);
+  LOG(PLAIN) << "Server received " << server_stats.packet_count << " packets with " << server_stats.query_count
+             << " queries and answered " << server_stats.flood_wait_count << " of them with FLOOD_WAIT; sent "
+             << td::format::as_size(server_stats.sent_bytes) << ", received "
+             << td::format::as_size(server_stats.received_bytes);
+  return 0;
+}
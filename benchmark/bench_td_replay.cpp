@@ -0,0 +1,745 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/ChannelId.h"
+#include "td/telegram/Client.h"
+#include "td/telegram/DialogId.h"
+#include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryDispatcher.h"
+#include "td/telegram/td_api.h"
+#include "td/telegram/telegram_api.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/Gzip.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/Clocks.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Status.h"
+#include "td/utils/Time.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/TsCerr.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <utility>
+
+static void usage() {
+  td::TsCerr() << "Runs a real TDLib client against an in-process server, which replays getDifference, "
+                  "getChannelDifference and getHistory responses, and measures end-to-end performance.\n";
+  td::TsCerr() << "Usage: bench_td_replay [options]\n";
+  td::TsCerr() << "Options:\n";
+  td::TsCerr() << "  -v<N>\tSet verbosity level to N\n";
+  td::TsCerr() << "  -h/--help\tDisplay this information\n";
+  td::TsCerr() << "  -p/--private-chats\tNumber of private chats (default is 100)\n";
+  td::TsCerr() << "  -c/--channels\tNumber of channels (default is 10)\n";
+  td::TsCerr() << "  -u/--updates\tNumber of new messages in private chats returned by getDifference "
+                  "(default is 100000)\n";
+  td::TsCerr() << "  -U/--channel-updates\tNumber of new messages in every channel (default is 1000)\n";
+  td::TsCerr() << "  -H/--history\tNumber of old messages in every chat available through getHistory "
+                  "(default is 1000)\n";
+  td::TsCerr() << "  -d/--database-directory\tDirectory for the TDLib database, which is deleted on exit "
+                  "(default is bench_td_replay_db)\n";
+  std::exit(2);
+}
+
+// serializes server responses in the same binary format in which they are received from the server
+class TlWriter {
+ public:
+  static constexpr td::int32 VECTOR_ID = 0x1cb5c415;
+
+  void store_int(td::int32 x) {
+    store_raw(&x, sizeof(x));
+  }
+
+  void store_long(td::int64 x) {
+    store_raw(&x, sizeof(x));
+  }
+
+  void store_string(td::Slice str) {
+    size_t len = str.size();
+    if (len < 254) {
+      data_ += static_cast<char>(len);
+      len++;
+    } else {
+      CHECK(len < (1 << 24));
+      data_ += static_cast<char>(254);
+      data_ += static_cast<char>(len & 255);
+      data_ += static_cast<char>((len >> 8) & 255);
+      data_ += static_cast<char>(len >> 16);
+      len += 4;
+    }
+    data_.append(str.data(), str.size());
+    while (len % 4 != 0) {
+      data_ += '\0';
+      len++;
+    }
+  }
+
+  void store_vector_begin(size_t size) {
+    store_int(VECTOR_ID);
+    store_int(td::narrow_cast<td::int32>(size));
+  }
+
+  td::BufferSlice as_buffer_slice() const {
+    return td::BufferSlice(data_);
+  }
+
+ private:
+  td::string data_;
+
+  void store_raw(const void *data, size_t size) {
+    data_.append(static_cast<const char *>(data), size);
+  }
+};
+
+// generates deterministic anonymized chat history and answers queries of a single user
+class ReplayServer {
+ public:
+  struct Options {
+    int private_chat_count = 100;
+    int channel_count = 10;
+    int update_count = 100000;
+    int channel_update_count = 1000;
+    int history_size = 1000;
+  };
+
+  explicit ReplayServer(const Options &options)
+      : options_(options), date_(static_cast<td::int32>(td::Clocks::system())) {
+    CHECK(options_.private_chat_count > 0);
+    private_chats_.resize(options_.private_chat_count);
+    td::int32 message_id = 0;
+    for (auto &chat : private_chats_) {
+      for (int i = 0; i < options_.history_size; i++) {
+        chat.message_ids.push_back(++message_id);
+      }
+    }
+    first_new_message_id_ = message_id + 1;
+    for (int i = 0; i < options_.update_count; i++) {
+      private_chats_[i % options_.private_chat_count].message_ids.push_back(++message_id);
+    }
+  }
+
+  td::int64 get_private_chat_id(int chat_index) const {
+    return get_user_id(chat_index);
+  }
+
+  td::int64 get_channel_chat_id(int channel_index) const {
+    return td::DialogId(td::ChannelId(get_channel_id(channel_index))).get();
+  }
+
+  int get_expected_new_message_count() const {
+    return options_.update_count + options_.channel_count * options_.channel_update_count;
+  }
+
+  bool on_query(td::NetQuery &net_query) {
+    auto query = net_query.gzip_flag() == td::NetQuery::GzipFlag::On ? td::gzdecode(net_query.query().as_slice())
+                                                                     : net_query.query().clone();
+    td::TlParser parser(query.as_slice());
+    auto constructor_id = parser.fetch_int();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    query_count_++;
+    td::Result<td::BufferSlice> r_answer;
+    switch (constructor_id) {
+      case td::telegram_api::auth_sendCode::ID:
+        r_answer = get_sent_code();
+        break;
+      case td::telegram_api::updates_getState::ID:
+        r_answer = get_state();
+        break;
+      case td::telegram_api::updates_getDifference::ID:
+        r_answer = get_difference(parser);
+        break;
+      case td::telegram_api::updates_getChannelDifference::ID:
+        r_answer = get_channel_difference(parser);
+        break;
+      case td::telegram_api::messages_getHistory::ID:
+        r_answer = get_history(parser);
+        break;
+      default:
+        unsupported_query_count_++;
+        r_answer = td::Status::Error(400, "QUERY_UNSUPPORTED");
+        break;
+    }
+    if (r_answer.is_error()) {
+      net_query.set_error(r_answer.move_as_error());
+    } else {
+      net_query.set_ok(r_answer.move_as_ok());
+    }
+    return true;
+  }
+
+  td::string get_statistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return PSTRING() << query_count_ << " queries, including " << difference_count_ << " getDifference, "
+                     << channel_difference_count_ << " getChannelDifference, " << history_count_
+                     << " getHistory and " << unsupported_query_count_ << " unsupported";
+  }
+
+ private:
+  static constexpr td::int64 SELF_USER_ID = 1000000;
+  static constexpr td::int64 FIRST_USER_ID = 1000001;
+  static constexpr td::int64 FIRST_CHANNEL_ID = 2000001;
+  static constexpr int DIFFERENCE_SLICE_SIZE = 1000;
+
+  struct PrivateChat {
+    td::vector<td::int32> message_ids;
+  };
+
+  Options options_;
+  td::int32 date_;
+  td::int32 first_new_message_id_ = 0;
+  td::vector<PrivateChat> private_chats_;
+
+  std::mutex mutex_;
+  td::uint64 query_count_ = 0;
+  td::uint64 difference_count_ = 0;
+  td::uint64 channel_difference_count_ = 0;
+  td::uint64 history_count_ = 0;
+  td::uint64 unsupported_query_count_ = 0;
+
+  static td::int64 get_user_id(int chat_index) {
+    return FIRST_USER_ID + chat_index;
+  }
+
+  static td::int64 get_channel_id(int channel_index) {
+    return FIRST_CHANNEL_ID + channel_index;
+  }
+
+  static td::int64 get_access_hash(td::int64 id) {
+    return id * 1000003;
+  }
+
+  static td::string get_message_text(td::int64 peer_id, td::int32 message_id) {
+    td::Random::Xorshift128plus rnd(static_cast<td::uint64>(peer_id) * 1000000007 + message_id);
+    td::string text = PSTRING() << "Message " << message_id;
+    auto word_count = rnd.fast(0, 30);
+    for (int i = 0; i < word_count; i++) {
+      text += ' ';
+      auto word_length = rnd.fast(1, 10);
+      for (int j = 0; j < word_length; j++) {
+        text += static_cast<char>('a' + rnd.fast(0, 25));
+      }
+    }
+    return text;
+  }
+
+  td::int32 get_message_date(td::int32 message_id, td::int32 last_message_id) const {
+    return date_ - (last_message_id - message_id) / 10;
+  }
+
+  static void store_user(TlWriter &writer, td::int64 user_id, bool is_self) {
+    writer.store_int(td::telegram_api::user::ID);
+    writer.store_int(1 /*access_hash*/ | 2 /*first_name*/ | (is_self ? 1024 : 0));
+    writer.store_int(0);
+    writer.store_long(user_id);
+    writer.store_long(get_access_hash(user_id));
+    writer.store_string(PSLICE() << "User " << user_id);
+  }
+
+  void store_channel(TlWriter &writer, td::int64 channel_id) const {
+    writer.store_int(td::telegram_api::channel::ID);
+    writer.store_int(32 /*broadcast*/ | 8192 /*access_hash*/);
+    writer.store_int(0);
+    writer.store_long(channel_id);
+    writer.store_long(get_access_hash(channel_id));
+    writer.store_string(PSLICE() << "Channel " << channel_id);
+    writer.store_int(td::telegram_api::chatPhotoEmpty::ID);
+    writer.store_int(date_ - 86400);
+  }
+
+  void store_private_message(TlWriter &writer, td::int64 user_id, td::int32 message_id) const {
+    writer.store_int(td::telegram_api::message::ID);
+    writer.store_int(0);
+    writer.store_int(message_id);
+    writer.store_int(td::telegram_api::peerUser::ID);
+    writer.store_long(user_id);
+    writer.store_int(get_message_date(message_id, first_new_message_id_ + options_.update_count));
+    writer.store_string(get_message_text(user_id, message_id));
+  }
+
+  void store_channel_message(TlWriter &writer, td::int64 channel_id, td::int32 message_id) const {
+    writer.store_int(td::telegram_api::message::ID);
+    writer.store_int(16384 /*post*/);
+    writer.store_int(message_id);
+    writer.store_int(td::telegram_api::peerChannel::ID);
+    writer.store_long(channel_id);
+    writer.store_int(get_message_date(message_id, get_channel_message_count()));
+    writer.store_string(get_message_text(channel_id, message_id));
+  }
+
+  void store_state(TlWriter &writer, td::int32 pts) const {
+    writer.store_int(td::telegram_api::updates_state::ID);
+    writer.store_int(pts);
+    writer.store_int(0);
+    writer.store_int(date_);
+    writer.store_int(0);
+    writer.store_int(0);
+  }
+
+  td::int32 get_channel_message_count() const {
+    return options_.history_size + options_.channel_update_count;
+  }
+
+  td::BufferSlice get_sent_code() const {
+    TlWriter writer;
+    writer.store_int(td::telegram_api::auth_sentCodeSuccess::ID);
+    writer.store_int(td::telegram_api::auth_authorization::ID);
+    writer.store_int(0);
+    store_user(writer, SELF_USER_ID, true);
+    return writer.as_buffer_slice();
+  }
+
+  td::BufferSlice get_state() const {
+    TlWriter writer;
+    store_state(writer, 1);
+    return writer.as_buffer_slice();
+  }
+
+  // the i-th new message in private chats has PTS i + 2, so getDifference from PTS 1 returns all of them
+  td::Result<td::BufferSlice> get_difference(td::TlParser &parser) {
+    difference_count_++;
+    auto flags = parser.fetch_int();
+    auto pts = parser.fetch_int();
+    if (flags & td::telegram_api::updates_getDifference::PTS_TOTAL_LIMIT_MASK) {
+      parser.fetch_int();
+    }
+    TRY_STATUS(parser.get_status());
+
+    TlWriter writer;
+    auto begin = td::max(pts - 1, 0);
+    if (begin >= options_.update_count) {
+      writer.store_int(td::telegram_api::updates_differenceEmpty::ID);
+      writer.store_int(date_);
+      writer.store_int(0);
+      return writer.as_buffer_slice();
+    }
+    auto end = td::min(begin + DIFFERENCE_SLICE_SIZE, options_.update_count);
+    bool is_slice = end < options_.update_count;
+
+    writer.store_int(is_slice ? td::telegram_api::updates_differenceSlice::ID
+                              : td::telegram_api::updates_difference::ID);
+    writer.store_vector_begin(end - begin);
+    for (int i = begin; i < end; i++) {
+      store_private_message(writer, get_user_id(i % options_.private_chat_count), first_new_message_id_ + i);
+    }
+    writer.store_vector_begin(0);
+
+    // channels are announced only in the first slice, so their messages are fetched through getChannelDifference
+    auto channel_count = begin == 0 ? options_.channel_count : 0;
+    writer.store_vector_begin(channel_count);
+    for (int i = 0; i < channel_count; i++) {
+      writer.store_int(td::telegram_api::updateChannelTooLong::ID);
+      writer.store_int(0);
+      writer.store_long(get_channel_id(i));
+    }
+    writer.store_vector_begin(channel_count);
+    for (int i = 0; i < channel_count; i++) {
+      store_channel(writer, get_channel_id(i));
+    }
+
+    auto user_count = td::min(end - begin, options_.private_chat_count);
+    writer.store_vector_begin(user_count);
+    for (int i = 0; i < user_count; i++) {
+      store_user(writer, get_user_id((begin + i) % options_.private_chat_count), false);
+    }
+    store_state(writer, end + 1);
+    return writer.as_buffer_slice();
+  }
+
+  // the i-th new message in a channel has PTS i + 2, so getChannelDifference from PTS 1 returns all of them
+  td::Result<td::BufferSlice> get_channel_difference(td::TlParser &parser) {
+    channel_difference_count_++;
+    parser.fetch_int();
+    if (parser.fetch_int() != td::telegram_api::inputChannel::ID) {
+      return td::Status::Error(400, "CHANNEL_INVALID");
+    }
+    auto channel_id = parser.fetch_long();
+    parser.fetch_long();
+    if (parser.fetch_int() != td::telegram_api::channelMessagesFilterEmpty::ID) {
+      return td::Status::Error(400, "FILTER_INVALID");
+    }
+    auto pts = parser.fetch_int();
+    auto limit = parser.fetch_int();
+    TRY_STATUS(parser.get_status());
+    if (channel_id < FIRST_CHANNEL_ID || channel_id >= get_channel_id(options_.channel_count)) {
+      return td::Status::Error(400, "CHANNEL_INVALID");
+    }
+
+    TlWriter writer;
+    auto begin = td::max(pts - 1, 0);
+    if (begin >= options_.channel_update_count) {
+      writer.store_int(td::telegram_api::updates_channelDifferenceEmpty::ID);
+      writer.store_int(1 /*final*/);
+      writer.store_int(options_.channel_update_count + 1);
+      return writer.as_buffer_slice();
+    }
+    auto end = td::min(begin + td::max(limit, 1), options_.channel_update_count);
+
+    writer.store_int(td::telegram_api::updates_channelDifference::ID);
+    writer.store_int(end == options_.channel_update_count ? 1 /*final*/ : 0);
+    writer.store_int(end + 1);
+    writer.store_vector_begin(end - begin);
+    for (int i = begin; i < end; i++) {
+      store_channel_message(writer, channel_id, options_.history_size + i + 1);
+    }
+    writer.store_vector_begin(0);
+    writer.store_vector_begin(1);
+    store_channel(writer, channel_id);
+    writer.store_vector_begin(0);
+    return writer.as_buffer_slice();
+  }
+
+  td::Result<td::BufferSlice> get_history(td::TlParser &parser) {
+    history_count_++;
+    auto peer_type = parser.fetch_int();
+    auto peer_id = parser.fetch_long();
+    parser.fetch_long();
+    auto offset_id = parser.fetch_int();
+    parser.fetch_int();
+    auto add_offset = parser.fetch_int();
+    auto limit = parser.fetch_int();
+    TRY_STATUS(parser.get_status());
+
+    td::vector<td::int32> channel_message_ids;
+    const td::vector<td::int32> *message_ids = nullptr;
+    bool is_channel = false;
+    if (peer_type == td::telegram_api::inputPeerUser::ID && peer_id >= FIRST_USER_ID &&
+        peer_id < get_user_id(options_.private_chat_count)) {
+      message_ids = &private_chats_[static_cast<size_t>(peer_id - FIRST_USER_ID)].message_ids;
+    } else if (peer_type == td::telegram_api::inputPeerChannel::ID && peer_id >= FIRST_CHANNEL_ID &&
+               peer_id < get_channel_id(options_.channel_count)) {
+      is_channel = true;
+      for (td::int32 message_id = 1; message_id <= get_channel_message_count(); message_id++) {
+        channel_message_ids.push_back(message_id);
+      }
+      message_ids = &channel_message_ids;
+    } else {
+      return td::Status::Error(400, "PEER_ID_INVALID");
+    }
+
+    auto size = static_cast<td::int32>(message_ids->size());
+    auto offset_pos = offset_id <= 0 ? size
+                                     : static_cast<td::int32>(std::lower_bound(message_ids->begin(),
+                                                                               message_ids->end(), offset_id) -
+                                                              message_ids->begin());
+    auto end = td::clamp(offset_pos - add_offset, 0, size);
+    auto begin = td::max(end - td::max(limit, 0), 0);
+
+    TlWriter writer;
+    if (is_channel) {
+      writer.store_int(td::telegram_api::messages_channelMessages::ID);
+      writer.store_int(0);
+      writer.store_int(options_.channel_update_count + 1);
+      writer.store_int(size);
+    } else {
+      writer.store_int(td::telegram_api::messages_messagesSlice::ID);
+      writer.store_int(0);
+      writer.store_int(size);
+    }
+    writer.store_vector_begin(end - begin);
+    for (auto i = end - 1; i >= begin; i--) {
+      if (is_channel) {
+        store_channel_message(writer, peer_id, (*message_ids)[i]);
+      } else {
+        store_private_message(writer, peer_id, (*message_ids)[i]);
+      }
+    }
+    if (is_channel) {
+      writer.store_vector_begin(0);
+      writer.store_vector_begin(1);
+      store_channel(writer, peer_id);
+      writer.store_vector_begin(0);
+    } else {
+      writer.store_vector_begin(0);
+      writer.store_vector_begin(1);
+      store_user(writer, peer_id, false);
+    }
+    return writer.as_buffer_slice();
+  }
+};
+
+class ReplayClient {
+ public:
+  ReplayClient(td::ClientManager &client_manager, td::string database_directory)
+      : client_manager_(client_manager)
+      , client_id_(client_manager.create_client_id())
+      , database_directory_(std::move(database_directory)) {
+  }
+
+  void start() {
+    send(td::td_api::make_object<td::td_api::setTdlibParameters>(
+        false, database_directory_, td::string(), td::string(), true, true, true, false, 94575,
+        "a3406de8d171bb422bb6ddf3bbd800e2", "en", "Desktop", "Unknown", "1.0", false, false));
+  }
+
+  void wait_authorization_state(td::int32 authorization_state_id) {
+    while (authorization_state_id_ != authorization_state_id) {
+      receive();
+    }
+  }
+
+  // returns time when the last new message was received
+  double wait_new_messages(int count) {
+    while (new_message_count_ < count) {
+      if (!receive(IDLE_TIMEOUT).object) {
+        LOG(ERROR) << "Receive only " << new_message_count_ << " new messages out of " << count;
+        break;
+      }
+    }
+    return last_new_message_time_;
+  }
+
+  td::td_api::object_ptr<td::td_api::Object> execute(td::td_api::object_ptr<td::td_api::Function> function) {
+    auto request_id = send(std::move(function));
+    while (true) {
+      auto response = receive();
+      if (response.request_id == request_id) {
+        return std::move(response.object);
+      }
+    }
+  }
+
+  int get_new_message_count() const {
+    return new_message_count_;
+  }
+
+ private:
+  static constexpr double RECEIVE_TIMEOUT = 60.0;
+  static constexpr double IDLE_TIMEOUT = 5.0;
+
+  td::ClientManager &client_manager_;
+  td::ClientManager::ClientId client_id_;
+  td::string database_directory_;
+  td::ClientManager::RequestId last_request_id_ = 0;
+  td::int32 authorization_state_id_ = 0;
+  int new_message_count_ = 0;
+  double last_new_message_time_ = 0.0;
+
+  td::ClientManager::RequestId send(td::td_api::object_ptr<td::td_api::Function> function) {
+    client_manager_.send(client_id_, ++last_request_id_, std::move(function));
+    return last_request_id_;
+  }
+
+  td::ClientManager::Response receive() {
+    auto response = receive(RECEIVE_TIMEOUT);
+    if (response.object == nullptr) {
+      LOG(FATAL) << "Receive nothing in " << td::format::as_time(RECEIVE_TIMEOUT) << " after " << new_message_count_
+                 << " new messages";
+    }
+    return response;
+  }
+
+  td::ClientManager::Response receive(double timeout) {
+    auto response = client_manager_.receive(timeout);
+    if (response.object == nullptr) {
+      return response;
+    }
+    CHECK(response.client_id == client_id_);
+    if (response.request_id == 0) {
+      switch (response.object->get_id()) {
+        case td::td_api::updateAuthorizationState::ID:
+          authorization_state_id_ = static_cast<const td::td_api::updateAuthorizationState &>(*response.object)
+                                        .authorization_state_->get_id();
+          break;
+        case td::td_api::updateNewMessage::ID:
+          new_message_count_++;
+          last_new_message_time_ = td::Time::now();
+          break;
+        default:
+          break;
+      }
+    } else if (response.object->get_id() == td::td_api::error::ID) {
+      LOG(ERROR) << "Receive " << to_string(response.object);
+    }
+    return response;
+  }
+};
+
+class LatencyStatistics {
+ public:
+  void add(double latency) {
+    latencies_.push_back(latency);
+  }
+
+  td::string to_string() {
+    if (latencies_.empty()) {
+      return "no requests";
+    }
+    std::sort(latencies_.begin(), latencies_.end());
+    double sum = 0.0;
+    for (auto latency : latencies_) {
+      sum += latency;
+    }
+    auto get_percentile = [&](size_t percent) {
+      return latencies_[td::min(latencies_.size() - 1, latencies_.size() * percent / 100)];
+    };
+    return PSTRING() << latencies_.size() << " requests, average " << td::format::as_time(sum / latencies_.size())
+                     << ", median " << td::format::as_time(get_percentile(50)) << ", 99th percentile "
+                     << td::format::as_time(get_percentile(99)) << ", max " << td::format::as_time(latencies_.back());
+  }
+
+ private:
+  td::vector<double> latencies_;
+};
+
+static void load_chat_history(ReplayClient &client, td::int64 chat_id, LatencyStatistics &statistics) {
+  td::int64 from_message_id = 0;
+  while (true) {
+    auto start_time = td::Time::now();
+    auto result =
+        client.execute(td::td_api::make_object<td::td_api::getChatHistory>(chat_id, from_message_id, 0, 100, false));
+    statistics.add(td::Time::now() - start_time);
+    if (result->get_id() != td::td_api::messages::ID) {
+      return;
+    }
+    auto &messages = static_cast<const td::td_api::messages &>(*result).messages_;
+    if (messages.empty() || messages.back() == nullptr) {
+      return;
+    }
+    from_message_id = messages.back()->id_;
+  }
+}
+
+int main(int argc, char **argv) {
+  int new_verbosity_level = VERBOSITY_NAME(FATAL);
+  ReplayServer::Options options;
+  td::string database_directory = "bench_td_replay_db";
+
+  for (int i = 1; i < argc; i++) {
+    td::string arg(argv[i]);
+
+    auto get_next_arg = [&i, &arg, argc, argv](bool is_optional = false) {
+      CHECK(arg.size() >= 2);
+      if (arg.size() == 2 || arg[1] == '-') {
+        if (i + 1 < argc && argv[i + 1][0] != '-') {
+          return td::string(argv[++i]);
+        }
+      } else {
+        if (arg.size() > 2) {
+          return arg.substr(2);
+        }
+      }
+      if (!is_optional) {
+        td::TsCerr() << "Error: value is required after " << arg << "\n";
+        usage();
+      }
+      return td::string();
+    };
+    auto get_next_int_arg = [&get_next_arg] {
+      auto r_value = td::to_integer_safe<int>(get_next_arg());
+      if (r_value.is_error() || r_value.ok() < 0) {
+        usage();
+      }
+      return r_value.ok();
+    };
+
+    if (td::begins_with(arg, "-v")) {
+      arg = get_next_arg(true);
+      int new_verbosity = 1;
+      while (arg[0] == 'v') {
+        new_verbosity++;
+        arg = arg.substr(1);
+      }
+      if (!arg.empty()) {
+        new_verbosity += td::to_integer<int>(arg) - (new_verbosity == 1);
+      }
+      new_verbosity_level = VERBOSITY_NAME(FATAL) + new_verbosity;
+    } else if (td::begins_with(arg, "-p") || arg == "--private-chats") {
+      options.private_chat_count = td::max(get_next_int_arg(), 1);
+    } else if (td::begins_with(arg, "-c") || arg == "--channels") {
+      options.channel_count = get_next_int_arg();
+    } else if (td::begins_with(arg, "-u") || arg == "--updates") {
+      options.update_count = get_next_int_arg();
+    } else if (td::begins_with(arg, "-U") || arg == "--channel-updates") {
+      options.channel_update_count = get_next_int_arg();
+    } else if (td::begins_with(arg, "-H") || arg == "--history") {
+      options.history_size = get_next_int_arg();
+    } else if (td::begins_with(arg, "-d") || arg == "--database-directory") {
+      database_directory = get_next_arg();
+    } else {
+      usage();
+    }
+  }
+
+  SET_VERBOSITY_LEVEL(new_verbosity_level);
+
+  td::rmrf(database_directory).ignore();
+
+  ReplayServer server(options);
+  td::NetQueryDispatcher::set_query_handler([&server](td::NetQuery &net_query) { return server.on_query(net_query); });
+
+  {
+    td::ClientManager client_manager;
+
+    auto start_time = td::Time::now();
+    ReplayClient client(client_manager, database_directory);
+    client.start();
+    client.wait_authorization_state(td::td_api::authorizationStateWaitPhoneNumber::ID);
+    LOG(PLAIN) << "Cold startup time: " << td::format::as_time(td::Time::now() - start_time);
+
+    start_time = td::Time::now();
+    client.execute(td::td_api::make_object<td::td_api::setAuthenticationPhoneNumber>("123456789", nullptr));
+    client.wait_authorization_state(td::td_api::authorizationStateReady::ID);
+    LOG(PLAIN) << "Authorization time: " << td::format::as_time(td::Time::now() - start_time);
+
+    start_time = td::Time::now();
+    client.execute(td::td_api::make_object<td::td_api::testGetDifference>());
+    auto replay_time = client.wait_new_messages(server.get_expected_new_message_count()) - start_time;
+    LOG(PLAIN) << "Replayed " << client.get_new_message_count() << " new messages in "
+               << td::format::as_time(replay_time) << ": " << static_cast<td::int64>(client.get_new_message_count() / td::max(replay_time, 1e-9))
+               << " updates/s";
+
+    LatencyStatistics private_statistics;
+    for (int i = 0; i < options.private_chat_count; i++) {
+      load_chat_history(client, server.get_private_chat_id(i), private_statistics);
+    }
+    LOG(PLAIN) << "getChatHistory in private chats: " << private_statistics.to_string();
+
+    LatencyStatistics channel_statistics;
+    for (int i = 0; i < options.channel_count; i++) {
+      load_chat_history(client, server.get_channel_chat_id(i), channel_statistics);
+    }
+    LOG(PLAIN) << "getChatHistory in channels: " << channel_statistics.to_string();
+
+    client.execute(td::td_api::make_object<td::td_api::close>());
+    client.wait_authorization_state(td::td_api::authorizationStateClosed::ID);
+  }
+
+  {
+    td::ClientManager client_manager;
+
+    auto start_time = td::Time::now();
+    ReplayClient client(client_manager, database_directory);
+    client.start();
+    client.wait_authorization_state(td::td_api::authorizationStateReady::ID);
+    LOG(PLAIN) << "Warm startup time: " << td::format::as_time(td::Time::now() - start_time);
+
+    LatencyStatistics statistics;
+    load_chat_history(client, server.get_private_chat_id(0), statistics);
+    LOG(PLAIN) << "getChatHistory after restart: " << statistics.to_string();
+
+    client.execute(td::td_api::make_object<td::td_api::close>());
+    client.wait_authorization_state(td::td_api::authorizationStateClosed::ID);
+  }
+
+  td::NetQueryDispatcher::set_query_handler(nullptr);
+  td::rmrf(database_directory).ignore();
+
+  LOG(PLAIN) << "Server statistics: " << server.get_statistics();
+  auto r_mem_stat = td::mem_stat();
+  if (r_mem_stat.is_ok()) {
+    LOG(PLAIN) << "Peak resident set size: " << td::format::as_size(r_mem_stat.ok().resident_size_peak_);
+  }
+}
@@ -11,6 +11,9 @@
 #include "td/telegram/ServerMessageId.h"
 #include "td/telegram/UserId.h"
 
+#include "td/db/binlog/Binlog.h"
+#include "td/db/binlog/ConcurrentBinlog.h"
+#include "td/db/BinlogKeyValue.h"
 #include "td/db/DbKey.h"
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
@@ -21,10 +24,16 @@
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/port/sleep.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/Storer.h"
 
+#include <atomic>
 #include <memory>
 
 static td::Status init_db(td::SqliteDb &db) {
@@ -107,7 +116,273 @@ class MessageDbBench final : public td::Benchmark {
   }
 };
 
+// replays search queries of 1-2 words, a half of them in a specific chat, over messages with Zipf-like word frequencies
+class MessageDbFtsBench final : public td::Benchmark {
+ public:
+  explicit MessageDbFtsBench(bool is_prefix_query) : is_prefix_query_(is_prefix_query) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "MessageDbFts" << (is_prefix_query_ ? "Prefix" : "Word");
+  }
+
+  void start_up() final {
+    do_start_up().ensure();
+  }
+
+  void run(int n) final {
+    auto guard = scheduler_->get_main_guard();
+    auto &message_db = message_db_sync_safe_->get();
+    size_t found_count = 0;
+    for (int i = 0; i < n; i++) {
+      td::MessageDbFtsQuery query;
+      query.query = get_query_word();
+      if (td::Random::fast_bool()) {
+        query.query += ' ';
+        query.query += get_query_word();
+      }
+      if (td::Random::fast_bool()) {
+        query.dialog_id = get_dialog_id();
+      }
+      query.limit = 50;
+      found_count += message_db.get_messages_fts(std::move(query)).messages.size();
+    }
+    LOG(INFO) << "Found " << found_count << " messages";
+  }
+
+  void tear_down() final {
+    {
+      auto guard = scheduler_->get_main_guard();
+      message_db_sync_safe_.reset();
+      sql_connection_->close_and_destroy();
+      sql_connection_.reset();
+    }
+    scheduler_.reset();
+  }
+
+ private:
+  static constexpr int MESSAGE_COUNT = 100000;
+  static constexpr int WORDS_PER_MESSAGE = 10;
+  static constexpr int WORD_COUNT = 10000;
+  static constexpr int DIALOG_COUNT = 100;
+
+  bool is_prefix_query_;
+  td::vector<td::string> words_;
+  td::unique_ptr<td::ConcurrentScheduler> scheduler_;
+  std::shared_ptr<td::SqliteConnectionSafe> sql_connection_;
+  std::shared_ptr<td::MessageDbSyncSafeInterface> message_db_sync_safe_;
+
+  const td::string &get_word() const {
+    // frequent words have small indices
+    auto x = td::Random::fast(0, 1000000) * 1e-6;
+    return words_[static_cast<size_t>(x * x * x * (WORD_COUNT - 1))];
+  }
+
+  td::string get_query_word() const {
+    auto word = get_word();
+    if (is_prefix_query_) {
+      word.resize(td::Random::fast(2, 3));
+    }
+    return word;
+  }
+
+  static td::DialogId get_dialog_id() {
+    return td::DialogId(td::UserId(static_cast<td::int64>(td::Random::fast(1, DIALOG_COUNT))));
+  }
+
+  td::Status do_start_up() {
+    scheduler_ = td::make_unique<td::ConcurrentScheduler>(0, 0);
+    auto guard = scheduler_->get_main_guard();
+
+    for (int i = 0; i < WORD_COUNT; i++) {
+      td::string word(td::Random::fast(4, 10), '\0');
+      for (auto &c : word) {
+        c = static_cast<char>(td::Random::fast('a', 'z'));
+      }
+      words_.push_back(std::move(word));
+    }
+
+    td::string sql_db_name = "bench_fts.sqlite";
+    td::SqliteDb::destroy(sql_db_name).ignore();
+    {
+      TRY_RESULT(db, td::SqliteDb::open_with_key(sql_db_name, true, td::DbKey::empty()));
+      TRY_STATUS(init_db(db));
+      TRY_STATUS(db.exec("BEGIN TRANSACTION"));
+      TRY_STATUS(init_message_db(db, 0));
+      TRY_STATUS(db.exec("COMMIT TRANSACTION"));
+    }
+    sql_connection_ = std::make_shared<td::SqliteConnectionSafe>(sql_db_name, td::DbKey::empty());
+    message_db_sync_safe_ = td::create_message_db_sync(sql_connection_);
+
+    auto &message_db = message_db_sync_safe_->get();
+    TRY_STATUS(message_db.begin_write_transaction());
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+      td::string text;
+      for (int j = 0; j < WORDS_PER_MESSAGE; j++) {
+        if (j != 0) {
+          text += ' ';
+        }
+        text += get_word();
+      }
+      auto message_id = td::MessageId(td::ServerMessageId(i + 1));
+      message_db.add_message({get_dialog_id(), message_id}, td::ServerMessageId(), td::DialogId(), 0, 0, 0, i + 1,
+                             std::move(text), td::NotificationId(), td::MessageId(), td::BufferSlice(100));
+    }
+    TRY_STATUS(message_db.commit_transaction());
+    return td::Status::OK();
+  }
+};
+
+// events are added by CHAIN_COUNT independent chains, each adding the next event after the previous one is synced
+class ConcurrentBinlogBench final : public td::Benchmark {
+ public:
+  ConcurrentBinlogBench(double max_delay, std::size_t max_size) : max_delay_(max_delay), max_size_(max_size) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "ConcurrentBinlog group commit " << td::tag("max_delay", max_delay_)
+                     << td::tag("max_size", max_size_);
+  }
+
+  void start_up() final {
+    scheduler_ = td::make_unique<td::ConcurrentScheduler>(1, 0);
+    td::Binlog::destroy(binlog_name_).ignore();
+    {
+      auto guard = scheduler_->get_main_guard();
+      binlog_ = std::make_shared<td::ConcurrentBinlog>();
+      binlog_->init(binlog_name_.str(), [](const td::BinlogEvent &) {}).ensure();
+      binlog_->set_group_commit(max_delay_, max_size_);
+    }
+    scheduler_->start();
+  }
+
+  void run(int n) final {
+    left_count_ = n;
+    {
+      auto guard = scheduler_->get_main_guard();
+      for (int i = 0; i < CHAIN_COUNT && i < n; i++) {
+        add_event();
+      }
+    }
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+    CHECK(left_count_ == 0);
+  }
+
+  void tear_down() final {
+    {
+      auto guard = scheduler_->get_main_guard();
+      binlog_->close_and_destroy();
+      binlog_.reset();
+    }
+    scheduler_->finish();
+    scheduler_.reset();
+  }
+
+ private:
+  static constexpr int CHAIN_COUNT = 100;
+
+  double max_delay_;
+  std::size_t max_size_;
+  td::CSlice binlog_name_ = "bench_binlog";
+  td::string event_data_ = td::string(100, 'a');
+  td::unique_ptr<td::ConcurrentScheduler> scheduler_;
+  std::shared_ptr<td::ConcurrentBinlog> binlog_;
+  int left_count_ = 0;
+  int pending_count_ = 0;
+
+  void add_event() {
+    pending_count_++;
+    binlog_->add(1, td::create_storer(td::Slice(event_data_)), td::PromiseCreator::lambda([this](td::Unit) {
+                   pending_count_--;
+                   left_count_--;
+                   if (left_count_ == 0) {
+                     td::Scheduler::instance()->finish();
+                   } else if (left_count_ > pending_count_) {
+                     add_event();
+                   }
+                 }));
+  }
+};
+
+#if !TD_THREAD_UNSUPPORTED
+// threads_n threads concurrently read values of KEY_COUNT keys or of a single hot key, like "auth" in binlog PMC,
+// while the main thread changes one of the values every WRITE_PERIOD microseconds
+class BinlogKeyValueGetBench final : public td::Benchmark {
+ public:
+  BinlogKeyValueGetBench(int threads_n, bool is_hot_key) : threads_n_(threads_n), is_hot_key_(is_hot_key) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "BinlogKeyValue get " << td::tag("threads_n", threads_n_) << td::tag("is_hot_key", is_hot_key_);
+  }
+
+  void start_up() final {
+    KeyValue::destroy(binlog_name_).ignore();
+    kv_.init(binlog_name_.str()).ensure();
+    for (int i = 0; i < KEY_COUNT; i++) {
+      kv_.set(PSTRING() << "key" << i, td::string(100, 'a'));
+    }
+  }
+
+  void run(int n) final {
+    std::atomic<int> left_threads_n{threads_n_};
+    td::vector<td::thread> threads;
+    for (int i = 0; i < threads_n_; i++) {
+      threads.emplace_back([&] {
+        td::vector<td::string> keys;
+        for (int j = 0; j < KEY_COUNT; j++) {
+          keys.push_back(is_hot_key_ ? td::string("key0") : PSTRING() << "key" << j);
+        }
+        std::size_t total_size = 0;
+        for (int j = 0; j < n / threads_n_; j++) {
+          total_size += kv_.get(keys[j % KEY_COUNT]).size();
+        }
+        CHECK(total_size != 0 || n < threads_n_);
+        left_threads_n--;
+      });
+    }
+    for (int i = 0; left_threads_n.load() != 0; i++) {
+      kv_.set(PSTRING() << "key" << i % KEY_COUNT, td::string(100, static_cast<char>('a' + i % 2)));
+      td::usleep_for(WRITE_PERIOD);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  void tear_down() final {
+    kv_.close();
+    KeyValue::destroy(binlog_name_).ignore();
+  }
+
+ private:
+  using KeyValue = td::BinlogKeyValue<td::Binlog>;
+  static constexpr int KEY_COUNT = 1000;
+  static constexpr td::int32 WRITE_PERIOD = 100;
+
+  int threads_n_;
+  bool is_hot_key_;
+  td::CSlice binlog_name_ = "bench_binlog";
+  KeyValue kv_;
+};
+#endif
+
 int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   td::bench(MessageDbBench());
+  td::bench(MessageDbFtsBench(false));
+  td::bench(MessageDbFtsBench(true));
+  td::bench(ConcurrentBinlogBench(0.0, 0));
+  td::bench(ConcurrentBinlogBench(0.001, 0));
+  td::bench(ConcurrentBinlogBench(0.01, 0));
+  td::bench(ConcurrentBinlogBench(0.01, 1 << 12));
+  td::bench(ConcurrentBinlogBench(0.1, 1 << 12));
+#if !TD_THREAD_UNSUPPORTED
+  for (int threads_n : {1, 4, 16}) {
+    td::bench(BinlogKeyValueGetBench(threads_n, false));
+    td::bench(BinlogKeyValueGetBench(threads_n, true));
+  }
+#endif
 }
@@ -5,6 +5,7 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/utils/FlatHashMap.h"
+#include "td/utils/FlatHashMapChunks.h"
 
 #ifdef SCOPE_EXIT
 #undef SCOPE_EXIT
@@ -17,6 +18,7 @@
 #include <unordered_map>
 
 #define test_map td::FlatHashMap
+//#define test_map td::FlatHashMapChunks
 //#define test_map folly::F14FastMap
 //#define test_map absl::flat_hash_map
 //#define test_map std::map
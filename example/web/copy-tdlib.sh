@@ -4,4 +4,7 @@ cd $(dirname $0)
 DEST=tdweb/src/prebuilt/release/
 mkdir -p $DEST || exit 1
 cp build/wasm/td_wasm.js build/wasm/td_wasm.wasm $DEST || exit 1
+if [ -f build/wasm/td_wasm.worker.js ] ; then
+  cp build/wasm/td_wasm.worker.js $DEST || exit 1
+fi
 cp build/asmjs/td_asmjs.js build/asmjs/td_asmjs.js.mem $DEST || exit 1
@@ -8,9 +8,14 @@
 
 #include "td/utils/port/platform.h"
 
+#include <cstdio>
+#include <string>
+#include <vector>
+
 #if (TD_DARWIN || TD_LINUX) && defined(USE_MEMPROF)
 #include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
@@ -18,7 +23,6 @@
 #include <functional>
 #include <new>
 #include <utility>
-#include <vector>
 
 #include <dlfcn.h>
 #include <execinfo.h>
@@ -121,6 +125,43 @@ static Backtrace get_backtrace() {
   return res;
 }
 
+#if USE_MEMPROF_SAMPLE
+static constexpr std::size_t SAMPLE_INTERVAL = 512 << 10;
+
+// intervals between sampled bytes have exponential distribution, so every allocated byte is sampled with equal
+// probability 1 / SAMPLE_INTERVAL regardless of allocation sizes and their order
+static bool need_backtrace(std::size_t size) {
+  static __thread std::int64_t bytes_until_sample;  // static zero-initialized
+  static __thread std::uint64_t random_state;       // static zero-initialized
+  bytes_until_sample -= static_cast<std::int64_t>(size);
+  if (bytes_until_sample >= 0) {
+    return false;
+  }
+
+  if (random_state == 0) {
+    random_state = reinterpret_cast<std::uintptr_t>(&random_state) | 1;
+  }
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  auto u = static_cast<double>((random_state >> 11) + 1) / static_cast<double>(static_cast<std::uint64_t>(1) << 53);
+  bytes_until_sample = static_cast<std::int64_t>(-std::log(u) * static_cast<double>(SAMPLE_INTERVAL));
+  return true;
+}
+
+std::size_t get_memprof_sample_interval() {
+  return SAMPLE_INTERVAL;
+}
+#else
+static bool need_backtrace(std::size_t size) {
+  return true;
+}
+
+std::size_t get_memprof_sample_interval() {
+  return 1;
+}
+#endif
+
 static constexpr std::size_t RESERVED_SIZE = 16;
 static constexpr std::int32_t MALLOC_INFO_MAGIC = 0x27138373;
 struct malloc_info {
@@ -141,6 +182,7 @@ struct HashtableNode {
   std::atomic<std::uint64_t> hash;
   Backtrace backtrace;
   std::atomic<std::size_t> size;
+  std::atomic<std::size_t> count;
 };
 
 static constexpr std::size_t HT_MAX_SIZE = 1000000;
@@ -196,23 +238,30 @@ void dump_alloc(const std::function<void(const AllocInfo &)> &func) {
     if (size == 0) {
       continue;
     }
-    func(AllocInfo{node.backtrace, size});
+    func(AllocInfo{node.backtrace, size, node.count.load(std::memory_order_relaxed)});
   }
 }
 
 void register_xalloc(malloc_info *info, std::int32_t diff) {
   my_assert(info->size >= 0);
+  if (info->ht_pos < 0) {
+    // the allocation wasn't sampled
+    return;
+  }
   if (diff > 0) {
     ht[info->ht_pos].size.fetch_add(info->size, std::memory_order_relaxed);
+    ht[info->ht_pos].count.fetch_add(1, std::memory_order_relaxed);
   } else {
     auto old_value = ht[info->ht_pos].size.fetch_sub(info->size, std::memory_order_relaxed);
     my_assert(old_value >= static_cast<std::size_t>(info->size));
+    ht[info->ht_pos].count.fetch_sub(1, std::memory_order_relaxed);
   }
 }
 
 extern "C" {
 
-static void *malloc_with_frame(std::size_t size, const Backtrace &frame) {
+// frame is nullptr for allocations, which aren't sampled
+static void *malloc_with_frame(std::size_t size, const Backtrace *frame) {
   static_assert(RESERVED_SIZE % alignof(std::max_align_t) == 0, "fail");
   static_assert(RESERVED_SIZE >= sizeof(malloc_info), "fail");
 #if TD_DARWIN
@@ -227,7 +276,7 @@ static void *malloc_with_frame(std::size_t size, const Backtrace &frame) {
 
   info->magic = MALLOC_INFO_MAGIC;
   info->size = static_cast<std::int32_t>(size);
-  info->ht_pos = get_ht_pos(frame);
+  info->ht_pos = frame == nullptr ? -1 : get_ht_pos(*frame);
 
   register_xalloc(info, +1);
 
@@ -246,7 +295,11 @@ static malloc_info *get_info(void *data_void) {
 }
 
 void *malloc(std::size_t size) {
-  return malloc_with_frame(size, get_backtrace());
+  if (!need_backtrace(size)) {
+    return malloc_with_frame(size, nullptr);
+  }
+  auto backtrace = get_backtrace();
+  return malloc_with_frame(size, &backtrace);
 }
 
 void free(void *data_void) {
@@ -268,17 +321,29 @@ void free(void *data_void) {
 
 void *calloc(std::size_t size_a, std::size_t size_b) {
   auto size = size_a * size_b;
-  void *res = malloc_with_frame(size, get_backtrace());
+  void *res;
+  if (!need_backtrace(size)) {
+    res = malloc_with_frame(size, nullptr);
+  } else {
+    auto backtrace = get_backtrace();
+    res = malloc_with_frame(size, &backtrace);
+  }
   std::memset(res, 0, size);
   return res;
 }
 
 void *realloc(void *ptr, std::size_t size) {
+  void *new_ptr;
+  if (!need_backtrace(size)) {
+    new_ptr = malloc_with_frame(size, nullptr);
+  } else {
+    auto backtrace = get_backtrace();
+    new_ptr = malloc_with_frame(size, &backtrace);
+  }
   if (ptr == nullptr) {
-    return malloc_with_frame(size, get_backtrace());
+    return new_ptr;
   }
   auto *info = get_info(ptr);
-  auto *new_ptr = malloc_with_frame(size, get_backtrace());
   auto to_copy = std::min(static_cast<std::int32_t>(size), info->size);
   std::memcpy(new_ptr, ptr, to_copy);
   free(ptr);
@@ -293,7 +358,11 @@ void *memalign(std::size_t aligment, std::size_t size) {
 
 // c++14 guarantees that it is enough to override these two operators.
 void *operator new(std::size_t count) {
-  return malloc_with_frame(count, get_backtrace());
+  if (!need_backtrace(count)) {
+    return malloc_with_frame(count, nullptr);
+  }
+  auto backtrace = get_backtrace();
+  return malloc_with_frame(count, &backtrace);
 }
 void operator delete(void *ptr) noexcept(true) {
   free(ptr);
@@ -311,6 +380,9 @@ void operator delete(void *ptr, std::size_t) noexcept(true) {
 bool is_memprof_on() {
   return false;
 }
+std::size_t get_memprof_sample_interval() {
+  return 0;
+}
 void dump_alloc(const std::function<void(const AllocInfo &)> &func) {
 }
 double get_fast_backtrace_success_rate() {
@@ -326,3 +398,52 @@ std::size_t get_used_memory_size() {
   dump_alloc([&](const auto info) { res += info.size; });
   return res;
 }
+
+std::string get_heap_profile() {
+  std::vector<AllocInfo> alloc_info;
+  dump_alloc([&](const AllocInfo &info) { alloc_info.push_back(info); });
+  std::size_t total_size = 0;
+  std::size_t total_count = 0;
+  for (auto &info : alloc_info) {
+    total_size += info.size;
+    total_count += info.count;
+  }
+
+  auto append_counts = [](std::string &result, std::size_t count, std::size_t size) {
+    result += std::to_string(count);
+    result += ": ";
+    result += std::to_string(size);
+    result += " [0: 0] @";
+  };
+
+  // legacy heap profile format of gperftools, which is supported by pprof
+  std::string result = "heap profile: ";
+  append_counts(result, total_count, total_size);
+  result += " heap_v2/";
+  result += std::to_string(get_memprof_sample_interval());
+  result += '\n';
+  for (auto &info : alloc_info) {
+    append_counts(result, info.count, info.size);
+    for (auto *ip : info.backtrace) {
+      if (ip == nullptr) {
+        break;
+      }
+      char buf[32];
+      std::snprintf(buf, sizeof(buf), " %p", ip);
+      result += buf;
+    }
+    result += '\n';
+  }
+
+  auto *maps = std::fopen("/proc/self/maps", "r");
+  if (maps != nullptr) {
+    result += "\nMAPPED_LIBRARIES:\n";
+    char buf[4096];
+    std::size_t read_size;
+    while ((read_size = std::fread(buf, 1, sizeof(buf), maps)) > 0) {
+      result.append(buf, read_size);
+    }
+    std::fclose(maps);
+  }
+  return result;
+}
@@ -9,6 +9,7 @@
 #include <array>
 #include <cstddef>
 #include <functional>
+#include <string>
 
 constexpr std::size_t BACKTRACE_SHIFT = 2;
 constexpr std::size_t BACKTRACE_HASHED_LENGTH = 6;
@@ -18,6 +19,7 @@ using Backtrace = std::array<void *, BACKTRACE_LENGTH>;
 struct AllocInfo {
   Backtrace backtrace;
   std::size_t size;
+  std::size_t count;
 };
 
 bool is_memprof_on();
@@ -25,3 +27,10 @@ std::size_t get_ht_size();
 double get_fast_backtrace_success_rate();
 void dump_alloc(const std::function<void(const AllocInfo &)> &func);
 std::size_t get_used_memory_size();
+
+// returns 1 if all allocations are tracked, average number of bytes between sampled allocations in sampling mode,
+// and 0 if memory profiling is disabled; in sampling mode AllocInfo contains only sampled allocations
+std::size_t get_memprof_sample_interval();
+
+// returns live allocations in pprof-compatible heap profile format
+std::string get_heap_profile();
@@ -29,8 +29,14 @@ static void generate_cpp(const std::string &directory, const std::string &tl_nam
 }
 
 int main() {
+#if TD_ENABLE_TL_ARENA
+  generate_cpp<>("auto/td/telegram", "telegram_api", "std::string", "BufferSlice",
+                 {"\"td/tl/tl_object_parse.h\"", "\"td/tl/tl_object_store.h\""},
+                 {"\"td/tl/TlArena.h\"", "\"td/utils/buffer.h\""});
+#else
   generate_cpp<>("auto/td/telegram", "telegram_api", "std::string", "BufferSlice",
                  {"\"td/tl/tl_object_parse.h\"", "\"td/tl/tl_object_store.h\""}, {"\"td/utils/buffer.h\""});
+#endif
 
   generate_cpp<>("auto/td/telegram", "secret_api", "std::string", "BufferSlice",
                  {"\"td/tl/tl_object_parse.h\"", "\"td/tl/tl_object_store.h\""}, {"\"td/utils/buffer.h\""});
@@ -43,6 +49,7 @@ int main() {
   generate_cpp<td::TD_TL_writer_jni_cpp, td::TD_TL_writer_jni_h>(
       "auto/td/telegram", "td_api", "std::string", "std::string", {"\"td/tl/tl_jni_object.h\""}, {"<string>"});
 #else
-  generate_cpp<>("auto/td/telegram", "td_api", "std::string", "std::string", {}, {"<string>"});
+  generate_cpp<>("auto/td/telegram", "td_api", "std::string", "std::string",
+                 {"\"td/tl/tl_object_parse.h\"", "\"td/tl/tl_object_store.h\""}, {"<string>"});
 #endif
 }
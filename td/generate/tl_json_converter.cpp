@@ -15,7 +15,9 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/StringBuilder.h"
 
+#include <map>
 #include <utility>
+#include <vector>
 
 namespace td {
 
@@ -101,10 +103,31 @@ void gen_from_json_constructor(StringBuilder &sb, const T *constructor, bool is_
     sb << ";\n\n";
   } else {
     sb << " {\n";
-    for (auto &arg : constructor->args) {
-      sb << "  TRY_STATUS(from_json" << (arg.type->type == tl::simple::Type::Bytes ? "_bytes" : "") << "(to."
-         << tl::simple::gen_cpp_field_name(arg.name) << ", get_json_object_field_force(from, \""
-         << tl::simple::gen_cpp_name(arg.name) << "\")));\n";
+    if (!constructor->args.empty()) {
+      // dispatch the keys by their length, so each key is compared only with the field names of the same length;
+      // the fields are processed in the reverse order, so the first of duplicate fields has the priority
+      std::map<size_t, std::vector<const tl::simple::Arg *>> args_by_length;
+      for (auto &arg : constructor->args) {
+        args_by_length[arg.name.size()].push_back(&arg);
+      }
+      sb << "  for (auto it = from.rbegin(); it != from.rend(); ++it) {\n";
+      sb << "    Slice key = it->first;\n";
+      sb << "    switch (key.size()) {\n";
+      for (auto &length_args : args_by_length) {
+        sb << "      case " << length_args.first << ":\n";
+        for (auto *arg : length_args.second) {
+          sb << "        if (key == \"" << arg->name << "\") {\n";
+          sb << "          TRY_STATUS(from_json" << (arg->type->type == tl::simple::Type::Bytes ? "_bytes" : "") << "(to."
+             << tl::simple::gen_cpp_field_name(arg->name) << ", std::move(it->second)));\n";
+          sb << "          break;\n";
+          sb << "        }\n";
+        }
+        sb << "        break;\n";
+      }
+      sb << "      default:\n";
+      sb << "        break;\n";
+      sb << "    }\n";
+      sb << "  }\n";
     }
     sb << "  return Status::OK();\n";
     sb << "}\n\n";
@@ -130,7 +153,7 @@ void gen_from_json(StringBuilder &sb, const tl::simple::Schema &schema, bool is_
 
 using Vec = std::vector<std::pair<int32, std::string>>;
 void gen_tl_constructor_from_string(StringBuilder &sb, Slice name, const Vec &vec, bool is_header) {
-  sb << "Result<int32> tl_constructor_from_string(td_api::" << name << " *object, const std::string &str)";
+  sb << "Result<int32> tl_constructor_from_string(td_api::" << name << " *object, Slice str)";
   if (is_header) {
     sb << ";\n\n";
     return;
@@ -205,6 +228,7 @@ void gen_json_converter_file(const tl::simple::Schema &schema, const std::string
     sb << "#include \"td/telegram/td_api.h\"\n\n";
 
     sb << "#include \"td/utils/JsonBuilder.h\"\n";
+    sb << "#include \"td/utils/Slice.h\"\n";
     sb << "#include \"td/utils/Status.h\"\n\n";
   } else {
     sb << "#include \"" << file_name_base << ".h\"\n\n";
@@ -134,6 +134,12 @@ std::string TD_TL_writer_cpp::gen_constructor_id_store(std::int32_t id, int stor
   return "  " + gen_constructor_id_store_raw(int_to_string(id)) + "\n";
 }
 
+// objects with a single constructor are stored in td_api boxed, because all object fields in td_api can be null
+bool TD_TL_writer_cpp::is_nullable_object_type(const tl::tl_type *t) const {
+  return tl_name == "td_api" && t->constructors_num == 1 && !is_built_in_simple_type(t->name) &&
+         !is_built_in_complex_type(t->name) && t->name != "#";
+}
+
 std::string TD_TL_writer_cpp::gen_fetch_class_name(const tl::tl_tree_type *tree_type) const {
   const tl::tl_type *t = tree_type->type;
   const std::string &name = t->name;
@@ -180,7 +186,7 @@ std::string TD_TL_writer_cpp::gen_full_fetch_class_name(const tl::tl_tree_type *
   assert(!(t->flags & tl::FLAG_DEFAULT_CONSTRUCTOR));  // Not supported yet
 
   std::int32_t expected_constructor_id = 0;
-  if (tree_type->flags & tl::FLAG_BARE) {
+  if ((tree_type->flags & tl::FLAG_BARE) && !is_nullable_object_type(t)) {
     assert(is_type_bare(t));
   } else {
     if (is_type_bare(t)) {
@@ -196,6 +202,10 @@ std::string TD_TL_writer_cpp::gen_full_fetch_class_name(const tl::tl_tree_type *
   if (expected_constructor_id == 0) {
     return gen_fetch_class_name(tree_type);
   }
+  if (is_nullable_object_type(t)) {
+    return "TlFetchNullableBoxed<" + gen_fetch_class_name(tree_type) + ", " + int_to_string(expected_constructor_id) +
+           ">";
+  }
   return "TlFetchBoxed<" + gen_fetch_class_name(tree_type) + ", " + int_to_string(expected_constructor_id) + ">";
 }
 
@@ -278,6 +288,43 @@ std::string TD_TL_writer_cpp::gen_field_fetch(int field_num, const tl::arg &a, s
   return res;
 }
 
+int TD_TL_writer_cpp::get_fixed_field_length(const tl::arg &a) const {
+  if (a.exist_var_num != -1 || a.var_num != -1 || (a.flags & tl::FLAG_EXCL) ||
+      a.type->get_type() != tl::NODE_TYPE_TYPE) {
+    return 0;
+  }
+  auto fetch_class_name = gen_full_fetch_class_name(static_cast<const tl::tl_tree_type *>(a.type));
+  if (fetch_class_name == "TlFetchInt") {
+    return 4;
+  }
+  if (fetch_class_name == "TlFetchLong" || fetch_class_name == "TlFetchDouble") {
+    return 8;
+  }
+  if (fetch_class_name == "TlFetchInt128") {
+    return 16;
+  }
+  if (fetch_class_name == "TlFetchInt256") {
+    return 32;
+  }
+  return 0;
+}
+
+int TD_TL_writer_cpp::get_max_fixed_fields_length() const {
+  // after a failed length check TlParser reads unchecked data from its zero buffer of this size
+  return 32;
+}
+
+std::string TD_TL_writer_cpp::gen_fixed_field_fetch(int field_num, const tl::arg &a, int parser_type,
+                                                    int checked_length) const {
+  assert(parser_type >= 0);
+  std::string field_name = (parser_type == 0 ? (field_num == 0 ? ": " : ", ") : "res->") + gen_field_name(a.name);
+  std::string fetch = gen_full_fetch_class_name(static_cast<const tl::tl_tree_type *>(a.type)) + "::parse_unsafe(p)";
+  if (checked_length > 0) {
+    fetch = "(p.check_len(" + int_to_string(checked_length) + "), " + fetch + ")";
+  }
+  return "  " + field_name + (parser_type == 0 ? "(" + fetch + ")" : " = " + fetch + ";") + "\n";
+}
+
 std::string TD_TL_writer_cpp::gen_var_type_fetch(const tl::arg &a) const {
   assert(false);
   return "";
@@ -361,7 +408,8 @@ std::string TD_TL_writer_cpp::gen_full_store_class_name(const tl::tl_tree_type *
 
   assert(!(t->flags & tl::FLAG_DEFAULT_CONSTRUCTOR));  // Not supported yet
 
-  if ((tree_type->flags & tl::FLAG_BARE) != 0 || t->name == "#" || t->name == "Bool") {
+  if (((tree_type->flags & tl::FLAG_BARE) != 0 && !is_nullable_object_type(t)) || t->name == "#" ||
+      t->name == "Bool") {
     return gen_store_class_name(tree_type);
   }
 
@@ -655,7 +703,12 @@ std::string TD_TL_writer_cpp::gen_fetch_switch_case(const tl::tl_combinator *t,
 }
 
 std::string TD_TL_writer_cpp::gen_fetch_switch_end() const {
-  return "    default:\n"
+  std::string null_case;
+  if (tl_name == "td_api") {
+    null_case = "    case " + int_to_string(0x56730bcc) + ":  // null\n      return nullptr;\n";
+  }
+  return null_case +
+         "    default:\n"
          "      FAIL(PSTRING() << \"Unknown constructor found \" << format::as_hex(constructor));\n"
          "  }\n";
 }
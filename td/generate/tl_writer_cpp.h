@@ -17,6 +17,8 @@ namespace td {
 class TD_TL_writer_cpp : public TD_TL_writer {
   std::string gen_constructor_id_store_raw(const std::string &id) const;
 
+  bool is_nullable_object_type(const tl::tl_type *t) const;
+
   std::string gen_fetch_class_name(const tl::tl_tree_type *tree_type) const;
 
   std::string gen_full_fetch_class_name(const tl::tl_tree_type *tree_type) const;
@@ -64,6 +66,10 @@ class TD_TL_writer_cpp : public TD_TL_writer {
 
   std::string gen_field_fetch(int field_num, const tl::arg &a, std::vector<tl::var_description> &vars, bool flat,
                               int parser_type) const override;
+  int get_fixed_field_length(const tl::arg &a) const override;
+  int get_max_fixed_fields_length() const override;
+  std::string gen_fixed_field_fetch(int field_num, const tl::arg &a, int parser_type,
+                                    int checked_length) const override;
   std::string gen_field_store(const tl::arg &a, std::vector<tl::var_description> &vars, bool flat,
                               int storer_type) const override;
   std::string gen_type_fetch(const std::string &field_name, const tl::tl_tree_type *tree_type,
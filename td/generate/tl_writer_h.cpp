@@ -256,9 +256,23 @@ std::string TD_TL_writer_h::gen_forward_class_declaration(const std::string &cla
 
 std::string TD_TL_writer_h::gen_class_begin(const std::string &class_name, const std::string &base_class_name,
                                             bool is_proxy, const tl::tl_tree *result) const {
+  std::string allocation_functions;
+#if TD_ENABLE_TL_ARENA
+  if (tl_name == "telegram_api" && is_proxy && class_name == gen_base_type_class_name(0)) {
+    allocation_functions =
+        "  static void *operator new(std::size_t size) {\n"
+        "    return ::td::TlArena::allocate(size);\n"
+        "  }\n"
+        "\n"
+        "  static void operator delete(void *ptr) noexcept {\n"
+        "    ::td::TlArena::deallocate(ptr);\n"
+        "  }\n";
+  }
+#endif
   return "class " + class_name + (!is_proxy ? " final " : "") + ": public " + base_class_name +
          " {\n"
-         " public:\n";
+         " public:\n" +
+         allocation_functions;
 }
 
 std::string TD_TL_writer_h::gen_class_end() const {
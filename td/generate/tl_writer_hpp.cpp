@@ -7,6 +7,7 @@
 #include "tl_writer_hpp.h"
 
 #include <cassert>
+#include <string>
 
 namespace td {
 
@@ -18,14 +19,24 @@ bool TD_TL_writer_hpp::is_documentation_generated() const {
 #endif
 }
 
+bool TD_TL_writer_hpp::is_function_table_generated() const {
+  return tl_name == "td_api";
+}
+
 int TD_TL_writer_hpp::get_additional_function_type(const std::string &additional_function_name) const {
-  assert(additional_function_name == "downcast_call");
+  assert(additional_function_name == "downcast_call" || additional_function_name == "get_function_index" ||
+         additional_function_name == "get_function_name" || additional_function_name == "downcast_call_by_index");
   return 2;
 }
 
 std::vector<std::string> TD_TL_writer_hpp::get_additional_functions() const {
   std::vector<std::string> additional_functions;
   additional_functions.push_back("downcast_call");
+  if (is_function_table_generated()) {
+    additional_functions.push_back("get_function_index");
+    additional_functions.push_back("get_function_name");
+    additional_functions.push_back("downcast_call_by_index");
+  }
   return additional_functions;
 }
 
@@ -193,7 +204,6 @@ std::string TD_TL_writer_hpp::gen_fetch_switch_end() const {
 
 std::string TD_TL_writer_hpp::gen_additional_function(const std::string &function_name, const tl::tl_combinator *t,
                                                       bool is_function) const {
-  assert(function_name == "downcast_call");
   return "";
 }
 
@@ -201,6 +211,67 @@ std::string TD_TL_writer_hpp::gen_additional_proxy_function_begin(const std::str
                                                                   const tl::tl_type *type,
                                                                   const std::string &class_name, int arity,
                                                                   bool is_function) const {
+  if (function_name == "get_function_index") {
+    if (!is_function) {
+      return "";
+    }
+    function_count_ = 0;
+    return
+#ifndef DISABLE_HPP_DOCUMENTATION
+        "/**\n"
+        " * Returns a dense index of the function with the given identifier.\n"
+        " * \\param[in] id Identifier of the function.\n"
+        " * \\returns Index of the function in range [0, FUNCTION_COUNT) or -1 if the identifier is unknown.\n"
+        " */\n"
+#endif
+        "inline std::int32_t get_function_index(std::int32_t id) {\n"
+        "  switch (id) {\n";
+  }
+  if (function_name == "get_function_name") {
+    if (!is_function) {
+      return "";
+    }
+    return
+#ifndef DISABLE_HPP_DOCUMENTATION
+        "/**\n"
+        " * Returns name of the function with the given index.\n"
+        " * \\param[in] index Index of the function, returned by get_function_index.\n"
+        " * \\returns Name of the function.\n"
+        " */\n"
+#endif
+        "inline const char *get_function_name(std::int32_t index) {\n"
+        "  static const char *const names[] = {\n";
+  }
+  if (function_name == "downcast_call_by_index") {
+    if (!is_function) {
+      return "";
+    }
+    return "template <class ObjectT, class T>\n"
+           "void call_downcasted(" +
+           class_name +
+           " &obj, const T &func) {\n"
+           "  func(static_cast<ObjectT &>(obj));\n"
+           "}\n"
+           "\n"
+#ifndef DISABLE_HPP_DOCUMENTATION
+           "/**\n"
+           " * Calls the specified function object with the given function downcasted to its most derived type.\n"
+           " * Uses a table of calls indexed by the dense function index instead of a switch over identifiers.\n"
+           " * \\param[in] index Index of the function, returned by get_function_index(obj.get_id()).\n"
+           " * \\param[in] obj Function to pass as an argument to the function object.\n"
+           " * \\param[in] func Function object to which the function will be passed.\n"
+           " */\n"
+#endif
+           "template <class T>\n"
+           "void downcast_call_by_index(std::int32_t index, " +
+           class_name +
+           " &obj, const T &func) {\n"
+           "  using Call = void (*)(" +
+           class_name +
+           " &, const T &);\n"
+           "  static const Call calls[] = {\n";
+  }
+
   assert(function_name == "downcast_call");
   return
 #ifndef DISABLE_HPP_DOCUMENTATION
@@ -229,6 +300,25 @@ std::string TD_TL_writer_hpp::gen_additional_proxy_function_case(const std::stri
 std::string TD_TL_writer_hpp::gen_additional_proxy_function_case(const std::string &function_name,
                                                                  const tl::tl_type *type, const tl::tl_combinator *t,
                                                                  int arity, bool is_function) const {
+  if (function_name == "get_function_index") {
+    if (!is_function) {
+      return "";
+    }
+    return "    case " + gen_class_name(t->name) + "::ID:\n      return " + std::to_string(function_count_++) + ";\n";
+  }
+  if (function_name == "get_function_name") {
+    if (!is_function) {
+      return "";
+    }
+    return "    \"" + gen_class_name(t->name) + "\",\n";
+  }
+  if (function_name == "downcast_call_by_index") {
+    if (!is_function) {
+      return "";
+    }
+    return "    &call_downcasted<" + gen_class_name(t->name) + ", T>,\n";
+  }
+
   assert(function_name == "downcast_call");
   return "    case " + gen_class_name(t->name) +
          "::ID:\n"
@@ -240,6 +330,40 @@ std::string TD_TL_writer_hpp::gen_additional_proxy_function_case(const std::stri
 
 std::string TD_TL_writer_hpp::gen_additional_proxy_function_end(const std::string &function_name,
                                                                 const tl::tl_type *type, bool is_function) const {
+  if (function_name == "get_function_index") {
+    if (!is_function) {
+      return "";
+    }
+    return "    default:\n"
+           "      return -1;\n"
+           "  }\n"
+           "}\n"
+           "\n"
+#ifndef DISABLE_HPP_DOCUMENTATION
+           "/**\n"
+           " * Number of functions, i.e. the upper bound of function indices returned by get_function_index.\n"
+           " */\n"
+#endif
+           "constexpr std::int32_t FUNCTION_COUNT = " +
+           std::to_string(function_count_) + ";\n\n";
+  }
+  if (function_name == "get_function_name") {
+    if (!is_function) {
+      return "";
+    }
+    return "  };\n"
+           "  return names[index];\n"
+           "}\n\n";
+  }
+  if (function_name == "downcast_call_by_index") {
+    if (!is_function) {
+      return "";
+    }
+    return "  };\n"
+           "  calls[index](obj, func);\n"
+           "}\n\n";
+  }
+
   assert(function_name == "downcast_call");
   return "    default:\n"
          "      return false;\n"
@@ -15,6 +15,10 @@
 namespace td {
 
 class TD_TL_writer_hpp final : public TD_TL_writer {
+  mutable int function_count_ = 0;
+
+  bool is_function_table_generated() const;
+
  public:
   TD_TL_writer_hpp(const std::string &tl_name, const std::string &string_type, const std::string &bytes_type)
       : TD_TL_writer(tl_name, string_type, bytes_type) {
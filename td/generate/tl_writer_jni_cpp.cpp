@@ -334,6 +334,10 @@ std::string TD_TL_writer_jni_cpp::gen_type_store(const std::string &field_name,
   return res;
 }
 
+int TD_TL_writer_jni_cpp::get_max_fixed_fields_length() const {
+  return 0;
+}
+
 std::string TD_TL_writer_jni_cpp::gen_field_store(const tl::arg &a, std::vector<tl::var_description> &vars, bool flat,
                                                   int storer_type) const {
   std::string field_name = gen_field_name(a.name);
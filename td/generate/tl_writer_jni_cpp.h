@@ -64,6 +64,7 @@ class TD_TL_writer_jni_cpp final : public TD_TL_writer_cpp {
 
   std::string gen_field_fetch(int field_num, const tl::arg &a, std::vector<tl::var_description> &vars, bool flat,
                               int parser_type) const final;
+  int get_max_fixed_fields_length() const final;
   std::string gen_field_store(const tl::arg &a, std::vector<tl::var_description> &vars, bool flat,
                               int storer_type) const final;
   std::string gen_type_fetch(const std::string &field_name, const tl::tl_tree_type *tree_type,
@@ -100,7 +100,7 @@ std::vector<std::string> TD_TL_writer::get_parsers() const {
   std::vector<std::string> parsers;
   if (tl_name == "telegram_api") {
     parsers.push_back("TlBufferParser");
-  } else if (tl_name == "mtproto_api" || tl_name == "secret_api") {
+  } else if (tl_name == "mtproto_api" || tl_name == "secret_api" || tl_name == "td_api") {
     parsers.push_back("TlParser");
   }
   return parsers;
@@ -108,9 +108,10 @@ std::vector<std::string> TD_TL_writer::get_parsers() const {
 
 std::vector<std::string> TD_TL_writer::get_storers() const {
   std::vector<std::string> storers;
-  if (tl_name == "telegram_api" || tl_name == "mtproto_api" || tl_name == "secret_api") {
+  if (tl_name == "telegram_api" || tl_name == "mtproto_api" || tl_name == "secret_api" || tl_name == "td_api") {
     storers.push_back("TlStorerCalcLength");
     storers.push_back("TlStorerUnsafe");
+    storers.push_back("TlStorerBounded");
   }
   storers.push_back("TlStorerToString");
   return storers;
@@ -0,0 +1,179 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/mtproto/CryptoWorkerPool.h"
+
+#include "td/utils/port/thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+
+namespace td {
+namespace mtproto {
+
+#if !TD_THREAD_UNSUPPORTED
+namespace {
+
+class CryptoWorkerPoolImpl {
+ public:
+  CryptoWorkerPoolImpl() = default;
+  CryptoWorkerPoolImpl(const CryptoWorkerPoolImpl &) = delete;
+  CryptoWorkerPoolImpl &operator=(const CryptoWorkerPoolImpl &) = delete;
+  CryptoWorkerPoolImpl(CryptoWorkerPoolImpl &&) = delete;
+  CryptoWorkerPoolImpl &operator=(CryptoWorkerPoolImpl &&) = delete;
+  ~CryptoWorkerPoolImpl() {
+    stop_workers();
+  }
+
+  static CryptoWorkerPoolImpl &get() {
+    static CryptoWorkerPoolImpl pool;
+    return pool;
+  }
+
+  void set_worker_count(int32 worker_count) {
+    std::lock_guard<std::mutex> guard(workers_mutex_);
+    if (worker_count == static_cast<int32>(workers_.size())) {
+      return;
+    }
+    stop_workers();
+    worker_count_ = worker_count;
+    for (int32 i = 0; i < worker_count; i++) {
+      workers_.emplace_back([this] { worker_loop(); });
+      workers_.back().set_name("CryptoWorker");
+    }
+  }
+
+  bool is_enabled() const {
+    return worker_count_.load(std::memory_order_relaxed) > 0;
+  }
+
+  void run(size_t task_count, const std::function<void(size_t)> &task) {
+    auto batch = std::make_shared<Batch>(task_count, task);
+    if (task_count > 1 && is_enabled()) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      batches_.push(batch);
+      cond_.notify_all();
+    }
+
+    while (batch->run_next_task()) {
+    }
+
+    std::unique_lock<std::mutex> lock(batch->mutex_);
+    batch->cond_.wait(lock, [&] { return batch->finished_task_count_ == task_count; });
+  }
+
+ private:
+  class Batch {
+   public:
+    Batch(size_t task_count, const std::function<void(size_t)> &task) : task_count_(task_count), task_(task) {
+    }
+
+    // returns false if there are no more tasks to run
+    bool run_next_task() {
+      auto task_id = next_task_id_.fetch_add(1, std::memory_order_relaxed);
+      if (task_id >= task_count_) {
+        return false;
+      }
+      task_(task_id);
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (++finished_task_count_ == task_count_) {
+        cond_.notify_all();
+      }
+      return true;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    size_t finished_task_count_ = 0;
+
+   private:
+    size_t task_count_;
+    // the reference is used only until all tasks are started, i.e. while the caller waits for their completion
+    const std::function<void(size_t)> &task_;
+    std::atomic<size_t> next_task_id_{0};
+  };
+
+  std::mutex workers_mutex_;
+  vector<td::thread> workers_;
+  std::atomic<int32> worker_count_{0};
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::queue<std::shared_ptr<Batch>> batches_;
+  bool close_flag_ = false;
+
+  void stop_workers() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      close_flag_ = true;
+    }
+    cond_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+    worker_count_ = 0;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    close_flag_ = false;
+  }
+
+  void worker_loop() {
+    while (true) {
+      std::shared_ptr<Batch> batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [&] { return close_flag_ || !batches_.empty(); });
+        if (close_flag_) {
+          return;
+        }
+        batch = batches_.front();
+      }
+
+      if (!batch->run_next_task()) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!batches_.empty() && batches_.front() == batch) {
+          batches_.pop();
+        }
+      }
+    }
+  }
+};
+
+}  // namespace
+
+void CryptoWorkerPool::set_worker_count(int32 worker_count) {
+  CryptoWorkerPoolImpl::get().set_worker_count(max(worker_count, 0));
+}
+
+bool CryptoWorkerPool::is_enabled() {
+  return CryptoWorkerPoolImpl::get().is_enabled();
+}
+
+void CryptoWorkerPool::run(size_t task_count, const std::function<void(size_t)> &task) {
+  CryptoWorkerPoolImpl::get().run(task_count, task);
+}
+#else
+void CryptoWorkerPool::set_worker_count(int32 worker_count) {
+}
+
+bool CryptoWorkerPool::is_enabled() {
+  return false;
+}
+
+void CryptoWorkerPool::run(size_t task_count, const std::function<void(size_t)> &task) {
+  for (size_t i = 0; i < task_count; i++) {
+    task(i);
+  }
+}
+#endif
+
+}  // namespace mtproto
+}  // namespace td
@@ -0,0 +1,30 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <functional>
+
+namespace td {
+namespace mtproto {
+
+// process-wide pool of threads, which help network threads to decrypt big batches of received packets
+class CryptoWorkerPool {
+ public:
+  // 0 disables the pool
+  static void set_worker_count(int32 worker_count);
+
+  static bool is_enabled();
+
+  // runs task(0), ..., task(task_count - 1) in parallel and returns after all of them are finished
+  // the calling thread takes part in execution of the tasks, so they are executed even if the pool is disabled
+  static void run(size_t task_count, const std::function<void(size_t)> &task);
+};
+
+}  // namespace mtproto
+}  // namespace td
@@ -0,0 +1,139 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/mtproto/DhExponentPool.h"
+
+#include "td/utils/port/thread.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+namespace td {
+namespace mtproto {
+
+#if !TD_THREAD_UNSUPPORTED
+namespace {
+
+class DhExponentPoolImpl {
+ public:
+  DhExponentPoolImpl() = default;
+  DhExponentPoolImpl(const DhExponentPoolImpl &) = delete;
+  DhExponentPoolImpl &operator=(const DhExponentPoolImpl &) = delete;
+  DhExponentPoolImpl(DhExponentPoolImpl &&) = delete;
+  DhExponentPoolImpl &operator=(DhExponentPoolImpl &&) = delete;
+  ~DhExponentPoolImpl() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      close_flag_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+  }
+
+  static DhExponentPoolImpl &get() {
+    static DhExponentPoolImpl pool;
+    return pool;
+  }
+
+  void set_max_size(size_t max_size) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    max_size_ = max_size;
+    if (exponents_.size() > max_size_) {
+      exponents_.resize(max_size_);
+    }
+    if (max_size_ > 0 && !is_thread_started_) {
+      is_thread_started_ = true;
+      thread_ = td::thread([this] { generator_loop(); });
+      thread_.set_name("DhExponentPool");
+    }
+    cond_.notify_all();
+  }
+
+  bool take(int32 g_int, Slice prime_str, BigNum &b, BigNum &g_b) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (max_size_ == 0) {
+      return false;
+    }
+    if (g_int != g_int_ || prime_str != prime_str_) {
+      // start generation for the new parameters
+      g_int_ = g_int;
+      prime_str_ = prime_str.str();
+      exponents_.clear();
+      cond_.notify_all();
+      return false;
+    }
+    if (exponents_.empty()) {
+      return false;
+    }
+    b = std::move(exponents_.back().first);
+    g_b = std::move(exponents_.back().second);
+    exponents_.pop_back();
+    cond_.notify_all();
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  size_t max_size_ = 0;
+  int32 g_int_ = 0;
+  string prime_str_;
+  vector<std::pair<BigNum, BigNum>> exponents_;
+  bool close_flag_ = false;
+  bool is_thread_started_ = false;
+  td::thread thread_;
+
+  void generator_loop() {
+    BigNumContext ctx;
+    while (true) {
+      int32 g_int;
+      string prime_str;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [&] { return close_flag_ || (!prime_str_.empty() && exponents_.size() < max_size_); });
+        if (close_flag_) {
+          return;
+        }
+        g_int = g_int_;
+        prime_str = prime_str_;
+      }
+
+      BigNum b;
+      BigNum::random(b, 2048, -1, 0);
+      BigNum g;
+      g.set_value(g_int);
+      BigNum g_b;
+      BigNum::mod_exp(g_b, g, b, BigNum::from_binary(prime_str), ctx);
+
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (g_int == g_int_ && prime_str == prime_str_ && exponents_.size() < max_size_) {
+        exponents_.emplace_back(std::move(b), std::move(g_b));
+      }
+    }
+  }
+};
+
+}  // namespace
+
+void DhExponentPool::set_max_size(size_t max_size) {
+  DhExponentPoolImpl::get().set_max_size(max_size);
+}
+
+bool DhExponentPool::take(int32 g_int, Slice prime_str, BigNum &b, BigNum &g_b) {
+  return DhExponentPoolImpl::get().take(g_int, prime_str, b, g_b);
+}
+#else
+void DhExponentPool::set_max_size(size_t max_size) {
+}
+
+bool DhExponentPool::take(int32 g_int, Slice prime_str, BigNum &b, BigNum &g_b) {
+  return false;
+}
+#endif
+
+}  // namespace mtproto
+}  // namespace td
@@ -0,0 +1,28 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/BigNum.h"
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+namespace td {
+namespace mtproto {
+
+// process-wide pool of precomputed pairs (b, g^b mod p) for client side of Diffie-Hellman key exchanges
+// the pairs are generated by a background thread for the last used g and p
+class DhExponentPool {
+ public:
+  // 0 disables the pool
+  static void set_max_size(size_t max_size);
+
+  // returns false if there is no precomputed pair for the given g and p; each pair is returned at most once
+  static bool take(int32 g_int, Slice prime_str, BigNum &b, BigNum &g_b);
+};
+
+}  // namespace mtproto
+}  // namespace td
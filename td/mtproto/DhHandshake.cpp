@@ -7,6 +7,7 @@
 #include "td/mtproto/DhHandshake.h"
 
 #include "td/mtproto/DhCallback.h"
+#include "td/mtproto/DhExponentPool.h"
 
 #include "td/utils/as.h"
 #include "td/utils/crypto.h"
@@ -133,12 +134,16 @@ void DhHandshake::set_config(int32 g_int, Slice prime_str) {
   b_ = BigNum();
   g_b_ = BigNum();
 
-  BigNum::random(b_, 2048, -1, 0);
-
-  // g^b
   g_int_ = g_int;
   g_.set_value(g_int_);
 
+  if (DhExponentPool::take(g_int, prime_str, b_, g_b_)) {
+    return;
+  }
+
+  BigNum::random(b_, 2048, -1, 0);
+
+  // g^b
   BigNum::mod_exp(g_b_, g_, b_, prime_, ctx_);
 }
 
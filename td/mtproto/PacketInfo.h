@@ -26,6 +26,7 @@ struct PacketInfo {
   int32 version{1};
   bool no_crypto_flag{false};
   bool is_creator{false};
+  bool is_server{false};  // the packet is sent or received by the server side of a connection
   bool check_mod4{true};
   bool use_random_padding{false};
   uint32 size{0};
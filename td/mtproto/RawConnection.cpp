@@ -7,6 +7,7 @@
 #include "td/mtproto/RawConnection.h"
 
 #include "td/mtproto/AuthKey.h"
+#include "td/mtproto/CryptoWorkerPool.h"
 #include "td/mtproto/IStreamTransport.h"
 #include "td/mtproto/ProxySecret.h"
 #include "td/mtproto/Transport.h"
@@ -120,6 +121,8 @@ class RawConnectionDefault final : public RawConnection {
   }
 
   void close() final {
+    LOG(DEBUG) << "Close connection after " << socket_fd_.get_read_syscall_count() << " reads and "
+               << socket_fd_.get_write_syscall_count() << " writes";
     transport_.reset();
     socket_fd_.close();
   }
@@ -137,6 +140,7 @@ class RawConnectionDefault final : public RawConnection {
   unique_ptr<IStreamTransport> transport_;
   FlatHashMap<uint32, uint64> quick_ack_to_token_;
   bool has_error_{false};
+  size_t expected_packet_size_{0};
 
   unique_ptr<StatsCallback> stats_callback_;
 
@@ -153,41 +157,101 @@ class RawConnectionDefault final : public RawConnection {
     callback.on_read(size);
   }
 
+  struct ReceivedPacket {
+    BufferSlice packet;
+    BufferSlice unaligned_packet;
+    uint32 quick_ack = 0;
+    PacketInfo info;
+    Result<Transport::ReadResult> r_read_result;
+  };
+
+  static void decrypt_packet(ReceivedPacket &received_packet, const AuthKey &auth_key) {
+    if (received_packet.quick_ack != 0) {
+      return;
+    }
+    auto &packet = received_packet.packet;
+    auto &unaligned_packet = received_packet.unaligned_packet;
+    auto &info = received_packet.info;
+    info.version = 2;
+    received_packet.r_read_result =
+        Transport::read(unaligned_packet.empty() ? packet.as_slice() : unaligned_packet.as_slice(),
+                        packet.as_mutable_slice(), auth_key, &info);
+  }
+
+  static void decrypt_packets(vector<ReceivedPacket> &received_packets, const AuthKey &auth_key) {
+    // big batches of packets, received for example during getDifference, are decrypted in parallel
+    // by the crypto worker pool; the packets are still handled in order by the calling thread
+    constexpr size_t MIN_PARALLEL_DECRYPTION_SIZE = 1 << 16;
+    size_t total_size = 0;
+    for (auto &received_packet : received_packets) {
+      total_size += received_packet.packet.size();
+    }
+    if (received_packets.size() >= 2 && total_size >= MIN_PARALLEL_DECRYPTION_SIZE &&
+        CryptoWorkerPool::is_enabled()) {
+      CryptoWorkerPool::run(received_packets.size(),
+                            [&](size_t i) { decrypt_packet(received_packets[i], auth_key); });
+      return;
+    }
+    for (auto &received_packet : received_packets) {
+      decrypt_packet(received_packet, auth_key);
+    }
+  }
+
   Status flush_read(const AuthKey &auth_key, Callback &callback) {
     auto r = socket_fd_.flush_read();
     if (r.is_ok()) {
       on_read(r.ok(), callback);
     }
+    vector<ReceivedPacket> received_packets;
     while (transport_->can_read()) {
       BufferSlice packet;
       uint32 quick_ack = 0;
       TRY_RESULT(wait_size, transport_->read_next(&packet, &quick_ack));
-      auto old_pointer = packet.as_slice().ubegin();
-      if (!is_aligned_pointer<4>(old_pointer)) {
-        BufferSlice new_packet(packet.size());
-        new_packet.as_mutable_slice().copy_from(packet.as_slice());
-        packet = std::move(new_packet);
-      }
-      LOG_CHECK(is_aligned_pointer<4>(packet.as_slice().ubegin()))
-          << old_pointer << ' ' << packet.as_slice().ubegin() << ' ' << BufferSlice(0).as_slice().ubegin() << ' '
-          << packet.size() << ' ' << wait_size << ' ' << quick_ack;
       if (wait_size != 0) {
         constexpr size_t MAX_PACKET_SIZE = (1 << 22) + 1024;
         if (wait_size > MAX_PACKET_SIZE) {
           return Status::Error(PSLICE() << "Expected packet size is too big: " << wait_size);
         }
+        if (wait_size != expected_packet_size_) {
+          // receive the rest of a big packet, like a file part, into few big chunks instead of many small ones
+          expected_packet_size_ = wait_size;
+          constexpr size_t MIN_READ_SIZE_HINT = 1 << 14;
+          socket_fd_.set_read_size_hint(wait_size >= MIN_READ_SIZE_HINT ? wait_size : 0);
+        }
         break;
       }
+      if (expected_packet_size_ != 0) {
+        expected_packet_size_ = 0;
+        socket_fd_.set_read_size_hint(0);
+      }
 
-      if (quick_ack != 0) {
-        TRY_STATUS(on_quick_ack(quick_ack, callback));
-        continue;
+      ReceivedPacket received_packet;
+      received_packet.quick_ack = quick_ack;
+      if (quick_ack == 0) {
+        // the packet is decrypted in place, unless it isn't aligned; in the latter case it is decrypted directly
+        // into a new aligned buffer instead of being copied there before decryption
+        auto old_pointer = packet.as_slice().ubegin();
+        if (!is_aligned_pointer<4>(old_pointer)) {
+          received_packet.unaligned_packet = std::move(packet);
+          packet = BufferSlice(received_packet.unaligned_packet.size());
+        }
+        LOG_CHECK(is_aligned_pointer<4>(packet.as_slice().ubegin()))
+            << old_pointer << ' ' << packet.as_slice().ubegin() << ' ' << BufferSlice(0).as_slice().ubegin() << ' '
+            << packet.size() << ' ' << wait_size;
       }
+      received_packet.packet = std::move(packet);
+      received_packets.push_back(std::move(received_packet));
+    }
+
+    decrypt_packets(received_packets, auth_key);
 
-      PacketInfo info;
-      info.version = 2;
+    for (auto &received_packet : received_packets) {
+      if (received_packet.quick_ack != 0) {
+        TRY_STATUS(on_quick_ack(received_packet.quick_ack, callback));
+        continue;
+      }
 
-      TRY_RESULT(read_result, Transport::read(packet.as_mutable_slice(), auth_key, &info));
+      TRY_RESULT(read_result, std::move(received_packet.r_read_result));
       switch (read_result.type()) {
         case Transport::ReadResult::Quickack: {
           TRY_STATUS(on_quick_ack(read_result.quick_ack(), callback));
@@ -205,7 +269,8 @@ class RawConnectionDefault final : public RawConnection {
             }
           }
 
-          TRY_STATUS(callback.on_raw_packet(info, packet.from_slice(read_result.packet())));
+          TRY_STATUS(callback.on_raw_packet(received_packet.info,
+                                            received_packet.packet.from_slice(read_result.packet())));
           break;
         }
         case Transport::ReadResult::Nop:
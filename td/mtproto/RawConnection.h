@@ -31,6 +31,7 @@ class RawConnection {
     virtual ~StatsCallback() = default;
     virtual void on_read(uint64 bytes) = 0;
     virtual void on_write(uint64 bytes) = 0;
+    virtual void on_packet_sent(uint64 bytes) = 0;  // called for each sent MTProto packet after on_write
 
     virtual void on_pong() = 0;   // called when we know that connection is alive
     virtual void on_error() = 0;  // called on RawConnection error. Such error should be very rare on good connections.
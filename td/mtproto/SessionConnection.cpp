@@ -30,6 +30,7 @@
 #include "td/utils/TlDowncastHelper.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <type_traits>
 
@@ -330,6 +331,7 @@ Status SessionConnection::on_packet(const MsgInfo &info,
       LOG(WARNING) << bad_info << ": MessageId is too high. Session will be closed";
       // All this queries will be re-sent by parent
       to_send_.clear();
+      to_send_size_ = 0;
       callback_->on_session_failed(Status::Error("MessageId is too high"));
       return Status::Error("MessageId is too high");
     }
@@ -404,6 +406,7 @@ Status SessionConnection::on_packet(const MsgInfo &info, const mtproto_api::gzip
 Status SessionConnection::on_packet(const MsgInfo &info, const mtproto_api::pong &pong) {
   VLOG(mtproto) << "PONG";
   last_pong_at_ = Time::now_cached();
+  on_pong_received(pong.ping_id_);
   return callback_->on_pong();
 }
 Status SessionConnection::on_packet(const MsgInfo &info, const mtproto_api::future_salts &salts) {
@@ -756,6 +759,51 @@ void SessionConnection::set_online(bool online_flag, bool is_main) {
   last_ping_container_id_ = 0;
 }
 
+double SessionConnection::get_degraded_rtt() const {
+  return max(min_rtt_ * DEGRADED_RTT_FACTOR, min_rtt_ + MIN_DEGRADED_RTT_INCREASE);
+}
+
+bool SessionConnection::is_degraded() const {
+  if (answered_ping_count_ < MIN_DEGRADED_PING_COUNT) {
+    return false;
+  }
+  auto degraded_rtt = get_degraded_rtt();
+  if (smoothed_rtt_ > degraded_rtt || ping_loss_rate_ > DEGRADED_PING_LOSS_RATE) {
+    return true;
+  }
+  return !pending_pings_.empty() && pending_pings_.front().sent_at + degraded_rtt < Time::now_cached();
+}
+
+void SessionConnection::on_ping_sent(int64 ping_id) {
+  if (pending_pings_.size() >= MAX_PENDING_PINGS) {
+    pending_pings_.pop();
+    ping_loss_rate_ += (1.0 - ping_loss_rate_) * RTT_SMOOTHING_FACTOR;
+  }
+  pending_pings_.push(PendingPing{ping_id, Time::now_cached()});
+}
+
+void SessionConnection::on_pong_received(int64 ping_id) {
+  // pongs are received in the order in which pings were sent, so all earlier pings are lost
+  while (!pending_pings_.empty() && pending_pings_.front().ping_id < ping_id) {
+    pending_pings_.pop();
+    ping_loss_rate_ += (1.0 - ping_loss_rate_) * RTT_SMOOTHING_FACTOR;
+  }
+  if (pending_pings_.empty() || pending_pings_.front().ping_id != ping_id) {
+    return;
+  }
+  auto rtt = max(Time::now_cached() - pending_pings_.pop().sent_at, 0.0);
+  ping_loss_rate_ -= ping_loss_rate_ * RTT_SMOOTHING_FACTOR;
+  if (answered_ping_count_++ == 0) {
+    smoothed_rtt_ = rtt;
+    min_rtt_ = rtt;
+  } else {
+    smoothed_rtt_ += (rtt - smoothed_rtt_) * RTT_SMOOTHING_FACTOR;
+    min_rtt_ = min(min_rtt_, rtt);
+  }
+  VLOG(mtproto) << "Receive pong with RTT " << rtt << ", smoothed RTT = " << smoothed_rtt_
+                << ", minimum RTT = " << min_rtt_ << ", ping loss rate = " << ping_loss_rate_;
+}
+
 void SessionConnection::do_close(Status status) {
   state_ = Closed;
   // NB: this could be destroyed after on_closed
@@ -776,8 +824,13 @@ Result<uint64> SessionConnection::send_query(BufferSlice buffer, bool gzip_flag,
     message_id = auth_data_->next_message_id(Time::now_cached());
   }
   auto seq_no = auth_data_->next_seq_no(true);
+  update_query_rate(buffer.size());
   if (to_send_.empty()) {
-    send_before(Time::now_cached() + QUERY_DELAY);
+    send_before(Time::now_cached() + get_query_delay());
+  }
+  to_send_size_ += buffer.size();
+  if (to_send_size_ >= get_max_container_size()) {
+    send_before(Time::now_cached());
   }
   to_send_.push_back(
       MtprotoQuery{message_id, seq_no, std::move(buffer), gzip_flag, std::move(invoke_after_ids), use_quick_ack});
@@ -787,6 +840,49 @@ Result<uint64> SessionConnection::send_query(BufferSlice buffer, bool gzip_flag,
   return message_id;
 }
 
+void SessionConnection::update_query_rate(size_t query_size) {
+  // exponentially decaying number of queries and bytes per QUERY_RATE_PERIOD
+  auto now = Time::now_cached();
+  if (last_query_at_ != 0) {
+    auto decay = std::exp(-max(now - last_query_at_, 0.0) / QUERY_RATE_PERIOD);
+    query_rate_ *= decay;
+    query_size_rate_ *= decay;
+  }
+  last_query_at_ = now;
+  query_rate_ += 1.0 / QUERY_RATE_PERIOD;
+  query_size_rate_ += static_cast<double>(query_size) / QUERY_RATE_PERIOD;
+}
+
+bool SessionConnection::is_bulk_flow() const {
+  return query_rate_ >= BULK_QUERY_RATE;
+}
+
+double SessionConnection::get_query_delay() const {
+  if (!is_bulk_flow()) {
+    // queries added in the same event loop iteration are still packed together
+    return 0.0;
+  }
+  double min_delay = QUERY_DELAY;
+  double max_delay = MAX_BULK_QUERY_DELAY;
+  return clamp(raw_connection_->extra().rtt * 0.05, min_delay, max_delay);
+}
+
+size_t SessionConnection::get_max_container_size() const {
+  if (!is_bulk_flow()) {
+    return MIN_CONTAINER_SIZE;
+  }
+  // the number of bytes sent during one RTT is an estimate of the current congestion window
+  double min_rtt = QUERY_DELAY;
+  auto window_size = query_size_rate_ * max(raw_connection_->extra().rtt, min_rtt);
+  if (window_size <= static_cast<double>(MIN_CONTAINER_SIZE)) {
+    return MIN_CONTAINER_SIZE;
+  }
+  if (window_size >= static_cast<double>(MAX_CONTAINER_SIZE)) {
+    return MAX_CONTAINER_SIZE;
+  }
+  return static_cast<size_t>(window_size);
+}
+
 void SessionConnection::get_state_info(int64 message_id) {
   if (to_get_state_info_.empty()) {
     send_before(Time::now_cached());
@@ -908,14 +1004,16 @@ void SessionConnection::flush_packet() {
 
   size_t send_till = 0;
   size_t send_size = 0;
-  // send at most 1020 queries, of total size 2^15
+  // send at most 1020 queries, of total size get_max_container_size()
   // don't send anything if have no salt
   if (has_salt) {
-    while (send_till < to_send_.size() && send_till < 1020 && send_size < (1 << 15)) {
+    auto max_container_size = get_max_container_size();
+    while (send_till < to_send_.size() && send_till < 1020 && send_size < max_container_size) {
       send_size += to_send_[send_till].packet.size();
       send_till++;
     }
   }
+  to_send_size_ -= send_size;
   vector<MtprotoQuery> queries;
   if (send_till == to_send_.size()) {
     queries = std::move(to_send_);
@@ -976,7 +1074,12 @@ void SessionConnection::flush_packet() {
                                            &get_state_info_id, &resend_answer_id, &ping_message_id, &parent_message_id);
 
     auto quick_ack_token = use_quick_ack ? parent_message_id : 0;
+    auto old_write_size = last_write_size_;
     send_crypto(storer, quick_ack_token);
+    auto stats_callback = raw_connection_->stats_callback();
+    if (stats_callback != nullptr) {
+      stats_callback->on_packet_sent(last_write_size_ - old_write_size);
+    }
   }
 
   if (resend_answer_id) {
@@ -988,6 +1091,7 @@ void SessionConnection::flush_packet() {
   if (ping_id != 0) {
     last_ping_container_id_ = container_id;
     last_ping_message_id_ = ping_message_id;
+    on_ping_sent(ping_id);
   }
 
   if (container_id != 0) {
@@ -1076,13 +1180,20 @@ double SessionConnection::flush(SessionConnection::Callback *callback) {
   }
 
   // wakeup_at
-  // three independent timeouts
+  // four independent timeouts
   // 1. close connection after ping_disconnect_delay() after last pong
   // 2. close connection after read_disconnect_delay() after last read
   // 3. the one returned by must_flush_packet
   relax_timeout_at(&wakeup_at_, last_pong_at_ + ping_disconnect_delay() + 0.002);
   relax_timeout_at(&wakeup_at_, last_read_at_ + read_disconnect_delay() + 0.002);
   relax_timeout_at(&wakeup_at_, flush_packet_at_);
+  // 4. wake up the owner when the connection becomes degraded because of an unanswered ping
+  if (answered_ping_count_ >= MIN_DEGRADED_PING_COUNT && !pending_pings_.empty()) {
+    auto degraded_at = pending_pings_.front().sent_at + get_degraded_rtt() + 0.002;
+    if (degraded_at > Time::now_cached()) {
+      relax_timeout_at(&wakeup_at_, degraded_at);
+    }
+  }
 
   auto now = Time::now();
   LOG(DEBUG) << "Last pong was in " << (now - last_pong_at_) << ", last read was in " << (now - last_pong_at_)
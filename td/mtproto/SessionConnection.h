@@ -22,6 +22,7 @@
 #include "td/utils/StorerBase.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tl_parsers.h"
+#include "td/utils/VectorQueue.h"
 
 #include <utility>
 
@@ -93,6 +94,19 @@ class SessionConnection final
   void set_online(bool online_flag, bool is_main);
   void force_ack();
 
+  // smoothed RTT of pings sent over the connection; 0 if there were no answered pings yet
+  double get_smoothed_rtt() const {
+    return smoothed_rtt_;
+  }
+
+  // fraction of recently sent pings, which were left unanswered
+  double get_ping_loss_rate() const {
+    return ping_loss_rate_;
+  }
+
+  // returns true if RTT or ping loss rate of the connection has grown significantly since it was created
+  bool is_degraded() const;
+
   class Callback {
    public:
     Callback() = default;
@@ -133,6 +147,7 @@ class SessionConnection final
  private:
   static constexpr int ACK_DELAY = 30;                  // 30s
   static constexpr double QUERY_DELAY = 0.001;          // 0.001s
+  static constexpr double MAX_BULK_QUERY_DELAY = 0.01;  // 0.01s
   static constexpr double RESEND_ANSWER_DELAY = 0.001;  // 0.001s
 
   bool online_flag_ = false;
@@ -159,13 +174,54 @@ class SessionConnection final
     return online_flag_ ? rtt() : 60 + random_delay_;
   }
 
+  // connection quality is tracked using answers to the pings
+  // the connection is considered degraded if the smoothed RTT is much bigger than the minimum RTT,
+  // if too many pings are unanswered, or if the oldest unanswered ping is waiting for too long
+  static constexpr double RTT_SMOOTHING_FACTOR = 0.125;
+  static constexpr size_t MIN_DEGRADED_PING_COUNT = 4;
+  static constexpr size_t MAX_PENDING_PINGS = 16;
+  static constexpr double DEGRADED_RTT_FACTOR = 3.0;
+  static constexpr double MIN_DEGRADED_RTT_INCREASE = 1.0;  // 1s
+  static constexpr double DEGRADED_PING_LOSS_RATE = 0.3;
+
+  struct PendingPing {
+    int64 ping_id;
+    double sent_at;
+  };
+  VectorQueue<PendingPing> pending_pings_;
+  size_t answered_ping_count_ = 0;
+  double smoothed_rtt_ = 0;
+  double min_rtt_ = 0;
+  double ping_loss_rate_ = 0;
+
+  double get_degraded_rtt() const;
+  void on_ping_sent(int64 ping_id);
+  void on_pong_received(int64 ping_id);
+
   double http_max_wait() const {
     return 25.0;  // 25s. Longer could be closed by proxy
   }
   static constexpr int HTTP_MAX_AFTER = 10;  // 0.01s
   static constexpr int HTTP_MAX_DELAY = 30;  // 0.03s
 
+  // queries are sent immediately in interactive flows and are delayed for a fraction of RTT in bulk flows
+  // to be packed in containers, which size is chosen from the number of bytes sent per RTT
+  static constexpr double BULK_QUERY_RATE = 20.0;        // queries per second
+  static constexpr double QUERY_RATE_PERIOD = 1.0;       // 1s
+  static constexpr size_t MIN_CONTAINER_SIZE = 1 << 15;  // 32KB
+  static constexpr size_t MAX_CONTAINER_SIZE = 1 << 17;  // 128KB
+
+  double query_rate_ = 0;
+  double query_size_rate_ = 0;
+  double last_query_at_ = 0;
+
+  void update_query_rate(size_t query_size);
+  bool is_bulk_flow() const;
+  double get_query_delay() const;
+  size_t get_max_container_size() const;
+
   vector<MtprotoQuery> to_send_;
+  size_t to_send_size_ = 0;
   vector<int64> to_ack_;
   double force_send_at_ = 0;
 
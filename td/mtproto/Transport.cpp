@@ -217,17 +217,28 @@ Status Transport::read_no_crypto(MutableSlice message, PacketInfo *info, Mutable
 }
 
 template <class HeaderT, class PrefixT>
-Status Transport::read_crypto_impl(int X, MutableSlice message, const AuthKey &auth_key, HeaderT **header_ptr,
-                                   PrefixT **prefix_ptr, MutableSlice *data, PacketInfo *info) {
+Status Transport::read_crypto_impl(int X, Slice message, MutableSlice dest, const AuthKey &auth_key,
+                                   HeaderT **header_ptr, PrefixT **prefix_ptr, MutableSlice *data, PacketInfo *info) {
+  CHECK(dest.size() == message.size());
   if (message.size() < sizeof(HeaderT)) {
     return Status::Error(PSLICE() << "Invalid MTProto message: too small [message.size() = " << message.size()
                                   << "] < [sizeof(HeaderT) = " << sizeof(HeaderT) << "]");
   }
+  bool is_inplace = dest.begin() == message.begin();
+  if (!is_inplace) {
+    // the encrypted part is copied by the decryption itself
+    dest.copy_from(message.substr(0, sizeof(HeaderT)));
+  }
   //FIXME: rewrite without reinterpret cast
-  auto *header = reinterpret_cast<HeaderT *>(message.begin());
+  auto *header = reinterpret_cast<HeaderT *>(dest.begin());
   *header_ptr = header;
-  auto to_decrypt = MutableSlice(header->encrypt_begin(), message.uend());
-  to_decrypt.remove_suffix(to_decrypt.size() & 15);
+  auto to_decrypt = MutableSlice(header->encrypt_begin(), dest.uend());
+  auto unaligned_size = to_decrypt.size() & 15;
+  to_decrypt.remove_suffix(unaligned_size);
+  auto encrypted = message.substr(header->encrypt_begin() - dest.ubegin(), to_decrypt.size());
+  if (!is_inplace && unaligned_size != 0) {
+    dest.substr(dest.size() - unaligned_size).copy_from(message.substr(message.size() - unaligned_size));
+  }
 
   if (header->auth_key_id != auth_key.id()) {
     return Status::Error(PSLICE() << "Invalid MTProto message: auth_key_id mismatch [found = "
@@ -243,9 +254,9 @@ Status Transport::read_crypto_impl(int X, MutableSlice message, const AuthKey &a
     KDF2(auth_key.key(), header->message_key, X, &aes_key, &aes_iv);
   }
 
-  aes_ige_decrypt(as_slice(aes_key), as_mutable_slice(aes_iv), to_decrypt, to_decrypt);
+  aes_ige_decrypt(as_slice(aes_key), as_mutable_slice(aes_iv), encrypted, to_decrypt);
 
-  size_t tail_size = message.end() - reinterpret_cast<char *>(header->data);
+  size_t tail_size = dest.end() - reinterpret_cast<char *>(header->data);
   if (tail_size < sizeof(PrefixT)) {
     return Status::Error("Too small encrypted part");
   }
@@ -304,10 +315,11 @@ Status Transport::read_crypto_impl(int X, MutableSlice message, const AuthKey &a
   return Status::OK();
 }
 
-Status Transport::read_crypto(MutableSlice message, const AuthKey &auth_key, PacketInfo *info, MutableSlice *data) {
+Status Transport::read_crypto(Slice message, MutableSlice dest, const AuthKey &auth_key, PacketInfo *info,
+                              MutableSlice *data) {
   CryptoHeader *header = nullptr;
   CryptoPrefix *prefix = nullptr;
-  TRY_STATUS(read_crypto_impl(8, message, auth_key, &header, &prefix, data, info));
+  TRY_STATUS(read_crypto_impl(info->is_server ? 0 : 8, message, dest, auth_key, &header, &prefix, data, info));
   CHECK(header != nullptr);
   CHECK(prefix != nullptr);
   CHECK(info != nullptr);
@@ -318,11 +330,12 @@ Status Transport::read_crypto(MutableSlice message, const AuthKey &auth_key, Pac
   info->seq_no = prefix->seq_no;
   return Status::OK();
 }
-Status Transport::read_e2e_crypto(MutableSlice message, const AuthKey &auth_key, PacketInfo *info, MutableSlice *data) {
+Status Transport::read_e2e_crypto(Slice message, MutableSlice dest, const AuthKey &auth_key, PacketInfo *info,
+                                  MutableSlice *data) {
   EndToEndHeader *header = nullptr;
   EndToEndPrefix *prefix = nullptr;
-  TRY_STATUS(read_crypto_impl(info->is_creator && info->version != 1 ? 8 : 0, message, auth_key, &header, &prefix, data,
-                              info));
+  TRY_STATUS(read_crypto_impl(info->is_creator && info->version != 1 ? 8 : 0, message, dest, auth_key, &header,
+                              &prefix, data, info));
   CHECK(header != nullptr);
   CHECK(prefix != nullptr);
   CHECK(info != nullptr);
@@ -399,7 +412,7 @@ size_t Transport::write_crypto(const Storer &storer, const AuthKey &auth_key, Pa
   header.salt = info->salt;
   header.session_id = info->session_id;
 
-  write_crypto_impl(0, storer, auth_key, info, &header, data_size);
+  write_crypto_impl(info->is_server ? 8 : 0, storer, auth_key, info, &header, data_size);
 
   return size;
 }
@@ -433,6 +446,12 @@ Result<uint64> Transport::read_auth_key_id(Slice message) {
 }
 
 Result<Transport::ReadResult> Transport::read(MutableSlice message, const AuthKey &auth_key, PacketInfo *info) {
+  return read(message, message, auth_key, info);
+}
+
+Result<Transport::ReadResult> Transport::read(Slice message, MutableSlice dest, const AuthKey &auth_key,
+                                              PacketInfo *info) {
+  CHECK(dest.size() == message.size());
   if (message.size() < 12) {
     if (message.size() < 4) {
       return Status::Error(PSLICE() << "Invalid MTProto message: smaller than 4 bytes [size = " << message.size()
@@ -453,14 +472,17 @@ Result<Transport::ReadResult> Transport::read(MutableSlice message, const AuthKe
   info->no_crypto_flag = info->auth_key_id == 0;
   MutableSlice data;
   if (info->type == PacketInfo::EndToEnd) {
-    TRY_STATUS(read_e2e_crypto(message, auth_key, info, &data));
+    TRY_STATUS(read_e2e_crypto(message, dest, auth_key, info, &data));
   } else if (info->no_crypto_flag) {
-    TRY_STATUS(read_no_crypto(message, info, &data));
+    if (dest.begin() != message.begin()) {
+      dest.copy_from(message);
+    }
+    TRY_STATUS(read_no_crypto(dest, info, &data));
   } else {
     if (auth_key.empty()) {
       return Status::Error("Failed to decrypt MTProto message: auth key is empty");
     }
-    TRY_STATUS(read_crypto(message, auth_key, info, &data));
+    TRY_STATUS(read_crypto(message, dest, auth_key, info, &data));
   }
   return ReadResult::make_packet(data);
 }
@@ -88,6 +88,11 @@ class Transport {
   // If auth_key is nonempty, encryption will be used.
   static Result<ReadResult> read(MutableSlice message, const AuthKey &auth_key, PacketInfo *info) TD_WARN_UNUSED_RESULT;
 
+  // The same as above, but the packet is decrypted directly from [message] into [dest] of the same size,
+  // so [data] will be subslice of [dest]. [dest] can coincide with [message].
+  static Result<ReadResult> read(Slice message, MutableSlice dest, const AuthKey &auth_key,
+                                 PacketInfo *info) TD_WARN_UNUSED_RESULT;
+
   static size_t write(const Storer &storer, const AuthKey &auth_key, PacketInfo *info,
                       MutableSlice dest = MutableSlice());
 
@@ -107,13 +112,14 @@ class Transport {
 
   static Status read_no_crypto(MutableSlice message, PacketInfo *info, MutableSlice *data) TD_WARN_UNUSED_RESULT;
 
-  static Status read_crypto(MutableSlice message, const AuthKey &auth_key, PacketInfo *info,
+  static Status read_crypto(Slice message, MutableSlice dest, const AuthKey &auth_key, PacketInfo *info,
                             MutableSlice *data) TD_WARN_UNUSED_RESULT;
-  static Status read_e2e_crypto(MutableSlice message, const AuthKey &auth_key, PacketInfo *info,
+  static Status read_e2e_crypto(Slice message, MutableSlice dest, const AuthKey &auth_key, PacketInfo *info,
                                 MutableSlice *data) TD_WARN_UNUSED_RESULT;
   template <class HeaderT, class PrefixT>
-  static Status read_crypto_impl(int X, MutableSlice message, const AuthKey &auth_key, HeaderT **header_ptr,
-                                 PrefixT **prefix_ptr, MutableSlice *data, PacketInfo *info) TD_WARN_UNUSED_RESULT;
+  static Status read_crypto_impl(int X, Slice message, MutableSlice dest, const AuthKey &auth_key,
+                                 HeaderT **header_ptr, PrefixT **prefix_ptr, MutableSlice *data,
+                                 PacketInfo *info) TD_WARN_UNUSED_RESULT;
 
   static size_t write_no_crypto(const Storer &storer, PacketInfo *info, MutableSlice dest);
 
@@ -802,13 +802,16 @@ void AuthManager::on_get_password_result(NetQueryPtr &result) {
       return;
     }
     LOG(INFO) << "Have SRP ID " << wait_password_state_.srp_id_;
-    auto hash = PasswordManager::get_input_check_password(password_, wait_password_state_.current_client_salt_,
-                                                          wait_password_state_.current_server_salt_,
-                                                          wait_password_state_.srp_g_, wait_password_state_.srp_p_,
-                                                          wait_password_state_.srp_B_, wait_password_state_.srp_id_);
-
-    start_net_query(NetQueryType::CheckPassword,
-                    G()->net_query_creator().create_unauth(telegram_api::auth_checkPassword(std::move(hash))));
+    PasswordManager::calc_input_check_password(
+        password_, wait_password_state_.current_client_salt_, wait_password_state_.current_server_salt_,
+        wait_password_state_.srp_g_, wait_password_state_.srp_p_, wait_password_state_.srp_B_,
+        wait_password_state_.srp_id_,
+        PromiseCreator::lambda([actor_id = actor_id(this), query_id = query_id_](
+                                   Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash) {
+          if (r_hash.is_ok()) {
+            send_closure(actor_id, &AuthManager::on_get_input_check_password, query_id, r_hash.move_as_ok());
+          }
+        }));
   } else {
     update_state(State::WaitPassword);
     if (query_id_ != 0) {
@@ -817,6 +820,16 @@ void AuthManager::on_get_password_result(NetQueryPtr &result) {
   }
 }
 
+void AuthManager::on_get_input_check_password(uint64 query_id,
+                                              tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash) {
+  if (query_id != query_id_ || state_ != State::WaitPassword || !checking_password_) {
+    LOG(INFO) << "Ignore password hash for outdated query " << query_id;
+    return;
+  }
+  start_net_query(NetQueryType::CheckPassword,
+                  G()->net_query_creator().create_unauth(telegram_api::auth_checkPassword(std::move(hash))));
+}
+
 void AuthManager::on_request_password_recovery_result(NetQueryPtr &result) {
   auto r_email_address_pattern = fetch_result<telegram_api::auth_requestPasswordRecovery>(result->ok());
   if (r_email_address_pattern.is_error()) {
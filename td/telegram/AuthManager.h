@@ -307,6 +307,7 @@ class AuthManager final : public NetActor {
   void on_verify_email_address_result(NetQueryPtr &result);
   void on_request_qr_code_result(NetQueryPtr &result, bool is_import);
   void on_get_password_result(NetQueryPtr &result);
+  void on_get_input_check_password(uint64 query_id, tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash);
   void on_request_password_recovery_result(NetQueryPtr &result);
   void on_check_password_recovery_code_result(NetQueryPtr &result);
   void on_request_firebase_sms_result(NetQueryPtr &result);
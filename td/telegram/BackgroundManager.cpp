@@ -419,6 +419,12 @@ void BackgroundManager::store_background(BackgroundId background_id, LogEventSto
   store(*background, storer);
 }
 
+void BackgroundManager::store_background(BackgroundId background_id, LogEventStorerBounded &storer) {
+  const auto *background = get_background(background_id);
+  CHECK(background != nullptr);
+  store(*background, storer);
+}
+
 void BackgroundManager::parse_background(BackgroundId &background_id, LogEventParser &parser) {
   Background background;
   parse(background, parser);
@@ -65,6 +65,8 @@ class BackgroundManager final : public Actor {
 
   void store_background(BackgroundId background_id, LogEventStorerUnsafe &storer);
 
+  void store_background(BackgroundId background_id, LogEventStorerBounded &storer);
+
   void parse_background(BackgroundId &background_id, LogEventParser &parser);
 
  private:
@@ -23,6 +23,11 @@ class ChannelParticipantFilter {
 
   friend StringBuilder &operator<<(StringBuilder &string_builder, const ChannelParticipantFilter &filter);
 
+  friend bool operator==(const ChannelParticipantFilter &lhs, const ChannelParticipantFilter &rhs) {
+    return lhs.type_ == rhs.type_ && lhs.query_ == rhs.query_ &&
+           lhs.top_thread_message_id_ == rhs.top_thread_message_id_;
+  }
+
  public:
   explicit ChannelParticipantFilter(const td_api::object_ptr<td_api::SupergroupMembersFilter> &filter);
 
@@ -21,6 +21,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/MpscPollableQueue.h"
+#include "td/utils/port/numa.h"
 #include "td/utils/port/RwMutex.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
@@ -92,6 +93,12 @@ class ClientManager::Impl final {
     return client_id;
   }
 
+  ClientId create_client_id_with_own_queue() {
+    auto client_id = create_client_id();
+    own_receivers_[client_id] = make_unique<TdReceiver>();
+    return client_id;
+  }
+
   void send(ClientId client_id, RequestId request_id, td_api::object_ptr<td_api::Function> &&request) {
     if (pending_clients_.erase(client_id) != 0) {
       if (tds_.empty()) {
@@ -101,74 +108,30 @@ class ClientManager::Impl final {
         concurrent_scheduler_ = make_unique<ConcurrentScheduler>(0, 0);
         concurrent_scheduler_->start();
       }
-      tds_[client_id] =
-          concurrent_scheduler_->create_actor_unsafe<Td>(0, "Td", receiver_.create_callback(client_id), options_);
+      tds_[client_id] = concurrent_scheduler_->create_actor_unsafe<Td>(
+          0, "Td", get_receiver(client_id).create_callback(client_id), options_);
     }
     requests_.push_back({client_id, request_id, std::move(request)});
   }
 
-  Response receive(double timeout) {
-    if (!requests_.empty()) {
-      for (size_t i = 0; i < requests_.size(); i++) {
-        auto &request = requests_[i];
-        if (request.client_id <= 0 || request.client_id > client_id_) {
-          receiver_.add_response(request.client_id, request.id,
-                                 td_api::make_object<td_api::error>(400, "Invalid TDLib instance specified"));
-          continue;
-        }
-        auto it = tds_.find(request.client_id);
-        if (it == tds_.end() || it->second.empty()) {
-          receiver_.add_response(request.client_id, request.id,
-                                 td_api::make_object<td_api::error>(500, "Request aborted"));
-          continue;
-        }
-
-        CHECK(concurrent_scheduler_ != nullptr);
-        auto guard = concurrent_scheduler_->get_main_guard();
-        send_closure_later(it->second, &Td::request, request.id, std::move(request.request));
-      }
-      requests_.clear();
+  void send_batch(vector<ClientManager::Request> &&requests) {
+    for (auto &request : requests) {
+      send(request.client_id, request.request_id, std::move(request.function));
     }
+  }
 
-    auto response = receiver_.receive(0);
-    if (response.client_id == 0 && response.request_id == 0 && concurrent_scheduler_ != nullptr) {
-      concurrent_scheduler_->run_main(0);
-      response = receiver_.receive(0);
-    } else {
-      ConcurrentScheduler::emscripten_clear_main_timeout();
-    }
-    if (response.request_id == 0 && response.object != nullptr &&
-        response.object->get_id() == td_api::updateAuthorizationState::ID &&
-        static_cast<const td_api::updateAuthorizationState *>(response.object.get())->authorization_state_->get_id() ==
-            td_api::authorizationStateClosed::ID) {
-      CHECK(concurrent_scheduler_ != nullptr);
-      auto guard = concurrent_scheduler_->get_main_guard();
-      auto it = tds_.find(response.client_id);
-      CHECK(it != tds_.end());
-      it->second.reset();
-
-      response.client_id = 0;
-      response.object = nullptr;
-    }
-    if (response.object == nullptr && response.client_id != 0 && response.request_id == 0) {
-      auto it = tds_.find(response.client_id);
-      CHECK(it != tds_.end());
-      CHECK(it->second.empty());
-      tds_.erase(it);
-
-      response.object = td_api::make_object<td_api::updateAuthorizationState>(
-          td_api::make_object<td_api::authorizationStateClosed>());
+  Response receive(double timeout) {
+    flush_requests();
+    return receive_response(receiver_);
+  }
 
-      if (tds_.empty()) {
-        CHECK(options_.net_query_stats.use_count() == 1);
-        CHECK(options_.net_query_stats->get_count() == 0);
-        options_.net_query_stats = nullptr;
-        concurrent_scheduler_->finish();
-        concurrent_scheduler_ = nullptr;
-        reset_to_empty(tds_);
-      }
+  Response receive(ClientId client_id, double timeout) {
+    auto it = own_receivers_.find(client_id);
+    if (it == own_receivers_.end()) {
+      return {0, 0, nullptr};
     }
-    return response;
+    flush_requests();
+    return receive_response(*it->second);
   }
 
   Impl() = default;
@@ -187,6 +150,15 @@ class ClientManager::Impl final {
         td.second.reset();
       }
     }
+    vector<ClientId> own_queue_client_ids;
+    for (auto &it : own_receivers_) {
+      own_queue_client_ids.push_back(it.first);
+    }
+    for (auto client_id : own_queue_client_ids) {
+      while (tds_.count(client_id) != 0 && !ExitGuard::is_exited()) {
+        receive(client_id, 0.1);
+      }
+    }
     while (!tds_.empty() && !ExitGuard::is_exited()) {
       receive(0.1);
     }
@@ -197,6 +169,7 @@ class ClientManager::Impl final {
 
  private:
   TdReceiver receiver_;
+  FlatHashMap<ClientId, unique_ptr<TdReceiver>> own_receivers_;
   struct Request {
     ClientId client_id;
     RequestId id;
@@ -208,6 +181,82 @@ class ClientManager::Impl final {
   Td::Options options_;
   FlatHashSet<int32> pending_clients_;
   FlatHashMap<int32, ActorOwn<Td>> tds_;
+
+  TdReceiver &get_receiver(ClientId client_id) {
+    auto it = own_receivers_.find(client_id);
+    if (it == own_receivers_.end()) {
+      return receiver_;
+    }
+    return *it->second;
+  }
+
+  void flush_requests() {
+    if (requests_.empty()) {
+      return;
+    }
+    for (size_t i = 0; i < requests_.size(); i++) {
+      auto &request = requests_[i];
+      if (request.client_id <= 0 || request.client_id > client_id_) {
+        receiver_.add_response(request.client_id, request.id,
+                               td_api::make_object<td_api::error>(400, "Invalid TDLib instance specified"));
+        continue;
+      }
+      auto it = tds_.find(request.client_id);
+      if (it == tds_.end() || it->second.empty()) {
+        get_receiver(request.client_id)
+            .add_response(request.client_id, request.id, td_api::make_object<td_api::error>(500, "Request aborted"));
+        continue;
+      }
+
+      CHECK(concurrent_scheduler_ != nullptr);
+      auto guard = concurrent_scheduler_->get_main_guard();
+      send_closure_later(it->second, &Td::request, request.id, std::move(request.request));
+    }
+    requests_.clear();
+  }
+
+  Response receive_response(TdReceiver &receiver) {
+    auto response = receiver.receive(0);
+    if (response.client_id == 0 && response.request_id == 0 && concurrent_scheduler_ != nullptr) {
+      concurrent_scheduler_->run_main(0);
+      response = receiver.receive(0);
+    } else {
+      ConcurrentScheduler::emscripten_clear_main_timeout();
+    }
+    if (response.request_id == 0 && response.object != nullptr &&
+        response.object->get_id() == td_api::updateAuthorizationState::ID &&
+        static_cast<const td_api::updateAuthorizationState *>(response.object.get())->authorization_state_->get_id() ==
+            td_api::authorizationStateClosed::ID) {
+      CHECK(concurrent_scheduler_ != nullptr);
+      auto guard = concurrent_scheduler_->get_main_guard();
+      auto it = tds_.find(response.client_id);
+      CHECK(it != tds_.end());
+      it->second.reset();
+
+      response.client_id = 0;
+      response.object = nullptr;
+    }
+    if (response.object == nullptr && response.client_id != 0 && response.request_id == 0) {
+      auto it = tds_.find(response.client_id);
+      CHECK(it != tds_.end());
+      CHECK(it->second.empty());
+      tds_.erase(it);
+      own_receivers_.erase(response.client_id);
+
+      response.object = td_api::make_object<td_api::updateAuthorizationState>(
+          td_api::make_object<td_api::authorizationStateClosed>());
+
+      if (tds_.empty()) {
+        CHECK(options_.net_query_stats.use_count() == 1);
+        CHECK(options_.net_query_stats->get_count() == 0);
+        options_.net_query_stats = nullptr;
+        concurrent_scheduler_->finish();
+        concurrent_scheduler_ = nullptr;
+        reset_to_empty(tds_);
+      }
+    }
+    return response;
+  }
 };
 
 class Client::Impl final {
@@ -256,7 +305,13 @@ class MultiTd final : public Actor {
             td_api::object_ptr<td_api::Function> &&request) {
     auto &td = tds_[client_id];
     CHECK(!td.empty());
-    send_closure(td, &Td::request, request_id, std::move(request));
+    send_closure_priority(td, &Td::request, request_id, std::move(request));
+  }
+
+  void send_batch(vector<ClientManager::Request> &&requests) {
+    for (auto &request : requests) {
+      send(request.client_id, request.request_id, std::move(request.function));
+    }
   }
 
   void close(int32 td_id) {
@@ -352,8 +407,8 @@ class MultiImpl {
  public:
   static constexpr int32 ADDITIONAL_THREAD_COUNT = 3;
 
-  explicit MultiImpl(std::shared_ptr<NetQueryStats> net_query_stats) {
-    concurrent_scheduler_ = std::make_shared<ConcurrentScheduler>(ADDITIONAL_THREAD_COUNT, 0);
+  MultiImpl(std::shared_ptr<NetQueryStats> net_query_stats, uint64 thread_affinity_mask) {
+    concurrent_scheduler_ = std::make_shared<ConcurrentScheduler>(ADDITIONAL_THREAD_COUNT, thread_affinity_mask);
     concurrent_scheduler_->start();
 
     {
@@ -364,6 +419,12 @@ class MultiImpl {
     }
 
     scheduler_thread_ = thread([concurrent_scheduler = concurrent_scheduler_] {
+#if TD_HAVE_THREAD_AFFINITY
+      auto main_thread_affinity_mask = concurrent_scheduler->get_thread_affinity_mask(0);
+      if (main_thread_affinity_mask != 0) {
+        thread::set_affinity_mask(this_thread::get_id(), main_thread_affinity_mask).ignore();
+      }
+#endif
       while (concurrent_scheduler->run_main(10)) {
       }
     });
@@ -394,6 +455,11 @@ class MultiImpl {
     send_closure(multi_td_, &MultiTd::send, client_id, request_id, std::move(request));
   }
 
+  void send_batch(vector<ClientManager::Request> &&requests) {
+    auto guard = concurrent_scheduler_->get_send_guard();
+    send_closure(multi_td_, &MultiTd::send_batch, std::move(requests));
+  }
+
   void close(ClientManager::ClientId client_id) {
     auto guard = concurrent_scheduler_->get_send_guard();
     send_closure(multi_td_, &MultiTd::close, client_id);
@@ -439,13 +505,24 @@ class MultiImplPool {
       CHECK(impls_.size() * (1 + MultiImpl::ADDITIONAL_THREAD_COUNT + 1 /* IOCP */) < 128);
 
       net_query_stats_ = std::make_shared<NetQueryStats>();
+
+      // all threads of an instance are placed on the same NUMA node to avoid cross-node traffic between schedulers
+      numa_node_cpu_masks_ = get_numa_node_cpu_masks();
+      if (numa_node_cpu_masks_.size() < 2) {
+        numa_node_cpu_masks_.clear();
+      }
     }
-    auto &impl = *std::min_element(impls_.begin(), impls_.end(),
-                                   [](auto &a, auto &b) { return a.lock().use_count() < b.lock().use_count(); });
-    auto result = impl.lock();
+    auto impl = std::min_element(impls_.begin(), impls_.end(),
+                                 [](auto &a, auto &b) { return a.lock().use_count() < b.lock().use_count(); });
+    auto result = impl->lock();
     if (!result) {
-      result = std::make_shared<MultiImpl>(net_query_stats_);
-      impl = result;
+      uint64 thread_affinity_mask = 0;
+      if (!numa_node_cpu_masks_.empty()) {
+        auto impl_pos = static_cast<size_t>(impl - impls_.begin());
+        thread_affinity_mask = numa_node_cpu_masks_[impl_pos % numa_node_cpu_masks_.size()];
+      }
+      result = std::make_shared<MultiImpl>(net_query_stats_, thread_affinity_mask);
+      *impl = result;
     }
     return result;
   }
@@ -472,6 +549,7 @@ class MultiImplPool {
   std::mutex mutex_;
   std::vector<std::weak_ptr<MultiImpl>> impls_;
   std::shared_ptr<NetQueryStats> net_query_stats_;
+  vector<uint64> numa_node_cpu_masks_;
 };
 
 class ClientManager::Impl final {
@@ -485,6 +563,15 @@ class ClientManager::Impl final {
     return client_id;
   }
 
+  ClientId create_client_id_with_own_queue() {
+    auto client_id = MultiImpl::create_id();
+    {
+      auto lock = impls_mutex_.lock_write().move_as_ok();
+      impls_[client_id].receiver = std::make_shared<TdReceiver>();
+    }
+    return client_id;
+  }
+
   void send(ClientId client_id, RequestId request_id, td_api::object_ptr<td_api::Function> &&request) {
     auto lock = impls_mutex_.lock_read().move_as_ok();
     if (!MultiImpl::is_valid_client_id(client_id)) {
@@ -501,7 +588,7 @@ class ClientManager::Impl final {
       it = impls_.find(client_id);
       if (it != impls_.end() && it->second.impl == nullptr) {
         it->second.impl = pool_.get();
-        it->second.impl->create(client_id, receiver_.create_callback(client_id));
+        it->second.impl->create(client_id, get_receiver(it->second).create_callback(client_id));
       }
       write_lock.reset();
 
@@ -509,14 +596,64 @@ class ClientManager::Impl final {
       it = impls_.find(client_id);
     }
     if (it == impls_.end() || it->second.is_closed) {
-      receiver_.add_response(client_id, request_id, td_api::make_object<td_api::error>(500, "Request aborted"));
+      auto &receiver = it == impls_.end() ? receiver_ : get_receiver(it->second);
+      receiver.add_response(client_id, request_id, td_api::make_object<td_api::error>(500, "Request aborted"));
       return;
     }
     it->second.impl->send(client_id, request_id, std::move(request));
   }
 
+  void send_batch(vector<Request> &&requests) {
+    // requests to TDLib instances, which haven't been created yet, are sent through send
+    auto lock = impls_mutex_.lock_read().move_as_ok();
+    MultiImpl *batch_impl = nullptr;
+    vector<Request> batch;
+    auto flush_batch = [&] {
+      if (!batch.empty()) {
+        batch_impl->send_batch(std::move(batch));
+        batch.clear();
+      }
+    };
+    for (auto &request : requests) {
+      auto it = impls_.find(request.client_id);
+      if (!MultiImpl::is_valid_client_id(request.client_id) || it == impls_.end() || it->second.impl == nullptr ||
+          it->second.is_closed) {
+        flush_batch();
+        lock.reset();
+        send(request.client_id, request.request_id, std::move(request.function));
+        lock = impls_mutex_.lock_read().move_as_ok();
+        batch_impl = nullptr;
+        continue;
+      }
+      if (it->second.impl.get() != batch_impl) {
+        flush_batch();
+        batch_impl = it->second.impl.get();
+      }
+      batch.push_back(std::move(request));
+    }
+    flush_batch();
+  }
+
   Response receive(double timeout) {
-    auto response = receiver_.receive(timeout, true);
+    return process_response(receiver_.receive(timeout, true));
+  }
+
+  Response receive(ClientId client_id, double timeout) {
+    std::shared_ptr<TdReceiver> receiver;
+    {
+      auto lock = impls_mutex_.lock_read().move_as_ok();
+      auto it = impls_.find(client_id);
+      if (it != impls_.end()) {
+        receiver = it->second.receiver;
+      }
+    }
+    if (receiver == nullptr) {
+      return {0, 0, nullptr};
+    }
+    return process_response(receiver->receive(timeout, true));
+  }
+
+  Response process_response(Response response) {
     if (response.request_id == 0 && response.object != nullptr &&
         response.object->get_id() == td_api::updateAuthorizationState::ID &&
         static_cast<const td_api::updateAuthorizationState *>(response.object.get())->authorization_state_->get_id() ==
@@ -551,7 +688,7 @@ class ClientManager::Impl final {
     if (!it->second.is_closed) {
       it->second.is_closed = true;
       if (it->second.impl == nullptr) {
-        receiver_.add_response(client_id, 0, nullptr);
+        get_receiver(it->second).add_response(client_id, 0, nullptr);
       } else {
         it->second.impl->close(client_id);
       }
@@ -567,8 +704,17 @@ class ClientManager::Impl final {
     if (ExitGuard::is_exited()) {
       return;
     }
+    vector<ClientId> own_queue_client_ids;
     for (auto &it : impls_) {
       close_impl(it.first);
+      if (it.second.receiver != nullptr) {
+        own_queue_client_ids.push_back(it.first);
+      }
+    }
+    for (auto client_id : own_queue_client_ids) {
+      while (impls_.count(client_id) != 0 && !ExitGuard::is_exited()) {
+        receive(client_id, 0.1);
+      }
     }
     while (!impls_.empty() && !ExitGuard::is_exited()) {
       receive(0.1);
@@ -577,13 +723,21 @@ class ClientManager::Impl final {
 
  private:
   MultiImplPool pool_;
-  RwMutex impls_mutex_;
+  RwMutex impls_mutex_{"ClientManager impls"};
   struct MultiImplInfo {
     std::shared_ptr<MultiImpl> impl;
+    std::shared_ptr<TdReceiver> receiver;  // non-null if the client has its own response queue
     bool is_closed = false;
   };
   FlatHashMap<ClientId, MultiImplInfo> impls_;
   TdReceiver receiver_;
+
+  TdReceiver &get_receiver(MultiImplInfo &info) {
+    if (info.receiver == nullptr) {
+      return receiver_;
+    }
+    return *info.receiver;
+  }
 };
 
 class Client::Impl final {
@@ -664,14 +818,38 @@ ClientManager::ClientId ClientManager::create_client_id() {
   return impl_->create_client_id();
 }
 
+ClientManager::ClientId ClientManager::create_client_id_with_own_queue() {
+  return impl_->create_client_id_with_own_queue();
+}
+
 void ClientManager::send(ClientId client_id, RequestId request_id, td_api::object_ptr<td_api::Function> &&request) {
   impl_->send(client_id, request_id, std::move(request));
 }
 
+void ClientManager::send_batch(std::vector<Request> &&requests) {
+  impl_->send_batch(std::move(requests));
+}
+
 ClientManager::Response ClientManager::receive(double timeout) {
   return impl_->receive(timeout);
 }
 
+ClientManager::Response ClientManager::receive(ClientId client_id, double timeout) {
+  return impl_->receive(client_id, timeout);
+}
+
+std::vector<ClientManager::Response> ClientManager::receive_batch(std::size_t max_count, double timeout) {
+  std::vector<Response> responses;
+  while (responses.size() < max_count) {
+    auto response = impl_->receive(responses.empty() ? timeout : 0.0);
+    if (response.object == nullptr) {
+      break;
+    }
+    responses.push_back(std::move(response));
+  }
+  return responses;
+}
+
 td_api::object_ptr<td_api::Object> ClientManager::execute(td_api::object_ptr<td_api::Function> &&request) {
   return Td::static_request(std::move(request));
 }
@@ -11,8 +11,10 @@
 #include "td/telegram/td_api.h"
 #include "td/telegram/td_api.hpp"
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace td {
 
@@ -27,6 +29,12 @@ namespace td {
  * they were received, to ensure consistency.
  * Some TDLib requests can be executed synchronously from any thread using the method ClientManager::execute.
  *
+ * If updates and responses of different client instances need to be processed in parallel, the client instances can be
+ * created through the method ClientManager::create_client_id_with_own_queue. Updates and responses for such instances
+ * aren't returned by ClientManager::receive(double) and must be received using the method
+ * ClientManager::receive(ClientId, double), which can be called simultaneously from different threads for different
+ * client instances.
+ *
  * General pattern of usage:
  * \code
  * td::ClientManager manager;
@@ -78,6 +86,14 @@ class ClientManager final {
    */
   ClientId create_client_id();
 
+  /**
+   * Returns an opaque identifier of a new TDLib instance, which has its own queue of updates and responses to requests.
+   * Updates and responses to requests for the instance can be received only using the method receive(client_id, timeout).
+   * The TDLib instance will not send updates until the first request is sent to it.
+   * \return Opaque identifier of a new TDLib instance.
+   */
+  ClientId create_client_id_with_own_queue();
+
   /**
    * Sends request to TDLib. May be called from any thread.
    * \param[in] client_id TDLib client instance identifier.
@@ -86,6 +102,33 @@ class ClientManager final {
    */
   void send(ClientId client_id, RequestId request_id, td_api::object_ptr<td_api::Function> &&request);
 
+  /**
+   * A request to TDLib.
+   */
+  struct Request {
+    /**
+     * TDLib client instance identifier, to which the request is sent.
+     */
+    ClientId client_id;
+
+    /**
+     * Request identifier. Must be non-zero.
+     */
+    RequestId request_id;
+
+    /**
+     * TDLib API function representing a request to TDLib.
+     */
+    td_api::object_ptr<td_api::Function> function;
+  };
+
+  /**
+   * Sends a number of requests to TDLib at once. May be called from any thread.
+   * Requests to the same client instance are handled in the order they are specified.
+   * \param[in] requests Requests to TDLib.
+   */
+  void send_batch(std::vector<Request> &&requests);
+
   /**
    * A response to a request, or an incoming update from TDLib.
    */
@@ -115,6 +158,28 @@ class ClientManager final {
    */
   Response receive(double timeout);
 
+  /**
+   * Receives incoming updates and responses to requests from a TDLib instance created with
+   * create_client_id_with_own_queue. May be called from any thread, but must not be called simultaneously from two
+   * different threads for the same client. Returns immediately if the client has no own queue or was already closed.
+   * \param[in] client_id TDLib client instance identifier.
+   * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+   * \return An incoming update or response to a request. The object returned in the response may be a nullptr
+   *         if the timeout expires.
+   */
+  Response receive(ClientId client_id, double timeout);
+
+  /**
+   * Receives a number of incoming updates and responses to requests from TDLib at once. May be called from any thread,
+   * but must not be called simultaneously from two different threads, or simultaneously with receive(timeout).
+   * The function waits only for the first update or response; all other already available ones are returned immediately.
+   * \param[in] max_count The maximum number of updates and responses to return.
+   * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+   * \return Incoming updates and responses to requests in the order they were received. May be empty
+   *         if the timeout expires.
+   */
+  std::vector<Response> receive_batch(std::size_t max_count, double timeout);
+
   /**
    * Synchronously executes a TDLib request.
    * A request can be executed synchronously, only if it is documented with "Can be called synchronously".
@@ -0,0 +1,100 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/ClientBinary.h"
+
+#include "td/telegram/Client.h"
+#include "td/telegram/td_api.h"
+
+#include "td/utils/ExitGuard.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/tl_storers.h"
+
+#include <utility>
+
+namespace td {
+
+// the binary interface uses its own ClientManager, so its client identifiers are independent of the JSON interface
+static ClientManager *get_manager() {
+  static ClientManager client_manager;
+  static ExitGuard exit_guard;
+  return &client_manager;
+}
+
+static td_api::object_ptr<td_api::Function> to_request(Slice request) {
+  TlParser parser(request);
+  auto function = td_api::Function::fetch(parser);
+  parser.fetch_end();
+  const char *error = parser.get_error();
+  if (error != nullptr) {
+    auto error_object = td_api::make_object<td_api::error>(
+        400, PSTRING() << "Failed to parse request as TDLib request: " << error << " at " << parser.get_error_pos());
+    return td_api::make_object<td_api::testReturnError>(std::move(error_object));
+  }
+  return function;
+}
+
+// the returned responses are serialized directly into the buffer, which is reused for all responses in the thread
+static TD_THREAD_LOCAL string *current_output;
+
+static Slice store_response(const td_api::Object &object) {
+  init_thread_local<string>(current_output);
+  auto &output = *current_output;
+
+  TlStorerCalcLength calc_length;
+  calc_length.store_binary(object.get_id());
+  object.store(calc_length);
+  auto length = calc_length.get_length();
+  if (output.size() < length) {
+    output.resize(max(length, static_cast<size_t>(1 << 18)));
+  }
+
+  TlStorerUnsafe storer(MutableSlice(output).ubegin());
+  storer.store_binary(object.get_id());
+  object.store(storer);
+  CHECK(storer.get_buf() == MutableSlice(output).ubegin() + length);
+  return Slice(output.data(), length);
+}
+
+int binary_create_client_id() {
+  return static_cast<int>(get_manager()->create_client_id());
+}
+
+int binary_create_client_id_with_own_queue() {
+  return static_cast<int>(get_manager()->create_client_id_with_own_queue());
+}
+
+void binary_send(int client_id, uint64 request_id, Slice request) {
+  get_manager()->send(client_id, request_id, to_request(request));
+}
+
+Slice binary_receive(double timeout, int &client_id, uint64 &request_id) {
+  auto response = get_manager()->receive(timeout);
+  if (!response.object) {
+    return Slice();
+  }
+  client_id = response.client_id;
+  request_id = response.request_id;
+  return store_response(*response.object);
+}
+
+Slice binary_receive_for_client(int client_id, double timeout, uint64 &request_id) {
+  auto response = get_manager()->receive(client_id, timeout);
+  if (!response.object) {
+    return Slice();
+  }
+  request_id = response.request_id;
+  return store_response(*response.object);
+}
+
+Slice binary_execute(Slice request) {
+  auto response = ClientManager::execute(to_request(request));
+  return store_response(*response);
+}
+
+}  // namespace td
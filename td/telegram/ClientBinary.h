@@ -0,0 +1,27 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+namespace td {
+
+int binary_create_client_id();
+
+int binary_create_client_id_with_own_queue();
+
+void binary_send(int client_id, uint64 request_id, Slice request);
+
+// returns an empty slice if the timeout expires
+Slice binary_receive(double timeout, int &client_id, uint64 &request_id);
+
+Slice binary_receive_for_client(int client_id, double timeout, uint64 &request_id);
+
+Slice binary_execute(Slice request);
+
+}  // namespace td
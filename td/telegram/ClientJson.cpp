@@ -12,11 +12,12 @@
 #include "td/utils/common.h"
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/JsonBuilder.h"
+#include "td/utils/port/Mutex.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/SliceBuilder.h"
-#include "td/utils/StackAllocator.h"
 #include "td/utils/StringBuilder.h"
 
+#include <cstring>
 #include <utility>
 
 namespace td {
@@ -26,15 +27,7 @@ static td_api::object_ptr<td_api::Function> get_return_error_function(Slice erro
   return td_api::make_object<td_api::testReturnError>(std::move(error));
 }
 
-static std::pair<td_api::object_ptr<td_api::Function>, string> to_request(Slice request) {
-  auto request_str = request.str();
-  auto r_json_value = json_decode(request_str);
-  if (r_json_value.is_error()) {
-    return {get_return_error_function(PSLICE()
-                                      << "Failed to parse request as JSON object: " << r_json_value.error().message()),
-            string()};
-  }
-  auto json_value = r_json_value.move_as_ok();
+static std::pair<td_api::object_ptr<td_api::Function>, string> to_request(JsonValue json_value) {
   if (json_value.type() != JsonValue::Type::Object) {
     return {get_return_error_function("Expected a JSON object"), string()};
   }
@@ -54,9 +47,18 @@ static std::pair<td_api::object_ptr<td_api::Function>, string> to_request(Slice
   return std::make_pair(std::move(func), std::move(extra));
 }
 
-static string from_response(const td_api::Object &object, const string &extra, int client_id) {
-  auto buf = StackAllocator::alloc(1 << 18);
-  JsonBuilder jb(StringBuilder(buf.as_slice(), true), -1);
+static std::pair<td_api::object_ptr<td_api::Function>, string> to_request(Slice request) {
+  auto request_str = request.str();
+  auto r_json_value = json_decode(request_str);
+  if (r_json_value.is_error()) {
+    return {get_return_error_function(PSLICE()
+                                      << "Failed to parse request as JSON object: " << r_json_value.error().message()),
+            string()};
+  }
+  return to_request(r_json_value.move_as_ok());
+}
+
+static void append_response(JsonBuilder &jb, const td_api::Object &object, const string &extra, int client_id) {
   jb.enter_value() << ToJson(object);
   auto &sb = jb.string_builder();
   auto slice = sb.as_cslice();
@@ -69,15 +71,28 @@ static string from_response(const td_api::Object &object, const string &extra, i
     sb << ",\"@client_id\":" << client_id;
   }
   sb << '}';
-  return sb.as_cslice().str();
 }
 
+// the returned strings are serialized directly into the buffer, which is reused for all responses in the thread
 static TD_THREAD_LOCAL string *current_output;
 
-static const char *store_string(string str) {
+template <class F>
+static const char *store_json(F &&f) {
   init_thread_local<string>(current_output);
-  *current_output = std::move(str);
-  return current_output->c_str();
+  auto &output = *current_output;
+  if (output.size() < (1 << 18)) {
+    output.resize(1 << 18);
+  }
+  JsonBuilder jb(StringBuilder(MutableSlice(output), true), -1);
+  f(jb);
+  auto result = jb.string_builder().as_cslice();
+  if (result.begin() != output.data()) {
+    // the result didn't fit in the buffer, so increase the buffer for subsequent responses
+    string new_output(result.size() * 2, '\0');
+    std::memcpy(&new_output[0], result.begin(), result.size() + 1);
+    output = std::move(new_output);
+  }
+  return output.c_str();
 }
 
 void ClientJson::send(Slice request) {
@@ -105,20 +120,20 @@ const char *ClientJson::receive(double timeout) {
       extra_.erase(it);
     }
   }
-  return store_string(from_response(*response.object, extra, 0));
+  return store_json([&](JsonBuilder &jb) { append_response(jb, *response.object, extra, 0); });
 }
 
 const char *ClientJson::execute(Slice request) {
   auto parsed_request = to_request(request);
-  return store_string(from_response(*Client::execute(Client::Request{0, std::move(parsed_request.first)}).object,
-                                    parsed_request.second, 0));
+  auto response = Client::execute(Client::Request{0, std::move(parsed_request.first)});
+  return store_json([&](JsonBuilder &jb) { append_response(jb, *response.object, parsed_request.second, 0); });
 }
 
 static ClientManager *get_manager() {
   return ClientManager::get_manager_singleton();
 }
 
-static std::mutex extra_mutex;
+static Mutex extra_mutex("ClientJson extra");
 static FlatHashMap<int64, string> extra;
 static std::atomic<uint64> extra_id{1};
 
@@ -126,38 +141,94 @@ int json_create_client_id() {
   return static_cast<int>(get_manager()->create_client_id());
 }
 
-void json_send(int client_id, Slice request) {
-  auto parsed_request = to_request(request);
+int json_create_client_id_with_own_queue() {
+  return static_cast<int>(get_manager()->create_client_id_with_own_queue());
+}
+
+static ClientManager::Request to_manager_request(int client_id,
+                                                 std::pair<td_api::object_ptr<td_api::Function>, string> parsed_request) {
   auto request_id = extra_id.fetch_add(1, std::memory_order_relaxed);
   if (!parsed_request.second.empty()) {
-    std::lock_guard<std::mutex> guard(extra_mutex);
+    auto guard = extra_mutex.lock();
     extra[request_id] = std::move(parsed_request.second);
   }
-  get_manager()->send(client_id, request_id, std::move(parsed_request.first));
+  return {client_id, request_id, std::move(parsed_request.first)};
 }
 
-const char *json_receive(double timeout) {
-  auto response = get_manager()->receive(timeout);
-  if (!response.object) {
-    return nullptr;
+void json_send(int client_id, Slice request) {
+  auto manager_request = to_manager_request(client_id, to_request(request));
+  get_manager()->send(client_id, manager_request.request_id, std::move(manager_request.function));
+}
+
+void json_send_batch(int client_id, Slice requests) {
+  vector<ClientManager::Request> manager_requests;
+  auto requests_str = requests.str();
+  auto r_json_value = json_decode(requests_str);
+  if (r_json_value.is_error()) {
+    manager_requests.push_back(to_manager_request(
+        client_id, {get_return_error_function(PSLICE() << "Failed to parse requests as JSON array: "
+                                                       << r_json_value.error().message()),
+                    string()}));
+  } else if (r_json_value.ok().type() != JsonValue::Type::Array) {
+    manager_requests.push_back(
+        to_manager_request(client_id, {get_return_error_function("Expected a JSON array"), string()}));
+  } else {
+    auto &json_requests = r_json_value.ok_ref().get_array();
+    manager_requests.reserve(json_requests.size());
+    for (auto &json_request : json_requests) {
+      manager_requests.push_back(to_manager_request(client_id, to_request(std::move(json_request))));
+    }
   }
+  get_manager()->send_batch(std::move(manager_requests));
+}
 
+static void append_manager_response(JsonBuilder &jb, const ClientManager::Response &response) {
   string extra_str;
   if (response.request_id != 0) {
-    std::lock_guard<std::mutex> guard(extra_mutex);
+    auto guard = extra_mutex.lock();
     auto it = extra.find(response.request_id);
     if (it != extra.end()) {
       extra_str = std::move(it->second);
       extra.erase(it);
     }
   }
-  return store_string(from_response(*response.object, extra_str, response.client_id));
+  append_response(jb, *response.object, extra_str, response.client_id);
+}
+
+static const char *json_process_response(ClientManager::Response response) {
+  if (!response.object) {
+    return nullptr;
+  }
+  return store_json([&](JsonBuilder &jb) { append_manager_response(jb, response); });
+}
+
+const char *json_receive(double timeout) {
+  return json_process_response(get_manager()->receive(timeout));
+}
+
+const char *json_receive_for_client(int client_id, double timeout) {
+  return json_process_response(get_manager()->receive(client_id, timeout));
+}
+
+const char *json_receive_batch(int max_count, double timeout) {
+  auto responses = get_manager()->receive_batch(static_cast<size_t>(max(max_count, 1)), timeout);
+  return store_json([&](JsonBuilder &jb) {
+    auto &sb = jb.string_builder();
+    sb << '[';
+    for (size_t i = 0; i < responses.size(); i++) {
+      if (i != 0) {
+        sb << ',';
+      }
+      append_manager_response(jb, responses[i]);
+    }
+    sb << ']';
+  });
 }
 
 const char *json_execute(Slice request) {
   auto parsed_request = to_request(request);
-  return store_string(
-      from_response(*ClientManager::execute(std::move(parsed_request.first)), parsed_request.second, 0));
+  auto response = ClientManager::execute(std::move(parsed_request.first));
+  return store_json([&](JsonBuilder &jb) { append_response(jb, *response, parsed_request.second, 0); });
 }
 
 }  // namespace td
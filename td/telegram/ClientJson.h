@@ -36,10 +36,18 @@ class ClientJson final {
 
 int json_create_client_id();
 
+int json_create_client_id_with_own_queue();
+
 void json_send(int client_id, Slice request);
 
+void json_send_batch(int client_id, Slice requests);
+
 const char *json_receive(double timeout);
 
+const char *json_receive_for_client(int client_id, double timeout);
+
+const char *json_receive_batch(int max_count, double timeout);
+
 const char *json_execute(Slice request);
 
 }  // namespace td
@@ -65,7 +65,9 @@
 #include "td/utils/UInt.h"
 
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <utility>
 
 namespace td {
@@ -426,6 +428,9 @@ static ActorOwn<> get_full_config(DcOption option, Promise<tl_object_ptr<telegra
     void on_result(NetQueryPtr net_query) final {
       G()->net_query_dispatcher().dispatch(std::move(net_query));
     }
+    void on_inflight_query_limit_updated(size_t inflight_query_limit) final {
+      // nop
+    }
 
    private:
     ActorShared<> parent_;
@@ -489,8 +494,7 @@ static ActorOwn<> get_full_config(DcOption option, Promise<tl_object_ptr<telegra
 
    private:
     DcId dc_id_;
-    std::shared_ptr<PublicRsaKeyShared> public_rsa_key_ =
-        std::make_shared<PublicRsaKeyShared>(DcId::empty(), G()->is_test_dc());
+    std::shared_ptr<PublicRsaKeyShared> public_rsa_key_ = PublicRsaKeyShared::get_common(G()->is_test_dc());
 
     std::vector<unique_ptr<Listener>> auth_key_listeners_;
     void notify() {
@@ -564,6 +568,106 @@ static ActorOwn<> get_full_config(DcOption option, Promise<tl_object_ptr<telegra
       create_actor<GetConfigActor>("GetConfigActor", std::move(option), std::move(promise), std::move(parent)));
 }
 
+// process-wide storage of configs, which can be shared between clients with the same API identifier and environment
+class SharedConfigStorage {
+ public:
+  using Key = std::pair<int32, bool>;
+
+  // DC options from a simple config together with phone number prefix rules for them
+  using SimpleConfigRules = vector<std::pair<string, vector<DcOption>>>;
+
+  static SharedConfigStorage &instance() {
+    static SharedConfigStorage storage;
+    return storage;
+  }
+
+  static Key get_key() {
+    return {G()->parameters().api_id, G()->is_test_dc()};
+  }
+
+  uint64 subscribe(Key key, ActorId<ConfigManager> config_manager) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto subscriber_id = ++max_subscriber_id_;
+    entries_[key].subscribers.emplace_back(subscriber_id, std::move(config_manager));
+    return subscriber_id;
+  }
+
+  void unsubscribe(Key key, uint64 subscriber_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &subscribers = entries_[key].subscribers;
+    td::remove_if(subscribers, [subscriber_id](const auto &subscriber) { return subscriber.first == subscriber_id; });
+  }
+
+  void set_config(Key key, uint64 source_subscriber_id, int32 dc_id, BufferSlice config, double expires_at) {
+    vector<std::pair<uint64, ActorId<ConfigManager>>> subscribers;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto &entry = entries_[key];
+      entry.config = config.clone();
+      entry.config_dc_id = dc_id;
+      entry.config_expires_at = expires_at;
+      subscribers = entry.subscribers;
+    }
+    for (auto &subscriber : subscribers) {
+      if (subscriber.first != source_subscriber_id) {
+        send_closure(subscriber.second, &ConfigManager::on_shared_config, config.clone());
+      }
+    }
+  }
+
+  BufferSlice get_config(Key key, int32 dc_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.config.empty() || it->second.config_dc_id != dc_id ||
+        it->second.config_expires_at < Time::now()) {
+      return BufferSlice();
+    }
+    return it->second.config.clone();
+  }
+
+  void set_simple_config(Key key, SimpleConfigRules simple_config, double expires_at) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &entry = entries_[key];
+    entry.simple_config = std::move(simple_config);
+    entry.simple_config_expires_at = expires_at;
+  }
+
+  bool get_simple_config(Key key, SimpleConfigRules &simple_config) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.simple_config_expires_at < Time::now()) {
+      return false;
+    }
+    simple_config = it->second.simple_config;
+    return true;
+  }
+
+ private:
+  struct Entry {
+    vector<std::pair<uint64, ActorId<ConfigManager>>> subscribers;
+
+    BufferSlice config;
+    int32 config_dc_id = 0;
+    double config_expires_at = 0;
+
+    SimpleConfigRules simple_config;
+    double simple_config_expires_at = 0;
+  };
+
+  std::mutex mutex_;
+  std::map<Key, Entry> entries_;
+  uint64 max_subscriber_id_ = 0;
+};
+
+static telegram_api::object_ptr<telegram_api::config> parse_shared_config(const BufferSlice &data) {
+  auto r_config = fetch_result<telegram_api::help_getConfig>(data);
+  if (r_config.is_error()) {
+    LOG(ERROR) << "Failed to parse shared config: " << r_config.error();
+    return nullptr;
+  }
+  return r_config.move_as_ok();
+}
+
 class ConfigRecoverer final : public Actor {
  public:
   explicit ConfigRecoverer(ActorShared<> parent) : parent_(std::move(parent)) {
@@ -655,35 +759,50 @@ class ConfigRecoverer final : public Actor {
     loop();
   }
 
+  bool try_use_shared_simple_config() {
+    if (!G()->get_option_boolean("use_shared_config")) {
+      return false;
+    }
+    SharedConfigStorage::SimpleConfigRules rules;
+    if (!SharedConfigStorage::instance().get_simple_config(SharedConfigStorage::get_key(), rules)) {
+      return false;
+    }
+    VLOG(config_recoverer) << "Use shared SimpleConfig";
+    apply_simple_config_rules(rules);
+    on_simple_config_updated();
+    update_dc_options();
+    return true;
+  }
+
   void do_on_simple_config(Result<SimpleConfig> r_simple_config) {
     if (r_simple_config.is_ok()) {
       auto config = r_simple_config.move_as_ok();
       VLOG(config_recoverer) << "Receive raw " << to_string(config);
       if (config->expires_ >= G()->unix_time()) {
-        string phone_number = G()->get_option_string("my_phone_number");
-        simple_config_.dc_options.clear();
-
+        SharedConfigStorage::SimpleConfigRules rules;
         for (auto &rule : config->rules_) {
-          if (check_phone_number_rules(phone_number, rule->phone_prefix_rules_) && DcId::is_valid(rule->dc_id_)) {
+          if (DcId::is_valid(rule->dc_id_)) {
             DcId dc_id = DcId::internal(rule->dc_id_);
+            vector<DcOption> dc_options;
             for (auto &ip_port : rule->ips_) {
               DcOption option(dc_id, *ip_port);
               if (option.is_valid()) {
-                simple_config_.dc_options.push_back(std::move(option));
+                dc_options.push_back(std::move(option));
               }
             }
+            rules.emplace_back(std::move(rule->phone_prefix_rules_), std::move(dc_options));
           }
         }
-        VLOG(config_recoverer) << "Receive SimpleConfig " << simple_config_;
+        apply_simple_config_rules(rules);
+        if (G()->get_option_boolean("use_shared_config")) {
+          SharedConfigStorage::instance().set_simple_config(SharedConfigStorage::get_key(), std::move(rules),
+                                                            get_config_expire_time());
+        }
       } else {
         VLOG(config_recoverer) << "Config has expired at " << config->expires_;
       }
 
-      simple_config_expires_at_ = get_config_expire_time();
-      simple_config_at_ = Time::now_cached();
-      for (size_t i = 1; i < simple_config_.dc_options.size(); i++) {
-        std::swap(simple_config_.dc_options[i], simple_config_.dc_options[Random::fast(0, static_cast<int>(i))]);
-      }
+      on_simple_config_updated();
     } else {
       VLOG(config_recoverer) << "Get SimpleConfig error " << r_simple_config.error();
       simple_config_ = DcOptions();
@@ -691,6 +810,25 @@ class ConfigRecoverer final : public Actor {
     }
   }
 
+  void apply_simple_config_rules(const SharedConfigStorage::SimpleConfigRules &rules) {
+    string phone_number = G()->get_option_string("my_phone_number");
+    simple_config_.dc_options.clear();
+    for (auto &rule : rules) {
+      if (check_phone_number_rules(phone_number, rule.first)) {
+        append(simple_config_.dc_options, rule.second);
+      }
+    }
+    VLOG(config_recoverer) << "Receive SimpleConfig " << simple_config_;
+  }
+
+  void on_simple_config_updated() {
+    simple_config_expires_at_ = get_config_expire_time();
+    simple_config_at_ = Time::now_cached();
+    for (size_t i = 1; i < simple_config_.dc_options.size(); i++) {
+      std::swap(simple_config_.dc_options[i], simple_config_.dc_options[Random::fast(0, static_cast<int>(i))]);
+    }
+  }
+
   void on_full_config(Result<tl_object_ptr<telegram_api::config>> r_full_config, bool dummy) {
     full_config_query_.reset();
     if (r_full_config.is_ok()) {
@@ -809,6 +947,10 @@ class ConfigRecoverer final : public Actor {
       update_dc_options();
     }
     bool need_simple_config = has_connecting_problem && !is_valid_simple_config && simple_config_query_.empty();
+    if (need_simple_config && try_use_shared_simple_config()) {
+      need_simple_config = false;
+      wakeup_timestamp.relax(Timestamp::at(simple_config_expires_at_));
+    }
     bool has_dc_options = !dc_options_.dc_options.empty();
     bool is_valid_full_config = !check_timeout(Timestamp::at(full_config_expires_at_));
     bool need_full_config = has_connecting_problem && has_dc_options && !is_valid_full_config &&
@@ -841,7 +983,7 @@ class ConfigRecoverer final : public Actor {
             return get_simple_config_mozilla_dns;
         }
       }();
-      simple_config_query_ = get_simple_config(std::move(promise), G()->get_option_boolean("prefer_ipv6"),
+      simple_config_query_ = get_simple_config(std::move(promise), G()->get_option_boolean(OptionId::PreferIpv6),
                                                G()->get_option_string("dc_txt_domain_name"), G()->is_test_dc(),
                                                G()->get_gc_scheduler_id());
       simple_config_turn_++;
@@ -938,6 +1080,7 @@ ConfigManager::ConfigManager(ActorShared<> parent) : parent_(std::move(parent))
 void ConfigManager::start_up() {
   config_recoverer_ = create_actor<ConfigRecoverer>("Recoverer", create_reference());
   send_closure(config_recoverer_, &ConfigRecoverer::on_dc_options_update, load_dc_options_update());
+  on_use_shared_config_changed();
 
   auto expire_time = load_config_expire_time();
   if (expire_time.is_in_past() || true) {
@@ -963,6 +1106,10 @@ void ConfigManager::hangup_shared() {
 void ConfigManager::hangup() {
   ref_cnt_--;
   config_recoverer_.reset();
+  if (shared_config_subscriber_id_ != 0) {
+    SharedConfigStorage::instance().unsubscribe(SharedConfigStorage::get_key(), shared_config_subscriber_id_);
+    shared_config_subscriber_id_ = 0;
+  }
   try_stop();
 }
 
@@ -988,6 +1135,10 @@ void ConfigManager::request_config(bool reopen_sessions) {
     return;
   }
 
+  if (!reopen_sessions && try_use_shared_config()) {
+    return;
+  }
+
   lazy_request_flood_control_.add_event(Time::now());
   request_config_from_dc_impl(DcId::main(), reopen_sessions);
 }
@@ -1128,6 +1279,67 @@ void ConfigManager::on_dc_options_update(DcOptions dc_options) {
   send_closure(config_recoverer_, &ConfigRecoverer::on_dc_options_update, std::move(dc_options));
 }
 
+void ConfigManager::on_use_shared_config_changed() {
+  bool use_shared_config = G()->get_option_boolean("use_shared_config");
+  if (use_shared_config == (shared_config_subscriber_id_ != 0)) {
+    return;
+  }
+  if (use_shared_config) {
+    shared_config_subscriber_id_ =
+        SharedConfigStorage::instance().subscribe(SharedConfigStorage::get_key(), actor_id(this));
+  } else {
+    SharedConfigStorage::instance().unsubscribe(SharedConfigStorage::get_key(), shared_config_subscriber_id_);
+    shared_config_subscriber_id_ = 0;
+  }
+}
+
+void ConfigManager::on_shared_config(BufferSlice config) {
+  if (G()->close_flag() || shared_config_subscriber_id_ == 0) {
+    return;
+  }
+
+  auto shared_config = parse_shared_config(config);
+  if (shared_config == nullptr ||
+      shared_config->this_dc_ != G()->net_query_dispatcher().get_main_dc_id().get_value()) {
+    return;
+  }
+  LOG(INFO) << "Receive shared config";
+  on_dc_options_update(DcOptions());
+  process_config(std::move(shared_config), true);
+}
+
+bool ConfigManager::try_use_shared_config() {
+  if (shared_config_subscriber_id_ == 0) {
+    return false;
+  }
+
+  auto main_dc_id = G()->net_query_dispatcher().get_main_dc_id().get_value();
+  auto data = SharedConfigStorage::instance().get_config(SharedConfigStorage::get_key(), main_dc_id);
+  if (data.empty()) {
+    return false;
+  }
+  auto config = parse_shared_config(data);
+  if (config == nullptr) {
+    return false;
+  }
+  LOG(INFO) << "Use shared config";
+  on_dc_options_update(DcOptions());
+  process_config(std::move(config), true);
+  return true;
+}
+
+void ConfigManager::publish_shared_config(const telegram_api::config &config, BufferSlice config_data) {
+  if (shared_config_subscriber_id_ == 0 ||
+      config.this_dc_ != G()->net_query_dispatcher().get_main_dc_id().get_value()) {
+    return;
+  }
+
+  auto reload_in = clamp(config.expires_ - config.date_, 60, 86400);
+  SharedConfigStorage::instance().set_config(SharedConfigStorage::get_key(), shared_config_subscriber_id_,
+                                             config.this_dc_, std::move(config_data),
+                                             Time::now() + reload_in - reload_in / 5);
+}
+
 void ConfigManager::request_config_from_dc_impl(DcId dc_id, bool reopen_sessions) {
   config_sent_cnt_++;
   reopen_sessions_after_get_config_ |= reopen_sessions;
@@ -1247,7 +1459,7 @@ void ConfigManager::on_result(NetQueryPtr res) {
     if (result_ptr.is_error()) {
       fail_promises(set_content_settings_queries_[ignore_sensitive_content_restrictions], result_ptr.move_as_error());
     } else {
-      if (G()->get_option_boolean("can_ignore_sensitive_content_restrictions") &&
+      if (G()->get_option_boolean(OptionId::CanIgnoreSensitiveContentRestrictions) &&
           last_set_content_settings_ == ignore_sensitive_content_restrictions) {
         do_set_ignore_sensitive_content_restrictions(ignore_sensitive_content_restrictions);
       }
@@ -1320,6 +1532,10 @@ void ConfigManager::on_result(NetQueryPtr res) {
   CHECK(token == 8 || token == 9);
   CHECK(config_sent_cnt_ > 0);
   config_sent_cnt_--;
+  BufferSlice config_data;
+  if (shared_config_subscriber_id_ != 0 && res->is_ok()) {
+    config_data = res->ok().clone();
+  }
   auto r_config = fetch_result<telegram_api::help_getConfig>(std::move(res));
   if (r_config.is_error()) {
     if (!G()->close_flag()) {
@@ -1329,8 +1545,12 @@ void ConfigManager::on_result(NetQueryPtr res) {
     }
     fail_promises(reget_config_queries_, r_config.move_as_error());
   } else {
+    auto config = r_config.move_as_ok();
+    if (!config_data.empty()) {
+      publish_shared_config(*config, std::move(config_data));
+    }
     on_dc_options_update(DcOptions());
-    process_config(r_config.move_as_ok());
+    process_config(std::move(config), false);
     if (token == 9) {
       G()->net_query_dispatcher().update_mtproto_header();
     }
@@ -1369,7 +1589,7 @@ void ConfigManager::save_config_expire(Timestamp timestamp) {
   G()->td_db()->get_binlog_pmc()->set("config_expire", to_string(static_cast<int>(Clocks::system() + timestamp.in())));
 }
 
-void ConfigManager::process_config(tl_object_ptr<telegram_api::config> config) {
+void ConfigManager::process_config(tl_object_ptr<telegram_api::config> config, bool is_shared) {
   bool is_from_main_dc = G()->net_query_dispatcher().get_main_dc_id().get_value() == config->this_dc_;
 
   LOG(INFO) << to_string(config);
@@ -1391,7 +1611,9 @@ void ConfigManager::process_config(tl_object_ptr<telegram_api::config> config) {
   options.set_option_integer("recent_stickers_limit", config->stickers_recent_limit_);
   options.set_option_integer("channels_read_media_period", config->channels_read_media_period_);
 
-  send_closure(G()->link_manager(), &LinkManager::update_autologin_token, std::move(config->autologin_token_));
+  if (!is_shared) {  // the autologin token is specific to the user that received the config
+    send_closure(G()->link_manager(), &LinkManager::update_autologin_token, std::move(config->autologin_token_));
+  }
 
   options.set_option_boolean("test_mode", config->test_mode_);
   options.set_option_integer("forwarded_message_count_max", config->forwarded_count_max_);
@@ -1959,15 +2181,15 @@ void ConfigManager::process_app_config(tl_object_ptr<telegram_api::JSONValue> &c
   if (ignored_restriction_reasons.empty()) {
     options.set_option_empty("ignored_restriction_reasons");
 
-    if (options.get_option_boolean("ignore_sensitive_content_restrictions", true) ||
-        options.get_option_boolean("can_ignore_sensitive_content_restrictions", true)) {
+    if (options.get_option_boolean(OptionId::IgnoreSensitiveContentRestrictions, true) ||
+        options.get_option_boolean(OptionId::CanIgnoreSensitiveContentRestrictions, true)) {
       get_content_settings(Auto());
     }
   } else {
     options.set_option_string("ignored_restriction_reasons", ignored_restriction_reasons);
 
-    if (!options.get_option_boolean("can_ignore_sensitive_content_restrictions") ||
-        !options.get_option_boolean("ignore_sensitive_content_restrictions")) {
+    if (!options.get_option_boolean(OptionId::CanIgnoreSensitiveContentRestrictions) ||
+        !options.get_option_boolean(OptionId::IgnoreSensitiveContentRestrictions)) {
       get_content_settings(Auto());
     }
   }
@@ -2035,7 +2257,7 @@ void ConfigManager::process_app_config(tl_object_ptr<telegram_api::JSONValue> &c
     options.set_option_integer("aggressive_anti_spam_supergroup_member_count_min", telegram_antispam_group_size_min);
   }
 
-  bool is_premium = options.get_option_boolean("is_premium");
+  bool is_premium = options.get_option_boolean(OptionId::IsPremium);
   if (is_premium) {
     options.set_option_integer("chat_filter_count_max", options.get_option_integer("dialog_filters_limit_premium", 20));
     options.set_option_integer("chat_filter_chosen_chat_count_max",
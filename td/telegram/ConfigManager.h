@@ -15,6 +15,7 @@
 
 #include "td/actor/actor.h"
 
+#include "td/utils/buffer.h"
 #include "td/utils/common.h"
 #include "td/utils/FloodControlStrict.h"
 #include "td/utils/logging.h"
@@ -102,6 +103,10 @@ class ConfigManager final : public NetQueryCallback {
 
   void on_dc_options_update(DcOptions dc_options);
 
+  void on_shared_config(BufferSlice config);
+
+  void on_use_shared_config_changed();
+
   void get_current_state(vector<td_api::object_ptr<td_api::Update>> &updates) const;
 
  private:
@@ -148,6 +153,8 @@ class ConfigManager final : public NetQueryCallback {
   size_t dismiss_suggested_action_request_count_ = 0;
   std::map<int32, vector<Promise<Unit>>> dismiss_suggested_action_queries_;
 
+  uint64 shared_config_subscriber_id_ = 0;
+
   static constexpr uint64 REFCNT_TOKEN = std::numeric_limits<uint64>::max() - 2;
 
   void start_up() final;
@@ -159,7 +166,11 @@ class ConfigManager final : public NetQueryCallback {
   void on_result(NetQueryPtr res) final;
 
   void request_config_from_dc_impl(DcId dc_id, bool reopen_sessions);
-  void process_config(tl_object_ptr<telegram_api::config> config);
+  void process_config(tl_object_ptr<telegram_api::config> config, bool is_shared);
+
+  bool try_use_shared_config();
+
+  void publish_shared_config(const telegram_api::config &config, BufferSlice config_data);
 
   void try_request_app_config();
 
@@ -3927,6 +3927,21 @@ class ContactsManager::UploadProfilePhotoCallback final : public FileManager::Up
   }
 };
 
+struct ContactsManager::ChannelParticipantsPrefetch {
+  ChannelParticipantFilter filter_;
+  int32 offset_ = 0;
+  int32 limit_ = 0;
+  double receive_time_ = 0.0;
+  tl_object_ptr<telegram_api::channels_channelParticipants> result_;  // nullptr, if the page is still being loaded
+
+  // promise of the request, which waits for the page being loaded
+  Promise<tl_object_ptr<telegram_api::channels_channelParticipants>> promise_;
+
+  ChannelParticipantsPrefetch(const ChannelParticipantFilter &filter, int32 offset, int32 limit)
+      : filter_(filter), offset_(offset), limit_(limit) {
+  }
+};
+
 ContactsManager::ContactsManager(Td *td, ActorShared<> parent) : td_(td), parent_(std::move(parent)) {
   upload_profile_photo_callback_ = std::make_shared<UploadProfilePhotoCallback>();
 
@@ -4001,6 +4016,9 @@ ContactsManager::ContactsManager(Td *td, ActorShared<> parent) : td_(td), parent
   channel_participant_cache_timeout_.set_callback(on_channel_participant_cache_timeout_callback);
   channel_participant_cache_timeout_.set_callback_data(static_cast<void *>(this));
 
+  // coalesce users and chats, which are requested in bulk during processing of large updates, into bigger batches
+  get_user_queries_.set_merge_delay(0.005);
+  get_chat_queries_.set_merge_delay(0.005);
   get_user_queries_.set_merge_function([this](vector<int64> query_ids, Promise<Unit> &&promise) {
     TRY_STATUS_PROMISE(promise, G()->close_status());
     auto input_users = transform(query_ids, [this](int64 query_id) {
@@ -4260,9 +4278,30 @@ void ContactsManager::on_channel_participant_cache_timeout(ChannelId channel_id)
   }
 }
 
+const ContactsManager::User::RareFields &ContactsManager::User::get_rare_fields() const {
+  static const RareFields empty_rare_fields;
+  return rare_fields == nullptr ? empty_rare_fields : *rare_fields;
+}
+
+ContactsManager::User::RareFields &ContactsManager::User::get_rare_fields_to_edit() {
+  if (rare_fields == nullptr) {
+    rare_fields = make_unique<RareFields>();
+  }
+  return *rare_fields;
+}
+
+void ContactsManager::User::drop_empty_rare_fields() {
+  if (rare_fields != nullptr && rare_fields->is_empty()) {
+    rare_fields = nullptr;
+  }
+}
+
 template <class StorerT>
 void ContactsManager::User::store(StorerT &storer) const {
   using td::store;
+  const auto &restriction_reasons = get_rare_fields().restriction_reasons;
+  const auto &inline_query_placeholder = get_rare_fields().inline_query_placeholder;
+  const auto &language_code = get_rare_fields().language_code;
   bool has_last_name = !last_name.empty();
   bool legacy_has_username = false;
   bool has_photo = photo.small_file_id.is_valid();
@@ -4421,19 +4460,20 @@ void ContactsManager::User::parse(ParserT &parser) {
   if (legacy_is_restricted) {
     string restriction_reason;
     parse(restriction_reason, parser);
-    restriction_reasons = get_restriction_reasons(restriction_reason);
+    get_rare_fields_to_edit().restriction_reasons = get_restriction_reasons(restriction_reason);
   } else if (has_restriction_reasons) {
-    parse(restriction_reasons, parser);
+    parse(get_rare_fields_to_edit().restriction_reasons, parser);
   }
   if (is_inline_bot) {
-    parse(inline_query_placeholder, parser);
+    parse(get_rare_fields_to_edit().inline_query_placeholder, parser);
   }
   if (is_bot) {
     parse(bot_info_version, parser);
   }
   if (has_language_code) {
-    parse(language_code, parser);
+    parse(get_rare_fields_to_edit().language_code, parser);
   }
+  drop_empty_rare_fields();
   if (has_cache_version) {
     parse(cache_version, parser);
   }
@@ -7442,7 +7482,7 @@ void ContactsManager::on_update_active_usernames_order(vector<string> &&username
 }
 
 void ContactsManager::set_emoji_status(EmojiStatus emoji_status, Promise<Unit> &&promise) {
-  if (!td_->option_manager_->get_option_boolean("is_premium")) {
+  if (!td_->option_manager_->get_option_boolean(OptionId::IsPremium)) {
     return promise.set_error(Status::Error(400, "The method is available only to Telegram Premium users"));
   }
   add_recent_emoji_status(td_, emoji_status);
@@ -9916,8 +9956,9 @@ void ContactsManager::on_get_user(tl_object_ptr<telegram_api::User> &&user_ptr,
   int32 bot_info_version = has_bot_info_version ? user->bot_info_version_ : -1;
   if (is_verified != u->is_verified || is_support != u->is_support || is_bot != u->is_bot ||
       can_join_groups != u->can_join_groups || can_read_all_group_messages != u->can_read_all_group_messages ||
-      restriction_reasons != u->restriction_reasons || is_scam != u->is_scam || is_fake != u->is_fake ||
-      is_inline_bot != u->is_inline_bot || inline_query_placeholder != u->inline_query_placeholder ||
+      restriction_reasons != u->get_rare_fields().restriction_reasons || is_scam != u->is_scam ||
+      is_fake != u->is_fake || is_inline_bot != u->is_inline_bot ||
+      inline_query_placeholder != u->get_rare_fields().inline_query_placeholder ||
       need_location_bot != u->need_location_bot || can_be_added_to_attach_menu != u->can_be_added_to_attach_menu ||
       attach_menu_enabled != u->attach_menu_enabled) {
     LOG_IF(ERROR, is_bot != u->is_bot && !is_deleted && !u->is_deleted && u->is_received)
@@ -9928,11 +9969,15 @@ void ContactsManager::on_get_user(tl_object_ptr<telegram_api::User> &&user_ptr,
     u->is_bot = is_bot;
     u->can_join_groups = can_join_groups;
     u->can_read_all_group_messages = can_read_all_group_messages;
-    u->restriction_reasons = std::move(restriction_reasons);
+    if (!restriction_reasons.empty() || !inline_query_placeholder.empty() || u->rare_fields != nullptr) {
+      auto &rare_fields = u->get_rare_fields_to_edit();
+      rare_fields.restriction_reasons = std::move(restriction_reasons);
+      rare_fields.inline_query_placeholder = std::move(inline_query_placeholder);
+      u->drop_empty_rare_fields();
+    }
     u->is_scam = is_scam;
     u->is_fake = is_fake;
     u->is_inline_bot = is_inline_bot;
-    u->inline_query_placeholder = std::move(inline_query_placeholder);
     u->need_location_bot = need_location_bot;
     u->can_be_added_to_attach_menu = can_be_added_to_attach_menu;
     u->attach_menu_enabled = attach_menu_enabled;
@@ -9973,10 +10018,10 @@ void ContactsManager::on_get_user(tl_object_ptr<telegram_api::User> &&user_ptr,
   bool has_language_code = (flags & USER_FLAG_HAS_LANGUAGE_CODE) != 0;
   LOG_IF(ERROR, has_language_code && !td_->auth_manager_->is_bot())
       << "Receive language code for " << user_id << " from " << source;
-  if (u->language_code != user->lang_code_ && !user->lang_code_.empty()) {
-    u->language_code = user->lang_code_;
+  if (u->get_rare_fields().language_code != user->lang_code_ && !user->lang_code_.empty()) {
+    u->get_rare_fields_to_edit().language_code = user->lang_code_;
 
-    LOG(DEBUG) << "Language code has changed for " << user_id << " to " << u->language_code;
+    LOG(DEBUG) << "Language code has changed for " << user_id << " to " << user->lang_code_;
     u->is_changed = true;
   }
 
@@ -10076,7 +10121,8 @@ void ContactsManager::save_user_to_database(User *u, UserId user_id) {
     return;
   }
   if (loaded_from_database_users_.count(user_id)) {
-    save_user_to_database_impl(u, user_id, get_user_database_value(u));
+    pending_saved_users_.insert(user_id);
+    schedule_save_pending_entities_to_database();
     return;
   }
   if (load_user_from_database_queries_.count(user_id) != 0) {
@@ -10208,6 +10254,73 @@ void ContactsManager::on_load_user_from_database(UserId user_id, string value, b
   set_promises(promises);
 }
 
+void ContactsManager::load_dialog_infos_from_database(const vector<DialogId> &dialog_ids) {
+  if (!G()->parameters().use_chat_info_db) {
+    return;
+  }
+
+  vector<UserId> user_ids;
+  vector<ChatId> chat_ids;
+  vector<ChannelId> channel_ids;
+  vector<string> keys;
+  for (auto dialog_id : dialog_ids) {
+    switch (dialog_id.get_type()) {
+      case DialogType::User: {
+        auto user_id = dialog_id.get_user_id();
+        if (user_id.is_valid() && get_user(user_id) == nullptr && loaded_from_database_users_.count(user_id) == 0 &&
+            load_user_from_database_queries_.count(user_id) == 0) {
+          user_ids.push_back(user_id);
+          keys.push_back(get_user_database_key(user_id));
+        }
+        break;
+      }
+      case DialogType::Chat: {
+        auto chat_id = dialog_id.get_chat_id();
+        if (chat_id.is_valid() && get_chat(chat_id) == nullptr && loaded_from_database_chats_.count(chat_id) == 0 &&
+            load_chat_from_database_queries_.count(chat_id) == 0) {
+          chat_ids.push_back(chat_id);
+          keys.push_back(get_chat_database_key(chat_id));
+        }
+        break;
+      }
+      case DialogType::Channel: {
+        auto channel_id = dialog_id.get_channel_id();
+        if (channel_id.is_valid() && get_channel(channel_id) == nullptr &&
+            loaded_from_database_channels_.count(channel_id) == 0 &&
+            load_channel_from_database_queries_.count(channel_id) == 0) {
+          channel_ids.push_back(channel_id);
+          keys.push_back(get_channel_database_key(channel_id));
+        }
+        break;
+      }
+      case DialogType::SecretChat:
+        break;
+      case DialogType::None:
+      default:
+        UNREACHABLE();
+    }
+  }
+  if (keys.size() <= 1) {
+    // there is nothing to batch; the entity will be loaded on first access
+    return;
+  }
+
+  LOG(INFO) << "Load " << user_ids.size() << " users, " << chat_ids.size() << " basic groups and "
+            << channel_ids.size() << " supergroups from database";
+  auto values = G()->td_db()->get_sqlite_sync_pmc()->get_many(keys);
+  CHECK(values.size() == keys.size());
+  size_t pos = 0;
+  for (auto user_id : user_ids) {
+    on_load_user_from_database(user_id, std::move(values[pos++]), true);
+  }
+  for (auto chat_id : chat_ids) {
+    on_load_chat_from_database(chat_id, std::move(values[pos++]), true);
+  }
+  for (auto channel_id : channel_ids) {
+    on_load_channel_from_database(channel_id, std::move(values[pos++]), true);
+  }
+}
+
 bool ContactsManager::have_user_force(UserId user_id) {
   return get_user_force(user_id) != nullptr;
 }
@@ -10407,7 +10520,8 @@ void ContactsManager::save_chat_to_database(Chat *c, ChatId chat_id) {
     return;
   }
   if (loaded_from_database_chats_.count(chat_id)) {
-    save_chat_to_database_impl(c, chat_id, get_chat_database_value(c));
+    pending_saved_chats_.insert(chat_id);
+    schedule_save_pending_entities_to_database();
     return;
   }
   if (load_chat_from_database_queries_.count(chat_id) != 0) {
@@ -10653,7 +10767,8 @@ void ContactsManager::save_channel_to_database(Channel *c, ChannelId channel_id)
     return;
   }
   if (loaded_from_database_channels_.count(channel_id)) {
-    save_channel_to_database_impl(c, channel_id, get_channel_database_value(c));
+    pending_saved_channels_.insert(channel_id);
+    schedule_save_pending_entities_to_database();
     return;
   }
   if (load_channel_from_database_queries_.count(channel_id) != 0) {
@@ -10851,6 +10966,89 @@ class ContactsManager::SecretChatLogEvent {
   }
 };
 
+void ContactsManager::schedule_save_pending_entities_to_database() {
+  if (!has_timeout()) {
+    set_timeout_in(SAVE_TO_DATABASE_DELAY);
+  }
+}
+
+void ContactsManager::timeout_expired() {
+  save_pending_entities_to_database();
+}
+
+void ContactsManager::save_pending_entities_to_database() {
+  if (G()->close_flag()) {
+    // the entities will be restored from binlog
+    return;
+  }
+
+  // only the latest version of each entity is serialized and all of them are written in one transaction
+  FlatHashMap<string, string> key_values;
+  vector<UserId> user_ids;
+  for (auto user_id : pending_saved_users_) {
+    User *u = get_user(user_id);
+    CHECK(u != nullptr);
+    CHECK(!u->is_being_saved);
+    u->is_being_saved = true;
+    u->is_saved = true;
+    u->is_status_saved = true;
+    key_values.emplace(get_user_database_key(user_id), get_user_database_value(u));
+    user_ids.push_back(user_id);
+  }
+  pending_saved_users_.clear();
+
+  vector<ChatId> chat_ids;
+  for (auto chat_id : pending_saved_chats_) {
+    Chat *c = get_chat(chat_id);
+    CHECK(c != nullptr);
+    CHECK(!c->is_being_saved);
+    c->is_being_saved = true;
+    c->is_saved = true;
+    key_values.emplace(get_chat_database_key(chat_id), get_chat_database_value(c));
+    chat_ids.push_back(chat_id);
+  }
+  pending_saved_chats_.clear();
+
+  vector<ChannelId> channel_ids;
+  for (auto channel_id : pending_saved_channels_) {
+    Channel *c = get_channel(channel_id);
+    CHECK(c != nullptr);
+    CHECK(!c->is_being_saved);
+    c->is_being_saved = true;
+    c->is_saved = true;
+    key_values.emplace(get_channel_database_key(channel_id), get_channel_database_value(c));
+    channel_ids.push_back(channel_id);
+  }
+  pending_saved_channels_.clear();
+
+  if (key_values.empty()) {
+    return;
+  }
+
+  LOG(INFO) << "Trying to save to database " << user_ids.size() << " users, " << chat_ids.size()
+            << " basic groups and " << channel_ids.size() << " supergroups";
+  G()->td_db()->get_sqlite_pmc()->set_all(
+      std::move(key_values),
+      PromiseCreator::lambda([user_ids = std::move(user_ids), chat_ids = std::move(chat_ids),
+                              channel_ids = std::move(channel_ids)](Result<Unit> result) mutable {
+        send_closure(G()->contacts_manager(), &ContactsManager::on_save_pending_entities_to_database,
+                     std::move(user_ids), std::move(chat_ids), std::move(channel_ids), result.is_ok());
+      }));
+}
+
+void ContactsManager::on_save_pending_entities_to_database(vector<UserId> user_ids, vector<ChatId> chat_ids,
+                                                           vector<ChannelId> channel_ids, bool success) {
+  for (auto user_id : user_ids) {
+    on_save_user_to_database(user_id, success);
+  }
+  for (auto chat_id : chat_ids) {
+    on_save_chat_to_database(chat_id, success);
+  }
+  for (auto channel_id : channel_ids) {
+    on_save_channel_to_database(channel_id, success);
+  }
+}
+
 void ContactsManager::save_secret_chat(SecretChat *c, SecretChatId secret_chat_id, bool from_binlog) {
   if (!G()->parameters().use_chat_info_db) {
     return;
@@ -11437,7 +11635,7 @@ void ContactsManager::for_each_secret_chat_with_user(UserId user_id, const std::
 void ContactsManager::update_user(User *u, UserId user_id, bool from_binlog, bool from_database) {
   CHECK(u != nullptr);
   if (user_id == get_my_id()) {
-    if (td_->option_manager_->get_option_boolean("is_premium") != u->is_premium) {
+    if (td_->option_manager_->get_option_boolean(OptionId::IsPremium) != u->is_premium) {
       td_->option_manager_->set_option_boolean("is_premium", u->is_premium);
       send_closure(td_->config_manager_, &ConfigManager::request_config, true);
       td_->stickers_manager_->reload_top_reactions();
@@ -11503,7 +11701,7 @@ void ContactsManager::update_user(User *u, UserId user_id, bool from_binlog, boo
     }
   }
   if (!td_->auth_manager_->is_bot()) {
-    if (u->restriction_reasons.empty()) {
+    if (u->get_rare_fields().restriction_reasons.empty()) {
       restricted_user_ids_.erase(user_id);
     } else {
       restricted_user_ids_.insert(user_id);
@@ -17334,8 +17532,105 @@ void ContactsManager::get_channel_participants(ChannelId channel_id,
                        limit, std::move(additional_query), additional_limit, result.move_as_ok(), std::move(promise));
         }
       });
-  td_->create_handler<GetChannelParticipantsQuery>(std::move(get_channel_participants_promise))
-      ->send(channel_id, participant_filter, offset, limit);
+  get_channel_participants_page(channel_id, participant_filter, offset, limit,
+                                std::move(get_channel_participants_promise));
+}
+
+void ContactsManager::get_channel_participants_page(
+    ChannelId channel_id, const ChannelParticipantFilter &filter, int32 offset, int32 limit,
+    Promise<tl_object_ptr<telegram_api::channels_channelParticipants>> &&promise) {
+  auto it = channel_participants_prefetches_.find(channel_id);
+  if (it != channel_participants_prefetches_.end()) {
+    auto &prefetch = *it->second;
+    if (prefetch.filter_ == filter && prefetch.offset_ == offset && prefetch.limit_ == limit && !prefetch.promise_) {
+      if (prefetch.result_ == nullptr) {
+        LOG(INFO) << "Wait for prefetched " << filter << " members in " << channel_id << " with offset " << offset;
+        prefetch.promise_ = std::move(promise);
+        return;
+      }
+      if (prefetch.receive_time_ >= Time::now() - CHANNEL_PARTICIPANTS_PREFETCH_TIME) {
+        LOG(INFO) << "Use prefetched " << filter << " members in " << channel_id << " with offset " << offset;
+        auto result = std::move(prefetch.result_);
+        channel_participants_prefetches_.erase(it);
+        return on_get_channel_participants_page(channel_id, filter, offset, limit, std::move(result),
+                                                std::move(promise));
+      }
+    }
+    if (prefetch.result_ != nullptr) {
+      channel_participants_prefetches_.erase(it);
+    }
+  }
+
+  auto query_promise = PromiseCreator::lambda(
+      [actor_id = actor_id(this), channel_id, filter, offset, limit, promise = std::move(promise)](
+          Result<tl_object_ptr<telegram_api::channels_channelParticipants>> &&result) mutable {
+        if (result.is_error()) {
+          promise.set_error(result.move_as_error());
+        } else {
+          send_closure(actor_id, &ContactsManager::on_get_channel_participants_page, channel_id, std::move(filter),
+                       offset, limit, result.move_as_ok(), std::move(promise));
+        }
+      });
+  td_->create_handler<GetChannelParticipantsQuery>(std::move(query_promise))->send(channel_id, filter, offset, limit);
+}
+
+void ContactsManager::on_get_channel_participants_page(
+    ChannelId channel_id, const ChannelParticipantFilter &filter, int32 offset, int32 limit,
+    tl_object_ptr<telegram_api::channels_channelParticipants> &&channel_participants,
+    Promise<tl_object_ptr<telegram_api::channels_channelParticipants>> &&promise) {
+  CHECK(channel_participants != nullptr);
+  // the client is likely to load the whole member list page by page, so the next page is loaded in advance
+  auto next_offset = offset + limit;
+  if (offset > 0 && static_cast<int32>(channel_participants->participants_.size()) == limit &&
+      next_offset < channel_participants->count_ && channel_participants_prefetches_.count(channel_id) == 0) {
+    LOG(INFO) << "Prefetch " << filter << " members in " << channel_id << " with offset " << next_offset;
+    channel_participants_prefetches_[channel_id] =
+        make_unique<ChannelParticipantsPrefetch>(filter, next_offset, limit);
+    auto query_promise = PromiseCreator::lambda(
+        [actor_id = actor_id(this), channel_id, filter, next_offset,
+         limit](Result<tl_object_ptr<telegram_api::channels_channelParticipants>> &&result) mutable {
+          send_closure(actor_id, &ContactsManager::on_get_prefetched_channel_participants, channel_id,
+                       std::move(filter), next_offset, limit, std::move(result));
+        });
+    td_->create_handler<GetChannelParticipantsQuery>(std::move(query_promise))
+        ->send(channel_id, filter, next_offset, limit);
+  }
+  promise.set_value(std::move(channel_participants));
+}
+
+void ContactsManager::on_get_prefetched_channel_participants(
+    ChannelId channel_id, ChannelParticipantFilter filter, int32 offset, int32 limit,
+    Result<tl_object_ptr<telegram_api::channels_channelParticipants>> &&r_channel_participants) {
+  G()->ignore_result_if_closing(r_channel_participants);
+
+  auto it = channel_participants_prefetches_.find(channel_id);
+  CHECK(it != channel_participants_prefetches_.end());
+  auto &prefetch = *it->second;
+  CHECK(prefetch.filter_ == filter && prefetch.offset_ == offset && prefetch.limit_ == limit);
+  CHECK(prefetch.result_ == nullptr);
+  auto promise = std::move(prefetch.promise_);
+  if (r_channel_participants.is_error()) {
+    channel_participants_prefetches_.erase(it);
+    if (promise) {
+      // the page was requested by the client, so retry the request
+      TRY_STATUS_PROMISE(promise, G()->close_status());
+      get_channel_participants_page(channel_id, filter, offset, limit, std::move(promise));
+    }
+    return;
+  }
+
+  auto channel_participants = r_channel_participants.move_as_ok();
+  if (promise) {
+    channel_participants_prefetches_.erase(it);
+    return on_get_channel_participants_page(channel_id, filter, offset, limit, std::move(channel_participants),
+                                            std::move(promise));
+  }
+
+  // apply received users and chats immediately to not keep them in memory and to not apply outdated data later
+  on_get_users(std::move(channel_participants->users_), "on_get_prefetched_channel_participants");
+  on_get_chats(std::move(channel_participants->chats_), "on_get_prefetched_channel_participants");
+  prefetch.receive_time_ = Time::now();
+  prefetch.result_ = std::move(channel_participants);
 }
 
 td_api::object_ptr<td_api::chatAdministrators> ContactsManager::get_chat_administrators_object(
@@ -18157,7 +18452,7 @@ tl_object_ptr<td_api::user> ContactsManager::get_user_object(UserId user_id, con
     type = make_tl_object<td_api::userTypeDeleted>();
   } else if (u->is_bot) {
     type = make_tl_object<td_api::userTypeBot>(u->can_join_groups, u->can_read_all_group_messages, u->is_inline_bot,
-                                               u->inline_query_placeholder, u->need_location_bot,
+                                               u->get_rare_fields().inline_query_placeholder, u->need_location_bot,
                                                u->can_be_added_to_attach_menu);
   } else {
     type = make_tl_object<td_api::userTypeRegular>();
@@ -18168,8 +18463,8 @@ tl_object_ptr<td_api::user> ContactsManager::get_user_object(UserId user_id, con
       user_id.get(), u->first_name, u->last_name, u->usernames.get_usernames_object(), u->phone_number,
       get_user_status_object(user_id, u), get_profile_photo_object(td_->file_manager_.get(), u->photo),
       std::move(emoji_status), u->is_contact, u->is_mutual_contact, u->is_verified, u->is_premium, u->is_support,
-      get_restriction_reason_description(u->restriction_reasons), u->is_scam, u->is_fake, u->is_received,
-      std::move(type), u->language_code, u->attach_menu_enabled);
+      get_restriction_reason_description(u->get_rare_fields().restriction_reasons), u->is_scam, u->is_fake,
+      u->is_received, std::move(type), u->get_rare_fields().language_code, u->attach_menu_enabled);
 }
 
 vector<int64> ContactsManager::get_user_ids_object(const vector<UserId> &user_ids, const char *source) const {
@@ -18593,4 +18888,15 @@ void ContactsManager::get_current_state(vector<td_api::object_ptr<td_api::Update
   });
 }
 
+void ContactsManager::get_memory_statistics(MemoryStatisticsEntries &entries) const {
+  add_memory_statistics_entry<User>(entries, "ContactsManager", "users", users_.calc_size());
+  add_memory_statistics_entry<UserFull>(entries, "ContactsManager", "users_full", users_full_.calc_size());
+  add_memory_statistics_entry<Chat>(entries, "ContactsManager", "basic_groups", chats_.calc_size());
+  add_memory_statistics_entry<ChatFull>(entries, "ContactsManager", "basic_groups_full", chats_full_.calc_size());
+  add_memory_statistics_entry<Channel>(entries, "ContactsManager", "supergroups", channels_.calc_size());
+  add_memory_statistics_entry<ChannelFull>(entries, "ContactsManager", "supergroups_full", channels_full_.calc_size());
+  add_memory_statistics_entry<MinChannel>(entries, "ContactsManager", "min_supergroups", min_channels_.calc_size());
+  add_memory_statistics_entry<SecretChat>(entries, "ContactsManager", "secret_chats", secret_chats_.calc_size());
+}
+
 }  // namespace td
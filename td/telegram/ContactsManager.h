@@ -26,6 +26,7 @@
 #include "td/telegram/FolderId.h"
 #include "td/telegram/FullMessageId.h"
 #include "td/telegram/Location.h"
+#include "td/telegram/MemoryStatistics.h"
 #include "td/telegram/MessageId.h"
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/Photo.h"
@@ -547,6 +548,9 @@ class ContactsManager final : public Actor {
   bool have_min_user(UserId user_id) const;
   bool have_user_force(UserId user_id);
 
+  // loads from the database with one batched query all users, basic groups and supergroups needed for the dialogs
+  void load_dialog_infos_from_database(const vector<DialogId> &dialog_ids);
+
   bool is_dialog_info_received_from_server(DialogId dialog_id) const;
 
   void reload_dialog_info(DialogId dialog_id, Promise<Unit> &&promise);
@@ -685,6 +689,8 @@ class ContactsManager final : public Actor {
 
   void get_current_state(vector<td_api::object_ptr<td_api::Update>> &updates) const;
 
+  void get_memory_statistics(MemoryStatisticsEntries &entries) const;
+
   static tl_object_ptr<td_api::dateRange> convert_date_range(
       const tl_object_ptr<telegram_api::statsDateRangeDays> &obj);
 
@@ -716,14 +722,22 @@ class ContactsManager final : public Actor {
 
     ProfilePhoto photo;
 
-    vector<RestrictionReason> restriction_reasons;
-    string inline_query_placeholder;
     int32 bot_info_version = -1;
 
     int32 was_online = 0;
     int32 local_was_online = 0;
 
-    string language_code;
+    // fields, which are empty for almost all users, are stored out of line to keep User small
+    struct RareFields {
+      vector<RestrictionReason> restriction_reasons;
+      string inline_query_placeholder;
+      string language_code;
+
+      bool is_empty() const {
+        return restriction_reasons.empty() && inline_query_placeholder.empty() && language_code.empty();
+      }
+    };
+    unique_ptr<RareFields> rare_fields;
 
     FlatHashSet<int64> photo_ids;
 
@@ -775,6 +789,12 @@ class ContactsManager final : public Actor {
 
     uint64 log_event_id = 0;
 
+    const RareFields &get_rare_fields() const;
+
+    RareFields &get_rare_fields_to_edit();
+
+    void drop_empty_rare_fields();
+
     template <class StorerT>
     void store(StorerT &storer) const;
 
@@ -1120,6 +1140,10 @@ class ContactsManager final : public Actor {
 
   static constexpr int32 CHANNEL_PARTICIPANT_CACHE_TIME = 1800;  // some reasonable limit
 
+  static constexpr double CHANNEL_PARTICIPANTS_PREFETCH_TIME = 30.0;  // some reasonable limit
+
+  static constexpr double SAVE_TO_DATABASE_DELAY = 0.05;  // some reasonable limit
+
   static constexpr int32 USER_FLAG_HAS_ACCESS_HASH = 1 << 0;
   static constexpr int32 USER_FLAG_HAS_FIRST_NAME = 1 << 1;
   static constexpr int32 USER_FLAG_HAS_LAST_NAME = 1 << 2;
@@ -1491,6 +1515,11 @@ class ContactsManager final : public Actor {
   void load_channel_from_database_impl(ChannelId channel_id, Promise<Unit> promise);
   void on_load_channel_from_database(ChannelId channel_id, string value, bool force);
 
+  void schedule_save_pending_entities_to_database();
+  void save_pending_entities_to_database();
+  void on_save_pending_entities_to_database(vector<UserId> user_ids, vector<ChatId> chat_ids,
+                                            vector<ChannelId> channel_ids, bool success);
+
   void save_secret_chat(SecretChat *c, SecretChatId secret_chat_id, bool from_binlog);
   static string get_secret_chat_database_key(SecretChatId secret_chat_id);
   static string get_secret_chat_database_value(const SecretChat *c);
@@ -1724,6 +1753,19 @@ class ContactsManager final : public Actor {
   void do_search_chat_participants(ChatId chat_id, const string &query, int32 limit, DialogParticipantFilter filter,
                                    Promise<DialogParticipants> &&promise);
 
+  void get_channel_participants_page(ChannelId channel_id, const ChannelParticipantFilter &filter, int32 offset,
+                                     int32 limit,
+                                     Promise<tl_object_ptr<telegram_api::channels_channelParticipants>> &&promise);
+
+  void on_get_channel_participants_page(
+      ChannelId channel_id, const ChannelParticipantFilter &filter, int32 offset, int32 limit,
+      tl_object_ptr<telegram_api::channels_channelParticipants> &&channel_participants,
+      Promise<tl_object_ptr<telegram_api::channels_channelParticipants>> &&promise);
+
+  void on_get_prefetched_channel_participants(
+      ChannelId channel_id, ChannelParticipantFilter filter, int32 offset, int32 limit,
+      Result<tl_object_ptr<telegram_api::channels_channelParticipants>> &&r_channel_participants);
+
   void on_get_channel_participants(ChannelId channel_id, ChannelParticipantFilter &&filter, int32 offset, int32 limit,
                                    string additional_query, int32 additional_limit,
                                    tl_object_ptr<telegram_api::channels_channelParticipants> &&channel_participants,
@@ -1810,6 +1852,8 @@ class ContactsManager final : public Actor {
 
   void tear_down() final;
 
+  void timeout_expired() final;
+
   Td *td_;
   ActorShared<> parent_;
   UserId my_id_;
@@ -1876,6 +1920,11 @@ class ContactsManager final : public Actor {
   FlatHashSet<ChannelId, ChannelIdHash> loaded_from_database_channels_;
   FlatHashSet<ChannelId, ChannelIdHash> unavailable_channel_fulls_;
 
+  // users, basic groups and supergroups, which will be saved to the database with the next batch
+  FlatHashSet<UserId, UserIdHash> pending_saved_users_;
+  FlatHashSet<ChatId, ChatIdHash> pending_saved_chats_;
+  FlatHashSet<ChannelId, ChannelIdHash> pending_saved_channels_;
+
   FlatHashMap<SecretChatId, vector<Promise<Unit>>, SecretChatIdHash> load_secret_chat_from_database_queries_;
   FlatHashSet<SecretChatId, SecretChatIdHash> loaded_from_database_secret_chats_;
 
@@ -1928,6 +1977,9 @@ class ContactsManager final : public Actor {
 
   FlatHashMap<ChannelId, vector<DialogParticipant>, ChannelIdHash> cached_channel_participants_;
 
+  struct ChannelParticipantsPrefetch;
+  FlatHashMap<ChannelId, unique_ptr<ChannelParticipantsPrefetch>, ChannelIdHash> channel_participants_prefetches_;
+
   FlatHashMap<string, UserId> resolved_phone_numbers_;
 
   // bot-administrators only
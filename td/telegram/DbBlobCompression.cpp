@@ -0,0 +1,63 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/DbBlobCompression.h"
+
+#include "td/utils/as.h"
+#include "td/utils/Gzip.h"
+#include "td/utils/logging.h"
+
+namespace td {
+
+static constexpr int32 COMPRESSED_BLOB_MAGIC = -0x5a4c4442;
+
+enum class DbBlobCompressionFormat : int32 { Gzip = 1 };
+
+static constexpr size_t COMPRESSED_BLOB_HEADER_SIZE = 2 * sizeof(int32);
+
+static constexpr size_t MIN_COMPRESSED_BLOB_DATA_SIZE = 128;
+
+std::atomic<bool> DbBlobCompression::is_enabled_{false};
+
+void DbBlobCompression::set_enabled(bool is_enabled) {
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+BufferSlice DbBlobCompression::compress(BufferSlice data) {
+  if (!is_enabled() || data.size() < MIN_COMPRESSED_BLOB_DATA_SIZE) {
+    return data;
+  }
+
+  auto compressed = gzencode(data.as_slice(), 0.9);
+  if (compressed.empty()) {
+    return data;
+  }
+
+  BufferSlice result(COMPRESSED_BLOB_HEADER_SIZE + compressed.size());
+  as<int32>(result.as_mutable_slice().begin()) = COMPRESSED_BLOB_MAGIC;
+  as<int32>(result.as_mutable_slice().begin() + sizeof(int32)) = static_cast<int32>(DbBlobCompressionFormat::Gzip);
+  result.as_mutable_slice().substr(COMPRESSED_BLOB_HEADER_SIZE).copy_from(compressed.as_slice());
+  return result;
+}
+
+BufferSlice DbBlobCompression::decompress(Slice blob) {
+  if (blob.size() < COMPRESSED_BLOB_HEADER_SIZE || as<int32>(blob.begin()) != COMPRESSED_BLOB_MAGIC) {
+    return BufferSlice(blob);
+  }
+
+  int32 format = as<int32>(blob.begin() + sizeof(int32));
+  if (format != static_cast<int32>(DbBlobCompressionFormat::Gzip)) {
+    LOG(ERROR) << "Receive database blob in unsupported format " << format;
+    return BufferSlice();
+  }
+  auto result = gzdecode(blob.substr(COMPRESSED_BLOB_HEADER_SIZE));
+  if (result.empty()) {
+    LOG(ERROR) << "Failed to decompress database blob of size " << blob.size();
+  }
+  return result;
+}
+
+}  // namespace td
@@ -0,0 +1,38 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+#include <atomic>
+
+namespace td {
+
+// Compresses serialized messages and chats before they are stored in the database
+// A compressed blob begins with a negative magic number and the compression format, followed by the compressed data
+// Uncompressed blobs begin with a non-negative log event version, so they are stored as is and remain readable
+class DbBlobCompression {
+ public:
+  static void set_enabled(bool is_enabled);
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // returns the data to be stored in the database; the data is left as is if compression is disabled or useless
+  static BufferSlice compress(BufferSlice data);
+
+  // returns the data stored in the blob; returns an empty buffer if the blob can't be decompressed
+  static BufferSlice decompress(Slice blob);
+
+ private:
+  static std::atomic<bool> is_enabled_;
+};
+
+}  // namespace td
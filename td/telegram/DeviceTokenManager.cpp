@@ -263,7 +263,7 @@ void DeviceTokenManager::register_device(tl_object_ptr<td_api::DeviceToken> devi
   } else {
     if ((info.state == TokenInfo::State::Reregister || info.state == TokenInfo::State::Sync) && info.token == token &&
         info.other_user_ids == input_user_ids && info.is_app_sandbox == is_app_sandbox && encrypt == info.encrypt) {
-      int64 push_token_id = encrypt ? info.encryption_key_id : G()->get_option_integer("my_id");
+      int64 push_token_id = encrypt ? info.encryption_key_id : G()->get_option_integer(OptionId::MyId);
       return promise.set_value(td_api::make_object<td_api::pushReceiverId>(push_token_id));
     }
 
@@ -315,7 +315,7 @@ vector<std::pair<int64, Slice>> DeviceTokenManager::get_encryption_keys() const
       if (info.encrypt) {
         result.emplace_back(info.encryption_key_id, info.encryption_key);
       } else {
-        result.emplace_back(G()->get_option_integer("my_id"), Slice());
+        result.emplace_back(G()->get_option_integer(OptionId::MyId), Slice());
       }
     }
   }
@@ -326,6 +326,50 @@ string DeviceTokenManager::get_database_key(int32 token_type) {
   return PSTRING() << "device_token" << token_type;
 }
 
+Status DeviceTokenManager::parse_token_info(Slice serialized, TokenInfo &token) {
+  CHECK(!serialized.empty());
+  char c = serialized[0];
+  if (c == '*') {
+    return unserialize(token, serialized.substr(1));
+  }
+
+  // legacy
+  if (c == '+') {
+    token.state = TokenInfo::State::Register;
+  } else if (c == '-') {
+    token.state = TokenInfo::State::Unregister;
+  } else if (c == '=') {
+    token.state = TokenInfo::State::Sync;
+  } else {
+    return Status::Error("Unknown format");
+  }
+  token.token = serialized.substr(1).str();
+  return Status::OK();
+}
+
+vector<string> DeviceTokenManager::get_database_keys() {
+  vector<string> result;
+  for (int32 token_type = 1; token_type < TokenType::Size; token_type++) {
+    result.push_back(get_database_key(token_type));
+  }
+  return result;
+}
+
+Result<std::pair<int64, string>> DeviceTokenManager::get_saved_encryption_key(Slice serialized, int64 my_id) {
+  if (serialized.empty()) {
+    return Status::Error("Device token isn't registered");
+  }
+  TokenInfo info;
+  TRY_STATUS(parse_token_info(serialized, info));
+  if (info.token.empty() || info.state == TokenInfo::State::Unregister) {
+    return Status::Error("Device token isn't registered");
+  }
+  if (info.encrypt) {
+    return std::make_pair(info.encryption_key_id, std::move(info.encryption_key));
+  }
+  return std::make_pair(my_id, string());
+}
+
 void DeviceTokenManager::start_up() {
   for (int32 token_type = 1; token_type < TokenType::Size; token_type++) {
     auto serialized = G()->td_db()->get_binlog_pmc()->get(get_database_key(token_type));
@@ -334,27 +378,11 @@ void DeviceTokenManager::start_up() {
     }
 
     auto &token = tokens_[token_type];
-    char c = serialized[0];
-    if (c == '*') {
-      auto status = unserialize(token, serialized.substr(1));
-      if (status.is_error()) {
-        token = TokenInfo();
-        LOG(ERROR) << "Invalid serialized TokenInfo: " << format::escaped(serialized) << ' ' << status;
-        continue;
-      }
-    } else {
-      // legacy
-      if (c == '+') {
-        token.state = TokenInfo::State::Register;
-      } else if (c == '-') {
-        token.state = TokenInfo::State::Unregister;
-      } else if (c == '=') {
-        token.state = TokenInfo::State::Sync;
-      } else {
-        LOG(ERROR) << "Invalid serialized TokenInfo: " << format::escaped(serialized);
-        continue;
-      }
-      token.token = serialized.substr(1);
+    auto status = parse_token_info(serialized, token);
+    if (status.is_error()) {
+      token = TokenInfo();
+      LOG(ERROR) << "Invalid serialized TokenInfo: " << format::escaped(serialized) << ' ' << status;
+      continue;
     }
     LOG(INFO) << "Have device token " << token_type << "--->" << token;
     if (token.state == TokenInfo::State::Sync && !token.token.empty()) {
@@ -431,7 +459,7 @@ void DeviceTokenManager::on_result(NetQueryPtr net_query) {
         if (info.encrypt) {
           push_token_id = info.encryption_key_id;
         } else {
-          push_token_id = G()->get_option_integer("my_id");
+          push_token_id = G()->get_option_integer(OptionId::MyId);
         }
       }
       info.promise.set_value(td_api::make_object<td_api::pushReceiverId>(push_token_id));
@@ -15,6 +15,7 @@
 #include "td/utils/common.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 
 #include <array>
@@ -33,6 +34,13 @@ class DeviceTokenManager final : public NetQueryCallback {
 
   vector<std::pair<int64, Slice>> get_encryption_keys() const;
 
+  // returns keys of the binlog key-value storage, in which device tokens are saved
+  static vector<string> get_database_keys();
+
+  // returns the encryption key of a device token saved in the binlog key-value storage in the same way as
+  // get_encryption_keys, or an error if the token isn't registered
+  static Result<std::pair<int64, string>> get_saved_encryption_key(Slice serialized, int64 my_id);
+
  private:
   ActorShared<> parent_;
   enum TokenType : int32 {
@@ -80,6 +88,7 @@ class DeviceTokenManager final : public NetQueryCallback {
   void start_up() final;
 
   static string get_database_key(int32 token_type);
+  static Status parse_token_info(Slice serialized, TokenInfo &token);
   void save_info(int32 token_type);
 
   void dec_sync_cnt();
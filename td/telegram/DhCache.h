@@ -8,10 +8,15 @@
 
 #include "td/mtproto/DhCallback.h"
 
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/Slice.h"
 
+#include <mutex>
+
 namespace td {
 
+// results of prime checks are cached in memory process-wide, so each prime is checked once for all clients
 class DhCache final : public mtproto::DhCallback {
  public:
   int is_good_prime(Slice prime_str) const final;
@@ -22,5 +27,11 @@ class DhCache final : public mtproto::DhCallback {
     static DhCache res;
     return &res;
   }
+
+ private:
+  mutable std::mutex mutex_;
+  mutable FlatHashMap<string, bool> checked_primes_;
+
+  void on_prime_checked(Slice prime_str, bool is_good) const;
 };
 }  // namespace td
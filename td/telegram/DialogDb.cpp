@@ -6,12 +6,15 @@
 //
 #include "td/telegram/DialogDb.h"
 
+#include "td/telegram/DbBlobCompression.h"
 #include "td/telegram/Version.h"
 
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteKeyValue.h"
+#include "td/db/SqliteReadPool.h"
 #include "td/db/SqliteStatement.h"
+#include "td/db/WriteBatcher.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/SchedulerLocalStorage.h"
@@ -23,8 +26,15 @@
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
+#include "td/utils/utf8.h"
 
 namespace td {
+
+static Status create_dialogs_fts_table(SqliteDb &db) {
+  // rowid is a dialog identifier; text consists of normalized words from the dialog title and usernames
+  return db.exec("CREATE VIRTUAL TABLE IF NOT EXISTS dialogs_fts USING fts5(text, prefix='2 3')");
+}
+
 // NB: must happen inside a transaction
 Status init_dialog_db(SqliteDb &db, int32 version, KeyValueSyncInterface &binlog_pmc, bool &was_created) {
   LOG(INFO) << "Init dialog database " << tag("version", version);
@@ -68,6 +78,7 @@ Status init_dialog_db(SqliteDb &db, int32 version, KeyValueSyncInterface &binlog
     TRY_STATUS(create_notification_group_table());
     TRY_STATUS(create_last_notification_date_index());
     TRY_STATUS(add_dialogs_in_folder_index());
+    TRY_STATUS(create_dialogs_fts_table(db));
     version = current_db_version();
   }
   if (version < static_cast<int32>(DbVersion::AddNotificationsSupport)) {
@@ -98,6 +109,10 @@ Status init_dialog_db(SqliteDb &db, int32 version, KeyValueSyncInterface &binlog
       binlog_pmc.set(PSTRING() << "pinned_dialog_ids" << folder_id, implode(pinned_dialog_ids, ','));
     }
   }
+  if (version < static_cast<int32>(DbVersion::AddDialogSearchIndex)) {
+    // the index is filled as dialogs are loaded from the database
+    TRY_STATUS(create_dialogs_fts_table(db));
+  }
 
   return Status::OK();
 }
@@ -118,6 +133,7 @@ Status drop_dialog_db(SqliteDb &db, int version) {
   }
   auto status = db.exec("DROP TABLE IF EXISTS dialogs");
   TRY_STATUS(db.exec("DROP TABLE IF EXISTS notification_groups"));
+  TRY_STATUS(db.exec("DROP TABLE IF EXISTS dialogs_fts"));
   return status;
 }
 
@@ -155,6 +171,14 @@ class DialogDbImpl final : public DialogDbSyncInterface {
         get_secret_chat_count_stmt_,
         db_.get_statement(
             "SELECT COUNT(*) FROM dialogs WHERE folder_id = ?1 AND dialog_order > 0 AND dialog_id < -1500000000000"));
+    TRY_RESULT_ASSIGN(get_dialog_search_text_stmt_, db_.get_statement("SELECT text FROM dialogs_fts WHERE rowid = ?1"));
+    TRY_RESULT_ASSIGN(delete_dialog_search_text_stmt_, db_.get_statement("DELETE FROM dialogs_fts WHERE rowid = ?1"));
+    TRY_RESULT_ASSIGN(add_dialog_search_text_stmt_,
+                      db_.get_statement("INSERT INTO dialogs_fts(rowid, text) VALUES(?1, ?2)"));
+    TRY_RESULT_ASSIGN(search_dialogs_stmt_,
+                      db_.get_statement("SELECT dialog_id FROM dialogs WHERE dialog_id IN (SELECT rowid FROM "
+                                        "dialogs_fts WHERE dialogs_fts MATCH ?1) AND dialog_order > 0 ORDER BY "
+                                        "dialog_order DESC, dialog_id DESC LIMIT ?2"));
 
     // LOG(ERROR) << get_dialog_stmt_.explain().ok();
     // LOG(ERROR) << get_dialogs_stmt_.explain().ok();
@@ -172,6 +196,7 @@ class DialogDbImpl final : public DialogDbSyncInterface {
     };
     add_dialog_stmt_.bind_int64(1, dialog_id.get()).ensure();
     add_dialog_stmt_.bind_int64(2, order).ensure();
+    data = DbBlobCompression::compress(std::move(data));
     add_dialog_stmt_.bind_blob(3, data.as_slice()).ensure();
     if (order > 0) {
       add_dialog_stmt_.bind_int32(4, folder_id.get()).ensure();
@@ -214,7 +239,7 @@ class DialogDbImpl final : public DialogDbSyncInterface {
     if (!get_dialog_stmt_.has_row()) {
       return Status::Error("Not found");
     }
-    return BufferSlice(get_dialog_stmt_.view_blob(0));
+    return DbBlobCompression::decompress(get_dialog_stmt_.view_blob(0));
   }
 
   Result<NotificationGroupKey> get_notification_group(NotificationGroupId notification_group_id) final {
@@ -255,17 +280,88 @@ class DialogDbImpl final : public DialogDbSyncInterface {
     result.next_order = order;
     get_dialogs_stmt_.step().ensure();
     while (get_dialogs_stmt_.has_row()) {
-      BufferSlice data(get_dialogs_stmt_.view_blob(0));
+      auto data = DbBlobCompression::decompress(get_dialogs_stmt_.view_blob(0));
       result.next_dialog_id = DialogId(get_dialogs_stmt_.view_int64(1));
       result.next_order = get_dialogs_stmt_.view_int64(2);
       LOG(INFO) << "Load " << result.next_dialog_id << " with order " << result.next_order;
       result.dialogs.emplace_back(std::move(data));
+      result.dialog_ids.push_back(result.next_dialog_id);
       get_dialogs_stmt_.step().ensure();
     }
 
     return result;
   }
 
+  void set_dialog_search_text(DialogId dialog_id, string text) final {
+    text = utf8_prepare_search_string(text);
+    {
+      SCOPE_EXIT {
+        get_dialog_search_text_stmt_.reset();
+      };
+      get_dialog_search_text_stmt_.bind_int64(1, dialog_id.get()).ensure();
+      get_dialog_search_text_stmt_.step().ensure();
+      if (get_dialog_search_text_stmt_.has_row() && get_dialog_search_text_stmt_.view_string(0) == text) {
+        // the dialog is re-added to the index on every load, so unchanged texts must not be rewritten
+        return;
+      }
+    }
+    {
+      SCOPE_EXIT {
+        delete_dialog_search_text_stmt_.reset();
+      };
+      delete_dialog_search_text_stmt_.bind_int64(1, dialog_id.get()).ensure();
+      delete_dialog_search_text_stmt_.step().ensure();
+    }
+    if (text.empty()) {
+      return;
+    }
+    SCOPE_EXIT {
+      add_dialog_search_text_stmt_.reset();
+    };
+    add_dialog_search_text_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    add_dialog_search_text_stmt_.bind_string(2, text).ensure();
+    add_dialog_search_text_stmt_.step().ensure();
+  }
+
+  vector<DialogId> search_dialogs(const string &query, int32 limit) final {
+    SCOPE_EXIT {
+      search_dialogs_stmt_.reset();
+    };
+
+    // every query word must be a prefix of some word of the dialog, as in Hints
+    string words;
+    for (auto &word : utf8_get_search_words(query)) {
+      if (!words.empty()) {
+        words += ' ';
+      }
+      words += '"';
+      for (auto c : word) {
+        if (c == '"') {
+          words += '"';
+        }
+        words += c;
+      }
+      words += "\"*";
+    }
+
+    vector<DialogId> result;
+    if (words.empty()) {
+      return result;
+    }
+    search_dialogs_stmt_.bind_string(1, words).ensure();
+    search_dialogs_stmt_.bind_int32(2, limit).ensure();
+    auto status = search_dialogs_stmt_.step();
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to search for chats with " << tag("query", words) << ": " << status;
+      return result;
+    }
+    while (search_dialogs_stmt_.has_row()) {
+      result.push_back(DialogId(search_dialogs_stmt_.view_int64(0)));
+      search_dialogs_stmt_.step().ensure();
+    }
+    return result;
+  }
+
   vector<NotificationGroupKey> get_notification_groups_by_last_notification_date(
       NotificationGroupKey notification_group_key, int32 limit) final {
     auto &stmt = get_notification_groups_by_last_notification_date_stmt_;
@@ -310,6 +406,10 @@ class DialogDbImpl final : public DialogDbSyncInterface {
   SqliteStatement get_notification_groups_by_last_notification_date_stmt_;
   SqliteStatement get_notification_group_stmt_;
   SqliteStatement get_secret_chat_count_stmt_;
+  SqliteStatement get_dialog_search_text_stmt_;
+  SqliteStatement delete_dialog_search_text_stmt_;
+  SqliteStatement add_dialog_search_text_stmt_;
+  SqliteStatement search_dialogs_stmt_;
 
   static int32 get_last_notification_date(SqliteStatement &stmt, int id) {
     if (stmt.view_datatype(id) == SqliteStatement::Datatype::Null) {
@@ -340,8 +440,9 @@ std::shared_ptr<DialogDbSyncSafeInterface> create_dialog_db_sync(
 
 class DialogDbAsync final : public DialogDbAsyncInterface {
  public:
-  DialogDbAsync(std::shared_ptr<DialogDbSyncSafeInterface> sync_db, int32 scheduler_id) {
-    impl_ = create_actor_on_scheduler<Impl>("DialogDbActor", scheduler_id, std::move(sync_db));
+  DialogDbAsync(std::shared_ptr<DialogDbSyncSafeInterface> sync_db, int32 scheduler_id,
+                std::shared_ptr<SqliteReadPool> read_pool) {
+    impl_ = create_actor_on_scheduler<Impl>("DialogDbActor", scheduler_id, std::move(sync_db), std::move(read_pool));
   }
 
   void add_dialog(DialogId dialog_id, FolderId folder_id, int64 order, BufferSlice data,
@@ -350,6 +451,14 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
                  std::move(promise));
   }
 
+  void set_dialog_search_text(DialogId dialog_id, string text, Promise<Unit> promise) final {
+    send_closure(impl_, &Impl::set_dialog_search_text, dialog_id, std::move(text), std::move(promise));
+  }
+
+  void search_dialogs(string query, int32 limit, Promise<vector<DialogId>> promise) final {
+    send_closure_later(impl_, &Impl::search_dialogs, std::move(query), limit, std::move(promise));
+  }
+
   void get_notification_groups_by_last_notification_date(NotificationGroupKey notification_group_key, int32 limit,
                                                          Promise<vector<NotificationGroupKey>> promise) final {
     send_closure(impl_, &Impl::get_notification_groups_by_last_notification_date, notification_group_key, limit,
@@ -384,7 +493,8 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
  private:
   class Impl final : public Actor {
    public:
-    explicit Impl(std::shared_ptr<DialogDbSyncSafeInterface> sync_db_safe) : sync_db_safe_(std::move(sync_db_safe)) {
+    Impl(std::shared_ptr<DialogDbSyncSafeInterface> sync_db_safe, std::shared_ptr<SqliteReadPool> read_pool)
+        : sync_db_safe_(std::move(sync_db_safe)), read_pool_(std::move(read_pool)) {
     }
 
     void add_dialog(DialogId dialog_id, FolderId folder_id, int64 order, BufferSlice data,
@@ -396,6 +506,20 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
       });
     }
 
+    void set_dialog_search_text(DialogId dialog_id, string text, Promise<Unit> promise) {
+      add_write_query([this, dialog_id, text = std::move(text), promise = std::move(promise)](Unit) mutable {
+        sync_db_->set_dialog_search_text(dialog_id, std::move(text));
+        on_write_result(std::move(promise));
+      });
+    }
+
+    void search_dialogs(string query, int32 limit, Promise<vector<DialogId>> promise) {
+      add_read_query(
+          [query = std::move(query), limit, promise = std::move(promise)](DialogDbSyncInterface &db) mutable {
+            promise.set_value(db.search_dialogs(query, limit));
+          });
+    }
+
     void on_write_result(Promise<Unit> &&promise) {
       // We are inside a transaction and don't know how to handle errors
       finished_writes_.push_back(std::move(promise));
@@ -403,67 +527,75 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
 
     void get_notification_groups_by_last_notification_date(NotificationGroupKey notification_group_key, int32 limit,
                                                            Promise<vector<NotificationGroupKey>> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_notification_groups_by_last_notification_date(notification_group_key, limit));
+      add_read_query(
+          [notification_group_key, limit, promise = std::move(promise)](DialogDbSyncInterface &db) mutable {
+            promise.set_value(db.get_notification_groups_by_last_notification_date(notification_group_key, limit));
+          });
     }
 
     void get_notification_group(NotificationGroupId notification_group_id, Promise<NotificationGroupKey> promise) {
-      add_read_query();
-      promise.set_result(sync_db_->get_notification_group(notification_group_id));
+      add_read_query([notification_group_id, promise = std::move(promise)](DialogDbSyncInterface &db) mutable {
+        promise.set_result(db.get_notification_group(notification_group_id));
+      });
     }
 
     void get_secret_chat_count(FolderId folder_id, Promise<int32> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_secret_chat_count(folder_id));
+      add_read_query([folder_id, promise = std::move(promise)](DialogDbSyncInterface &db) mutable {
+        promise.set_value(db.get_secret_chat_count(folder_id));
+      });
     }
 
     void get_dialog(DialogId dialog_id, Promise<BufferSlice> promise) {
-      add_read_query();
-      promise.set_result(sync_db_->get_dialog(dialog_id));
+      add_read_query([dialog_id, promise = std::move(promise)](DialogDbSyncInterface &db) mutable {
+        promise.set_result(db.get_dialog(dialog_id));
+      });
     }
 
     void get_dialogs(FolderId folder_id, int64 order, DialogId dialog_id, int32 limit,
                      Promise<DialogDbGetDialogsResult> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_dialogs(folder_id, order, dialog_id, limit));
+      add_read_query(
+          [folder_id, order, dialog_id, limit, promise = std::move(promise)](DialogDbSyncInterface &db) mutable {
+            promise.set_value(db.get_dialogs(folder_id, order, dialog_id, limit));
+          });
     }
 
     void close(Promise<Unit> promise) {
       do_flush();
       sync_db_safe_.reset();
       sync_db_ = nullptr;
-      promise.set_value(Unit());
+      if (read_pool_ != nullptr) {
+        // wait for all running read queries
+        read_pool_->flush(std::move(promise));
+        read_pool_.reset();
+      } else {
+        promise.set_value(Unit());
+      }
       stop();
     }
 
     void force_flush() {
       do_flush();
-      LOG(INFO) << "DialogDb flushed";
+      LOG(INFO) << "DialogDb flushed with " << write_batcher_.get_stats();
     }
 
    private:
     std::shared_ptr<DialogDbSyncSafeInterface> sync_db_safe_;
     DialogDbSyncInterface *sync_db_ = nullptr;
+    std::shared_ptr<SqliteReadPool> read_pool_;
 
-    static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
-    static constexpr double MAX_PENDING_QUERIES_DELAY{0.01};
+    WriteBatcher write_batcher_;
 
     //NB: order is important, destructor of pending_writes_ will change finished_writes_
     vector<Promise<Unit>> finished_writes_;
     vector<Promise<Unit>> pending_writes_;  // TODO use Action
-    double wakeup_at_ = 0;
 
     template <class F>
     void add_write_query(F &&f) {
       pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f)));
-      if (pending_writes_.size() > MAX_PENDING_QUERIES_COUNT) {
+      if (write_batcher_.need_flush(pending_writes_.size())) {
         do_flush();
-        wakeup_at_ = 0;
-      } else if (wakeup_at_ == 0) {
-        wakeup_at_ = Time::now_cached() + MAX_PENDING_QUERIES_DELAY;
-      }
-      if (wakeup_at_ != 0) {
-        set_timeout_at(wakeup_at_);
+      } else if (pending_writes_.size() == 1) {
+        set_timeout_at(write_batcher_.get_flush_time(Time::now_cached()));
       }
     }
 
@@ -471,13 +603,27 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
       do_flush();
     }
 
+    template <class F>
+    void add_read_query(F &&f) {
+      // the query must see all previous writes, so they are committed first
+      add_read_query();
+      if (read_pool_ == nullptr) {
+        f(*sync_db_);
+        return;
+      }
+      read_pool_->run([sync_db_safe = sync_db_safe_, f = std::forward<F>(f)]() mutable { f(sync_db_safe->get()); });
+    }
+
     void do_flush() {
       if (pending_writes_.empty()) {
         return;
       }
+      auto batch_size = pending_writes_.size();
+      auto start_time = Time::now();
       sync_db_->begin_write_transaction().ensure();
       set_promises(pending_writes_);
       sync_db_->commit_transaction().ensure();
+      write_batcher_.on_commit(batch_size, Time::now() - start_time);
       set_promises(finished_writes_);
       cancel_timeout();
     }
@@ -494,8 +640,9 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
 };
 
 std::shared_ptr<DialogDbAsyncInterface> create_dialog_db_async(std::shared_ptr<DialogDbSyncSafeInterface> sync_db,
-                                                               int32 scheduler_id) {
-  return std::make_shared<DialogDbAsync>(std::move(sync_db), scheduler_id);
+                                                               int32 scheduler_id,
+                                                               std::shared_ptr<SqliteReadPool> read_pool) {
+  return std::make_shared<DialogDbAsync>(std::move(sync_db), scheduler_id, std::move(read_pool));
 }
 
 }  // namespace td
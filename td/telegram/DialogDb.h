@@ -25,9 +25,11 @@ namespace td {
 
 class SqliteConnectionSafe;
 class SqliteDb;
+class SqliteReadPool;
 
 struct DialogDbGetDialogsResult {
   vector<BufferSlice> dialogs;
+  vector<DialogId> dialog_ids;
   int64 next_order = 0;
   DialogId next_dialog_id;
 };
@@ -53,6 +55,11 @@ class DialogDbSyncInterface {
 
   virtual int32 get_secret_chat_count(FolderId folder_id) = 0;
 
+  virtual void set_dialog_search_text(DialogId dialog_id, string text) = 0;
+
+  // returns identifiers of dialogs from the database, which have words starting with all the query words
+  virtual vector<DialogId> search_dialogs(const string &query, int32 limit) = 0;
+
   virtual Status begin_read_transaction() = 0;
   virtual Status begin_write_transaction() = 0;
   virtual Status commit_transaction() = 0;
@@ -92,6 +99,10 @@ class DialogDbAsyncInterface {
 
   virtual void get_secret_chat_count(FolderId folder_id, Promise<int32> promise) = 0;
 
+  virtual void set_dialog_search_text(DialogId dialog_id, string text, Promise<Unit> promise) = 0;
+
+  virtual void search_dialogs(string query, int32 limit, Promise<vector<DialogId>> promise) = 0;
+
   virtual void close(Promise<Unit> promise) = 0;
 
   virtual void force_flush() = 0;
@@ -104,7 +115,9 @@ Status drop_dialog_db(SqliteDb &db, int version) TD_WARN_UNUSED_RESULT;
 std::shared_ptr<DialogDbSyncSafeInterface> create_dialog_db_sync(
     std::shared_ptr<SqliteConnectionSafe> sqlite_connection);
 
+// if read_pool is specified, read queries are run by it instead of the database actor
 std::shared_ptr<DialogDbAsyncInterface> create_dialog_db_async(std::shared_ptr<DialogDbSyncSafeInterface> sync_db,
-                                                               int32 scheduler_id = -1);
+                                                               int32 scheduler_id = -1,
+                                                               std::shared_ptr<SqliteReadPool> read_pool = nullptr);
 
 }  // namespace td
@@ -42,11 +42,17 @@ struct FileDownloadInDatabase {
   int32 created_at{};
   int32 completed_at{};
   bool is_paused{};
+  bool has_search_text{};
+  string search_text;
 
   template <class StorerT>
   void store(StorerT &storer) const {
+    bool has_non_empty_search_text = has_search_text && !search_text.empty();
+    bool has_empty_search_text = has_search_text && search_text.empty();
     BEGIN_STORE_FLAGS();
     STORE_FLAG(is_paused);
+    STORE_FLAG(has_non_empty_search_text);
+    STORE_FLAG(has_empty_search_text);
     END_STORE_FLAGS();
     td::store(download_id, storer);
     td::store(file_id, storer);
@@ -54,12 +60,19 @@ struct FileDownloadInDatabase {
     td::store(priority, storer);
     td::store(created_at, storer);
     td::store(completed_at, storer);
+    if (has_non_empty_search_text) {
+      td::store(search_text, storer);
+    }
   }
 
   template <class ParserT>
   void parse(ParserT &parser) {
+    bool has_non_empty_search_text;
+    bool has_empty_search_text;
     BEGIN_PARSE_FLAGS();
     PARSE_FLAG(is_paused);
+    PARSE_FLAG(has_non_empty_search_text);
+    PARSE_FLAG(has_empty_search_text);
     END_PARSE_FLAGS();
     td::parse(download_id, parser);
     td::parse(file_id, parser);
@@ -67,6 +80,10 @@ struct FileDownloadInDatabase {
     td::parse(priority, parser);
     td::parse(created_at, parser);
     td::parse(completed_at, parser);
+    if (has_non_empty_search_text) {
+      td::parse(search_text, parser);
+    }
+    has_search_text = has_non_empty_search_text || has_empty_search_text;
   }
 };
 
@@ -153,8 +170,10 @@ class DownloadManagerImpl final : public DownloadManager {
     file_info->priority = priority;
     file_info->created_at = G()->unix_time();
     file_info->need_save_to_database = true;
+    file_info->has_search_text = true;
+    file_info->search_text = std::move(search_text);
 
-    add_file_info(std::move(file_info), search_text);
+    add_file_info(std::move(file_info));
 
     promise.set_value(callback_->get_file_object(file_id));
   }
@@ -171,8 +190,7 @@ class DownloadManagerImpl final : public DownloadManager {
     if (r_file_info_ptr.is_error()) {
       return;
     }
-    auto &file_info = *r_file_info_ptr.ok();
-    hints_.add(file_info.download_id, search_text.empty() ? string(" ") : search_text);
+    set_search_text(*r_file_info_ptr.ok(), std::move(search_text));
   }
 
   void hints_synchronized(Result<Unit>) {
@@ -328,6 +346,8 @@ class DownloadManagerImpl final : public DownloadManager {
     bool is_counted{};
     mutable bool is_registered{};
     mutable bool need_save_to_database{};
+    bool has_search_text{};
+    string search_text;
     int64 size{};
     int64 expected_size{};
     int64 downloaded_size{};
@@ -394,6 +414,8 @@ class DownloadManagerImpl final : public DownloadManager {
     to_save.created_at = file_info.created_at;
     to_save.completed_at = file_info.completed_at;
     to_save.file_id = file_info.file_id;
+    to_save.has_search_text = file_info.has_search_text;
+    to_save.search_text = file_info.search_text;
     G()->td_db()->get_binlog_pmc()->set(pmc_key(file_info), log_event_store(to_save).as_slice().str());
   }
 
@@ -446,8 +468,10 @@ class DownloadManagerImpl final : public DownloadManager {
     file_info->priority = narrow_cast<int8>(in_db.priority);
     file_info->completed_at = in_db.completed_at;
     file_info->created_at = in_db.created_at;
+    file_info->has_search_text = in_db.has_search_text;
+    file_info->search_text = std::move(in_db.search_text);
 
-    add_file_info(std::move(file_info), "");
+    add_file_info(std::move(file_info));
   }
 
   void load_database_files(const char *source) {
@@ -473,7 +497,7 @@ class DownloadManagerImpl final : public DownloadManager {
       log_event_parse(in_db, value).ensure();
       CHECK(in_db.download_id == to_integer_safe<int64>(key).ok());
       max_download_id_ = max(in_db.download_id, max_download_id_);
-      add_file_from_database(in_db);
+      add_file_from_database(std::move(in_db));
     }
 
     is_database_loaded_ = true;
@@ -485,8 +509,12 @@ class DownloadManagerImpl final : public DownloadManager {
   }
 
   void prepare_hints() {
+    // search text is saved to the database, so it needs to be requested only for downloads from older versions
     for (auto &it : files_) {
       const auto &file_info = *it.second;
+      if (file_info.has_search_text) {
+        continue;
+      }
       auto promise =
           PromiseCreator::lambda([actor_id = actor_id(this), promise = load_search_text_multipromise_.get_promise(),
                                   download_id = it.first](Result<string> r_search_text) mutable {
@@ -508,14 +536,26 @@ class DownloadManagerImpl final : public DownloadManager {
         remove_file_impl(it->second->file_id, {}, false, "add_download_to_hints");
       }
     } else {
-      auto search_text = r_search_text.move_as_ok();
       // TODO: This is a race. Synchronous call would be better.
-      hints_.add(download_id, search_text.empty() ? string(" ") : search_text);
+      set_search_text(*it->second, r_search_text.move_as_ok());
     }
     promise.set_value(Unit());
   }
 
-  void add_file_info(unique_ptr<FileInfo> &&file_info, const string &search_text) {
+  void set_search_text(const FileInfo &file_info, string search_text) {
+    hints_.add(file_info.download_id, search_text.empty() ? string(" ") : search_text);
+    if (file_info.has_search_text && file_info.search_text == search_text) {
+      return;
+    }
+
+    with_file_info(file_info, [&](FileInfo &file_info) {
+      file_info.has_search_text = true;
+      file_info.search_text = std::move(search_text);
+      file_info.need_save_to_database = true;
+    });
+  }
+
+  void add_file_info(unique_ptr<FileInfo> &&file_info) {
     CHECK(file_info != nullptr);
     auto download_id = file_info->download_id;
     file_info->internal_file_id = callback_->dup_file_id(file_info->file_id);
@@ -535,7 +575,7 @@ class DownloadManagerImpl final : public DownloadManager {
 
     by_internal_file_id_[file_info->internal_file_id] = download_id;
     by_file_id_[file_info->file_id] = download_id;
-    hints_.add(download_id, search_text.empty() ? string(" ") : search_text);
+    hints_.add(download_id, file_info->search_text.empty() ? string(" ") : file_info->search_text);
     file_info->link_token = ++last_link_token_;
 
     LOG(INFO) << "Adding to downloads file " << file_info->file_id << '/' << file_info->internal_file_id << " of size "
@@ -11,6 +11,7 @@
 #include "td/telegram/BackgroundManager.h"
 #include "td/telegram/ConfigManager.h"
 #include "td/telegram/ContactsManager.h"
+#include "td/telegram/DialogId.h"
 #include "td/telegram/files/FileManager.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/MessagesManager.h"
@@ -34,6 +35,9 @@ namespace td {
 int VERBOSITY_NAME(file_references) = VERBOSITY_NAME(INFO);
 
 FileReferenceManager::FileReferenceManager(ActorShared<> parent) : parent_(std::move(parent)) {
+  get_messages_queries_.set_merge_function([this](vector<int64> query_ids, Promise<Unit> &&promise) {
+    send_get_messages_query(std::move(query_ids), std::move(promise));
+  });
 }
 
 FileReferenceManager::~FileReferenceManager() {
@@ -305,6 +309,10 @@ void FileReferenceManager::send_query(Destination dest, FileSourceId file_source
   CHECK(index < file_sources_.size());
   file_sources_[index].visit(overloaded(
       [&](const FileSourceMessage &source) {
+        auto query_merger = get_message_query_merger(source.full_message_id);
+        if (query_merger != nullptr) {
+          return query_merger->add_query(file_source_id.get(), std::move(promise));
+        }
         send_closure_later(G()->messages_manager(), &MessagesManager::get_message_from_server, source.full_message_id,
                            std::move(promise), "FileSourceMessage", nullptr);
       },
@@ -373,6 +381,45 @@ void FileReferenceManager::send_query(Destination dest, FileSourceId file_source
       }));
 }
 
+QueryMerger *FileReferenceManager::get_message_query_merger(FullMessageId full_message_id) {
+  auto message_id = full_message_id.get_message_id();
+  if (!message_id.is_valid() || !message_id.is_server()) {
+    return nullptr;
+  }
+  auto dialog_id = full_message_id.get_dialog_id();
+  switch (dialog_id.get_type()) {
+    case DialogType::User:
+    case DialogType::Chat:
+      return &get_messages_queries_;
+    case DialogType::Channel: {
+      // messages from different channels are requested separately, so merge only messages from the same channel
+      // to not fail repairing of all of them if one of the channels becomes inaccessible
+      auto &query_merger = get_channel_messages_queries_[dialog_id.get_channel_id()];
+      if (query_merger == nullptr) {
+        query_merger = make_unique<QueryMerger>("GetFileSourceChannelMessagesMerger", 1, 100);
+        query_merger->set_merge_function([this](vector<int64> query_ids, Promise<Unit> &&promise) {
+          send_get_messages_query(std::move(query_ids), std::move(promise));
+        });
+      }
+      return query_merger.get();
+    }
+    default:
+      return nullptr;
+  }
+}
+
+void FileReferenceManager::send_get_messages_query(vector<int64> file_source_ids, Promise<Unit> &&promise) {
+  TRY_STATUS_PROMISE(promise, G()->close_status());
+  auto full_message_ids = transform(file_source_ids, [this](int64 file_source_id) {
+    auto index = static_cast<size_t>(file_source_id) - 1;
+    CHECK(index < file_sources_.size());
+    return file_sources_[index].get<FileSourceMessage>().full_message_id;
+  });
+  VLOG(file_references) << "Repair file references from " << full_message_ids;
+  send_closure_later(G()->messages_manager(), &MessagesManager::get_messages_from_server, std::move(full_message_ids),
+                     std::move(promise), "FileSourceMessages", nullptr);
+}
+
 FileReferenceManager::Destination FileReferenceManager::on_query_result(Destination dest, FileSourceId file_source_id,
                                                                         Status status, int32 sub) {
   if (G()->close_flag()) {
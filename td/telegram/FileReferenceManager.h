@@ -13,6 +13,7 @@
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/FullMessageId.h"
 #include "td/telegram/PhotoSizeSource.h"
+#include "td/telegram/QueryMerger.h"
 #include "td/telegram/SetWithPosition.h"
 #include "td/telegram/td_api.h"
 #include "td/telegram/UserId.h"
@@ -20,6 +21,7 @@
 #include "td/actor/actor.h"
 
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/logging.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
@@ -182,12 +184,18 @@ class FileReferenceManager final : public Actor {
 
   WaitFreeHashMap<NodeId, unique_ptr<Node>, FileIdHash> nodes_;
 
+  // repair queries for message sources are merged into messages.getMessages and channels.getMessages requests
+  QueryMerger get_messages_queries_{"GetFileSourceMessagesMerger", 3, 100};
+  FlatHashMap<ChannelId, unique_ptr<QueryMerger>, ChannelIdHash> get_channel_messages_queries_;
+
   ActorShared<> parent_;
 
   Node &add_node(NodeId node_id);
 
   void run_node(NodeId node);
   void send_query(Destination dest, FileSourceId file_source_id);
+  QueryMerger *get_message_query_merger(FullMessageId full_message_id);
+  void send_get_messages_query(vector<int64> file_source_ids, Promise<Unit> &&promise);
   Destination on_query_result(Destination dest, FileSourceId file_source_id, Status status, int32 sub = 0);
 
   template <class T>
@@ -433,7 +433,6 @@ void ForumTopicManager::Topic::store(StorerT &storer) const {
 
 template <class ParserT>
 void ForumTopicManager::Topic::parse(ParserT &parser) {
-  CHECK(info_ != nullptr);
   using td::parse;
 
   int32 magic;
@@ -887,7 +886,10 @@ void ForumTopicManager::on_delete_forum_topic(DialogId dialog_id, MessageId top_
 }
 
 void ForumTopicManager::delete_all_dialog_topics(DialogId dialog_id) {
-  dialog_topics_.erase(dialog_id);
+  // keep the dialog to ignore topics, which can still be read from the database before they are deleted
+  auto new_dialog_topics = make_unique<DialogTopics>();
+  new_dialog_topics->are_database_topics_deleted_ = true;
+  dialog_topics_.set(dialog_id, std::move(new_dialog_topics));
 
   auto message_thread_db = G()->td_db()->get_message_thread_db_async();
   if (message_thread_db == nullptr) {
@@ -923,7 +925,7 @@ void ForumTopicManager::on_get_forum_topic_info(DialogId dialog_id, const ForumT
   auto forum_topic_info = td::make_unique<ForumTopicInfo>(topic_info);
   MessageId top_thread_message_id = forum_topic_info->get_top_thread_message_id();
   CHECK(can_be_message_thread_id(top_thread_message_id).is_ok());
-  auto topic = add_topic(dialog_topics, top_thread_message_id);
+  auto topic = add_topic(dialog_id, dialog_topics, top_thread_message_id);
   if (topic == nullptr) {
     return;
   }
@@ -950,7 +952,7 @@ void ForumTopicManager::on_get_forum_topic_infos(DialogId dialog_id,
     if (can_be_message_thread_id(top_thread_message_id).is_error()) {
       continue;
     }
-    auto topic = add_topic(dialog_topics, top_thread_message_id);
+    auto topic = add_topic(dialog_id, dialog_topics, top_thread_message_id);
     if (topic != nullptr) {
       set_topic_info(dialog_id, topic, std::move(forum_topic_info));
       save_topic_to_database(dialog_id, topic);
@@ -1047,8 +1049,9 @@ ForumTopicManager::DialogTopics *ForumTopicManager::get_dialog_topics(DialogId d
   return dialog_topics_.get_pointer(dialog_id);
 }
 
-ForumTopicManager::Topic *ForumTopicManager::add_topic(DialogTopics *dialog_topics, MessageId top_thread_message_id) {
-  auto topic = dialog_topics->topics_.get_pointer(top_thread_message_id);
+ForumTopicManager::Topic *ForumTopicManager::add_topic(DialogId dialog_id, DialogTopics *dialog_topics,
+                                                       MessageId top_thread_message_id) {
+  auto topic = load_topic_from_database(dialog_id, dialog_topics, top_thread_message_id);
   if (topic == nullptr) {
     if (dialog_topics->deleted_topic_ids_.count(top_thread_message_id) > 0) {
       return nullptr;
@@ -1064,16 +1067,48 @@ ForumTopicManager::Topic *ForumTopicManager::get_topic(DialogTopics *dialog_topi
   return dialog_topics->topics_.get_pointer(top_thread_message_id);
 }
 
+ForumTopicManager::Topic *ForumTopicManager::load_topic_from_database(DialogId dialog_id, DialogTopics *dialog_topics,
+                                                                      MessageId top_thread_message_id) {
+  if (dialog_topics != nullptr) {
+    auto topic = get_topic(dialog_topics, top_thread_message_id);
+    if (topic != nullptr || dialog_topics->are_database_topics_deleted_ ||
+        dialog_topics->deleted_topic_ids_.count(top_thread_message_id) > 0) {
+      return topic;
+    }
+  }
+  if (G()->td_db()->get_message_thread_db_async() == nullptr || td_->auth_manager_->is_bot() ||
+      !can_be_forum(dialog_id) || can_be_message_thread_id(top_thread_message_id).is_error()) {
+    return nullptr;
+  }
+
+  auto value = G()->td_db()->get_message_thread_db_sync()->get_message_thread(dialog_id, top_thread_message_id);
+  if (value.empty()) {
+    return nullptr;
+  }
+  auto topic = make_unique<Topic>();
+  if (log_event_parse(*topic, value.as_slice()).is_error() || topic->info_ == nullptr ||
+      topic->info_->get_top_thread_message_id() != top_thread_message_id) {
+    LOG(ERROR) << "Failed to load topic of " << top_thread_message_id << " in " << dialog_id << " from database";
+    delete_topic_from_database(dialog_id, top_thread_message_id, Promise<Unit>());
+    return nullptr;
+  }
+  LOG(INFO) << "Loaded topic of " << top_thread_message_id << " in " << dialog_id << " from database";
+  topic->need_save_to_database_ = false;
+
+  if (dialog_topics == nullptr) {
+    dialog_topics = add_dialog_topics(dialog_id);
+  }
+  auto result = topic.get();
+  dialog_topics->topics_.set(top_thread_message_id, std::move(topic));
+  return result;
+}
+
 ForumTopicManager::Topic *ForumTopicManager::add_topic(DialogId dialog_id, MessageId top_thread_message_id) {
-  return add_topic(add_dialog_topics(dialog_id), top_thread_message_id);
+  return add_topic(dialog_id, add_dialog_topics(dialog_id), top_thread_message_id);
 }
 
 ForumTopicManager::Topic *ForumTopicManager::get_topic(DialogId dialog_id, MessageId top_thread_message_id) {
-  auto *dialog_topics = dialog_topics_.get_pointer(dialog_id);
-  if (dialog_topics == nullptr) {
-    return nullptr;
-  }
-  return dialog_topics->topics_.get_pointer(top_thread_message_id);
+  return load_topic_from_database(dialog_id, dialog_topics_.get_pointer(dialog_id), top_thread_message_id);
 }
 
 const ForumTopicManager::Topic *ForumTopicManager::get_topic(DialogId dialog_id,
@@ -1136,7 +1171,8 @@ void ForumTopicManager::save_topic_to_database(DialogId dialog_id, const Topic *
 
   auto top_thread_message_id = topic->info_->get_top_thread_message_id();
   LOG(INFO) << "Save topic of " << top_thread_message_id << " in " << dialog_id << " to database";
-  message_thread_db->add_message_thread(dialog_id, top_thread_message_id, 0, log_event_store(*topic), Auto());
+  message_thread_db->add_message_thread(dialog_id, top_thread_message_id, top_thread_message_id.get(),
+                                        log_event_store(*topic), Auto());
 }
 
 void ForumTopicManager::delete_topic_from_database(DialogId dialog_id, MessageId top_thread_message_id,
@@ -1160,7 +1196,7 @@ void ForumTopicManager::on_topic_message_count_changed(DialogId dialog_id, Messa
   LOG(INFO) << "Change by " << diff << " number of loaded messages in thread of " << top_thread_message_id << " in "
             << dialog_id;
   auto dialog_topics = add_dialog_topics(dialog_id);
-  auto topic = add_topic(dialog_topics, top_thread_message_id);
+  auto topic = add_topic(dialog_id, dialog_topics, top_thread_message_id);
   if (topic == nullptr) {
     return;
   }
@@ -130,9 +130,11 @@ class ForumTopicManager final : public Actor {
     int32 MAGIC = 0x1fac3901;
   };
 
+  // topics are kept in memory only while they have loaded messages and are loaded from the database on demand
   struct DialogTopics {
     WaitFreeHashMap<MessageId, unique_ptr<Topic>, MessageIdHash> topics_;
     WaitFreeHashSet<MessageId, MessageIdHash> deleted_topic_ids_;
+    bool are_database_topics_deleted_ = false;
   };
 
   void tear_down() final;
@@ -147,10 +149,12 @@ class ForumTopicManager final : public Actor {
 
   DialogTopics *get_dialog_topics(DialogId dialog_id);
 
-  static Topic *add_topic(DialogTopics *dialog_topics, MessageId top_thread_message_id);
+  Topic *add_topic(DialogId dialog_id, DialogTopics *dialog_topics, MessageId top_thread_message_id);
 
   static Topic *get_topic(DialogTopics *dialog_topics, MessageId top_thread_message_id);
 
+  Topic *load_topic_from_database(DialogId dialog_id, DialogTopics *dialog_topics, MessageId top_thread_message_id);
+
   Topic *add_topic(DialogId dialog_id, MessageId top_thread_message_id);
 
   Topic *get_topic(DialogId dialog_id, MessageId top_thread_message_id);
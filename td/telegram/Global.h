@@ -10,6 +10,7 @@
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/MtprotoHeader.h"
 #include "td/telegram/net/NetQueryCreator.h"
+#include "td/telegram/OptionId.h"
 #include "td/telegram/TdParameters.h"
 
 #include "td/net/NetStats.h"
@@ -145,6 +146,10 @@ class Global final : public ActorContext {
 
   string get_option_string(Slice name, string default_value = "") const;
 
+  bool get_option_boolean(OptionId option_id, bool default_value = false) const;
+
+  int64 get_option_integer(OptionId option_id, int64 default_value = 0) const;
+
   bool is_server_time_reliable() const {
     return server_time_difference_was_updated_;
   }
@@ -948,6 +948,7 @@ struct GroupCallManager::GroupCall {
 
 struct GroupCallManager::GroupCallParticipants {
   vector<GroupCallParticipant> participants;
+  FlatHashMap<DialogId, size_t, DialogIdHash> participant_positions;  // dialog_id -> index in participants
   string next_offset;
   GroupCallParticipantOrder min_order = GroupCallParticipantOrder::max();
   bool joined_date_asc = false;
@@ -961,6 +962,35 @@ struct GroupCallManager::GroupCallParticipants {
   };
   std::map<int32, PendingUpdates> pending_version_updates_;
   std::map<int32, PendingUpdates> pending_mute_updates_;
+
+  // returns participants.size() if the participant isn't found
+  size_t find_participant(DialogId dialog_id) const {
+    auto it = participant_positions.find(dialog_id);
+    return it == participant_positions.end() ? participants.size() : it->second;
+  }
+
+  void add_participant(GroupCallParticipant &&participant) {
+    participant_positions[participant.dialog_id] = participants.size();
+    participants.push_back(std::move(participant));
+  }
+
+  // the order of participants isn't preserved
+  void remove_participant(size_t pos) {
+    CHECK(pos < participants.size());
+    participant_positions.erase(participants[pos].dialog_id);
+    if (pos + 1 != participants.size()) {
+      participants[pos] = std::move(participants.back());
+      participant_positions[participants[pos].dialog_id] = pos;
+    }
+    participants.pop_back();
+  }
+
+  void update_participant_positions() {
+    participant_positions.clear();
+    for (size_t i = 0; i < participants.size(); i++) {
+      participant_positions[participants[i].dialog_id] = i;
+    }
+  }
 };
 
 struct GroupCallManager::GroupCallRecentSpeakers {
@@ -1719,10 +1749,9 @@ GroupCallParticipant *GroupCallManager::get_group_call_participant(GroupCallPart
       }
     }
   } else {
-    for (auto &group_call_participant : group_call_participants->participants) {
-      if (group_call_participant.dialog_id == dialog_id) {
-        return &group_call_participant;
-      }
+    auto pos = group_call_participants->find_participant(dialog_id);
+    if (pos < group_call_participants->participants.size()) {
+      return &group_call_participants->participants[pos];
     }
   }
   return nullptr;
@@ -2149,6 +2178,7 @@ void GroupCallManager::process_group_call_participants(
       group_call_participants->local_unmuted_video_count -= participant.get_has_video();
       participant_it = group_participants.erase(participant_it);
     }
+    group_call_participants->update_participant_positions();
     if (group_call_participants->min_order < min_order) {
       // if previously known more users, adjust min_order
       LOG(INFO) << "Decrease min_order from " << group_call_participants->min_order << " to " << min_order << " in "
@@ -2249,48 +2279,58 @@ std::pair<int32, int32> GroupCallManager::process_group_call_participant(InputGr
   bool can_self_unmute = get_group_call_can_self_unmute(input_group_call_id);
   bool can_manage = can_manage_group_call(input_group_call_id);
   auto *participants = add_group_call_participants(input_group_call_id);
-  for (size_t i = 0; i < participants->participants.size(); i++) {
+  auto i = participants->find_participant(participant.dialog_id);
+  if (i == participants->participants.size() && participant.is_self) {
+    for (i = 0; i < participants->participants.size(); i++) {
+      if (participants->participants[i].is_self) {
+        break;
+      }
+    }
+  }
+  if (i < participants->participants.size()) {
     auto &old_participant = participants->participants[i];
-    if (old_participant.dialog_id == participant.dialog_id || (old_participant.is_self && participant.is_self)) {
-      if (participant.joined_date == 0) {
-        LOG(INFO) << "Remove " << old_participant;
-        if (old_participant.order.is_valid()) {
-          send_update_group_call_participant(input_group_call_id, participant, "process_group_call_participant remove");
-        }
-        on_remove_group_call_participant(input_group_call_id, old_participant.dialog_id);
-        remove_recent_group_call_speaker(input_group_call_id, old_participant.dialog_id);
-        int32 unmuted_video_diff = -old_participant.get_has_video();
-        participants->local_unmuted_video_count += unmuted_video_diff;
-        participants->participants.erase(participants->participants.begin() + i);
-        return {-1, unmuted_video_diff};
+    if (participant.joined_date == 0) {
+      LOG(INFO) << "Remove " << old_participant;
+      if (old_participant.order.is_valid()) {
+        send_update_group_call_participant(input_group_call_id, participant, "process_group_call_participant remove");
       }
+      on_remove_group_call_participant(input_group_call_id, old_participant.dialog_id);
+      remove_recent_group_call_speaker(input_group_call_id, old_participant.dialog_id);
+      int32 unmuted_video_diff = -old_participant.get_has_video();
+      participants->local_unmuted_video_count += unmuted_video_diff;
+      participants->remove_participant(i);
+      return {-1, unmuted_video_diff};
+    }
 
-      if (old_participant.version > participant.version) {
-        LOG(INFO) << "Ignore outdated update of " << old_participant.dialog_id;
-        return {0, 0};
-      }
+    if (old_participant.version > participant.version) {
+      LOG(INFO) << "Ignore outdated update of " << old_participant.dialog_id;
+      return {0, 0};
+    }
 
-      if (old_participant.dialog_id != participant.dialog_id) {
-        on_remove_group_call_participant(input_group_call_id, old_participant.dialog_id);
-        on_add_group_call_participant(input_group_call_id, participant.dialog_id);
-      }
+    if (old_participant.dialog_id != participant.dialog_id) {
+      on_remove_group_call_participant(input_group_call_id, old_participant.dialog_id);
+      on_add_group_call_participant(input_group_call_id, participant.dialog_id);
+    }
 
-      participant.update_from(old_participant);
+    participant.update_from(old_participant);
 
-      participant.is_just_joined = false;
-      participant.order = get_real_participant_order(can_self_unmute, participant, participants);
-      update_group_call_participant_can_be_muted(can_manage, participants, participant);
+    participant.is_just_joined = false;
+    participant.order = get_real_participant_order(can_self_unmute, participant, participants);
+    update_group_call_participant_can_be_muted(can_manage, participants, participant);
 
-      LOG(INFO) << "Edit " << old_participant << " to " << participant;
-      if (old_participant != participant && (old_participant.order.is_valid() || participant.order.is_valid())) {
-        send_update_group_call_participant(input_group_call_id, participant, "process_group_call_participant edit");
-      }
-      on_participant_speaking_in_group_call(input_group_call_id, participant);
-      int32 unmuted_video_diff = participant.get_has_video() - old_participant.get_has_video();
-      participants->local_unmuted_video_count += unmuted_video_diff;
-      old_participant = std::move(participant);
-      return {0, unmuted_video_diff};
+    LOG(INFO) << "Edit " << old_participant << " to " << participant;
+    if (old_participant != participant && (old_participant.order.is_valid() || participant.order.is_valid())) {
+      send_update_group_call_participant(input_group_call_id, participant, "process_group_call_participant edit");
+    }
+    on_participant_speaking_in_group_call(input_group_call_id, participant);
+    int32 unmuted_video_diff = participant.get_has_video() - old_participant.get_has_video();
+    participants->local_unmuted_video_count += unmuted_video_diff;
+    if (old_participant.dialog_id != participant.dialog_id) {
+      participants->participant_positions.erase(old_participant.dialog_id);
+      participants->participant_positions[participant.dialog_id] = i;
     }
+    old_participant = std::move(participant);
+    return {0, unmuted_video_diff};
   }
 
   if (participant.joined_date == 0) {
@@ -2310,7 +2350,7 @@ std::pair<int32, int32> GroupCallManager::process_group_call_participant(InputGr
   participant.is_just_joined = false;
   participants->local_unmuted_video_count += participant.get_has_video();
   update_group_call_participant_can_be_muted(can_manage, participants, participant);
-  participants->participants.push_back(std::move(participant));
+  participants->add_participant(std::move(participant));
   if (participants->participants.back().order.is_valid()) {
     send_update_group_call_participant(input_group_call_id, participants->participants.back(),
                                        "process_group_call_participant add");
@@ -59,14 +59,76 @@
 #include "td/utils/tl_parsers.h"
 
 #include <algorithm>
+#include <map>
+#include <mutex>
 
 namespace td {
 
+// inline query results, which can be reused by all clients in the process
+class SharedInlineQueryResultCache {
+ public:
+  static SharedInlineQueryResultCache &instance() {
+    static SharedInlineQueryResultCache cache;
+    return cache;
+  }
+
+  void add_results(string key, BufferSlice results, int32 cache_time) {
+    if (cache_time <= 0) {
+      return;
+    }
+
+    auto now = Time::now();
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (entries_.size() >= MAX_CACHED_RESULTS) {
+      for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.expires_at <= now) {
+          it = entries_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      if (entries_.size() >= MAX_CACHED_RESULTS) {
+        return;
+      }
+    }
+    auto &entry = entries_[std::move(key)];
+    entry.results = std::move(results);
+    entry.expires_at = now + cache_time;
+  }
+
+  BufferSlice get_results(const string &key, int32 &cache_time) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return BufferSlice();
+    }
+    auto left_time = it->second.expires_at - Time::now();
+    if (left_time < 1.0) {
+      entries_.erase(it);
+      return BufferSlice();
+    }
+    cache_time = static_cast<int32>(left_time);
+    return it->second.results.clone();
+  }
+
+ private:
+  static constexpr size_t MAX_CACHED_RESULTS = 1000;
+
+  struct Entry {
+    BufferSlice results;
+    double expires_at = 0;
+  };
+
+  std::mutex mutex_;
+  std::map<string, Entry> entries_;
+};
+
 class GetInlineBotResultsQuery final : public Td::ResultHandler {
   Promise<Unit> promise_;
   DialogId dialog_id_;
   UserId bot_user_id_;
   uint64 query_hash_;
+  string shared_cache_key_;
 
   static constexpr int32 GET_INLINE_BOT_RESULTS_FLAG_HAS_LOCATION = 1 << 0;
 
@@ -76,11 +138,12 @@ class GetInlineBotResultsQuery final : public Td::ResultHandler {
 
   NetQueryRef send(UserId bot_user_id, DialogId dialog_id, tl_object_ptr<telegram_api::InputUser> bot_input_user,
                    tl_object_ptr<telegram_api::InputPeer> input_peer, Location user_location, const string &query,
-                   const string &offset, uint64 query_hash) {
+                   const string &offset, uint64 query_hash, string shared_cache_key) {
     CHECK(input_peer != nullptr);
     bot_user_id_ = bot_user_id;
     dialog_id_ = dialog_id;
     query_hash_ = query_hash;
+    shared_cache_key_ = std::move(shared_cache_key);
     int32 flags = 0;
     if (!user_location.empty()) {
       flags |= GET_INLINE_BOT_RESULTS_FLAG_HAS_LOCATION;
@@ -101,8 +164,13 @@ class GetInlineBotResultsQuery final : public Td::ResultHandler {
       return on_error(result_ptr.move_as_error());
     }
 
+    if (!shared_cache_key_.empty() && result_ptr.ok()->query_id_ != 0) {
+      SharedInlineQueryResultCache::instance().add_results(std::move(shared_cache_key_), std::move(packet),
+                                                           result_ptr.ok()->cache_time_);
+    }
+
     td_->inline_queries_manager_->on_get_inline_query_results(dialog_id_, bot_user_id_, query_hash_,
-                                                              result_ptr.move_as_ok());
+                                                              result_ptr.move_as_ok(), false);
     promise_.set_value(Unit());
   }
 
@@ -114,7 +182,7 @@ class GetInlineBotResultsQuery final : public Td::ResultHandler {
     }
     LOG(INFO) << "Receive error for GetInlineBotResultsQuery: " << status;
 
-    td_->inline_queries_manager_->on_get_inline_query_results(dialog_id_, bot_user_id_, query_hash_, nullptr);
+    td_->inline_queries_manager_->on_get_inline_query_results(dialog_id_, bot_user_id_, query_hash_, nullptr, false);
     promise_.set_error(std::move(status));
   }
 };
@@ -1044,21 +1112,55 @@ uint64 InlineQueriesManager::send_inline_query(UserId bot_user_id, DialogId dial
     inline_query_results_[query_hash] = {nullptr, -1.0, 1};
   }
 
+  string shared_cache_key;
+  if (G()->get_option_boolean("use_shared_inline_query_cache")) {
+    shared_cache_key = get_shared_cache_key(bot_user_id, peer_type, r_bot_data.ok().need_location, user_location,
+                                            query, offset);
+    int32 cache_time = 0;
+    auto shared_results = SharedInlineQueryResultCache::instance().get_results(shared_cache_key, cache_time);
+    if (!shared_results.empty()) {
+      auto r_results = fetch_result<telegram_api::messages_getInlineBotResults>(shared_results);
+      if (r_results.is_ok()) {
+        LOG(INFO) << "Use shared results for inline query " << query_hash;
+        auto results = r_results.move_as_ok();
+        results->cache_time_ = cache_time;
+        on_get_inline_query_results(dialog_id, bot_user_id, query_hash, std::move(results), true);
+        promise.set_value(Unit());
+        return query_hash;
+      }
+      LOG(ERROR) << "Failed to parse shared inline query results: " << r_results.error();
+    }
+  }
+
   if (pending_inline_query_ != nullptr) {
     LOG(INFO) << "Drop inline query " << pending_inline_query_->query_hash;
     on_get_inline_query_results(pending_inline_query_->dialog_id, pending_inline_query_->bot_user_id,
-                                pending_inline_query_->query_hash, nullptr);
+                                pending_inline_query_->query_hash, nullptr, false);
     pending_inline_query_->promise.set_error(Status::Error(406, "Request canceled"));
   }
 
-  pending_inline_query_ = make_unique<PendingInlineQuery>(PendingInlineQuery{
-      query_hash, bot_user_id, dialog_id, std::move(input_peer), user_location, query, offset, std::move(promise)});
+  pending_inline_query_ = make_unique<PendingInlineQuery>(
+      PendingInlineQuery{query_hash, bot_user_id, dialog_id, std::move(input_peer), user_location, query, offset,
+                         std::move(shared_cache_key), std::move(promise)});
 
   loop();
 
   return query_hash;
 }
 
+string InlineQueriesManager::get_shared_cache_key(UserId bot_user_id, int32 peer_type, bool need_location,
+                                                  const Location &user_location, const string &query,
+                                                  const string &offset) {
+  // results can be shared only between clients connected to the same environment
+  auto key = PSTRING() << G()->is_test_dc() << ' ' << bot_user_id.get() << ' ' << peer_type;
+  if (need_location) {
+    key += PSTRING() << ' ' << static_cast<int64>(user_location.get_latitude() * 1e4) << ' '
+                     << static_cast<int64>(user_location.get_longitude() * 1e4);
+  }
+  key += PSTRING() << ' ' << offset.size() << ' ' << offset << ' ' << trim(query);
+  return key;
+}
+
 void InlineQueriesManager::loop() {
   LOG(INFO) << "Inline query loop";
   if (pending_inline_query_ == nullptr) {
@@ -1078,7 +1180,8 @@ void InlineQueriesManager::loop() {
                         ->send(pending_inline_query_->bot_user_id, pending_inline_query_->dialog_id,
                                r_bot_input_user.move_as_ok(), std::move(pending_inline_query_->input_peer),
                                pending_inline_query_->user_location, pending_inline_query_->query,
-                               pending_inline_query_->offset, pending_inline_query_->query_hash);
+                               pending_inline_query_->offset, pending_inline_query_->query_hash,
+                               std::move(pending_inline_query_->shared_cache_key));
 
       next_inline_query_time_ = now + INLINE_QUERY_DELAY_MS * 1e-3;
     }
@@ -1538,7 +1641,8 @@ string InlineQueriesManager::get_web_document_content_type(
 }
 
 void InlineQueriesManager::on_get_inline_query_results(DialogId dialog_id, UserId bot_user_id, uint64 query_hash,
-                                                       tl_object_ptr<telegram_api::messages_botResults> &&results) {
+                                                       tl_object_ptr<telegram_api::messages_botResults> &&results,
+                                                       bool is_shared) {
   LOG(INFO) << "Receive results for inline query " << query_hash;
   if (results == nullptr || results->query_id_ == 0) {
     decrease_pending_request_count(query_hash);
@@ -1546,7 +1650,10 @@ void InlineQueriesManager::on_get_inline_query_results(DialogId dialog_id, UserI
   }
   LOG(INFO) << to_string(results);
 
-  td_->contacts_manager_->on_get_users(std::move(results->users_), "on_get_inline_query_results");
+  if (!is_shared) {
+    // access hashes of the users are valid only for the client, which received them
+    td_->contacts_manager_->on_get_users(std::move(results->users_), "on_get_inline_query_results");
+  }
 
   auto dialog_type = dialog_id.get_type();
   bool allow_invoice = dialog_type != DialogType::SecretChat;
@@ -67,7 +67,7 @@ class InlineQueriesManager final : public Actor {
   UserId get_inline_bot_user_id(int64 query_id) const;
 
   void on_get_inline_query_results(DialogId dialog_id, UserId bot_user_id, uint64 query_hash,
-                                   tl_object_ptr<telegram_api::messages_botResults> &&results);
+                                   tl_object_ptr<telegram_api::messages_botResults> &&results, bool is_shared);
 
   tl_object_ptr<td_api::inlineQueryResults> get_inline_query_results_object(uint64 query_hash);
 
@@ -121,6 +121,9 @@ class InlineQueriesManager final : public Actor {
 
   tl_object_ptr<td_api::inlineQueryResults> decrease_pending_request_count(uint64 query_hash);
 
+  static string get_shared_cache_key(UserId bot_user_id, int32 peer_type, bool need_location,
+                                     const Location &user_location, const string &query, const string &offset);
+
   static void on_drop_inline_query_result_timeout_callback(void *inline_queries_manager_ptr, int64 query_hash);
 
   void loop() final;
@@ -140,6 +143,7 @@ class InlineQueriesManager final : public Actor {
     Location user_location;
     string query;
     string offset;
+    string shared_cache_key;
     Promise<Unit> promise;
   };
 
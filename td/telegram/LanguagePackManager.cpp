@@ -27,6 +27,7 @@
 #include <atomic>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <utility>
 
 namespace td {
@@ -198,7 +199,7 @@ LanguagePackManager::LanguageDatabase *LanguagePackManager::add_language_databas
 }
 
 LanguagePackManager::LanguagePackManager(ActorShared<> parent) : parent_(std::move(parent)) {
-  std::lock_guard<std::mutex> database_lock(language_database_mutex_);
+  auto database_lock = language_database_mutex_.lock();
   manager_count_++;
   language_pack_ = G()->get_option_string("localization_target");
   language_code_ = G()->get_option_string("language_pack_id");
@@ -253,7 +254,7 @@ void LanguagePackManager::tear_down() {
   if (ExitGuard::is_exited()) {
     return;
   }
-  std::lock_guard<std::mutex> lock(language_database_mutex_);
+  auto lock = language_database_mutex_.lock();
   manager_count_--;
   if (manager_count_ == 0) {
     // can't clear language packs, because they can be accessed later using synchronous requests
@@ -1292,17 +1293,21 @@ td_api::object_ptr<td_api::Object> LanguagePackManager::get_language_pack_string
     return td_api::make_object<td_api::error>(400, "Key is invalid");
   }
 
-  std::unique_lock<std::mutex> language_databases_lock(language_database_mutex_);
+  auto language_databases_lock = language_database_mutex_.lock();
   LanguageDatabase *database = add_language_database(database_path);
   CHECK(database != nullptr);
-  language_databases_lock.unlock();
+  language_databases_lock.reset();
 
   Language *language = add_language(database, language_pack, language_code);
-  vector<string> keys{key};
-  if (language_has_strings(language, keys)) {
+  CHECK(language != nullptr);
+  {
+    // fast path: the string has already been loaded, so look it up with a single lock of the language
     std::lock_guard<std::mutex> lock(language->mutex_);
-    return get_language_pack_string_value_object(language, key);
+    if (language->is_full_ || language_has_string_unsafe(language, key)) {
+      return get_language_pack_string_value_object(language, key);
+    }
   }
+  vector<string> keys{key};
   if (load_language_strings(database, language, keys)) {
     std::lock_guard<std::mutex> lock(language->mutex_);
     return get_language_pack_string_value_object(language, key);
@@ -1913,7 +1918,7 @@ void LanguagePackManager::hangup() {
 }
 
 int32 LanguagePackManager::manager_count_ = 0;
-std::mutex LanguagePackManager::language_database_mutex_;
+Mutex LanguagePackManager::language_database_mutex_("LanguagePackManager database");
 std::unordered_map<string, unique_ptr<LanguagePackManager::LanguageDatabase>, Hash<string>>
     LanguagePackManager::language_databases_;
 
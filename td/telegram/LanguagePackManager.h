@@ -16,11 +16,11 @@
 #include "td/utils/Container.h"
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/HashTableUtils.h"
+#include "td/utils/port/Mutex.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
-#include <mutex>
 #include <unordered_map>
 #include <utility>
 
@@ -105,7 +105,7 @@ class LanguagePackManager final : public NetQueryCallback {
 
   static int32 manager_count_;
 
-  static std::mutex language_database_mutex_;
+  static Mutex language_database_mutex_;
   static std::unordered_map<string, unique_ptr<LanguageDatabase>, Hash<string>> language_databases_;
 
   static LanguageDatabase *add_language_database(string path);
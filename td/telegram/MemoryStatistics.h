@@ -0,0 +1,25 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/td_api.h"
+
+#include "td/utils/common.h"
+
+namespace td {
+
+using MemoryStatisticsEntries = vector<td_api::object_ptr<td_api::memoryStatisticsEntry>>;
+
+// size of the objects is estimated by size of their fixed-size part, which doesn't include owned heap memory
+template <class T>
+void add_memory_statistics_entry(MemoryStatisticsEntries &entries, const char *component, const char *object_kind,
+                                 size_t object_count) {
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      component, object_kind, static_cast<int64>(object_count), static_cast<int64>(object_count * sizeof(T))));
+}
+
+}  // namespace td
@@ -1793,6 +1793,10 @@ void store_message_content(const MessageContent *content, LogEventStorerUnsafe &
   store(content, storer);
 }
 
+void store_message_content(const MessageContent *content, LogEventStorerBounded &storer) {
+  store(content, storer);
+}
+
 void parse_message_content(unique_ptr<MessageContent> &content, LogEventParser &parser) {
   parse(content, parser);
 }
@@ -4994,7 +4998,7 @@ unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const
       }
     case MessageContentType::Sticker: {
       auto result = make_unique<MessageSticker>(*static_cast<const MessageSticker *>(content));
-      result->is_premium = td->option_manager_->get_option_boolean("is_premium");
+      result->is_premium = td->option_manager_->get_option_boolean(OptionId::IsPremium);
       if (td->stickers_manager_->has_input_media(result->file_id, to_secret)) {
         return std::move(result);
       }
@@ -5092,6 +5096,106 @@ unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const
   return nullptr;
 }
 
+static bool can_share_message_content(Td *td, DialogId dialog_id, const MessageContent *content,
+                                      MessageContentDupType type, const MessageCopyOptions &copy_options) {
+  if (type != MessageContentDupType::Forward || copy_options.send_copy ||
+      dialog_id.get_type() == DialogType::SecretChat) {
+    return false;
+  }
+
+  // the content can be shared only if dup_message_content doesn't change anything in the copy
+  switch (content->get_type()) {
+    case MessageContentType::Animation:
+    case MessageContentType::Audio:
+    case MessageContentType::Document:
+    case MessageContentType::Video:
+      return td->documents_manager_->has_input_media(get_message_content_any_file_id(content), FileId(), false);
+    case MessageContentType::Contact:
+    case MessageContentType::Dice:
+    case MessageContentType::Game:
+    case MessageContentType::Invoice:
+    case MessageContentType::Location:
+    case MessageContentType::Poll:
+    case MessageContentType::Text:
+    case MessageContentType::Venue:
+      return true;
+    case MessageContentType::Photo: {
+      // file identifier of an already sent photo is duped for every forward by users
+      if (!td->auth_manager_->is_bot()) {
+        return false;
+      }
+      const auto &photos = static_cast<const MessagePhoto *>(content)->photo.photos;
+      return !photos.empty() && (photos.size() > 2 || photos.back().type != 'i');
+    }
+    case MessageContentType::Sticker: {
+      const auto *m = static_cast<const MessageSticker *>(content);
+      return m->is_premium == td->option_manager_->get_option_boolean(OptionId::IsPremium) &&
+             td->stickers_manager_->has_input_media(m->file_id, false);
+    }
+    case MessageContentType::VideoNote: {
+      const auto *m = static_cast<const MessageVideoNote *>(content);
+      return !m->is_viewed && td->documents_manager_->has_input_media(m->file_id, FileId(), false);
+    }
+    case MessageContentType::VoiceNote: {
+      const auto *m = static_cast<const MessageVoiceNote *>(content);
+      return !m->is_listened && td->documents_manager_->has_input_media(m->file_id, FileId(), false);
+    }
+    default:
+      return false;
+  }
+}
+
+SharedMessageContent dup_shared_message_content(Td *td, DialogId dialog_id, const SharedMessageContent &content,
+                                                MessageContentDupType type, MessageCopyOptions &&copy_options) {
+  CHECK(content != nullptr);
+  if (can_share_message_content(td, dialog_id, content.get(), type, copy_options)) {
+    return content;
+  }
+  return dup_message_content(td, dialog_id, content.get(), type, std::move(copy_options));
+}
+
+unique_ptr<MessageContent> copy_message_content(const MessageContent *content) {
+  CHECK(content != nullptr);
+  // only contents, which can be shared by dup_shared_message_content, need to be copied
+  switch (content->get_type()) {
+    case MessageContentType::Text:
+      return make_unique<MessageText>(*static_cast<const MessageText *>(content));
+    case MessageContentType::Animation:
+      return make_unique<MessageAnimation>(*static_cast<const MessageAnimation *>(content));
+    case MessageContentType::Audio:
+      return make_unique<MessageAudio>(*static_cast<const MessageAudio *>(content));
+    case MessageContentType::Document:
+      return make_unique<MessageDocument>(*static_cast<const MessageDocument *>(content));
+    case MessageContentType::Photo:
+      return make_unique<MessagePhoto>(*static_cast<const MessagePhoto *>(content));
+    case MessageContentType::Sticker:
+      return make_unique<MessageSticker>(*static_cast<const MessageSticker *>(content));
+    case MessageContentType::Video:
+      return make_unique<MessageVideo>(*static_cast<const MessageVideo *>(content));
+    case MessageContentType::VoiceNote:
+      return make_unique<MessageVoiceNote>(*static_cast<const MessageVoiceNote *>(content));
+    case MessageContentType::Contact:
+      return make_unique<MessageContact>(*static_cast<const MessageContact *>(content));
+    case MessageContentType::Location:
+      return make_unique<MessageLocation>(*static_cast<const MessageLocation *>(content));
+    case MessageContentType::Venue:
+      return make_unique<MessageVenue>(*static_cast<const MessageVenue *>(content));
+    case MessageContentType::Game:
+      return make_unique<MessageGame>(*static_cast<const MessageGame *>(content));
+    case MessageContentType::Invoice:
+      return make_unique<MessageInvoice>(*static_cast<const MessageInvoice *>(content));
+    case MessageContentType::VideoNote:
+      return make_unique<MessageVideoNote>(*static_cast<const MessageVideoNote *>(content));
+    case MessageContentType::Poll:
+      return make_unique<MessagePoll>(*static_cast<const MessagePoll *>(content));
+    case MessageContentType::Dice:
+      return make_unique<MessageDice>(*static_cast<const MessageDice *>(content));
+    default:
+      UNREACHABLE();
+      return nullptr;
+  }
+}
+
 unique_ptr<MessageContent> get_action_message_content(Td *td, tl_object_ptr<telegram_api::MessageAction> &&action_ptr,
                                                       DialogId owner_dialog_id, DialogId reply_in_dialog_id,
                                                       MessageId reply_to_message_id) {
@@ -5918,11 +6022,11 @@ FileId get_message_content_any_file_id(const MessageContent *content) {
   return result;
 }
 
-void update_message_content_file_id_remote(MessageContent *content, FileId file_id) {
+void update_message_content_file_id_remote(SharedMessageContent &content, FileId file_id) {
   if (file_id.get_remote() == 0) {
     return;
   }
-  FileId *old_file_id = [&] {
+  auto get_file_id = [](MessageContent *content) {
     switch (content->get_type()) {
       case MessageContentType::Animation:
         return &static_cast<MessageAnimation *>(content)->file_id;
@@ -5941,9 +6045,11 @@ void update_message_content_file_id_remote(MessageContent *content, FileId file_
       default:
         return static_cast<FileId *>(nullptr);
     }
-  }();
+  };
+  // the content is copied only if it needs to be changed
+  const FileId *old_file_id = get_file_id(const_cast<MessageContent *>(content.get()));
   if (old_file_id != nullptr && *old_file_id == file_id && old_file_id->get_remote() == 0) {
-    *old_file_id = file_id;
+    *get_file_id(content.get_mutable()) = file_id;
   }
 }
 
@@ -6226,7 +6332,7 @@ bool need_delay_message_content_notification(const MessageContent *content, User
   }
 }
 
-void update_expired_message_content(unique_ptr<MessageContent> &content) {
+void update_expired_message_content(SharedMessageContent &content) {
   switch (content->get_type()) {
     case MessageContentType::Photo:
       content = make_unique<MessageExpiredPhoto>();
@@ -6255,11 +6361,11 @@ void update_expired_message_content(unique_ptr<MessageContent> &content) {
   }
 }
 
-void update_failed_to_send_message_content(Td *td, unique_ptr<MessageContent> &content) {
+void update_failed_to_send_message_content(Td *td, const MessageContent *content) {
   // do not forget about failed to send message forwards
   switch (content->get_type()) {
     case MessageContentType::Poll: {
-      const auto *message_poll = static_cast<const MessagePoll *>(content.get());
+      const auto *message_poll = static_cast<const MessagePoll *>(content);
       if (PollManager::is_local_poll_id(message_poll->poll_id)) {
         td->poll_manager_->stop_local_poll(message_poll->poll_id);
       }
@@ -20,6 +20,7 @@
 #include "td/telegram/ReplyMarkup.h"
 #include "td/telegram/secret_api.h"
 #include "td/telegram/SecretInputMedia.h"
+#include "td/telegram/SharedMessageContent.h"
 #include "td/telegram/StickerType.h"
 #include "td/telegram/td_api.h"
 #include "td/telegram/telegram_api.h"
@@ -43,19 +44,6 @@ class MultiPromiseActor;
 struct Photo;
 class Td;
 
-// Do not forget to update merge_message_contents when one of the inheritors of this class changes
-class MessageContent {
- public:
-  MessageContent() = default;
-  MessageContent(const MessageContent &) = default;
-  MessageContent &operator=(const MessageContent &) = default;
-  MessageContent(MessageContent &&) = default;
-  MessageContent &operator=(MessageContent &&) = default;
-
-  virtual MessageContentType get_type() const = 0;
-  virtual ~MessageContent() = default;
-};
-
 struct InputMessageContent {
   unique_ptr<MessageContent> content;
   bool disable_web_page_preview = false;
@@ -85,6 +73,8 @@ void store_message_content(const MessageContent *content, LogEventStorerCalcLeng
 
 void store_message_content(const MessageContent *content, LogEventStorerUnsafe &storer);
 
+void store_message_content(const MessageContent *content, LogEventStorerBounded &storer);
+
 void parse_message_content(unique_ptr<MessageContent> &content, LogEventParser &parser);
 
 InlineMessageContent create_inline_message_content(Td *td, FileId file_id,
@@ -197,6 +187,10 @@ enum class MessageContentDupType : int32 { Send, SendViaBot, Forward, Copy, Serv
 unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const MessageContent *content,
                                                MessageContentDupType type, MessageCopyOptions &&copy_options);
 
+// returns the same content instead of its copy whenever dup_message_content would return an equal copy
+SharedMessageContent dup_shared_message_content(Td *td, DialogId dialog_id, const SharedMessageContent &content,
+                                                MessageContentDupType type, MessageCopyOptions &&copy_options);
+
 unique_ptr<MessageContent> get_action_message_content(Td *td, tl_object_ptr<telegram_api::MessageAction> &&action_ptr,
                                                       DialogId owner_dialog_id, DialogId reply_in_dialog_id,
                                                       MessageId reply_to_message_id);
@@ -226,7 +220,7 @@ FileId get_message_content_upload_file_id(const MessageContent *content);
 
 FileId get_message_content_any_file_id(const MessageContent *content);
 
-void update_message_content_file_id_remote(MessageContent *content, FileId file_id);
+void update_message_content_file_id_remote(SharedMessageContent &content, FileId file_id);
 
 FileId get_message_content_thumbnail_file_id(const MessageContent *content, const Td *td);
 
@@ -250,9 +244,9 @@ bool need_reget_message_content(const MessageContent *content);
 
 bool need_delay_message_content_notification(const MessageContent *content, UserId my_user_id);
 
-void update_expired_message_content(unique_ptr<MessageContent> &content);
+void update_expired_message_content(SharedMessageContent &content);
 
-void update_failed_to_send_message_content(Td *td, unique_ptr<MessageContent> &content);
+void update_failed_to_send_message_content(Td *td, const MessageContent *content);
 
 void add_message_content_dependencies(Dependencies &dependencies, const MessageContent *message_content, bool is_bot);
 
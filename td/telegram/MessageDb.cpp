@@ -6,19 +6,26 @@
 //
 #include "td/telegram/MessageDb.h"
 
+#include "td/telegram/DbBlobCompression.h"
 #include "td/telegram/logevent/LogEvent.h"
 #include "td/telegram/UserId.h"
 #include "td/telegram/Version.h"
 
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteReadPool.h"
 #include "td/db/SqliteStatement.h"
+#include "td/db/WriteBatcher.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/SchedulerLocalStorage.h"
 
+#include "td/utils/algorithm.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/format.h"
+#include "td/utils/List.h"
 #include "td/utils/logging.h"
+#include "td/utils/port/Mutex.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
@@ -31,6 +38,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <iterator>
 #include <limits>
 #include <tuple>
@@ -41,6 +49,371 @@ namespace td {
 static constexpr int32 MESSAGE_DB_INDEX_COUNT = 30;
 static constexpr int32 MESSAGE_DB_INDEX_COUNT_OLD = 9;
 
+static Status create_messages_fts_table(SqliteDb &db) {
+  // prefix indexes allow to search for words by their first 2 or 3 characters without a scan over all terms
+  return db.exec(
+      "CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(text, content='messages', content_rowid='search_id', "
+      "prefix='2 3', tokenize = \"unicode61 remove_diacritics 0 tokenchars '\a'\")");
+}
+
+static Result<bool> has_messages_fts_prefix_index(SqliteDb &db) {
+  TRY_RESULT(stmt, db.get_statement("SELECT sql FROM sqlite_master WHERE type='table' AND name='messages_fts'"));
+  TRY_STATUS(stmt.step());
+  if (!stmt.has_row()) {
+    return false;
+  }
+  return stmt.view_string(0).str().find("prefix=") != string::npos;
+}
+
+static std::pair<MessageId, int32> get_message_info(MessageId message_id, Slice data, bool from_data) {
+  LogEventParser message_date_parser(data);
+  int32 flags;
+  int32 flags2 = 0;
+  int32 flags3 = 0;
+  td::parse(flags, message_date_parser);
+  if ((flags & (1 << 29)) != 0) {
+    td::parse(flags2, message_date_parser);
+    if ((flags2 & (1 << 29)) != 0) {
+      td::parse(flags3, message_date_parser);
+    }
+  }
+  bool has_sender = (flags & (1 << 10)) != 0;
+  MessageId data_message_id;
+  td::parse(data_message_id, message_date_parser);
+  UserId sender_user_id;
+  if (has_sender) {
+    td::parse(sender_user_id, message_date_parser);
+  }
+  int32 date;
+  td::parse(date, message_date_parser);
+  LOG(INFO) << "Loaded " << message_id << "(aka " << data_message_id << ") sent at " << date << " by "
+            << sender_user_id;
+  return {from_data ? data_message_id : message_id, date};
+}
+
+static std::pair<MessageId, int32> get_message_info(const MessageDbDialogMessage &message, bool from_data = false) {
+  return get_message_info(message.message_id, message.data.as_slice(), from_data);
+}
+
+// identifiers and dates of messages with the same search filter in a dialog, which are split into blocks of a limited
+// size, so a message can be found by its position in the list and the list can be traversed without a scan over
+// the messages table and parsing of the messages
+// a block is identified by a lower bound of its message identifiers, which is greater than all identifiers
+// from the previous block; the identifiers are stored sorted in ascending order
+class MessageIdBlocks {
+ public:
+  struct Block {
+    int64 first_message_id = 0;
+    vector<int64> message_ids;
+    vector<int32> dates;
+  };
+
+  static Status create_table(SqliteDb &db) {
+    return db.exec(
+        "CREATE TABLE IF NOT EXISTS message_id_blocks (dialog_id INT8, index_id INT4, first_message_id INT8, "
+        "message_count INT4, message_ids BLOB, message_dates BLOB, PRIMARY KEY (dialog_id, index_id, "
+        "first_message_id))");
+  }
+
+  // NB: must happen inside a transaction
+  static Status build(SqliteDb &db) {
+    MessageIdBlocks blocks;
+    TRY_STATUS(blocks.init(db));
+    TRY_STATUS(db.exec("DELETE FROM message_id_blocks"));
+    for (int32 i = 0; i < MESSAGE_DB_INDEX_COUNT; i++) {
+      TRY_RESULT(stmt, db.get_statement(PSLICE() << "SELECT dialog_id, message_id, data FROM messages WHERE "
+                                                    "(index_mask & "
+                                                 << (1 << i) << ") != 0 ORDER BY dialog_id, message_id"));
+      DialogId dialog_id;
+      Block block;
+      TRY_STATUS(stmt.step());
+      while (stmt.has_row()) {
+        DialogId row_dialog_id(stmt.view_int64(0));
+        if (row_dialog_id != dialog_id) {
+          blocks.add_sorted_messages(dialog_id, i, block);
+          dialog_id = row_dialog_id;
+          block = Block();
+        }
+        MessageId message_id(stmt.view_int64(1));
+        block.message_ids.push_back(message_id.get());
+        block.dates.push_back(
+            get_message_info(message_id, DbBlobCompression::decompress(stmt.view_blob(2)).as_slice(), false).second);
+        TRY_STATUS(stmt.step());
+      }
+      blocks.add_sorted_messages(dialog_id, i, block);
+    }
+    return Status::OK();
+  }
+
+  Status init(SqliteDb &db) {
+    TRY_RESULT_ASSIGN(get_block_by_message_id_stmt_,
+                      db.get_statement("SELECT first_message_id, message_ids, message_dates FROM message_id_blocks "
+                                       "WHERE dialog_id = ?1 AND index_id = ?2 AND first_message_id <= ?3 ORDER BY "
+                                       "first_message_id DESC LIMIT 1"));
+    TRY_RESULT_ASSIGN(get_first_block_stmt_,
+                      db.get_statement("SELECT first_message_id, message_ids, message_dates FROM message_id_blocks "
+                                       "WHERE dialog_id = ?1 AND index_id = ?2 ORDER BY first_message_id ASC LIMIT 1"));
+    TRY_RESULT_ASSIGN(get_block_stmt_,
+                      db.get_statement("SELECT first_message_id, message_ids, message_dates FROM message_id_blocks "
+                                       "WHERE dialog_id = ?1 AND index_id = ?2 AND first_message_id = ?3"));
+    TRY_RESULT_ASSIGN(get_block_sizes_stmt_,
+                      db.get_statement("SELECT first_message_id, message_count FROM message_id_blocks WHERE dialog_id "
+                                       "= ?1 AND index_id = ?2 AND first_message_id < ?3 ORDER BY first_message_id "
+                                       "DESC"));
+    TRY_RESULT_ASSIGN(set_block_stmt_,
+                      db.get_statement("INSERT OR REPLACE INTO message_id_blocks VALUES(?1, ?2, ?3, ?4, ?5, ?6)"));
+    TRY_RESULT_ASSIGN(delete_block_stmt_,
+                      db.get_statement("DELETE FROM message_id_blocks WHERE dialog_id = ?1 AND index_id = ?2 AND "
+                                       "first_message_id = ?3"));
+    TRY_RESULT_ASSIGN(delete_dialog_blocks_stmt_,
+                      db.get_statement("DELETE FROM message_id_blocks WHERE dialog_id = ?1"));
+    return Status::OK();
+  }
+
+  void add_message(DialogId dialog_id, int32 index_id, MessageId message_id, int32 date) {
+    auto id = message_id.get();
+    Block block;
+    if (!get_block_by_message_id(dialog_id, index_id, id, block)) {
+      // the message is older than all other messages, so the lower bound of the first block must be changed
+      if (get_first_block(dialog_id, index_id, block)) {
+        delete_block(dialog_id, index_id, block.first_message_id);
+      }
+      block.first_message_id = id;
+    }
+
+    auto it = std::lower_bound(block.message_ids.begin(), block.message_ids.end(), id);
+    auto pos = it - block.message_ids.begin();
+    if (it != block.message_ids.end() && *it == id) {
+      return;
+    }
+    block.message_ids.insert(it, id);
+    block.dates.insert(block.dates.begin() + pos, date);
+    if (block.message_ids.size() <= MAX_BLOCK_SIZE) {
+      set_block(dialog_id, index_id, block.first_message_id, block, 0, block.message_ids.size());
+      return;
+    }
+
+    auto half = block.message_ids.size() / 2;
+    set_block(dialog_id, index_id, block.first_message_id, block, 0, half);
+    set_block(dialog_id, index_id, block.message_ids[half], block, half, block.message_ids.size() - half);
+  }
+
+  void delete_message(DialogId dialog_id, int32 index_id, MessageId message_id) {
+    auto id = message_id.get();
+    Block block;
+    if (!get_block_by_message_id(dialog_id, index_id, id, block)) {
+      return;
+    }
+
+    auto it = std::lower_bound(block.message_ids.begin(), block.message_ids.end(), id);
+    if (it == block.message_ids.end() || *it != id) {
+      return;
+    }
+    block.dates.erase(block.dates.begin() + (it - block.message_ids.begin()));
+    block.message_ids.erase(it);
+    if (block.message_ids.empty()) {
+      delete_block(dialog_id, index_id, block.first_message_id);
+    } else {
+      set_block(dialog_id, index_id, block.first_message_id, block, 0, block.message_ids.size());
+    }
+  }
+
+  void delete_dialog(DialogId dialog_id) {
+    SCOPE_EXIT {
+      delete_dialog_blocks_stmt_.reset();
+    };
+    delete_dialog_blocks_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    delete_dialog_blocks_stmt_.step().ensure();
+  }
+
+  // messages must be sorted by identifier in ascending order and be newer than all messages in the list
+  void add_sorted_messages(DialogId dialog_id, int32 index_id, const Block &messages) {
+    CHECK(messages.message_ids.size() == messages.dates.size());
+    for (size_t i = 0; i < messages.message_ids.size(); i += BUILT_BLOCK_SIZE) {
+      auto size = min(messages.message_ids.size() - i, BUILT_BLOCK_SIZE);
+      set_block(dialog_id, index_id, messages.message_ids[i], messages, i, size);
+    }
+  }
+
+  // returns the number of messages with identifiers less than from_message_id, and identifiers and dates of up to
+  // limit evenly spaced messages among them together with their positions, counting from the newest message
+  int32 get_sparse_messages(DialogId dialog_id, int32 index_id, MessageId from_message_id, int32 limit,
+                            vector<MessageDbMessagePosition> &result) {
+    struct BlockInfo {
+      int64 first_message_id;
+      int32 message_count;
+    };
+    vector<BlockInfo> block_infos;
+    {
+      SCOPE_EXIT {
+        get_block_sizes_stmt_.reset();
+      };
+      get_block_sizes_stmt_.bind_int64(1, dialog_id.get()).ensure();
+      get_block_sizes_stmt_.bind_int32(2, index_id).ensure();
+      get_block_sizes_stmt_.bind_int64(3, from_message_id.get()).ensure();
+      get_block_sizes_stmt_.step().ensure();
+      while (get_block_sizes_stmt_.has_row()) {
+        block_infos.push_back(BlockInfo{get_block_sizes_stmt_.view_int64(0), get_block_sizes_stmt_.view_int32(1)});
+        get_block_sizes_stmt_.step().ensure();
+      }
+    }
+    if (block_infos.empty()) {
+      return 0;
+    }
+
+    // the newest block can contain messages, which aren't less than from_message_id
+    auto block = get_block(dialog_id, index_id, block_infos[0].first_message_id);
+    block_infos[0].message_count = static_cast<int32>(
+        std::lower_bound(block.message_ids.begin(), block.message_ids.end(), from_message_id.get()) -
+        block.message_ids.begin());
+
+    int32 total_count = 0;
+    for (auto &block_info : block_infos) {
+      total_count += block_info.message_count;
+    }
+    limit = min(limit, total_count);
+    if (limit <= 0) {
+      return total_count;
+    }
+
+    double delta = static_cast<double>(total_count) / limit;
+    size_t block_pos = 0;
+    int32 block_begin_position = 0;
+    result.reserve(limit);
+    for (int32 i = 0; i < limit; i++) {
+      auto position = static_cast<int32>((i + 0.5) * delta);
+      bool is_block_changed = false;
+      while (position >= block_begin_position + block_infos[block_pos].message_count) {
+        block_begin_position += block_infos[block_pos].message_count;
+        block_pos++;
+        CHECK(block_pos < block_infos.size());
+        is_block_changed = true;
+      }
+      if (is_block_changed) {
+        block = get_block(dialog_id, index_id, block_infos[block_pos].first_message_id);
+        LOG_CHECK(static_cast<int32>(block.message_ids.size()) == block_infos[block_pos].message_count)
+            << block.message_ids.size() << ' ' << block_infos[block_pos].message_count;
+      }
+      auto offset = block_infos[block_pos].message_count - 1 - (position - block_begin_position);
+      result.push_back(MessageDbMessagePosition{position, block.dates[offset], MessageId(block.message_ids[offset])});
+    }
+    return total_count;
+  }
+
+  // calls func(message_id, date) for messages with identifiers less than from_message_id from the newest to the oldest
+  // message until func returns false
+  template <class F>
+  void for_each_message_before(DialogId dialog_id, int32 index_id, MessageId from_message_id, F &&func) {
+    auto max_message_id = from_message_id.get() - 1;
+    Block block;
+    while (max_message_id > 0 && get_block_by_message_id(dialog_id, index_id, max_message_id, block)) {
+      auto end_pos = std::upper_bound(block.message_ids.begin(), block.message_ids.end(), max_message_id) -
+                     block.message_ids.begin();
+      for (auto pos = end_pos; pos > 0; pos--) {
+        if (!func(MessageId(block.message_ids[pos - 1]), block.dates[pos - 1])) {
+          return;
+        }
+      }
+      max_message_id = block.first_message_id - 1;
+    }
+  }
+
+ private:
+  static constexpr size_t MAX_BLOCK_SIZE = 256;
+  static constexpr size_t BUILT_BLOCK_SIZE = MAX_BLOCK_SIZE / 2;
+
+  SqliteStatement get_block_by_message_id_stmt_;
+  SqliteStatement get_first_block_stmt_;
+  SqliteStatement get_block_stmt_;
+  SqliteStatement get_block_sizes_stmt_;
+  SqliteStatement set_block_stmt_;
+  SqliteStatement delete_block_stmt_;
+  SqliteStatement delete_dialog_blocks_stmt_;
+
+  template <class T>
+  static vector<T> parse_array(Slice data) {
+    CHECK(data.size() % sizeof(T) == 0);
+    vector<T> result(data.size() / sizeof(T));
+    if (!result.empty()) {
+      std::memcpy(result.data(), data.data(), data.size());
+    }
+    return result;
+  }
+
+  static bool parse_block(SqliteStatement &stmt, Block &block) {
+    stmt.step().ensure();
+    if (!stmt.has_row()) {
+      return false;
+    }
+    block.first_message_id = stmt.view_int64(0);
+    block.message_ids = parse_array<int64>(stmt.view_blob(1));
+    block.dates = parse_array<int32>(stmt.view_blob(2));
+    CHECK(block.message_ids.size() == block.dates.size());
+    return true;
+  }
+
+  bool get_block_by_message_id(DialogId dialog_id, int32 index_id, int64 message_id, Block &block) {
+    SCOPE_EXIT {
+      get_block_by_message_id_stmt_.reset();
+    };
+    get_block_by_message_id_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    get_block_by_message_id_stmt_.bind_int32(2, index_id).ensure();
+    get_block_by_message_id_stmt_.bind_int64(3, message_id).ensure();
+    return parse_block(get_block_by_message_id_stmt_, block);
+  }
+
+  bool get_first_block(DialogId dialog_id, int32 index_id, Block &block) {
+    SCOPE_EXIT {
+      get_first_block_stmt_.reset();
+    };
+    get_first_block_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    get_first_block_stmt_.bind_int32(2, index_id).ensure();
+    return parse_block(get_first_block_stmt_, block);
+  }
+
+  Block get_block(DialogId dialog_id, int32 index_id, int64 first_message_id) {
+    SCOPE_EXIT {
+      get_block_stmt_.reset();
+    };
+    get_block_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    get_block_stmt_.bind_int32(2, index_id).ensure();
+    get_block_stmt_.bind_int64(3, first_message_id).ensure();
+    Block block;
+    CHECK(parse_block(get_block_stmt_, block));
+    return block;
+  }
+
+  void set_block(DialogId dialog_id, int32 index_id, int64 first_message_id, const Block &block, size_t begin,
+                 size_t size) {
+    CHECK(size > 0);
+    CHECK(begin + size <= block.message_ids.size());
+    SCOPE_EXIT {
+      set_block_stmt_.reset();
+    };
+    set_block_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    set_block_stmt_.bind_int32(2, index_id).ensure();
+    set_block_stmt_.bind_int64(3, first_message_id).ensure();
+    set_block_stmt_.bind_int32(4, narrow_cast<int32>(size)).ensure();
+    set_block_stmt_
+        .bind_blob(5, Slice(reinterpret_cast<const char *>(block.message_ids.data() + begin), size * sizeof(int64)))
+        .ensure();
+    set_block_stmt_
+        .bind_blob(6, Slice(reinterpret_cast<const char *>(block.dates.data() + begin), size * sizeof(int32)))
+        .ensure();
+    set_block_stmt_.step().ensure();
+  }
+
+  void delete_block(DialogId dialog_id, int32 index_id, int64 first_message_id) {
+    SCOPE_EXIT {
+      delete_block_stmt_.reset();
+    };
+    delete_block_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    delete_block_stmt_.bind_int32(2, index_id).ensure();
+    delete_block_stmt_.bind_int64(3, first_message_id).ensure();
+    delete_block_stmt_.step().ensure();
+  }
+};
+
 // NB: must happen inside a transaction
 Status init_message_db(SqliteDb &db, int32 version) {
   LOG(INFO) << "Init message database " << tag("version", version);
@@ -68,9 +441,7 @@ Status init_message_db(SqliteDb &db, int32 version) {
         db.exec("CREATE INDEX IF NOT EXISTS message_by_search_id ON messages "
                 "(search_id) WHERE search_id IS NOT NULL"));
 
-    TRY_STATUS(
-        db.exec("CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(text, content='messages', "
-                "content_rowid='search_id', tokenize = \"unicode61 remove_diacritics 0 tokenchars '\a'\")"));
+    TRY_STATUS(create_messages_fts_table(db));
     TRY_STATUS(db.exec(
         "CREATE TRIGGER IF NOT EXISTS trigger_fts_delete BEFORE DELETE ON messages WHEN OLD.search_id IS NOT NULL"
         " BEGIN INSERT INTO messages_fts(messages_fts, rowid, text) VALUES(\'delete\', OLD.search_id, OLD.text); END"));
@@ -100,6 +471,11 @@ Status init_message_db(SqliteDb &db, int32 version) {
         "CREATE INDEX IF NOT EXISTS message_by_notification_id ON messages (dialog_id, notification_id) WHERE "
         "notification_id IS NOT NULL");
   };
+  auto add_thread_index = [&db] {
+    return db.exec(
+        "CREATE INDEX IF NOT EXISTS message_by_top_thread_message_id ON messages (dialog_id, top_thread_message_id, "
+        "message_id) WHERE top_thread_message_id IS NOT NULL");
+  };
   auto add_scheduled_messages_table = [&db] {
     TRY_STATUS(
         db.exec("CREATE TABLE IF NOT EXISTS scheduled_messages (dialog_id INT8, message_id INT8, "
@@ -140,6 +516,10 @@ Status init_message_db(SqliteDb &db, int32 version) {
 
     TRY_STATUS(add_scheduled_messages_table());
 
+    TRY_STATUS(MessageIdBlocks::create_table(db));
+
+    TRY_STATUS(add_thread_index());
+
     version = current_db_version();
   }
   if (version < static_cast<int32>(DbVersion::MessageDbMediaIndex)) {
@@ -167,6 +547,30 @@ Status init_message_db(SqliteDb &db, int32 version) {
   if (version < static_cast<int32>(DbVersion::AddMessageThreadSupport)) {
     TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN top_thread_message_id INT8"));
   }
+  if (version < static_cast<int32>(DbVersion::AddMessageIdBlocks)) {
+    TRY_STATUS(MessageIdBlocks::create_table(db));
+    TRY_STATUS(MessageIdBlocks::build(db));
+  }
+  if (version < static_cast<int32>(DbVersion::AddMessageThreadIndex)) {
+    TRY_STATUS(add_thread_index());
+  }
+  return Status::OK();
+}
+
+// NB: must happen inside a transaction
+Status add_message_db_fts_prefix_index(SqliteDb &db) {
+  TRY_RESULT(has_prefix_index, has_messages_fts_prefix_index(db));
+  if (has_prefix_index) {
+    return Status::OK();
+  }
+
+  LOG(WARNING) << "Rebuild message full-text search index";
+  auto start_time = Time::now();
+  // options of an FTS5 table can't be changed, so the table is recreated; the triggers refer to it by name
+  TRY_STATUS(db.exec("DROP TABLE IF EXISTS messages_fts"));
+  TRY_STATUS(create_messages_fts_table(db));
+  TRY_STATUS(db.exec("INSERT INTO messages_fts(messages_fts) VALUES('rebuild')"));
+  LOG(WARNING) << "Message full-text search index was rebuilt in " << Time::now() - start_time << " seconds";
   return Status::OK();
 }
 
@@ -174,12 +578,104 @@ Status init_message_db(SqliteDb &db, int32 version) {
 Status drop_message_db(SqliteDb &db, int32 version) {
   LOG(WARNING) << "Drop message database " << tag("version", version)
                << tag("current_db_version", current_db_version());
+  TRY_STATUS(db.exec("DROP TABLE IF EXISTS message_id_blocks"));
   return db.exec("DROP TABLE IF EXISTS messages");
 }
 
+// size-bounded LRU cache of raw message rows, which is shared between all connections to the database
+class MessageDbCache {
+ public:
+  // the generation must be taken before the row is read from the database
+  uint64 get_generation() {
+    auto guard = mutex_.lock();
+    return generation_;
+  }
+
+  bool get(FullMessageId full_message_id, BufferSlice &data) {
+    auto guard = mutex_.lock();
+    auto it = entries_.find(full_message_id);
+    if (it == entries_.end()) {
+      return false;
+    }
+    auto *entry = it->second.get();
+    entry->remove();
+    lru_.put(entry);
+    data = entry->data.clone();
+    return true;
+  }
+
+  void add(FullMessageId full_message_id, uint64 generation, Slice data) {
+    if (data.size() > MAX_ENTRY_SIZE) {
+      return;
+    }
+    auto guard = mutex_.lock();
+    if (generation != generation_) {
+      // the row could have been changed after it was read
+      return;
+    }
+    auto &entry = entries_[full_message_id];
+    if (entry == nullptr) {
+      entry = make_unique<Entry>();
+      entry->full_message_id = full_message_id;
+    } else {
+      total_size_ -= entry->data.size();
+      entry->remove();
+    }
+    entry->data = BufferSlice(data);
+    total_size_ += data.size();
+    lru_.put(entry.get());
+
+    while (total_size_ > MAX_TOTAL_SIZE || entries_.size() > MAX_ENTRY_COUNT) {
+      auto *oldest = static_cast<Entry *>(lru_.get());
+      CHECK(oldest != nullptr);
+      total_size_ -= oldest->data.size();
+      entries_.erase(oldest->full_message_id);
+    }
+  }
+
+  void erase(FullMessageId full_message_id) {
+    auto guard = mutex_.lock();
+    generation_++;
+    auto it = entries_.find(full_message_id);
+    if (it == entries_.end()) {
+      return;
+    }
+    total_size_ -= it->second->data.size();
+    entries_.erase(it);
+  }
+
+  void erase_dialog(DialogId dialog_id) {
+    auto guard = mutex_.lock();
+    generation_++;
+    table_remove_if(entries_, [&](const auto &it) {
+      if (it.first.get_dialog_id() != dialog_id) {
+        return false;
+      }
+      total_size_ -= it.second->data.size();
+      return true;
+    });
+  }
+
+ private:
+  struct Entry final : public ListNode {
+    FullMessageId full_message_id;
+    BufferSlice data;
+  };
+
+  static constexpr size_t MAX_TOTAL_SIZE = 4 << 20;
+  static constexpr size_t MAX_ENTRY_SIZE = 64 << 10;
+  static constexpr size_t MAX_ENTRY_COUNT = 10000;
+
+  Mutex mutex_{"MessageDb cache"};
+  FlatHashMap<FullMessageId, unique_ptr<Entry>, FullMessageIdHash> entries_;
+  ListNode lru_;
+  size_t total_size_ = 0;
+  uint64 generation_ = 0;
+};
+
 class MessageDbImpl final : public MessageDbSyncInterface {
  public:
-  explicit MessageDbImpl(SqliteDb db) : db_(std::move(db)) {
+  MessageDbImpl(SqliteDb db, std::shared_ptr<MessageDbCache> cache) : db_(std::move(db)), cache_(std::move(cache)) {
     init().ensure();
   }
 
@@ -193,10 +689,24 @@ class MessageDbImpl final : public MessageDbSyncInterface {
                       db_.get_statement("DELETE FROM messages WHERE dialog_id = ?1 AND message_id <= ?2"));
     TRY_RESULT_ASSIGN(delete_dialog_messages_by_sender_stmt_,
                       db_.get_statement("DELETE FROM messages WHERE dialog_id = ?1 AND sender_user_id = ?2"));
+    TRY_RESULT_ASSIGN(get_message_index_mask_stmt_,
+                      db_.get_statement("SELECT index_mask FROM messages WHERE dialog_id = ?1 AND message_id = ?2"));
+    TRY_STATUS(message_id_blocks_.init(db_));
 
     TRY_RESULT_ASSIGN(
         get_message_stmt_,
         db_.get_statement("SELECT message_id, data FROM messages WHERE dialog_id = ?1 AND message_id = ?2"));
+    {
+      string query = "SELECT message_id, data FROM messages WHERE dialog_id = ?1 AND message_id IN (";
+      for (size_t i = 0; i < GET_MESSAGES_BY_IDS_BATCH_SIZE; i++) {
+        if (i != 0) {
+          query += ", ";
+        }
+        query += PSTRING() << '?' << i + 2;
+      }
+      query += ')';
+      TRY_RESULT_ASSIGN(get_messages_by_ids_stmt_, db_.get_statement(query));
+    }
     TRY_RESULT_ASSIGN(
         get_message_by_random_id_stmt_,
         db_.get_statement("SELECT message_id, data FROM messages WHERE dialog_id = ?1 AND random_id = ?2"));
@@ -218,23 +728,31 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     TRY_RESULT_ASSIGN(get_messages_stmt_.desc_stmt_,
                       db_.get_statement("SELECT data, message_id FROM messages WHERE dialog_id = ?1 AND message_id < "
                                         "?2 ORDER BY message_id DESC LIMIT ?3"));
+    TRY_RESULT_ASSIGN(get_thread_messages_stmt_.asc_stmt_,
+                      db_.get_statement("SELECT data, message_id FROM messages WHERE dialog_id = ?1 AND "
+                                        "top_thread_message_id = ?4 AND message_id > ?2 ORDER BY message_id ASC "
+                                        "LIMIT ?3"));
+    TRY_RESULT_ASSIGN(get_thread_messages_stmt_.desc_stmt_,
+                      db_.get_statement("SELECT data, message_id FROM messages WHERE dialog_id = ?1 AND "
+                                        "top_thread_message_id = ?4 AND message_id < ?2 ORDER BY message_id DESC "
+                                        "LIMIT ?3"));
     TRY_RESULT_ASSIGN(get_scheduled_messages_stmt_,
                       db_.get_statement("SELECT data, message_id FROM scheduled_messages WHERE dialog_id = ?1 AND "
                                         "message_id < ?2 ORDER BY message_id DESC LIMIT ?3"));
     TRY_RESULT_ASSIGN(get_messages_from_notification_id_stmt_,
                       db_.get_statement("SELECT data, message_id FROM messages WHERE dialog_id = ?1 AND "
                                         "notification_id < ?2 ORDER BY notification_id DESC LIMIT ?3"));
+    TRY_RESULT_ASSIGN(use_prefix_search_, has_messages_fts_prefix_index(db_));
     TRY_RESULT_ASSIGN(get_messages_fts_stmt_,
                       db_.get_statement("SELECT dialog_id, message_id, data, search_id FROM messages WHERE search_id "
                                         "IN (SELECT rowid FROM messages_fts WHERE messages_fts MATCH ?1 AND rowid < ?2 "
                                         "ORDER BY rowid DESC LIMIT ?3) ORDER BY search_id DESC"));
 
     for (int32 i = 0; i < MESSAGE_DB_INDEX_COUNT; i++) {
-      TRY_RESULT_ASSIGN(
-          get_message_ids_stmts_[i],
-          db_.get_statement(
-              PSLICE() << "SELECT message_id FROM messages WHERE dialog_id = ?1 AND message_id < ?2 AND (index_mask & "
-                       << (1 << i) << ") != 0 ORDER BY message_id DESC LIMIT 1000000"));
+      TRY_RESULT_ASSIGN(get_message_ids_stmts_[i],
+                        db_.get_statement(PSLICE() << "SELECT message_id, data FROM messages WHERE dialog_id = ?1 AND "
+                                                      "(index_mask & "
+                                                   << (1 << i) << ") != 0 ORDER BY message_id ASC"));
 
       TRY_RESULT_ASSIGN(
           get_messages_from_index_stmts_[i].desc_stmt_,
@@ -324,6 +842,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       add_message_stmt_.bind_null(5).ensure();
     }
 
+    data = DbBlobCompression::compress(std::move(data));
     add_message_stmt_.bind_blob(6, data.as_slice()).ensure();
 
     if (ttl_expires_at != 0) {
@@ -368,7 +887,10 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       add_message_stmt_.bind_null(12).ensure();
     }
 
+    auto old_index_mask = get_message_index_mask(dialog_id, message_id);
     add_message_stmt_.step().ensure();
+    invalidate_message(full_message_id);
+    update_message_id_blocks(dialog_id, message_id, old_index_mask, index_mask, data.as_slice());
   }
 
   void add_scheduled_message(FullMessageId full_message_id, BufferSlice data) final {
@@ -389,6 +911,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       add_scheduled_message_stmt_.bind_null(3).ensure();
     }
 
+    data = DbBlobCompression::compress(std::move(data));
     add_scheduled_message_stmt_.bind_blob(4, data.as_slice()).ensure();
 
     add_scheduled_message_stmt_.step().ensure();
@@ -408,6 +931,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     SCOPE_EXIT {
       stmt.reset();
     };
+    auto old_index_mask = is_scheduled ? 0 : get_message_index_mask(dialog_id, message_id);
     stmt.bind_int64(1, dialog_id.get()).ensure();
     if (is_scheduled_server) {
       stmt.bind_int32(2, message_id.get_scheduled_server_message_id().get()).ensure();
@@ -415,6 +939,10 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       stmt.bind_int64(2, message_id.get()).ensure();
     }
     stmt.step().ensure();
+    if (!is_scheduled) {
+      invalidate_message(full_message_id);
+      update_message_id_blocks(dialog_id, message_id, old_index_mask, 0, Slice());
+    }
   }
 
   void delete_all_dialog_messages(DialogId dialog_id, MessageId from_message_id) final {
@@ -430,6 +958,8 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     if (status.is_error()) {
       LOG(ERROR) << status;
     }
+    cache_->erase_dialog(dialog_id);
+    rebuild_message_id_blocks(dialog_id);
   }
 
   void delete_dialog_messages_by_sender(DialogId dialog_id, DialogId sender_dialog_id) final {
@@ -442,6 +972,8 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     delete_dialog_messages_by_sender_stmt_.bind_int64(1, dialog_id.get()).ensure();
     delete_dialog_messages_by_sender_stmt_.bind_int64(2, sender_dialog_id.get()).ensure();
     delete_dialog_messages_by_sender_stmt_.step().ensure();
+    cache_->erase_dialog(dialog_id);
+    rebuild_message_id_blocks(dialog_id);
   }
 
   Result<MessageDbDialogMessage> get_message(FullMessageId full_message_id) final {
@@ -451,6 +983,14 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     CHECK(message_id.is_valid() || message_id.is_valid_scheduled());
     bool is_scheduled = message_id.is_scheduled();
     bool is_scheduled_server = is_scheduled && message_id.is_scheduled_server();
+    uint64 cache_generation = 0;
+    if (!is_scheduled) {
+      BufferSlice cached_data;
+      if (cache_->get(full_message_id, cached_data)) {
+        return MessageDbDialogMessage{message_id, std::move(cached_data)};
+      }
+      cache_generation = cache_->get_generation();
+    }
     auto &stmt = is_scheduled ? (is_scheduled_server ? get_scheduled_server_message_stmt_ : get_scheduled_message_stmt_)
                               : get_message_stmt_;
     SCOPE_EXIT {
@@ -468,16 +1008,75 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       return Status::Error("Not found");
     }
     MessageId received_message_id(stmt.view_int64(0));
-    Slice data = stmt.view_blob(1);
+    auto data = DbBlobCompression::decompress(stmt.view_blob(1));
     if (is_scheduled_server) {
       CHECK(received_message_id.is_scheduled());
       CHECK(received_message_id.is_scheduled_server());
       CHECK(received_message_id.get_scheduled_server_message_id() == message_id.get_scheduled_server_message_id());
     } else {
       LOG_CHECK(received_message_id == message_id)
-          << received_message_id << ' ' << message_id << ' ' << get_message_info(received_message_id, data, true).first;
+          << received_message_id << ' ' << message_id << ' '
+          << get_message_info(received_message_id, data.as_slice(), true).first;
     }
-    return MessageDbDialogMessage{received_message_id, BufferSlice(data)};
+    if (!is_scheduled) {
+      cache_->add(full_message_id, cache_generation, data.as_slice());
+    }
+    return MessageDbDialogMessage{received_message_id, std::move(data)};
+  }
+
+  vector<MessageDbMessage> get_messages_by_ids(vector<FullMessageId> full_message_ids) final {
+    vector<MessageDbMessage> result;
+    vector<MessageId> missing_message_ids;
+    while (!full_message_ids.empty()) {
+      auto dialog_id = full_message_ids[0].get_dialog_id();
+      CHECK(dialog_id.is_valid());
+      missing_message_ids.clear();
+      td::remove_if(full_message_ids, [&](FullMessageId full_message_id) {
+        if (full_message_id.get_dialog_id() != dialog_id) {
+          return false;
+        }
+        auto message_id = full_message_id.get_message_id();
+        if (message_id.is_scheduled()) {
+          auto r_message = get_message(full_message_id);
+          if (r_message.is_ok()) {
+            result.push_back(MessageDbMessage{dialog_id, message_id, std::move(r_message.ok_ref().data)});
+          }
+          return true;
+        }
+        CHECK(message_id.is_valid());
+        BufferSlice cached_data;
+        if (cache_->get(full_message_id, cached_data)) {
+          result.push_back(MessageDbMessage{dialog_id, message_id, std::move(cached_data)});
+        } else {
+          missing_message_ids.push_back(message_id);
+        }
+        return true;
+      });
+
+      td::unique(missing_message_ids);
+      for (size_t i = 0; i < missing_message_ids.size(); i += GET_MESSAGES_BY_IDS_BATCH_SIZE) {
+        auto cache_generation = cache_->get_generation();
+        auto batch_size = min(missing_message_ids.size() - i, GET_MESSAGES_BY_IDS_BATCH_SIZE);
+        SCOPE_EXIT {
+          get_messages_by_ids_stmt_.reset();
+        };
+        get_messages_by_ids_stmt_.bind_int64(1, dialog_id.get()).ensure();
+        for (size_t j = 0; j < GET_MESSAGES_BY_IDS_BATCH_SIZE; j++) {
+          // the last batch is padded with its last message identifier
+          auto message_id = missing_message_ids[i + min(j, batch_size - 1)];
+          get_messages_by_ids_stmt_.bind_int64(narrow_cast<int>(j + 2), message_id.get()).ensure();
+        }
+        get_messages_by_ids_stmt_.step().ensure();
+        while (get_messages_by_ids_stmt_.has_row()) {
+          MessageId message_id(get_messages_by_ids_stmt_.view_int64(0));
+          auto data = DbBlobCompression::decompress(get_messages_by_ids_stmt_.view_blob(1));
+          cache_->add({dialog_id, message_id}, cache_generation, data.as_slice());
+          result.push_back(MessageDbMessage{dialog_id, message_id, std::move(data)});
+          get_messages_by_ids_stmt_.step().ensure();
+        }
+      }
+    }
+    return result;
   }
 
   Result<MessageDbMessage> get_message_by_unique_message_id(ServerMessageId unique_message_id) final {
@@ -494,7 +1093,8 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     }
     DialogId dialog_id(get_message_by_unique_message_id_stmt_.view_int64(0));
     MessageId message_id(get_message_by_unique_message_id_stmt_.view_int64(1));
-    return MessageDbMessage{dialog_id, message_id, BufferSlice(get_message_by_unique_message_id_stmt_.view_blob(2))};
+    return MessageDbMessage{dialog_id, message_id,
+                            DbBlobCompression::decompress(get_message_by_unique_message_id_stmt_.view_blob(2))};
   }
 
   Result<MessageDbDialogMessage> get_message_by_random_id(DialogId dialog_id, int64 random_id) final {
@@ -508,7 +1108,8 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       return Status::Error("Not found");
     }
     MessageId message_id(get_message_by_random_id_stmt_.view_int64(0));
-    return MessageDbDialogMessage{message_id, BufferSlice(get_message_by_random_id_stmt_.view_blob(1))};
+    return MessageDbDialogMessage{message_id,
+                                  DbBlobCompression::decompress(get_message_by_random_id_stmt_.view_blob(1))};
   }
 
   Result<MessageDbDialogMessage> get_dialog_message_by_date(DialogId dialog_id, MessageId first_message_id,
@@ -590,7 +1191,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       while (get_expiring_messages_stmt_.has_row()) {
         DialogId dialog_id(get_expiring_messages_stmt_.view_int64(0));
         MessageId message_id(get_expiring_messages_stmt_.view_int64(1));
-        BufferSlice data(get_expiring_messages_stmt_.view_blob(2));
+        auto data = DbBlobCompression::decompress(get_expiring_messages_stmt_.view_blob(2));
         messages.push_back(MessageDbMessage{dialog_id, message_id, std::move(data)});
         get_expiring_messages_stmt_.step().ensure();
       }
@@ -610,71 +1211,65 @@ class MessageDbImpl final : public MessageDbSyncInterface {
   }
 
   MessageDbCalendar get_dialog_message_calendar(MessageDbDialogCalendarQuery query) final {
-    auto &stmt = get_messages_from_index_stmts_[message_search_filter_index(query.filter)].desc_stmt_;
-    SCOPE_EXIT {
-      stmt.reset();
-    };
     int32 limit = 1000;
-    stmt.bind_int64(1, query.dialog_id.get()).ensure();
-    stmt.bind_int64(2, query.from_message_id.get()).ensure();
-    stmt.bind_int32(3, limit).ensure();
-
-    vector<MessageDbDialogMessage> messages;
+    vector<MessageId> first_message_ids;
     vector<int32> total_counts;
-    stmt.step().ensure();
     int32 current_day = std::numeric_limits<int32>::max();
-    while (stmt.has_row()) {
-      auto data_slice = stmt.view_blob(0);
-      MessageId message_id(stmt.view_int64(1));
-      auto info = get_message_info(message_id, data_slice, false);
-      auto day = (query.tz_offset + info.second) / 86400;
-      if (day >= current_day) {
-        CHECK(!total_counts.empty());
-        total_counts.back()++;
-      } else {
-        current_day = day;
-        messages.push_back(MessageDbDialogMessage{message_id, BufferSlice(data_slice)});
-        total_counts.push_back(1);
+    message_id_blocks_.for_each_message_before(
+        query.dialog_id, message_search_filter_index(query.filter), query.from_message_id,
+        [&](MessageId message_id, int32 date) {
+          auto day = (query.tz_offset + date) / 86400;
+          if (day >= current_day) {
+            CHECK(!total_counts.empty());
+            total_counts.back()++;
+          } else {
+            current_day = day;
+            first_message_ids.push_back(message_id);
+            total_counts.push_back(1);
+          }
+          return --limit > 0;
+        });
+
+    // only the first message of each day needs to be loaded
+    vector<MessageDbDialogMessage> messages;
+    vector<int32> message_total_counts;
+    messages.reserve(first_message_ids.size());
+    message_total_counts.reserve(first_message_ids.size());
+    for (size_t i = 0; i < first_message_ids.size(); i++) {
+      auto r_message = get_message({query.dialog_id, first_message_ids[i]});
+      if (r_message.is_error()) {
+        LOG(ERROR) << "Failed to load " << first_message_ids[i] << " from " << query.dialog_id << ": "
+                   << r_message.error();
+        continue;
       }
-      stmt.step().ensure();
+      messages.push_back(r_message.move_as_ok());
+      message_total_counts.push_back(total_counts[i]);
     }
-    return MessageDbCalendar{std::move(messages), std::move(total_counts)};
+    return MessageDbCalendar{std::move(messages), std::move(message_total_counts)};
   }
 
   Result<MessageDbMessagePositions> get_dialog_sparse_message_positions(
       MessageDbGetDialogSparseMessagePositionsQuery query) final {
-    auto &stmt = get_message_ids_stmts_[message_search_filter_index(query.filter)];
-    SCOPE_EXIT {
-      stmt.reset();
-    };
-    stmt.bind_int64(1, query.dialog_id.get()).ensure();
-    stmt.bind_int64(2, query.from_message_id.get()).ensure();
-
-    vector<MessageId> message_ids;
-    stmt.step().ensure();
-    while (stmt.has_row()) {
-      message_ids.push_back(MessageId(stmt.view_int64(0)));
-      stmt.step().ensure();
-    }
-
     MessageDbMessagePositions positions;
-    int32 limit = min(query.limit, static_cast<int32>(message_ids.size()));
-    if (limit > 0) {
-      double delta = static_cast<double>(message_ids.size()) / limit;
-      positions.total_count = static_cast<int32>(message_ids.size());
-      positions.positions.reserve(limit);
-      for (int32 i = 0; i < limit; i++) {
-        auto position = static_cast<int32>((i + 0.5) * delta);
-        auto message_id = message_ids[position];
-        TRY_RESULT(message, get_message({query.dialog_id, message_id}));
-        auto date = get_message_info(message).second;
-        positions.positions.push_back(MessageDbMessagePosition{position, date, message_id});
-      }
+    positions.total_count =
+        message_id_blocks_.get_sparse_messages(query.dialog_id, message_search_filter_index(query.filter),
+                                               query.from_message_id, query.limit, positions.positions);
+    if (positions.positions.empty()) {
+      positions.total_count = 0;
     }
     return positions;
   }
 
   vector<MessageDbDialogMessage> get_messages(MessageDbMessagesQuery query) final {
+    if (query.top_thread_message_id.is_valid()) {
+      CHECK(query.filter == MessageSearchFilter::Empty);
+      // the identifier of the thread is bound once to both statements, because reset doesn't clear bindings
+      auto top_thread_message_id = query.top_thread_message_id.get();
+      get_thread_messages_stmt_.asc_stmt_.bind_int64(4, top_thread_message_id).ensure();
+      get_thread_messages_stmt_.desc_stmt_.bind_int64(4, top_thread_message_id).ensure();
+      return get_messages_impl(get_thread_messages_stmt_, query.dialog_id, query.from_message_id, query.offset,
+                               query.limit);
+    }
     if (query.filter != MessageSearchFilter::Empty) {
       return get_messages_from_index(query.dialog_id, query.from_message_id, query.filter, query.offset, query.limit);
     }
@@ -701,14 +1296,15 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     while (stmt.has_row()) {
       auto data_slice = stmt.view_blob(0);
       MessageId message_id(stmt.view_int64(1));
-      result.push_back(MessageDbDialogMessage{message_id, BufferSlice(data_slice)});
+      result.push_back(MessageDbDialogMessage{message_id, DbBlobCompression::decompress(data_slice)});
       LOG(INFO) << "Load " << message_id << " in " << dialog_id << " from database";
       stmt.step().ensure();
     }
     return result;
   }
 
-  static string prepare_query(Slice query) {
+  // if use_prefix_search, then messages with words starting with the query words are also found
+  static string prepare_query(Slice query, bool use_prefix_search) {
     auto is_word_character = [](uint32 a) {
       switch (get_unicode_simple_category(a)) {
         case UnicodeSimpleCategory::Letter:
@@ -725,6 +1321,16 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     auto buf = StackAllocator::alloc(query.size() * 4 + 100);
     StringBuilder sb(buf.as_slice());
     bool in_word{false};
+    size_t word_length = 0;
+    auto finish_word = [&] {
+      in_word = false;
+      sb << '"';
+      // a prefix search for one-character words would match too many terms
+      if (use_prefix_search && word_length >= 2) {
+        sb << '*';
+      }
+      sb << ' ';
+    };
 
     for (auto ptr = query.ubegin(), end = query.uend(); ptr < end;) {
       uint32 code;
@@ -733,18 +1339,19 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       if (is_word_character(code)) {
         if (!in_word) {
           in_word = true;
+          word_length = 0;
           sb << "\"";
         }
         sb << Slice(code_ptr, ptr);
+        word_length++;
       } else {
         if (in_word) {
-          in_word = false;
-          sb << "\" ";
+          finish_word();
         }
       }
     }
     if (in_word) {
-      sb << "\" ";
+      finish_word();
     }
 
     if (sb.is_error()) {
@@ -762,7 +1369,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
 
     LOG(INFO) << tag("query", query.query) << query.dialog_id << tag("filter", query.filter)
               << tag("from_search_id", query.from_search_id) << tag("limit", query.limit);
-    string words = prepare_query(query.query);
+    string words = prepare_query(query.query, use_prefix_search_);
     LOG(INFO) << tag("from", query.query) << tag("to", words);
 
     // dialog_id kludge
@@ -794,7 +1401,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       auto data_slice = stmt.view_blob(2);
       auto search_id = stmt.view_int64(3);
       result.next_search_id = search_id;
-      result.messages.push_back(MessageDbMessage{dialog_id, message_id, BufferSlice(data_slice)});
+      result.messages.push_back(MessageDbMessage{dialog_id, message_id, DbBlobCompression::decompress(data_slice)});
       stmt.step().ensure();
     }
     return result;
@@ -830,7 +1437,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       DialogId dialog_id(stmt.view_int64(0));
       MessageId message_id(stmt.view_int64(1));
       auto data_slice = stmt.view_blob(2);
-      result.messages.push_back(MessageDbMessage{dialog_id, message_id, BufferSlice(data_slice)});
+      result.messages.push_back(MessageDbMessage{dialog_id, message_id, DbBlobCompression::decompress(data_slice)});
       stmt.step().ensure();
     }
     return result;
@@ -840,19 +1447,33 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     return db_.begin_write_transaction();
   }
   Status commit_transaction() final {
-    return db_.commit_transaction();
+    auto status = db_.commit_transaction();
+    // rows could have been read by other connections before the changes were committed
+    for (auto full_message_id : invalidated_full_message_ids_) {
+      cache_->erase(full_message_id);
+    }
+    invalidated_full_message_ids_.clear();
+    return status;
   }
 
  private:
   SqliteDb db_;
+  std::shared_ptr<MessageDbCache> cache_;
+  vector<FullMessageId> invalidated_full_message_ids_;
+
+  static constexpr size_t GET_MESSAGES_BY_IDS_BATCH_SIZE = 32;
 
   SqliteStatement add_message_stmt_;
 
   SqliteStatement delete_message_stmt_;
   SqliteStatement delete_all_dialog_messages_stmt_;
   SqliteStatement delete_dialog_messages_by_sender_stmt_;
+  SqliteStatement get_message_index_mask_stmt_;
+
+  MessageIdBlocks message_id_blocks_;
 
   SqliteStatement get_message_stmt_;
+  SqliteStatement get_messages_by_ids_stmt_;
   SqliteStatement get_message_by_random_id_stmt_;
   SqliteStatement get_message_by_unique_message_id_stmt_;
   SqliteStatement get_expiring_messages_stmt_;
@@ -863,6 +1484,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     SqliteStatement desc_stmt_;
   };
   GetMessagesStmt get_messages_stmt_;
+  GetMessagesStmt get_thread_messages_stmt_;
   SqliteStatement get_scheduled_messages_stmt_;
   SqliteStatement get_messages_from_notification_id_stmt_;
 
@@ -871,6 +1493,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
   std::array<SqliteStatement, 2> get_calls_stmts_;
 
   SqliteStatement get_messages_fts_stmt_;
+  bool use_prefix_search_ = false;
 
   SqliteStatement add_scheduled_message_stmt_;
   SqliteStatement get_scheduled_message_stmt_;
@@ -946,41 +1569,74 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     while (stmt.has_row()) {
       auto data_slice = stmt.view_blob(0);
       MessageId message_id(stmt.view_int64(1));
-      result.push_back(MessageDbDialogMessage{message_id, BufferSlice(data_slice)});
+      result.push_back(MessageDbDialogMessage{message_id, DbBlobCompression::decompress(data_slice)});
       LOG(INFO) << "Loaded " << message_id << " in " << dialog_id << " from database";
       stmt.step().ensure();
     }
     return result;
   }
 
-  static std::pair<MessageId, int32> get_message_info(const MessageDbDialogMessage &message, bool from_data = false) {
-    return get_message_info(message.message_id, message.data.as_slice(), from_data);
+  void invalidate_message(FullMessageId full_message_id) {
+    cache_->erase(full_message_id);
+    invalidated_full_message_ids_.push_back(full_message_id);
+  }
+
+  int32 get_message_index_mask(DialogId dialog_id, MessageId message_id) {
+    auto &stmt = get_message_index_mask_stmt_;
+    SCOPE_EXIT {
+      stmt.reset();
+    };
+    stmt.bind_int64(1, dialog_id.get()).ensure();
+    stmt.bind_int64(2, message_id.get()).ensure();
+    stmt.step().ensure();
+    if (!stmt.has_row() || stmt.view_datatype(0) == SqliteStatement::Datatype::Null) {
+      return 0;
+    }
+    return stmt.view_int32(0);
   }
 
-  static std::pair<MessageId, int32> get_message_info(MessageId message_id, Slice data, bool from_data) {
-    LogEventParser message_date_parser(data);
-    int32 flags;
-    int32 flags2 = 0;
-    int32 flags3 = 0;
-    td::parse(flags, message_date_parser);
-    if ((flags & (1 << 29)) != 0) {
-      td::parse(flags2, message_date_parser);
-      if ((flags2 & (1 << 29)) != 0) {
-        td::parse(flags3, message_date_parser);
+  void update_message_id_blocks(DialogId dialog_id, MessageId message_id, int32 old_index_mask, int32 new_index_mask,
+                                Slice data) {
+    auto changed_index_mask = old_index_mask ^ new_index_mask;
+    if (changed_index_mask == 0) {
+      return;
+    }
+    int32 date = 0;
+    if ((changed_index_mask & new_index_mask) != 0) {
+      date = get_message_info(message_id, data, false).second;
+    }
+    for (int32 i = 0; i < MESSAGE_DB_INDEX_COUNT; i++) {
+      if ((changed_index_mask & (1 << i)) == 0) {
+        continue;
+      }
+      if ((new_index_mask & (1 << i)) != 0) {
+        message_id_blocks_.add_message(dialog_id, i, message_id, date);
+      } else {
+        message_id_blocks_.delete_message(dialog_id, i, message_id);
       }
     }
-    bool has_sender = (flags & (1 << 10)) != 0;
-    MessageId data_message_id;
-    td::parse(data_message_id, message_date_parser);
-    UserId sender_user_id;
-    if (has_sender) {
-      td::parse(sender_user_id, message_date_parser);
+  }
+
+  void rebuild_message_id_blocks(DialogId dialog_id) {
+    message_id_blocks_.delete_dialog(dialog_id);
+    for (int32 i = 0; i < MESSAGE_DB_INDEX_COUNT; i++) {
+      auto &stmt = get_message_ids_stmts_[i];
+      SCOPE_EXIT {
+        stmt.reset();
+      };
+      stmt.bind_int64(1, dialog_id.get()).ensure();
+
+      MessageIdBlocks::Block messages;
+      stmt.step().ensure();
+      while (stmt.has_row()) {
+        MessageId message_id(stmt.view_int64(0));
+        messages.message_ids.push_back(message_id.get());
+        messages.dates.push_back(
+            get_message_info(message_id, DbBlobCompression::decompress(stmt.view_blob(1)).as_slice(), false).second);
+        stmt.step().ensure();
+      }
+      message_id_blocks_.add_sorted_messages(dialog_id, i, messages);
     }
-    int32 date;
-    td::parse(date, message_date_parser);
-    LOG(INFO) << "Loaded " << message_id << "(aka " << data_message_id << ") sent at " << date << " by "
-              << sender_user_id;
-    return {from_data ? data_message_id : message_id, date};
   }
 };
 
@@ -989,8 +1645,8 @@ std::shared_ptr<MessageDbSyncSafeInterface> create_message_db_sync(
   class MessageDbSyncSafe final : public MessageDbSyncSafeInterface {
    public:
     explicit MessageDbSyncSafe(std::shared_ptr<SqliteConnectionSafe> sqlite_connection)
-        : lsls_db_([safe_connection = std::move(sqlite_connection)] {
-          return make_unique<MessageDbImpl>(safe_connection->get().clone());
+        : lsls_db_([safe_connection = std::move(sqlite_connection), cache = std::make_shared<MessageDbCache>()] {
+          return td::make_unique<MessageDbImpl>(safe_connection->get().clone(), cache);
         }) {
     }
     MessageDbSyncInterface &get() final {
@@ -1005,8 +1661,9 @@ std::shared_ptr<MessageDbSyncSafeInterface> create_message_db_sync(
 
 class MessageDbAsync final : public MessageDbAsyncInterface {
  public:
-  MessageDbAsync(std::shared_ptr<MessageDbSyncSafeInterface> sync_db, int32 scheduler_id) {
-    impl_ = create_actor_on_scheduler<Impl>("MessageDbActor", scheduler_id, std::move(sync_db));
+  MessageDbAsync(std::shared_ptr<MessageDbSyncSafeInterface> sync_db, int32 scheduler_id,
+                 std::shared_ptr<SqliteReadPool> read_pool) {
+    impl_ = create_actor_on_scheduler<Impl>("MessageDbActor", scheduler_id, std::move(sync_db), std::move(read_pool));
   }
 
   void add_message(FullMessageId full_message_id, ServerMessageId unique_message_id, DialogId sender_dialog_id,
@@ -1037,6 +1694,9 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
   void get_message_by_unique_message_id(ServerMessageId unique_message_id, Promise<MessageDbMessage> promise) final {
     send_closure_later(impl_, &Impl::get_message_by_unique_message_id, unique_message_id, std::move(promise));
   }
+  void get_messages_by_ids(vector<FullMessageId> full_message_ids, Promise<vector<MessageDbMessage>> promise) final {
+    send_closure_later(impl_, &Impl::get_messages_by_ids, std::move(full_message_ids), std::move(promise));
+  }
   void get_message_by_random_id(DialogId dialog_id, int64 random_id, Promise<MessageDbDialogMessage> promise) final {
     send_closure_later(impl_, &Impl::get_message_by_random_id, dialog_id, random_id, std::move(promise));
   }
@@ -1088,7 +1748,8 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
  private:
   class Impl final : public Actor {
    public:
-    explicit Impl(std::shared_ptr<MessageDbSyncSafeInterface> sync_db_safe) : sync_db_safe_(std::move(sync_db_safe)) {
+    Impl(std::shared_ptr<MessageDbSyncSafeInterface> sync_db_safe, std::shared_ptr<SqliteReadPool> read_pool)
+        : sync_db_safe_(std::move(sync_db_safe)), read_pool_(std::move(read_pool)) {
     }
     void add_message(FullMessageId full_message_id, ServerMessageId unique_message_id, DialogId sender_dialog_id,
                      int64 random_id, int32 ttl_expires_at, int32 index_mask, int64 search_id, string text,
@@ -1135,109 +1796,144 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
     }
 
     void get_message(FullMessageId full_message_id, Promise<MessageDbDialogMessage> promise) {
-      add_read_query();
-      promise.set_result(sync_db_->get_message(full_message_id));
+      add_read_query([full_message_id, promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_result(db.get_message(full_message_id));
+      });
+    }
+    void get_messages_by_ids(vector<FullMessageId> full_message_ids, Promise<vector<MessageDbMessage>> promise) {
+      add_read_query([full_message_ids = std::move(full_message_ids),
+                      promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_value(db.get_messages_by_ids(std::move(full_message_ids)));
+      });
     }
     void get_message_by_unique_message_id(ServerMessageId unique_message_id, Promise<MessageDbMessage> promise) {
-      add_read_query();
-      promise.set_result(sync_db_->get_message_by_unique_message_id(unique_message_id));
+      add_read_query([unique_message_id, promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_result(db.get_message_by_unique_message_id(unique_message_id));
+      });
     }
     void get_message_by_random_id(DialogId dialog_id, int64 random_id, Promise<MessageDbDialogMessage> promise) {
-      add_read_query();
-      promise.set_result(sync_db_->get_message_by_random_id(dialog_id, random_id));
+      add_read_query([dialog_id, random_id, promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_result(db.get_message_by_random_id(dialog_id, random_id));
+      });
     }
     void get_dialog_message_by_date(DialogId dialog_id, MessageId first_message_id, MessageId last_message_id,
                                     int32 date, Promise<MessageDbDialogMessage> promise) {
-      add_read_query();
-      promise.set_result(sync_db_->get_dialog_message_by_date(dialog_id, first_message_id, last_message_id, date));
+      add_read_query([dialog_id, first_message_id, last_message_id, date,
+                      promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_result(db.get_dialog_message_by_date(dialog_id, first_message_id, last_message_id, date));
+      });
     }
 
     void get_dialog_message_calendar(MessageDbDialogCalendarQuery query, Promise<MessageDbCalendar> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_dialog_message_calendar(std::move(query)));
+      add_read_query([query = std::move(query), promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_value(db.get_dialog_message_calendar(std::move(query)));
+      });
     }
 
     void get_dialog_sparse_message_positions(MessageDbGetDialogSparseMessagePositionsQuery query,
                                              Promise<MessageDbMessagePositions> promise) {
-      add_read_query();
-      promise.set_result(sync_db_->get_dialog_sparse_message_positions(std::move(query)));
+      add_read_query([query = std::move(query), promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_result(db.get_dialog_sparse_message_positions(std::move(query)));
+      });
     }
 
     void get_messages(MessageDbMessagesQuery query, Promise<vector<MessageDbDialogMessage>> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_messages(std::move(query)));
+      add_read_query([query = std::move(query), promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_value(db.get_messages(std::move(query)));
+      });
     }
     void get_scheduled_messages(DialogId dialog_id, int32 limit, Promise<vector<MessageDbDialogMessage>> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_scheduled_messages(dialog_id, limit));
+      add_read_query([dialog_id, limit, promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_value(db.get_scheduled_messages(dialog_id, limit));
+      });
     }
     void get_messages_from_notification_id(DialogId dialog_id, NotificationId from_notification_id, int32 limit,
                                            Promise<vector<MessageDbDialogMessage>> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_messages_from_notification_id(dialog_id, from_notification_id, limit));
+      add_read_query([dialog_id, from_notification_id, limit,
+                      promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_value(db.get_messages_from_notification_id(dialog_id, from_notification_id, limit));
+      });
     }
     void get_calls(MessageDbCallsQuery query, Promise<MessageDbCallsResult> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_calls(std::move(query)));
+      add_read_query([query = std::move(query), promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_value(db.get_calls(std::move(query)));
+      });
     }
     void get_messages_fts(MessageDbFtsQuery query, Promise<MessageDbFtsResult> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_messages_fts(std::move(query)));
+      add_read_query([query = std::move(query), promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_value(db.get_messages_fts(std::move(query)));
+      });
     }
     void get_expiring_messages(int32 expires_from, int32 expires_till, int32 limit,
                                Promise<std::pair<vector<MessageDbMessage>, int32>> promise) {
-      add_read_query();
-      promise.set_value(sync_db_->get_expiring_messages(expires_from, expires_till, limit));
+      add_read_query([expires_from, expires_till, limit,
+                      promise = std::move(promise)](MessageDbSyncInterface &db) mutable {
+        promise.set_value(db.get_expiring_messages(expires_from, expires_till, limit));
+      });
     }
 
     void close(Promise<> promise) {
       do_flush();
       sync_db_safe_.reset();
       sync_db_ = nullptr;
-      promise.set_value(Unit());
+      if (read_pool_ != nullptr) {
+        // wait for all running read queries
+        read_pool_->flush(std::move(promise));
+        read_pool_.reset();
+      } else {
+        promise.set_value(Unit());
+      }
       stop();
     }
 
     void force_flush() {
       do_flush();
-      LOG(INFO) << "MessageDb flushed";
+      LOG(INFO) << "MessageDb flushed with " << write_batcher_.get_stats();
     }
 
    private:
     std::shared_ptr<MessageDbSyncSafeInterface> sync_db_safe_;
     MessageDbSyncInterface *sync_db_ = nullptr;
+    std::shared_ptr<SqliteReadPool> read_pool_;
 
-    static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
-    static constexpr double MAX_PENDING_QUERIES_DELAY{0.01};
+    WriteBatcher write_batcher_;
 
     //NB: order is important, destructor of pending_writes_ will change finished_writes_
     vector<Promise<Unit>> finished_writes_;
     vector<Promise<Unit>> pending_writes_;  // TODO use Action
-    double wakeup_at_ = 0;
 
     template <class F>
     void add_write_query(F &&f) {
       pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f)));
-      if (pending_writes_.size() > MAX_PENDING_QUERIES_COUNT) {
+      if (write_batcher_.need_flush(pending_writes_.size())) {
         do_flush();
-        wakeup_at_ = 0;
-      } else if (wakeup_at_ == 0) {
-        wakeup_at_ = Time::now_cached() + MAX_PENDING_QUERIES_DELAY;
-      }
-      if (wakeup_at_ != 0) {
-        set_timeout_at(wakeup_at_);
+      } else if (pending_writes_.size() == 1) {
+        set_timeout_at(write_batcher_.get_flush_time(Time::now_cached()));
       }
     }
     void add_read_query() {
       do_flush();
     }
+    template <class F>
+    void add_read_query(F &&f) {
+      // the query must see all previous writes, so they are committed first
+      add_read_query();
+      if (read_pool_ == nullptr) {
+        f(*sync_db_);
+        return;
+      }
+      read_pool_->run([sync_db_safe = sync_db_safe_, f = std::forward<F>(f)]() mutable { f(sync_db_safe->get()); });
+    }
     void do_flush() {
       if (pending_writes_.empty()) {
         return;
       }
+      auto batch_size = pending_writes_.size();
+      auto start_time = Time::now();
       sync_db_->begin_write_transaction().ensure();
       set_promises(pending_writes_);
       sync_db_->commit_transaction().ensure();
+      write_batcher_.on_commit(batch_size, Time::now() - start_time);
       set_promises(finished_writes_);
       cancel_timeout();
     }
@@ -1253,8 +1949,9 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
 };
 
 std::shared_ptr<MessageDbAsyncInterface> create_message_db_async(std::shared_ptr<MessageDbSyncSafeInterface> sync_db,
-                                                                 int32 scheduler_id) {
-  return std::make_shared<MessageDbAsync>(std::move(sync_db), scheduler_id);
+                                                                 int32 scheduler_id,
+                                                                 std::shared_ptr<SqliteReadPool> read_pool) {
+  return std::make_shared<MessageDbAsync>(std::move(sync_db), scheduler_id, std::move(read_pool));
 }
 
 }  // namespace td
@@ -25,10 +25,12 @@ namespace td {
 
 class SqliteConnectionSafe;
 class SqliteDb;
+class SqliteReadPool;
 
 struct MessageDbMessagesQuery {
   DialogId dialog_id;
   MessageSearchFilter filter{MessageSearchFilter::Empty};
+  MessageId top_thread_message_id;  // if valid, only messages from the thread are returned; filter must be empty
   MessageId from_message_id;
   int32 offset{0};
   int32 limit{100};
@@ -114,6 +116,8 @@ class MessageDbSyncInterface {
   virtual void delete_dialog_messages_by_sender(DialogId dialog_id, DialogId sender_dialog_id) = 0;
 
   virtual Result<MessageDbDialogMessage> get_message(FullMessageId full_message_id) = 0;
+  // returns found messages in an unspecified order
+  virtual vector<MessageDbMessage> get_messages_by_ids(vector<FullMessageId> full_message_ids) = 0;
   virtual Result<MessageDbMessage> get_message_by_unique_message_id(ServerMessageId unique_message_id) = 0;
   virtual Result<MessageDbDialogMessage> get_message_by_random_id(DialogId dialog_id, int64 random_id) = 0;
   virtual Result<MessageDbDialogMessage> get_dialog_message_by_date(DialogId dialog_id, MessageId first_message_id,
@@ -167,6 +171,8 @@ class MessageDbAsyncInterface {
   virtual void delete_dialog_messages_by_sender(DialogId dialog_id, DialogId sender_dialog_id, Promise<> promise) = 0;
 
   virtual void get_message(FullMessageId full_message_id, Promise<MessageDbDialogMessage> promise) = 0;
+  virtual void get_messages_by_ids(vector<FullMessageId> full_message_ids,
+                                   Promise<vector<MessageDbMessage>> promise) = 0;
   virtual void get_message_by_unique_message_id(ServerMessageId unique_message_id,
                                                 Promise<MessageDbMessage> promise) = 0;
   virtual void get_message_by_random_id(DialogId dialog_id, int64 random_id,
@@ -198,10 +204,16 @@ class MessageDbAsyncInterface {
 Status init_message_db(SqliteDb &db, int version) TD_WARN_UNUSED_RESULT;
 Status drop_message_db(SqliteDb &db, int version) TD_WARN_UNUSED_RESULT;
 
+// adds prefix indexes to the full-text search index of an old database, which requires to rebuild it;
+// databases created after prefix indexes were introduced already have them
+Status add_message_db_fts_prefix_index(SqliteDb &db) TD_WARN_UNUSED_RESULT;
+
 std::shared_ptr<MessageDbSyncSafeInterface> create_message_db_sync(
     std::shared_ptr<SqliteConnectionSafe> sqlite_connection);
 
+// if read_pool is specified, read queries are run by it instead of the database actor
 std::shared_ptr<MessageDbAsyncInterface> create_message_db_async(std::shared_ptr<MessageDbSyncSafeInterface> sync_db,
-                                                                 int32 scheduler_id = -1);
+                                                                 int32 scheduler_id = -1,
+                                                                 std::shared_ptr<SqliteReadPool> read_pool = nullptr);
 
 }  // namespace td
@@ -29,6 +29,7 @@
 #include "td/utils/utf8.h"
 
 #include <algorithm>
+#include <array>
 #include <cstring>
 #include <limits>
 #include <tuple>
@@ -1690,8 +1691,52 @@ static void fix_entity_offsets(Slice text, vector<MessageEntity> &entities) {
   }
 }
 
+static constexpr int32 ENTITY_TRIGGER_AT_SIGN = 1 << 0;
+static constexpr int32 ENTITY_TRIGGER_SLASH = 1 << 1;
+static constexpr int32 ENTITY_TRIGGER_NUMBER_SIGN = 1 << 2;
+static constexpr int32 ENTITY_TRIGGER_DOLLAR_SIGN = 1 << 3;
+static constexpr int32 ENTITY_TRIGGER_COLON = 1 << 4;
+static constexpr int32 ENTITY_TRIGGER_DOT = 1 << 5;
+static constexpr int32 ENTITY_TRIGGER_DIGIT = 1 << 6;
+static constexpr int32 ENTITY_TRIGGER_BANK_CARD_DIGITS = 1 << 7;
+
+// returns mask of characters, which can start or delimit an entity, found in a single pass over the text
+// entities of a type can't be found in the text, if none of their trigger characters is present
+static int32 get_entity_triggers(Slice text) {
+  static const auto trigger_table = [] {
+    std::array<uint8, 256> table{};
+    table['@'] = ENTITY_TRIGGER_AT_SIGN;
+    table['/'] = ENTITY_TRIGGER_SLASH;
+    table['#'] = ENTITY_TRIGGER_NUMBER_SIGN;
+    table['$'] = ENTITY_TRIGGER_DOLLAR_SIGN;
+    table[':'] = ENTITY_TRIGGER_COLON;
+    table['.'] = ENTITY_TRIGGER_DOT;
+    for (int c = '0'; c <= '9'; c++) {
+      table[c] = ENTITY_TRIGGER_DIGIT;
+    }
+    return table;
+  }();
+
+  int32 triggers = 0;
+  size_t digit_count = 0;
+  for (auto ptr = text.ubegin(), end = text.uend(); ptr != end; ++ptr) {
+    auto trigger = trigger_table[*ptr];
+    triggers |= trigger;
+    digit_count += static_cast<size_t>(trigger == ENTITY_TRIGGER_DIGIT);
+  }
+  // a bank card number contains at least 13 digits
+  if (digit_count >= 13) {
+    triggers |= ENTITY_TRIGGER_BANK_CARD_DIGITS;
+  }
+  return triggers;
+}
+
 vector<MessageEntity> find_entities(Slice text, bool skip_bot_commands, bool skip_media_timestamps) {
   vector<MessageEntity> entities;
+  auto triggers = get_entity_triggers(text);
+  if ((triggers & ~ENTITY_TRIGGER_DIGIT) == 0) {
+    return entities;
+  }
 
   auto add_entities = [&entities, &text](MessageEntity::Type type, vector<Slice> (*find_entities_f)(Slice)) mutable {
     auto new_entities = find_entities_f(text);
@@ -1701,23 +1746,35 @@ vector<MessageEntity> find_entities(Slice text, bool skip_bot_commands, bool ski
       entities.emplace_back(type, offset, length);
     }
   };
-  add_entities(MessageEntity::Type::Mention, find_mentions);
-  if (!skip_bot_commands) {
+  if ((triggers & ENTITY_TRIGGER_AT_SIGN) != 0) {
+    add_entities(MessageEntity::Type::Mention, find_mentions);
+  }
+  if (!skip_bot_commands && (triggers & ENTITY_TRIGGER_SLASH) != 0) {
     add_entities(MessageEntity::Type::BotCommand, find_bot_commands);
   }
-  add_entities(MessageEntity::Type::Hashtag, find_hashtags);
-  add_entities(MessageEntity::Type::Cashtag, find_cashtags);
+  if ((triggers & ENTITY_TRIGGER_NUMBER_SIGN) != 0) {
+    add_entities(MessageEntity::Type::Hashtag, find_hashtags);
+  }
+  if ((triggers & ENTITY_TRIGGER_DOLLAR_SIGN) != 0) {
+    add_entities(MessageEntity::Type::Cashtag, find_cashtags);
+  }
   // TODO find_phone_numbers
-  add_entities(MessageEntity::Type::BankCardNumber, find_bank_card_numbers);
-  add_entities(MessageEntity::Type::Url, find_tg_urls);
-  auto urls = find_urls(text);
-  for (auto &url : urls) {
-    auto type = url.second ? MessageEntity::Type::EmailAddress : MessageEntity::Type::Url;
-    auto offset = narrow_cast<int32>(url.first.begin() - text.begin());
-    auto length = narrow_cast<int32>(url.first.size());
-    entities.emplace_back(type, offset, length);
-  }
-  if (!skip_media_timestamps) {
+  if ((triggers & ENTITY_TRIGGER_BANK_CARD_DIGITS) != 0) {
+    add_entities(MessageEntity::Type::BankCardNumber, find_bank_card_numbers);
+  }
+  if ((triggers & ENTITY_TRIGGER_COLON) != 0) {
+    add_entities(MessageEntity::Type::Url, find_tg_urls);
+  }
+  if ((triggers & ENTITY_TRIGGER_DOT) != 0) {
+    auto urls = find_urls(text);
+    for (auto &url : urls) {
+      auto type = url.second ? MessageEntity::Type::EmailAddress : MessageEntity::Type::Url;
+      auto offset = narrow_cast<int32>(url.first.begin() - text.begin());
+      auto length = narrow_cast<int32>(url.first.size());
+      entities.emplace_back(type, offset, length);
+    }
+  }
+  if (!skip_media_timestamps && (triggers & ENTITY_TRIGGER_COLON) != 0) {
     auto media_timestamps = find_media_timestamps(text);
     for (auto &entity : media_timestamps) {
       auto offset = narrow_cast<int32>(entity.first.begin() - text.begin());
@@ -4241,7 +4298,8 @@ Status fix_formatted_text(string &text, vector<MessageEntity> &entities, bool al
       text = std::move(result);
     }
   }
-  LOG_CHECK(check_utf8(text)) << text;
+  // the text was validated before and only whole UTF-8 characters were removed from it
+  LOG_DCHECK(check_utf8(text)) << text;
 
   if (!allow_empty && is_empty_string(text)) {
     return Status::Error(400, "Message must be non-empty");
@@ -4542,7 +4600,7 @@ void remove_unallowed_entities(const Td *td, FormattedText &text, DialogId dialo
       remove_intersecting_entities(text.entities);
     }
   }
-  if (!td->option_manager_->get_option_boolean("is_premium") &&
+  if (!td->option_manager_->get_option_boolean(OptionId::IsPremium) &&
       dialog_id != DialogId(td->contacts_manager_->get_my_id())) {
     remove_premium_custom_emoji_entities(td, text.entities, false);
   }
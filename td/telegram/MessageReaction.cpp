@@ -41,7 +41,7 @@
 namespace td {
 
 static size_t get_max_reaction_count() {
-  bool is_premium = G()->get_option_boolean("is_premium");
+  bool is_premium = G()->get_option_boolean(OptionId::IsPremium);
   auto option_key = is_premium ? Slice("reactions_user_max_premium") : Slice("reactions_user_max_default");
   return static_cast<size_t>(
       max(static_cast<int32>(1), static_cast<int32>(G()->get_option_integer(option_key, is_premium ? 3 : 1))));
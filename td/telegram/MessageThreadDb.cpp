@@ -11,6 +11,7 @@
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteStatement.h"
+#include "td/db/WriteBatcher.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/SchedulerLocalStorage.h"
@@ -280,32 +281,26 @@ class MessageThreadDbAsync final : public MessageThreadDbAsyncInterface {
 
     void force_flush() {
       do_flush();
-      LOG(INFO) << "MessageThreadDb flushed";
+      LOG(INFO) << "MessageThreadDb flushed with " << write_batcher_.get_stats();
     }
 
    private:
     std::shared_ptr<MessageThreadDbSyncSafeInterface> sync_db_safe_;
     MessageThreadDbSyncInterface *sync_db_ = nullptr;
 
-    static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
-    static constexpr double MAX_PENDING_QUERIES_DELAY{0.01};
+    WriteBatcher write_batcher_;
 
     //NB: order is important, destructor of pending_writes_ will change finished_writes_
     vector<Promise<Unit>> finished_writes_;
     vector<Promise<Unit>> pending_writes_;  // TODO use Action
-    double wakeup_at_ = 0;
 
     template <class F>
     void add_write_query(F &&f) {
       pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f)));
-      if (pending_writes_.size() > MAX_PENDING_QUERIES_COUNT) {
+      if (write_batcher_.need_flush(pending_writes_.size())) {
         do_flush();
-        wakeup_at_ = 0;
-      } else if (wakeup_at_ == 0) {
-        wakeup_at_ = Time::now_cached() + MAX_PENDING_QUERIES_DELAY;
-      }
-      if (wakeup_at_ != 0) {
-        set_timeout_at(wakeup_at_);
+      } else if (pending_writes_.size() == 1) {
+        set_timeout_at(write_batcher_.get_flush_time(Time::now_cached()));
       }
     }
 
@@ -317,9 +312,12 @@ class MessageThreadDbAsync final : public MessageThreadDbAsyncInterface {
       if (pending_writes_.empty()) {
         return;
       }
+      auto batch_size = pending_writes_.size();
+      auto start_time = Time::now();
       sync_db_->begin_write_transaction().ensure();
       set_promises(pending_writes_);
       sync_db_->commit_transaction().ensure();
+      write_batcher_.on_commit(batch_size, Time::now() - start_time);
       set_promises(finished_writes_);
       cancel_timeout();
     }
@@ -3425,7 +3425,7 @@ class SendMessageQuery final : public Td::ResultHandler {
             std::move(entities), schedule_date, std::move(as_input_peer)),
         {{dialog_id, MessageContentType::Text},
          {dialog_id, is_copy ? MessageContentType::Photo : MessageContentType::Text}});
-    if (td_->option_manager_->get_option_boolean("use_quick_ack")) {
+    if (td_->option_manager_->get_option_boolean(OptionId::UseQuickAck)) {
       query->quick_ack_promise_ = PromiseCreator::lambda([random_id](Result<Unit> result) {
         if (result.is_ok()) {
           send_closure(G()->messages_manager(), &MessagesManager::on_send_message_get_quick_ack, random_id);
@@ -3494,7 +3494,7 @@ class StartBotQuery final : public Td::ResultHandler {
     auto query = G()->net_query_creator().create(
         telegram_api::messages_startBot(std::move(bot_input_user), std::move(input_peer), random_id, parameter),
         {{dialog_id, MessageContentType::Text}, {dialog_id, MessageContentType::Photo}});
-    if (td_->option_manager_->get_option_boolean("use_quick_ack")) {
+    if (td_->option_manager_->get_option_boolean(OptionId::UseQuickAck)) {
       query->quick_ack_promise_ = PromiseCreator::lambda([random_id](Result<Unit> result) {
         if (result.is_ok()) {
           send_closure(G()->messages_manager(), &MessagesManager::on_send_message_get_quick_ack, random_id);
@@ -3743,7 +3743,7 @@ class SendMediaQuery final : public Td::ResultHandler {
             top_thread_message_id.get_server_message_id().get(), std::move(input_media), text, random_id,
             std::move(reply_markup), std::move(entities), schedule_date, std::move(as_input_peer)),
         {{dialog_id, content_type}, {dialog_id, is_copy ? MessageContentType::Text : content_type}});
-    if (td_->option_manager_->get_option_boolean("use_quick_ack") && was_uploaded_) {
+    if (td_->option_manager_->get_option_boolean(OptionId::UseQuickAck) && was_uploaded_) {
       query->quick_ack_promise_ = PromiseCreator::lambda([random_id](Result<Unit> result) {
         if (result.is_ok()) {
           send_closure(G()->messages_manager(), &MessagesManager::on_send_message_get_quick_ack, random_id);
@@ -4111,7 +4111,7 @@ class ForwardMessagesQuery final : public Td::ResultHandler {
             std::move(random_ids), std::move(to_input_peer), top_thread_message_id.get_server_message_id().get(),
             schedule_date, std::move(as_input_peer)),
         {{to_dialog_id, MessageContentType::Text}, {to_dialog_id, MessageContentType::Photo}});
-    if (td_->option_manager_->get_option_boolean("use_quick_ack")) {
+    if (td_->option_manager_->get_option_boolean(OptionId::UseQuickAck)) {
       query->quick_ack_promise_ = PromiseCreator::lambda([random_ids = random_ids_](Result<Unit> result) {
         if (result.is_ok()) {
           for (auto random_id : random_ids) {
@@ -4927,7 +4927,7 @@ void MessagesManager::Message::store(StorerT &storer) const {
   bool has_flags2 = true;
   bool has_notification_id = notification_id.is_valid();
   bool has_forward_sender_name = is_forwarded && !forward_info->sender_name.empty();
-  bool has_send_error_code = send_error_code != 0;
+  bool has_send_error_code = send_error != nullptr && send_error->code != 0;
   bool has_real_forward_from = real_forward_from_dialog_id.is_valid() && real_forward_from_message_id.is_valid();
   bool has_legacy_layer = legacy_layer != 0;
   bool has_restriction_reasons = !restriction_reasons.empty();
@@ -5088,10 +5088,10 @@ void MessagesManager::Message::store(StorerT &storer) const {
     store_time(ttl_expires_at, storer);
   }
   if (has_send_error_code) {
-    store(send_error_code, storer);
-    store(send_error_message, storer);
-    if (send_error_code == 429) {
-      store_time(try_resend_at, storer);
+    store(send_error->code, storer);
+    store(send_error->message, storer);
+    if (send_error->code == 429) {
+      store_time(send_error->try_resend_at, storer);
     }
   }
   if (has_author_signature) {
@@ -5347,10 +5347,11 @@ void MessagesManager::Message::parse(ParserT &parser) {
     parse_time(ttl_expires_at, parser);
   }
   if (has_send_error_code) {
-    parse(send_error_code, parser);
-    parse(send_error_message, parser);
-    if (send_error_code == 429) {
-      parse_time(try_resend_at, parser);
+    send_error = make_unique<MessageSendError>();
+    parse(send_error->code, parser);
+    parse(send_error->message, parser);
+    if (send_error->code == 429) {
+      parse_time(send_error->try_resend_at, parser);
     }
   }
   if (has_author_signature) {
@@ -5392,7 +5393,9 @@ void MessagesManager::Message::parse(ParserT &parser) {
   if (has_send_emoji) {
     parse(send_emoji, parser);
   }
-  parse_message_content(content, parser);
+  unique_ptr<MessageContent> parsed_content;
+  parse_message_content(parsed_content, parser);
+  content = std::move(parsed_content);
   if (has_reply_markup) {
     parse(reply_markup, parser);
   }
@@ -6095,6 +6098,8 @@ MessagesManager::MessagesManager(Td *td, ActorShared<> parent)
 
   pending_read_history_timeout_.set_callback(on_pending_read_history_timeout_callback);
   pending_read_history_timeout_.set_callback_data(static_cast<void *>(this));
+  read_history_flood_control_.add_limit(1, 5);
+  read_history_flood_control_.add_limit(10, 20);
 
   pending_updated_dialog_timeout_.set_callback(on_pending_updated_dialog_timeout_callback);
   pending_updated_dialog_timeout_.set_callback_data(static_cast<void *>(this));
@@ -6119,6 +6124,9 @@ MessagesManager::MessagesManager(Td *td, ActorShared<> parent)
 
   update_viewed_messages_timeout_.set_callback(on_update_viewed_messages_timeout_callback);
   update_viewed_messages_timeout_.set_callback_data(static_cast<void *>(this));
+
+  bulk_send_timeout_.set_callback(on_bulk_send_timeout_callback);
+  bulk_send_timeout_.set_callback_data(static_cast<void *>(this));
 }
 
 MessagesManager::~MessagesManager() {
@@ -6266,17 +6274,19 @@ void MessagesManager::on_update_viewed_messages_timeout_callback(void *messages_
                      DialogId(dialog_id_int));
 }
 
-BufferSlice MessagesManager::get_dialog_database_value(const Dialog *d) {
-  // can't use log_event_store, because it tries to parse stored Dialog
-  LogEventStorerCalcLength storer_calc_length;
-  store(*d, storer_calc_length);
+void MessagesManager::on_bulk_send_timeout_callback(void *messages_manager_ptr, int64 bulk_send_id) {
+  if (G()->close_flag()) {
+    return;
+  }
 
-  BufferSlice value_buffer{storer_calc_length.get_length()};
-  auto value = value_buffer.as_mutable_slice();
+  auto messages_manager = static_cast<MessagesManager *>(messages_manager_ptr);
+  send_closure_later(messages_manager->actor_id(messages_manager), &MessagesManager::on_bulk_send_timeout,
+                     bulk_send_id);
+}
 
-  LogEventStorerUnsafe storer_unsafe(value.ubegin());
-  store(*d, storer_unsafe);
-  return value_buffer;
+BufferSlice MessagesManager::get_dialog_database_value(const Dialog *d) {
+  // can't use log_event_store, because it tries to parse stored Dialog
+  return log_event_store_by_function([d](auto &storer) { store(*d, storer); });
 }
 
 void MessagesManager::save_dialog_to_database(DialogId dialog_id) {
@@ -7473,15 +7483,14 @@ void MessagesManager::on_update_message_extended_media(
     return;
   }
 
-  auto content = m->content.get();
-  auto content_type = content->get_type();
+  auto content_type = m->content->get_type();
   if (content_type != MessageContentType::Invoice) {
     if (content_type != MessageContentType::Unsupported) {
       LOG(ERROR) << "Receive updateMessageExtendedMedia for " << full_message_id << " of type " << content_type;
     }
     return;
   }
-  if (update_message_content_extended_media(content, std::move(extended_media), dialog_id, td_)) {
+  if (update_message_content_extended_media(m->content.get_mutable(), std::move(extended_media), dialog_id, td_)) {
     send_update_message_content(d, m, true, "on_update_message_extended_media");
     on_message_changed(d, m, true, "on_update_message_extended_media");
     on_message_notification_changed(d, m, "on_update_message_extended_media");  // usually a no-op
@@ -9319,7 +9328,7 @@ void MessagesManager::do_send_media(DialogId dialog_id, Message *m, FileId file_
             << ", have_input_file = " << have_input_file << ", have_input_thumbnail = " << have_input_thumbnail
             << ", self-destruct time = " << m->ttl;
 
-  MessageContent *content = nullptr;
+  const MessageContent *content = nullptr;
   if (m->message_id.is_any_server()) {
     content = m->edited_content.get();
     if (content == nullptr) {
@@ -9416,7 +9425,7 @@ void MessagesManager::on_load_secret_thumbnail(FileId thumbnail_file_id, BufferS
   CHECK(m->message_id.is_yet_unsent());
 
   if (thumbnail.empty()) {
-    delete_message_content_thumbnail(m->content.get(), td_);
+    delete_message_content_thumbnail(m->content.get_mutable(), td_);
   }
 
   auto dialog_id = full_message_id.get_dialog_id();
@@ -9464,7 +9473,7 @@ void MessagesManager::on_upload_thumbnail(FileId thumbnail_file_id,
   bool is_edit = m->message_id.is_any_server();
 
   if (thumbnail_input_file == nullptr) {
-    delete_message_content_thumbnail(is_edit ? m->edited_content.get() : m->content.get(), td_);
+    delete_message_content_thumbnail(is_edit ? m->edited_content.get() : m->content.get_mutable(), td_);
   }
 
   auto dialog_id = full_message_id.get_dialog_id();
@@ -10900,6 +10909,7 @@ void MessagesManager::update_dialog_pinned_messages_from_updates(DialogId dialog
     return;
   }
 
+  preload_messages_from_database(d, message_ids, "update_dialog_pinned_messages_from_updates");
   for (auto message_id : message_ids) {
     if (!message_id.is_valid() || (!message_id.is_server() && dialog_id.get_type() != DialogType::SecretChat)) {
       LOG(ERROR) << "Incoming update tries to pin/unpin " << message_id << " in " << dialog_id;
@@ -11094,9 +11104,9 @@ bool MessagesManager::can_revoke_message(DialogId dialog_id, const Message *m) c
   auto content_type = m->content->get_type();
   switch (dialog_id.get_type()) {
     case DialogType::User: {
-      bool can_revoke_incoming = td_->option_manager_->get_option_boolean("revoke_pm_inbox", true);
+      bool can_revoke_incoming = td_->option_manager_->get_option_boolean(OptionId::RevokePmInbox, true);
       int64 revoke_time_limit =
-          td_->option_manager_->get_option_integer("revoke_pm_time_limit", DEFAULT_REVOKE_TIME_LIMIT);
+          td_->option_manager_->get_option_integer(OptionId::RevokePmTimeLimit, DEFAULT_REVOKE_TIME_LIMIT);
 
       if (G()->unix_time_cached() - m->date < 86400 && content_type == MessageContentType::Dice) {
         return false;
@@ -11109,7 +11119,7 @@ bool MessagesManager::can_revoke_message(DialogId dialog_id, const Message *m) c
       bool is_appointed_administrator =
           td_->contacts_manager_->is_appointed_chat_administrator(dialog_id.get_chat_id());
       int64 revoke_time_limit =
-          td_->option_manager_->get_option_integer("revoke_time_limit", DEFAULT_REVOKE_TIME_LIMIT);
+          td_->option_manager_->get_option_integer(OptionId::RevokeTimeLimit, DEFAULT_REVOKE_TIME_LIMIT);
 
       return ((m->is_outgoing && !is_service_message_content(content_type)) || is_appointed_administrator) &&
              G()->unix_time_cached() - m->date <= revoke_time_limit;
@@ -11431,7 +11441,7 @@ MessagesManager::CanDeleteDialog MessagesManager::can_delete_dialog(const Dialog
           td_->contacts_manager_->is_user_bot(d->dialog_id.get_user_id())) {
         return {true, false};
       }
-      return {true, td_->option_manager_->get_option_boolean("revoke_pm_inbox", true)};
+      return {true, td_->option_manager_->get_option_boolean(OptionId::RevokePmInbox, true)};
     case DialogType::Chat:
       // chats can be deleted only for self and can be deleted for everyone by their creator
       return {true, td_->contacts_manager_->get_chat_status(d->dialog_id.get_chat_id()).is_creator()};
@@ -12008,7 +12018,37 @@ int32 MessagesManager::get_unload_dialog_delay() const {
 
   CHECK(is_message_unload_enabled());
   auto default_unload_delay = td_->auth_manager_->is_bot() ? DIALOG_UNLOAD_BOT_DELAY : DIALOG_UNLOAD_DELAY;
-  return narrow_cast<int32>(td_->option_manager_->get_option_integer("message_unload_delay", default_unload_delay));
+  auto unload_delay =
+      narrow_cast<int32>(td_->option_manager_->get_option_integer("message_unload_delay", default_unload_delay));
+  if (message_unload_threshold_ > 0 && loaded_message_count_ > message_unload_threshold_) {
+    // the more messages are loaded, the sooner the least recently accessed of them are unloaded
+    constexpr int32 MIN_DIALOG_UNLOAD_DELAY = 8;  // seconds
+    auto scaled_unload_delay = static_cast<double>(unload_delay) * static_cast<double>(message_unload_threshold_) /
+                               static_cast<double>(loaded_message_count_);
+    unload_delay = max(static_cast<int32>(scaled_unload_delay), min(unload_delay, MIN_DIALOG_UNLOAD_DELAY));
+  }
+  return unload_delay;
+}
+
+void MessagesManager::on_update_message_unload_threshold() {
+  message_unload_threshold_ = td_->option_manager_->get_option_integer("message_unload_threshold");
+}
+
+void MessagesManager::on_loaded_message_count_exceeded() {
+  auto now = Time::now();
+  if (now < last_fast_unload_time_ + 1.0 || !is_message_unload_enabled()) {
+    return;
+  }
+  last_fast_unload_time_ = now;
+
+  LOG(INFO) << "Have " << loaded_message_count_ << " loaded messages with threshold " << message_unload_threshold_
+            << "; unloaded " << unloaded_message_count_ << " and reloaded " << reloaded_message_count_
+            << " messages since start";
+  dialogs_.foreach([&](const DialogId &dialog_id, unique_ptr<Dialog> &dialog) {
+    if (dialog->has_unload_timeout) {
+      pending_unload_dialog_timeout_.set_timeout_in(dialog_id.get(), get_next_unload_dialog_delay(dialog.get()) / 8);
+    }
+  });
 }
 
 double MessagesManager::get_next_unload_dialog_delay(Dialog *d) const {
@@ -12040,10 +12080,16 @@ void MessagesManager::unload_dialog(DialogId dialog_id) {
     return;
   }
 
+  unload_dialog_messages(d, G()->unix_time_cached() - get_unload_dialog_delay() + 2);
+}
+
+void MessagesManager::unload_dialog_messages(Dialog *d, int32 unload_before_date) {
+  CHECK(d != nullptr);
+  auto dialog_id = d->dialog_id;
   vector<MessageId> to_unload_message_ids;
   bool has_left_to_unload_messages = false;
-  find_unloadable_messages(d, G()->unix_time_cached() - get_unload_dialog_delay() + 2, d->messages.get(),
-                           to_unload_message_ids, has_left_to_unload_messages);
+  find_unloadable_messages(d, unload_before_date, d->messages.get(), to_unload_message_ids,
+                           has_left_to_unload_messages);
 
   vector<int64> unloaded_message_ids;
   vector<unique_ptr<Message>> unloaded_messages;
@@ -12055,6 +12101,7 @@ void MessagesManager::unload_dialog(DialogId dialog_id) {
     }
     unloaded_messages.push_back(std::move(message));
   }
+  unloaded_message_count_ += static_cast<int64>(unloaded_messages.size());
   if (unloaded_messages.size() >= MIN_DELETED_ASYNCHRONOUSLY_MESSAGES) {
     Scheduler::instance()->destroy_on_scheduler(G()->get_gc_scheduler_id(), unloaded_messages);
   }
@@ -12080,6 +12127,22 @@ void MessagesManager::unload_dialog(DialogId dialog_id) {
   }
 }
 
+int64 MessagesManager::unload_all_messages() {
+  if (G()->close_flag() || !is_message_unload_enabled()) {
+    return 0;
+  }
+
+  auto old_unloaded_message_count = unloaded_message_count_;
+  auto unload_before_date = G()->unix_time() + 1;
+  dialogs_.foreach([&](const DialogId &dialog_id, unique_ptr<Dialog> &dialog) {
+    if (dialog->messages != nullptr) {
+      dialog->has_unload_timeout = true;
+      unload_dialog_messages(dialog.get(), unload_before_date);
+    }
+  });
+  return unloaded_message_count_ - old_unloaded_message_count;
+}
+
 void MessagesManager::delete_all_dialog_messages(Dialog *d, bool remove_from_dialog_list, bool is_permanently_deleted) {
   CHECK(d != nullptr);
   LOG(INFO) << "Delete all messages in " << d->dialog_id
@@ -12126,7 +12189,11 @@ void MessagesManager::delete_all_dialog_messages(Dialog *d, bool remove_from_dia
   }
 
   vector<int64> deleted_message_ids;
-  do_delete_all_dialog_messages(d, d->messages, is_permanently_deleted, deleted_message_ids);
+  vector<unique_ptr<Message>> deleted_messages;
+  do_delete_all_dialog_messages(d, d->messages, is_permanently_deleted, deleted_message_ids, deleted_messages);
+  if (deleted_messages.size() >= MIN_DELETED_ASYNCHRONOUSLY_MESSAGES) {
+    Scheduler::instance()->destroy_on_scheduler(G()->get_gc_scheduler_id(), deleted_messages);
+  }
   delete_all_dialog_messages_from_database(d, MessageId::max(), "delete_all_dialog_messages 3");
   if (is_permanently_deleted) {
     for (auto id : deleted_message_ids) {
@@ -12456,7 +12523,7 @@ bool MessagesManager::read_message_content(Dialog *d, Message *m, bool is_local_
   LOG_CHECK(m != nullptr) << source;
   CHECK(!m->message_id.is_scheduled());
   bool is_mention_read = update_message_contains_unread_mention(d, m, false, "read_message_content");
-  bool is_content_read = update_opened_message_content(m->content.get());
+  bool is_content_read = update_opened_message_content(m->content.get_mutable());
   if (ttl_on_open(d, m, Time::now(), is_local_read)) {
     is_content_read = true;
   }
@@ -13141,7 +13208,9 @@ void MessagesManager::set_dialog_max_unavailable_message_id(DialogId dialog_id,
     find_old_messages(d->messages.get(), max_unavailable_message_id, message_ids);
 
     vector<int64> deleted_message_ids;
+    vector<unique_ptr<Message>> deleted_messages;
     bool need_update_dialog_pos = false;
+    being_range_deleted_full_message_id_ = FullMessageId{dialog_id, max_unavailable_message_id};
     for (auto message_id : message_ids) {
       if (message_id.is_yet_unsent()) {
         continue;
@@ -13155,6 +13224,18 @@ void MessagesManager::set_dialog_max_unavailable_message_id(DialogId dialog_id,
           delete_message(d, message_id, !from_update, &need_update_dialog_pos, "set_dialog_max_unavailable_message_id");
       CHECK(p.get() == m);
       deleted_message_ids.push_back(p->message_id.get());
+      deleted_messages.push_back(std::move(p));
+    }
+    being_range_deleted_full_message_id_ = FullMessageId();
+    if (max_unavailable_message_id.is_valid()) {
+      delete_all_dialog_messages_from_database(d, max_unavailable_message_id, "set_dialog_max_unavailable_message_id");
+      if (d->last_database_message_id.is_valid() && d->last_database_message_id <= max_unavailable_message_id) {
+        set_dialog_first_database_message_id(d, MessageId(), "set_dialog_max_unavailable_message_id");
+        set_dialog_last_database_message_id(d, MessageId(), "set_dialog_max_unavailable_message_id");
+      }
+    }
+    if (deleted_messages.size() >= MIN_DELETED_ASYNCHRONOUSLY_MESSAGES) {
+      Scheduler::instance()->destroy_on_scheduler(G()->get_gc_scheduler_id(), deleted_messages);
     }
 
     if (need_update_dialog_pos) {
@@ -13278,6 +13359,8 @@ void MessagesManager::on_update_viewed_messages_timeout(DialogId dialog_id) {
 
   auto &info = it->second;
   CHECK(info != nullptr);
+  auto poll_count = ++info->poll_count;
+  auto now = G()->unix_time();
   vector<MessageId> reaction_message_ids;
   vector<MessageId> views_message_ids;
   vector<MessageId> extended_media_message_ids;
@@ -13286,10 +13369,16 @@ void MessagesManager::on_update_viewed_messages_timeout(DialogId dialog_id) {
     CHECK(m != nullptr);
     CHECK(m->message_id.is_valid());
     CHECK(m->message_id.is_server());
-    if (need_poll_message_reactions(d, m)) {
+
+    // interaction info of older messages changes slower, so poll it less often
+    auto message_age = now - m->date;
+    uint32 poll_period = message_age >= 86400 ? 4 : (message_age >= 3600 ? 2 : 1);
+    bool need_poll_interaction_info = poll_count % poll_period == 0;
+
+    if (need_poll_interaction_info && need_poll_message_reactions(d, m)) {
       reaction_message_ids.push_back(m->message_id);
     }
-    if (m->view_count > 0 && !m->has_get_message_views_query) {
+    if (need_poll_interaction_info && m->view_count > 0 && !m->has_get_message_views_query) {
       m->has_get_message_views_query = true;
       views_message_ids.push_back(m->message_id);
     }
@@ -13702,12 +13791,14 @@ void MessagesManager::init() {
     return;
   }
   is_inited_ = true;
+  auto init_start_time = Time::now();
 
   td_->notification_settings_manager_->init();  // load scope notification settings
   init_stickers_manager(td_);                   // load available reactions
 
   start_time_ = Time::now();
   last_channel_pts_jump_warning_time_ = start_time_ - 3600;
+  on_update_message_unload_threshold();
 
   bool is_authorized = td_->auth_manager_->is_authorized();
   bool was_authorized_user = td_->auth_manager_->was_authorized() && !td_->auth_manager_->is_bot();
@@ -13717,7 +13808,7 @@ void MessagesManager::init() {
   if (is_authorized && td_->auth_manager_->is_bot()) {
     disable_get_dialog_filter_ = true;
   }
-  authorization_date_ = td_->option_manager_->get_option_integer("authorization_date");
+  authorization_date_ = td_->option_manager_->get_option_integer(OptionId::AuthorizationDate);
 
   if (was_authorized_user) {
     auto dialog_filters = G()->td_db()->get_binlog_pmc()->get("dialog_filters");
@@ -13726,7 +13817,7 @@ void MessagesManager::init() {
       if (log_event_parse(log_event, dialog_filters).is_ok()) {
         server_main_dialog_list_position_ = log_event.server_main_dialog_list_position;
         main_dialog_list_position_ = log_event.main_dialog_list_position;
-        if (!td_->option_manager_->get_option_boolean("is_premium") &&
+        if (!td_->option_manager_->get_option_boolean(OptionId::IsPremium) &&
             (server_main_dialog_list_position_ != 0 || main_dialog_list_position_ != 0)) {
           LOG(INFO) << "Ignore main chat list position " << server_main_dialog_list_position_ << '/'
                     << main_dialog_list_position_;
@@ -13971,6 +14062,8 @@ void MessagesManager::init() {
     }
   }
 
+  td_->add_startup_phase("MessagesManager::init", init_start_time, static_cast<int64>(dialogs_.calc_size()));
+
   /*
   FI LE *f = std::f open("error.txt", "r");
   if (f != nullptr) {
@@ -14119,7 +14212,7 @@ void MessagesManager::init() {
 
 void MessagesManager::on_authorization_success() {
   CHECK(td_->auth_manager_->is_authorized());
-  authorization_date_ = td_->option_manager_->get_option_integer("authorization_date");
+  authorization_date_ = td_->option_manager_->get_option_integer(OptionId::AuthorizationDate);
 
   if (td_->auth_manager_->is_bot()) {
     disable_get_dialog_filter_ = true;
@@ -15848,7 +15941,7 @@ void MessagesManager::delete_pending_message_web_page(FullMessageId full_message
   Message *m = get_message(d, full_message_id.get_message_id());
   CHECK(m != nullptr);
 
-  MessageContent *content = m->content.get();
+  MessageContent *content = m->content.get_mutable();
   CHECK(has_message_content_web_page(content));
   unregister_message_content(td_, content, full_message_id, "delete_pending_message_web_page");
   remove_message_content_web_page(content);
@@ -16803,6 +16896,7 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
   }
 
   auto result = treap_delete_message(v);
+  loaded_message_count_--;
 
   d->being_deleted_message_id = MessageId();
 
@@ -16989,7 +17083,8 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_scheduled_messag
 }
 
 void MessagesManager::do_delete_all_dialog_messages(Dialog *d, unique_ptr<Message> &message,
-                                                    bool is_permanently_deleted, vector<int64> &deleted_message_ids) {
+                                                    bool is_permanently_deleted, vector<int64> &deleted_message_ids,
+                                                    vector<unique_ptr<Message>> &deleted_messages) {
   if (message == nullptr) {
     return;
   }
@@ -17004,15 +17099,16 @@ void MessagesManager::do_delete_all_dialog_messages(Dialog *d, unique_ptr<Messag
   LOG(INFO) << "Delete " << message_id;
   deleted_message_ids.push_back(message_id.get());
 
-  do_delete_all_dialog_messages(d, message->right, is_permanently_deleted, deleted_message_ids);
-  do_delete_all_dialog_messages(d, message->left, is_permanently_deleted, deleted_message_ids);
+  do_delete_all_dialog_messages(d, message->right, is_permanently_deleted, deleted_message_ids, deleted_messages);
+  do_delete_all_dialog_messages(d, message->left, is_permanently_deleted, deleted_message_ids, deleted_messages);
 
   delete_active_live_location(d->dialog_id, m);
   remove_message_file_sources(d->dialog_id, m);
 
   on_message_deleted(d, message.get(), is_permanently_deleted, "do_delete_all_dialog_messages");
 
-  message = nullptr;
+  deleted_messages.push_back(std::move(message));
+  loaded_message_count_--;
 }
 
 bool MessagesManager::have_dialog(DialogId dialog_id) const {
@@ -17621,6 +17717,8 @@ void MessagesManager::on_get_dialogs_from_database(FolderId folder_id, int32 lim
   }
   folder.load_dialog_list_limit_max_ = 0;
 
+  td_->contacts_manager_->load_dialog_infos_from_database(dialogs.dialog_ids);
+
   size_t dialogs_skipped = 0;
   for (auto &dialog : dialogs.dialogs) {
     Dialog *d = on_load_dialog_from_database(DialogId(), std::move(dialog), "on_get_dialogs_from_database");
@@ -17689,6 +17787,11 @@ void MessagesManager::preload_folder_dialog_list(FolderId folder_id) {
     LOG(INFO) << "Skip chat list preload in " << folder_id << ", because there is a pending load chat list request";
     return;
   }
+  if (td_->option_manager_->get_option_boolean("disable_chat_list_preloading")) {
+    // chats are loaded only when they are requested by the application or accessed directly
+    LOG(INFO) << "Skip chat list preload in " << folder_id << ", because it is disabled";
+    return;
+  }
 
   if (folder.last_loaded_database_dialog_date_ < folder.last_database_server_dialog_date_) {
     // if there are some dialogs in database, preload some of them
@@ -17908,7 +18011,7 @@ void MessagesManager::on_get_dialog_filters(Result<vector<tl_object_ptr<telegram
     LOG(ERROR) << "Receive no dialogFilterDefault";
     server_main_dialog_list_position = 0;
   }
-  if (server_main_dialog_list_position != 0 && !td_->option_manager_->get_option_boolean("is_premium")) {
+  if (server_main_dialog_list_position != 0 && !td_->option_manager_->get_option_boolean(OptionId::IsPremium)) {
     LOG(INFO) << "Ignore server main chat list position " << server_main_dialog_list_position;
     server_main_dialog_list_position = 0;
   }
@@ -18203,6 +18306,26 @@ std::pair<int32, vector<DialogId>> MessagesManager::search_dialogs(const string
     return recently_found_dialogs_.get_dialogs(limit, std::move(promise));
   }
 
+  if (G()->parameters().use_message_db && !are_all_dialogs_loaded_from_database() &&
+      database_searched_dialog_queries_.insert(query).second) {
+    // dialogs, which aren't loaded yet, aren't in dialogs_hints_, so they need to be found and loaded from the database
+    if (database_searched_dialog_queries_.size() > MAX_DATABASE_SEARCHED_DIALOG_QUERIES) {
+      database_searched_dialog_queries_.clear();
+      database_searched_dialog_queries_.insert(query);
+    }
+    G()->td_db()->get_dialog_db_async()->search_dialogs(
+        query, limit,
+        PromiseCreator::lambda([actor_id = actor_id(this), promise = std::move(promise)](
+                                   Result<vector<DialogId>> r_dialog_ids) mutable {
+          if (r_dialog_ids.is_error()) {
+            return promise.set_value(Unit());
+          }
+          send_closure(actor_id, &MessagesManager::on_search_dialogs_from_database, r_dialog_ids.move_as_ok(),
+                       std::move(promise));
+        }));
+    return {};
+  }
+
   auto result = dialogs_hints_.search(query, limit);
   vector<DialogId> dialog_ids;
   dialog_ids.reserve(result.second.size());
@@ -18214,6 +18337,26 @@ std::pair<int32, vector<DialogId>> MessagesManager::search_dialogs(const string
   return {narrow_cast<int32>(result.first), std::move(dialog_ids)};
 }
 
+bool MessagesManager::are_all_dialogs_loaded_from_database() const {
+  for (auto &it : dialog_folders_) {
+    if (it.second.last_loaded_database_dialog_date_ != MAX_DIALOG_DATE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MessagesManager::on_search_dialogs_from_database(vector<DialogId> dialog_ids, Promise<Unit> &&promise) {
+  TRY_STATUS_PROMISE(promise, G()->close_status());
+
+  LOG(INFO) << "Found " << dialog_ids.size() << " chats in database";
+  for (auto dialog_id : dialog_ids) {
+    // loaded dialogs are added to dialogs_hints_
+    get_dialog_force(dialog_id, "on_search_dialogs_from_database");
+  }
+  promise.set_value(Unit());
+}
+
 std::pair<int32, vector<DialogId>> MessagesManager::get_recently_opened_dialogs(int32 limit, Promise<Unit> &&promise) {
   CHECK(!td_->auth_manager_->is_bot());
   return recently_opened_dialogs_.get_dialogs(limit, std::move(promise));
@@ -19221,6 +19364,8 @@ bool MessagesManager::get_messages(DialogId dialog_id, const vector<MessageId> &
     return false;
   }
 
+  preload_messages_from_database(d, message_ids, "get_messages");
+
   bool is_secret = dialog_id.get_type() == DialogType::SecretChat;
   vector<FullMessageId> missed_message_ids;
   for (auto message_id : message_ids) {
@@ -20053,7 +20198,7 @@ void MessagesManager::reorder_dialog_filters(vector<DialogFilterId> dialog_filte
   if (main_dialog_list_position < 0 || main_dialog_list_position > static_cast<int32>(dialog_filters_.size())) {
     return promise.set_error(Status::Error(400, "Invalid main chat list position specified"));
   }
-  if (!td_->option_manager_->get_option_boolean("is_premium")) {
+  if (!td_->option_manager_->get_option_boolean(OptionId::IsPremium)) {
     main_dialog_list_position = 0;
   }
 
@@ -20144,6 +20289,7 @@ void MessagesManager::add_dialog_filter(unique_ptr<DialogFilter> dialog_filter,
   auto dialog_filter_id = dialog_filter->dialog_filter_id;
   LOG(INFO) << "Add " << dialog_filter_id << " from " << source;
   CHECK(get_dialog_filter(dialog_filter_id) == nullptr);
+  update_dialog_filter_dialog_ids(dialog_filter.get());
   if (at_beginning) {
     dialog_filters_.insert(dialog_filters_.begin(), std::move(dialog_filter));
   } else {
@@ -20211,6 +20357,7 @@ void MessagesManager::edit_dialog_filter(unique_ptr<DialogFilter> new_dialog_fil
       auto &old_list = *old_list_ptr;
 
       disable_get_dialog_filter_ = true;  // to ensure crash if get_dialog_filter is called
+      update_dialog_filter_dialog_ids(new_dialog_filter.get());
 
       auto folder_ids = get_dialog_filter_folder_ids(old_dialog_filter.get());
       CHECK(!folder_ids.empty());
@@ -20462,6 +20609,7 @@ int32 MessagesManager::delete_dialog_filter(DialogFilterId dialog_filter_id, con
       auto position = static_cast<int32>(it - dialog_filters_.begin());
       dialog_lists_.erase(dialog_list_id);
       dialog_filters_.erase(it);
+      dialog_filter_dialog_ids_.erase(dialog_filter_id);
       return position;
     }
   }
@@ -20469,6 +20617,22 @@ int32 MessagesManager::delete_dialog_filter(DialogFilterId dialog_filter_id, con
   return -1;
 }
 
+void MessagesManager::update_dialog_filter_dialog_ids(const DialogFilter *filter) {
+  auto &dialog_ids = dialog_filter_dialog_ids_[filter->dialog_filter_id];
+  dialog_ids.clear();
+  // explicitly included chats have priority over excluded
+  for (auto input_dialog_ids :
+       {&filter->excluded_dialog_ids, &filter->included_dialog_ids, &filter->pinned_dialog_ids}) {
+    bool is_included = input_dialog_ids != &filter->excluded_dialog_ids;
+    for (const auto &input_dialog_id : *input_dialog_ids) {
+      auto dialog_id = input_dialog_id.get_dialog_id();
+      if (dialog_id.is_valid()) {
+        dialog_ids[dialog_id] = is_included;
+      }
+    }
+  }
+}
+
 Status MessagesManager::delete_dialog_reply_markup(DialogId dialog_id, MessageId message_id) {
   if (td_->auth_manager_->is_bot()) {
     return Status::Error(400, "Bots can't delete chat reply markup");
@@ -20638,7 +20802,7 @@ int32 MessagesManager::get_pinned_dialogs_limit(DialogListId dialog_list_id) con
   }
   int32 limit = clamp(narrow_cast<int32>(td_->option_manager_->get_option_integer(key)), 0, 1000);
   if (limit <= 0) {
-    if (td_->option_manager_->get_option_boolean("is_premium")) {
+    if (td_->option_manager_->get_option_boolean(OptionId::IsPremium)) {
       default_limit *= 2;
     }
     return default_limit;
@@ -21024,7 +21188,7 @@ Status MessagesManager::toggle_dialog_is_translatable(DialogId dialog_id, bool i
   if (!have_input_peer(dialog_id, AccessRights::Read)) {
     return Status::Error(400, "Can't access the chat");
   }
-  if (!td_->option_manager_->get_option_boolean("is_premium")) {
+  if (!td_->option_manager_->get_option_boolean(OptionId::IsPremium)) {
     return Status::Error(400, "The method is available to Telegram Premium users only");
   }
 
@@ -22258,7 +22422,7 @@ td_api::object_ptr<td_api::MessageSender> MessagesManager::get_default_message_s
 td_api::object_ptr<td_api::chat> MessagesManager::get_chat_object(const Dialog *d) const {
   CHECK(d != nullptr);
 
-  bool is_premium = td_->option_manager_->get_option_boolean("is_premium");
+  bool is_premium = td_->option_manager_->get_option_boolean(OptionId::IsPremium);
   auto chat_source = is_dialog_sponsored(d) ? sponsored_dialog_source_.get_chat_source_object() : nullptr;
   auto can_delete = can_delete_dialog(d);
   // TODO hide/show draft message when can_send_message(dialog_id) changes
@@ -22758,11 +22922,19 @@ void MessagesManager::read_history_on_server(Dialog *d, MessageId max_message_id
 
     d->last_read_inbox_message_date = m->date;
   } else if (G()->parameters().use_message_db) {
-    ReadHistoryOnServerLogEvent log_event;
-    log_event.dialog_id_ = dialog_id;
-    log_event.max_message_id_ = max_message_id;
-    add_log_event(d->read_history_log_event_ids[0], get_log_event_storer(log_event),
-                  LogEvent::HandlerType::ReadHistoryOnServer, "read history");
+    auto &log_event_id = d->read_history_log_event_ids[0];
+    if (log_event_id.log_event_id == 0) {
+      ReadHistoryOnServerLogEvent log_event;
+      log_event.dialog_id_ = dialog_id;
+      log_event.max_message_id_ = max_message_id;
+      add_log_event(log_event_id, get_log_event_storer(log_event), LogEvent::HandlerType::ReadHistoryOnServer,
+                    "read history");
+    } else {
+      // there is no need to rewrite the existing log event, because on restart the history is read
+      // up to the maximum of the stored message and d->last_read_inbox_message_id anyway;
+      // increase generation to keep the log event until the new read history request is finished
+      log_event_id.generation++;
+    }
   }
 
   d->updated_read_history_message_ids.insert(MessageId());
@@ -22808,6 +22980,20 @@ void MessagesManager::do_read_history_on_server(DialogId dialog_id) {
   Dialog *d = get_dialog(dialog_id);
   CHECK(d != nullptr);
 
+  if (d->updated_read_history_message_ids.empty()) {
+    return;
+  }
+
+  // read history requests from all chats are paced together
+  auto now = Time::now();
+  auto wakeup_at = read_history_flood_control_.get_wakeup_at();
+  if (wakeup_at > now) {
+    LOG(INFO) << "Postpone reading history in " << dialog_id << " for " << wakeup_at - now << " seconds";
+    pending_read_history_timeout_.set_timeout_at(dialog_id.get(), wakeup_at);
+    return;
+  }
+  read_history_flood_control_.add_event(now);
+
   for (auto top_thread_message_id : d->updated_read_history_message_ids) {
     if (!top_thread_message_id.is_valid()) {
       read_history_on_server_impl(d, MessageId());
@@ -23201,7 +23387,7 @@ td_api::object_ptr<td_api::messageCalendar> MessagesManager::get_dialog_message_
       db_query.dialog_id = dialog_id;
       db_query.filter = filter;
       db_query.from_message_id = fixed_from_message_id;
-      db_query.tz_offset = static_cast<int32>(td_->option_manager_->get_option_integer("utc_time_offset"));
+      db_query.tz_offset = static_cast<int32>(td_->option_manager_->get_option_integer(OptionId::UtcTimeOffset));
       G()->td_db()->get_message_db_async()->get_dialog_message_calendar(db_query, std::move(new_promise));
       return {};
     }
@@ -24717,17 +24903,65 @@ void MessagesManager::preload_older_messages(const Dialog *d, MessageId min_mess
       return;
     }
   */
+  auto &state = history_preload_states_[d->dialog_id];
+  auto now = Time::now();
+  if (state.older_preload_depth != 0 && now - state.last_get_history_time < FAST_HISTORY_SCROLL_DELAY) {
+    // the history is scrolled fast, so preload more messages in advance
+    state.older_preload_depth = min(state.older_preload_depth * 2, MAX_HISTORY_PRELOAD_DEPTH);
+  } else {
+    state.older_preload_depth = MIN_HISTORY_PRELOAD_DEPTH;
+  }
+  state.last_get_history_time = now;
+  state.older_preload_from_message_id = min_message_id;
+  state.older_preloaded_count = -1;
+
+  do_preload_older_messages(d);
+}
+
+void MessagesManager::do_preload_older_messages(const Dialog *d) {
+  auto &state = history_preload_states_[d->dialog_id];
+  if (state.is_preloading_older) {
+    // will be rechecked in on_preload_older_messages
+    return;
+  }
+
+  auto min_message_id = state.older_preload_from_message_id;
   MessagesConstIterator p(d, min_message_id);
-  int32 limit = MAX_GET_HISTORY * 3 / 10 + 1;
-  while (*p != nullptr && limit-- > 0) {
+  int32 count = 0;
+  while (*p != nullptr && count <= state.older_preload_depth) {
     min_message_id = (*p)->message_id;
     --p;
+    count++;
   }
-  if (limit > 0) {
-    // need to preload some old messages
-    LOG(INFO) << "Preloading older before " << min_message_id;
-    load_messages_impl(d, min_message_id, 0, MAX_GET_HISTORY / 2, 3, false, Promise<Unit>());
+  if (count > state.older_preload_depth) {
+    // enough messages have already been loaded
+    return;
+  }
+  if (count <= state.older_preloaded_count) {
+    // the previous preloading hasn't loaded any new messages
+    return;
   }
+
+  state.older_preloaded_count = count;
+  state.is_preloading_older = true;
+  auto limit = clamp(state.older_preload_depth + 1 - count, MAX_GET_HISTORY / 2, MAX_GET_HISTORY);
+  LOG(INFO) << "Preloading " << limit << " older messages before " << min_message_id << " in " << d->dialog_id;
+  load_messages_impl(d, min_message_id, 0, limit, 3, false,
+                     PromiseCreator::lambda([actor_id = actor_id(this), dialog_id = d->dialog_id](Result<Unit>) {
+                       send_closure(actor_id, &MessagesManager::on_preload_older_messages, dialog_id);
+                     }));
+}
+
+void MessagesManager::on_preload_older_messages(DialogId dialog_id) {
+  auto &state = history_preload_states_[dialog_id];
+  CHECK(state.is_preloading_older);
+  state.is_preloading_older = false;
+  if (G()->close_flag()) {
+    return;
+  }
+
+  // continue preloading if the preload depth isn't reached yet
+  do_preload_older_messages(get_dialog(dialog_id));
 }
 
 unique_ptr<MessagesManager::Message> MessagesManager::parse_message(Dialog *d, MessageId expected_message_id,
@@ -24876,12 +25110,28 @@ void MessagesManager::on_get_history_from_database(DialogId dialog_id, MessageId
   auto debug_last_new_message_id = d->last_new_message_id;
   auto first_received_message_id = MessageId::max();
   MessageId last_received_message_id;
+
+  // parse all messages beforehand to load their files from the database in batches instead of one by one
+  vector<unique_ptr<Message>> parsed_messages;
+  vector<FileId> file_ids;
+  if (d->first_database_message_id.is_valid() || d->have_full_history) {
+    for (auto &message_slice : messages) {
+      auto message = parse_message(d, message_slice.message_id, message_slice.data, false);
+      if (message == nullptr) {
+        break;
+      }
+      append(file_ids, get_message_file_ids(message.get()));
+      parsed_messages.push_back(std::move(message));
+    }
+    td_->file_manager_->preload_from_database(file_ids);
+  }
+
   size_t pos = 0;
-  for (auto &message_slice : messages) {
+  for (size_t i = 0; i < messages.size(); i++) {
     if (!d->first_database_message_id.is_valid() && !d->have_full_history) {
       break;
     }
-    auto message = parse_message(d, message_slice.message_id, message_slice.data, false);
+    auto message = i < parsed_messages.size() ? std::move(parsed_messages[i]) : nullptr;
     if (message == nullptr) {
       if (d->have_full_history) {
         d->have_full_history = false;
@@ -25390,7 +25640,7 @@ Result<td_api::object_ptr<td_api::availableReactions>> MessagesManager::get_mess
   }
 
   auto available_reactions = get_message_available_reactions(d, m, false);
-  bool is_premium = td_->option_manager_->get_option_boolean("is_premium");
+  bool is_premium = td_->option_manager_->get_option_boolean(OptionId::IsPremium);
   bool show_premium = is_premium;
 
   auto recent_reactions = get_recent_reactions(td_);
@@ -25524,7 +25774,7 @@ ChatReactions MessagesManager::get_message_available_reactions(const Dialog *d,
       }
     }
   }
-  if (dissalow_custom_for_non_premium && !td_->option_manager_->get_option_boolean("is_premium")) {
+  if (dissalow_custom_for_non_premium && !td_->option_manager_->get_option_boolean(OptionId::IsPremium)) {
     active_reactions.allow_custom_ = false;
   }
   return active_reactions;
@@ -25738,11 +25988,12 @@ tl_object_ptr<td_api::MessageSendingState> MessagesManager::get_message_sending_
   }
   if (m->is_failed_to_send) {
     auto can_retry = can_resend_message(m);
+    const auto &send_error = get_message_send_error(m);
     auto need_another_sender =
-        can_retry && m->send_error_code == 400 && m->send_error_message == CSlice("SEND_AS_PEER_INVALID");
-    return td_api::make_object<td_api::messageSendingStateFailed>(m->send_error_code, m->send_error_message, can_retry,
+        can_retry && send_error.code == 400 && send_error.message == CSlice("SEND_AS_PEER_INVALID");
+    return td_api::make_object<td_api::messageSendingStateFailed>(send_error.code, send_error.message, can_retry,
                                                                   need_another_sender,
-                                                                  max(m->try_resend_at - Time::now(), 0.0));
+                                                                  max(send_error.try_resend_at - Time::now(), 0.0));
   }
   return nullptr;
 }
@@ -25969,7 +26220,7 @@ int64 MessagesManager::generate_new_random_id(const Dialog *d) {
 
 unique_ptr<MessagesManager::Message> MessagesManager::create_message_to_send(
     Dialog *d, MessageId top_thread_message_id, MessageId reply_to_message_id, const MessageSendOptions &options,
-    unique_ptr<MessageContent> &&content, bool suppress_reply_info, unique_ptr<MessageForwardInfo> forward_info,
+    SharedMessageContent &&content, bool suppress_reply_info, unique_ptr<MessageForwardInfo> forward_info,
     bool is_copy, DialogId send_as_dialog_id) const {
   CHECK(d != nullptr);
   CHECK(content != nullptr);
@@ -26098,7 +26349,7 @@ unique_ptr<MessagesManager::Message> MessagesManager::create_message_to_send(
 
 MessagesManager::Message *MessagesManager::get_message_to_send(
     Dialog *d, MessageId top_thread_message_id, MessageId reply_to_message_id, const MessageSendOptions &options,
-    unique_ptr<MessageContent> &&content, bool *need_update_dialog_pos, bool suppress_reply_info,
+    SharedMessageContent &&content, bool *need_update_dialog_pos, bool suppress_reply_info,
     unique_ptr<MessageForwardInfo> forward_info, bool is_copy, DialogId send_as_dialog_id) {
   d->was_opened = true;
 
@@ -26272,6 +26523,8 @@ void MessagesManager::cancel_send_message_query(DialogId dialog_id, Message *m)
   CHECK(m->message_id.is_yet_unsent());
   LOG(INFO) << "Cancel send message query for " << m->message_id;
 
+  on_bulk_send_message_finished(FullMessageId(dialog_id, m->message_id), Status::Error(400, "Message was deleted"));
+
   cancel_upload_message_content_files(m->content.get());
 
   CHECK(m->edited_content == nullptr);
@@ -26449,7 +26702,7 @@ void MessagesManager::get_dialog_send_message_as_dialog_ids(
       };
       std::multimap<int64, Sender> sorted_senders;
 
-      bool is_premium = td_->option_manager_->get_option_boolean("is_premium");
+      bool is_premium = td_->option_manager_->get_option_boolean(OptionId::IsPremium);
       auto linked_channel_id = td_->contacts_manager_->get_channel_linked_channel_id(dialog_id.get_channel_id());
       for (auto channel_id : created_public_broadcasts_) {
         int64 score = td_->contacts_manager_->get_channel_participant_count(channel_id);
@@ -26686,7 +26939,7 @@ Result<InputMessageContent> MessagesManager::process_input_message_content(
                                UserId(), copied_message->send_emoji);
   }
 
-  bool is_premium = td_->option_manager_->get_option_boolean("is_premium");
+  bool is_premium = td_->option_manager_->get_option_boolean(OptionId::IsPremium);
   TRY_RESULT(content, get_input_message_content(dialog_id, std::move(input_message_content), td_, is_premium));
 
   if (content.ttl < 0 || content.ttl > MAX_PRIVATE_MESSAGE_TTL) {
@@ -26733,16 +26986,26 @@ Result<MessagesManager::MessageSendOptions> MessagesManager::process_message_sen
     result.sending_id = options->sending_id_;
   }
 
+  if (dialog_id != DialogId()) {
+    TRY_STATUS(can_use_message_send_options(dialog_id, result));
+  }
+  if (result.schedule_date != 0 && td_->auth_manager_->is_bot()) {
+    return Status::Error(400, "Bots can't send scheduled messages");
+  }
+
+  if (result.protect_content && !td_->auth_manager_->is_bot()) {
+    result.protect_content = false;
+  }
+
+  return result;
+}
+
+Status MessagesManager::can_use_message_send_options(DialogId dialog_id, const MessageSendOptions &options) const {
   auto dialog_type = dialog_id.get_type();
-  if (result.schedule_date != 0) {
-    if (dialog_type == DialogType::SecretChat) {
-      return Status::Error(400, "Can't schedule messages in secret chats");
-    }
-    if (td_->auth_manager_->is_bot()) {
-      return Status::Error(400, "Bots can't send scheduled messages");
-    }
+  if (options.schedule_date != 0 && dialog_type == DialogType::SecretChat) {
+    return Status::Error(400, "Can't schedule messages in secret chats");
   }
-  if (result.schedule_date == SCHEDULE_WHEN_ONLINE_DATE) {
+  if (options.schedule_date == SCHEDULE_WHEN_ONLINE_DATE) {
     if (dialog_type != DialogType::User) {
       return Status::Error(400, "Messages can be scheduled till online only in private chats");
     }
@@ -26750,16 +27013,11 @@ Result<MessagesManager::MessageSendOptions> MessagesManager::process_message_sen
       return Status::Error(400, "Can't scheduled till online messages in chat with self");
     }
   }
-
-  if (result.protect_content && !td_->auth_manager_->is_bot()) {
-    result.protect_content = false;
-  }
-
-  return result;
+  return Status::OK();
 }
 
 Status MessagesManager::can_use_message_send_options(const MessageSendOptions &options,
-                                                     const unique_ptr<MessageContent> &content, int32 ttl) {
+                                                     const MessageContent *content, int32 ttl) {
   if (options.schedule_date != 0) {
     if (ttl > 0) {
       return Status::Error(400, "Can't send scheduled self-destructing messages");
@@ -26774,7 +27032,7 @@ Status MessagesManager::can_use_message_send_options(const MessageSendOptions &o
 
 Status MessagesManager::can_use_message_send_options(const MessageSendOptions &options,
                                                      const InputMessageContent &content) {
-  return can_use_message_send_options(options, content.content, content.ttl);
+  return can_use_message_send_options(options, content.content.get(), content.ttl);
 }
 
 Status MessagesManager::can_use_top_thread_message_id(Dialog *d, MessageId top_thread_message_id,
@@ -26912,6 +27170,196 @@ Result<td_api::object_ptr<td_api::messages>> MessagesManager::send_message_group
   return get_messages_object(-1, std::move(result), false);
 }
 
+int64 MessagesManager::generate_new_bulk_send_id() const {
+  int64 bulk_send_id = 0;
+  do {
+    bulk_send_id = Random::secure_int64();
+  } while (bulk_send_id == 0 || bulk_sends_.count(bulk_send_id) != 0);
+  return bulk_send_id;
+}
+
+Result<td_api::object_ptr<td_api::bulkMessageSend>> MessagesManager::send_message_to_dialogs(
+    vector<DialogId> dialog_ids, tl_object_ptr<td_api::messageSendOptions> &&options,
+    tl_object_ptr<td_api::InputMessageContent> &&input_message_content) {
+  if (dialog_ids.empty()) {
+    return Status::Error(400, "There are no chats to send the message to");
+  }
+  if (dialog_ids.size() > MAX_BULK_SEND_DIALOGS) {
+    return Status::Error(400, "Too many chats to send the message to");
+  }
+
+  // the content is processed only once and is checked for each chat separately
+  TRY_RESULT(message_content, process_input_message_content(DialogId(), std::move(input_message_content)));
+  TRY_RESULT(message_send_options, process_message_send_options(DialogId(), std::move(options), true));
+  TRY_STATUS(can_use_message_send_options(message_send_options, message_content));
+
+  LOG(INFO) << "Begin to send message to " << dialog_ids;
+
+  auto bulk_send_id = generate_new_bulk_send_id();
+  auto bulk_send = make_unique<BulkSend>();
+  vector<td_api::object_ptr<td_api::message>> result;
+  for (auto dialog_id : dialog_ids) {
+    Dialog *d = get_dialog_force(dialog_id, "send_message_to_dialogs");
+    if (d == nullptr || dialog_id.get_type() == DialogType::SecretChat || can_send_message(dialog_id).is_error() ||
+        can_send_message_content(dialog_id, message_content.content.get(), false, td_).is_error() ||
+        can_use_message_send_options(dialog_id, message_send_options).is_error() ||
+        (message_content.ttl > 0 && dialog_id.get_type() != DialogType::User)) {
+      LOG(INFO) << "Can't send the message to " << dialog_id;
+      result.push_back(nullptr);
+      continue;
+    }
+
+    bool need_update_dialog_pos = false;
+    Message *m = get_message_to_send(d, MessageId(), MessageId(), message_send_options,
+                                     dup_message_content(td_, dialog_id, message_content.content.get(),
+                                                         MessageContentDupType::Send, MessageCopyOptions()),
+                                     &need_update_dialog_pos);
+    m->disable_web_page_preview = message_content.disable_web_page_preview;
+    if (message_content.ttl > 0) {
+      m->ttl = message_content.ttl;
+      m->is_content_secret = is_secret_message_content(m->ttl, m->content->get_type());
+    }
+    m->send_emoji = message_content.emoji;
+
+    // the message will be sent from on_bulk_send_timeout
+    save_send_message_log_event(dialog_id, m);
+
+    send_update_new_message(d, m);
+    if (need_update_dialog_pos) {
+      send_update_chat_last_message(d, "send_message_to_dialogs");
+    }
+
+    result.push_back(get_message_object(dialog_id, m, "send_message_to_dialogs"));
+
+    FullMessageId full_message_id{dialog_id, m->message_id};
+    bulk_send->message_ids.push_back(full_message_id);
+    bulk_send_message_ids_.emplace(full_message_id, bulk_send_id);
+  }
+
+  if (bulk_send->message_ids.empty()) {
+    return td_api::make_object<td_api::bulkMessageSend>(0, std::move(result));
+  }
+
+  // a new file must be uploaded only once, so other messages wait until the first message is sent
+  auto file_id = get_message_content_any_file_id(message_content.content.get());
+  bulk_send->is_waiting_for_media_upload =
+      file_id.is_valid() && !td_->file_manager_->get_file_view(file_id).has_remote_location();
+
+  if (bulk_send_rate_ == 0.0) {
+    bulk_send_rate_ = td_->auth_manager_->is_bot() ? BOT_BULK_SEND_RATE : USER_BULK_SEND_RATE;
+  }
+  bulk_sends_.emplace(bulk_send_id, std::move(bulk_send));
+  on_bulk_send_timeout(bulk_send_id);
+
+  return td_api::make_object<td_api::bulkMessageSend>(bulk_send_id, std::move(result));
+}
+
+void MessagesManager::on_bulk_send_timeout(int64 bulk_send_id) {
+  if (G()->close_flag()) {
+    return;
+  }
+
+  auto now = Time::now();
+  if (now < bulk_send_resume_time_) {
+    bulk_send_timeout_.set_timeout_in(bulk_send_id, bulk_send_resume_time_ - now);
+    return;
+  }
+
+  auto max_tokens = bulk_send_rate_ > 1.0 ? bulk_send_rate_ : 1.0;
+  bulk_send_tokens_ += (now - bulk_send_tokens_update_time_) * bulk_send_rate_;
+  if (bulk_send_tokens_ > max_tokens) {
+    bulk_send_tokens_ = max_tokens;
+  }
+  bulk_send_tokens_update_time_ = now;
+
+  while (true) {
+    // do_send_message can finish the bulk send
+    auto it = bulk_sends_.find(bulk_send_id);
+    if (it == bulk_sends_.end()) {
+      return;
+    }
+    auto &bulk_send = *it->second;
+    if (bulk_send.next_message_pos == bulk_send.message_ids.size()) {
+      return;
+    }
+    if (bulk_send.is_waiting_for_media_upload && bulk_send.next_message_pos > 0) {
+      // will be resumed from on_bulk_send_message_finished
+      return;
+    }
+    if (bulk_send_tokens_ < 1.0) {
+      bulk_send_timeout_.set_timeout_in(bulk_send_id, (1.0 - bulk_send_tokens_) / bulk_send_rate_);
+      return;
+    }
+
+    auto full_message_id = bulk_send.message_ids[bulk_send.next_message_pos++];
+    const Message *m = get_message(full_message_id);
+    if (m == nullptr) {
+      // the message has already been deleted and counted as failed in cancel_send_message_query
+      continue;
+    }
+    bulk_send_tokens_ -= 1.0;
+    do_send_message(full_message_id.get_dialog_id(), m);
+  }
+}
+
+void MessagesManager::on_bulk_send_message_finished(FullMessageId full_message_id, const Status &error) {
+  auto message_it = bulk_send_message_ids_.find(full_message_id);
+  if (message_it == bulk_send_message_ids_.end()) {
+    return;
+  }
+  auto bulk_send_id = message_it->second;
+  bulk_send_message_ids_.erase(message_it);
+
+  auto it = bulk_sends_.find(bulk_send_id);
+  CHECK(it != bulk_sends_.end());
+  auto &bulk_send = *it->second;
+  if (error.is_ok()) {
+    bulk_send.sent_count++;
+  } else {
+    LOG(INFO) << "Failed to send " << full_message_id << " from bulk send " << bulk_send_id << ": " << error;
+    bulk_send.failed_count++;
+  }
+  update_bulk_send_rate(error);
+
+  auto total_count = narrow_cast<int32>(bulk_send.message_ids.size());
+  send_closure(G()->td(), &Td::send_update,
+               td_api::make_object<td_api::updateBulkMessageSendProgress>(bulk_send_id, bulk_send.sent_count,
+                                                                         bulk_send.failed_count, total_count));
+
+  if (bulk_send.sent_count + bulk_send.failed_count == total_count) {
+    bulk_send_timeout_.cancel_timeout(bulk_send_id);
+    bulk_sends_.erase(it);
+    return;
+  }
+  if (bulk_send.is_waiting_for_media_upload) {
+    // the file has been uploaded with the first message, if it was sent successfully
+    bulk_send.is_waiting_for_media_upload = false;
+    bulk_send_timeout_.set_timeout_in(bulk_send_id, 0.0);
+  }
+}
+
+void MessagesManager::update_bulk_send_rate(const Status &error) {
+  // additive increase, multiplicative decrease
+  if (error.is_ok()) {
+    auto max_rate = td_->auth_manager_->is_bot() ? BOT_BULK_SEND_RATE : USER_BULK_SEND_RATE;
+    bulk_send_rate_ += BULK_SEND_RATE_INCREMENT;
+    if (bulk_send_rate_ > max_rate) {
+      bulk_send_rate_ = max_rate;
+    }
+  } else if (error.code() == 429) {
+    bulk_send_rate_ *= 0.5;
+    if (bulk_send_rate_ < MIN_BULK_SEND_RATE) {
+      bulk_send_rate_ = MIN_BULK_SEND_RATE;
+    }
+    bulk_send_tokens_ = 0.0;
+    auto resume_time = Time::now() + Global::get_retry_after(error.code(), error.message());
+    if (resume_time > bulk_send_resume_time_) {
+      bulk_send_resume_time_ = resume_time;
+    }
+    LOG(INFO) << "Decrease bulk send rate to " << bulk_send_rate_ << " messages per second";
+  }
+}
+
 void MessagesManager::save_send_message_log_event(DialogId dialog_id, const Message *m) {
   if (!G()->parameters().use_message_db) {
     return;
@@ -27752,7 +28200,7 @@ Result<MessageId> MessagesManager::send_inline_query_result_message(DialogId dia
   }
 
   reply_to_message_id = get_reply_to_message_id(d, top_thread_message_id, reply_to_message_id, false);
-  TRY_STATUS(can_use_message_send_options(message_send_options, content->message_content, 0));
+  TRY_STATUS(can_use_message_send_options(message_send_options, content->message_content.get(), 0));
   TRY_STATUS(can_send_message_content(dialog_id, content->message_content.get(), false, td_));
   TRY_STATUS(can_use_top_thread_message_id(d, top_thread_message_id, reply_to_message_id));
 
@@ -27866,7 +28314,7 @@ bool MessagesManager::has_qts_messages(DialogId dialog_id) const {
   switch (dialog_id.get_type()) {
     case DialogType::User:
     case DialogType::Chat:
-      return td_->option_manager_->get_option_integer("session_count") > 1;
+      return td_->option_manager_->get_option_integer(OptionId::SessionCount) > 1;
     case DialogType::Channel:
     case DialogType::SecretChat:
       return false;
@@ -28053,9 +28501,15 @@ bool MessagesManager::can_edit_message(DialogId dialog_id, const Message *m, boo
   return false;
 }
 
+const MessagesManager::MessageSendError &MessagesManager::get_message_send_error(const Message *m) {
+  static const MessageSendError empty_send_error;
+  return m->send_error == nullptr ? empty_send_error : *m->send_error;
+}
+
 bool MessagesManager::can_resend_message(const Message *m) const {
-  if (m->send_error_code != 429 && m->send_error_message != "Message is too old to be re-sent automatically" &&
-      m->send_error_message != "SCHEDULE_TOO_MUCH" && m->send_error_message != "SEND_AS_PEER_INVALID") {
+  const auto &send_error = get_message_send_error(m);
+  if (send_error.code != 429 && send_error.message != "Message is too old to be re-sent automatically" &&
+      send_error.message != "SCHEDULE_TOO_MUCH" && send_error.message != "SEND_AS_PEER_INVALID") {
     return false;
   }
   if (m->is_bot_start_message) {
@@ -28321,13 +28775,14 @@ void MessagesManager::on_message_media_edited(DialogId dialog_id, MessageId mess
     auto pts = result.ok();
     LOG(INFO) << "Successfully edited " << message_id << " in " << dialog_id << " with PTS = " << pts
               << " and last edit PTS = " << m->last_edit_pts;
-    std::swap(m->content, m->edited_content);
-    bool need_send_update_message_content = m->edited_content->get_type() == MessageContentType::Photo &&
+    SharedMessageContent new_content = std::move(m->content);
+    m->content = std::move(m->edited_content);
+    bool need_send_update_message_content = new_content->get_type() == MessageContentType::Photo &&
                                             m->content->get_type() == MessageContentType::Photo;
     bool need_merge_files = pts != 0 && pts == m->last_edit_pts;
     bool is_content_changed = false;
     bool need_update =
-        update_message_content(dialog_id, m, std::move(m->edited_content), need_merge_files, true, is_content_changed);
+        update_message_content(dialog_id, m, std::move(new_content), need_merge_files, true, is_content_changed);
     if (need_send_update_message_content) {
       if (need_update) {
         send_update_message_content(d, m, true, "on_message_media_edited");
@@ -29609,8 +30064,8 @@ Result<MessagesManager::ForwardedMessages> MessagesManager::get_forwarded_messag
                           : MessageContentDupType::Forward;
     auto reply_to_message_id = copy_options[i].reply_to_message_id;
     auto reply_markup = std::move(copy_options[i].reply_markup);
-    unique_ptr<MessageContent> content =
-        dup_message_content(td_, to_dialog_id, forwarded_message->content.get(), type, std::move(copy_options[i]));
+    SharedMessageContent content =
+        dup_shared_message_content(td_, to_dialog_id, forwarded_message->content, type, std::move(copy_options[i]));
     if (content == nullptr) {
       LOG(INFO) << "Can't forward content of " << message_id;
       continue;
@@ -29624,7 +30079,7 @@ Result<MessagesManager::ForwardedMessages> MessagesManager::get_forwarded_messag
       continue;
     }
 
-    auto can_use_options_status = can_use_message_send_options(message_send_options, content, 0);
+    auto can_use_options_status = can_use_message_send_options(message_send_options, content.get(), 0);
     if (can_use_options_status.is_error()) {
       LOG(INFO) << "Can't forward " << message_id << ": " << can_send_status.message();
       continue;
@@ -29864,7 +30319,7 @@ Result<vector<MessageId>> MessagesManager::resend_messages(DialogId dialog_id, v
     if (!can_resend_message(m)) {
       return Status::Error(400, "Message can't be re-sent");
     }
-    if (m->try_resend_at > Time::now()) {
+    if (get_message_send_error(m).try_resend_at > Time::now()) {
       return Status::Error(400, "Message can't be re-sent yet");
     }
     if (last_message_id != MessageId()) {
@@ -29926,8 +30381,8 @@ Result<vector<MessageId>> MessagesManager::resend_messages(DialogId dialog_id, v
     CHECK(message != nullptr);
     send_update_delete_messages(dialog_id, {message->message_id.get()}, true);
 
-    auto need_another_sender =
-        message->send_error_code == 400 && message->send_error_message == CSlice("SEND_AS_PEER_INVALID");
+    const auto &send_error = get_message_send_error(message.get());
+    auto need_another_sender = send_error.code == 400 && send_error.message == CSlice("SEND_AS_PEER_INVALID");
     MessageSendOptions options(message->disable_notification, message->from_background,
                                message->update_stickersets_order, message->noforwards,
                                get_message_schedule_date(message.get()), message->sending_id);
@@ -32414,6 +32869,8 @@ FullMessageId MessagesManager::on_send_message_success(int64 random_id, MessageI
 
   being_sent_messages_.erase(it);
 
+  on_bulk_send_message_finished(FullMessageId(dialog_id, old_message_id), Status::OK());
+
   // must be called before delete_message
   update_reply_to_message_id(dialog_id, old_message_id, new_message_id, true, "on_send_message_success");
 
@@ -32447,7 +32904,7 @@ FullMessageId MessagesManager::on_send_message_success(int64 random_id, MessageI
 
   sent_message->ttl_period = ttl_period;
 
-  if (merge_message_content_file_id(td_, sent_message->content.get(), new_file_id)) {
+  if (merge_message_content_file_id(td_, sent_message->content.get_mutable(), new_file_id)) {
     send_update_message_content(d, sent_message.get(), false, source);
   }
 
@@ -32872,6 +33329,8 @@ MessageId MessagesManager::get_next_yet_unsent_scheduled_message_id(Dialog *d, i
 }
 
 void MessagesManager::fail_send_message(FullMessageId full_message_id, int error_code, const string &error_message) {
+  on_bulk_send_message_finished(full_message_id, Status::Error(error_code, error_message));
+
   auto dialog_id = full_message_id.get_dialog_id();
   Dialog *d = get_dialog(dialog_id);
   CHECK(d != nullptr);
@@ -32922,14 +33381,14 @@ void MessagesManager::fail_send_message(FullMessageId full_message_id, int error
     message->view_count = 0;
   }
   message->is_failed_to_send = true;
-  message->send_error_code = error_code;
-  message->send_error_message = error_message;
-  message->try_resend_at = 0.0;
+  message->send_error = make_unique<MessageSendError>();
+  message->send_error->code = error_code;
+  message->send_error->message = error_message;
   auto retry_after = Global::get_retry_after(error_code, error_message);
   if (retry_after > 0) {
-    message->try_resend_at = Time::now() + retry_after;
+    message->send_error->try_resend_at = Time::now() + retry_after;
   }
-  update_failed_to_send_message_content(td_, message->content);
+  update_failed_to_send_message_content(td_, message->content.get());
 
   message->from_database = false;
   message->have_previous = true;
@@ -33207,7 +33666,7 @@ void MessagesManager::set_dialog_is_translatable(Dialog *d, bool is_translatable
 
   LOG(INFO) << "Set " << d->dialog_id << " is translatable to " << is_translatable;
   LOG_CHECK(d->is_update_new_chat_sent) << "Wrong " << d->dialog_id << " in set_dialog_is_translatable";
-  bool is_premium = td_->option_manager_->get_option_boolean("is_premium");
+  bool is_premium = td_->option_manager_->get_option_boolean(OptionId::IsPremium);
   if (is_premium) {
     send_closure(G()->td(), &Td::send_update,
                  make_tl_object<td_api::updateChatIsTranslatable>(d->dialog_id.get(), is_translatable));
@@ -35460,6 +35919,33 @@ MessagesManager::Message *MessagesManager::get_message_force(Dialog *d, MessageI
   return on_get_message_from_database(d, r_value.ok(), message_id.is_scheduled(), source);
 }
 
+void MessagesManager::preload_messages_from_database(Dialog *d, const vector<MessageId> &message_ids,
+                                                     const char *source) {
+  CHECK(d != nullptr);
+  if (!G()->parameters().use_message_db) {
+    return;
+  }
+
+  vector<FullMessageId> full_message_ids;
+  for (auto message_id : message_ids) {
+    if (!message_id.is_valid() || message_id.is_yet_unsent() || get_message(d, message_id) != nullptr ||
+        is_deleted_message(d, message_id)) {
+      continue;
+    }
+    full_message_ids.emplace_back(d->dialog_id, message_id);
+  }
+  if (full_message_ids.size() <= 1) {
+    // get_message_force will load the message
+    return;
+  }
+
+  LOG(INFO) << "Trying to load " << full_message_ids << " from database from " << source;
+  auto messages = G()->td_db()->get_message_db_sync()->get_messages_by_ids(std::move(full_message_ids));
+  for (auto &message : messages) {
+    on_get_message_from_database(d, message.message_id, message.data, false, source);
+  }
+}
+
 MessagesManager::Message *MessagesManager::on_get_message_from_database(const MessageDbMessage &message,
                                                                         bool is_scheduled, const char *source) {
   if (message.data.empty()) {
@@ -36001,7 +36487,7 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
   }
 
   if (message->from_database && !message->are_media_timestamp_entities_found) {
-    auto text = get_message_content_text_mutable(message->content.get());
+    auto text = get_message_content_text_mutable(message->content.get_mutable());
     if (text != nullptr) {
       fix_formatted_text(text->text, text->entities, true, true, true, false, false).ensure();
       // always call to save are_media_timestamp_entities_found flag
@@ -36020,7 +36506,7 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     auto channel_read_media_period =
         td_->option_manager_->get_option_integer("channels_read_media_period", (G()->is_test_dc() ? 300 : 7 * 86400));
     if (message->date < G()->unix_time_cached() - channel_read_media_period) {
-      update_opened_message_content(message->content.get());
+      update_opened_message_content(message->content.get_mutable());
     }
   }
 
@@ -36352,6 +36838,13 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
   CHECK(result_message != nullptr);
   CHECK(result_message == m);
   CHECK(d->messages != nullptr);
+  loaded_message_count_++;
+  if (m->from_database) {
+    reloaded_message_count_++;
+  }
+  if (message_unload_threshold_ > 0 && loaded_message_count_ > message_unload_threshold_) {
+    on_loaded_message_count_exceeded();
+  }
 
   if (!is_attached) {
     if (m->have_next) {
@@ -36902,6 +37395,12 @@ void MessagesManager::delete_message_from_database(Dialog *d, MessageId message_
     return;
   }
 
+  if (!need_delete_files && d->dialog_id == being_range_deleted_full_message_id_.get_dialog_id() &&
+      !message_id.is_scheduled() && message_id <= being_range_deleted_full_message_id_.get_message_id()) {
+    // the message will be deleted from the database together with all previous messages
+    return;
+  }
+
   DeleteMessageLogEvent log_event;
 
   log_event.full_message_id_ = {d->dialog_id, message_id};
@@ -37514,12 +38013,12 @@ bool MessagesManager::need_message_changed_warning(const Message *old_message) {
 }
 
 bool MessagesManager::update_message_content(DialogId dialog_id, Message *old_message,
-                                             unique_ptr<MessageContent> new_content, bool need_merge_files,
+                                             SharedMessageContent new_content, bool need_merge_files,
                                              bool is_message_in_dialog, bool &is_content_changed) {
   is_content_changed = false;
   bool need_update = false;
 
-  unique_ptr<MessageContent> &old_content = old_message->content;
+  SharedMessageContent &old_content = old_message->content;
   MessageContentType old_content_type = old_content->get_type();
   MessageContentType new_content_type = new_content->get_type();
 
@@ -37562,7 +38061,7 @@ bool MessagesManager::update_message_content(DialogId dialog_id, Message *old_me
       }
     }
   } else {
-    merge_message_contents(td_, old_content.get(), new_content.get(), need_message_changed_warning(old_message),
+    merge_message_contents(td_, old_content.get(), new_content.get_mutable(), need_message_changed_warning(old_message),
                            dialog_id, need_merge_files, is_content_changed, need_update);
   }
   if (need_finish_upload) {
@@ -37578,9 +38077,9 @@ bool MessagesManager::update_message_content(DialogId dialog_id, Message *old_me
     }
     old_content = std::move(new_content);
     old_message->last_edit_pts = 0;
-    update_message_content_file_id_remote(old_content.get(), old_file_id);
+    update_message_content_file_id_remote(old_content, old_file_id);
   } else {
-    update_message_content_file_id_remote(old_content.get(), get_message_content_any_file_id(new_content.get()));
+    update_message_content_file_id_remote(old_content, get_message_content_any_file_id(new_content.get()));
   }
   if (is_content_changed && !need_update) {
     LOG(INFO) << "Content of " << old_message->message_id << " in " << dialog_id << " has changed";
@@ -38399,7 +38898,11 @@ bool MessagesManager::add_dialog_last_database_message(Dialog *d, unique_ptr<Mes
 
 void MessagesManager::update_dialogs_hints(const Dialog *d) {
   if (!td_->auth_manager_->is_bot() && d->order != DEFAULT_ORDER) {
-    dialogs_hints_.add(-d->dialog_id.get(), td_->contacts_manager_->get_dialog_search_text(d->dialog_id));
+    auto search_text = td_->contacts_manager_->get_dialog_search_text(d->dialog_id);
+    if (G()->parameters().use_message_db) {
+      G()->td_db()->get_dialog_db_async()->set_dialog_search_text(d->dialog_id, search_text, Promise<Unit>());
+    }
+    dialogs_hints_.add(-d->dialog_id.get(), search_text);
   }
 }
 
@@ -39217,27 +39720,21 @@ bool MessagesManager::need_dialog_in_filter(const Dialog *d, const DialogFilter
   CHECK(filter != nullptr);
   CHECK(d->order != DEFAULT_ORDER);
 
-  if (InputDialogId::contains(filter->pinned_dialog_ids, d->dialog_id)) {
-    return true;
-  }
-  if (InputDialogId::contains(filter->included_dialog_ids, d->dialog_id)) {
-    return true;
-  }
-  if (InputDialogId::contains(filter->excluded_dialog_ids, d->dialog_id)) {
-    return false;
-  }
-  if (d->dialog_id.get_type() == DialogType::SecretChat) {
-    auto user_id = td_->contacts_manager_->get_secret_chat_user_id(d->dialog_id.get_secret_chat_id());
-    if (user_id.is_valid()) {
-      auto dialog_id = DialogId(user_id);
-      if (InputDialogId::contains(filter->pinned_dialog_ids, dialog_id)) {
-        return true;
-      }
-      if (InputDialogId::contains(filter->included_dialog_ids, dialog_id)) {
-        return true;
-      }
-      if (InputDialogId::contains(filter->excluded_dialog_ids, dialog_id)) {
-        return false;
+  auto dialog_ids_it = dialog_filter_dialog_ids_.find(filter->dialog_filter_id);
+  CHECK(dialog_ids_it != dialog_filter_dialog_ids_.end());
+  const auto &dialog_ids = dialog_ids_it->second;
+  if (!dialog_ids.empty()) {
+    auto it = dialog_ids.find(d->dialog_id);
+    if (it != dialog_ids.end()) {
+      return it->second;
+    }
+    if (d->dialog_id.get_type() == DialogType::SecretChat) {
+      auto user_id = td_->contacts_manager_->get_secret_chat_user_id(d->dialog_id.get_secret_chat_id());
+      if (user_id.is_valid()) {
+        it = dialog_ids.find(DialogId(user_id));
+        if (it != dialog_ids.end()) {
+          return it->second;
+        }
       }
     }
   }
@@ -39624,6 +40121,27 @@ void MessagesManager::do_get_channel_difference(DialogId dialog_id, int32 pts, b
     }
   }
 
+  if (running_channel_difference_query_count_ >= max_running_channel_difference_query_count_) {
+    auto priority = get_channel_difference_priority(dialog_id);
+    LOG(INFO) << "Delay channels.getDifference for " << dialog_id << " with priority " << priority << ", because "
+              << running_channel_difference_query_count_ << " queries are already being executed";
+    auto &pending_difference =
+        pending_channel_differences_[std::make_pair(priority, ++pending_channel_difference_count_)];
+    pending_difference.dialog_id = dialog_id;
+    pending_difference.pts = pts;
+    pending_difference.force = force;
+    pending_difference.is_old = is_old;
+    pending_difference.input_channel = std::move(input_channel);
+    pending_difference.source = source;
+    return;
+  }
+
+  send_get_channel_difference_query(dialog_id, pts, force, std::move(input_channel), is_old, source);
+}
+
+void MessagesManager::send_get_channel_difference_query(DialogId dialog_id, int32 pts, bool force,
+                                                        tl_object_ptr<telegram_api::InputChannel> &&input_channel,
+                                                        bool is_old, const char *source) {
   int32 limit = td_->auth_manager_->is_bot() && !is_old ? MAX_BOT_CHANNEL_DIFFERENCE : MAX_CHANNEL_DIFFERENCE;
   if (pts <= 0) {
     pts = 1;
@@ -39633,9 +40151,52 @@ void MessagesManager::do_get_channel_difference(DialogId dialog_id, int32 pts, b
   LOG(INFO) << "-----BEGIN GET CHANNEL DIFFERENCE----- for " << dialog_id << " with PTS " << pts << " and limit "
             << limit << " from " << source;
 
+  running_channel_difference_query_count_++;
   td_->create_handler<GetChannelDifferenceQuery>()->send(dialog_id, std::move(input_channel), pts, limit, force);
 }
 
+int32 MessagesManager::get_channel_difference_priority(DialogId dialog_id) const {
+  // the less, the sooner channel difference is requested
+  const Dialog *d = get_dialog(dialog_id);
+  if (d == nullptr) {
+    return 3;
+  }
+  if (d->open_count > 0) {
+    return 0;
+  }
+  if (is_dialog_muted(d)) {
+    return 3;
+  }
+  if (d->unread_mention_count > 0 || d->server_unread_count + d->local_unread_count > 0) {
+    return 1;
+  }
+  return 2;
+}
+
+void MessagesManager::on_get_channel_difference_query_finished(bool is_success) {
+  CHECK(running_channel_difference_query_count_ > 0);
+  running_channel_difference_query_count_--;
+
+  // additive increase and multiplicative decrease of the number of simultaneously executed queries
+  if (is_success) {
+    if (max_running_channel_difference_query_count_ < MAX_RUNNING_CHANNEL_DIFFERENCE_QUERIES) {
+      max_running_channel_difference_query_count_++;
+    }
+  } else {
+    max_running_channel_difference_query_count_ = max(max_running_channel_difference_query_count_ / 2, 1);
+  }
+
+  while (!pending_channel_differences_.empty() &&
+         running_channel_difference_query_count_ < max_running_channel_difference_query_count_) {
+    auto it = pending_channel_differences_.begin();
+    auto pending_difference = std::move(it->second);
+    pending_channel_differences_.erase(it);
+    send_get_channel_difference_query(pending_difference.dialog_id, pending_difference.pts, pending_difference.force,
+                                      std::move(pending_difference.input_channel), pending_difference.is_old,
+                                      pending_difference.source);
+  }
+}
+
 void MessagesManager::process_get_channel_difference_updates(
     DialogId dialog_id, int32 new_pts, vector<tl_object_ptr<telegram_api::Message>> &&new_messages,
     vector<tl_object_ptr<telegram_api::Update>> &&other_updates) {
@@ -39922,6 +40483,8 @@ void MessagesManager::on_get_channel_difference(
     DialogId dialog_id, int32 request_pts, int32 request_limit,
     tl_object_ptr<telegram_api::updates_ChannelDifference> &&difference_ptr) {
   LOG(INFO) << "----- END  GET CHANNEL DIFFERENCE----- for " << dialog_id;
+  on_get_channel_difference_query_finished(difference_ptr != nullptr);
+
   auto it = active_get_channel_differencies_.find(dialog_id);
   CHECK(it != active_get_channel_differencies_.end());
   string source = std::move(it->second);
@@ -40558,7 +41121,10 @@ void MessagesManager::on_binlog_events(vector<BinlogEvent> &&events) {
   if (G()->close_flag()) {
     return;
   }
+  auto replay_start_time = Time::now();
+  int64 replay_size = 0;
   for (auto &event : events) {
+    replay_size += event.size_;
     CHECK(event.id_ != 0);
     switch (event.type_) {
       case LogEvent::HandlerType::SendMessage: {
@@ -41335,6 +41901,8 @@ void MessagesManager::on_binlog_events(vector<BinlogEvent> &&events) {
         LOG(FATAL) << "Unsupported log event type " << event.type_;
     }
   }
+  td_->add_startup_phase("MessagesManager binlog replay", replay_start_time, static_cast<int64>(events.size()),
+                         replay_size);
 }
 
 Status MessagesManager::add_recently_found_dialog(DialogId dialog_id) {
@@ -41761,6 +42329,12 @@ void MessagesManager::get_current_state(vector<td_api::object_ptr<td_api::Update
   append(updates, std::move(last_message_updates));
 }
 
+void MessagesManager::get_memory_statistics(MemoryStatisticsEntries &entries) const {
+  add_memory_statistics_entry<Dialog>(entries, "MessagesManager", "chats", dialogs_.calc_size());
+  add_memory_statistics_entry<Message>(entries, "MessagesManager", "messages",
+                                       static_cast<size_t>(loaded_message_count_));
+}
+
 void MessagesManager::add_message_file_to_downloads(FullMessageId full_message_id, FileId file_id, int32 priority,
                                                     Promise<td_api::object_ptr<td_api::file>> promise) {
   auto m = get_message_force(full_message_id, "add_message_file_to_downloads");
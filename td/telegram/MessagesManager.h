@@ -29,6 +29,7 @@
 #include "td/telegram/InputDialogId.h"
 #include "td/telegram/InputGroupCallId.h"
 #include "td/telegram/logevent/LogEventHelper.h"
+#include "td/telegram/MemoryStatistics.h"
 #include "td/telegram/MessageContentType.h"
 #include "td/telegram/MessageCopyOptions.h"
 #include "td/telegram/MessageDb.h"
@@ -60,6 +61,7 @@
 #include "td/telegram/SecretChatId.h"
 #include "td/telegram/SecretInputMedia.h"
 #include "td/telegram/ServerMessageId.h"
+#include "td/telegram/SharedMessageContent.h"
 #include "td/telegram/td_api.h"
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/UserId.h"
@@ -76,6 +78,7 @@
 #include "td/utils/common.h"
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/FlatHashSet.h"
+#include "td/utils/FloodControlFast.h"
 #include "td/utils/HashTableUtils.h"
 #include "td/utils/Heap.h"
 #include "td/utils/Hints.h"
@@ -104,7 +107,6 @@ class DialogActionBar;
 class DialogFilter;
 class DraftMessage;
 struct InputMessageContent;
-class MessageContent;
 struct MessageReactions;
 class Td;
 
@@ -321,6 +323,8 @@ class MessagesManager final : public Actor {
 
   void on_update_dialog_filters();
 
+  void on_update_message_unload_threshold();
+
   void on_update_service_notification(tl_object_ptr<telegram_api::updateServiceNotification> &&update,
                                       bool skip_new_entities, Promise<Unit> &&promise);
 
@@ -446,6 +450,10 @@ class MessagesManager final : public Actor {
       vector<tl_object_ptr<td_api::InputMessageContent>> &&input_message_contents,
       bool only_preview) TD_WARN_UNUSED_RESULT;
 
+  Result<td_api::object_ptr<td_api::bulkMessageSend>> send_message_to_dialogs(
+      vector<DialogId> dialog_ids, tl_object_ptr<td_api::messageSendOptions> &&options,
+      tl_object_ptr<td_api::InputMessageContent> &&input_message_content) TD_WARN_UNUSED_RESULT;
+
   Result<MessageId> send_bot_start_message(UserId bot_user_id, DialogId dialog_id,
                                            const string &parameter) TD_WARN_UNUSED_RESULT;
 
@@ -1016,8 +1024,13 @@ class MessagesManager final : public Actor {
 
   bool can_set_game_score(FullMessageId full_message_id) const;
 
+  // unloads all messages, which can be unloaded, from memory; returns the number of unloaded messages
+  int64 unload_all_messages();
+
   void get_current_state(vector<td_api::object_ptr<td_api::Update>> &updates) const;
 
+  void get_memory_statistics(MemoryStatisticsEntries &entries) const;
+
   void add_message_file_to_downloads(FullMessageId full_message_id, FileId file_id, int32 priority,
                                      Promise<td_api::object_ptr<td_api::file>> promise);
 
@@ -1128,6 +1141,13 @@ class MessagesManager final : public Actor {
   };
 
   // Do not forget to update MessagesManager::update_message and all make_unique<Message> when this class is changed
+  // the reason why a message has failed to be sent; allocated only for such messages
+  struct MessageSendError {
+    int32 code = 0;
+    string message;
+    double try_resend_at = 0;
+  };
+
   struct Message {
     int32 random_y = 0;
 
@@ -1214,9 +1234,7 @@ class MessagesManager final : public Actor {
 
     int32 legacy_layer = 0;
 
-    int32 send_error_code = 0;
-    string send_error_message;
-    double try_resend_at = 0;
+    unique_ptr<MessageSendError> send_error;
 
     int32 ttl_period = 0;       // counted from message send date
     int32 ttl = 0;              // counted from message content view date
@@ -1224,18 +1242,17 @@ class MessagesManager final : public Actor {
 
     int64 media_album_id = 0;
 
-    unique_ptr<MessageContent> content;
+    SharedMessageContent content;
 
     unique_ptr<ReplyMarkup> reply_markup;
 
     int32 edited_schedule_date = 0;
+    int32 last_edit_pts = 0;
     unique_ptr<MessageContent> edited_content;
     unique_ptr<ReplyMarkup> edited_reply_markup;
     uint64 edit_generation = 0;
     Promise<Unit> edit_promise;
 
-    int32 last_edit_pts = 0;
-
     const char *debug_source = "null";
 
     unique_ptr<Message> left;
@@ -1612,11 +1629,17 @@ class MessagesManager final : public Actor {
   class MessagesIteratorBase {
     vector<const Message *> stack_;
 
+    // expected treap depth is about 3 * log2(n), so this is enough for dialogs with millions of loaded messages
+    static constexpr size_t RESERVED_STACK_SIZE = 64;
+
    protected:
     MessagesIteratorBase() = default;
 
     // points iterator to message with greatest identifier which is less or equal than message_id
     MessagesIteratorBase(const Message *root, MessageId message_id) {
+      if (root != nullptr) {
+        stack_.reserve(RESERVED_STACK_SIZE);
+      }
       size_t last_right_pos = 0;
       while (root != nullptr) {
         //        LOG(DEBUG) << "Have root->message_id = " << root->message_id;
@@ -1810,12 +1833,14 @@ class MessagesManager final : public Actor {
   class DialogFiltersLogEvent;
 
   static constexpr size_t MAX_GROUPED_MESSAGES = 10;               // server side limit
+  static constexpr size_t MAX_BULK_SEND_DIALOGS = 100;             // some reasonable limit
   static constexpr int32 MAX_GET_DIALOGS = 100;                    // server side limit
   static constexpr int32 MAX_GET_HISTORY = 100;                    // server side limit
   static constexpr int32 MAX_SEARCH_MESSAGES = 100;                // server side limit
   static constexpr int32 MIN_SEARCH_PUBLIC_DIALOG_PREFIX_LEN = 4;  // server side limit
   static constexpr int32 MIN_CHANNEL_DIFFERENCE = 1;
   static constexpr int32 MAX_CHANNEL_DIFFERENCE = 100;
+  static constexpr int32 MAX_RUNNING_CHANNEL_DIFFERENCE_QUERIES = 50;
   static constexpr int32 MAX_BOT_CHANNEL_DIFFERENCE = 100000;   // server side limit
   static constexpr int32 MAX_RECENT_DIALOGS = 50;               // some reasonable value
   static constexpr size_t MAX_TITLE_LENGTH = 128;               // server side limit for chat title
@@ -1825,6 +1850,7 @@ class MessagesManager final : public Actor {
   static constexpr int32 DIALOG_FILTERS_CACHE_TIME = 86400;
   static constexpr size_t MIN_DELETED_ASYNCHRONOUSLY_MESSAGES = 10;
   static constexpr size_t MAX_UNLOADED_MESSAGES = 5000;
+  static constexpr size_t MAX_DATABASE_SEARCHED_DIALOG_QUERIES = 1000;
 
   static constexpr int64 SPONSORED_DIALOG_ORDER = static_cast<int64>(2147483647) << 32;
   static constexpr int32 MIN_PINNED_DIALOG_DATE = 2147000000;  // some big date
@@ -1844,6 +1870,10 @@ class MessagesManager final : public Actor {
   static constexpr int32 MIN_READ_HISTORY_DELAY = 3;  // seconds
   static constexpr int32 MAX_SAVE_DIALOG_DELAY = 0;   // seconds
 
+  static constexpr int32 MIN_HISTORY_PRELOAD_DEPTH = MAX_GET_HISTORY * 3 / 10;
+  static constexpr int32 MAX_HISTORY_PRELOAD_DEPTH = MAX_GET_HISTORY * 4;
+  static constexpr double FAST_HISTORY_SCROLL_DELAY = 2.0;  // seconds between pages to consider scrolling fast
+
   static constexpr int32 LIVE_LOCATION_VIEW_PERIOD = 60;      // seconds, server-side limit
   static constexpr int32 UPDATE_VIEWED_MESSAGES_PERIOD = 15;  // seconds
 
@@ -1855,6 +1885,12 @@ class MessagesManager final : public Actor {
 
   static constexpr int32 MAX_RESEND_DELAY = 86400;  // seconds, some resonable limit
 
+  // initial and boundary rates of sending messages to multiple chats in messages per second
+  static constexpr double BOT_BULK_SEND_RATE = 25.0;
+  static constexpr double USER_BULK_SEND_RATE = 1.0;
+  static constexpr double MIN_BULK_SEND_RATE = 0.2;
+  static constexpr double BULK_SEND_RATE_INCREMENT = 0.2;
+
   static constexpr int32 SCHEDULE_WHEN_ONLINE_DATE = 2147483646;
 
   static constexpr double DIALOG_ACTION_TIMEOUT = 5.5;
@@ -1925,8 +1961,10 @@ class MessagesManager final : public Actor {
                                                           tl_object_ptr<td_api::messageSendOptions> &&options,
                                                           bool allow_update_stickersets_order) const;
 
-  static Status can_use_message_send_options(const MessageSendOptions &options,
-                                             const unique_ptr<MessageContent> &content, int32 ttl);
+  Status can_use_message_send_options(DialogId dialog_id, const MessageSendOptions &options) const;
+
+  static Status can_use_message_send_options(const MessageSendOptions &options, const MessageContent *content,
+                                             int32 ttl);
 
   static Status can_use_message_send_options(const MessageSendOptions &options, const InputMessageContent &content);
 
@@ -1937,12 +1975,12 @@ class MessagesManager final : public Actor {
   int64 generate_new_random_id(const Dialog *d);
 
   unique_ptr<Message> create_message_to_send(Dialog *d, MessageId top_thread_message_id, MessageId reply_to_message_id,
-                                             const MessageSendOptions &options, unique_ptr<MessageContent> &&content,
+                                             const MessageSendOptions &options, SharedMessageContent &&content,
                                              bool suppress_reply_info, unique_ptr<MessageForwardInfo> forward_info,
                                              bool is_copy, DialogId send_as_dialog_id) const;
 
   Message *get_message_to_send(Dialog *d, MessageId top_thread_message_id, MessageId reply_to_message_id,
-                               const MessageSendOptions &options, unique_ptr<MessageContent> &&content,
+                               const MessageSendOptions &options, SharedMessageContent &&content,
                                bool *need_update_dialog_pos, bool suppress_reply_info = false,
                                unique_ptr<MessageForwardInfo> forward_info = nullptr, bool is_copy = false,
                                DialogId sender_dialog_id = DialogId());
@@ -1951,6 +1989,8 @@ class MessagesManager final : public Actor {
 
   Status can_send_message(DialogId dialog_id) const TD_WARN_UNUSED_RESULT;
 
+  static const MessageSendError &get_message_send_error(const Message *m);
+
   bool can_resend_message(const Message *m) const;
 
   bool can_edit_message(DialogId dialog_id, const Message *m, bool is_editing, bool only_reply_markup = false) const;
@@ -2029,7 +2069,7 @@ class MessagesManager final : public Actor {
 
   struct ForwardedMessages {
     struct CopiedMessage {
-      unique_ptr<MessageContent> content;
+      SharedMessageContent content;
       MessageId reply_to_message_id;
       MessageId original_message_id;
       MessageId original_reply_to_message_id;
@@ -2041,7 +2081,7 @@ class MessagesManager final : public Actor {
     vector<CopiedMessage> copied_messages;
 
     struct ForwardedMessageContent {
-      unique_ptr<MessageContent> content;
+      SharedMessageContent content;
       int64 media_album_id;
       size_t index;
     };
@@ -2081,6 +2121,14 @@ class MessagesManager final : public Actor {
 
   void do_send_message_group(int64 media_album_id);
 
+  int64 generate_new_bulk_send_id() const;
+
+  void on_bulk_send_timeout(int64 bulk_send_id);
+
+  void on_bulk_send_message_finished(FullMessageId full_message_id, const Status &error);
+
+  void update_bulk_send_rate(const Status &error);
+
   void on_text_message_ready_to_send(DialogId dialog_id, MessageId message_id);
 
   void on_media_message_ready_to_send(DialogId dialog_id, MessageId message_id, Promise<Message *> &&promise);
@@ -2157,10 +2205,14 @@ class MessagesManager final : public Actor {
 
   void unload_dialog(DialogId dialog_id);
 
+  void unload_dialog_messages(Dialog *d, int32 unload_before_date);
+
+  void on_loaded_message_count_exceeded();
+
   void delete_all_dialog_messages(Dialog *d, bool remove_from_dialog_list, bool is_permanently_deleted);
 
   void do_delete_all_dialog_messages(Dialog *d, unique_ptr<Message> &message, bool is_permanently_deleted,
-                                     vector<int64> &deleted_message_ids);
+                                     vector<int64> &deleted_message_ids, vector<unique_ptr<Message>> &deleted_messages);
 
   void erase_delete_messages_log_event(uint64 log_event_id);
 
@@ -2318,6 +2370,10 @@ class MessagesManager final : public Actor {
 
   void preload_older_messages(const Dialog *d, MessageId min_message_id);
 
+  void do_preload_older_messages(const Dialog *d);
+
+  void on_preload_older_messages(DialogId dialog_id);
+
   void on_get_history_from_database(DialogId dialog_id, MessageId from_message_id,
                                     MessageId old_last_database_message_id, int32 offset, int32 limit,
                                     bool from_the_end, bool only_local, vector<MessageDbDialogMessage> &&messages,
@@ -2457,7 +2513,7 @@ class MessagesManager final : public Actor {
 
   static bool need_message_changed_warning(const Message *old_message);
 
-  bool update_message_content(DialogId dialog_id, Message *old_message, unique_ptr<MessageContent> new_content,
+  bool update_message_content(DialogId dialog_id, Message *old_message, SharedMessageContent new_content,
                               bool need_merge_files, bool is_message_in_dialog, bool &is_content_changed);
 
   void update_message_max_reply_media_timestamp(const Dialog *d, Message *m, bool need_send_update_message_content);
@@ -2825,6 +2881,10 @@ class MessagesManager final : public Actor {
   void on_get_dialogs_from_database(FolderId folder_id, int32 limit, DialogDbGetDialogsResult &&dialogs,
                                     Promise<Unit> &&promise);
 
+  bool are_all_dialogs_loaded_from_database() const;
+
+  void on_search_dialogs_from_database(vector<DialogId> dialog_ids, Promise<Unit> &&promise);
+
   void send_get_dialog_query(DialogId dialog_id, Promise<Unit> &&promise, uint64 log_event_id, const char *source);
 
   void send_search_public_dialogs_query(const string &query, Promise<Unit> &&promise);
@@ -2896,6 +2956,8 @@ class MessagesManager final : public Actor {
 
   int32 delete_dialog_filter(DialogFilterId dialog_filter_id, const char *source);
 
+  void update_dialog_filter_dialog_ids(const DialogFilter *filter);
+
   static bool set_dialog_filters_order(vector<unique_ptr<DialogFilter>> &dialog_filters,
                                        vector<DialogFilterId> dialog_filter_ids);
 
@@ -2962,6 +3024,8 @@ class MessagesManager final : public Actor {
 
   Message *get_message_force(FullMessageId full_message_id, const char *source);
 
+  void preload_messages_from_database(Dialog *d, const vector<MessageId> &message_ids, const char *source);
+
   void get_message_force_from_server(Dialog *d, MessageId message_id, Promise<Unit> &&promise,
                                      tl_object_ptr<telegram_api::InputMessage> input_message = nullptr);
 
@@ -3207,6 +3271,14 @@ class MessagesManager final : public Actor {
                                  tl_object_ptr<telegram_api::InputChannel> &&input_channel, bool is_old,
                                  const char *source);
 
+  void send_get_channel_difference_query(DialogId dialog_id, int32 pts, bool force,
+                                         tl_object_ptr<telegram_api::InputChannel> &&input_channel, bool is_old,
+                                         const char *source);
+
+  int32 get_channel_difference_priority(DialogId dialog_id) const;
+
+  void on_get_channel_difference_query_finished(bool is_success);
+
   void process_get_channel_difference_updates(DialogId dialog_id, int32 new_pts,
                                               vector<tl_object_ptr<telegram_api::Message>> &&new_messages,
                                               vector<tl_object_ptr<telegram_api::Update>> &&other_updates);
@@ -3244,6 +3316,8 @@ class MessagesManager final : public Actor {
 
   static void on_update_viewed_messages_timeout_callback(void *messages_manager_ptr, int64 dialog_id_int);
 
+  static void on_bulk_send_timeout_callback(void *messages_manager_ptr, int64 bulk_send_id);
+
   void load_secret_thumbnail(FileId thumbnail_file_id);
 
   void on_upload_media(FileId file_id, tl_object_ptr<telegram_api::InputFile> input_file,
@@ -3481,6 +3555,8 @@ class MessagesManager final : public Actor {
 
   FlatHashMap<int64, FullMessageId> being_sent_messages_;  // message_random_id -> message
 
+  FullMessageId being_range_deleted_full_message_id_;  // messages up to it are deleted from the database by range
+
   FlatHashMap<FullMessageId, MessageId, FullMessageIdHash> update_message_ids_;  // new_message_id -> temporary_id
   FlatHashMap<DialogId, FlatHashMap<ScheduledServerMessageId, MessageId, ScheduledServerMessageIdHash>,
               DialogIdHash>
@@ -3553,6 +3629,31 @@ class MessagesManager final : public Actor {
   };
   FlatHashMap<int64, PendingMessageGroupSend> pending_message_group_sends_;  // media_album_id -> ...
 
+  struct HistoryPreloadState {
+    double last_get_history_time = 0.0;
+    int32 older_preload_depth = 0;
+    MessageId older_preload_from_message_id;
+    int32 older_preloaded_count = -1;
+    bool is_preloading_older = false;
+  };
+  FlatHashMap<DialogId, HistoryPreloadState, DialogIdHash> history_preload_states_;
+
+  struct BulkSend {
+    vector<FullMessageId> message_ids;
+    size_t next_message_pos = 0;
+    int32 sent_count = 0;
+    int32 failed_count = 0;
+    bool is_waiting_for_media_upload = false;
+  };
+  FlatHashMap<int64, unique_ptr<BulkSend>> bulk_sends_;                         // bulk_send_id -> ...
+  FlatHashMap<FullMessageId, int64, FullMessageIdHash> bulk_send_message_ids_;  // message -> bulk_send_id
+
+  // token bucket shared by all sends to multiple chats
+  double bulk_send_rate_ = 0.0;
+  double bulk_send_tokens_ = 0.0;
+  double bulk_send_tokens_update_time_ = 0.0;
+  double bulk_send_resume_time_ = 0.0;
+
   WaitFreeHashMap<MessageId, DialogId, MessageIdHash> message_id_to_dialog_id_;
   FlatHashMap<MessageId, DialogId, MessageIdHash> last_clear_history_message_id_to_dialog_id_;
 
@@ -3646,12 +3747,28 @@ class MessagesManager final : public Actor {
   int32 dialog_filters_updated_date_ = 0;
   vector<unique_ptr<DialogFilter>> server_dialog_filters_;
   vector<unique_ptr<DialogFilter>> dialog_filters_;
+  // for each chat filter, chats, which are explicitly included (true) or excluded (false) by it
+  FlatHashMap<DialogFilterId, FlatHashMap<DialogId, bool, DialogIdHash>, DialogFilterIdHash> dialog_filter_dialog_ids_;
   vector<RecommendedDialogFilter> recommended_dialog_filters_;
   vector<Promise<Unit>> dialog_filter_reload_queries_;
   int32 server_main_dialog_list_position_ = 0;  // position of the main dialog list stored on the server
   int32 main_dialog_list_position_ = 0;         // local position of the main dialog list stored on the server
 
   FlatHashMap<DialogId, string, DialogIdHash> active_get_channel_differencies_;
+
+  struct PendingChannelDifference {
+    DialogId dialog_id;
+    int32 pts = 0;
+    bool force = false;
+    bool is_old = false;
+    tl_object_ptr<telegram_api::InputChannel> input_channel;
+    const char *source = nullptr;
+  };
+  // channels.getDifference queries waiting for a free slot, ordered by priority and then by addition order
+  std::map<std::pair<int32, uint64>, PendingChannelDifference> pending_channel_differences_;
+  uint64 pending_channel_difference_count_ = 0;
+  int32 running_channel_difference_query_count_ = 0;
+  int32 max_running_channel_difference_query_count_ = 10;
   FlatHashMap<DialogId, uint64, DialogIdHash> get_channel_difference_to_log_event_id_;
   FlatHashMap<DialogId, int32, DialogIdHash> channel_get_difference_retry_timeouts_;
   FlatHashMap<DialogId, std::multimap<int32, PendingPtsUpdate>, DialogIdHash> postponed_channel_updates_;
@@ -3663,6 +3780,7 @@ class MessagesManager final : public Actor {
   MultiTimeout pending_message_live_location_view_timeout_{"PendingMessageLiveLocationViewTimeout"};
   MultiTimeout pending_draft_message_timeout_{"PendingDraftMessageTimeout"};
   MultiTimeout pending_read_history_timeout_{"PendingReadHistoryTimeout"};
+  FloodControlFast read_history_flood_control_;  // shared by read history requests in all chats
   MultiTimeout pending_updated_dialog_timeout_{"PendingUpdatedDialogTimeout"};
   MultiTimeout pending_unload_dialog_timeout_{"PendingUnloadDialogTimeout"};
   MultiTimeout dialog_unmute_timeout_{"DialogUnmuteTimeout"};
@@ -3671,10 +3789,12 @@ class MessagesManager final : public Actor {
   MultiTimeout update_dialog_online_member_count_timeout_{"UpdateDialogOnlineMemberCountTimeout"};
   MultiTimeout preload_folder_dialog_list_timeout_{"PreloadFolderDialogListTimeout"};
   MultiTimeout update_viewed_messages_timeout_{"UpdateViewedMessagesTimeout"};
+  MultiTimeout bulk_send_timeout_{"BulkSendTimeout"};
 
   Timeout reload_dialog_filters_timeout_;
 
   Hints dialogs_hints_;  // search dialogs by title and usernames
+  FlatHashSet<string> database_searched_dialog_queries_;
 
   FlatHashSet<FullMessageId, FullMessageIdHash> active_live_location_full_message_ids_;
   bool are_active_live_location_messages_loaded_ = false;
@@ -3767,6 +3887,7 @@ class MessagesManager final : public Actor {
     FlatHashMap<MessageId, uint64, MessageIdHash> message_id_to_view_id;
     std::map<uint64, MessageId> recently_viewed_messages;
     uint64 current_view_id = 0;
+    uint32 poll_count = 0;
   };
   FlatHashMap<DialogId, unique_ptr<ViewedMessagesInfo>, DialogIdHash> dialog_viewed_messages_;
 
@@ -3816,6 +3937,12 @@ class MessagesManager final : public Actor {
   DialogId debug_last_get_channel_difference_dialog_id_;
   const char *debug_last_get_channel_difference_source_ = "unknown";
 
+  int64 loaded_message_count_ = 0;      // number of non-scheduled messages in memory in all dialogs
+  int64 message_unload_threshold_ = 0;  // if positive, unload messages sooner when more of them are loaded
+  double last_fast_unload_time_ = 0.0;
+  int64 unloaded_message_count_ = 0;
+  int64 reloaded_message_count_ = 0;
+
   double start_time_ = 0;
   bool is_inited_ = false;
 
@@ -0,0 +1,161 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/MetricsExporter.h"
+
+#include "td/net/HttpHeaderCreator.h"
+#include "td/net/HttpInboundConnection.h"
+#include "td/net/HttpQuery.h"
+#include "td/net/TcpListener.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/BufferedFd.h"
+#include "td/utils/ExitGuard.h"
+#include "td/utils/logging.h"
+#include "td/utils/Metrics.h"
+#include "td/utils/port/ServerSocketFd.h"
+#include "td/utils/port/SocketFd.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <memory>
+#include <mutex>
+
+namespace td {
+
+namespace {
+
+constexpr CSlice METRICS_EXPORTER_ADDRESS("127.0.0.1");
+
+class MetricsQueryHandler final : public HttpInboundConnection::Callback {
+ public:
+  void handle(unique_ptr<HttpQuery> query, ActorOwn<HttpInboundConnection> connection) final {
+    HttpHeaderCreator hc;
+    string content;
+    if (query->type_ == HttpQuery::Type::Get && query->url_path_ == Slice("/metrics")) {
+      content = MetricRegistry::get_prometheus_text();
+      hc.init_ok();
+      hc.set_content_type("text/plain; version=0.0.4");
+    } else {
+      content = "Not Found";
+      hc.init_status_line(404);
+      hc.set_content_type("text/plain");
+    }
+    hc.set_keep_alive();
+    hc.set_content_size(content.size());
+
+    auto r_header = hc.finish(content);
+    if (r_header.is_error()) {
+      LOG(ERROR) << "Failed to create metrics response: " << r_header.error();
+      send_closure(connection.release(), &HttpInboundConnection::write_error, r_header.move_as_error());
+      return;
+    }
+    send_closure(connection, &HttpInboundConnection::write_next, BufferSlice(r_header.ok()));
+    send_closure(connection.release(), &HttpInboundConnection::write_ok);
+  }
+};
+
+class MetricsServer final : public TcpListener::Callback {
+ public:
+  explicit MetricsServer(int32 port) : port_(port) {
+  }
+
+ private:
+  static constexpr int32 IDLE_TIMEOUT = 60;
+
+  int32 port_;
+  ActorOwn<TcpListener> listener_;
+
+  void start_up() final {
+    listener_ = create_actor<TcpListener>("MetricsListener", port_, actor_shared(this), METRICS_EXPORTER_ADDRESS);
+  }
+
+  void accept(SocketFd fd) final {
+    create_actor<HttpInboundConnection>("MetricsConnection", BufferedFd<SocketFd>(std::move(fd)), 0, 0, IDLE_TIMEOUT,
+                                        create_actor<MetricsQueryHandler>("MetricsQueryHandler"))
+        .release();
+  }
+};
+
+constexpr int32 MetricsServer::IDLE_TIMEOUT;
+
+class MetricsExporterImpl {
+ public:
+  explicit MetricsExporterImpl(int32 port) {
+    concurrent_scheduler_ = std::make_shared<ConcurrentScheduler>(0, 0);
+    {
+      auto guard = concurrent_scheduler_->get_main_guard();
+      server_ = create_actor<MetricsServer>("MetricsServer", port);
+    }
+    concurrent_scheduler_->start();
+
+    scheduler_thread_ = thread([concurrent_scheduler = concurrent_scheduler_] {
+      while (concurrent_scheduler->run_main(10)) {
+      }
+    });
+  }
+  MetricsExporterImpl(const MetricsExporterImpl &) = delete;
+  MetricsExporterImpl &operator=(const MetricsExporterImpl &) = delete;
+  MetricsExporterImpl(MetricsExporterImpl &&) = delete;
+  MetricsExporterImpl &operator=(MetricsExporterImpl &&) = delete;
+
+  ~MetricsExporterImpl() {
+    {
+      auto guard = concurrent_scheduler_->get_send_guard();
+      server_.reset();
+      Scheduler::instance()->finish();
+    }
+    if (!ExitGuard::is_exited()) {
+      scheduler_thread_.join();
+    } else {
+      scheduler_thread_.detach();
+    }
+    concurrent_scheduler_->finish();
+  }
+
+ private:
+  std::shared_ptr<ConcurrentScheduler> concurrent_scheduler_;
+  thread scheduler_thread_;
+  ActorOwn<MetricsServer> server_;
+};
+
+}  // namespace
+
+Status MetricsExporter::set_port(int32 port) {
+  if (port < 0 || port > 65535) {
+    return Status::Error(400, "Invalid port specified");
+  }
+
+  static std::mutex mutex;
+  static unique_ptr<MetricsExporterImpl> exporter;
+  static int32 exporter_port = 0;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (port == exporter_port) {
+    return Status::OK();
+  }
+  if (port != 0) {
+    // check that the port is free to report an error synchronously; the listener reopens it itself
+    auto r_socket = ServerSocketFd::open(port, METRICS_EXPORTER_ADDRESS);
+    if (r_socket.is_error()) {
+      return Status::Error(400, PSLICE() << "Can't listen on port " << port << ": " << r_socket.error().message());
+    }
+  }
+
+  exporter = nullptr;
+  exporter_port = port;
+  MetricRegistry::set_enabled(port != 0);
+  if (port != 0) {
+    exporter = make_unique<MetricsExporterImpl>(port);
+  }
+  return Status::OK();
+}
+
+}  // namespace td
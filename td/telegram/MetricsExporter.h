@@ -0,0 +1,23 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+// Serves metrics from MetricRegistry in Prometheus text exposition format at http://127.0.0.1:<port>/metrics
+// There is at most one exporter per process, which runs in its own thread and covers all TDLib instances
+class MetricsExporter {
+ public:
+  // starts the exporter on the given port and enables collection of metrics;
+  // stops the exporter and disables collection of metrics if the port is 0
+  static Status set_port(int32 port);
+};
+
+}  // namespace td
@@ -21,9 +21,13 @@
 #include "td/telegram/misc.h"
 #include "td/telegram/net/ConnectionCreator.h"
 #include "td/telegram/net/DcId.h"
+#include "td/telegram/NotificationSettingsManager.h"
+#include "td/telegram/NotificationSettingsScope.h"
 #include "td/telegram/OptionManager.h"
 #include "td/telegram/Photo.h"
 #include "td/telegram/Photo.hpp"
+#include "td/telegram/ScopeNotificationSettings.h"
+#include "td/telegram/ScopeNotificationSettings.hpp"
 #include "td/telegram/SecretChatId.h"
 #include "td/telegram/ServerMessageId.h"
 #include "td/telegram/StateManager.h"
@@ -39,6 +43,7 @@
 
 #include "td/db/binlog/BinlogEvent.h"
 #include "td/db/binlog/BinlogHelper.h"
+#include "td/db/DbKey.h"
 
 #include "td/actor/SleepActor.h"
 
@@ -51,6 +56,7 @@
 #include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/port/Clocks.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
@@ -59,6 +65,7 @@
 #include "td/utils/utf8.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <limits>
 
@@ -971,13 +978,19 @@ void NotificationManager::add_update(int32 group_id, td_api::object_ptr<td_api::
   updates.push_back(std::move(update));
   if (!G()->close_flag()) {
     if (!running_get_difference_ && running_get_chat_difference_.count(group_id) == 0) {
-      flush_pending_updates_timeout_.add_timeout_in(group_id, MIN_UPDATE_DELAY_MS * 1e-3);
+      flush_pending_updates_timeout_.add_timeout_at(group_id, get_pending_updates_flush_time(MIN_UPDATE_DELAY_MS));
     } else {
-      flush_pending_updates_timeout_.set_timeout_in(group_id, MAX_UPDATE_DELAY_MS * 1e-3);
+      flush_pending_updates_timeout_.set_timeout_at(group_id, get_pending_updates_flush_time(MAX_UPDATE_DELAY_MS));
     }
   }
 }
 
+double NotificationManager::get_pending_updates_flush_time(int32 delay_ms) {
+  // align flush time to a tick to flush pending updates of all groups, changed at the same time, together
+  const double tick = UPDATE_FLUSH_TICK_MS * 1e-3;
+  return std::ceil((Time::now() + delay_ms * 1e-3) / tick) * tick;
+}
+
 void NotificationManager::add_update_notification_group(td_api::object_ptr<td_api::updateNotificationGroup> update) {
   auto group_id = update->notification_group_id_;
   if (update->notification_settings_chat_id_ == 0) {
@@ -1030,6 +1043,7 @@ void NotificationManager::flush_pending_updates(int32 group_id, const char *sour
   for (auto &update : updates) {
     VLOG(notifications) << "Have " << as_notification_update(update.get());
   }
+  auto pending_update_count = updates.size();
 
   td::remove_if(updates, [](auto &update) { return update == nullptr; });
 
@@ -1335,6 +1349,12 @@ void NotificationManager::flush_pending_updates(int32 group_id, const char *sour
     updates.resize(last_update_pos + 1);
   }
 
+  flushed_update_count_ += static_cast<int64>(pending_update_count);
+  merged_update_count_ += static_cast<int64>(pending_update_count - updates.size());
+  VLOG(notifications) << "Merged " << pending_update_count - updates.size() << " out of " << pending_update_count
+                      << " pending updates in " << NotificationGroupId(group_id) << "; totally merged "
+                      << merged_update_count_ << " out of " << flushed_update_count_ << " pending updates";
+
   for (auto &update : updates) {
     CHECK(update != nullptr);
     if (update->get_id() == td_api::updateNotificationGroup::ID) {
@@ -2713,7 +2733,7 @@ void NotificationManager::process_push_notification(string payload, Promise<Unit
     send_closure(G()->state_manager(), &StateManager::on_online, false);
   }
 
-  if (receiver_id == 0 || receiver_id == td_->option_manager_->get_option_integer("my_id")) {
+  if (receiver_id == 0 || receiver_id == td_->option_manager_->get_option_integer(OptionId::MyId)) {
     auto status = process_push_notification_payload(payload, was_encrypted, promise);
     if (status.is_error()) {
       if (status.code() == 406 || status.code() == 200) {
@@ -3980,6 +4000,133 @@ Result<string> NotificationManager::decrypt_push_payload(int64 encryption_key_id
   return result.packet().substr(4).str();
 }
 
+Result<td_api::object_ptr<td_api::decryptedPushNotification>> NotificationManager::decrypt_push_notification(
+    const TdParameters &parameters, DbKey db_key, string payload) {
+  TRY_RESULT(receiver_id, get_push_receiver_id(payload));
+
+  auto device_token_keys = DeviceTokenManager::get_database_keys();
+  auto keys = device_token_keys;
+  keys.push_back("my_id");
+  const NotificationSettingsScope scopes[] = {NotificationSettingsScope::Private, NotificationSettingsScope::Group,
+                                              NotificationSettingsScope::Channel};
+  for (auto scope : scopes) {
+    keys.push_back(NotificationSettingsManager::get_notification_settings_scope_database_key(scope));
+  }
+  TRY_RESULT(values, TdDb::get_binlog_pmc_values_read_only(parameters, std::move(db_key), keys));
+  auto my_id = to_integer<int64>(values[device_token_keys.size()]);
+
+  if (receiver_id != 0) {
+    for (size_t i = 0; i < device_token_keys.size(); i++) {
+      auto r_key = DeviceTokenManager::get_saved_encryption_key(values[i], my_id);
+      if (r_key.is_error() || r_key.ok().first != receiver_id) {
+        continue;
+      }
+      auto key = r_key.move_as_ok();
+      if (!key.second.empty()) {
+        auto r_payload = decrypt_push(key.first, std::move(key.second), std::move(payload));
+        if (r_payload.is_error()) {
+          LOG(ERROR) << "Failed to decrypt push: " << r_payload.error();
+          return Status::Error(400, "Failed to decrypt push payload");
+        }
+        payload = r_payload.move_as_ok();
+      }
+      receiver_id = 0;
+      break;
+    }
+    if (receiver_id != 0 && receiver_id != my_id) {
+      return Status::Error(400, "The push notification was sent to another account");
+    }
+  }
+  if (!check_utf8(payload)) {
+    return Status::Error(400, "Push payload must be encoded in UTF-8");
+  }
+
+  auto result = td_api::make_object<td_api::decryptedPushNotification>();
+  result->receiver_user_id_ = my_id;
+  result->show_preview_ = true;
+
+  auto json_value = json_decode(payload).move_as_ok();  // the payload was already successfully parsed
+  if (json_value.type() == JsonValue::Type::Object) {
+    auto data = std::move(json_value.get_object());
+    if (has_json_object_field(data, "data")) {
+      TRY_RESULT(data_data, get_json_object_field(data, "data", JsonValue::Type::Object, false));
+      data = std::move(data_data.get_object());
+    }
+
+    JsonObject custom;
+    for (auto &field_value : data) {
+      if (field_value.first == "loc_key" && field_value.second.type() == JsonValue::Type::String) {
+        result->loc_key_ = field_value.second.get_string().str();
+      } else if (field_value.first == "loc_args" && field_value.second.type() == JsonValue::Type::Array) {
+        for (auto &arg : field_value.second.get_array()) {
+          if (arg.type() == JsonValue::Type::String) {
+            result->loc_args_.push_back(arg.get_string().str());
+          }
+        }
+      } else if (field_value.first == "custom" && field_value.second.type() == JsonValue::Type::Object) {
+        custom = std::move(field_value.second.get_object());
+      }
+    }
+    if (!clean_input_string(result->loc_key_)) {
+      result->loc_key_.clear();
+    }
+    for (auto &loc_arg : result->loc_args_) {
+      if (!clean_input_string(loc_arg)) {
+        loc_arg.clear();
+      }
+    }
+
+    DialogId dialog_id;
+    TRY_RESULT(user_id_int, get_json_object_long_field(custom, "from_id"));
+    if (user_id_int != 0) {
+      dialog_id = DialogId(UserId(user_id_int));
+    }
+    TRY_RESULT(chat_id_int, get_json_object_long_field(custom, "chat_id"));
+    if (chat_id_int != 0) {
+      dialog_id = DialogId(ChatId(chat_id_int));
+    }
+    TRY_RESULT(channel_id_int, get_json_object_long_field(custom, "channel_id"));
+    if (channel_id_int != 0) {
+      dialog_id = DialogId(ChannelId(channel_id_int));
+    }
+    TRY_RESULT(secret_chat_id_int, get_json_object_int_field(custom, "encryption_id"));
+    if (secret_chat_id_int != 0) {
+      dialog_id = DialogId(SecretChatId(secret_chat_id_int));
+    }
+    if (dialog_id.is_valid()) {
+      result->chat_id_ = dialog_id.get();
+
+      TRY_RESULT(msg_id, get_json_object_int_field(custom, "msg_id"));
+      ServerMessageId server_message_id(msg_id);
+      if (server_message_id.is_valid()) {
+        result->message_id_ = MessageId(server_message_id).get();
+      }
+
+      auto scope = NotificationSettingsScope::Private;
+      if (dialog_id.get_type() == DialogType::Chat) {
+        scope = NotificationSettingsScope::Group;
+      } else if (dialog_id.get_type() == DialogType::Channel) {
+        scope = begins_with(result->loc_key_, "CHANNEL_") ? NotificationSettingsScope::Channel
+                                                          : NotificationSettingsScope::Group;
+      }
+      const string &serialized_settings = values[device_token_keys.size() + 1 + static_cast<size_t>(scope)];
+      if (!serialized_settings.empty()) {
+        // the settings can't be parsed with log_event_parse, because there is no Global instance
+        ScopeNotificationSettings settings;
+        LogEventParser parser(serialized_settings, nullptr);
+        parse(settings, parser);
+        parser.fetch_end();
+        if (parser.get_status().is_ok()) {
+          result->is_muted_ = settings.mute_until > static_cast<int32>(Clocks::system());
+          result->show_preview_ = settings.show_preview;
+        }
+      }
+    }
+  }
+  result->payload_ = std::move(payload);
+  return std::move(result);
+}
+
 void NotificationManager::before_get_difference() {
   if (is_disabled()) {
     return;
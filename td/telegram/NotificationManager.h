@@ -42,8 +42,12 @@ extern int VERBOSITY_NAME(notifications);
 
 struct BinlogEvent;
 
+class DbKey;
+
 class Td;
 
+struct TdParameters;
+
 class NotificationManager final : public Actor {
  public:
   static constexpr int32 MIN_NOTIFICATION_GROUP_COUNT_MAX = 0;
@@ -115,6 +119,10 @@ class NotificationManager final : public Actor {
 
   static Result<string> decrypt_push(int64 encryption_key_id, string encryption_key, string push);  // public for tests
 
+  // decrypts the push notification using only data from the binlog without initialization of a Td instance
+  static Result<td_api::object_ptr<td_api::decryptedPushNotification>> decrypt_push_notification(
+      const TdParameters &parameters, DbKey db_key, string payload);
+
   void before_get_difference();
 
   void after_get_difference();
@@ -147,6 +155,7 @@ class NotificationManager final : public Actor {
 
   static constexpr int32 MIN_UPDATE_DELAY_MS = 50;
   static constexpr int32 MAX_UPDATE_DELAY_MS = 60000;
+  static constexpr int32 UPDATE_FLUSH_TICK_MS = 10;
 
   static constexpr int32 ANNOUNCEMENT_ID_CACHE_TIME = 7 * 86400;
 
@@ -211,6 +220,8 @@ class NotificationManager final : public Actor {
 
   static void on_flush_pending_updates_timeout_callback(void *notification_manager_ptr, int64 group_id_int);
 
+  static double get_pending_updates_flush_time(int32 delay_ms);
+
   bool is_disabled() const;
 
   void start_up() final;
@@ -362,6 +373,9 @@ class NotificationManager final : public Actor {
   int32 delayed_notification_update_count_ = 0;
   int32 unreceived_notification_update_count_ = 0;
 
+  int64 flushed_update_count_ = 0;  // total number of flushed pending updates
+  int64 merged_update_count_ = 0;   // number of flushed pending updates, which were merged or dropped
+
   NotificationGroupKey last_loaded_notification_group_key_;
 
   SyncState contact_registered_notifications_sync_state_ = SyncState::NotSynced;
@@ -108,6 +108,8 @@ class NotificationSettingsManager final : public Actor {
 
   void get_current_state(vector<td_api::object_ptr<td_api::Update>> &updates) const;
 
+  static string get_notification_settings_scope_database_key(NotificationSettingsScope scope);
+
  private:
   class UpdateScopeNotificationSettingsOnServerLogEvent;
 
@@ -167,8 +169,6 @@ class NotificationSettingsManager final : public Actor {
 
   void on_scope_unmute(NotificationSettingsScope scope);
 
-  static string get_notification_settings_scope_database_key(NotificationSettingsScope scope);
-
   static void save_scope_notification_settings(NotificationSettingsScope scope,
                                                const ScopeNotificationSettings &new_settings);
 
@@ -108,6 +108,10 @@ void store_notification_sound(const NotificationSound *notification_sound, LogEv
   store(notification_sound, storer);
 }
 
+void store_notification_sound(const NotificationSound *notification_sound, LogEventStorerBounded &storer) {
+  store(notification_sound, storer);
+}
+
 void parse_notification_sound(unique_ptr<NotificationSound> &notification_sound, LogEventParser &parser) {
   parse(notification_sound, parser);
 }
@@ -36,6 +36,8 @@ void store_notification_sound(const NotificationSound *notification_sound, LogEv
 
 void store_notification_sound(const NotificationSound *notification_sound, LogEventStorerUnsafe &storer);
 
+void store_notification_sound(const NotificationSound *notification_sound, LogEventStorerBounded &storer);
+
 template <class StorerT>
 void NotificationSound::store(StorerT &storer) const {
   store_notification_sound(this, storer);
@@ -0,0 +1,30 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+namespace td {
+
+// frequently accessed boolean and integer options, whose values are cached by OptionManager
+enum class OptionId : int32 {
+  IsPremium,
+  MyId,
+  SessionCount,
+  AuthorizationDate,
+  UseQuickAck,
+  PreferIpv6,
+  CanIgnoreSensitiveContentRestrictions,
+  IgnoreSensitiveContentRestrictions,
+  UtcTimeOffset,
+  RevokePmInbox,
+  RevokePmTimeLimit,
+  RevokeTimeLimit,
+  Size
+};
+
+}  // namespace td
@@ -12,12 +12,16 @@
 #include "td/telegram/ConfigManager.h"
 #include "td/telegram/ContactsManager.h"
 #include "td/telegram/CountryInfoManager.h"
+#include "td/telegram/DbBlobCompression.h"
 #include "td/telegram/DialogId.h"
+#include "td/telegram/files/ResourceArbiter.h"
 #include "td/telegram/GitCommitHash.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/JsonValue.h"
 #include "td/telegram/LanguagePackManager.h"
 #include "td/telegram/MessageReaction.h"
+#include "td/telegram/MessagesManager.h"
+#include "td/telegram/net/ConnectionCreator.h"
 #include "td/telegram/net/MtprotoHeader.h"
 #include "td/telegram/net/NetQueryDispatcher.h"
 #include "td/telegram/NotificationManager.h"
@@ -29,6 +33,9 @@
 #include "td/telegram/TdDb.h"
 #include "td/telegram/TopDialogManager.h"
 
+#include "td/mtproto/CryptoWorkerPool.h"
+#include "td/mtproto/DhExponentPool.h"
+
 #include "td/db/KeyValueSyncInterface.h"
 #include "td/db/TsSeqKeyValue.h"
 
@@ -59,6 +66,7 @@ OptionManager::OptionManager(Td *td)
   for (const auto &name_value : all_options) {
     const string &name = name_value.first;
     options_->set(name, name_value.second);
+    update_cached_option_value(name, name_value.second);
     if (!is_internal_option(name)) {
       send_closure(G()->td(), &Td::send_update,
                    td_api::make_object<td_api::updateOption>(name, get_option_value_object(name_value.second)));
@@ -69,6 +77,7 @@ OptionManager::OptionManager(Td *td)
       }
     }
   }
+  DbBlobCompression::set_enabled(get_option_boolean("compress_message_database"));
 
   if (!have_option("message_text_length_max")) {
     set_option_integer("message_text_length_max", 4096);
@@ -185,6 +194,69 @@ string OptionManager::get_option_string(Slice name, string default_value) const
   return value.substr(1);
 }
 
+bool OptionManager::get_option_boolean(OptionId option_id, bool default_value) const {
+  const auto &cached_value = cached_option_values_[static_cast<size_t>(option_id)];
+  switch (cached_value.type.load(std::memory_order_acquire)) {
+    case CachedOptionValue::Type::Empty:
+      return default_value;
+    case CachedOptionValue::Type::Boolean:
+      return cached_value.value.load(std::memory_order_relaxed) != 0;
+    default:
+      return get_option_boolean(get_option_id_name(option_id), default_value);
+  }
+}
+
+int64 OptionManager::get_option_integer(OptionId option_id, int64 default_value) const {
+  const auto &cached_value = cached_option_values_[static_cast<size_t>(option_id)];
+  switch (cached_value.type.load(std::memory_order_acquire)) {
+    case CachedOptionValue::Type::Empty:
+      return default_value;
+    case CachedOptionValue::Type::Integer:
+      return cached_value.value.load(std::memory_order_relaxed);
+    default:
+      return get_option_integer(get_option_id_name(option_id), default_value);
+  }
+}
+
+Slice OptionManager::get_option_id_name(OptionId option_id) {
+  static const Slice names[] = {"is_premium",
+                                "my_id",
+                                "session_count",
+                                "authorization_date",
+                                "use_quick_ack",
+                                "prefer_ipv6",
+                                "can_ignore_sensitive_content_restrictions",
+                                "ignore_sensitive_content_restrictions",
+                                "utc_time_offset",
+                                "revoke_pm_inbox",
+                                "revoke_pm_time_limit",
+                                "revoke_time_limit"};
+  static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(OptionId::Size), "");
+  return names[static_cast<size_t>(option_id)];
+}
+
+void OptionManager::update_cached_option_value(Slice name, Slice value) {
+  for (size_t i = 0; i < cached_option_values_.size(); i++) {
+    if (get_option_id_name(static_cast<OptionId>(i)) != name) {
+      continue;
+    }
+
+    auto &cached_value = cached_option_values_[i];
+    if (value.empty()) {
+      cached_value.type.store(CachedOptionValue::Type::Empty, std::memory_order_release);
+    } else if (value == "Btrue" || value == "Bfalse") {
+      cached_value.value.store(value == "Btrue" ? 1 : 0, std::memory_order_relaxed);
+      cached_value.type.store(CachedOptionValue::Type::Boolean, std::memory_order_release);
+    } else if (value[0] == 'I') {
+      cached_value.value.store(to_integer<int64>(value.substr(1)), std::memory_order_relaxed);
+      cached_value.type.store(CachedOptionValue::Type::Integer, std::memory_order_release);
+    } else {
+      cached_value.type.store(CachedOptionValue::Type::Other, std::memory_order_release);
+    }
+    return;
+  }
+}
+
 void OptionManager::set_option(Slice name, Slice value) {
   CHECK(!name.empty());
   CHECK(Scheduler::instance()->sched_id() == current_scheduler_id_);
@@ -199,6 +271,7 @@ void OptionManager::set_option(Slice name, Slice value) {
     }
     option_pmc_->set(name.str(), value.str());
   }
+  update_cached_option_value(name, value);
 
   if (!G()->close_flag() && is_td_inited_) {
     on_option_updated(name);
@@ -330,11 +403,17 @@ void OptionManager::on_option_updated(Slice name) {
       if (name == "animation_search_provider") {
         td_->animations_manager_->on_update_animation_search_provider();
       }
+      if (name == "auto_select_proxy") {
+        send_closure(G()->connection_creator(), &ConnectionCreator::on_auto_select_proxy_changed);
+      }
       break;
     case 'b':
       if (name == "base_language_pack_version") {
         send_closure(td_->language_pack_manager_, &LanguagePackManager::on_language_pack_version_changed, true, -1);
       }
+      if (name == "buffer_memory_limit") {
+        ResourceArbiter::set_buffer_memory_limit(get_option_integer(name));
+      }
       break;
     case 'c':
       if (name == "connection_parameters") {
@@ -342,8 +421,17 @@ void OptionManager::on_option_updated(Slice name) {
           G()->net_query_dispatcher().update_mtproto_header();
         }
       }
+      if (name == "compress_message_database") {
+        DbBlobCompression::set_enabled(get_option_boolean(name));
+      }
+      if (name == "crypto_worker_count") {
+        mtproto::CryptoWorkerPool::set_worker_count(narrow_cast<int32>(get_option_integer(name)));
+      }
       break;
     case 'd':
+      if (name == "dh_exponent_pool_size") {
+        mtproto::DhExponentPool::set_max_size(static_cast<size_t>(get_option_integer(name)));
+      }
       if (name == "dice_emojis") {
         send_closure(td_->stickers_manager_actor_, &StickersManager::on_update_dice_emojis);
       }
@@ -402,6 +490,14 @@ void OptionManager::on_option_updated(Slice name) {
         }
       }
       break;
+    case 'm':
+      if (name == "max_session_count") {
+        G()->net_query_dispatcher().update_session_count();
+      }
+      if (name == "message_unload_threshold") {
+        send_closure(td_->messages_manager_actor_, &MessagesManager::on_update_message_unload_threshold);
+      }
+      break;
     case 'n':
       if (name == "notification_cloud_delay_ms") {
         send_closure(td_->notification_manager_actor_, &NotificationManager::on_notification_cloud_delay_changed);
@@ -422,6 +518,11 @@ void OptionManager::on_option_updated(Slice name) {
         send_closure(td_->notification_manager_actor_, &NotificationManager::on_online_cloud_timeout_changed);
       }
       break;
+    case 'p':
+      if (name == "prewarmed_connection_count") {
+        send_closure(G()->connection_creator(), &ConnectionCreator::on_prewarmed_connection_count_changed);
+      }
+      break;
     case 'r':
       if (name == "rating_e_decay") {
         send_closure(td_->top_dialog_manager_actor_, &TopDialogManager::update_rating_e_decay);
@@ -439,9 +540,15 @@ void OptionManager::on_option_updated(Slice name) {
       }
       break;
     case 'u':
+      if (name == "update_coalescing_delay_ms") {
+        td_->on_update_coalescing_delay_changed();
+      }
       if (name == "use_pfs") {
         G()->net_query_dispatcher().update_use_pfs();
       }
+      if (name == "use_shared_config") {
+        send_closure(td_->config_manager_, &ConfigManager::on_use_shared_config_changed);
+      }
       if (name == "use_storage_optimizer") {
         send_closure(td_->storage_manager_, &StorageManager::update_use_storage_optimizer);
       }
@@ -614,6 +721,9 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       if (set_boolean_option("always_parse_markdown")) {
         return;
       }
+      if (set_boolean_option("auto_select_proxy")) {
+        return;
+      }
       if (!is_bot && name == "archive_and_mute_new_chats_from_unknown_users") {
         if (value_constructor_id != td_api::optionValueBoolean::ID &&
             value_constructor_id != td_api::optionValueEmpty::ID) {
@@ -628,7 +738,18 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
         return;
       }
       break;
+    case 'b':
+      if (set_integer_option("buffer_memory_limit", 0, std::numeric_limits<int64>::max())) {
+        return;
+      }
+      break;
     case 'c':
+      if (set_boolean_option("compress_message_database")) {
+        return;
+      }
+      if (set_integer_option("crypto_worker_count", 0, 16)) {
+        return;
+      }
       if (!is_bot && set_string_option("connection_parameters", [](Slice value) {
             string value_copy = value.str();
             auto r_json_value = get_json_value(value_copy);
@@ -641,9 +762,18 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       }
       break;
     case 'd':
+      if (set_boolean_option("deduplicate_net_queries")) {
+        return;
+      }
+      if (set_integer_option("dh_exponent_pool_size", 0, 64)) {
+        return;
+      }
       if (!is_bot && set_boolean_option("disable_animated_emoji")) {
         return;
       }
+      if (!is_bot && set_boolean_option("disable_chat_list_preloading")) {
+        return;
+      }
       if (!is_bot && set_boolean_option("disable_contact_registered_notifications")) {
         return;
       }
@@ -665,6 +795,11 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
         return promise.set_value(Unit());
       }
       break;
+    case 'f':
+      if (set_integer_option("file_transfer_weight", 1, 100)) {
+        return;
+      }
+      break;
     case 'i':
       if (set_boolean_option("ignore_background_updates")) {
         return;
@@ -682,7 +817,7 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
         return;
       }
       if (!is_bot && name == "ignore_sensitive_content_restrictions") {
-        if (!get_option_boolean("can_ignore_sensitive_content_restrictions")) {
+        if (!get_option_boolean(OptionId::CanIgnoreSensitiveContentRestrictions)) {
           return promise.set_error(
               Status::Error(400, "Option \"ignore_sensitive_content_restrictions\" can't be changed by the user"));
         }
@@ -716,9 +851,15 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       }
       break;
     case 'm':
+      if (set_integer_option("max_session_count", 1, 100)) {
+        return;
+      }
       if (set_integer_option("message_unload_delay", 60, 86400)) {
         return;
       }
+      if (set_integer_option("message_unload_threshold", 0, 1000000000)) {
+        return;
+      }
       break;
     case 'n':
       if (!is_bot &&
@@ -748,6 +889,9 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       }
       break;
     case 'p':
+      if (set_integer_option("prewarmed_connection_count", 0, 3)) {
+        return;
+      }
       if (set_boolean_option("prefer_ipv6")) {
         send_closure(td_->state_manager_, &StateManager::on_network_updated);
         return;
@@ -760,6 +904,9 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       }
       break;
     case 's':
+      if (set_string_option("shared_files_directory", [](Slice value) { return true; })) {
+        return;
+      }
       if (set_integer_option("storage_max_files_size")) {
         return;
       }
@@ -782,12 +929,21 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       }
       break;
     case 'u':
+      if (set_integer_option("update_coalescing_delay_ms", 0, 1000)) {
+        return;
+      }
       if (set_boolean_option("use_pfs")) {
         return;
       }
       if (set_boolean_option("use_quick_ack")) {
         return;
       }
+      if (set_boolean_option("use_shared_config")) {
+        return;
+      }
+      if (set_boolean_option("use_shared_inline_query_cache")) {
+        return;
+      }
       if (set_boolean_option("use_storage_optimizer")) {
         return;
       }
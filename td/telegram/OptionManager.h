@@ -6,12 +6,14 @@
 //
 #pragma once
 
+#include "td/telegram/OptionId.h"
 #include "td/telegram/td_api.h"
 
 #include "td/utils/common.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
 
+#include <array>
 #include <atomic>
 #include <memory>
 #include <utility>
@@ -49,6 +51,11 @@ class OptionManager {
 
   string get_option_string(Slice name, string default_value = "") const;
 
+  // lock-free access to cached values of frequently used options
+  bool get_option_boolean(OptionId option_id, bool default_value = false) const;
+
+  int64 get_option_integer(OptionId option_id, int64 default_value = 0) const;
+
   void on_update_server_time_difference();
 
   void get_option(const string &name, Promise<td_api::object_ptr<td_api::OptionValue>> &&promise);
@@ -64,8 +71,18 @@ class OptionManager {
   void get_current_state(vector<td_api::object_ptr<td_api::Update>> &updates) const;
 
  private:
+  struct CachedOptionValue {
+    enum class Type : int32 { Empty, Boolean, Integer, Other };
+    std::atomic<Type> type{Type::Empty};
+    std::atomic<int64> value{0};
+  };
+
   void set_option(Slice name, Slice value);
 
+  static Slice get_option_id_name(OptionId option_id);
+
+  void update_cached_option_value(Slice name, Slice value);
+
   void on_option_updated(Slice name);
 
   string get_option(Slice name) const;
@@ -89,6 +106,7 @@ class OptionManager {
   int32 current_scheduler_id_ = -1;
   unique_ptr<TsSeqKeyValue> options_;
   std::shared_ptr<KeyValueSyncInterface> option_pmc_;
+  std::array<CachedOptionValue, static_cast<size_t>(OptionId::Size)> cached_option_values_;
 
   std::atomic<double> last_sent_server_time_difference_{1e100};
 };
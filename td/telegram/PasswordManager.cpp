@@ -27,6 +27,7 @@
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
+#include "td/utils/Timer.h"
 
 namespace td {
 
@@ -43,13 +44,14 @@ static void hash_sha256(Slice data, Slice salt, MutableSlice dest) {
 
 BufferSlice PasswordManager::calc_password_hash(Slice password, Slice client_salt, Slice server_salt) {
   LOG(INFO) << "Begin password hash calculation";
+  Timer timer;
   BufferSlice buf(32);
   hash_sha256(password, client_salt, buf.as_mutable_slice());
   hash_sha256(buf.as_slice(), server_salt, buf.as_mutable_slice());
   BufferSlice hash(64);
-  pbkdf2_sha512(buf.as_slice(), client_salt, 100000, hash.as_mutable_slice());
+  secure_storage::calc_pbkdf2_sha512(buf.as_slice(), client_salt, hash.as_mutable_slice());
   hash_sha256(hash.as_slice(), server_salt, buf.as_mutable_slice());
-  LOG(INFO) << "End password hash calculation";
+  LOG(INFO) << "End password hash calculation" << timer;
   return buf;
 }
 
@@ -144,21 +146,49 @@ tl_object_ptr<telegram_api::InputCheckPasswordSRP> PasswordManager::get_input_ch
   return make_tl_object<telegram_api::inputCheckPasswordSRP>(id, BufferSlice(A), BufferSlice(M));
 }
 
-tl_object_ptr<telegram_api::InputCheckPasswordSRP> PasswordManager::get_input_check_password(
-    Slice password, const PasswordState &state) {
-  return get_input_check_password(password, state.current_client_salt, state.current_server_salt, state.current_srp_g,
-                                  state.current_srp_p, state.current_srp_B, state.current_srp_id);
+void PasswordManager::calc_input_check_password(string password, string client_salt, string server_salt, int32 g,
+                                                string p, string B, int64 id,
+                                                Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> promise) {
+  Scheduler::instance()->run_on_scheduler(
+      G()->get_slow_net_scheduler_id(),
+      [password = std::move(password), client_salt = std::move(client_salt), server_salt = std::move(server_salt), g,
+       p = std::move(p), B = std::move(B), id, promise = std::move(promise)](Unit) mutable {
+        promise.set_value(get_input_check_password(password, client_salt, server_salt, g, p, B, id));
+      });
+}
+
+void PasswordManager::do_get_input_check_password(string password, const PasswordState &state,
+                                                  Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> promise) {
+  if (password.empty()) {
+    return promise.set_value(make_tl_object<telegram_api::inputCheckPasswordEmpty>());
+  }
+
+  auto id = input_check_password_promises_.create(std::move(promise));
+  calc_input_check_password(
+      std::move(password), state.current_client_salt, state.current_server_salt, state.current_srp_g,
+      state.current_srp_p, state.current_srp_B, state.current_srp_id,
+      PromiseCreator::lambda([actor_id = actor_id(this),
+                              id](Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash) mutable {
+        send_closure(actor_id, &PasswordManager::on_get_input_check_password, id, std::move(r_hash));
+      }));
+}
+
+void PasswordManager::on_get_input_check_password(
+    uint64 id, Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash) {
+  auto promise = input_check_password_promises_.extract(id);
+  promise.set_result(std::move(r_hash));
 }
 
 void PasswordManager::get_input_check_password_srp(
     string password, Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> &&promise) {
-  do_get_state(PromiseCreator::lambda(
-      [promise = std::move(promise), password = std::move(password)](Result<PasswordState> r_state) mutable {
-        if (r_state.is_error()) {
-          return promise.set_error(r_state.move_as_error());
-        }
-        promise.set_value(PasswordManager::get_input_check_password(password, r_state.move_as_ok()));
-      }));
+  do_get_state(PromiseCreator::lambda([actor_id = actor_id(this), promise = std::move(promise),
+                                       password = std::move(password)](Result<PasswordState> r_state) mutable {
+    if (r_state.is_error()) {
+      return promise.set_error(r_state.move_as_error());
+    }
+    send_closure(actor_id, &PasswordManager::do_get_input_check_password, std::move(password), r_state.move_as_ok(),
+                 std::move(promise));
+  }));
 }
 
 void PasswordManager::set_password(string current_password, string new_password, string new_hint,
@@ -318,7 +348,20 @@ void PasswordManager::drop_temp_password() {
 
 void PasswordManager::do_create_temp_password(string password, int32 timeout, PasswordState &&password_state,
                                               Promise<TempPasswordState> promise) {
-  auto hash = get_input_check_password(password, password_state);
+  do_get_input_check_password(
+      std::move(password), password_state,
+      PromiseCreator::lambda([actor_id = actor_id(this), timeout, promise = std::move(promise)](
+                                 Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash) mutable {
+        if (r_hash.is_error()) {
+          return promise.set_error(r_hash.move_as_error());
+        }
+        send_closure(actor_id, &PasswordManager::do_create_temp_password_impl, r_hash.move_as_ok(), timeout,
+                     std::move(promise));
+      }));
+}
+
+void PasswordManager::do_create_temp_password_impl(tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash,
+                                                   int32 timeout, Promise<TempPasswordState> promise) {
   send_with_promise(G()->net_query_creator().create(telegram_api::account_getTmpPassword(std::move(hash), timeout)),
                     PromiseCreator::lambda([promise = std::move(promise)](Result<NetQueryPtr> r_query) mutable {
                       auto r_result = fetch_result<telegram_api::account_getTmpPassword>(std::move(r_query));
@@ -397,7 +440,21 @@ void PasswordManager::do_get_full_state(string password, PasswordState state, Pr
     return promise.set_value(std::move(result));
   }
 
-  auto hash = get_input_check_password(password, state);
+  do_get_input_check_password(
+      password, state,
+      PromiseCreator::lambda([actor_id = actor_id(this), password, state, promise = std::move(promise)](
+                                 Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash) mutable {
+        if (r_hash.is_error()) {
+          return promise.set_error(r_hash.move_as_error());
+        }
+        send_closure(actor_id, &PasswordManager::do_get_full_state_impl, std::move(password), std::move(state),
+                     r_hash.move_as_ok(), std::move(promise));
+      }));
+}
+
+void PasswordManager::do_get_full_state_impl(string password, PasswordState state,
+                                             tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash,
+                                             Promise<PasswordFullState> promise) {
   send_with_promise(G()->net_query_creator().create(telegram_api::account_getPasswordSettings(std::move(hash))),
                     PromiseCreator::lambda([promise = std::move(promise), state = std::move(state),
                                             password](Result<NetQueryPtr> r_query) mutable {
@@ -733,7 +790,22 @@ void PasswordManager::do_update_password_settings_impl(UpdateSettings update_set
                                                        PasswordPrivateState private_state, Promise<bool> promise) {
   TRY_RESULT_PROMISE(promise, new_settings,
                      get_password_input_settings(update_settings, state.has_password, state.new_state, &private_state));
-  auto current_hash = get_input_check_password(state.has_password ? update_settings.current_password : Slice(), state);
+  do_get_input_check_password(
+      state.has_password ? std::move(update_settings.current_password) : string(), state,
+      PromiseCreator::lambda([actor_id = actor_id(this), new_settings = std::move(new_settings),
+                              promise = std::move(promise)](
+                                 Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash) mutable {
+        if (r_hash.is_error()) {
+          return promise.set_error(r_hash.move_as_error());
+        }
+        send_closure(actor_id, &PasswordManager::do_update_password_settings_send, std::move(new_settings),
+                     r_hash.move_as_ok(), std::move(promise));
+      }));
+}
+
+void PasswordManager::do_update_password_settings_send(PasswordInputSettings new_settings,
+                                                       tl_object_ptr<telegram_api::InputCheckPasswordSRP> current_hash,
+                                                       Promise<bool> promise) {
   auto query = G()->net_query_creator().create(
       telegram_api::account_updatePasswordSettings(std::move(current_hash), std::move(new_settings)));
 
@@ -881,6 +953,10 @@ void PasswordManager::start_up() {
 void PasswordManager::hangup() {
   container_.for_each(
       [](auto id, Promise<NetQueryPtr> &promise) { promise.set_error(Global::request_aborted_error()); });
+  input_check_password_promises_.for_each(
+      [](auto id, Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> &promise) {
+        promise.set_error(Global::request_aborted_error());
+      });
   stop();
 }
 
@@ -65,6 +65,11 @@ class PasswordManager final : public NetQueryCallback {
                                                                                      Slice server_salt, int32 g,
                                                                                      Slice p, Slice B, int64 id);
 
+  // calculates the hash on the slow network scheduler; the promise is set on its thread
+  static void calc_input_check_password(string password, string client_salt, string server_salt, int32 g, string p,
+                                        string B, int64 id,
+                                        Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> promise);
+
   static Result<PasswordInputSettings> get_password_input_settings(string new_password, string new_hint,
                                                                    const NewPasswordState &state);
 
@@ -174,8 +179,9 @@ class PasswordManager final : public NetQueryCallback {
   static Result<BufferSlice> calc_password_srp_hash(Slice password, Slice client_salt, Slice server_salt, int32 g,
                                                     Slice p);
 
-  static tl_object_ptr<telegram_api::InputCheckPasswordSRP> get_input_check_password(Slice password,
-                                                                                     const PasswordState &state);
+  void do_get_input_check_password(string password, const PasswordState &state,
+                                   Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> promise);
+  void on_get_input_check_password(uint64 id, Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash);
 
   static Result<PasswordInputSettings> get_password_input_settings(const UpdateSettings &update_settings,
                                                                    bool has_password, const NewPasswordState &state,
@@ -187,15 +193,23 @@ class PasswordManager final : public NetQueryCallback {
   void do_update_password_settings(UpdateSettings update_settings, PasswordFullState full_state, Promise<bool> promise);
   void do_update_password_settings_impl(UpdateSettings update_settings, PasswordState state,
                                         PasswordPrivateState private_state, Promise<bool> promise);
+  void do_update_password_settings_send(PasswordInputSettings new_settings,
+                                        tl_object_ptr<telegram_api::InputCheckPasswordSRP> current_hash,
+                                        Promise<bool> promise);
   void on_get_code_length(int32 code_length);
   void do_get_state(Promise<PasswordState> promise);
   void get_full_state(string password, Promise<PasswordFullState> promise);
   void do_get_secure_secret(bool allow_recursive, string password, Promise<secure_storage::Secret> promise);
   void do_get_full_state(string password, PasswordState state, Promise<PasswordFullState> promise);
+  void do_get_full_state_impl(string password, PasswordState state,
+                              tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash,
+                              Promise<PasswordFullState> promise);
   void cache_secret(secure_storage::Secret secret);
 
   void do_create_temp_password(string password, int32 timeout, PasswordState &&password_state,
                                Promise<TempPasswordState> promise);
+  void do_create_temp_password_impl(tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash, int32 timeout,
+                                    Promise<TempPasswordState> promise);
   void on_finish_create_temp_password(Result<TempPasswordState> result, bool dummy);
 
   void on_result(NetQueryPtr query) final;
@@ -205,6 +219,7 @@ class PasswordManager final : public NetQueryCallback {
   void hangup() final;
 
   Container<Promise<NetQueryPtr>> container_;
+  Container<Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>>> input_check_password_promises_;
   void send_with_promise(NetQueryPtr query, Promise<NetQueryPtr> promise);
 };
 
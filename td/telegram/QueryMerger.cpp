@@ -25,6 +25,12 @@ void QueryMerger::add_query(int64 query_id, Promise<Unit> &&promise) {
     return;
   }
   pending_queries_.push(query_id);
+  if (merge_delay_ > 0.0 && pending_queries_.size() < max_merged_query_count_) {
+    if (!has_timeout()) {
+      set_timeout_in(merge_delay_);
+    }
+    return;
+  }
   loop();
 }
 
@@ -74,6 +80,13 @@ void QueryMerger::loop() {
     }
   }
   if (!query_ids.empty()) {
+    if (has_timeout()) {
+      // wait for more queries to fill the batch
+      for (auto query_id : query_ids) {
+        pending_queries_.push(query_id);
+      }
+      return;
+    }
     send_query(std::move(query_ids));
   }
 }
@@ -29,6 +29,11 @@ class QueryMerger final : public Actor {
     merge_function_ = std::move(merge_function);
   }
 
+  // incomplete batches of queries are sent no earlier than merge_delay seconds after the first query was added
+  void set_merge_delay(double merge_delay) {
+    merge_delay_ = merge_delay;
+  }
+
   void add_query(int64 query_id, Promise<Unit> &&promise);
 
  private:
@@ -39,6 +44,7 @@ class QueryMerger final : public Actor {
   size_t query_count_ = 0;
   size_t max_concurrent_query_count_;
   size_t max_merged_query_count_;
+  double merge_delay_ = 0.0;
 
   MergeFunction merge_function_;
   std::queue<int64> pending_queries_;
@@ -0,0 +1,107 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/RequestStatistics.h"
+
+#include "td/telegram/td_api.h"
+#include "td/telegram/td_api.hpp"
+
+#include "td/utils/logging.h"
+#include "td/utils/ThreadLocalStorage.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace td {
+
+namespace {
+
+struct RequestStatisticsEntry {
+  uint64 request_count = 0;
+  uint64 error_count = 0;
+  RequestStatistics::Histogram latency{};
+};
+
+struct ThreadRequestStatistics {
+  std::mutex mutex;
+  vector<RequestStatisticsEntry> entries;
+};
+
+ThreadLocalStorage<ThreadRequestStatistics> &get_thread_request_statistics() {
+  static ThreadLocalStorage<ThreadRequestStatistics> statistics;
+  return statistics;
+}
+
+void add_to_histogram(RequestStatistics::Histogram &histogram, double duration) {
+  size_t pos = 0;
+  double max_duration = 1e-6;
+  while (pos + 1 < histogram.size() && duration >= max_duration) {
+    pos++;
+    max_duration *= 2;
+  }
+  histogram[pos]++;
+}
+
+}  // namespace
+
+std::atomic<bool> RequestStatistics::is_enabled_{false};
+
+void RequestStatistics::set_enabled(bool is_enabled) {
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+void RequestStatistics::on_request_finished(int32 function_index, bool is_error, double latency) {
+  CHECK(0 <= function_index && function_index < td_api::FUNCTION_COUNT);
+  auto &statistics = get_thread_request_statistics().get();
+  std::lock_guard<std::mutex> lock(statistics.mutex);
+  if (statistics.entries.empty()) {
+    statistics.entries.resize(td_api::FUNCTION_COUNT);
+  }
+  auto &entry = statistics.entries[function_index];
+  entry.request_count++;
+  if (is_error) {
+    entry.error_count++;
+  }
+  add_to_histogram(entry.latency, latency);
+}
+
+vector<RequestStatistics::Entry> RequestStatistics::get_statistics() {
+  vector<Entry> entries(td_api::FUNCTION_COUNT);
+  get_thread_request_statistics().for_each([&entries](ThreadRequestStatistics &statistics) {
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    for (size_t function_index = 0; function_index < statistics.entries.size(); function_index++) {
+      const auto &thread_entry = statistics.entries[function_index];
+      auto &entry = entries[function_index];
+      entry.request_count += thread_entry.request_count;
+      entry.error_count += thread_entry.error_count;
+      for (size_t i = 0; i < HISTOGRAM_SIZE; i++) {
+        entry.latency[i] += thread_entry.latency[i];
+      }
+    }
+  });
+
+  vector<Entry> result;
+  for (size_t function_index = 0; function_index < entries.size(); function_index++) {
+    auto &entry = entries[function_index];
+    if (entry.request_count == 0) {
+      continue;
+    }
+    entry.request_type = td_api::get_function_name(static_cast<int32>(function_index));
+    result.push_back(std::move(entry));
+  }
+  std::sort(result.begin(), result.end(),
+            [](const Entry &lhs, const Entry &rhs) { return lhs.request_count > rhs.request_count; });
+  return result;
+}
+
+void RequestStatistics::clear() {
+  get_thread_request_statistics().for_each([](ThreadRequestStatistics &statistics) {
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    statistics.entries.clear();
+  });
+}
+
+}  // namespace td
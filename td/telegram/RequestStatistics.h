@@ -0,0 +1,50 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <array>
+#include <atomic>
+
+namespace td {
+
+// Collects statistics about completed TDLib requests, grouped by request type
+// Collection is disabled by default and costs a relaxed atomic load per request when disabled
+class RequestStatistics {
+ public:
+  static constexpr size_t HISTOGRAM_SIZE = 24;
+
+  // i-th element contains number of latencies in [2^(i-1), 2^i) microseconds
+  // the first element contains number of latencies less than 1 microsecond, the last element contains all longer latencies
+  using Histogram = std::array<uint64, HISTOGRAM_SIZE>;
+
+  struct Entry {
+    string request_type;
+    uint64 request_count = 0;
+    uint64 error_count = 0;
+    Histogram latency{};
+  };
+
+  static void set_enabled(bool is_enabled);
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // function_index is the value returned by td_api::get_function_index
+  static void on_request_finished(int32 function_index, bool is_error, double latency);
+
+  static vector<Entry> get_statistics();
+
+  static void clear();
+
+ private:
+  static std::atomic<bool> is_enabled_;
+};
+
+}  // namespace td
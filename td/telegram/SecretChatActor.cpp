@@ -555,6 +555,14 @@ void SecretChatActor::run_fill_gaps() {
   }
 
   if (pending_inbound_messages_.empty()) {
+    if (gap_start_time_ != 0.0) {
+      auto gap_wait_time = Time::now() - gap_start_time_;
+      gap_start_time_ = 0.0;
+      total_gap_wait_time_ += gap_wait_time;
+      filled_gap_count_++;
+      LOG(INFO) << "Gap in inbound messages was filled in " << gap_wait_time << " seconds; "
+                << tag("filled_gap_count", filled_gap_count_) << tag("total_gap_wait_time", total_gap_wait_time_);
+    }
     return;
   }
 
@@ -788,7 +796,8 @@ Result<std::tuple<uint64, BufferSlice, int32>> SecretChatActor::decrypt(BufferSl
   int32 mtproto_version = -1;
   Result<mtproto::Transport::ReadResult> r_read_result;
   for (size_t i = 0; i < versions.size(); i++) {
-    encrypted_message_copy = encrypted_message.copy();
+    // the message is decrypted directly into a new buffer, so the original message is left intact for other tries
+    encrypted_message_copy = BufferSlice(encrypted_message.size());
     data = encrypted_message_copy.as_mutable_slice();
     CHECK(is_aligned_pointer<4>(data.data()));
 
@@ -797,7 +806,7 @@ Result<std::tuple<uint64, BufferSlice, int32>> SecretChatActor::decrypt(BufferSl
     mtproto_version = versions[i];
     info.version = mtproto_version;
     info.is_creator = auth_state_.x == 0;
-    r_read_result = mtproto::Transport::read(data, *auth_key, &info);
+    r_read_result = mtproto::Transport::read(encrypted_message.as_slice(), data, *auth_key, &info);
     if (i + 1 != versions.size() && r_read_result.is_error()) {
       if (config_state_.his_layer >= static_cast<int32>(SecretChatLayer::Mtproto2)) {
         LOG(WARNING) << tag("mtproto", mtproto_version) << " decryption failed " << r_read_result.error();
@@ -1174,6 +1183,9 @@ void SecretChatActor::do_inbound_message_decrypted_pending(unique_ptr<log_event:
   LOG(INFO) << "Inbound PENDING secret message start " << tag("log_event_id", log_event_id) << tag("message", *message);
 
   auto seq_no = message->decrypted_message_layer->out_seq_no_ / 2;
+  if (pending_inbound_messages_.empty()) {
+    gap_start_time_ = Time::now();
+  }
   pending_inbound_messages_[seq_no] = std::move(message);
 }
 
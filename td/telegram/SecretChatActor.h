@@ -565,6 +565,9 @@ class SecretChatActor final : public NetQueryCallback {
   Container<InboundMessageState> inbound_message_states_;
 
   std::map<int32, unique_ptr<log_event::InboundSecretMessage>> pending_inbound_messages_;
+  double gap_start_time_ = 0.0;       // time when the current gap in inbound messages was found
+  double total_gap_wait_time_ = 0.0;  // total time spent waiting for gaps to be filled
+  int32 filled_gap_count_ = 0;
 
   Result<std::tuple<uint64, BufferSlice, int32>> decrypt(BufferSlice &encrypted_message);
 
@@ -14,6 +14,9 @@
 #include "td/utils/Random.h"
 #include "td/utils/SharedSlice.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Timer.h"
+
+#include <mutex>
 
 namespace td {
 namespace secure_storage {
@@ -38,10 +41,47 @@ static AesCbcState calc_aes_cbc_state_hash(Slice hash) {
   return AesCbcState{key, iv};
 }
 
+void calc_pbkdf2_sha512(Slice password, Slice salt, MutableSlice dest) {
+  CHECK(dest.size() == 64);
+  struct CacheEntry {
+    UInt256 key;
+    UInt<512> hash;
+  };
+  static constexpr size_t MAX_CACHE_SIZE = 8;
+  static std::mutex cache_mutex;
+  static vector<CacheEntry> cache;  // the most recently used entry is the last
+
+  CacheEntry entry;
+  sha256(PSLICE() << password.size() << ' ' << password << salt, as_mutable_slice(entry.key));
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    for (size_t i = 0; i < cache.size(); i++) {
+      if (cache[i].key == entry.key) {
+        entry = cache[i];
+        cache.erase(cache.begin() + i);
+        cache.push_back(entry);
+        dest.copy_from(as_slice(entry.hash));
+        return;
+      }
+    }
+  }
+
+  Timer timer;
+  pbkdf2_sha512(password, salt, 100000, as_mutable_slice(entry.hash));
+  LOG(INFO) << "Calculated PBKDF2 hash " << timer;
+  dest.copy_from(as_slice(entry.hash));
+
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  if (cache.size() == MAX_CACHE_SIZE) {
+    cache.erase(cache.begin());
+  }
+  cache.push_back(entry);
+}
+
 AesCbcState calc_aes_cbc_state_pbkdf2(Slice secret, Slice salt) {
   LOG(INFO) << "Begin AES CBC state calculation";
   UInt<512> hash;
-  pbkdf2_sha512(secret, salt, 100000, as_mutable_slice(hash));
+  calc_pbkdf2_sha512(secret, salt, as_mutable_slice(hash));
   return calc_aes_cbc_state_hash(as_slice(hash));
 }
 
@@ -95,6 +95,10 @@ class ConcatDataView final : public DataView {
   const DataView &right_;
 };
 
+// PBKDF2-HMAC-SHA512 with 100000 iterations and 64-byte result
+// a few last results are cached, because the same password is usually checked many times and each calculation is slow
+void calc_pbkdf2_sha512(Slice password, Slice salt, MutableSlice dest);
+
 AesCbcState calc_aes_cbc_state_pbkdf2(Slice secret, Slice salt);
 AesCbcState calc_aes_cbc_state_sha512(Slice seed);
 Result<ValueHash> calc_value_hash(const DataView &data_view);
@@ -301,7 +301,7 @@ class MultiSequenceDispatcherImpl final : public MultiSequenceDispatcher {
     node.net_query_ref = node.net_query.get_weak();
     node.callback = std::move(callback);
     scheduler_.create_task(chain_ids, std::move(node));
-    loop();
+    schedule_flush();
   }
 
  private:
@@ -316,6 +316,7 @@ class MultiSequenceDispatcherImpl final : public MultiSequenceDispatcher {
     }
   };
   ChainScheduler<Node> scheduler_;
+  bool is_flush_scheduled_ = false;
 
   using TaskId = ChainScheduler<Node>::TaskId;
 
@@ -373,7 +374,7 @@ class MultiSequenceDispatcherImpl final : public MultiSequenceDispatcher {
       VLOG(net_query) << "Resend " << query;
       query->resend();
       do_resend(task_id, node, std::move(query));
-      loop();
+      schedule_flush();
       return;
     }
     node.net_query = std::move(query);
@@ -386,7 +387,7 @@ class MultiSequenceDispatcherImpl final : public MultiSequenceDispatcher {
       auto query = std::move(node.net_query);
       scheduler_.finish_task(task_id);
       send_closure_later(G()->td(), &Td::on_result, std::move(query));
-      loop();
+      schedule_flush();
       return;
     }
     auto promise = promise_send_closure(actor_shared(this, task_id), &MultiSequenceDispatcherImpl::on_resend);
@@ -401,7 +402,7 @@ class MultiSequenceDispatcherImpl final : public MultiSequenceDispatcher {
     } else {
       do_resend(task_id, node, r_query.move_as_ok());
     }
-    loop();
+    schedule_flush();
   }
 
   void do_resend(TaskId task_id, Node &node, NetQueryPtr &&query) {
@@ -416,7 +417,17 @@ class MultiSequenceDispatcherImpl final : public MultiSequenceDispatcher {
     }
   }
 
+  // queries, which became ready to be sent while handling a burst of events, are dispatched together,
+  // so the whole resent suffix of a chain can be packed by Session into one container
+  void schedule_flush() {
+    if (!is_flush_scheduled_) {
+      is_flush_scheduled_ = true;
+      yield();
+    }
+  }
+
   void loop() final {
+    is_flush_scheduled_ = false;
     flush_pending_queries();
   }
 
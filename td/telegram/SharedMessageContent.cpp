@@ -0,0 +1,50 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/SharedMessageContent.h"
+
+#include <atomic>
+
+namespace td {
+
+static std::atomic<int64> shared_message_content_count{0};
+static std::atomic<int64> saved_message_content_copy_count{0};
+
+void SharedMessageContent::add_reference() {
+  if (content_ == nullptr) {
+    return;
+  }
+  if (content_->ref_count_ == 1) {
+    shared_message_content_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  content_->ref_count_++;
+  saved_message_content_copy_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SharedMessageContent::remove_reference() {
+  if (content_ == nullptr) {
+    return;
+  }
+  CHECK(content_->ref_count_ > 0);
+  content_->ref_count_--;
+  if (content_->ref_count_ == 0) {
+    delete content_;
+    return;
+  }
+  if (content_->ref_count_ == 1) {
+    shared_message_content_count.fetch_sub(1, std::memory_order_relaxed);
+  }
+  saved_message_content_copy_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+SharedMessageContent::Statistics SharedMessageContent::get_statistics() {
+  Statistics statistics;
+  statistics.shared_content_count = shared_message_content_count.load(std::memory_order_relaxed);
+  statistics.saved_copy_count = saved_message_content_copy_count.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+}  // namespace td
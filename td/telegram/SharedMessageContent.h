@@ -0,0 +1,145 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/MessageContentType.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+
+#include <cstddef>
+
+namespace td {
+
+// Do not forget to update merge_message_contents when one of the inheritors of this class changes
+class MessageContent {
+ public:
+  MessageContent() = default;
+  // the reference counter belongs to the object and is never copied or moved
+  MessageContent(const MessageContent &) {
+  }
+  MessageContent &operator=(const MessageContent &) {
+    return *this;
+  }
+  MessageContent(MessageContent &&) {
+  }
+  MessageContent &operator=(MessageContent &&) {
+    return *this;
+  }
+
+  virtual MessageContentType get_type() const = 0;
+  virtual ~MessageContent() = default;
+
+ private:
+  friend class SharedMessageContent;
+
+  // number of SharedMessageContent objects owning the content; all of them must be used from the same thread
+  mutable int32 ref_count_ = 0;
+};
+
+// returns a copy of a content, which can be shared; defined in MessageContent.cpp
+unique_ptr<MessageContent> copy_message_content(const MessageContent *content);
+
+// Reference-counted immutable message content, which can be shared between messages and is copied on write
+class SharedMessageContent {
+ public:
+  struct Statistics {
+    int64 shared_content_count = 0;  // number of message contents owned by more than one message
+    int64 saved_copy_count = 0;      // number of message content copies avoided through sharing
+  };
+
+  SharedMessageContent() = default;
+
+  SharedMessageContent(std::nullptr_t) {
+  }
+
+  template <class T>
+  SharedMessageContent(unique_ptr<T> &&content) : content_(content.release()) {
+    if (content_ != nullptr) {
+      CHECK(content_->ref_count_ == 0);
+      content_->ref_count_ = 1;
+    }
+  }
+
+  SharedMessageContent(const SharedMessageContent &other) : content_(other.content_) {
+    add_reference();
+  }
+
+  SharedMessageContent &operator=(const SharedMessageContent &other) {
+    if (content_ != other.content_) {
+      remove_reference();
+      content_ = other.content_;
+      add_reference();
+    }
+    return *this;
+  }
+
+  SharedMessageContent(SharedMessageContent &&other) noexcept : content_(other.content_) {
+    other.content_ = nullptr;
+  }
+
+  SharedMessageContent &operator=(SharedMessageContent &&other) noexcept {
+    if (this != &other) {
+      remove_reference();
+      content_ = other.content_;
+      other.content_ = nullptr;
+    }
+    return *this;
+  }
+
+  ~SharedMessageContent() {
+    remove_reference();
+  }
+
+  const MessageContent *get() const {
+    return content_;
+  }
+
+  const MessageContent *operator->() const {
+    return content_;
+  }
+
+  const MessageContent &operator*() const {
+    return *content_;
+  }
+
+  // returns the content, which can be changed, copying it first if it is shared with other messages
+  MessageContent *get_mutable() {
+    if (content_ != nullptr && content_->ref_count_ > 1) {
+      *this = SharedMessageContent(copy_message_content(content_));
+    }
+    return content_;
+  }
+
+  bool is_shared() const {
+    return content_ != nullptr && content_->ref_count_ > 1;
+  }
+
+  void reset() {
+    remove_reference();
+    content_ = nullptr;
+  }
+
+  static Statistics get_statistics();
+
+ private:
+  MessageContent *content_ = nullptr;
+
+  void add_reference();
+
+  void remove_reference();
+};
+
+inline bool operator==(const SharedMessageContent &content, std::nullptr_t) {
+  return content.get() == nullptr;
+}
+
+inline bool operator!=(const SharedMessageContent &content, std::nullptr_t) {
+  return content.get() != nullptr;
+}
+
+}  // namespace td
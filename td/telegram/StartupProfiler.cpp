@@ -0,0 +1,68 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/StartupProfiler.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/format.h"
+#include "td/utils/Time.h"
+
+#include <utility>
+
+namespace td {
+
+StartupProfiler::StartupProfiler() : start_time_(Time::now()) {
+}
+
+bool StartupProfiler::has_phase(Slice name) const {
+  for (auto &phase : phases_) {
+    if (phase.name == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void StartupProfiler::add_phase(string name, double start_time, int64 count, int64 size) {
+  add_phase(std::move(name), start_time, Time::now() - start_time, count, size);
+}
+
+void StartupProfiler::add_phase(string name, double start_time, double duration, int64 count, int64 size) {
+  Phase phase;
+  phase.name = std::move(name);
+  phase.start_time = start_time - start_time_;
+  phase.duration = duration;
+  phase.count = count;
+  phase.size = size;
+  phases_.push_back(std::move(phase));
+}
+
+td_api::object_ptr<td_api::updateStartupTimeline> StartupProfiler::get_update_startup_timeline_object() const {
+  return td_api::make_object<td_api::updateStartupTimeline>(
+      transform(phases_,
+                [](const Phase &phase) {
+                  return td_api::make_object<td_api::startupPhase>(phase.name, phase.start_time, phase.duration,
+                                                                   phase.count, phase.size);
+                }),
+      Time::now() - start_time_);
+}
+
+StringBuilder &operator<<(StringBuilder &string_builder, const StartupProfiler &profiler) {
+  string_builder << "Initialization has finished in " << format::as_time(Time::now() - profiler.start_time_) << ':';
+  for (auto &phase : profiler.phases_) {
+    string_builder << "\n[" << format::as_time(phase.start_time) << "] " << phase.name << ": "
+                   << format::as_time(phase.duration);
+    if (phase.count != 0) {
+      string_builder << ", " << phase.count << " objects";
+    }
+    if (phase.size != 0) {
+      string_builder << ", " << format::as_size(phase.size);
+    }
+  }
+  return string_builder;
+}
+
+}  // namespace td
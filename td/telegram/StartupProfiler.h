@@ -0,0 +1,52 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/td_api.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/StringBuilder.h"
+
+namespace td {
+
+// Records the timeline of TDLib initialization from the call to setTdlibParameters
+class StartupProfiler {
+ public:
+  StartupProfiler();
+
+  double get_start_time() const {
+    return start_time_;
+  }
+
+  bool has_phase(Slice name) const;
+
+  // the phase has started at start_time and has finished now
+  void add_phase(string name, double start_time, int64 count = 0, int64 size = 0);
+
+  void add_phase(string name, double start_time, double duration, int64 count, int64 size);
+
+  td_api::object_ptr<td_api::updateStartupTimeline> get_update_startup_timeline_object() const;
+
+ private:
+  struct Phase {
+    string name;
+    double start_time = 0.0;
+    double duration = 0.0;
+    int64 count = 0;
+    int64 size = 0;
+  };
+
+  double start_time_ = 0.0;
+  vector<Phase> phases_;
+
+  friend StringBuilder &operator<<(StringBuilder &string_builder, const StartupProfiler &profiler);
+};
+
+StringBuilder &operator<<(StringBuilder &string_builder, const StartupProfiler &profiler);
+
+}  // namespace td
@@ -34,7 +34,7 @@ void StateManager::on_network(NetType new_network_type) {
 }
 
 void StateManager::do_on_network(NetType new_network_type, bool inc_generation) {
-  bool new_network_flag = new_network_type != NetType::None;
+  bool new_network_flag = new_network_type != NetType::None && !is_hibernated_;
   if (network_flag_ != new_network_flag) {
     network_flag_ = new_network_flag;
     loop();
@@ -62,8 +62,17 @@ void StateManager::on_logging_out(bool is_logging_out) {
   notify_flag(Flag::LoggingOut);
 }
 
+void StateManager::on_hibernate(bool is_hibernated) {
+  if (is_hibernated_ == is_hibernated) {
+    return;
+  }
+  is_hibernated_ = is_hibernated;
+  // network connections are closed while the client hibernates and are reopened after wake up
+  do_on_network(network_type_, true /*inc_generation*/);
+}
+
 void StateManager::add_callback(unique_ptr<Callback> callback) {
-  if (callback->on_network(network_type_, network_generation_) && callback->on_online(online_flag_) &&
+  if (callback->on_network(get_network_type(), network_generation_) && callback->on_online(online_flag_) &&
       callback->on_state(get_real_state()) && callback->on_logging_out(is_logging_out_)) {
     callbacks_.push_back(std::move(callback));
   }
@@ -80,6 +89,10 @@ void StateManager::close() {
   stop();
 }
 
+NetType StateManager::get_network_type() const {
+  return is_hibernated_ ? NetType::None : network_type_;
+}
+
 ConnectionState StateManager::get_real_state() const {
   if (!network_flag_) {
     return ConnectionState::WaitingForNetwork;
@@ -105,7 +118,7 @@ void StateManager::notify_flag(Flag flag) {
         case Flag::State:
           return (*it)->on_state(flush_state_);
         case Flag::Network:
-          return (*it)->on_network(network_type_, network_generation_);
+          return (*it)->on_network(get_network_type(), network_generation_);
         case Flag::LoggingOut:
           return (*it)->on_logging_out(is_logging_out_);
         default:
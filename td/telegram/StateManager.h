@@ -55,6 +55,8 @@ class StateManager final : public mtproto::ConnectionManager {
 
   void on_logging_out(bool is_logging_out);
 
+  void on_hibernate(bool is_hibernated);
+
   void add_callback(unique_ptr<Callback> net_callback);
 
   void wait_first_sync(Promise<> promise);
@@ -70,6 +72,7 @@ class StateManager final : public mtproto::ConnectionManager {
   bool online_flag_ = false;
   bool use_proxy_ = false;
   bool is_logging_out_ = false;
+  bool is_hibernated_ = false;
 
   static constexpr double UP_DELAY = 0.05;
   static constexpr double DOWN_DELAY = 0.3;
@@ -96,6 +99,8 @@ class StateManager final : public mtproto::ConnectionManager {
   void on_network_soft();
   void do_on_network(NetType new_network_type, bool inc_generation);
 
+  NetType get_network_type() const;
+
   ConnectionState get_real_state() const;
 };
 
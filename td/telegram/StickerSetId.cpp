@@ -20,6 +20,10 @@ void StickerSetId::store(LogEventStorerUnsafe &storer) const {
   storer.context()->td().get_actor_unsafe()->stickers_manager_->store_sticker_set_id(*this, storer);
 }
 
+void StickerSetId::store(LogEventStorerBounded &storer) const {
+  storer.context()->td().get_actor_unsafe()->stickers_manager_->store_sticker_set_id(*this, storer);
+}
+
 void StickerSetId::parse(LogEventParser &parser) {
   parser.context()->td().get_actor_unsafe()->stickers_manager_->parse_sticker_set_id(*this, parser);
 }
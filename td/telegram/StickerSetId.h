@@ -47,6 +47,8 @@ class StickerSetId {
 
   void store(LogEventStorerUnsafe &storer) const;
 
+  void store(LogEventStorerBounded &storer) const;
+
   void parse(LogEventParser &parser);
 };
 
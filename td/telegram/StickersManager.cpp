@@ -1739,6 +1739,7 @@ void StickersManager::init() {
   }
   LOG(INFO) << "Init StickersManager";
   is_inited_ = true;
+  auto init_start_time = Time::now();
 
   {
     auto &sticker_set = add_special_sticker_set(SpecialStickerSetType::animated_emoji());
@@ -1808,6 +1809,8 @@ void StickersManager::init() {
   G()->td_db()->get_binlog_pmc()->erase("animated_dice_sticker_set");         // legacy
   td_->option_manager_->set_option_empty("animated_dice_sticker_set_name");   // legacy
   td_->option_manager_->set_option_empty("animated_emoji_sticker_set_name");  // legacy
+
+  td_->add_startup_phase("StickersManager::init", init_start_time);
 }
 
 td_api::object_ptr<td_api::emojiReaction> StickersManager::get_emoji_reaction_object(const string &emoji) const {
@@ -2677,7 +2680,7 @@ tl_object_ptr<td_api::stickerSetInfo> StickersManager::get_sticker_set_info_obje
     vector<FileId> regular_sticker_ids;
     vector<FileId> premium_sticker_ids;
     std::tie(regular_sticker_ids, premium_sticker_ids) = split_stickers_by_premium(sticker_set);
-    auto is_premium = td_->option_manager_->get_option_boolean("is_premium");
+    auto is_premium = td_->option_manager_->get_option_boolean(OptionId::IsPremium);
     size_t max_premium_stickers = is_premium ? covers_limit : 1;
     if (premium_sticker_ids.size() > max_premium_stickers) {
       premium_sticker_ids.resize(max_premium_stickers);
@@ -3994,6 +3997,7 @@ StickerSetId StickersManager::on_get_messages_sticker_set(StickerSetId sticker_s
   }
 
   if (!is_bot) {
+    sticker_set_generation_++;
     s->emoji_stickers_map_.clear();
     s->sticker_emojis_map_.clear();
     s->keyword_stickers_map_.clear();
@@ -4442,6 +4446,9 @@ void StickersManager::on_get_installed_sticker_sets(StickerType sticker_type,
   for (auto &set : stickers->sets_) {
     debug_hashes.push_back(set->hash_);
     debug_sticker_set_ids.push_back(set->id_);
+    const StickerSet *old_sticker_set = get_sticker_set(StickerSetId(set->id_));
+    bool was_inited = old_sticker_set != nullptr && old_sticker_set->is_inited_;
+    int32 old_hash = was_inited ? old_sticker_set->hash_ : 0;
     StickerSetId set_id = on_get_sticker_set(std::move(set), false, "on_get_installed_sticker_sets");
     if (!set_id.is_valid()) {
       continue;
@@ -4461,7 +4468,9 @@ void StickersManager::on_get_installed_sticker_sets(StickerType sticker_type,
     }
     update_sticker_set(sticker_set, "on_get_installed_sticker_sets");
 
-    if (!sticker_set->is_archived_ && !sticker_set->is_loaded_) {
+    // stickers of unchanged sticker sets are loaded from database only on the first access to them
+    if (!sticker_set->is_archived_ && !sticker_set->is_loaded_ &&
+        (!was_inited || old_hash != sticker_set->hash_ || sticker_set->was_loaded_)) {
       sets_to_load.push_back(set_id);
     }
   }
@@ -4539,11 +4548,62 @@ void StickersManager::find_sticker_set_stickers(const StickerSet *sticker_set, c
   }
 }
 
+const StickersManager::InstalledStickerSetIndex &StickersManager::get_installed_sticker_set_index(
+    StickerType sticker_type) {
+  auto type = static_cast<int32>(sticker_type);
+  auto &index = installed_sticker_set_indexes_[type];
+  if (index.is_inited_ && index.sticker_set_generation_ == sticker_set_generation_ &&
+      index.sticker_set_ids_ == installed_sticker_set_ids_[type]) {
+    return index;
+  }
+
+  LOG(INFO) << "Rebuild index of installed " << sticker_type << " sticker sets";
+  index.is_inited_ = true;
+  index.sticker_set_generation_ = sticker_set_generation_;
+  index.sticker_set_ids_ = installed_sticker_set_ids_[type];
+  index.emoji_sticker_set_ids_.clear();
+  index.keyword_sticker_set_ids_.clear();
+  for (auto sticker_set_id : index.sticker_set_ids_) {
+    const StickerSet *sticker_set = get_sticker_set(sticker_set_id);
+    if (sticker_set == nullptr || !sticker_set->was_loaded_) {
+      continue;
+    }
+    for (auto &it : sticker_set->emoji_stickers_map_) {
+      index.emoji_sticker_set_ids_[it.first].push_back(sticker_set_id);
+    }
+    for (auto &it : get_sticker_set_keywords(sticker_set)) {
+      index.keyword_sticker_set_ids_[it.first].push_back(sticker_set_id);
+    }
+  }
+  return index;
+}
+
+FlatHashSet<StickerSetId, StickerSetIdHash> StickersManager::find_installed_sticker_sets(StickerType sticker_type,
+                                                                                        const vector<string> &emojis,
+                                                                                        const string &query) {
+  const auto &index = get_installed_sticker_set_index(sticker_type);
+  FlatHashSet<StickerSetId, StickerSetIdHash> result;
+  for (auto &emoji : emojis) {
+    auto it = index.emoji_sticker_set_ids_.find(emoji);
+    if (it != index.emoji_sticker_set_ids_.end()) {
+      result.insert(it->second.begin(), it->second.end());
+    }
+  }
+  if (!query.empty()) {
+    for (auto it = index.keyword_sticker_set_ids_.lower_bound(query);
+         it != index.keyword_sticker_set_ids_.end() && begins_with(it->first, query); ++it) {
+      result.insert(it->second.begin(), it->second.end());
+    }
+  }
+  return result;
+}
+
 bool StickersManager::can_find_sticker_by_query(FileId sticker_id, const vector<string> &emojis,
                                                 const string &query) const {
   const Sticker *s = get_sticker(sticker_id);
   CHECK(s != nullptr);
-  if (td::contains(emojis, remove_emoji_modifiers(s->alt_))) {
+  if (std::any_of(emojis.begin(), emojis.end(),
+                  [&s](const string &emoji) { return is_emoji_without_modifiers_equal(s->alt_, emoji); })) {
     // fast path
     return true;
   }
@@ -4783,8 +4843,15 @@ vector<FileId> StickersManager::get_stickers(StickerType sticker_type, string qu
   } else {
     auto prepared_query = utf8_prepare_search_string(query);
     LOG(INFO) << "Search stickers by " << emojis << " and keyword " << prepared_query;
+    // installed sticker sets without matching stickers are skipped without looking inside them
+    auto found_installed_sticker_set_ids = find_installed_sticker_sets(sticker_type, emojis, prepared_query);
+    auto installed_sticker_set_count = installed_sticker_set_ids_[type].size();
     vector<const StickerSet *> examined_sticker_sets;
-    for (const auto &sticker_set_id : examined_sticker_set_ids) {
+    for (size_t i = 0; i < examined_sticker_set_ids.size(); i++) {
+      auto sticker_set_id = examined_sticker_set_ids[i];
+      if (i < installed_sticker_set_count && found_installed_sticker_set_ids.count(sticker_set_id) == 0) {
+        continue;
+      }
       const StickerSet *sticker_set = get_sticker_set(sticker_set_id);
       if (sticker_set == nullptr || !sticker_set->was_loaded_) {
         continue;
@@ -4842,7 +4909,7 @@ vector<FileId> StickersManager::get_stickers(StickerType sticker_type, string qu
       vector<FileId> regular_sticker_ids;
       vector<FileId> premium_sticker_ids;
       std::tie(regular_sticker_ids, premium_sticker_ids) = split_stickers_by_premium(result);
-      if (td_->option_manager_->get_option_boolean("is_premium") || allow_premium) {
+      if (td_->option_manager_->get_option_boolean(OptionId::IsPremium) || allow_premium) {
         auto normal_count = td_->option_manager_->get_option_integer("stickers_normal_by_emoji_per_premium_num", 2);
         if (normal_count < 0) {
           normal_count = 2;
@@ -5602,18 +5669,12 @@ string StickersManager::get_full_sticker_set_database_key(StickerSetId set_id) {
 }
 
 string StickersManager::get_sticker_set_database_value(const StickerSet *s, bool with_stickers, const char *source) {
-  LogEventStorerCalcLength storer_calc_length;
-  store_sticker_set(s, with_stickers, storer_calc_length, source);
-
-  BufferSlice value_buffer{storer_calc_length.get_length()};
-  auto value = value_buffer.as_mutable_slice();
+  auto value_buffer = log_event_store_by_function(
+      [&](auto &storer) { store_sticker_set(s, with_stickers, storer, source); });
 
-  LOG(DEBUG) << "Serialized size of " << s->id_ << " is " << value.size();
+  LOG(DEBUG) << "Serialized size of " << s->id_ << " is " << value_buffer.size();
 
-  LogEventStorerUnsafe storer_unsafe(value.ubegin());
-  store_sticker_set(s, with_stickers, storer_unsafe, source);
-
-  return value.str();
+  return value_buffer.as_slice().str();
 }
 
 void StickersManager::update_sticker_set(StickerSet *sticker_set, const char *source) {
@@ -5654,6 +5715,7 @@ void StickersManager::load_sticker_sets(vector<StickerSetId> &&sticker_set_ids,
   load_request.promise_ = std::move(promise);
   load_request.left_queries_ = sticker_set_ids.size();
 
+  vector<StickerSetId> database_sticker_set_ids;
   for (auto sticker_set_id : sticker_set_ids) {
     StickerSet *sticker_set = get_sticker_set(sticker_set_id);
     CHECK(sticker_set != nullptr);
@@ -5663,17 +5725,14 @@ void StickersManager::load_sticker_sets(vector<StickerSetId> &&sticker_set_ids,
     if (sticker_set->load_requests_.size() == 1u) {
       if (G()->parameters().use_file_db && !sticker_set->was_loaded_) {
         LOG(INFO) << "Trying to load " << sticker_set_id << " with stickers from database";
-        G()->td_db()->get_sqlite_pmc()->get(
-            get_full_sticker_set_database_key(sticker_set_id), PromiseCreator::lambda([sticker_set_id](string value) {
-              send_closure(G()->stickers_manager(), &StickersManager::on_load_sticker_set_from_database, sticker_set_id,
-                           true, std::move(value));
-            }));
+        database_sticker_set_ids.push_back(sticker_set_id);
       } else {
         LOG(INFO) << "Trying to load " << sticker_set_id << " with stickers from server";
         do_reload_sticker_set(sticker_set_id, get_input_sticker_set(sticker_set), 0, Auto(), "load_sticker_sets");
       }
     }
   }
+  load_sticker_sets_from_database(std::move(database_sticker_set_ids), true);
 }
 
 void StickersManager::load_sticker_sets_without_stickers(vector<StickerSetId> &&sticker_set_ids,
@@ -5689,6 +5748,7 @@ void StickersManager::load_sticker_sets_without_stickers(vector<StickerSetId> &&
   load_request.promise_ = std::move(promise);
   load_request.left_queries_ = sticker_set_ids.size();
 
+  vector<StickerSetId> database_sticker_set_ids;
   for (auto sticker_set_id : sticker_set_ids) {
     StickerSet *sticker_set = get_sticker_set(sticker_set_id);
     CHECK(sticker_set != nullptr);
@@ -5701,11 +5761,7 @@ void StickersManager::load_sticker_sets_without_stickers(vector<StickerSetId> &&
       if (sticker_set->load_without_stickers_requests_.size() == 1u) {
         if (G()->parameters().use_file_db) {
           LOG(INFO) << "Trying to load " << sticker_set_id << " from database";
-          G()->td_db()->get_sqlite_pmc()->get(
-              get_sticker_set_database_key(sticker_set_id), PromiseCreator::lambda([sticker_set_id](string value) {
-                send_closure(G()->stickers_manager(), &StickersManager::on_load_sticker_set_from_database,
-                             sticker_set_id, false, std::move(value));
-              }));
+          database_sticker_set_ids.push_back(sticker_set_id);
         } else {
           LOG(INFO) << "Trying to load " << sticker_set_id << " from server";
           do_reload_sticker_set(sticker_set_id, get_input_sticker_set(sticker_set), 0, Auto(),
@@ -5714,6 +5770,34 @@ void StickersManager::load_sticker_sets_without_stickers(vector<StickerSetId> &&
       }
     }
   }
+  load_sticker_sets_from_database(std::move(database_sticker_set_ids), false);
+}
+
+void StickersManager::load_sticker_sets_from_database(vector<StickerSetId> sticker_set_ids, bool with_stickers) {
+  if (sticker_set_ids.empty()) {
+    return;
+  }
+  auto keys = transform(sticker_set_ids, [with_stickers](StickerSetId sticker_set_id) {
+    return with_stickers ? get_full_sticker_set_database_key(sticker_set_id)
+                         : get_sticker_set_database_key(sticker_set_id);
+  });
+  G()->td_db()->get_sqlite_pmc()->get_many(
+      std::move(keys), PromiseCreator::lambda([sticker_set_ids = std::move(sticker_set_ids),
+                                               with_stickers](vector<string> values) mutable {
+        send_closure(G()->stickers_manager(), &StickersManager::on_load_sticker_sets_from_database,
+                     std::move(sticker_set_ids), with_stickers, std::move(values));
+      }));
+}
+
+void StickersManager::on_load_sticker_sets_from_database(vector<StickerSetId> sticker_set_ids, bool with_stickers,
+                                                         vector<string> values) {
+  if (G()->close_flag()) {
+    return;
+  }
+  CHECK(sticker_set_ids.size() == values.size());
+  for (size_t i = 0; i < sticker_set_ids.size(); i++) {
+    on_load_sticker_set_from_database(sticker_set_ids[i], with_stickers, std::move(values[i]));
+  }
 }
 
 void StickersManager::on_load_sticker_set_from_database(StickerSetId sticker_set_id, bool with_stickers, string value) {
@@ -6903,7 +6987,7 @@ vector<FileId> StickersManager::get_animated_emoji_click_stickers(const StickerS
   for (auto sticker_id : sticker_set->sticker_ids_) {
     auto s = get_sticker(sticker_id);
     CHECK(s != nullptr);
-    if (remove_emoji_modifiers(s->alt_) == emoji) {
+    if (is_emoji_without_modifiers_equal(s->alt_, emoji)) {
       result.push_back(sticker_id);
     }
   }
@@ -10435,4 +10519,9 @@ void StickersManager::get_current_state(vector<td_api::object_ptr<td_api::Update
   }
 }
 
+void StickersManager::get_memory_statistics(MemoryStatisticsEntries &entries) const {
+  add_memory_statistics_entry<Sticker>(entries, "StickersManager", "stickers", stickers_.calc_size());
+  add_memory_statistics_entry<StickerSet>(entries, "StickersManager", "sticker_sets", sticker_sets_.calc_size());
+}
+
 }  // namespace td
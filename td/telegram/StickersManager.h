@@ -14,6 +14,7 @@
 #include "td/telegram/files/FileId.h"
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/FullMessageId.h"
+#include "td/telegram/MemoryStatistics.h"
 #include "td/telegram/PhotoFormat.h"
 #include "td/telegram/PhotoSize.h"
 #include "td/telegram/SecretInputMedia.h"
@@ -439,6 +440,8 @@ class StickersManager final : public Actor {
 
   void get_current_state(vector<td_api::object_ptr<td_api::Update>> &updates) const;
 
+  void get_memory_statistics(MemoryStatisticsEntries &entries) const;
+
   template <class StorerT>
   void store_sticker_set_id(StickerSetId sticker_set_id, StorerT &storer) const;
 
@@ -583,6 +586,15 @@ class StickersManager final : public Actor {
     void parse(ParserT &parser);
   };
 
+  // index of emojis and keywords of all installed sticker sets of a type
+  struct InstalledStickerSetIndex {
+    vector<StickerSetId> sticker_set_ids_;  // installed sticker sets, for which the index was built
+    uint64 sticker_set_generation_ = 0;     // value of sticker_set_generation_ when the index was built
+    bool is_inited_ = false;
+    FlatHashMap<string, vector<StickerSetId>> emoji_sticker_set_ids_;
+    std::map<string, vector<StickerSetId>> keyword_sticker_set_ids_;
+  };
+
   struct Reaction {
     string reaction_;
     string title_;
@@ -737,6 +749,11 @@ class StickersManager final : public Actor {
 
   void load_sticker_sets_without_stickers(vector<StickerSetId> &&sticker_set_ids, Promise<Unit> &&promise);
 
+  void load_sticker_sets_from_database(vector<StickerSetId> sticker_set_ids, bool with_stickers);
+
+  void on_load_sticker_sets_from_database(vector<StickerSetId> sticker_set_ids, bool with_stickers,
+                                          vector<string> values);
+
   void on_load_sticker_set_from_database(StickerSetId sticker_set_id, bool with_stickers, string value);
 
   void update_load_requests(StickerSet *sticker_set, bool with_stickers, const Status &status);
@@ -994,6 +1011,12 @@ class StickersManager final : public Actor {
 
   bool can_find_sticker_by_query(FileId sticker_id, const vector<string> &emojis, const string &query) const;
 
+  const InstalledStickerSetIndex &get_installed_sticker_set_index(StickerType sticker_type);
+
+  FlatHashSet<StickerSetId, StickerSetIdHash> find_installed_sticker_sets(StickerType sticker_type,
+                                                                          const vector<string> &emojis,
+                                                                          const string &query);
+
   static string get_emoji_language_code_version_database_key(const string &language_code);
 
   static string get_emoji_language_code_last_difference_time_database_key(const string &language_code);
@@ -1059,6 +1082,8 @@ class StickersManager final : public Actor {
   WaitFreeHashMap<string, StickerSetId> short_name_to_sticker_set_id_;
 
   vector<StickerSetId> installed_sticker_set_ids_[MAX_STICKER_TYPE];
+  InstalledStickerSetIndex installed_sticker_set_indexes_[MAX_STICKER_TYPE];
+  uint64 sticker_set_generation_ = 0;  // changed whenever emojis or keywords of a sticker set change
   vector<StickerSetId> featured_sticker_set_ids_[MAX_STICKER_TYPE];
   vector<StickerSetId> old_featured_sticker_set_ids_[MAX_STICKER_TYPE];
   vector<FileId> recent_sticker_ids_[2];
@@ -379,6 +379,7 @@ void StickersManager::parse_sticker_set(StickerSet *sticker_set, ParserT &parser
     sticker_set->sticker_ids_.clear();
     sticker_set->premium_sticker_positions_.clear();
     if (sticker_set->was_loaded_) {
+      sticker_set_generation_++;
       sticker_set->emoji_stickers_map_.clear();
       sticker_set->sticker_emojis_map_.clear();
       sticker_set->keyword_stickers_map_.clear();
@@ -7,6 +7,8 @@
 #include "td/telegram/StorageManager.h"
 
 #include "td/telegram/DialogId.h"
+#include "td/telegram/files/FileDb.h"
+#include "td/telegram/files/FileGcIndex.h"
 #include "td/telegram/files/FileGcWorker.h"
 #include "td/telegram/files/FileStatsWorker.h"
 #include "td/telegram/Global.h"
@@ -41,9 +43,11 @@ void StorageManager::start_up() {
   schedule_next_gc();
 
   load_fast_stat();
+  load_live_stats();
 }
 
-void StorageManager::on_new_file(int64 size, int64 real_size, int32 cnt) {
+void StorageManager::on_new_file(FileType file_type, DialogId owner_dialog_id, int64 size, int64 real_size,
+                                 int32 cnt) {
   LOG(INFO) << "Add " << cnt << " file of size " << size << " with real size " << real_size
             << " to fast storage statistics";
   fast_stat_.cnt += cnt;
@@ -59,12 +63,23 @@ void StorageManager::on_new_file(int64 size, int64 real_size, int32 cnt) {
     fast_stat_ = FileTypeStat();
   }
   save_fast_stat();
+
+  if (live_stats_ != nullptr) {
+    live_stats_->add_stat(get_main_file_type(file_type), owner_dialog_id, add_size, cnt);
+  }
 }
 
 void StorageManager::get_storage_stats(bool need_all_files, int32 dialog_limit, Promise<FileStats> promise) {
   if (is_closed_) {
     return promise.set_error(Global::request_aborted_error());
   }
+  if (!need_all_files && live_stats_ != nullptr &&
+      (dialog_limit == 0 || live_stats_->is_split_by_owner_dialog_id() || !G()->parameters().use_chat_info_db)) {
+    LOG(INFO) << "Return storage statistics from memory";
+    std::vector<Promise<FileStats>> promises;
+    promises.push_back(std::move(promise));
+    return send_stats(FileStats(*live_stats_), dialog_limit, std::move(promises));
+  }
   if (!pending_storage_stats_.empty()) {
     if (stats_dialog_limit_ == dialog_limit && need_all_files == stats_need_all_files_) {
       pending_storage_stats_.emplace_back(std::move(promise));
@@ -81,7 +96,9 @@ void StorageManager::get_storage_stats(bool need_all_files, int32 dialog_limit,
   pending_storage_stats_.emplace_back(std::move(promise));
 
   create_stats_worker();
-  send_closure(stats_worker_, &FileStatsWorker::get_stats, need_all_files, stats_dialog_limit_ != 0,
+  // statistics must be split by owner dialog to be used for subsequent requests
+  send_closure(stats_worker_, &FileStatsWorker::get_stats, need_all_files,
+               stats_dialog_limit_ != 0 || (live_stats_ == nullptr && !need_all_files),
                PromiseCreator::lambda(
                    [actor_id = actor_id(this), stats_generation = stats_generation_](Result<FileStats> file_stats) {
                      send_closure(actor_id, &StorageManager::on_file_stats, std::move(file_stats), stats_generation);
@@ -116,14 +133,29 @@ void StorageManager::run_gc(FileGcParameters parameters, bool return_deleted_fil
     close_gc_worker();
   }
 
+  if (can_use_file_gc_index()) {
+    LOG(INFO) << "Run files GC using files index";
+    create_gc_worker();
+    int32 dialog_limit = parameters.dialog_limit_;
+    send_closure(
+        gc_worker_, &FileGcWorker::run_gc_from_index, std::move(parameters),
+        PromiseCreator::lambda([actor_id = actor_id(this), dialog_limit](Result<FileGcResult> r_file_gc_result) {
+          send_closure(actor_id, &StorageManager::on_gc_finished, dialog_limit, std::move(r_file_gc_result));
+        }));
+    pending_run_gc_[return_deleted_file_statistics].push_back(std::move(promise));
+    return;
+  }
+
+  // owner dialogs of all files are needed to rebuild files index
   bool split_by_owner_dialog_id = !parameters.owner_dialog_ids_.empty() ||
-                                  !parameters.exclude_owner_dialog_ids_.empty() || parameters.dialog_limit_ != 0;
-  get_storage_stats(
-      true /*need_all_files*/, split_by_owner_dialog_id,
-      PromiseCreator::lambda(
-          [actor_id = actor_id(this), parameters = std::move(parameters)](Result<FileStats> file_stats) mutable {
-            send_closure(actor_id, &StorageManager::on_all_files, std::move(parameters), std::move(file_stats));
-          }));
+                                  !parameters.exclude_owner_dialog_ids_.empty() || parameters.dialog_limit_ != 0 ||
+                                  G()->parameters().use_file_db;
+  get_storage_stats(true /*need_all_files*/, split_by_owner_dialog_id,
+                    PromiseCreator::lambda([actor_id = actor_id(this), parameters = std::move(parameters),
+                                            scan_start_time = Clocks::system()](Result<FileStats> file_stats) mutable {
+                      send_closure(actor_id, &StorageManager::on_all_files, std::move(parameters), scan_start_time,
+                                   std::move(file_stats));
+                    }));
 
   //NB: get_storage_stats will cancel all garbage collection queries, so promise needs to be added after the call
   pending_run_gc_[return_deleted_file_statistics].push_back(std::move(promise));
@@ -139,6 +171,9 @@ void StorageManager::on_file_stats(Result<FileStats> r_file_stats, uint32 genera
   }
 
   update_fast_stats(r_file_stats.ok());
+  if (!stats_need_all_files_) {
+    update_live_stats(r_file_stats.ok());
+  }
   send_stats(r_file_stats.move_as_ok(), stats_dialog_limit_, std::move(pending_storage_stats_));
 }
 
@@ -151,7 +186,21 @@ void StorageManager::create_stats_worker() {
   }
 }
 
-void StorageManager::on_all_files(FileGcParameters gc_parameters, Result<FileStats> r_file_stats) {
+bool StorageManager::can_use_file_gc_index() const {
+  if (!G()->parameters().use_file_db) {
+    return false;
+  }
+  auto file_db = G()->td_db()->get_file_db_shared();
+  if (file_db == nullptr) {
+    return false;
+  }
+  auto build_time = get_file_gc_index_build_time(file_db->pmc());
+  auto now = Clocks::system();
+  return build_time > now - FULL_SCAN_EACH && build_time <= now;
+}
+
+void StorageManager::on_all_files(FileGcParameters gc_parameters, double scan_start_time,
+                                  Result<FileStats> r_file_stats) {
   int32 dialog_limit = gc_parameters.dialog_limit_;
   if (is_closed_ && r_file_stats.is_ok()) {
     r_file_stats = Global::request_aborted_error();
@@ -162,10 +211,15 @@ void StorageManager::on_all_files(FileGcParameters gc_parameters, Result<FileSta
 
   create_gc_worker();
 
-  send_closure(gc_worker_, &FileGcWorker::run_gc, std::move(gc_parameters), r_file_stats.ok_ref().get_all_files(),
-               PromiseCreator::lambda([actor_id = actor_id(this), dialog_limit](Result<FileGcResult> r_file_gc_result) {
-                 send_closure(actor_id, &StorageManager::on_gc_finished, dialog_limit, std::move(r_file_gc_result));
-               }));
+  if (!G()->parameters().use_file_db) {
+    scan_start_time = 0.0;
+  }
+  send_closure(
+      gc_worker_, &FileGcWorker::run_gc, std::move(gc_parameters), r_file_stats.ok_ref().get_all_files(),
+      scan_start_time,
+      PromiseCreator::lambda([actor_id = actor_id(this), dialog_limit](Result<FileGcResult> r_file_gc_result) {
+        send_closure(actor_id, &StorageManager::on_gc_finished, dialog_limit, std::move(r_file_gc_result));
+      }));
 }
 
 int64 StorageManager::get_file_size(CSlice path) {
@@ -224,6 +278,7 @@ void StorageManager::on_gc_finished(int32 dialog_limit, Result<FileGcResult> r_f
   }
 
   update_fast_stats(r_file_gc_result.ok().kept_file_stats_);
+  update_live_stats(r_file_gc_result.ok().kept_file_stats_);
 
   auto kept_file_promises = std::move(pending_run_gc_[0]);
   auto removed_file_promises = std::move(pending_run_gc_[1]);
@@ -250,6 +305,36 @@ void StorageManager::update_fast_stats(const FileStats &stats) {
   save_fast_stat();
 }
 
+void StorageManager::load_live_stats() {
+  auto value = G()->td_db()->get_binlog_pmc()->get("live_file_stats");
+  if (value.empty()) {
+    return;
+  }
+  // the statistics are saved only on closing, so they must not be used after an unclean shutdown
+  G()->td_db()->get_binlog_pmc()->erase("live_file_stats");
+
+  auto stats = make_unique<FileStats>();
+  auto status = log_event_parse(*stats, value);
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to load storage statistics: " << status;
+    return;
+  }
+  live_stats_ = std::move(stats);
+  LOG(INFO) << "Loaded storage statistics " << *live_stats_;
+}
+
+void StorageManager::save_live_stats() {
+  if (live_stats_ == nullptr) {
+    return;
+  }
+  G()->td_db()->get_binlog_pmc()->set("live_file_stats", log_event_store(*live_stats_).as_slice().str());
+}
+
+void StorageManager::update_live_stats(const FileStats &stats) {
+  live_stats_ = make_unique<FileStats>(stats);
+  LOG(INFO) << "Recalculate storage statistics to " << *live_stats_;
+}
+
 void StorageManager::send_stats(FileStats &&stats, int32 dialog_limit, std::vector<Promise<FileStats>> &&promises) {
   if (promises.empty()) {
     return;
@@ -305,6 +390,7 @@ void StorageManager::close_gc_worker() {
 
 void StorageManager::hangup() {
   is_closed_ = true;
+  save_live_stats();
   close_stats_worker();
   close_gc_worker();
   hangup_shared();
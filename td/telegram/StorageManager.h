@@ -6,9 +6,11 @@
 //
 #pragma once
 
+#include "td/telegram/DialogId.h"
 #include "td/telegram/files/FileGcWorker.h"
 #include "td/telegram/files/FileStats.h"
 #include "td/telegram/files/FileStatsWorker.h"
+#include "td/telegram/files/FileType.h"
 #include "td/telegram/td_api.h"
 
 #include "td/actor/actor.h"
@@ -38,12 +40,13 @@ class StorageManager final : public Actor {
   void run_gc(FileGcParameters parameters, bool return_deleted_file_statistics, Promise<FileStats> promise);
   void update_use_storage_optimizer();
 
-  void on_new_file(int64 size, int64 real_size, int32 cnt);
+  void on_new_file(FileType file_type, DialogId owner_dialog_id, int64 size, int64 real_size, int32 cnt);
 
  private:
   static constexpr int GC_EACH = 60 * 60 * 24;  // 1 day
   static constexpr int GC_DELAY = 60;
   static constexpr int GC_RAND_DELAY = 60 * 15;
+  static constexpr int FULL_SCAN_EACH = 60 * 60 * 24 * 7;  // 1 week
 
   ActorShared<> parent_;
 
@@ -58,6 +61,9 @@ class StorageManager final : public Actor {
 
   FileTypeStat fast_stat_;
 
+  // statistics by owner dialog and file type, which are updated on file changes; empty if unknown
+  unique_ptr<FileStats> live_stats_;
+
   CancellationTokenSource stats_cancellation_token_source_;
   CancellationTokenSource gc_cancellation_token_source_;
 
@@ -68,6 +74,9 @@ class StorageManager final : public Actor {
 
   void save_fast_stat();
   void load_fast_stat();
+  void load_live_stats();
+  void save_live_stats();
+  void update_live_stats(const FileStats &stats);
   static int64 get_database_size();
   static int64 get_language_pack_database_size();
   static int64 get_log_size();
@@ -88,7 +97,8 @@ class StorageManager final : public Actor {
   uint32 last_gc_timestamp_ = 0;
   double next_gc_at_ = 0;
 
-  void on_all_files(FileGcParameters gc_parameters, Result<FileStats> r_file_stats);
+  bool can_use_file_gc_index() const;
+  void on_all_files(FileGcParameters gc_parameters, double scan_start_time, Result<FileStats> r_file_stats);
   void create_gc_worker();
   void on_gc_finished(int32 dialog_limit, Result<FileGcResult> r_file_gc_result);
 
@@ -67,6 +67,7 @@
 #include "td/telegram/LinkManager.h"
 #include "td/telegram/Location.h"
 #include "td/telegram/Logging.h"
+#include "td/telegram/MemoryStatistics.h"
 #include "td/telegram/MessageCopyOptions.h"
 #include "td/telegram/MessageEntity.h"
 #include "td/telegram/MessageId.h"
@@ -78,6 +79,7 @@
 #include "td/telegram/MessageSource.h"
 #include "td/telegram/MessageThreadInfo.h"
 #include "td/telegram/MessageTtl.h"
+#include "td/telegram/MetricsExporter.h"
 #include "td/telegram/misc.h"
 #include "td/telegram/net/ConnectionCreator.h"
 #include "td/telegram/net/DcId.h"
@@ -107,6 +109,7 @@
 #include "td/telegram/PublicDialogType.h"
 #include "td/telegram/ReportReason.h"
 #include "td/telegram/RequestActor.h"
+#include "td/telegram/RequestStatistics.h"
 #include "td/telegram/ScopeNotificationSettings.h"
 #include "td/telegram/SecretChatId.h"
 #include "td/telegram/SecretChatsManager.h"
@@ -114,6 +117,7 @@
 #include "td/telegram/SecureValue.h"
 #include "td/telegram/SentEmailCode.h"
 #include "td/telegram/SponsoredMessageManager.h"
+#include "td/telegram/StartupProfiler.h"
 #include "td/telegram/StateManager.h"
 #include "td/telegram/StickerFormat.h"
 #include "td/telegram/StickerSetId.h"
@@ -147,24 +151,32 @@
 #include "td/mtproto/RSA.h"
 #include "td/mtproto/TransportType.h"
 
+#include "td/tl/TlArena.h"
+
 #include "td/actor/actor.h"
+#include "td/actor/ActorStatistics.h"
+#include "td/actor/RequestTracer.h"
 
 #include "td/utils/algorithm.h"
 #include "td/utils/buffer.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/format.h"
+#include "td/utils/LockStatistics.h"
 #include "td/utils/MimeType.h"
 #include "td/utils/misc.h"
 #include "td/utils/PathView.h"
 #include "td/utils/port/IPAddress.h"
 #include "td/utils/port/SocketFd.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/port/uname.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/Time.h"
 #include "td/utils/Timer.h"
 #include "td/utils/tl_parsers.h"
+#include "td/utils/TlStorerToString.h"
 #include "td/utils/utf8.h"
 
 #include <limits>
@@ -2580,6 +2592,10 @@ void Td::on_alarm_timeout(int64 alarm_id) {
     }
     return;
   }
+  if (alarm_id == COALESCED_UPDATES_ALARM_ID) {
+    flush_coalesced_updates();
+    return;
+  }
   if (alarm_id == PROMO_DATA_ALARM_ID) {
     if (!close_flag_ && !auth_manager_->is_bot()) {
       auto promise = PromiseCreator::lambda(
@@ -2731,7 +2747,7 @@ void Td::set_is_online(bool is_online) {
 }
 
 void Td::set_is_bot_online(bool is_bot_online) {
-  if (G()->get_option_integer("session_count") > 1) {
+  if (G()->get_option_integer(OptionId::SessionCount) > 1) {
     is_bot_online = false;
   }
 
@@ -2786,6 +2802,7 @@ bool Td::is_synchronous_request(const td_api::Function *function) {
     case td_api::getJsonString::ID:
     case td_api::getThemeParametersJsonString::ID:
     case td_api::getPushReceiverId::ID:
+    case td_api::decryptPushNotification::ID:
     case td_api::setLogStream::ID:
     case td_api::getLogStream::ID:
     case td_api::setLogVerbosityLevel::ID:
@@ -2794,6 +2811,15 @@ bool Td::is_synchronous_request(const td_api::Function *function) {
     case td_api::setLogTagVerbosityLevel::ID:
     case td_api::getLogTagVerbosityLevel::ID:
     case td_api::addLogMessage::ID:
+    case td_api::toggleActorStatistics::ID:
+    case td_api::getActorStatistics::ID:
+    case td_api::toggleLockStatistics::ID:
+    case td_api::getLockStatistics::ID:
+    case td_api::toggleRequestStatistics::ID:
+    case td_api::getRequestStatistics::ID:
+    case td_api::toggleRequestTracing::ID:
+    case td_api::getRequestTraces::ID:
+    case td_api::setMetricsExporterPort::ID:
     case td_api::testReturnError::ID:
       return true;
     case td_api::getOption::ID:
@@ -2807,6 +2833,7 @@ bool Td::is_preinitialization_request(int32 id) {
   switch (id) {
     case td_api::getCurrentState::ID:
     case td_api::setAlarm::ID:
+    case td_api::setUpdateFilter::ID:
     case td_api::testUseUpdate::ID:
     case td_api::testCallEmpty::ID:
     case td_api::testSquareInt::ID:
@@ -2842,10 +2869,12 @@ bool Td::is_preauthentication_request(int32 id) {
     case td_api::getStorageStatistics::ID:
     case td_api::getStorageStatisticsFast::ID:
     case td_api::getDatabaseStatistics::ID:
+    case td_api::getMemoryStatistics::ID:
     case td_api::setNetworkType::ID:
     case td_api::getNetworkStatistics::ID:
     case td_api::addNetworkStatistics::ID:
     case td_api::resetNetworkStatistics::ID:
+    case td_api::getNetworkQueryStatistics::ID:
     case td_api::getCountries::ID:
     case td_api::getCountryCode::ID:
     case td_api::getPhoneNumberInfo::ID:
@@ -2915,8 +2944,13 @@ void Td::request(uint64 id, tl_object_ptr<td_api::Function> function) {
     return callback_->on_error(id, make_error(400, "Request is empty"));
   }
 
-  VLOG(td_requests) << "Receive request " << id << ": " << to_string(function);
-  request_set_.emplace(id, function->get_id());
+  VLOG(td_requests) << "Receive request " << id << ": " << lazy_to_string(function);
+  auto function_index = td_api::get_function_index(function->get_id());
+  CHECK(function_index >= 0);
+  auto trace_id = RequestTracer::is_enabled() ? RequestTracer::start_trace() : 0;
+  auto start_time = RequestStatistics::is_enabled() || trace_id != 0 ? Time::now() : 0.0;
+  request_set_.emplace(id, RequestInfo(function_index, start_time, trace_id));
+  RequestTracer::Guard trace_guard(trace_id);
   if (is_synchronous_request(function.get())) {
     // send response synchronously
     return send_result(id, static_request(std::move(function)));
@@ -2925,6 +2959,20 @@ void Td::request(uint64 id, tl_object_ptr<td_api::Function> function) {
   run_request(id, std::move(function));
 }
 
+void Td::on_request_finished(const RequestInfo &request_info, bool is_error) {
+  if (request_info.start_time <= 0) {
+    return;
+  }
+  auto now = Time::now();
+  if (RequestStatistics::is_enabled()) {
+    RequestStatistics::on_request_finished(request_info.function_index, is_error, now - request_info.start_time);
+  }
+  if (request_info.trace_id != 0) {
+    RequestTracer::add_span(request_info.trace_id, CSlice(td_api::get_function_name(request_info.function_index)),
+                            request_info.start_time, now);
+  }
+}
+
 void Td::run_request(uint64 id, tl_object_ptr<td_api::Function> function) {
   if (set_parameters_request_id_ > 0) {
     pending_set_parameters_requests_.emplace_back(id, std::move(function));
@@ -2962,6 +3010,7 @@ void Td::run_request(uint64 id, tl_object_ptr<td_api::Function> function) {
 
           VLOG(td_init) << "Begin to open database";
           set_parameters_request_id_ = id;
+          startup_profiler_ = make_unique<StartupProfiler>();
 
           auto promise =
               PromiseCreator::lambda([actor_id = actor_id(this)](Result<TdDb::OpenedDatabase> r_opened_database) {
@@ -2997,7 +3046,13 @@ void Td::run_request(uint64 id, tl_object_ptr<td_api::Function> function) {
       !is_preinitialization_request(function_id) && !is_authentication_request(function_id)) {
     return send_error_impl(id, make_error(401, "Unauthorized"));
   }
-  downcast_call(*function, [this, id](auto &request) { this->on_request(id, request); });
+  if (is_hibernated_ && function_id != td_api::hibernate::ID) {
+    LOG(INFO) << "Wake up from hibernation";
+    is_hibernated_ = false;
+    send_closure(state_manager_, &StateManager::on_hibernate, false);
+  }
+  td_api::downcast_call_by_index(td_api::get_function_index(function_id), *function,
+                                 [this, id](auto &request) { this->on_request(id, request); });
 }
 
 td_api::object_ptr<td_api::Object> Td::static_request(td_api::object_ptr<td_api::Function> function) {
@@ -3026,7 +3081,7 @@ td_api::object_ptr<td_api::Object> Td::static_request(td_api::object_ptr<td_api:
   }();
 
   if (need_logging) {
-    VLOG(td_requests) << "Receive static request: " << to_string(function);
+    VLOG(td_requests) << "Receive static request: " << lazy_to_string(function);
   }
 
   td_api::object_ptr<td_api::Object> response;
@@ -3034,7 +3089,7 @@ td_api::object_ptr<td_api::Object> Td::static_request(td_api::object_ptr<td_api:
   LOG_CHECK(response != nullptr) << function_id;
 
   if (need_logging) {
-    VLOG(td_requests) << "Sending result for static request: " << to_string(response);
+    VLOG(td_requests) << "Sending result for static request: " << lazy_to_string(response);
   }
   return response;
 }
@@ -3059,7 +3114,11 @@ void Td::on_update(BufferSlice &&update, uint64 auth_key_id) {
   }
 
   TlBufferParser parser(&update);
-  auto ptr = telegram_api::Updates::fetch(parser);
+  telegram_api::object_ptr<telegram_api::Updates> ptr;
+  {
+    TlArena::Scope arena_scope;
+    ptr = telegram_api::Updates::fetch(parser);
+  }
   parser.fetch_end();
   if (parser.get_error()) {
     LOG(ERROR) << "Failed to fetch update: " << parser.get_error() << format::as_hex_dump<4>(update.as_slice());
@@ -3106,9 +3165,30 @@ void Td::on_connection_state_changed(ConnectionState new_state) {
   }
   connection_state_ = new_state;
 
+  if (connection_state_ == ConnectionState::Ready && startup_profiler_ != nullptr &&
+      !startup_profiler_->has_phase("connection to the server")) {
+    add_startup_phase("connection to the server", startup_profiler_->get_start_time());
+  }
+
   send_closure(actor_id(this), &Td::send_update, get_update_connection_state_object(connection_state_));
 }
 
+void Td::add_startup_phase(string name, double start_time, int64 count, int64 size) {
+  if (startup_profiler_ == nullptr) {
+    return;
+  }
+  startup_profiler_->add_phase(std::move(name), start_time, count, size);
+}
+
+void Td::finish_startup_profiling() {
+  if (startup_profiler_ == nullptr) {
+    return;
+  }
+  LOG(INFO) << *startup_profiler_;
+  send_update(startup_profiler_->get_update_startup_timeline_object());
+  startup_profiler_ = nullptr;
+}
+
 void Td::start_up() {
   uint64 check_endianness = 0x0706050403020100;
   auto check_endianness_raw = reinterpret_cast<const unsigned char *>(&check_endianness);
@@ -3172,10 +3252,11 @@ void Td::dec_actor_refcnt() {
   }
   if (actor_refcnt_ == 0) {
     if (close_flag_ == 2) {
+      on_close_phase_finished("Actors were closed");
       create_reference();
       close_flag_ = 3;
     } else if (close_flag_ == 3) {
-      LOG(INFO) << "All actors were closed";
+      on_close_phase_finished("All actors were closed");
       Timer timer;
       animations_manager_.reset();
       LOG(DEBUG) << "AnimationsManager was cleared" << timer;
@@ -3245,6 +3326,7 @@ void Td::dec_actor_refcnt() {
       G()->set_option_manager(nullptr);
       option_manager_.reset();
       LOG(DEBUG) << "OptionManager was cleared" << timer;
+      on_close_phase_finished("Managers were destroyed");
 
       Promise<> promise = PromiseCreator::lambda([actor_id = create_reference()](Unit) mutable { actor_id.reset(); });
       if (destroy_flag_) {
@@ -3255,6 +3337,7 @@ void Td::dec_actor_refcnt() {
       // NetQueryDispatcher will be closed automatically
       close_flag_ = 4;
     } else if (close_flag_ == 4) {
+      on_close_phase_finished("Databases were closed");
       on_closed();
     } else {
       UNREACHABLE();
@@ -3269,6 +3352,13 @@ void Td::on_closed() {
   dec_stop_cnt();
 }
 
+void Td::on_close_phase_finished(const char *phase) {
+  auto now = Time::now();
+  LOG(INFO) << phase << " in " << format::as_time(now - close_phase_start_time_) << ", closing for "
+            << format::as_time(now - close_start_time_);
+  close_phase_start_time_ = now;
+}
+
 void Td::dec_stop_cnt() {
   stop_cnt_--;
   if (stop_cnt_ == 0) {
@@ -3286,7 +3376,7 @@ void Td::dec_request_actor_refcnt() {
   request_actor_refcnt_--;
   LOG(DEBUG) << "Decrease request actor count to " << request_actor_refcnt_;
   if (request_actor_refcnt_ == 0) {
-    LOG(INFO) << "Have no request actors";
+    on_close_phase_finished("Request actors were closed");
     clear();
     dec_actor_refcnt();  // remove guard
   }
@@ -3435,6 +3525,7 @@ void Td::clear() {
   LOG(DEBUG) << "VoiceNotesManager actor was cleared" << timer;
   web_pages_manager_actor_.reset();
   LOG(DEBUG) << "WebPagesManager actor was cleared" << timer;
+  on_close_phase_finished("Network was stopped and managers were asked to close");
 }
 
 void Td::close() {
@@ -3452,6 +3543,8 @@ void Td::close_impl(bool destroy_flag) {
   }
 
   LOG(WARNING) << (destroy_flag ? "Destroy" : "Close") << " Td in state " << static_cast<int32>(state_);
+  close_start_time_ = Time::now();
+  close_phase_start_time_ = close_start_time_;
   if (state_ == State::WaitParameters) {
     clear_requests();
     state_ = State::Close;
@@ -3512,7 +3605,8 @@ template <class T>
 void Td::complete_pending_preauthentication_requests(const T &func) {
   for (auto &request : pending_preauthentication_requests_) {
     if (request.second != nullptr && func(request.second->get_id())) {
-      downcast_call(*request.second, [this, id = request.first](auto &request) { this->on_request(id, request); });
+      td_api::downcast_call_by_index(td_api::get_function_index(request.second->get_id()), *request.second,
+                                     [this, id = request.first](auto &request) { this->on_request(id, request); });
       request.second = nullptr;
     }
   }
@@ -3544,11 +3638,21 @@ void Td::init(Result<TdDb::OpenedDatabase> r_opened_database) {
   CHECK(set_parameters_request_id_ != 0);
   if (r_opened_database.is_error()) {
     LOG(WARNING) << "Failed to open database: " << r_opened_database.error();
+    startup_profiler_ = nullptr;
     send_closure(actor_id(this), &Td::send_error, set_parameters_request_id_, r_opened_database.move_as_error());
     return finish_set_parameters();
   }
   auto events = r_opened_database.move_as_ok();
 
+  CHECK(startup_profiler_ != nullptr);
+  for (auto &phase : events.database->get_open_phases()) {
+    bool is_binlog_replay = phase.name == "binlog replay";
+    startup_profiler_->add_phase("TdDb::open: " + phase.name, phase.start_time, phase.duration,
+                                 is_binlog_replay ? events.binlog_event_count : 0,
+                                 is_binlog_replay ? events.binlog_event_size : 0);
+  }
+  add_startup_phase("TdDb::open", startup_profiler_->get_start_time());
+
   parameters_.database_directory = std::move(events.database_directory);
   parameters_.files_directory = std::move(events.files_directory);
 
@@ -3558,7 +3662,9 @@ void Td::init(Result<TdDb::OpenedDatabase> r_opened_database) {
 
   G()->init(parameters_, actor_id(this), std::move(events.database)).ensure();
 
+  auto phase_start_time = Time::now();
   init_options_and_network();
+  add_startup_phase("Td::init_options_and_network", phase_start_time);
 
   // we need to process td_api::getOption along with td_api::setOption for consistency
   // we need to process td_api::setOption before managers and MTProto header are created,
@@ -3583,7 +3689,7 @@ void Td::init(Result<TdDb::OpenedDatabase> r_opened_database) {
   options_.language_pack = option_manager_->get_option_string("localization_target");
   options_.language_code = option_manager_->get_option_string("language_pack_id");
   options_.parameters = option_manager_->get_option_string("connection_parameters");
-  options_.tz_offset = static_cast<int32>(option_manager_->get_option_integer("utc_time_offset"));
+  options_.tz_offset = static_cast<int32>(option_manager_->get_option_integer(OptionId::UtcTimeOffset));
   options_.is_emulator = option_manager_->get_option_boolean("is_emulator");
   // options_.proxy = Proxy();
   G()->set_mtproto_header(make_unique<MtprotoHeader>(options_));
@@ -3604,9 +3710,13 @@ void Td::init(Result<TdDb::OpenedDatabase> r_opened_database) {
   auth_manager_actor_ = register_actor("AuthManager", auth_manager_.get());
   G()->set_auth_manager(auth_manager_actor_.get());
 
+  phase_start_time = Time::now();
   init_file_manager();
+  add_startup_phase("Td::init_file_manager", phase_start_time);
 
+  phase_start_time = Time::now();
   init_managers();
+  add_startup_phase("Td::init_managers", phase_start_time);
 
   storage_manager_ = create_actor<StorageManager>("StorageManager", create_reference(), G()->get_gc_scheduler_id());
   G()->set_storage_manager(storage_manager_.get());
@@ -3614,30 +3724,35 @@ void Td::init(Result<TdDb::OpenedDatabase> r_opened_database) {
   option_manager_->on_td_inited();
 
   VLOG(td_init) << "Send binlog events";
-  for (auto &event : events.user_events) {
-    contacts_manager_->on_binlog_user_event(std::move(event));
-  }
+  auto replay_binlog_events = [this](Slice name, vector<BinlogEvent> &binlog_events, auto &&on_binlog_event) {
+    auto start_time = Time::now();
+    int64 size = 0;
+    for (auto &event : binlog_events) {
+      size += event.size_;
+      on_binlog_event(std::move(event));
+    }
+    add_startup_phase(PSTRING() << name << " binlog replay", start_time, static_cast<int64>(binlog_events.size()),
+                      size);
+  };
+  replay_binlog_events("user", events.user_events,
+                       [this](BinlogEvent &&event) { contacts_manager_->on_binlog_user_event(std::move(event)); });
 
-  for (auto &event : events.channel_events) {
-    contacts_manager_->on_binlog_channel_event(std::move(event));
-  }
+  replay_binlog_events("channel", events.channel_events,
+                       [this](BinlogEvent &&event) { contacts_manager_->on_binlog_channel_event(std::move(event)); });
 
   // chats may contain links to channels, so should be inited after
-  for (auto &event : events.chat_events) {
-    contacts_manager_->on_binlog_chat_event(std::move(event));
-  }
+  replay_binlog_events("chat", events.chat_events,
+                       [this](BinlogEvent &&event) { contacts_manager_->on_binlog_chat_event(std::move(event)); });
 
-  for (auto &event : events.secret_chat_events) {
+  replay_binlog_events("secret chat", events.secret_chat_events, [this](BinlogEvent &&event) {
     contacts_manager_->on_binlog_secret_chat_event(std::move(event));
-  }
+  });
 
-  for (auto &event : events.web_page_events) {
-    web_pages_manager_->on_binlog_web_page_event(std::move(event));
-  }
+  replay_binlog_events("web page", events.web_page_events,
+                       [this](BinlogEvent &&event) { web_pages_manager_->on_binlog_web_page_event(std::move(event)); });
 
-  for (auto &event : events.save_app_log_events) {
-    on_save_app_log_binlog_event(this, std::move(event));
-  }
+  replay_binlog_events("app log", events.save_app_log_events,
+                       [this](BinlogEvent &&event) { on_save_app_log_binlog_event(this, std::move(event)); });
 
   if (option_manager_->get_option_boolean("default_reaction_needs_sync")) {
     send_set_default_reaction_query(this);
@@ -3699,6 +3814,10 @@ void Td::init(Result<TdDb::OpenedDatabase> r_opened_database) {
 
   state_ = State::Run;
 
+  if (!auth_manager_->is_authorized()) {
+    finish_startup_profiling();
+  }
+
   send_closure(actor_id(this), &Td::send_result, set_parameters_request_id_, td_api::make_object<td_api::ok>());
   return finish_set_parameters();
 }
@@ -3724,6 +3843,7 @@ void Td::init_options_and_network() {
   VLOG(td_init) << "Create OptionManager";
   option_manager_ = make_unique<OptionManager>(this);
   G()->set_option_manager(option_manager_.get());
+  on_update_coalescing_delay_changed();
 
   init_connection_creator();
 
@@ -3785,8 +3905,9 @@ void Td::init_file_manager() {
       return !td_->auth_manager_->is_bot();
     }
 
-    void on_new_file(int64 size, int64 real_size, int32 cnt) final {
-      send_closure(G()->storage_manager(), &StorageManager::on_new_file, size, real_size, cnt);
+    void on_new_file(FileType file_type, DialogId owner_dialog_id, int64 size, int64 real_size, int32 cnt) final {
+      send_closure(G()->storage_manager(), &StorageManager::on_new_file, file_type, owner_dialog_id, size, real_size,
+                   cnt);
     }
 
     void on_file_updated(FileId file_id) final {
@@ -3935,6 +4056,52 @@ void Td::init_managers() {
       "VerifyPhoneNumberManager", PhoneNumberManager::Type::VerifyPhone, create_reference());
 }
 
+template <class T>
+static auto get_update_chat_id(const T &update, int) -> decltype(static_cast<int64>(update.chat_id_)) {
+  return update.chat_id_;
+}
+
+template <class T>
+static int64 get_update_chat_id(const T &update, long) {
+  return 0;
+}
+
+static int64 get_update_chat_id(const td_api::Update &update) {
+  switch (update.get_id()) {
+    case td_api::updateNewMessage::ID:
+      return static_cast<const td_api::updateNewMessage &>(update).message_->chat_id_;
+    case td_api::updateMessageSendSucceeded::ID:
+      return static_cast<const td_api::updateMessageSendSucceeded &>(update).message_->chat_id_;
+    case td_api::updateMessageSendFailed::ID:
+      return static_cast<const td_api::updateMessageSendFailed &>(update).message_->chat_id_;
+    case td_api::updateNewChat::ID:
+      return static_cast<const td_api::updateNewChat &>(update).chat_->id_;
+    default: {
+      int64 chat_id = 0;
+      td_api::downcast_call(const_cast<td_api::Update &>(update),
+                            [&chat_id](const auto &object) { chat_id = get_update_chat_id(object, 0); });
+      return chat_id;
+    }
+  }
+}
+
+bool Td::is_update_allowed(const td_api::Update &update) const {
+  auto update_id = update.get_id();
+  if (update_id == td_api::updateAuthorizationState::ID) {
+    return true;
+  }
+  if (!update_filter_types_.empty() && update_filter_types_.count(update_id) == 0) {
+    return false;
+  }
+  if (!update_filter_chat_ids_.empty()) {
+    auto chat_id = get_update_chat_id(update);
+    if (chat_id != 0 && update_filter_chat_ids_.count(chat_id) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void Td::send_update(tl_object_ptr<td_api::Update> &&object) {
   CHECK(object != nullptr);
   auto object_id = object->get_id();
@@ -3942,6 +4109,9 @@ void Td::send_update(tl_object_ptr<td_api::Update> &&object) {
     // just in case
     return;
   }
+  if ((!update_filter_types_.empty() || !update_filter_chat_ids_.empty()) && !is_update_allowed(*object)) {
+    return;
+  }
 
   switch (object_id) {
     case td_api::updateChatThemes::ID:
@@ -3977,12 +4147,94 @@ void Td::send_update(tl_object_ptr<td_api::Update> &&object) {
       LOG(ERROR) << "Sending update: " << oneline(to_string(object));
       break;
     default:
-      VLOG(td_requests) << "Sending update: " << to_string(object);
+      VLOG(td_requests) << "Sending update: " << lazy_to_string(object);
   }
 
+  if (update_coalescing_delay_ > 0 && object_id != td_api::updateAuthorizationState::ID) {
+    return add_coalesced_update(std::move(object));
+  }
+  flush_coalesced_updates();
   callback_->on_result(0, std::move(object));
 }
 
+// returns a key, which is the same for updates, only the last of which needs to be sent, or 0 if none
+static int64 get_coalesced_update_key(const td_api::Update &update) {
+  auto get_key = [](int64 object_id, int64 type) {
+    return object_id * 16 + type;
+  };
+  switch (update.get_id()) {
+    case td_api::updateChatLastMessage::ID:
+      return get_key(static_cast<const td_api::updateChatLastMessage &>(update).chat_id_, 1);
+    case td_api::updateChatReadInbox::ID:
+      return get_key(static_cast<const td_api::updateChatReadInbox &>(update).chat_id_, 2);
+    case td_api::updateChatReadOutbox::ID:
+      return get_key(static_cast<const td_api::updateChatReadOutbox &>(update).chat_id_, 3);
+    case td_api::updateUser::ID:
+      // updateUser and updateUserStatus share the key, so they are never reordered
+      return get_key(static_cast<const td_api::updateUser &>(update).user_->id_, 4);
+    case td_api::updateUserStatus::ID:
+      return get_key(static_cast<const td_api::updateUserStatus &>(update).user_id_, 4);
+    case td_api::updateBasicGroup::ID:
+      return get_key(static_cast<const td_api::updateBasicGroup &>(update).basic_group_->id_, 5);
+    case td_api::updateSupergroup::ID:
+      return get_key(static_cast<const td_api::updateSupergroup &>(update).supergroup_->id_, 6);
+    case td_api::updateFile::ID:
+      return get_key(static_cast<const td_api::updateFile &>(update).file_->id_, 7);
+    case td_api::updateChatPosition::ID:
+    case td_api::updateChatDraftMessage::ID:
+      // the updates change chat positions like updateChatLastMessage does; return key of updateChatLastMessage
+      return -get_key(get_update_chat_id(update), 1);
+    default:
+      return 0;
+  }
+}
+
+void Td::add_coalesced_update(td_api::object_ptr<td_api::Update> &&update) {
+  auto update_id = update->get_id();
+  auto key = get_coalesced_update_key(*update);
+  if (key < 0) {
+    // a previous updateChatLastMessage must not be moved after the update
+    coalesced_update_positions_.erase(-key);
+  } else if (key > 0) {
+    auto &position = coalesced_update_positions_[key];
+    if (position != 0 && coalesced_updates_[position - 1]->get_id() == update_id) {
+      VLOG(td_requests) << "Replace pending update at position " << position - 1;
+      coalesced_updates_[position - 1] = std::move(update);
+      return;
+    }
+    position = coalesced_updates_.size() + 1;
+  }
+
+  if (coalesced_updates_.empty()) {
+    alarm_timeout_.set_timeout_in(COALESCED_UPDATES_ALARM_ID, update_coalescing_delay_);
+  }
+  coalesced_updates_.push_back(std::move(update));
+  if (coalesced_updates_.size() >= MAX_COALESCED_UPDATES) {
+    flush_coalesced_updates();
+  }
+}
+
+void Td::flush_coalesced_updates() {
+  if (coalesced_updates_.empty()) {
+    return;
+  }
+
+  alarm_timeout_.cancel_timeout(COALESCED_UPDATES_ALARM_ID);
+  coalesced_update_positions_.clear();
+  auto updates = std::move(coalesced_updates_);
+  coalesced_updates_.clear();
+  for (auto &update : updates) {
+    callback_->on_result(0, std::move(update));
+  }
+}
+
+void Td::on_update_coalescing_delay_changed() {
+  update_coalescing_delay_ = static_cast<double>(G()->get_option_integer("update_coalescing_delay_ms")) * 1e-3;
+  if (update_coalescing_delay_ <= 0) {
+    flush_coalesced_updates();
+  }
+}
+
 void Td::send_result(uint64 id, tl_object_ptr<td_api::Object> object) {
   if (id == 0) {
     LOG(ERROR) << "Sending " << to_string(object) << " through send_result";
@@ -3994,8 +4246,10 @@ void Td::send_result(uint64 id, tl_object_ptr<td_api::Object> object) {
     if (object == nullptr) {
       object = make_tl_object<td_api::error>(404, "Not Found");
     }
-    VLOG(td_requests) << "Sending result for request " << id << ": " << to_string(object);
+    VLOG(td_requests) << "Sending result for request " << id << ": " << lazy_to_string(object);
+    on_request_finished(it->second, object->get_id() == td_api::error::ID);
     request_set_.erase(it);
+    flush_coalesced_updates();
     callback_->on_result(id, std::move(object));
   }
 }
@@ -4006,10 +4260,13 @@ void Td::send_error_impl(uint64 id, tl_object_ptr<td_api::error> error) {
   auto it = request_set_.find(id);
   if (it != request_set_.end()) {
     if (error->code_ == 0 && error->message_ == "Lost promise") {
-      LOG(FATAL) << "Lost promise for query " << id << " of type " << it->second << " in close state " << close_flag_;
+      LOG(FATAL) << "Lost promise for query " << id << " of type "
+                 << td_api::get_function_name(it->second.function_index) << " in close state " << close_flag_;
     }
     VLOG(td_requests) << "Sending error for request " << id << ": " << oneline(to_string(error));
+    on_request_finished(it->second, true);
     request_set_.erase(it);
+    flush_coalesced_updates();
     callback_->on_error(id, std::move(error));
   }
 }
@@ -4800,6 +5057,18 @@ void Td::on_request(uint64 id, td_api::getDatabaseStatistics &request) {
   send_closure(storage_manager_, &StorageManager::get_database_stats, std::move(query_promise));
 }
 
+void Td::on_request(uint64 id, const td_api::getMemoryStatistics &request) {
+  CREATE_REQUEST_PROMISE();
+  MemoryStatisticsEntries entries;
+  messages_manager_->get_memory_statistics(entries);
+  contacts_manager_->get_memory_statistics(entries);
+  stickers_manager_->get_memory_statistics(entries);
+  file_manager_->get_memory_statistics(entries);
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "BufferAllocator", "buffers", 0, static_cast<int64>(BufferAllocator::get_buffer_mem())));
+  promise.set_value(td_api::make_object<td_api::memoryStatistics>(std::move(entries)));
+}
+
 void Td::on_request(uint64 id, td_api::optimizeStorage &request) {
   std::vector<FileType> file_types;
   for (auto &file_type : request.file_types_) {
@@ -4863,6 +5132,24 @@ void Td::on_request(uint64 id, td_api::resetNetworkStatistics &request) {
   promise.set_value(Unit());
 }
 
+void Td::on_request(uint64 id, const td_api::getNetworkQueryStatistics &request) {
+  if (td_options_.net_query_stats == nullptr) {
+    return send_error_raw(id, 400, "Network query statistics are unavailable");
+  }
+  CREATE_REQUEST_PROMISE();
+  auto statistics = td_options_.net_query_stats->get_statistics();
+  if (request.reset_) {
+    td_options_.net_query_stats->clear_statistics();
+  }
+  promise.set_value(td_api::make_object<td_api::networkQueryStatistics>(
+      transform(statistics, [](const NetQueryStats::ConstructorStatistics &entry) {
+        return td_api::make_object<td_api::networkQueryStatisticsEntry>(
+            entry.tl_constructor, static_cast<int64>(entry.query_count), static_cast<int64>(entry.error_count),
+            static_cast<int64>(entry.sent_bytes), static_cast<int64>(entry.received_bytes), entry.latency_p50,
+            entry.latency_p99);
+      })));
+}
+
 void Td::on_request(uint64 id, td_api::addNetworkStatistics &request) {
   if (request.entry_ == nullptr) {
     return send_error_raw(id, 400, "Network statistics entry must be non-empty");
@@ -4920,6 +5207,24 @@ void Td::on_request(uint64 id, const td_api::setNetworkType &request) {
   promise.set_value(Unit());
 }
 
+void Td::on_request(uint64 id, const td_api::hibernate &request) {
+  auto r_old_mem_stat = mem_stat();
+
+  is_hibernated_ = true;
+  send_closure(state_manager_, &StateManager::on_hibernate, true);
+  auto unloaded_message_count = messages_manager_->unload_all_messages();
+  G()->td_db()->flush_all();
+
+  int64 released_memory_size = 0;
+  auto r_new_mem_stat = mem_stat();
+  if (r_old_mem_stat.is_ok() && r_new_mem_stat.is_ok() &&
+      r_old_mem_stat.ok().resident_size_ > r_new_mem_stat.ok().resident_size_) {
+    released_memory_size = static_cast<int64>(r_old_mem_stat.ok().resident_size_ - r_new_mem_stat.ok().resident_size_);
+  }
+  send_closure(actor_id(this), &Td::send_result, id,
+               td_api::make_object<td_api::hibernationResult>(unloaded_message_count, released_memory_size));
+}
+
 void Td::on_request(uint64 id, const td_api::getAutoDownloadSettingsPresets &request) {
   CHECK_IS_USER();
   CREATE_REQUEST_PROMISE();
@@ -5463,6 +5768,17 @@ void Td::on_request(uint64 id, td_api::sendMessageAlbum &request) {
   }
 }
 
+void Td::on_request(uint64 id, td_api::sendMessageToChats &request) {
+  auto r_bulk_message_send = messages_manager_->send_message_to_dialogs(
+      transform(request.chat_ids_, [](int64 chat_id) { return DialogId(chat_id); }), std::move(request.options_),
+      std::move(request.input_message_content_));
+  if (r_bulk_message_send.is_error()) {
+    send_closure(actor_id(this), &Td::send_error, id, r_bulk_message_send.move_as_error());
+  } else {
+    send_closure(actor_id(this), &Td::send_result, id, r_bulk_message_send.move_as_ok());
+  }
+}
+
 void Td::on_request(uint64 id, td_api::sendBotStartMessage &request) {
   CHECK_IS_USER();
   CLEAN_INPUT_STRING(request.parameter_);
@@ -8243,6 +8559,26 @@ void Td::on_request(uint64 id, td_api::answerCustomQuery &request) {
   create_handler<AnswerCustomQueryQuery>(std::move(promise))->send(request.custom_query_id_, request.data_);
 }
 
+void Td::on_request(uint64 id, const td_api::setUpdateFilter &request) {
+  FlatHashSet<int32> update_types;
+  for (auto update_type : request.update_types_) {
+    if (update_type == 0) {
+      return send_error_raw(id, 400, "Invalid update type specified");
+    }
+    update_types.insert(update_type);
+  }
+  FlatHashSet<int64> chat_ids;
+  for (auto chat_id : request.chat_ids_) {
+    if (!DialogId(chat_id).is_valid()) {
+      return send_error_raw(id, 400, "Invalid chat identifier specified");
+    }
+    chat_ids.insert(chat_id);
+  }
+  update_filter_types_ = std::move(update_types);
+  update_filter_chat_ids_ = std::move(chat_ids);
+  send_closure(actor_id(this), &Td::send_result, id, td_api::make_object<td_api::ok>());
+}
+
 void Td::on_request(uint64 id, const td_api::setAlarm &request) {
   if (request.seconds_ < 0 || request.seconds_ > 3e9) {
     return send_error_raw(id, 400, "Wrong parameter seconds specified");
@@ -8524,6 +8860,10 @@ void Td::on_request(uint64 id, const td_api::getPushReceiverId &request) {
   UNREACHABLE();
 }
 
+void Td::on_request(uint64 id, const td_api::decryptPushNotification &request) {
+  UNREACHABLE();
+}
+
 void Td::on_request(uint64 id, const td_api::getChatFilterDefaultIconName &request) {
   UNREACHABLE();
 }
@@ -8572,6 +8912,42 @@ void Td::on_request(uint64 id, const td_api::addLogMessage &request) {
   UNREACHABLE();
 }
 
+void Td::on_request(uint64 id, const td_api::toggleActorStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getActorStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::toggleLockStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getLockStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::toggleRequestStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getRequestStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::toggleRequestTracing &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getRequestTraces &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::setMetricsExporterPort &request) {
+  UNREACHABLE();
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getTextEntities &request) {
   if (!check_utf8(request.text_)) {
     return make_error(400, "Text must be encoded in UTF-8");
@@ -8702,6 +9078,26 @@ td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getPushRe
   return td_api::make_object<td_api::pushReceiverId>(r_push_receiver_id.ok());
 }
 
+td_api::object_ptr<td_api::Object> Td::do_static_request(td_api::decryptPushNotification &request) {
+  // don't check push payload UTF-8 correctness
+  TdParameters parameters;
+  parameters.use_test_dc = request.use_test_dc_;
+  parameters.database_directory = std::move(request.database_directory_);
+  if (parameters.database_directory.empty()) {
+    parameters.database_directory = ".";
+  }
+  if (parameters.database_directory.back() != TD_DIR_SLASH) {
+    parameters.database_directory += TD_DIR_SLASH;
+  }
+  auto r_notification = NotificationManager::decrypt_push_notification(
+      parameters, as_db_key(std::move(request.database_encryption_key_)), std::move(request.payload_));
+  if (r_notification.is_error()) {
+    VLOG(notifications) << "Failed to decrypt push notification: " << r_notification.error();
+    return make_error(r_notification.error().code(), r_notification.error().message());
+  }
+  return r_notification.move_as_ok();
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getChatFilterDefaultIconName &request) {
   if (request.filter_ == nullptr) {
     return make_error(400, "Chat filter must be non-empty");
@@ -8793,6 +9189,91 @@ td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::addLogMes
   return td_api::make_object<td_api::ok>();
 }
 
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::toggleActorStatistics &request) {
+  ActorStatistics::set_enabled(request.is_enabled_);
+  return td_api::make_object<td_api::ok>();
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getActorStatistics &request) {
+  auto statistics = ActorStatistics::get_statistics();
+  if (request.reset_) {
+    ActorStatistics::clear();
+  }
+  auto get_histogram = [](const ActorStatistics::Histogram &histogram) {
+    return transform(histogram, [](uint64 count) { return static_cast<int64>(count); });
+  };
+  return td_api::make_object<td_api::actorStatistics>(
+      transform(statistics, [&get_histogram](const ActorStatistics::Entry &entry) {
+        return td_api::make_object<td_api::actorStatisticsByName>(entry.name, static_cast<int64>(entry.event_count),
+                                                                   get_histogram(entry.wait_time),
+                                                                   get_histogram(entry.run_time));
+      }));
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::toggleLockStatistics &request) {
+  LockStatistics::set_enabled(request.is_enabled_);
+  return td_api::make_object<td_api::ok>();
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getLockStatistics &request) {
+  auto statistics = LockStatistics::get_statistics();
+  if (request.reset_) {
+    LockStatistics::clear();
+  }
+  auto get_histogram = [](const LockStatistics::Histogram &histogram) {
+    return transform(histogram, [](uint64 count) { return static_cast<int64>(count); });
+  };
+  return td_api::make_object<td_api::lockStatistics>(
+      transform(statistics, [&get_histogram](const LockStatistics::Entry &entry) {
+        return td_api::make_object<td_api::lockStatisticsByName>(
+            entry.name, entry.is_shared, static_cast<int64>(entry.lock_count),
+            static_cast<int64>(entry.contended_lock_count), entry.total_wait_time, get_histogram(entry.wait_time),
+            get_histogram(entry.hold_time));
+      }));
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::toggleRequestStatistics &request) {
+  RequestStatistics::set_enabled(request.is_enabled_);
+  return td_api::make_object<td_api::ok>();
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getRequestStatistics &request) {
+  auto statistics = RequestStatistics::get_statistics();
+  if (request.reset_) {
+    RequestStatistics::clear();
+  }
+  return td_api::make_object<td_api::requestStatistics>(
+      transform(statistics, [](const RequestStatistics::Entry &entry) {
+        return td_api::make_object<td_api::requestStatisticsByType>(
+            entry.request_type, static_cast<int64>(entry.request_count), static_cast<int64>(entry.error_count),
+            transform(entry.latency, [](uint64 count) { return static_cast<int64>(count); }));
+      }));
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::toggleRequestTracing &request) {
+  if (request.sampling_period_ <= 0) {
+    return make_error(400, "Sampling period must be positive");
+  }
+  RequestTracer::set_enabled(request.is_enabled_, request.sampling_period_);
+  return td_api::make_object<td_api::ok>();
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getRequestTraces &request) {
+  auto trace = RequestTracer::get_chrome_trace();
+  if (request.reset_) {
+    RequestTracer::clear();
+  }
+  return td_api::make_object<td_api::text>(std::move(trace));
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::setMetricsExporterPort &request) {
+  auto status = MetricsExporter::set_port(request.port_);
+  if (status.is_error()) {
+    return make_error(status.code(), status.message());
+  }
+  return td_api::make_object<td_api::ok>();
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(td_api::testReturnError &request) {
   if (request.error_ == nullptr) {
     return td_api::make_object<td_api::error>(404, "Not Found");
@@ -27,6 +27,7 @@
 #include "td/utils/common.h"
 #include "td/utils/Container.h"
 #include "td/utils/FlatHashMap.h"
+#include "td/utils/FlatHashSet.h"
 #include "td/utils/logging.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
@@ -73,6 +74,7 @@ class PrivacyManager;
 class SecureManager;
 class SecretChatsManager;
 class SponsoredMessageManager;
+class StartupProfiler;
 class StateManager;
 class StickersManager;
 class StorageManager;
@@ -253,6 +255,14 @@ class Td final : public Actor {
 
   void send_update(tl_object_ptr<td_api::Update> &&object);
 
+  void on_update_coalescing_delay_changed();
+
+  // adds an initialization phase, which has started at start_time and has finished now; ignored after initialization
+  void add_startup_phase(string name, double start_time, int64 count = 0, int64 size = 0);
+
+  // sends updateStartupTimeline; must be called once the client is ready
+  void finish_startup_profiling();
+
   static td_api::object_ptr<td_api::Object> static_request(td_api::object_ptr<td_api::Function> function);
 
  private:
@@ -261,6 +271,8 @@ class Td final : public Actor {
   static constexpr int32 PING_SERVER_TIMEOUT = 300;
   static constexpr int64 TERMS_OF_SERVICE_ALARM_ID = -2;
   static constexpr int64 PROMO_DATA_ALARM_ID = -3;
+  static constexpr int64 COALESCED_UPDATES_ALARM_ID = -4;
+  static constexpr size_t MAX_COALESCED_UPDATES = 1000;
 
   void on_connection_state_changed(ConnectionState new_state);
 
@@ -283,6 +295,8 @@ class Td final : public Actor {
   void close();
   void on_closed();
 
+  void on_close_phase_finished(const char *phase);
+
   void dec_stop_cnt();
 
   unique_ptr<TdCallback> callback_;
@@ -294,12 +308,27 @@ class Td final : public Actor {
 
   ConnectionState connection_state_ = ConnectionState::Empty;
 
-  std::unordered_multimap<uint64, int32> request_set_;
+  struct RequestInfo {
+    int32 function_index = -1;
+    double start_time = 0.0;  // 0 if request statistics and tracing were disabled when the request was received
+    uint32 trace_id = 0;      // 0 if the request isn't traced
+
+    RequestInfo(int32 function_index, double start_time, uint32 trace_id)
+        : function_index(function_index), start_time(start_time), trace_id(trace_id) {
+    }
+  };
+  void on_request_finished(const RequestInfo &request_info, bool is_error);
+
+  std::unordered_multimap<uint64, RequestInfo> request_set_;
   int actor_refcnt_ = 0;
   int request_actor_refcnt_ = 0;
   int stop_cnt_ = 2;
   bool destroy_flag_ = false;
   int close_flag_ = 0;
+  double close_start_time_ = 0.0;
+  double close_phase_start_time_ = 0.0;
+
+  unique_ptr<StartupProfiler> startup_profiler_;
 
   enum class State : int32 { WaitParameters, Run, Close } state_ = State::WaitParameters;
   uint64 set_parameters_request_id_ = 0;
@@ -310,6 +339,15 @@ class Td final : public Actor {
 
   bool is_online_ = false;
   bool is_bot_online_ = false;
+  bool is_hibernated_ = false;
+
+  FlatHashSet<int32> update_filter_types_;
+  FlatHashSet<int64> update_filter_chat_ids_;
+
+  double update_coalescing_delay_ = 0.0;
+  vector<td_api::object_ptr<td_api::Update>> coalesced_updates_;
+  FlatHashMap<int64, size_t> coalesced_update_positions_;  // coalescing key -> position in coalesced_updates_ + 1
+
   NetQueryRef update_status_query_;
 
   int64 alarm_id_ = 1;
@@ -393,6 +431,12 @@ class Td final : public Actor {
 
   static bool is_preauthentication_request(int32 id);
 
+  bool is_update_allowed(const td_api::Update &update) const;
+
+  void add_coalesced_update(td_api::object_ptr<td_api::Update> &&update);
+
+  void flush_coalesced_updates();
+
   template <class T>
   void on_request(uint64 id, const T &request) = delete;
 
@@ -576,16 +620,24 @@ class Td final : public Actor {
 
   void on_request(uint64 id, td_api::getDatabaseStatistics &request);
 
+  void on_request(uint64 id, const td_api::getMemoryStatistics &request);
+
   void on_request(uint64 id, td_api::optimizeStorage &request);
 
   void on_request(uint64 id, td_api::getNetworkStatistics &request);
 
   void on_request(uint64 id, td_api::resetNetworkStatistics &request);
 
+  void on_request(uint64 id, const td_api::getNetworkQueryStatistics &request);
+
   void on_request(uint64 id, td_api::addNetworkStatistics &request);
 
   void on_request(uint64 id, const td_api::setNetworkType &request);
 
+  void on_request(uint64 id, const td_api::hibernate &request);
+
+  void on_request(uint64 id, const td_api::setUpdateFilter &request);
+
   void on_request(uint64 id, const td_api::getAutoDownloadSettingsPresets &request);
 
   void on_request(uint64 id, const td_api::setAutoDownloadSettings &request);
@@ -732,6 +784,8 @@ class Td final : public Actor {
 
   void on_request(uint64 id, td_api::sendMessageAlbum &request);
 
+  void on_request(uint64 id, td_api::sendMessageToChats &request);
+
   void on_request(uint64 id, td_api::sendBotStartMessage &request);
 
   void on_request(uint64 id, td_api::sendInlineQueryResultMessage &request);
@@ -1520,6 +1574,8 @@ class Td final : public Actor {
 
   void on_request(uint64 id, const td_api::getPushReceiverId &request);
 
+  void on_request(uint64 id, const td_api::decryptPushNotification &request);
+
   void on_request(uint64 id, const td_api::getChatFilterDefaultIconName &request);
 
   void on_request(uint64 id, const td_api::getJsonValue &request);
@@ -1544,6 +1600,24 @@ class Td final : public Actor {
 
   void on_request(uint64 id, const td_api::addLogMessage &request);
 
+  void on_request(uint64 id, const td_api::toggleActorStatistics &request);
+
+  void on_request(uint64 id, const td_api::getActorStatistics &request);
+
+  void on_request(uint64 id, const td_api::toggleLockStatistics &request);
+
+  void on_request(uint64 id, const td_api::getLockStatistics &request);
+
+  void on_request(uint64 id, const td_api::toggleRequestStatistics &request);
+
+  void on_request(uint64 id, const td_api::getRequestStatistics &request);
+
+  void on_request(uint64 id, const td_api::toggleRequestTracing &request);
+
+  void on_request(uint64 id, const td_api::getRequestTraces &request);
+
+  void on_request(uint64 id, const td_api::setMetricsExporterPort &request);
+
   // test
   void on_request(uint64 id, const td_api::testNetwork &request);
   void on_request(uint64 id, td_api::testProxy &request);
@@ -1574,6 +1648,7 @@ class Td final : public Actor {
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getLanguagePackString &request);
   static td_api::object_ptr<td_api::Object> do_static_request(td_api::getPhoneNumberInfoSync &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getPushReceiverId &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(td_api::decryptPushNotification &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getChatFilterDefaultIconName &request);
   static td_api::object_ptr<td_api::Object> do_static_request(td_api::getJsonValue &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getJsonString &request);
@@ -1586,6 +1661,15 @@ class Td final : public Actor {
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::setLogTagVerbosityLevel &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getLogTagVerbosityLevel &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::addLogMessage &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::toggleActorStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getActorStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::toggleLockStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getLockStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::toggleRequestStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getRequestStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::toggleRequestTracing &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getRequestTraces &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::setMetricsExporterPort &request);
   static td_api::object_ptr<td_api::Object> do_static_request(td_api::testReturnError &request);
 
   static DbKey as_db_key(string key);
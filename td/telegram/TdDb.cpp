@@ -20,15 +20,19 @@
 #include "td/db/binlog/Binlog.h"
 #include "td/db/binlog/ConcurrentBinlog.h"
 #include "td/db/BinlogKeyValue.h"
+#include "td/db/SqliteCacheBudget.h"
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteIncrementalVacuum.h"
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueAsync.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteReadPool.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/MultiPromise.h"
 
+#include "td/utils/algorithm.h"
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
@@ -36,11 +40,14 @@
 #include "td/utils/port/Clocks.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
+#include <utility>
 
 namespace td {
 
@@ -69,6 +76,8 @@ Status init_binlog(Binlog &binlog, string path, BinlogKeyValue<Binlog> &binlog_p
   }
 
   auto callback = [&](const BinlogEvent &event) {
+    events.binlog_event_count++;
+    events.binlog_event_size += event.size_;
     switch (event.type_) {
       case LogEvent::HandlerType::SecretChats:
         events.to_secret_chats_manager.push_back(event.clone());
@@ -275,6 +284,11 @@ void TdDb::do_close(Promise<> on_finished, bool destroy_flag) {
       }));
   auto lock = mpas.get_promise();
 
+  if (sqlite_incremental_vacuum_) {
+    sqlite_incremental_vacuum_->close(mpas.get_promise());
+    sqlite_incremental_vacuum_.reset();
+  }
+
   if (file_db_) {
     file_db_->close(mpas.get_promise());
     file_db_.reset();
@@ -318,31 +332,45 @@ void TdDb::do_close(Promise<> on_finished, bool destroy_flag) {
   lock.set_value(Unit());
 }
 
-Status TdDb::init_sqlite(const TdParameters &parameters, const DbKey &key, const DbKey &old_key,
-                         BinlogKeyValue<Binlog> &binlog_pmc) {
-  CHECK(!parameters.use_message_db || parameters.use_chat_info_db);
-  CHECK(!parameters.use_chat_info_db || parameters.use_file_db);
-
-  const string sql_database_path = get_sqlite_path(parameters);
+struct TdDb::SqliteInitState {
+  SqliteDb db;
+  int32 user_version = 0;
+  vector<TdDb::OpenPhase> timings;
+};
 
-  bool use_sqlite = parameters.use_file_db;
-  bool use_file_db = parameters.use_file_db;
-  bool use_dialog_db = parameters.use_message_db;
+Status TdDb::open_sqlite(const TdParameters &parameters, const string &path, const DbKey &key, const DbKey &old_key,
+                         SqliteInitState &state) {
   bool use_message_thread_db = parameters.use_message_db && false;
   bool use_message_db = parameters.use_message_db;
-  if (!use_sqlite) {
-    SqliteDb::destroy(sql_database_path).ignore();
-    return Status::OK();
-  }
 
-  sqlite_path_ = sql_database_path;
-  TRY_RESULT(db_instance, SqliteDb::change_key(sqlite_path_, true, key, old_key));
-  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_database_path, key, db_instance.get_cipher_version());
-  sql_connection_->set(std::move(db_instance));
-  auto &db = sql_connection_->get();
+  auto start_time = Time::now();
+  TRY_RESULT_ASSIGN(state.db, SqliteDb::change_key(path, true, key, old_key));
+  auto &db = state.db;
   TRY_STATUS(db.exec("PRAGMA journal_mode=WAL"));
   TRY_STATUS(db.exec("PRAGMA secure_delete=1"));
 
+  // free pages are returned to the file system in background by SqliteIncrementalVacuum
+  // a failed migration isn't fatal, because the database remains usable
+  TRY_RESULT(auto_vacuum, db.get_pragma_string("auto_vacuum"));
+  if (auto_vacuum != "2") {
+    auto migration_start_time = Time::now();
+    auto status = db.exec("PRAGMA auto_vacuum=INCREMENTAL");
+    if (status.is_ok()) {
+      TRY_RESULT(page_count, db.get_pragma_string("page_count"));
+      if (page_count != "0") {
+        // auto_vacuum mode of an existing database can be changed only by rebuilding it
+        LOG(WARNING) << "Change auto_vacuum mode of the database with " << page_count << " pages";
+        status = db.exec("VACUUM");
+      }
+    }
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to enable incremental vacuum: " << status;
+    }
+    auto migration_time = Time::now() - migration_start_time;
+    state.timings.emplace_back("SQLite auto_vacuum migration", migration_start_time, migration_time);
+    start_time += migration_time;
+  }
+
   // Init databases
   // Do initialization once and before everything else to avoid "database is locked" error.
   // Must be in a transaction
@@ -351,37 +379,73 @@ Status TdDb::init_sqlite(const TdParameters &parameters, const DbKey &key, const
   TRY_STATUS(db.exec("BEGIN TRANSACTION"));
 
   // Get 'PRAGMA user_version'
-  TRY_RESULT(user_version, db.user_version());
-  LOG(INFO) << "Have PRAGMA user_version = " << user_version;
+  TRY_RESULT_ASSIGN(state.user_version, db.user_version());
+  LOG(INFO) << "Have PRAGMA user_version = " << state.user_version;
+  auto user_version = state.user_version;
+  state.timings.emplace_back("SQLite open", start_time, Time::now() - start_time);
 
-  // init DialogDb
-  bool dialog_db_was_created = false;
-  if (use_dialog_db) {
-    TRY_STATUS(init_dialog_db(db, user_version, binlog_pmc, dialog_db_was_created));
-  } else {
-    TRY_STATUS(drop_dialog_db(db, user_version));
-  }
+  // DialogDb is initialized later, because its migrations can change the binlog
 
   // init MessageThreadDb
+  start_time = Time::now();
   if (use_message_thread_db) {
     TRY_STATUS(init_message_thread_db(db, user_version));
   } else {
     TRY_STATUS(drop_message_thread_db(db, user_version));
   }
+  state.timings.emplace_back("message thread database", start_time, Time::now() - start_time);
 
   // init MessageDb
+  start_time = Time::now();
   if (use_message_db) {
     TRY_STATUS(init_message_db(db, user_version));
   } else {
     TRY_STATUS(drop_message_db(db, user_version));
   }
+  state.timings.emplace_back("message database", start_time, Time::now() - start_time);
 
   // init filesDb
-  if (use_file_db) {
-    TRY_STATUS(init_file_db(db, user_version));
+  start_time = Time::now();
+  TRY_STATUS(init_file_db(db, user_version));
+  state.timings.emplace_back("file database", start_time, Time::now() - start_time);
+
+  return Status::OK();
+}
+
+Status TdDb::init_sqlite(const TdParameters &parameters, const DbKey &key, const DbKey &old_key,
+                         BinlogKeyValue<Binlog> &binlog_pmc, SqliteInitState &state) {
+  CHECK(!parameters.use_message_db || parameters.use_chat_info_db);
+  CHECK(!parameters.use_chat_info_db || parameters.use_file_db);
+
+  const string sql_database_path = get_sqlite_path(parameters);
+
+  bool use_sqlite = parameters.use_file_db;
+  bool use_dialog_db = parameters.use_message_db;
+  bool use_message_thread_db = parameters.use_message_db && false;
+  bool use_message_db = parameters.use_message_db;
+  if (!use_sqlite) {
+    SqliteDb::destroy(sql_database_path).ignore();
+    return Status::OK();
+  }
+
+  sqlite_path_ = sql_database_path;
+  if (state.db.empty()) {
+    TRY_STATUS(open_sqlite(parameters, sql_database_path, key, old_key, state));
+  }
+  auto user_version = state.user_version;
+  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_database_path, key, state.db.get_cipher_version());
+  sql_connection_->set(std::move(state.db));
+  auto &db = sql_connection_->get();
+
+  // init DialogDb
+  auto start_time = Time::now();
+  bool dialog_db_was_created = false;
+  if (use_dialog_db) {
+    TRY_STATUS(init_dialog_db(db, user_version, binlog_pmc, dialog_db_was_created));
   } else {
-    TRY_STATUS(drop_file_db(db, user_version));
+    TRY_STATUS(drop_dialog_db(db, user_version));
   }
+  state.timings.emplace_back("dialog database", start_time, Time::now() - start_time);
 
   // Update 'PRAGMA user_version'
   auto db_version = current_db_version();
@@ -411,14 +475,21 @@ Status TdDb::init_sqlite(const TdParameters &parameters, const DbKey &key, const
 
   TRY_STATUS(db.exec("COMMIT TRANSACTION"));
 
-  file_db_ = create_file_db(sql_connection_);
+  // read queries are run on the next scheduler, which has its own database connection
+  std::shared_ptr<SqliteReadPool> read_pool;
+  auto read_scheduler_id = min(Scheduler::instance()->sched_id() + 1, Scheduler::instance()->sched_count() - 1);
+  if (read_scheduler_id != Scheduler::instance()->sched_id()) {
+    read_pool = std::make_shared<SqliteReadPool>(vector<int32>{read_scheduler_id});
+  }
+
+  file_db_ = create_file_db(sql_connection_, -1, read_pool);
 
   common_kv_safe_ = std::make_shared<SqliteKeyValueSafe>("common", sql_connection_);
   common_kv_async_ = create_sqlite_key_value_async(common_kv_safe_);
 
   if (use_dialog_db) {
     dialog_db_sync_safe_ = create_dialog_db_sync(sql_connection_);
-    dialog_db_async_ = create_dialog_db_async(dialog_db_sync_safe_);
+    dialog_db_async_ = create_dialog_db_async(dialog_db_sync_safe_, -1, read_pool);
   }
 
   if (use_message_thread_db) {
@@ -428,9 +499,11 @@ Status TdDb::init_sqlite(const TdParameters &parameters, const DbKey &key, const
 
   if (use_message_db) {
     message_db_sync_safe_ = create_message_db_sync(sql_connection_);
-    message_db_async_ = create_message_db_async(message_db_sync_safe_);
+    message_db_async_ = create_message_db_async(message_db_sync_safe_, -1, read_pool);
   }
 
+  sqlite_incremental_vacuum_ = td::make_unique<SqliteIncrementalVacuum>(sql_connection_);
+
   return Status::OK();
 }
 
@@ -457,9 +530,26 @@ void TdDb::open_impl(TdParameters parameters, DbKey key, Promise<OpenedDatabase>
   config_pmc->external_init_begin(static_cast<int32>(LogEvent::HandlerType::ConfigPmcMagic));
 
   bool encrypt_binlog = !key.is_empty();
+
+  // the SQLite database key is stored in the binlog and is known in advance only if the binlog isn't encrypted,
+  // so the SQLite database can be opened while the binlog is replayed; the result is dropped if the guess was wrong
+  SqliteInitState sqlite_state;
+  Status parallel_sqlite_status;
+  thread sqlite_thread;
+  if (parameters.use_file_db && !encrypt_binlog) {
+    sqlite_thread = thread([&] {
+      parallel_sqlite_status =
+          open_sqlite(parameters, get_sqlite_path(parameters), DbKey::empty(), DbKey::empty(), sqlite_state);
+    });
+  }
+
   VLOG(td_init) << "Start binlog loading";
-  TRY_STATUS_PROMISE(
-      promise, init_binlog(*binlog, get_binlog_path(parameters), *binlog_pmc, *config_pmc, result, std::move(key)));
+  auto start_time = Time::now();
+  auto init_binlog_status =
+      init_binlog(*binlog, get_binlog_path(parameters), *binlog_pmc, *config_pmc, result, std::move(key));
+  auto binlog_replay_time = Time::now() - start_time;
+  sqlite_thread.join();
+  TRY_STATUS_PROMISE(promise, std::move(init_binlog_status));
   VLOG(td_init) << "Finish binlog loading";
 
   binlog_pmc->external_init_finish(binlog);
@@ -467,7 +557,16 @@ void TdDb::open_impl(TdParameters parameters, DbKey key, Promise<OpenedDatabase>
   config_pmc->external_init_finish(binlog);
   VLOG(td_init) << "Finish initialization of config PMC";
 
-  if (parameters.use_file_db && binlog_pmc->get("auth").empty()) {
+  auto sqlite_key = binlog_pmc->get("sqlite_key");
+  bool destroy_sqlite = parameters.use_file_db && binlog_pmc->get("auth").empty();
+  if (parallel_sqlite_status.is_error()) {
+    LOG(INFO) << "Failed to open SQLite database in parallel with binlog: " << parallel_sqlite_status;
+  }
+  if (parallel_sqlite_status.is_error() || destroy_sqlite || !sqlite_key.empty()) {
+    sqlite_state = SqliteInitState();
+  }
+
+  if (destroy_sqlite) {
     LOG(INFO) << "Destroy SQLite database, because wasn't authorized yet";
     SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
   }
@@ -476,7 +575,6 @@ void TdDb::open_impl(TdParameters parameters, DbKey key, Promise<OpenedDatabase>
   DbKey old_sqlite_key;
   bool encrypt_sqlite = encrypt_binlog;
   bool drop_sqlite_key = false;
-  auto sqlite_key = binlog_pmc->get("sqlite_key");
   if (encrypt_sqlite) {
     if (sqlite_key.empty()) {
       sqlite_key = string(32, ' ');
@@ -493,19 +591,23 @@ void TdDb::open_impl(TdParameters parameters, DbKey key, Promise<OpenedDatabase>
   }
   VLOG(td_init) << "Start to init database";
   auto db = make_unique<TdDb>();
-  auto init_sqlite_status = db->init_sqlite(parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc);
+  sqlite_state.timings.emplace(sqlite_state.timings.begin(), "binlog replay", start_time, binlog_replay_time);
+  auto init_sqlite_status = db->init_sqlite(parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc, sqlite_state);
   VLOG(td_init) << "Finish to init database";
   if (init_sqlite_status.is_error()) {
     LOG(ERROR) << "Destroy bad SQLite database because of " << init_sqlite_status;
     if (db->sql_connection_ != nullptr) {
       db->sql_connection_->get().close();
     }
+    sqlite_state = SqliteInitState();
+    sqlite_state.timings.emplace_back("binlog replay", start_time, binlog_replay_time);
     SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
-    init_sqlite_status = db->init_sqlite(parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc);
+    init_sqlite_status = db->init_sqlite(parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc, sqlite_state);
     if (init_sqlite_status.is_error()) {
       return promise.set_error(Status::Error(400, init_sqlite_status.message()));
     }
   }
+  db->open_phases_ = std::move(sqlite_state.timings);
   if (drop_sqlite_key) {
     binlog_pmc->erase("sqlite_key");
     binlog_pmc->force_sync(Auto());
@@ -586,6 +688,27 @@ void TdDb::change_key(DbKey key, Promise<> promise) {
   get_binlog()->change_key(std::move(key), std::move(promise));
 }
 
+Result<vector<string>> TdDb::get_binlog_pmc_values_read_only(const TdParameters &parameters, DbKey key,
+                                                             const vector<string> &keys) {
+  BinlogKeyValue<Binlog> binlog_pmc;
+  binlog_pmc.external_init_begin(static_cast<int32>(LogEvent::HandlerType::BinlogPmcMagic));
+  auto status = Binlog::replay_read_only(
+      get_binlog_path(parameters),
+      [&binlog_pmc](const BinlogEvent &event) {
+        if (event.type_ == static_cast<int32>(LogEvent::HandlerType::BinlogPmcMagic)) {
+          binlog_pmc.external_init_handle(event);
+        }
+      },
+      std::move(key));
+  if (status.is_error()) {
+    if (status.code() == static_cast<int>(Binlog::Error::WrongPassword)) {
+      return Status::Error(401, "Wrong database encryption key");
+    }
+    return Status::Error(400, status.message());
+  }
+  return transform(keys, [&binlog_pmc](const string &key) { return binlog_pmc.get(key); });
+}
+
 Status TdDb::destroy(const TdParameters &parameters) {
   SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
   Binlog::destroy(get_binlog_path(parameters)).ignore();
@@ -599,6 +722,10 @@ void TdDb::with_db_path(const std::function<void(CSlice)> &callback) {
 
 Result<string> TdDb::get_stats() {
   auto sb = StringBuilder({}, true);
+  sb << "Database open time:\n";
+  for (auto &phase : open_phases_) {
+    sb << phase.name << ":\t" << format::as_time(phase.duration) << "\n";
+  }
   auto &sql = sql_connection_->get();
   auto run_query = [&](CSlice query, Slice desc) -> Status {
     TRY_RESULT(stmt, sql.get_statement(query));
@@ -632,6 +759,21 @@ Result<string> TdDb::get_stats() {
   TRY_STATUS(run_kv_query("ch%"));
   TRY_STATUS(run_kv_query("ss%"));
   TRY_STATUS(run_kv_query("gr%"));
+  TRY_RESULT(page_count, sql.get_pragma_string("page_count"));
+  TRY_RESULT(free_page_count, sql.get_pragma_string("freelist_count"));
+  TRY_RESULT(auto_vacuum, sql.get_pragma_string("auto_vacuum"));
+  sb << "Database pages:\t" << page_count << "\tfree:\t" << free_page_count << "\tauto_vacuum:\t" << auto_vacuum
+     << "\n";
+
+  auto cache_budget = SqliteCacheBudget::get_budget();
+  if (cache_budget != 0) {
+    sb << "Page cache budget:\t" << format::as_size(cache_budget) << "\n";
+    for (auto &stat : SqliteCacheBudget::get_statistics()) {
+      sb << stat.path << ":\tsize:\t" << format::as_size(stat.cache_size) << "\tused:\t"
+         << format::as_size(stat.cache_used) << "\thits:\t" << stat.hit_count << "\tmisses:\t" << stat.miss_count
+         << "\n";
+    }
+  }
 
   vector<int32> prev(1);
   size_t count = 0;
@@ -19,6 +19,7 @@
 
 #include <functional>
 #include <memory>
+#include <utility>
 
 namespace td {
 
@@ -37,6 +38,7 @@ class MessageThreadDbSyncInterface;
 class MessageThreadDbSyncSafeInterface;
 class MessageThreadDbAsyncInterface;
 class SqliteConnectionSafe;
+class SqliteIncrementalVacuum;
 class SqliteKeyValueSafe;
 class SqliteKeyValueAsyncInterface;
 class SqliteKeyValue;
@@ -50,6 +52,16 @@ class TdDb {
   TdDb &operator=(TdDb &&) = delete;
   ~TdDb();
 
+  struct OpenPhase {
+    string name;
+    double start_time = 0.0;
+    double duration = 0.0;
+
+    OpenPhase(string name, double start_time, double duration)
+        : name(std::move(name)), start_time(start_time), duration(duration) {
+    }
+  };
+
   struct OpenedDatabase {
     string database_directory;
     string files_directory;
@@ -69,11 +81,18 @@ class TdDb {
     vector<BinlogEvent> to_notification_settings_manager;
 
     int64 since_last_open = 0;
+    int64 binlog_event_count = 0;
+    int64 binlog_event_size = 0;
   };
   static void open(int32 scheduler_id, TdParameters parameters, DbKey key, Promise<OpenedDatabase> &&promise);
 
   static Status destroy(const TdParameters &parameters);
 
+  // replays only the binlog key-value storage without locking or changing the binlog, so the database can be opened
+  // by another TDLib instance at the same time; returns values of the given keys, or empty strings for absent keys
+  static Result<vector<string>> get_binlog_pmc_values_read_only(const TdParameters &parameters, DbKey key,
+                                                                const vector<string> &keys);
+
   std::shared_ptr<FileDbInterface> get_file_db_shared();
   std::shared_ptr<SqliteConnectionSafe> &get_sqlite_connection_safe();
 #define get_binlog() get_binlog_impl(__FILE__, __LINE__)
@@ -112,9 +131,14 @@ class TdDb {
 
   Result<string> get_stats();
 
+  const vector<OpenPhase> &get_open_phases() const {
+    return open_phases_;
+  }
+
  private:
   string sqlite_path_;
   std::shared_ptr<SqliteConnectionSafe> sql_connection_;
+  unique_ptr<SqliteIncrementalVacuum> sqlite_incremental_vacuum_;
 
   std::shared_ptr<FileDbInterface> file_db_;
 
@@ -134,12 +158,19 @@ class TdDb {
   std::shared_ptr<BinlogKeyValue<ConcurrentBinlog>> config_pmc_;
   std::shared_ptr<ConcurrentBinlog> binlog_;
 
+  vector<OpenPhase> open_phases_;
+
   static void open_impl(TdParameters parameters, DbKey key, Promise<OpenedDatabase> &&promise);
 
   static Status check_parameters(TdParameters &parameters);
 
+  struct SqliteInitState;
+
+  static Status open_sqlite(const TdParameters &parameters, const string &path, const DbKey &key,
+                            const DbKey &old_key, SqliteInitState &state);
+
   Status init_sqlite(const TdParameters &parameters, const DbKey &key, const DbKey &old_key,
-                     BinlogKeyValue<Binlog> &binlog_pmc);
+                     BinlogKeyValue<Binlog> &binlog_pmc, SqliteInitState &state);
 
   void do_close(Promise<> on_finished, bool destroy_flag);
 };
@@ -34,7 +34,6 @@
 
 #include <algorithm>
 #include <cmath>
-#include <iterator>
 
 namespace td {
 
@@ -205,25 +204,30 @@ void TopDialogManager::on_dialog_used(TopDialogCategory category, DialogId dialo
   auto &top_dialogs = by_category_[pos];
 
   top_dialogs.is_dirty = true;
-  auto it = std::find_if(top_dialogs.dialogs.begin(), top_dialogs.dialogs.end(),
-                         [&](auto &top_dialog) { return top_dialog.dialog_id == dialog_id; });
-  if (it == top_dialogs.dialogs.end()) {
+  size_t dialog_pos;
+  auto it = top_dialogs.dialog_positions.find(dialog_id);
+  if (it == top_dialogs.dialog_positions.end()) {
     TopDialog top_dialog;
     top_dialog.dialog_id = dialog_id;
+    dialog_pos = top_dialogs.dialogs.size();
     top_dialogs.dialogs.push_back(top_dialog);
-    it = top_dialogs.dialogs.end() - 1;
+  } else {
+    dialog_pos = it->second;
+    CHECK(top_dialogs.dialogs[dialog_pos].dialog_id == dialog_id);
   }
 
+  // the rating only increases, so the dialog can only move to the beginning of the list
+  auto &dialogs = top_dialogs.dialogs;
   auto delta = rating_add(date, top_dialogs.rating_timestamp);
-  it->rating += delta;
-  while (it != top_dialogs.dialogs.begin()) {
-    auto next = std::prev(it);
-    if (*next < *it) {
-      break;
-    }
-    std::swap(*next, *it);
-    it = next;
+  auto top_dialog = dialogs[dialog_pos];
+  top_dialog.rating += delta;
+  while (dialog_pos > 0 && !(dialogs[dialog_pos - 1] < top_dialog)) {
+    dialogs[dialog_pos] = dialogs[dialog_pos - 1];
+    top_dialogs.dialog_positions[dialogs[dialog_pos].dialog_id] = dialog_pos;
+    dialog_pos--;
   }
+  dialogs[dialog_pos] = top_dialog;
+  top_dialogs.dialog_positions[dialog_id] = dialog_pos;
 
   LOG(INFO) << "Update " << get_top_dialog_category_name(category) << " rating of " << dialog_id << " by " << delta;
 
@@ -254,14 +258,16 @@ void TopDialogManager::remove_dialog(TopDialogCategory category, DialogId dialog
 
   td_->create_handler<ResetTopPeerRatingQuery>()->send(category, dialog_id);
 
-  auto it = std::find_if(top_dialogs.dialogs.begin(), top_dialogs.dialogs.end(),
-                         [&](auto &top_dialog) { return top_dialog.dialog_id == dialog_id; });
-  if (it == top_dialogs.dialogs.end()) {
+  auto it = top_dialogs.dialog_positions.find(dialog_id);
+  if (it == top_dialogs.dialog_positions.end()) {
     return promise.set_value(Unit());
   }
 
+  auto dialog_pos = it->second;
+  top_dialogs.dialog_positions.erase(it);
   top_dialogs.is_dirty = true;
-  top_dialogs.dialogs.erase(it);
+  top_dialogs.dialogs.erase(top_dialogs.dialogs.begin() + dialog_pos);
+  top_dialogs.update_dialog_positions(dialog_pos);
   if (!first_unsync_change_) {
     first_unsync_change_ = Timestamp::now_cached();
   }
@@ -298,6 +304,15 @@ void TopDialogManager::update_rating_e_decay() {
   rating_e_decay_ = narrow_cast<int32>(G()->get_option_integer("rating_e_decay", rating_e_decay_));
 }
 
+void TopDialogManager::TopDialogs::update_dialog_positions(size_t from_pos) {
+  if (from_pos == 0) {
+    dialog_positions.clear();
+  }
+  for (size_t i = from_pos; i < dialogs.size(); i++) {
+    dialog_positions[dialogs[i].dialog_id] = i;
+  }
+}
+
 template <class StorerT>
 void store(const TopDialogManager::TopDialog &top_dialog, StorerT &storer) {
   using ::td::store;
@@ -324,6 +339,7 @@ void parse(TopDialogManager::TopDialogs &top_dialogs, ParserT &parser) {
   using ::td::parse;
   parse(top_dialogs.rating_timestamp, parser);
   parse(top_dialogs.dialogs, parser);
+  top_dialogs.update_dialog_positions();
 }
 
 double TopDialogManager::rating_add(double now, double rating_timestamp) const {
@@ -486,6 +502,7 @@ void TopDialogManager::on_get_top_peers(Result<telegram_api::object_ptr<telegram
           top_dialog.rating = top_peer->rating_;
           top_dialogs.dialogs.push_back(std::move(top_dialog));
         }
+        top_dialogs.update_dialog_positions();
       }
       db_sync_state_ = SyncState::None;
       break;
@@ -583,6 +600,7 @@ void TopDialogManager::try_start() {
       top_dialogs.is_dirty = false;
       top_dialogs.rating_timestamp = 0;
       top_dialogs.dialogs.clear();
+      top_dialogs.dialog_positions.clear();
     }
   }
   db_sync_state_ = SyncState::Ok;
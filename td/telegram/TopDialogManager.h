@@ -13,6 +13,7 @@
 #include "td/actor/actor.h"
 
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Status.h"
 #include "td/utils/Time.h"
@@ -81,7 +82,10 @@ class TopDialogManager final : public Actor {
   struct TopDialogs {
     bool is_dirty = false;
     double rating_timestamp = 0;
-    vector<TopDialog> dialogs;
+    vector<TopDialog> dialogs;  // sorted by rating
+    FlatHashMap<DialogId, size_t, DialogIdHash> dialog_positions;  // position of each dialog in dialogs; isn't stored
+
+    void update_dialog_positions(size_t from_pos = 0);
   };
   template <class StorerT>
   friend void store(const TopDialog &top_dialog, StorerT &storer);
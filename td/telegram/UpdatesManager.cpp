@@ -256,6 +256,8 @@ void UpdatesManager::fill_pts_gap(void *td) {
     min_pts = min(min_pts, updates_manager->postponed_pts_updates_.begin()->first);
     max_pts = max(max_pts, updates_manager->postponed_pts_updates_.rbegin()->first);
   }
+  updates_manager->pts_gap_statistics_.unfilled_gap_count++;
+  VLOG(get_difference) << "PTS gap statistics: " << updates_manager->pts_gap_statistics_;
   string source = PSTRING() << "PTS from " << updates_manager->get_pts() << " to " << min_pts << '-' << max_pts;
   fill_gap(td, source.c_str());
 }
@@ -273,6 +275,9 @@ void UpdatesManager::fill_seq_gap(void *td) {
     min_seq = updates_manager->pending_seq_updates_.begin()->first;
     max_seq = updates_manager->pending_seq_updates_.rbegin()->second.seq_end;
   }
+  updates_manager->seq_gap_statistics_.unfilled_gap_count++;
+  updates_manager->last_seq_gap_time_ = 0;
+  VLOG(get_difference) << "Seq gap statistics: " << updates_manager->seq_gap_statistics_;
   string source = PSTRING() << "seq from " << updates_manager->seq_ << " to " << min_seq << '-' << max_seq;
   fill_gap(td, source.c_str());
 }
@@ -385,6 +390,25 @@ void UpdatesManager::run_get_difference(bool is_recursive, const char *source) {
     min_postponed_update_qts_ = 0;
   }
 
+  if (prefetched_difference_ != nullptr) {
+    if (prefetched_difference_->pts == pts && prefetched_difference_->date == date &&
+        prefetched_difference_->qts == qts) {
+      VLOG(get_difference) << "Use prefetched difference";
+      prefetched_difference_->is_awaited = true;
+      if (prefetched_difference_->is_received) {
+        prefetched_difference_->is_received = false;
+        send_closure_later(actor_id(this), &UpdatesManager::on_get_prefetched_difference,
+                           prefetched_difference_generation_, std::move(prefetched_difference_->result));
+      }
+      last_get_difference_pts_ = pts;
+      last_get_difference_qts_ = qts;
+      return;
+    }
+    VLOG(get_difference) << "Drop prefetched difference with PTS = " << prefetched_difference_->pts
+                         << ", QTS = " << prefetched_difference_->qts << ", date = " << prefetched_difference_->date;
+    prefetched_difference_ = nullptr;
+  }
+
   auto promise = PromiseCreator::lambda([](Result<tl_object_ptr<telegram_api::updates_Difference>> result) {
     if (result.is_ok()) {
       send_closure(G()->updates_manager(), &UpdatesManager::on_get_difference, result.move_as_ok());
@@ -397,6 +421,44 @@ void UpdatesManager::run_get_difference(bool is_recursive, const char *source) {
   last_get_difference_qts_ = qts;
 }
 
+void UpdatesManager::prefetch_difference(int32 pts, int32 date, int32 qts) {
+  CHECK(prefetched_difference_ == nullptr);
+  VLOG(get_difference) << "Prefetch difference with PTS = " << pts << ", QTS = " << qts << ", date = " << date;
+  prefetched_difference_ = make_unique<PrefetchedDifference>();
+  prefetched_difference_->pts = pts;
+  prefetched_difference_->date = date;
+  prefetched_difference_->qts = qts;
+
+  auto generation = ++prefetched_difference_generation_;
+  auto promise =
+      PromiseCreator::lambda([generation](Result<tl_object_ptr<telegram_api::updates_Difference>> result) mutable {
+        send_closure(G()->updates_manager(), &UpdatesManager::on_get_prefetched_difference, generation,
+                     std::move(result));
+      });
+  td_->create_handler<GetDifferenceQuery>(std::move(promise))->send(pts, date, qts);
+}
+
+void UpdatesManager::on_get_prefetched_difference(uint64 generation,
+                                                  Result<tl_object_ptr<telegram_api::updates_Difference>> result) {
+  if (prefetched_difference_ == nullptr || generation != prefetched_difference_generation_) {
+    VLOG(get_difference) << "Ignore outdated prefetched difference";
+    return;
+  }
+  if (!prefetched_difference_->is_awaited) {
+    // the current difference slice is still being applied
+    prefetched_difference_->is_received = true;
+    prefetched_difference_->result = std::move(result);
+    return;
+  }
+
+  prefetched_difference_ = nullptr;
+  if (result.is_ok()) {
+    on_get_difference(result.move_as_ok());
+  } else {
+    on_failed_get_difference(result.move_as_error());
+  }
+}
+
 void UpdatesManager::before_get_difference(bool is_initial) {
   // may be called many times before after_get_difference is called
   send_closure(G()->state_manager(), &StateManager::on_synchronized, false);
@@ -517,7 +579,7 @@ Promise<> UpdatesManager::set_pts(int32 pts, const char *source) {
       last_get_difference_pts_ = get_pts();
       schedule_get_difference("rare PTS getDifference");
     }
-  } else if (pts < get_pts() && (pts > 1 || td_->option_manager_->get_option_integer("session_count") <= 1)) {
+  } else if (pts < get_pts() && (pts > 1 || td_->option_manager_->get_option_integer(OptionId::SessionCount) <= 1)) {
     LOG(ERROR) << "Receive wrong PTS = " << pts << " from " << source << ". Current PTS = " << get_pts();
   }
   return result;
@@ -1571,7 +1633,7 @@ void UpdatesManager::on_update_from_auth_key_id(uint64 auth_key_id) {
   if (info.update_count++ == 0) {
     info.first_update_time = now;
     while (session_infos_.size() >
-           static_cast<size_t>(max(narrow_cast<int32>(G()->get_option_integer("session_count")), 1))) {
+           static_cast<size_t>(max(narrow_cast<int32>(G()->get_option_integer(OptionId::SessionCount)), 1))) {
       auto unused_auth_key_id = get_most_unused_auth_key_id();
       LOG(INFO) << "Delete statistics for auth key " << unused_auth_key_id;
       session_infos_.erase(unused_auth_key_id);
@@ -1734,8 +1796,10 @@ void UpdatesManager::on_get_difference(tl_object_ptr<telegram_api::updates_Diffe
       bool is_pts_changed = have_update_pts_changed(difference->other_updates_);
       if (difference->intermediate_state_->pts_ >= get_pts() && get_pts() != std::numeric_limits<int32>::max() &&
           difference->intermediate_state_->date_ >= date_ && difference->intermediate_state_->qts_ == get_qts() &&
-          !is_pts_changed) {
-        // TODO send new getDifference request and apply difference slice only after that
+          !is_pts_changed && prefetched_difference_ == nullptr) {
+        // request the next part of the difference while the current slice is being applied
+        prefetch_difference(difference->intermediate_state_->pts_, difference->intermediate_state_->date_,
+                            difference->intermediate_state_->qts_);
       }
 
       VLOG(get_difference) << "In get difference receive " << difference->users_.size() << " users and "
@@ -1778,7 +1842,7 @@ void UpdatesManager::on_get_difference(tl_object_ptr<telegram_api::updates_Diffe
       break;
     }
     case telegram_api::updates_differenceTooLong::ID: {
-      if (td_->option_manager_->get_option_integer("session_count") <= 1) {
+      if (td_->option_manager_->get_option_integer(OptionId::SessionCount) <= 1) {
         LOG(ERROR) << "Receive differenceTooLong";
       }
       // TODO
@@ -1799,6 +1863,11 @@ void UpdatesManager::on_get_difference(tl_object_ptr<telegram_api::updates_Diffe
 void UpdatesManager::after_get_difference() {
   CHECK(!running_get_difference_);
 
+  if (prefetched_difference_ != nullptr) {
+    VLOG(get_difference) << "Drop unneeded prefetched difference";
+    prefetched_difference_ = nullptr;
+  }
+
   retry_timeout_.cancel_timeout();
   retry_time_ = 1;
 
@@ -1879,6 +1948,10 @@ void UpdatesManager::after_get_difference() {
   td_->messages_manager_->after_get_difference();
   send_closure_later(td_->notification_manager_actor_, &NotificationManager::after_get_difference);
   send_closure(G()->state_manager(), &StateManager::on_synchronized, true);
+  if (get_difference_start_time_ > 0) {
+    td_->add_startup_phase("getDifference", get_difference_start_time_);
+  }
+  td_->finish_startup_profiling();
   get_difference_start_time_ = 0.0;
 
   try_reload_data();
@@ -2286,6 +2359,7 @@ void UpdatesManager::on_pending_updates(vector<tl_object_ptr<telegram_api::Updat
   if (can_postpone_updates()) {
     pending_seq_updates_.emplace(
         seq_begin, PendingSeqUpdates(seq_begin, seq_end, date, receive_time, std::move(updates), std::move(lock)));
+    seq_gap_statistics_.on_pending_update_added(pending_seq_updates_.size());
   } else {
     lock.set_value(Unit());
   }
@@ -2559,7 +2633,7 @@ void UpdatesManager::add_pending_pts_update(tl_object_ptr<telegram_api::Update>
 
   if (old_pts > new_pts - pts_count) {
     LOG(WARNING) << "Have old_pts (= " << old_pts << ") + pts_count (= " << pts_count << ") > new_pts (= " << new_pts
-                 << "). Logged in " << td_->option_manager_->get_option_integer("authorization_date")
+                 << "). Logged in " << td_->option_manager_->get_option_integer(OptionId::AuthorizationDate)
                  << ". Update from " << source << " = " << oneline(to_string(update));
     postpone_pts_update(std::move(update), new_pts, pts_count, receive_time, std::move(promise));
     set_pts_gap_timeout(0.001);
@@ -2575,7 +2649,7 @@ void UpdatesManager::add_pending_pts_update(tl_object_ptr<telegram_api::Update>
     LOG(WARNING) << "Have old_pts (= " << old_pts << ") + accumulated_pts_count (= " << accumulated_pts_count_
                  << ") > accumulated_pts (= " << accumulated_pts_ << "). new_pts = " << new_pts
                  << ", pts_count = " << pts_count << ". Logged in "
-                 << td_->option_manager_->get_option_integer("authorization_date") << ". Update from " << source
+                 << td_->option_manager_->get_option_integer(OptionId::AuthorizationDate) << ". Update from " << source
                  << " = " << oneline(to_string(update));
     postpone_pts_update(std::move(update), new_pts, pts_count, receive_time, std::move(promise));
     set_pts_gap_timeout(0.001);
@@ -2600,6 +2674,7 @@ void UpdatesManager::add_pending_pts_update(tl_object_ptr<telegram_api::Update>
 
   pending_pts_updates_.emplace(
       new_pts, PendingPtsUpdate(std::move(update), new_pts, pts_count, receive_time, std::move(promise)));
+  pts_gap_statistics_.on_pending_update_added(pending_pts_updates_.size());
 
   if (old_pts < accumulated_pts_ - accumulated_pts_count_) {
     if (old_pts == new_pts - pts_count) {
@@ -2719,9 +2794,11 @@ void UpdatesManager::process_all_pending_pts_updates() {
     auto begin_diff = begin_time - last_pts_gap_time_;
     auto diff = Time::now() - last_pts_gap_time_;
     last_pts_gap_time_ = 0;
+    pts_gap_statistics_.on_gap_filled(diff);
     if (diff > 0.1) {
       VLOG(get_difference) << "Gap in PTS from " << accumulated_pts_ - accumulated_pts_count_ << " to "
-                           << accumulated_pts_ << " has been filled in " << begin_diff << '-' << diff << " seconds";
+                           << accumulated_pts_ << " has been filled in " << begin_diff << '-' << diff
+                           << " seconds; PTS gap statistics: " << pts_gap_statistics_;
     }
   }
 
@@ -2913,6 +2990,10 @@ void UpdatesManager::process_pending_seq_updates() {
   if (pending_seq_updates_.empty() || applied_update_count > 0) {
     seq_gap_timeout_.cancel_timeout();
   }
+  if (pending_seq_updates_.empty() && last_seq_gap_time_ != 0) {
+    seq_gap_statistics_.on_gap_filled(Time::now() - last_seq_gap_time_);
+    last_seq_gap_time_ = 0;
+  }
   if (!pending_seq_updates_.empty()) {
     // if still have a gap, reset timeout
     auto update_it = pending_seq_updates_.begin();
@@ -3002,6 +3083,9 @@ void UpdatesManager::set_seq_gap_timeout(double timeout) {
     seq_gap_timeout_.set_callback(std::move(fill_seq_gap));
     seq_gap_timeout_.set_callback_data(static_cast<void *>(td_));
     seq_gap_timeout_.set_timeout_in(timeout);
+    if (last_seq_gap_time_ == 0) {
+      last_seq_gap_time_ = Time::now();
+    }
   }
 }
 
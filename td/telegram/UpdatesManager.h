@@ -54,6 +54,10 @@ class dummyUpdate final : public telegram_api::Update {
     UNREACHABLE();
   }
 
+  void store(TlStorerBounded &s) const final {
+    UNREACHABLE();
+  }
+
   void store(TlStorerToString &s, const char *field_name) const final {
     s.store_class_begin(field_name, "dummyUpdate");
     s.store_class_end();
@@ -84,6 +88,10 @@ class updateSentMessage final : public telegram_api::Update {
     UNREACHABLE();
   }
 
+  void store(TlStorerBounded &s) const final {
+    UNREACHABLE();
+  }
+
   void store(TlStorerToString &s, const char *field_name) const final {
     s.store_class_begin(field_name, "updateSentMessage");
     s.store_field("random_id", random_id_);
@@ -199,6 +207,32 @@ class UpdatesManager final : public Actor {
     vector<Promise<Unit>> promises;
   };
 
+  struct GapStatistics {
+    int64 filled_gap_count = 0;
+    int64 unfilled_gap_count = 0;
+    double total_gap_fill_time = 0.0;
+    double max_gap_fill_time = 0.0;
+    size_t max_pending_update_count = 0;
+
+    void on_gap_filled(double fill_time) {
+      filled_gap_count++;
+      total_gap_fill_time += fill_time;
+      max_gap_fill_time = max(max_gap_fill_time, fill_time);
+    }
+
+    void on_pending_update_added(size_t pending_update_count) {
+      max_pending_update_count = max(max_pending_update_count, pending_update_count);
+    }
+
+    friend StringBuilder &operator<<(StringBuilder &string_builder, const GapStatistics &statistics) {
+      return string_builder << "[filled " << statistics.filled_gap_count << " gaps in "
+                            << statistics.total_gap_fill_time << " seconds with maximum of "
+                            << statistics.max_gap_fill_time << " seconds, failed to fill "
+                            << statistics.unfilled_gap_count << " gaps, had up to "
+                            << statistics.max_pending_update_count << " pending updates]";
+    }
+  };
+
   Td *td_;
   ActorShared<> parent_;
   int32 ref_cnt_ = 1;
@@ -222,6 +256,9 @@ class UpdatesManager final : public Actor {
   int32 accumulated_pts_ = -1;
   double last_pts_jump_warning_time_ = 0;
   double last_pts_gap_time_ = 0;
+  double last_seq_gap_time_ = 0;
+  GapStatistics pts_gap_statistics_;
+  GapStatistics seq_gap_statistics_;
 
   std::multimap<int32, PendingPtsUpdate> pending_pts_updates_;
   std::multimap<int32, PendingPtsUpdate> postponed_pts_updates_;
@@ -253,6 +290,18 @@ class UpdatesManager final : public Actor {
   int32 min_postponed_update_qts_ = 0;
   double get_difference_start_time_ = 0;  // time from which we started to get difference without success
 
+  // the next difference, requested while the current difference slice is being applied
+  struct PrefetchedDifference {
+    int32 pts = 0;
+    int32 date = 0;
+    int32 qts = 0;
+    bool is_received = false;
+    bool is_awaited = false;
+    Result<tl_object_ptr<telegram_api::updates_Difference>> result;
+  };
+  unique_ptr<PrefetchedDifference> prefetched_difference_;
+  uint64 prefetched_difference_generation_ = 0;
+
   FlatHashMap<int64, TranscribedAudioHandler> pending_audio_transcriptions_;
   MultiTimeout pending_audio_transcription_timeout_{"PendingAudioTranscriptionTimeout"};
 
@@ -367,6 +416,10 @@ class UpdatesManager final : public Actor {
 
   void run_get_difference(bool is_recursive, const char *source);
 
+  void prefetch_difference(int32 pts, int32 date, int32 qts);
+
+  void on_get_prefetched_difference(uint64 generation, Result<tl_object_ptr<telegram_api::updates_Difference>> result);
+
   void on_failed_get_updates_state(Status &&error);
 
   void on_failed_get_difference(Status &&error);
@@ -61,6 +61,7 @@ enum class Version : int32 {
   AddMessageMediaSpoiler,  // 45
   MakeParticipantFlags64Bit,
   AddDocumentFlags,
+  AddPartialRemoteReadyBitmask,
   Next
 };
 
@@ -77,6 +78,9 @@ enum class DbVersion : int32 {
   StorePinnedDialogsInBinlog,
   AddMessageThreadSupport,
   AddMessageThreadDatabase,
+  AddMessageIdBlocks,
+  AddDialogSearchIndex,
+  AddMessageThreadIndex,
   Next
 };
 
@@ -2378,6 +2378,10 @@ void store(const unique_ptr<WebPageBlock> &block, LogEventStorerUnsafe &storer)
   store_web_page_block(block, storer);
 }
 
+void store(const unique_ptr<WebPageBlock> &block, LogEventStorerBounded &storer) {
+  store_web_page_block(block, storer);
+}
+
 void parse(unique_ptr<WebPageBlock> &block, LogEventParser &parser) {
   parse_web_page_block(block, parser);
 }
@@ -93,6 +93,8 @@ void store(const unique_ptr<WebPageBlock> &block, LogEventStorerCalcLength &stor
 
 void store(const unique_ptr<WebPageBlock> &block, LogEventStorerUnsafe &storer);
 
+void store(const unique_ptr<WebPageBlock> &block, LogEventStorerBounded &storer);
+
 void parse(unique_ptr<WebPageBlock> &block, LogEventParser &parser);
 
 vector<unique_ptr<WebPageBlock>> get_web_page_blocks(
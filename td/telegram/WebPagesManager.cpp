@@ -420,6 +420,11 @@ WebPagesManager::~WebPagesManager() {
 
 WebPageId WebPagesManager::on_get_web_page(tl_object_ptr<telegram_api::WebPage> &&web_page_ptr,
                                            DialogId owner_dialog_id) {
+  return on_get_web_page_impl(std::move(web_page_ptr), owner_dialog_id, false);
+}
+
+WebPageId WebPagesManager::on_get_web_page_impl(tl_object_ptr<telegram_api::WebPage> &&web_page_ptr,
+                                                DialogId owner_dialog_id, bool defer_instant_view) {
   CHECK(web_page_ptr != nullptr);
   if (td_->auth_manager_->is_bot()) {
     return WebPageId();
@@ -435,6 +440,7 @@ WebPageId WebPagesManager::on_get_web_page(tl_object_ptr<telegram_api::WebPage>
       }
 
       LOG(INFO) << "Receive empty " << web_page_id;
+      deferred_web_page_instant_views_.erase(web_page_id);
       const WebPage *web_page_to_delete = get_web_page(web_page_id);
       if (web_page_to_delete != nullptr) {
         if (web_page_to_delete->log_event_id != 0) {
@@ -523,8 +529,20 @@ WebPageId WebPagesManager::on_get_web_page(tl_object_ptr<telegram_api::WebPage>
         }
         // TODO attribute->settings_
       }
+      deferred_web_page_instant_views_.erase(web_page_id);
       if (web_page->cached_page_ != nullptr) {
-        on_get_web_page_instant_view(page.get(), std::move(web_page->cached_page_), web_page->hash_, owner_dialog_id);
+        if (defer_instant_view && deferred_web_page_instant_views_.size() < MAX_DEFERRED_INSTANT_VIEWS) {
+          // the instant view will be parsed only if it is requested
+          LOG(INFO) << "Defer parsing of instant view for " << web_page_id;
+          page->instant_view.is_empty = false;
+          page->instant_view.is_v2 = web_page->cached_page_->v2_;
+          auto &deferred_instant_view = deferred_web_page_instant_views_[web_page_id];
+          deferred_instant_view.page = std::move(web_page->cached_page_);
+          deferred_instant_view.hash = web_page->hash_;
+        } else {
+          on_get_web_page_instant_view(page.get(), std::move(web_page->cached_page_), web_page->hash_,
+                                       owner_dialog_id);
+        }
       }
 
       update_web_page(std::move(page), web_page_id, false, false);
@@ -751,7 +769,7 @@ void WebPagesManager::on_get_web_page_preview(const string &url,
   auto message_media_web_page = move_tl_object_as<telegram_api::messageMediaWebPage>(message_media_ptr);
   CHECK(message_media_web_page->webpage_ != nullptr);
 
-  auto web_page_id = on_get_web_page(std::move(message_media_web_page->webpage_), DialogId());
+  auto web_page_id = on_get_web_page_impl(std::move(message_media_web_page->webpage_), DialogId(), true);
   if (web_page_id.is_valid() && !have_web_page(web_page_id)) {
     pending_get_web_pages_[web_page_id].emplace_back(url, std::move(promise));
     return;
@@ -765,12 +783,86 @@ void WebPagesManager::on_get_web_page_preview_success(const string &url, WebPage
   CHECK(web_page_id == WebPageId() || have_web_page(web_page_id));
 
   if (web_page_id.is_valid() && !url.empty()) {
-    on_get_web_page_by_url(url, web_page_id, true);
+    on_get_web_page_by_url(url, web_page_id, false);
   }
 
   promise.set_value(get_web_page_object(web_page_id));
 }
 
+void WebPagesManager::on_load_web_page_preview_id_from_database(string url, string value) {
+  if (G()->close_flag()) {
+    return on_get_web_page_preview_finished(url, G()->close_status());
+  }
+
+  LOG(INFO) << "Successfully loaded preview of the URL \"" << url << "\" of size " << value.size() << " from database";
+  if (get_web_page_by_url(url).is_valid()) {
+    // URL web page has already been loaded
+    return on_get_web_page_preview_finished(url, Status::OK());
+  }
+  if (!value.empty()) {
+    auto web_page_id = WebPageId(to_integer<int64>(value));
+    if (web_page_id.is_valid()) {
+      if (have_web_page(web_page_id)) {
+        on_get_web_page_by_url(url, web_page_id, true);
+        return on_get_web_page_preview_finished(url, Status::OK());
+      }
+
+      load_web_page_from_database(web_page_id, PromiseCreator::lambda([actor_id = actor_id(this), web_page_id,
+                                                                       url](Result<Unit> result) mutable {
+                                    send_closure(actor_id, &WebPagesManager::on_load_web_page_preview_from_database,
+                                                 std::move(url), web_page_id);
+                                  }));
+      return;
+    }
+  }
+
+  send_get_web_page_preview_query(url);
+}
+
+void WebPagesManager::on_load_web_page_preview_from_database(string url, WebPageId web_page_id) {
+  if (G()->close_flag()) {
+    return on_get_web_page_preview_finished(url, G()->close_status());
+  }
+
+  if (have_web_page(web_page_id)) {
+    on_get_web_page_by_url(url, web_page_id, true);
+    return on_get_web_page_preview_finished(url, Status::OK());
+  }
+
+  send_get_web_page_preview_query(url);
+}
+
+void WebPagesManager::send_get_web_page_preview_query(const string &url) {
+  auto it = pending_get_web_page_previews_.find(url);
+  CHECK(it != pending_get_web_page_previews_.end());
+  const auto &text = it->second.text;
+  auto promise = PromiseCreator::lambda(
+      [actor_id = actor_id(this), url](Result<td_api::object_ptr<td_api::webPage>> result) {
+        send_closure(actor_id, &WebPagesManager::on_get_web_page_preview_finished, url,
+                     result.is_error() ? result.move_as_error() : Status::OK());
+      });
+  td_->create_handler<GetWebPagePreviewQuery>(std::move(promise))
+      ->send(text.text,
+             get_input_message_entities(td_->contacts_manager_.get(), text.entities, "send_get_web_page_preview_query"),
+             url);
+}
+
+void WebPagesManager::on_get_web_page_preview_finished(const string &url, Status status) {
+  auto it = pending_get_web_page_previews_.find(url);
+  CHECK(it != pending_get_web_page_previews_.end());
+  auto promises = std::move(it->second.promises);
+  pending_get_web_page_previews_.erase(it);
+
+  if (status.is_error()) {
+    return fail_promises(promises, std::move(status));
+  }
+
+  auto web_page_id = get_web_page_by_url(url);
+  for (auto &promise : promises) {
+    promise.set_value(get_web_page_object(web_page_id));
+  }
+}
+
 void WebPagesManager::get_web_page_preview(td_api::object_ptr<td_api::formattedText> &&text,
                                            Promise<td_api::object_ptr<td_api::webPage>> &&promise) {
   TRY_RESULT_PROMISE(promise, formatted_text,
@@ -787,10 +879,26 @@ void WebPagesManager::get_web_page_preview(td_api::object_ptr<td_api::formattedT
   if (web_page_id.is_valid()) {
     return promise.set_value(get_web_page_object(web_page_id));
   }
-  td_->create_handler<GetWebPagePreviewQuery>(std::move(promise))
-      ->send(formatted_text.text,
-             get_input_message_entities(td_->contacts_manager_.get(), formatted_text.entities, "get_web_page_preview"),
-             std::move(url));
+
+  // concurrent requests for the same URL share the same preview
+  auto &query = pending_get_web_page_previews_[url];
+  query.promises.push_back(std::move(promise));
+  if (query.promises.size() != 1) {
+    LOG(INFO) << "Wait for another preview request for the URL \"" << url << '"';
+    return;
+  }
+  query.text = std::move(formatted_text);
+
+  if (!G()->parameters().use_message_db) {
+    return send_get_web_page_preview_query(url);
+  }
+
+  G()->td_db()->get_sqlite_pmc()->get(
+      get_web_page_url_database_key(url),
+      PromiseCreator::lambda([actor_id = actor_id(this), url](string value) mutable {
+        send_closure(actor_id, &WebPagesManager::on_load_web_page_preview_id_from_database, std::move(url),
+                     std::move(value));
+      }));
 }
 
 void WebPagesManager::get_web_page_instant_view(const string &url, bool force_full, Promise<WebPageId> &&promise) {
@@ -825,6 +933,8 @@ void WebPagesManager::get_web_page_instant_view_impl(WebPageId web_page_id, bool
 
   LOG(INFO) << "Trying to get web page instant view for " << web_page_id;
 
+  parse_deferred_web_page_instant_view(web_page_id);
+
   const WebPageInstantView *web_page_instant_view = get_web_page_instant_view(web_page_id);
   if (web_page_instant_view == nullptr) {
     return promise.set_value(WebPageId());
@@ -841,6 +951,34 @@ void WebPagesManager::get_web_page_instant_view_impl(WebPageId web_page_id, bool
   promise.set_value(std::move(web_page_id));
 }
 
+void WebPagesManager::parse_deferred_web_page_instant_view(WebPageId web_page_id) {
+  auto it = deferred_web_page_instant_views_.find(web_page_id);
+  if (it == deferred_web_page_instant_views_.end()) {
+    return;
+  }
+  auto deferred_instant_view = std::move(it->second);
+  deferred_web_page_instant_views_.erase(it);
+
+  WebPage *web_page = web_pages_.get_pointer(web_page_id);
+  if (web_page == nullptr || web_page->instant_view.is_loaded) {
+    return;
+  }
+
+  LOG(INFO) << "Parse deferred instant view for " << web_page_id;
+  auto old_file_ids = get_web_page_file_ids(web_page);
+
+  auto old_instant_view = std::move(web_page->instant_view);
+  web_page->instant_view = WebPageInstantView();
+  on_get_web_page_instant_view(web_page, std::move(deferred_instant_view.page), deferred_instant_view.hash,
+                               DialogId());
+  update_web_page_instant_view(web_page_id, web_page->instant_view, std::move(old_instant_view));
+
+  auto new_file_ids = get_web_page_file_ids(web_page);
+  if (old_file_ids != new_file_ids) {
+    td_->file_manager_->change_files_source(get_web_page_file_source_id(web_page), old_file_ids, new_file_ids);
+  }
+}
+
 string WebPagesManager::get_web_page_instant_view_database_key(WebPageId web_page_id) {
   return PSTRING() << "wpiv" << web_page_id.get();
 }
@@ -913,6 +1051,12 @@ void WebPagesManager::on_load_web_page_instant_view_from_database(WebPageId web_
   if (web_page_instant_view.was_loaded_from_database) {
     return;
   }
+  if (value.empty() && !web_page_instant_view.is_loaded) {
+    // the instant view wasn't saved to the database, because its parsing was deferred
+    LOG(INFO) << "There is no " << web_page_id << " instant view in database";
+    web_page_instant_view.was_loaded_from_database = true;
+    return reload_web_page_instant_view(web_page_id);
+  }
 
   WebPageInstantView result;
   if (!value.empty()) {
@@ -10,6 +10,7 @@
 #include "td/telegram/files/FileId.h"
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/FullMessageId.h"
+#include "td/telegram/MessageEntity.h"
 #include "td/telegram/SecretInputMedia.h"
 #include "td/telegram/td_api.h"
 #include "td/telegram/telegram_api.h"
@@ -93,6 +94,11 @@ class WebPagesManager final : public Actor {
 
   class WebPageLogEvent;
 
+  static constexpr size_t MAX_DEFERRED_INSTANT_VIEWS = 100;  // maximum number of not parsed preview instant views
+
+  WebPageId on_get_web_page_impl(tl_object_ptr<telegram_api::WebPage> &&web_page_ptr, DialogId owner_dialog_id,
+                                 bool defer_instant_view);
+
   void update_web_page(unique_ptr<WebPage> web_page, WebPageId web_page_id, bool from_binlog, bool from_database);
 
   void update_web_page_instant_view(WebPageId web_page_id, WebPageInstantView &new_instant_view,
@@ -119,6 +125,16 @@ class WebPagesManager final : public Actor {
   void on_get_web_page_preview_success(const string &url, WebPageId web_page_id,
                                        Promise<td_api::object_ptr<td_api::webPage>> &&promise);
 
+  void on_load_web_page_preview_id_from_database(string url, string value);
+
+  void on_load_web_page_preview_from_database(string url, WebPageId web_page_id);
+
+  void send_get_web_page_preview_query(const string &url);
+
+  void on_get_web_page_preview_finished(const string &url, Status status);
+
+  void parse_deferred_web_page_instant_view(WebPageId web_page_id);
+
   void on_get_web_page_instant_view(WebPage *web_page, tl_object_ptr<telegram_api::page> &&page, int32 hash,
                                     DialogId owner_dialog_id);
 
@@ -180,6 +196,18 @@ class WebPagesManager final : public Actor {
   FlatHashMap<WebPageId, vector<std::pair<string, Promise<td_api::object_ptr<td_api::webPage>>>>, WebPageIdHash>
       pending_get_web_pages_;
 
+  struct PendingWebPagePreviewQuery {
+    FormattedText text;
+    vector<Promise<td_api::object_ptr<td_api::webPage>>> promises;
+  };
+  FlatHashMap<string, PendingWebPagePreviewQuery> pending_get_web_page_previews_;  // URL -> query
+
+  struct DeferredInstantView {
+    tl_object_ptr<telegram_api::page> page;
+    int32 hash = 0;
+  };
+  FlatHashMap<WebPageId, DeferredInstantView, WebPageIdHash> deferred_web_page_instant_views_;
+
   FlatHashMap<string, WebPageId> url_to_web_page_id_;
 
   FlatHashMap<string, FileSourceId> url_to_file_source_id_;
@@ -2104,6 +2104,8 @@ class CliClient final : public Actor {
       send_request(td_api::make_object<td_api::processPushNotification>(args));
     } else if (op == "gpri") {
       send_request(td_api::make_object<td_api::getPushReceiverId>(args));
+    } else if (op == "dpn") {
+      execute(td_api::make_object<td_api::decryptPushNotification>(string(), use_test_dc_, string(), args));
     } else if (op == "rda") {
       send_request(td_api::make_object<td_api::registerDevice>(
           td_api::make_object<td_api::deviceTokenApplePush>(args, true), as_user_ids("")));
@@ -2784,6 +2786,8 @@ class CliClient final : public Actor {
       send_request(td_api::make_object<td_api::getStorageStatisticsFast>());
     } else if (op == "database") {
       send_request(td_api::make_object<td_api::getDatabaseStatistics>());
+    } else if (op == "memory") {
+      send_request(td_api::make_object<td_api::getMemoryStatistics>());
     } else if (op == "optimize_storage" || op == "optimize_storage_all") {
       string chat_ids;
       string exclude_chat_ids;
@@ -2822,8 +2826,18 @@ class CliClient final : public Actor {
       send_request(td_api::make_object<td_api::getNetworkStatistics>(true));
     } else if (op == "reset_network") {
       send_request(td_api::make_object<td_api::resetNetworkStatistics>());
+    } else if (op == "gnqs" || op == "gnqsr") {
+      send_request(td_api::make_object<td_api::getNetworkQueryStatistics>(op == "gnqsr"));
     } else if (op == "snt") {
       send_request(td_api::make_object<td_api::setNetworkType>(as_network_type(args)));
+    } else if (op == "hibernate") {
+      send_request(td_api::make_object<td_api::hibernate>());
+    } else if (op == "suf") {
+      string update_types;
+      string chat_ids;
+      get_args(args, update_types, chat_ids);
+      send_request(
+          td_api::make_object<td_api::setUpdateFilter>(to_integers<int32>(update_types), as_chat_ids(chat_ids)));
     } else if (op == "gadsp") {
       send_request(td_api::make_object<td_api::getAutoDownloadSettingsPresets>());
     } else if (op == "sads") {
@@ -3880,6 +3894,13 @@ class CliClient final : public Actor {
       send_request(td_api::make_object<td_api::sendMessageAlbum>(
           chat_id, message_thread_id_, reply_to_message_id, default_message_send_options(),
           std::move(input_message_contents), op == "smapp" || op == "smaprp"));
+    } else if (op == "smtc") {
+      string chat_ids;
+      string message;
+      get_args(args, chat_ids, message);
+      send_request(td_api::make_object<td_api::sendMessageToChats>(
+          as_chat_ids(chat_ids), default_message_send_options(),
+          td_api::make_object<td_api::inputMessageText>(as_formatted_text(message), false, true)));
     } else if (op == "smad" || op == "smadp") {
       ChatId chat_id;
       get_args(args, chat_id, args);
@@ -5317,6 +5338,18 @@ class CliClient final : public Actor {
         LOG(ERROR) << "RSS = " << stats.resident_size_ << ", peak RSS = " << stats.resident_size_peak_ << ", VSZ "
                    << stats.virtual_size_ << ", peak VSZ = " << stats.virtual_size_peak_;
       }
+    } else if (op == "memprof") {
+      if (!is_memprof_on()) {
+        LOG(ERROR) << "Memory profiling is disabled";
+      } else {
+        string path = args.empty() ? string("heap.prof") : args;
+        auto status = write_file(path, get_heap_profile());
+        if (status.is_error()) {
+          LOG(ERROR) << status;
+        } else {
+          LOG(ERROR) << "Heap profile has been written to " << path;
+        }
+      }
     } else if (op == "cpu") {
       auto inc_count = to_integer<uint32>(args);
       while (inc_count-- > 0) {
@@ -5377,6 +5410,35 @@ class CliClient final : public Actor {
       } else {
         execute(std::move(request));
       }
+    } else if (op == "tas") {
+      bool is_enabled;
+      get_args(args, is_enabled);
+      execute(td_api::make_object<td_api::toggleActorStatistics>(is_enabled));
+    } else if (op == "gas" || op == "gasr") {
+      execute(td_api::make_object<td_api::getActorStatistics>(op == "gasr"));
+    } else if (op == "tls") {
+      bool is_enabled;
+      get_args(args, is_enabled);
+      execute(td_api::make_object<td_api::toggleLockStatistics>(is_enabled));
+    } else if (op == "gls" || op == "glsr") {
+      execute(td_api::make_object<td_api::getLockStatistics>(op == "glsr"));
+    } else if (op == "trqs") {
+      bool is_enabled;
+      get_args(args, is_enabled);
+      execute(td_api::make_object<td_api::toggleRequestStatistics>(is_enabled));
+    } else if (op == "grqs" || op == "grqsr") {
+      execute(td_api::make_object<td_api::getRequestStatistics>(op == "grqsr"));
+    } else if (op == "trqt") {
+      bool is_enabled;
+      int32 sampling_period;
+      get_args(args, is_enabled, sampling_period);
+      execute(td_api::make_object<td_api::toggleRequestTracing>(is_enabled, sampling_period));
+    } else if (op == "grqt" || op == "grqtr") {
+      execute(td_api::make_object<td_api::getRequestTraces>(op == "grqtr"));
+    } else if (op == "smep") {
+      int32 port;
+      get_args(args, port);
+      execute(td_api::make_object<td_api::setMetricsExporterPort>(port));
     } else if (op == "q" || op == "Quit") {
       quit();
     } else if (op == "dnq") {
@@ -8,6 +8,7 @@
 
 #include "td/telegram/files/FileData.h"
 #include "td/telegram/files/FileData.hpp"
+#include "td/telegram/files/FileGcIndex.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileLocation.hpp"
 #include "td/telegram/logevent/LogEvent.h"
@@ -17,15 +18,19 @@
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteReadPool.h"
+#include "td/db/WriteBatcher.h"
 
 #include "td/actor/actor.h"
 
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
 #include "td/utils/tl_parsers.h"
 
@@ -60,30 +65,138 @@ class FileDb final : public FileDbInterface {
  public:
   class FileDbActor final : public Actor {
    public:
-    FileDbActor(FileDbId max_file_db_id, std::shared_ptr<SqliteKeyValueSafe> file_kv_safe)
-        : max_file_db_id_(max_file_db_id), file_kv_safe_(std::move(file_kv_safe)) {
+    FileDbActor(FileDbId max_file_db_id, std::shared_ptr<SqliteKeyValueSafe> file_kv_safe,
+                std::shared_ptr<SqliteReadPool> read_pool)
+        : max_file_db_id_(max_file_db_id), file_kv_safe_(std::move(file_kv_safe)), read_pool_(std::move(read_pool)) {
     }
 
     void close(Promise<> promise) {
+      do_flush();
       file_kv_safe_.reset();
       LOG(INFO) << "FileDb is closed";
-      promise.set_value(Unit());
+      if (read_pool_ != nullptr) {
+        // wait for all running read queries
+        read_pool_->flush(std::move(promise));
+        read_pool_.reset();
+      } else {
+        promise.set_value(Unit());
+      }
       stop();
     }
 
-    void load_file_data(const string &key, Promise<FileData> promise) {
-      promise.set_result(load_file_data_impl(actor_id(this), file_pmc(), key, max_file_db_id_));
+    void load_file_data(string key, Promise<FileData> promise) {
+      do_flush();
+      if (read_pool_ == nullptr) {
+        return promise.set_result(load_file_data_impl(actor_id(this), file_pmc(), key, max_file_db_id_));
+      }
+      // all previous writes are already committed
+      read_pool_->run([actor_id = actor_id(this), file_kv_safe = file_kv_safe_, key = std::move(key),
+                       max_file_db_id = max_file_db_id_, promise = std::move(promise)]() mutable {
+        promise.set_result(load_file_data_impl(actor_id, file_kv_safe->get(), key, max_file_db_id));
+      });
+    }
+
+    void clear_file_data(FileDbId file_db_id, string remote_key, string local_key, string generate_key) {
+      add_write_query([this, file_db_id, remote_key = std::move(remote_key), local_key = std::move(local_key),
+                       generate_key = std::move(generate_key)](Unit) {
+        do_clear_file_data(file_db_id, remote_key, local_key, generate_key);
+      });
+    }
+
+    void store_file_data(FileDbId file_db_id, string file_data, string remote_key, string local_key,
+                         string generate_key) {
+      add_write_query([this, file_db_id, file_data = std::move(file_data), remote_key = std::move(remote_key),
+                       local_key = std::move(local_key), generate_key = std::move(generate_key)](Unit) {
+        do_store_file_data(file_db_id, file_data, remote_key, local_key, generate_key);
+      });
+    }
+
+    void store_file_data_ref(FileDbId file_db_id, FileDbId new_file_db_id) {
+      add_write_query([this, file_db_id, new_file_db_id](Unit) {
+        update_max_file_db_id(file_db_id);
+        do_store_file_data_ref(file_db_id, new_file_db_id);
+      });
+    }
+
+    void store_file_gc_info(string path, string info) {
+      add_write_query([this, path = std::move(path), info = std::move(info)](Unit) {
+        file_pmc().set(get_file_gc_index_key(path), info);
+      });
+    }
+
+    void touch_file_gc_info(string path, uint64 atime_nsec) {
+      add_write_query([this, path = std::move(path), atime_nsec](Unit) { do_touch_file_gc_info(path, atime_nsec); });
+    }
+
+    void clear_file_gc_infos(vector<string> paths) {
+      add_write_query([this, paths = std::move(paths)](Unit) mutable {
+        for (auto &path : paths) {
+          path = get_file_gc_index_key(path);
+        }
+        file_pmc().erase_batch(std::move(paths));
+      });
     }
 
-    void clear_file_data(FileDbId file_db_id, const string &remote_key, const string &local_key,
-                         const string &generate_key) {
+    void rebuild_file_gc_index(vector<FullFileInfo> files, double scan_start_time) {
+      // the index is rebuilt in its own transaction after all previous writes
+      do_flush();
+      ::td::rebuild_file_gc_index(file_pmc(), files, scan_start_time);
+    }
+
+    void optimize_refs(std::vector<FileDbId> file_db_ids, FileDbId main_file_db_id) {
+      LOG(INFO) << "Optimize " << file_db_ids.size() << " file_db_ids in file database to " << main_file_db_id.get();
+      add_write_query([this, file_db_ids = std::move(file_db_ids), main_file_db_id](Unit) {
+        for (size_t i = 0; i + 1 < file_db_ids.size(); i++) {
+          do_store_file_data_ref(file_db_ids[i], main_file_db_id);
+        }
+      });
+    }
+
+   private:
+    FileDbId max_file_db_id_;
+    std::shared_ptr<SqliteKeyValueSafe> file_kv_safe_;
+    std::shared_ptr<SqliteReadPool> read_pool_;
+
+    // writes of avatars and thumbnails of a chat list page arrive in bursts, so they are committed in one transaction
+    WriteBatcher write_batcher_;
+    vector<Promise<Unit>> pending_writes_;
+
+    SqliteKeyValue &file_pmc() {
+      return file_kv_safe_->get();
+    }
+
+    template <class F>
+    void add_write_query(F &&f) {
+      pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f)));
+      if (write_batcher_.need_flush(pending_writes_.size())) {
+        do_flush();
+      } else if (pending_writes_.size() == 1) {
+        set_timeout_at(write_batcher_.get_flush_time(Time::now_cached()));
+      }
+    }
+
+    void do_flush() {
+      if (pending_writes_.empty()) {
+        return;
+      }
+      auto batch_size = pending_writes_.size();
+      auto start_time = Time::now();
       auto &pmc = file_pmc();
       pmc.begin_write_transaction().ensure();
+      set_promises(pending_writes_);
+      pmc.commit_transaction().ensure();
+      write_batcher_.on_commit(batch_size, Time::now() - start_time);
+      cancel_timeout();
+    }
 
-      if (file_db_id > max_file_db_id_) {
-        pmc.set("file_id", to_string(file_db_id.get()));
-        max_file_db_id_ = file_db_id;
-      }
+    void timeout_expired() final {
+      do_flush();
+    }
+
+    void do_clear_file_data(FileDbId file_db_id, const string &remote_key, const string &local_key,
+                            const string &generate_key) {
+      auto &pmc = file_pmc();
+      update_max_file_db_id(file_db_id);
 
       pmc.erase(PSTRING() << "file" << file_db_id.get());
       // LOG(DEBUG) << "ERASE " << format::as_hex_dump<4>(Slice(PSLICE() << "file" << file_db_id.get()));
@@ -99,19 +212,12 @@ class FileDb final : public FileDbInterface {
       if (!generate_key.empty()) {
         pmc.erase(generate_key);
       }
-
-      pmc.commit_transaction().ensure();
     }
 
-    void store_file_data(FileDbId file_db_id, const string &file_data, const string &remote_key,
-                         const string &local_key, const string &generate_key) {
+    void do_store_file_data(FileDbId file_db_id, const string &file_data, const string &remote_key,
+                            const string &local_key, const string &generate_key) {
       auto &pmc = file_pmc();
-      pmc.begin_write_transaction().ensure();
-
-      if (file_db_id > max_file_db_id_) {
-        pmc.set("file_id", to_string(file_db_id.get()));
-        max_file_db_id_ = file_db_id;
-      }
+      update_max_file_db_id(file_db_id);
 
       pmc.set(PSTRING() << "file" << file_db_id.get(), file_data);
 
@@ -124,40 +230,29 @@ class FileDb final : public FileDbInterface {
       if (!generate_key.empty()) {
         pmc.set(generate_key, to_string(file_db_id.get()));
       }
-
-      pmc.commit_transaction().ensure();
     }
 
-    void store_file_data_ref(FileDbId file_db_id, FileDbId new_file_db_id) {
+    void do_touch_file_gc_info(const string &path, uint64 atime_nsec) {
       auto &pmc = file_pmc();
-      pmc.begin_write_transaction().ensure();
-
-      if (file_db_id > max_file_db_id_) {
-        pmc.set("file_id", to_string(file_db_id.get()));
-        max_file_db_id_ = file_db_id;
+      auto key = get_file_gc_index_key(path);
+      auto value = pmc.get(key);
+      if (value.empty()) {
+        return;
       }
-
-      do_store_file_data_ref(file_db_id, new_file_db_id);
-
-      pmc.commit_transaction().ensure();
-    }
-
-    void optimize_refs(std::vector<FileDbId> file_db_ids, FileDbId main_file_db_id) {
-      LOG(INFO) << "Optimize " << file_db_ids.size() << " file_db_ids in file database to " << main_file_db_id.get();
-      auto &pmc = file_pmc();
-      pmc.begin_write_transaction().ensure();
-      for (size_t i = 0; i + 1 < file_db_ids.size(); i++) {
-        do_store_file_data_ref(file_db_ids[i], main_file_db_id);
+      auto r_info = parse_file_gc_info(path, value);
+      if (r_info.is_error() || r_info.ok().atime_nsec >= atime_nsec) {
+        return;
       }
-      pmc.commit_transaction().ensure();
+      auto info = r_info.move_as_ok();
+      info.atime_nsec = atime_nsec;
+      pmc.set(key, serialize_file_gc_info(info));
     }
 
-   private:
-    FileDbId max_file_db_id_;
-    std::shared_ptr<SqliteKeyValueSafe> file_kv_safe_;
-
-    SqliteKeyValue &file_pmc() {
-      return file_kv_safe_->get();
+    void update_max_file_db_id(FileDbId file_db_id) {
+      if (file_db_id > max_file_db_id_) {
+        file_pmc().set("file_id", to_string(file_db_id.get()));
+        max_file_db_id_ = file_db_id;
+      }
     }
 
     void do_store_file_data_ref(FileDbId file_db_id, FileDbId new_file_db_id) {
@@ -165,12 +260,12 @@ class FileDb final : public FileDbInterface {
     }
   };
 
-  explicit FileDb(std::shared_ptr<SqliteKeyValueSafe> kv_safe, int scheduler_id = -1) {
+  FileDb(std::shared_ptr<SqliteKeyValueSafe> kv_safe, int scheduler_id, std::shared_ptr<SqliteReadPool> read_pool) {
     file_kv_safe_ = std::move(kv_safe);
     CHECK(file_kv_safe_);
     max_file_db_id_ = FileDbId(to_integer<uint64>(file_kv_safe_->get().get("file_id")));
-    file_db_actor_ =
-        create_actor_on_scheduler<FileDbActor>("FileDbActor", scheduler_id, max_file_db_id_, file_kv_safe_);
+    file_db_actor_ = create_actor_on_scheduler<FileDbActor>("FileDbActor", scheduler_id, max_file_db_id_,
+                                                            file_kv_safe_, std::move(read_pool));
   }
 
   FileDbId get_next_file_db_id() final {
@@ -190,6 +285,14 @@ class FileDb final : public FileDbInterface {
     return load_file_data_impl(file_db_actor_.get(), file_kv_safe_->get(), key, max_file_db_id_);
   }
 
+  vector<Result<FileData>> get_file_data_many_sync_impl(vector<string> keys) final {
+    return load_file_data_many_impl(file_db_actor_.get(), file_kv_safe_->get(), keys, max_file_db_id_);
+  }
+
+  Result<FileData> get_file_data_sync(FileDbId file_db_id) final {
+    return load_file_data_by_id_impl(file_db_actor_.get(), file_kv_safe_->get(), file_db_id, max_file_db_id_);
+  }
+
   void clear_file_data(FileDbId file_db_id, const FileData &file_data) final {
     string remote_key;
     if (file_data.remote_.type() == RemoteFileLocation::Type::Full) {
@@ -231,6 +334,23 @@ class FileDb final : public FileDbInterface {
   void set_file_data_ref(FileDbId file_db_id, FileDbId new_file_db_id) final {
     send_closure(file_db_actor_, &FileDbActor::store_file_data_ref, file_db_id, new_file_db_id);
   }
+
+  void set_file_gc_info(const FullFileInfo &info) final {
+    send_closure(file_db_actor_, &FileDbActor::store_file_gc_info, info.path, serialize_file_gc_info(info));
+  }
+
+  void touch_file_gc_info(string path, uint64 atime_nsec) final {
+    send_closure(file_db_actor_, &FileDbActor::touch_file_gc_info, std::move(path), atime_nsec);
+  }
+
+  void clear_file_gc_infos(vector<string> paths) final {
+    send_closure(file_db_actor_, &FileDbActor::clear_file_gc_infos, std::move(paths));
+  }
+
+  void rebuild_file_gc_index(vector<FullFileInfo> files, double scan_start_time) final {
+    send_closure(file_db_actor_, &FileDbActor::rebuild_file_gc_index, std::move(files), scan_start_time);
+  }
+
   SqliteKeyValue &pmc() final {
     return file_kv_safe_->get();
   }
@@ -244,13 +364,50 @@ class FileDb final : public FileDbInterface {
                                               const string &key, FileDbId max_file_db_id) {
     // LOG(DEBUG) << "Load by key " << format::as_hex_dump<4>(Slice(key));
     TRY_RESULT(file_db_id, get_file_db_id(pmc, key));
+    return load_file_data_by_id_impl(file_db_actor_id, pmc, file_db_id, max_file_db_id);
+  }
 
+  static vector<Result<FileData>> load_file_data_many_impl(ActorId<FileDbActor> file_db_actor_id, SqliteKeyValue &pmc,
+                                                          const vector<string> &keys, FileDbId max_file_db_id) {
+    vector<Result<FileData>> result;
+    result.reserve(keys.size());
+    auto file_db_id_strs = pmc.get_many(keys);
+
+    vector<string> data_keys;
+    for (auto &file_db_id_str : file_db_id_strs) {
+      if (!file_db_id_str.empty()) {
+        data_keys.push_back(PSTRING() << "file" << to_integer<uint64>(file_db_id_str));
+      }
+    }
+    auto data_strs = pmc.get_many(data_keys);
+
+    size_t data_pos = 0;
+    for (auto &file_db_id_str : file_db_id_strs) {
+      if (file_db_id_str.empty()) {
+        result.push_back(Status::Error("There is no such key in the database"));
+        continue;
+      }
+      auto &data_str = data_strs[data_pos++];
+      if (begins_with(data_str, "@@")) {
+        // references are rare, so they are resolved one by one
+        result.push_back(load_file_data_by_id_impl(file_db_actor_id, pmc, FileDbId(to_integer<uint64>(file_db_id_str)),
+                                                   max_file_db_id));
+      } else {
+        result.push_back(parse_file_data(data_str));
+      }
+    }
+    CHECK(data_pos == data_strs.size());
+    return result;
+  }
+
+  static Result<FileData> load_file_data_by_id_impl(ActorId<FileDbActor> file_db_actor_id, SqliteKeyValue &pmc,
+                                                    FileDbId file_db_id, FileDbId max_file_db_id) {
     vector<FileDbId> file_db_ids;
     string data_str;
     int attempt_count = 0;
     while (true) {
       if (attempt_count > 100) {
-        LOG(FATAL) << "Cycle in file database? max_file_db_id=" << max_file_db_id << " key=" << key
+        LOG(FATAL) << "Cycle in file database? max_file_db_id=" << max_file_db_id
                    << " links=" << format::as_array(file_db_ids);
       }
       attempt_count++;
@@ -272,6 +429,10 @@ class FileDb final : public FileDbInterface {
     // LOG(DEBUG) << "By ID " << file_db_id.get() << " found data " << format::as_hex_dump<4>(Slice(data_str));
     // LOG(INFO) << attempt_count;
 
+    return parse_file_data(data_str);
+  }
+
+  static Result<FileData> parse_file_data(const string &data_str) {
     log_event::WithVersion<TlParser> parser(data_str);
     parser.set_version(static_cast<int32>(Version::Initial));
     FileData data;
@@ -294,9 +455,10 @@ class FileDb final : public FileDbInterface {
   }
 };
 
-std::shared_ptr<FileDbInterface> create_file_db(std::shared_ptr<SqliteConnectionSafe> connection, int scheduler_id) {
+std::shared_ptr<FileDbInterface> create_file_db(std::shared_ptr<SqliteConnectionSafe> connection, int scheduler_id,
+                                                std::shared_ptr<SqliteReadPool> read_pool) {
   auto kv = std::make_shared<SqliteKeyValueSafe>("files", std::move(connection));
-  return std::make_shared<FileDb>(std::move(kv), scheduler_id);
+  return std::make_shared<FileDb>(std::move(kv), scheduler_id, std::move(read_pool));
 }
 
 }  // namespace td
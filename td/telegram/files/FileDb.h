@@ -8,6 +8,7 @@
 
 #include "td/telegram/files/FileData.h"
 #include "td/telegram/files/FileDbId.h"
+#include "td/telegram/files/FileStats.h"
 
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
@@ -23,13 +24,17 @@ namespace td {
 class SqliteDb;
 class SqliteConnectionSafe;
 class SqliteKeyValue;
+class SqliteReadPool;
 
 Status drop_file_db(SqliteDb &db, int32 version) TD_WARN_UNUSED_RESULT;
 Status init_file_db(SqliteDb &db, int32 version) TD_WARN_UNUSED_RESULT;
 
 class FileDbInterface;
+// if read_pool is specified, file data is loaded by it instead of the database actor
 std::shared_ptr<FileDbInterface> create_file_db(std::shared_ptr<SqliteConnectionSafe> connection,
-                                                int32 scheduler_id = -1) TD_WARN_UNUSED_RESULT;
+                                                int32 scheduler_id = -1,
+                                                std::shared_ptr<SqliteReadPool> read_pool = nullptr)
+    TD_WARN_UNUSED_RESULT;
 
 class FileDbInterface {
  public:
@@ -75,17 +80,32 @@ class FileDbInterface {
     return res;
   }
 
+  // loads data of files with the given keys, returned by as_key, using one database query per batch of keys
+  vector<Result<FileData>> get_file_data_many_sync(vector<string> keys) {
+    return get_file_data_many_sync_impl(std::move(keys));
+  }
+
+  // loads data of the file with the given identifier; used to restore evicted file nodes
+  virtual Result<FileData> get_file_data_sync(FileDbId file_db_id) = 0;
+
   virtual void clear_file_data(FileDbId file_db_id, const FileData &file_data) = 0;
   virtual void set_file_data(FileDbId file_db_id, const FileData &file_data, bool new_remote, bool new_local,
                              bool new_generate) = 0;
   virtual void set_file_data_ref(FileDbId file_db_id, FileDbId new_file_db_id) = 0;
 
+  // files GC index
+  virtual void set_file_gc_info(const FullFileInfo &info) = 0;
+  virtual void touch_file_gc_info(string path, uint64 atime_nsec) = 0;
+  virtual void clear_file_gc_infos(vector<string> paths) = 0;
+  virtual void rebuild_file_gc_index(vector<FullFileInfo> files, double scan_start_time) = 0;
+
   // For FileStatsWorker. TODO: remove it
   virtual SqliteKeyValue &pmc() = 0;
 
  private:
   virtual void get_file_data_impl(string key, Promise<FileData> promise) = 0;
   virtual Result<FileData> get_file_data_sync_impl(string key) = 0;
+  virtual vector<Result<FileData>> get_file_data_many_sync_impl(vector<string> keys) = 0;
 };
 
 }  // namespace td
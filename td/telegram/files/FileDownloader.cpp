@@ -87,6 +87,26 @@ Result<FileLoader::FileInfo> FileDownloader::init() {
       CHECK((part_size & (part_size - 1)) == 0);
     }
   }
+  if (need_search_file_ && fd_.empty() && size_ > 0 && encryption_key_.empty() && !remote_.is_web()) {
+    // the file from the shared storage is checked like a found local file, but must be moved to the files directory
+    [&] {
+      TRY_RESULT(path, link_shared_file(remote_, size_));
+      auto r_fd = FileFd::open(path, FileFd::Read);
+      if (r_fd.is_error()) {
+        unlink(path).ignore();
+        return r_fd.move_as_error();
+      }
+      LOG(INFO) << "Check hash of shared file " << path;
+      path_ = std::move(path);
+      fd_ = r_fd.move_as_ok();
+      need_check_ = true;
+      only_check_ = true;
+      is_shared_file_ = true;
+      part_size = 128 * (1 << 10);
+      bitmask = Bitmask{Bitmask::Ones{}, (size_ + part_size - 1) / part_size};
+      return Status::OK();
+    }();
+  }
   if (need_search_file_ && fd_.empty() && size_ > 0 && encryption_key_.empty() && !remote_.is_web()) {
     [&] {
       TRY_RESULT(path, search_file(remote_.file_type_, name_, size_));
@@ -101,6 +121,14 @@ Result<FileLoader::FileInfo> FileDownloader::init() {
       return Status::OK();
     }();
   }
+  if (part_size == 0 && is_small_ && size_ > 0 && !remote_.is_web()) {
+    // small files are downloaded in one part of the least sufficient size, so that much more of them fit
+    // into the small download resource limit and their queries are sent together in the same containers
+    part_size = 4 << 10;
+    while (part_size < size_) {
+      part_size *= 2;
+    }
+  }
 
   FileInfo res;
   res.size = size_;
@@ -132,17 +160,24 @@ Status FileDownloader::on_ok(int64 size) {
     TRY_RESULT(path_stat, stat(path_));
     size = path_stat.size_;
   }
-  if (only_check_) {
+  if (only_check_ && !is_shared_file_) {
     path = path_;
   } else {
     TRY_RESULT_ASSIGN(path, create_from_temp(remote_.file_type_, path_, name_));
+    if (!is_shared_file_ && encryption_key_.empty() && !remote_.is_web() && size == size_) {
+      add_shared_file(remote_, path);
+    }
   }
-  callback_->on_ok(FullLocalFileLocation(remote_.file_type_, std::move(path), 0), size, !only_check_);
+  callback_->on_ok(FullLocalFileLocation(remote_.file_type_, std::move(path), 0), size,
+                   !only_check_ || is_shared_file_);
   return Status::OK();
 }
 
 void FileDownloader::on_error(Status status) {
   fd_.close();
+  if (is_shared_file_) {
+    unlink(path_).ignore();
+  }
   callback_->on_error(std::move(status));
 }
 
@@ -362,8 +397,16 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
                     bytes.as_mutable_slice());
   }
 
-  auto slice = bytes.as_slice().substr(0, part.size);
   TRY_STATUS(acquire_fd());
+  if (!encryption_key_.is_secret()) {
+    // parts of secret files must be finished in order, because the IV of a partial download depends on them
+    bytes.truncate(part.size);
+    if (write_part_async(fd_, part, bytes)) {
+      LOG(INFO) << "Started write of part " << part.id << " at offset " << part.offset << " for \"" << path_ << '"';
+      return ASYNC_PART_SIZE;
+    }
+  }
+  auto slice = bytes.as_slice().substr(0, part.size);
   LOG(INFO) << "Receive " << slice.size() << " bytes at offset " << part.offset << " for \"" << path_ << '"';
   TRY_RESULT(written, fd_.pwrite(slice, part.offset));
   LOG(INFO) << "Written " << written << " bytes";
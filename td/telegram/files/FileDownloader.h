@@ -48,6 +48,7 @@ class FileDownloader final : public FileLoader {
   FileEncryptionKey encryption_key_;
   unique_ptr<Callback> callback_;
   bool only_check_{false};
+  bool is_shared_file_{false};
 
   string path_;
   FileFd fd_;
@@ -0,0 +1,138 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileGcIndex.h"
+
+#include "td/telegram/Global.h"
+
+#include "td/db/SqliteKeyValue.h"
+
+#include "td/utils/FlatHashSet.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/tl_helpers.h"
+
+namespace td {
+
+static const char FILE_GC_INDEX_KEY_PREFIX[] = "gcf:";
+static const char FILE_GC_INDEX_BUILD_TIME_KEY[] = "gci";
+
+namespace {
+struct FileGcInfo {
+  int32 file_type = 0;
+  DialogId owner_dialog_id;
+  int64 size = 0;
+  uint64 atime_nsec = 0;
+  uint64 mtime_nsec = 0;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    td::store(file_type, storer);
+    td::store(owner_dialog_id, storer);
+    td::store(size, storer);
+    td::store(atime_nsec, storer);
+    td::store(mtime_nsec, storer);
+  }
+
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    td::parse(file_type, parser);
+    td::parse(owner_dialog_id, parser);
+    td::parse(size, parser);
+    td::parse(atime_nsec, parser);
+    td::parse(mtime_nsec, parser);
+  }
+};
+}  // namespace
+
+string get_file_gc_index_key(Slice path) {
+  return PSTRING() << FILE_GC_INDEX_KEY_PREFIX << path;
+}
+
+string serialize_file_gc_info(const FullFileInfo &info) {
+  FileGcInfo gc_info;
+  gc_info.file_type = static_cast<int32>(info.file_type);
+  gc_info.owner_dialog_id = info.owner_dialog_id;
+  gc_info.size = info.size;
+  gc_info.atime_nsec = info.atime_nsec;
+  gc_info.mtime_nsec = info.mtime_nsec;
+  return serialize(gc_info);
+}
+
+Result<FullFileInfo> parse_file_gc_info(Slice path, Slice value) {
+  FileGcInfo gc_info;
+  TRY_STATUS(unserialize(gc_info, value));
+  if (gc_info.file_type < 0 || gc_info.file_type >= MAX_FILE_TYPE) {
+    return Status::Error("Invalid file type");
+  }
+  FullFileInfo info;
+  info.file_type = static_cast<FileType>(gc_info.file_type);
+  info.path = path.str();
+  info.owner_dialog_id = gc_info.owner_dialog_id;
+  info.size = gc_info.size;
+  info.atime_nsec = gc_info.atime_nsec;
+  info.mtime_nsec = gc_info.mtime_nsec;
+  return std::move(info);
+}
+
+double get_file_gc_index_build_time(SqliteKeyValue &pmc) {
+  return to_double(pmc.get(FILE_GC_INDEX_BUILD_TIME_KEY));
+}
+
+Result<vector<FullFileInfo>> load_file_gc_index(SqliteKeyValue &pmc, CancellationToken &token) {
+  vector<FullFileInfo> files;
+  pmc.get_by_prefix(FILE_GC_INDEX_KEY_PREFIX, [&](Slice key, Slice value) {
+    if (token) {
+      return false;
+    }
+    auto path = key.substr(Slice(FILE_GC_INDEX_KEY_PREFIX).size());
+    auto r_info = parse_file_gc_info(path, value);
+    if (r_info.is_error()) {
+      LOG(ERROR) << "Invalid files GC index entry " << tag("path", path) << tag("value", format::escaped(value));
+      return true;
+    }
+    files.push_back(r_info.move_as_ok());
+    return true;
+  });
+  if (token) {
+    return Global::request_aborted_error();
+  }
+  return std::move(files);
+}
+
+void rebuild_file_gc_index(SqliteKeyValue &pmc, const vector<FullFileInfo> &files, double scan_start_time) {
+  FlatHashSet<string> paths;
+  for (auto &info : files) {
+    paths.insert(info.path);
+  }
+
+  // files, which were added after the scan had started, can be absent in files
+  auto min_mtime_nsec = static_cast<uint64>(scan_start_time * 1e9);
+  vector<string> deleted_keys;
+  pmc.get_by_prefix(FILE_GC_INDEX_KEY_PREFIX, [&](Slice key, Slice value) {
+    auto path = key.substr(Slice(FILE_GC_INDEX_KEY_PREFIX).size());
+    if (paths.count(path.str()) != 0) {
+      return true;
+    }
+    auto r_info = parse_file_gc_info(path, value);
+    if (r_info.is_error() || r_info.ok().mtime_nsec < min_mtime_nsec) {
+      deleted_keys.push_back(key.str());
+    }
+    return true;
+  });
+
+  pmc.begin_write_transaction().ensure();
+  pmc.erase_batch(std::move(deleted_keys));
+  for (auto &info : files) {
+    pmc.set(get_file_gc_index_key(info.path), serialize_file_gc_info(info));
+  }
+  pmc.set(FILE_GC_INDEX_BUILD_TIME_KEY, PSLICE() << static_cast<int64>(scan_start_time));
+  pmc.commit_transaction().ensure();
+}
+
+}  // namespace td
@@ -0,0 +1,37 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/files/FileStats.h"
+
+#include "td/utils/CancellationToken.h"
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+class SqliteKeyValue;
+
+// persistent index of files in the files directories with their size and access time, which is stored in the file
+// database and is updated by FileManager, so files GC doesn't need to scan all the files directories on each run
+
+string get_file_gc_index_key(Slice path);
+
+string serialize_file_gc_info(const FullFileInfo &info);
+
+Result<FullFileInfo> parse_file_gc_info(Slice path, Slice value);
+
+// returns the time of the last full rebuild of the index or 0 if the index has never been built
+double get_file_gc_index_build_time(SqliteKeyValue &pmc);
+
+Result<vector<FullFileInfo>> load_file_gc_index(SqliteKeyValue &pmc, CancellationToken &token);
+
+// replaces the index with the files found by a scan started at scan_start_time, but keeps files added after it
+void rebuild_file_gc_index(SqliteKeyValue &pmc, const vector<FullFileInfo> &files, double scan_start_time);
+
+}  // namespace td
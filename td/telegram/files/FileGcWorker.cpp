@@ -6,10 +6,13 @@
 //
 #include "td/telegram/files/FileGcWorker.h"
 
+#include "td/telegram/files/FileDb.h"
+#include "td/telegram/files/FileGcIndex.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileManager.h"
 #include "td/telegram/files/FileType.h"
 #include "td/telegram/Global.h"
+#include "td/telegram/TdDb.h"
 #include "td/telegram/TdParameters.h"
 
 #include "td/utils/algorithm.h"
@@ -17,7 +20,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/Clocks.h"
-#include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/Time.h"
 
 #include <algorithm>
@@ -28,9 +31,24 @@ namespace td {
 int VERBOSITY_NAME(file_gc) = VERBOSITY_NAME(INFO);
 
 void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFileInfo> files,
-                          Promise<FileGcResult> promise) {
+                          double scan_start_time, Promise<FileGcResult> promise) {
+  do_run_gc(parameters, std::move(files), false, scan_start_time, std::move(promise));
+}
+
+void FileGcWorker::run_gc_from_index(const FileGcParameters &parameters, Promise<FileGcResult> promise) {
+  auto r_files = load_file_gc_index(G()->td_db()->get_file_db_shared()->pmc(), token_);
+  if (r_files.is_error()) {
+    return promise.set_error(r_files.move_as_error());
+  }
+  do_run_gc(parameters, r_files.move_as_ok(), true, 0.0, std::move(promise));
+}
+
+void FileGcWorker::do_run_gc(const FileGcParameters &parameters, std::vector<FullFileInfo> files, bool is_from_index,
+                             double scan_start_time, Promise<FileGcResult> promise) {
+  CHECK(!finish_promise_);
+  CHECK(pending_unlink_batch_count_ == 0);
   auto begin_time = Time::now();
-  VLOG(file_gc) << "Start files GC with " << parameters;
+  VLOG(file_gc) << "Start files GC with " << parameters << (is_from_index ? " using files index" : "");
   // quite stupid implementations
   // needs a lot of memory
   // may write something more clever, but i will need at least 2 passes over the files
@@ -73,6 +91,7 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
   int32 remove_by_atime_cnt = 0;
   int32 remove_by_count_cnt = 0;
   int32 remove_by_size_cnt = 0;
+  int32 changed_file_cnt = 0;
   int64 total_removed_size = 0;
   int64 total_size = 0;
   for (auto &info : files) {
@@ -82,15 +101,45 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
     total_size += info.size;
   }
 
-  FileStats new_stats(false, parameters.dialog_limit_ != 0);
-  FileStats removed_stats(false, parameters.dialog_limit_ != 0);
+  // files have owner dialogs if the file database is used, so the statistics can be reused by StorageManager
+  bool split_by_owner_dialog_id = parameters.dialog_limit_ != 0 || G()->parameters().use_file_db;
+  FileStats new_stats(false, split_by_owner_dialog_id);
+  FileStats removed_stats(false, split_by_owner_dialog_id);
+
+  vector<FullFileInfo> kept_files;
+  auto keep_file = [&](const FullFileInfo &info) {
+    new_stats.add_copy(info);
+    if (scan_start_time > 0) {
+      kept_files.push_back(info);
+    }
+  };
 
-  auto do_remove_file = [&removed_stats](const FullFileInfo &info) {
+  // the index can be outdated, because the files could be deleted or accessed not through FileManager
+  vector<string> missing_file_paths;
+  vector<FullFileInfo> changed_files;
+  auto do_remove_file = [&](const FullFileInfo &info) {
+    if (is_from_index) {
+      auto r_stat = stat(info.path);
+      if (r_stat.is_error()) {
+        missing_file_paths.push_back(info.path);
+        return false;
+      }
+      const auto &stat = r_stat.ok();
+      auto access_time_nsec = td::max(stat.atime_nsec_, stat.mtime_nsec_);
+      if (access_time_nsec > info.atime_nsec) {
+        FullFileInfo new_info = info;
+        new_info.size = stat.real_size_;
+        new_info.atime_nsec = access_time_nsec;
+        new_info.mtime_nsec = stat.mtime_nsec_;
+        changed_file_cnt++;
+        keep_file(new_info);
+        changed_files.push_back(std::move(new_info));
+        return false;
+      }
+    }
     removed_stats.add_copy(info);
-    auto status = unlink(info.path);
-    LOG_IF(WARNING, status.is_error()) << "Failed to unlink file \"" << info.path << "\" during files GC: " << status;
-    send_closure(G()->file_manager(), &FileManager::on_file_unlink,
-                 FullLocalFileLocation(info.file_type, info.path, info.mtime_nsec));
+    unlink_file(info);
+    return true;
   };
 
   double now = Clocks::system();
@@ -102,35 +151,37 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
     }
     if (immune_types[narrow_cast<size_t>(info.file_type)]) {
       type_immunity_ignored_cnt++;
-      new_stats.add_copy(info);
+      keep_file(info);
       return true;
     }
     if (td::contains(parameters.exclude_owner_dialog_ids_, info.owner_dialog_id)) {
       exclude_owner_dialog_id_ignored_cnt++;
-      new_stats.add_copy(info);
+      keep_file(info);
       return true;
     }
     if (!parameters.owner_dialog_ids_.empty() && !td::contains(parameters.owner_dialog_ids_, info.owner_dialog_id)) {
       owner_dialog_id_ignored_cnt++;
-      new_stats.add_copy(info);
+      keep_file(info);
       return true;
     }
     if (static_cast<double>(info.mtime_nsec) * 1e-9 > now - parameters.immunity_delay_) {
       // new files are immune to GC
       time_immunity_ignored_cnt++;
-      new_stats.add_copy(info);
+      keep_file(info);
       return true;
     }
 
     if (static_cast<double>(info.atime_nsec) * 1e-9 < now - parameters.max_time_from_last_access_) {
-      do_remove_file(info);
-      total_removed_size += info.size;
-      remove_by_atime_cnt++;
+      if (do_remove_file(info)) {
+        total_removed_size += info.size;
+        remove_by_atime_cnt++;
+      }
       return true;
     }
     return false;
   });
   if (token_) {
+    flush_unlink_batch();
     return promise.set_error(Global::request_aborted_error());
   }
 
@@ -151,8 +202,13 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
   size_t pos = 0;
   while (pos < files.size() && (remove_count > 0 || remove_size > 0)) {
     if (token_) {
+      flush_unlink_batch();
       return promise.set_error(Global::request_aborted_error());
     }
+    if (!do_remove_file(files[pos])) {
+      pos++;
+      continue;
+    }
     if (remove_count > 0) {
       remove_by_count_cnt++;
     } else {
@@ -165,15 +221,27 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
     remove_size -= files[pos].size;
 
     total_removed_size += files[pos].size;
-    do_remove_file(files[pos]);
     pos++;
   }
 
   while (pos < files.size()) {
-    new_stats.add_copy(files[pos]);
+    keep_file(files[pos]);
     pos++;
   }
 
+  auto file_db = G()->td_db()->get_file_db_shared();
+  if (file_db != nullptr) {
+    if (!missing_file_paths.empty()) {
+      file_db->clear_file_gc_infos(std::move(missing_file_paths));
+    }
+    for (auto &info : changed_files) {
+      file_db->set_file_gc_info(info);
+    }
+    if (scan_start_time > 0) {
+      file_db->rebuild_file_gc_index(std::move(kept_files), scan_start_time);
+    }
+  }
+
   auto end_time = Time::now();
 
   VLOG(file_gc) << "Finish files GC: " << tag("time", end_time - begin_time) << tag("total", file_cnt)
@@ -184,7 +252,8 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
                 << tag("by_size", remove_by_size_cnt) << tag("type_immunity", type_immunity_ignored_cnt)
                 << tag("time_immunity", time_immunity_ignored_cnt)
                 << tag("owner_dialog_id_immunity", owner_dialog_id_ignored_cnt)
-                << tag("exclude_owner_dialog_id_immunity", exclude_owner_dialog_id_ignored_cnt);
+                << tag("exclude_owner_dialog_id_immunity", exclude_owner_dialog_id_ignored_cnt)
+                << tag("changed", changed_file_cnt);
   if (end_time - begin_time > 1.0) {
     LOG(WARNING) << "Finish file GC: " << tag("time", end_time - begin_time) << tag("total", file_cnt)
                  << tag("removed", remove_by_atime_cnt + remove_by_count_cnt + remove_by_size_cnt)
@@ -192,7 +261,51 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
                  << tag("total_removed_size", format::as_size(total_removed_size));
   }
 
-  promise.set_value({std::move(new_stats), std::move(removed_stats)});
+  flush_unlink_batch();
+  finish_promise_ = PromiseCreator::lambda(
+      [result = FileGcResult{std::move(new_stats), std::move(removed_stats)},
+       promise = std::move(promise)](Result<Unit> r_unit) mutable {
+        if (r_unit.is_error()) {
+          return promise.set_error(r_unit.move_as_error());
+        }
+        promise.set_value(std::move(result));
+      });
+  if (pending_unlink_batch_count_ == 0) {
+    finish_promise_.set_value(Unit());
+  }
+}
+
+void FileGcWorker::unlink_file(const FullFileInfo &info) {
+  unlink_batch_.emplace_back(info.file_type, info.path, info.mtime_nsec);
+  if (unlink_batch_.size() >= UNLINK_BATCH_SIZE) {
+    flush_unlink_batch();
+  }
+}
+
+void FileGcWorker::flush_unlink_batch() {
+  if (unlink_batch_.empty()) {
+    return;
+  }
+  pending_unlink_batch_count_++;
+  send_closure(G()->file_manager(), &FileManager::unlink_gc_files, std::move(unlink_batch_),
+               PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+                 send_closure(actor_id, &FileGcWorker::on_unlink_batch_finished);
+               }));
+  unlink_batch_.clear();
+}
+
+void FileGcWorker::on_unlink_batch_finished() {
+  CHECK(pending_unlink_batch_count_ > 0);
+  pending_unlink_batch_count_--;
+  if (pending_unlink_batch_count_ == 0 && finish_promise_) {
+    finish_promise_.set_value(Unit());
+  }
+}
+
+void FileGcWorker::tear_down() {
+  if (finish_promise_) {
+    finish_promise_.set_error(Global::request_aborted_error());
+  }
 }
 
 }  // namespace td
@@ -7,11 +7,13 @@
 #pragma once
 
 #include "td/telegram/files/FileGcParameters.h"
+#include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileStats.h"
 
 #include "td/actor/actor.h"
 
 #include "td/utils/CancellationToken.h"
+#include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/Promise.h"
 
@@ -28,11 +30,36 @@ class FileGcWorker final : public Actor {
  public:
   FileGcWorker(ActorShared<> parent, CancellationToken token) : parent_(std::move(parent)), token_(std::move(token)) {
   }
-  void run_gc(const FileGcParameters &parameters, std::vector<FullFileInfo> files, Promise<FileGcResult> promise);
+
+  // files must contain all files from the files directories; the files GC index is rebuilt from them
+  // if scan_start_time is positive
+  void run_gc(const FileGcParameters &parameters, std::vector<FullFileInfo> files, double scan_start_time,
+              Promise<FileGcResult> promise);
+
+  // takes files from the files GC index instead of scanning the files directories
+  void run_gc_from_index(const FileGcParameters &parameters, Promise<FileGcResult> promise);
 
  private:
+  static constexpr size_t UNLINK_BATCH_SIZE = 100;
+
   ActorShared<> parent_;
   CancellationToken token_;
+
+  // files are unlinked by FileLoadManager in batches, while the next files are being chosen
+  vector<FullLocalFileLocation> unlink_batch_;
+  size_t pending_unlink_batch_count_ = 0;
+  Promise<Unit> finish_promise_;
+
+  void do_run_gc(const FileGcParameters &parameters, std::vector<FullFileInfo> files, bool is_from_index,
+                 double scan_start_time, Promise<FileGcResult> promise);
+
+  void unlink_file(const FullFileInfo &info);
+
+  void flush_unlink_batch();
+
+  void on_unlink_batch_finished();
+
+  void tear_down() final;
 };
 
 }  // namespace td
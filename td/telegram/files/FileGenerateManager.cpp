@@ -423,7 +423,7 @@ static Status check_mtime(std::string &conversion, CSlice original_path) {
 }
 
 void FileGenerateManager::generate_file(uint64 query_id, FullGenerateFileLocation generate_location,
-                                        const LocalFileLocation &local_location, string name,
+                                        const LocalFileLocation &local_location, string name, int8 priority,
                                         unique_ptr<FileGenerateCallback> callback) {
   LOG(INFO) << "Begin to generate file with " << generate_location;
   auto mtime_status = check_mtime(generate_location.conversion_, generate_location.original_path_);
@@ -434,32 +434,75 @@ void FileGenerateManager::generate_file(uint64 query_id, FullGenerateFileLocatio
   CHECK(query_id != 0);
   auto it_flag = query_id_to_query_.emplace(query_id, Query{});
   LOG_CHECK(it_flag.second) << "Query identifier must be unique";
-  auto parent = actor_shared(this, query_id);
 
   Slice file_id_query = "#file_id#";
   Slice conversion = generate_location.conversion_;
 
   auto &query = it_flag.first->second;
+  query.priority_ = priority;
   if (begins_with(conversion, file_id_query)) {
     auto file_id = FileId(to_integer<int32>(conversion.substr(file_id_query.size())), 0);
     query.worker_ = create_actor<FileDownloadGenerateActor>("FileDownloadGenerateActor", generate_location.file_type_,
-                                                            file_id, std::move(callback), std::move(parent));
+                                                            file_id, std::move(callback), actor_shared(this, query_id));
   } else if (FileManager::is_remotely_generated_file(conversion) && generate_location.original_path_.empty()) {
     query.worker_ = create_actor<WebFileDownloadGenerateActor>("WebFileDownloadGenerateActor",
                                                                std::move(generate_location.conversion_),
-                                                               std::move(callback), std::move(parent));
+                                                               std::move(callback), actor_shared(this, query_id));
   } else {
-    query.worker_ = create_actor<FileExternalGenerateActor>("FileExternalGenerationActor", query_id, generate_location,
-                                                            local_location, std::move(name), std::move(callback),
-                                                            std::move(parent));
+    query.is_external_ = true;
+    query.pending_ = make_unique<Query::PendingExternalGeneration>(Query::PendingExternalGeneration{
+        std::move(generate_location), local_location, std::move(name), std::move(callback)});
+    pending_external_queries_.emplace(-priority, query_id);
+    start_external_generations();
   }
 }
 
+void FileGenerateManager::start_external_generations() {
+  while (active_external_query_count_ < MAX_ACTIVE_EXTERNAL_GENERATIONS && !pending_external_queries_.empty()) {
+    auto query_id = pending_external_queries_.begin()->second;
+    pending_external_queries_.erase(pending_external_queries_.begin());
+
+    auto it = query_id_to_query_.find(query_id);
+    CHECK(it != query_id_to_query_.end());
+    auto &query = it->second;
+    CHECK(query.pending_ != nullptr);
+    auto pending = std::move(query.pending_);
+
+    LOG(INFO) << "Start external generation " << query_id << " with priority " << query.priority_;
+    active_external_query_count_++;
+    // writing and copying of generated files is done on a separate scheduler to not delay downloads
+    query.worker_ = create_actor_on_scheduler<FileExternalGenerateActor>(
+        "FileExternalGenerationActor", G()->get_gc_scheduler_id(), query_id, pending->generate_location_,
+        pending->local_location_, std::move(pending->name_), std::move(pending->callback_),
+        actor_shared(this, query_id));
+  }
+}
+
+void FileGenerateManager::set_priority(uint64 query_id, int8 priority) {
+  auto it = query_id_to_query_.find(query_id);
+  if (it == query_id_to_query_.end()) {
+    return;
+  }
+  auto &query = it->second;
+  if (query.pending_ != nullptr && query.priority_ != priority) {
+    pending_external_queries_.erase({-query.priority_, query_id});
+    pending_external_queries_.emplace(-priority, query_id);
+  }
+  query.priority_ = priority;
+}
+
 void FileGenerateManager::cancel(uint64 query_id) {
   auto it = query_id_to_query_.find(query_id);
   if (it == query_id_to_query_.end()) {
     return;
   }
+  if (it->second.pending_ != nullptr) {
+    auto callback = std::move(it->second.pending_->callback_);
+    pending_external_queries_.erase({-it->second.priority_, query_id});
+    query_id_to_query_.erase(it);
+    callback->on_error(Status::Error(-1, "Canceled"));
+    return;
+  }
   it->second.worker_.reset();
 }
 
@@ -496,7 +539,20 @@ void FileGenerateManager::external_file_generate_finish(uint64 query_id, Status
 }
 
 void FileGenerateManager::do_cancel(uint64 query_id) {
-  query_id_to_query_.erase(query_id);
+  auto it = query_id_to_query_.find(query_id);
+  if (it == query_id_to_query_.end()) {
+    return;
+  }
+  if (it->second.is_external_) {
+    CHECK(it->second.pending_ == nullptr);
+    CHECK(active_external_query_count_ > 0);
+    active_external_query_count_--;
+  }
+  query_id_to_query_.erase(it);
+
+  if (!close_flag_) {
+    start_external_generations();
+  }
 }
 
 void FileGenerateManager::hangup_shared() {
@@ -506,6 +562,14 @@ void FileGenerateManager::hangup_shared() {
 
 void FileGenerateManager::hangup() {
   close_flag_ = true;
+  for (auto &query_id : pending_external_queries_) {
+    auto it = query_id_to_query_.find(query_id.second);
+    CHECK(it != query_id_to_query_.end());
+    auto callback = std::move(it->second.pending_->callback_);
+    query_id_to_query_.erase(it);
+    callback->on_error(Status::Error(-1, "Canceled"));
+  }
+  pending_external_queries_.clear();
   for (auto &it : query_id_to_query_) {
     it.second.worker_.reset();
   }
@@ -10,10 +10,13 @@
 
 #include "td/actor/actor.h"
 
+#include "td/utils/common.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Status.h"
 
 #include <map>
+#include <set>
+#include <utility>
 
 namespace td {
 
@@ -37,7 +40,9 @@ class FileGenerateManager final : public Actor {
   }
 
   void generate_file(uint64 query_id, FullGenerateFileLocation generate_location,
-                     const LocalFileLocation &local_location, string name, unique_ptr<FileGenerateCallback> callback);
+                     const LocalFileLocation &local_location, string name, int8 priority,
+                     unique_ptr<FileGenerateCallback> callback);
+  void set_priority(uint64 query_id, int8 priority);
   void cancel(uint64 query_id);
 
   // external updates about file generation state
@@ -56,16 +61,32 @@ class FileGenerateManager final : public Actor {
     ~Query();
 
     ActorOwn<FileGenerateActor> worker_;
+    int8 priority_ = 0;
+    bool is_external_ = false;
+
+    // parameters of an external generation, which is waiting for a free worker
+    struct PendingExternalGeneration {
+      FullGenerateFileLocation generate_location_;
+      LocalFileLocation local_location_;
+      string name_;
+      unique_ptr<FileGenerateCallback> callback_;
+    };
+    unique_ptr<PendingExternalGeneration> pending_;
   };
 
+  static constexpr size_t MAX_ACTIVE_EXTERNAL_GENERATIONS = 16;
+
   ActorShared<> parent_;
   std::map<uint64, Query> query_id_to_query_;
+  std::set<std::pair<int32, uint64>> pending_external_queries_;  // (-priority, query_id)
+  size_t active_external_query_count_ = 0;
   bool close_flag_ = false;
 
   void hangup() final;
   void hangup_shared() final;
   void loop() final;
   void do_cancel(uint64 query_id);
+  void start_external_generations();
 };
 
 }  // namespace td
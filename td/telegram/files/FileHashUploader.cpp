@@ -17,108 +17,116 @@
 #include "td/utils/crypto.h"
 #include "td/utils/logging.h"
 #include "td/utils/MimeType.h"
-#include "td/utils/misc.h"
 #include "td/utils/PathView.h"
 #include "td/utils/port/FileFd.h"
-#include "td/utils/port/PollFlags.h"
+#include "td/utils/Promise.h"
 #include "td/utils/Status.h"
 
 namespace td {
 
-void FileHashUploader::start_up() {
-  auto status = init();
-  if (status.is_error()) {
-    callback_->on_error(std::move(status));
-    stop_flag_ = true;
-    return;
+// calculates SHA-256 of a file in chunks, so that other actors on the same scheduler aren't blocked for long
+class FileSha256Calculator final : public Actor {
+ public:
+  FileSha256Calculator(string path, int64 size, Promise<string> promise)
+      : path_(std::move(path)), size_(size), promise_(std::move(promise)) {
   }
-}
 
-Status FileHashUploader::init() {
-  TRY_RESULT(fd, FileFd::open(local_.path_, FileFd::Read));
-  TRY_RESULT(file_size, fd.get_size());
-  if (file_size != size_) {
-    return Status::Error("Size mismatch");
-  }
-  fd_ = BufferedFd<FileFd>(std::move(fd));
-  sha256_state_.init();
+ private:
+  static constexpr int64 CHUNK_SIZE = 1 << 20;
 
-  resource_state_.set_unit_size(1024);
-  resource_state_.update_estimated_limit(size_);
-  return Status::OK();
-}
+  string path_;
+  int64 size_;
+  Promise<string> promise_;
 
-void FileHashUploader::loop() {
-  if (stop_flag_) {
-    return;
-  }
+  FileFd fd_;
+  int64 offset_ = 0;
+  BufferSlice buffer_;
+  Sha256State sha256_state_;
 
-  auto status = loop_impl();
-  if (status.is_error()) {
-    callback_->on_error(std::move(status));
-    stop_flag_ = true;
-    return;
+  void start_up() final {
+    auto status = init();
+    if (status.is_error()) {
+      return finish(std::move(status));
+    }
+    loop();
   }
-}
 
-Status FileHashUploader::loop_impl() {
-  if (state_ == State::CalcSha) {
-    TRY_STATUS(loop_sha());
+  Status init() {
+    TRY_RESULT_ASSIGN(fd_, FileFd::open(path_, FileFd::Read));
+    TRY_RESULT(file_size, fd_.get_size());
+    if (file_size != size_) {
+      return Status::Error("Size mismatch");
+    }
+    buffer_ = BufferSlice(static_cast<size_t>(min(CHUNK_SIZE, size_)));
+    sha256_state_.init();
+    return Status::OK();
   }
-  if (state_ == State::NetRequest) {
-    // messages.getDocumentByHash#338e2464 sha256:bytes size:long mime_type:string = Document;
-    auto hash = BufferSlice(32);
-    sha256_state_.extract(hash.as_mutable_slice(), true);
-    auto mime_type = MimeType::from_extension(PathView(local_.path_).extension(), "image/gif");
-    auto query = telegram_api::messages_getDocumentByHash(std::move(hash), size_, std::move(mime_type));
-    LOG(INFO) << "Send getDocumentByHash request: " << to_string(query);
-    auto ptr = G()->net_query_creator().create(query);
-    G()->net_query_dispatcher().dispatch_with_callback(std::move(ptr), actor_shared(this));
-    state_ = State::WaitNetResult;
+
+  void loop() final {
+    auto status = hash_next_chunk();
+    if (status.is_error()) {
+      return finish(std::move(status));
+    }
+    if (offset_ == size_) {
+      auto hash = string(32, '\0');
+      sha256_state_.extract(hash, true);
+      promise_.set_value(std::move(hash));
+      return stop();
+    }
+    yield();
   }
-  return Status::OK();
-}
 
-Status FileHashUploader::loop_sha() {
-  auto limit = resource_state_.unused();
-  if (limit == 0) {
+  Status hash_next_chunk() {
+    auto chunk = buffer_.as_mutable_slice().truncate(static_cast<size_t>(min(size_ - offset_, CHUNK_SIZE)));
+    TRY_RESULT(read_size, fd_.pread(chunk, offset_));
+    if (read_size != chunk.size()) {
+      return Status::Error("Unexpected end of file");
+    }
+    sha256_state_.feed(chunk);
+    offset_ += static_cast<int64>(read_size);
     return Status::OK();
   }
-  if (limit > size_left_) {
-    limit = size_left_;
+
+  void finish(Status status) {
+    promise_.set_error(std::move(status));
+    stop();
   }
-  resource_state_.start_use(limit);
+};
+
+void FileHashUploader::start_up() {
+  hash_calculator_ = create_actor_on_scheduler<FileSha256Calculator>(
+      "FileSha256Calculator", G()->get_gc_scheduler_id(), local_.path_, size_,
+      PromiseCreator::lambda([actor_id = actor_id(this)](Result<string> r_hash) {
+        send_closure(actor_id, &FileHashUploader::on_hash, std::move(r_hash));
+      }));
+}
 
-  fd_.get_poll_info().add_flags(PollFlags::Read());
-  TRY_RESULT(read_size, fd_.flush_read(static_cast<size_t>(limit)));
-  if (read_size != static_cast<size_t>(limit)) {
-    return Status::Error("Unexpected end of file");
+void FileHashUploader::on_hash(Result<string> r_hash) {
+  hash_calculator_.release();
+  if (stop_flag_) {
+    return;
   }
-  while (true) {
-    auto ready = fd_.input_buffer().prepare_read();
-    if (ready.empty()) {
-      break;
-    }
-    sha256_state_.feed(ready);
-    fd_.input_buffer().confirm_read(ready.size());
+  if (r_hash.is_error()) {
+    return on_error(r_hash.move_as_error());
   }
-  resource_state_.stop_use(limit);
 
-  size_left_ -= narrow_cast<int64>(read_size);
-  CHECK(size_left_ >= 0);
-  if (size_left_ == 0) {
-    state_ = State::NetRequest;
-    return Status::OK();
-  }
-  return Status::OK();
+  // messages.getDocumentByHash#338e2464 sha256:bytes size:long mime_type:string = Document;
+  auto mime_type = MimeType::from_extension(PathView(local_.path_).extension(), "image/gif");
+  auto query = telegram_api::messages_getDocumentByHash(BufferSlice(r_hash.ok()), size_, std::move(mime_type));
+  LOG(INFO) << "Send getDocumentByHash request: " << to_string(query);
+  auto ptr = G()->net_query_creator().create(query);
+  G()->net_query_dispatcher().dispatch_with_callback(std::move(ptr), actor_shared(this));
+}
+
+void FileHashUploader::on_error(Status status) {
+  callback_->on_error(std::move(status));
+  stop_flag_ = true;
 }
 
 void FileHashUploader::on_result(NetQueryPtr net_query) {
   auto status = on_result_impl(std::move(net_query));
   if (status.is_error()) {
-    callback_->on_error(std::move(status));
-    stop_flag_ = true;
-    return;
+    return on_error(std::move(status));
   }
 }
 
@@ -12,9 +12,7 @@
 
 #include "td/actor/actor.h"
 
-#include "td/utils/BufferedFd.h"
-#include "td/utils/crypto.h"
-#include "td/utils/port/FileFd.h"
+#include "td/utils/common.h"
 #include "td/utils/Status.h"
 
 namespace td {
@@ -33,52 +31,37 @@ class FileHashUploader final : public FileLoaderActor {
   };
 
   FileHashUploader(const FullLocalFileLocation &local, int64 size, unique_ptr<Callback> callback)
-      : local_(local), size_(size), size_left_(size), callback_(std::move(callback)) {
+      : local_(local), size_(size), callback_(std::move(callback)) {
   }
 
+  // the file is hashed on a separate scheduler, so no resources are needed
   void set_resource_manager(ActorShared<ResourceManager> resource_manager) final {
     resource_manager_ = std::move(resource_manager);
-    send_closure(resource_manager_, &ResourceManager::update_resources, resource_state_);
   }
-
   void update_priority(int8 priority) final {
-    send_closure(resource_manager_, &ResourceManager::update_priority, priority);
   }
   void update_resources(const ResourceState &other) final {
-    if (stop_flag_) {
-      return;
-    }
-    resource_state_.update_slave(other);
-    loop();
   }
 
  private:
-  ResourceState resource_state_;
-  BufferedFd<FileFd> fd_;
-
   FullLocalFileLocation local_;
   int64 size_;
-  int64 size_left_;
   unique_ptr<Callback> callback_;
 
   ActorShared<ResourceManager> resource_manager_;
+  ActorOwn<> hash_calculator_;
 
-  enum class State : int32 { CalcSha, NetRequest, WaitNetResult } state_ = State::CalcSha;
   bool stop_flag_ = false;
-  Sha256State sha256_state_;
 
   void start_up() final;
-  Status init();
-
-  void loop() final;
 
-  Status loop_impl();
-
-  Status loop_sha();
+  void on_hash(Result<string> r_hash);
 
   void on_result(NetQueryPtr net_query) final;
 
   Status on_result_impl(NetQueryPtr net_query);
+
+  void on_error(Status status);
 };
 
 }  // namespace td
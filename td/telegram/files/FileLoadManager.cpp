@@ -6,6 +6,7 @@
 //
 #include "td/telegram/files/FileLoadManager.h"
 
+#include "td/telegram/files/ResourceArbiter.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/TdParameters.h"
@@ -13,6 +14,8 @@
 #include "td/utils/common.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/port/path.h"
 #include "td/utils/SliceBuilder.h"
 
@@ -27,8 +30,9 @@ void FileLoadManager::start_up() {
   upload_resource_manager_ = create_actor<ResourceManager>("UploadResourceManager", MAX_UPLOAD_RESOURCE_LIMIT,
                                                            !G()->parameters().use_file_db /*tdlib_engine*/
                                                                ? ResourceManager::Mode::Greedy
-                                                               : ResourceManager::Mode::Baseline);
-  if (G()->get_option_boolean("is_premium")) {
+                                                               : ResourceManager::Mode::Baseline,
+                                                           ResourceArbiter::Type::Upload, resource_tenant_id_);
+  if (G()->get_option_boolean(OptionId::IsPremium)) {
     max_download_resource_limit_ *= 8;
   }
 }
@@ -38,11 +42,17 @@ ActorOwn<ResourceManager> &FileLoadManager::get_download_resource_manager(bool i
   if (actor.empty()) {
     actor = create_actor<ResourceManager>(
         PSLICE() << "DownloadResourceManager " << tag("is_small", is_small) << tag("dc_id", dc_id),
-        max_download_resource_limit_, ResourceManager::Mode::Baseline);
+        max_download_resource_limit_, ResourceManager::Mode::Baseline, ResourceArbiter::Type::Download,
+        resource_tenant_id_);
   }
   return actor;
 }
 
+int32 FileLoadManager::get_transfer_weight(FileType file_type) {
+  auto client_weight = narrow_cast<int32>(G()->get_option_integer("file_transfer_weight", 1));
+  return client_weight * ResourceArbiter::get_file_type_weight(file_type);
+}
+
 void FileLoadManager::download(QueryId query_id, const FullRemoteFileLocation &remote_location,
                                const LocalFileLocation &local, int64 size, string name,
                                const FileEncryptionKey &encryption_key, bool search_file, int64 offset, int64 limit,
@@ -62,7 +72,8 @@ void FileLoadManager::download(QueryId query_id, const FullRemoteFileLocation &r
   DcId dc_id = remote_location.is_web() ? G()->get_webfile_dc_id() : remote_location.get_dc_id();
   auto &resource_manager = get_download_resource_manager(is_small, dc_id);
   send_closure(resource_manager, &ResourceManager::register_worker,
-               ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority);
+               ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority,
+               get_transfer_weight(remote_location.file_type_));
   bool is_inserted = query_id_to_node_id_.emplace(query_id, node_id).second;
   CHECK(is_inserted);
 }
@@ -80,27 +91,37 @@ void FileLoadManager::upload(QueryId query_id, const LocalFileLocation &local_lo
   auto callback = make_unique<FileUploaderCallback>(actor_shared(this, node_id));
   node->loader_ = create_actor<FileUploader>("Uploader", local_location, remote_location, expected_size, encryption_key,
                                              std::move(bad_parts), std::move(callback));
+  auto file_type = FileType::None;
+  switch (local_location.type()) {
+    case LocalFileLocation::Type::Partial:
+      file_type = local_location.partial().file_type_;
+      break;
+    case LocalFileLocation::Type::Full:
+      file_type = local_location.full().file_type_;
+      break;
+    default:
+      break;
+  }
   send_closure(upload_resource_manager_, &ResourceManager::register_worker,
-               ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority);
+               ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority,
+               get_transfer_weight(file_type));
   bool is_inserted = query_id_to_node_id_.emplace(query_id, node_id).second;
   CHECK(is_inserted);
 }
 
-void FileLoadManager::upload_by_hash(QueryId query_id, const FullLocalFileLocation &local_location, int64 size,
-                                     int8 priority) {
+void FileLoadManager::lookup_by_hash(QueryId query_id, const FullLocalFileLocation &local_location, int64 size) {
   if (stop_flag_) {
     return;
   }
-  NodeId node_id = nodes_container_.create(Node());
-  Node *node = nodes_container_.get(node_id);
+  auto it = query_id_to_node_id_.find(query_id);
+  if (it == query_id_to_node_id_.end()) {
+    return;
+  }
+  auto node_id = it->second;
+  auto node = nodes_container_.get(node_id);
   CHECK(node);
-  node->query_id_ = query_id;
-  auto callback = make_unique<FileHashUploaderCallback>(actor_shared(this, node_id));
-  node->loader_ = create_actor<FileHashUploader>("HashUploader", local_location, size, std::move(callback));
-  send_closure(upload_resource_manager_, &ResourceManager::register_worker,
-               ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority);
-  bool is_inserted = query_id_to_node_id_.emplace(query_id, node_id).second;
-  CHECK(is_inserted);
+  auto callback = make_unique<FileHashUploaderCallback>(actor_id(this), node_id);
+  node->hash_loader_ = create_actor<FileHashUploader>("HashUploader", local_location, size, std::move(callback));
 }
 
 void FileLoadManager::update_priority(QueryId query_id, int8 priority) {
@@ -202,7 +223,10 @@ void FileLoadManager::update_downloaded_part(QueryId query_id, int64 offset, int
 }
 
 void FileLoadManager::hangup() {
-  nodes_container_.for_each([](auto query_id, auto &node) { node.loader_.reset(); });
+  nodes_container_.for_each([](auto query_id, auto &node) {
+    node.loader_.reset();
+    node.hash_loader_.reset();
+  });
   stop_flag_ = true;
   loop();
 }
@@ -278,12 +302,12 @@ void FileLoadManager::on_ok_upload(FileType file_type, PartialRemoteFileLocation
   loop();
 }
 
-void FileLoadManager::on_ok_upload_full(FullRemoteFileLocation remote) {
-  auto node_id = get_link_token();
+void FileLoadManager::on_hash_lookup_ok(NodeId node_id, FullRemoteFileLocation remote) {
   auto node = nodes_container_.get(node_id);
   if (node == nullptr) {
     return;
   }
+  // the file has already been uploaded, so the upload can be canceled
   if (!stop_flag_) {
     send_closure(callback_, &Callback::on_upload_full_ok, node->query_id_, std::move(remote));
   }
@@ -291,6 +315,15 @@ void FileLoadManager::on_ok_upload_full(FullRemoteFileLocation remote) {
   loop();
 }
 
+void FileLoadManager::on_hash_lookup_error(NodeId node_id, Status status) {
+  auto node = nodes_container_.get(node_id);
+  if (node == nullptr) {
+    return;
+  }
+  LOG(INFO) << "Failed to find file by hash: " << status;
+  node->hash_loader_.reset();
+}
+
 void FileLoadManager::on_error(Status status) {
   auto node_id = get_link_token();
   on_error_impl(node_id, std::move(status));
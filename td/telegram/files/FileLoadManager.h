@@ -52,7 +52,8 @@ class FileLoadManager final : public Actor {
                 int64 limit, int8 priority);
   void upload(QueryId query_id, const LocalFileLocation &local_location, const RemoteFileLocation &remote_location,
               int64 expected_size, const FileEncryptionKey &encryption_key, int8 priority, vector<int> bad_parts);
-  void upload_by_hash(QueryId query_id, const FullLocalFileLocation &local_location, int64 size, int8 priority);
+  // looks for an already uploaded file with the same hash in parallel with the started upload
+  void lookup_by_hash(QueryId query_id, const FullLocalFileLocation &local_location, int64 size);
   void update_priority(QueryId query_id, int8 priority);
   void from_bytes(QueryId query_id, FileType type, BufferSlice bytes, string name);
   void cancel(QueryId query_id);
@@ -74,6 +75,7 @@ class FileLoadManager final : public Actor {
   struct Node {
     QueryId query_id_;
     ActorOwn<FileLoaderActor> loader_;
+    ActorOwn<FileLoaderActor> hash_loader_;
     ResourceState resource_state_;
   };
   using NodeId = uint64;
@@ -87,6 +89,7 @@ class FileLoadManager final : public Actor {
   ActorShared<> parent_;
   std::map<QueryId, NodeId> query_id_to_node_id_;
   int64 max_download_resource_limit_ = 1 << 21;
+  uint64 resource_tenant_id_ = ResourceArbiter::create_tenant_id();
   bool stop_flag_ = false;
 
   void start_up() final;
@@ -97,13 +100,16 @@ class FileLoadManager final : public Actor {
   void close_node(NodeId node_id);
   ActorOwn<ResourceManager> &get_download_resource_manager(bool is_small, DcId dc_id);
 
+  static int32 get_transfer_weight(FileType file_type);
+
   void on_start_download();
   void on_partial_download(PartialLocalFileLocation partial_local, int64 ready_size, int64 size);
   void on_partial_upload(PartialRemoteFileLocation partial_remote, int64 ready_size);
   void on_hash(string hash);
   void on_ok_download(FullLocalFileLocation local, int64 size, bool is_new);
   void on_ok_upload(FileType file_type, PartialRemoteFileLocation remote, int64 size);
-  void on_ok_upload_full(FullRemoteFileLocation remote);
+  void on_hash_lookup_ok(NodeId node_id, FullRemoteFileLocation remote);
+  void on_hash_lookup_error(NodeId node_id, Status status);
   void on_error(Status status);
   void on_error_impl(NodeId node_id, Status status);
 
@@ -150,19 +156,22 @@ class FileLoadManager final : public Actor {
       send_closure(std::move(actor_id_), &FileLoadManager::on_error, std::move(status));
     }
   };
+  // the hash lookup is optional, so its failure or destruction doesn't affect the upload
   class FileHashUploaderCallback final : public FileHashUploader::Callback {
    public:
-    explicit FileHashUploaderCallback(ActorShared<FileLoadManager> actor_id) : actor_id_(std::move(actor_id)) {
+    FileHashUploaderCallback(ActorId<FileLoadManager> actor_id, NodeId node_id)
+        : actor_id_(std::move(actor_id)), node_id_(node_id) {
     }
 
    private:
-    ActorShared<FileLoadManager> actor_id_;
+    ActorId<FileLoadManager> actor_id_;
+    NodeId node_id_;
 
     void on_ok(FullRemoteFileLocation remote) final {
-      send_closure(std::move(actor_id_), &FileLoadManager::on_ok_upload_full, std::move(remote));
+      send_closure(actor_id_, &FileLoadManager::on_hash_lookup_ok, node_id_, std::move(remote));
     }
     void on_error(Status status) final {
-      send_closure(std::move(actor_id_), &FileLoadManager::on_error, std::move(status));
+      send_closure(actor_id_, &FileLoadManager::on_hash_lookup_error, node_id_, std::move(status));
     }
   };
 
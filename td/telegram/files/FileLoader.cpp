@@ -15,13 +15,24 @@
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/Metrics.h"
 #include "td/utils/misc.h"
+#include "td/utils/port/PollFlags.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/Time.h"
 
 #include <tuple>
 
 namespace td {
 
+static MetricCounter file_downloaded_part_count_metric("td_file_downloaded_parts_total",
+                                                       "Number of downloaded file parts");
+static MetricCounter file_downloaded_bytes_metric("td_file_downloaded_bytes_total",
+                                                  "Total size of downloaded file parts in bytes");
+static MetricCounter file_uploaded_part_count_metric("td_file_uploaded_parts_total", "Number of uploaded file parts");
+static MetricCounter file_uploaded_bytes_metric("td_file_uploaded_bytes_total",
+                                                "Total size of uploaded file parts in bytes");
+
 void FileLoader::set_resource_manager(ActorShared<ResourceManager> resource_manager) {
   resource_manager_ = std::move(resource_manager);
   send_closure(resource_manager_, &ResourceManager::update_resources, resource_state_);
@@ -75,15 +86,20 @@ void FileLoader::update_local_file_location(const LocalFileLocation &local) {
 void FileLoader::update_downloaded_part(int64 offset, int64 limit, int64 max_resource_limit) {
   if (parts_manager_.get_streaming_offset() != offset) {
     auto begin_part_id = parts_manager_.set_streaming_offset(offset, limit);
-    auto new_end_part_id = limit <= 0 ? parts_manager_.get_part_count()
-                                      : narrow_cast<int32>((offset + limit - 1) / parts_manager_.get_part_size()) + 1;
+    // the streaming limit can be extended by the read-ahead window, whose parts must not be cancelled
+    auto streaming_limit = parts_manager_.get_streaming_limit();
+    auto new_end_part_id =
+        streaming_limit <= 0 ? parts_manager_.get_part_count()
+                             : narrow_cast<int32>((offset + streaming_limit - 1) / parts_manager_.get_part_size()) + 1;
     auto max_parts = narrow_cast<int32>(max_resource_limit / parts_manager_.get_part_size());
     auto end_part_id = begin_part_id + td::min(max_parts, new_end_part_id - begin_part_id);
     VLOG(file_loader) << "Protect parts " << begin_part_id << " ... " << end_part_id - 1;
     for (auto &it : part_map_) {
-      if (!it.second.second.empty() && !(begin_part_id <= it.second.first.id && it.second.first.id < end_part_id)) {
-        VLOG(file_loader) << "Cancel part " << it.second.first.id;
-        it.second.second.reset();  // cancel_query(it.second.second);
+      auto &part_info = it.second;
+      if (!part_info.cancel_signal.empty() &&
+          !(begin_part_id <= part_info.part.id && part_info.part.id < end_part_id)) {
+        VLOG(file_loader) << "Cancel part " << part_info.part.id;
+        part_info.cancel_signal.reset();  // cancel_query(part_info.cancel_signal);
       }
     }
   } else {
@@ -108,6 +124,7 @@ void FileLoader::start_up() {
   auto &ready_parts = file_info.ready_parts;
   auto use_part_count_limit = file_info.use_part_count_limit;
   bool is_upload = file_info.is_upload;
+  is_upload_ = is_upload;
 
   // Two cases when FILE_UPLOAD_RESTART will happen
   // 1. File is ready, size is final. But there are more uploaded parts than size of the file
@@ -147,6 +164,7 @@ void FileLoader::start_up() {
 }
 
 void FileLoader::loop() {
+  process_async_writes();
   if (stop_flag_) {
     return;
   }
@@ -215,8 +233,10 @@ Status FileLoader::do_loop() {
       CHECK(blocking_id_ == 0);
       blocking_id_ = unique_id;
     }
-    part_map_[unique_id] = std::make_pair(part, query->cancel_slot_.get_signal_new());
-    // part_map_[unique_id] = std::make_pair(part, query.get_weak());
+    auto &part_info = part_map_[unique_id];
+    part_info.part = part;
+    part_info.cancel_signal = query->cancel_slot_.get_signal_new();
+    part_info.start_time = Time::now();
 
     auto callback = actor_shared(this, unique_id);
     if (delay_dispatcher_.empty()) {
@@ -233,7 +253,11 @@ Status FileLoader::do_loop() {
 
 void FileLoader::tear_down() {
   for (auto &it : part_map_) {
-    it.second.second.reset();  // cancel_query(it.second.second);
+    it.second.cancel_signal.reset();  // cancel_query(it.second.cancel_signal);
+  }
+  if (!file_io_.empty()) {
+    Scheduler::unsubscribe_before_close(file_io_.get_poll_info().get_pollable_fd_ref());
+    file_io_.close();
   }
   ordered_parts_.clear([](auto &&part) { part.second->clear(); });
   if (!delay_dispatcher_.empty()) {
@@ -272,8 +296,9 @@ void FileLoader::on_result(NetQueryPtr query) {
     return;
   }
 
-  Part part = it->second.first;
-  it->second.second.release();
+  Part part = it->second.part;
+  auto start_time = it->second.start_time;
+  it->second.cancel_signal.release();
   CHECK(query->is_ready());
   part_map_.erase(it);
 
@@ -289,6 +314,11 @@ void FileLoader::on_result(NetQueryPtr query) {
       parts_manager_.on_part_failed(part.id);
     } else {
       next = true;
+      if (!is_upload_ && !query->is_error() && !resource_manager_.empty()) {
+        // used by ResourceManager to choose number of simultaneously downloaded parts
+        send_closure(resource_manager_, &ResourceManager::on_part_loaded, static_cast<int64>(part.size),
+                     Time::now() - start_time);
+      }
     }
     return Status::OK();
   }();
@@ -334,12 +364,27 @@ void FileLoader::on_common_query(NetQueryPtr query) {
 
 Status FileLoader::try_on_part_query(Part part, NetQueryPtr query) {
   TRY_RESULT(size, process_part(part, std::move(query)));
+  if (size == ASYNC_PART_SIZE) {
+    VLOG(file_loader) << "Wait for write of part " << tag("id", part.id) << tag("size", part.size);
+    return Status::OK();
+  }
+  return on_part_processed(part, size);
+}
+
+Status FileLoader::on_part_processed(Part part, size_t size) {
   VLOG(file_loader) << "Ok part " << tag("id", part.id) << tag("size", part.size);
   resource_state_.stop_use(static_cast<int64>(part.size));
   auto old_ready_prefix_count = parts_manager_.get_unchecked_ready_prefix_count();
   TRY_STATUS(parts_manager_.on_part_ok(part.id, part.size, size));
   auto new_ready_prefix_count = parts_manager_.get_unchecked_ready_prefix_count();
   debug_total_parts_++;
+  if (is_upload_) {
+    file_uploaded_part_count_metric.add();
+    file_uploaded_bytes_metric.add(static_cast<int64>(size));
+  } else {
+    file_downloaded_part_count_metric.add();
+    file_downloaded_bytes_metric.add(static_cast<int64>(size));
+  }
   if (old_ready_prefix_count == new_ready_prefix_count) {
     debug_bad_parts_.push_back(part.id);
     debug_bad_part_order_++;
@@ -348,6 +393,57 @@ Status FileLoader::try_on_part_query(Part part, NetQueryPtr query) {
   return Status::OK();
 }
 
+bool FileLoader::write_part_async(const FileFd &fd, Part part, BufferSlice &bytes) {
+  if (!is_file_io_inited_) {
+    is_file_io_inited_ = true;
+    auto status = file_io_.init(MAX_ASYNC_WRITE_COUNT);
+    if (status.is_error()) {
+      LOG(INFO) << "Can't use asynchronous file I/O: " << status;
+    } else {
+      Scheduler::subscribe(file_io_.get_poll_info().extract_pollable_fd(this), PollFlags::Read());
+    }
+  }
+  if (!file_io_.can_submit()) {
+    return false;
+  }
+  CHECK(async_writes_.count(part.id) == 0);
+  auto status = file_io_.submit_pwrite(fd, bytes.as_slice(), part.offset, static_cast<uint64>(part.id));
+  if (status.is_error()) {
+    LOG(INFO) << "Failed to start asynchronous write of part " << part.id << ": " << status;
+    return false;
+  }
+  async_writes_[part.id] = AsyncWrite{part, std::move(bytes)};
+  return true;
+}
+
+void FileLoader::process_async_writes() {
+  if (file_io_.empty()) {
+    return;
+  }
+  for (auto &completion : file_io_.get_completions()) {
+    auto it = async_writes_.find(narrow_cast<int32>(completion.token));
+    CHECK(it != async_writes_.end());
+    auto part = it->second.part;
+    auto size = it->second.bytes.size();
+    async_writes_.erase(it);
+    if (stop_flag_) {
+      continue;
+    }
+
+    auto status = [&] {
+      TRY_RESULT(written, std::move(completion.result));
+      if (written != size) {
+        return Status::Error("Failed to save file part to the file");
+      }
+      return on_part_processed(part, written);
+    }();
+    if (status.is_error()) {
+      on_error(std::move(status));
+      stop_flag_ = true;
+    }
+  }
+}
+
 void FileLoader::on_progress_impl() {
   Progress progress;
   progress.part_count = parts_manager_.get_part_count();
@@ -360,4 +456,6 @@ void FileLoader::on_progress_impl() {
   on_progress(std::move(progress));
 }
 
+constexpr size_t FileLoader::ASYNC_PART_SIZE;
+
 }  // namespace td
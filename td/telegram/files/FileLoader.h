@@ -16,9 +16,13 @@
 
 #include "td/actor/actor.h"
 
+#include "td/utils/buffer.h"
 #include "td/utils/OrderedEventsProcessor.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/FileIoUring.h"
 #include "td/utils/Status.h"
 
+#include <limits>
 #include <map>
 #include <utility>
 
@@ -72,6 +76,13 @@ class FileLoader : public FileLoaderActor {
   virtual void after_start_parts() {
   }
   virtual Result<size_t> process_part(Part part, NetQueryPtr net_query) TD_WARN_UNUSED_RESULT = 0;
+
+  // returned by process_part if the part is being written by write_part_async
+  static constexpr size_t ASYNC_PART_SIZE = std::numeric_limits<size_t>::max();
+
+  // tries to start asynchronous write of the whole part bytes to the file and takes the bytes on success
+  // the part will be finished after the write is completed; the file can be closed in the meantime
+  bool write_part_async(const FileFd &fd, Part part, BufferSlice &bytes);
   struct Progress {
     int32 part_count{0};
     int32 part_size{0};
@@ -114,12 +125,27 @@ class FileLoader : public FileLoaderActor {
   ResourceState resource_state_;
   PartsManager parts_manager_;
   uint64 blocking_id_{0};
-  std::map<uint64, std::pair<Part, ActorShared<>>> part_map_;
+  struct PartInfo {
+    Part part;
+    ActorShared<> cancel_signal;
+    double start_time = 0.0;
+  };
+  std::map<uint64, PartInfo> part_map_;
+  bool is_upload_ = false;
   bool ordered_flag_ = false;
   OrderedEventsProcessor<std::pair<Part, NetQueryPtr>> ordered_parts_;
   ActorOwn<DelayDispatcher> delay_dispatcher_;
   double next_delay_ = 0;
 
+  static constexpr size_t MAX_ASYNC_WRITE_COUNT = 16;
+  struct AsyncWrite {
+    Part part;
+    BufferSlice bytes;
+  };
+  std::map<int32, AsyncWrite> async_writes_;
+  bool is_file_io_inited_ = false;
+  FileIoUring file_io_;  // must be destroyed before async_writes_, because it waits for pending writes
+
   uint32 debug_total_parts_ = 0;
   uint32 debug_bad_part_order_ = 0;
   std::vector<int32> debug_bad_parts_;
@@ -133,11 +159,13 @@ class FileLoader : public FileLoaderActor {
 
   void update_estimated_limit();
   void on_progress_impl();
+  void process_async_writes();
 
   void on_result(NetQueryPtr query) final;
   void on_part_query(Part part, NetQueryPtr query);
   void on_common_query(NetQueryPtr query);
   Status try_on_part_query(Part part, NetQueryPtr query);
+  Status on_part_processed(Part part, size_t size);
 };
 
 }  // namespace td
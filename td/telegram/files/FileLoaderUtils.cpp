@@ -6,10 +6,12 @@
 //
 #include "td/telegram/files/FileLoaderUtils.h"
 
+#include "td/telegram/files/FileLocation.hpp"
 #include "td/telegram/Global.h"
 #include "td/telegram/TdDb.h"
 #include "td/telegram/TdParameters.h"
 
+#include "td/utils/base64.h"
 #include "td/utils/common.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/format.h"
@@ -21,6 +23,7 @@
 #include "td/utils/Random.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/tl_helpers.h"
 #include "td/utils/utf8.h"
 
 #include <tuple>
@@ -163,6 +166,43 @@ Result<string> search_file(FileType file_type, CSlice name, int64 expected_size)
   return res;
 }
 
+static string get_shared_file_path(const FullRemoteFileLocation &remote) {
+  auto dir = G()->get_option_string("shared_files_directory");
+  if (dir.empty()) {
+    return dir;
+  }
+  if (dir.back() != TD_DIR_SLASH) {
+    dir += TD_DIR_SLASH;
+  }
+  return dir + base64url_encode(zero_encode(serialize(remote.as_unique())));
+}
+
+Result<string> link_shared_file(const FullRemoteFileLocation &remote, int64 expected_size) {
+  auto shared_path = get_shared_file_path(remote);
+  if (shared_path.empty()) {
+    return Status::Error(500, "Shared file storage is disabled");
+  }
+  TRY_RESULT(shared_stat, stat(shared_path));
+  if (!shared_stat.is_reg_ || shared_stat.size_ != expected_size) {
+    return Status::Error(500, "Shared file has wrong size");
+  }
+  auto temp_path = PSTRING() << get_files_temp_dir(remote.file_type_) << "shared_" << RandSuff{6};
+  TRY_STATUS(link(shared_path, temp_path));
+  LOG(INFO) << "Use shared file " << shared_path << " for " << remote;
+  return std::move(temp_path);
+}
+
+void add_shared_file(const FullRemoteFileLocation &remote, CSlice path) {
+  auto shared_path = get_shared_file_path(remote);
+  if (shared_path.empty()) {
+    return;
+  }
+  mkpath(shared_path).ignore();
+  // the file can be already added by another client, or the storage can be on another file system
+  auto status = link(path, shared_path);
+  LOG_IF(INFO, status.is_error()) << "Failed to add file to shared storage: " << status;
+}
+
 Result<string> get_suggested_file_name(CSlice directory, Slice file_name) {
   string cleaned_name = clean_filename(file_name.str());
   file_name = cleaned_name;
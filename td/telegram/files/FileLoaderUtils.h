@@ -28,6 +28,11 @@ Result<string> create_from_temp(FileType file_type, CSlice temp_path, CSlice nam
 
 Result<string> search_file(FileType type, CSlice name, int64 expected_size) TD_WARN_UNUSED_RESULT;
 
+// returns path to a new temporary hard link to the file from the shared content-addressed storage
+Result<string> link_shared_file(const FullRemoteFileLocation &remote, int64 expected_size) TD_WARN_UNUSED_RESULT;
+
+void add_shared_file(const FullRemoteFileLocation &remote, CSlice path);
+
 Result<string> get_suggested_file_name(CSlice dir, Slice file_name) TD_WARN_UNUSED_RESULT;
 
 Result<FullLocalFileLocation> save_file_bytes(FileType file_type, BufferSlice bytes, CSlice file_name);
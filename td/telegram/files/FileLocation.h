@@ -56,6 +56,7 @@ struct PartialRemoteFileLocation {
   int32 part_size_;
   int32 ready_part_count_;
   int32 is_big_;
+  string ready_bitmask_;  // encoded Bitmask of all uploaded parts, ready_part_count_ is only their prefix
 
   template <class StorerT>
   void store(StorerT &storer) const;
@@ -65,7 +66,8 @@ struct PartialRemoteFileLocation {
 
 inline bool operator==(const PartialRemoteFileLocation &lhs, const PartialRemoteFileLocation &rhs) {
   return lhs.file_id_ == rhs.file_id_ && lhs.part_count_ == rhs.part_count_ && lhs.part_size_ == rhs.part_size_ &&
-         lhs.ready_part_count_ == rhs.ready_part_count_ && lhs.is_big_ == rhs.is_big_;
+         lhs.ready_part_count_ == rhs.ready_part_count_ && lhs.is_big_ == rhs.is_big_ &&
+         lhs.ready_bitmask_ == rhs.ready_bitmask_;
 }
 
 inline bool operator!=(const PartialRemoteFileLocation &lhs, const PartialRemoteFileLocation &rhs) {
@@ -27,6 +27,7 @@ void PartialRemoteFileLocation::store(StorerT &storer) const {
   store(part_size_, storer);
   store(ready_part_count_, storer);
   store(is_big_, storer);
+  store(ready_bitmask_, storer);
 }
 
 template <class ParserT>
@@ -37,6 +38,9 @@ void PartialRemoteFileLocation::parse(ParserT &parser) {
   parse(part_size_, parser);
   parse(ready_part_count_, parser);
   parse(is_big_, parser);
+  if (parser.version() >= static_cast<int32>(Version::AddPartialRemoteReadyBitmask)) {
+    parse(ready_bitmask_, parser);
+  }
 }
 
 template <class StorerT>
@@ -13,6 +13,7 @@
 #include "td/telegram/files/FileLoaderUtils.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileLocation.hpp"
+#include "td/telegram/files/FileStats.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/logevent/LogEvent.h"
 #include "td/telegram/misc.h"
@@ -32,6 +33,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/PathView.h"
+#include "td/utils/port/Clocks.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
@@ -74,8 +76,6 @@ StringBuilder &operator<<(StringBuilder &string_builder, FileLocationSource sour
 
 StringBuilder &operator<<(StringBuilder &string_builder, FileManager::Query::Type type) {
   switch (type) {
-    case FileManager::Query::Type::UploadByHash:
-      return string_builder << "UploadByHash";
     case FileManager::Query::Type::UploadWaitFileReference:
       return string_builder << "UploadWaitFileReference";
     case FileManager::Query::Type::Upload:
@@ -308,7 +308,7 @@ void FileNode::set_partial_remote_location(PartialRemoteFileLocation remote, int
     VLOG(update_file) << "Partial location of " << main_file_id_ << " is NOT changed";
     return;
   }
-  if (!remote_.partial && remote.ready_part_count_ == 0) {
+  if (!remote_.partial && remote.ready_part_count_ == 0 && remote.ready_bitmask_.empty()) {
     // empty partial remote is equal to empty remote
     VLOG(update_file) << "Partial location of " << main_file_id_
                       << " is still empty, so there is NO reason to update it";
@@ -678,6 +678,10 @@ int64 FileView::remote_size() const {
     VLOG(update_file) << "Have part_size = " << part_size << ", remote_ready_part_count = " << ready_part_count
                       << ", remote_ready_size = " << remote_ready_size << ", size = " << size();
     auto res = max(part_size * ready_part_count, remote_ready_size);
+    const auto &ready_bitmask = node_->remote_.partial->ready_bitmask_;
+    if (!ready_bitmask.empty()) {
+      res = max(res, Bitmask(Bitmask::Decode{}, ready_bitmask).get_total_size(part_size, size()));
+    }
     if (size() != 0 && size() < res) {
       res = size();
     }
@@ -837,12 +841,16 @@ void FileManager::init_actor() {
                                                                   actor_shared(this), context_->create_reference());
   file_generate_manager_ = create_actor_on_scheduler<FileGenerateManager>(
       "FileGenerateManager", G()->get_slow_net_scheduler_id(), context_->create_reference());
+  if (file_db_) {
+    set_timeout_in(FILE_NODE_EVICTION_PERIOD);
+  }
 }
 
 FileManager::~FileManager() {
   Scheduler::instance()->destroy_on_scheduler(G()->get_gc_scheduler_id(), remote_location_info_, file_hash_to_file_id_,
                                               local_location_to_file_id_, generate_location_to_file_id_,
-                                              pmc_id_to_file_node_id_, file_id_info_, empty_file_ids_, file_nodes_);
+                                              pmc_id_to_file_node_id_, file_id_info_, empty_file_ids_, file_nodes_,
+                                              evicted_file_nodes_);
 }
 
 string FileManager::fix_file_extension(Slice file_name, Slice file_type, Slice file_extension) {
@@ -1153,6 +1161,62 @@ void FileManager::on_file_unlink(const FullLocalFileLocation &location) {
   try_flush_node(file_node, "on_file_unlink");
 }
 
+void FileManager::unlink_gc_files(vector<FullLocalFileLocation> locations, Promise<Unit> promise) {
+  if (is_closed_) {
+    return promise.set_error(Global::request_aborted_error());
+  }
+  if (locations.empty()) {
+    return promise.set_value(Unit());
+  }
+
+  vector<string> paths;
+  paths.reserve(locations.size());
+  for (size_t i = 0; i < locations.size(); i++) {
+    on_file_unlink(locations[i]);
+    paths.push_back(locations[i].path_);
+    // FileLoadManager handles queries in order, so the last promise is set after all files are unlinked
+    send_closure(file_load_manager_, &FileLoadManager::unlink_file, locations[i].path_,
+                 i + 1 == locations.size() ? std::move(promise) : Promise<Unit>());
+  }
+  if (file_db_) {
+    file_db_->clear_file_gc_infos(std::move(paths));
+  }
+}
+
+void FileManager::add_to_file_gc_index(const FileView &file_view) {
+  if (!file_db_ || !file_view.has_local_location()) {
+    return;
+  }
+  const auto &location = file_view.local_location();
+  if (!begins_with(location.path_, get_files_dir(location.file_type_))) {
+    return;
+  }
+
+  FullFileInfo info;
+  info.file_type = get_main_file_type(location.file_type_);
+  info.path = location.path_;
+  info.owner_dialog_id = file_view.owner_dialog_id();
+  info.size = file_view.get_allocated_local_size();
+  info.mtime_nsec = location.mtime_nsec_;
+  info.atime_nsec = static_cast<uint64>(Clocks::system() * 1e9);
+  file_db_->set_file_gc_info(info);
+}
+
+void FileManager::on_file_access(FileNodePtr node) {
+  if (!file_db_) {
+    return;
+  }
+  const auto &path = node->local_.full().path_;
+  if (!begins_with(path, get_files_dir(node->local_.full().file_type_))) {
+    return;
+  }
+  // access time is needed only to choose files to delete, so it is enough to update it once per launch
+  if (!accessed_file_paths_.insert(path).second) {
+    return;
+  }
+  file_db_->touch_file_gc_info(path, static_cast<uint64>(Clocks::system() * 1e9));
+}
+
 Result<FileId> FileManager::register_local(FullLocalFileLocation location, DialogId owner_dialog_id, int64 size,
                                            bool get_by_hash, bool force, bool skip_file_size_checks,
                                            FileId merge_file_id) {
@@ -1282,6 +1346,7 @@ Result<FileId> FileManager::register_file(FileData &&data, FileLocationSource fi
                                    std::move(data.generate_), data.size_, data.expected_size_,
                                    std::move(data.remote_name_), std::move(data.url_), data.owner_dialog_id_,
                                    std::move(data.encryption_key_), file_id, static_cast<int8>(has_remote));
+  file_node_count_++;
   node->pmc_id_ = FileDbId(data.pmc_id_);
   get_file_id_info(file_id)->node_id_ = file_node_id;
   node->file_ids_.push_back(file_id);
@@ -1792,6 +1857,7 @@ Status FileManager::merge(FileId x_file_id, FileId y_file_id, bool no_sync) {
   }
 
   file_nodes_[node_ids[other_node_i]] = nullptr;
+  file_node_count_--;
 
   run_generate(node);
   run_download(node, false);
@@ -2016,7 +2082,116 @@ FileNode *FileManager::get_file_node_raw(FileId file_id, FileNodeId *file_node_i
   if (file_node_id != nullptr) {
     *file_node_id = node_id;
   }
-  return file_nodes_[node_id].get();
+  auto *node = file_nodes_[node_id].get();
+  if (node == nullptr) {
+    if (evicted_file_nodes_.empty()) {
+      return nullptr;
+    }
+    node = restore_evicted_file_node(node_id);
+    if (node == nullptr) {
+      return nullptr;
+    }
+  }
+  node->access_generation_ = file_node_access_generation_;
+  return node;
+}
+
+bool FileManager::is_file_node_evictable(const FileNode *node) {
+  // the node must be fully saved to the database and have no state, which isn't saved there
+  if (node->pmc_id_.empty() || node->need_load_from_pmc_ || node->pmc_changed_flag_ || node->info_changed_flag_) {
+    return false;
+  }
+  if (!node->remote_.full && node->local_.type() != LocalFileLocation::Type::Full) {
+    return false;
+  }
+  if ((node->remote_.full && !node->remote_.is_full_alive) || node->remote_.partial != nullptr ||
+      node->local_.type() == LocalFileLocation::Type::Partial) {
+    return false;
+  }
+  if (node->generate_ != nullptr && begins_with(node->generate_->conversion_, "#file_id#")) {
+    return false;
+  }
+  if (node->download_id_ != 0 || node->upload_id_ != 0 || node->generate_id_ != 0 || node->upload_pause_.is_valid() ||
+      node->download_priority_ != 0 || node->upload_priority_ != 0 || node->generate_priority_ != 0 ||
+      node->download_offset_ != 0 || node->private_download_limit_ != 0 || node->ignore_download_limit_) {
+    return false;
+  }
+  if (node->get_by_hash_ || !node->can_search_locally_ || node->need_reload_photo_ || node->upload_prefer_small_ ||
+      node->upload_was_update_file_reference_ || node->download_was_update_file_reference_) {
+    return false;
+  }
+  for (auto file_id : node->file_ids_) {
+    auto *file_info = get_file_id_info(file_id);
+    if (file_info->send_updates_flag_ || file_info->download_priority_ != 0 || file_info->upload_priority_ != 0 ||
+        file_info->download_callback_ != nullptr || file_info->upload_callback_ != nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void FileManager::evict_cold_file_nodes() {
+  if (!file_db_ || file_nodes_.size() < MIN_FILE_NODE_COUNT_FOR_EVICTION) {
+    return;
+  }
+
+  // nodes, which weren't accessed since the previous call, are cold
+  auto last_access_generation = file_node_access_generation_++;
+  size_t evicted_count = 0;
+  for (size_t node_id = 1; node_id < file_nodes_.size(); node_id++) {
+    auto &node = file_nodes_[node_id];
+    if (node == nullptr || node->access_generation_ == last_access_generation || !is_file_node_evictable(node.get())) {
+      continue;
+    }
+
+    auto evicted_node = make_unique<EvictedFileNode>();
+    evicted_node->pmc_id_ = node->pmc_id_;
+    evicted_node->main_file_id_ = node->main_file_id_;
+    evicted_node->main_file_id_priority_ = node->main_file_id_priority_;
+    evicted_node->remote_source_ = node->remote_.full_source;
+    evicted_node->file_ids_ = std::move(node->file_ids_);
+    evicted_file_nodes_[static_cast<FileNodeId>(node_id)] = std::move(evicted_node);
+    node = nullptr;
+    file_node_count_--;
+    evicted_count++;
+  }
+  LOG(INFO) << "Evicted " << evicted_count << " cold file nodes; have " << evicted_file_nodes_.size()
+            << " evicted file nodes out of " << file_nodes_.size();
+}
+
+FileNode *FileManager::restore_evicted_file_node(FileNodeId node_id) {
+  auto it = evicted_file_nodes_.find(node_id);
+  if (it == evicted_file_nodes_.end()) {
+    return nullptr;
+  }
+  auto evicted_node = std::move(it->second);
+  evicted_file_nodes_.erase(it);
+
+  auto r_data = file_db_->get_file_data_sync(evicted_node->pmc_id_);
+  if (r_data.is_error()) {
+    LOG(ERROR) << "Failed to restore evicted file " << evicted_node->main_file_id_ << ": " << r_data.error();
+    return nullptr;
+  }
+  auto data = r_data.move_as_ok();
+  if (data.local_.type() == LocalFileLocation::Type::Full) {
+    PathView path_view(data.local_.full().path_);
+    if (path_view.is_relative()) {
+      data.local_.full().path_ = PSTRING() << get_files_base_dir(data.local_.full().file_type_)
+                                           << data.local_.full().path_;
+    }
+  }
+  VLOG(update_file) << "Restore evicted file " << evicted_node->main_file_id_ << " from " << data;
+
+  auto &node = file_nodes_[node_id];
+  node = td::make_unique<FileNode>(
+      std::move(data.local_), NewRemoteFileLocation(data.remote_, evicted_node->remote_source_),
+      std::move(data.generate_), data.size_, data.expected_size_, std::move(data.remote_name_), std::move(data.url_),
+      data.owner_dialog_id_, std::move(data.encryption_key_), evicted_node->main_file_id_,
+      evicted_node->main_file_id_priority_);
+  file_node_count_++;
+  node->pmc_id_ = evicted_node->pmc_id_;
+  node->file_ids_ = std::move(evicted_node->file_ids_);
+  return node.get();
 }
 
 FileNodePtr FileManager::get_sync_file_node(FileId file_id) {
@@ -2077,6 +2252,60 @@ void FileManager::load_from_pmc(FileNodePtr node, bool new_remote, bool new_loca
   }
 }
 
+void FileManager::preload_from_database(const vector<FileId> &file_ids) {
+  if (!file_db_) {
+    return;
+  }
+
+  struct LoadQuery {
+    FileId file_id;
+    const char *source;
+  };
+  vector<LoadQuery> queries;
+  vector<string> keys;
+  for (auto file_id : file_ids) {
+    auto node = get_file_node(file_id);
+    if (!node || !node->need_load_from_pmc_) {
+      continue;
+    }
+    node->need_load_from_pmc_ = false;
+
+    auto main_file_id = node->main_file_id_;
+    auto file_view = FileView(node);
+    if (file_view.has_remote_location()) {
+      keys.push_back(FileDbInterface::as_key(file_view.remote_location()));
+      queries.push_back({main_file_id, "load remote from database"});
+    }
+    if (file_view.has_local_location()) {
+      auto local = file_view.local_location();
+      prepare_path_for_pmc(local.file_type_, local.path_);
+      keys.push_back(FileDbInterface::as_key(local));
+      queries.push_back({main_file_id, "load local from database"});
+    }
+    if (file_view.has_generate_location()) {
+      keys.push_back(FileDbInterface::as_key(file_view.generate_location()));
+      queries.push_back({main_file_id, "load generate from database"});
+    }
+  }
+  if (keys.empty()) {
+    return;
+  }
+
+  LOG(DEBUG) << "Preload " << keys.size() << " file locations from database";
+  auto results = file_db_->get_file_data_many_sync(std::move(keys));
+  CHECK(results.size() == queries.size());
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].is_error()) {
+      continue;
+    }
+    auto r_new_file_id =
+        register_file(results[i].move_as_ok(), FileLocationSource::FromDatabase, FileId(), queries[i].source, false);
+    if (r_new_file_id.is_ok()) {
+      merge(queries[i].file_id, r_new_file_id.ok()).ignore();  // merge manually to keep merge parameters order
+    }
+  }
+}
+
 bool FileManager::set_encryption_key(FileId file_id, FileEncryptionKey key) {
   auto node = get_sync_file_node(file_id);
   if (!node) {
@@ -2232,9 +2461,13 @@ void FileManager::delete_file(FileId file_id, Promise<Unit> promise, const char
     if (begins_with(file_view.local_location().path_, get_files_dir(file_view.get_type()))) {
       clear_from_pmc(node);
       if (context_->need_notify_on_new_files()) {
-        context_->on_new_file(-file_view.size(), -file_view.get_allocated_local_size(), -1);
+        context_->on_new_file(file_view.get_type(), file_view.owner_dialog_id(), -file_view.size(),
+                              -file_view.get_allocated_local_size(), -1);
       }
       path = std::move(node->local_.full().path_);
+      if (file_db_) {
+        file_db_->clear_file_gc_infos({path});
+      }
     }
   } else {
     if (file_view.get_type() == FileType::Encrypted) {
@@ -2302,6 +2535,7 @@ void FileManager::download_impl(FileId file_id, std::shared_ptr<DownloadCallback
   }
   if (node->local_.type() == LocalFileLocation::Type::Full) {
     LOG(INFO) << "File " << file_id << " is already downloaded";
+    on_file_access(node);
     if (callback) {
       callback->on_download_ok(file_id);
     }
@@ -2848,7 +3082,11 @@ void FileManager::run_generate(FileNodePtr node) {
   }
 
   if (old_priority != 0) {
-    LOG(INFO) << "TODO: change file " << file_id << " generation priority";
+    if (old_priority != node->generate_priority_) {
+      LOG(INFO) << "Change file " << file_id << " generation priority to " << node->generate_priority_;
+      send_closure(file_generate_manager_, &FileGenerateManager::set_priority, node->generate_id_,
+                   node->generate_priority_);
+    }
     return;
   }
 
@@ -2856,7 +3094,7 @@ void FileManager::run_generate(FileNodePtr node) {
   node->generate_id_ = query_id;
   send_closure(
       file_generate_manager_, &FileGenerateManager::generate_file, query_id, *node->generate_, node->local_,
-      node->suggested_path(), [file_manager = this, query_id] {
+      node->suggested_path(), node->generate_priority_, [file_manager = this, query_id] {
         class Callback final : public FileGenerateCallback {
           ActorId<FileManager> actor_;
           uint64 query_id_;
@@ -2969,16 +3207,6 @@ void FileManager::run_upload(FileNodePtr node, vector<int> bad_parts) {
     return;
   }
 
-  if (!node->remote_.partial && node->get_by_hash_) {
-    LOG(INFO) << "Get file " << node->main_file_id_ << " by hash";
-    QueryId query_id = queries_container_.create(Query{file_id, Query::Type::UploadByHash});
-    node->upload_id_ = query_id;
-
-    send_closure(file_load_manager_, &FileLoadManager::upload_by_hash, query_id, node->local_.full(), node->size_,
-                 narrow_cast<int8>(-priority));
-    return;
-  }
-
   auto new_priority = narrow_cast<int8>(bad_parts.empty() ? -priority : priority);
   td::remove_if(bad_parts, [](auto part_id) { return part_id < 0; });
 
@@ -2991,6 +3219,10 @@ void FileManager::run_upload(FileNodePtr node, vector<int> bad_parts) {
   node->upload_id_ = query_id;
   send_closure(file_load_manager_, &FileLoadManager::upload, query_id, node->local_, node->remote_.partial_or_empty(),
                expected_size, node->encryption_key_, new_priority, std::move(bad_parts));
+  if (!node->remote_.partial && node->get_by_hash_ && node->local_.type() == LocalFileLocation::Type::Full) {
+    LOG(INFO) << "Get file " << node->main_file_id_ << " by hash";
+    send_closure(file_load_manager_, &FileLoadManager::lookup_by_hash, query_id, node->local_.full(), node->size_);
+  }
 
   LOG(INFO) << "File " << file_id << " upload request has sent to FileLoadManager";
 }
@@ -3679,9 +3911,12 @@ void FileManager::on_download_ok(QueryId query_id, FullLocalFileLocation local,
   if (r_new_file_id.is_error()) {
     status = Status::Error(PSLICE() << "Can't register local file after download: " << r_new_file_id.error().message());
   } else {
+    auto file_view = get_file_view(r_new_file_id.ok());
     if (is_new && context_->need_notify_on_new_files()) {
-      context_->on_new_file(size, get_file_view(r_new_file_id.ok()).get_allocated_local_size(), 1);
+      context_->on_new_file(file_view.get_type(), file_view.owner_dialog_id(), size,
+                            file_view.get_allocated_local_size(), 1);
     }
+    add_to_file_gc_index(file_view);
   }
   if (status.is_error()) {
     LOG(ERROR) << status.message();
@@ -3775,6 +4010,11 @@ void FileManager::on_upload_full_ok(QueryId query_id, FullRemoteFileLocation rem
 
   auto file_id = finish_query(query_id).first.file_id_;
   LOG(INFO) << "ON UPLOAD FULL OK for file " << file_id;
+  auto file_node = get_file_node(file_id);
+  if (file_node) {
+    // the file was found by hash while it was being uploaded
+    file_node->delete_partial_remote_location();
+  }
   auto new_file_id = register_remote(std::move(remote), FileLocationSource::FromServer, DialogId(), 0, 0, "");
   LOG_STATUS(merge(new_file_id, file_id));
 }
@@ -3845,9 +4085,11 @@ void FileManager::on_generate_ok(QueryId query_id, FullLocalFileLocation local)
   FileView file_view(file_node);
   if (context_->need_notify_on_new_files()) {
     if (!file_view.has_generate_location() || !begins_with(file_view.generate_location().conversion_, "#file_id#")) {
-      context_->on_new_file(file_view.size(), file_view.get_allocated_local_size(), 1);
+      context_->on_new_file(file_view.get_type(), file_view.owner_dialog_id(), file_view.size(),
+                            file_view.get_allocated_local_size(), 1);
     }
   }
+  add_to_file_gc_index(file_view);
 
   run_upload(file_node, {});
 
@@ -3873,12 +4115,6 @@ void FileManager::on_error(QueryId query_id, Status status) {
     return;
   }
 
-  if (query.type_ == Query::Type::UploadByHash && !G()->close_flag()) {
-    LOG(INFO) << "Upload By Hash failed: " << status << ", restart upload";
-    node->get_by_hash_ = false;
-    run_upload(node, {});
-    return;
-  }
   on_error_impl(node, query.type_, was_active, std::move(status));
 }
 
@@ -4093,6 +4329,21 @@ void FileManager::hangup() {
   stop();
 }
 
+void FileManager::timeout_expired() {
+  if (is_closed_) {
+    return;
+  }
+  evict_cold_file_nodes();
+  set_timeout_in(FILE_NODE_EVICTION_PERIOD);
+}
+
+void FileManager::get_memory_statistics(MemoryStatisticsEntries &entries) const {
+  add_memory_statistics_entry<FileIdInfo>(entries, "FileManager", "file_ids", file_id_info_.size());
+  add_memory_statistics_entry<FileNode>(entries, "FileManager", "file_nodes", file_node_count_);
+  add_memory_statistics_entry<EvictedFileNode>(entries, "FileManager", "evicted_file_nodes",
+                                               evicted_file_nodes_.size());
+}
+
 void FileManager::tear_down() {
   parent_.reset();
 
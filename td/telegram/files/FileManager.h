@@ -17,6 +17,7 @@
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/files/FileType.h"
 #include "td/telegram/Location.h"
+#include "td/telegram/MemoryStatistics.h"
 #include "td/telegram/PhotoSizeSource.h"
 #include "td/telegram/td_api.h"
 #include "td/telegram/telegram_api.h"
@@ -27,6 +28,7 @@
 #include "td/utils/common.h"
 #include "td/utils/Container.h"
 #include "td/utils/Enumerator.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/FlatHashSet.h"
 #include "td/utils/logging.h"
 #include "td/utils/optional.h"
@@ -169,6 +171,8 @@ class FileNode {
 
   int8 main_file_id_priority_ = 0;
 
+  uint32 access_generation_ = 0;  // value of FileManager::file_node_access_generation_ during the last access
+
   bool is_download_offset_dirty_ = false;
   bool is_download_limit_dirty_ = false;
 
@@ -386,7 +390,8 @@ class FileManager final : public FileLoadManager::Callback {
    public:
     virtual bool need_notify_on_new_files() = 0;
 
-    virtual void on_new_file(int64 size, int64 real_size, int32 cnt) = 0;
+    virtual void on_new_file(FileType file_type, DialogId owner_dialog_id, int64 size, int64 real_size,
+                             int32 cnt) = 0;
 
     virtual void on_file_updated(FileId size) = 0;
 
@@ -425,6 +430,9 @@ class FileManager final : public FileLoadManager::Callback {
 
   void on_file_unlink(const FullLocalFileLocation &location);
 
+  // unlinks files chosen by files GC; the promise is set after all the files are unlinked
+  void unlink_gc_files(vector<FullLocalFileLocation> locations, Promise<Unit> promise);
+
   FileId register_empty(FileType type);
   Result<FileId> register_local(FullLocalFileLocation location, DialogId owner_dialog_id, int64 size,
                                 bool get_by_hash = false, bool force = false, bool skip_file_size_checks = false,
@@ -438,6 +446,9 @@ class FileManager final : public FileLoadManager::Callback {
 
   Status merge(FileId x_file_id, FileId y_file_id, bool no_sync = false);
 
+  // synchronously loads from the database all files, which would be loaded on the first access, using batched queries
+  void preload_from_database(const vector<FileId> &file_ids);
+
   void add_file_source(FileId file_id, FileSourceId file_source_id);
 
   void remove_file_source(FileId file_id, FileSourceId file_source_id);
@@ -466,6 +477,8 @@ class FileManager final : public FileLoadManager::Callback {
 
   Result<string> get_suggested_file_name(FileId file_id, const string &directory);
 
+  void get_memory_statistics(MemoryStatisticsEntries &entries) const;
+
   void read_file_part(FileId file_id, int64 offset, int64 count, int left_tries,
                       Promise<td_api::object_ptr<td_api::filePart>> promise);
 
@@ -534,7 +547,6 @@ class FileManager final : public FileLoadManager::Callback {
    public:
     FileId file_id_;
     enum class Type : int32 {
-      UploadByHash,
       UploadWaitFileReference,
       Upload,
       DownloadWaitFileReference,
@@ -568,6 +580,7 @@ class FileManager final : public FileLoadManager::Callback {
   ActorShared<> parent_;
   unique_ptr<Context> context_;
   std::shared_ptr<FileDbInterface> file_db_;
+  FlatHashSet<string> accessed_file_paths_;
 
   FileIdInfo *get_file_id_info(FileId file_id);
 
@@ -594,6 +607,22 @@ class FileManager final : public FileLoadManager::Callback {
   WaitFreeVector<FileIdInfo> file_id_info_;
   WaitFreeVector<int32> empty_file_ids_;
   WaitFreeVector<unique_ptr<FileNode>> file_nodes_;
+  size_t file_node_count_ = 0;  // number of non-empty elements of file_nodes_
+
+  // everything needed to restore a cold file node, which was evicted from memory, from the file database
+  struct EvictedFileNode {
+    FileDbId pmc_id_;
+    FileId main_file_id_;
+    int8 main_file_id_priority_ = 0;
+    FileLocationSource remote_source_ = FileLocationSource::None;
+    vector<FileId> file_ids_;
+  };
+  FlatHashMap<FileNodeId, unique_ptr<EvictedFileNode>> evicted_file_nodes_;
+  uint32 file_node_access_generation_ = 1;
+
+  static constexpr size_t MIN_FILE_NODE_COUNT_FOR_EVICTION = 100000;
+  static constexpr double FILE_NODE_EVICTION_PERIOD = 600.0;
+
   ActorOwn<FileLoadManager> file_load_manager_;
   ActorOwn<FileGenerateManager> file_generate_manager_;
 
@@ -638,6 +667,9 @@ class FileManager final : public FileLoadManager::Callback {
   void try_flush_node_info(FileNodePtr node, const char *source);
   void try_flush_node_pmc(FileNodePtr node, const char *source);
   void clear_from_pmc(FileNodePtr node);
+
+  void add_to_file_gc_index(const FileView &file_view);
+  void on_file_access(FileNodePtr node);
   void flush_to_pmc(FileNodePtr node, bool new_remote, bool new_local, bool new_generate, const char *source);
   void load_from_pmc(FileNodePtr node, bool new_remote, bool new_local, bool new_generate);
 
@@ -657,6 +689,10 @@ class FileManager final : public FileLoadManager::Callback {
   }
   FileNode *get_file_node_raw(FileId file_id, FileNodeId *file_node_id = nullptr);
 
+  bool is_file_node_evictable(const FileNode *node);
+  void evict_cold_file_nodes();
+  FileNode *restore_evicted_file_node(FileNodeId node_id);
+
   FileNodePtr get_sync_file_node(FileId file_id);
 
   void on_force_reupload_success(FileId file_id);
@@ -689,6 +725,7 @@ class FileManager final : public FileLoadManager::Callback {
 
   FlatHashSet<FileId, FileIdHash> get_main_file_ids(const vector<FileId> &file_ids);
 
+  void timeout_expired() final;
   void hangup() final;
   void tear_down() final;
 
@@ -12,6 +12,7 @@
 #include "td/utils/common.h"
 #include "td/utils/FlatHashSet.h"
 #include "td/utils/format.h"
+#include "td/utils/logging.h"
 #include "td/utils/misc.h"
 
 #include <algorithm>
@@ -53,6 +54,19 @@ void FileStats::add(FullFileInfo &&info) {
   }
 }
 
+void FileStats::add_stat(FileType file_type, DialogId owner_dialog_id, int64 size, int32 cnt) {
+  auto pos = static_cast<size_t>(file_type);
+  CHECK(pos < stat_by_type_.size());
+  auto &stat = split_by_owner_dialog_id_ ? stat_by_owner_dialog_id_[owner_dialog_id][pos] : stat_by_type_[pos];
+  stat.size += size;
+  stat.cnt += cnt;
+  if (stat.size < 0 || stat.cnt < 0) {
+    LOG(ERROR) << "Receive wrong storage statistics after adding size " << size << " and count " << cnt << " of "
+               << file_type << " files";
+    stat = FileTypeStat();
+  }
+}
+
 FileTypeStat FileStats::get_nontemp_stat(const FileStats::StatByType &by_type) {
   FileTypeStat stat;
   for (int32 i = 0; i < MAX_FILE_TYPE; i++) {
@@ -10,6 +10,7 @@
 #include "td/telegram/files/FileType.h"
 
 #include "td/utils/common.h"
+#include "td/utils/misc.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tl_helpers.h"
 
@@ -87,7 +88,29 @@ class FileStats {
 
   friend StringBuilder &operator<<(StringBuilder &sb, const FileStats &file_stats);
 
+  template <class StorerT>
+  static void store_stat_by_type(const StatByType &by_type, StorerT &storer) {
+    td::store(static_cast<int32>(by_type.size()), storer);
+    for (auto &stat : by_type) {
+      td::store(stat, storer);
+    }
+  }
+
+  template <class ParserT>
+  static void parse_stat_by_type(StatByType &by_type, ParserT &parser) {
+    int32 size;
+    td::parse(size, parser);
+    if (size != static_cast<int32>(by_type.size())) {
+      return parser.set_error("Invalid number of file types");
+    }
+    for (auto &stat : by_type) {
+      td::parse(stat, parser);
+    }
+  }
+
  public:
+  FileStats() = default;
+
   FileStats(bool need_all_files, bool split_by_owner_dialog_id)
       : need_all_files_(need_all_files), split_by_owner_dialog_id_(split_by_owner_dialog_id) {
   }
@@ -96,6 +119,9 @@ class FileStats {
 
   void add(FullFileInfo &&info);
 
+  // adds size and count of files of the given type, which can be negative for deleted files
+  void add_stat(FileType file_type, DialogId owner_dialog_id, int64 size, int32 cnt);
+
   void apply_dialog_limit(int32 limit);
 
   void apply_dialog_ids(const vector<DialogId> &dialog_ids);
@@ -107,6 +133,42 @@ class FileStats {
   FileTypeStat get_total_nontemp_stat() const;
 
   vector<FullFileInfo> get_all_files();
+
+  bool is_split_by_owner_dialog_id() const {
+    return split_by_owner_dialog_id_;
+  }
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    CHECK(!need_all_files_);
+    td::store(split_by_owner_dialog_id_, storer);
+    if (split_by_owner_dialog_id_) {
+      td::store(narrow_cast<int32>(stat_by_owner_dialog_id_.size()), storer);
+      for (auto &it : stat_by_owner_dialog_id_) {
+        td::store(it.first, storer);
+        store_stat_by_type(it.second, storer);
+      }
+    } else {
+      store_stat_by_type(stat_by_type_, storer);
+    }
+  }
+
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    need_all_files_ = false;
+    td::parse(split_by_owner_dialog_id_, parser);
+    if (split_by_owner_dialog_id_) {
+      int32 size;
+      td::parse(size, parser);
+      for (int32 i = 0; i < size && parser.get_error() == nullptr; i++) {
+        DialogId dialog_id;
+        td::parse(dialog_id, parser);
+        parse_stat_by_type(stat_by_owner_dialog_id_[dialog_id], parser);
+      }
+    } else {
+      parse_stat_by_type(stat_by_type_, parser);
+    }
+  }
 };
 
 StringBuilder &operator<<(StringBuilder &sb, const FileStats &file_stats);
@@ -24,13 +24,16 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/PathView.h"
+#include "td/utils/port/config.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
 #include "td/utils/tl_parsers.h"
 
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -100,48 +103,98 @@ struct FsFileInfo {
   uint64 mtime_nsec;
 };
 
+struct FsDirInfo {
+  FileType file_type;
+  string path;
+  vector<FsFileInfo> files;
+};
+
+void scan_dir(const CancellationToken &token, FsDirInfo &dir) {
+  LOG(INFO) << "Trying to scan directory " << dir.path;
+  walk_path(dir.path, [&](CSlice path, WalkPath::Type type) {
+    if (token) {
+      return WalkPath::Action::Abort;
+    }
+    if (type != WalkPath::Type::RegularFile) {
+      return WalkPath::Action::Continue;
+    }
+    auto r_stat = stat(path);
+    if (r_stat.is_error()) {
+      LOG(WARNING) << "Stat in files gc failed: " << r_stat.error();
+      return WalkPath::Action::Continue;
+    }
+    auto stat = r_stat.move_as_ok();
+    if (stat.size_ == 0 && ends_with(path, "/.nomedia")) {
+      // skip .nomedia file
+      return WalkPath::Action::Continue;
+    }
+
+    FsFileInfo info;
+    info.path = path.str();
+    info.size = stat.real_size_;
+    info.file_type = dir.file_type;
+    info.atime_nsec = stat.atime_nsec_;
+    info.mtime_nsec = stat.mtime_nsec_;
+    dir.files.push_back(std::move(info));
+    return WalkPath::Action::Continue;
+  }).ignore();
+}
+
 template <class CallbackT>
 void scan_fs(CancellationToken &token, CallbackT &&callback) {
   std::unordered_set<string, Hash<string>> scanned_file_dirs;
-  auto scan_dir = [&](FileType file_type, const string &file_dir) {
-    LOG(INFO) << "Trying to scan directory " << file_dir;
+  vector<FsDirInfo> dirs;
+  auto add_dir = [&](FileType file_type, const string &file_dir) {
     if (!scanned_file_dirs.insert(file_dir).second) {
       return;
     }
-    walk_path(file_dir, [&](CSlice path, WalkPath::Type type) {
-      if (token) {
-        return WalkPath::Action::Abort;
-      }
-      if (type != WalkPath::Type::RegularFile) {
-        return WalkPath::Action::Continue;
-      }
-      auto r_stat = stat(path);
-      if (r_stat.is_error()) {
-        LOG(WARNING) << "Stat in files gc failed: " << r_stat.error();
-        return WalkPath::Action::Continue;
-      }
-      auto stat = r_stat.move_as_ok();
-      if (stat.size_ == 0 && ends_with(path, "/.nomedia")) {
-        // skip .nomedia file
-        return WalkPath::Action::Continue;
-      }
-
-      FsFileInfo info;
-      info.path = path.str();
-      info.size = stat.real_size_;
-      info.file_type = file_type;
-      info.atime_nsec = stat.atime_nsec_;
-      info.mtime_nsec = stat.mtime_nsec_;
-      callback(info);
-      return WalkPath::Action::Continue;
-    }).ignore();
+    FsDirInfo dir;
+    dir.file_type = file_type;
+    dir.path = file_dir;
+    dirs.push_back(std::move(dir));
   };
   for (int32 i = 0; i < MAX_FILE_TYPE; i++) {
     auto file_type = static_cast<FileType>(i);
-    scan_dir(get_main_file_type(file_type), get_files_dir(file_type));
+    add_dir(get_main_file_type(file_type), get_files_dir(file_type));
+  }
+  add_dir(get_main_file_type(FileType::Temp), get_files_temp_dir(FileType::SecureDecrypted));
+  add_dir(get_main_file_type(FileType::Temp), get_files_temp_dir(FileType::Video));
+
+  // the directories are independent, so they are scanned in parallel; the callback is called from the current thread
+#if TD_THREAD_UNSUPPORTED
+  for (auto &dir : dirs) {
+    scan_dir(token, dir);
+  }
+#else
+  std::atomic<size_t> next_dir_pos{0};
+  auto run_scan = [&] {
+    while (true) {
+      auto pos = next_dir_pos.fetch_add(1, std::memory_order_relaxed);
+      if (pos >= dirs.size()) {
+        break;
+      }
+      scan_dir(token, dirs[pos]);
+    }
+  };
+  auto thread_count = td::min(static_cast<size_t>(clamp(thread::hardware_concurrency(), 1u, 4u)), dirs.size());
+  vector<thread> threads;
+  for (size_t i = 1; i < thread_count; i++) {
+    threads.emplace_back(run_scan);
+  }
+  run_scan();
+  for (auto &scan_thread : threads) {
+    scan_thread.join();
+  }
+#endif
+
+  for (auto &dir : dirs) {
+    for (auto &info : dir.files) {
+      if (token) {
+        return;
+      }
+      callback(info);
+    }
   }
-  scan_dir(get_main_file_type(FileType::Temp), get_files_temp_dir(FileType::SecureDecrypted));
-  scan_dir(get_main_file_type(FileType::Temp), get_files_temp_dir(FileType::Video));
 }
 }  // namespace
 
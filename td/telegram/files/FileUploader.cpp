@@ -6,6 +6,7 @@
 //
 #include "td/telegram/files/FileUploader.h"
 
+#include "td/telegram/files/FileBitmask.h"
 #include "td/telegram/files/FileLoaderUtils.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/DcId.h"
@@ -55,19 +56,30 @@ Result<FileLoader::FileInfo> FileUploader::init() {
   (void)prefix_info;
 
   int offset = 0;
+  int ready_prefix_count = 0;
   int part_size = 0;
+  Bitmask ready_bitmask;
   if (remote_.type() == RemoteFileLocation::Type::Partial) {
     const auto &partial = remote_.partial();
     file_id_ = partial.file_id_;
     part_size = partial.part_size_;
     big_flag_ = partial.is_big_ != 0;
     offset = partial.ready_part_count_;
+    ready_prefix_count = offset;
+    if (!partial.ready_bitmask_.empty()) {
+      // parts are uploaded in parallel, so there can be many ready parts after the ready prefix
+      ready_bitmask = Bitmask(Bitmask::Decode{}, partial.ready_bitmask_);
+      offset = max(offset, narrow_cast<int>(min(ready_bitmask.size(), static_cast<int64>(partial.part_count_))));
+    }
   } else {
     file_id_ = Random::secure_int64();
     big_flag_ = is_file_big(file_type_, expected_size_);
   }
 
   std::vector<bool> ok(offset, true);
+  for (int i = ready_prefix_count; i < offset; i++) {
+    ok[i] = ready_bitmask.get(i);
+  }
   for (auto bad_id : bad_parts_) {
     if (bad_id >= 0 && bad_id < offset) {
       ok[bad_id] = false;
@@ -311,14 +323,16 @@ Result<size_t> FileUploader::process_part(Part part, NetQueryPtr net_query) {
 }
 
 void FileUploader::on_progress(Progress progress) {
-  callback_->on_partial_upload(PartialRemoteFileLocation{file_id_, progress.part_count, progress.part_size,
-                                                         progress.ready_part_count, big_flag_},
-                               progress.ready_size);
+  // the bitmask is needed only if some parts after the ready prefix are uploaded
+  string ready_bitmask;
+  if (progress.ready_part_count != progress.part_count && progress.ready_size != 0) {
+    ready_bitmask = std::move(progress.ready_bitmask);
+  }
+  PartialRemoteFileLocation partial_remote{file_id_, progress.part_count, progress.part_size, progress.ready_part_count,
+                                           big_flag_, std::move(ready_bitmask)};
+  callback_->on_partial_upload(partial_remote, progress.ready_size);
   if (progress.is_ready) {
-    callback_->on_ok(file_type_,
-                     PartialRemoteFileLocation{file_id_, progress.part_count, progress.part_size,
-                                               progress.ready_part_count, big_flag_},
-                     local_size_);
+    callback_->on_ok(file_type_, std::move(partial_remote), local_size_);
   }
 }
 
@@ -12,6 +12,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
 
 #include <limits>
 #include <numeric>
@@ -54,6 +55,7 @@ int32 PartsManager::set_streaming_offset(int64 offset, int64 limit) {
     return finish();
   }
 
+  update_streaming_rate(offset);
   streaming_offset_ = offset;
   first_streaming_empty_part_ = narrow_cast<int>(part_id);
   first_streaming_not_ready_part_ = narrow_cast<int>(part_id);
@@ -69,8 +71,56 @@ int32 PartsManager::get_pending_count() const {
   return pending_count_;
 }
 
+void PartsManager::update_streaming_rate(int64 offset) {
+  auto now = Time::now();
+  int64 max_sequential_step = MAX_STREAMING_READ_AHEAD_SIZE;
+  if (streaming_limit_ > max_sequential_step) {
+    max_sequential_step = streaming_limit_;
+  }
+  if (last_streaming_offset_ < 0 || offset < last_streaming_offset_ ||
+      offset - last_streaming_offset_ > max_sequential_step) {
+    // the first request or a seek; parts for the previous position aren't needed anymore
+    VLOG(file_loader) << "Reset streaming rate after switching streaming offset from " << last_streaming_offset_
+                      << " to " << offset;
+    streaming_rate_ = 0;
+    last_streaming_offset_ = offset;
+    last_streaming_offset_time_ = now;
+    return;
+  }
+
+  auto passed_time = now - last_streaming_offset_time_;
+  if (passed_time < 0.1) {
+    // too close requests; the offset change will be accounted in the next sample
+    return;
+  }
+  auto rate = static_cast<double>(offset - last_streaming_offset_) / passed_time;
+  streaming_rate_ = streaming_rate_ == 0 ? rate : streaming_rate_ * 0.7 + rate * 0.3;
+  last_streaming_offset_ = offset;
+  last_streaming_offset_time_ = now;
+  VLOG(file_loader) << "Update streaming rate to " << static_cast<int64>(streaming_rate_) << " bytes per second";
+}
+
+int64 PartsManager::get_streaming_read_ahead_size() const {
+  if (streaming_rate_ <= 0) {
+    return 0;
+  }
+  auto size = static_cast<int64>(streaming_rate_ * STREAMING_READ_AHEAD_TIME);
+  if (size > MAX_STREAMING_READ_AHEAD_SIZE) {
+    size = MAX_STREAMING_READ_AHEAD_SIZE;
+  }
+  if (!unknown_size_flag_) {
+    // don't wrap the read-ahead window around the end of the file
+    size = min(size, max(get_size() - streaming_offset_, static_cast<int64>(0)));
+  }
+  return size;
+}
+
 void PartsManager::set_streaming_limit(int64 limit) {
   streaming_limit_ = limit;
+  if (limit != 0) {
+    // keep downloaded enough data for the predicted playback, not only the requested part
+    streaming_limit_ = max(limit, get_streaming_read_ahead_size());
+  }
   streaming_ready_size_ = 0;
   if (streaming_limit_ == 0) {
     return;
@@ -222,6 +272,10 @@ int64 PartsManager::get_streaming_offset() const {
   return streaming_offset_;
 }
 
+int64 PartsManager::get_streaming_limit() const {
+  return streaming_limit_;
+}
+
 string PartsManager::get_bitmask() {
   int32 prefix_count = -1;
   if (need_check_) {
@@ -577,6 +631,7 @@ StringBuilder &operator<<(StringBuilder &string_builder, const PartsManager &par
                         << ", first_not_ready_part = " << parts_manager.first_not_ready_part_
                         << ", streaming_offset = " << parts_manager.streaming_offset_
                         << ", streaming_limit = " << parts_manager.streaming_limit_
+                        << ", streaming_rate = " << parts_manager.streaming_rate_
                         << ", first_streaming_empty_part = " << parts_manager.first_streaming_empty_part_
                         << ", first_streaming_not_ready_part = " << parts_manager.first_streaming_not_ready_part_
                         << ", use_part_count_limit = " << parts_manager.use_part_count_limit_
@@ -51,6 +51,7 @@ class PartsManager {
   int32 get_unchecked_ready_prefix_count();
   int32 get_ready_prefix_count();
   int64 get_streaming_offset() const;
+  int64 get_streaming_limit() const;
   string get_bitmask();
   int32 get_pending_count() const;
 
@@ -59,6 +60,8 @@ class PartsManager {
   static constexpr int MAX_PART_COUNT_PREMIUM = 8000;
   static constexpr size_t MAX_PART_SIZE = 512 << 10;
   static constexpr int64 MAX_FILE_SIZE = static_cast<int64>(MAX_PART_SIZE) * MAX_PART_COUNT_PREMIUM;
+  static constexpr double STREAMING_READ_AHEAD_TIME = 10.0;
+  static constexpr int64 MAX_STREAMING_READ_AHEAD_SIZE = static_cast<int64>(MAX_PART_SIZE) * 32;
 
   enum class PartStatus : int32 { Empty, Pending, Ready };
 
@@ -84,6 +87,9 @@ class PartsManager {
   int first_not_ready_part_{0};
   int64 streaming_offset_{0};
   int64 streaming_limit_{0};
+  int64 last_streaming_offset_{-1};
+  double last_streaming_offset_time_{0};
+  double streaming_rate_{0};  // estimated playback rate in bytes per second
   int first_streaming_empty_part_{0};
   int first_streaming_not_ready_part_{0};
   vector<PartStatus> part_status_;
@@ -102,6 +108,9 @@ class PartsManager {
   void update_first_empty_part();
   void update_first_not_ready_part();
 
+  void update_streaming_rate(int64 offset);
+  int64 get_streaming_read_ahead_size() const;
+
   bool is_streaming_limit_reached();
   bool is_part_in_streaming_limit(int part_id) const;
 
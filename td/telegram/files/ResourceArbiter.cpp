@@ -0,0 +1,173 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/ResourceArbiter.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <utility>
+
+namespace td {
+
+ResourceArbiter &ResourceArbiter::get(Type type) {
+  static ResourceArbiter download_arbiter(static_cast<int64>(64) << 20);
+  static ResourceArbiter upload_arbiter(static_cast<int64>(32) << 20);
+  switch (type) {
+    case Type::Download:
+      return download_arbiter;
+    case Type::Upload:
+      return upload_arbiter;
+    default:
+      UNREACHABLE();
+      return download_arbiter;
+  }
+}
+
+std::atomic<int64> ResourceArbiter::buffer_memory_limit_{0};
+
+uint64 ResourceArbiter::create_tenant_id() {
+  static std::atomic<uint64> max_tenant_id{0};
+  return ++max_tenant_id;
+}
+
+void ResourceArbiter::set_buffer_memory_limit(int64 buffer_memory_limit) {
+  buffer_memory_limit_ = max(buffer_memory_limit, static_cast<int64>(0));
+}
+
+uint64 ResourceArbiter::add_flow(uint64 tenant_id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto flow_id = ++max_flow_id_;
+  flows_[flow_id].tenant_id = tenant_id;
+  return flow_id;
+}
+
+void ResourceArbiter::remove_flow(uint64 flow_id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  flows_.erase(flow_id);
+}
+
+int64 ResourceArbiter::update_flow(uint64 flow_id, int32 weight, int64 demand) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = flows_.find(flow_id);
+  CHECK(it != flows_.end());
+  it->second.weight = max(weight, 1);
+  it->second.demand = max(demand, static_cast<int64>(0));
+  it->second.fair_share = get_fair_share(flow_id);
+  return it->second.fair_share;
+}
+
+void ResourceArbiter::set_total_limit(int64 total_limit) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  total_limit_ = total_limit;
+}
+
+int64 ResourceArbiter::get_total_limit() const {
+  auto buffer_memory_limit = buffer_memory_limit_.load(std::memory_order_relaxed);
+  if (buffer_memory_limit == 0) {
+    return total_limit_;
+  }
+
+  // bytes in flight are already included in the used buffer memory, so only the rest of it is subtracted
+  int64 in_flight = 0;
+  for (auto &it : flows_) {
+    in_flight += it.second.fair_share;
+  }
+  auto other_memory = max(static_cast<int64>(BufferAllocator::get_buffer_mem()) - in_flight, static_cast<int64>(0));
+  return clamp(buffer_memory_limit - other_memory, static_cast<int64>(0), total_limit_);
+}
+
+int64 ResourceArbiter::get_fair_share(uint64 flow_id) const {
+  auto tenant_id = flows_.at(flow_id).tenant_id;
+
+  // the limit is split between clients first, so a client can't get a bigger share by using more DCs
+  std::map<uint64, Demand> tenant_demands;
+  vector<Demand> flow_demands;
+  for (auto &it : flows_) {
+    auto &flow = it.second;
+    if (flow.demand <= 0) {
+      continue;
+    }
+    auto &tenant_demand = tenant_demands[flow.tenant_id];
+    tenant_demand.id = flow.tenant_id;
+    tenant_demand.weight = max(tenant_demand.weight, flow.weight);
+    tenant_demand.demand += flow.demand;
+    if (flow.tenant_id == tenant_id) {
+      flow_demands.push_back({it.first, flow.weight, flow.demand});
+    }
+  }
+
+  vector<Demand> demands;
+  for (auto &it : tenant_demands) {
+    demands.push_back(it.second);
+  }
+  auto tenant_share = get_fair_share(std::move(demands), get_total_limit(), tenant_id);
+  return get_fair_share(std::move(flow_demands), tenant_share, flow_id);
+}
+
+int64 ResourceArbiter::get_fair_share(vector<Demand> demands, int64 limit, uint64 id) {
+  // water-filling: demands, which are less than their weighted share, are satisfied,
+  // and everything left is split between other demands proportionally to their weights
+  auto remaining_limit = limit;
+  while (!demands.empty()) {
+    int64 total_weight = 0;
+    for (auto &demand : demands) {
+      total_weight += demand.weight;
+    }
+    auto get_share = [&](const Demand &demand) {
+      return static_cast<int64>(static_cast<double>(remaining_limit) * demand.weight / total_weight);
+    };
+
+    int64 satisfied_demand = 0;
+    vector<Demand> left_demands;
+    for (auto &demand : demands) {
+      if (demand.demand <= get_share(demand)) {
+        if (demand.id == id) {
+          return demand.demand;
+        }
+        satisfied_demand += demand.demand;
+      } else {
+        left_demands.push_back(demand);
+      }
+    }
+    if (left_demands.size() == demands.size()) {
+      for (auto &demand : demands) {
+        if (demand.id == id) {
+          return get_share(demand);
+        }
+      }
+      break;
+    }
+    remaining_limit -= satisfied_demand;
+    demands = std::move(left_demands);
+  }
+  return 0;
+}
+
+int32 ResourceArbiter::get_file_type_weight(FileType file_type) {
+  switch (file_type) {
+    case FileType::Thumbnail:
+    case FileType::EncryptedThumbnail:
+    case FileType::ProfilePhoto:
+    case FileType::Photo:
+    case FileType::Sticker:
+    case FileType::VoiceNote:
+    case FileType::VideoNote:
+      return 4;
+    case FileType::Video:
+    case FileType::Animation:
+    case FileType::Audio:
+    case FileType::Wallpaper:
+    case FileType::Background:
+    case FileType::Ringtone:
+      return 2;
+    default:
+      return 1;
+  }
+}
+
+}  // namespace td
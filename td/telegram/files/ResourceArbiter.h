@@ -0,0 +1,77 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/files/FileType.h"
+
+#include "td/utils/common.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace td {
+
+// process-wide weighted max-min fair sharing of bytes in flight between clients and then between ResourceManagers
+// of each client
+class ResourceArbiter {
+ public:
+  enum class Type : int32 { Download, Upload };
+
+  explicit ResourceArbiter(int64 total_limit) : total_limit_(total_limit) {
+  }
+
+  static ResourceArbiter &get(Type type);
+
+  // returns a new identifier of a client, which flows are accounted together
+  static uint64 create_tenant_id();
+
+  // limits bytes in flight of all arbiters, so that total memory used by buffers doesn't exceed the limit;
+  // 0 means no limit
+  static void set_buffer_memory_limit(int64 buffer_memory_limit);
+
+  uint64 add_flow(uint64 tenant_id);
+
+  void remove_flow(uint64 flow_id);
+
+  // sets weight of the flow and number of bytes it wants to have in flight
+  // returns number of bytes the flow is allowed to have in flight
+  int64 update_flow(uint64 flow_id, int32 weight, int64 demand);
+
+  void set_total_limit(int64 total_limit);
+
+  static int32 get_file_type_weight(FileType file_type);
+
+ private:
+  struct Flow {
+    uint64 tenant_id = 0;
+    int32 weight = 1;
+    int64 demand = 0;
+    int64 fair_share = 0;
+  };
+
+  struct Demand {
+    uint64 id = 0;
+    int32 weight = 1;
+    int64 demand = 0;
+  };
+
+  static std::atomic<int64> buffer_memory_limit_;
+
+  std::mutex mutex_;
+  int64 total_limit_ = 0;
+  uint64 max_flow_id_ = 0;
+  std::map<uint64, Flow> flows_;
+
+  int64 get_total_limit() const;
+
+  int64 get_fair_share(uint64 flow_id) const;
+
+  static int64 get_fair_share(vector<Demand> demands, int64 limit, uint64 id);
+};
+
+}  // namespace td
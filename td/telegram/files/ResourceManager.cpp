@@ -13,22 +13,33 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
 
 namespace td {
 
-void ResourceManager::register_worker(ActorShared<FileLoaderActor> callback, int8 priority) {
+void ResourceManager::start_up() {
+  arbiter_flow_id_ = ResourceArbiter::get(arbiter_type_).add_flow(arbiter_tenant_id_);
+}
+
+void ResourceManager::tear_down() {
+  ResourceArbiter::get(arbiter_type_).remove_flow(arbiter_flow_id_);
+}
+
+void ResourceManager::register_worker(ActorShared<FileLoaderActor> callback, int8 priority, int32 weight) {
   auto node_id = nodes_container_.create();
   auto *node_ptr = nodes_container_.get(node_id);
   *node_ptr = make_unique<Node>();
   auto *node = (*node_ptr).get();
   CHECK(node);
   node->node_id = node_id;
+  node->weight = weight;
   node->callback_ = std::move(callback);
 
   add_node(node_id, priority);
   send_closure(node->callback_, &FileLoaderActor::set_resource_manager, actor_shared(this, node_id));
+  update_max_resource_limit();
 }
 
 void ResourceManager::update_priority(int8 priority) {
@@ -65,6 +76,60 @@ void ResourceManager::update_resources(const ResourceState &resource_state) {
   loop();
 }
 
+void ResourceManager::on_part_loaded(int64 size, double rtt) {
+  if (stop_flag_) {
+    return;
+  }
+  auto now = Time::now();
+  if (min_rtt_ == 0.0 || rtt <= min_rtt_ || now > min_rtt_time_ + MIN_RTT_EXPIRE_TIME) {
+    min_rtt_ = max(rtt, 1e-3);
+    min_rtt_time_ = now;
+  }
+
+  if (goodput_interval_start_time_ < now - rtt - MIN_RTT_EXPIRE_TIME) {
+    // there were no loaded parts for a long time; the part was being loaded since now - rtt
+    goodput_interval_start_time_ = now - rtt;
+    goodput_interval_size_ = 0;
+  }
+  goodput_interval_size_ += size;
+  auto interval = now - goodput_interval_start_time_;
+  if (interval < max(min_rtt_, MIN_GOODPUT_INTERVAL)) {
+    return;
+  }
+  goodput_samples_[goodput_sample_pos_] = static_cast<double>(goodput_interval_size_) / interval;
+  goodput_sample_pos_ = (goodput_sample_pos_ + 1) % GOODPUT_SAMPLE_COUNT;
+  goodput_interval_start_time_ = now;
+  goodput_interval_size_ = 0;
+
+  update_max_resource_limit();
+}
+
+void ResourceManager::update_max_resource_limit() {
+  double max_goodput = 0.0;
+  for (auto goodput : goodput_samples_) {
+    max_goodput = max(max_goodput, goodput);
+  }
+  auto window = clamp(static_cast<int64>(RESOURCE_LIMIT_GAIN * max_goodput * min_rtt_), base_resource_limit_,
+                      base_resource_limit_ * MAX_RESOURCE_LIMIT_MULTIPLIER);
+
+  // the window is also limited by the fair share of the process-wide limit, which is weighted by the most important
+  // of the loaded files; the base limit is always available to avoid starvation
+  int32 weight = 0;
+  nodes_container_.for_each([&weight](NodeId, const unique_ptr<Node> &node) { weight = max(weight, node->weight); });
+  auto demand = weight == 0 ? 0 : window;
+  auto fair_share = ResourceArbiter::get(arbiter_type_).update_flow(arbiter_flow_id_, weight, demand);
+  auto new_max_resource_limit = clamp(min(window, fair_share), base_resource_limit_, window);
+  new_max_resource_limit -= new_max_resource_limit % base_resource_limit_;
+  if (new_max_resource_limit == max_resource_limit_) {
+    return;
+  }
+  LOG(INFO) << "Change resource limit from " << max_resource_limit_ << " to " << new_max_resource_limit << " with "
+            << tag("goodput", max_goodput) << tag("min_rtt", min_rtt_) << tag("fair_share", fair_share)
+            << tag("weight", weight);
+  max_resource_limit_ = new_max_resource_limit;
+  loop();
+}
+
 void ResourceManager::hangup_shared() {
   auto node_id = get_link_token();
   auto node_ptr = nodes_container_.get(node_id);
@@ -79,6 +144,7 @@ void ResourceManager::hangup_shared() {
   resource_state_ -= node->resource_state_;
   remove_node(node_id);
   nodes_container_.erase(node_id);
+  update_max_resource_limit();
   loop();
 }
 
@@ -115,7 +181,7 @@ bool ResourceManager::satisfy_node(NodeId file_node_id) {
   give = min(need, give);
   give -= give % part_size;
   VLOG(file_loader) << tag("give", give);
-  if (give == 0) {
+  if (give <= 0) {
     return false;
   }
   resource_state_.start_use(give);
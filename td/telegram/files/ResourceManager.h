@@ -7,6 +7,7 @@
 #pragma once
 
 #include "td/telegram/files/FileLoaderActor.h"
+#include "td/telegram/files/ResourceArbiter.h"
 #include "td/telegram/files/ResourceState.h"
 
 #include "td/actor/actor.h"
@@ -14,6 +15,7 @@
 #include "td/utils/Container.h"
 #include "td/utils/Heap.h"
 
+#include <array>
 #include <utility>
 
 namespace td {
@@ -21,21 +23,46 @@ namespace td {
 class ResourceManager final : public Actor {
  public:
   enum class Mode : int32 { Baseline, Greedy };
-  ResourceManager(int64 max_resource_limit, Mode mode) : max_resource_limit_(max_resource_limit), mode_(mode) {
+  ResourceManager(int64 max_resource_limit, Mode mode, ResourceArbiter::Type arbiter_type, uint64 arbiter_tenant_id)
+      : max_resource_limit_(max_resource_limit)
+      , base_resource_limit_(max_resource_limit)
+      , mode_(mode)
+      , arbiter_type_(arbiter_type)
+      , arbiter_tenant_id_(arbiter_tenant_id) {
   }
   // use through ActorShared
   void update_priority(int8 priority);
   void update_resources(const ResourceState &resource_state);
+  void on_part_loaded(int64 size, double rtt);
 
-  void register_worker(ActorShared<FileLoaderActor> callback, int8 priority);
+  void register_worker(ActorShared<FileLoaderActor> callback, int8 priority, int32 weight);
 
  private:
   int64 max_resource_limit_ = 0;
+  int64 base_resource_limit_ = 0;
   Mode mode_;
+  ResourceArbiter::Type arbiter_type_;
+  uint64 arbiter_tenant_id_ = 0;
+  uint64 arbiter_flow_id_ = 0;
+
+  // the limit is chosen like BBR congestion window from maximum recent goodput and minimum recent RTT
+  static constexpr int64 MAX_RESOURCE_LIMIT_MULTIPLIER = 16;
+  static constexpr double RESOURCE_LIMIT_GAIN = 2.0;
+  static constexpr double MIN_RTT_EXPIRE_TIME = 10.0;
+  static constexpr double MIN_GOODPUT_INTERVAL = 0.1;
+  static constexpr size_t GOODPUT_SAMPLE_COUNT = 10;
+
+  double min_rtt_ = 0.0;
+  double min_rtt_time_ = 0.0;
+  double goodput_interval_start_time_ = 0.0;
+  int64 goodput_interval_size_ = 0;
+  std::array<double, GOODPUT_SAMPLE_COUNT> goodput_samples_{};
+  size_t goodput_sample_pos_ = 0;
 
   using NodeId = uint64;
   struct Node final : public HeapNode {
     NodeId node_id = 0;
+    int32 weight = 1;
 
     ResourceState resource_state_;
     ActorShared<FileLoaderActor> callback_;
@@ -56,6 +83,8 @@ class ResourceManager final : public Actor {
   ActorShared<> parent_;
   bool stop_flag_ = false;
 
+  void start_up() final;
+  void tear_down() final;
   void hangup_shared() final;
 
   void loop() final;
@@ -64,6 +93,7 @@ class ResourceManager final : public Actor {
   bool satisfy_node(NodeId file_node_id);
   void add_node(NodeId node_id, int8 priority);
   bool remove_node(NodeId node_id);
+  void update_max_resource_limit();
 };
 
 }  // namespace td
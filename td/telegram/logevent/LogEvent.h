@@ -15,6 +15,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/Slice.h"
+#include "td/utils/StackAllocator.h"
 #include "td/utils/Status.h"
 #include "td/utils/StorerBase.h"
 #include "td/utils/StringBuilder.h"
@@ -22,6 +23,8 @@
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
 
+#include <cstring>
+
 namespace td {
 namespace log_event {
 
@@ -139,6 +142,13 @@ class LogEventParser final : public WithVersion<WithContext<TlParser, Global *>>
     LOG_CHECK(version() < static_cast<int32>(Version::Next)) << "Wrong version " << version();
     set_context(G());
   }
+
+  // allows to parse data outside of a TDLib instance; the parsed objects must not use the context
+  LogEventParser(Slice data, Global *context) : WithVersion<WithContext<TlParser, Global *>>(data) {
+    set_version(fetch_int());
+    LOG_CHECK(version() < static_cast<int32>(Version::Next)) << "Wrong version " << version();
+    set_context(context);
+  }
 };
 
 class LogEventStorerCalcLength final : public WithContext<TlStorerCalcLength, Global *> {
@@ -157,29 +167,12 @@ class LogEventStorerUnsafe final : public WithContext<TlStorerUnsafe, Global *>
   }
 };
 
-template <class T>
-class LogEventStorerImpl final : public Storer {
+class LogEventStorerBounded final : public WithContext<TlStorerBounded, Global *> {
  public:
-  explicit LogEventStorerImpl(const T &event) : event_(event) {
-  }
-
-  size_t size() const final {
-    LogEventStorerCalcLength storer;
-    td::store(event_, storer);
-    return storer.get_length();
-  }
-  size_t store(uint8 *ptr) const final {
-    LogEventStorerUnsafe storer(ptr);
-    td::store(event_, storer);
-#ifdef TD_DEBUG
-    T check_result;
-    log_event_parse(check_result, Slice(ptr, storer.get_buf())).ensure();
-#endif
-    return static_cast<size_t>(storer.get_buf() - ptr);
+  LogEventStorerBounded(unsigned char *buf, size_t capacity) : WithContext<TlStorerBounded, Global *>(buf, capacity) {
+    store_int(static_cast<int32>(Version::Next) - 1);
+    set_context(G());
   }
-
- private:
-  const T &event_;
 };
 
 }  // namespace log_event
@@ -188,6 +181,7 @@ using LogEvent = log_event::LogEvent;
 using LogEventParser = log_event::LogEventParser;
 using LogEventStorerCalcLength = log_event::LogEventStorerCalcLength;
 using LogEventStorerUnsafe = log_event::LogEventStorerUnsafe;
+using LogEventStorerBounded = log_event::LogEventStorerBounded;
 
 template <class T>
 Status log_event_parse(T &data, Slice slice) TD_WARN_UNUSED_RESULT;
@@ -200,17 +194,32 @@ Status log_event_parse(T &data, Slice slice) {
   return parser.get_status();
 }
 
-template <class T>
-BufferSlice log_event_store_impl(const T &data, const char *file, int line) {
-  LogEventStorerCalcLength storer_calc_length;
-  store(data, storer_calc_length);
+// store_function(storer) must store the same data to a storer of any type
+template <class F>
+BufferSlice log_event_store_by_function(const F &store_function) {
+  // most values fit in the temporary buffer, so they are serialized in a single pass and then just copied
+  constexpr size_t MAX_SINGLE_PASS_SIZE = 1 << 14;
+  auto tmp = StackAllocator::alloc(MAX_SINGLE_PASS_SIZE);
+  LogEventStorerBounded storer_bounded(tmp.as_slice().ubegin(), tmp.as_slice().size());
+  store_function(storer_bounded);
 
-  BufferSlice value_buffer{storer_calc_length.get_length()};
+  BufferSlice value_buffer{storer_bounded.get_length()};
   auto ptr = value_buffer.as_mutable_slice().ubegin();
   LOG_CHECK(is_aligned_pointer<4>(ptr)) << ptr;
 
-  LogEventStorerUnsafe storer_unsafe(ptr);
-  store(data, storer_unsafe);
+  if (storer_bounded.is_complete()) {
+    std::memcpy(ptr, tmp.as_slice().ubegin(), value_buffer.size());
+  } else {
+    LogEventStorerUnsafe storer_unsafe(ptr);
+    store_function(storer_unsafe);
+    CHECK(storer_unsafe.get_buf() == value_buffer.as_slice().uend());
+  }
+  return value_buffer;
+}
+
+template <class T>
+BufferSlice log_event_store_impl(const T &data, const char *file, int line) {
+  auto value_buffer = log_event_store_by_function([&data](auto &storer) { store(data, storer); });
 
 #ifdef TD_DEBUG
   T check_result;
@@ -224,6 +233,38 @@ BufferSlice log_event_store_impl(const T &data, const char *file, int line) {
 
 #define log_event_store(data) log_event_store_impl((data), __FILE__, __LINE__)
 
+namespace log_event {
+
+template <class T>
+class LogEventStorerImpl final : public Storer {
+ public:
+  explicit LogEventStorerImpl(const T &event) : event_(event) {
+  }
+
+  size_t size() const final {
+    return get_data().size();
+  }
+  size_t store(uint8 *ptr) const final {
+    auto data = get_data();
+    std::memcpy(ptr, data.ubegin(), data.size());
+    return data.size();
+  }
+
+ private:
+  const T &event_;
+  mutable BufferSlice data_;
+
+  // the event is serialized once and reused by both size() and store()
+  Slice get_data() const {
+    if (data_.empty()) {
+      data_ = log_event_store(event_);
+    }
+    return data_.as_slice();
+  }
+};
+
+}  // namespace log_event
+
 template <class T>
 log_event::LogEventStorerImpl<T> get_log_event_storer(const T &event) {
   return log_event::LogEventStorerImpl<T>(event);
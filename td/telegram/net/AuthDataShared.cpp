@@ -89,7 +89,7 @@ class AuthDataSharedImpl final : public AuthDataShared {
   std::vector<unique_ptr<Listener>> auth_key_listeners_;
   std::shared_ptr<PublicRsaKeyShared> public_rsa_key_;
   std::shared_ptr<Guard> guard_;
-  RwMutex rw_mutex_;
+  RwMutex rw_mutex_{"AuthDataShared"};
 
   string auth_key_key() const {
     return PSTRING() << "auth" << dc_id_.get_raw_id();
@@ -31,6 +31,7 @@
 #include "td/utils/algorithm.h"
 #include "td/utils/base64.h"
 #include "td/utils/format.h"
+#include "td/utils/HashTableUtils.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/IPAddress.h"
@@ -40,6 +41,7 @@
 #include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
 
+#include <algorithm>
 #include <utility>
 
 namespace td {
@@ -64,6 +66,9 @@ class StatsCallback final : public mtproto::RawConnection::StatsCallback {
   void on_write(uint64 bytes) final {
     net_stats_callback_->on_write(bytes);
   }
+  void on_packet_sent(uint64 bytes) final {
+    net_stats_callback_->on_packet_sent(bytes);
+  }
 
   void on_pong() final {
     if (option_stat_) {
@@ -164,6 +169,7 @@ void ConnectionCreator::add_proxy(int32 old_proxy_id, string server, int32 port,
     G()->td_db()->get_binlog_pmc()->erase(get_proxy_used_database_key(old_proxy_id));
     proxy_last_used_date_.erase(old_proxy_id);
     proxy_last_used_saved_date_.erase(old_proxy_id);
+    proxy_stats_.erase(old_proxy_id);
   }
 
   auto proxy_id = [&] {
@@ -216,6 +222,7 @@ void ConnectionCreator::remove_proxy(int32 proxy_id, Promise<Unit> promise) {
   }
 
   proxies_.erase(proxy_id);
+  proxy_stats_.erase(proxy_id);
 
   G()->td_db()->get_binlog_pmc()->erase(get_proxy_database_key(proxy_id));
   G()->td_db()->get_binlog_pmc()->erase(get_proxy_used_database_key(proxy_id));
@@ -265,7 +272,7 @@ void ConnectionCreator::ping_proxy(int32 proxy_id, Promise<double> promise) {
   CHECK(!close_flag_);
   if (proxy_id == 0) {
     auto main_dc_id = G()->net_query_dispatcher().get_main_dc_id();
-    bool prefer_ipv6 = G()->get_option_boolean("prefer_ipv6");
+    bool prefer_ipv6 = G()->get_option_boolean(OptionId::PreferIpv6);
     auto infos = dc_options_set_.find_all_connections(main_dc_id, false, false, prefer_ipv6, false);
     if (infos.empty()) {
       return promise.set_error(Status::Error(400, "Can't find valid DC address"));
@@ -297,12 +304,15 @@ void ConnectionCreator::ping_proxy(int32 proxy_id, Promise<double> promise) {
         continue;
       }
 
-      ping_proxy_buffered_socket_fd(std::move(ip_address), BufferedFd<SocketFd>(r_socket_fd.move_as_ok()),
-                                    r_transport_type.move_as_ok(), PSTRING() << info.option->get_ip_address(),
-                                    PromiseCreator::lambda([actor_id = actor_id(this), token](Result<double> result) {
-                                      send_closure(actor_id, &ConnectionCreator::on_ping_main_dc_result, token,
-                                                   std::move(result));
-                                    }));
+      ping_proxy_buffered_socket_fd(
+          std::move(ip_address), BufferedFd<SocketFd>(r_socket_fd.move_as_ok()), r_transport_type.move_as_ok(),
+          PSTRING() << info.option->get_ip_address(),
+          PromiseCreator::lambda([actor_id = actor_id(this), token, stat = info.stat](Result<double> result) {
+            if (result.is_ok()) {
+              send_closure(actor_id, &ConnectionCreator::on_dc_option_rtt, stat, result.ok());
+            }
+            send_closure(actor_id, &ConnectionCreator::on_ping_main_dc_result, token, std::move(result));
+          }));
     }
     return;
   }
@@ -312,7 +322,7 @@ void ConnectionCreator::ping_proxy(int32 proxy_id, Promise<double> promise) {
     return promise.set_error(Status::Error(400, "Unknown proxy identifier"));
   }
   const Proxy &proxy = it->second;
-  bool prefer_ipv6 = G()->get_option_boolean("prefer_ipv6");
+  bool prefer_ipv6 = G()->get_option_boolean(OptionId::PreferIpv6);
   send_closure(get_dns_resolver(), &GetHostByNameActor::run, proxy.server().str(), proxy.port(), prefer_ipv6,
                PromiseCreator::lambda([actor_id = actor_id(this), promise = std::move(promise),
                                        proxy_id](Result<IPAddress> result) mutable {
@@ -378,6 +388,94 @@ void ConnectionCreator::ping_proxy_buffered_socket_fd(IPAddress ip_address, Buff
                                create_reference(token))};
 }
 
+void ConnectionCreator::on_auto_select_proxy_changed() {
+  if (!G()->get_option_boolean("auto_select_proxy")) {
+    proxy_stats_.clear();
+  }
+  loop();
+}
+
+bool ConnectionCreator::need_probe_proxies() const {
+  return online_flag_ && active_proxy_id_ != 0 && proxies_.size() > 1 &&
+         G()->get_option_boolean("auto_select_proxy");
+}
+
+void ConnectionCreator::probe_proxies() {
+  CHECK(pending_proxy_probe_count_ == 0);
+  probe_proxies_timestamp_ = Timestamp::in(PROXY_PROBE_PERIOD);
+  VLOG(connections) << "Probe " << proxies_.size() << " proxies";
+  pending_proxy_probe_count_ = proxies_.size();
+  for (auto &proxy : proxies_) {
+    auto proxy_id = proxy.first;
+    ping_proxy(proxy_id, PromiseCreator::lambda([actor_id = actor_id(this), proxy_id](Result<double> result) {
+                 send_closure(actor_id, &ConnectionCreator::on_proxy_probe_result, proxy_id, std::move(result));
+               }));
+  }
+}
+
+void ConnectionCreator::on_proxy_probe_result(int32 proxy_id, Result<double> result) {
+  CHECK(pending_proxy_probe_count_ > 0);
+  pending_proxy_probe_count_--;
+  if (proxies_.count(proxy_id) != 0) {
+    auto &stat = proxy_stats_[proxy_id];
+    if (result.is_ok()) {
+      auto rtt = result.ok();
+      stat.rtt = stat.probe_count == 0 ? rtt : stat.rtt + (rtt - stat.rtt) * PROXY_STAT_SMOOTHING_FACTOR;
+      stat.reliability += (1.0 - stat.reliability) * PROXY_STAT_SMOOTHING_FACTOR;
+    } else {
+      stat.reliability -= stat.reliability * PROXY_STAT_SMOOTHING_FACTOR;
+    }
+    stat.probe_count++;
+    VLOG(connections) << "Proxy " << proxy_id << " has RTT " << stat.rtt << " and reliability " << stat.reliability
+                      << " after " << stat.probe_count << " probes";
+  }
+  if (pending_proxy_probe_count_ != 0) {
+    return;
+  }
+
+  if (!G()->close_flag()) {
+    select_fastest_proxy();
+    loop();
+  }
+}
+
+void ConnectionCreator::select_fastest_proxy() {
+  if (!need_probe_proxies() || last_proxy_switch_at_ + MIN_PROXY_SWITCH_DELAY > Time::now()) {
+    return;
+  }
+  auto is_reliable = [](const ProxyStat &stat) {
+    return stat.probe_count >= MIN_PROXY_PROBE_COUNT && stat.reliability >= MIN_PROXY_RELIABILITY;
+  };
+
+  int32 best_proxy_id = 0;
+  const ProxyStat *best_stat = nullptr;
+  for (auto &it : proxy_stats_) {
+    if (is_reliable(it.second) && (best_stat == nullptr || it.second.rtt < best_stat->rtt)) {
+      best_proxy_id = it.first;
+      best_stat = &it.second;
+    }
+  }
+  if (best_stat == nullptr || best_proxy_id == active_proxy_id_) {
+    return;
+  }
+
+  auto active_it = proxy_stats_.find(active_proxy_id_);
+  if (active_it != proxy_stats_.end()) {
+    const auto &active_stat = active_it->second;
+    if (active_stat.probe_count < MIN_PROXY_PROBE_COUNT) {
+      return;
+    }
+    if (is_reliable(active_stat) && best_stat->rtt >= active_stat.rtt * PROXY_SWITCH_RTT_FACTOR) {
+      return;
+    }
+  }
+
+  LOG(INFO) << "Switch from proxy " << active_proxy_id_ << " to proxy " << best_proxy_id << " with RTT "
+            << best_stat->rtt;
+  last_proxy_switch_at_ = Time::now();
+  enable_proxy_impl(best_proxy_id);
+}
+
 void ConnectionCreator::set_active_proxy_id(int32 proxy_id, bool from_binlog) {
   active_proxy_id_ = proxy_id;
   if (proxy_id == 0) {
@@ -440,6 +538,11 @@ void ConnectionCreator::on_proxy_changed(bool from_db) {
         child.second.second.reset();
       }
     }
+    for (auto &client : clients_) {
+      if (client.second.is_prewarm_pool) {
+        client.second.ready_connections.clear();
+      }
+    }
   }
 
   VLOG(connections) << "Drop proxy IP address " << proxy_ip_address_;
@@ -548,6 +651,9 @@ void ConnectionCreator::on_online(bool online_flag) {
       client_loop(client.second);
     }
   }
+  if (online_flag_) {
+    loop();
+  }
 }
 void ConnectionCreator::on_logging_out(bool is_logging_out) {
   if (is_logging_out_ == is_logging_out) {
@@ -604,9 +710,64 @@ void ConnectionCreator::request_raw_connection(DcId dc_id, bool allow_media_only
                     << tag("allow_media_only", allow_media_only);
   client.queries.push_back(std::move(promise));
 
+  auto pool_hash = get_prewarm_pool_hash(dc_id, allow_media_only, is_media);
+  CHECK(pool_hash != hash);
+  auto &pool = clients_[pool_hash];
+  if (!pool.inited) {
+    pool.inited = true;
+    pool.hash = pool_hash;
+    pool.dc_id = dc_id;
+    pool.allow_media_only = allow_media_only;
+    pool.is_media = is_media;
+    pool.is_prewarm_pool = true;
+  }
+
   client_loop(client);
 }
 
+void ConnectionCreator::on_prewarmed_connection_count_changed() {
+  for (auto &client : clients_) {
+    if (client.second.is_prewarm_pool) {
+      client_loop(client.second);
+    }
+  }
+}
+
+uint32 ConnectionCreator::get_prewarm_pool_hash(DcId dc_id, bool allow_media_only, bool is_media) {
+  return Hash<string>()(PSTRING() << "Prewarm " << dc_id.get_raw_id() << ' ' << allow_media_only << ' ' << is_media);
+}
+
+size_t ConnectionCreator::get_prewarmed_connection_count() const {
+  // connections are prewarmed only while the application is active to save traffic and battery
+  if (!online_flag_ || close_flag_) {
+    return 0;
+  }
+  return static_cast<size_t>(G()->get_option_integer("prewarmed_connection_count"));
+}
+
+void ConnectionCreator::client_take_prewarmed_connections(ClientInfo &client) {
+  CHECK(!client.is_prewarm_pool);
+  auto it = clients_.find(get_prewarm_pool_hash(client.dc_id, client.allow_media_only, client.is_media));
+  if (it == clients_.end()) {
+    return;
+  }
+  auto &pool = it->second;
+  while (client.ready_connections.size() < client.queries.size() && !pool.ready_connections.empty()) {
+    auto raw_connection = std::move(pool.ready_connections.back().first);
+    pool.ready_connections.pop_back();
+    if (raw_connection->extra().extra != network_generation_) {
+      VLOG(connections) << "Drop prewarmed " << tag("connection", raw_connection.get()) << " from old network";
+      continue;
+    }
+    VLOG(connections) << "Take prewarmed " << tag("connection", raw_connection.get()) << " for "
+                      << tag("client", format::as_hex(client.hash));
+    client.ready_connections.emplace_back(std::move(raw_connection), Time::now_cached());
+  }
+
+  // refill the pool
+  client_loop(pool);
+}
+
 void ConnectionCreator::request_raw_connection_by_ip(IPAddress ip_address, mtproto::TransportType transport_type,
                                                      Promise<unique_ptr<mtproto::RawConnection>> promise) {
   auto r_socket_fd = SocketFd::open(ip_address);
@@ -669,13 +830,14 @@ Result<mtproto::TransportType> ConnectionCreator::get_transport_type(const Proxy
 Result<SocketFd> ConnectionCreator::find_connection(const Proxy &proxy, const IPAddress &proxy_ip_address, DcId dc_id,
                                                     bool allow_media_only, FindConnectionExtra &extra) {
   extra.debug_str = PSTRING() << "Failed to find valid IP address for " << dc_id;
-  bool prefer_ipv6 = G()->get_option_boolean("prefer_ipv6") || (proxy.use_proxy() && proxy_ip_address.is_ipv6());
+  bool prefer_ipv6 = G()->get_option_boolean(OptionId::PreferIpv6) || (proxy.use_proxy() && proxy_ip_address.is_ipv6());
   bool only_http = proxy.use_http_caching_proxy();
 #if TD_DARWIN_WATCH_OS
   only_http = true;
 #endif
-  TRY_RESULT(info, dc_options_set_.find_connection(
-                       dc_id, allow_media_only, proxy.use_proxy() && proxy.use_socks5_proxy(), prefer_ipv6, only_http));
+  TRY_RESULT(info, dc_options_set_.find_connection(dc_id, allow_media_only,
+                                                   proxy.use_proxy() && proxy.use_socks5_proxy(), prefer_ipv6,
+                                                   only_http, extra.excluded_stats));
   extra.stat = info.stat;
   TRY_RESULT_ASSIGN(extra.transport_type, get_transport_type(proxy, info));
 
@@ -812,12 +974,17 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
   VLOG(connections) << "In client_loop: " << tag("client", format::as_hex(client.hash));
 
   // Remove expired ready connections
-  td::remove_if(client.ready_connections,
-                [&, expires_at = Time::now_cached() - ClientInfo::READY_CONNECTIONS_TIMEOUT](auto &v) {
-                  bool drop = v.second < expires_at;
-                  VLOG_IF(connections, drop) << "Drop expired " << tag("connection", v.first.get());
-                  return drop;
-                });
+  auto ready_connections_timeout =
+      client.is_prewarm_pool ? ClientInfo::PREWARMED_CONNECTIONS_TIMEOUT : ClientInfo::READY_CONNECTIONS_TIMEOUT;
+  td::remove_if(client.ready_connections, [&, expires_at = Time::now_cached() - ready_connections_timeout](auto &v) {
+    bool drop = v.second < expires_at;
+    VLOG_IF(connections, drop) << "Drop expired " << tag("connection", v.first.get());
+    return drop;
+  });
+
+  if (!client.is_prewarm_pool && client.ready_connections.size() < client.queries.size()) {
+    client_take_prewarmed_connections(client);
+  }
 
   // Send ready connections into promises
   {
@@ -835,20 +1002,36 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
   }
 
   // Main loop. Create new connections till needed
-  bool check_mode = client.checking_connections != 0 && !proxy.use_proxy();
+  // connections of prewarm pools are always checked to be sure that they are usable
+  bool check_mode = (client.checking_connections != 0 || client.is_prewarm_pool) && !proxy.use_proxy();
   while (true) {
     // Check if we need new connections
-    if (client.queries.empty()) {
+    if (client.is_prewarm_pool) {
+      if (client.pending_connections + client.ready_connections.size() >= get_prewarmed_connection_count()) {
+        if (!client.ready_connections.empty()) {
+          client_set_timeout_at(client, Time::now() + ClientInfo::PREWARMED_CONNECTIONS_TIMEOUT);
+        }
+        return;
+      }
+    } else if (client.queries.empty()) {
       if (!client.ready_connections.empty()) {
         client_set_timeout_at(client, Time::now() + ClientInfo::READY_CONNECTIONS_TIMEOUT);
       }
       return;
     }
+    bool is_racing_check = false;
     if (check_mode) {
-      if (client.checking_connections >= 3) {
+      if (client.checking_connections >= ClientInfo::MAX_CHECKING_CONNECTIONS) {
         return;
       }
-    } else {
+      if (client.checking_connections > 0 && !proxy.use_proxy() && !client.is_prewarm_pool) {
+        auto race_at = client.last_check_at + ClientInfo::RACING_CHECK_DELAY;
+        if (race_at > Time::now()) {
+          return client_set_timeout_at(client, race_at);
+        }
+        is_racing_check = true;
+      }
+    } else if (!client.is_prewarm_pool) {
       if (client.pending_connections >= client.queries.size()) {
         return;
       }
@@ -857,24 +1040,33 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
     bool act_as_if_online = online_flag_ || is_logging_out_;
     // Check flood
     auto &flood_control = act_as_if_online ? client.flood_control_online : client.flood_control;
-    auto wakeup_at = max(flood_control.get_wakeup_at(), client.mtproto_error_flood_control.get_wakeup_at());
-    wakeup_at = max(client.sanity_flood_control.get_wakeup_at(), wakeup_at);
-
-    if (!act_as_if_online) {
-      wakeup_at = max(wakeup_at, static_cast<double>(client.backoff.get_wakeup_at()));
+    auto wakeup_at =
+        max(client.sanity_flood_control.get_wakeup_at(), client.mtproto_error_flood_control.get_wakeup_at());
+    if (!is_racing_check) {
+      wakeup_at = max(wakeup_at, flood_control.get_wakeup_at());
+      if (!act_as_if_online) {
+        wakeup_at = max(wakeup_at, static_cast<double>(client.backoff.get_wakeup_at()));
+      }
     }
     if (wakeup_at > Time::now()) {
       return client_set_timeout_at(client, wakeup_at);
     }
-    client.sanity_flood_control.add_event(Time::now());
-    if (!act_as_if_online) {
-      client.backoff.add_event(static_cast<int32>(Time::now()));
-    }
 
     // Create new RawConnection
     // sync part
     FindConnectionExtra extra;
+    if (is_racing_check) {
+      extra.excluded_stats = client.checking_stats;
+    }
     auto r_socket_fd = find_connection(proxy, proxy_ip_address_, client.dc_id, client.allow_media_only, extra);
+    if (is_racing_check && r_socket_fd.is_error()) {
+      VLOG(connections) << "Don't race checks: " << r_socket_fd.error();
+      return;
+    }
+    client.sanity_flood_control.add_event(Time::now());
+    if (!is_racing_check && !act_as_if_online) {
+      client.backoff.add_event(static_cast<int32>(Time::now()));
+    }
     check_mode |= extra.check_mode;
     if (r_socket_fd.is_error()) {
       LOG(WARNING) << extra.debug_str << ": " << r_socket_fd.error();
@@ -902,14 +1094,16 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
         extra.stat->on_check();
       }
       client.checking_connections++;
+      client.checking_stats.push_back(extra.stat);
+      client.last_check_at = Time::now();
     }
 
     auto promise = PromiseCreator::lambda(
-        [actor_id = actor_id(this), check_mode, transport_type = extra.transport_type, hash = client.hash,
-         debug_str = extra.debug_str,
+        [actor_id = actor_id(this), check_mode, stat = extra.stat, transport_type = extra.transport_type,
+         hash = client.hash, debug_str = extra.debug_str,
          network_generation = network_generation_](Result<ConnectionData> r_connection_data) mutable {
           send_closure(actor_id, &ConnectionCreator::client_create_raw_connection, std::move(r_connection_data),
-                       check_mode, std::move(transport_type), hash, std::move(debug_str), network_generation);
+                       check_mode, stat, std::move(transport_type), hash, std::move(debug_str), network_generation);
         });
 
     auto stats_callback =
@@ -926,8 +1120,8 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 }
 
 void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_connection_data, bool check_mode,
-                                                     mtproto::TransportType transport_type, uint32 hash,
-                                                     string debug_str, uint32 network_generation) {
+                                                     DcOptionsSet::Stat *stat, mtproto::TransportType transport_type,
+                                                     uint32 hash, string debug_str, uint32 network_generation) {
   unique_ptr<mtproto::AuthData> auth_data;
   uint64 auth_data_generation{0};
   int64 session_id{0};
@@ -942,7 +1136,8 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
       auth_data->set_session_id(session_id);
     }
   }
-  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), hash, check_mode, auth_data_generation, session_id,
+  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), hash, check_mode, stat, auth_data_generation,
+                                         session_id,
                                          debug_str](Result<unique_ptr<mtproto::RawConnection>> result) mutable {
     if (result.is_ok()) {
       VLOG(connections) << "Ready connection (" << (check_mode ? "" : "un") << "checked) " << result.ok().get() << ' '
@@ -951,7 +1146,7 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
       VLOG(connections) << "Failed connection (" << (check_mode ? "" : "un") << "checked) " << result.error() << ' '
                         << debug_str;
     }
-    send_closure(actor_id, &ConnectionCreator::client_add_connection, hash, std::move(result), check_mode,
+    send_closure(actor_id, &ConnectionCreator::client_add_connection, hash, std::move(result), check_mode, stat,
                  auth_data_generation, session_id);
   });
 
@@ -988,7 +1183,8 @@ void ConnectionCreator::client_set_timeout_at(ClientInfo &client, double wakeup_
 }
 
 void ConnectionCreator::client_add_connection(uint32 hash, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection,
-                                              bool check_flag, uint64 auth_data_generation, int64 session_id) {
+                                              bool check_flag, DcOptionsSet::Stat *stat, uint64 auth_data_generation,
+                                              int64 session_id) {
   auto &client = clients_[hash];
   client.add_session_id(session_id);
   CHECK(client.pending_connections > 0);
@@ -996,10 +1192,17 @@ void ConnectionCreator::client_add_connection(uint32 hash, Result<unique_ptr<mtp
   if (check_flag) {
     CHECK(client.checking_connections > 0);
     client.checking_connections--;
+    auto it = std::find(client.checking_stats.begin(), client.checking_stats.end(), stat);
+    CHECK(it != client.checking_stats.end());
+    client.checking_stats.erase(it);
   }
   if (r_raw_connection.is_ok()) {
     VLOG(connections) << "Add ready connection " << r_raw_connection.ok().get() << " for "
                       << tag("client", format::as_hex(hash));
+    auto rtt = r_raw_connection.ok()->extra().rtt;
+    if (check_flag && stat != nullptr && rtt > 0) {
+      on_dc_option_rtt(stat, rtt);
+    }
     client.backoff.clear();
     client.ready_connections.emplace_back(r_raw_connection.move_as_ok(), Time::now_cached());
   } else {
@@ -1083,6 +1286,7 @@ void ConnectionCreator::start_up() {
   } else {
     on_dc_options(std::move(dc_options));
   }
+  dc_options_set_.set_serialized_rtts(G()->td_db()->get_binlog_pmc()->get("dc_option_rtts"));
 
   auto proxy_info = G()->td_db()->get_binlog_pmc()->prefix_get("proxy");
   auto it = proxy_info.find("_max_id");
@@ -1248,7 +1452,7 @@ void ConnectionCreator::loop() {
       if (resolve_proxy_query_token_ == 0) {
         resolve_proxy_query_token_ = next_token();
         const Proxy &proxy = proxies_[active_proxy_id_];
-        bool prefer_ipv6 = G()->get_option_boolean("prefer_ipv6");
+        bool prefer_ipv6 = G()->get_option_boolean(OptionId::PreferIpv6);
         VLOG(connections) << "Resolve IP address " << resolve_proxy_query_token_ << " of " << proxy.server();
         send_closure(
             get_dns_resolver(), &GetHostByNameActor::run, proxy.server().str(), proxy.port(), prefer_ipv6,
@@ -1262,6 +1466,15 @@ void ConnectionCreator::loop() {
     }
   }
 
+  if (need_probe_proxies()) {
+    if (probe_proxies_timestamp_.is_in_past() && pending_proxy_probe_count_ == 0) {
+      probe_proxies();
+    }
+    if (!probe_proxies_timestamp_.is_in_past()) {
+      timeout.relax(probe_proxies_timestamp_);
+    }
+  }
+
   if (timeout) {
     set_timeout_at(timeout.at());
   }
@@ -1292,6 +1505,16 @@ void ConnectionCreator::on_proxy_resolved(Result<IPAddress> r_ip_address, bool d
   }
 }
 
+void ConnectionCreator::on_dc_option_rtt(DcOptionsSet::Stat *stat, double rtt) {
+  CHECK(stat != nullptr);
+  stat->on_rtt(rtt);
+
+  if (Time::now() >= dc_option_rtts_save_at_) {
+    dc_option_rtts_save_at_ = Time::now() + DC_OPTION_RTTS_SAVE_DELAY;
+    G()->td_db()->get_binlog_pmc()->set("dc_option_rtts", dc_options_set_.get_serialized_rtts());
+  }
+}
+
 void ConnectionCreator::on_ping_main_dc_result(uint64 token, Result<double> result) {
   auto &request = ping_main_dc_requests_[token];
   CHECK(request.left_queries > 0);
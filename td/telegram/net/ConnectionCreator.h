@@ -67,6 +67,10 @@ class ConnectionCreator final : public NetQueryCallback {
   void request_raw_connection_by_ip(IPAddress ip_address, mtproto::TransportType transport_type,
                                     Promise<unique_ptr<mtproto::RawConnection>> promise);
 
+  void on_prewarmed_connection_count_changed();
+
+  void on_auto_select_proxy_changed();
+
   void set_net_stats_callback(std::shared_ptr<NetStatsCallback> common_callback,
                               std::shared_ptr<NetStatsCallback> media_callback);
 
@@ -117,6 +121,29 @@ class ConnectionCreator final : public NetQueryCallback {
   Timestamp resolve_proxy_timestamp_;
   uint64 resolve_proxy_query_token_{0};
 
+  // while the option "auto_select_proxy" is enabled and the application is active, all proxies are pinged
+  // in parallel and the enabled proxy is replaced with the fastest reliable one, if it is noticeably faster
+  // or if the enabled proxy itself becomes unreliable
+  static constexpr double PROXY_PROBE_PERIOD = 60;
+  static constexpr double MIN_PROXY_SWITCH_DELAY = 300;
+  static constexpr double PROXY_SWITCH_RTT_FACTOR = 0.7;
+  static constexpr double PROXY_STAT_SMOOTHING_FACTOR = 0.3;
+  static constexpr double MIN_PROXY_RELIABILITY = 0.8;
+  static constexpr int32 MIN_PROXY_PROBE_COUNT = 3;
+
+  struct ProxyStat {
+    double rtt = 0;
+    double reliability = 0;
+    int32 probe_count = 0;
+  };
+  FlatHashMap<int32, ProxyStat> proxy_stats_;
+  Timestamp probe_proxies_timestamp_;
+  size_t pending_proxy_probe_count_ = 0;
+  double last_proxy_switch_at_ = 0;
+
+  static constexpr double DC_OPTION_RTTS_SAVE_DELAY = 60;
+  double dc_option_rtts_save_at_ = 0;
+
   struct ClientInfo {
     class Backoff {
 #if TD_ANDROID || TD_DARWIN_IOS || TD_DARWIN_WATCH_OS || TD_TIZEN
@@ -158,6 +185,17 @@ class ConnectionCreator final : public NetQueryCallback {
 
     static constexpr double READY_CONNECTIONS_TIMEOUT = 10;
 
+    // pool of ready connections shared by all clients with the same DC and connection type
+    bool is_prewarm_pool{false};
+    static constexpr double PREWARMED_CONNECTIONS_TIMEOUT = 30;
+
+    // checks of different addresses are raced like in RFC 8305: the next one is started, if previous checks
+    // haven't finished in RACING_CHECK_DELAY seconds, regardless of flood control and backoff
+    static constexpr size_t MAX_CHECKING_CONNECTIONS = 3;
+    static constexpr double RACING_CHECK_DELAY = 0.25;
+    std::vector<const DcOptionsSet::Stat *> checking_stats;
+    double last_check_at{0};
+
     bool inited{false};
     uint32 hash{0};
     DcId dc_id;
@@ -220,12 +258,16 @@ class ConnectionCreator final : public NetQueryCallback {
   void client_wakeup(uint32 hash);
   void client_loop(ClientInfo &client);
   void client_create_raw_connection(Result<ConnectionData> r_connection_data, bool check_mode,
-                                    mtproto::TransportType transport_type, uint32 hash, string debug_str,
-                                    uint32 network_generation);
+                                    DcOptionsSet::Stat *stat, mtproto::TransportType transport_type, uint32 hash,
+                                    string debug_str, uint32 network_generation);
   void client_add_connection(uint32 hash, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection, bool check_flag,
-                             uint64 auth_data_generation, int64 session_id);
+                             DcOptionsSet::Stat *stat, uint64 auth_data_generation, int64 session_id);
   void client_set_timeout_at(ClientInfo &client, double wakeup_at);
 
+  static uint32 get_prewarm_pool_hash(DcId dc_id, bool allow_media_only, bool is_media);
+  size_t get_prewarmed_connection_count() const;
+  void client_take_prewarmed_connections(ClientInfo &client);
+
   void on_proxy_resolved(Result<IPAddress> ip_address, bool dummy);
 
   struct FindConnectionExtra {
@@ -235,6 +277,7 @@ class ConnectionCreator final : public NetQueryCallback {
     IPAddress ip_address;
     IPAddress mtproto_ip_address;
     bool check_mode{false};
+    vector<const DcOptionsSet::Stat *> excluded_stats;
   };
 
   static Result<mtproto::TransportType> get_transport_type(const Proxy &proxy,
@@ -251,6 +294,16 @@ class ConnectionCreator final : public NetQueryCallback {
                                      mtproto::TransportType transport_type, string debug_str, Promise<double> promise);
 
   void on_ping_main_dc_result(uint64 token, Result<double> result);
+
+  bool need_probe_proxies() const;
+
+  void probe_proxies();
+
+  void on_proxy_probe_result(int32 proxy_id, Result<double> result);
+
+  void select_fastest_proxy();
+
+  void on_dc_option_rtt(DcOptionsSet::Stat *stat, double rtt);
 };
 
 }  // namespace td
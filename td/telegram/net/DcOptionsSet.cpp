@@ -15,6 +15,7 @@
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/tl_helpers.h"
 
 #include <algorithm>
 #include <set>
@@ -132,7 +133,8 @@ vector<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_all_connections(DcId dc_
 }
 
 Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, bool allow_media_only, bool use_static,
-                                                                   bool prefer_ipv6, bool only_http) {
+                                                                   bool prefer_ipv6, bool only_http,
+                                                                   const vector<const Stat *> &excluded_stats) {
   auto options = find_all_connections(dc_id, allow_media_only, use_static, prefer_ipv6, only_http);
 
   if (options.empty()) {
@@ -142,6 +144,13 @@ Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, b
                                   << tag("prefer_ipv6", prefer_ipv6));
   }
 
+  if (!excluded_stats.empty()) {
+    td::remove_if(options, [&](auto &v) { return td::contains(excluded_stats, v.stat); });
+    if (options.empty()) {
+      return Status::Error(PSLICE() << "No more connections to try in " << dc_id);
+    }
+  }
+
   auto last_error_at = std::min_element(options.begin(), options.end(), [](const auto &a_option, const auto &b_option) {
                          return a_option.stat->error_at > b_option.stat->error_at;
                        })->stat->error_at;
@@ -155,6 +164,12 @@ Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, b
       return a_state < b_state;
     }
     if (a_state == Stat::State::Ok) {
+      // addresses with known smaller round-trip time are preferred
+      auto a_rtt = a.rtt < 0 ? 1e9 : a.rtt;
+      auto b_rtt = b.rtt < 0 ? 1e9 : b.rtt;
+      if (a_rtt != b_rtt) {
+        return a_rtt < b_rtt;
+      }
       if (a_option.order == b_option.order) {
         return a_option.use_http < b_option.use_http;
       }
@@ -173,6 +188,67 @@ void DcOptionsSet::reset() {
   ordered_options_.clear();
 }
 
+namespace {
+
+struct SavedRtt {
+  IPAddress ip_address;
+  double rtt = 0;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    td::store(ip_address.is_ipv6(), storer);
+    td::store(ip_address.get_ip_str().str(), storer);
+    td::store(ip_address.get_port(), storer);
+    td::store(rtt, storer);
+  }
+
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    bool is_ipv6;
+    string ip;
+    int32 port;
+    td::parse(is_ipv6, parser);
+    td::parse(ip, parser);
+    td::parse(port, parser);
+    td::parse(rtt, parser);
+    if (is_ipv6) {
+      ip_address.init_ipv6_port(ip, port).ignore();
+    } else {
+      ip_address.init_ipv4_port(ip, port).ignore();
+    }
+  }
+};
+
+}  // namespace
+
+string DcOptionsSet::get_serialized_rtts() const {
+  vector<SavedRtt> saved_rtts;
+  for (auto &it : option_to_stat_id_) {
+    auto rtt = option_stats_.get(it.second)->get()->tcp_stat.rtt;
+    if (rtt >= 0) {
+      saved_rtts.push_back(SavedRtt{it.first, rtt});
+    }
+  }
+  return serialize(saved_rtts);
+}
+
+void DcOptionsSet::set_serialized_rtts(Slice serialized_rtts) {
+  if (serialized_rtts.empty()) {
+    return;
+  }
+  vector<SavedRtt> saved_rtts;
+  auto status = unserialize(saved_rtts, serialized_rtts);
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to parse saved round-trip times: " << status;
+    return;
+  }
+  for (auto &saved_rtt : saved_rtts) {
+    if (saved_rtt.ip_address.is_valid() && saved_rtt.rtt >= 0) {
+      option_stats_.get(get_ip_address_stat_id(saved_rtt.ip_address))->get()->tcp_stat.rtt = saved_rtt.rtt;
+    }
+  }
+}
+
 DcOptionsSet::DcOptionInfo *DcOptionsSet::register_dc_option(DcOption &&option) {
   auto info = make_unique<DcOptionInfo>(std::move(option), options_.size());
   init_option_stat(info.get());
@@ -182,12 +258,15 @@ DcOptionsSet::DcOptionInfo *DcOptionsSet::register_dc_option(DcOption &&option)
 }
 
 void DcOptionsSet::init_option_stat(DcOptionInfo *option_info) {
-  const auto &ip_address = option_info->option.get_ip_address();
+  option_info->stat_id = get_ip_address_stat_id(option_info->option.get_ip_address());
+}
+
+int64 DcOptionsSet::get_ip_address_stat_id(const IPAddress &ip_address) {
   auto it_ok = option_to_stat_id_.emplace(ip_address, 0);
   if (it_ok.second) {
     it_ok.first->second = option_stats_.create(make_unique<OptionStat>());
   }
-  option_info->stat_id = it_ok.first->second;
+  return it_ok.first->second;
 }
 
 DcOptionsSet::OptionStat *DcOptionsSet::get_option_stat(const DcOptionInfo *option_info) {
@@ -28,6 +28,7 @@ class DcOptionsSet {
     double ok_at{-1000};
     double error_at{-1001};
     double check_at{-1002};
+    double rtt{-1};  // smoothed round-trip time to the address; negative if unknown
     enum class State : int32 { Ok, Error, Checking };
 
     void on_ok() {
@@ -39,6 +40,9 @@ class DcOptionsSet {
     void on_check() {
       check_at = Time::now_cached();
     }
+    void on_rtt(double new_rtt) {
+      rtt = rtt < 0 ? new_rtt : 0.7 * rtt + 0.3 * new_rtt;
+    }
     bool is_ok() const {
       return state() == State::Ok;
     }
@@ -64,10 +68,15 @@ class DcOptionsSet {
   vector<ConnectionInfo> find_all_connections(DcId dc_id, bool allow_media_only, bool use_static, bool prefer_ipv6,
                                               bool only_http);
 
+  // options with statistics from excluded_stats aren't returned
   Result<ConnectionInfo> find_connection(DcId dc_id, bool allow_media_only, bool use_static, bool prefer_ipv6,
-                                         bool only_http);
+                                         bool only_http, const vector<const Stat *> &excluded_stats = {});
   void reset();
 
+  // round-trip times are kept between restarts to rank addresses before the first connection
+  string get_serialized_rtts() const;
+  void set_serialized_rtts(Slice serialized_rtts);
+
  private:
   enum class State : int32 { Error, Ok, Checking };
 
@@ -106,6 +115,7 @@ class DcOptionsSet {
 
   DcOptionInfo *register_dc_option(DcOption &&option);
   void init_option_stat(DcOptionInfo *option_info);
+  int64 get_ip_address_stat_id(const IPAddress &ip_address);
   OptionStat *get_option_stat(const DcOptionInfo *option_info);
 };
 
@@ -10,8 +10,11 @@
 #include "td/telegram/Global.h"
 #include "td/telegram/telegram_api.h"
 
+#include "td/actor/RequestTracer.h"
+
 #include "td/utils/algorithm.h"
 #include "td/utils/as.h"
+#include "td/utils/Metrics.h"
 #include "td/utils/misc.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
@@ -22,6 +25,17 @@ namespace td {
 
 int VERBOSITY_NAME(net_query) = VERBOSITY_NAME(INFO);
 
+static MetricCounter net_query_count_metric("td_net_queries_total", "Number of completed network queries");
+static MetricCounter net_query_error_count_metric("td_net_query_errors_total",
+                                                  "Number of network queries completed with an error");
+static MetricCounter net_query_sent_bytes_metric("td_net_query_sent_bytes_total",
+                                                 "Total size of sent network queries in bytes");
+static MetricCounter net_query_received_bytes_metric("td_net_query_received_bytes_total",
+                                                     "Total size of received network query results in bytes");
+static MetricHistogram net_query_duration_metric("td_net_query_duration_seconds",
+                                                 "Time from creation of a network query to its completion",
+                                                 {0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0});
+
 void NetQuery::debug(string state, bool may_be_lost) {
   may_be_lost_ = may_be_lost;
   VLOG(net_query) << *this << " " << tag("state", state);
@@ -53,11 +67,41 @@ NetQuery::NetQuery(State state, uint64 id, BufferSlice &&query, BufferSlice &&an
   td::unique(chain_ids_);
 
   auto &data = get_data_unsafe();
-  data.my_id_ = G()->get_option_integer("my_id");
+  data.my_id_ = G()->get_option_integer(OptionId::MyId);
   data.start_timestamp_ = data.state_timestamp_ = Time::now();
   LOG(INFO) << *this;
   if (stats) {
-    nq_counter_ = stats->register_query(this);
+    nq_counter_ = stats->register_query(this, id_);
+    stats_ = stats;
+  }
+}
+
+void NetQuery::on_completed() {
+  if ((stats_ == nullptr && trace_id_ == 0 && !MetricRegistry::is_enabled()) || !is_ready()) {
+    return;
+  }
+  double start_timestamp;
+  {
+    auto guard = lock();
+    start_timestamp = get_data_unsafe().start_timestamp_;
+  }
+  auto now = Time::now();
+  if (stats_ != nullptr) {
+    stats_->on_query_completed(tl_constructor_, query_.size(), is_ok() ? answer_.size() : 0, is_error(),
+                               now - start_timestamp);
+  }
+  if (trace_id_ != 0) {
+    RequestTracer::add_span(trace_id_, trace_name_, start_timestamp, now);
+  }
+  if (MetricRegistry::is_enabled()) {
+    net_query_count_metric.add();
+    if (is_error()) {
+      net_query_error_count_metric.add();
+    } else {
+      net_query_received_bytes_metric.add(static_cast<int64>(answer_.size()));
+    }
+    net_query_sent_bytes_metric.add(static_cast<int64>(query_.size()));
+    net_query_duration_metric.observe(now - start_timestamp);
   }
 }
 
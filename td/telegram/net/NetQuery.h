@@ -10,6 +10,8 @@
 #include "td/telegram/net/NetQueryCounter.h"
 #include "td/telegram/net/NetQueryStats.h"
 
+#include "td/tl/TlArena.h"
+
 #include "td/actor/actor.h"
 #include "td/actor/SignalSlot.h"
 
@@ -233,6 +235,7 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
 
   void stop_track() {
     nq_counter_ = NetQueryCounter();
+    stats_ = nullptr;
     remove();
   }
 
@@ -243,6 +246,9 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
 
   void debug(string state, bool may_be_lost = false);
 
+  // must be called once, when the final result of the query is known
+  void on_completed();
+
   void set_callback(ActorShared<NetQueryCallback> callback) {
     callback_ = std::move(callback);
   }
@@ -271,6 +277,14 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
     return chain_ids_;
   }
 
+  uint32 get_trace_id() const {
+    return trace_id_;
+  }
+  void set_trace(uint32 trace_id, string trace_name) {
+    trace_id_ = trace_id;
+    trace_name_ = std::move(trace_name);
+  }
+
   void set_in_sequence_dispatcher(bool in_sequence_dispacher) {
     in_sequence_dispacher_ = in_sequence_dispacher;
   }
@@ -286,6 +300,7 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
   DcId dc_id_;
 
   NetQueryCounter nq_counter_;
+  NetQueryStats *stats_ = nullptr;
   Status status_;
   uint64 id_ = 0;
   BufferSlice query_;
@@ -299,6 +314,9 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
   bool may_be_lost_ = false;
   int8 priority_{0};
 
+  uint32 trace_id_ = 0;  // identifier of the traced request, which has created the query, see RequestTracer
+  string trace_name_;
+
   template <class T>
   struct movable_atomic final : public std::atomic<T> {
     movable_atomic() = default;
@@ -382,6 +400,7 @@ inline void cancel_query(NetQueryRef &ref) {
 template <class T>
 Result<typename T::ReturnType> fetch_result(const BufferSlice &message) {
   TlBufferParser parser(&message);
+  TlArena::Scope arena_scope;
   auto result = T::fetch_result(parser);
   parser.fetch_end();
 
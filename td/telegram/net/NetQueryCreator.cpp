@@ -11,14 +11,56 @@
 #include "td/telegram/Td.h"
 #include "td/telegram/telegram_api.h"
 
+#include "td/actor/RequestTracer.h"
+
 #include "td/utils/buffer.h"
-#include "td/utils/format.h"
 #include "td/utils/Gzip.h"
 #include "td/utils/logging.h"
-#include "td/utils/Storer.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/tl_storers.h"
 
 namespace td {
 
+static TD_THREAD_LOCAL BufferSlice *query_buffer_arena;  // static zero-initialized
+
+// small and medium queries are serialized in a single pass into slices of a per-thread chunk to avoid
+// a heap allocation and a separate length calculation per query
+static BufferSlice serialize_query(const telegram_api::Function &function) {
+  constexpr size_t MAX_ARENA_QUERY_SIZE = 4096;
+  constexpr size_t ARENA_CHUNK_SIZE = 1 << 16;
+
+  init_thread_local<BufferSlice>(query_buffer_arena);
+  auto &arena = *query_buffer_arena;
+  if (arena.empty()) {
+    arena = BufferSlice(ARENA_CHUNK_SIZE);
+  }
+  TlStorerBounded storer(arena.as_mutable_slice().ubegin(), min(arena.size(), MAX_ARENA_QUERY_SIZE));
+  function.store(storer);
+  auto size = storer.get_length();
+  if (!storer.is_complete()) {
+    if (size > MAX_ARENA_QUERY_SIZE) {
+      BufferSlice result(size);
+      TlStorerUnsafe storer_unsafe(result.as_mutable_slice().ubegin());
+      function.store(storer_unsafe);
+      CHECK(storer_unsafe.get_buf() == result.as_slice().uend());
+      return result;
+    }
+
+    // the query doesn't fit in the rest of the chunk
+    arena = BufferSlice(ARENA_CHUNK_SIZE);
+    TlStorerUnsafe storer_unsafe(arena.as_mutable_slice().ubegin());
+    function.store(storer_unsafe);
+    CHECK(storer_unsafe.get_buf() == arena.as_slice().ubegin() + size);
+  }
+
+  // chunk size is divisible by 8, so the aligned size never exceeds the size of the rest of the chunk
+  auto result = arena.from_slice(arena.as_slice().substr(0, size));
+  arena.confirm_read((size + 7) & -8);
+  return result;
+}
+
 NetQueryCreator::NetQueryCreator(std::shared_ptr<NetQueryStats> net_query_stats)
     : net_query_stats_(std::move(net_query_stats)) {
   object_pool_.set_check_empty(true);
@@ -32,11 +74,7 @@ NetQueryPtr NetQueryCreator::create(const telegram_api::Function &function, vect
 NetQueryPtr NetQueryCreator::create(uint64 id, const telegram_api::Function &function, vector<ChainId> &&chain_ids,
                                     DcId dc_id, NetQuery::Type type, NetQuery::AuthFlag auth_flag) {
   LOG(INFO) << "Create query " << to_string(function);
-  auto storer = DefaultStorer<telegram_api::Function>(function);
-  BufferSlice slice(storer.size());
-  auto real_size = storer.store(slice.as_mutable_slice().ubegin());
-  LOG_CHECK(real_size == slice.size()) << real_size << " " << slice.size() << " "
-                                       << format::as_hex_dump<4>(slice.as_slice());
+  BufferSlice slice = serialize_query(function);
 
   int32 tl_constructor = function.get_id();
 
@@ -79,6 +117,14 @@ NetQueryPtr NetQueryCreator::create(uint64 id, const telegram_api::Function &fun
       object_pool_.create(NetQuery::State::Query, id, std::move(slice), BufferSlice(), dc_id, type, auth_flag,
                           gzip_flag, tl_constructor, total_timeout_limit, net_query_stats_.get(), std::move(chain_ids));
   query->set_cancellation_token(query.generation());
+  if (unlikely(RequestTracer::is_enabled())) {
+    auto trace_id = RequestTracer::get_current_trace_id();
+    if (trace_id != 0) {
+      auto function_string = to_string(function);
+      auto function_name = Slice(function_string).substr(0, function_string.find(' '));
+      query->set_trace(trace_id, PSTRING() << "NetQuery " << function_name);
+    }
+  }
   return query;
 }
 
@@ -19,6 +19,8 @@
 #include "td/telegram/TdDb.h"
 #include "td/telegram/telegram_api.h"
 
+#include "td/actor/RequestTracer.h"
+
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
@@ -26,10 +28,22 @@
 #include "td/utils/port/sleep.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
+
+#include <cmath>
 
 namespace td {
 
+NetQueryDispatcher::QueryHandler NetQueryDispatcher::query_handler_;
+
+void NetQueryDispatcher::set_query_handler(QueryHandler query_handler) {
+  query_handler_ = std::move(query_handler);
+}
+
 void NetQueryDispatcher::complete_net_query(NetQueryPtr net_query) {
+  // the result is handled as a part of the request, which has created the query
+  RequestTracer::Guard trace_guard(net_query->get_trace_id());
+  net_query->on_completed();
   auto callback = net_query->move_callback();
   if (callback.empty()) {
     net_query->debug("sent to td (no callback)");
@@ -44,6 +58,7 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
   // net_query->debug("dispatch");
   if (stop_flag_.load(std::memory_order_relaxed)) {
     net_query->set_error(Global::request_aborted_error());
+    on_deduplicated_net_query_result(*net_query);
     return complete_net_query(std::move(net_query));
   }
   if (G()->get_option_boolean("test_flood_wait")) {
@@ -64,6 +79,12 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
     return;
   }
 
+  if (query_handler_ && !net_query->is_ready() && query_handler_(*net_query)) {
+    CHECK(net_query->is_ready());
+    net_query->debug("answered by query handler");
+    return complete_net_query(std::move(net_query));
+  }
+
   if (net_query->is_ready()) {
     if (net_query->is_error()) {
       auto code = net_query->error().code();
@@ -72,6 +93,9 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
       } else if (code == NetQuery::Resend) {
         net_query->resend();
       } else if (code < 0 || code == 500 || code == 420) {
+        if (code == 420) {
+          on_flood_wait(*net_query);
+        }
         net_query->debug("sent to NetQueryDelayer");
         return send_closure_later(delayer_, &NetQueryDelayer::delay, std::move(net_query));
       }
@@ -92,7 +116,22 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
     net_query->set_error(Status::Error(PSLICE() << "No such dc " << dest_dc_id));
   }
 
+  if (!net_query->is_ready()) {
+    auto flood_wait_delay = get_flood_wait_delay(*net_query, dest_dc_id);
+    if (flood_wait_delay > 0) {
+      // the query would be rejected by the server anyway, so delay it without sending
+      net_query->set_error(Status::Error(420, PSLICE() << "FLOOD_WAIT_" << flood_wait_delay));
+      net_query->debug("sent to NetQueryDelayer before sending");
+      return send_closure_later(delayer_, &NetQueryDelayer::delay, std::move(net_query));
+    }
+  }
+
+  if (!net_query->is_ready() && try_deduplicate_net_query(net_query, dest_dc_id)) {
+    return;
+  }
+
   if (net_query->is_ready()) {
+    on_deduplicated_net_query_result(*net_query);
     return complete_net_query(std::move(net_query));
   }
 
@@ -122,6 +161,134 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
   }
 }
 
+bool NetQueryDispatcher::is_deduplicable_query(int32 tl_constructor) {
+  switch (tl_constructor) {
+    case telegram_api::channels_getChannels::ID:
+    case telegram_api::channels_getFullChannel::ID:
+    case telegram_api::help_getConfig::ID:
+    case telegram_api::messages_getStickerSet::ID:
+    case telegram_api::users_getFullUser::ID:
+    case telegram_api::users_getUsers::ID:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool NetQueryDispatcher::try_deduplicate_net_query(NetQueryPtr &net_query, DcId dc_id) {
+  if (!net_query->get_chain_ids().empty() || !is_deduplicable_query(net_query->tl_constructor())) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(deduplication_mutex_);
+  if (deduplication_keys_.count(net_query->id()) != 0) {
+    // the query is resent
+    return false;
+  }
+  if (!G()->get_option_boolean("deduplicate_net_queries")) {
+    return false;
+  }
+
+  string key = PSTRING() << dc_id.get_raw_id() << ' ' << static_cast<int32>(net_query->type()) << ' '
+                         << static_cast<int32>(net_query->auth_flag()) << ' ';
+  key.append(net_query->query().as_slice().begin(), net_query->query().size());
+  auto &query = deduplicated_queries_[key];
+  if (query.leader_query_id == 0) {
+    query.leader_query_id = net_query->id();
+    deduplication_keys_.emplace(net_query->id(), std::move(key));
+    deduplicated_query_count_++;
+    return false;
+  }
+
+  net_query->debug(PSTRING() << "wait for result of identical query " << query.leader_query_id);
+  query.duplicates.push_back(std::move(net_query));
+  return true;
+}
+
+void NetQueryDispatcher::on_deduplicated_net_query_result(const NetQuery &net_query) {
+  if (deduplicated_query_count_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+
+  vector<NetQueryPtr> duplicates;
+  {
+    std::lock_guard<std::mutex> guard(deduplication_mutex_);
+    auto it = deduplication_keys_.find(net_query.id());
+    if (it == deduplication_keys_.end()) {
+      return;
+    }
+    auto query_it = deduplicated_queries_.find(it->second);
+    CHECK(query_it != deduplicated_queries_.end());
+    duplicates = std::move(query_it->second.duplicates);
+    deduplicated_queries_.erase(query_it);
+    deduplication_keys_.erase(it);
+    deduplicated_query_count_--;
+  }
+
+  for (auto &duplicate : duplicates) {
+    if (net_query.is_ok()) {
+      duplicate->set_ok(net_query.ok().copy());
+    } else if (net_query.error().code() == NetQuery::Canceled) {
+      // the first of the duplicates becomes the new leader
+      dispatch(std::move(duplicate));
+      continue;
+    } else {
+      duplicate->set_error(net_query.error().clone());
+    }
+    complete_net_query(std::move(duplicate));
+  }
+}
+
+uint64 NetQueryDispatcher::get_flood_wait_key(DcId dc_id, int32 tl_constructor) {
+  return (static_cast<uint64>(dc_id.get_raw_id()) << 32) | static_cast<uint32>(tl_constructor);
+}
+
+void NetQueryDispatcher::on_flood_wait(const NetQuery &net_query) {
+  // chained queries are sent to a specific chat and can have chat-specific flood limits
+  if (!net_query.get_chain_ids().empty()) {
+    return;
+  }
+  Slice prefix("FLOOD_WAIT_");
+  auto error_message = net_query.error().message();
+  if (!begins_with(error_message, prefix)) {
+    return;
+  }
+  auto timeout = to_integer<int32>(error_message.substr(prefix.size()));
+  if (timeout <= 0) {
+    return;
+  }
+
+  auto dc_id = net_query.dc_id();
+  if (dc_id.is_main()) {
+    dc_id = get_main_dc_id();
+  }
+  auto until = Time::now() + clamp(timeout, 1, 14 * 24 * 60 * 60);
+  std::lock_guard<std::mutex> guard(flood_wait_mutex_);
+  auto &flood_wait_until = flood_wait_until_[get_flood_wait_key(dc_id, net_query.tl_constructor())];
+  flood_wait_until = max(flood_wait_until, until);
+}
+
+int32 NetQueryDispatcher::get_flood_wait_delay(const NetQuery &net_query, DcId dc_id) {
+  if (!net_query.get_chain_ids().empty()) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> guard(flood_wait_mutex_);
+  if (flood_wait_until_.empty()) {
+    return 0;
+  }
+  auto it = flood_wait_until_.find(get_flood_wait_key(dc_id, net_query.tl_constructor()));
+  if (it == flood_wait_until_.end()) {
+    return 0;
+  }
+  auto now = Time::now();
+  if (it->second <= now) {
+    flood_wait_until_.erase(it);
+    return 0;
+  }
+  return static_cast<int32>(std::ceil(it->second - now));
+}
+
 Status NetQueryDispatcher::wait_dc_init(DcId dc_id, bool force) {
   // TODO: optimize
   if (!dc_id.is_exact()) {
@@ -167,22 +334,23 @@ Status NetQueryDispatcher::wait_dc_init(DcId dc_id, bool force) {
     int32 slow_net_scheduler_id = G()->get_slow_net_scheduler_id();
 
     auto raw_dc_id = dc_id.get_raw_id();
-    bool is_premium = G()->get_option_boolean("is_premium");
+    bool is_premium = G()->get_option_boolean(OptionId::IsPremium);
     int32 upload_session_count = (raw_dc_id != 2 && raw_dc_id != 4) || is_premium ? 8 : 4;
     int32 download_session_count = is_premium ? 8 : 2;
     int32 download_small_session_count = is_premium ? 8 : 2;
-    dc.main_session_ = create_actor<SessionMultiProxy>(PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":main",
-                                                       session_count, auth_data, true, raw_dc_id == main_dc_id_,
-                                                       use_pfs, false, false, is_cdn, need_destroy_key);
+    dc.main_session_ = create_actor<SessionMultiProxy>(
+        PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":main", session_count, get_max_session_count(), auth_data,
+        true, raw_dc_id == main_dc_id_, use_pfs, false, false, is_cdn, need_destroy_key);
     dc.upload_session_ = create_actor_on_scheduler<SessionMultiProxy>(
         PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":upload", slow_net_scheduler_id, upload_session_count,
-        auth_data, false, false, use_pfs, false, true, is_cdn, need_destroy_key);
+        upload_session_count, auth_data, false, false, use_pfs, false, true, is_cdn, need_destroy_key);
     dc.download_session_ = create_actor_on_scheduler<SessionMultiProxy>(
         PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":download", slow_net_scheduler_id, download_session_count,
-        auth_data, false, false, use_pfs, true, true, is_cdn, need_destroy_key);
+        download_session_count, auth_data, false, false, use_pfs, true, true, is_cdn, need_destroy_key);
     dc.download_small_session_ = create_actor_on_scheduler<SessionMultiProxy>(
         PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":download_small", slow_net_scheduler_id,
-        download_small_session_count, auth_data, false, false, use_pfs, true, true, is_cdn, need_destroy_key);
+        download_small_session_count, download_small_session_count, auth_data, false, false, use_pfs, true, true,
+        is_cdn, need_destroy_key);
     dc.is_inited_ = true;
     if (dc_id.is_internal()) {
       send_closure_later(dc_auth_manager_, &DcAuthManager::add_dc, std::move(auth_data));
@@ -224,10 +392,12 @@ void NetQueryDispatcher::stop() {
 void NetQueryDispatcher::update_session_count() {
   std::lock_guard<std::mutex> guard(main_dc_id_mutex_);
   int32 session_count = get_session_count();
+  int32 max_session_count = get_max_session_count();
   bool use_pfs = get_use_pfs();
   for (size_t i = 1; i < MAX_DC_COUNT; i++) {
     if (is_dc_inited(narrow_cast<int32>(i))) {
-      send_closure_later(dcs_[i - 1].main_session_, &SessionMultiProxy::update_options, session_count, use_pfs);
+      send_closure_later(dcs_[i - 1].main_session_, &SessionMultiProxy::update_options, session_count,
+                         max_session_count, use_pfs);
       send_closure_later(dcs_[i - 1].upload_session_, &SessionMultiProxy::update_use_pfs, use_pfs);
       send_closure_later(dcs_[i - 1].download_session_, &SessionMultiProxy::update_use_pfs, use_pfs);
       send_closure_later(dcs_[i - 1].download_small_session_, &SessionMultiProxy::update_use_pfs, use_pfs);
@@ -277,7 +447,13 @@ bool NetQueryDispatcher::is_dc_inited(int32 raw_dc_id) {
 }
 
 int32 NetQueryDispatcher::get_session_count() {
-  return max(narrow_cast<int32>(G()->get_option_integer("session_count")), 1);
+  return max(narrow_cast<int32>(G()->get_option_integer(OptionId::SessionCount)), 1);
+}
+
+int32 NetQueryDispatcher::get_max_session_count() {
+  auto session_count = get_session_count();
+  auto max_session_count = narrow_cast<int32>(G()->get_option_integer("max_session_count", session_count + 3));
+  return clamp(max_session_count, session_count, 100);
 }
 
 bool NetQueryDispatcher::get_use_pfs() {
@@ -292,7 +468,7 @@ NetQueryDispatcher::NetQueryDispatcher(const std::function<ActorShared<>()> &cre
   LOG(INFO) << tag("main_dc_id", main_dc_id_.load(std::memory_order_relaxed));
   delayer_ = create_actor<NetQueryDelayer>("NetQueryDelayer", create_reference());
   dc_auth_manager_ = create_actor<DcAuthManager>("DcAuthManager", create_reference());
-  common_public_rsa_key_ = std::make_shared<PublicRsaKeyShared>(DcId::empty(), G()->is_test_dc());
+  common_public_rsa_key_ = PublicRsaKeyShared::get_common(G()->is_test_dc());
   public_rsa_key_watchdog_ = create_actor<PublicRsaKeyWatchdog>("PublicRsaKeyWatchdog", create_reference());
   sequence_dispatcher_ = MultiSequenceDispatcher::create("MultiSequenceDispatcher");
 
@@ -12,6 +12,7 @@
 #include "td/actor/actor.h"
 
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/Promise.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Status.h"
@@ -58,7 +59,16 @@ class NetQueryDispatcher {
   void set_main_dc_id(int32 new_main_dc_id);
   void check_authorization_is_ok();
 
+  // the handler is called for every query before it is sent to the server
+  // it must return true if it has set the result of the query, or false if the query must be sent to the server
+  // it can be called simultaneously from different threads and must be set before any client is created
+  // is supposed to be used only by tests and benchmarks to work without the network
+  using QueryHandler = std::function<bool(NetQuery &net_query)>;
+  static void set_query_handler(QueryHandler query_handler);
+
  private:
+  static QueryHandler query_handler_;
+
   std::atomic<bool> stop_flag_{false};
   bool need_destroy_auth_key_{false};
   ActorOwn<NetQueryDelayer> delayer_;
@@ -86,15 +96,42 @@ class NetQueryDispatcher {
   std::mutex main_dc_id_mutex_;
   std::shared_ptr<Guard> td_guard_;
 
+  // identical read-only queries, which are sent while the first of them is being executed, wait for its result
+  struct DeduplicatedQuery {
+    uint64 leader_query_id = 0;
+    vector<NetQueryPtr> duplicates;
+  };
+  std::mutex deduplication_mutex_;
+  std::atomic<size_t> deduplicated_query_count_{0};
+  FlatHashMap<string, DeduplicatedQuery> deduplicated_queries_;
+  FlatHashMap<uint64, string> deduplication_keys_;
+
+  // the time until which the server is known to reject queries with FLOOD_WAIT by DC and TL constructor
+  std::mutex flood_wait_mutex_;
+  FlatHashMap<uint64, double> flood_wait_until_;
+
   Status wait_dc_init(DcId dc_id, bool force);
   bool is_dc_inited(int32 raw_dc_id);
 
   static int32 get_session_count();
+  static int32 get_max_session_count();
   static bool get_use_pfs();
 
   static void complete_net_query(NetQueryPtr net_query);
 
   void try_fix_migrate(NetQueryPtr &net_query);
+
+  static bool is_deduplicable_query(int32 tl_constructor);
+
+  bool try_deduplicate_net_query(NetQueryPtr &net_query, DcId dc_id);
+
+  void on_deduplicated_net_query_result(const NetQuery &net_query);
+
+  static uint64 get_flood_wait_key(DcId dc_id, int32 tl_constructor);
+
+  void on_flood_wait(const NetQuery &net_query);
+
+  int32 get_flood_wait_delay(const NetQuery &net_query, DcId dc_id);
 };
 
 }  // namespace td
@@ -14,6 +14,9 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace td {
 
 uint64 NetQueryStats::get_count() const {
@@ -29,28 +32,109 @@ void NetQueryStats::dump_pending_network_queries() {
   }
   decltype(n) i = 0;
   bool was_gap = false;
-  auto &net_query_list = list_;
-  auto guard = net_query_list.lock();
-  for (auto begin = net_query_list.begin(), cur = net_query_list.end(); cur != begin; i++) {
-    cur = cur->get_prev();
-    if (i < 20 || i + 20 > n || i % (n / 20 + 1) == 0) {
-      if (was_gap) {
-        LOG(WARNING) << "...";
-        was_gap = false;
+  for (auto &net_query_list : lists_) {
+    auto guard = net_query_list.lock();
+    for (auto begin = net_query_list.begin(), cur = net_query_list.end(); cur != begin; i++) {
+      cur = cur->get_prev();
+      if (i < 20 || i + 20 > n || i % (n / 20 + 1) == 0) {
+        if (was_gap) {
+          LOG(WARNING) << "...";
+          was_gap = false;
+        }
+        const NetQueryDebug &debug = cur->get_data_unsafe();
+        const NetQuery &nq = *static_cast<const NetQuery *>(cur);
+        LOG(WARNING) << tag("user", lpad(PSTRING() << debug.my_id_, 10, ' ')) << nq
+                     << tag("total flood", format::as_time(nq.total_timeout_))
+                     << tag("since start", format::as_time(Time::now_cached() - debug.start_timestamp_))
+                     << tag("state", debug.state_)
+                     << tag("in this state", format::as_time(Time::now_cached() - debug.state_timestamp_))
+                     << tag("state changed", debug.state_change_count_) << tag("resend count", debug.resend_count_)
+                     << tag("fail count", debug.send_failed_count_) << tag("ack state", debug.ack_state_)
+                     << tag("unknown", debug.unknown_state_);
+      } else {
+        was_gap = true;
       }
-      const NetQueryDebug &debug = cur->get_data_unsafe();
-      const NetQuery &nq = *static_cast<const NetQuery *>(cur);
-      LOG(WARNING) << tag("user", lpad(PSTRING() << debug.my_id_, 10, ' ')) << nq
-                   << tag("total flood", format::as_time(nq.total_timeout_))
-                   << tag("since start", format::as_time(Time::now_cached() - debug.start_timestamp_))
-                   << tag("state", debug.state_)
-                   << tag("in this state", format::as_time(Time::now_cached() - debug.state_timestamp_))
-                   << tag("state changed", debug.state_change_count_) << tag("resend count", debug.resend_count_)
-                   << tag("fail count", debug.send_failed_count_) << tag("ack state", debug.ack_state_)
-                   << tag("unknown", debug.unknown_state_);
-    } else {
-      was_gap = true;
     }
   }
 }
+
+void NetQueryStats::on_query_completed(int32 tl_constructor, size_t sent_bytes, size_t received_bytes, bool is_error,
+                                       double latency) {
+  size_t pos = 0;
+  double max_latency = 1e-3;
+  while (pos + 1 < LATENCY_HISTOGRAM_SIZE && latency >= max_latency) {
+    pos++;
+    max_latency *= 2;
+  }
+
+  auto &statistics = statistics_.get();
+  std::lock_guard<std::mutex> lock(statistics.mutex);
+  auto &entry = statistics.entries[tl_constructor];
+  entry.query_count++;
+  if (is_error) {
+    entry.error_count++;
+  }
+  entry.sent_bytes += sent_bytes;
+  entry.received_bytes += received_bytes;
+  entry.latency[pos]++;
+}
+
+double NetQueryStats::get_latency_percentile(const std::array<uint64, LATENCY_HISTOGRAM_SIZE> &histogram,
+                                             uint64 total_count, double percentile) {
+  // returns the upper bound of the histogram bucket containing the percentile
+  auto rank = static_cast<uint64>(std::ceil(static_cast<double>(total_count) * percentile));
+  uint64 count = 0;
+  double max_latency = 1e-3;
+  for (size_t i = 0; i < LATENCY_HISTOGRAM_SIZE; i++) {
+    count += histogram[i];
+    if (count >= rank) {
+      return max_latency;
+    }
+    max_latency *= 2;
+  }
+  return max_latency;
+}
+
+vector<NetQueryStats::ConstructorStatistics> NetQueryStats::get_statistics() {
+  FlatHashMap<int32, Entry> entries;
+  statistics_.for_each([&entries](ThreadStatistics &statistics) {
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    for (auto &it : statistics.entries) {
+      auto &entry = entries[it.first];
+      entry.query_count += it.second.query_count;
+      entry.error_count += it.second.error_count;
+      entry.sent_bytes += it.second.sent_bytes;
+      entry.received_bytes += it.second.received_bytes;
+      for (size_t i = 0; i < LATENCY_HISTOGRAM_SIZE; i++) {
+        entry.latency[i] += it.second.latency[i];
+      }
+    }
+  });
+
+  vector<ConstructorStatistics> result;
+  result.reserve(entries.size());
+  for (auto &it : entries) {
+    ConstructorStatistics statistics;
+    statistics.tl_constructor = it.first;
+    statistics.query_count = it.second.query_count;
+    statistics.error_count = it.second.error_count;
+    statistics.sent_bytes = it.second.sent_bytes;
+    statistics.received_bytes = it.second.received_bytes;
+    statistics.latency_p50 = get_latency_percentile(it.second.latency, it.second.query_count, 0.5);
+    statistics.latency_p99 = get_latency_percentile(it.second.latency, it.second.query_count, 0.99);
+    result.push_back(statistics);
+  }
+  std::sort(result.begin(), result.end(), [](const ConstructorStatistics &lhs, const ConstructorStatistics &rhs) {
+    return lhs.query_count > rhs.query_count;
+  });
+  return result;
+}
+
+void NetQueryStats::clear_statistics() {
+  statistics_.for_each([](ThreadStatistics &statistics) {
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    statistics.entries.clear();
+  });
+}
+
 }  // namespace td
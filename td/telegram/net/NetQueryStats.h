@@ -9,9 +9,13 @@
 #include "td/telegram/net/NetQueryCounter.h"
 
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/ThreadLocalStorage.h"
 #include "td/utils/TsList.h"
 
+#include <array>
 #include <atomic>
+#include <mutex>
 
 namespace td {
 
@@ -29,9 +33,19 @@ struct NetQueryDebug {
 
 class NetQueryStats {
  public:
-  NetQueryCounter register_query(TsListNode<NetQueryDebug> *query) {
+  struct ConstructorStatistics {
+    int32 tl_constructor = 0;
+    uint64 query_count = 0;
+    uint64 error_count = 0;
+    uint64 sent_bytes = 0;
+    uint64 received_bytes = 0;
+    double latency_p50 = 0.0;
+    double latency_p99 = 0.0;
+  };
+
+  NetQueryCounter register_query(TsListNode<NetQueryDebug> *query, uint64 query_id) {
     if (use_list_.load(std::memory_order_relaxed)) {
-      list_.put(query);
+      lists_[query_id % LIST_COUNT].put(query);
     }
     return NetQueryCounter(&count_);
   }
@@ -40,10 +54,41 @@ class NetQueryStats {
 
   void dump_pending_network_queries();
 
+  void on_query_completed(int32 tl_constructor, size_t sent_bytes, size_t received_bytes, bool is_error,
+                          double latency);
+
+  // returns statistics sorted by the number of queries in decreasing order
+  vector<ConstructorStatistics> get_statistics();
+
+  void clear_statistics();
+
  private:
+  // live queries are spread between several lists to reduce contention on their mutexes
+  static constexpr size_t LIST_COUNT = 16;
+
+  // i-th element contains number of queries with latency in [2^(i-1), 2^i) milliseconds
+  static constexpr size_t LATENCY_HISTOGRAM_SIZE = 24;
+
+  struct Entry {
+    uint64 query_count = 0;
+    uint64 error_count = 0;
+    uint64 sent_bytes = 0;
+    uint64 received_bytes = 0;
+    std::array<uint64, LATENCY_HISTOGRAM_SIZE> latency{};
+  };
+
+  struct ThreadStatistics {
+    std::mutex mutex;
+    FlatHashMap<int32, Entry> entries;
+  };
+
   NetQueryCounter::Counter count_{0};
   std::atomic<bool> use_list_{true};
-  TsList<NetQueryDebug> list_;
+  std::array<TsList<NetQueryDebug>, LIST_COUNT> lists_;
+  ThreadLocalStorage<ThreadStatistics> statistics_;
+
+  static double get_latency_percentile(const std::array<uint64, LATENCY_HISTOGRAM_SIZE> &histogram,
+                                       uint64 total_count, double percentile);
 };
 
 }  // namespace td
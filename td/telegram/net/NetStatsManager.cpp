@@ -17,6 +17,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
 
 namespace td {
@@ -44,25 +45,8 @@ static void parse(NetStatsData &net_stats, ParserT &parser) {
 
 void NetStatsManager::init() {
   LOG_CHECK(!empty()) << G()->close_flag();
-  class NetStatsInternalCallback final : public NetStats::Callback {
-   public:
-    NetStatsInternalCallback(ActorId<NetStatsManager> parent, size_t id) : parent_(std::move(parent)), id_(id) {
-    }
-
-   private:
-    ActorId<NetStatsManager> parent_;
-    size_t id_;
-    void on_stats_updated() final {
-      send_closure(parent_, &NetStatsManager::on_stats_updated, id_);
-    }
-  };
-
   for_each_stat([&](NetStatsInfo &stat, size_t id, CSlice name, FileType file_type) {
-    auto main_file_type = get_main_file_type(file_type);
-    id += static_cast<size_t>(main_file_type) - static_cast<size_t>(file_type);
-
     stat.key = "net_stats_" + name.str();
-    stat.stats.set_callback(make_unique<NetStatsInternalCallback>(actor_id(this), id));
   });
 }
 
@@ -71,7 +55,7 @@ void NetStatsManager::get_network_stats(bool current, Promise<NetworkStats> prom
 
   result.since = current ? since_current_ : since_total_;
 
-  for_each_stat([&](NetStatsInfo &info, size_t id, CSlice name, FileType file_type) { update(info, false); });
+  for_each_stat([&](NetStatsInfo &info, size_t id, CSlice name, FileType file_type) { update(info); });
 
   for (size_t net_type_i = 0; net_type_i < net_type_size(); net_type_i++) {
     auto net_type = NetType(net_type_i);
@@ -212,7 +196,7 @@ void NetStatsManager::start_up() {
   auto since_str = G()->td_db()->get_binlog_pmc()->get("net_stats_since");
   if (!since_str.empty()) {
     auto since = to_integer<int32>(since_str);
-    auto authorization_date = G()->get_option_integer("authorization_date");
+    auto authorization_date = G()->get_option_integer(OptionId::AuthorizationDate);
     if (unix_time < since) {
       since_total_ = unix_time;
       G()->td_db()->get_binlog_pmc()->set("net_stats_since", to_string(since_total_));
@@ -242,6 +226,20 @@ void NetStatsManager::start_up() {
     ActorId<NetStatsManager> net_stats_manager_;
   };
   send_closure(G()->state_manager(), &StateManager::add_callback, make_unique<NetCallback>(actor_id(this)));
+
+  set_timeout_in(SAVE_STATS_PERIOD);
+}
+
+void NetStatsManager::timeout_expired() {
+  for_each_stat(
+      [&](NetStatsInfo &info, size_t id, CSlice name, FileType file_type) { save_dirty_stats(info, false); });
+  set_timeout_in(SAVE_STATS_PERIOD);
+}
+
+void NetStatsManager::hangup() {
+  for_each_stat(
+      [&](NetStatsInfo &info, size_t id, CSlice name, FileType file_type) { save_dirty_stats(info, false); });
+  stop();
 }
 
 std::shared_ptr<NetStatsCallback> NetStatsManager::get_common_stats_callback() const {
@@ -263,7 +261,7 @@ std::vector<std::shared_ptr<NetStatsCallback>> NetStatsManager::get_file_stats_c
   return result;
 }
 
-void NetStatsManager::update(NetStatsInfo &info, bool force_save) {
+void NetStatsManager::update(NetStatsInfo &info) {
   if (info.net_type == NetType::None) {
     return;
   }
@@ -273,13 +271,27 @@ void NetStatsManager::update(NetStatsInfo &info, bool force_save) {
   auto net_type_i = static_cast<size_t>(info.net_type);
   auto &type_stats = info.stats_by_type[net_type_i];
 
+  auto now = Time::now();
+  if (diff.packet_count != 0 && info.last_sync_time != 0 && now > info.last_sync_time) {
+    LOG(INFO) << "Sent " << static_cast<double>(diff.packet_count) / (now - info.last_sync_time)
+              << " packets per second with " << diff.packet_size / diff.packet_count << " bytes per container for "
+              << info.key;
+  }
+  info.last_sync_time = now;
   info.last_sync_stats = current_stats;
 
-  auto mem_stats = type_stats.mem_stats + diff;
-  type_stats.mem_stats = mem_stats;
+  type_stats.mem_stats = type_stats.mem_stats + diff;
   type_stats.dirty_size += diff.read_size + diff.write_size;
+}
 
-  if (type_stats.dirty_size < 1000 && !force_save) {
+void NetStatsManager::save_dirty_stats(NetStatsInfo &info, bool force_save) {
+  if (info.net_type == NetType::None) {
+    return;
+  }
+  update(info);
+
+  auto &type_stats = info.stats_by_type[static_cast<size_t>(info.net_type)];
+  if (type_stats.dirty_size == 0 && !force_save) {
     return;
   }
 
@@ -303,27 +315,6 @@ void NetStatsManager::save_stats(NetStatsInfo &info, NetType net_type) {
   G()->td_db()->get_binlog_pmc()->set(key, log_event_store(stats).as_slice().str());
 }
 
-void NetStatsManager::info_loop(NetStatsInfo &info) {
-  if (info.net_type == NetType::None) {
-    return;
-  }
-  auto mem_stats = info.stats.get_stats();
-  auto diff = mem_stats - info.last_sync_stats;
-  auto size = diff.read_size + diff.write_size;
-  if (size < 1000) {
-    return;
-  }
-  update(info, false);
-}
-
-void NetStatsManager::on_stats_updated(size_t id) {
-  for_each_stat([&](NetStatsInfo &stat, size_t stat_id, CSlice name, FileType) {
-    if (stat_id == id) {
-      info_loop(stat);
-    }
-  });
-}
-
 void NetStatsManager::on_net_type_updated(NetType net_type) {
   if (net_type == NetType::Unknown) {
     net_type = NetType::None;
@@ -333,7 +324,7 @@ void NetStatsManager::on_net_type_updated(NetType net_type) {
       return;
     }
     if (info.net_type != NetType::None) {
-      update(info, true);
+      save_dirty_stats(info, true);
     }
     info.net_type = net_type;
   };
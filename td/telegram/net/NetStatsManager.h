@@ -102,6 +102,7 @@ class NetStatsManager final : public Actor {
     string key;
     NetStats stats;
     NetStatsData last_sync_stats;
+    double last_sync_time = 0;
     NetType net_type = NetType::None;
 
     struct TypeStats {
@@ -134,13 +135,18 @@ class NetStatsManager final : public Actor {
 
   static void add_network_stats_impl(NetStatsInfo &info, const NetworkStatsEntry &entry);
 
+  // network statistics are aggregated from the counters only when requested and are saved to the database
+  // no more often than once in SAVE_STATS_PERIOD, on network type change and on close
+  static constexpr double SAVE_STATS_PERIOD = 60.0;
+
   void start_up() final;
+  void timeout_expired() final;
+  void hangup() final;
 
-  static void update(NetStatsInfo &info, bool force_save);
+  static void update(NetStatsInfo &info);
+  static void save_dirty_stats(NetStatsInfo &info, bool force_save);
   static void save_stats(NetStatsInfo &info, NetType net_type);
-  static void info_loop(NetStatsInfo &info);
 
-  void on_stats_updated(size_t id);
   void on_net_type_updated(NetType net_type);
 };
 
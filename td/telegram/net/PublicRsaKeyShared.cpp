@@ -54,6 +54,12 @@ PublicRsaKeyShared::PublicRsaKeyShared(DcId dc_id, bool is_test) : dc_id_(dc_id)
       "-----END RSA PUBLIC KEY-----");
 }
 
+std::shared_ptr<PublicRsaKeyShared> PublicRsaKeyShared::get_common(bool is_test) {
+  static auto production_key = std::make_shared<PublicRsaKeyShared>(DcId::empty(), false);
+  static auto test_key = std::make_shared<PublicRsaKeyShared>(DcId::empty(), true);
+  return is_test ? test_key : production_key;
+}
+
 void PublicRsaKeyShared::add_rsa(mtproto::RSA rsa) {
   auto lock = rw_mutex_.lock_write();
   auto fingerprint = rsa.get_fingerprint();
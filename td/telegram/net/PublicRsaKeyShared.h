@@ -14,12 +14,17 @@
 #include "td/utils/port/RwMutex.h"
 #include "td/utils/Status.h"
 
+#include <memory>
+
 namespace td {
 
 class PublicRsaKeyShared final : public mtproto::PublicRsaKeyInterface {
  public:
   PublicRsaKeyShared(DcId dc_id, bool is_test);
 
+  // returns the process-wide instance with built-in keys, which are never changed
+  static std::shared_ptr<PublicRsaKeyShared> get_common(bool is_test);
+
   class Listener {
    public:
     Listener() = default;
@@ -46,7 +51,7 @@ class PublicRsaKeyShared final : public mtproto::PublicRsaKeyInterface {
   DcId dc_id_;
   std::vector<RsaKey> keys_;
   std::vector<unique_ptr<Listener>> listeners_;
-  RwMutex rw_mutex_;
+  RwMutex rw_mutex_{"PublicRsaKeyShared"};
 
   RsaKey *get_rsa_key_unsafe(int64 fingerprint);
 
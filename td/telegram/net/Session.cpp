@@ -27,6 +27,7 @@
 #include "td/mtproto/TransportType.h"
 
 #include "td/actor/PromiseFuture.h"
+#include "td/actor/RequestTracer.h"
 
 #include "td/utils/algorithm.h"
 #include "td/utils/as.h"
@@ -888,6 +889,10 @@ Status Session::on_message_result_ok(uint64 message_id, BufferSlice packet, size
   auth_data_.on_api_response();
   Query *query_ptr = &it->second;
   VLOG(net_query) << "Return query result " << query_ptr->query;
+  on_query_latency(Time::now() - query_ptr->sent_at_);
+  if (query_ptr->query->get_trace_id() != 0) {
+    RequestTracer::add_span(query_ptr->query->get_trace_id(), "Server response", query_ptr->sent_at_, Time::now());
+  }
 
   if (!parser.get_error()) {
     // Steal authorization information.
@@ -913,6 +918,59 @@ Status Session::on_message_result_ok(uint64 message_id, BufferSlice packet, size
   return Status::OK();
 }
 
+size_t Session::get_inflight_query_limit() const {
+  return static_cast<size_t>(inflight_query_limit_);
+}
+
+void Session::on_query_latency(double latency) {
+  if (latency < 0) {
+    return;
+  }
+  if (min_query_latency_ == 0 || latency < min_query_latency_) {
+    min_query_latency_ = latency;
+  }
+  query_latency_ = query_latency_ == 0 ? latency : query_latency_ * 0.9 + latency * 0.1;
+
+  if (query_latency_ > min_query_latency_ * MAX_QUERY_LATENCY_FACTOR + 1.0) {
+    // the queries are queued somewhere on the way to the server
+    return decrease_inflight_query_limit("high latency");
+  }
+  if (sent_queries_.size() + 1 >= get_inflight_query_limit() &&
+      inflight_query_limit_ < static_cast<double>(MAX_INFLIGHT_QUERIES)) {
+    inflight_query_limit_ += INFLIGHT_QUERY_LIMIT_INCREASE / inflight_query_limit_;
+    if (inflight_query_limit_ > static_cast<double>(MAX_INFLIGHT_QUERIES)) {
+      inflight_query_limit_ = static_cast<double>(MAX_INFLIGHT_QUERIES);
+    }
+    on_inflight_query_limit_changed();
+  }
+}
+
+void Session::decrease_inflight_query_limit(Slice reason) {
+  auto now = Time::now();
+  // decrease the limit at most once per query latency
+  if (now < last_inflight_query_limit_decrease_at_ + max(query_latency_, 1.0)) {
+    return;
+  }
+  last_inflight_query_limit_decrease_at_ = now;
+
+  inflight_query_limit_ *= INFLIGHT_QUERY_LIMIT_DECREASE;
+  if (inflight_query_limit_ < static_cast<double>(MIN_INFLIGHT_QUERIES)) {
+    inflight_query_limit_ = static_cast<double>(MIN_INFLIGHT_QUERIES);
+  }
+  // the latency is expected to return to the normal value after the decrease
+  query_latency_ = min_query_latency_;
+  LOG(INFO) << "Decrease in-flight query limit to " << get_inflight_query_limit() << " because of " << reason;
+  on_inflight_query_limit_changed();
+}
+
+void Session::on_inflight_query_limit_changed() {
+  auto inflight_query_limit = get_inflight_query_limit();
+  if (inflight_query_limit != reported_inflight_query_limit_) {
+    reported_inflight_query_limit_ = inflight_query_limit;
+    callback_->on_inflight_query_limit_updated(inflight_query_limit);
+  }
+}
+
 void Session::on_message_result_error(uint64 message_id, int error_code, string message) {
   if (!check_utf8(message)) {
     LOG(ERROR) << "Receive invalid error message \"" << message << '"';
@@ -988,6 +1046,12 @@ void Session::on_message_result_error(uint64 message_id, int error_code, string
 
   Query *query_ptr = &it->second;
   VLOG(net_query) << "Return query error " << query_ptr->query;
+  if (query_ptr->query->get_trace_id() != 0) {
+    RequestTracer::add_span(query_ptr->query->get_trace_id(), "Server error", query_ptr->sent_at_, Time::now());
+  }
+  if (error_code == 420) {
+    decrease_inflight_query_limit(message);
+  }
 
   cleanup_container(message_id, query_ptr);
   mark_as_known(message_id, query_ptr);
@@ -1060,6 +1124,7 @@ void Session::on_message_info(uint64 message_id, int32 state, uint64 answer_mess
       case 1:
       case 2:
       case 3:
+        decrease_inflight_query_limit("lost message");
         return on_message_failed(message_id,
                                  Status::Error("Message wasn't received by the server and must be re-sent"));
       case 0:
@@ -1237,6 +1302,56 @@ void Session::connection_check_mode(ConnectionInfo *info) {
   }
 }
 
+void Session::connection_check_quality(ConnectionInfo *info, double now) {
+  if (close_flag_ || info->state_ != ConnectionInfo::State::Ready || mode_ != Mode::Tcp || !connection_online_flag_) {
+    return;
+  }
+  if (info->created_at_ + MIN_FAILOVER_CONNECTION_AGE > now || last_failover_at_ + FAILOVER_COOLDOWN > now) {
+    return;
+  }
+  if (!info->connection_->is_degraded()) {
+    return;
+  }
+  if (cached_connection_ == nullptr) {
+    if (!is_standby_connection_requested_) {
+      VLOG(dc) << "Request standby connection";
+      is_standby_connection_requested_ = true;
+      standby_connection_cancellation_token_source_ = CancellationTokenSource{};
+      callback_->request_raw_connection(
+          nullptr, PromiseCreator::cancellable_lambda(
+                       standby_connection_cancellation_token_source_.get_cancellation_token(),
+                       [actor_id = actor_id(this)](Result<unique_ptr<mtproto::RawConnection>> r_raw_connection) {
+                         send_closure(actor_id, &Session::on_standby_connection, std::move(r_raw_connection));
+                       }));
+    }
+    return;
+  }
+
+  LOG(WARNING) << "Switch to standby connection, because the current connection is degraded with smoothed RTT "
+               << info->connection_->get_smoothed_rtt() << " and ping loss rate "
+               << info->connection_->get_ping_loss_rate();
+  last_failover_at_ = now;
+  connection_close(info);
+}
+
+void Session::on_standby_connection(Result<unique_ptr<mtproto::RawConnection>> r_raw_connection) {
+  is_standby_connection_requested_ = false;
+  if (close_flag_) {
+    return;
+  }
+  if (r_raw_connection.is_error()) {
+    LOG(INFO) << "Failed to open standby connection: " << r_raw_connection.error();
+    return;
+  }
+  auto raw_connection = r_raw_connection.move_as_ok();
+  if (raw_connection->extra().extra != network_generation_) {
+    VLOG(dc) << "Ignore standby connection with old network_generation";
+    return;
+  }
+  connection_add(std::move(raw_connection));
+  yield();
+}
+
 void Session::connection_open_finish(ConnectionInfo *info,
                                      Result<unique_ptr<mtproto::RawConnection>> r_raw_connection) {
   if (close_flag_ || info->state_ != ConnectionInfo::State::Connecting) {
@@ -1528,6 +1643,7 @@ void Session::loop() {
 
   connection_check_mode(&main_connection_);
   connection_check_mode(&long_poll_connection_);
+  connection_check_quality(&main_connection_, now);
   if (mode_ == Mode::Http) {
     if (long_poll_connection_.state_ == ConnectionInfo::State::Ready) {
       connection_flush(&long_poll_connection_);
@@ -1545,7 +1661,8 @@ void Session::loop() {
     while (main_connection_.state_ == ConnectionInfo::State::Ready) {
       if (auth_data_.is_ready(now)) {
         if (need_send_query()) {
-          while (!pending_queries_.empty() && sent_queries_.size() < MAX_INFLIGHT_QUERIES) {
+          auto inflight_query_limit = get_inflight_query_limit();
+          while (!pending_queries_.empty() && sent_queries_.size() < inflight_query_limit) {
             auto query = pending_queries_.pop();
             connection_send_query(&main_connection_, std::move(query));
             need_flush = true;
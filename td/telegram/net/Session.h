@@ -25,6 +25,7 @@
 #include "td/utils/FlatHashSet.h"
 #include "td/utils/List.h"
 #include "td/utils/Promise.h"
+#include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/VectorQueue.h"
@@ -64,6 +65,7 @@ class Session final
     virtual void on_server_salt_updated(vector<mtproto::ServerSalt> server_salts) = 0;
     virtual void on_update(BufferSlice &&update, uint64 auth_key_id) = 0;
     virtual void on_result(NetQueryPtr net_query) = 0;
+    virtual void on_inflight_query_limit_updated(size_t inflight_query_limit) = 0;
   };
 
   Session(unique_ptr<Callback> callback, std::shared_ptr<AuthDataShared> shared_auth_data, int32 raw_dc_id, int32 dc_id,
@@ -163,6 +165,14 @@ class Session final
   double cached_connection_timestamp_ = 0;
   unique_ptr<mtproto::RawConnection> cached_connection_;
 
+  // if the main connection is degraded, a standby connection is requested and the main connection is replaced with it;
+  // queries without acknowledgement are marked as unknown and their state is asked over the new connection
+  static constexpr double MIN_FAILOVER_CONNECTION_AGE = 10.0;
+  static constexpr double FAILOVER_COOLDOWN = 60.0;
+  bool is_standby_connection_requested_ = false;
+  double last_failover_at_ = 0;
+  CancellationTokenSource standby_connection_cancellation_token_source_;
+
   std::shared_ptr<Callback> callback_;
   mtproto::AuthData auth_data_;
   bool use_pfs_{false};
@@ -172,7 +182,21 @@ class Session final
   bool close_flag_ = false;
 
   static constexpr double ACTIVITY_TIMEOUT = 60 * 5;
-  static constexpr size_t MAX_INFLIGHT_QUERIES = 1024;
+  static constexpr size_t MIN_INFLIGHT_QUERIES = 64;
+  static constexpr size_t INITIAL_INFLIGHT_QUERIES = 1024;
+  static constexpr size_t MAX_INFLIGHT_QUERIES = 4096;
+  static constexpr double INFLIGHT_QUERY_LIMIT_INCREASE = 16.0;  // per whole window of answered queries
+  static constexpr double INFLIGHT_QUERY_LIMIT_DECREASE = 0.75;
+  static constexpr double MAX_QUERY_LATENCY_FACTOR = 4.0;
+
+  // the number of simultaneously sent queries is limited by a window, which grows additively while the window
+  // is saturated and the queries are answered fast, and shrinks multiplicatively on FLOOD_WAIT errors,
+  // lost messages and growth of the latency
+  double inflight_query_limit_ = static_cast<double>(INITIAL_INFLIGHT_QUERIES);
+  size_t reported_inflight_query_limit_ = INITIAL_INFLIGHT_QUERIES;
+  double min_query_latency_ = 0;
+  double query_latency_ = 0;
+  double last_inflight_query_limit_decrease_at_ = 0;
 
   struct ContainerInfo {
     size_t ref_cnt;
@@ -190,6 +214,11 @@ class Session final
   std::array<HandshakeInfo, 2> handshake_info_;
 
   double wakeup_at_;
+  size_t get_inflight_query_limit() const;
+  void on_query_latency(double latency);
+  void decrease_inflight_query_limit(Slice reason);
+  void on_inflight_query_limit_changed();
+
   void on_handshake_ready(Result<unique_ptr<mtproto::AuthKeyHandshake>> r_handshake);
   void create_gen_auth_key_actor(HandshakeId handshake_id);
   void auth_loop(double now);
@@ -245,6 +274,8 @@ class Session final
   void connection_open(ConnectionInfo *info, double now, bool ask_info = false);
   void connection_add(unique_ptr<mtproto::RawConnection> raw_connection);
   void connection_check_mode(ConnectionInfo *info);
+  void connection_check_quality(ConnectionInfo *info, double now);
+  void on_standby_connection(Result<unique_ptr<mtproto::RawConnection>> r_raw_connection);
   void connection_open_finish(ConnectionInfo *info, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection);
 
   void connection_online_update(double now, bool force);
@@ -11,19 +11,20 @@
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 
-#include <algorithm>
-
 namespace td {
 
 SessionMultiProxy::~SessionMultiProxy() = default;
 
-SessionMultiProxy::SessionMultiProxy(int32 session_count, std::shared_ptr<AuthDataShared> shared_auth_data,
-                                     bool is_primary, bool is_main, bool use_pfs, bool allow_media_only, bool is_media,
-                                     bool is_cdn, bool need_destroy_auth_key)
+SessionMultiProxy::SessionMultiProxy(int32 session_count, int32 max_session_count,
+                                     std::shared_ptr<AuthDataShared> shared_auth_data, bool is_primary, bool is_main,
+                                     bool use_pfs, bool allow_media_only, bool is_media, bool is_cdn,
+                                     bool need_destroy_auth_key)
     : session_count_(session_count)
+    , max_session_count_(max(max_session_count, session_count))
     , auth_data_(std::move(shared_auth_data))
     , is_primary_(is_primary)
     , is_main_(is_main)
@@ -41,11 +42,32 @@ void SessionMultiProxy::send(NetQueryPtr query) {
   size_t pos = 0;
   if (query->auth_flag() == NetQuery::AuthFlag::On) {
     if (query->session_rand()) {
-      pos = query->session_rand() % sessions_.size();
+      // automatically opened sessions must not change the session chosen for the query
+      pos = query->session_rand() % session_count_;
     } else {
-      pos = std::min_element(sessions_.begin(), sessions_.end(),
-                             [](const auto &a, const auto &b) { return a.queries_count < b.queries_count; }) -
-            sessions_.begin();
+      // choose the least loaded session, starting from the session after the last chosen one, so queries of
+      // a big download are striped over all sessions even if they have the same number of active queries
+      auto session_count = active_session_count_;
+      pos = next_session_pos_ % session_count;
+      for (size_t i = 1; i < session_count; i++) {
+        auto candidate_pos = (next_session_pos_ + i) % session_count;
+        if (sessions_[candidate_pos].queries_count < sessions_[pos].queries_count) {
+          pos = candidate_pos;
+        }
+      }
+      if (sessions_[pos].is_saturated() && !need_destroy_auth_key_ &&
+          active_session_count_ < static_cast<size_t>(max_session_count_)) {
+        LOG(INFO) << "Activate additional session in " << get_name() << ", because in-flight query windows of all "
+                  << active_session_count_ << " sessions are saturated";
+        if (active_session_count_ == sessions_.size()) {
+          add_session();
+        }
+        pos = active_session_count_++;
+        if (!has_timeout()) {
+          set_timeout_in(AUTO_SCALE_PERIOD);
+        }
+      }
+      next_session_pos_ = pos + 1;
     }
   }
   // query->debug(PSTRING() << get_name() << ": send to proxy #" << pos);
@@ -67,14 +89,14 @@ void SessionMultiProxy::update_destroy_auth_key(bool need_destroy_auth_key) {
 }
 
 void SessionMultiProxy::update_session_count(int32 session_count) {
-  update_options(session_count, use_pfs_);
+  update_options(session_count, max_session_count_, use_pfs_);
 }
 
 void SessionMultiProxy::update_use_pfs(bool use_pfs) {
-  update_options(session_count_, use_pfs);
+  update_options(session_count_, max_session_count_, use_pfs);
 }
 
-void SessionMultiProxy::update_options(int32 session_count, bool use_pfs) {
+void SessionMultiProxy::update_options(int32 session_count, int32 max_session_count, bool use_pfs) {
   bool changed = false;
 
   if (session_count != session_count_) {
@@ -88,6 +110,8 @@ void SessionMultiProxy::update_options(int32 session_count, bool use_pfs) {
     LOG(INFO) << "Update " << get_name() << " session_count to " << session_count_;
     changed = true;
   }
+  // extra sessions above the new limit will be deactivated in timeout_expired
+  max_session_count_ = max(max_session_count, session_count_);
 
   if (use_pfs != use_pfs_) {
     bool old_pfs_flag = get_pfs_flag();
@@ -123,37 +147,103 @@ void SessionMultiProxy::init() {
     LOG(WARNING) << tag("session_count", session_count_);
   }
   for (int32 i = 0; i < session_count_; i++) {
-    string name = PSTRING() << "Session" << get_name().substr(Slice("SessionMulti").size())
-                            << format::cond(session_count_ > 1, format::concat("#", i));
-
-    SessionInfo info;
-    class Callback final : public SessionProxy::Callback {
-     public:
-      Callback(ActorId<SessionMultiProxy> parent, uint32 generation, int32 session_id)
-          : parent_(parent), generation_(generation), session_id_(session_id) {
-      }
-      void on_query_finished() final {
-        send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_);
-      }
-
-     private:
-      ActorId<SessionMultiProxy> parent_;
-      uint32 generation_;
-      int32 session_id_;
-    };
-    info.proxy = create_actor<SessionProxy>(name, make_unique<Callback>(actor_id(this), sessions_generation_, i),
-                                            auth_data_, is_primary_, is_main_, allow_media_only_, is_media_,
-                                            get_pfs_flag(), is_cdn_, need_destroy_auth_key_ && i == 0);
-    sessions_.push_back(std::move(info));
+    add_session();
   }
+  active_session_count_ = sessions_.size();
+  peak_session_throughput_ = 0.0;
+  cancel_timeout();
+}
+
+void SessionMultiProxy::add_session() {
+  auto session_id = narrow_cast<int32>(sessions_.size());
+  string name = PSTRING() << "Session" << get_name().substr(Slice("SessionMulti").size())
+                          << format::cond(session_count_ > 1 || session_id > 0, format::concat("#", session_id));
+
+  SessionInfo info;
+  class Callback final : public SessionProxy::Callback {
+   public:
+    Callback(ActorId<SessionMultiProxy> parent, uint32 generation, int32 session_id)
+        : parent_(parent), generation_(generation), session_id_(session_id) {
+    }
+    void on_query_finished() final {
+      send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_);
+    }
+    void on_inflight_query_limit_updated(size_t inflight_query_limit) final {
+      send_closure(parent_, &SessionMultiProxy::on_inflight_query_limit_updated, generation_, session_id_,
+                   inflight_query_limit);
+    }
+
+   private:
+    ActorId<SessionMultiProxy> parent_;
+    uint32 generation_;
+    int32 session_id_;
+  };
+  info.proxy = create_actor<SessionProxy>(name, make_unique<Callback>(actor_id(this), sessions_generation_, session_id),
+                                          auth_data_, is_primary_, is_main_, allow_media_only_, is_media_,
+                                          get_pfs_flag(), is_cdn_, need_destroy_auth_key_ && session_id == 0);
+  sessions_.push_back(std::move(info));
 }
 
 void SessionMultiProxy::on_query_finished(uint32 generation, int session_id) {
   if (generation != sessions_generation_) {
     return;
   }
-  sessions_.at(session_id).queries_count--;
-  CHECK(sessions_.at(session_id).queries_count >= 0);
+  auto &session = sessions_.at(session_id);
+  session.queries_count--;
+  session.finished_queries_count++;
+  CHECK(session.queries_count >= 0);
+}
+
+void SessionMultiProxy::on_inflight_query_limit_updated(uint32 generation, int session_id,
+                                                        size_t inflight_query_limit) {
+  if (generation != sessions_generation_ || static_cast<size_t>(session_id) >= sessions_.size()) {
+    return;
+  }
+  LOG(INFO) << "In-flight query limit of session " << session_id << " in " << get_name() << " is "
+            << inflight_query_limit;
+  sessions_.at(session_id).inflight_query_limit = inflight_query_limit;
+}
+
+void SessionMultiProxy::timeout_expired() {
+  auto session_count = static_cast<size_t>(session_count_);
+  if (active_session_count_ > session_count) {
+    int64 queries_count = 0;
+    int64 finished_queries_count = 0;
+    bool is_saturated = false;
+    for (size_t i = 0; i < active_session_count_; i++) {
+      const auto &session = sessions_[i];
+      queries_count += session.queries_count;
+      finished_queries_count += session.finished_queries_count;
+      is_saturated |= session.is_saturated();
+      auto session_throughput = static_cast<double>(session.finished_queries_count) / AUTO_SCALE_PERIOD;
+      if (session_throughput > peak_session_throughput_) {
+        peak_session_throughput_ = session_throughput;
+      }
+    }
+
+    // deactivate the last session if other sessions aren't saturated, all queries can be kept in them,
+    // and they can handle the current throughput being loaded at most by a half
+    auto remaining_session_count = static_cast<double>(active_session_count_ - 1);
+    auto throughput = static_cast<double>(finished_queries_count) / AUTO_SCALE_PERIOD;
+    if (active_session_count_ > static_cast<size_t>(max_session_count_) ||
+        (!is_saturated && queries_count <= static_cast<int64>(active_session_count_ - 1) * MAX_IDLE_SESSION_QUERIES &&
+         throughput <= 0.5 * peak_session_throughput_ * remaining_session_count)) {
+      active_session_count_--;
+      LOG(INFO) << "Deactivate session " << active_session_count_ << " in " << get_name() << " with throughput "
+                << throughput << " queries per second";
+    }
+  }
+  for (auto &session : sessions_) {
+    session.finished_queries_count = 0;
+  }
+
+  // close deactivated sessions without active queries
+  while (sessions_.size() > active_session_count_ && sessions_.back().queries_count == 0) {
+    sessions_.pop_back();
+  }
+  if (sessions_.size() > session_count) {
+    set_timeout_in(AUTO_SCALE_PERIOD);
+  }
 }
 
 }  // namespace td
@@ -19,8 +19,8 @@ class SessionProxy;
 
 class SessionMultiProxy final : public Actor {
  public:
-  SessionMultiProxy(int32 session_count, std::shared_ptr<AuthDataShared> shared_auth_data, bool is_primary,
-                    bool is_main, bool use_pfs, bool allow_media_only, bool is_media, bool is_cdn,
+  SessionMultiProxy(int32 session_count, int32 max_session_count, std::shared_ptr<AuthDataShared> shared_auth_data,
+                    bool is_primary, bool is_main, bool use_pfs, bool allow_media_only, bool is_media, bool is_cdn,
                     bool need_destroy_auth_key);
   SessionMultiProxy(const SessionMultiProxy &other) = delete;
   SessionMultiProxy &operator=(const SessionMultiProxy &other) = delete;
@@ -31,13 +31,14 @@ class SessionMultiProxy final : public Actor {
 
   void update_session_count(int32 session_count);
   void update_use_pfs(bool use_pfs);
-  void update_options(int32 session_count, bool use_pfs);
+  void update_options(int32 session_count, int32 max_session_count, bool use_pfs);
   void update_mtproto_header();
 
   void update_destroy_auth_key(bool need_destroy_auth_key);
 
  private:
   int32 session_count_ = 0;
+  int32 max_session_count_ = 0;
   std::shared_ptr<AuthDataShared> auth_data_;
   const bool is_primary_;
   bool is_main_ = false;
@@ -49,16 +50,32 @@ class SessionMultiProxy final : public Actor {
   struct SessionInfo {
     ActorOwn<SessionProxy> proxy;
     int queries_count{0};
+    int finished_queries_count{0};   // since the last auto-scaling check
+    size_t inflight_query_limit{0};  // 0 if unknown
+
+    bool is_saturated() const {
+      return inflight_query_limit != 0 && static_cast<size_t>(queries_count) >= inflight_query_limit;
+    }
   };
+  // up to max_session_count_ sessions are activated automatically when all active sessions have saturated in-flight
+  // query windows; additional sessions are deactivated and closed when the load decreases
+  static constexpr double AUTO_SCALE_PERIOD = 10.0;
+  static constexpr int64 MAX_IDLE_SESSION_QUERIES = 16;
+  size_t active_session_count_ = 0;
+  double peak_session_throughput_ = 0.0;
   uint32 sessions_generation_{0};
   std::vector<SessionInfo> sessions_;
+  size_t next_session_pos_ = 0;
 
   void start_up() final;
+  void timeout_expired() final;
   void init();
+  void add_session();
 
   bool get_pfs_flag() const;
 
   void on_query_finished(uint32 generation, int session_id);
+  void on_inflight_query_limit_updated(uint32 generation, int session_id, size_t inflight_query_limit);
 };
 
 }  // namespace td
@@ -69,6 +69,10 @@ class SessionCallback final : public Session::Callback {
     G()->net_query_dispatcher().dispatch(std::move(query));
   }
 
+  void on_inflight_query_limit_updated(size_t inflight_query_limit) final {
+    send_closure(parent_, &SessionProxy::on_inflight_query_limit_updated, inflight_query_limit);
+  }
+
  private:
   ActorShared<SessionProxy> parent_;
   DcId dc_id_;
@@ -258,4 +262,8 @@ void SessionProxy::on_query_finished() {
   callback_->on_query_finished();
 }
 
+void SessionProxy::on_inflight_query_limit_updated(size_t inflight_query_limit) {
+  callback_->on_inflight_query_limit_updated(inflight_query_limit);
+}
+
 }  // namespace td
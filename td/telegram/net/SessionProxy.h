@@ -27,6 +27,7 @@ class SessionProxy final : public Actor {
    public:
     virtual ~Callback() = default;
     virtual void on_query_finished() = 0;
+    virtual void on_inflight_query_limit_updated(size_t inflight_query_limit) = 0;
   };
 
   SessionProxy(unique_ptr<Callback> callback, std::shared_ptr<AuthDataShared> shared_auth_data, bool is_primary,
@@ -64,6 +65,7 @@ class SessionProxy final : public Actor {
   void on_server_salt_updated(std::vector<mtproto::ServerSalt> server_salts);
 
   void on_query_finished();
+  void on_inflight_query_limit_updated(size_t inflight_query_limit);
 
   void start_up() final;
   void tear_down() final;
@@ -0,0 +1,113 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+/**
+ * \file
+ * C interface for interaction with TDLib via TL-serialized objects.
+ * Can be used instead of the JSON interface by applications, which are able to serialize and deserialize TDLib API
+ * objects in the TL binary format, to avoid the overhead of JSON serialization.
+ *
+ * All requests and responses are boxed TL-serialized objects, i.e. each object starts with the 32-bit identifier
+ * of its constructor. Fields of object types which can be null are also boxed, and null objects are stored as
+ * the constructor null = Null with identifier 0x56730bcc. Requests should be aligned to a 4-byte boundary.
+ *
+ * The interface is independent of the JSON interface: client identifiers returned by td_binary_create_client_id can
+ * be used only with the functions from this file, and their updates are returned only by td_binary_receive.
+ * Requests are matched with responses through a request identifier, passed to td_binary_send and returned
+ * by td_binary_receive. Updates have request identifier 0.
+ *
+ * General pattern of usage:
+ * \code
+ * int client_id = td_binary_create_client_id();
+ * // share the client_id with other threads, which will be able to send requests via td_binary_send
+ *
+ * const double WAIT_TIMEOUT = 10.0; // seconds
+ * while (true) {
+ *   int response_client_id;
+ *   unsigned long long request_id;
+ *   int size;
+ *   const void *result = td_binary_receive(WAIT_TIMEOUT, &response_client_id, &request_id, &size);
+ *   if (result) {
+ *     // deserialize the result and process it as an incoming update or the answer to a previously sent request
+ *   }
+ * }
+ * \endcode
+ */
+
+#include "td/telegram/tdjson_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Returns an opaque identifier of a new TDLib instance.
+ * The TDLib instance will not send updates until the first request is sent to it.
+ * \return Opaque identifier of a new TDLib instance.
+ */
+TDJSON_EXPORT int td_binary_create_client_id();
+
+/**
+ * Returns an opaque identifier of a new TDLib instance, which has its own queue of updates and request responses.
+ * Updates and request responses for the instance can be received only through td_binary_receive_for_client.
+ * The TDLib instance will not send updates until the first request is sent to it.
+ * \return Opaque identifier of a new TDLib instance.
+ */
+TDJSON_EXPORT int td_binary_create_client_id_with_own_queue();
+
+/**
+ * Sends request to the TDLib client. May be called from any thread.
+ * \param[in] client_id TDLib client identifier.
+ * \param[in] request_id Non-zero identifier of the request, which will be returned with the response.
+ * \param[in] request TL-serialized request to TDLib.
+ * \param[in] request_size Size of the request in bytes.
+ */
+TDJSON_EXPORT void td_binary_send(int client_id, unsigned long long request_id, const void *request, int request_size);
+
+/**
+ * Receives incoming updates and request responses. Must not be called simultaneously from two different threads.
+ * The returned pointer can be used until the next call to td_binary_receive, td_binary_receive_for_client or
+ * td_binary_execute in the same thread, after which it will be deallocated by TDLib.
+ * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+ * \param[out] client_id Identifier of the client for which the update or the response was received.
+ * \param[out] request_id Identifier of the request, or 0 for updates.
+ * \param[out] response_size Size of the returned data in bytes.
+ * \return TL-serialized incoming update or request response. May be NULL if the timeout expires.
+ */
+TDJSON_EXPORT const void *td_binary_receive(double timeout, int *client_id, unsigned long long *request_id,
+                                            int *response_size);
+
+/**
+ * Receives incoming updates and request responses for a TDLib instance created with
+ * td_binary_create_client_id_with_own_queue. Must not be called simultaneously from two different threads for
+ * the same client. The returned pointer can be used until the next call to td_binary_receive,
+ * td_binary_receive_for_client or td_binary_execute in the same thread, after which it will be deallocated by TDLib.
+ * \param[in] client_id TDLib client identifier.
+ * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+ * \param[out] request_id Identifier of the request, or 0 for updates.
+ * \param[out] response_size Size of the returned data in bytes.
+ * \return TL-serialized incoming update or request response. May be NULL if the timeout expires.
+ */
+TDJSON_EXPORT const void *td_binary_receive_for_client(int client_id, double timeout, unsigned long long *request_id,
+                                                       int *response_size);
+
+/**
+ * Synchronously executes a TDLib request.
+ * A request can be executed synchronously, only if it is documented with "Can be called synchronously".
+ * The returned pointer can be used until the next call to td_binary_receive, td_binary_receive_for_client or
+ * td_binary_execute in the same thread, after which it will be deallocated by TDLib.
+ * \param[in] request TL-serialized request to TDLib.
+ * \param[in] request_size Size of the request in bytes.
+ * \param[out] response_size Size of the returned data in bytes.
+ * \return TL-serialized request response.
+ */
+TDJSON_EXPORT const void *td_binary_execute(const void *request, int request_size, int *response_size);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -35,14 +35,30 @@ int td_create_client_id() {
   return td::json_create_client_id();
 }
 
+int td_create_client_id_with_own_queue() {
+  return td::json_create_client_id_with_own_queue();
+}
+
 void td_send(int client_id, const char *request) {
   td::json_send(client_id, td::Slice(request == nullptr ? "" : request));
 }
 
+void td_send_batch(int client_id, const char *requests) {
+  td::json_send_batch(client_id, td::Slice(requests == nullptr ? "" : requests));
+}
+
 const char *td_receive(double timeout) {
   return td::json_receive(timeout);
 }
 
+const char *td_receive_for_client(int client_id, double timeout) {
+  return td::json_receive_for_client(client_id, timeout);
+}
+
+const char *td_receive_batch(int max_count, double timeout) {
+  return td::json_receive_batch(max_count, timeout);
+}
+
 const char *td_execute(const char *request) {
   return td::json_execute(td::Slice(request == nullptr ? "" : request));
 }
@@ -30,6 +30,10 @@
  * has been sent to the client instance. This function must not be called simultaneously from two different threads.
  * Also, note that all updates and responses to requests must be applied in the order they were received for consistency.
  * Some TDLib requests can be executed synchronously from any thread using td_execute.
+ * If updates of different client instances need to be processed in parallel, the client instances can be created
+ * through td_create_client_id_with_own_queue. Updates and responses for such instances aren't returned by td_receive
+ * and must be received through td_receive_for_client, which can be called simultaneously from different threads
+ * for different client instances.
  * TDLib client instances are destroyed automatically after they are closed.
  * All TDLib client instances must be closed before application termination to ensure data consistency.
  *
@@ -61,6 +65,14 @@ extern "C" {
  */
 TDJSON_EXPORT int td_create_client_id();
 
+/**
+ * Returns an opaque identifier of a new TDLib instance, which has its own queue of updates and request responses.
+ * Updates and request responses for the instance can be received only through td_receive_for_client.
+ * The TDLib instance will not send updates until the first request is sent to it.
+ * \return Opaque identifier of a new TDLib instance.
+ */
+TDJSON_EXPORT int td_create_client_id_with_own_queue();
+
 /**
  * Sends request to the TDLib client. May be called from any thread.
  * \param[in] client_id TDLib client identifier.
@@ -68,6 +80,14 @@ TDJSON_EXPORT int td_create_client_id();
  */
 TDJSON_EXPORT void td_send(int client_id, const char *request);
 
+/**
+ * Sends a number of requests to the TDLib client at once. May be called from any thread.
+ * Requests are handled in the order they are specified in the array.
+ * \param[in] client_id TDLib client identifier.
+ * \param[in] requests JSON-serialized null-terminated array of requests to TDLib.
+ */
+TDJSON_EXPORT void td_send_batch(int client_id, const char *requests);
+
 /**
  * Receives incoming updates and request responses. Must not be called simultaneously from two different threads.
  * The returned pointer can be used until the next call to td_receive or td_execute, after which it will be deallocated by TDLib.
@@ -76,6 +96,29 @@ TDJSON_EXPORT void td_send(int client_id, const char *request);
  */
 TDJSON_EXPORT const char *td_receive(double timeout);
 
+/**
+ * Receives incoming updates and request responses for a TDLib instance created with td_create_client_id_with_own_queue.
+ * Must not be called simultaneously from two different threads for the same client.
+ * The returned pointer can be used until the next call to td_receive, td_receive_for_client or td_execute in the same
+ * thread, after which it will be deallocated by TDLib.
+ * \param[in] client_id TDLib client identifier.
+ * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+ * \return JSON-serialized null-terminated incoming update or request response. May be NULL if the timeout expires.
+ */
+TDJSON_EXPORT const char *td_receive_for_client(int client_id, double timeout);
+
+/**
+ * Receives a number of incoming updates and request responses at once. Must not be called simultaneously from two
+ * different threads, or simultaneously with td_receive. Waits only for the first update or response.
+ * The returned pointer can be used until the next call to td_receive, td_receive_for_client, td_receive_batch
+ * or td_execute in the same thread, after which it will be deallocated by TDLib.
+ * \param[in] max_count The maximum number of updates and responses to return.
+ * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+ * \return JSON-serialized null-terminated array of incoming updates and request responses in the order they were
+ *         received. The array is empty if the timeout expires.
+ */
+TDJSON_EXPORT const char *td_receive_batch(int max_count, double timeout);
+
 /**
  * Synchronously executes a TDLib request.
  * A request can be executed synchronously, only if it is documented with "Can be called synchronously".
@@ -0,0 +1,104 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/tl/TlArena.h"
+
+#include "td/utils/common.h"
+#include "td/utils/port/thread_local.h"
+
+#include <atomic>
+#include <limits>
+#include <new>
+
+namespace td {
+
+// each object is preceded by a header with a pointer to its chunk or nullptr if the object is allocated on heap
+// the chunk reference counter starts from a huge value to avoid an atomic operation per allocation;
+// the unused part of the value is subtracted after the chunk is retired by the arena
+struct TlArena::Chunk {
+  std::atomic<std::size_t> ref_cnt{std::numeric_limits<std::size_t>::max()};
+};
+
+static constexpr std::size_t TL_ARENA_ALIGNMENT = alignof(std::max_align_t);
+static constexpr std::size_t TL_ARENA_HEADER_SIZE =
+    (sizeof(void *) + TL_ARENA_ALIGNMENT - 1) / TL_ARENA_ALIGNMENT * TL_ARENA_ALIGNMENT;
+static constexpr std::size_t TL_ARENA_CHUNK_SIZE = 1 << 14;
+static constexpr std::size_t TL_ARENA_MAX_OBJECT_SIZE = TL_ARENA_CHUNK_SIZE / 4;
+
+static TD_THREAD_LOCAL TlArena *current_tl_arena;  // static zero-initialized
+
+static void *set_tl_arena_header(char *ptr, void *chunk) {
+  *reinterpret_cast<void **>(ptr) = chunk;
+  return ptr + TL_ARENA_HEADER_SIZE;
+}
+
+void *TlArena::allocate(std::size_t size) {
+  auto *arena = current_tl_arena;
+  if (arena != nullptr && size <= TL_ARENA_MAX_OBJECT_SIZE) {
+    return arena->do_allocate(size);
+  }
+  return set_tl_arena_header(static_cast<char *>(::operator new(TL_ARENA_HEADER_SIZE + size)), nullptr);
+}
+
+void TlArena::deallocate(void *ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto *header = static_cast<char *>(ptr) - TL_ARENA_HEADER_SIZE;
+  auto *chunk = static_cast<Chunk *>(*reinterpret_cast<void **>(header));
+  if (chunk == nullptr) {
+    return ::operator delete(header);
+  }
+  if (chunk->ref_cnt.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    chunk->~Chunk();
+    ::operator delete(chunk);
+  }
+}
+
+void *TlArena::do_allocate(std::size_t size) {
+  size = (size + TL_ARENA_ALIGNMENT - 1) / TL_ARENA_ALIGNMENT * TL_ARENA_ALIGNMENT + TL_ARENA_HEADER_SIZE;
+  if (static_cast<std::size_t>(end_ - begin_) < size) {
+    retire_chunk();
+    auto *memory = static_cast<char *>(::operator new(TL_ARENA_CHUNK_SIZE));
+    chunk_ = new (memory) Chunk();
+    begin_ = memory + (sizeof(Chunk) + TL_ARENA_ALIGNMENT - 1) / TL_ARENA_ALIGNMENT * TL_ARENA_ALIGNMENT;
+    end_ = memory + TL_ARENA_CHUNK_SIZE;
+  }
+  auto *result = set_tl_arena_header(begin_, chunk_);
+  begin_ += size;
+  allocation_count_++;
+  return result;
+}
+
+void TlArena::retire_chunk() {
+  if (chunk_ == nullptr) {
+    return;
+  }
+  auto unused_ref_cnt = std::numeric_limits<std::size_t>::max() - allocation_count_;
+  if (chunk_->ref_cnt.fetch_sub(unused_ref_cnt, std::memory_order_acq_rel) == unused_ref_cnt) {
+    chunk_->~Chunk();
+    ::operator delete(chunk_);
+  }
+  chunk_ = nullptr;
+  begin_ = nullptr;
+  end_ = nullptr;
+  allocation_count_ = 0;
+}
+
+TlArena::~TlArena() {
+  retire_chunk();
+}
+
+TlArena::Scope::Scope() : old_arena_(current_tl_arena) {
+  current_tl_arena = &arena_;
+}
+
+TlArena::Scope::~Scope() {
+  CHECK(current_tl_arena == &arena_);
+  current_tl_arena = old_arena_;
+}
+
+}  // namespace td
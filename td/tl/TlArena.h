@@ -0,0 +1,64 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <cstddef>
+
+namespace td {
+
+// Allocator for TL objects, which are created in batches, for example, while a server response is parsed.
+//
+// While a TlArena::Scope is alive, objects are allocated from big shared chunks of memory by a pointer bump.
+// A chunk is freed after all objects allocated from it are deleted, so the objects can be moved anywhere,
+// can outlive the scope and can be deleted from any thread. Outside of a scope the objects are allocated on heap.
+// An object, which is kept forever, keeps its whole chunk alive, so chunks are small.
+//
+// Generated TL classes use the arena if generate_common is built with TD_ENABLE_TL_ARENA.
+class TlArena {
+ public:
+  static void *allocate(std::size_t size);
+
+  static void deallocate(void *ptr) noexcept;
+
+  // all objects allocated by the current thread while the scope is alive are allocated from a new arena
+  class Scope;
+
+  TlArena() = default;
+  TlArena(const TlArena &) = delete;
+  TlArena &operator=(const TlArena &) = delete;
+  TlArena(TlArena &&) = delete;
+  TlArena &operator=(TlArena &&) = delete;
+  ~TlArena();
+
+ private:
+  struct Chunk;
+
+  Chunk *chunk_ = nullptr;
+  char *begin_ = nullptr;
+  char *end_ = nullptr;
+  std::size_t allocation_count_ = 0;
+
+  void *do_allocate(std::size_t size);
+
+  void retire_chunk();
+};
+
+class TlArena::Scope {
+ public:
+  Scope();
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+  Scope(Scope &&) = delete;
+  Scope &operator=(Scope &&) = delete;
+  ~Scope();
+
+ private:
+  TlArena arena_;
+  TlArena *old_arena_;
+};
+
+}  // namespace td
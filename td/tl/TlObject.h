@@ -23,6 +23,8 @@ class TlStorerCalcLength;
 
 class TlStorerUnsafe;
 
+class TlStorerBounded;
+
 class TlStorerToString;
 
 /**
@@ -49,6 +51,13 @@ class TlObject {
   virtual void store(TlStorerCalcLength &s) const {
   }
 
+  /**
+   * Appends the object to the storer serializing object in a single pass, a buffer of limited length.
+   * \param[in] s Storer to which the object will be appended.
+   */
+  virtual void store(TlStorerBounded &s) const {
+  }
+
   /**
    * Helper function for the to_string method. Appends a string representation of the object to the storer.
    * \param[in] s Storer to which the object string representation will be appended.
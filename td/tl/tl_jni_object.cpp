@@ -165,12 +165,13 @@ static void utf16_to_utf8(const jchar *p, jsize len, char *res) {
   }
 }
 
-static jsize get_utf16_from_utf8_length(const char *p, size_t len, jsize *surrogates) {
+static jsize get_utf16_from_utf8_length(const char *p, size_t len, jsize *surrogates, jsize *zeros) {
   // UTF-8 correctness is supposed
   jsize result = 0;
   for (size_t i = 0; i < len; i++) {
     result += ((p[i] & 0xc0) != 0x80);
     *surrogates += ((p[i] & 0xf8) == 0xf0);
+    *zeros += (p[i] == '\0');
   }
   return result;
 }
@@ -216,7 +217,18 @@ std::string from_jstring(JNIEnv *env, jstring s) {
     return std::string();
   }
   jsize s_len = env->GetStringLength(s);
-  const jchar *p = env->GetStringChars(s, nullptr);
+  if (s_len == 0) {
+    return std::string();
+  }
+  if (env->GetStringUTFLength(s) == s_len) {
+    // all characters are ASCII characters other than '\0', which are the same in UTF-8 and in modified UTF-8,
+    // so the string can be copied without conversion from UTF-16 and without a copy of UTF-16 characters
+    std::string res(static_cast<size_t>(s_len) + 1, '\0');  // GetStringUTFRegion can write terminating '\0'
+    env->GetStringUTFRegion(s, 0, s_len, &res[0]);
+    res.resize(static_cast<size_t>(s_len));
+    return res;
+  }
+  const jchar *p = env->GetStringCritical(s, nullptr);
   if (p == nullptr) {
     parse_error = true;
     return std::string();
@@ -226,15 +238,16 @@ std::string from_jstring(JNIEnv *env, jstring s) {
   if (len) {
     utf16_to_utf8(p, s_len, &res[0]);
   }
-  env->ReleaseStringChars(s, p);
+  env->ReleaseStringCritical(s, p);
   return res;
 }
 
 jstring to_jstring(JNIEnv *env, const std::string &s) {
   jsize surrogates = 0;
-  jsize unicode_len = get_utf16_from_utf8_length(s.c_str(), s.size(), &surrogates);
-  if (surrogates == 0) {
-    // TODO '\0'
+  jsize zeros = 0;
+  jsize unicode_len = get_utf16_from_utf8_length(s.c_str(), s.size(), &surrogates, &zeros);
+  if (surrogates == 0 && zeros == 0) {
+    // the string is the same in UTF-8 and in modified UTF-8
     return env->NewStringUTF(s.c_str());
   }
   jsize result_len = surrogates + unicode_len;
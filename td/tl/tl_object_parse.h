@@ -8,10 +8,12 @@
 
 #include "td/tl/TlObject.h"
 
+#include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/UInt.h"
 
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -32,6 +34,27 @@ class TlFetchBoxed {
   }
 };
 
+// the same as TlFetchBoxed, but also accepts the constructor null = Null for null objects
+template <class Func, std::int32_t constructor_id>
+class TlFetchNullableBoxed {
+ public:
+  template <class ParserT>
+  static auto parse(ParserT &parser) -> decltype(Func::parse(parser)) {
+    constexpr std::int32_t ID_NULL = 0x56730bcc;
+
+    auto parsed_constructor_id = parser.fetch_int();
+    if (parsed_constructor_id == ID_NULL) {
+      return nullptr;
+    }
+    if (parsed_constructor_id != constructor_id) {
+      parser.set_error(PSTRING() << "Wrong constructor " << parsed_constructor_id << " found instead of "
+                                 << constructor_id);
+      return nullptr;
+    }
+    return Func::parse(parser);
+  }
+};
+
 class TlFetchTrue {
  public:
   template <class ParserT>
@@ -64,6 +87,11 @@ class TlFetchInt {
   static std::int32_t parse(ParserT &parser) {
     return parser.fetch_int();
   }
+
+  template <class ParserT>
+  static std::int32_t parse_unsafe(ParserT &parser) {
+    return parser.fetch_int_unsafe();
+  }
 };
 
 class TlFetchLong {
@@ -72,6 +100,11 @@ class TlFetchLong {
   static std::int64_t parse(ParserT &parser) {
     return parser.fetch_long();
   }
+
+  template <class ParserT>
+  static std::int64_t parse_unsafe(ParserT &parser) {
+    return parser.fetch_long_unsafe();
+  }
 };
 
 class TlFetchDouble {
@@ -80,6 +113,11 @@ class TlFetchDouble {
   static double parse(ParserT &parser) {
     return parser.fetch_double();
   }
+
+  template <class ParserT>
+  static double parse_unsafe(ParserT &parser) {
+    return parser.fetch_double_unsafe();
+  }
 };
 
 class TlFetchInt128 {
@@ -88,6 +126,11 @@ class TlFetchInt128 {
   static UInt128 parse(ParserT &parser) {
     return parser.template fetch_binary<UInt128>();
   }
+
+  template <class ParserT>
+  static UInt128 parse_unsafe(ParserT &parser) {
+    return parser.template fetch_binary_unsafe<UInt128>();
+  }
 };
 
 class TlFetchInt256 {
@@ -96,6 +139,11 @@ class TlFetchInt256 {
   static UInt256 parse(ParserT &parser) {
     return parser.template fetch_binary<UInt256>();
   }
+
+  template <class ParserT>
+  static UInt256 parse_unsafe(ParserT &parser) {
+    return parser.template fetch_binary_unsafe<UInt256>();
+  }
 };
 
 template <class T>
@@ -135,6 +183,34 @@ class TlFetchVector {
   }
 };
 
+// vectors of fixed-size numbers are fetched by a single memcpy
+template <class T>
+class TlFetchFixedSizeVector {
+ public:
+  template <class ParserT>
+  static std::vector<T> parse(ParserT &parser) {
+    const std::uint32_t multiplicity = parser.fetch_int();
+    std::vector<T> v;
+    if (parser.get_left_len() / sizeof(T) < multiplicity) {
+      parser.set_error("Wrong vector length");
+    } else if (multiplicity != 0) {
+      v.resize(multiplicity);
+      auto data = parser.template fetch_string_raw<Slice>(multiplicity * sizeof(T));
+      std::memcpy(v.data(), data.data(), data.size());
+    }
+    return v;
+  }
+};
+
+template <>
+class TlFetchVector<TlFetchInt> final : public TlFetchFixedSizeVector<std::int32_t> {};
+
+template <>
+class TlFetchVector<TlFetchLong> final : public TlFetchFixedSizeVector<std::int64_t> {};
+
+template <>
+class TlFetchVector<TlFetchDouble> final : public TlFetchFixedSizeVector<double> {};
+
 template <class T>
 class TlFetchObject {
  public:
@@ -16,6 +16,9 @@
 
 namespace td {
 
+// null object is stored as the constructor null = Null
+constexpr std::int32_t TL_ID_NULL = 0x56730bcc;
+
 template <class Func, std::int32_t constructor_id>
 class TlStoreBoxed {
  public:
@@ -24,6 +27,16 @@ class TlStoreBoxed {
     storer.store_binary(constructor_id);
     Func::store(x, storer);
   }
+
+  template <class T, class StorerT>
+  static void store(const tl_object_ptr<T> &x, StorerT &storer) {
+    if (x == nullptr) {
+      storer.store_binary(TL_ID_NULL);
+      return;
+    }
+    storer.store_binary(constructor_id);
+    Func::store(x, storer);
+  }
 };
 
 template <class Func>
@@ -31,6 +44,10 @@ class TlStoreBoxedUnknown {
  public:
   template <class T, class StorerT>
   static void store(const T &x, StorerT &storer) {
+    if (x == nullptr) {
+      storer.store_binary(TL_ID_NULL);
+      return;
+    }
     storer.store_binary(x->get_id());
     Func::store(x, storer);
   }
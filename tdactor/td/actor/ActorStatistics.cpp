@@ -0,0 +1,90 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/actor/ActorStatistics.h"
+
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/ThreadLocalStorage.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace td {
+
+namespace {
+
+struct ThreadActorStatistics {
+  std::mutex mutex;
+  FlatHashMap<string, ActorStatistics::Entry> entries;
+};
+
+ThreadLocalStorage<ThreadActorStatistics> &get_thread_actor_statistics() {
+  static ThreadLocalStorage<ThreadActorStatistics> statistics;
+  return statistics;
+}
+
+void add_to_histogram(ActorStatistics::Histogram &histogram, double duration) {
+  size_t pos = 0;
+  double max_duration = 1e-6;
+  while (pos + 1 < histogram.size() && duration >= max_duration) {
+    pos++;
+    max_duration *= 2;
+  }
+  histogram[pos]++;
+}
+
+}  // namespace
+
+std::atomic<bool> ActorStatistics::is_enabled_{false};
+
+void ActorStatistics::set_enabled(bool is_enabled) {
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+void ActorStatistics::on_event(Slice name, double wait_time, double run_time) {
+  auto &statistics = get_thread_actor_statistics().get();
+  std::lock_guard<std::mutex> lock(statistics.mutex);
+  auto &entry = statistics.entries[name.str()];
+  entry.event_count++;
+  if (wait_time >= 0) {
+    add_to_histogram(entry.wait_time, wait_time);
+  }
+  add_to_histogram(entry.run_time, run_time);
+}
+
+vector<ActorStatistics::Entry> ActorStatistics::get_statistics() {
+  FlatHashMap<string, Entry> entries;
+  get_thread_actor_statistics().for_each([&entries](ThreadActorStatistics &statistics) {
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    for (auto &it : statistics.entries) {
+      auto &entry = entries[it.first];
+      entry.event_count += it.second.event_count;
+      for (size_t i = 0; i < HISTOGRAM_SIZE; i++) {
+        entry.wait_time[i] += it.second.wait_time[i];
+        entry.run_time[i] += it.second.run_time[i];
+      }
+    }
+  });
+
+  vector<Entry> result;
+  result.reserve(entries.size());
+  for (auto &it : entries) {
+    it.second.name = it.first;
+    result.push_back(std::move(it.second));
+  }
+  std::sort(result.begin(), result.end(),
+            [](const Entry &lhs, const Entry &rhs) { return lhs.event_count > rhs.event_count; });
+  return result;
+}
+
+void ActorStatistics::clear() {
+  get_thread_actor_statistics().for_each([](ThreadActorStatistics &statistics) {
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    statistics.entries.clear();
+  });
+}
+
+}  // namespace td
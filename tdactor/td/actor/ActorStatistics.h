@@ -0,0 +1,51 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+#include <array>
+#include <atomic>
+
+namespace td {
+
+// Collects statistics about events processed by actors, grouped by actor name
+// Collection is disabled by default and costs a relaxed atomic load per event when disabled
+class ActorStatistics {
+ public:
+  static constexpr size_t HISTOGRAM_SIZE = 24;
+
+  // i-th element contains number of durations in [2^(i-1), 2^i) microseconds
+  // the first element contains number of durations less than 1 microsecond, the last element contains all longer durations
+  using Histogram = std::array<uint64, HISTOGRAM_SIZE>;
+
+  struct Entry {
+    string name;
+    uint64 event_count = 0;
+    Histogram wait_time{};
+    Histogram run_time{};
+  };
+
+  static void set_enabled(bool is_enabled);
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // wait_time is negative if it is unknown
+  static void on_event(Slice name, double wait_time, double run_time);
+
+  static vector<Entry> get_statistics();
+
+  static void clear();
+
+ private:
+  static std::atomic<bool> is_enabled_;
+};
+
+}  // namespace td
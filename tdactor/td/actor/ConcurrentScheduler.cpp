@@ -15,7 +15,8 @@
 
 namespace td {
 
-ConcurrentScheduler::ConcurrentScheduler(int32 additional_thread_count, uint64 thread_affinity_mask) {
+ConcurrentScheduler::ConcurrentScheduler(int32 additional_thread_count, uint64 thread_affinity_mask,
+                                         bool use_timer_wheel) {
 #if TD_THREAD_UNSUPPORTED || TD_EVENTFD_UNSUPPORTED
   additional_thread_count = 0;
 #endif
@@ -28,6 +29,7 @@ ConcurrentScheduler::ConcurrentScheduler(int32 additional_thread_count, uint64 t
     outbound[i] = queue;
   }
   thread_affinity_mask_ = thread_affinity_mask;
+  thread_affinity_masks_.resize(additional_thread_count, 0);
 #endif
 
   // +1 for extra scheduler for IOCP and send_closure from unrelated threads
@@ -52,6 +54,7 @@ ConcurrentScheduler::ConcurrentScheduler(int32 additional_thread_count, uint64 t
 #endif
 
     sched->init(i, outbound, static_cast<Scheduler::Callback *>(this));
+    sched->set_use_timer_wheel(use_timer_wheel);
   }
 
 #if TD_PORT_WINDOWS
@@ -62,6 +65,39 @@ ConcurrentScheduler::ConcurrentScheduler(int32 additional_thread_count, uint64 t
   state_ = State::Start;
 }
 
+void ConcurrentScheduler::enable_work_stealing() {
+  CHECK(state_ == State::Start);
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  auto sched_count = static_cast<int32>(schedulers_.size()) - extra_scheduler_;
+  auto work_stealing_info = std::make_shared<Scheduler::WorkStealingInfo>(sched_count);
+  for (int32 i = 0; i < sched_count; i++) {
+    // the main scheduler is run only from run_main, so it can give actors away, but must not take them
+    schedulers_[i]->set_work_stealing_info(work_stealing_info, i != 0);
+  }
+#endif
+}
+
+void ConcurrentScheduler::set_thread_affinity_mask(int32 sched_id, uint64 thread_affinity_mask) {
+  CHECK(state_ == State::Start);
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  auto thread_pos = static_cast<size_t>(sched_id);
+  CHECK(thread_pos < thread_affinity_masks_.size());
+  thread_affinity_masks_[thread_pos] = thread_affinity_mask;
+#endif
+}
+
+uint64 ConcurrentScheduler::get_thread_affinity_mask(int32 sched_id) const {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  auto thread_pos = static_cast<size_t>(sched_id);
+  if (thread_pos < thread_affinity_masks_.size() && thread_affinity_masks_[thread_pos] != 0) {
+    return thread_affinity_masks_[thread_pos];
+  }
+  return thread_affinity_mask_;
+#else
+  return 0;
+#endif
+}
+
 void ConcurrentScheduler::test_one_thread_run() {
   do {
     for (auto &sched : schedulers_) {
@@ -84,7 +120,8 @@ void ConcurrentScheduler::start() {
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
   for (size_t i = 1; i + extra_scheduler_ < schedulers_.size(); i++) {
     auto &sched = schedulers_[i];
-    threads_.push_back(td::thread([&, thread_affinity_mask = thread_affinity_mask_] {
+    auto thread_affinity_mask = get_thread_affinity_mask(static_cast<int32>(i));
+    threads_.push_back(td::thread([&, thread_affinity_mask] {
 #if TD_PORT_WINDOWS
       detail::Iocp::Guard iocp_guard(iocp_.get());
 #endif
@@ -26,7 +26,13 @@ namespace td {
 
 class ConcurrentScheduler final : private Scheduler::Callback {
  public:
-  explicit ConcurrentScheduler(int32 additional_thread_count, uint64 thread_affinity_mask = 0);
+  // if use_timer_wheel is true, actor timeouts and MultiTimeout are backed by a TimerWheel instead of a heap
+  explicit ConcurrentScheduler(int32 additional_thread_count, uint64 thread_affinity_mask = 0,
+                               bool use_timer_wheel = false);
+
+  // allows idle scheduler threads to take migratable actors from overloaded schedulers
+  // must be called before start()
+  void enable_work_stealing();
 
   void finish_async() {
     schedulers_[0]->finish();
@@ -44,6 +50,13 @@ class ConcurrentScheduler final : private Scheduler::Callback {
     return schedulers_.back()->get_const_guard();
   }
 
+  // overrides thread affinity mask for the thread running the scheduler sched_id
+  // the main scheduler is run by the caller of run_main, which must apply get_thread_affinity_mask(0) itself
+  // must be called before start()
+  void set_thread_affinity_mask(int32 sched_id, uint64 thread_affinity_mask);
+
+  uint64 get_thread_affinity_mask(int32 sched_id) const;
+
   void test_one_thread_run();
 
   bool is_finished() const {
@@ -101,6 +114,7 @@ class ConcurrentScheduler final : private Scheduler::Callback {
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
   vector<td::thread> threads_;
   uint64 thread_affinity_mask_ = 0;
+  vector<uint64> thread_affinity_masks_;
 #endif
 #if TD_PORT_WINDOWS
   unique_ptr<detail::Iocp> iocp_;
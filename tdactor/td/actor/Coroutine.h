@@ -0,0 +1,146 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+// Opt-in adapter, which allows to write request handlers as C++20 coroutines.
+// It is available only if the file is compiled as C++20 with coroutine support, otherwise TD_HAVE_CXX20_COROUTINES is 0.
+//
+// Usage inside an actor:
+//   ActorTask run_query(Promise<Unit> promise) {
+//     auto r_result = co_await await_promise<int>(actor_id(this), [&](Promise<int> query_promise) {
+//       send_closure(other_actor_id_, &OtherActor::query, std::move(query_promise));
+//     });
+//     ...
+//   }
+//
+// The coroutine starts immediately and after each co_await it is resumed by an event sent to the actor,
+// so it is always run by the actor's scheduler and in the actor's context. An operation can be anything
+// reporting its result through a Promise, for example, a NetQuery, a database request or a MultiPromise.
+// If the actor is destroyed before an operation finishes, the coroutine is destroyed without being resumed.
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define TD_HAVE_CXX20_COROUTINES 1
+#else
+#define TD_HAVE_CXX20_COROUTINES 0
+#endif
+
+#if TD_HAVE_CXX20_COROUTINES
+
+#include "td/actor/actor.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Status.h"
+
+#include <coroutine>
+#include <type_traits>
+#include <utility>
+
+namespace td {
+
+// fire-and-forget coroutine, the result must be returned through a Promise passed to the coroutine
+class ActorTask {
+ public:
+  struct promise_type {
+    ActorTask get_return_object() noexcept {
+      return ActorTask();
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() noexcept {
+    }
+    void unhandled_exception() noexcept {
+      UNREACHABLE();
+    }
+  };
+};
+
+namespace detail {
+
+// owns a suspended coroutine until it is resumed
+class CoroutineResumer {
+ public:
+  explicit CoroutineResumer(std::coroutine_handle<> handle) : handle_(handle) {
+  }
+  CoroutineResumer(const CoroutineResumer &) = delete;
+  CoroutineResumer &operator=(const CoroutineResumer &) = delete;
+  CoroutineResumer(CoroutineResumer &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+  }
+  CoroutineResumer &operator=(CoroutineResumer &&other) noexcept {
+    if (this != &other) {
+      reset();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  ~CoroutineResumer() {
+    reset();
+  }
+
+  void resume() {
+    CHECK(handle_);
+    std::exchange(handle_, nullptr).resume();
+  }
+
+ private:
+  std::coroutine_handle<> handle_;
+
+  void reset() {
+    if (handle_) {
+      std::exchange(handle_, nullptr).destroy();
+    }
+  }
+};
+
+}  // namespace detail
+
+template <class T, class StartFunctionT>
+class PromiseAwaiter {
+ public:
+  PromiseAwaiter(ActorId<> actor_id, StartFunctionT start_function)
+      : actor_id_(std::move(actor_id)), start_function_(std::move(start_function)) {
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    start_function_(PromiseCreator::lambda([actor_id = std::move(actor_id_), result = &result_,
+                                            resumer = detail::CoroutineResumer(handle)](Result<T> r_value) mutable {
+      send_lambda(actor_id, [result, r_value = std::move(r_value), resumer = std::move(resumer)]() mutable {
+        *result = std::move(r_value);
+        resumer.resume();
+      });
+    }));
+  }
+
+  Result<T> await_resume() {
+    return std::move(result_);
+  }
+
+ private:
+  ActorId<> actor_id_;
+  StartFunctionT start_function_;
+  Result<T> result_;
+};
+
+// start_function receives a Promise<T> and must start the operation; the coroutine is resumed by the actor actor_id
+template <class T, class ActorT, class StartFunctionT>
+PromiseAwaiter<T, std::decay_t<StartFunctionT>> await_promise(const ActorId<ActorT> &actor_id,
+                                                              StartFunctionT &&start_function) {
+  return PromiseAwaiter<T, std::decay_t<StartFunctionT>>(static_cast<ActorId<>>(actor_id),
+                                                         std::forward<StartFunctionT>(start_function));
+}
+
+}  // namespace td
+
+#endif
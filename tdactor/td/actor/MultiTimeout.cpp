@@ -18,7 +18,16 @@ void MultiTimeout::set_timeout_at(int64 key, double timeout) {
   LOG(DEBUG) << "Set " << get_name() << " for " << key << " in " << timeout - Time::now();
   auto item = items_.emplace(key);
   auto heap_node = static_cast<HeapNode *>(const_cast<Item *>(&*item.first));
-  if (heap_node->in_heap()) {
+  if (use_timer_wheel_) {
+    if (heap_node->in_heap()) {
+      CHECK(!item.second);
+      timer_wheel_.fix(timeout, heap_node);
+    } else {
+      CHECK(item.second);
+      timer_wheel_.insert(timeout, heap_node);
+    }
+    update_timeout("set_timeout 3");
+  } else if (heap_node->in_heap()) {
     CHECK(!item.second);
     bool need_update_timeout = heap_node->is_top();
     timeout_queue_.fix(timeout, heap_node);
@@ -42,9 +51,14 @@ void MultiTimeout::add_timeout_at(int64 key, double timeout) {
     CHECK(!item.second);
   } else {
     CHECK(item.second);
-    timeout_queue_.insert(timeout, heap_node);
-    if (heap_node->is_top()) {
-      update_timeout("add_timeout");
+    if (use_timer_wheel_) {
+      timer_wheel_.insert(timeout, heap_node);
+      update_timeout("add_timeout 2");
+    } else {
+      timeout_queue_.insert(timeout, heap_node);
+      if (heap_node->is_top()) {
+        update_timeout("add_timeout");
+      }
     }
   }
 }
@@ -55,8 +69,12 @@ void MultiTimeout::cancel_timeout(int64 key) {
   if (item != items_.end()) {
     auto heap_node = static_cast<HeapNode *>(const_cast<Item *>(&*item));
     CHECK(heap_node->in_heap());
-    bool need_update_timeout = heap_node->is_top();
-    timeout_queue_.erase(heap_node);
+    bool need_update_timeout = use_timer_wheel_ || heap_node->is_top();
+    if (use_timer_wheel_) {
+      timer_wheel_.erase(heap_node);
+    } else {
+      timeout_queue_.erase(heap_node);
+    }
     items_.erase(item);
 
     if (need_update_timeout) {
@@ -68,17 +86,30 @@ void MultiTimeout::cancel_timeout(int64 key) {
 void MultiTimeout::update_timeout(const char *source) {
   if (items_.empty()) {
     LOG(DEBUG) << "Cancel timeout of " << get_name();
-    LOG_CHECK(timeout_queue_.empty()) << get_name() << ' ' << source;
+    LOG_CHECK(timeout_queue_.empty() && timer_wheel_.empty()) << get_name() << ' ' << source;
     LOG_CHECK(Actor::has_timeout()) << get_name() << ' ' << source;
     Actor::cancel_timeout();
   } else {
-    LOG(DEBUG) << "Set timeout of " << get_name() << " in " << timeout_queue_.top_key() - Time::now_cached();
-    Actor::set_timeout_at(timeout_queue_.top_key());
+    auto timeout_at = use_timer_wheel_ ? timer_wheel_.get_wakeup_at() : timeout_queue_.top_key();
+    LOG(DEBUG) << "Set timeout of " << get_name() << " in " << timeout_at - Time::now_cached();
+    Actor::set_timeout_at(timeout_at);
   }
 }
 
 vector<int64> MultiTimeout::get_expired_keys(double now) {
   vector<int64> expired_keys;
+  if (use_timer_wheel_) {
+    while (true) {
+      auto item = static_cast<Item *>(timer_wheel_.pop_expired(now));
+      if (item == nullptr) {
+        break;
+      }
+      int64 key = item->key;
+      items_.erase(Item(key));
+      expired_keys.push_back(key);
+    }
+    return expired_keys;
+  }
   while (!timeout_queue_.empty() && timeout_queue_.top_key() < now) {
     int64 key = static_cast<Item *>(timeout_queue_.pop())->key;
     items_.erase(Item(key));
@@ -98,7 +129,17 @@ void MultiTimeout::timeout_expired() {
 }
 
 void MultiTimeout::run_all() {
-  vector<int64> expired_keys = get_expired_keys(Time::now_cached() + 1e10);
+  vector<int64> expired_keys;
+  if (use_timer_wheel_) {
+    // the timer wheel can't be advanced to the far future, so all items are removed directly
+    for (auto &item : items_) {
+      timer_wheel_.erase(const_cast<Item *>(&item));
+      expired_keys.push_back(item.key);
+    }
+    items_.clear();
+  } else {
+    expired_keys = get_expired_keys(Time::now_cached() + 1e10);
+  }
   if (!expired_keys.empty()) {
     update_timeout("run_all");
   }
@@ -12,6 +12,7 @@
 #include "td/utils/Heap.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Time.h"
+#include "td/utils/TimerWheel.h"
 
 #include <set>
 
@@ -33,7 +34,7 @@ class MultiTimeout final : public Actor {
  public:
   using Data = void *;
   using Callback = void (*)(Data, int64);
-  explicit MultiTimeout(Slice name) {
+  explicit MultiTimeout(Slice name) : use_timer_wheel_(Scheduler::instance()->use_timer_wheel()) {
     register_actor(name, this).release();
   }
 
@@ -68,7 +69,9 @@ class MultiTimeout final : public Actor {
   Callback callback_;
   Data data_;
 
+  bool use_timer_wheel_ = false;
   KHeap<double> timeout_queue_;
+  TimerWheel timer_wheel_;
   std::set<Item> items_;
 
   void update_timeout(const char *source);
@@ -0,0 +1,171 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/actor/RequestTracer.h"
+
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/logging.h"
+#include "td/utils/ThreadLocalStorage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace td {
+
+namespace {
+
+struct TraceSpan {
+  uint32 trace_id = 0;
+  uint32 name_size = 0;
+  double begin_time = 0.0;
+  double end_time = 0.0;
+  char name[RequestTracer::MAX_SPAN_NAME_SIZE + 1];
+};
+
+// the slot contains the i-th span of the thread if its version is 2 * i + 2
+// and is being overwritten if its version is odd
+struct TraceSlot {
+  std::atomic<uint64> version{0};
+  TraceSpan span;
+};
+
+// is written only by the owning thread, but can be read by any thread
+struct ThreadTraceBuffer {
+  std::atomic<TraceSlot *> slots{nullptr};
+  std::atomic<uint64> write_count{0};
+  std::atomic<uint64> clear_count{0};
+
+  ThreadTraceBuffer() = default;
+  ThreadTraceBuffer(const ThreadTraceBuffer &) = delete;
+  ThreadTraceBuffer &operator=(const ThreadTraceBuffer &) = delete;
+  ThreadTraceBuffer(ThreadTraceBuffer &&) = delete;
+  ThreadTraceBuffer &operator=(ThreadTraceBuffer &&) = delete;
+  ~ThreadTraceBuffer() {
+    delete[] slots.load(std::memory_order_relaxed);
+  }
+};
+
+ThreadLocalStorage<ThreadTraceBuffer> &get_thread_trace_buffers() {
+  static ThreadLocalStorage<ThreadTraceBuffer> buffers;
+  return buffers;
+}
+
+}  // namespace
+
+std::atomic<bool> RequestTracer::is_enabled_{false};
+std::atomic<uint32> RequestTracer::sampling_period_{1};
+std::atomic<uint32> RequestTracer::request_count_{0};
+std::atomic<uint32> RequestTracer::last_trace_id_{0};
+TD_THREAD_LOCAL uint32 RequestTracer::current_trace_id_;  // static zero-initialized
+
+void RequestTracer::set_enabled(bool is_enabled, int32 sampling_period) {
+  CHECK(sampling_period > 0);
+  sampling_period_.store(static_cast<uint32>(sampling_period), std::memory_order_relaxed);
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+uint32 RequestTracer::start_trace() {
+  auto request_number = request_count_.fetch_add(1, std::memory_order_relaxed);
+  if (request_number % sampling_period_.load(std::memory_order_relaxed) != 0) {
+    return 0;
+  }
+  auto trace_id = last_trace_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (trace_id == 0) {
+    trace_id = last_trace_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  return trace_id;
+}
+
+void RequestTracer::add_span(uint32 trace_id, Slice name, double begin_time, double end_time) {
+  CHECK(trace_id != 0);
+  auto &buffer = get_thread_trace_buffers().get();
+  auto slots = buffer.slots.load(std::memory_order_relaxed);
+  if (slots == nullptr) {
+    slots = new TraceSlot[THREAD_BUFFER_SIZE];
+    buffer.slots.store(slots, std::memory_order_release);
+  }
+
+  auto index = buffer.write_count.load(std::memory_order_relaxed);
+  auto &slot = slots[index % THREAD_BUFFER_SIZE];
+  slot.version.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  auto &span = slot.span;
+  span.trace_id = trace_id;
+  span.name_size = static_cast<uint32>(std::min(name.size(), MAX_SPAN_NAME_SIZE));
+  std::memcpy(span.name, name.data(), span.name_size);
+  span.begin_time = begin_time;
+  span.end_time = end_time;
+  slot.version.store(2 * index + 2, std::memory_order_release);
+  buffer.write_count.store(index + 1, std::memory_order_release);
+}
+
+string RequestTracer::get_chrome_trace() {
+  vector<std::pair<int32, TraceSpan>> spans;
+  int32 thread_index = 0;
+  get_thread_trace_buffers().for_each([&spans, &thread_index](ThreadTraceBuffer &buffer) {
+    thread_index++;
+    auto slots = buffer.slots.load(std::memory_order_acquire);
+    if (slots == nullptr) {
+      return;
+    }
+    auto write_count = buffer.write_count.load(std::memory_order_acquire);
+    auto begin = std::max(buffer.clear_count.load(std::memory_order_relaxed),
+                          write_count < THREAD_BUFFER_SIZE ? 0 : write_count - THREAD_BUFFER_SIZE);
+    for (auto index = begin; index < write_count; index++) {
+      auto &slot = slots[index % THREAD_BUFFER_SIZE];
+      auto version = slot.version.load(std::memory_order_acquire);
+      if (version != 2 * index + 2) {
+        // the span has already been overwritten
+        continue;
+      }
+      TraceSpan span;
+      std::memcpy(&span, &slot.span, sizeof(span));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.version.load(std::memory_order_relaxed) != version) {
+        continue;
+      }
+      span.name_size = static_cast<uint32>(std::min(static_cast<size_t>(span.name_size), MAX_SPAN_NAME_SIZE));
+      spans.emplace_back(thread_index, span);
+    }
+  });
+
+  JsonBuilder jb;
+  {
+    auto jo = jb.enter_object();
+    jo("displayTimeUnit", "ms");
+    jo("traceEvents", json_array([&spans](auto &events) {
+         for (auto &it : spans) {
+           auto &span = it.second;
+           events(json_object([&](auto &event) {
+             event("name", Slice(span.name, span.name_size));
+             event("cat", "td");
+             if (span.end_time > span.begin_time) {
+               event("ph", "X");
+               event("dur", JsonFloat((span.end_time - span.begin_time) * 1e6));
+             } else {
+               event("ph", "i");
+               event("s", "t");
+             }
+             event("ts", JsonFloat(span.begin_time * 1e6));
+             event("pid", JsonInt(1));
+             event("tid", JsonInt(it.first));
+             event("args", json_object([&span](auto &args) { args("trace_id", JsonLong(span.trace_id)); }));
+           }));
+         }
+       }));
+  }
+  LOG_IF(ERROR, jb.string_builder().is_error()) << "Failed to build request trace";
+  return jb.string_builder().as_cslice().str();
+}
+
+void RequestTracer::clear() {
+  get_thread_trace_buffers().for_each([](ThreadTraceBuffer &buffer) {
+    buffer.clear_count.store(buffer.write_count.load(std::memory_order_acquire), std::memory_order_relaxed);
+  });
+}
+
+}  // namespace td
@@ -0,0 +1,73 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Slice.h"
+
+#include <atomic>
+
+namespace td {
+
+// Follows sampled requests through actor events, network queries and database requests
+// Each traced request has a non-zero trace identifier, which is propagated with all events sent while it is current
+// Spans are stored in per-thread ring buffers without locking and are exported in Chrome trace event format
+// Tracing is disabled by default and costs a relaxed atomic load per sent event when disabled
+class RequestTracer {
+ public:
+  static constexpr size_t MAX_SPAN_NAME_SIZE = 47;
+  static constexpr size_t THREAD_BUFFER_SIZE = 1 << 12;
+
+  class Guard {
+   public:
+    explicit Guard(uint32 trace_id) : old_trace_id_(current_trace_id_) {
+      current_trace_id_ = trace_id;
+    }
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+    Guard(Guard &&) = delete;
+    Guard &operator=(Guard &&) = delete;
+    ~Guard() {
+      current_trace_id_ = old_trace_id_;
+    }
+
+   private:
+    uint32 old_trace_id_;
+  };
+
+  // only every sampling_period-th started request is traced
+  static void set_enabled(bool is_enabled, int32 sampling_period);
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // returns 0 if the request must not be traced
+  static uint32 start_trace();
+
+  static uint32 get_current_trace_id() {
+    return current_trace_id_;
+  }
+
+  // the span is shown as an instant event if begin_time == end_time
+  static void add_span(uint32 trace_id, Slice name, double begin_time, double end_time);
+
+  // returns all stored spans in Chrome trace event format
+  static string get_chrome_trace();
+
+  static void clear();
+
+ private:
+  static std::atomic<bool> is_enabled_;
+  static std::atomic<uint32> sampling_period_;
+  static std::atomic<uint32> request_count_;
+  static std::atomic<uint32> last_trace_id_;
+  static TD_THREAD_LOCAL uint32 current_trace_id_;
+};
+
+}  // namespace td
@@ -74,6 +74,10 @@ class Actor : public ObserverBase {
   void migrate(int32 sched_id);
   void do_migrate(int32 sched_id);
 
+  // allows the scheduler to move the actor to an idle scheduler in work-stealing mode
+  // the actor must not rely on being always run on the same thread
+  void set_migratable(bool is_migratable);
+
   uint64 get_link_token();
   std::weak_ptr<ActorContext> get_context_weak_ptr() const;
   std::shared_ptr<ActorContext> set_context(std::shared_ptr<ActorContext> context);
@@ -72,6 +72,9 @@ inline void Actor::migrate(int32 sched_id) {
 inline void Actor::do_migrate(int32 sched_id) {
   Scheduler::instance()->do_migrate_actor(this, sched_id);
 }
+inline void Actor::set_migratable(bool is_migratable) {
+  get_info()->set_migratable(is_migratable);
+}
 
 template <class ActorType>
 std::enable_if_t<std::is_base_of<Actor, ActorType>::value> start_migrate(ActorType &obj, int32 sched_id) {
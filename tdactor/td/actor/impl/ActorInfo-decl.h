@@ -104,22 +104,34 @@ class ActorInfo final
   void finish_run();
 
   vector<Event> mailbox_;
+  // events sent with priority; they are handled before events from mailbox_
+  vector<Event> priority_mailbox_;
+
+  bool has_mailbox_events() const;
+  void add_to_mailbox(Event &&event);
 
   bool need_context() const;
   bool need_start_up() const;
 
+  void set_migratable(bool is_migratable);
+  bool is_migratable() const;
+
+  // time when the first event was added to the empty mailbox; used only for actor statistics
+  void set_ready_time(double ready_time);
+  double get_ready_time() const;
+
  private:
   Deleter deleter_ = Deleter::None;
   bool need_context_ = true;
   bool need_start_up_ = true;
   bool is_running_ = false;
+  bool is_migratable_ = false;
 
   std::atomic<int32> sched_id_{0};
   Actor *actor_ = nullptr;
 
-#ifdef TD_DEBUG
   string name_;
-#endif
+  double ready_time_ = 0.0;
   std::shared_ptr<ActorContext> context_;
 };
 
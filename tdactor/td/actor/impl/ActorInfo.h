@@ -41,15 +41,15 @@ inline void ActorInfo::init(int32 sched_id, Slice name, ObjectPool<ActorInfo>::O
     context_ = Scheduler::context()->this_ptr_.lock();
     VLOG(actor) << "Set context " << context_.get() << " for " << name;
   }
-#ifdef TD_DEBUG
   name_.assign(name.data(), name.size());
-#endif
 
   actor_->init(std::move(this_ptr));
   deleter_ = deleter;
   need_context_ = need_context;
   need_start_up_ = need_start_up;
   is_running_ = false;
+  is_migratable_ = false;
+  ready_time_ = 0.0;
 }
 
 inline bool ActorInfo::need_context() const {
@@ -60,12 +60,40 @@ inline bool ActorInfo::need_start_up() const {
   return need_start_up_;
 }
 
+inline void ActorInfo::set_migratable(bool is_migratable) {
+  is_migratable_ = is_migratable;
+}
+
+inline bool ActorInfo::is_migratable() const {
+  return is_migratable_;
+}
+
+inline void ActorInfo::set_ready_time(double ready_time) {
+  ready_time_ = ready_time;
+}
+
+inline double ActorInfo::get_ready_time() const {
+  return ready_time_;
+}
+
 inline void ActorInfo::on_actor_moved(Actor *actor_new_ptr) {
   actor_ = actor_new_ptr;
 }
 
+inline bool ActorInfo::has_mailbox_events() const {
+  return !mailbox_.empty() || !priority_mailbox_.empty();
+}
+
+inline void ActorInfo::add_to_mailbox(Event &&event) {
+  if (event.is_priority) {
+    priority_mailbox_.push_back(std::move(event));
+  } else {
+    mailbox_.push_back(std::move(event));
+  }
+}
+
 inline void ActorInfo::clear() {
-  CHECK(mailbox_.empty());
+  CHECK(!has_mailbox_events());
   CHECK(!actor_);
   CHECK(!is_running());
   CHECK(!is_migrating());
@@ -89,6 +117,7 @@ inline void ActorInfo::destroy_actor() {
   }
   actor_ = nullptr;
   mailbox_.clear();
+  priority_mailbox_.clear();
 }
 
 template <class ActorT>
@@ -164,11 +193,7 @@ inline ActorContext *ActorInfo::get_context() {
 }
 
 inline CSlice ActorInfo::get_name() const {
-#ifdef TD_DEBUG
   return name_;
-#else
-  return "";
-#endif
 }
 
 inline void ActorInfo::start_run() {
@@ -0,0 +1,115 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/actor/impl/Event.h"
+
+#include "td/utils/port/thread_local.h"
+
+#include <array>
+#include <new>
+
+namespace td {
+
+namespace {
+
+// Per-thread cache of memory blocks of destroyed custom events.
+// Most events are created and destroyed by the same scheduler thread, so in the steady state
+// delayed closures are sent without any calls to the global allocator.
+class CustomEventCache {
+ public:
+  static constexpr size_t MIN_BLOCK_SIZE_LOG = 5;
+  static constexpr int BUCKET_COUNT = 4;  // 32, 64, 128 and 256 bytes
+  static constexpr size_t MAX_BUCKET_SIZE = 256;
+
+  CustomEventCache() = default;
+  CustomEventCache(const CustomEventCache &) = delete;
+  CustomEventCache &operator=(const CustomEventCache &) = delete;
+  CustomEventCache(CustomEventCache &&) = delete;
+  CustomEventCache &operator=(CustomEventCache &&) = delete;
+  ~CustomEventCache() {
+    for (auto &bucket : buckets_) {
+      while (bucket.head != nullptr) {
+        auto next = bucket.head->next;
+        ::operator delete(bucket.head);
+        bucket.head = next;
+      }
+    }
+  }
+
+  static int get_bucket_id(size_t size) {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+      if (size <= get_block_size(i)) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static size_t get_block_size(int bucket_id) {
+    return static_cast<size_t>(1) << (MIN_BLOCK_SIZE_LOG + bucket_id);
+  }
+
+  void *pop(int bucket_id) {
+    auto &bucket = buckets_[bucket_id];
+    auto result = bucket.head;
+    if (result == nullptr) {
+      return nullptr;
+    }
+    bucket.head = result->next;
+    bucket.size--;
+    return result;
+  }
+
+  bool push(int bucket_id, void *ptr) {
+    auto &bucket = buckets_[bucket_id];
+    if (bucket.size >= MAX_BUCKET_SIZE) {
+      return false;
+    }
+    auto block = static_cast<Block *>(ptr);
+    block->next = bucket.head;
+    bucket.head = block;
+    bucket.size++;
+    return true;
+  }
+
+ private:
+  struct Block {
+    Block *next;
+  };
+  struct Bucket {
+    Block *head = nullptr;
+    size_t size = 0;
+  };
+  std::array<Bucket, BUCKET_COUNT> buckets_;
+};
+
+TD_THREAD_LOCAL CustomEventCache *custom_event_cache;  // static zero-initialized
+
+}  // namespace
+
+void *CustomEvent::operator new(size_t size) {
+  auto bucket_id = CustomEventCache::get_bucket_id(size);
+  if (bucket_id < 0) {
+    return ::operator new(size);
+  }
+  init_thread_local<CustomEventCache>(custom_event_cache);
+  auto ptr = custom_event_cache->pop(bucket_id);
+  if (ptr == nullptr) {
+    ptr = ::operator new(CustomEventCache::get_block_size(bucket_id));
+  }
+  return ptr;
+}
+
+void CustomEvent::operator delete(void *ptr, size_t size) {
+  auto bucket_id = CustomEventCache::get_bucket_id(size);
+  // the cache isn't created here, because an event can be destroyed during destruction of thread local variables
+  if (bucket_id >= 0 && custom_event_cache != nullptr && custom_event_cache->push(bucket_id, ptr)) {
+    return;
+  }
+  ::operator delete(ptr);
+}
+
+}  // namespace td
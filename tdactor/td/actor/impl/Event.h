@@ -19,7 +19,7 @@ class Actor;
 
 // Events
 //
-// Small structure (up to 16 bytes) used to send events between actors.
+// Small structure (up to 24 bytes) used to send events between actors.
 //
 // There are some predefined types of events:
 // NoType -- unitialized event
@@ -47,6 +47,10 @@ class CustomEvent {
   CustomEvent &operator=(CustomEvent &&) = delete;
   virtual ~CustomEvent() = default;
 
+  // small events are allocated from a per-thread cache of freed blocks to avoid global allocator calls
+  static void *operator new(size_t size);
+  static void operator delete(void *ptr, size_t size);
+
   virtual void run(Actor *actor) = 0;
   virtual void start_migrate(int32 sched_id) {
   }
@@ -98,8 +102,10 @@ class LambdaEvent final : public CustomEvent {
 
 class Event {
  public:
-  enum class Type { NoType, Start, Stop, Yield, Timeout, Hangup, Raw, Custom };
+  enum class Type : uint8 { NoType, Start, Stop, Yield, Timeout, Hangup, Raw, Custom };
   Type type;
+  bool is_priority = false;  // the event is handled before ordinary events, which are already in the actor mailbox
+  uint32 trace_id = 0;       // identifier of the traced request, which has sent the event, see RequestTracer
   uint64 link_token = 0;
   union Raw {
     void *ptr;
@@ -157,12 +163,19 @@ class Event {
   }
   Event(const Event &other) = delete;
   Event &operator=(const Event &) = delete;
-  Event(Event &&other) noexcept : type(other.type), link_token(other.link_token), data(other.data) {
+  Event(Event &&other) noexcept
+      : type(other.type)
+      , is_priority(other.is_priority)
+      , trace_id(other.trace_id)
+      , link_token(other.link_token)
+      , data(other.data) {
     other.type = Type::NoType;
   }
   Event &operator=(Event &&other) noexcept {
     destroy();
     type = other.type;
+    is_priority = other.is_priority;
+    trace_id = other.trace_id;
     link_token = other.link_token;
     data = other.data;
     other.type = Type::NoType;
@@ -186,6 +199,11 @@ class Event {
     return *this;
   }
 
+  Event &set_priority() {
+    is_priority = true;
+    return *this;
+  }
+
   friend void start_migrate(Event &obj, int32 sched_id) {
     if (obj.type == Type::Custom) {
       obj.data.custom_event->start_migrate(sched_id);
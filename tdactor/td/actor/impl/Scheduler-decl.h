@@ -26,8 +26,10 @@
 #include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Time.h"
+#include "td/utils/TimerWheel.h"
 #include "td/utils/type_traits.h"
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <type_traits>
@@ -71,6 +73,27 @@ class Scheduler {
     virtual void on_finish() = 0;
     virtual void register_at_finish(std::function<void()>) = 0;
   };
+
+  // shared by all schedulers of a ConcurrentScheduler in work-stealing mode
+  class WorkStealingInfo {
+   public:
+    explicit WorkStealingInfo(int32 sched_count);
+
+    // called by a scheduler before and after it waits for new events
+    void set_idle(int32 sched_id, bool is_idle);
+
+    // called by an overloaded scheduler; returns identifier of the claimed idle scheduler or -1
+    int32 acquire_idle_scheduler(int32 sched_id);
+
+   private:
+    struct SchedulerState {
+      std::atomic<bool> is_idle{false};
+      char pad[TD_CONCURRENCY_PAD - sizeof(std::atomic<bool>)];
+    };
+    int32 sched_count_;
+    std::unique_ptr<SchedulerState[]> states_;
+  };
+
   Scheduler() = default;
   Scheduler(const Scheduler &) = delete;
   Scheduler &operator=(const Scheduler &) = delete;
@@ -82,6 +105,14 @@ class Scheduler {
   void init(int32 id, std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound, Callback *callback);
   void clear();
 
+  void set_work_stealing_info(std::shared_ptr<WorkStealingInfo> work_stealing_info, bool can_steal);
+
+  // stores actor timeouts in a TimerWheel instead of a heap; must be called before any timeout is set
+  void set_use_timer_wheel(bool use_timer_wheel);
+  bool use_timer_wheel() const {
+    return use_timer_wheel_;
+  }
+
   int32 sched_id() const;
   int32 sched_count() const;
 
@@ -99,6 +130,7 @@ class Scheduler {
 
   void send_to_scheduler(int32 sched_id, const ActorId<> &actor_id, Event &&event);
   void send_to_other_scheduler(int32 sched_id, const ActorId<> &actor_id, Event &&event);
+  void flush_outbound_events();
 
   void run_on_scheduler(int32 sched_id, Promise<Unit> action);  // TODO Action
 
@@ -114,6 +146,10 @@ class Scheduler {
   template <ActorSendType send_type, class EventT>
   void send_closure(ActorRef actor_ref, EventT &&closure);
 
+  // the closure is handled before ordinary events, which are already in the actor mailbox
+  template <class EventT>
+  void send_priority_closure(ActorRef actor_ref, EventT &&closure);
+
   template <ActorSendType send_type>
   void send(ActorRef actor_ref, Event &&event);
 
@@ -154,9 +190,14 @@ class Scheduler {
   Timestamp get_timeout();
 
  private:
+  static constexpr int MIN_INBOUND_SPIN_COUNT = 16;
+  static constexpr int MAX_INBOUND_SPIN_COUNT = 1 << 14;
+
   static void set_scheduler(Scheduler *scheduler);
 
   void destroy_on_scheduler_impl(int32 sched_id, Promise<Unit> action);
+  void flush_retired_objects();
+  void reclaim_on_scheduler(int32 sched_id, vector<Promise<Unit>> actions);
 
   class ServiceActor final : public Actor {
    public:
@@ -173,6 +214,7 @@ class Scheduler {
   friend class ServiceActor;
 
   void do_event(ActorInfo *actor, Event &&event);
+  void do_traced_event(ActorInfo *actor_info, Event &&event);
 
   void enter_actor(ActorInfo *actor_info);
   void exit_actor(ActorInfo *actor_info);
@@ -202,6 +244,7 @@ class Scheduler {
 
   Timestamp run_timeout();
   void run_mailbox();
+  void share_ready_actors(ListNode &actors_list);
   Timestamp run_events(Timestamp timeout);
   void run_poll(Timestamp timeout);
 
@@ -219,6 +262,8 @@ class Scheduler {
   ListNode pending_actors_list_;
   ListNode ready_actors_list_;
   KHeap<double> timeout_queue_;
+  TimerWheel timer_wheel_;
+  bool use_timer_wheel_ = false;
 
   FlatHashMap<ActorInfo *, std::vector<Event>> pending_events_;
 
@@ -232,8 +277,23 @@ class Scheduler {
   int32 sched_id_ = 0;
   int32 sched_n_ = 0;
   std::shared_ptr<MpscPollableQueue<EventFull>> inbound_queue_;
+  // number of iterations to busy-wait for inbound events before sleeping in poll; adapts to recent wakeups
+  int inbound_spin_count_ = MIN_INBOUND_SPIN_COUNT;
   std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound_queues_;
 
+  // events to other schedulers are collected during an event loop iteration and are sent in one batch
+  bool batch_outbound_events_ = false;
+  bool has_outbound_events_ = false;
+  std::vector<std::vector<EventFull>> outbound_events_;
+
+  // objects passed to destroy_on_scheduler during an event loop iteration are destroyed by one actor per scheduler
+  bool batch_retired_objects_ = false;
+  bool has_retired_objects_ = false;
+  std::vector<std::vector<Promise<Unit>>> retired_objects_;
+
+  std::shared_ptr<WorkStealingInfo> work_stealing_info_;
+  bool can_steal_ = false;
+
   std::shared_ptr<ActorContext> save_context_;
 
   struct EventContext {
@@ -274,6 +334,18 @@ void send_closure(ActorIdT &&actor_id, FunctionT function, ArgsT &&...args) {
       std::forward<ActorIdT>(actor_id), create_immediate_closure(function, std::forward<ArgsT>(args)...));
 }
 
+// like send_closure, but the closure is handled before ordinary events, which are already in the actor mailbox,
+// so a user-facing request or a control event doesn't wait for queued background events
+template <class ActorIdT, class FunctionT, class... ArgsT>
+void send_closure_priority(ActorIdT &&actor_id, FunctionT function, ArgsT &&...args) {
+  using ActorT = typename std::decay_t<ActorIdT>::ActorT;
+  using FunctionClassT = member_function_class_t<FunctionT>;
+  static_assert(std::is_base_of<FunctionClassT, ActorT>::value, "unsafe send_closure");
+
+  Scheduler::instance()->send_priority_closure(std::forward<ActorIdT>(actor_id),
+                                               create_immediate_closure(function, std::forward<ArgsT>(args)...));
+}
+
 template <class ActorIdT, class FunctionT, class... ArgsT>
 void send_closure_later(ActorIdT &&actor_id, FunctionT function, ArgsT &&...args) {
   using ActorT = typename std::decay_t<ActorIdT>::ActorT;
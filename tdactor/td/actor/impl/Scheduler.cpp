@@ -6,20 +6,24 @@
 //
 #include "td/actor/impl/Scheduler.h"
 
+#include "td/actor/ActorStatistics.h"
 #include "td/actor/impl/Actor.h"
 #include "td/actor/impl/ActorId.h"
 #include "td/actor/impl/ActorInfo.h"
 #include "td/actor/impl/Event.h"
 #include "td/actor/impl/EventFull.h"
+#include "td/actor/RequestTracer.h"
 
 #include "td/utils/common.h"
 #include "td/utils/ExitGuard.h"
 #include "td/utils/format.h"
 #include "td/utils/List.h"
 #include "td/utils/logging.h"
+#include "td/utils/Metrics.h"
 #include "td/utils/misc.h"
 #include "td/utils/MpscPollableQueue.h"
 #include "td/utils/ObjectPool.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Promise.h"
 #include "td/utils/ScopeGuard.h"
@@ -37,6 +41,8 @@ int VERBOSITY_NAME(actor) = VERBOSITY_NAME(DEBUG) + 10;
 TD_THREAD_LOCAL Scheduler *Scheduler::scheduler_;   // static zero-initialized
 TD_THREAD_LOCAL ActorContext *Scheduler::context_;  // static zero-initialized
 
+static MetricCounter actor_event_count_metric("td_actor_events_total", "Number of events processed by actors");
+
 Scheduler::~Scheduler() {
   clear();
 }
@@ -117,6 +123,27 @@ void Scheduler::ServiceActor::tear_down() {
 #endif
 }
 
+/*** WorkStealingInfo ***/
+Scheduler::WorkStealingInfo::WorkStealingInfo(int32 sched_count)
+    : sched_count_(sched_count), states_(new SchedulerState[sched_count]) {
+}
+
+void Scheduler::WorkStealingInfo::set_idle(int32 sched_id, bool is_idle) {
+  CHECK(0 <= sched_id && sched_id < sched_count_);
+  states_[sched_id].is_idle.store(is_idle, std::memory_order_relaxed);
+}
+
+int32 Scheduler::WorkStealingInfo::acquire_idle_scheduler(int32 sched_id) {
+  for (int32 i = 1; i < sched_count_; i++) {
+    auto other_sched_id = (sched_id + i) % sched_count_;
+    auto &is_idle = states_[other_sched_id].is_idle;
+    if (is_idle.load(std::memory_order_relaxed) && is_idle.exchange(false, std::memory_order_acquire)) {
+      return other_sched_id;
+    }
+  }
+  return -1;
+}
+
 /*** SchedlerGuard ***/
 SchedulerGuard::SchedulerGuard(Scheduler *scheduler, bool lock) : scheduler_(scheduler) {
   if (lock) {
@@ -164,7 +191,7 @@ EventGuard::~EventGuard() {
   auto info = event_context_.actor_info;
   auto node = info->get_list_node();
   node->remove();
-  if (info->mailbox_.empty()) {
+  if (!info->has_mailbox_events()) {
     scheduler_->pending_actors_list_.put(node);
   } else {
     scheduler_->ready_actors_list_.put(node);
@@ -223,14 +250,30 @@ void Scheduler::init(int32 id, std::vector<std::shared_ptr<MpscPollableQueue<Eve
 
   if (!outbound.empty()) {
     inbound_queue_ = std::move(outbound[id]);
+#if !TD_THREAD_UNSUPPORTED
+    // spinning can't help if there is no other CPU to run the sender
+    inbound_spin_count_ = thread::hardware_concurrency() > 1 ? MIN_INBOUND_SPIN_COUNT : 0;
+#endif
   }
   outbound_queues_ = std::move(outbound);
   sched_id_ = id;
   sched_n_ = static_cast<int32>(outbound_queues_.size());
+  outbound_events_.resize(outbound_queues_.size());
+  retired_objects_.resize(max(sched_n_, static_cast<int32>(1)));
   service_actor_.set_queue(inbound_queue_);
   register_actor("ServiceActor", &service_actor_).release();
 }
 
+void Scheduler::set_work_stealing_info(std::shared_ptr<WorkStealingInfo> work_stealing_info, bool can_steal) {
+  work_stealing_info_ = std::move(work_stealing_info);
+  can_steal_ = can_steal && work_stealing_info_ != nullptr;
+}
+
+void Scheduler::set_use_timer_wheel(bool use_timer_wheel) {
+  CHECK(timeout_queue_.empty() && timer_wheel_.empty());
+  use_timer_wheel_ = use_timer_wheel;
+}
+
 void Scheduler::clear() {
   if (service_actor_.empty()) {
     return;
@@ -262,6 +305,10 @@ void Scheduler::clear() {
 }
 
 void Scheduler::do_event(ActorInfo *actor_info, Event &&event) {
+  if (unlikely(event.trace_id != 0)) {
+    return do_traced_event(actor_info, std::move(event));
+  }
+  actor_event_count_metric.add();
   event_context_ptr_->link_token = event.link_token;
   auto actor = actor_info->get_actor_unsafe();
   VLOG(actor) << *actor_info << ' ' << event;
@@ -299,6 +346,17 @@ void Scheduler::do_event(ActorInfo *actor_info, Event &&event) {
   // can't clear event here. It may be already destroyed during destroy_actor
 }
 
+void Scheduler::do_traced_event(ActorInfo *actor_info, Event &&event) {
+  // the actor can be destroyed during the event
+  string name = actor_info->get_name().str();
+  auto trace_id = event.trace_id;
+  event.trace_id = 0;
+  RequestTracer::Guard guard(trace_id);
+  auto start_time = Time::now();
+  do_event(actor_info, std::move(event));
+  RequestTracer::add_span(trace_id, name, start_time, Time::now());
+}
+
 void Scheduler::register_migrated_actor(ActorInfo *actor_info) {
   VLOG(actor) << "Register migrated actor: " << tag("name", *actor_info) << tag("ptr", actor_info)
               << tag("actor_count", actor_count_);
@@ -312,13 +370,17 @@ void Scheduler::register_migrated_actor(ActorInfo *actor_info) {
   for (auto &event : actor_info->mailbox_) {
     finish_migrate(event);
   }
+  for (auto &event : actor_info->priority_mailbox_) {
+    finish_migrate(event);
+  }
   auto it = pending_events_.find(actor_info);
   if (it != pending_events_.end()) {
-    actor_info->mailbox_.insert(actor_info->mailbox_.end(), std::make_move_iterator(it->second.begin()),
-                                std::make_move_iterator(it->second.end()));
+    for (auto &event : it->second) {
+      actor_info->add_to_mailbox(std::move(event));
+    }
     pending_events_.erase(it);
   }
-  if (actor_info->mailbox_.empty()) {
+  if (!actor_info->has_mailbox_events()) {
     pending_actors_list_.put(actor_info->get_list_node());
   } else {
     ready_actors_list_.put(actor_info->get_list_node());
@@ -335,11 +397,28 @@ void Scheduler::send_to_other_scheduler(int32 sched_id, const ActorId<> &actor_i
       VLOG(actor) << "Send to scheduler " << sched_id << ": " << event;
     }
     start_migrate(event, sched_id);
+    if (batch_outbound_events_) {
+      outbound_events_[sched_id].push_back(EventCreator::event_unsafe(actor_id, std::move(event)));
+      has_outbound_events_ = true;
+      return;
+    }
     outbound_queues_[sched_id]->writer_put(EventCreator::event_unsafe(actor_id, std::move(event)));
     outbound_queues_[sched_id]->writer_flush();
   }
 }
 
+void Scheduler::flush_outbound_events() {
+  if (!has_outbound_events_) {
+    return;
+  }
+  has_outbound_events_ = false;
+  for (size_t i = 0; i < outbound_events_.size(); i++) {
+    if (!outbound_events_[i].empty()) {
+      outbound_queues_[i]->writer_put_batch(outbound_events_[i]);
+    }
+  }
+}
+
 void Scheduler::run_on_scheduler(int32 sched_id, Promise<Unit> action) {
   if (sched_id >= 0 && sched_id_ != sched_id) {
     class Worker final : public Actor {
@@ -363,6 +442,62 @@ void Scheduler::run_on_scheduler(int32 sched_id, Promise<Unit> action) {
 }
 
 void Scheduler::destroy_on_scheduler_impl(int32 sched_id, Promise<Unit> action) {
+  if (sched_id < 0 || sched_id >= static_cast<int32>(retired_objects_.size())) {
+    sched_id = sched_id_;
+  }
+  if (batch_retired_objects_) {
+    retired_objects_[sched_id].push_back(std::move(action));
+    has_retired_objects_ = true;
+    return;
+  }
+
+  vector<Promise<Unit>> actions;
+  actions.push_back(std::move(action));
+  reclaim_on_scheduler(sched_id, std::move(actions));
+}
+
+void Scheduler::flush_retired_objects() {
+  if (!has_retired_objects_) {
+    return;
+  }
+  has_retired_objects_ = false;
+  for (size_t i = 0; i < retired_objects_.size(); i++) {
+    if (!retired_objects_[i].empty()) {
+      auto actions = std::move(retired_objects_[i]);
+      retired_objects_[i].clear();
+      reclaim_on_scheduler(static_cast<int32>(i), std::move(actions));
+    }
+  }
+}
+
+void Scheduler::reclaim_on_scheduler(int32 sched_id, vector<Promise<Unit>> actions) {
+  // destroys the objects in parts, yielding the scheduler between them
+  class Reclaimer final : public Actor {
+   public:
+    explicit Reclaimer(vector<Promise<Unit>> actions) : actions_(std::move(actions)) {
+    }
+
+   private:
+    vector<Promise<Unit>> actions_;
+    size_t pos_ = 0;
+
+    void start_up() final {
+      loop();
+    }
+
+    void loop() final {
+      auto end_time = Time::now() + 0.005;
+      while (pos_ < actions_.size()) {
+        actions_[pos_++].set_value(Unit());
+        if (pos_ < actions_.size() && Time::now() > end_time) {
+          yield();
+          return;
+        }
+      }
+      stop();
+    }
+  };
+
   auto empty_context = std::make_shared<ActorContext>();
   empty_context->this_ptr_ = empty_context;
   ActorContext *current_context = context_;
@@ -371,7 +506,7 @@ void Scheduler::destroy_on_scheduler_impl(int32 sched_id, Promise<Unit> action)
   const char *current_tag = LOG_TAG;
   LOG_TAG = nullptr;
 
-  run_on_scheduler(sched_id, std::move(action));
+  create_actor_on_scheduler<Reclaimer>("Reclaimer", sched_id, std::move(actions)).release();
 
   context_ = current_context;
   LOG_TAG = current_tag;
@@ -384,7 +519,10 @@ void Scheduler::add_to_mailbox(ActorInfo *actor_info, Event &&event) {
     ready_actors_list_.put(node);
   }
   VLOG(actor) << "Add to mailbox: " << *actor_info << " " << event;
-  actor_info->mailbox_.push_back(std::move(event));
+  if (unlikely(ActorStatistics::is_enabled()) && !actor_info->has_mailbox_events()) {
+    actor_info->set_ready_time(Time::now());
+  }
+  actor_info->add_to_mailbox(std::move(event));
 }
 
 void Scheduler::do_stop_actor(Actor *actor) {
@@ -447,6 +585,9 @@ void Scheduler::start_migrate_actor(ActorInfo *actor_info, int32 dest_sched_id)
   for (auto &event : actor_info->mailbox_) {
     start_migrate(event, dest_sched_id);
   }
+  for (auto &event : actor_info->priority_mailbox_) {
+    start_migrate(event, dest_sched_id);
+  }
   actor_info->start_migrate(dest_sched_id);
   actor_info->get_list_node()->remove();
   cancel_actor_timeout(actor_info);
@@ -454,7 +595,10 @@ void Scheduler::start_migrate_actor(ActorInfo *actor_info, int32 dest_sched_id)
 
 double Scheduler::get_actor_timeout(const ActorInfo *actor_info) const {
   const HeapNode *heap_node = actor_info->get_heap_node();
-  return heap_node->in_heap() ? timeout_queue_.get_key(heap_node) - Time::now() : 0.0;
+  if (!heap_node->in_heap()) {
+    return 0.0;
+  }
+  return (use_timer_wheel_ ? timer_wheel_.get_key(heap_node) : timeout_queue_.get_key(heap_node)) - Time::now();
 }
 
 void Scheduler::set_actor_timeout_in(ActorInfo *actor_info, double timeout) {
@@ -471,14 +615,23 @@ void Scheduler::set_actor_timeout_in(ActorInfo *actor_info, double timeout) {
 void Scheduler::set_actor_timeout_at(ActorInfo *actor_info, double timeout_at) {
   HeapNode *heap_node = actor_info->get_heap_node();
   VLOG(actor) << "Set actor " << *actor_info << " timeout in " << timeout_at - Time::now_cached();
-  if (heap_node->in_heap()) {
-    timeout_queue_.fix(timeout_at, heap_node);
+  if (use_timer_wheel_) {
+    if (heap_node->in_heap()) {
+      timer_wheel_.fix(timeout_at, heap_node);
+    } else {
+      timer_wheel_.insert(timeout_at, heap_node);
+    }
   } else {
-    timeout_queue_.insert(timeout_at, heap_node);
+    if (heap_node->in_heap()) {
+      timeout_queue_.fix(timeout_at, heap_node);
+    } else {
+      timeout_queue_.insert(timeout_at, heap_node);
+    }
   }
 }
 
 void Scheduler::run_poll(Timestamp timeout) {
+  Time::update_cached();
   // we can't wait for less than 1ms
   auto timeout_ms = static_cast<int>(clamp(timeout.in(), 0.0, 1000000.0) * 1000 + 1);
 #if TD_PORT_WINDOWS
@@ -486,6 +639,19 @@ void Scheduler::run_poll(Timestamp timeout) {
   inbound_queue_->reader_get_event_fd().wait(timeout_ms);
   service_actor_.notify();
 #elif TD_PORT_POSIX
+  if (inbound_spin_count_ > 0 && inbound_queue_ != nullptr && timeout_ms > 1) {
+    // spin a little before sleeping, because an event from another scheduler often arrives soon;
+    // the number of iterations grows while spinning succeeds and falls back quickly otherwise
+    if (inbound_queue_->reader_spin_wait(inbound_spin_count_)) {
+      if (inbound_spin_count_ < MAX_INBOUND_SPIN_COUNT) {
+        inbound_spin_count_ *= 2;
+      }
+      service_actor_.notify();
+      timeout_ms = 0;
+    } else if (inbound_spin_count_ > MIN_INBOUND_SPIN_COUNT) {
+      inbound_spin_count_ /= 2;
+    }
+  }
   poll_.run(timeout_ms);
 #endif
 }
@@ -493,6 +659,9 @@ void Scheduler::run_poll(Timestamp timeout) {
 void Scheduler::run_mailbox() {
   VLOG(actor) << "Run mailbox : begin";
   ListNode actors_list = std::move(ready_actors_list_);
+  if (work_stealing_info_ != nullptr) {
+    share_ready_actors(actors_list);
+  }
   while (!actors_list.empty()) {
     ListNode *node = actors_list.get();
     CHECK(node);
@@ -519,8 +688,55 @@ void Scheduler::run_mailbox() {
   //LOG_CHECK(cnt == actor_count_) << cnt << " vs " << actor_count_;
 }
 
+void Scheduler::share_ready_actors(ListNode &actors_list) {
+  // actors with a timeout aren't moved, because migration cancels the timeout
+  auto can_give = [](const ActorInfo *actor_info) {
+    return actor_info->is_migratable() && !actor_info->is_running() && !actor_info->get_heap_node()->in_heap();
+  };
+
+  size_t ready_actor_count = 0;
+  size_t migratable_actor_count = 0;
+  for (auto it = actors_list.begin(); it != actors_list.end(); it = it->get_next()) {
+    ready_actor_count++;
+    if (can_give(ActorInfo::from_list_node(it))) {
+      migratable_actor_count++;
+    }
+  }
+  if (ready_actor_count < 2 || migratable_actor_count == 0) {
+    return;
+  }
+
+  auto dest_sched_id = work_stealing_info_->acquire_idle_scheduler(sched_id_);
+  if (dest_sched_id == -1) {
+    return;
+  }
+
+  // give away at most half of ready actors
+  auto left_actor_count = td::min(migratable_actor_count, ready_actor_count / 2);
+  for (auto it = actors_list.begin(); it != actors_list.end() && left_actor_count > 0;) {
+    auto actor_info = ActorInfo::from_list_node(it);
+    it = it->get_next();
+    if (can_give(actor_info)) {
+      VLOG(actor) << "Give " << *actor_info << " to scheduler " << dest_sched_id;
+      do_migrate_actor(actor_info, dest_sched_id);
+      left_actor_count--;
+    }
+  }
+}
+
 Timestamp Scheduler::run_timeout() {
   double now = Time::now();
+  if (use_timer_wheel_) {
+    while (true) {
+      HeapNode *node = timer_wheel_.pop_expired(now);
+      if (node == nullptr) {
+        break;
+      }
+      ActorInfo *actor_info = ActorInfo::from_heap_node(node);
+      send<ActorSendType::Immediate>(actor_info->actor_id(), Event::timeout());
+    }
+    return get_timeout();
+  }
   //TODO: use Timestamp().is_in_past()
   while (!timeout_queue_.empty() && timeout_queue_.top_key() < now) {
     HeapNode *node = timeout_queue_.pop();
@@ -535,15 +751,25 @@ Timestamp Scheduler::run_events(Timestamp timeout) {
   VLOG(actor) << "Run events " << sched_id_ << " " << tag("pending", pending_events_.size())
               << tag("actors", actor_count_);
   do {
+    Time::update_cached();
     run_mailbox();
     res = run_timeout();
+    flush_retired_objects();
+    flush_outbound_events();
   } while (!ready_actors_list_.empty() && !timeout.is_in_past());
   return res;
 }
 
 void Scheduler::run_no_guard(Timestamp timeout) {
   CHECK(has_guard_);
+  // events can be batched only while the scheduler is run by its owner thread
+  batch_outbound_events_ = sched_n_ > 1;
+  batch_retired_objects_ = true;
   SCOPE_EXIT {
+    batch_retired_objects_ = false;
+    flush_retired_objects();
+    flush_outbound_events();
+    batch_outbound_events_ = false;
     yield_flag_ = false;
   };
 
@@ -551,7 +777,13 @@ void Scheduler::run_no_guard(Timestamp timeout) {
   if (yield_flag_) {
     return;
   }
+  if (can_steal_) {
+    work_stealing_info_->set_idle(sched_id_, true);
+  }
   run_poll(timeout);
+  if (can_steal_) {
+    work_stealing_info_->set_idle(sched_id_, false);
+  }
   run_events(timeout);
 }
 
@@ -559,6 +791,12 @@ Timestamp Scheduler::get_timeout() {
   if (!ready_actors_list_.empty()) {
     return Timestamp::in(0);
   }
+  if (use_timer_wheel_) {
+    if (timer_wheel_.empty()) {
+      return Timestamp::in(10000);
+    }
+    return Timestamp::at(timer_wheel_.get_wakeup_at());
+  }
   if (timeout_queue_.empty()) {
     return Timestamp::in(10000);
   }
@@ -6,8 +6,10 @@
 //
 #pragma once
 
+#include "td/actor/ActorStatistics.h"
 #include "td/actor/impl/ActorInfo-decl.h"
 #include "td/actor/impl/Scheduler-decl.h"
+#include "td/actor/RequestTracer.h"
 
 #include "td/utils/common.h"
 #include "td/utils/Heap.h"
@@ -145,18 +147,60 @@ inline void Scheduler::destroy_actor(ActorInfo *actor_info) {
 template <class RunFuncT, class EventFuncT>
 void Scheduler::flush_mailbox(ActorInfo *actor_info, const RunFuncT &run_func, const EventFuncT &event_func) {
   auto &mailbox = actor_info->mailbox_;
+  auto &priority_mailbox = actor_info->priority_mailbox_;
   size_t mailbox_size = mailbox.size();
-  CHECK(mailbox_size != 0);
+  CHECK(mailbox_size != 0 || !priority_mailbox.empty());
   EventGuard guard(this, actor_info);
+
+  // handles priority events, which were added before the call
+  auto flush_priority_mailbox = [&](const auto &run_event) {
+    if (likely(priority_mailbox.empty())) {
+      return;
+    }
+    size_t priority_mailbox_size = priority_mailbox.size();
+    size_t j = 0;
+    for (; j < priority_mailbox_size && guard.can_run(); j++) {
+      run_event(std::move(priority_mailbox[j]));
+    }
+    priority_mailbox.erase(priority_mailbox.begin(), priority_mailbox.begin() + j);
+  };
+
   size_t i = 0;
-  for (; i < mailbox_size && guard.can_run(); i++) {
-    do_event(actor_info, std::move(mailbox[i]));
+  if (unlikely(ActorStatistics::is_enabled())) {
+    auto ready_time = actor_info->get_ready_time();
+    auto flush_start_time = Time::now();
+    auto run_event = [&](Event &&event) {
+      auto start_time = Time::now();
+      do_event(actor_info, std::move(event));
+      ActorStatistics::on_event(actor_info->get_name(), ready_time > 0 ? start_time - ready_time : -1.0,
+                                Time::now() - start_time);
+    };
+    flush_priority_mailbox(run_event);
+    for (; i < mailbox_size && guard.can_run(); i++) {
+      run_event(std::move(mailbox[i]));
+      flush_priority_mailbox(run_event);
+    }
+    // events, which were added during the flush, can't wait longer than the flush
+    actor_info->set_ready_time(flush_start_time);
+  } else {
+    auto run_event = [&](Event &&event) {
+      do_event(actor_info, std::move(event));
+    };
+    flush_priority_mailbox(run_event);
+    for (; i < mailbox_size && guard.can_run(); i++) {
+      run_event(std::move(mailbox[i]));
+      flush_priority_mailbox(run_event);
+    }
   }
   if (run_func) {
     if (guard.can_run()) {
       (*run_func)(actor_info);
     } else {
-      mailbox.insert(mailbox.begin() + i, (*event_func)());
+      auto event = (*event_func)();
+      if (unlikely(RequestTracer::is_enabled())) {
+        event.trace_id = RequestTracer::get_current_trace_id();
+      }
+      mailbox.insert(mailbox.begin() + i, std::move(event));
     }
   }
   mailbox.erase(mailbox.begin(), mailbox.begin() + i);
@@ -206,14 +250,24 @@ void Scheduler::send_impl(const ActorId<> &actor_id, const RunFuncT &run_func, c
   CHECK(has_guard_ || !on_current_sched);
 
   if (likely(send_type == ActorSendType::Immediate && on_current_sched && !actor_info->is_running() &&
-             actor_info->mailbox_.empty())) {  // run immediately
+             !actor_info->has_mailbox_events())) {  // run immediately
     EventGuard guard(this, actor_info);
-    run_func(actor_info);
+    if (unlikely(ActorStatistics::is_enabled())) {
+      auto start_time = Time::now();
+      run_func(actor_info);
+      ActorStatistics::on_event(actor_info->get_name(), 0.0, Time::now() - start_time);
+    } else {
+      run_func(actor_info);
+    }
   } else {
+    auto event = event_func();
+    if (unlikely(RequestTracer::is_enabled())) {
+      event.trace_id = RequestTracer::get_current_trace_id();
+    }
     if (on_current_sched) {
-      add_to_mailbox(actor_info, event_func());
+      add_to_mailbox(actor_info, std::move(event));
     } else {
-      send_to_scheduler(actor_sched_id, actor_id, event_func());
+      send_to_scheduler(actor_sched_id, actor_id, std::move(event));
     }
   }
 }
@@ -248,6 +302,22 @@ void Scheduler::send_closure(ActorRef actor_ref, EventT &&closure) {
       });
 }
 
+template <class EventT>
+void Scheduler::send_priority_closure(ActorRef actor_ref, EventT &&closure) {
+  return send_impl<ActorSendType::Immediate>(
+      actor_ref.get(),
+      [&](ActorInfo *actor_info) {
+        event_context_ptr_->link_token = actor_ref.token();
+        closure.run(static_cast<typename EventT::ActorType *>(actor_info->get_actor_unsafe()));
+      },
+      [&] {
+        auto event = Event::immediate_closure(std::forward<EventT>(closure));
+        event.set_link_token(actor_ref.token());
+        event.set_priority();
+        return event;
+      });
+}
+
 template <ActorSendType send_type>
 void Scheduler::send(ActorRef actor_ref, Event &&event) {
   event.set_link_token(actor_ref.token());
@@ -311,7 +381,11 @@ inline void Scheduler::cancel_actor_timeout(Actor *actor) {
 inline void Scheduler::cancel_actor_timeout(ActorInfo *actor_info) {
   HeapNode *heap_node = actor_info->get_heap_node();
   if (heap_node->in_heap()) {
-    timeout_queue_.erase(heap_node);
+    if (use_timer_wheel_) {
+      timer_wheel_.erase(heap_node);
+    } else {
+      timeout_queue_.erase(heap_node);
+    }
   }
 }
 
@@ -12,6 +12,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/Random.h"
 #include "td/utils/tests.h"
+#include "td/utils/Time.h"
 
 TEST(MultiTimeout, bug) {
   td::ConcurrentScheduler sched(0, 0);
@@ -110,3 +111,42 @@ TEST(MultiTimeout, Destroy) {
   }
   sched.finish();
 }
+
+TEST(MultiTimeout, timer_wheel) {
+  td::ConcurrentScheduler sched(0, 0, true);
+
+  sched.start();
+  td::unique_ptr<td::MultiTimeout> multi_timeout;
+  struct Data {
+    td::vector<double> expires_at;
+    int left_count = 0;
+  };
+  Data data;
+
+  {
+    auto guard = sched.get_main_guard();
+    multi_timeout = td::make_unique<td::MultiTimeout>("MultiTimeout");
+    multi_timeout->set_callback([](void *void_data, td::int64 key) {
+      auto &data = *static_cast<Data *>(void_data);
+      CHECK(data.expires_at[static_cast<size_t>(key)] <= td::Time::now());
+      if (--data.left_count == 0) {
+        td::Scheduler::instance()->finish();
+      }
+    });
+    multi_timeout->set_callback_data(&data);
+    for (int i = 0; i < 100; i++) {
+      auto expires_at = td::Time::now() + td::Random::fast(0, 50) / 1000.0;
+      data.expires_at.push_back(expires_at);
+      multi_timeout->set_timeout_at(i, expires_at);
+    }
+    multi_timeout->cancel_timeout(0);
+    multi_timeout->set_timeout_at(1, data.expires_at[1] + 0.01);
+    data.expires_at[1] += 0.01;
+    data.left_count = 99;
+  }
+
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
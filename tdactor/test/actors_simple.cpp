@@ -5,9 +5,11 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/actor/actor.h"
+#include "td/actor/ActorStatistics.h"
 #include "td/actor/ConcurrentScheduler.h"
 #include "td/actor/MultiPromise.h"
 #include "td/actor/PromiseFuture.h"
+#include "td/actor/RequestTracer.h"
 #include "td/actor/SleepActor.h"
 
 #include "td/utils/common.h"
@@ -23,6 +25,7 @@
 #include "td/utils/tests.h"
 #include "td/utils/Time.h"
 
+#include <array>
 #include <memory>
 #include <tuple>
 
@@ -442,6 +445,57 @@ TEST(Actors, promise) {
   ASSERT_EQ(1, value);
 }
 
+TEST(Actors, promise_move) {
+  auto check = [](td::Promise<int> promise) {
+    td::vector<td::Promise<int>> promises;
+    promises.push_back(std::move(promise));
+    for (int i = 0; i < 10; i++) {
+      promises.push_back(std::move(promises.back()));
+    }
+    auto last_promise = std::move(promises.back());
+    promises.clear();
+    ASSERT_TRUE(static_cast<bool>(last_promise));
+    last_promise.set_value(5);
+    ASSERT_TRUE(!last_promise);
+  };
+
+  int value = 0;
+  check(td::PromiseCreator::lambda([&value](int x) { value += x; }));
+  ASSERT_EQ(5, value);
+  check(td::PromiseCreator::lambda([&value, a = 1, b = 2, c = 3, d = 4](int x) { value += x + a + b + c + d; }));
+  ASSERT_EQ(20, value);
+  td::string big_capture(100, 'a');
+  check(td::PromiseCreator::lambda([&value, big_capture, s = std::array<char, 256>()](int x) {
+    value += x + static_cast<int>(big_capture.size()) + static_cast<int>(s.size());
+  }));
+  ASSERT_EQ(381, value);
+
+  // lost promises must be failed whether they are stored inline or not
+  int error_count = 0;
+  {
+    td::Promise<int> small = td::PromiseCreator::lambda([&](td::Result<int> r) { error_count += r.is_error(); });
+    td::Promise<int> big = td::PromiseCreator::lambda(
+        [&, s = std::array<char, 256>()](td::Result<int> r) { error_count += r.is_error() + (s[0] != 0); });
+    auto moved_small = std::move(small);
+    auto moved_big = std::move(big);
+  }
+  ASSERT_EQ(2, error_count);
+
+  // released promise must still be usable
+  auto released = td::Promise<int>(td::PromiseCreator::lambda([&value](int x) { value = x; })).release();
+  td::Promise<int>(std::move(released)).set_value(7);
+  ASSERT_EQ(7, value);
+
+  // the promise may be destroyed during its completion
+  td::Promise<int> self_destroying;
+  self_destroying = td::PromiseCreator::lambda([&](int x) {
+    self_destroying = td::Promise<int>();
+    value = x;
+  });
+  self_destroying.set_value(9);
+  ASSERT_EQ(9, value);
+}
+
 class LaterSlave final : public td::Actor {
  public:
   explicit LaterSlave(td::ActorShared<> parent) : parent_(std::move(parent)) {
@@ -491,6 +545,43 @@ TEST(Actors, later) {
   ASSERT_STREQ(sb.as_cslice().c_str(), "AAABBB");
 }
 
+class PriorityReceiver final : public td::Actor {
+ public:
+  void add(char c) {
+    sb << c;
+    if (c == 'a') {
+      td::send_closure_priority(actor_id(this), &PriorityReceiver::add, 'Y');
+    }
+  }
+
+  void finish() {
+    td::Scheduler::instance()->finish();
+    stop();
+  }
+};
+
+class PrioritySender final : public td::Actor {
+  void start_up() final {
+    auto receiver = td::create_actor<PriorityReceiver>("PriorityReceiver").release();
+    td::send_closure_later(receiver, &PriorityReceiver::add, 'a');
+    td::send_closure_later(receiver, &PriorityReceiver::add, 'b');
+    td::send_closure_priority(receiver, &PriorityReceiver::add, 'X');
+    td::send_closure_later(receiver, &PriorityReceiver::finish);
+    stop();
+  }
+};
+
+TEST(Actors, send_closure_priority) {
+  sb.clear();
+  td::ConcurrentScheduler scheduler(0, 0);
+  scheduler.create_actor_unsafe<PrioritySender>(0, "A").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+  ASSERT_STREQ(sb.as_cslice().c_str(), "XaYb");
+}
+
 class MultiPromise2 final : public td::Actor {
  public:
   void start_up() final {
@@ -677,3 +768,155 @@ TEST(Actors, MultiPromiseSendClosureLater) {
   }
   scheduler.finish();
 }
+
+class StatisticsTest final : public td::Actor {
+ public:
+  void start_up() final {
+    td::send_closure_later(actor_id(this), &StatisticsTest::on_event, 10);
+  }
+
+ private:
+  void on_event(int left) {
+    if (left == 0) {
+      td::Scheduler::instance()->finish();
+      stop();
+      return;
+    }
+    td::send_closure_later(actor_id(this), &StatisticsTest::on_event, left - 1);
+  }
+};
+
+TEST(Actors, statistics) {
+  td::ActorStatistics::clear();
+  td::ActorStatistics::set_enabled(true);
+  td::ConcurrentScheduler scheduler(0, 0);
+  scheduler.create_actor_unsafe<StatisticsTest>(0, "StatisticsTest").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+  td::ActorStatistics::set_enabled(false);
+
+  bool is_found = false;
+  for (auto &entry : td::ActorStatistics::get_statistics()) {
+    if (entry.name == "StatisticsTest") {
+      is_found = true;
+      // start_up and 11 on_event calls
+      ASSERT_EQ(12u, entry.event_count);
+      td::uint64 run_count = 0;
+      for (auto count : entry.run_time) {
+        run_count += count;
+      }
+      ASSERT_EQ(entry.event_count, run_count);
+    }
+  }
+  ASSERT_TRUE(is_found);
+  td::ActorStatistics::clear();
+}
+
+class RequestTracerTest final : public td::Actor {
+ public:
+  void start_up() final {
+    trace_id_ = td::RequestTracer::start_trace();
+    CHECK(trace_id_ != 0);
+    {
+      td::RequestTracer::Guard guard(trace_id_);
+      td::send_closure_later(actor_id(this), &RequestTracerTest::on_traced_event, 3);
+    }
+    td::send_closure_later(actor_id(this), &RequestTracerTest::on_untraced_event);
+  }
+
+ private:
+  td::uint32 trace_id_ = 0;
+  int finished_count_ = 0;
+
+  void on_traced_event(int left) {
+    ASSERT_EQ(trace_id_, td::RequestTracer::get_current_trace_id());
+    if (left == 0) {
+      return on_finished();
+    }
+    td::send_closure_later(actor_id(this), &RequestTracerTest::on_traced_event, left - 1);
+  }
+
+  void on_untraced_event() {
+    ASSERT_EQ(0u, td::RequestTracer::get_current_trace_id());
+    on_finished();
+  }
+
+  void on_finished() {
+    if (++finished_count_ == 2) {
+      td::Scheduler::instance()->finish();
+      stop();
+    }
+  }
+};
+
+TEST(Actors, RequestTracer) {
+  td::RequestTracer::clear();
+  td::RequestTracer::set_enabled(true, 1);
+  td::ConcurrentScheduler scheduler(0, 0);
+  scheduler.create_actor_unsafe<RequestTracerTest>(0, "RequestTracerTest").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+  td::RequestTracer::set_enabled(false, 1);
+
+  auto trace = td::RequestTracer::get_chrome_trace();
+  td::RequestTracer::clear();
+  size_t span_count = 0;
+  td::string span_name = "\"name\":\"RequestTracerTest\"";
+  for (auto pos = trace.find(span_name); pos != td::string::npos; pos = trace.find(span_name, pos + 1)) {
+    span_count++;
+  }
+  // 4 on_traced_event calls
+  ASSERT_EQ(4u, span_count);
+  ASSERT_TRUE(td::RequestTracer::get_chrome_trace().find(span_name) == td::string::npos);
+}
+
+class DestroyOnSchedulerTest final : public td::Actor {
+  class Object {
+   public:
+    explicit Object(td::ActorId<DestroyOnSchedulerTest> parent) : parent_(std::move(parent)) {
+    }
+    Object(const Object &) = delete;
+    Object &operator=(const Object &) = delete;
+    Object(Object &&) = delete;
+    Object &operator=(Object &&) = delete;
+    ~Object() {
+      CHECK(td::Scheduler::instance()->sched_id() == 1);
+      td::send_closure(parent_, &DestroyOnSchedulerTest::on_object_destroyed);
+    }
+
+   private:
+    td::ActorId<DestroyOnSchedulerTest> parent_;
+  };
+
+  void start_up() final {
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+      td::vector<td::unique_ptr<Object>> objects;
+      objects.push_back(td::make_unique<Object>(actor_id(this)));
+      td::Scheduler::instance()->destroy_on_scheduler(1, objects);
+      CHECK(objects.empty());
+    }
+  }
+
+  void on_object_destroyed() {
+    if (++destroyed_object_count_ == OBJECT_COUNT) {
+      td::Scheduler::instance()->finish();
+      stop();
+    }
+  }
+
+  static constexpr int OBJECT_COUNT = 1000;
+  int destroyed_object_count_ = 0;
+};
+
+TEST(Actors, destroy_on_scheduler) {
+  td::ConcurrentScheduler scheduler(1, 0);
+  scheduler.create_actor_unsafe<DestroyOnSchedulerTest>(0, "DestroyOnSchedulerTest").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+}
@@ -13,6 +13,9 @@
 
 class PowerWorker final : public td::Actor {
  public:
+  explicit PowerWorker(bool is_migratable) : is_migratable_(is_migratable) {
+  }
+
   class Callback {
    public:
     Callback() = default;
@@ -41,6 +44,11 @@ class PowerWorker final : public td::Actor {
 
  private:
   td::unique_ptr<Callback> callback_;
+  bool is_migratable_;
+
+  void start_up() final {
+    set_migratable(is_migratable_);
+  }
 };
 
 class Manager final : public td::Actor {
@@ -105,13 +113,18 @@ class Manager final : public td::Actor {
   int query_size_;
 };
 
-static void test_workers(int threads_n, int workers_n, int queries_n, int query_size) {
+static void test_workers(int threads_n, int workers_n, int queries_n, int query_size, bool work_stealing = false) {
   td::ConcurrentScheduler sched(threads_n, 0);
+  if (work_stealing) {
+    sched.enable_work_stealing();
+  }
 
   td::vector<td::ActorId<PowerWorker>> workers;
   for (int i = 0; i < workers_n; i++) {
-    int thread_id = threads_n ? i % (threads_n - 1) + 2 : 0;
-    workers.push_back(sched.create_actor_unsafe<PowerWorker>(thread_id, PSLICE() << "worker" << i).release());
+    // in work-stealing mode all workers start on the same scheduler
+    int thread_id = threads_n ? (work_stealing ? 2 : i % (threads_n - 1) + 2) : 0;
+    workers.push_back(
+        sched.create_actor_unsafe<PowerWorker>(thread_id, PSLICE() << "worker" << i, work_stealing).release());
   }
   sched.create_actor_unsafe<Manager>(threads_n ? 1 : 0, "Manager", queries_n, query_size, std::move(workers)).release();
 
@@ -147,3 +160,11 @@ TEST(Actors, workers_small_query_two_threads) {
 TEST(Actors, workers_small_query_nine_threads) {
   test_workers(9, 10, 10000, 1);
 }
+
+TEST(Actors, workers_big_query_work_stealing) {
+  test_workers(4, 10, 1000, 300000, true);
+}
+
+TEST(Actors, workers_small_query_work_stealing) {
+  test_workers(4, 10, 100000, 1, true);
+}
@@ -14,10 +14,15 @@
 #include "td/utils/algorithm.h"
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/crypto.h"
+#include "td/utils/filesystem.h"
 #include "td/utils/HashTableUtils.h"
+#include "td/utils/HazardPointers.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/port/path.h"
 #include "td/utils/port/RwMutex.h"
+#include "td/utils/port/thread_local.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
@@ -25,6 +30,9 @@
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 #include <utility>
@@ -42,16 +50,27 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
     }
     Slice key;
     Slice value;
+    int32 snapshot_magic = 0;  // special events, which are used only with a snapshot
+
+    // the key was erased after it had been stored in the snapshot
+    static constexpr int32 TOMBSTONE_MAGIC = 0x5e3a7d1c;
+    // the snapshot was saved; keeps identifiers of new events greater than the identifiers of events in the snapshot
+    static constexpr int32 SNAPSHOT_MARKER_MAGIC = 0x5e3a7d1d;
+
     template <class StorerT>
     void store(StorerT &&storer) const {
       storer.store_string(key);
       storer.store_string(value);
+      if (snapshot_magic != 0) {
+        storer.store_int(snapshot_magic);
+      }
     }
 
     template <class ParserT>
     void parse(ParserT &&parser) {
       key = parser.template fetch_string<Slice>();
       value = parser.template fetch_string<Slice>();
+      snapshot_magic = parser.get_left_len() != 0 ? parser.fetch_int() : 0;
     }
 
     size_t size() const final {
@@ -66,6 +85,21 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
     }
   };
 
+  BinlogKeyValue() {
+    for (auto &shard : shards_) {
+      shard.map = new Map();
+    }
+  }
+  BinlogKeyValue(const BinlogKeyValue &) = delete;
+  BinlogKeyValue &operator=(const BinlogKeyValue &) = delete;
+  BinlogKeyValue(BinlogKeyValue &&) = delete;
+  BinlogKeyValue &operator=(BinlogKeyValue &&) = delete;
+  ~BinlogKeyValue() final {
+    for (auto &shard : shards_) {
+      delete shard.map.load();
+    }
+  }
+
   int32 get_magic() const {
     return magic_;
   }
@@ -78,14 +112,19 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
     }
 
     binlog_ = std::make_shared<BinlogT>();
+    bool use_snapshot = db_key.is_empty();  // the snapshot isn't encrypted
+    if (use_snapshot) {
+      TRY_STATUS(load_snapshot(get_snapshot_path(name)));
+    }
     TRY_STATUS(binlog_->init(
-        name,
-        [&](const BinlogEvent &binlog_event) {
-          Event event;
-          event.parse(TlParser(binlog_event.get_data()));
-          map_.emplace(event.key.str(), std::make_pair(event.value.str(), binlog_event.id_));
-        },
-        std::move(db_key), DbKey::empty(), scheduler_id));
+        name, [&](const BinlogEvent &binlog_event) { on_binlog_event(binlog_event); }, std::move(db_key),
+        DbKey::empty(), scheduler_id));
+    if (use_snapshot && need_snapshot()) {
+      auto status = save_snapshot();
+      if (status.is_error()) {
+        LOG(ERROR) << "Failed to save snapshot of " << name << ": " << status;
+      }
+    }
     return Status::OK();
   }
 
@@ -98,13 +137,166 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
 
   template <class OtherBinlogT>
   void external_init_handle(BinlogKeyValue<OtherBinlogT> &&other) {
-    map_ = std::move(other.map_);
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+      auto &shard = shards_[i];
+      auto &other_shard = other.shards_[i];
+      shard.map = other_shard.map.exchange(shard.map.load());
+      shard.tombstone_event_ids = std::move(other_shard.tombstone_event_ids);
+      shard.tail_event_count = other_shard.tail_event_count;
+    }
+    snapshot_path_ = std::move(other.snapshot_path_);
+    has_snapshot_ = other.has_snapshot_;
+    snapshot_event_id_ = other.snapshot_event_id_;
+    marker_event_id_ = other.marker_event_id_;
+    stale_event_ids_ = std::move(other.stale_event_ids_);
   }
 
   void external_init_handle(const BinlogEvent &binlog_event) {
-    Event event;
-    event.parse(TlParser(binlog_event.get_data()));
-    map_.emplace(event.key.str(), std::make_pair(event.value.str(), binlog_event.id_));
+    on_binlog_event(binlog_event);
+  }
+
+  static string get_snapshot_path(Slice name) {
+    return PSTRING() << name << ".snapshot";
+  }
+
+  // loads the snapshot of the map, which allows to skip replaying of all older events of the key-value storage,
+  // must be called before the binlog is loaded; the snapshot file is not encrypted
+  Status load_snapshot(string path) TD_WARN_UNUSED_RESULT {
+    snapshot_path_ = std::move(path);
+    auto r_data = read_file_str(snapshot_path_);
+    if (r_data.is_error()) {
+      return Status::OK();
+    }
+    auto data = r_data.move_as_ok();
+    if (data.size() < 4 || data.size() % 4 != 0) {
+      return Status::Error(PSLICE() << "Wrong snapshot size " << data.size());
+    }
+    Slice snapshot = Slice(data).remove_suffix(4);
+    if (static_cast<uint32>(TlParser(Slice(data).substr(snapshot.size())).fetch_int()) != crc32(snapshot)) {
+      return Status::Error("Snapshot CRC mismatch");
+    }
+
+    TlParser parser(snapshot);
+    auto snapshot_magic = parser.fetch_int();
+    auto magic = parser.fetch_int();
+    auto snapshot_event_id = static_cast<uint64>(parser.fetch_long());
+    auto size = parser.fetch_int();
+    if (parser.get_error() != nullptr || snapshot_magic != SNAPSHOT_MAGIC || magic != magic_ || size < 0) {
+      return Status::Error("Wrong snapshot header");
+    }
+    std::array<Map, SHARD_COUNT> maps;
+    for (int32 i = 0; i < size && parser.get_error() == nullptr; i++) {
+      auto key = parser.template fetch_string<string>();
+      auto value = parser.template fetch_string<string>();
+      auto shard_id = get_shard_id(key);
+      maps[shard_id].emplace(std::move(key), std::make_pair(std::move(value), 0));
+    }
+    parser.fetch_end();
+    if (parser.get_error() != nullptr) {
+      return Status::Error(PSLICE() << "Failed to parse snapshot: " << parser.get_status());
+    }
+
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+      get_map_unsafe(i) = std::move(maps[i]);
+    }
+    has_snapshot_ = true;
+    snapshot_event_id_ = snapshot_event_id;
+    return Status::OK();
+  }
+
+  // returns true if the snapshot must be saved after the binlog is loaded
+  bool need_snapshot() const {
+    if (snapshot_path_.empty()) {
+      return false;
+    }
+    if (has_snapshot_ && marker_event_id_ == 0) {
+      // saving of the snapshot was interrupted
+      return true;
+    }
+    size_t tail_event_count = 0;
+    size_t size = 0;
+    for (auto &shard : shards_) {
+      tail_event_count += shard.tail_event_count;
+      size += shard.map.load()->size();
+    }
+    return tail_event_count >= max(MIN_SNAPSHOT_TAIL_EVENT_COUNT, size);
+  }
+
+  // replaces all binlog events of the key-value storage with a snapshot of the map
+  Status save_snapshot() TD_WARN_UNUSED_RESULT {
+    auto locks = lock_all_shards();
+    CHECK(!snapshot_path_.empty());
+    // all events of the storage have smaller identifiers than the marker
+    auto snapshot_event_id = binlog_->next_event_id();
+    Event marker;
+    marker.snapshot_magic = Event::SNAPSHOT_MARKER_MAGIC;
+    auto marker_event = BinlogEvent::create_raw(snapshot_event_id, magic_, 0, marker);
+
+    auto storer = [&](auto &tl_storer) {
+      size_t size = 0;
+      for (auto &shard : shards_) {
+        size += shard.map.load(std::memory_order_relaxed)->size();
+      }
+      tl_storer.store_int(SNAPSHOT_MAGIC);
+      tl_storer.store_int(magic_);
+      tl_storer.store_long(static_cast<int64>(snapshot_event_id));
+      tl_storer.store_int(narrow_cast<int32>(size));
+      for (auto &shard : shards_) {
+        for (const auto &it : *shard.map.load(std::memory_order_relaxed)) {
+          tl_storer.store_string(it.first);
+          tl_storer.store_string(it.second.first);
+        }
+      }
+    };
+    TlStorerCalcLength calc_length;
+    storer(calc_length);
+    string data(calc_length.get_length() + 4, '\0');
+    TlStorerUnsafe tl_storer(MutableSlice(data).ubegin());
+    storer(tl_storer);
+    tl_storer.store_int(static_cast<int32>(crc32(Slice(data).remove_suffix(4))));
+    auto status = atomic_write_file(snapshot_path_, data);
+    if (status.is_error()) {
+      // the marker must be added anyway, because its identifier is already used
+      stale_event_ids_.push_back(snapshot_event_id);
+      locks.clear();
+      add_event(snapshot_event_id, std::move(marker_event));
+      return status;
+    }
+
+    vector<uint64> event_ids = std::move(stale_event_ids_);
+    if (marker_event_id_ != 0) {
+      event_ids.push_back(marker_event_id_);
+    }
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+      auto &shard = shards_[i];
+      append(event_ids, shard.tombstone_event_ids);
+      shard.tombstone_event_ids.clear();
+      shard.tail_event_count = 0;
+
+      auto old_size = event_ids.size();
+      for (const auto &it : *shard.map.load(std::memory_order_relaxed)) {
+        if (it.second.second != 0) {
+          event_ids.push_back(it.second.second);
+        }
+      }
+      if (event_ids.size() != old_size) {
+        update_map(i, [](Map &map) {
+          for (auto &it : map) {
+            it.second.second = 0;
+          }
+        });
+      }
+    }
+    has_snapshot_ = true;
+    snapshot_event_id_ = snapshot_event_id;
+    marker_event_id_ = snapshot_event_id;
+    stale_event_ids_.clear();
+    locks.clear();
+
+    // the events must be erased only after the snapshot is saved
+    add_event(snapshot_event_id, std::move(marker_event));
+    binlog_->erase_batch(std::move(event_ids));
+    return Status::OK();
   }
 
   void external_init_finish(std::shared_ptr<BinlogT> binlog) {
@@ -112,24 +304,37 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
   }
 
   void close() {
-    *this = BinlogKeyValue();
+    for (auto &shard : shards_) {
+      delete shard.map.exchange(new Map());
+      shard.tombstone_event_ids.clear();
+      shard.tail_event_count = 0;
+    }
+    binlog_.reset();
+    magic_ = MAGIC;
+    snapshot_path_.clear();
+    has_snapshot_ = false;
+    snapshot_event_id_ = 0;
+    marker_event_id_ = 0;
+    stale_event_ids_.clear();
   }
   void close(Promise<> promise) final {
     binlog_->close(std::move(promise));
   }
 
   SeqNo set(string key, string value) final {
-    auto lock = rw_mutex_.lock_write().move_as_ok();
+    auto shard_id = get_shard_id(key);
+    auto &shard = shards_[shard_id];
+    auto lock = shard.rw_mutex.lock_write().move_as_ok();
+    const Map &map = *shard.map.load(std::memory_order_relaxed);
     uint64 old_event_id = 0;
-    auto it_ok = map_.emplace(key, std::make_pair(value, 0));
-    if (!it_ok.second) {
-      if (it_ok.first->second.first == value) {
+    auto it = map.find(key);
+    if (it != map.end()) {
+      if (it->second.first == value) {
         return 0;
       }
-      VLOG(binlog) << "Change value of key " << key << " from " << hex_encode(it_ok.first->second.first) << " to "
+      VLOG(binlog) << "Change value of key " << key << " from " << hex_encode(it->second.first) << " to "
                    << hex_encode(value);
-      old_event_id = it_ok.first->second.second;
-      it_ok.first->second.first = value;
+      old_event_id = it->second.second;
     } else {
       VLOG(binlog) << "Set value of key " << key << " to " << hex_encode(value);
     }
@@ -141,8 +346,9 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
       event_id = old_event_id;
     } else {
       event_id = seq_no;
-      it_ok.first->second.second = event_id;
+      shard.tail_event_count++;
     }
+    update_map(shard_id, [&](Map &new_map) { new_map[key] = std::make_pair(value, event_id); });
 
     lock.reset();
     add_event(seq_no,
@@ -151,36 +357,56 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
   }
 
   SeqNo erase(const string &key) final {
-    auto lock = rw_mutex_.lock_write().move_as_ok();
-    auto it = map_.find(key);
-    if (it == map_.end()) {
+    auto shard_id = get_shard_id(key);
+    auto &shard = shards_[shard_id];
+    auto lock = shard.rw_mutex.lock_write().move_as_ok();
+    const Map &map = *shard.map.load(std::memory_order_relaxed);
+    auto it = map.find(key);
+    if (it == map.end()) {
       return 0;
     }
     VLOG(binlog) << "Remove value of key " << key << ", which is " << hex_encode(it->second.first);
     uint64 event_id = it->second.second;
-    map_.erase(it);
+    update_map(shard_id, [&](Map &new_map) { new_map.erase(key); });
     auto seq_no = binlog_->next_event_id();
+    auto event = create_erase_event(key, event_id, seq_no);
     lock.reset();
-    add_event(seq_no, BinlogEvent::create_raw(event_id, BinlogEvent::ServiceTypes::Empty, BinlogEvent::Flags::Rewrite,
-                                              EmptyStorer()));
+    add_event(seq_no, std::move(event));
     return seq_no;
   }
 
   SeqNo erase_batch(vector<string> keys) final {
-    auto lock = rw_mutex_.lock_write().move_as_ok();
-    vector<uint64> log_event_ids;
+    std::array<vector<string>, SHARD_COUNT> shard_keys;
     for (auto &key : keys) {
-      auto it = map_.find(key);
-      if (it != map_.end()) {
-        log_event_ids.push_back(it->second.second);
-        map_.erase(it);
-      }
+      shard_keys[get_shard_id(key)].push_back(key);
+    }
+    for (auto &key_list : shard_keys) {
+      td::unique(key_list);
+    }
+
+    auto locks = lock_all_shards();
+    vector<uint64> log_event_ids;
+    vector<string> erased_keys;
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+      erase_from_shard(
+          i, [&](const Map &map, auto &&f) {
+            for (auto &key : shard_keys[i]) {
+              auto it = map.find(key);
+              if (it != map.end()) {
+                f(it);
+              }
+            }
+          },
+          erased_keys, log_event_ids);
     }
     if (log_event_ids.empty()) {
       return 0;
     }
     VLOG(binlog) << "Remove value of keys " << keys;
-    return binlog_->erase_batch(std::move(log_event_ids));
+    if (!has_snapshot_) {
+      return binlog_->erase_batch(std::move(log_event_ids));
+    }
+    return add_erase_events(std::move(locks), erased_keys, log_event_ids);
   }
 
   void add_event(uint64 seq_no, BufferSlice &&event) {
@@ -188,18 +414,18 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
   }
 
   bool isset(const string &key) final {
-    auto lock = rw_mutex_.lock_read().move_as_ok();
-    return map_.count(key) > 0;
+    return read_map(get_shard_id(key), [&](const Map &map) { return map.count(key) > 0; });
   }
 
   string get(const string &key) final {
-    auto lock = rw_mutex_.lock_read().move_as_ok();
-    auto it = map_.find(key);
-    if (it == map_.end()) {
-      return string();
-    }
-    VLOG(binlog) << "Get value of key " << key << ", which is " << hex_encode(it->second.first);
-    return it->second.first;
+    return read_map(get_shard_id(key), [&](const Map &map) {
+      auto it = map.find(key);
+      if (it == map.end()) {
+        return string();
+      }
+      VLOG(binlog) << "Get value of key " << key << ", which is " << hex_encode(it->second.first);
+      return it->second.first;
+    });
   }
 
   void force_sync(Promise<> &&promise) final {
@@ -211,37 +437,50 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
   }
 
   std::unordered_map<string, string, Hash<string>> prefix_get(Slice prefix) final {
-    auto lock = rw_mutex_.lock_write().move_as_ok();
+    auto locks = lock_all_shards_read();
     std::unordered_map<string, string, Hash<string>> res;
-    for (const auto &kv : map_) {
-      if (begins_with(kv.first, prefix)) {
-        res.emplace(kv.first.substr(prefix.size()), kv.second.first);
+    for (auto &shard : shards_) {
+      for (const auto &kv : *shard.map.load(std::memory_order_relaxed)) {
+        if (begins_with(kv.first, prefix)) {
+          res.emplace(kv.first.substr(prefix.size()), kv.second.first);
+        }
       }
     }
     return res;
   }
 
   std::unordered_map<string, string, Hash<string>> get_all() final {
-    auto lock = rw_mutex_.lock_write().move_as_ok();
+    auto locks = lock_all_shards_read();
     std::unordered_map<string, string, Hash<string>> res;
-    for (const auto &kv : map_) {
-      res.emplace(kv.first, kv.second.first);
+    for (auto &shard : shards_) {
+      for (const auto &kv : *shard.map.load(std::memory_order_relaxed)) {
+        res.emplace(kv.first, kv.second.first);
+      }
     }
     return res;
   }
 
   void erase_by_prefix(Slice prefix) final {
-    auto lock = rw_mutex_.lock_write().move_as_ok();
+    auto locks = lock_all_shards();
     vector<uint64> event_ids;
-    table_remove_if(map_, [&](const auto &it) {
-      if (begins_with(it.first, prefix)) {
-        event_ids.push_back(it.second.second);
-        return true;
-      }
-      return false;
-    });
+    vector<string> erased_keys;
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+      erase_from_shard(
+          i, [&](const Map &map, auto &&f) {
+            for (auto it = map.begin(); it != map.end(); ++it) {
+              if (begins_with(it->first, prefix)) {
+                f(it);
+              }
+            }
+          },
+          erased_keys, event_ids);
+    }
+    if (has_snapshot_) {
+      add_erase_events(std::move(locks), erased_keys, event_ids);
+      return;
+    }
     auto seq_no = binlog_->next_event_id(narrow_cast<int32>(event_ids.size()));
-    lock.reset();
+    locks.clear();
     for (auto event_id : event_ids) {
       add_event(seq_no, BinlogEvent::create_raw(event_id, BinlogEvent::ServiceTypes::Empty, BinlogEvent::Flags::Rewrite,
                                                 EmptyStorer()));
@@ -252,14 +491,185 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
   friend class BinlogKeyValue;
 
   static Status destroy(Slice name) {
+    unlink(get_snapshot_path(name)).ignore();
     return Binlog::destroy(name);
   }
 
  private:
-  std::unordered_map<string, std::pair<string, uint64>, Hash<string>> map_;
+  // event identifier is 0 for values, which are stored only in the snapshot
+  using Map = std::unordered_map<string, std::pair<string, uint64>, Hash<string>>;
+
+  // the map of a shard is never changed after it is published, so it can be read without a lock
+  // writers copy the map under the write lock of the shard, so they contend only with writers to the same shard
+  struct Shard {
+    // protects all changes of the shard; taken for reading only by threads without a hazard pointer
+    RwMutex rw_mutex{"BinlogKeyValue shard"};
+    std::atomic<Map *> map{nullptr};
+    vector<uint64> tombstone_event_ids;  // events, which erase keys stored in the snapshot
+    size_t tail_event_count = 0;
+    char pad[TD_CONCURRENCY_PAD];
+  };
+
+  static constexpr size_t SHARD_COUNT = 32;
+  static constexpr size_t MAX_LOCK_FREE_READER_THREAD_ID = 128;
+
+  std::array<Shard, SHARD_COUNT> shards_;
+  // a hazard pointer for each reader thread, followed by a slot for retired maps of each shard
+  HazardPointers<Map> hazard_pointers_{MAX_LOCK_FREE_READER_THREAD_ID + SHARD_COUNT};
   std::shared_ptr<BinlogT> binlog_;
-  RwMutex rw_mutex_;
   int32 magic_ = MAGIC;
+
+  static constexpr int32 SNAPSHOT_MAGIC = 0x2a28ffff;
+  static constexpr size_t MIN_SNAPSHOT_TAIL_EVENT_COUNT = 1000;
+
+  string snapshot_path_;
+  bool has_snapshot_ = false;
+  uint64 snapshot_event_id_ = 0;  // all events with smaller identifiers are included in the snapshot
+  uint64 marker_event_id_ = 0;
+  vector<uint64> stale_event_ids_;  // events, which are included in the snapshot, but weren't erased
+
+  static size_t get_shard_id(const string &key) {
+    return randomize_hash(Hash<string>()(key)) % SHARD_COUNT;
+  }
+
+  template <class F>
+  auto read_map(size_t shard_id, F &&f) {
+    auto &shard = shards_[shard_id];
+    auto thread_id = static_cast<size_t>(get_thread_id());
+    if (thread_id != 0 && thread_id < MAX_LOCK_FREE_READER_THREAD_ID) {
+      typename HazardPointers<Map>::Holder holder(hazard_pointers_, thread_id, 0);
+      return f(*holder.protect(shard.map));
+    }
+    // the thread has no unique identifier, so it can't own a hazard pointer
+    auto lock = shard.rw_mutex.lock_read().move_as_ok();
+    return f(*shard.map.load(std::memory_order_relaxed));
+  }
+
+  // must be called under the write lock of the shard
+  template <class F>
+  void update_map(size_t shard_id, F &&f) {
+    auto &shard = shards_[shard_id];
+    auto old_map = shard.map.load(std::memory_order_relaxed);
+    auto new_map = new Map(*old_map);
+    f(*new_map);
+    shard.map = new_map;
+    hazard_pointers_.retire(MAX_LOCK_FREE_READER_THREAD_ID + shard_id, old_map);
+  }
+
+  // can be used only while there are no concurrent readers
+  Map &get_map_unsafe(size_t shard_id) {
+    return *shards_[shard_id].map.load(std::memory_order_relaxed);
+  }
+
+  vector<RwMutex::WriteLock> lock_all_shards() {
+    vector<RwMutex::WriteLock> locks;
+    for (auto &shard : shards_) {
+      locks.push_back(shard.rw_mutex.lock_write().move_as_ok());
+    }
+    return locks;
+  }
+
+  vector<RwMutex::ReadLock> lock_all_shards_read() {
+    vector<RwMutex::ReadLock> locks;
+    for (auto &shard : shards_) {
+      locks.push_back(shard.rw_mutex.lock_read().move_as_ok());
+    }
+    return locks;
+  }
+
+  // must be called under the write lock of the shard; for_each_erased must call its argument for each erased key
+  template <class F>
+  void erase_from_shard(size_t shard_id, F &&for_each_erased, vector<string> &erased_keys,
+                        vector<uint64> &event_ids) {
+    vector<string> keys;
+    for_each_erased(*shards_[shard_id].map.load(std::memory_order_relaxed), [&](const auto &it) {
+      keys.push_back(it->first);
+      event_ids.push_back(it->second.second);
+    });
+    if (keys.empty()) {
+      return;
+    }
+    update_map(shard_id, [&](Map &map) {
+      for (auto &key : keys) {
+        map.erase(key);
+      }
+    });
+    if (has_snapshot_) {
+      append(erased_keys, std::move(keys));
+    }
+  }
+
+  void on_binlog_event(const BinlogEvent &binlog_event) {
+    if (binlog_event.id_ < snapshot_event_id_) {
+      stale_event_ids_.push_back(binlog_event.id_);
+      return;
+    }
+
+    Event event;
+    event.parse(TlParser(binlog_event.get_data()));
+    if (event.snapshot_magic == Event::SNAPSHOT_MARKER_MAGIC) {
+      if (binlog_event.id_ == snapshot_event_id_) {
+        marker_event_id_ = binlog_event.id_;
+      } else {
+        stale_event_ids_.push_back(binlog_event.id_);
+      }
+      return;
+    }
+    auto key = event.key.str();
+    auto shard_id = get_shard_id(key);
+    auto &shard = shards_[shard_id];
+    auto &map = get_map_unsafe(shard_id);
+    shard.tail_event_count++;
+    if (event.snapshot_magic == Event::TOMBSTONE_MAGIC) {
+      map.erase(key);
+      shard.tombstone_event_ids.push_back(binlog_event.id_);
+      return;
+    }
+    auto it_ok = map.emplace(std::move(key), std::make_pair(event.value.str(), binlog_event.id_));
+    if (!it_ok.second && it_ok.first->second.second == 0) {
+      // the value from the snapshot is overridden
+      it_ok.first->second = std::make_pair(event.value.str(), binlog_event.id_);
+    }
+  }
+
+  // must be called under the write lock of the shard of the key
+  BufferSlice create_erase_event(const string &key, uint64 event_id, uint64 seq_no) {
+    if (!has_snapshot_) {
+      return BinlogEvent::create_raw(event_id, BinlogEvent::ServiceTypes::Empty, BinlogEvent::Flags::Rewrite,
+                                     EmptyStorer());
+    }
+
+    // the key can be stored in the snapshot, so the erasure must be saved until the next snapshot
+    auto &shard = shards_[get_shard_id(key)];
+    Event event{key, Slice()};
+    event.snapshot_magic = Event::TOMBSTONE_MAGIC;
+    int32 flags = BinlogEvent::Flags::Rewrite;
+    if (event_id == 0) {
+      event_id = seq_no;
+      flags = 0;
+      shard.tail_event_count++;
+    }
+    shard.tombstone_event_ids.push_back(event_id);
+    return BinlogEvent::create_raw(event_id, magic_, flags, event);
+  }
+
+  SeqNo add_erase_events(vector<RwMutex::WriteLock> locks, const vector<string> &keys,
+                         const vector<uint64> &event_ids) {
+    CHECK(keys.size() == event_ids.size());
+    if (keys.empty()) {
+      return 0;
+    }
+    auto seq_no = binlog_->next_event_id(narrow_cast<int32>(keys.size()));
+    vector<BufferSlice> events;
+    for (size_t i = 0; i < keys.size(); i++) {
+      events.push_back(create_erase_event(keys[i], event_ids[i], seq_no + i));
+    }
+    locks.clear();
+    for (size_t i = 0; i < events.size(); i++) {
+      add_event(seq_no + i, std::move(events[i]));
+    }
+    return seq_no;
+  }
 };
 
 template <>
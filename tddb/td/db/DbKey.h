@@ -11,6 +11,26 @@
 
 namespace td {
 
+// SQLCipher page encryption settings; a database must be opened with the same settings, which were used to create it
+struct DbCipherProfile {
+  enum class Hmac : int32 { Sha512, Sha1, None };
+
+  int32 page_size = 0;  // 0 means the SQLCipher default
+  Hmac hmac = Hmac::Sha512;
+
+  bool is_default() const {
+    return page_size == 0 && hmac == Hmac::Sha512;
+  }
+};
+
+inline bool operator==(const DbCipherProfile &lhs, const DbCipherProfile &rhs) {
+  return lhs.page_size == rhs.page_size && lhs.hmac == rhs.hmac;
+}
+
+inline bool operator!=(const DbCipherProfile &lhs, const DbCipherProfile &rhs) {
+  return !(lhs == rhs);
+}
+
 class DbKey {
   enum class Type { Empty, RawKey, Password };
 
@@ -35,6 +55,15 @@ class DbKey {
     return data_;
   }
 
+  // used only by SQLite databases
+  const DbCipherProfile &cipher_profile() const {
+    return cipher_profile_;
+  }
+
+  void set_cipher_profile(DbCipherProfile cipher_profile) {
+    cipher_profile_ = cipher_profile;
+  }
+
   static DbKey raw_key(string raw_key) {
     DbKey res;
     res.type_ = Type::RawKey;
@@ -56,6 +85,7 @@ class DbKey {
  private:
   Type type_{Type::Empty};
   string data_;
+  DbCipherProfile cipher_profile_;
 };
 
 }  // namespace td
@@ -0,0 +1,161 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteCacheBudget.h"
+
+#include "td/db/detail/RawSqliteDb.h"
+
+#include "sqlite/sqlite3.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/algorithm.h"
+#include "td/utils/common.h"
+#include "td/utils/Time.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace td {
+
+namespace {
+
+constexpr double REBALANCE_PERIOD = 60.0;  // seconds
+constexpr int64 MIN_CACHE_SIZE = 64 << 10;
+
+struct ConnectionInfo {
+  detail::RawSqliteDb *db = nullptr;
+  int64 last_request_count = 0;
+};
+
+struct CacheBudgetState {
+  std::mutex mutex;
+  int64 budget = 0;
+  vector<ConnectionInfo> connections;
+};
+
+CacheBudgetState &get_cache_budget_state() {
+  static CacheBudgetState state;
+  return state;
+}
+
+std::atomic<bool> is_budget_enabled{false};
+std::atomic<double> next_rebalance_time{0.0};
+
+int64 get_db_status(tdsqlite3 *db, int op) {
+  int current = 0;
+  int highwater = 0;
+  if (tdsqlite3_db_status(db, op, &current, &highwater, 0) != SQLITE_OK) {
+    return 0;
+  }
+  return current;
+}
+
+int64 get_request_count(tdsqlite3 *db) {
+  return get_db_status(db, SQLITE_DBSTATUS_CACHE_HIT) + get_db_status(db, SQLITE_DBSTATUS_CACHE_MISS);
+}
+
+void rebalance_locked(CacheBudgetState &state) {
+  next_rebalance_time.store(Time::now() + REBALANCE_PERIOD, std::memory_order_relaxed);
+  if (state.connections.empty()) {
+    return;
+  }
+  if (state.budget == 0) {
+    for (auto &connection : state.connections) {
+      connection.db->set_cache_size_target(0);
+    }
+    return;
+  }
+
+  auto connection_count = static_cast<int64>(state.connections.size());
+  // a quarter of the budget is split evenly to keep caches of currently idle connections warm
+  auto min_share = state.budget / 4 / connection_count;
+  auto shared_budget = static_cast<double>(state.budget - min_share * connection_count);
+
+  vector<int64> request_counts;
+  int64 total_request_count = 0;
+  for (auto &connection : state.connections) {
+    auto request_count = get_request_count(connection.db->db());
+    auto new_request_count = max(request_count - connection.last_request_count, static_cast<int64>(0));
+    connection.last_request_count = request_count;
+    request_counts.push_back(new_request_count);
+    total_request_count += new_request_count;
+  }
+
+  for (size_t i = 0; i < state.connections.size(); i++) {
+    double share = total_request_count == 0
+                       ? 1.0 / static_cast<double>(connection_count)
+                       : static_cast<double>(request_counts[i]) / static_cast<double>(total_request_count);
+    auto cache_size = max(min_share + static_cast<int64>(shared_budget * share), MIN_CACHE_SIZE);
+    state.connections[i].db->set_cache_size_target(cache_size);
+  }
+}
+
+}  // namespace
+
+void SqliteCacheBudget::set_budget(int64 budget) {
+  auto &state = get_cache_budget_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.budget = max(budget, static_cast<int64>(0));
+  is_budget_enabled.store(state.budget != 0, std::memory_order_relaxed);
+  LOG(INFO) << "Set SQLite page cache budget to " << state.budget;
+  rebalance_locked(state);
+}
+
+int64 SqliteCacheBudget::get_budget() {
+  auto &state = get_cache_budget_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.budget;
+}
+
+vector<SqliteCacheBudget::ConnectionStatistics> SqliteCacheBudget::get_statistics() {
+  auto &state = get_cache_budget_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  vector<ConnectionStatistics> result;
+  for (auto &connection : state.connections) {
+    auto db = connection.db->db();
+    ConnectionStatistics statistics;
+    statistics.path = connection.db->path().str();
+    statistics.cache_size = connection.db->get_cache_size_target();
+    statistics.cache_used = get_db_status(db, SQLITE_DBSTATUS_CACHE_USED);
+    statistics.hit_count = get_db_status(db, SQLITE_DBSTATUS_CACHE_HIT);
+    statistics.miss_count = get_db_status(db, SQLITE_DBSTATUS_CACHE_MISS);
+    result.push_back(std::move(statistics));
+  }
+  return result;
+}
+
+void SqliteCacheBudget::rebalance_if_needed() {
+  if (!is_budget_enabled.load(std::memory_order_relaxed) ||
+      Time::now() < next_rebalance_time.load(std::memory_order_relaxed)) {
+    return;
+  }
+  auto &state = get_cache_budget_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  rebalance_locked(state);
+}
+
+void SqliteCacheBudget::register_connection(detail::RawSqliteDb *db) {
+  auto &state = get_cache_budget_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  ConnectionInfo connection;
+  connection.db = db;
+  connection.last_request_count = get_request_count(db->db());
+  state.connections.push_back(connection);
+  if (state.budget != 0) {
+    rebalance_locked(state);
+  }
+}
+
+void SqliteCacheBudget::unregister_connection(detail::RawSqliteDb *db) {
+  auto &state = get_cache_budget_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  td::remove_if(state.connections, [db](const ConnectionInfo &connection) { return connection.db == db; });
+  if (state.budget != 0) {
+    rebalance_locked(state);
+  }
+}
+
+}  // namespace td
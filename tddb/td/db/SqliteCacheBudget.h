@@ -0,0 +1,46 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+namespace td {
+
+namespace detail {
+class RawSqliteDb;
+}  // namespace detail
+
+// Distributes a process-wide page cache budget between all opened SQLite connections
+// The budget is split proportionally to the number of page requests made by each connection since the last
+// rebalancing, and each connection is guaranteed to receive a small equal share
+// By default, the budget is disabled and every connection uses the default SQLite cache size
+class SqliteCacheBudget {
+ public:
+  struct ConnectionStatistics {
+    string path;
+    int64 cache_size = 0;  // in bytes; 0 if the default cache size is used
+    int64 cache_used = 0;  // in bytes
+    int64 hit_count = 0;
+    int64 miss_count = 0;
+  };
+
+  // sets total size of page caches of all connections in bytes; 0 disables the budget
+  static void set_budget(int64 budget);
+
+  static int64 get_budget();
+
+  static vector<ConnectionStatistics> get_statistics();
+
+  // recalculates cache sizes of connections if the budget is enabled and the last rebalancing was long ago
+  static void rebalance_if_needed();
+
+  static void register_connection(detail::RawSqliteDb *db);
+
+  static void unregister_connection(detail::RawSqliteDb *db);
+};
+
+}  // namespace td
@@ -32,7 +32,9 @@ void SqliteConnectionSafe::set(SqliteDb &&db) {
 }
 
 SqliteDb &SqliteConnectionSafe::get() {
-  return lsls_connection_.get();
+  auto &db = lsls_connection_.get();
+  db.update_cache_size();
+  return db;
 }
 
 void SqliteConnectionSafe::close() {
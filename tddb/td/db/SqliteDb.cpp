@@ -6,20 +6,29 @@
 //
 #include "td/db/SqliteDb.h"
 
+#include "td/db/SqliteCacheBudget.h"
+
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/Metrics.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/Time.h"
 #include "td/utils/Timer.h"
 
 #include "sqlite/sqlite3.h"
 
 namespace td {
 
+static MetricCounter sqlite_commit_count_metric("td_sqlite_commits_total", "Number of committed SQLite transactions");
+static MetricHistogram sqlite_commit_duration_metric("td_sqlite_commit_duration_seconds",
+                                                     "Duration of SQLite transaction commit",
+                                                     {0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0});
+
 namespace {
 string quote_string(Slice str) {
   size_t cnt = 0;
@@ -67,6 +76,26 @@ string db_key_to_sqlcipher_key(const DbKey &db_key) {
   res.resize(expected_size);
   return res;
 }
+
+Status set_cipher_profile(SqliteDb &db, Slice schema_name, const DbCipherProfile &cipher_profile) {
+  string prefix = schema_name.empty() ? string() : PSTRING() << schema_name << '.';
+  if (cipher_profile.page_size != 0) {
+    TRY_STATUS(db.exec(PSLICE() << "PRAGMA " << prefix << "cipher_page_size = " << cipher_profile.page_size));
+  }
+  switch (cipher_profile.hmac) {
+    case DbCipherProfile::Hmac::Sha512:
+      break;
+    case DbCipherProfile::Hmac::Sha1:
+      TRY_STATUS(db.exec(PSLICE() << "PRAGMA " << prefix << "cipher_hmac_algorithm = HMAC_SHA1"));
+      break;
+    case DbCipherProfile::Hmac::None:
+      TRY_STATUS(db.exec(PSLICE() << "PRAGMA " << prefix << "cipher_use_hmac = OFF"));
+      break;
+    default:
+      UNREACHABLE();
+  }
+  return Status::OK();
+}
 }  // namespace
 
 SqliteDb::~SqliteDb() = default;
@@ -190,15 +219,37 @@ Status SqliteDb::begin_read_transaction() {
 
 Status SqliteDb::begin_write_transaction() {
   if (raw_->on_begin()) {
+    SqliteCacheBudget::rebalance_if_needed();
+    update_cache_size();
     return exec("BEGIN IMMEDIATE");
   }
   return Status::OK();
 }
 
+void SqliteDb::update_cache_size() {
+  if (raw_ == nullptr || !raw_->need_update_cache_size()) {
+    return;
+  }
+  auto cache_size = raw_->on_update_cache_size();
+  // negative value of cache_size is measured in KiB; -2000 is the default SQLite value
+  auto cache_size_kb = cache_size == 0 ? static_cast<int64>(2000) : max(cache_size >> 10, static_cast<int64>(1));
+  auto status = exec(PSLICE() << "PRAGMA cache_size = -" << cache_size_kb);
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to change cache size of " << raw_->path() << ": " << status;
+  }
+}
+
 Status SqliteDb::commit_transaction() {
   TRY_RESULT(need_commit, raw_->on_commit());
   if (need_commit) {
-    return exec("COMMIT");
+    if (!MetricRegistry::is_enabled()) {
+      return exec("COMMIT");
+    }
+    auto start_time = Time::now();
+    auto status = exec("COMMIT");
+    sqlite_commit_count_metric.add();
+    sqlite_commit_duration_metric.observe(Time::now() - start_time);
+    return status;
   }
   return Status::OK();
 }
@@ -233,6 +284,8 @@ Result<SqliteDb> SqliteDb::do_open_with_key(CSlice path, bool allow_creation, co
     if (cipher_version != 0) {
       LOG(INFO) << "Trying SQLCipher compatibility mode with version = " << cipher_version;
       TRY_STATUS(db.exec(PSLICE() << "PRAGMA cipher_compatibility = " << cipher_version));
+    } else {
+      TRY_STATUS(set_cipher_profile(db, Slice(), db_key.cipher_profile()));
     }
     db.set_cipher_version(cipher_version);
   }
@@ -278,6 +331,7 @@ Result<SqliteDb> SqliteDb::change_key(CSlice path, bool allow_creation, const Db
     // make sure that database is not empty
     TRY_STATUS(db.exec("CREATE TABLE IF NOT EXISTS encryption_dummy_table(id INT PRIMARY KEY)"));
     TRY_STATUS(db.exec(PSLICE() << "ATTACH DATABASE '" << quote_string(tmp_path) << "' AS encrypted KEY " << new_key));
+    TRY_STATUS(set_cipher_profile(db, "encrypted", new_db_key.cipher_profile()));
     TRY_STATUS(db.exec("SELECT sqlcipher_export('encrypted')"));
     TRY_STATUS(db.exec(PSLICE() << "PRAGMA encrypted.user_version = " << user_version));
     TRY_STATUS(db.exec("DETACH DATABASE encrypted"));
@@ -295,6 +349,20 @@ Result<SqliteDb> SqliteDb::change_key(CSlice path, bool allow_creation, const Db
     TRY_STATUS(db.exec("DETACH DATABASE decrypted"));
     db.close();
     TRY_STATUS(rename(tmp_path, path));
+  } else if (old_db_key.cipher_profile() != new_db_key.cipher_profile()) {
+    // page size and HMAC settings can't be changed by rekey, so the database is exported with the new settings
+    LOG(DEBUG) << "REENCRYPT";
+    PerfWarningTimer timer("Reencrypt SQLite database", 0.1);
+    auto tmp_path = path.str() + ".encrypted";
+    TRY_STATUS(create_database(tmp_path));
+
+    TRY_STATUS(db.exec(PSLICE() << "ATTACH DATABASE '" << quote_string(tmp_path) << "' AS encrypted KEY " << new_key));
+    TRY_STATUS(set_cipher_profile(db, "encrypted", new_db_key.cipher_profile()));
+    TRY_STATUS(db.exec("SELECT sqlcipher_export('encrypted')"));
+    TRY_STATUS(db.exec(PSLICE() << "PRAGMA encrypted.user_version = " << user_version));
+    TRY_STATUS(db.exec("DETACH DATABASE encrypted"));
+    db.close();
+    TRY_STATUS(rename(tmp_path, path));
   } else {
     LOG(DEBUG) << "REKEY";
     PerfWarningTimer timer("Rekey SQLite database", 0.1);
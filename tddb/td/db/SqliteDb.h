@@ -55,6 +55,9 @@ class SqliteDb {
   Status set_user_version(int32 version) TD_WARN_UNUSED_RESULT;
   void trace(bool flag);
 
+  // applies the page cache size assigned by SqliteCacheBudget; must be called by the thread, which uses the connection
+  void update_cache_size();
+
   static Status destroy(Slice path) TD_WARN_UNUSED_RESULT;
 
   // we can't change the key on the fly, so static functions are more than enough
@@ -0,0 +1,144 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteIncrementalVacuum.h"
+
+#include "td/db/SqliteConnectionSafe.h"
+#include "td/db/SqliteDb.h"
+
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
+
+namespace td {
+
+class SqliteIncrementalVacuum::Impl final : public Actor {
+ public:
+  explicit Impl(std::shared_ptr<SqliteConnectionSafe> connection) : connection_(std::move(connection)) {
+  }
+
+  void check() {
+    if (connection_ == nullptr || is_running_) {
+      return;
+    }
+    auto r_free_page_count = get_free_page_count();
+    if (r_free_page_count.is_error()) {
+      LOG(ERROR) << "Failed to get free page count: " << r_free_page_count.error();
+      return set_timeout_in(CHECK_DELAY);
+    }
+    auto free_page_count = r_free_page_count.move_as_ok();
+    if (free_page_count < MIN_FREE_PAGE_COUNT) {
+      return set_timeout_in(CHECK_DELAY);
+    }
+
+    LOG(INFO) << "Start incremental vacuum of " << free_page_count << " free pages";
+    is_running_ = true;
+    start_free_page_count_ = free_page_count;
+    start_time_ = Time::now();
+    run_time_ = 0.0;
+    run_slice();
+  }
+
+  void close(Promise<Unit> promise) {
+    connection_.reset();
+    stop();
+    promise.set_value(Unit());
+  }
+
+ private:
+  static constexpr int64 MIN_FREE_PAGE_COUNT = 1024;
+  static constexpr int32 SLICE_PAGE_COUNT = 128;
+  static constexpr double INITIAL_CHECK_DELAY = 60.0;
+  static constexpr double CHECK_DELAY = 3600.0;
+  static constexpr double MIN_SLICE_DELAY = 0.05;
+  static constexpr double SLICE_DELAY_RUN_TIME_RATIO = 9.0;  // use at most 10% of the scheduler time
+
+  std::shared_ptr<SqliteConnectionSafe> connection_;
+  bool is_running_ = false;
+  int64 start_free_page_count_ = 0;
+  double start_time_ = 0.0;
+  double run_time_ = 0.0;
+
+  void start_up() final {
+    set_timeout_in(INITIAL_CHECK_DELAY);
+  }
+
+  void timeout_expired() final {
+    if (is_running_) {
+      run_slice();
+    } else {
+      check();
+    }
+  }
+
+  Result<int64> get_free_page_count() {
+    auto &db = connection_->get();
+    TRY_RESULT(auto_vacuum, db.get_pragma_string("auto_vacuum"));
+    if (auto_vacuum != "2") {
+      // the database can't be vacuumed incrementally
+      return 0;
+    }
+    TRY_RESULT(free_page_count, db.get_pragma_string("freelist_count"));
+    return to_integer_safe<int64>(free_page_count);
+  }
+
+  void run_slice() {
+    CHECK(is_running_);
+    CHECK(connection_ != nullptr);
+    auto &db = connection_->get();
+    auto slice_start_time = Time::now();
+    auto status = db.exec(PSLICE() << "PRAGMA incremental_vacuum(" << SLICE_PAGE_COUNT << ')');
+    auto r_free_page_count = get_free_page_count();
+    auto slice_run_time = Time::now() - slice_start_time;
+    run_time_ += slice_run_time;
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to run incremental vacuum: " << status;
+      return finish(start_free_page_count_);
+    }
+    if (r_free_page_count.is_error()) {
+      LOG(ERROR) << "Failed to get free page count: " << r_free_page_count.error();
+      return finish(start_free_page_count_);
+    }
+
+    auto free_page_count = r_free_page_count.move_as_ok();
+    if (free_page_count < SLICE_PAGE_COUNT) {
+      return finish(free_page_count);
+    }
+    auto slice_delay = slice_run_time * SLICE_DELAY_RUN_TIME_RATIO;
+    if (slice_delay < MIN_SLICE_DELAY) {
+      slice_delay = MIN_SLICE_DELAY;
+    }
+    set_timeout_in(slice_delay);
+  }
+
+  void finish(int64 free_page_count) {
+    LOG(INFO) << "Finish incremental vacuum: free page count changed from " << start_free_page_count_ << " to "
+              << free_page_count << " in " << format::as_time(Time::now() - start_time_) << " with run time "
+              << format::as_time(run_time_);
+    is_running_ = false;
+    set_timeout_in(CHECK_DELAY);
+  }
+};
+
+SqliteIncrementalVacuum::SqliteIncrementalVacuum(std::shared_ptr<SqliteConnectionSafe> connection,
+                                                 int32 scheduler_id) {
+  impl_ = create_actor_on_scheduler<Impl>("SqliteIncrementalVacuum", scheduler_id, std::move(connection));
+}
+
+SqliteIncrementalVacuum::~SqliteIncrementalVacuum() = default;
+
+void SqliteIncrementalVacuum::check() {
+  send_closure_later(impl_, &Impl::check);
+}
+
+void SqliteIncrementalVacuum::close(Promise<Unit> promise) {
+  send_closure_later(impl_, &Impl::close, std::move(promise));
+}
+
+}  // namespace td
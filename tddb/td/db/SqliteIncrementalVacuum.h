@@ -0,0 +1,42 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Promise.h"
+
+#include <memory>
+
+namespace td {
+
+class SqliteConnectionSafe;
+
+// returns free pages of a database with auto_vacuum=INCREMENTAL to the file system in small slices,
+// so the database isn't blocked for a long time as it is by a full VACUUM
+// the slices are run on the scheduler of the writer and use at most a small part of its time
+class SqliteIncrementalVacuum {
+ public:
+  explicit SqliteIncrementalVacuum(std::shared_ptr<SqliteConnectionSafe> connection, int32 scheduler_id = -1);
+  SqliteIncrementalVacuum(const SqliteIncrementalVacuum &) = delete;
+  SqliteIncrementalVacuum &operator=(const SqliteIncrementalVacuum &) = delete;
+  SqliteIncrementalVacuum(SqliteIncrementalVacuum &&) = delete;
+  SqliteIncrementalVacuum &operator=(SqliteIncrementalVacuum &&) = delete;
+  ~SqliteIncrementalVacuum();
+
+  // checks the number of free pages immediately, for example, after a lot of data was deleted
+  void check();
+
+  void close(Promise<Unit> promise);
+
+ private:
+  class Impl;
+  ActorOwn<Impl> impl_;
+};
+
+}  // namespace td
@@ -8,8 +8,11 @@
 
 #include "td/utils/base64.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
 
+#include <utility>
+
 namespace td {
 
 Status SqliteKeyValue::init_with_connection(SqliteDb connection, string table_name) {
@@ -36,6 +39,23 @@ Status SqliteKeyValue::init_with_connection(SqliteDb connection, string table_na
   TRY_RESULT_ASSIGN(get_by_prefix_rare_stmt_,
                     db_.get_statement(PSLICE() << "SELECT k, v FROM " << table_name_ << " WHERE ?1 <= k"));
 
+  string values;
+  string keys;
+  for (size_t i = 1; i <= BATCH_SIZE; i++) {
+    if (i != 1) {
+      values += ", ";
+      keys += ", ";
+    }
+    values += PSTRING() << "(?" << 2 * i - 1 << ", ?" << 2 * i << ')';
+    keys += PSTRING() << '?' << i;
+  }
+  TRY_RESULT_ASSIGN(set_batch_stmt_,
+                    db_.get_statement(PSLICE() << "REPLACE INTO " << table_name_ << " (k, v) VALUES " << values));
+  TRY_RESULT_ASSIGN(get_batch_stmt_,
+                    db_.get_statement(PSLICE() << "SELECT k, v FROM " << table_name_ << " WHERE k IN (" << keys << ')'));
+  TRY_RESULT_ASSIGN(erase_batch_stmt_,
+                    db_.get_statement(PSLICE() << "DELETE FROM " << table_name_ << " WHERE k IN (" << keys << ')'));
+
   init_guard.dismiss();
   return Status::OK();
 }
@@ -60,10 +80,37 @@ void SqliteKeyValue::set(Slice key, Slice value) {
   set_stmt_.reset();
 }
 
+template <class F>
+void SqliteKeyValue::for_each_batch(size_t size, F &&f) {
+  // get_index(i) returns index of the element, which must be bound at the position i of the batch
+  for (size_t begin = 0; begin < size; begin += BATCH_SIZE) {
+    auto end = min(begin + BATCH_SIZE, size);
+    f(begin, [begin, end](size_t i) { return min(begin + i, end - 1); });
+  }
+}
+
 void SqliteKeyValue::set_all(const FlatHashMap<string, string> &key_values) {
   begin_write_transaction().ensure();
-  for (auto &key_value : key_values) {
-    set(key_value.first, key_value.second);
+  if (key_values.size() == 1) {
+    set(key_values.begin()->first, key_values.begin()->second);
+  } else {
+    vector<std::pair<Slice, Slice>> pairs;
+    pairs.reserve(key_values.size());
+    for (auto &key_value : key_values) {
+      pairs.emplace_back(key_value.first, key_value.second);
+    }
+    for_each_batch(pairs.size(), [&](size_t begin, auto get_index) {
+      for (size_t i = 0; i < BATCH_SIZE; i++) {
+        const auto &key_value = pairs[get_index(i)];
+        set_batch_stmt_.bind_blob(narrow_cast<int>(2 * i + 1), key_value.first).ensure();
+        set_batch_stmt_.bind_blob(narrow_cast<int>(2 * i + 2), key_value.second).ensure();
+      }
+      auto status = set_batch_stmt_.step();
+      if (status.is_error()) {
+        LOG(FATAL) << "Failed to set \"" << base64_encode(pairs[begin].first) << "\" and other keys: " << status;
+      }
+      set_batch_stmt_.reset();
+    });
   }
   commit_transaction().ensure();
 }
@@ -82,6 +129,39 @@ string SqliteKeyValue::get(Slice key) {
   return data;
 }
 
+vector<string> SqliteKeyValue::get_many(const vector<string> &keys) {
+  vector<string> result(keys.size());
+  if (keys.size() <= 1) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      result[i] = get(keys[i]);
+    }
+    return result;
+  }
+
+  FlatHashMap<string, string> values;
+  for_each_batch(keys.size(), [&](size_t begin, auto get_index) {
+    auto guard = get_batch_stmt_.guard();
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+      get_batch_stmt_.bind_blob(narrow_cast<int>(i + 1), keys[get_index(i)]).ensure();
+    }
+    get_batch_stmt_.step().ensure();
+    while (get_batch_stmt_.has_row()) {
+      auto key = get_batch_stmt_.view_blob(0);
+      if (!key.empty()) {
+        values[key.str()] = get_batch_stmt_.view_blob(1).str();
+      }
+      get_batch_stmt_.step().ensure();
+    }
+  });
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto it = values.find(keys[i]);
+    if (it != values.end()) {
+      result[i] = it->second;
+    }
+  }
+  return result;
+}
+
 void SqliteKeyValue::erase(Slice key) {
   erase_stmt_.bind_blob(1, key).ensure();
   erase_stmt_.step().ensure();
@@ -89,9 +169,16 @@ void SqliteKeyValue::erase(Slice key) {
 }
 
 void SqliteKeyValue::erase_batch(vector<string> keys) {
-  for (auto &key : keys) {
-    erase(key);
+  if (keys.size() == 1) {
+    return erase(keys[0]);
   }
+  for_each_batch(keys.size(), [&](size_t begin, auto get_index) {
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+      erase_batch_stmt_.bind_blob(narrow_cast<int>(i + 1), keys[get_index(i)]).ensure();
+    }
+    erase_batch_stmt_.step().ensure();
+    erase_batch_stmt_.reset();
+  });
 }
 
 void SqliteKeyValue::erase_by_prefix(Slice prefix) {
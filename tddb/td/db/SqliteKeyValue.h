@@ -45,6 +45,9 @@ class SqliteKeyValue {
 
   string get(Slice key);
 
+  // returns values of the keys in the same order; values of non-existing keys are empty
+  vector<string> get_many(const vector<string> &keys);
+
   void erase(Slice key);
 
   void erase_batch(vector<string> keys);
@@ -119,7 +122,16 @@ class SqliteKeyValue {
   SqliteStatement get_by_prefix_stmt_;
   SqliteStatement get_by_prefix_rare_stmt_;
 
+  // statements for BATCH_SIZE keys at once; shorter batches are padded with the last key
+  static constexpr size_t BATCH_SIZE = 32;
+  SqliteStatement set_batch_stmt_;
+  SqliteStatement get_batch_stmt_;
+  SqliteStatement erase_batch_stmt_;
+
   static string next_prefix(Slice prefix);
+
+  template <class F>
+  static void for_each_batch(size_t size, F &&f);
 };
 
 }  // namespace td
@@ -36,6 +36,9 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
   void get(string key, Promise<string> promise) final {
     send_closure_later(impl_, &Impl::get, std::move(key), std::move(promise));
   }
+  void get_many(vector<string> keys, Promise<vector<string>> promise) final {
+    send_closure_later(impl_, &Impl::get_many, std::move(keys), std::move(promise));
+  }
   void close(Promise<Unit> promise) final {
     send_closure_later(impl_, &Impl::close, std::move(promise));
   }
@@ -96,6 +99,28 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
       promise.set_value(kv_->get(key));
     }
 
+    void get_many(vector<string> keys, Promise<vector<string>> promise) {
+      vector<string> values(keys.size());
+      vector<size_t> positions;
+      vector<string> database_keys;
+      for (size_t i = 0; i < keys.size(); i++) {
+        auto it = buffer_.find(keys[i]);
+        if (it != buffer_.end()) {
+          if (it->second) {
+            values[i] = it->second.value();
+          }
+        } else {
+          positions.push_back(i);
+          database_keys.push_back(std::move(keys[i]));
+        }
+      }
+      auto database_values = kv_->get_many(database_keys);
+      for (size_t i = 0; i < positions.size(); i++) {
+        values[positions[i]] = std::move(database_values[i]);
+      }
+      promise.set_value(std::move(values));
+    }
+
     void close(Promise<Unit> promise) {
       do_flush(true /*force*/);
       kv_safe_.reset();
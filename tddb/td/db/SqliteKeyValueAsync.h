@@ -30,6 +30,9 @@ class SqliteKeyValueAsyncInterface {
 
   virtual void get(string key, Promise<string> promise) = 0;
 
+  // returns values of the keys in the same order; values of non-existing keys are empty
+  virtual void get_many(vector<string> keys, Promise<vector<string>> promise) = 0;
+
   virtual void close(Promise<Unit> promise) = 0;
 };
 
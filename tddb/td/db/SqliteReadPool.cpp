@@ -0,0 +1,41 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteReadPool.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <memory>
+
+namespace td {
+
+namespace {
+class SqliteReader final : public Actor {};
+}  // namespace
+
+SqliteReadPool::SqliteReadPool(vector<int32> scheduler_ids) {
+  CHECK(!scheduler_ids.empty());
+  for (size_t i = 0; i < scheduler_ids.size(); i++) {
+    readers_.emplace_back(create_actor_on_scheduler<SqliteReader>(PSLICE() << "SqliteReader" << i, scheduler_ids[i]));
+  }
+}
+
+SqliteReadPool::~SqliteReadPool() = default;
+
+void SqliteReadPool::flush(Promise<Unit> promise) {
+  auto left_count = std::make_shared<std::atomic<size_t>>(readers_.size());
+  auto shared_promise = std::make_shared<Promise<Unit>>(std::move(promise));
+  for (auto &reader : readers_) {
+    send_lambda(reader, [left_count, shared_promise] {
+      if (left_count->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        shared_promise->set_value(Unit());
+      }
+    });
+  }
+}
+
+}  // namespace td
@@ -0,0 +1,45 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Promise.h"
+
+#include <atomic>
+#include <utility>
+
+namespace td {
+
+// runs read queries on dedicated schedulers, each of them has its own SQLite connection through SqliteConnectionSafe
+// writes must stay on the writer, and a read must be added only after all writes it depends on are committed
+class SqliteReadPool {
+ public:
+  explicit SqliteReadPool(vector<int32> scheduler_ids);
+  SqliteReadPool(const SqliteReadPool &) = delete;
+  SqliteReadPool &operator=(const SqliteReadPool &) = delete;
+  SqliteReadPool(SqliteReadPool &&) = delete;
+  SqliteReadPool &operator=(SqliteReadPool &&) = delete;
+  ~SqliteReadPool();
+
+  // the function is run on one of the reader schedulers, so the connection must be obtained inside it
+  template <class F>
+  void run(F &&f) {
+    auto reader_id = next_reader_id_.fetch_add(1, std::memory_order_relaxed) % readers_.size();
+    send_lambda(readers_[reader_id], std::forward<F>(f));
+  }
+
+  // the promise is set after all previously added functions have finished
+  void flush(Promise<Unit> promise);
+
+ private:
+  vector<ActorOwn<>> readers_;
+  std::atomic<size_t> next_reader_id_{0};
+};
+
+}  // namespace td
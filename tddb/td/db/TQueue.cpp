@@ -11,16 +11,22 @@
 #include "td/db/binlog/BinlogHelper.h"
 #include "td/db/binlog/BinlogInterface.h"
 
+#include "td/utils/crypto.h"
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/PathView.h"
+#include "td/utils/port/MemoryMapping.h"
+#include "td/utils/port/path.h"
 #include "td/utils/Random.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/StorerBase.h"
 #include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
 
+#include <cstring>
 #include <set>
 
 namespace td {
@@ -180,7 +186,7 @@ class TQueueImpl final : public TQueue {
 
     RawEvent raw_event;
     raw_event.event_id = event_id;
-    raw_event.data = std::move(data);
+    raw_event.data = BufferSlice(data);
     raw_event.expires_at = expires_at;
     raw_event.extra = extra;
     bool is_added = do_push(queue_id, std::move(raw_event));
@@ -294,22 +300,40 @@ class TQueueImpl final : public TQueue {
 
   Result<size_t> get(QueueId queue_id, EventId from_id, bool forget_previous, int32 unix_time_now,
                      MutableSpan<Event> &result_events) final {
-    auto it = queues_.find(queue_id);
-    if (it == queues_.end()) {
-      result_events.truncate(0);
-      return 0;
-    }
-    auto &q = it->second;
-    // Some sanity checks
-    if (from_id.value() > q.tail_id.value() + 10) {
-      return Status::Error("Specified from_id is in the future");
-    }
-    if (from_id.value() < get_queue_head(q).value() - static_cast<int32>(MAX_QUEUE_EVENTS)) {
-      return Status::Error("Specified from_id is in the past");
-    }
+    return do_get(queue_id, from_id, forget_previous, unix_time_now, result_events);
+  }
 
-    do_get(queue_id, q, from_id, forget_previous, unix_time_now, result_events);
-    return get_size(q);
+  Result<size_t> get(QueueId queue_id, EventId from_id, bool forget_previous, int32 unix_time_now,
+                     MutableSpan<SharedEvent> &result_events) final {
+    return do_get(queue_id, from_id, forget_previous, unix_time_now, result_events);
+  }
+
+  vector<GetQueryResult> get_batch(Span<GetQuery> queries, int32 unix_time_now,
+                                   vector<SharedEvent> &result_events) final {
+    size_t total_limit = result_events.size();
+    for (auto &query : queries) {
+      total_limit += query.limit;
+    }
+    result_events.reserve(total_limit);
+
+    vector<GetQueryResult> results(queries.size());
+    for (size_t i = 0; i < queries.size(); i++) {
+      auto &query = queries[i];
+      auto &result = results[i];
+      result.events_offset = result_events.size();
+      result_events.resize(result.events_offset + query.limit);
+      MutableSpan<SharedEvent> events(result_events.data() + result.events_offset, query.limit);
+      auto r_queue_size = do_get(query.queue_id, query.from_id, query.forget_previous, unix_time_now, events);
+      if (r_queue_size.is_error()) {
+        result.status = r_queue_size.move_as_error();
+        events.truncate(0);
+      } else {
+        result.queue_size = r_queue_size.ok();
+      }
+      result.event_count = events.size();
+      result_events.resize(result.events_offset + result.event_count);
+    }
+    return results;
   }
 
   std::pair<int64, bool> run_gc(int32 unix_time_now) final {
@@ -429,8 +453,38 @@ class TQueueImpl final : public TQueue {
     event.data = {};
   }
 
+  template <class EventT>
+  Result<size_t> do_get(QueueId queue_id, EventId from_id, bool forget_previous, int32 unix_time_now,
+                        MutableSpan<EventT> &result_events) {
+    auto it = queues_.find(queue_id);
+    if (it == queues_.end()) {
+      result_events.truncate(0);
+      return 0;
+    }
+    auto &q = it->second;
+    // Some sanity checks
+    if (from_id.value() > q.tail_id.value() + 10) {
+      return Status::Error("Specified from_id is in the future");
+    }
+    if (from_id.value() < get_queue_head(q).value() - static_cast<int32>(MAX_QUEUE_EVENTS)) {
+      return Status::Error("Specified from_id is in the past");
+    }
+
+    do_get(queue_id, q, from_id, forget_previous, unix_time_now, result_events);
+    return get_size(q);
+  }
+
+  static void set_event_data(Event &to, const RawEvent &from) {
+    to.data = from.data.as_slice();
+  }
+
+  static void set_event_data(SharedEvent &to, const RawEvent &from) {
+    to.data = from.data.copy();
+  }
+
+  template <class EventT>
   void do_get(QueueId queue_id, Queue &q, EventId from_id, bool forget_previous, int32 unix_time_now,
-              MutableSpan<Event> &result_events) {
+              MutableSpan<EventT> &result_events) {
     if (forget_previous) {
       for (auto it = q.events.begin(); it != q.events.end() && it->first < from_id;) {
         pop(q, queue_id, it, q.tail_id);
@@ -449,7 +503,7 @@ class TQueueImpl final : public TQueue {
         }
 
         auto &to = result_events[ready_n];
-        to.data = event.data;
+        set_event_data(to, event);
         to.id = event.event_id;
         to.expires_at = event.expires_at;
         to.extra = event.extra;
@@ -566,7 +620,7 @@ Status TQueueBinlog<BinlogT>::replay(const BinlogEvent &binlog_event, TQueue &q)
   raw_event.log_event_id = binlog_event.id_;
   raw_event.event_id = event_id;
   raw_event.expires_at = event.expires_at;
-  raw_event.data = event.data.str();
+  raw_event.data = BufferSlice(event.data);
   raw_event.extra = event.extra;
   if (!q.do_push(event.queue_id, std::move(raw_event))) {
     return Status::Error("Failed to add event");
@@ -584,7 +638,7 @@ template class TQueueBinlog<Binlog>;
 
 uint64 TQueueMemoryStorage::push(QueueId queue_id, const RawEvent &event) {
   auto log_event_id = event.log_event_id == 0 ? next_log_event_id_++ : event.log_event_id;
-  events_[log_event_id] = std::make_pair(queue_id, event);
+  events_[log_event_id] = std::make_pair(queue_id, event.copy());
   return log_event_id;
 }
 
@@ -594,9 +648,9 @@ void TQueueMemoryStorage::pop(uint64 log_event_id) {
 
 void TQueueMemoryStorage::replay(TQueue &q) const {
   for (auto &e : events_) {
-    auto x = e.second;
-    x.second.log_event_id = e.first;
-    bool is_added = q.do_push(x.first, std::move(x.second));
+    auto raw_event = e.second.second.copy();
+    raw_event.log_event_id = e.first;
+    bool is_added = q.do_push(e.second.first, std::move(raw_event));
     CHECK(is_added);
   }
 }
@@ -605,6 +659,341 @@ void TQueueMemoryStorage::close(Promise<> promise) {
   promise.set_value({});
 }
 
+struct TQueueFileRecord {
+  static constexpr int32 PUSH = 1;
+  static constexpr int32 POP = 2;
+  static constexpr size_t MIN_SIZE = 4 + 4 + 8 + 4;
+
+  int32 type{0};
+  uint64 log_event_id{0};
+  int32 event_id{0};
+  int32 expires_at{0};
+  int64 extra{0};
+  Slice data;
+
+  template <class StorerT>
+  void store(StorerT &&storer) const {
+    using td::store;
+    store(type, storer);
+    store(static_cast<int64>(log_event_id), storer);
+    if (type == PUSH) {
+      store(event_id, storer);
+      store(expires_at, storer);
+      store(extra, storer);
+      store(data, storer);
+    }
+  }
+
+  // record size, record body and CRC32 of the record size and the body
+  string serialize() const {
+    TlStorerCalcLength calc_length;
+    store(calc_length);
+    auto size = calc_length.get_length() + 8;
+    string result(size, '\0');
+    TlStorerUnsafe storer(MutableSlice(result).ubegin());
+    storer.store_int(narrow_cast<int32>(size));
+    store(storer);
+    storer.store_int(static_cast<int32>(crc32(Slice(result).substr(0, size - 4))));
+    return result;
+  }
+
+  // returns size of the record at the beginning of data or 0 if there is no valid complete record there
+  size_t parse(Slice data) {
+    if (data.size() < MIN_SIZE) {
+      return 0;
+    }
+    int32 size;
+    std::memcpy(&size, data.data(), sizeof(size));
+    if (size < static_cast<int32>(MIN_SIZE) || static_cast<size_t>(size) > data.size() || size % 4 != 0) {
+      return 0;
+    }
+    uint32 stored_crc;
+    std::memcpy(&stored_crc, data.data() + size - 4, sizeof(stored_crc));
+    if (crc32(data.substr(0, size - 4)) != stored_crc) {
+      return 0;
+    }
+
+    TlParser parser(data.substr(4, size - 8));
+    type = parser.fetch_int();
+    log_event_id = static_cast<uint64>(parser.fetch_long());
+    if (type == PUSH) {
+      event_id = parser.fetch_int();
+      expires_at = parser.fetch_int();
+      extra = parser.fetch_long();
+      this->data = parser.template fetch_string<Slice>();
+    } else if (type != POP) {
+      return 0;
+    }
+    parser.fetch_end();
+    if (parser.get_status().is_error()) {
+      return 0;
+    }
+    return static_cast<size_t>(size);
+  }
+};
+
+Status TQueueFileStorage::init(string directory) {
+  CHECK(!directory.empty());
+  if (directory.back() != TD_DIR_SLASH) {
+    directory += TD_DIR_SLASH;
+  }
+  TRY_STATUS(mkpath(directory));
+  directory_ = std::move(directory);
+  return Status::OK();
+}
+
+Status TQueueFileStorage::destroy(Slice directory) {
+  return rmrf(directory.str());
+}
+
+string TQueueFileStorage::get_segment_path(QueueId queue_id, int64 segment_id) const {
+  return PSTRING() << directory_ << queue_id << '.' << segment_id << ".tqueue";
+}
+
+Status TQueueFileStorage::replay(TQueue &q) {
+  CHECK(!directory_.empty());
+  CHECK(queues_.empty());
+  bool is_root = true;
+  TRY_STATUS(walk_path(directory_, [&](CSlice path, WalkPath::Type type) {
+    if (type == WalkPath::Type::EnterDir) {
+      if (is_root) {
+        is_root = false;
+        return WalkPath::Action::Continue;
+      }
+      return WalkPath::Action::SkipDir;
+    }
+    if (type != WalkPath::Type::RegularFile) {
+      return WalkPath::Action::Continue;
+    }
+    auto name = PathView(path).file_name();
+    if (!ends_with(name, ".tqueue")) {
+      return WalkPath::Action::Continue;
+    }
+    name.remove_suffix(7);
+    auto dot_pos = name.find('.');
+    if (dot_pos == Slice::npos) {
+      return WalkPath::Action::Continue;
+    }
+    auto r_queue_id = to_integer_safe<QueueId>(name.substr(0, dot_pos));
+    auto r_segment_id = to_integer_safe<int64>(name.substr(dot_pos + 1));
+    if (r_queue_id.is_error() || r_segment_id.is_error() || r_segment_id.ok() <= 0) {
+      LOG(ERROR) << "Skip unexpected file " << path;
+      return WalkPath::Action::Continue;
+    }
+    queues_[r_queue_id.ok()].segments[r_segment_id.ok()];
+    return WalkPath::Action::Continue;
+  }));
+
+  std::map<uint64, std::pair<QueueId, RawEvent>> events;
+  for (auto &queue_it : queues_) {
+    auto queue_id = queue_it.first;
+    auto &queue = queue_it.second;
+    for (auto &segment_it : queue.segments) {
+      auto segment_id = segment_it.first;
+      auto &segment = segment_it.second;
+      auto path = get_segment_path(queue_id, segment_id);
+      TRY_RESULT(fd, FileFd::open(path, FileFd::Read | FileFd::Write));
+      TRY_RESULT(file_size, fd.get_size());
+      if (file_size == 0) {
+        continue;
+      }
+      TRY_RESULT(mapping, MemoryMapping::create_from_file(fd));
+      auto data = mapping.as_slice();
+      while (segment.size < file_size) {
+        TQueueFileRecord record;
+        auto record_size = record.parse(data.substr(static_cast<size_t>(segment.size)));
+        if (record_size == 0) {
+          break;
+        }
+        auto offset = segment.size;
+        segment.size += static_cast<int64>(record_size);
+        segment.record_count++;
+        next_log_event_id_ = max(next_log_event_id_, record.log_event_id + 1);
+
+        auto location_it = event_locations_.find(record.log_event_id);
+        if (location_it != event_locations_.end()) {
+          queue.segments[location_it->second.segment_id].live_count--;
+        }
+        if (record.type == TQueueFileRecord::POP) {
+          if (location_it != event_locations_.end()) {
+            event_locations_.erase(location_it);
+            events.erase(record.log_event_id);
+          }
+          continue;
+        }
+
+        event_locations_[record.log_event_id] = EventLocation{queue_id, segment_id, offset};
+        segment.live_count++;
+        auto r_event_id = EventId::from_int32(record.event_id);
+        if (r_event_id.is_error()) {
+          return Status::Error(PSLICE() << "Invalid event identifier in " << path);
+        }
+        RawEvent raw_event;
+        raw_event.log_event_id = record.log_event_id;
+        raw_event.event_id = r_event_id.move_as_ok();
+        raw_event.expires_at = record.expires_at;
+        raw_event.data = BufferSlice(record.data);
+        raw_event.extra = record.extra;
+        events[record.log_event_id] = std::make_pair(queue_id, std::move(raw_event));
+      }
+      if (segment.size != file_size) {
+        LOG(WARNING) << "Truncate " << path << " from size " << file_size << " to size " << segment.size;
+        TRY_STATUS(fd.seek(segment.size));
+        TRY_STATUS(fd.truncate_to_current_position(segment.size));
+      }
+    }
+  }
+
+  // segments are appended only by the last of them
+  for (auto &queue_it : queues_) {
+    auto &queue = queue_it.second;
+    if (!queue.segments.empty()) {
+      auto path = get_segment_path(queue_it.first, queue.segments.rbegin()->first);
+      TRY_RESULT_ASSIGN(queue.active_fd, FileFd::open(path, FileFd::Write | FileFd::Append));
+    }
+  }
+
+  vector<uint64> failed_log_event_ids;
+  for (auto &it : events) {
+    if (!q.do_push(it.second.first, std::move(it.second.second))) {
+      LOG(ERROR) << "Failed to add event " << it.first << " to " << it.second.first;
+      failed_log_event_ids.push_back(it.first);
+    }
+  }
+  for (auto log_event_id : failed_log_event_ids) {
+    pop(log_event_id);
+  }
+  for (auto &queue_it : queues_) {
+    delete_unused_segments(queue_it.first, queue_it.second);
+  }
+  return Status::OK();
+}
+
+int64 TQueueFileStorage::write_record(QueueId queue_id, Queue &queue, Slice record) {
+  if (queue.segments.empty() || queue.segments.rbegin()->second.size >= MAX_SEGMENT_SIZE) {
+    auto segment_id = queue.segments.empty() ? 1 : queue.segments.rbegin()->first + 1;
+    queue.active_fd.close();
+    auto r_fd = FileFd::open(get_segment_path(queue_id, segment_id), FileFd::Write | FileFd::Create |
+                                                                          FileFd::Truncate | FileFd::Append);
+    LOG_IF(FATAL, r_fd.is_error()) << "Failed to create TQueue segment: " << r_fd.error();
+    queue.active_fd = r_fd.move_as_ok();
+    queue.segments[segment_id];
+  }
+
+  auto &segment = queue.segments.rbegin()->second;
+  auto offset = segment.size;
+  while (!record.empty()) {
+    auto r_written = queue.active_fd.write(record);
+    LOG_IF(FATAL, r_written.is_error()) << "Failed to write to TQueue segment: " << r_written.error();
+    record.remove_prefix(r_written.ok());
+    segment.size += static_cast<int64>(r_written.ok());
+  }
+  segment.record_count++;
+  return offset;
+}
+
+void TQueueFileStorage::move_event(uint64 log_event_id, QueueId queue_id, int64 segment_id, int64 offset) {
+  auto &queue = queues_[queue_id];
+  auto &location = event_locations_[log_event_id];
+  if (location.segment_id != 0) {
+    CHECK(location.queue_id == queue_id);
+    queue.segments[location.segment_id].live_count--;
+  }
+  location = EventLocation{queue_id, segment_id, offset};
+  queue.segments[segment_id].live_count++;
+}
+
+uint64 TQueueFileStorage::push(QueueId queue_id, const RawEvent &event) {
+  TQueueFileRecord record;
+  record.type = TQueueFileRecord::PUSH;
+  record.log_event_id = event.log_event_id == 0 ? next_log_event_id_++ : event.log_event_id;
+  record.event_id = event.event_id.value();
+  record.expires_at = event.expires_at;
+  record.extra = event.extra;
+  record.data = event.data;
+
+  auto &queue = queues_[queue_id];
+  auto old_segment_count = queue.segments.size();
+  auto offset = write_record(queue_id, queue, record.serialize());
+  move_event(record.log_event_id, queue_id, queue.segments.rbegin()->first, offset);
+  delete_unused_segments(queue_id, queue);
+  if (queue.segments.size() > old_segment_count) {
+    compact_oldest_segment(queue_id, queue);
+  }
+  return record.log_event_id;
+}
+
+void TQueueFileStorage::pop(uint64 log_event_id) {
+  auto it = event_locations_.find(log_event_id);
+  if (it == event_locations_.end()) {
+    return;
+  }
+  auto queue_id = it->second.queue_id;
+  auto &queue = queues_[queue_id];
+  queue.segments[it->second.segment_id].live_count--;
+  event_locations_.erase(it);
+
+  TQueueFileRecord record;
+  record.type = TQueueFileRecord::POP;
+  record.log_event_id = log_event_id;
+  write_record(queue_id, queue, record.serialize());
+  delete_unused_segments(queue_id, queue);
+}
+
+void TQueueFileStorage::delete_unused_segments(QueueId queue_id, Queue &queue) {
+  // a segment can contain pops of events from previous segments, so segments are deleted from the oldest one
+  while (!queue.segments.empty() && queue.segments.begin()->second.live_count == 0) {
+    auto segment_id = queue.segments.begin()->first;
+    if (queue.segments.size() == 1) {
+      queue.active_fd.close();
+    }
+    queue.segments.erase(queue.segments.begin());
+    unlink(get_segment_path(queue_id, segment_id)).ignore();
+  }
+}
+
+void TQueueFileStorage::compact_oldest_segment(QueueId queue_id, Queue &queue) {
+  // if a few old events are still alive, they are copied to the active segment to allow deletion of the oldest one
+  if (queue.segments.size() <= 2) {
+    return;
+  }
+  auto segment_id = queue.segments.begin()->first;
+  auto &segment = queue.segments.begin()->second;
+  if (segment.live_count * 4 > segment.record_count) {
+    return;
+  }
+
+  auto r_fd = FileFd::open(get_segment_path(queue_id, segment_id), FileFd::Read);
+  LOG_IF(FATAL, r_fd.is_error()) << "Failed to open TQueue segment: " << r_fd.error();
+  auto r_mapping = MemoryMapping::create_from_file(r_fd.ok());
+  LOG_IF(FATAL, r_mapping.is_error()) << "Failed to map TQueue segment: " << r_mapping.error();
+  auto data = r_mapping.ok().as_slice();
+  int64 offset = 0;
+  while (offset < segment.size) {
+    TQueueFileRecord record;
+    auto record_size = record.parse(data.substr(static_cast<size_t>(offset)));
+    CHECK(record_size != 0);
+    auto location_it = event_locations_.find(record.log_event_id);
+    if (record.type == TQueueFileRecord::PUSH && location_it != event_locations_.end() &&
+        location_it->second.segment_id == segment_id && location_it->second.offset == offset) {
+      auto new_offset = write_record(queue_id, queue, data.substr(static_cast<size_t>(offset), record_size));
+      move_event(record.log_event_id, queue_id, queue.segments.rbegin()->first, new_offset);
+    }
+    offset += static_cast<int64>(record_size);
+  }
+  CHECK(queue.segments.begin()->second.live_count == 0);
+  delete_unused_segments(queue_id, queue);
+}
+
+void TQueueFileStorage::close(Promise<> promise) {
+  for (auto &it : queues_) {
+    it.second.active_fd.close();
+  }
+  queues_.clear();
+  event_locations_.clear();
+  promise.set_value({});
+}
+
 void TQueue::StorageCallback::pop_batch(std::vector<uint64> log_event_ids) {
   for (auto id : log_event_ids) {
     pop(id);
@@ -6,7 +6,9 @@
 //
 #pragma once
 
+#include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/port/FileFd.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Span.h"
@@ -58,15 +60,47 @@ class TQueue {
     int64 extra{0};
   };
 
+  using QueueId = int64;
+
+  // an event, which shares data with the queue and remains valid after the queue is changed
+  struct SharedEvent {
+    EventId id;
+    int32 expires_at{0};
+    BufferSlice data;
+    int64 extra{0};
+  };
+
   struct RawEvent {
     uint64 log_event_id{0};
     EventId event_id;
     int32 expires_at{0};
-    string data;
+    BufferSlice data;
     int64 extra{0};
+
+    RawEvent copy() const {
+      RawEvent result;
+      result.log_event_id = log_event_id;
+      result.event_id = event_id;
+      result.expires_at = expires_at;
+      result.data = data.copy();
+      result.extra = extra;
+      return result;
+    }
   };
 
-  using QueueId = int64;
+  struct GetQuery {
+    QueueId queue_id{0};
+    EventId from_id;
+    bool forget_previous{false};
+    size_t limit{0};
+  };
+
+  struct GetQueryResult {
+    Status status;
+    size_t queue_size{0};
+    size_t events_offset{0};
+    size_t event_count{0};
+  };
 
   class StorageCallback {
    public:
@@ -113,6 +147,13 @@ class TQueue {
   virtual Result<size_t> get(QueueId queue_id, EventId from_id, bool forget_previous, int32 unix_time_now,
                              MutableSpan<Event> &result_events) = 0;
 
+  virtual Result<size_t> get(QueueId queue_id, EventId from_id, bool forget_previous, int32 unix_time_now,
+                             MutableSpan<SharedEvent> &result_events) = 0;
+
+  // appends events for all queries to result_events and returns results of the queries in the same order
+  virtual vector<GetQueryResult> get_batch(Span<GetQuery> queries, int32 unix_time_now,
+                                           vector<SharedEvent> &result_events) = 0;
+
   virtual size_t get_size(QueueId queue_id) const = 0;
 
   // returns number of deleted events and whether garbage collection was completed
@@ -154,4 +195,50 @@ class TQueueMemoryStorage final : public TQueue::StorageCallback {
   std::map<uint64, std::pair<QueueId, RawEvent>> events_;
 };
 
+// stores events of every queue in its own append-only segment files in a dedicated directory
+// a segment file is deleted as soon as all its events are popped, so expired and forgotten events
+// are removed without rewriting of the remaining ones
+class TQueueFileStorage final : public TQueue::StorageCallback {
+ public:
+  Status init(string directory) TD_WARN_UNUSED_RESULT;
+  Status replay(TQueue &q) TD_WARN_UNUSED_RESULT;
+  static Status destroy(Slice directory) TD_WARN_UNUSED_RESULT;
+
+  uint64 push(QueueId queue_id, const RawEvent &event) final;
+  void pop(uint64 log_event_id) final;
+  void close(Promise<> promise) final;
+
+ private:
+  static constexpr int64 MAX_SEGMENT_SIZE = 1 << 20;
+
+  struct Segment {
+    int64 size{0};
+    size_t record_count{0};
+    size_t live_count{0};
+  };
+
+  struct Queue {
+    std::map<int64, Segment> segments;
+    FileFd active_fd;
+  };
+
+  struct EventLocation {
+    QueueId queue_id{0};
+    int64 segment_id{0};
+    int64 offset{0};
+  };
+
+  string directory_;
+  uint64 next_log_event_id_{1};
+  std::map<QueueId, Queue> queues_;
+  std::map<uint64, EventLocation> event_locations_;
+
+  string get_segment_path(QueueId queue_id, int64 segment_id) const;
+
+  int64 write_record(QueueId queue_id, Queue &queue, Slice record);
+  void move_event(uint64 log_event_id, QueueId queue_id, int64 segment_id, int64 offset);
+  void delete_unused_segments(QueueId queue_id, Queue &queue);
+  void compact_oldest_segment(QueueId queue_id, Queue &queue);
+};
+
 }  // namespace td
@@ -84,7 +84,7 @@ class TsSeqKeyValue {
   }
 
  private:
-  mutable RwMutex rw_mutex_;
+  mutable RwMutex rw_mutex_{"TsSeqKeyValue"};
   SeqKeyValue kv_;
 };
 
@@ -0,0 +1,61 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/WriteBatcher.h"
+
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+namespace td {
+
+StringBuilder &operator<<(StringBuilder &string_builder, const WriteBatcherStats &stats) {
+  return string_builder << "WriteBatcherStats[" << tag("max_batch_size", stats.max_batch_size)
+                        << tag("flush_delay", stats.flush_delay) << tag("last_batch_size", stats.last_batch_size)
+                        << tag("last_commit_duration", stats.last_commit_duration)
+                        << tag("average_commit_duration", stats.average_commit_duration)
+                        << tag("commit_count", stats.commit_count) << tag("write_count", stats.write_count) << ']';
+}
+
+void WriteBatcher::on_commit(size_t batch_size, double commit_duration) {
+  CHECK(batch_size > 0);
+  last_batch_size_ = batch_size;
+  last_commit_duration_ = commit_duration;
+  if (commit_count_ == 0) {
+    average_commit_duration_ = commit_duration;
+  } else {
+    average_commit_duration_ =
+        average_commit_duration_ * COMMIT_DURATION_DECAY + commit_duration * (1 - COMMIT_DURATION_DECAY);
+  }
+  commit_count_++;
+  write_count_ += batch_size;
+
+  if (commit_duration > MAX_COMMIT_DURATION) {
+    max_batch_size_ = max(max_batch_size_ / 2, MIN_BATCH_SIZE);
+  } else if (batch_size >= max_batch_size_) {
+    // there is a backlog of writes
+    max_batch_size_ = min(max_batch_size_ * 2, MAX_BATCH_SIZE);
+  } else if (batch_size * 4 < max_batch_size_) {
+    max_batch_size_ = max(max_batch_size_ * 3 / 4, MIN_BATCH_SIZE);
+  }
+
+  flush_delay_ = clamp(average_commit_duration_ * FLUSH_DELAY_COMMIT_DURATION_RATIO, MIN_FLUSH_DELAY, MAX_FLUSH_DELAY);
+  LOG(DEBUG) << "Commit " << batch_size << " writes in " << commit_duration << ", new " << get_stats();
+}
+
+WriteBatcherStats WriteBatcher::get_stats() const {
+  WriteBatcherStats stats;
+  stats.max_batch_size = max_batch_size_;
+  stats.flush_delay = flush_delay_;
+  stats.last_batch_size = last_batch_size_;
+  stats.last_commit_duration = last_commit_duration_;
+  stats.average_commit_duration = average_commit_duration_;
+  stats.commit_count = commit_count_;
+  stats.write_count = write_count_;
+  return stats;
+}
+
+}  // namespace td
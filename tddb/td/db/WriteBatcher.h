@@ -0,0 +1,63 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/StringBuilder.h"
+
+namespace td {
+
+struct WriteBatcherStats {
+  size_t max_batch_size = 0;
+  double flush_delay = 0.0;
+  size_t last_batch_size = 0;
+  double last_commit_duration = 0.0;
+  double average_commit_duration = 0.0;
+  uint64 commit_count = 0;
+  uint64 write_count = 0;
+};
+
+StringBuilder &operator<<(StringBuilder &string_builder, const WriteBatcherStats &stats);
+
+// decides when pending database writes must be committed in one transaction
+// the maximum batch size grows while writes arrive faster than they are committed and shrinks back when they don't,
+// the delay before a commit is proportional to the average commit duration
+class WriteBatcher {
+ public:
+  // returns true if pending_count pending writes must be committed immediately
+  bool need_flush(size_t pending_count) const {
+    return pending_count >= max_batch_size_;
+  }
+
+  // returns time at which writes must be committed if the first of them was added at first_write_time
+  double get_flush_time(double first_write_time) const {
+    return first_write_time + flush_delay_;
+  }
+
+  void on_commit(size_t batch_size, double commit_duration);
+
+  WriteBatcherStats get_stats() const;
+
+ private:
+  static constexpr size_t MIN_BATCH_SIZE = 50;
+  static constexpr size_t MAX_BATCH_SIZE = 5000;
+  static constexpr double MIN_FLUSH_DELAY = 0.001;
+  static constexpr double MAX_FLUSH_DELAY = 0.01;
+  static constexpr double FLUSH_DELAY_COMMIT_DURATION_RATIO = 4.0;
+  static constexpr double MAX_COMMIT_DURATION = 0.1;  // a long transaction delays all reads
+  static constexpr double COMMIT_DURATION_DECAY = 0.9;
+
+  size_t max_batch_size_ = MIN_BATCH_SIZE;
+  double flush_delay_ = MAX_FLUSH_DELAY;
+  size_t last_batch_size_ = 0;
+  double last_commit_duration_ = 0.0;
+  double average_commit_duration_ = 0.0;
+  uint64 commit_count_ = 0;
+  uint64 write_count_ = 0;
+};
+
+}  // namespace td
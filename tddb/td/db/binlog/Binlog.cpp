@@ -11,13 +11,16 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/format.h"
+#include "td/utils/Metrics.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/Clocks.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/MemoryMapping.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/PollFlags.h"
 #include "td/utils/port/sleep.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
@@ -26,6 +29,8 @@
 #include "td/utils/tl_helpers.h"
 #include "td/utils/tl_parsers.h"
 
+#include <limits>
+
 namespace td {
 namespace detail {
 struct AesCtrEncryptionEvent {
@@ -165,10 +170,89 @@ static int64 file_size(CSlice path) {
   }
   return r_stat.ok().size_;
 }
+
+// returns the state of the AES-CTR stream after offset bytes
+static AesCtrState create_aes_ctr_state(Slice key, const UInt128 &iv, int64 offset) {
+  CHECK(offset >= 0);
+  UInt128 counter = iv;
+  auto block_count = static_cast<uint64>(offset) / 16;
+  for (int i = 15; i >= 0 && block_count != 0; i--) {
+    auto sum = static_cast<uint64>(counter.raw[i]) + (block_count & 255);
+    counter.raw[i] = static_cast<uint8>(sum & 255);
+    block_count = (block_count >> 8) + (sum >> 8);
+  }
+
+  AesCtrState state;
+  state.init(key, as_slice(counter));
+  auto skipped_size = static_cast<size_t>(offset % 16);
+  if (skipped_size != 0) {
+    char buf[16];
+    state.encrypt(Slice(buf, skipped_size), MutableSlice(buf, skipped_size));
+  }
+  return state;
+}
+
+static void aes_ctr_decrypt_parallel(Slice key, const UInt128 &iv, Slice from, MutableSlice to) {
+  CHECK(from.size() <= to.size());
+  constexpr size_t MIN_PART_SIZE = 1 << 22;
+  size_t thread_count = 1;
+#if !TD_THREAD_UNSUPPORTED
+  thread_count = clamp(static_cast<size_t>(thread::hardware_concurrency()), static_cast<size_t>(1),
+                       static_cast<size_t>(16));
+  thread_count = min(thread_count, from.size() / MIN_PART_SIZE + 1);
+#endif
+  auto part_size = ((from.size() + thread_count - 1) / thread_count + 15) & ~static_cast<size_t>(15);
+
+  auto decrypt_part = [&](size_t part) {
+    auto begin = part * part_size;
+    if (begin >= from.size()) {
+      return;
+    }
+    auto size = min(part_size, from.size() - begin);
+    auto state = create_aes_ctr_state(key, iv, static_cast<int64>(begin));
+    state.decrypt(from.substr(begin, size), to.substr(begin, size));
+  };
+
+#if !TD_THREAD_UNSUPPORTED
+  vector<thread> threads;
+  for (size_t part = 1; part < thread_count; part++) {
+    threads.emplace_back(decrypt_part, part);
+  }
+#endif
+  decrypt_part(0);
+#if !TD_THREAD_UNSUPPORTED
+  for (auto &thread : threads) {
+    thread.join();
+  }
+#endif
+}
 }  // namespace detail
 
 int32 VERBOSITY_NAME(binlog) = VERBOSITY_NAME(DEBUG) + 8;
 
+static MetricCounter binlog_event_count_metric("td_binlog_events_total", "Number of events added to binlogs");
+static MetricCounter binlog_event_bytes_metric("td_binlog_event_bytes_total",
+                                               "Total size of events added to binlogs in bytes");
+static MetricCounter binlog_sync_count_metric("td_binlog_syncs_total", "Number of binlog file synchronizations");
+static MetricHistogram binlog_sync_duration_metric("td_binlog_sync_duration_seconds",
+                                                   "Duration of binlog file synchronization",
+                                                   {0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0});
+
+struct Binlog::Compaction {
+  FileFd fd;
+  string path;
+  bool is_encrypted = false;
+  AesCtrState aes_ctr_state;
+  string buffer;
+  uint64 next_event_id = 0;  // all live events with smaller identifiers have already been written
+  int64 size = 0;
+  uint64 events = 0;
+
+  double start_time = 0;
+  int64 start_size = 0;
+  uint64 start_events = 0;
+};
+
 Binlog::Binlog() = default;
 
 Binlog::~Binlog() {
@@ -226,10 +310,32 @@ Status Binlog::init(string path, const Callback &callback, DbKey db_key, DbKey o
   return Status::OK();
 }
 
+Status Binlog::replay_read_only(string path, const Callback &callback, DbKey db_key) {
+  Binlog binlog;
+  binlog.is_read_only_ = true;
+  binlog.db_key_ = std::move(db_key);
+  binlog.processor_ = make_unique<detail::BinlogEventsProcessor>();
+
+  TRY_RESULT(fd, FileFd::open(path, FileFd::Flags::Read));
+  binlog.fd_ = BufferedFdBase<FileFd>(std::move(fd));
+  binlog.path_ = std::move(path);
+
+  auto status = binlog.load_binlog(callback, Callback());
+  binlog.fd_.close();
+  binlog.path_.clear();
+  TRY_STATUS(std::move(status));
+  if (binlog.info_.wrong_password) {
+    return Status::Error(static_cast<int>(Error::WrongPassword), "Wrong password");
+  }
+  return Status::OK();
+}
+
 void Binlog::add_event(BinlogEvent &&event) {
   if (event.size_ % 4 != 0) {
     LOG(FATAL) << "Trying to add event with bad size " << event.public_to_string();
   }
+  binlog_event_count_metric.add();
+  binlog_event_bytes_metric.add(event.size_);
 
   if (!events_buffer_) {
     do_add_event(std::move(event));
@@ -246,10 +352,17 @@ void Binlog::add_event(BinlogEvent &&event) {
     auto need_reindex = [&](int64 min_size, int rate) {
       return fd_size > min_size && fd_size / rate > processor_->total_raw_events_size();
     };
-    if (need_reindex(50000, 5) || need_reindex(100000, 4) || need_reindex(300000, 3) || need_reindex(500000, 2)) {
+    if (compaction_ != nullptr) {
+      compaction_step(COMPACTION_STEP_SIZE);
+    } else if (need_reindex(50000, 5) || need_reindex(100000, 4) || need_reindex(300000, 3) ||
+               need_reindex(500000, 2)) {
       LOG(INFO) << tag("fd_size", format::as_size(fd_size))
                 << tag("total events size", format::as_size(processor_->total_raw_events_size()));
-      do_reindex();
+      if (is_incremental_compaction_enabled_) {
+        start_compaction();
+      } else {
+        do_reindex();
+      }
     }
   }
 }
@@ -285,6 +398,7 @@ Status Binlog::close(bool need_sync) {
   if (fd_.empty()) {
     return Status::OK();
   }
+  cancel_compaction();
   if (need_sync) {
     sync();
   } else {
@@ -305,6 +419,7 @@ void Binlog::close(Promise<> promise) {
 }
 
 void Binlog::change_key(DbKey new_db_key) {
+  cancel_compaction();
   db_key_ = std::move(new_db_key);
   aes_ctr_key_salt_ = string();
   do_reindex();
@@ -335,6 +450,16 @@ void Binlog::do_event(BinlogEvent &&event) {
     VLOG(binlog) << "Write binlog event: " << format::cond(state_ == State::Reindex, "[reindex] ")
                  << event.public_to_string();
     buffer_writer_.append(as_slice(event.raw_event_));
+
+    // events for already written identifiers must be mirrored to the new file, all other events will be written
+    // to it by compaction_step
+    if (compaction_ != nullptr && state_ == State::Run && event.id_ < compaction_->next_event_id) {
+      auto status = write_compacted_event(event.raw_event_);
+      if (status.is_error()) {
+        LOG(ERROR) << "Failed to write compacted binlog: " << status;
+        cancel_compaction();
+      }
+    }
   }
 
   if (event.type_ < 0) {
@@ -383,6 +508,10 @@ void Binlog::do_event(BinlogEvent &&event) {
   if (state_ != State::Reindex) {
     auto status = processor_->add_event(std::move(event));
     if (status.is_error()) {
+      if (is_read_only_) {
+        LOG(ERROR) << "Skip event in binlog \"" << path_ << "\" at offset " << fd_size_ << " due to error: " << status;
+        return;
+      }
       auto old_size = detail::file_size(path_);
       auto data = debug_get_binlog_data(fd_size_, old_size);
       if (state_ == State::Load) {
@@ -407,8 +536,11 @@ void Binlog::do_event(BinlogEvent &&event) {
 void Binlog::sync() {
   flush();
   if (need_sync_) {
+    auto start_time = Time::now();
     auto status = fd_.sync();
     LOG_IF(FATAL, status.is_error()) << "Failed to sync binlog: " << status;
+    binlog_sync_count_metric.add();
+    binlog_sync_duration_metric.observe(Time::now() - start_time);
     need_sync_ = false;
   }
 }
@@ -499,47 +631,15 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
 
   update_read_encryption();
 
-  fd_.get_poll_info().add_flags(PollFlags::Read());
   info_.wrong_password = false;
-  while (true) {
-    BinlogEvent event;
-    auto r_need_size = reader.read_next(&event);
-    if (r_need_size.is_error()) {
-      if (r_need_size.error().code() == -2) {
-        auto old_size = detail::file_size(path_);
-        auto offset = reader.offset();
-        auto data = debug_get_binlog_data(offset, old_size);
-        fd_.seek(offset).ensure();
-        fd_.truncate_to_current_position(offset).ensure();
-        if (data.empty()) {
-          break;
-        }
-        LOG(FATAL) << "Truncate binlog \"" << path_ << "\" from size " << old_size << " to size " << offset
-                   << " due to error: " << r_need_size.error() << " after reading " << data;
-      }
-      LOG(ERROR) << r_need_size.error();
-      break;
-    }
-    auto need_size = r_need_size.move_as_ok();
-    // LOG(ERROR) << "Need size = " << need_size;
-    if (need_size == 0) {
-      if (debug_callback) {
-        debug_callback(event);
-      }
-      do_add_event(std::move(event));
-      if (info_.wrong_password) {
-        return Status::OK();
-      }
-    } else {
-      TRY_STATUS(fd_.flush_read(max(need_size, static_cast<size_t>(4096))));
-      buffer_reader_.sync_with_writer();
-      if (byte_flow_flag_) {
-        byte_flow_source_.wakeup();
-      }
-      if (reader.input()->size() < need_size) {
-        break;
-      }
-    }
+  auto r_mapping = MemoryMapping::create_from_file(fd_);
+  if (r_mapping.is_ok()) {
+    load_mapped_events(r_mapping.ok().as_slice(), debug_callback);
+  } else {
+    TRY_STATUS(load_events(debug_callback));
+  }
+  if (info_.wrong_password) {
+    return Status::OK();
   }
 
   auto offset = processor_->offset();
@@ -552,6 +652,12 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
   });
 
   TRY_RESULT(fd_size, fd_.get_size());
+  if (is_read_only_) {
+    // the tail of the binlog can be being written right now, so it must not be truncated
+    binlog_reader_ptr_ = nullptr;
+    state_ = State::Run;
+    return Status::OK();
+  }
   if (offset != fd_size) {
     LOG(ERROR) << "Truncate " << tag("path", path_) << tag("old_size", fd_size) << tag("new_size", offset);
     fd_.seek(offset).ensure();
@@ -574,11 +680,128 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
   return Status::OK();
 }
 
+Status Binlog::load_events(const Callback &debug_callback) {
+  fd_.get_poll_info().add_flags(PollFlags::Read());
+  while (true) {
+    BinlogEvent event;
+    auto r_need_size = binlog_reader_ptr_->read_next(&event);
+    if (r_need_size.is_error()) {
+      on_load_error(r_need_size.error(), binlog_reader_ptr_->offset());
+      break;
+    }
+    auto need_size = r_need_size.move_as_ok();
+    // LOG(ERROR) << "Need size = " << need_size;
+    if (need_size == 0) {
+      if (debug_callback) {
+        debug_callback(event);
+      }
+      do_add_event(std::move(event));
+      if (info_.wrong_password) {
+        break;
+      }
+    } else {
+      TRY_STATUS(fd_.flush_read(max(need_size, static_cast<size_t>(4096))));
+      buffer_reader_.sync_with_writer();
+      if (byte_flow_flag_) {
+        byte_flow_source_.wakeup();
+      }
+      if (binlog_reader_ptr_->input()->size() < need_size) {
+        break;
+      }
+    }
+  }
+
+  return Status::OK();
+}
+
+void Binlog::load_mapped_events(Slice data, const Callback &debug_callback) {
+  // the whole file is available, so everything after an encryption event can be decrypted at once
+  string decrypted_data;
+  Slice input = data;
+  int64 input_offset = 0;
+  int64 encryption_offset = -1;
+  size_t pos = 0;
+  while (input.size() - pos >= 4) {
+    auto offset = input_offset + static_cast<int64>(pos);
+    auto size = static_cast<size_t>(TlParser(input.substr(pos, 4)).fetch_int());
+    if (size > BinlogEvent::MAX_SIZE) {
+      on_load_error(Status::Error(PSLICE() << "Too big event " << tag("size", size)), offset);
+      break;
+    }
+    if (size < BinlogEvent::MIN_SIZE) {
+      on_load_error(Status::Error(PSLICE() << "Too small event " << tag("size", size)), offset);
+      break;
+    }
+    if (size % 4 != 0) {
+      on_load_error(Status::Error(-2, PSLICE() << "Event of size " << size << " at offset " << offset << " out of "
+                                               << data.size() << ' ' << tag("is_encrypted", encryption_offset >= 0)),
+                    offset);
+      break;
+    }
+    if (input.size() - pos < size) {
+      break;
+    }
+
+    BinlogEvent event;
+    event.debug_info_ = BinlogDebugInfo{__FILE__, __LINE__};
+    event.init(input.substr(pos, size).str());
+    auto status = event.validate();
+    if (status.is_error()) {
+      on_load_error(std::move(status), offset);
+      break;
+    }
+    pos += size;
+    event.offset_ = offset + static_cast<int64>(size);
+    bool is_encryption_event = event.type_ == BinlogEvent::ServiceTypes::AesCtrEncryption;
+
+    if (debug_callback) {
+      debug_callback(event);
+    }
+    do_add_event(std::move(event));
+    if (info_.wrong_password) {
+      return;
+    }
+
+    if (is_encryption_event && encryption_type_ == EncryptionType::AesCtr) {
+      encryption_offset = input_offset + static_cast<int64>(pos);
+      auto encrypted_data = data.substr(static_cast<size_t>(encryption_offset));
+      decrypted_data.resize(encrypted_data.size());
+      detail::aes_ctr_decrypt_parallel(as_slice(aes_ctr_key_), aes_ctr_iv_, encrypted_data, decrypted_data);
+      input = decrypted_data;
+      input_offset = encryption_offset;
+      pos = 0;
+    }
+  }
+
+  // the file wasn't read, so new events must be explicitly written after the last loaded event
+  fd_.seek(processor_->offset()).ensure();
+
+  if (encryption_offset >= 0) {
+    // the state must be ready to encrypt new events, which will be written after the last loaded event
+    aes_xcode_byte_flow_.init(
+        detail::create_aes_ctr_state(as_slice(aes_ctr_key_), aes_ctr_iv_, processor_->offset() - encryption_offset));
+  }
+}
+
+void Binlog::on_load_error(const Status &error, int64 offset) {
+  if (error.code() == -2 && !is_read_only_) {
+    auto old_size = detail::file_size(path_);
+    auto data = debug_get_binlog_data(offset, old_size);
+    fd_.seek(offset).ensure();
+    fd_.truncate_to_current_position(offset).ensure();
+    if (data.empty()) {
+      return;
+    }
+    LOG(FATAL) << "Truncate binlog \"" << path_ << "\" from size " << old_size << " to size " << offset
+               << " due to error: " << error << " after reading " << data;
+  }
+  LOG(ERROR) << error;
+}
+
 void Binlog::update_encryption(Slice key, Slice iv) {
   as_mutable_slice(aes_ctr_key_).copy_from(key);
-  UInt128 aes_ctr_iv;
-  as_mutable_slice(aes_ctr_iv).copy_from(iv);
-  aes_ctr_state_.init(as_slice(aes_ctr_key_), as_slice(aes_ctr_iv));
+  as_mutable_slice(aes_ctr_iv_).copy_from(iv);
+  aes_ctr_state_.init(as_slice(aes_ctr_key_), as_slice(aes_ctr_iv_));
 }
 
 void Binlog::reset_encryption() {
@@ -705,6 +928,180 @@ void Binlog::do_reindex() {
   update_write_encryption();
 }
 
+void Binlog::set_incremental_compaction(bool is_enabled) {
+  is_incremental_compaction_enabled_ = is_enabled;
+  if (!is_enabled) {
+    cancel_compaction();
+  }
+}
+
+void Binlog::start_compaction() {
+  CHECK(state_ == State::Run);
+  CHECK(compaction_ == nullptr);
+  if (encryption_type_ == EncryptionType::AesCtr && aes_ctr_key_salt_.empty()) {
+    return do_reindex();
+  }
+  flush_events_buffer(true);
+
+  string new_path = path_ + ".new";
+  auto r_opened_file = open_binlog(new_path, FileFd::Flags::Write | FileFd::Flags::Create | FileFd::Truncate);
+  if (r_opened_file.is_error()) {
+    LOG(ERROR) << "Can't open new binlog for compaction: " << r_opened_file.error();
+    return;
+  }
+
+  compaction_ = make_unique<Compaction>();
+  compaction_->fd = r_opened_file.move_as_ok();
+  compaction_->path = std::move(new_path);
+  compaction_->start_time = Clocks::monotonic();
+  compaction_->start_size = fd_size_;
+  compaction_->start_events = fd_events_;
+
+  if (encryption_type_ == EncryptionType::AesCtr) {
+    // reuse the current key to avoid its slow generation
+    using EncryptionEvent = detail::AesCtrEncryptionEvent;
+    EncryptionEvent event;
+    event.key_salt_ = aes_ctr_key_salt_;
+    event.iv_.resize(EncryptionEvent::iv_size());
+    Random::secure_bytes(event.iv_);
+    event.key_hash_ = EncryptionEvent::generate_hash(as_slice(aes_ctr_key_).str());
+
+    auto raw_event =
+        BinlogEvent::create_raw(0, BinlogEvent::ServiceTypes::AesCtrEncryption, 0, create_default_storer(event));
+    auto status = write_compacted_event(raw_event.as_slice());
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to write compacted binlog: " << status;
+      return cancel_compaction();
+    }
+    compaction_->aes_ctr_state.init(as_slice(aes_ctr_key_), event.iv_);
+    compaction_->is_encrypted = true;
+  }
+  LOG(INFO) << "Start compaction of " << tag("name", path_) << tag("size", format::as_size(fd_size_))
+            << tag("total events size", format::as_size(processor_->total_raw_events_size()));
+}
+
+Status Binlog::write_compacted_event(Slice raw_event) {
+  CHECK(compaction_ != nullptr);
+  auto &buffer = compaction_->buffer;
+  auto old_size = buffer.size();
+  buffer.append(raw_event.data(), raw_event.size());
+  if (compaction_->is_encrypted) {
+    MutableSlice data(&buffer[old_size], raw_event.size());
+    compaction_->aes_ctr_state.encrypt(data, data);
+  }
+  compaction_->size += static_cast<int64>(raw_event.size());
+  compaction_->events++;
+  if (buffer.size() >= COMPACTION_STEP_SIZE) {
+    return flush_compacted_events();
+  }
+  return Status::OK();
+}
+
+Status Binlog::flush_compacted_events() {
+  CHECK(compaction_ != nullptr);
+  Slice data = compaction_->buffer;
+  while (!data.empty()) {
+    TRY_RESULT(written, compaction_->fd.write(data));
+    data.remove_prefix(written);
+  }
+  compaction_->buffer.clear();
+  return Status::OK();
+}
+
+void Binlog::compaction_step(size_t max_size) {
+  if (compaction_ == nullptr) {
+    return;
+  }
+
+  size_t written_size = 0;
+  bool is_finished = true;
+  Status status;
+  processor_->for_each_from(compaction_->next_event_id, [&](BinlogEvent &event) {
+    if (written_size >= max_size) {
+      compaction_->next_event_id = event.id_;
+      is_finished = false;
+      return false;
+    }
+    status = write_compacted_event(event.raw_event_);
+    if (status.is_error()) {
+      return false;
+    }
+    written_size += event.raw_event_.size();
+    return true;
+  });
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to write compacted binlog: " << status;
+    return cancel_compaction();
+  }
+  if (is_finished) {
+    finish_compaction();
+  }
+}
+
+void Binlog::finish_compaction() {
+  CHECK(compaction_ != nullptr);
+  // all live events are written, so all delayed events must be mirrored
+  compaction_->next_event_id = std::numeric_limits<uint64>::max();
+  flush_events_buffer(true);
+  if (compaction_ == nullptr) {
+    return;
+  }
+
+  auto status = flush_compacted_events();
+  if (status.is_ok()) {
+    status = compaction_->fd.sync_barrier();
+  }
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to write compacted binlog: " << status;
+    return cancel_compaction();
+  }
+
+  // all events are already written to the new file
+  flush();
+
+  auto compaction = std::move(compaction_);
+  status = unlink(path_);
+  LOG_IF(FATAL, status.is_error()) << "Failed to unlink old binlog: " << status;
+  fd_.close();  // now we can close old file and release the system lock
+  status = rename(compaction->path, path_);
+  FileFd::remove_local_lock(compaction->path);  // now we can release local lock for temporary file
+  LOG_IF(FATAL, status.is_error()) << "Failed to rename binlog: " << status;
+
+  fd_ = BufferedFdBase<FileFd>(std::move(compaction->fd));
+  fd_size_ = compaction->size;
+  fd_events_ = compaction->events;
+  need_sync_ = false;
+
+  buffer_writer_ = ChainBufferWriter();
+  buffer_reader_ = buffer_writer_.extract_reader();
+  if (compaction->is_encrypted) {
+    aes_ctr_state_ = std::move(compaction->aes_ctr_state);
+  }
+  update_write_encryption();
+
+  auto duration = Clocks::monotonic() - compaction->start_time;
+  auto reclaimed_size = compaction->start_size - fd_size_;
+  compaction_stats_.compaction_count++;
+  compaction_stats_.last_duration = duration;
+  compaction_stats_.total_duration += duration;
+  compaction_stats_.total_reclaimed_size += reclaimed_size;
+  LOG(INFO) << "Finish compaction of " << tag("name", path_) << tag("time", format::as_time(duration))
+            << tag("before_size", format::as_size(compaction->start_size))
+            << tag("after_size", format::as_size(fd_size_)) << tag("reclaimed", format::as_size(reclaimed_size))
+            << tag("before_events", compaction->start_events) << tag("after_events", fd_events_);
+}
+
+void Binlog::cancel_compaction() {
+  if (compaction_ == nullptr) {
+    return;
+  }
+  auto compaction = std::move(compaction_);
+  compaction->fd.lock(FileFd::LockFlags::Unlock, compaction->path, 1).ignore();
+  compaction->fd.close();
+  unlink(compaction->path).ignore();
+  LOG(INFO) << "Cancel compaction of " << tag("name", path_);
+}
+
 string Binlog::debug_get_binlog_data(int64 begin_offset, int64 end_offset) {
   if (begin_offset > end_offset) {
     return "Begin offset is bigger than end_offset";
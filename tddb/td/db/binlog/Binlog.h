@@ -37,6 +37,13 @@ struct BinlogInfo {
   bool is_opened{false};
 };
 
+struct BinlogCompactionStats {
+  int32 compaction_count{0};
+  double last_duration{0.0};
+  double total_duration{0.0};
+  int64 total_reclaimed_size{0};
+};
+
 namespace detail {
 class BinlogReader;
 class BinlogEventsProcessor;
@@ -57,6 +64,11 @@ class Binlog {
   Status init(string path, const Callback &callback, DbKey db_key = DbKey::empty(), DbKey old_db_key = DbKey::empty(),
               int32 dummy = -1, const Callback &debug_callback = Callback()) TD_WARN_UNUSED_RESULT;
 
+  // replays events of an existing binlog without locking or changing the file, so it can be done while the binlog
+  // is opened by another instance; events, which are being written concurrently, may be not replayed
+  static Status replay_read_only(string path, const Callback &callback,
+                                 DbKey db_key = DbKey::empty()) TD_WARN_UNUSED_RESULT;
+
   uint64 next_event_id() {
     return ++last_event_id_;
   }
@@ -130,6 +142,22 @@ class Binlog {
     return info_;
   }
 
+  // if enabled, the binlog is compacted in small steps instead of being regenerated at once
+  // live events are written to the new file by compaction_step, which is also called automatically from add_event,
+  // and new events are written to both files until the new file replaces the old one
+  void set_incremental_compaction(bool is_enabled);
+
+  bool is_compacting() const {
+    return compaction_ != nullptr;
+  }
+
+  // writes about max_size bytes of live events to the new file; finishes the compaction if all events were written
+  void compaction_step(size_t max_size);
+
+  const BinlogCompactionStats &get_compaction_stats() const {
+    return compaction_stats_;
+  }
+
  private:
   BufferedFdBase<FileFd> fd_;
   ChainBufferWriter buffer_writer_;
@@ -145,6 +173,7 @@ class Binlog {
   // AesCtrEncryption
   string aes_ctr_key_salt_;
   UInt256 aes_ctr_key_;
+  UInt128 aes_ctr_iv_;
   AesCtrState aes_ctr_state_;
 
   bool byte_flow_flag_ = false;
@@ -162,14 +191,30 @@ class Binlog {
   uint64 last_event_id_{0};
   double need_flush_since_ = 0;
   bool need_sync_{false};
+  bool is_read_only_{false};
   enum class State { Empty, Load, Reindex, Run } state_{State::Empty};
 
+  struct Compaction;
+  bool is_incremental_compaction_enabled_{false};
+  unique_ptr<Compaction> compaction_;
+  BinlogCompactionStats compaction_stats_;
+
+  static constexpr size_t COMPACTION_STEP_SIZE = 1 << 16;
+
   static Result<FileFd> open_binlog(const string &path, int32 flags);
   size_t flush_events_buffer(bool force);
   void do_add_event(BinlogEvent &&event);
   void do_event(BinlogEvent &&event);
   Status load_binlog(const Callback &callback, const Callback &debug_callback = Callback()) TD_WARN_UNUSED_RESULT;
+  Status load_events(const Callback &debug_callback) TD_WARN_UNUSED_RESULT;
+  void load_mapped_events(Slice data, const Callback &debug_callback);
+  void on_load_error(const Status &error, int64 offset);
   void do_reindex();
+  void start_compaction();
+  Status write_compacted_event(Slice raw_event) TD_WARN_UNUSED_RESULT;
+  Status flush_compacted_events() TD_WARN_UNUSED_RESULT;
+  void finish_compaction();
+  void cancel_compaction();
 
   void update_encryption(Slice key, Slice iv);
   void reset_encryption();
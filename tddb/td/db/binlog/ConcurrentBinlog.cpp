@@ -19,6 +19,7 @@ namespace detail {
 class BinlogActor final : public Actor {
  public:
   BinlogActor(unique_ptr<Binlog> binlog, uint64 seq_no) : binlog_(std::move(binlog)), processor_(seq_no) {
+    binlog_->set_incremental_compaction(true);
   }
   void close(Promise<> promise) {
     binlog_->close().ensure();
@@ -52,13 +53,23 @@ class BinlogActor final : public Actor {
 
   void add_raw_event(uint64 seq_no, BufferSlice &&raw_event, Promise<> &&promise, BinlogDebugInfo info) {
     processor_.add(seq_no, Event{std::move(raw_event), std::move(promise), info}, [&](uint64 event_id, Event &&event) {
+      if (event.sync_promise) {
+        lazy_sync_size_ += event.raw_event.size();
+      }
       if (!event.raw_event.empty()) {
         do_add_raw_event(std::move(event.raw_event), event.debug_info);
       }
       do_lazy_sync(std::move(event.sync_promise));
     });
     flush_immediate_sync();
-    try_flush();
+    if (max_lazy_sync_size_ != 0 && lazy_sync_size_ >= max_lazy_sync_size_) {
+      do_sync();
+    } else {
+      try_flush();
+    }
+    if (binlog_->is_compacting()) {
+      wakeup_after(COMPACTION_DELAY);
+    }
   }
 
   void force_sync(Promise<> &&promise) {
@@ -81,6 +92,16 @@ class BinlogActor final : public Actor {
     promise.set_value(Unit());
   }
 
+  void set_group_commit(double max_delay, size_t max_size) {
+    is_group_commit_ = true;
+    lazy_sync_delay_ = max_delay;
+    max_lazy_sync_size_ = max_size;
+    if (lazy_sync_flag_) {
+      lazy_sync_at_ = min(lazy_sync_at_, Time::now() + lazy_sync_delay_);
+      wakeup_at(lazy_sync_at_);
+    }
+  }
+
  private:
   unique_ptr<Binlog> binlog_;
 
@@ -92,8 +113,15 @@ class BinlogActor final : public Actor {
   bool lazy_sync_flag_ = false;
   bool flush_flag_ = false;
   double wakeup_at_ = 0;
+  bool is_group_commit_ = false;
+  double lazy_sync_delay_ = 30;
+  double lazy_sync_at_ = 0;
+  size_t max_lazy_sync_size_ = 0;
+  size_t lazy_sync_size_ = 0;
 
   static constexpr double FLUSH_TIMEOUT = 0.001;  // 1ms
+  static constexpr double COMPACTION_DELAY = 0.001;  // 1ms
+  static constexpr size_t COMPACTION_STEP_SIZE = 1 << 20;
 
   void wakeup_after(double after) {
     auto now = Time::now_cached();
@@ -148,25 +176,46 @@ class BinlogActor final : public Actor {
     }
     sync_promises_.emplace_back(std::move(promise));
     if (!lazy_sync_flag_ && !force_sync_flag_) {
-      wakeup_after(30);
+      lazy_sync_at_ = Time::now_cached() + lazy_sync_delay_;
+      wakeup_at(lazy_sync_at_);
       lazy_sync_flag_ = true;
     }
   }
 
-  void timeout_expired() final {
-    bool need_sync = lazy_sync_flag_ || force_sync_flag_;
+  void do_sync() {
     lazy_sync_flag_ = false;
     force_sync_flag_ = false;
+    flush_flag_ = false;
+    lazy_sync_size_ = 0;
+    binlog_->sync();
+    // LOG(ERROR) << "BINLOG SYNC";
+    set_promises(sync_promises_);
+  }
+
+  void timeout_expired() final {
+    // without group commit a lazy sync is done together with any flush
+    bool need_lazy_sync = lazy_sync_flag_ && (!is_group_commit_ || Time::now() > lazy_sync_at_ - 1e-9);
+    bool need_sync = need_lazy_sync || force_sync_flag_;
     bool need_flush = flush_flag_;
     flush_flag_ = false;
     wakeup_at_ = 0;
+    // continue compaction between batches of events
+    if (binlog_->is_compacting()) {
+      binlog_->compaction_step(COMPACTION_STEP_SIZE);
+      if (binlog_->is_compacting()) {
+        wakeup_after(COMPACTION_DELAY);
+      }
+    }
     if (need_sync) {
-      binlog_->sync();
-      // LOG(ERROR) << "BINLOG SYNC";
-      set_promises(sync_promises_);
-    } else if (need_flush) {
-      try_flush();
-      // LOG(ERROR) << "BINLOG FLUSH";
+      do_sync();
+    } else {
+      if (lazy_sync_flag_) {
+        wakeup_at(lazy_sync_at_);
+      }
+      if (need_flush) {
+        try_flush();
+        // LOG(ERROR) << "BINLOG FLUSH";
+      }
     }
   }
 };
@@ -214,6 +263,9 @@ void ConcurrentBinlog::force_flush() {
 void ConcurrentBinlog::change_key(DbKey db_key, Promise<> promise) {
   send_closure(binlog_actor_, &detail::BinlogActor::change_key, std::move(db_key), std::move(promise));
 }
+void ConcurrentBinlog::set_group_commit(double max_delay, size_t max_size) {
+  send_closure(binlog_actor_, &detail::BinlogActor::set_group_commit, max_delay, max_size);
+}
 
 uint64 ConcurrentBinlog::erase_batch(vector<uint64> event_ids) {
   auto shift = narrow_cast<int32>(event_ids.size());
@@ -45,6 +45,12 @@ class ConcurrentBinlog final : public BinlogInterface {
   void force_flush() final;
   void change_key(DbKey db_key, Promise<> promise) final;
 
+  // events added with a promise are written and synced in groups: a group is synced max_delay seconds after
+  // its first event is added or as soon as the total size of its events reaches max_size bytes, if max_size != 0;
+  // promises of the events are completed after the group is synced
+  // by default, max_delay is 30 seconds and max_size is 0
+  void set_group_commit(double max_delay, size_t max_size);
+
   uint64 next_event_id() final {
     return last_event_id_.fetch_add(1, std::memory_order_relaxed);
   }
@@ -18,7 +18,9 @@
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tl_parsers.h"
 
+#include <algorithm>
 #include <map>
+#include <unordered_map>
 
 struct Trie {
   Trie() {
@@ -95,16 +97,111 @@ struct Trie {
 
 enum Magic { ConfigPmcMagic = 0x1f18, BinlogPmcMagic = 0x4327 };
 
+struct EventTypeStatistics {
+  td::int32 type = 0;
+  std::size_t count = 0;
+  std::size_t size = 0;
+  std::size_t live_count = 0;
+  std::size_t live_size = 0;
+  std::size_t rewritten_count = 0;
+  std::size_t erased_count = 0;
+};
+
+class BinlogStatistics {
+ public:
+  void on_event(const td::BinlogEvent &event) {
+    auto size = event.raw_event_.size();
+    total_size_ += size;
+    if ((event.flags_ & td::BinlogEvent::Flags::Rewrite) != 0) {
+      auto it = event_types_.find(event.id_);
+      if (it == event_types_.end()) {
+        return;
+      }
+      auto &statistics = get_statistics(it->second);
+      if (event.type_ == td::BinlogEvent::ServiceTypes::Empty) {
+        statistics.erased_count++;
+        statistics.size += size;
+        event_types_.erase(it);
+      } else {
+        statistics.rewritten_count++;
+        statistics.size += size;
+      }
+      return;
+    }
+
+    auto &statistics = get_statistics(event.type_);
+    statistics.count++;
+    statistics.size += size;
+    if (event.type_ >= 0) {
+      event_types_[event.id_] = event.type_;
+    }
+  }
+
+  void on_live_event(const td::BinlogEvent &event) {
+    auto &statistics = get_statistics(event.type_);
+    statistics.live_count++;
+    statistics.live_size += event.raw_event_.size();
+    live_size_ += event.raw_event_.size();
+  }
+
+  void dump() const {
+    td::vector<EventTypeStatistics> statistics;
+    for (auto &it : statistics_) {
+      statistics.push_back(it.second);
+    }
+    std::sort(statistics.begin(), statistics.end(),
+              [](const EventTypeStatistics &lhs, const EventTypeStatistics &rhs) { return lhs.size > rhs.size; });
+
+    LOG(PLAIN) << td::tag("total_size", td::format::as_size(total_size_))
+               << td::tag("live_size", td::format::as_size(live_size_)) << td::tag("compaction_ratio", get_ratio());
+    for (auto &it : statistics) {
+      LOG(PLAIN) << td::tag("type", it.type) << td::tag("size", td::format::as_size(it.size))
+                 << td::tag("share", get_percent(it.size, total_size_)) << td::tag("events", it.count)
+                 << td::tag("live_events", it.live_count) << td::tag("live_size", td::format::as_size(it.live_size))
+                 << td::tag("rewritten", it.rewritten_count) << td::tag("erased", it.erased_count);
+    }
+  }
+
+ private:
+  std::map<td::int32, EventTypeStatistics> statistics_;
+  std::unordered_map<td::uint64, td::int32> event_types_;
+  std::size_t total_size_ = 0;
+  std::size_t live_size_ = 0;
+
+  EventTypeStatistics &get_statistics(td::int32 type) {
+    auto &statistics = statistics_[type];
+    statistics.type = type;
+    return statistics;
+  }
+
+  static td::string get_percent(std::size_t part, std::size_t total) {
+    if (total == 0) {
+      return "0%";
+    }
+    return PSTRING() << td::StringBuilder::FixedDouble(static_cast<double>(part) * 100.0 / static_cast<double>(total), 2)
+                     << '%';
+  }
+
+  td::string get_ratio() const {
+    if (live_size_ == 0) {
+      return "inf";
+    }
+    return PSTRING() << td::StringBuilder::FixedDouble(static_cast<double>(total_size_) / static_cast<double>(live_size_),
+                                                       2);
+  }
+};
+
 int main(int argc, char *argv[]) {
-  if (argc < 2) {
-    LOG(PLAIN) << "Usage: binlog_dump <binlog_file_name>";
+  bool only_statistics = argc >= 2 && td::Slice(argv[1]) == "--stat";
+  if (argc < 2 + static_cast<int>(only_statistics)) {
+    LOG(PLAIN) << "Usage: binlog_dump [--stat] <binlog_file_name>";
     return 1;
   }
-  td::string binlog_file_name = argv[1];
+  td::string binlog_file_name = argv[1 + static_cast<int>(only_statistics)];
   auto r_stat = td::stat(binlog_file_name);
   if (r_stat.is_error() || r_stat.ok().size_ == 0 || !r_stat.ok().is_reg_) {
     LOG(PLAIN) << "Wrong binlog file name specified";
-    LOG(PLAIN) << "Usage: binlog_dump <binlog_file_name>";
+    LOG(PLAIN) << "Usage: binlog_dump [--stat] <binlog_file_name>";
     return 1;
   }
 
@@ -115,6 +212,7 @@ int main(int argc, char *argv[]) {
     Trie compressed_trie;
   };
   std::map<td::uint64, Info> info;
+  BinlogStatistics statistics;
 
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
   td::Binlog binlog;
@@ -122,6 +220,7 @@ int main(int argc, char *argv[]) {
       .init(
           binlog_file_name,
           [&](auto &event) {
+            statistics.on_live_event(event);
             info[0].compressed_size += event.raw_event_.size();
             info[event.type_].compressed_size += event.raw_event_.size();
             if (event.type_ == ConfigPmcMagic || event.type_ == BinlogPmcMagic) {
@@ -131,12 +230,16 @@ int main(int argc, char *argv[]) {
           },
           td::DbKey::raw_key("cucumber"), td::DbKey::empty(), -1,
           [&](auto &event) mutable {
+            statistics.on_event(event);
             info[0].full_size += event.raw_event_.size();
             info[event.type_].full_size += event.raw_event_.size();
             if (event.type_ == ConfigPmcMagic || event.type_ == BinlogPmcMagic) {
               auto key = td::TlParser(event.get_data()).fetch_string<td::Slice>();
               info[event.type_].trie.add(key);
             }
+            if (only_statistics) {
+              return;
+            }
             LOG(PLAIN) << "LogEvent[" << td::tag("event_id", td::format::as_hex(event.id_))
                        << td::tag("type", event.type_) << td::tag("flags", event.flags_)
                        << td::tag("size", event.get_data().size())
@@ -153,6 +256,7 @@ int main(int argc, char *argv[]) {
       it.second.compressed_trie.dump();
     }
   }
+  statistics.dump();
 
   return 0;
 }
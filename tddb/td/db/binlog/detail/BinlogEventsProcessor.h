@@ -12,6 +12,8 @@
 #include "td/utils/logging.h"
 #include "td/utils/Status.h"
 
+#include <algorithm>
+
 namespace td {
 namespace detail {
 
@@ -33,6 +35,18 @@ class BinlogEventsProcessor {
     }
   }
 
+  // calls callback for the events with identifiers not less than first_event_id in increasing order of the identifiers
+  // until the callback returns false
+  template <class CallbackT>
+  void for_each_from(uint64 first_event_id, CallbackT &&callback) {
+    auto it = std::lower_bound(event_ids_.begin(), event_ids_.end(), first_event_id * 2);
+    for (auto i = static_cast<size_t>(it - event_ids_.begin()); i < event_ids_.size(); i++) {
+      if ((event_ids_[i] & 1) == 0 && !callback(events_[i])) {
+        return;
+      }
+    }
+  }
+
   uint64 last_event_id() const {
     return last_event_id_;
   }
@@ -6,6 +6,8 @@
 //
 #include "td/db/detail/RawSqliteDb.h"
 
+#include "td/db/SqliteCacheBudget.h"
+
 #include "sqlite/sqlite3.h"
 
 #include "td/utils/common.h"
@@ -51,7 +53,12 @@ bool RawSqliteDb::was_any_database_destroyed() {
   return was_database_destroyed.load(std::memory_order_relaxed);
 }
 
+RawSqliteDb::RawSqliteDb(tdsqlite3 *db, std::string path) : db_(db), path_(std::move(path)) {
+  SqliteCacheBudget::register_connection(this);
+}
+
 RawSqliteDb::~RawSqliteDb() {
+  SqliteCacheBudget::unregister_connection(this);
   auto rc = tdsqlite3_close(db_);
   LOG_IF(FATAL, rc != SQLITE_OK) << last_error(db_, path());
 }
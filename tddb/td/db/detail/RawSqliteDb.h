@@ -6,11 +6,14 @@
 //
 #pragma once
 
+#include "td/utils/common.h"
 #include "td/utils/optional.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 
+#include <atomic>
+
 struct tdsqlite3;
 
 namespace td {
@@ -18,8 +21,7 @@ namespace detail {
 
 class RawSqliteDb {
  public:
-  RawSqliteDb(tdsqlite3 *db, std::string path) : db_(db), path_(std::move(path)) {
-  }
+  RawSqliteDb(tdsqlite3 *db, std::string path);
   RawSqliteDb(const RawSqliteDb &) = delete;
   RawSqliteDb(RawSqliteDb &&) = delete;
   RawSqliteDb &operator=(const RawSqliteDb &) = delete;
@@ -67,11 +69,32 @@ class RawSqliteDb {
     return cipher_version_.copy();
   }
 
+  // page cache size in bytes assigned by SqliteCacheBudget; 0 if the default cache size must be used
+  void set_cache_size_target(int64 cache_size) {
+    cache_size_target_.store(cache_size, std::memory_order_relaxed);
+  }
+
+  int64 get_cache_size_target() const {
+    return cache_size_target_.load(std::memory_order_relaxed);
+  }
+
+  // must be called only by the thread, which uses the connection
+  bool need_update_cache_size() const {
+    return cache_size_ != get_cache_size_target();
+  }
+
+  int64 on_update_cache_size() {
+    cache_size_ = get_cache_size_target();
+    return cache_size_;
+  }
+
  private:
   tdsqlite3 *db_;
   std::string path_;
   size_t begin_cnt_{0};
   optional<int32> cipher_version_;
+  std::atomic<int64> cache_size_target_{0};
+  int64 cache_size_ = 0;
 };
 
 }  // namespace detail
@@ -23,21 +23,27 @@ namespace detail {
 
 class GoogleDnsResolver final : public Actor {
  public:
-  GoogleDnsResolver(std::string host, bool prefer_ipv6, Promise<IPAddress> promise)
+  GoogleDnsResolver(std::string host, bool prefer_ipv6, Promise<ResolvedIPAddress> promise)
       : host_(std::move(host)), prefer_ipv6_(prefer_ipv6), promise_(std::move(promise)) {
   }
 
  private:
   std::string host_;
   bool prefer_ipv6_;
-  Promise<IPAddress> promise_;
+  Promise<ResolvedIPAddress> promise_;
   ActorOwn<Wget> wget_;
   double begin_time_ = 0;
 
+  int32 get_record_type() const {
+    return prefer_ipv6_ ? 28 : 1;  // AAAA or A
+  }
+
   void start_up() final {
     auto r_address = IPAddress::get_ip_address(host_);
     if (r_address.is_ok()) {
-      promise_.set_value(r_address.move_as_ok());
+      ResolvedIPAddress result;
+      result.ip = r_address.move_as_ok();
+      promise_.set_value(std::move(result));
       return stop();
     }
 
@@ -49,27 +55,46 @@ class GoogleDnsResolver final : public Actor {
     });
     wget_ = create_actor<Wget>(
         "GoogleDnsResolver", std::move(wget_promise),
-        PSTRING() << "https://dns.google/resolve?name=" << url_encode(host_) << "&type=" << (prefer_ipv6_ ? 28 : 1),
+        PSTRING() << "https://dns.google/resolve?name=" << url_encode(host_) << "&type=" << get_record_type(),
         std::vector<std::pair<string, string>>({{"Host", "dns.google"}}), timeout, ttl, prefer_ipv6_,
-        SslCtx::VerifyPeer::Off);
+        SslCtx::VerifyPeer::Off, string(), string(), true);
   }
 
-  static Result<IPAddress> get_ip_address(Result<unique_ptr<HttpQuery>> r_http_query) {
+  Result<ResolvedIPAddress> get_ip_address(Result<unique_ptr<HttpQuery>> r_http_query) const {
     TRY_RESULT(http_query, std::move(r_http_query));
 
-    auto get_ip_address = [](JsonValue &answer) -> Result<IPAddress> {
+    // the answer can start with CNAME records, so the first record of the requested type is used
+    // the address is valid while all records in the chain are valid, so the minimum TTL is used
+    auto get_ip_address = [record_type = get_record_type()](JsonValue &answer) -> Result<ResolvedIPAddress> {
       auto &array = answer.get_array();
       if (array.empty()) {
         return Status::Error("Failed to parse DNS result: Answer is an empty array");
       }
-      if (array[0].type() != JsonValue::Type::Object) {
-        return Status::Error("Failed to parse DNS result: Answer[0] is not an object");
+      JsonObject *record = nullptr;
+      int32 ttl = -1;
+      for (auto &value : array) {
+        if (value.type() != JsonValue::Type::Object) {
+          return Status::Error("Failed to parse DNS result: Answer element is not an object");
+        }
+        auto &object = value.get_object();
+        TRY_RESULT(type, get_json_object_int_field(object, "type", true, record_type));
+        TRY_RESULT(record_ttl, get_json_object_int_field(object, "TTL", true, -1));
+        if (record_ttl >= 0 && (ttl < 0 || record_ttl < ttl)) {
+          ttl = record_ttl;
+        }
+        if (type == record_type) {
+          record = &object;
+          break;
+        }
       }
-      auto &answer_0 = array[0].get_object();
-      TRY_RESULT(ip_str, get_json_object_string_field(answer_0, "data", false));
-      IPAddress ip;
-      TRY_STATUS(ip.init_host_port(ip_str, 0));
-      return ip;
+      if (record == nullptr) {
+        record = &array[0].get_object();
+      }
+      TRY_RESULT(ip_str, get_json_object_string_field(*record, "data", false));
+      ResolvedIPAddress result;
+      TRY_STATUS(result.ip.init_host_port(ip_str, 0));
+      result.ttl = ttl;
+      return std::move(result);
     };
     if (!http_query->get_arg("Answer").empty()) {
       TRY_RESULT(answer, json_decode(http_query->get_arg("Answer")));
@@ -92,7 +117,8 @@ class GoogleDnsResolver final : public Actor {
     auto result = get_ip_address(std::move(r_http_query));
     VLOG(dns_resolver) << "Init IPv" << (prefer_ipv6_ ? "6" : "4") << " host = " << host_ << " in "
                        << end_time - begin_time_ << " seconds to "
-                       << (result.is_ok() ? (PSLICE() << result.ok()) : CSlice("[invalid]"));
+                       << (result.is_ok() ? (PSLICE() << result.ok().ip << " with TTL " << result.ok().ttl)
+                                          : CSlice("[invalid]"));
     promise_.set_result(std::move(result));
     stop();
   }
@@ -100,14 +126,14 @@ class GoogleDnsResolver final : public Actor {
 
 class NativeDnsResolver final : public Actor {
  public:
-  NativeDnsResolver(std::string host, bool prefer_ipv6, Promise<IPAddress> promise)
+  NativeDnsResolver(std::string host, bool prefer_ipv6, Promise<ResolvedIPAddress> promise)
       : host_(std::move(host)), prefer_ipv6_(prefer_ipv6), promise_(std::move(promise)) {
   }
 
  private:
   std::string host_;
   bool prefer_ipv6_;
-  Promise<IPAddress> promise_;
+  Promise<ResolvedIPAddress> promise_;
 
   void start_up() final {
     IPAddress ip;
@@ -118,7 +144,9 @@ class NativeDnsResolver final : public Actor {
     if (status.is_error()) {
       promise_.set_error(std::move(status));
     } else {
-      promise_.set_value(std::move(ip));
+      ResolvedIPAddress result;
+      result.ip = std::move(ip);  // getaddrinfo doesn't return TTL
+      promise_.set_value(std::move(result));
     }
     stop();
   }
@@ -142,10 +170,25 @@ void GetHostByNameActor::run(string host, int port, bool prefer_ipv6, Promise<IP
     return promise.set_error(Status::Error("Host is empty"));
   }
 
+  stats_.request_count++;
   auto begin_time = Time::now();
-  auto &value = cache_[prefer_ipv6].emplace(ascii_host, Value{{}, begin_time - 1.0}).first->second;
+  auto &value = cache_[prefer_ipv6].emplace(ascii_host, Value{{}, begin_time - 1.0, begin_time - 1.0}).first->second;
   if (value.expires_at > begin_time) {
-    return promise.set_result(value.get_ip_port(port));
+    stats_.cache_hit_count++;
+    promise.set_result(value.get_ip_port(port));
+    if (value.refresh_at > begin_time || value.ip.is_error()) {
+      return;
+    }
+    auto &query_ptr = active_queries_[prefer_ipv6][ascii_host];
+    if (query_ptr == nullptr) {
+      VLOG(dns_resolver) << "Prefetch host = " << host;
+      stats_.prefetch_count++;
+      query_ptr = make_unique<Query>();
+      query_ptr->real_host = std::move(host);
+      query_ptr->begin_time = begin_time;
+      run_query(std::move(ascii_host), prefer_ipv6, *query_ptr);
+    }
+    return;
   }
 
   auto &query_ptr = active_queries_[prefer_ipv6][ascii_host];
@@ -162,10 +205,15 @@ void GetHostByNameActor::run(string host, int port, bool prefer_ipv6, Promise<IP
   }
 }
 
+void GetHostByNameActor::get_stats(Promise<Stats> promise) {
+  promise.set_value(Stats(stats_));
+}
+
 void GetHostByNameActor::run_query(std::string host, bool prefer_ipv6, Query &query) {
-  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), host, prefer_ipv6](Result<IPAddress> res) mutable {
-    send_closure(actor_id, &GetHostByNameActor::on_query_result, std::move(host), prefer_ipv6, std::move(res));
-  });
+  auto promise = PromiseCreator::lambda(
+      [actor_id = actor_id(this), host, prefer_ipv6](Result<detail::ResolvedIPAddress> res) mutable {
+        send_closure(actor_id, &GetHostByNameActor::on_query_result, std::move(host), prefer_ipv6, std::move(res));
+      });
 
   CHECK(query.query.empty());
   CHECK(query.pos < options_.resolver_types.size());
@@ -185,11 +233,11 @@ void GetHostByNameActor::run_query(std::string host, bool prefer_ipv6, Query &qu
   }();
 }
 
-void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6, Result<IPAddress> result) {
+void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6,
+                                         Result<detail::ResolvedIPAddress> result) {
   auto query_it = active_queries_[prefer_ipv6].find(host);
   CHECK(query_it != active_queries_[prefer_ipv6].end());
   auto &query = *query_it->second;
-  CHECK(!query.promises.empty());
   CHECK(!query.query.empty());
 
   if (result.is_error() && query.pos < options_.resolver_types.size()) {
@@ -198,18 +246,38 @@ void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6, Res
   }
 
   auto end_time = Time::now();
-  VLOG(dns_resolver) << "Init host = " << query.real_host << " in total of " << end_time - query.begin_time
-                     << " seconds to " << (result.is_ok() ? (PSLICE() << result.ok()) : CSlice("[invalid]"));
+  auto resolve_time = end_time - query.begin_time;
+  VLOG(dns_resolver) << "Init host = " << query.real_host << " in total of " << resolve_time << " seconds to "
+                     << (result.is_ok() ? (PSLICE() << result.ok().ip) : CSlice("[invalid]"));
+  stats_.resolve_count++;
+  if (result.is_error()) {
+    stats_.failed_resolve_count++;
+  }
+  stats_.total_resolve_time += resolve_time;
+  stats_.max_resolve_time = max(stats_.max_resolve_time, resolve_time);
 
   auto promises = std::move(query.promises);
+  active_queries_[prefer_ipv6].erase(query_it);
+
   auto value_it = cache_[prefer_ipv6].find(host);
   CHECK(value_it != cache_[prefer_ipv6].end());
-  auto cache_timeout = result.is_ok() ? options_.ok_timeout : options_.error_timeout;
-  value_it->second = Value{std::move(result), end_time + cache_timeout};
-  active_queries_[prefer_ipv6].erase(query_it);
+  auto &value = value_it->second;
+  if (result.is_error()) {
+    if (value.ip.is_error() || value.expires_at <= end_time) {
+        value = Value{result.move_as_error(), end_time + options_.error_timeout, end_time + options_.error_timeout};
+    }
+    // otherwise, prefetch has failed and the still valid address is kept
+  } else {
+    auto resolved = result.move_as_ok();
+    auto cache_timeout = options_.ok_timeout;
+    if (resolved.ttl >= 0) {
+      cache_timeout = clamp(resolved.ttl, min(options_.min_ok_timeout, options_.ok_timeout), options_.ok_timeout);
+    }
+    value = Value{std::move(resolved.ip), end_time + cache_timeout, end_time + cache_timeout * 0.9};
+  }
 
   for (auto &promise : promises) {
-    promise.second.set_result(value_it->second.get_ip_port(promise.first));
+    promise.second.set_result(value.get_ip_port(promise.first));
   }
 }
 
@@ -20,6 +20,13 @@ namespace td {
 
 extern int VERBOSITY_NAME(dns_resolver);
 
+namespace detail {
+struct ResolvedIPAddress {
+  IPAddress ip;
+  int32 ttl = -1;  // in seconds, -1 if unknown
+};
+}  // namespace detail
+
 class GetHostByNameActor final : public Actor {
  public:
   enum class ResolverType { Native, Google };
@@ -27,25 +34,43 @@ class GetHostByNameActor final : public Actor {
   struct Options {
     static constexpr int32 DEFAULT_CACHE_TIME = 60 * 29;       // 29 minutes
     static constexpr int32 DEFAULT_ERROR_CACHE_TIME = 60 * 5;  // 5 minutes
+    static constexpr int32 DEFAULT_MIN_CACHE_TIME = 60;        // 1 minute
 
     vector<ResolverType> resolver_types{ResolverType::Native};
     int32 scheduler_id{-1};
-    int32 ok_timeout{DEFAULT_CACHE_TIME};
+    int32 ok_timeout{DEFAULT_CACHE_TIME};  // maximum cache time; used as is if the resolver doesn't know the TTL
+    int32 min_ok_timeout{DEFAULT_MIN_CACHE_TIME};
     int32 error_timeout{DEFAULT_ERROR_CACHE_TIME};
   };
 
+  struct Stats {
+    uint64 request_count = 0;
+    uint64 cache_hit_count = 0;
+    uint64 prefetch_count = 0;
+    uint64 resolve_count = 0;
+    uint64 failed_resolve_count = 0;
+    double total_resolve_time = 0.0;
+    double max_resolve_time = 0.0;
+  };
+
   explicit GetHostByNameActor(Options options);
 
   void run(std::string host, int port, bool prefer_ipv6, Promise<IPAddress> promise);
 
+  void get_stats(Promise<Stats> promise);
+
  private:
-  void on_query_result(std::string host, bool prefer_ipv6, Result<IPAddress> result);
+  void on_query_result(std::string host, bool prefer_ipv6, Result<detail::ResolvedIPAddress> result);
 
+  // successfully resolved entries, which are requested after refresh_at, are re-resolved in background,
+  // so frequently used hosts are never removed from the cache
   struct Value {
     Result<IPAddress> ip;
     double expires_at;
+    double refresh_at;
 
-    Value(Result<IPAddress> ip, double expires_at) : ip(std::move(ip)), expires_at(expires_at) {
+    Value(Result<IPAddress> ip, double expires_at, double refresh_at)
+        : ip(std::move(ip)), expires_at(expires_at), refresh_at(refresh_at) {
     }
 
     Result<IPAddress> get_ip_port(int port) const {
@@ -68,6 +93,7 @@ class GetHostByNameActor final : public Actor {
   FlatHashMap<string, unique_ptr<Query>> active_queries_[2];
 
   Options options_;
+  Stats stats_;
 
   void run_query(std::string host, bool prefer_ipv6, Query &query);
 };
@@ -53,6 +53,8 @@ void HttpConnectionBase::start_up() {
   yield();
 }
 void HttpConnectionBase::tear_down() {
+  LOG(DEBUG) << "Close connection after " << fd_.get_read_syscall_count() << " reads and "
+             << fd_.get_write_syscall_count() << " writes";
   Scheduler::unsubscribe_before_close(fd_.get_poll_info().get_pollable_fd_ref());
   fd_.close();
 }
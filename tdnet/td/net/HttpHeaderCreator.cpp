@@ -0,0 +1,65 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/net/HttpHeaderCreator.h"
+
+#include "td/utils/port/Clocks.h"
+#include "td/utils/port/thread_local.h"
+
+#include <cstring>
+
+namespace td {
+
+string HttpHeaderCreator::format_http_date(int64 unix_time) {
+  static const char *const week_days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+  static const char *const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  if (unix_time < 0) {
+    unix_time = 0;
+  }
+  auto days = unix_time / 86400;
+  auto seconds = static_cast<int32>(unix_time % 86400);
+  auto week_day = static_cast<int32>((days + 4) % 7);  // 1 January 1970 was Thursday
+
+  // convert the number of days since 1 January 1970 to a date in the proleptic Gregorian calendar
+  auto z = days + 719468;
+  auto era = z / 146097;
+  auto day_of_era = z - era * 146097;
+  auto year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+  auto day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  auto month_index = (5 * day_of_year + 2) / 153;  // 0 is March
+  auto day = static_cast<int32>(day_of_year - (153 * month_index + 2) / 5 + 1);
+  auto month = static_cast<int32>(month_index < 10 ? month_index + 3 : month_index - 9);
+  auto year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+
+  auto two_digits = [](int32 x) {
+    return string{static_cast<char>('0' + x / 10), static_cast<char>('0' + x % 10)};
+  };
+  return PSTRING() << week_days[week_day] << ", " << two_digits(day) << ' ' << months[month - 1] << ' ' << year << ' '
+                   << two_digits(seconds / 3600) << ':' << two_digits(seconds / 60 % 60) << ':'
+                   << two_digits(seconds % 60) << " GMT";
+}
+
+Slice HttpHeaderCreator::get_date_header() {
+  struct CachedDateHeader {
+    int64 unix_time;
+    size_t size;
+    char header[64];
+  };
+  static TD_THREAD_LOCAL CachedDateHeader cache;
+
+  auto unix_time = static_cast<int64>(Clocks::system());
+  if (cache.size == 0 || cache.unix_time != unix_time) {
+    auto header = PSTRING() << "Date: " << format_http_date(unix_time) << "\r\n";
+    CHECK(header.size() <= sizeof(cache.header));
+    std::memcpy(cache.header, header.data(), header.size());
+    cache.size = header.size();
+    cache.unix_time = unix_time;
+  }
+  return Slice(cache.header, cache.size);
+}
+
+}  // namespace td
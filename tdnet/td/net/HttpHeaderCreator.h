@@ -6,6 +6,7 @@
 //
 #pragma once
 
+#include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
@@ -41,11 +42,19 @@ class HttpHeaderCreator {
   void add_header(Slice key, Slice value) {
     sb_ << key << ": " << value << "\r\n";
   }
+  // adds preformatted header lines, each of which must end with "\r\n"; allows to build constant headers only once
+  void add_header_lines(Slice header_lines) {
+    sb_ << header_lines;
+  }
+  // adds the Date header with the current time
+  void add_date() {
+    sb_ << get_date_header();
+  }
   void set_content_type(Slice type) {
     add_header("Content-Type", type);
   }
   void set_content_size(size_t size) {
-    add_header("Content-Length", PSLICE() << size);
+    sb_ << "Content-Length: " << size << "\r\n";
   }
   void set_keep_alive() {
     add_header("Connection", "keep-alive");
@@ -62,6 +71,12 @@ class HttpHeaderCreator {
     return sb_.as_cslice();
   }
 
+  // returns date in the format "Sun, 06 Nov 1994 08:49:37 GMT"
+  static string format_http_date(int64 unix_time);
+
+  // returns the Date header line for the current time; the line is cached and updated once per second
+  static Slice get_date_header();
+
  private:
   static CSlice get_status_line(int http_status_code) {
     if (http_status_code == 200) {
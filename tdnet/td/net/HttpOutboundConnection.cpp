@@ -7,16 +7,27 @@
 #include "td/net/HttpOutboundConnection.h"
 
 #include "td/utils/common.h"
+#include "td/utils/logging.h"
 
 namespace td {
 
+void HttpOutboundConnection::set_callback(ActorShared<Callback> callback) {
+  callback_ = std::move(callback);
+}
+
 void HttpOutboundConnection::on_query(unique_ptr<HttpQuery> query) {
-  CHECK(!callback_.empty());
+  if (callback_.empty()) {
+    LOG(INFO) << "Receive unexpected response in an idle connection";
+    return stop();
+  }
   send_closure(callback_, &Callback::handle, std::move(query));
 }
 
 void HttpOutboundConnection::on_error(Status error) {
-  CHECK(!callback_.empty());
+  if (callback_.empty()) {
+    LOG(DEBUG) << "Close idle connection: " << error;
+    return stop();
+  }
   send_closure(callback_, &Callback::on_connection_error, std::move(error));
 }
 
@@ -36,6 +36,9 @@ class HttpOutboundConnection final : public detail::HttpConnectionBase {
   // void write_ok();
   // void write_error(Status error);
 
+  // changes the receiver of responses; the connection is idle while the callback is empty
+  void set_callback(ActorShared<Callback> callback);
+
  private:
   void on_query(unique_ptr<HttpQuery> query) final;
   void on_error(Status error) final;
@@ -16,8 +16,10 @@
 #include "td/utils/misc.h"
 #include "td/utils/Parser.h"
 #include "td/utils/PathView.h"
+#include "td/utils/port/IoSlice.h"
 #include "td/utils/port/path.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Span.h"
 
 #include <cstddef>
 #include <cstring>
@@ -183,7 +185,7 @@ Result<size_t> HttpReader::read_next(HttpQuery *query, bool can_be_slow) {
         auto size = content_->size();
         bool restart = false;
         if (size > (1 << 20) || flow_sink_.is_ready()) {
-          TRY_STATUS(save_file_part(content_->cut_head(size).move_as_buffer_slice()));
+          TRY_STATUS(save_file_part(content_->cut_head(size)));
           restart = true;
         }
         if (flow_sink_.is_ready()) {
@@ -471,7 +473,7 @@ Result<bool> HttpReader::parse_multipart_form_data(bool can_be_slow) {
           }
         }
         if (find_boundary(content_->clone(), boundary_, form_data_read_length_)) {
-          auto file_part = content_->cut_head(form_data_read_length_).move_as_buffer_slice();
+          auto file_part = content_->cut_head(form_data_read_length_);
           content_->advance(boundary_.size());
           form_data_skipped_length_ += form_data_read_length_ + boundary_.size();
           form_data_read_length_ = 0;
@@ -485,8 +487,7 @@ Result<bool> HttpReader::parse_multipart_form_data(bool can_be_slow) {
           continue;
         }
 
-        // TODO optimize?
-        auto file_part = content_->cut_head(form_data_read_length_).move_as_buffer_slice();
+        auto file_part = content_->cut_head(form_data_read_length_);
         form_data_skipped_length_ += form_data_read_length_;
         form_data_read_length_ = 0;
         CHECK(content_->size() < boundary_.size());
@@ -573,7 +574,7 @@ void HttpReader::process_header(MutableSlice header_name, MutableSlice header_va
     }
   } else if (header_name == "content-type") {
     content_type_ = header_value;
-    content_type_lowercased_ = header_value.str();
+    content_type_lowercased_.assign(header_value.begin(), header_value.end());
     to_lower_inplace(content_type_lowercased_);
   } else if (header_name == "content-encoding") {
     to_lower_inplace(header_value);
@@ -751,7 +752,7 @@ Status HttpReader::parse_head(MutableSlice head) {
 
   content_length_ = 0;
   content_type_ = Slice("application/octet-stream");
-  content_type_lowercased_ = content_type_.str();
+  content_type_lowercased_.assign(content_type_.begin(), content_type_.end());
   transfer_encoding_ = Slice();
   content_encoding_ = Slice();
 
@@ -832,7 +833,7 @@ Status HttpReader::try_open_temp_file(Slice directory_name, CSlice desired_file_
   return Status::OK();
 }
 
-Status HttpReader::save_file_part(BufferSlice &&file_part) {
+Status HttpReader::save_file_part(ChainBufferReader &&file_part) {
   file_size_ += narrow_cast<int64>(file_part.size());
   if (file_size_ > MAX_FILE_SIZE) {
     clean_temporary_file();
@@ -841,10 +842,26 @@ Status HttpReader::save_file_part(BufferSlice &&file_part) {
   }
 
   LOG(DEBUG) << "Save file part of size " << file_part.size() << " to file " << temp_file_name_;
-  auto result_written = temp_file_.write(file_part.as_slice());
-  if (result_written.is_error() || result_written.ok() != file_part.size()) {
-    clean_temporary_file();
-    return Status::Error(500, "Internal Server Error: can't upload the file");
+  // write buffer chunks directly without concatenating them
+  while (!file_part.empty()) {
+    constexpr size_t MAX_IO_SLICES = 64;
+    IoSlice io_slices[MAX_IO_SLICES];
+    auto it = file_part.clone();
+    size_t io_slice_count = 0;
+    while (io_slice_count < MAX_IO_SLICES) {
+      Slice slice = it.prepare_read();
+      if (slice.empty()) {
+        break;
+      }
+      io_slices[io_slice_count++] = as_io_slice(slice);
+      it.confirm_read(slice.size());
+    }
+    auto result_written = temp_file_.writev(Span<IoSlice>(io_slices, io_slice_count));
+    if (result_written.is_error() || result_written.ok() == 0) {
+      clean_temporary_file();
+      return Status::Error(500, "Internal Server Error: can't upload the file");
+    }
+    file_part.advance(result_written.ok());
   }
   return Status::OK();
 }
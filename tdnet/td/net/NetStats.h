@@ -11,7 +11,6 @@
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/StringBuilder.h"
-#include "td/utils/Time.h"
 
 #include <atomic>
 #include <memory>
@@ -22,6 +21,7 @@ class NetStatsCallback {
  public:
   virtual void on_read(uint64 bytes) = 0;
   virtual void on_write(uint64 bytes) = 0;
+  virtual void on_packet_sent(uint64 bytes) = 0;
   NetStatsCallback() = default;
   NetStatsCallback(const NetStatsCallback &) = delete;
   NetStatsCallback &operator=(const NetStatsCallback &) = delete;
@@ -34,6 +34,10 @@ struct NetStatsData {
 
   uint64 count = 0;
   double duration = 0;
+
+  // aren't saved to the database
+  uint64 packet_count = 0;
+  uint64 packet_size = 0;
 };
 
 inline NetStatsData operator+(const NetStatsData &a, const NetStatsData &b) {
@@ -42,6 +46,8 @@ inline NetStatsData operator+(const NetStatsData &a, const NetStatsData &b) {
   res.write_size = a.write_size + b.write_size;
   res.count = a.count + b.count;
   res.duration = a.duration + b.duration;
+  res.packet_count = a.packet_count + b.packet_count;
+  res.packet_size = a.packet_size + b.packet_size;
   return res;
 }
 inline NetStatsData operator-(const NetStatsData &a, const NetStatsData &b) {
@@ -58,25 +64,25 @@ inline NetStatsData operator-(const NetStatsData &a, const NetStatsData &b) {
   CHECK(a.duration >= b.duration);
   res.duration = a.duration - b.duration;
 
+  CHECK(a.packet_count >= b.packet_count);
+  res.packet_count = a.packet_count - b.packet_count;
+
+  CHECK(a.packet_size >= b.packet_size);
+  res.packet_size = a.packet_size - b.packet_size;
+
   return res;
 }
 
 inline StringBuilder &operator<<(StringBuilder &sb, const NetStatsData &data) {
   return sb << tag("Rx size", format::as_size(data.read_size)) << tag("Tx size", format::as_size(data.write_size))
-            << tag("count", data.count) << tag("duration", format::as_time(data.duration));
+            << tag("count", data.count) << tag("duration", format::as_time(data.duration))
+            << tag("packet count", data.packet_count) << tag("packet size", format::as_size(data.packet_size));
 }
 
+// Counters are scheduler-local and are updated without synchronization by the only writing thread,
+// so accounting of socket I/O costs a couple of plain memory accesses. They are summed up only on get_stats
 class NetStats {
  public:
-  class Callback {
-   public:
-    virtual void on_stats_updated() = 0;
-    Callback() = default;
-    Callback(const Callback &) = delete;
-    Callback &operator=(const Callback &) = delete;
-    virtual ~Callback() = default;
-  };
-
   std::shared_ptr<NetStatsCallback> get_callback() const {
     return impl_;
   }
@@ -85,11 +91,6 @@ class NetStats {
     return impl_->get_stats();
   }
 
-  // do it before get_callback
-  void set_callback(unique_ptr<Callback> callback) {
-    impl_->set_callback(std::move(callback));
-  }
-
  private:
   class Impl final : public NetStatsCallback {
    public:
@@ -98,44 +99,37 @@ class NetStats {
       local_net_stats_.for_each([&](auto &stats) {
         res.read_size += stats.read_size.load(std::memory_order_relaxed);
         res.write_size += stats.write_size.load(std::memory_order_relaxed);
+        res.packet_count += stats.packet_count.load(std::memory_order_relaxed);
+        res.packet_size += stats.packet_size.load(std::memory_order_relaxed);
       });
       return res;
     }
-    void set_callback(unique_ptr<Callback> callback) {
-      callback_ = std::move(callback);
-    }
 
    private:
     struct LocalNetStats {
-      double last_update = 0;
-      uint64 unsync_size = 0;
       std::atomic<uint64> read_size{0};
       std::atomic<uint64> write_size{0};
+      std::atomic<uint64> packet_count{0};
+      std::atomic<uint64> packet_size{0};
     };
     SchedulerLocalStorage<LocalNetStats> local_net_stats_;
-    unique_ptr<Callback> callback_;
 
-    void on_read(uint64 size) final {
-      auto &stats = local_net_stats_.get();
-      stats.read_size.fetch_add(size, std::memory_order_relaxed);
+    // the counter is changed only by the current thread, so a read-modify-write operation isn't needed
+    static void add(std::atomic<uint64> &counter, uint64 value) {
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
 
-      on_change(stats, size);
+    void on_read(uint64 size) final {
+      add(local_net_stats_.get().read_size, size);
     }
     void on_write(uint64 size) final {
-      auto &stats = local_net_stats_.get();
-      stats.write_size.fetch_add(size, std::memory_order_relaxed);
-
-      on_change(stats, size);
+      add(local_net_stats_.get().write_size, size);
     }
 
-    void on_change(LocalNetStats &stats, uint64 size) {
-      stats.unsync_size += size;
-      auto now = Time::now();
-      if (stats.unsync_size > 10000 || now - stats.last_update > 300) {
-        stats.unsync_size = 0;
-        stats.last_update = now;
-        callback_->on_stats_updated();
-      }
+    void on_packet_sent(uint64 size) final {
+      auto &stats = local_net_stats_.get();
+      add(stats.packet_count, 1);
+      add(stats.packet_size, size);
     }
   };
   std::shared_ptr<Impl> impl_{std::make_shared<Impl>()};
@@ -12,6 +12,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/IPAddress.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 #include "td/utils/Time.h"
 
@@ -20,8 +21,11 @@
 #include <openssl/ssl.h>
 #include <openssl/x509.h>
 
+#include <atomic>
 #include <cstring>
+#include <map>
 #include <memory>
+#include <mutex>
 
 namespace td {
 
@@ -132,6 +136,99 @@ struct SslHandleDeleter {
 
 using SslHandle = std::unique_ptr<SSL, SslHandleDeleter>;
 
+struct SslSessionStats {
+  std::atomic<uint64> handshake_count{0};
+  std::atomic<uint64> resumption_attempt_count{0};
+  std::atomic<uint64> resumed_handshake_count{0};
+};
+
+SslSessionStats &get_ssl_session_stats() {
+  static SslSessionStats stats;
+  return stats;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+// client TLS sessions, which can be resumed by subsequent connections to the same server
+// each session is used only once, as recommended for TLS 1.3 tickets
+class SslSessionCache {
+ public:
+  static SslSessionCache &instance() {
+    // the cache is never destroyed to avoid freeing of sessions after OpenSSL cleanup
+    static auto *cache = new SslSessionCache();
+    return *cache;
+  }
+
+  void add_session(SSL *ssl_handle, Slice host) {
+    auto *session = SSL_get1_session(ssl_handle);
+    if (session == nullptr) {
+      return;
+    }
+    SessionPtr session_ptr(session);
+    if (!SSL_SESSION_is_resumable(session)) {
+      return;
+    }
+
+    auto *ssl_ctx = SSL_get_SSL_CTX(ssl_handle);
+    // the context is referenced by the cache entry, so its address can't be reused by another context
+    SSL_CTX_up_ref(ssl_ctx);
+    SslCtxPtr ssl_ctx_ptr(ssl_ctx);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (sessions_.size() >= MAX_SESSION_COUNT) {
+      sessions_.clear();
+    }
+    auto &entry = sessions_[get_key(ssl_ctx, host)];
+    entry.ssl_ctx = std::move(ssl_ctx_ptr);
+    entry.session = std::move(session_ptr);
+  }
+
+  // returns whether a cached session was found
+  bool use_session(SSL *ssl_handle, Slice host) {
+    Entry entry;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = sessions_.find(get_key(SSL_get_SSL_CTX(ssl_handle), host));
+      if (it == sessions_.end()) {
+        return false;
+      }
+      entry = std::move(it->second);
+      sessions_.erase(it);
+    }
+    LOG(DEBUG) << "Try to resume TLS session with " << host;
+    return SSL_set_session(ssl_handle, entry.session.get()) == 1;
+  }
+
+ private:
+  static constexpr size_t MAX_SESSION_COUNT = 256;
+
+  struct SessionDeleter {
+    void operator()(SSL_SESSION *session) {
+      SSL_SESSION_free(session);
+    }
+  };
+  using SessionPtr = std::unique_ptr<SSL_SESSION, SessionDeleter>;
+
+  struct SslCtxDeleter {
+    void operator()(SSL_CTX *ssl_ctx) {
+      SSL_CTX_free(ssl_ctx);
+    }
+  };
+  using SslCtxPtr = std::unique_ptr<SSL_CTX, SslCtxDeleter>;
+
+  struct Entry {
+    SslCtxPtr ssl_ctx;
+    SessionPtr session;
+  };
+
+  std::mutex mutex_;
+  std::map<string, Entry> sessions_;
+
+  static string get_key(const SSL_CTX *ssl_ctx, Slice host) {
+    return PSTRING() << static_cast<const void *>(ssl_ctx) << ' ' << host;
+  }
+};
+#endif
+
 }  // namespace
 
 class SslStreamImpl {
@@ -177,11 +274,31 @@ class SslStreamImpl {
 #endif
     SSL_set_connect_state(ssl_handle.get());
 
+    session_cache_key_ = PSTRING() << host << ' ' << check_ip_address_as_host;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+    if (SslSessionCache::instance().use_session(ssl_handle.get(), session_cache_key_)) {
+      get_ssl_session_stats().resumption_attempt_count++;
+    }
+#endif
+
     ssl_handle_ = std::move(ssl_handle);
 
     return Status::OK();
   }
 
+  SslStreamImpl() = default;
+  SslStreamImpl(const SslStreamImpl &) = delete;
+  SslStreamImpl &operator=(const SslStreamImpl &) = delete;
+  SslStreamImpl(SslStreamImpl &&) = delete;
+  SslStreamImpl &operator=(SslStreamImpl &&) = delete;
+  ~SslStreamImpl() {
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+    if (ssl_handle_ != nullptr && SSL_is_init_finished(ssl_handle_.get())) {
+      SslSessionCache::instance().add_session(ssl_handle_.get(), session_cache_key_);
+    }
+#endif
+  }
+
   ByteFlowInterface &read_byte_flow() {
     return read_flow_;
   }
@@ -197,6 +314,22 @@ class SslStreamImpl {
 
  private:
   SslHandle ssl_handle_;
+  string session_cache_key_;
+  bool is_handshake_finished_ = false;
+
+  void on_handshake_finished() {
+    is_handshake_finished_ = true;
+    auto &stats = get_ssl_session_stats();
+    stats.handshake_count++;
+    if (SSL_session_reused(ssl_handle_.get())) {
+      LOG(DEBUG) << "TLS session was resumed";
+      stats.resumed_handshake_count++;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+    // a TLS 1.3 session can be resumed only after a ticket is received, so it is saved again when the stream is closed
+    SslSessionCache::instance().add_session(ssl_handle_.get(), session_cache_key_);
+#endif
+  }
 
   friend class SslReadByteFlow;
   friend class SslWriteByteFlow;
@@ -213,6 +346,9 @@ class SslStreamImpl {
     if (size <= 0) {
       return process_ssl_error(size);
     }
+    if (!is_handshake_finished_) {
+      on_handshake_finished();
+    }
     return size;
   }
 
@@ -228,6 +364,9 @@ class SslStreamImpl {
     if (size <= 0) {
       return process_ssl_error(size);
     }
+    if (!is_handshake_finished_) {
+      on_handshake_finished();
+    }
     return size;
   }
 
@@ -357,6 +496,15 @@ SslStream::SslStream(SslStream &&) noexcept = default;
 SslStream &SslStream::operator=(SslStream &&) noexcept = default;
 SslStream::~SslStream() = default;
 
+SslStream::SessionStats SslStream::get_session_stats() {
+  auto &stats = detail::get_ssl_session_stats();
+  SessionStats result;
+  result.handshake_count = stats.handshake_count.load(std::memory_order_relaxed);
+  result.resumption_attempt_count = stats.resumption_attempt_count.load(std::memory_order_relaxed);
+  result.resumed_handshake_count = stats.resumed_handshake_count.load(std::memory_order_relaxed);
+  return result;
+}
+
 Result<SslStream> SslStream::create(CSlice host, SslCtx ssl_ctx, bool use_ip_address_as_host) {
   auto impl = make_unique<detail::SslStreamImpl>();
   TRY_STATUS(impl->init(host, ssl_ctx, use_ip_address_as_host));
@@ -392,6 +540,10 @@ SslStream::SslStream(SslStream &&) noexcept = default;
 SslStream &SslStream::operator=(SslStream &&) noexcept = default;
 SslStream::~SslStream() = default;
 
+SslStream::SessionStats SslStream::get_session_stats() {
+  return SessionStats();
+}
+
 Result<SslStream> SslStream::create(CSlice host, SslCtx ssl_ctx, bool check_ip_address_as_host) {
   return Status::Error("Not supported in Emscripten");
 }
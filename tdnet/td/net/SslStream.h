@@ -9,6 +9,7 @@
 #include "td/net/SslCtx.h"
 
 #include "td/utils/ByteFlow.h"
+#include "td/utils/common.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
@@ -27,6 +28,14 @@ class SslStream {
 
   static Result<SslStream> create(CSlice host, SslCtx ssl_ctx, bool use_ip_address_as_host = false);
 
+  // TLS session resumption statistics of all streams
+  struct SessionStats {
+    uint64 handshake_count = 0;            // number of completed handshakes
+    uint64 resumption_attempt_count = 0;   // number of streams, which offered a cached session
+    uint64 resumed_handshake_count = 0;    // number of completed handshakes, which resumed a session
+  };
+  static SessionStats get_session_stats();
+
   ByteFlowInterface &read_byte_flow();
   ByteFlowInterface &write_byte_flow();
 
@@ -14,6 +14,8 @@
 
 namespace td {
 
+// listeners on different schedulers can use the same port;
+// the kernel distributes incoming connections between them on systems supporting SO_REUSEPORT
 class TcpListener final : public Actor {
  public:
   class Callback : public Actor {
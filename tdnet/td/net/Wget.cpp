@@ -12,6 +12,7 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/BufferedFd.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/HttpUrl.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
@@ -19,14 +20,72 @@
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
 
 #include <limits>
+#include <mutex>
 
 namespace td {
 
+namespace {
+
+// idle keep-alive connections, which can be reused by subsequent requests to the same server
+class WgetConnectionPool {
+ public:
+  ActorOwn<HttpOutboundConnection> get_connection(const string &key) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = connections_.find(key);
+    if (it == connections_.end()) {
+      return {};
+    }
+    auto &server_connections = it->second;
+    CHECK(!server_connections.empty());
+    if (server_connections.back().expires_at < Time::now()) {
+      // all connections have expired; they are closed when ActorOwn is destroyed
+      connections_.erase(it);
+      return {};
+    }
+    auto result = std::move(server_connections.back().connection);
+    server_connections.pop_back();
+    if (server_connections.empty()) {
+      connections_.erase(it);
+    }
+    return result;
+  }
+
+  void put_connection(const string &key, ActorOwn<HttpOutboundConnection> connection) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &server_connections = connections_[key];
+    if (server_connections.size() >= MAX_IDLE_CONNECTIONS) {
+      server_connections.erase(server_connections.begin());
+    }
+    server_connections.push_back({std::move(connection), Time::now() + IDLE_TIMEOUT});
+  }
+
+ private:
+  static constexpr size_t MAX_IDLE_CONNECTIONS = 4;
+  static constexpr double IDLE_TIMEOUT = 30.0;
+
+  struct IdleConnection {
+    ActorOwn<HttpOutboundConnection> connection;
+    double expires_at;
+  };
+
+  std::mutex mutex_;
+  FlatHashMap<string, vector<IdleConnection>> connections_;
+};
+
+WgetConnectionPool &get_connection_pool() {
+  // the pool is never destroyed, because closing of connections requires a running scheduler
+  static auto *pool = new WgetConnectionPool();
+  return *pool;
+}
+
+}  // namespace
+
 Wget::Wget(Promise<unique_ptr<HttpQuery>> promise, string url, std::vector<std::pair<string, string>> headers,
            int32 timeout_in, int32 ttl, bool prefer_ipv6, SslCtx::VerifyPeer verify_peer, string content,
-           string content_type)
+           string content_type, bool keep_alive)
     : promise_(std::move(promise))
     , input_url_(std::move(url))
     , headers_(std::move(headers))
@@ -35,7 +94,8 @@ Wget::Wget(Promise<unique_ptr<HttpQuery>> promise, string url, std::vector<std::
     , prefer_ipv6_(prefer_ipv6)
     , verify_peer_(verify_peer)
     , content_(std::move(content))
-    , content_type_(std::move(content_type)) {
+    , content_type_(std::move(content_type))
+    , keep_alive_(keep_alive) {
 }
 
 Status Wget::try_init() {
@@ -70,8 +130,27 @@ Status Wget::try_init() {
   if (!was_accept_encoding) {
     hc.add_header("Accept-Encoding", "gzip, deflate");
   }
+  if (keep_alive_) {
+    hc.set_keep_alive();
+  }
   TRY_RESULT(header, hc.finish(content_));
 
+  connection_generation_++;
+  auto callback = actor_shared(this, connection_generation_);
+  if (keep_alive_) {
+    connection_key_ = PSTRING() << static_cast<int32>(url.protocol_) << ' ' << url.host_ << ' ' << url.port_ << ' '
+                                << prefer_ipv6_ << ' ' << static_cast<int32>(verify_peer_);
+    connection_ = get_connection_pool().get_connection(connection_key_);
+    is_reused_connection_ = !connection_.empty();
+    if (is_reused_connection_) {
+      LOG(DEBUG) << "Reuse connection to " << url.host_ << ':' << url.port_;
+      send_closure(connection_, &HttpOutboundConnection::set_callback, std::move(callback));
+      send_closure(connection_, &HttpOutboundConnection::write_next, BufferSlice(header));
+      send_closure(connection_, &HttpOutboundConnection::write_ok);
+      return Status::OK();
+    }
+  }
+
   IPAddress addr;
   TRY_STATUS(addr.init_host_port(url.host_, url.port_, prefer_ipv6_));
 
@@ -82,13 +161,13 @@ Status Wget::try_init() {
   if (url.protocol_ == HttpUrl::Protocol::Http) {
     connection_ = create_actor<HttpOutboundConnection>("Connect", BufferedFd<SocketFd>(std::move(fd)), SslStream{},
                                                        std::numeric_limits<std::size_t>::max(), 0, 0,
-                                                       ActorOwn<HttpOutboundConnection::Callback>(actor_id(this)));
+                                                       std::move(callback));
   } else {
     TRY_RESULT(ssl_ctx, SslCtx::create(CSlice() /* certificate */, verify_peer_));
     TRY_RESULT(ssl_stream, SslStream::create(url.host_, std::move(ssl_ctx)));
     connection_ = create_actor<HttpOutboundConnection>(
         "Connect", BufferedFd<SocketFd>(std::move(fd)), std::move(ssl_stream), std::numeric_limits<std::size_t>::max(),
-        0, 0, ActorOwn<HttpOutboundConnection::Callback>(actor_id(this)));
+        0, 0, std::move(callback));
   }
 
   send_closure(connection_, &HttpOutboundConnection::write_next, BufferSlice(header));
@@ -110,9 +189,39 @@ void Wget::handle(unique_ptr<HttpQuery> result) {
 }
 
 void Wget::on_connection_error(Status error) {
+  if (is_reused_connection_ && content_.empty()) {
+    // the server could have closed the idle connection before receiving the request; GET requests can be repeated
+    LOG(INFO) << "Reused connection failed: " << error;
+    return reconnect();
+  }
   on_error(std::move(error));
 }
 
+void Wget::hangup_shared() {
+  if (get_link_token() != connection_generation_ || !promise_) {
+    // an old connection was closed
+    return;
+  }
+  if (is_reused_connection_) {
+    LOG(INFO) << "Reused connection was closed";
+    return reconnect();
+  }
+  on_error(Status::Error("Connection closed"));
+}
+
+void Wget::reconnect() {
+  connection_.reset();
+  loop();
+}
+
+void Wget::release_connection(bool can_reuse) {
+  if (keep_alive_ && can_reuse && !connection_.empty()) {
+    send_closure(connection_, &HttpOutboundConnection::set_callback, ActorShared<HttpOutboundConnection::Callback>());
+    get_connection_pool().put_connection(connection_key_, std::move(connection_));
+  }
+  connection_.reset();
+}
+
 void Wget::on_ok(unique_ptr<HttpQuery> http_query_ptr) {
   CHECK(promise_);
   CHECK(http_query_ptr);
@@ -123,12 +232,14 @@ void Wget::on_ok(unique_ptr<HttpQuery> http_query_ptr) {
     input_url_ = http_query_ptr->get_header("location").str();
     LOG(DEBUG) << input_url_;
     ttl_--;
-    connection_.reset();
+    release_connection(http_query_ptr->keep_alive_);
     yield();
   } else if (http_query_ptr->code_ >= 200 && http_query_ptr->code_ < 300) {
+    release_connection(http_query_ptr->keep_alive_);
     promise_.set_value(std::move(http_query_ptr));
     stop();
   } else {
+    release_connection(http_query_ptr->keep_alive_);
     on_error(Status::Error(PSLICE() << "HTTP error: " << http_query_ptr->code_));
   }
 }
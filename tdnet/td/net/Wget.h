@@ -24,7 +24,8 @@ class Wget final : public HttpOutboundConnection::Callback {
  public:
   explicit Wget(Promise<unique_ptr<HttpQuery>> promise, string url, std::vector<std::pair<string, string>> headers = {},
                 int32 timeout_in = 10, int32 ttl = 3, bool prefer_ipv6 = false,
-                SslCtx::VerifyPeer verify_peer = SslCtx::VerifyPeer::On, string content = {}, string content_type = {});
+                SslCtx::VerifyPeer verify_peer = SslCtx::VerifyPeer::On, string content = {}, string content_type = {},
+                bool keep_alive = false);
 
  private:
   Status try_init();
@@ -34,8 +35,12 @@ class Wget final : public HttpOutboundConnection::Callback {
   void on_ok(unique_ptr<HttpQuery> http_query_ptr);
   void on_error(Status error);
 
+  void release_connection(bool can_reuse);
+  void reconnect();
+
   void tear_down() final;
   void start_up() final;
+  void hangup_shared() final;
   void timeout_expired() final;
 
   Promise<unique_ptr<HttpQuery>> promise_;
@@ -48,6 +53,12 @@ class Wget final : public HttpOutboundConnection::Callback {
   SslCtx::VerifyPeer verify_peer_;
   string content_;
   string content_type_;
+
+  // idle connections are reused only if keep_alive_ is true
+  bool keep_alive_ = false;
+  bool is_reused_connection_ = false;
+  string connection_key_;
+  uint64 connection_generation_ = 0;
 };
 
 }  // namespace td
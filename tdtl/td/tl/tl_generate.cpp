@@ -81,6 +81,42 @@ static void write_class_constructor(tl_outputer &out, const tl_combinator *t, co
   out.append(w.gen_constructor_end(t, field_num, is_default));
 }
 
+static int write_fields_fetch(tl_outputer &out, const tl_combinator *t, std::vector<var_description> &vars, bool flat,
+                              int parser_type, const TL_writer &w) {
+  int max_group_length = w.get_max_fixed_fields_length();
+  int field_num = 0;
+  std::size_t group_end = 0;
+  for (std::size_t i = 0; i < t->args.size(); i++) {
+    int checked_length = 0;
+    if (i >= group_end && max_group_length > 0) {
+      // find the longest group of fixed length fields, starting from the current field
+      int group_length = 0;
+      std::size_t j = i;
+      while (j < t->args.size()) {
+        int field_length = w.get_fixed_field_length(t->args[j]);
+        if (field_length <= 0 || group_length + field_length > max_group_length) {
+          break;
+        }
+        group_length += field_length;
+        j++;
+      }
+      if (j >= i + 2) {
+        group_end = j;
+        checked_length = group_length;
+      }
+    }
+
+    std::string field_fetch = i < group_end
+                                  ? w.gen_fixed_field_fetch(field_num, t->args[i], parser_type, checked_length)
+                                  : w.gen_field_fetch(field_num, t->args[i], vars, flat, parser_type);
+    if (!field_fetch.empty()) {
+      out.append(field_fetch);
+      field_num++;
+    }
+  }
+  return field_num;
+}
+
 static void write_function_fetch(tl_outputer &out, const std::string &parser_name, const tl_combinator *t,
                                  const std::string &class_name, const std::set<std::string> &request_types,
                                  const std::set<std::string> &result_types, const TL_writer &w) {
@@ -95,14 +131,7 @@ static void write_function_fetch(tl_outputer &out, const std::string &parser_nam
   out.append(w.gen_fetch_function_begin(parser_name, class_name, class_name, 0, static_cast<int>(t->args.size()), vars,
                                         parser_type));
   out.append(w.gen_vars(t, NULL, vars));
-  int field_num = 0;
-  for (std::size_t i = 0; i < t->args.size(); i++) {
-    std::string field_fetch = w.gen_field_fetch(field_num, t->args[i], vars, false, parser_type);
-    if (!field_fetch.empty()) {
-      out.append(field_fetch);
-      field_num++;
-    }
-  }
+  int field_num = write_fields_fetch(out, t, vars, false, parser_type, w);
 
   out.append(w.gen_fetch_function_end(false, field_num, vars, parser_type));
 }
@@ -180,14 +209,7 @@ static void write_constructor_fetch(tl_outputer &out, const std::string &parser_
                                         static_cast<int>(t->args.size()), vars, parser_type));
   out.append(w.gen_vars(t, result_type, vars));
   out.append(w.gen_uni(result_type, vars, true));
-  int field_num = 0;
-  for (std::size_t i = 0; i < t->args.size(); i++) {
-    std::string field_fetch = w.gen_field_fetch(field_num, t->args[i], vars, is_flat, parser_type);
-    if (!field_fetch.empty()) {
-      out.append(field_fetch);
-      field_num++;
-    }
-  }
+  int field_num = write_fields_fetch(out, t, vars, is_flat, parser_type, w);
 
   out.append(w.gen_fetch_function_end(class_name != parent_class_name, field_num, vars, parser_type));
 }
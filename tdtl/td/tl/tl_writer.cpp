@@ -155,6 +155,19 @@ std::string TL_writer::gen_main_class_name(const tl_type *t) const {
   return gen_class_name(t->name);
 }
 
+int TL_writer::get_fixed_field_length(const arg &a) const {
+  return 0;
+}
+
+int TL_writer::get_max_fixed_fields_length() const {
+  return 0;
+}
+
+std::string TL_writer::gen_fixed_field_fetch(int field_num, const arg &a, int parser_type, int checked_length) const {
+  assert(false);
+  return "";
+}
+
 int TL_writer::get_parser_type(const tl_combinator *t, const std::string &parser_name) const {
   return t->var_count > 0;
 }
@@ -108,6 +108,13 @@ class TL_writer {
   virtual std::string gen_constructor_id_store(std::int32_t id, int storer_type) const = 0;
   virtual std::string gen_field_fetch(int field_num, const arg &a, std::vector<var_description> &vars, bool flat,
                                       int parser_type) const = 0;
+  // consecutive fields of fixed length can be fetched after a single length check for the whole group
+  // returns 0 if the field must be fetched by gen_field_fetch
+  virtual int get_fixed_field_length(const arg &a) const;
+  // returns 0 if fields must not be grouped
+  virtual int get_max_fixed_fields_length() const;
+  // checked_length is the total length of the group for the first field of the group and 0 for other fields
+  virtual std::string gen_fixed_field_fetch(int field_num, const arg &a, int parser_type, int checked_length) const;
   virtual std::string gen_field_store(const arg &a, std::vector<var_description> &vars, bool flat,
                                       int storer_type) const = 0;
   virtual std::string gen_type_fetch(const std::string &field_name, const tl_tree_type *tree_type,
@@ -80,6 +80,15 @@ Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_std
           }
         };
 
+        // all log lines available at once are written with a single system call
+        string batch;
+        auto flush_batch = [&] {
+          if (!batch.empty()) {
+            append(batch);
+            batch.clear();
+          }
+        };
+
         while (true) {
           int ready_count = queue->reader_wait_nonblock();
           if (ready_count == 0) {
@@ -91,9 +100,17 @@ Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_std
             Query query = queue->reader_get_unsafe();
             switch (query.type_) {
               case Query::Type::Log:
-                append(query.data_);
+                if (batch.empty()) {
+                  batch = std::move(query.data_);
+                } else {
+                  batch += query.data_;
+                }
+                if (batch.size() >= MAX_BATCH_SIZE) {
+                  flush_batch();
+                }
                 break;
               case Query::Type::AfterRotation:
+                flush_batch();
                 after_rotation();
                 break;
               case Query::Type::Close:
@@ -103,6 +120,7 @@ Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_std
                 process_fatal_error("Invalid query type in AsyncFileLog");
             }
           }
+          flush_batch();
           queue->reader_flush();
 
           if (need_close) {
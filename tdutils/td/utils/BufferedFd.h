@@ -48,9 +48,25 @@ class BufferedFdBase : public FdT {
     write_ = write;
   }
 
+  // expected number of bytes to be read soon; used to allocate input buffer chunks of a suitable size
+  void set_read_size_hint(size_t read_size_hint) {
+    read_size_hint_ = read_size_hint;
+  }
+
+  // number of read and write system calls made through the object
+  uint64 get_read_syscall_count() const {
+    return read_syscall_count_;
+  }
+  uint64 get_write_syscall_count() const {
+    return write_syscall_count_;
+  }
+
  private:
   ChainBufferWriter *read_ = nullptr;
   ChainBufferReader *write_ = nullptr;
+  size_t read_size_hint_ = 0;
+  uint64 read_syscall_count_ = 0;
+  uint64 write_syscall_count_ = 0;
 };
 
 template <class FdT>
@@ -101,13 +117,15 @@ Result<size_t> BufferedFdBase<FdT>::flush_read(size_t max_read) {
   CHECK(read_);
   size_t result = 0;
   while (::td::can_read_local(*this) && max_read) {
-    MutableSlice slice = read_->prepare_append();
+    MutableSlice slice = read_->prepare_append(read_size_hint_);
     slice.truncate(max_read);
+    read_syscall_count_++;
     TRY_RESULT(x, FdT::read(slice));
     slice.truncate(x);
     read_->confirm_append(x);
     result += x;
     max_read -= x;
+    read_size_hint_ -= min(read_size_hint_, x);
   }
   return result;
 }
@@ -117,13 +135,15 @@ Result<size_t> BufferedFdBase<FdT>::flush_write() {
   // TODO: sync on demand
   write_->sync_with_writer();
   size_t result = 0;
+  if (write_->empty()) {
+    return result;
+  }
+  // gather as many buffer chunks as possible to send many small packets with a single system call
+  IoSlice buf[MAX_IO_SLICE_COUNT];
   while (!write_->empty() && ::td::can_write_local(*this)) {
-    constexpr size_t BUF_SIZE = 20;
-    IoSlice buf[BUF_SIZE];
-
     auto it = write_->clone();
     size_t buf_i;
-    for (buf_i = 0; buf_i < BUF_SIZE; buf_i++) {
+    for (buf_i = 0; buf_i < MAX_IO_SLICE_COUNT; buf_i++) {
       Slice slice = it.prepare_read();
       if (slice.empty()) {
         break;
@@ -131,6 +151,7 @@ Result<size_t> BufferedFdBase<FdT>::flush_write() {
       buf[buf_i] = as_io_slice(slice);
       it.confirm_read(slice.size());
     }
+    write_syscall_count_++;
     TRY_RESULT(x, FdT::writev(Span<IoSlice>(buf, buf_i)));
     write_->advance(x);
     result += x;
@@ -169,7 +190,7 @@ BufferedFd<FdT>::BufferedFd(BufferedFd &&from) noexcept {
 
 template <class FdT>
 BufferedFd<FdT> &BufferedFd<FdT>::operator=(BufferedFd &&from) noexcept {
-  FdT::operator=(std::move(static_cast<FdT &>(from)));
+  Parent::operator=(std::move(static_cast<Parent &>(from)));
   input_reader_ = std::move(from.input_reader_);
   input_writer_ = std::move(from.input_writer_);
   output_reader_ = std::move(from.output_reader_);
@@ -18,8 +18,9 @@
 #include "td/utils/StringBuilder.h"
 #include "td/utils/VectorQueue.h"
 
-#include <functional>
 #include <unordered_map>
+#include <utility>
+
 
 namespace td {
 
@@ -110,13 +111,15 @@ class ChainScheduler final : public ChainSchedulerBase {
       return head_.empty();
     }
 
-    void foreach(std::function<void(TaskId, uint64)> f) const {
+    template <class F>
+    void foreach(F &&f) const {
       for (auto it = head_.begin(); it != head_.end(); it = it->get_next()) {
         auto &node = static_cast<const ChainNode &>(*it);
         f(node.task_id, node.generation);
       }
     }
-    void foreach_child(ListNode *start_node, std::function<void(TaskId, uint64)> f) const {
+    template <class F>
+    void foreach_child(ListNode *start_node, F &&f) const {
       for (auto it = start_node; it != head_.end(); it = it->get_next()) {
         auto &node = static_cast<const ChainNode &>(*it);
         f(node.task_id, node.generation);
@@ -130,6 +133,7 @@ class ChainScheduler final : public ChainSchedulerBase {
     Chain chain;
     uint32 active_tasks{};
     uint64 generation{1};
+    TaskId limited_task_id{};  // a pending task, which wasn't started because of too many active tasks in the chain
   };
   struct TaskChainInfo {
     ChainNode chain_node;
@@ -142,7 +146,6 @@ class ChainScheduler final : public ChainSchedulerBase {
     ExtraT extra;
   };
   std::unordered_map<ChainId, ChainInfo, Hash<ChainId>> chains_;
-  std::unordered_map<ChainId, TaskId, Hash<ChainId>> limited_tasks_;
   Container<Task> tasks_;
   VectorQueue<TaskId> pending_tasks_;
 
@@ -162,7 +165,7 @@ class ChainScheduler final : public ChainSchedulerBase {
       }
 
       if (task_chain_info.chain_info->active_tasks >= 10) {
-        limited_tasks_[task_chain_info.chain_id] = task_id;
+        task_chain_info.chain_info->limited_task_id = task_id;
         return;
       }
     }
@@ -172,7 +175,7 @@ class ChainScheduler final : public ChainSchedulerBase {
 
   void do_start_task(TaskId task_id, Task *task) {
     for (TaskChainInfo &task_chain_info : task->chains) {
-      ChainInfo &chain_info = chains_[task_chain_info.chain_id];
+      ChainInfo &chain_info = *task_chain_info.chain_info;
       chain_info.active_tasks++;
       task_chain_info.chain_node.generation = chain_info.generation;
     }
@@ -208,10 +211,9 @@ class ChainScheduler final : public ChainSchedulerBase {
         chain_info.generation = td::max(chain_info.generation, task_chain_info.chain_node.generation + 1);
       }
 
-      auto it = limited_tasks_.find(task_chain_info.chain_id);
-      if (it != limited_tasks_.end()) {
-        auto limited_task_id = it->second;
-        limited_tasks_.erase(it);
+      if (chain_info.limited_task_id != 0) {
+        auto limited_task_id = chain_info.limited_task_id;
+        chain_info.limited_task_id = 0;
         if (limited_task_id != task_id) {
           try_start_task_later(limited_task_id);
         }
@@ -230,12 +232,16 @@ class ChainScheduler final : public ChainSchedulerBase {
   void finish_chain_task(TaskChainInfo &task_chain_info) {
     auto &chain = task_chain_info.chain_info->chain;
     chain.finish_task(&task_chain_info.chain_node);
+    if (task_chain_info.chain_info->limited_task_id == task_chain_info.chain_node.task_id) {
+      task_chain_info.chain_info->limited_task_id = 0;
+    }
     if (chain.empty()) {
       chains_.erase(task_chain_info.chain_id);
     }
   }
 
   vector<TaskId> to_start_;
+  vector<TaskId> starting_;  // reused to avoid a memory allocation for each finished task
 
   void try_start_task_later(TaskId task_id) {
     LOG(DEBUG) << "Start later " << task_id;
@@ -243,10 +249,12 @@ class ChainScheduler final : public ChainSchedulerBase {
   }
 
   void flush_try_start_task() {
-    auto moved_to_start = std::move(to_start_);
-    for (auto task_id : moved_to_start) {
+    CHECK(starting_.empty());
+    std::swap(starting_, to_start_);
+    for (auto task_id : starting_) {
       try_start_task(task_id);
     }
+    starting_.clear();
     CHECK(to_start_.empty());
   }
 
@@ -262,7 +262,9 @@ class FlatHashTableChunks {
     }
     const auto hash = calc_hash(key);
     auto chunk_it = get_chunk_it(hash.chunk_i);
-    while (true) {
+    // all chunks can have non-zero skipped_cnt in a small table, so the probe sequence must be bounded;
+    // it visits every chunk in chunks_.size() steps, because number of chunks is a power of two
+    for (auto left_chunks = chunks_.size(); left_chunks > 0; left_chunks--) {
       auto chunk_i = chunk_it.pos();
       auto chunk_begin = nodes_.begin() + chunk_i * Chunk::CHUNK_SIZE;
       //__builtin_prefetch(chunk_begin);
@@ -6,8 +6,13 @@
 //
 #pragma once
 
-//#include "td/utils/FlatHashMapChunks.h"
+#include "td/utils/config.h"
+
+#if TD_FLAT_HASH_TABLE_CHUNKS
+#include "td/utils/FlatHashMapChunks.h"
+#else
 #include "td/utils/FlatHashTable.h"
+#endif
 #include "td/utils/HashTableUtils.h"
 #include "td/utils/SetNode.h"
 
@@ -16,9 +21,13 @@
 
 namespace td {
 
+#if TD_FLAT_HASH_TABLE_CHUNKS
+template <class KeyT, class HashT = Hash<KeyT>, class EqT = std::equal_to<KeyT>>
+using FlatHashSet = FlatHashSetChunks<KeyT, HashT, EqT>;
+#else
 template <class KeyT, class HashT = Hash<KeyT>, class EqT = std::equal_to<KeyT>>
 using FlatHashSet = FlatHashTable<SetNode<KeyT>, HashT, EqT>;
-//using FlatHashSet = FlatHashSetChunks<KeyT, HashT, EqT>;
+#endif
 //using FlatHashSet = std::unordered_set<KeyT, HashT, EqT>;
 
 }  // namespace td
@@ -9,6 +9,7 @@
 char disable_linker_warning_about_empty_file_gzip_cpp TD_UNUSED;
 
 #if TD_HAVE_ZLIB
+#include "td/utils/port/thread_local.h"
 #include "td/utils/SliceBuilder.h"
 
 #include <cstring>
@@ -54,6 +55,24 @@ Status Gzip::init_decode() {
   return Status::OK();
 }
 
+Status Gzip::reinit(Mode mode) {
+  if (mode_ == mode && mode != Mode::Empty) {
+    int ret = mode == Mode::Decode ? inflateReset(&impl_->stream_) : deflateReset(&impl_->stream_);
+    if (ret == Z_OK) {
+      impl_->stream_.avail_in = 0;
+      impl_->stream_.next_in = nullptr;
+      impl_->stream_.avail_out = 0;
+      impl_->stream_.next_out = nullptr;
+      input_size_ = 0;
+      output_size_ = 0;
+      close_input_flag_ = false;
+      return Status::OK();
+    }
+  }
+  clear();
+  return init(mode);
+}
+
 void Gzip::set_input(Slice input) {
   CHECK(input_size_ == 0);
   CHECK(!close_input_flag_);
@@ -87,7 +106,9 @@ Result<Gzip::State> Gzip::run() {
     }
     if (ret == Z_STREAM_END) {
       // TODO(now): fail if input is not empty;
-      clear();
+      if (!is_reusable_) {
+        clear();
+      }
       return State::Done;
     }
     clear();
@@ -147,6 +168,7 @@ void Gzip::swap(Gzip &other) {
   swap(input_size_, other.input_size_);
   swap(output_size_, other.output_size_);
   swap(close_input_flag_, other.close_input_flag_);
+  swap(is_reusable_, other.is_reusable_);
   swap(mode_, other.mode_);
 }
 
@@ -154,14 +176,41 @@ Gzip::~Gzip() {
   clear();
 }
 
+static Gzip &get_thread_gzip(Gzip::Mode mode) {
+  static TD_THREAD_LOCAL Gzip *decoder;
+  static TD_THREAD_LOCAL Gzip *encoder;
+  auto &gzip = mode == Gzip::Mode::Decode ? decoder : encoder;
+  if (init_thread_local<Gzip>(gzip)) {
+    gzip->set_reusable(true);
+  }
+  gzip->reinit(mode).ensure();
+  return *gzip;
+}
+
+// returns size of the uncompressed data from gzip trailer or 0 if it is unknown
+static size_t get_gzip_decoded_size(Slice s) {
+  if (s.size() < 18 || s.ubegin()[0] != 0x1f || s.ubegin()[1] != 0x8b) {
+    return 0;
+  }
+  auto trailer = s.ubegin() + s.size() - 4;
+  auto size = static_cast<size_t>(static_cast<uint32>(trailer[0]) | (static_cast<uint32>(trailer[1]) << 8) |
+                                  (static_cast<uint32>(trailer[2]) << 16) | (static_cast<uint32>(trailer[3]) << 24));
+  if (size / 1032 > s.size()) {
+    // deflate can't compress data more than 1032 times, so the trailer is wrong
+    return 0;
+  }
+  return size;
+}
+
 BufferSlice gzdecode(Slice s) {
-  Gzip gzip;
-  gzip.init_decode().ensure();
+  auto &gzip = get_thread_gzip(Gzip::Mode::Decode);
   ChainBufferWriter message;
   gzip.set_input(s);
   gzip.close_input();
   double k = 2;
-  gzip.set_output(message.prepare_append(static_cast<size_t>(static_cast<double>(s.size()) * k)));
+  auto decoded_size = get_gzip_decoded_size(s);
+  gzip.set_output(message.prepare_append(decoded_size != 0 ? decoded_size + 1
+                                                           : static_cast<size_t>(static_cast<double>(s.size()) * k)));
   while (true) {
     auto r_state = gzip.run();
     if (r_state.is_error()) {
@@ -185,8 +234,7 @@ BufferSlice gzdecode(Slice s) {
 }
 
 BufferSlice gzencode(Slice s, double max_compression_ratio) {
-  Gzip gzip;
-  gzip.init_encode().ensure();
+  auto &gzip = get_thread_gzip(Gzip::Mode::Encode);
   gzip.set_input(s);
   gzip.close_input();
   auto max_size = static_cast<size_t>(static_cast<double>(s.size()) * max_compression_ratio);
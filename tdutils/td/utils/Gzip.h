@@ -39,6 +39,14 @@ class Gzip {
 
   Status init_decode() TD_WARN_UNUSED_RESULT;
 
+  // starts a new stream in the given mode, reusing zlib state of the previous stream in the same mode if possible
+  Status reinit(Mode mode) TD_WARN_UNUSED_RESULT;
+
+  // if set, zlib state isn't freed after the end of a stream, so it can be reused by reinit
+  void set_reusable(bool is_reusable) {
+    is_reusable_ = is_reusable;
+  }
+
   void set_input(Slice input);
 
   void set_output(MutableSlice output);
@@ -89,6 +97,7 @@ class Gzip {
   size_t input_size_ = 0;
   size_t output_size_ = 0;
   bool close_input_flag_ = false;
+  bool is_reusable_ = false;
   Mode mode_ = Mode::Empty;
 
   void init_common();
@@ -97,6 +106,7 @@ class Gzip {
   void swap(Gzip &other);
 };
 
+// uses per-thread zlib state; the whole result is decoded into a single buffer if the size is known from gzip trailer
 BufferSlice gzdecode(Slice s);
 
 BufferSlice gzencode(Slice s, double max_compression_ratio);
@@ -14,6 +14,7 @@
 #include "td/utils/utf8.h"
 
 #include <algorithm>
+#include <limits>
 
 namespace td {
 
@@ -40,25 +41,112 @@ vector<string> Hints::get_words(Slice name) {
   return fix_words(utf8_get_search_words(name));
 }
 
-void Hints::add_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys) {
-  vector<KeyT> &keys = word_to_keys[word];
+void Hints::WordIndex::add(const string &word, KeyT key) {
+  auto deleted_it = deleted_words_.find(std::make_pair(word, key));
+  if (deleted_it != deleted_words_.end()) {
+    // the word is still in words_
+    deleted_words_.erase(deleted_it);
+    return;
+  }
+
+  vector<KeyT> &keys = added_words_[word];
   CHECK(!td::contains(keys, key));
   keys.push_back(key);
+  added_word_count_++;
+  merge_changes_if_needed();
 }
 
-void Hints::delete_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys) {
-  vector<KeyT> &keys = word_to_keys[word];
-  auto key_it = std::find(keys.begin(), keys.end(), key);
-  CHECK(key_it != keys.end());
-  if (keys.size() == 1) {
-    word_to_keys.erase(word);
-  } else {
-    CHECK(keys.size() > 1);
-    *key_it = keys.back();
-    keys.pop_back();
+void Hints::WordIndex::remove(const string &word, KeyT key) {
+  auto it = added_words_.find(word);
+  if (it != added_words_.end()) {
+    auto &keys = it->second;
+    auto key_it = std::find(keys.begin(), keys.end(), key);
+    if (key_it != keys.end()) {
+      *key_it = keys.back();
+      keys.pop_back();
+      if (keys.empty()) {
+        added_words_.erase(it);
+      }
+      added_word_count_--;
+      return;
+    }
+  }
+
+  auto word_key = std::make_pair(word, key);
+  CHECK(std::binary_search(words_.begin(), words_.end(), word_key));
+  auto is_inserted = deleted_words_.insert(std::move(word_key)).second;
+  CHECK(is_inserted);
+  merge_changes_if_needed();
+}
+
+void Hints::WordIndex::add_search_results(vector<KeyT> &results, const string &prefix) const {
+  LOG(DEBUG) << "Search for word " << prefix;
+  auto it = std::lower_bound(words_.begin(), words_.end(), prefix,
+                             [](const std::pair<string, KeyT> &lhs, const string &rhs) { return lhs.first < rhs; });
+  auto deleted_it = deleted_words_.lower_bound(std::make_pair(prefix, std::numeric_limits<KeyT>::min()));
+  for (; it != words_.end() && begins_with(it->first, prefix); ++it) {
+    // both deleted_words_ and words_ are sorted, so deleted words can be skipped in one pass
+    while (deleted_it != deleted_words_.end() && *deleted_it < *it) {
+      ++deleted_it;
+    }
+    if (deleted_it != deleted_words_.end() && *deleted_it == *it) {
+      ++deleted_it;
+      continue;
+    }
+    results.push_back(it->second);
+  }
+
+  auto added_it = added_words_.lower_bound(prefix);
+  while (added_it != added_words_.end() && begins_with(added_it->first, prefix)) {
+    results.insert(results.end(), added_it->second.begin(), added_it->second.end());
+    ++added_it;
   }
 }
 
+void Hints::WordIndex::merge_changes_if_needed() {
+  if (added_word_count_ + deleted_words_.size() > max(MIN_MERGED_CHANGE_COUNT, words_.size() / 8)) {
+    merge_changes();
+  }
+}
+
+void Hints::WordIndex::merge_changes() {
+  vector<std::pair<string, KeyT>> added_words;
+  added_words.reserve(added_word_count_);
+  for (auto &it : added_words_) {
+    for (auto key : it.second) {
+      added_words.emplace_back(it.first, key);
+    }
+  }
+  std::sort(added_words.begin(), added_words.end());
+  CHECK(added_words.size() == added_word_count_);
+  CHECK(words_.size() >= deleted_words_.size());
+
+  vector<std::pair<string, KeyT>> new_words;
+  new_words.reserve(words_.size() - deleted_words_.size() + added_words.size());
+  auto deleted_it = deleted_words_.begin();
+  auto added_it = added_words.begin();
+  for (auto &word : words_) {
+    if (deleted_it != deleted_words_.end() && *deleted_it == word) {
+      ++deleted_it;
+      continue;
+    }
+    while (added_it != added_words.end() && *added_it < word) {
+      new_words.push_back(std::move(*added_it));
+      ++added_it;
+    }
+    new_words.push_back(std::move(word));
+  }
+  CHECK(deleted_it == deleted_words_.end());
+  for (; added_it != added_words.end(); ++added_it) {
+    new_words.push_back(std::move(*added_it));
+  }
+
+  words_ = std::move(new_words);
+  added_words_.clear();
+  added_word_count_ = 0;
+  deleted_words_.clear();
+}
+
 void Hints::add(KeyT key, Slice name) {
   // LOG(ERROR) << "Add " << key << ": " << name;
   auto it = key_to_name_.find(key);
@@ -68,7 +156,7 @@ void Hints::add(KeyT key, Slice name) {
     }
     vector<string> old_transliterations;
     for (auto &old_word : get_words(it->second)) {
-      delete_word(old_word, key, word_to_keys_);
+      word_to_keys_.remove(old_word, key);
 
       for (auto &w : get_word_transliterations(old_word, false)) {
         if (w != old_word) {
@@ -77,7 +165,7 @@ void Hints::add(KeyT key, Slice name) {
       }
     }
     for (auto &word : fix_words(old_transliterations)) {
-      delete_word(word, key, translit_word_to_keys_);
+      translit_word_to_keys_.remove(word, key);
     }
   }
   if (name.empty()) {
@@ -90,7 +178,7 @@ void Hints::add(KeyT key, Slice name) {
 
   vector<string> transliterations;
   for (auto &word : get_words(name)) {
-    add_word(word, key, word_to_keys_);
+    word_to_keys_.add(word, key);
 
     for (auto &w : get_word_transliterations(word, false)) {
       if (w != word) {
@@ -99,7 +187,7 @@ void Hints::add(KeyT key, Slice name) {
     }
   }
   for (auto &word : fix_words(transliterations)) {
-    add_word(word, key, translit_word_to_keys_);
+    translit_word_to_keys_.add(word, key);
   }
 
   key_to_name_[key] = name.str();
@@ -110,21 +198,11 @@ void Hints::set_rating(KeyT key, RatingT rating) {
   key_to_rating_[key] = rating;
 }
 
-void Hints::add_search_results(vector<KeyT> &results, const string &word,
-                               const std::map<string, vector<KeyT>> &word_to_keys) {
-  LOG(DEBUG) << "Search for word " << word;
-  auto it = word_to_keys.lower_bound(word);
-  while (it != word_to_keys.end() && begins_with(it->first, word)) {
-    results.insert(results.end(), it->second.begin(), it->second.end());
-    ++it;
-  }
-}
-
 vector<Hints::KeyT> Hints::search_word(const string &word) const {
   vector<KeyT> results;
-  add_search_results(results, word, translit_word_to_keys_);
+  translit_word_to_keys_.add_search_results(results, word);
   for (const auto &w : get_word_transliterations(word, true)) {
-    add_search_results(results, w, word_to_keys_);
+    word_to_keys_.add_search_results(results, w);
   }
 
   td::unique(results);
@@ -172,17 +250,35 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, b
     results.resize(new_results_size);
   }
 
+  // sort by rating, which is found once for every key
   auto total_size = results.size();
+  vector<std::pair<RatingT, KeyT>> rated_results;
+  rated_results.reserve(total_size);
+  for (auto key : results) {
+    rated_results.emplace_back(get_rating(key), key);
+  }
   if (total_size < static_cast<size_t>(limit)) {
-    std::sort(results.begin(), results.end(), CompareByRating(key_to_rating_));
+    std::sort(rated_results.begin(), rated_results.end());
   } else {
-    std::partial_sort(results.begin(), results.begin() + limit, results.end(), CompareByRating(key_to_rating_));
-    results.resize(limit);
+    std::partial_sort(rated_results.begin(), rated_results.begin() + limit, rated_results.end());
+    rated_results.resize(limit);
   }
 
+  results.resize(rated_results.size());
+  for (size_t i = 0; i < rated_results.size(); i++) {
+    results[i] = rated_results[i].second;
+  }
   return {total_size, std::move(results)};
 }
 
+Hints::RatingT Hints::get_rating(KeyT key) const {
+  auto it = key_to_rating_.find(key);
+  if (it == key_to_rating_.end()) {
+    return RatingT();
+  }
+  return it->second;
+}
+
 bool Hints::has_key(KeyT key) const {
   return key_to_name_.count(key) > 0;
 }
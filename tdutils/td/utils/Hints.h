@@ -11,6 +11,7 @@
 #include "td/utils/Slice.h"
 
 #include <map>
+#include <set>
 #include <unordered_map>
 #include <utility>
 
@@ -45,43 +46,42 @@ class Hints {
   static vector<string> fix_words(vector<string> words);
 
  private:
-  std::map<string, vector<KeyT>> word_to_keys_;
-  std::map<string, vector<KeyT>> translit_word_to_keys_;
-  std::unordered_map<KeyT, string, Hash<KeyT>> key_to_name_;
-  std::unordered_map<KeyT, RatingT, Hash<KeyT>> key_to_rating_;
+  // sorted array of pairs (word, key) with recent changes kept aside until they are merged into the array
+  class WordIndex {
+   public:
+    void add(const string &word, KeyT key);
 
-  static void add_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys);
-  static void delete_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys);
+    void remove(const string &word, KeyT key);
 
-  static vector<string> get_words(Slice name);
+    void add_search_results(vector<KeyT> &results, const string &prefix) const;
 
-  static void add_search_results(vector<KeyT> &results, const string &word,
-                                 const std::map<string, vector<KeyT>> &word_to_keys);
+   private:
+    static constexpr size_t MIN_MERGED_CHANGE_COUNT = 1000;
 
-  vector<KeyT> search_word(const string &word) const;
+    vector<std::pair<string, KeyT>> words_;
 
-  class CompareByRating {
-    const std::unordered_map<KeyT, RatingT, Hash<KeyT>> &key_to_rating_;
+    // recently added words, which aren't in words_
+    std::map<string, vector<KeyT>> added_words_;
+    size_t added_word_count_ = 0;
 
-    RatingT get_rating(const KeyT &key) const {
-      auto it = key_to_rating_.find(key);
-      if (it == key_to_rating_.end()) {
-        return RatingT();
-      }
-      return it->second;
-    }
+    // recently deleted words, which are still in words_
+    std::set<std::pair<string, KeyT>> deleted_words_;
 
-   public:
-    explicit CompareByRating(const std::unordered_map<KeyT, RatingT, Hash<KeyT>> &key_to_rating)
-        : key_to_rating_(key_to_rating) {
-    }
-
-    bool operator()(const KeyT &lhs, const KeyT &rhs) const {
-      auto lhs_rating = get_rating(lhs);
-      auto rhs_rating = get_rating(rhs);
-      return lhs_rating < rhs_rating || (lhs_rating == rhs_rating && lhs < rhs);
-    }
+    void merge_changes_if_needed();
+
+    void merge_changes();
   };
+
+  WordIndex word_to_keys_;
+  WordIndex translit_word_to_keys_;
+  std::unordered_map<KeyT, string, Hash<KeyT>> key_to_name_;
+  std::unordered_map<KeyT, RatingT, Hash<KeyT>> key_to_rating_;
+
+  static vector<string> get_words(Slice name);
+
+  vector<KeyT> search_word(const string &word) const;
+
+  RatingT get_rating(KeyT key) const;
 };
 
 }  // namespace td
@@ -6,14 +6,77 @@
 //
 #include "td/utils/JsonBuilder.h"
 
+#include "td/utils/bits.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
 
 #include <cstring>
 
+#if defined(__SSE2__) || (TD_MSVC && (defined(_M_X64) || (defined(_M_IX86) && _M_IX86_FP >= 2)))
+#define TD_SSE2 1
+#endif
+
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
+#if TD_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace td {
 
+// returns pointer to the first '"' or '\\' in [begin, end) or end if there are no such characters
+static const char *json_find_quote_or_backslash(const char *begin, const char *end) {
+#if TD_SSE2
+  const auto quotes = _mm_set1_epi8('"');
+  const auto backslashes = _mm_set1_epi8('\\');
+  while (end - begin >= 16) {
+    auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+    auto mask = static_cast<uint32>(
+        _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, quotes), _mm_cmpeq_epi8(chars, backslashes))));
+    if (mask != 0) {
+      return begin + count_trailing_zeroes_non_zero32(mask);
+    }
+    begin += 16;
+  }
+#elif defined(__aarch64__)
+  const auto quotes = vdupq_n_u8('"');
+  const auto backslashes = vdupq_n_u8('\\');
+  while (end - begin >= 16) {
+    auto chars = vld1q_u8(reinterpret_cast<const uint8_t *>(begin));
+    auto matches = vorrq_u8(vceqq_u8(chars, quotes), vceqq_u8(chars, backslashes));
+    // each character is represented by 4 bits of the mask
+    auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+    if (mask != 0) {
+      return begin + count_trailing_zeroes_non_zero64(mask) / 4;
+    }
+    begin += 16;
+  }
+#endif
+  while (begin < end && *begin != '"' && *begin != '\\') {
+    begin++;
+  }
+  return begin;
+}
+
+// finds the closing '"' of a string, which begins at begin, and returns whether the string has escaped characters
+static const char *json_find_string_end(const char *begin, const char *end, bool &has_escapes) {
+  has_escapes = false;
+  while (true) {
+    begin = json_find_quote_or_backslash(begin, end);
+    if (begin == end || *begin == '"') {
+      return begin;
+    }
+    has_escapes = true;
+    if (end - begin <= 2) {
+      return end;
+    }
+    begin += 2;
+  }
+}
+
 StringBuilder &operator<<(StringBuilder &sb, const JsonRawString &val) {
   sb << '"';
   SCOPE_EXIT {
@@ -142,17 +205,15 @@ Result<MutableSlice> json_string_decode(Parser &parser) {
   }
   auto *cur_src = parser.data().data();
   auto *end_src = parser.data().end();
-  auto *end = cur_src;
-  while (end < end_src && end[0] != '"') {
-    if (end[0] == '\\') {
-      end++;
-    }
-    end++;
-  }
+  bool has_escapes;
+  auto *end = cur_src + (json_find_string_end(cur_src, end_src, has_escapes) - cur_src);
   if (end >= end_src) {
     return Status::Error("Closing '\"' not found");
   }
   parser.advance(end + 1 - cur_src);
+  if (!has_escapes) {
+    return MutableSlice(cur_src, end);
+  }
   end_src = end;
 
   auto *cur_dest = cur_src;
@@ -261,17 +322,15 @@ Status json_string_skip(Parser &parser) {
   auto *begin_src = parser.data().data();
   auto *cur_src = begin_src;
   auto *end_src = parser.data().end();
-  auto *end = cur_src;
-  while (end < end_src && *end != '"') {
-    if (*end == '\\') {
-      end++;
-    }
-    end++;
-  }
+  bool has_escapes;
+  auto *end = cur_src + (json_find_string_end(cur_src, end_src, has_escapes) - cur_src);
   if (end >= end_src) {
     return Status::Error("Closing '\"' not found");
   }
   parser.advance(end + 1 - cur_src);
+  if (!has_escapes) {
+    return Status::OK();
+  }
   end_src = end;
 
   while (cur_src != end_src) {
@@ -0,0 +1,128 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/LockStatistics.h"
+
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Slice.h"
+#include "td/utils/ThreadLocalStorage.h"
+#include "td/utils/Time.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+namespace td {
+
+namespace {
+
+// the statistics must not be protected by instrumented locks
+struct ThreadLockStatistics {
+  std::mutex mutex;
+  FlatHashMap<const char *, LockStatistics::Entry> exclusive_entries;
+  FlatHashMap<const char *, LockStatistics::Entry> shared_entries;
+
+  LockStatistics::Entry &get_entry(const char *name, bool is_shared) {
+    return is_shared ? shared_entries[name] : exclusive_entries[name];
+  }
+};
+
+ThreadLocalStorage<ThreadLockStatistics> &get_thread_lock_statistics() {
+  static ThreadLocalStorage<ThreadLockStatistics> statistics;
+  return statistics;
+}
+
+void add_to_histogram(LockStatistics::Histogram &histogram, double duration) {
+  size_t pos = 0;
+  double max_duration = 1e-6;
+  while (pos + 1 < histogram.size() && duration >= max_duration) {
+    pos++;
+    max_duration *= 2;
+  }
+  histogram[pos]++;
+}
+
+}  // namespace
+
+std::atomic<bool> LockStatistics::is_enabled_{false};
+
+void LockStatistics::set_enabled(bool is_enabled) {
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+double LockStatistics::now() {
+  return Time::now();
+}
+
+LockStatistics::Holder LockStatistics::on_lock(const char *name, bool is_shared, double wait_start_time) {
+  auto lock_time = Time::now();
+  auto &statistics = get_thread_lock_statistics().get();
+  std::lock_guard<std::mutex> lock(statistics.mutex);
+  auto &entry = statistics.get_entry(name, is_shared);
+  entry.lock_count++;
+  if (wait_start_time >= 0) {
+    auto wait_time = lock_time - wait_start_time;
+    entry.contended_lock_count++;
+    entry.total_wait_time += wait_time;
+    add_to_histogram(entry.wait_time, wait_time);
+  }
+  return Holder(name, is_shared, lock_time);
+}
+
+void LockStatistics::on_unlock(const char *name, bool is_shared, double lock_time) {
+  auto hold_time = Time::now() - lock_time;
+  auto &statistics = get_thread_lock_statistics().get();
+  std::lock_guard<std::mutex> lock(statistics.mutex);
+  add_to_histogram(statistics.get_entry(name, is_shared).hold_time, hold_time);
+}
+
+vector<LockStatistics::Entry> LockStatistics::get_statistics() {
+  // locks with the same name can be declared in different translation units, so merge entries by name
+  FlatHashMap<string, Entry> entries[2];
+  auto merge = [&entries](const FlatHashMap<const char *, Entry> &thread_entries, bool is_shared) {
+    for (auto &it : thread_entries) {
+      auto &entry = entries[is_shared][Slice(it.first).str()];
+      entry.lock_count += it.second.lock_count;
+      entry.contended_lock_count += it.second.contended_lock_count;
+      entry.total_wait_time += it.second.total_wait_time;
+      for (size_t i = 0; i < HISTOGRAM_SIZE; i++) {
+        entry.wait_time[i] += it.second.wait_time[i];
+        entry.hold_time[i] += it.second.hold_time[i];
+      }
+    }
+  };
+  get_thread_lock_statistics().for_each([&merge](ThreadLockStatistics &statistics) {
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    merge(statistics.exclusive_entries, false);
+    merge(statistics.shared_entries, true);
+  });
+
+  vector<Entry> result;
+  for (int is_shared = 0; is_shared < 2; is_shared++) {
+    for (auto &it : entries[is_shared]) {
+      it.second.name = it.first;
+      it.second.is_shared = is_shared != 0;
+      result.push_back(std::move(it.second));
+    }
+  }
+  std::sort(result.begin(), result.end(), [](const Entry &lhs, const Entry &rhs) {
+    if (lhs.total_wait_time != rhs.total_wait_time) {
+      return lhs.total_wait_time > rhs.total_wait_time;
+    }
+    return lhs.lock_count > rhs.lock_count;
+  });
+  return result;
+}
+
+void LockStatistics::clear() {
+  get_thread_lock_statistics().for_each([](ThreadLockStatistics &statistics) {
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    statistics.exclusive_entries.clear();
+    statistics.shared_entries.clear();
+  });
+}
+
+}  // namespace td
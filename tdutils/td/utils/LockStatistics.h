@@ -0,0 +1,97 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <array>
+#include <atomic>
+
+namespace td {
+
+// Collects statistics about waiting for and holding of Mutex, RwMutex and SpinLock, grouped by lock name
+// Collection is disabled by default and costs a relaxed atomic load per lock acquisition when disabled
+class LockStatistics {
+ public:
+  static constexpr size_t HISTOGRAM_SIZE = 24;
+
+  // i-th element contains number of durations in [2^(i-1), 2^i) microseconds
+  // the first element contains number of durations less than 1 microsecond, the last element contains all longer durations
+  using Histogram = std::array<uint64, HISTOGRAM_SIZE>;
+
+  struct Entry {
+    string name;
+    bool is_shared = false;
+    uint64 lock_count = 0;
+    uint64 contended_lock_count = 0;
+    double total_wait_time = 0.0;
+    Histogram wait_time{};
+    Histogram hold_time{};
+  };
+
+  // records hold time of an acquired lock on destruction
+  class Holder {
+   public:
+    Holder() = default;
+    Holder(const char *name, bool is_shared, double lock_time)
+        : name_(name), is_shared_(is_shared), lock_time_(lock_time) {
+    }
+    Holder(const Holder &) = delete;
+    Holder &operator=(const Holder &) = delete;
+    Holder(Holder &&other) noexcept : name_(other.name_), is_shared_(other.is_shared_), lock_time_(other.lock_time_) {
+      other.name_ = nullptr;
+    }
+    Holder &operator=(Holder &&other) noexcept {
+      if (this != &other) {
+        reset();
+        name_ = other.name_;
+        is_shared_ = other.is_shared_;
+        lock_time_ = other.lock_time_;
+        other.name_ = nullptr;
+      }
+      return *this;
+    }
+    ~Holder() {
+      reset();
+    }
+
+    void reset() {
+      if (name_ != nullptr) {
+        on_unlock(name_, is_shared_, lock_time_);
+        name_ = nullptr;
+      }
+    }
+
+   private:
+    const char *name_ = nullptr;
+    bool is_shared_ = false;
+    double lock_time_ = 0.0;
+  };
+
+  static void set_enabled(bool is_enabled);
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  static double now();
+
+  // must be called just after the lock is acquired; wait_start_time is negative if the lock wasn't contended
+  static Holder on_lock(const char *name, bool is_shared, double wait_start_time);
+
+  // returns statistics sorted by total wait time in decreasing order
+  static vector<Entry> get_statistics();
+
+  static void clear();
+
+ private:
+  static std::atomic<bool> is_enabled_;
+
+  static void on_unlock(const char *name, bool is_shared, double lock_time);
+};
+
+}  // namespace td
@@ -0,0 +1,123 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/Metrics.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/logging.h"
+#include "td/utils/StackAllocator.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace td {
+
+namespace {
+
+struct MetricList {
+  std::mutex mutex;
+  vector<const Metric *> metrics;
+};
+
+MetricList &get_metric_list() {
+  static MetricList list;
+  return list;
+}
+
+}  // namespace
+
+std::atomic<bool> MetricRegistry::is_enabled_{false};
+
+void MetricRegistry::set_enabled(bool is_enabled) {
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+string MetricRegistry::get_prometheus_text() {
+  auto &list = get_metric_list();
+  std::lock_guard<std::mutex> lock(list.mutex);
+  auto metrics = list.metrics;
+  std::sort(metrics.begin(), metrics.end(),
+            [](const Metric *lhs, const Metric *rhs) { return lhs->get_name() < rhs->get_name(); });
+
+  auto buf = StackAllocator::alloc(1 << 14);
+  StringBuilder sb(buf.as_slice(), true);
+  for (auto metric : metrics) {
+    metric->store(sb);
+  }
+  return sb.as_cslice().str();
+}
+
+Metric::Metric(Slice name, Slice help) : name_(name.str()), help_(help.str()) {
+  auto &list = get_metric_list();
+  std::lock_guard<std::mutex> lock(list.mutex);
+  for (auto metric : list.metrics) {
+    LOG_CHECK(metric->get_name() != name) << "Duplicate metric " << name;
+  }
+  list.metrics.push_back(this);
+}
+
+Metric::~Metric() {
+  auto &list = get_metric_list();
+  std::lock_guard<std::mutex> lock(list.mutex);
+  td::remove(list.metrics, this);
+}
+
+void Metric::store(StringBuilder &sb) const {
+  sb << "# HELP " << name_ << ' ' << help_ << '\n';
+  sb << "# TYPE " << name_ << ' ' << get_type() << '\n';
+  store_values(sb);
+}
+
+void MetricCounter::store_values(StringBuilder &sb) const {
+  sb << get_name() << ' ' << get() << '\n';
+}
+
+void MetricGauge::store_values(StringBuilder &sb) const {
+  sb << get_name() << ' ' << get_value_() << '\n';
+}
+
+MetricHistogram::MetricHistogram(Slice name, Slice help, std::initializer_list<double> bucket_bounds)
+    : Metric(name, help), bucket_bounds_(bucket_bounds) {
+  CHECK(bucket_bounds_.size() <= MAX_BUCKET_COUNT);
+  CHECK(std::is_sorted(bucket_bounds_.begin(), bucket_bounds_.end()));
+}
+
+void MetricHistogram::do_observe(double value) {
+  size_t pos = 0;
+  while (pos < bucket_bounds_.size() && value > bucket_bounds_[pos]) {
+    pos++;
+  }
+  auto &histogram = histograms_.get();
+  histogram.bucket_counts[pos].fetch_add(1, std::memory_order_relaxed);
+
+  // threads without an identifier share the same slot, so the sum must be updated atomically
+  auto sum = histogram.sum.load(std::memory_order_relaxed);
+  while (!histogram.sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+  }
+}
+
+void MetricHistogram::store_values(StringBuilder &sb) const {
+  std::array<uint64, MAX_BUCKET_COUNT + 1> bucket_counts{};
+  double sum = 0.0;
+  histograms_.for_each([&](const ThreadHistogram &histogram) {
+    for (size_t i = 0; i <= bucket_bounds_.size(); i++) {
+      bucket_counts[i] += histogram.bucket_counts[i].load(std::memory_order_relaxed);
+    }
+    sum += histogram.sum.load(std::memory_order_relaxed);
+  });
+
+  uint64 total_count = 0;
+  for (size_t i = 0; i < bucket_bounds_.size(); i++) {
+    total_count += bucket_counts[i];
+    sb << get_name() << "_bucket{le=\"" << bucket_bounds_[i] << "\"} " << total_count << '\n';
+  }
+  total_count += bucket_counts[bucket_bounds_.size()];
+  sb << get_name() << "_bucket{le=\"+Inf\"} " << total_count << '\n';
+  sb << get_name() << "_sum " << sum << '\n';
+  sb << get_name() << "_count " << total_count << '\n';
+}
+
+}  // namespace td
@@ -0,0 +1,142 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/StringBuilder.h"
+#include "td/utils/ThreadLocalStorage.h"
+#include "td/utils/ThreadSafeCounter.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+
+namespace td {
+
+// Process-wide registry of metrics, which can be exported in Prometheus text exposition format
+// Collection is disabled by default and costs a relaxed atomic load per update when disabled
+class MetricRegistry {
+ public:
+  static void set_enabled(bool is_enabled);
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // returns current values of all registered metrics sorted by name
+  static string get_prometheus_text();
+
+ private:
+  static std::atomic<bool> is_enabled_;
+};
+
+// Base class for all metrics. A metric registers itself on creation and unregisters on destruction,
+// so metrics are expected to be objects with static storage duration
+class Metric {
+ public:
+  Metric(Slice name, Slice help);
+  Metric(const Metric &) = delete;
+  Metric &operator=(const Metric &) = delete;
+  Metric(Metric &&) = delete;
+  Metric &operator=(Metric &&) = delete;
+  virtual ~Metric();
+
+  Slice get_name() const {
+    return name_;
+  }
+
+  void store(StringBuilder &sb) const;
+
+ protected:
+  virtual Slice get_type() const = 0;
+
+  virtual void store_values(StringBuilder &sb) const = 0;
+
+ private:
+  string name_;
+  string help_;
+};
+
+// Monotonically increasing value, which is updated without locks in a slot of the current thread
+class MetricCounter final : public Metric {
+ public:
+  MetricCounter(Slice name, Slice help) : Metric(name, help) {
+    counter_.clear();
+  }
+
+  void add(int64 diff = 1) {
+    if (MetricRegistry::is_enabled()) {
+      counter_.add(diff);
+    }
+  }
+
+  int64 get() const {
+    return counter_.sum();
+  }
+
+ private:
+  ThreadSafeCounter counter_;
+
+  Slice get_type() const final {
+    return Slice("counter");
+  }
+
+  void store_values(StringBuilder &sb) const final;
+};
+
+// Value, which is computed by the callback only when metrics are exported
+class MetricGauge final : public Metric {
+ public:
+  MetricGauge(Slice name, Slice help, std::function<double()> get_value)
+      : Metric(name, help), get_value_(std::move(get_value)) {
+  }
+
+ private:
+  std::function<double()> get_value_;
+
+  Slice get_type() const final {
+    return Slice("gauge");
+  }
+
+  void store_values(StringBuilder &sb) const final;
+};
+
+// Distribution of observed values over buckets with the given upper bounds
+class MetricHistogram final : public Metric {
+ public:
+  static constexpr size_t MAX_BUCKET_COUNT = 16;
+
+  MetricHistogram(Slice name, Slice help, std::initializer_list<double> bucket_bounds);
+
+  void observe(double value) {
+    if (MetricRegistry::is_enabled()) {
+      do_observe(value);
+    }
+  }
+
+ private:
+  struct ThreadHistogram {
+    // the last bucket contains values greater than all bounds
+    std::array<std::atomic<uint64>, MAX_BUCKET_COUNT + 1> bucket_counts{};
+    std::atomic<double> sum{0.0};
+  };
+
+  vector<double> bucket_bounds_;
+  ThreadLocalStorage<ThreadHistogram> histograms_;
+
+  void do_observe(double value);
+
+  Slice get_type() const final {
+    return Slice("histogram");
+  }
+
+  void store_values(StringBuilder &sb) const final;
+};
+
+}  // namespace td
@@ -14,6 +14,7 @@
 
 #include "td/utils/port/Mutex.h"
 
+#include <atomic>
 #include <utility>
 
 namespace td {
@@ -40,6 +41,7 @@ class MpscPollableQueue {
         reader_vector_.clear();
         reader_pos_ = 0;
         std::swap(writer_vector_, reader_vector_);
+        has_writer_values_.store(false, std::memory_order_relaxed);
         return narrow_cast<int>(reader_vector_.size());
       }
       event_fd_.acquire();
@@ -55,6 +57,28 @@ class MpscPollableQueue {
   void writer_put(ValueType value) {
     auto guard = lock_.lock();
     writer_vector_.push_back(std::move(value));
+    has_writer_values_.store(true, std::memory_order_relaxed);
+    if (wait_event_fd_) {
+      wait_event_fd_ = false;
+      guard.reset();
+      event_fd_.release();
+    }
+  }
+  // puts all values using one lock acquisition and at most one reader wakeup; values is left empty
+  void writer_put_batch(std::vector<ValueType> &values) {
+    if (values.empty()) {
+      return;
+    }
+    auto guard = lock_.lock();
+    if (writer_vector_.empty()) {
+      std::swap(writer_vector_, values);
+    } else {
+      for (auto &value : values) {
+        writer_vector_.push_back(std::move(value));
+      }
+      values.clear();
+    }
+    has_writer_values_.store(true, std::memory_order_relaxed);
     if (wait_event_fd_) {
       wait_event_fd_ = false;
       guard.reset();
@@ -64,6 +88,27 @@ class MpscPollableQueue {
   EventFd &reader_get_event_fd() {
     return event_fd_;
   }
+  // can be called after reader_wait_nonblock returned 0 to busy-wait for at most spin_count iterations
+  // writers don't release the event fd while the reader spins, so a fast wakeup costs no system calls
+  // returns true if new values are available and reader_wait_nonblock must be called without waiting for the event fd
+  bool reader_spin_wait(int spin_count) {
+    {
+      auto guard = lock_.lock();
+      if (!wait_event_fd_) {
+        // the event fd has already been released
+        return false;
+      }
+      wait_event_fd_ = false;
+    }
+    for (int i = 0; i < spin_count && !has_writer_values_.load(std::memory_order_relaxed); i++) {
+    }
+    auto guard = lock_.lock();
+    if (!writer_vector_.empty()) {
+      return true;
+    }
+    wait_event_fd_ = true;
+    return false;
+  }
   void writer_flush() {
     //nop
   }
@@ -80,6 +125,7 @@ class MpscPollableQueue {
     if (!event_fd_.empty()) {
       event_fd_.close();
       wait_event_fd_ = false;
+      has_writer_values_ = false;
       writer_vector_.clear();
       reader_vector_.clear();
       reader_pos_ = 0;
@@ -96,8 +142,9 @@ class MpscPollableQueue {
   }
 
  private:
-  Mutex lock_;
+  Mutex lock_{"MpscPollableQueue"};
   bool wait_event_fd_{false};
+  std::atomic<bool> has_writer_values_{false};
   EventFd event_fd_;
   std::vector<ValueType> writer_vector_;
   std::vector<ValueType> reader_vector_;
@@ -126,6 +173,11 @@ class MpscPollableQueue {
     UNREACHABLE();
   }
 
+  template <class PutValueType>
+  void writer_put_batch(std::vector<PutValueType> &values) {
+    UNREACHABLE();
+  }
+
   void writer_flush() {
     UNREACHABLE();
   }
@@ -135,6 +187,11 @@ class MpscPollableQueue {
     return 0;
   }
 
+  bool reader_spin_wait(int spin_count) {
+    UNREACHABLE();
+    return false;
+  }
+
   ValueType reader_get_unsafe() {
     UNREACHABLE();
     return ValueType();
@@ -12,6 +12,7 @@
 #include "td/utils/MovableValue.h"
 #include "td/utils/Status.h"
 
+#include <new>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -198,25 +199,45 @@ class Promise {
     if (!promise_) {
       return;
     }
-    promise_->set_value(std::move(value));
-    promise_.reset();
+    PromiseStorage storage;
+    bool is_inline;
+    auto *promise = take_promise(storage, is_inline);
+    DetachedPromise detached_promise(promise, is_inline);
+    promise->set_value(std::move(value));
   }
   void set_error(Status &&error) {
     if (!promise_) {
       return;
     }
-    promise_->set_error(std::move(error));
-    promise_.reset();
+    PromiseStorage storage;
+    bool is_inline;
+    auto *promise = take_promise(storage, is_inline);
+    DetachedPromise detached_promise(promise, is_inline);
+    promise->set_error(std::move(error));
   }
   void set_result(Result<T> &&result) {
     if (!promise_) {
       return;
     }
-    promise_->set_result(std::move(result));
-    promise_.reset();
+    PromiseStorage storage;
+    bool is_inline;
+    auto *promise = take_promise(storage, is_inline);
+    DetachedPromise detached_promise(promise, is_inline);
+    promise->set_result(std::move(result));
   }
   void reset() {
-    promise_.reset();
+    auto *promise = promise_;
+    if (promise == nullptr) {
+      return;
+    }
+    bool is_inline = move_function_ != nullptr;
+    promise_ = nullptr;
+    move_function_ = nullptr;
+    if (is_inline) {
+      promise->~PromiseInterface<T>();
+    } else {
+      delete promise;
+    }
   }
   bool is_cancellable() const {
     if (!promise_) {
@@ -231,26 +252,148 @@ class Promise {
     return promise_->is_canceled();
   }
   unique_ptr<PromiseInterface<T>> release() {
-    return std::move(promise_);
+    auto *promise = promise_;
+    if (move_function_ != nullptr) {
+      promise = move_function_(promise, nullptr);
+    }
+    promise_ = nullptr;
+    move_function_ = nullptr;
+    return unique_ptr<PromiseInterface<T>>(promise);
+  }
+
+  // creates a promise of the type PromiseT, which is stored inline if it is small enough
+  template <class PromiseT, class... ArgsT>
+  static Promise create(ArgsT &&...args) {
+    Promise result;
+    result.template emplace<PromiseT>(std::forward<ArgsT>(args)...);
+    return result;
   }
 
   Promise() = default;
-  explicit Promise(unique_ptr<PromiseInterface<T>> promise) : promise_(std::move(promise)) {
+  explicit Promise(unique_ptr<PromiseInterface<T>> promise) : promise_(promise.release()) {
   }
   Promise(Auto) {
   }
   Promise(SafePromise<T> &&other);
   Promise &operator=(SafePromise<T> &&other);
   template <class F, std::enable_if_t<!std::is_same<std::decay_t<F>, Promise>::value, int> = 0>
-  Promise(F &&f) : promise_(detail::promise_interface_ptr<T>(std::forward<F>(f))) {
+  Promise(F &&f) {
+    init(std::forward<F>(f));
+  }
+
+  Promise(const Promise &) = delete;
+  Promise &operator=(const Promise &) = delete;
+  Promise(Promise &&other) noexcept {
+    take_from(other);
+  }
+  Promise &operator=(Promise &&other) noexcept {
+    if (this != &other) {
+      reset();
+      take_from(other);
+    }
+    return *this;
+  }
+  ~Promise() {
+    reset();
   }
 
   explicit operator bool() const noexcept {
-    return static_cast<bool>(promise_);
+    return promise_ != nullptr;
   }
 
  private:
-  unique_ptr<PromiseInterface<T>> promise_;
+  // enough for LambdaPromise with 48 bytes of captures
+  static constexpr size_t INLINE_STORAGE_SIZE = 64;
+
+  using PromiseStorage = std::aligned_storage_t<INLINE_STORAGE_SIZE>;
+
+  // move-constructs the promise in the storage or on the heap if storage is nullptr and destroys the original
+  using MoveFunction = PromiseInterface<T> *(*)(PromiseInterface<T> *promise, void *storage);
+
+  PromiseInterface<T> *promise_ = nullptr;
+  MoveFunction move_function_ = nullptr;  // non-null if and only if the promise is stored in storage_
+  PromiseStorage storage_;
+
+  template <class PromiseT>
+  static PromiseInterface<T> *move_promise(PromiseInterface<T> *promise, void *storage) {
+    auto *old_promise = static_cast<PromiseT *>(promise);
+    PromiseInterface<T> *new_promise =
+        storage == nullptr ? new PromiseT(std::move(*old_promise)) : new (storage) PromiseT(std::move(*old_promise));
+    old_promise->~PromiseT();
+    return new_promise;
+  }
+
+  template <class PromiseT>
+  static constexpr bool can_store_inline() {
+    return sizeof(PromiseT) <= INLINE_STORAGE_SIZE && alignof(PromiseT) <= alignof(PromiseStorage) &&
+           std::is_nothrow_move_constructible<PromiseT>::value;
+  }
+
+  template <class PromiseT, class... ArgsT>
+  std::enable_if_t<can_store_inline<PromiseT>()> emplace(ArgsT &&...args) {
+    promise_ = new (&storage_) PromiseT(std::forward<ArgsT>(args)...);
+    move_function_ = &move_promise<PromiseT>;
+  }
+
+  template <class PromiseT, class... ArgsT>
+  std::enable_if_t<!can_store_inline<PromiseT>()> emplace(ArgsT &&...args) {
+    promise_ = new PromiseT(std::forward<ArgsT>(args)...);
+  }
+
+  template <class F>
+  std::enable_if_t<detail::is_promise_interface_ptr<std::decay_t<F>>::value> init(F &&f) {
+    promise_ = f.release();
+  }
+
+  template <class F>
+  std::enable_if_t<!detail::is_promise_interface_ptr<std::decay_t<F>>::value> init(F &&f) {
+    emplace<std::decay_t<decltype(detail::promise_interface<T>(std::forward<F>(f)))>>(std::forward<F>(f));
+  }
+
+  void take_from(Promise &other) noexcept {
+    if (other.move_function_ != nullptr) {
+      promise_ = other.move_function_(other.promise_, &storage_);
+      move_function_ = other.move_function_;
+    } else {
+      promise_ = other.promise_;
+    }
+    other.promise_ = nullptr;
+    other.move_function_ = nullptr;
+  }
+
+  // owns a promise, which was detached from a Promise object before completion
+  class DetachedPromise {
+   public:
+    DetachedPromise(PromiseInterface<T> *promise, bool is_inline) : promise_(promise), is_inline_(is_inline) {
+    }
+    DetachedPromise(const DetachedPromise &) = delete;
+    DetachedPromise &operator=(const DetachedPromise &) = delete;
+    DetachedPromise(DetachedPromise &&) = delete;
+    DetachedPromise &operator=(DetachedPromise &&) = delete;
+    ~DetachedPromise() {
+      if (is_inline_) {
+        promise_->~PromiseInterface<T>();
+      } else {
+        delete promise_;
+      }
+    }
+
+   private:
+    PromiseInterface<T> *promise_;
+    bool is_inline_;
+  };
+
+  // detaches the promise from this object, so the object can be safely destroyed or moved while the promise is completed
+  PromiseInterface<T> *take_promise(PromiseStorage &storage, bool &is_inline) {
+    auto *promise = promise_;
+    is_inline = move_function_ != nullptr;
+    if (is_inline) {
+      promise = move_function_(promise, &storage);
+    }
+    promise_ = nullptr;
+    move_function_ = nullptr;
+    return promise;
+  }
 };
 
 template <class T = Unit>
@@ -326,18 +469,18 @@ class PromiseCreator {
  public:
   template <class OkT, class ArgT = detail::drop_result_t<detail::get_arg_t<OkT>>>
   static Promise<ArgT> lambda(OkT &&ok) {
-    return Promise<ArgT>(td::make_unique<detail::LambdaPromise<ArgT, std::decay_t<OkT>>>(std::forward<OkT>(ok)));
+    return Promise<ArgT>::template create<detail::LambdaPromise<ArgT, std::decay_t<OkT>>>(std::forward<OkT>(ok));
   }
 
   template <class OkT, class ArgT = detail::drop_result_t<detail::get_arg_t<OkT>>>
   static auto cancellable_lambda(CancellationToken cancellation_token, OkT &&ok) {
-    return Promise<ArgT>(td::make_unique<detail::CancellablePromise<detail::LambdaPromise<ArgT, std::decay_t<OkT>>>>(
-        std::move(cancellation_token), std::forward<OkT>(ok)));
+    return Promise<ArgT>::template create<detail::CancellablePromise<detail::LambdaPromise<ArgT, std::decay_t<OkT>>>>(
+        std::move(cancellation_token), std::forward<OkT>(ok));
   }
 
   template <class... ArgsT>
   static Promise<> join(ArgsT &&...args) {
-    return Promise<>(td::make_unique<detail::JoinPromise<ArgsT...>>(std::forward<ArgsT>(args)...));
+    return Promise<>::create<detail::JoinPromise<ArgsT...>>(std::forward<ArgsT>(args)...);
   }
 };
 
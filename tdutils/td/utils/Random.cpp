@@ -13,6 +13,10 @@
 #include <openssl/rand.h>
 #endif
 
+#if TD_PORT_POSIX
+#include <pthread.h>
+#endif
+
 #include <atomic>
 #include <cstring>
 #include <limits>
@@ -24,8 +28,146 @@ namespace td {
 
 namespace {
 std::atomic<int64> random_seed_generation{0};
+std::atomic<bool> is_drbg_enabled{false};
+
+// fast-key-erasure ChaCha20-based generator, which is seeded and periodically reseeded from RAND_bytes
+class ChaCha20Drbg {
+ public:
+  static constexpr size_t BLOCK_SIZE = 64;
+
+  // size must be divisible by BLOCK_SIZE
+  void generate(unsigned char *dest, size_t size, int64 seed_generation) {
+    if (!is_seeded_ || generation_ != seed_generation || generated_size_ >= RESEED_INTERVAL) {
+      reseed(seed_generation);
+    }
+    for (size_t i = 0; i < size; i += BLOCK_SIZE) {
+      chacha20_block(dest + i);
+    }
+    generated_size_ += size;
+
+    // replace the key, so previously generated bytes can't be restored from the state
+    unsigned char block[BLOCK_SIZE];
+    chacha20_block(block);
+    std::memcpy(key_, block, sizeof(key_));
+    counter_ = 0;
+    MutableSlice(block, BLOCK_SIZE).fill_zero_secure();
+  }
+
+  void clear() {
+    MutableSlice(reinterpret_cast<unsigned char *>(key_), sizeof(key_)).fill_zero_secure();
+    is_seeded_ = false;
+  }
+
+ private:
+  static constexpr size_t RESEED_INTERVAL = 1 << 20;
+
+  uint32 key_[8];
+  uint64 counter_ = 0;
+  size_t generated_size_ = 0;
+  int64 generation_ = 0;
+  bool is_seeded_ = false;
+
+  void reseed(int64 seed_generation) {
+    int err = RAND_bytes(reinterpret_cast<unsigned char *>(key_), static_cast<int>(sizeof(key_)));
+    LOG_IF(FATAL, err != 1);
+    counter_ = 0;
+    generated_size_ = 0;
+    generation_ = seed_generation;
+    is_seeded_ = true;
+  }
+
+  static uint32 rotl(uint32 x, int n) {
+    return (x << n) | (x >> (32 - n));
+  }
+
+  static void quarter_round(uint32 *x, int a, int b, int c, int d) {
+    x[a] += x[b];
+    x[d] = rotl(x[d] ^ x[a], 16);
+    x[c] += x[d];
+    x[b] = rotl(x[b] ^ x[c], 12);
+    x[a] += x[b];
+    x[d] = rotl(x[d] ^ x[a], 8);
+    x[c] += x[d];
+    x[b] = rotl(x[b] ^ x[c], 7);
+  }
+
+  void chacha20_block(unsigned char *dest) {
+    uint32 input[16] = {0x61707865,
+                        0x3320646e,
+                        0x79622d32,
+                        0x6b206574,
+                        key_[0],
+                        key_[1],
+                        key_[2],
+                        key_[3],
+                        key_[4],
+                        key_[5],
+                        key_[6],
+                        key_[7],
+                        static_cast<uint32>(counter_),
+                        static_cast<uint32>(counter_ >> 32),
+                        0,
+                        0};
+    counter_++;
+
+    uint32 x[16];
+    std::memcpy(x, input, sizeof(x));
+    for (int i = 0; i < 10; i++) {
+      quarter_round(x, 0, 4, 8, 12);
+      quarter_round(x, 1, 5, 9, 13);
+      quarter_round(x, 2, 6, 10, 14);
+      quarter_round(x, 3, 7, 11, 15);
+      quarter_round(x, 0, 5, 10, 15);
+      quarter_round(x, 1, 6, 11, 12);
+      quarter_round(x, 2, 7, 8, 13);
+      quarter_round(x, 3, 4, 9, 14);
+    }
+    for (int i = 0; i < 16; i++) {
+      x[i] += input[i];
+    }
+    std::memcpy(dest, x, sizeof(x));
+    MutableSlice(reinterpret_cast<unsigned char *>(x), sizeof(x)).fill_zero_secure();
+  }
+};
+
+#if TD_PORT_POSIX
+void on_fork_child() {
+  // a child process must not repeat random bytes generated by the parent
+  random_seed_generation++;
+}
+#endif
+
+ChaCha20Drbg *get_thread_drbg() {
+  static TD_THREAD_LOCAL ChaCha20Drbg *drbg;  // static zero-initialized
+  if (init_thread_local<ChaCha20Drbg>(drbg)) {
+#if TD_PORT_POSIX
+    static bool is_fork_handler_registered = [] {
+      pthread_atfork(nullptr, nullptr, on_fork_child);
+      return true;
+    }();
+    (void)is_fork_handler_registered;
+#endif
+  }
+  return drbg;
+}
+
+void fill_secure_buffer(unsigned char *buf, size_t size, int64 generation) {
+  if (is_drbg_enabled.load(std::memory_order_relaxed)) {
+    get_thread_drbg()->generate(buf, size, generation);
+    return;
+  }
+  int err = RAND_bytes(buf, static_cast<int>(size));
+  // TODO: it CAN fail
+  LOG_IF(FATAL, err != 1);
+}
 }  // namespace
 
+void Random::set_secure_drbg_enabled(bool is_enabled) {
+  is_drbg_enabled.store(is_enabled, std::memory_order_relaxed);
+  // drop already buffered bytes
+  random_seed_generation++;
+}
+
 void Random::secure_bytes(MutableSlice dest) {
   Random::secure_bytes(dest.ubegin(), dest.size());
 }
@@ -42,6 +184,7 @@ void Random::secure_bytes(unsigned char *ptr, size_t size) {
   if (ptr == nullptr) {
     MutableSlice(buf, BUF_SIZE).fill_zero_secure();
     buf_pos = BUF_SIZE;
+    get_thread_drbg()->clear();
     return;
   }
   if (generation != random_seed_generation.load(std::memory_order_relaxed)) {
@@ -60,9 +203,7 @@ void Random::secure_bytes(unsigned char *ptr, size_t size) {
     }
   }
   if (size < BUF_SIZE) {
-    int err = RAND_bytes(buf, static_cast<int>(BUF_SIZE));
-    // TODO: it CAN fail
-    LOG_IF(FATAL, err != 1);
+    fill_secure_buffer(buf, BUF_SIZE, generation);
     buf_pos = size;
     std::memcpy(ptr, buf, size);
     return;
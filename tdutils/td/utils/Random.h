@@ -24,6 +24,10 @@ class Random {
   // works only for current thread
   static void add_seed(Slice bytes, double entropy = 0);
   static void secure_cleanup();
+
+  // if enabled, small requests are served by a per-thread ChaCha20 generator seeded from RAND_bytes,
+  // which avoids OpenSSL locking; requests of at least 512 bytes always use RAND_bytes
+  static void set_secure_drbg_enabled(bool is_enabled);
 #endif
 
   static uint32 fast_uint32();
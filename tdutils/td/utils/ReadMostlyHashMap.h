@@ -0,0 +1,138 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/HashTableUtils.h"
+#include "td/utils/HazardPointers.h"
+#include "td/utils/port/thread_local.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace td {
+
+// Concurrent hash map for data, which is rarely changed, but is read from many threads
+//
+// The map is split into shards, each of which is an immutable snapshot.
+// Readers from threads, created by td::thread, are lock-free: they protect the snapshot with a hazard pointer.
+// Other threads have no unique thread identifier, so they lock the shard instead.
+// Writers lock only the changed shard, replace its snapshot with an updated copy and retire the old snapshot,
+// so an update takes time proportional to the shard size.
+//
+// Calls to get, count and with_value must not be nested.
+template <class KeyT, class ValueT, class HashT = Hash<KeyT>>
+class ReadMostlyHashMap {
+  using Snapshot = std::unordered_map<KeyT, ValueT, HashT>;
+
+  static constexpr size_t SHARD_COUNT = 16;
+  static constexpr int32 MAX_THREAD_ID = 128;
+
+ public:
+  ReadMostlyHashMap() = default;
+  ReadMostlyHashMap(const ReadMostlyHashMap &) = delete;
+  ReadMostlyHashMap &operator=(const ReadMostlyHashMap &) = delete;
+  ReadMostlyHashMap(ReadMostlyHashMap &&) = delete;
+  ReadMostlyHashMap &operator=(ReadMostlyHashMap &&) = delete;
+  ~ReadMostlyHashMap() {
+    for (auto &shard : shards_) {
+      delete shard.snapshot.load(std::memory_order_relaxed);
+    }
+  }
+
+  // calls func(const ValueT &) if the key is found; returns whether the key was found
+  template <class F>
+  bool with_value(const KeyT &key, F &&func) {
+    auto &shard = get_shard(key);
+    auto thread_id = get_thread_id();
+    if (thread_id <= 0 || thread_id >= MAX_THREAD_ID) {
+      std::lock_guard<std::mutex> guard(shard.mutex);
+      return with_snapshot_value(shard.snapshot.load(std::memory_order_relaxed), key, func);
+    }
+
+    typename HazardPointers<Snapshot>::Holder holder(hp_, static_cast<size_t>(thread_id), 0);
+    return with_snapshot_value(holder.protect(shard.snapshot), key, func);
+  }
+
+  ValueT get(const KeyT &key) {
+    ValueT result{};
+    with_value(key, [&result](const ValueT &value) { result = value; });
+    return result;
+  }
+
+  size_t count(const KeyT &key) {
+    return with_value(key, [](const ValueT &) {}) ? 1 : 0;
+  }
+
+  void set(const KeyT &key, ValueT value) {
+    update_shard(key, [&](Snapshot &snapshot) {
+      snapshot[key] = std::move(value);
+      return true;
+    });
+  }
+
+  size_t erase(const KeyT &key) {
+    size_t result = 0;
+    update_shard(key, [&](Snapshot &snapshot) {
+      result = snapshot.erase(key);
+      return result != 0;
+    });
+    return result;
+  }
+
+ private:
+  struct Shard {
+    std::atomic<Snapshot *> snapshot{nullptr};
+    std::mutex mutex;
+  };
+  std::array<Shard, SHARD_COUNT> shards_;
+
+  HazardPointers<Snapshot> hp_{MAX_THREAD_ID};
+  std::mutex retire_mutex_;
+
+  Shard &get_shard(const KeyT &key) {
+    return shards_[randomize_hash(HashT()(key)) % SHARD_COUNT];
+  }
+
+  template <class F>
+  static bool with_snapshot_value(const Snapshot *snapshot, const KeyT &key, F &func) {
+    if (snapshot == nullptr) {
+      return false;
+    }
+    auto it = snapshot->find(key);
+    if (it == snapshot->end()) {
+      return false;
+    }
+    func(it->second);
+    return true;
+  }
+
+  // func(Snapshot &) changes a copy of the shard and returns whether the copy must be published
+  template <class F>
+  void update_shard(const KeyT &key, F &&func) {
+    auto &shard = get_shard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto *old_snapshot = shard.snapshot.load(std::memory_order_relaxed);
+    auto new_snapshot = td::make_unique<Snapshot>();
+    if (old_snapshot != nullptr) {
+      *new_snapshot = *old_snapshot;
+    }
+    if (!func(*new_snapshot)) {
+      return;
+    }
+    shard.snapshot.store(new_snapshot.release(), std::memory_order_release);
+    if (old_snapshot != nullptr) {
+      // all writers share the same retire list, because only threads created by td::thread have unique identifiers
+      std::lock_guard<std::mutex> retire_guard(retire_mutex_);
+      hp_.retire(0, old_snapshot);
+    }
+  }
+};
+
+}  // namespace td
@@ -6,6 +6,8 @@
 //
 #pragma once
 
+#include "td/utils/common.h"
+#include "td/utils/LockStatistics.h"
 #include "td/utils/port/sleep.h"
 
 #include <atomic>
@@ -15,7 +17,9 @@ namespace td {
 
 class SpinLock {
   struct Unlock {
+    LockStatistics::Holder holder;
     void operator()(SpinLock *ptr) {
+      holder.reset();
       ptr->unlock();
     }
   };
@@ -39,7 +43,16 @@ class SpinLock {
  public:
   using Lock = std::unique_ptr<SpinLock, Unlock>;
 
+  SpinLock() = default;
+
+  // the name is used to group lock statistics and must be a string literal
+  explicit SpinLock(const char *name) : name_(name) {
+  }
+
   Lock lock() {
+    if (unlikely(LockStatistics::is_enabled())) {
+      return lock_with_statistics();
+    }
     InfBackoff backoff;
     while (!try_lock()) {
       backoff.next();
@@ -52,9 +65,23 @@ class SpinLock {
 
  private:
   std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+  const char *name_ = "SpinLock";
+
   void unlock() {
     flag_.clear(std::memory_order_release);
   }
+
+  Lock lock_with_statistics() {
+    double wait_start_time = -1.0;
+    if (!try_lock()) {
+      wait_start_time = LockStatistics::now();
+      InfBackoff backoff;
+      while (!try_lock()) {
+        backoff.next();
+      }
+    }
+    return Lock(this, Unlock{LockStatistics::on_lock(name_, false, wait_start_time)});
+  }
 };
 
 }  // namespace td
@@ -7,6 +7,7 @@
 #include "td/utils/Time.h"
 
 #include "td/utils/port/Clocks.h"
+#include "td/utils/port/thread_local.h"
 
 #include <atomic>
 #include <cmath>
@@ -19,6 +20,11 @@ bool operator==(Timestamp a, Timestamp b) {
 
 static std::atomic<double> time_diff;
 
+// the maximum value returned by now() so far
+static std::atomic<double> last_now;
+
+static TD_THREAD_LOCAL bool is_cached_time_enabled;  // static zero-initialized
+
 double Time::now() {
   auto result = now_unadjusted() + time_diff.load(std::memory_order_relaxed);
   while (result < 0) {
@@ -26,9 +32,28 @@ double Time::now() {
     time_diff.compare_exchange_strong(old_time_diff, old_time_diff - result);
     result = now_unadjusted() + time_diff.load(std::memory_order_relaxed);
   }
+
+  auto old_last_now = last_now.load(std::memory_order_relaxed);
+  while (old_last_now < result &&
+         !last_now.compare_exchange_weak(old_last_now, result, std::memory_order_release, std::memory_order_relaxed)) {
+  }
   return result;
 }
 
+double Time::now_cached() {
+  if (!is_cached_time_enabled) {
+    return now();
+  }
+  // last_now can't be less than the time returned by now() in the current thread
+  // or in any thread, which has notified the current thread
+  return last_now.load(std::memory_order_acquire);
+}
+
+void Time::update_cached() {
+  is_cached_time_enabled = true;
+  now();
+}
+
 double Time::now_unadjusted() {
   return Clocks::monotonic();
 }
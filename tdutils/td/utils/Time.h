@@ -13,20 +13,15 @@ namespace td {
 class Time {
  public:
   static double now();
-  static double now_cached() {
-    // Temporary(?) use now in now_cached
-    // Problem:
-    //   thread A: check that now() > timestamp and notifies thread B
-    //   thread B: must see that now() > timestamp()
-    //
-    //   now() and now_cached() must be monotonic
-    //
-    //   if a=now[_cached]() happens before b=now[_cached] than
-    //     a <= b
-    //
-    // As an alternative we may say that now_cached is a thread local copy of now
-    return now();
-  }
+
+  // Returns the latest value returned by now() in any thread, if the cached time is enabled in the current thread
+  // by update_cached(), or now() otherwise.
+  // now() and now_cached() are monotonic: if a=now[_cached]() happens before b=now[_cached](), then a <= b
+  static double now_cached();
+
+  // Enables the cached time in the current thread and refreshes it. Must be called once per event loop iteration.
+  static void update_cached();
+
   static double now_unadjusted();
 
   // Used for testing. After jump_in_future(at) is called, now() >= at.
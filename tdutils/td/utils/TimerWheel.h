@@ -0,0 +1,283 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+#include "td/utils/Heap.h"
+#include "td/utils/misc.h"
+
+#include <array>
+
+namespace td {
+
+// Hierarchical timer wheel with O(1) insert, fix and erase
+//
+// Keys are timestamps in seconds, which are rounded down to ticks of tick_duration seconds.
+// A node is returned by pop_expired after its tick has passed, i.e. never before its key and at most one tick later.
+// Nodes expiring within the same tick are returned in an unspecified order.
+//
+// HeapNode is used as a handle, so the same object can be stored either in a KHeap or in a TimerWheel,
+// but HeapNode::is_top has no meaning for nodes in a TimerWheel.
+class TimerWheel {
+ public:
+  explicit TimerWheel(double tick_duration = 0.001) : tick_duration_(tick_duration) {
+    CHECK(tick_duration_ > 0);
+    slot_heads_.fill(-1);
+    used_slots_.fill(0);
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+  double get_key(const HeapNode *node) const {
+    return items_[get_item_id(node)].key_;
+  }
+
+  void insert(double key, HeapNode *node) {
+    CHECK(!node->in_heap());
+    int32 item_id;
+    if (free_item_id_ != -1) {
+      item_id = free_item_id_;
+      free_item_id_ = items_[item_id].next_;
+    } else {
+      item_id = narrow_cast<int32>(items_.size());
+      items_.emplace_back();
+    }
+    auto &item = items_[item_id];
+    item.key_ = key;
+    item.node_ = node;
+    node->pos_ = item_id;
+    size_++;
+    link(item_id, get_slot_id(get_tick(key)));
+  }
+
+  void fix(double key, HeapNode *node) {
+    auto item_id = get_item_id(node);
+    unlink(item_id);
+    items_[item_id].key_ = key;
+    link(item_id, get_slot_id(get_tick(key)));
+  }
+
+  void erase(HeapNode *node) {
+    auto item_id = get_item_id(node);
+    node->remove();
+    unlink(item_id);
+    free_item(item_id);
+  }
+
+  // removes and returns a node, which has expired by the time now, or returns nullptr if there are no such nodes
+  // the wheel can't be rewound, so all nodes with keys before now will be expired immediately after insertion
+  HeapNode *pop_expired(double now) {
+    auto target_tick = get_tick(now);
+    while (slot_heads_[EXPIRED_SLOT_ID] == -1) {
+      if (current_tick_ >= target_tick) {
+        return nullptr;
+      }
+      if (empty()) {
+        current_tick_ = target_tick;
+        return nullptr;
+      }
+      advance(target_tick);
+    }
+
+    auto item_id = slot_heads_[EXPIRED_SLOT_ID];
+    unlink(item_id);
+    auto node = items_[item_id].node_;
+    node->remove();
+    free_item(item_id);
+    return node;
+  }
+
+  // returns a time, which is not later than the time when pop_expired will return the next node
+  double get_wakeup_at() const {
+    CHECK(!empty());
+    if (slot_heads_[EXPIRED_SLOT_ID] != -1) {
+      return 0.0;
+    }
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+      if (used_slots_[level] == 0) {
+        continue;
+      }
+      // slots before the current position of the level are always empty
+      auto slot = static_cast<uint64>(count_trailing_zeroes_non_zero64(used_slots_[level]));
+      auto shift = level * LEVEL_BITS;
+      auto tick = ((current_tick_ >> (shift + LEVEL_BITS)) << (shift + LEVEL_BITS)) | (slot << shift);
+      if (level == 0) {
+        // nodes from a slot of the first level expire when their tick ends
+        tick++;
+      }
+      return static_cast<double>(tick) * tick_duration_;
+    }
+    // only far away nodes are left; they are redistributed when the whole wheel is passed
+    auto tick = ((current_tick_ >> TOTAL_BITS) + 1) << TOTAL_BITS;
+    return static_cast<double>(tick) * tick_duration_;
+  }
+
+  template <class F>
+  void for_each(F &&f) const {
+    for (auto &item : items_) {
+      if (item.node_ != nullptr) {
+        f(item.key_, static_cast<const HeapNode *>(item.node_));
+      }
+    }
+  }
+
+  template <class F>
+  void for_each(F &&f) {
+    for (auto &item : items_) {
+      if (item.node_ != nullptr) {
+        f(item.key_, item.node_);
+      }
+    }
+  }
+
+ private:
+  static constexpr int LEVEL_BITS = 6;
+  static constexpr int LEVEL_COUNT = 5;
+  static constexpr int TOTAL_BITS = LEVEL_BITS * LEVEL_COUNT;  // 2^30 ms is more than 12 days
+  static constexpr int32 SLOT_COUNT = 1 << LEVEL_BITS;
+  static constexpr uint64 SLOT_MASK = SLOT_COUNT - 1;
+  static constexpr int32 OVERFLOW_SLOT_ID = LEVEL_COUNT * SLOT_COUNT;
+  static constexpr int32 EXPIRED_SLOT_ID = OVERFLOW_SLOT_ID + 1;
+
+  struct Item {
+    double key_ = 0.0;
+    HeapNode *node_ = nullptr;
+    int32 prev_ = -1;
+    int32 next_ = -1;
+    int32 slot_id_ = -1;
+  };
+  vector<Item> items_;
+  int32 free_item_id_ = -1;
+  size_t size_ = 0;
+
+  std::array<int32, EXPIRED_SLOT_ID + 1> slot_heads_;
+  std::array<uint64, LEVEL_COUNT> used_slots_;
+  uint64 current_tick_ = 0;  // all nodes with smaller ticks have expired
+  double tick_duration_;
+
+  uint64 get_tick(double key) const {
+    if (!(key > 0)) {
+      return 0;
+    }
+    auto tick = key / tick_duration_;
+    if (tick >= 1e18) {
+      return static_cast<uint64>(1e18);
+    }
+    return static_cast<uint64>(tick);
+  }
+
+  int32 get_slot_id(uint64 tick) const {
+    if (tick < current_tick_) {
+      return EXPIRED_SLOT_ID;
+    }
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+      auto shift = (level + 1) * LEVEL_BITS;
+      if ((tick >> shift) == (current_tick_ >> shift)) {
+        return level * SLOT_COUNT + static_cast<int32>((tick >> (level * LEVEL_BITS)) & SLOT_MASK);
+      }
+    }
+    return OVERFLOW_SLOT_ID;
+  }
+
+  int32 get_item_id(const HeapNode *node) const {
+    auto item_id = node->pos_;
+    CHECK(0 <= item_id && static_cast<size_t>(item_id) < items_.size());
+    DCHECK(items_[item_id].node_ == node);
+    return item_id;
+  }
+
+  void link(int32 item_id, int32 slot_id) {
+    auto &item = items_[item_id];
+    auto &head = slot_heads_[slot_id];
+    item.slot_id_ = slot_id;
+    item.prev_ = -1;
+    item.next_ = head;
+    if (head != -1) {
+      items_[head].prev_ = item_id;
+    }
+    head = item_id;
+    if (slot_id < OVERFLOW_SLOT_ID) {
+      used_slots_[slot_id / SLOT_COUNT] |= static_cast<uint64>(1) << (slot_id % SLOT_COUNT);
+    }
+  }
+
+  void unlink(int32 item_id) {
+    auto &item = items_[item_id];
+    auto &head = slot_heads_[item.slot_id_];
+    if (item.prev_ != -1) {
+      items_[item.prev_].next_ = item.next_;
+    } else {
+      head = item.next_;
+    }
+    if (item.next_ != -1) {
+      items_[item.next_].prev_ = item.prev_;
+    }
+    if (head == -1 && item.slot_id_ < OVERFLOW_SLOT_ID) {
+      used_slots_[item.slot_id_ / SLOT_COUNT] &= ~(static_cast<uint64>(1) << (item.slot_id_ % SLOT_COUNT));
+    }
+    item.slot_id_ = -1;
+  }
+
+  void free_item(int32 item_id) {
+    auto &item = items_[item_id];
+    item.node_ = nullptr;
+    item.next_ = free_item_id_;
+    free_item_id_ = item_id;
+    size_--;
+  }
+
+  // moves all nodes from the slot to the slots corresponding to the current tick
+  void redistribute(int32 slot_id) {
+    auto item_id = slot_heads_[slot_id];
+    slot_heads_[slot_id] = -1;
+    if (slot_id < OVERFLOW_SLOT_ID) {
+      used_slots_[slot_id / SLOT_COUNT] &= ~(static_cast<uint64>(1) << (slot_id % SLOT_COUNT));
+    }
+    while (item_id != -1) {
+      auto next_item_id = items_[item_id].next_;
+      link(item_id, get_slot_id(get_tick(items_[item_id].key_)));
+      item_id = next_item_id;
+    }
+  }
+
+  void advance(uint64 target_tick) {
+    auto current_slot_id = static_cast<int32>(current_tick_ & SLOT_MASK);
+
+    // skip all ticks for which there can be no nodes
+    int level = 0;
+    while (level < LEVEL_COUNT && used_slots_[level] == 0) {
+      level++;
+    }
+    auto shift = level * LEVEL_BITS;
+    auto next_tick = ((current_tick_ >> shift) + 1) << shift;
+    current_tick_ = min(next_tick, target_tick);
+
+    // nodes from the previous first level slot have expired
+    redistribute(current_slot_id);
+
+    // cascade nodes from the higher level slots, which became current
+    for (int cascade_level = 1; cascade_level <= LEVEL_COUNT; cascade_level++) {
+      auto cascade_shift = cascade_level * LEVEL_BITS;
+      if ((current_tick_ & ((static_cast<uint64>(1) << cascade_shift) - 1)) != 0) {
+        break;
+      }
+      if (cascade_level == LEVEL_COUNT) {
+        redistribute(OVERFLOW_SLOT_ID);
+      } else {
+        redistribute(cascade_level * SLOT_COUNT + static_cast<int32>((current_tick_ >> cascade_shift) & SLOT_MASK));
+      }
+    }
+  }
+};
+
+}  // namespace td
@@ -0,0 +1,43 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/TlStorerToString.h"
+
+#include "td/utils/port/thread_local.h"
+
+namespace td {
+
+static TD_THREAD_LOCAL StringBuilder *thread_string_builder;  // static zero-initialized
+static TD_THREAD_LOCAL bool is_thread_string_builder_used;    // static zero-initialized
+
+TlStorerToString::TlStorerToString() {
+  if (is_thread_string_builder_used) {
+    // nested to_string call
+    own_sb_ = make_unique<StringBuilder>();
+    sb_ = own_sb_.get();
+    return;
+  }
+  init_thread_local<StringBuilder>(thread_string_builder);
+  is_thread_string_builder_used = true;
+  is_thread_local_ = true;
+  sb_ = thread_string_builder;
+}
+
+TlStorerToString::~TlStorerToString() {
+  if (!is_thread_local_) {
+    return;
+  }
+  // don't keep too big buffers after serialization of huge objects
+  constexpr size_t MAX_CACHED_BUFFER_SIZE = 1 << 20;
+  if (sb_->size() > MAX_CACHED_BUFFER_SIZE) {
+    *sb_ = StringBuilder();
+  } else {
+    sb_->clear();
+  }
+  is_thread_string_builder_used = false;
+}
+
+}  // namespace td
@@ -10,51 +10,68 @@
 #include "td/utils/SharedSlice.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/StringBuilder.h"
 #include "td/utils/UInt.h"
 
+#include <type_traits>
+
 namespace td {
 
 class TlStorerToString {
-  string result;
+  StringBuilder *sb_;
+  unique_ptr<StringBuilder> own_sb_;
+  bool is_thread_local_ = false;
   size_t shift = 0;
 
   void store_field_begin(const char *name) {
-    result.append(shift, ' ');
+    store_indent();
     if (name && name[0]) {
-      result += name;
-      result += " = ";
+      *sb_ << Slice(name) << Slice(" = ");
     }
   }
 
   void store_field_end() {
-    result += '\n';
+    *sb_ << '\n';
+  }
+
+  void store_indent() {
+    for (size_t i = 0; i < shift; i++) {
+      *sb_ << ' ';
+    }
   }
 
   void store_long(int64 value) {
-    result += (PSLICE() << value).c_str();
+    *sb_ << value;
   }
 
   void store_binary(Slice data) {
     static const char *hex = "0123456789ABCDEF";
 
-    result.append("{ ", 2);
+    *sb_ << Slice("{ ");
     for (auto c : data) {
       unsigned char byte = c;
-      result += hex[byte >> 4];
-      result += hex[byte & 15];
-      result += ' ';
+      *sb_ << hex[byte >> 4] << hex[byte & 15] << ' ';
     }
-    result += '}';
+    *sb_ << '}';
   }
 
  public:
-  TlStorerToString() = default;
+  // uses a thread-local StringBuilder, which keeps its capacity between calls
+  TlStorerToString();
+
+  // appends the result to the given StringBuilder
+  explicit TlStorerToString(StringBuilder &string_builder) : sb_(&string_builder) {
+  }
+
   TlStorerToString(const TlStorerToString &other) = delete;
   TlStorerToString &operator=(const TlStorerToString &other) = delete;
+  TlStorerToString(TlStorerToString &&other) = delete;
+  TlStorerToString &operator=(TlStorerToString &&other) = delete;
+  ~TlStorerToString();
 
   void store_field(const char *name, bool value) {
     store_field_begin(name);
-    result += (value ? "true" : "false");
+    *sb_ << (value ? Slice("true") : Slice("false"));
     store_field_end();
   }
 
@@ -70,40 +87,38 @@ class TlStorerToString {
 
   void store_field(const char *name, double value) {
     store_field_begin(name);
-    result += (PSLICE() << value).c_str();
+    *sb_ << value;
     store_field_end();
   }
 
   void store_field(const char *name, const char *value) {
     store_field_begin(name);
-    result += value;
+    *sb_ << Slice(value);
     store_field_end();
   }
 
   void store_field(const char *name, const string &value) {
     store_field_begin(name);
-    result += '"';
-    result += value;
-    result += '"';
+    *sb_ << '"' << Slice(value) << '"';
     store_field_end();
   }
 
   void store_field(const char *name, const SecureString &value) {
     store_field_begin(name);
-    result.append("<secret>");
+    *sb_ << Slice("<secret>");
     store_field_end();
   }
 
   template <class T>
   void store_field(const char *name, const T &value) {
     store_field_begin(name);
-    result.append(value.data(), value.size());
+    *sb_ << Slice(value.data(), value.size());
     store_field_end();
   }
 
   void store_bytes_field(const char *name, const SecureString &value) {
     store_field_begin(name);
-    result.append("<secret>");
+    *sb_ << Slice("<secret>");
     store_field_end();
   }
 
@@ -112,20 +127,18 @@ class TlStorerToString {
     static const char *hex = "0123456789ABCDEF";
 
     store_field_begin(name);
-    result.append("bytes [");
+    *sb_ << Slice("bytes [");
     store_long(static_cast<int64>(value.size()));
-    result.append("] { ");
+    *sb_ << Slice("] { ");
     size_t len = min(static_cast<size_t>(64), value.size());
     for (size_t i = 0; i < len; i++) {
       int b = value[static_cast<int>(i)] & 0xff;
-      result += hex[b >> 4];
-      result += hex[b & 15];
-      result += ' ';
+      *sb_ << hex[b >> 4] << hex[b & 15] << ' ';
     }
     if (len < value.size()) {
-      result.append("...");
+      *sb_ << Slice("...");
     }
-    result += '}';
+    *sb_ << '}';
     store_field_end();
   }
 
@@ -152,29 +165,54 @@ class TlStorerToString {
 
   void store_vector_begin(const char *field_name, size_t vector_size) {
     store_field_begin(field_name);
-    result += "vector[";
-    result += (PSLICE() << vector_size).c_str();
-    result += "] {\n";
+    *sb_ << Slice("vector[") << vector_size << Slice("] {\n");
     shift += 2;
   }
 
   void store_class_begin(const char *field_name, const char *class_name) {
     store_field_begin(field_name);
-    result += class_name;
-    result += " {\n";
+    *sb_ << Slice(class_name) << Slice(" {\n");
     shift += 2;
   }
 
   void store_class_end() {
     CHECK(shift >= 2);
     shift -= 2;
-    result.append(shift, ' ');
-    result += "}\n";
+    store_indent();
+    *sb_ << Slice("}\n");
   }
 
   string move_as_string() {
-    return std::move(result);
+    return sb_->as_cslice().str();
   }
 };
 
+namespace detail {
+template <class ObjectT>
+struct LazyTlObjectString {
+  const ObjectT *object;
+};
+
+template <class ObjectT>
+StringBuilder &operator<<(StringBuilder &string_builder, const LazyTlObjectString<ObjectT> &lazy_string) {
+  if (lazy_string.object == nullptr) {
+    return string_builder << "null";
+  }
+  TlStorerToString storer(string_builder);
+  lazy_string.object->store(storer, "");
+  return string_builder;
+}
+}  // namespace detail
+
+// to_string replacement for logging: the object is serialized directly to the log only if the log statement is enabled
+template <class ObjectT>
+detail::LazyTlObjectString<ObjectT> lazy_to_string(const ObjectT *object) {
+  return {object};
+}
+
+template <class PtrT>
+auto lazy_to_string(const PtrT &ptr) -> detail::LazyTlObjectString<std::remove_reference_t<decltype(*ptr.get())>> {
+  return {ptr.get()};
+}
+
 }  // namespace td
@@ -15,7 +15,6 @@
 
 #include <array>
 #include <atomic>
-#include <limits>
 #include <mutex>
 
 namespace td {
@@ -67,11 +66,16 @@ class TsFileLog final : public LogInterface {
   }
 
   Info *get_current_info() {
-    return &logs_[get_thread_id()];
+    auto thread_id = static_cast<size_t>(get_thread_id());
+    if (thread_id >= MAX_THREAD_ID) {
+      thread_id = 0;
+    }
+    return &logs_[thread_id];
   }
 
   Status init_info(Info *info) {
-    TRY_STATUS(info->log.init(get_path(info), std::numeric_limits<int64>::max(), info->id == 0 && redirect_stderr_));
+    // each thread writes to its own file, so the files are rotated independently
+    TRY_STATUS(info->log.init(get_path(info), rotate_threshold_, info->id == 0 && redirect_stderr_));
     info->is_inited = true;
     return Status::OK();
   }
@@ -90,7 +94,9 @@ class TsFileLog final : public LogInterface {
   vector<string> get_file_paths() final {
     vector<string> res;
     for (auto &log : logs_) {
-      res.push_back(get_path(&log));
+      auto path = get_path(&log);
+      res.push_back(PSTRING() << path << ".old");
+      res.push_back(std::move(path));
     }
     return res;
   }
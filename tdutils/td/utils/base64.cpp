@@ -37,43 +37,83 @@ static const unsigned char *get_character_table() {
 }
 
 template <bool is_url>
-string base64_encode_impl(Slice input) {
+static size_t get_base64_encoded_size(size_t size) {
+  return is_url ? (size * 4 + 2) / 3 : (size + 2) / 3 * 4;
+}
+
+template <bool is_url>
+static void do_base64_encode_impl(Slice input, char *ptr) {
   auto characters = get_characters<is_url>();
-  string base64;
-  base64.reserve((input.size() + 2) / 3 * 4);
-  for (size_t i = 0; i < input.size();) {
-    size_t left = min(input.size() - i, static_cast<size_t>(3));
-    int c = input.ubegin()[i++] << 16;
-    base64 += characters[c >> 18];
-    if (left != 1) {
-      c |= input.ubegin()[i++] << 8;
-    }
-    base64 += characters[(c >> 12) & 63];
-    if (left == 3) {
-      c |= input.ubegin()[i++];
-    }
-    if (left != 1) {
-      base64 += characters[(c >> 6) & 63];
-    } else if (!is_url) {
-      base64 += '=';
-    }
-    if (left == 3) {
-      base64 += characters[c & 63];
-    } else if (!is_url) {
-      base64 += '=';
-    }
+  auto it = input.ubegin();
+  auto full_end = it + input.size() / 3 * 3;
+  for (; it != full_end; it += 3) {
+    auto c = (static_cast<uint32>(it[0]) << 16) | (static_cast<uint32>(it[1]) << 8) | it[2];
+    ptr[0] = characters[c >> 18];
+    ptr[1] = characters[(c >> 12) & 63];
+    ptr[2] = characters[(c >> 6) & 63];
+    ptr[3] = characters[c & 63];
+    ptr += 4;
+  }
+
+  auto left = input.size() % 3;
+  if (left == 0) {
+    return;
+  }
+  auto c = static_cast<uint32>(it[0]) << 16;
+  if (left == 2) {
+    c |= static_cast<uint32>(it[1]) << 8;
+  }
+  *ptr++ = characters[c >> 18];
+  *ptr++ = characters[(c >> 12) & 63];
+  if (left == 2) {
+    *ptr++ = characters[(c >> 6) & 63];
+  } else if (!is_url) {
+    *ptr++ = '=';
+  }
+  if (!is_url) {
+    *ptr = '=';
   }
+}
+
+template <bool is_url>
+static string base64_encode_impl(Slice input) {
+  string base64(get_base64_encoded_size<is_url>(input.size()), '\0');
+  do_base64_encode_impl<is_url>(input, &base64[0]);
   return base64;
 }
 
+template <bool is_url>
+static MutableSlice base64_encode_impl(Slice input, MutableSlice output) {
+  auto size = get_base64_encoded_size<is_url>(input.size());
+  CHECK(output.size() >= size);
+  do_base64_encode_impl<is_url>(input, output.begin());
+  return output.substr(0, size);
+}
+
 string base64_encode(Slice input) {
   return base64_encode_impl<false>(input);
 }
 
+MutableSlice base64_encode(Slice input, MutableSlice output) {
+  return base64_encode_impl<false>(input, output);
+}
+
+size_t base64_encoded_size(size_t size) {
+  return get_base64_encoded_size<false>(size);
+}
+
 string base64url_encode(Slice input) {
   return base64_encode_impl<true>(input);
 }
 
+MutableSlice base64url_encode(Slice input, MutableSlice output) {
+  return base64_encode_impl<true>(input, output);
+}
+
+size_t base64url_encoded_size(size_t size) {
+  return get_base64_encoded_size<true>(size);
+}
+
 template <bool is_url>
 Result<Slice> base64_drop_padding(Slice base64) {
   size_t padding_length = 0;
@@ -94,6 +134,25 @@ Result<Slice> base64_drop_padding(Slice base64) {
 }
 
 static Status do_base64_decode_impl(Slice base64, const unsigned char *table, char *ptr) {
+  // all full groups are decoded at once; value 64 of an invalid character can't be hidden by bitwise OR
+  auto it = base64.ubegin();
+  auto full_end = it + base64.size() / 4 * 4;
+  for (; it != full_end; it += 4) {
+    uint32 a = table[it[0]];
+    uint32 b = table[it[1]];
+    uint32 c = table[it[2]];
+    uint32 d = table[it[3]];
+    if (((a | b | c | d) & 64) != 0) {
+      return Status::Error("Wrong character in the string");
+    }
+    auto value = (a << 18) | (b << 12) | (c << 6) | d;
+    ptr[0] = static_cast<char>(static_cast<unsigned char>(value >> 16));  // implementation-defined
+    ptr[1] = static_cast<char>(static_cast<unsigned char>(value >> 8));   // implementation-defined
+    ptr[2] = static_cast<char>(static_cast<unsigned char>(value));        // implementation-defined
+    ptr += 3;
+  }
+  base64.remove_prefix(base64.size() / 4 * 4);
+
   for (size_t i = 0; i < base64.size();) {
     size_t left = min(base64.size() - i, static_cast<size_t>(4));
     int c = 0;
@@ -123,6 +182,10 @@ static Status do_base64_decode_impl(Slice base64, const unsigned char *table, ch
   return Status::OK();
 }
 
+static size_t get_base64_decoded_size(Slice base64) {
+  return base64.size() / 4 * 3 + ((base64.size() & 3) + 1) / 2;
+}
+
 template <class T>
 static T create_empty(size_t size);
 
@@ -140,11 +203,23 @@ template <bool is_url, class T>
 static Result<T> base64_decode_impl(Slice base64) {
   TRY_RESULT_ASSIGN(base64, base64_drop_padding<is_url>(base64));
 
-  T result = create_empty<T>(base64.size() / 4 * 3 + ((base64.size() & 3) + 1) / 2);
+  T result = create_empty<T>(get_base64_decoded_size(base64));
   TRY_STATUS(do_base64_decode_impl(base64, get_character_table<is_url>(), as_mutable_slice(result).begin()));
   return std::move(result);
 }
 
+template <bool is_url>
+static Result<MutableSlice> base64_decode_impl(Slice base64, MutableSlice output) {
+  TRY_RESULT_ASSIGN(base64, base64_drop_padding<is_url>(base64));
+
+  auto size = get_base64_decoded_size(base64);
+  if (output.size() < size) {
+    return Status::Error("Output buffer is too small");
+  }
+  TRY_STATUS(do_base64_decode_impl(base64, get_character_table<is_url>(), output.begin()));
+  return output.substr(0, size);
+}
+
 Result<string> base64_decode(Slice base64) {
   return base64_decode_impl<false, string>(base64);
 }
@@ -153,13 +228,22 @@ Result<SecureString> base64_decode_secure(Slice base64) {
   return base64_decode_impl<false, SecureString>(base64);
 }
 
+Result<MutableSlice> base64_decode(Slice base64, MutableSlice output) {
+  return base64_decode_impl<false>(base64, output);
+}
+
 Result<string> base64url_decode(Slice base64) {
   return base64_decode_impl<true, string>(base64);
 }
+
 Result<SecureString> base64url_decode_secure(Slice base64) {
   return base64_decode_impl<true, SecureString>(base64);
 }
 
+Result<MutableSlice> base64url_decode(Slice base64, MutableSlice output) {
+  return base64_decode_impl<true>(base64, output);
+}
+
 template <bool is_url>
 static bool is_base64_impl(Slice input) {
   size_t padding_length = 0;
@@ -178,10 +262,12 @@ static bool is_base64_impl(Slice input) {
   }
 
   auto table = get_character_table<is_url>();
+  unsigned char values = 0;
   for (auto c : input) {
-    if (table[static_cast<unsigned char>(c)] == 64) {
-      return false;
-    }
+    values |= table[static_cast<unsigned char>(c)];
+  }
+  if ((values & 64) != 0) {
+    return false;
   }
 
   if ((input.size() & 3) == 2) {
@@ -21,6 +21,17 @@ string base64url_encode(Slice input);
 Result<string> base64url_decode(Slice base64);
 Result<SecureString> base64url_decode_secure(Slice base64);
 
+// variants without memory allocation
+// output of encoding must have at least base64_encoded_size(input.size()) or base64url_encoded_size(input.size()) bytes
+// return the written prefix of the output
+size_t base64_encoded_size(size_t size);
+MutableSlice base64_encode(Slice input, MutableSlice output);
+Result<MutableSlice> base64_decode(Slice base64, MutableSlice output);
+
+size_t base64url_encoded_size(size_t size);
+MutableSlice base64url_encode(Slice input, MutableSlice output);
+Result<MutableSlice> base64url_decode(Slice base64, MutableSlice output);
+
 bool is_base64(Slice input);
 bool is_base64url(Slice input);
 
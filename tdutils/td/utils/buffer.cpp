@@ -9,6 +9,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/port/thread_local.h"
 
+#include <array>
 #include <cstddef>
 #include <new>
 
@@ -21,9 +22,56 @@
 
 namespace td {
 
+// keeps freed buffers of each size class for reuse by the same thread
+struct BufferAllocator::BufferRawCache {
+  static constexpr size_t MAX_CACHED_BUFFERS = 8;  // per size class
+
+  std::array<std::array<char *, MAX_CACHED_BUFFERS>, SIZE_CLASS_COUNT> buffers_{};
+  std::array<size_t, SIZE_CLASS_COUNT> buffer_count_{};
+
+  static size_t get_alloc_size(size_t size_class) {
+    return TD_OFFSETOF(BufferRaw, data_) + (static_cast<size_t>(512) << size_class);
+  }
+
+  char *allocate(size_t size_class) {
+    auto &count = buffer_count_[size_class];
+    if (count == 0) {
+      return new char[get_alloc_size(size_class)];
+    }
+    cached_buffer_mem -= get_alloc_size(size_class);
+    return buffers_[size_class][--count];
+  }
+
+  bool free(size_t size_class, char *buffer) {
+    auto &count = buffer_count_[size_class];
+    if (count == MAX_CACHED_BUFFERS) {
+      return false;
+    }
+    cached_buffer_mem += get_alloc_size(size_class);
+    buffers_[size_class][count++] = buffer;
+    return true;
+  }
+
+  BufferRawCache() = default;
+  BufferRawCache(const BufferRawCache &) = delete;
+  BufferRawCache &operator=(const BufferRawCache &) = delete;
+  BufferRawCache(BufferRawCache &&) = delete;
+  BufferRawCache &operator=(BufferRawCache &&) = delete;
+  ~BufferRawCache() {
+    for (size_t size_class = 0; size_class < SIZE_CLASS_COUNT; size_class++) {
+      while (buffer_count_[size_class] > 0) {
+        delete[] allocate(size_class);
+      }
+    }
+  }
+};
+
 TD_THREAD_LOCAL BufferAllocator::BufferRawTls *BufferAllocator::buffer_raw_tls;  // static zero-initialized
+TD_THREAD_LOCAL BufferAllocator::BufferRawCache *BufferAllocator::buffer_raw_cache;  // static zero-initialized
 
 std::atomic<size_t> BufferAllocator::buffer_mem;
+std::array<std::atomic<size_t>, BufferAllocator::SIZE_CLASS_COUNT + 1> BufferAllocator::size_class_buffer_mem;
+std::atomic<size_t> BufferAllocator::cached_buffer_mem;
 
 int64 BufferAllocator::get_buffer_slice_size() {
   return 0;
@@ -33,6 +81,23 @@ size_t BufferAllocator::get_buffer_mem() {
   return buffer_mem;
 }
 
+size_t BufferAllocator::get_size_class_buffer_mem(size_t size_class) {
+  CHECK(size_class <= SIZE_CLASS_COUNT);
+  return size_class_buffer_mem[size_class];
+}
+
+size_t BufferAllocator::get_cached_buffer_mem() {
+  return cached_buffer_mem;
+}
+
+size_t BufferAllocator::get_size_class(size_t size) {
+  size_t size_class = 0;
+  while (size_class < SIZE_CLASS_COUNT && (static_cast<size_t>(512) << size_class) < size) {
+    size_class++;
+  }
+  return size_class;
+}
+
 BufferAllocator::WriterPtr BufferAllocator::create_writer(size_t size) {
   if (size < 512) {
     size = 512;
@@ -90,9 +155,17 @@ void BufferAllocator::dec_ref_cnt(BufferRaw *ptr) {
   int left = ptr->ref_cnt_.fetch_sub(1, std::memory_order_acq_rel);
   if (left == 1) {
     auto buf_size = max(sizeof(BufferRaw), TD_OFFSETOF(BufferRaw, data_) + ptr->data_size_);
+    auto size_class = get_size_class(ptr->data_size_);
     buffer_mem -= buf_size;
+    size_class_buffer_mem[size_class] -= buf_size;
     ptr->~BufferRaw();
-    delete[] ptr;
+
+    auto *buffer = reinterpret_cast<char *>(ptr);
+    // the cache isn't created here, because the buffer can be freed while thread locals are being destroyed
+    if (size_class < SIZE_CLASS_COUNT && buffer_raw_cache != nullptr && buffer_raw_cache->free(size_class, buffer)) {
+      return;
+    }
+    delete[] buffer;
   }
 }
 
@@ -109,9 +182,18 @@ BufferRaw *BufferAllocator::create_buffer_raw(size_t size) {
   if (buf_size < sizeof(BufferRaw)) {
     buf_size = sizeof(BufferRaw);
   }
+  auto size_class = get_size_class(size);
   buffer_mem += buf_size;
-  auto *buffer_raw = reinterpret_cast<BufferRaw *>(new char[buf_size]);
-  return new (buffer_raw) BufferRaw(size);
+  size_class_buffer_mem[size_class] += buf_size;
+
+  char *buffer;
+  if (size_class < SIZE_CLASS_COUNT) {
+    init_thread_local<BufferRawCache>(buffer_raw_cache);
+    buffer = buffer_raw_cache->allocate(size_class);
+  } else {
+    buffer = new char[buf_size];
+  }
+  return new (buffer) BufferRaw(size);
 }
 
 void BufferBuilder::append(BufferSlice slice) {
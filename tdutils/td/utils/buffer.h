@@ -10,6 +10,7 @@
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Slice.h"
 
+#include <array>
 #include <atomic>
 #include <limits>
 #include <memory>
@@ -66,9 +67,19 @@ class BufferAllocator {
 
   static ReaderPtr create_reader(const ReaderPtr &raw);
 
+  // buffers with up to 512, 1024, ..., 65536 bytes of data are allocated in size classes, which are reused
+  static constexpr size_t SIZE_CLASS_COUNT = 8;
+
   static size_t get_buffer_mem();
   static int64 get_buffer_slice_size();
 
+  // returns memory used by alive buffers of the given size class
+  // size class SIZE_CLASS_COUNT contains all buffers, which are bigger than the largest size class
+  static size_t get_size_class_buffer_mem(size_t size_class);
+
+  // returns memory kept in thread-local caches of freed buffers
+  static size_t get_cached_buffer_mem();
+
   static void clear_thread_local();
 
  private:
@@ -92,11 +103,18 @@ class BufferAllocator {
 
   static TD_THREAD_LOCAL BufferRawTls *buffer_raw_tls;
 
+  struct BufferRawCache;
+  static TD_THREAD_LOCAL BufferRawCache *buffer_raw_cache;
+
   static void dec_ref_cnt(BufferRaw *ptr);
 
   static BufferRaw *create_buffer_raw(size_t size);
 
+  static size_t get_size_class(size_t size);
+
   static std::atomic<size_t> buffer_mem;
+  static std::array<std::atomic<size_t>, SIZE_CLASS_COUNT + 1> size_class_buffer_mem;
+  static std::atomic<size_t> cached_buffer_mem;
 };
 
 using BufferWriterPtr = BufferAllocator::WriterPtr;
@@ -589,6 +589,84 @@ void aes_ige_decrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlic
   state.get_iv(aes_iv);
 }
 
+static void aes_ige_multi(bool encrypt, Slice aes_key, Span<MutableSlice> aes_ivs, Span<MutableSlice> data) {
+  CHECK(aes_key.size() == 32);
+  CHECK(aes_ivs.size() == data.size());
+  auto stream_count = data.size();
+  if (stream_count == 0) {
+    return;
+  }
+
+  Evp evp;
+  if (encrypt) {
+    evp.init_encrypt_ecb(aes_key);
+  } else {
+    evp.init_decrypt_ecb(aes_key);
+  }
+
+  vector<AesBlock> encrypted_ivs(stream_count);
+  vector<AesBlock> plaintext_ivs(stream_count);
+  size_t max_block_count = 0;
+  for (size_t i = 0; i < stream_count; i++) {
+    CHECK(aes_ivs[i].size() == 32);
+    CHECK(data[i].size() % AES_BLOCK_SIZE == 0);
+    encrypted_ivs[i].load(aes_ivs[i].ubegin());
+    plaintext_ivs[i].load(aes_ivs[i].ubegin() + AES_BLOCK_SIZE);
+    max_block_count = td::max(max_block_count, data[i].size() / AES_BLOCK_SIZE);
+  }
+
+  // on each step the next block of every unfinished stream is processed by a single ECB call
+  vector<AesBlock> blocks(stream_count);
+  vector<AesBlock> buffer(stream_count);
+  vector<size_t> stream_ids(stream_count);
+  for (size_t block_id = 0; block_id < max_block_count; block_id++) {
+    auto offset = block_id * AES_BLOCK_SIZE;
+    size_t count = 0;
+    for (size_t i = 0; i < stream_count; i++) {
+      if (offset < data[i].size()) {
+        blocks[count].load(data[i].ubegin() + offset);
+        buffer[count] = blocks[count] ^ (encrypt ? encrypted_ivs[i] : plaintext_ivs[i]);
+        stream_ids[count] = i;
+        count++;
+      }
+    }
+
+    auto size = static_cast<int>(AES_BLOCK_SIZE * count);
+    if (encrypt) {
+      evp.encrypt(buffer[0].raw(), buffer[0].raw(), size);
+    } else {
+      evp.decrypt(buffer[0].raw(), buffer[0].raw(), size);
+    }
+
+    for (size_t j = 0; j < count; j++) {
+      auto i = stream_ids[j];
+      if (encrypt) {
+        buffer[j] ^= plaintext_ivs[i];
+        plaintext_ivs[i] = blocks[j];
+        encrypted_ivs[i] = buffer[j];
+      } else {
+        buffer[j] ^= encrypted_ivs[i];
+        encrypted_ivs[i] = blocks[j];
+        plaintext_ivs[i] = buffer[j];
+      }
+      buffer[j].store(data[i].ubegin() + offset);
+    }
+  }
+
+  for (size_t i = 0; i < stream_count; i++) {
+    encrypted_ivs[i].store(aes_ivs[i].ubegin());
+    plaintext_ivs[i].store(aes_ivs[i].ubegin() + AES_BLOCK_SIZE);
+  }
+}
+
+void aes_ige_encrypt_multi(Slice aes_key, Span<MutableSlice> aes_ivs, Span<MutableSlice> data) {
+  aes_ige_multi(true, aes_key, aes_ivs, data);
+}
+
+void aes_ige_decrypt_multi(Slice aes_key, Span<MutableSlice> aes_ivs, Span<MutableSlice> data) {
+  aes_ige_multi(false, aes_key, aes_ivs, data);
+}
+
 void aes_cbc_encrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to) {
   CHECK(from.size() <= to.size());
   CHECK(from.size() % 16 == 0);
@@ -1330,8 +1408,35 @@ static const uint64 crc64_table[256] = {
     0xe0ada17364673f59};
 
 static uint64 crc64_partial(Slice data, uint64 crc) {
-  const char *p = data.begin();
-  for (auto len = data.size(); len > 0; len--) {
+  // slicing-by-8: tables[k][i] is CRC of byte i followed by k zero bytes
+  static uint64 tables_raw[8][256];
+  static const uint64(*tables)[256] = [&] {
+    auto *result = tables_raw;
+    for (int i = 0; i < 256; i++) {
+      result[0][i] = crc64_table[i];
+    }
+    for (int k = 1; k < 8; k++) {
+      for (int i = 0; i < 256; i++) {
+        auto value = result[k - 1][i];
+        result[k][i] = crc64_table[value & 0xff] ^ (value >> 8);
+      }
+    }
+    return result;
+  }();
+
+  const unsigned char *p = data.ubegin();
+  auto len = data.size();
+  while (len >= 8) {
+    crc ^= static_cast<uint64>(p[0]) | (static_cast<uint64>(p[1]) << 8) | (static_cast<uint64>(p[2]) << 16) |
+           (static_cast<uint64>(p[3]) << 24) | (static_cast<uint64>(p[4]) << 32) | (static_cast<uint64>(p[5]) << 40) |
+           (static_cast<uint64>(p[6]) << 48) | (static_cast<uint64>(p[7]) << 56);
+    crc = tables[7][crc & 0xff] ^ tables[6][(crc >> 8) & 0xff] ^ tables[5][(crc >> 16) & 0xff] ^
+          tables[4][(crc >> 24) & 0xff] ^ tables[3][(crc >> 32) & 0xff] ^ tables[2][(crc >> 40) & 0xff] ^
+          tables[1][(crc >> 48) & 0xff] ^ tables[0][crc >> 56];
+    p += 8;
+    len -= 8;
+  }
+  for (; len > 0; len--) {
     crc = crc64_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
   }
   return crc;
@@ -1341,6 +1446,57 @@ uint64 crc64(Slice data) {
   return crc64_partial(data, static_cast<uint64>(-1)) ^ static_cast<uint64>(-1);
 }
 
+namespace {
+
+uint64 gf64_matrix_times(const uint64 *matrix, uint64 vector) {
+  uint64 sum = 0;
+  while (vector) {
+    if (vector & 1) {
+      sum ^= *matrix;
+    }
+    vector >>= 1;
+    matrix++;
+  }
+  return sum;
+}
+
+void gf64_matrix_square(uint64 *square, const uint64 *matrix) {
+  for (int n = 0; n < 64; n++) {
+    square[n] = gf64_matrix_times(matrix, matrix[n]);
+  }
+}
+
+}  // namespace
+
+uint64 crc64_extend(uint64 old_crc, uint64 data_crc, size_t data_size) {
+  static uint64 power_buf_raw[64 * 64];
+  static const uint64 *power_buf = [&] {
+    auto *buf = power_buf_raw;
+    buf[0] = crc64_table[128];
+    for (int n = 0; n < 63; n++) {
+      buf[n + 1] = static_cast<uint64>(1) << n;
+    }
+    for (int n = 1; n < 64; n++) {
+      gf64_matrix_square(buf + (n << 6), buf + ((n - 1) << 6));
+    }
+    return buf;
+  }();
+
+  if (data_size == 0) {
+    return old_crc;
+  }
+
+  const uint64 *p = power_buf + 128;
+  do {
+    p += 64;
+    if (data_size & 1) {
+      old_crc = gf64_matrix_times(p, old_crc);
+    }
+    data_size >>= 1;
+  } while (data_size != 0);
+  return old_crc ^ data_crc;
+}
+
 static const uint16 crc16_table[256] = {
     0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7, 0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad,
     0xe1ce, 0xf1ef, 0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6, 0x9339, 0x8318, 0xb37b, 0xa35a,
@@ -10,6 +10,7 @@
 #include "td/utils/common.h"
 #include "td/utils/SharedSlice.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Span.h"
 #include "td/utils/Status.h"
 
 namespace td {
@@ -44,6 +45,11 @@ class AesState {
 void aes_ige_encrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to);
 void aes_ige_decrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to);
 
+// encrypt or decrypt in place several independent IGE streams with the same key, for example, different parts of a file
+// blocks of different streams are processed together, so hardware AES implementation can pipeline them
+void aes_ige_encrypt_multi(Slice aes_key, Span<MutableSlice> aes_ivs, Span<MutableSlice> data);
+void aes_ige_decrypt_multi(Slice aes_key, Span<MutableSlice> aes_ivs, Span<MutableSlice> data);
+
 class AesIgeStateImpl;
 
 class AesIgeState {
@@ -179,6 +185,9 @@ uint32 crc32c_extend(uint32 old_crc, uint32 new_crc, size_t data_size);
 #endif
 
 uint64 crc64(Slice data);
+
+// returns crc64 of concatenation of data with crc64 equal to old_crc and data of size data_size with crc64 data_crc
+uint64 crc64_extend(uint64 old_crc, uint64 data_crc, size_t data_size);
 uint16 crc16(Slice data);
 
 }  // namespace td
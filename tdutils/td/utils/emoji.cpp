@@ -10,11 +10,18 @@
 #include "td/utils/FlatHashSet.h"
 #include "td/utils/Gzip.h"
 
+#include <bitset>
+
 namespace td {
 
 bool is_emoji(Slice str) {
   constexpr size_t MAX_EMOJI_LENGTH = 38;
-  static const FlatHashSet<Slice, SliceHash> emojis = [max_emoji_length = MAX_EMOJI_LENGTH] {
+  struct Emojis {
+    FlatHashSet<Slice, SliceHash> all_emojis;
+    // allows to reject most non-emoji strings without hashing them
+    std::bitset<256> first_code_units;
+  };
+  static const Emojis emojis = [max_emoji_length = MAX_EMOJI_LENGTH] {
 #if TD_HAVE_ZLIB
     Slice packed_emojis(
         "eJyVvWly20qztTuVL-L7d36dvpmdTcuSbXUm1YKSLDcwIQmSTImSqAZNxB3KewdwdsSdwN1YWAlkVpIQFHGwnE9VViaYVQBYoM5-_7Ex_j__"
@@ -285,7 +292,8 @@ bool is_emoji(Slice str) {
     string all_emojis_str;
     constexpr size_t EMOJI_COUNT = 0;
 #endif
-    FlatHashSet<Slice, SliceHash> all_emojis;
+    Emojis result;
+    auto &all_emojis = result.all_emojis;
     all_emojis.reserve(EMOJI_COUNT);
     for (size_t i = 0; i < all_emojis_str.size(); i++) {
       CHECK(all_emojis_str[i] != ' ');
@@ -296,16 +304,18 @@ bool is_emoji(Slice str) {
       }
       CHECK(j < all_emojis_str.size());
       all_emojis.insert(Slice(&all_emojis_str[i], &all_emojis_str[j]));
+      result.first_code_units.set(static_cast<unsigned char>(all_emojis_str[i]));
       CHECK(j - i <= max_emoji_length);
       i = j;
     }
     CHECK(all_emojis.size() == EMOJI_COUNT);
-    return all_emojis;
+    return result;
   }();
-  if (str.size() > MAX_EMOJI_LENGTH) {
+  if (str.empty() || str.size() > MAX_EMOJI_LENGTH ||
+      !emojis.first_code_units.test(static_cast<unsigned char>(str[0]))) {
     return false;
   }
-  return emojis.count(str) != 0;
+  return emojis.all_emojis.count(str) != 0;
 }
 
 int get_fitzpatrick_modifier(Slice emoji) {
@@ -327,6 +337,31 @@ Slice remove_fitzpatrick_modifier(Slice emoji) {
   return emoji;
 }
 
+// returns length of the emoji modifier starting at the given position or 0 if there is no modifier
+static size_t get_emoji_modifier_length(Slice emoji, size_t pos, bool remove_selectors) {
+  auto left = emoji.size() - pos;
+  if (left < 3) {
+    return 0;
+  }
+  auto c = emoji.ubegin() + pos;
+  switch (c[0]) {
+    case 0xEF:
+      // variation selector-16 \uFE0F
+      return remove_selectors && c[1] == 0xB8 && c[2] == 0x8F ? 3 : 0;
+    case 0xE2:
+      // zero width joiner \u200D + female sign \u2640 or male sign \u2642
+      return left >= 6 && c[1] == 0x80 && c[2] == 0x8D && c[3] == 0xE2 && c[4] == 0x99 &&
+                     (c[5] == 0x80 || c[5] == 0x82)
+                 ? 6
+                 : 0;
+    case 0xF0:
+      // emoji modifiers Fitzpatrick \U0001F3FB-\U0001F3FF
+      return left >= 4 && c[1] == 0x9F && c[2] == 0x8F && 0xBB <= c[3] && c[3] <= 0xBF ? 4 : 0;
+    default:
+      return 0;
+  }
+}
+
 string remove_emoji_modifiers(Slice emoji, bool remove_selectors) {
   string result = emoji.str();
   remove_emoji_modifiers_in_place(result, remove_selectors);
@@ -334,28 +369,13 @@ string remove_emoji_modifiers(Slice emoji, bool remove_selectors) {
 }
 
 void remove_emoji_modifiers_in_place(string &emoji, bool remove_selectors) {
-  static const Slice modifiers[] = {u8"\uFE0F" /* variation selector-16 */,
-                                    u8"\u200D\u2640" /* zero width joiner + female sign */,
-                                    u8"\u200D\u2642" /* zero width joiner + male sign */,
-                                    u8"\U0001F3FB" /* emoji modifier fitzpatrick type-1-2 */,
-                                    u8"\U0001F3FC" /* emoji modifier fitzpatrick type-3 */,
-                                    u8"\U0001F3FD" /* emoji modifier fitzpatrick type-4 */,
-                                    u8"\U0001F3FE" /* emoji modifier fitzpatrick type-5 */,
-                                    u8"\U0001F3FF" /* emoji modifier fitzpatrick type-6 */};
-  const size_t start_index = remove_selectors ? 0 : 1;
   size_t j = 0;
   for (size_t i = 0; i < emoji.size();) {
-    bool is_found = false;
-    for (size_t k = start_index; k < sizeof(modifiers) / sizeof(*modifiers); k++) {
-      auto length = modifiers[k].size();
-      if (i + length <= emoji.size() && Slice(&emoji[i], length) == modifiers[k]) {
-        // skip the modifier
-        i += length;
-        is_found = true;
-        break;
-      }
-    }
-    if (!is_found) {
+    auto modifier_length = get_emoji_modifier_length(emoji, i, remove_selectors);
+    if (modifier_length != 0) {
+      // skip the modifier
+      i += modifier_length;
+    } else {
       emoji[j++] = emoji[i++];
     }
   }
@@ -364,8 +384,31 @@ void remove_emoji_modifiers_in_place(string &emoji, bool remove_selectors) {
   }
 }
 
+bool is_emoji_without_modifiers_equal(Slice emoji, Slice other, bool remove_selectors) {
+  size_t j = 0;
+  size_t i = 0;
+  while (i < emoji.size()) {
+    auto modifier_length = get_emoji_modifier_length(emoji, i, remove_selectors);
+    if (modifier_length != 0) {
+      i += modifier_length;
+      continue;
+    }
+    if (j == other.size() || emoji[i] != other[j]) {
+      return false;
+    }
+    i++;
+    j++;
+  }
+  if (j == 0) {
+    // remove_emoji_modifiers_in_place keeps strings consisting only of modifiers as is
+    return emoji == other;
+  }
+  return j == other.size();
+}
+
 string remove_emoji_selectors(Slice emoji) {
-  if (!is_emoji(emoji)) {
+  // \uFE0F is encoded as "\xEF\xB8\x8F"
+  if (emoji.find('\xEF') == Slice::npos || !is_emoji(emoji)) {
     return emoji.str();
   }
   string str;
@@ -377,7 +420,7 @@ string remove_emoji_selectors(Slice emoji) {
       str += emoji[i];
     }
   }
-  CHECK(is_emoji(str));
+  DCHECK(is_emoji(str));
   return str;
 }
 
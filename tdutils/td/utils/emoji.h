@@ -26,6 +26,9 @@ string remove_emoji_modifiers(Slice emoji, bool remove_selectors = true);
 // removes all emoji modifiers from the string in-place
 void remove_emoji_modifiers_in_place(string &emoji, bool remove_selectors = true);
 
+// checks whether remove_emoji_modifiers(emoji, remove_selectors) == other without memory allocations
+bool is_emoji_without_modifiers_equal(Slice emoji, Slice other, bool remove_selectors = true);
+
 // removes all emoji selectors from the string if it is an emoji
 string remove_emoji_selectors(Slice emoji);
 
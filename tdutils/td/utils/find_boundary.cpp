@@ -6,17 +6,103 @@
 //
 #include "td/utils/find_boundary.h"
 
+#include "td/utils/bits.h"
+
 #include <cstring>
 
+#if defined(__SSE2__) || (TD_MSVC && (defined(_M_X64) || (defined(_M_IX86) && _M_IX86_FP >= 2)))
+#define TD_SSE2 1
+#endif
+
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
+#if TD_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace td {
 
+// returns the first position in [0, candidate_count), at which the boundary begins, or candidate_count if there is none
+// the boundary must fit in the data at all candidate positions
+static size_t find_boundary_in_slice(const char *data, size_t candidate_count, Slice boundary) {
+  const char first = boundary[0];
+  const char last = boundary.back();
+  const size_t last_offset = boundary.size() - 1;
+  size_t pos = 0;
+  // compare simultaneously the first and the last characters of the boundary with 16 candidates
+#if TD_SSE2
+  const auto firsts = _mm_set1_epi8(first);
+  const auto lasts = _mm_set1_epi8(last);
+  while (candidate_count - pos >= 16) {
+    auto first_chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    auto last_chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos + last_offset));
+    auto mask = static_cast<uint32>(
+        _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first_chars, firsts), _mm_cmpeq_epi8(last_chars, lasts))));
+    while (mask != 0) {
+      auto candidate = pos + count_trailing_zeroes_non_zero32(mask);
+      if (std::memcmp(data + candidate + 1, boundary.data() + 1, last_offset) == 0) {
+        return candidate;
+      }
+      mask &= mask - 1;
+    }
+    pos += 16;
+  }
+#elif defined(__aarch64__)
+  const auto firsts = vdupq_n_u8(static_cast<uint8>(first));
+  const auto lasts = vdupq_n_u8(static_cast<uint8>(last));
+  while (candidate_count - pos >= 16) {
+    auto first_chars = vld1q_u8(reinterpret_cast<const uint8_t *>(data + pos));
+    auto last_chars = vld1q_u8(reinterpret_cast<const uint8_t *>(data + pos + last_offset));
+    auto matches = vandq_u8(vceqq_u8(first_chars, firsts), vceqq_u8(last_chars, lasts));
+    // each candidate is represented by 4 bits of the mask
+    auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+    while (mask != 0) {
+      auto candidate = pos + count_trailing_zeroes_non_zero64(mask) / 4;
+      if (std::memcmp(data + candidate + 1, boundary.data() + 1, last_offset) == 0) {
+        return candidate;
+      }
+      mask &= ~(static_cast<uint64>(15) << (count_trailing_zeroes_non_zero64(mask) & ~3));
+    }
+    pos += 16;
+  }
+#endif
+  while (pos < candidate_count) {
+    const auto *ptr = static_cast<const char *>(std::memchr(data + pos, first, candidate_count - pos));
+    if (ptr == nullptr) {
+      return candidate_count;
+    }
+    pos = ptr - data;
+    if (data[pos + last_offset] == last && std::memcmp(data + pos + 1, boundary.data() + 1, last_offset) == 0) {
+      return pos;
+    }
+    pos++;
+  }
+  return candidate_count;
+}
+
 bool find_boundary(ChainBufferReader range, Slice boundary, size_t &already_read) {
   range.advance(already_read);
 
   const int MAX_BOUNDARY_LENGTH = 70;
+  CHECK(!boundary.empty());
   CHECK(boundary.size() <= MAX_BOUNDARY_LENGTH + 4);
   while (!range.empty()) {
     Slice ready = range.prepare_read();
+    if (ready.size() >= boundary.size()) {
+      // fast path: check all positions, at which the boundary fits in the current chunk
+      auto candidate_count = ready.size() - boundary.size() + 1;
+      auto shift = find_boundary_in_slice(ready.data(), candidate_count, boundary);
+      already_read += shift;
+      if (shift < candidate_count) {
+        return true;
+      }
+      range.advance(shift);
+      continue;
+    }
+
+    // the boundary can span several chunks
     if (ready[0] == boundary[0]) {
       if (range.size() < boundary.size()) {
         return false;
@@ -0,0 +1,339 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/port/FileIoUring.h"
+
+#include "td/utils/port/config.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#if TD_LINUX && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include "td/utils/port/detail/NativeFd.h"
+#include "td/utils/port/detail/skip_eintr.h"
+#include "td/utils/port/EventFd.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define TD_FILE_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace td {
+namespace detail {
+
+#if TD_FILE_IO_URING
+static int io_uring_setup(uint32 entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ring_fd, uint32 to_submit, uint32 min_complete, uint32 flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+static int io_uring_register(int ring_fd, uint32 opcode, const void *arg, uint32 arg_count) {
+  return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, arg_count));
+}
+
+class FileIoUringImpl {
+ public:
+  FileIoUringImpl() = default;
+  FileIoUringImpl(const FileIoUringImpl &) = delete;
+  FileIoUringImpl &operator=(const FileIoUringImpl &) = delete;
+  FileIoUringImpl(FileIoUringImpl &&) = delete;
+  FileIoUringImpl &operator=(FileIoUringImpl &&) = delete;
+  ~FileIoUringImpl() {
+    wait_all();
+    unmap(sqes_, sqes_size_);
+    unmap(cq_ring_, cq_ring_size_);
+    unmap(sq_ring_, sq_ring_size_);
+  }
+
+  Status init(size_t max_pending_query_count) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = NativeFd(io_uring_setup(narrow_cast<uint32>(max_pending_query_count), &params));
+    if (!ring_fd_) {
+      return OS_ERROR("io_uring_setup failed");
+    }
+
+    // separate mappings of the rings are supported by all kernels
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32);
+    TRY_RESULT_ASSIGN(sq_ring_, map(sq_ring_size_, IORING_OFF_SQ_RING));
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    TRY_RESULT_ASSIGN(cq_ring_, map(cq_ring_size_, IORING_OFF_CQ_RING));
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    TRY_RESULT_ASSIGN(sqes_, map(sqes_size_, IORING_OFF_SQES));
+
+    auto sq_ring = static_cast<char *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<uint32 *>(sq_ring + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<uint32 *>(sq_ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32 *>(sq_ring + params.sq_off.array);
+    auto cq_ring = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<uint32 *>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32 *>(cq_ring + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<uint32 *>(cq_ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq_ring + params.cq_off.cqes);
+
+    event_fd_.init();
+    int event_fd = event_fd_.get_poll_info().native_fd().fd();
+    if (io_uring_register(ring_fd_.fd(), IORING_REGISTER_EVENTFD, &event_fd, 1) < 0) {
+      return OS_ERROR("io_uring_register failed");
+    }
+
+    // the completion queue is at least as big as the submission queue, so it can't overflow
+    auto query_count = td::min(max_pending_query_count, static_cast<size_t>(params.sq_entries));
+    queries_.resize(query_count);
+    for (size_t i = query_count; i > 0; i--) {
+      free_query_ids_.push_back(narrow_cast<uint32>(i - 1));
+    }
+    return Status::OK();
+  }
+
+  PollableFdInfo &get_poll_info() {
+    return event_fd_.get_poll_info();
+  }
+
+  bool can_submit() const {
+    return !free_query_ids_.empty();
+  }
+
+  size_t get_pending_query_count() const {
+    return queries_.size() - free_query_ids_.size();
+  }
+
+  Status submit(uint8 opcode, const FileFd &fd, void *data, size_t size, int64 offset, uint64 token) {
+    if (free_query_ids_.empty()) {
+      return Status::Error("Too many pending queries");
+    }
+    auto query_id = free_query_ids_.back();
+    auto &query = queries_[query_id];
+    query.token = token;
+    query.iov.iov_base = data;
+    query.iov.iov_len = size;
+
+    // the object is the only producer, so the tail can be read without synchronization
+    auto tail = *sq_tail_;
+    auto index = tail & sq_mask_;
+    auto &sqe = static_cast<io_uring_sqe *>(sqes_)[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = fd.get_native_fd().fd();
+    sqe.off = static_cast<uint64>(offset);
+    sqe.addr = reinterpret_cast<uint64>(&query.iov);
+    sqe.len = 1;
+    sqe.user_data = query_id;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    auto submitted = skip_eintr([&] { return io_uring_enter(ring_fd_.fd(), 1, 0, 0); });
+    if (submitted != 1) {
+      auto io_uring_enter_errno = errno;
+      __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+      if (submitted < 0) {
+        return Status::PosixError(io_uring_enter_errno, "io_uring_enter failed");
+      }
+      return Status::Error("Failed to submit a query");
+    }
+    free_query_ids_.pop_back();
+    return Status::OK();
+  }
+
+  vector<FileIoUring::Completion> get_completions() {
+    event_fd_.acquire();
+    reap_completions();
+    auto result = std::move(completions_);
+    completions_.clear();
+    return result;
+  }
+
+  void wait_all() {
+    while (true) {
+      reap_completions();
+      if (get_pending_query_count() == 0) {
+        break;
+      }
+      auto result = skip_eintr([&] { return io_uring_enter(ring_fd_.fd(), 0, 1, IORING_ENTER_GETEVENTS); });
+      if (result < 0) {
+        auto error = OS_ERROR("io_uring_enter failed");
+        LOG(FATAL) << "Failed to wait for pending file queries: " << error;
+      }
+    }
+  }
+
+ private:
+  struct Query {
+    uint64 token = 0;
+    iovec iov;
+  };
+
+  NativeFd ring_fd_;
+  EventFd event_fd_;
+
+  void *sq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = MAP_FAILED;
+  size_t cq_ring_size_ = 0;
+  void *sqes_ = MAP_FAILED;
+  size_t sqes_size_ = 0;
+
+  uint32 *sq_tail_ = nullptr;
+  uint32 sq_mask_ = 0;
+  uint32 *sq_array_ = nullptr;
+  uint32 *cq_head_ = nullptr;
+  uint32 *cq_tail_ = nullptr;
+  uint32 cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+
+  // iovec structures must stay valid until the queries are completed, so the vector is never resized after init
+  vector<Query> queries_;
+  vector<uint32> free_query_ids_;
+  vector<FileIoUring::Completion> completions_;
+
+  Result<void *> map(size_t size, int64 offset) {
+    auto result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_.fd(), offset);
+    if (result == MAP_FAILED) {
+      return OS_ERROR("mmap failed");
+    }
+    return result;
+  }
+
+  static void unmap(void *ptr, size_t size) {
+    if (ptr != MAP_FAILED) {
+      munmap(ptr, size);
+    }
+  }
+
+  void reap_completions() {
+    if (!cqes_) {
+      return;
+    }
+    auto head = *cq_head_;
+    auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+      const auto &cqe = cqes_[head & cq_mask_];
+      auto query_id = narrow_cast<uint32>(cqe.user_data);
+      CHECK(query_id < queries_.size());
+      FileIoUring::Completion completion;
+      completion.token = queries_[query_id].token;
+      if (cqe.res >= 0) {
+        completion.result = static_cast<size_t>(cqe.res);
+      } else {
+        completion.result = Status::PosixError(-cqe.res, "Asynchronous file query failed");
+      }
+      completions_.push_back(std::move(completion));
+      free_query_ids_.push_back(query_id);
+      head++;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+};
+#else
+class FileIoUringImpl {};
+#endif
+
+}  // namespace detail
+
+FileIoUring::FileIoUring() = default;
+FileIoUring::FileIoUring(FileIoUring &&) noexcept = default;
+FileIoUring &FileIoUring::operator=(FileIoUring &&) noexcept = default;
+FileIoUring::~FileIoUring() = default;
+
+Status FileIoUring::init(size_t max_pending_query_count) {
+  CHECK(max_pending_query_count > 0);
+#if TD_FILE_IO_URING
+  auto impl = make_unique<detail::FileIoUringImpl>();
+  TRY_STATUS(impl->init(max_pending_query_count));
+  impl_ = std::move(impl);
+  return Status::OK();
+#else
+  return Status::Error("io_uring isn't supported");
+#endif
+}
+
+bool FileIoUring::empty() const {
+  return !impl_;
+}
+
+void FileIoUring::close() {
+  impl_.reset();
+}
+
+#if TD_FILE_IO_URING
+PollableFdInfo &FileIoUring::get_poll_info() {
+  return impl_->get_poll_info();
+}
+
+bool FileIoUring::can_submit() const {
+  return impl_ && impl_->can_submit();
+}
+
+size_t FileIoUring::get_pending_query_count() const {
+  return impl_ ? impl_->get_pending_query_count() : 0;
+}
+
+Status FileIoUring::submit_pread(const FileFd &fd, MutableSlice slice, int64 offset, uint64 token) {
+  CHECK(impl_);
+  return impl_->submit(IORING_OP_READV, fd, slice.begin(), slice.size(), offset, token);
+}
+
+Status FileIoUring::submit_pwrite(const FileFd &fd, Slice slice, int64 offset, uint64 token) {
+  CHECK(impl_);
+  return impl_->submit(IORING_OP_WRITEV, fd, const_cast<char *>(slice.begin()), slice.size(), offset, token);
+}
+
+vector<FileIoUring::Completion> FileIoUring::get_completions() {
+  if (!impl_) {
+    return {};
+  }
+  return impl_->get_completions();
+}
+
+void FileIoUring::wait_all() {
+  if (impl_) {
+    impl_->wait_all();
+  }
+}
+#else
+PollableFdInfo &FileIoUring::get_poll_info() {
+  UNREACHABLE();
+}
+
+bool FileIoUring::can_submit() const {
+  return false;
+}
+
+size_t FileIoUring::get_pending_query_count() const {
+  return 0;
+}
+
+Status FileIoUring::submit_pread(const FileFd &fd, MutableSlice slice, int64 offset, uint64 token) {
+  return Status::Error("io_uring isn't supported");
+}
+
+Status FileIoUring::submit_pwrite(const FileFd &fd, Slice slice, int64 offset, uint64 token) {
+  return Status::Error("io_uring isn't supported");
+}
+
+vector<FileIoUring::Completion> FileIoUring::get_completions() {
+  return {};
+}
+
+void FileIoUring::wait_all() {
+}
+#endif
+
+}  // namespace td
@@ -0,0 +1,64 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/port/detail/PollableFd.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+namespace detail {
+class FileIoUringImpl;
+}  // namespace detail
+
+// asynchronous pread/pwrite through Linux io_uring
+// completion of queries is signalled through a pollable fd, so the object can be subscribed to Poll
+class FileIoUring {
+ public:
+  struct Completion {
+    uint64 token = 0;
+    Result<size_t> result;
+  };
+
+  FileIoUring();
+  FileIoUring(FileIoUring &&) noexcept;
+  FileIoUring &operator=(FileIoUring &&) noexcept;
+  FileIoUring(const FileIoUring &) = delete;
+  FileIoUring &operator=(const FileIoUring &) = delete;
+  ~FileIoUring();
+
+  // fails if io_uring isn't supported by the system
+  Status init(size_t max_pending_query_count) TD_WARN_UNUSED_RESULT;
+
+  bool empty() const;
+
+  // waits for completion of all pending queries
+  void close();
+
+  PollableFdInfo &get_poll_info();
+
+  bool can_submit() const;
+
+  size_t get_pending_query_count() const;
+
+  // the slice must be kept alive until the query is completed; the file can be closed right after the submission
+  Status submit_pread(const FileFd &fd, MutableSlice slice, int64 offset, uint64 token) TD_WARN_UNUSED_RESULT;
+  Status submit_pwrite(const FileFd &fd, Slice slice, int64 offset, uint64 token) TD_WARN_UNUSED_RESULT;
+
+  // returns results of all completed queries
+  vector<Completion> get_completions();
+
+  // blocks until all pending queries are completed; their results are returned by the next get_completions call
+  void wait_all();
+
+ private:
+  unique_ptr<detail::FileIoUringImpl> impl_;
+};
+
+}  // namespace td
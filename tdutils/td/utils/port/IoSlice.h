@@ -9,6 +9,7 @@
 #include "td/utils/Slice.h"
 
 #if TD_PORT_POSIX
+#include <climits>
 #include <sys/uio.h>
 #endif
 
@@ -18,6 +19,13 @@ namespace td {
 
 using IoSlice = struct iovec;
 
+// maximum number of slices, which can be passed to a single writev call
+#ifdef IOV_MAX
+constexpr size_t MAX_IO_SLICE_COUNT = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+constexpr size_t MAX_IO_SLICE_COUNT = 16;
+#endif
+
 inline IoSlice as_io_slice(Slice slice) {
   IoSlice res;
   res.iov_len = slice.size();
@@ -33,6 +41,8 @@ inline Slice as_slice(const IoSlice &io_slice) {
 
 using IoSlice = Slice;
 
+constexpr size_t MAX_IO_SLICE_COUNT = 1024;
+
 inline IoSlice as_io_slice(Slice slice) {
   return slice;
 }
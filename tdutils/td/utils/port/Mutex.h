@@ -6,25 +6,50 @@
 //
 #pragma once
 
+#include "td/utils/common.h"
+#include "td/utils/LockStatistics.h"
+
 #include <mutex>
 
 namespace td {
 
 class Mutex {
  public:
+  Mutex() = default;
+
+  // the name is used to group lock statistics and must be a string literal
+  explicit Mutex(const char *name) : name_(name) {
+  }
+
   struct Guard {
     std::unique_lock<std::mutex> guard;
+    LockStatistics::Holder holder;
     void reset() {
+      holder.reset();
       guard.unlock();
     }
   };
 
   Guard lock() {
+    if (unlikely(LockStatistics::is_enabled())) {
+      return lock_with_statistics();
+    }
     return {std::unique_lock<std::mutex>(mutex_)};
   }
 
  private:
   std::mutex mutex_;
+  const char *name_ = "Mutex";
+
+  Guard lock_with_statistics() {
+    std::unique_lock<std::mutex> guard(mutex_, std::try_to_lock);
+    double wait_start_time = -1.0;
+    if (!guard.owns_lock()) {
+      wait_start_time = LockStatistics::now();
+      guard.lock();
+    }
+    return {std::move(guard), LockStatistics::on_lock(name_, false, wait_start_time)};
+  }
 };
 
 }  // namespace td
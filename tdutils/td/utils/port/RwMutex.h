@@ -9,6 +9,7 @@
 #include "td/utils/port/config.h"
 
 #include "td/utils/common.h"
+#include "td/utils/LockStatistics.h"
 #include "td/utils/Status.h"
 
 #if TD_PORT_POSIX
@@ -24,13 +25,18 @@ class RwMutex {
   RwMutex() {
     init();
   }
+  // the name is used to group lock statistics and must be a string literal
+  explicit RwMutex(const char *name) : name_(name) {
+    init();
+  }
   RwMutex(const RwMutex &) = delete;
   RwMutex &operator=(const RwMutex &) = delete;
-  RwMutex(RwMutex &&other) noexcept {
+  RwMutex(RwMutex &&other) noexcept : name_(other.name_) {
     init();
     other.clear();
   }
   RwMutex &operator=(RwMutex &&other) noexcept {
+    name_ = other.name_;
     other.clear();
     return *this;
   }
@@ -47,12 +53,16 @@ class RwMutex {
   void clear();
 
   struct ReadUnlock {
+    LockStatistics::Holder holder;
     void operator()(RwMutex *ptr) {
+      holder.reset();
       ptr->unlock_read_unsafe();
     }
   };
   struct WriteUnlock {
+    LockStatistics::Holder holder;
     void operator()(RwMutex *ptr) {
+      holder.reset();
       ptr->unlock_write_unsafe();
     }
   };
@@ -61,11 +71,27 @@ class RwMutex {
   using WriteLock = std::unique_ptr<RwMutex, WriteUnlock>;
 
   Result<ReadLock> lock_read() TD_WARN_UNUSED_RESULT {
+    if (unlikely(LockStatistics::is_enabled())) {
+      double wait_start_time = -1.0;
+      if (!try_lock_read_unsafe()) {
+        wait_start_time = LockStatistics::now();
+        lock_read_unsafe();
+      }
+      return ReadLock(this, ReadUnlock{LockStatistics::on_lock(name_, true, wait_start_time)});
+    }
     lock_read_unsafe();
     return ReadLock(this);
   }
 
   Result<WriteLock> lock_write() TD_WARN_UNUSED_RESULT {
+    if (unlikely(LockStatistics::is_enabled())) {
+      double wait_start_time = -1.0;
+      if (!try_lock_write_unsafe()) {
+        wait_start_time = LockStatistics::now();
+        lock_write_unsafe();
+      }
+      return WriteLock(this, WriteUnlock{LockStatistics::on_lock(name_, false, wait_start_time)});
+    }
     lock_write_unsafe();
     return WriteLock(this);
   }
@@ -74,12 +100,17 @@ class RwMutex {
 
   void lock_write_unsafe();
 
+  bool try_lock_read_unsafe();
+
+  bool try_lock_write_unsafe();
+
   void unlock_read_unsafe();
 
   void unlock_write_unsafe();
 
  private:
   bool is_valid_ = false;
+  const char *name_ = "RwMutex";
 #if TD_PORT_POSIX
   pthread_rwlock_t mutex_;
 #elif TD_PORT_WINDOWS
@@ -128,6 +159,24 @@ inline void RwMutex::lock_write_unsafe() {
 #endif
 }
 
+inline bool RwMutex::try_lock_read_unsafe() {
+  CHECK(!empty());
+#if TD_PORT_POSIX
+  return pthread_rwlock_tryrdlock(&mutex_) == 0;
+#elif TD_PORT_WINDOWS
+  return TryAcquireSRWLockShared(mutex_.get()) != 0;
+#endif
+}
+
+inline bool RwMutex::try_lock_write_unsafe() {
+  CHECK(!empty());
+#if TD_PORT_POSIX
+  return pthread_rwlock_trywrlock(&mutex_) == 0;
+#elif TD_PORT_WINDOWS
+  return TryAcquireSRWLockExclusive(mutex_.get()) != 0;
+#endif
+}
+
 inline void RwMutex::unlock_read_unsafe() {
   CHECK(!empty());
 #if TD_PORT_POSIX
@@ -6,6 +6,7 @@
 //
 #pragma once
 
+#include "td/utils/config.h"
 #include "td/utils/port/platform.h"
 
 // clang-format off
@@ -44,7 +45,9 @@
   #error "Poll's implementation is not defined"
 #endif
 
-#if TD_EMSCRIPTEN
+#if TD_EMSCRIPTEN && TD_EMSCRIPTEN_PTHREADS
+  #define TD_THREAD_PTHREAD 1
+#elif TD_EMSCRIPTEN
   #define TD_THREAD_UNSUPPORTED 1
 #elif TD_WINDOWS
   #define TD_THREAD_STL 1
@@ -0,0 +1,389 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/port/detail/IoUringPoll.h"
+
+char disable_linker_warning_about_empty_file_io_uring_poll_cpp TD_UNUSED;
+
+#if defined(TD_POLL_EPOLL) && TD_USE_IO_URING_POLL
+
+#include "td/utils/logging.h"
+#include "td/utils/port/detail/NativeFd.h"
+#include "td/utils/port/detail/skip_eintr.h"
+#include "td/utils/Status.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_POLL_ADD_MULTI) && \
+    defined(IORING_FEAT_CQE_SKIP) && defined(IORING_ENTER_EXT_ARG)
+#define TD_IO_URING_POLL_SUPPORTED 1
+#endif
+#endif
+#endif
+
+namespace td {
+namespace detail {
+
+static std::atomic<bool> is_io_uring_poll_enabled{true};
+
+#if TD_IO_URING_POLL_SUPPORTED
+class IoUringPoll::Ring {
+ public:
+  struct Completion {
+    uint64 user_data;
+    int32 result;
+    bool has_more;
+  };
+
+  Ring() = default;
+  Ring(const Ring &) = delete;
+  Ring &operator=(const Ring &) = delete;
+  Ring(Ring &&) = delete;
+  Ring &operator=(Ring &&) = delete;
+  ~Ring() {
+    unmap(sqes_, sqes_size_);
+    unmap(cq_ring_, cq_ring_size_);
+    unmap(sq_ring_, sq_ring_size_);
+  }
+
+  Status init() {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = CQ_ENTRIES;
+    ring_fd_ = NativeFd(static_cast<int>(syscall(__NR_io_uring_setup, SQ_ENTRIES, &params)));
+    if (!ring_fd_) {
+      return OS_ERROR("io_uring_setup failed");
+    }
+    // multishot poll requests and waiting with a timeout were added in earlier kernel versions than CQE_SKIP
+    if ((params.features & IORING_FEAT_CQE_SKIP) == 0 || (params.features & IORING_FEAT_EXT_ARG) == 0 ||
+        (params.features & IORING_FEAT_NODROP) == 0) {
+      return Status::Error("io_uring is too old");
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32);
+    TRY_RESULT_ASSIGN(sq_ring_, map(sq_ring_size_, IORING_OFF_SQ_RING));
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    TRY_RESULT_ASSIGN(cq_ring_, map(cq_ring_size_, IORING_OFF_CQ_RING));
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    TRY_RESULT_ASSIGN(sqes_, map(sqes_size_, IORING_OFF_SQES));
+
+    auto sq_ring = static_cast<char *>(sq_ring_);
+    sq_head_ = reinterpret_cast<uint32 *>(sq_ring + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32 *>(sq_ring + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<uint32 *>(sq_ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32 *>(sq_ring + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    auto cq_ring = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<uint32 *>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32 *>(cq_ring + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<uint32 *>(cq_ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq_ring + params.cq_off.cqes);
+    return Status::OK();
+  }
+
+  void add_poll(int native_fd, uint32 events, uint64 user_data) {
+    auto &sqe = get_sqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = native_fd;
+    sqe.len = IORING_POLL_ADD_MULTI;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    events = (events << 16) | (events >> 16);  // the kernel expects swapped 16-bit halves
+#endif
+    sqe.poll32_events = events;
+    sqe.user_data = user_data;
+    push_sqe();
+  }
+
+  void remove_poll(uint64 user_data) {
+    auto &sqe = get_sqe();
+    sqe.opcode = IORING_OP_POLL_REMOVE;
+    sqe.fd = -1;
+    sqe.addr = user_data;
+    sqe.flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe.user_data = 0;
+    push_sqe();
+  }
+
+  // submits all pending requests and waits for at least one completion for at most timeout_ms milliseconds
+  void submit_and_wait(int timeout_ms) {
+    uint32 min_complete = 0;
+    __kernel_timespec timeout;
+    io_uring_getevents_arg arg;
+    std::memset(&arg, 0, sizeof(arg));
+    if (timeout_ms != 0 && !has_completions()) {
+      min_complete = 1;
+      if (timeout_ms > 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64>(&timeout);
+      }
+    }
+
+    // GETEVENTS is needed even without waiting to move completions from the kernel overflow list to the ring
+    auto flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    auto result = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_.fd(), pending_sqe_count_, min_complete,
+                                           flags, &arg, sizeof(arg)));
+    auto io_uring_enter_errno = errno;
+    if (result >= 0) {
+      pending_sqe_count_ -= td::min(pending_sqe_count_, static_cast<uint32>(result));
+      return;
+    }
+    LOG_IF(FATAL, io_uring_enter_errno != EINTR && io_uring_enter_errno != ETIME &&
+                      io_uring_enter_errno != EAGAIN && io_uring_enter_errno != EBUSY)
+        << Status::PosixError(io_uring_enter_errno, "io_uring_enter failed");
+  }
+
+  template <class F>
+  void for_each_completion(F &&f) {
+    auto head = *cq_head_;
+    auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+      const auto &cqe = cqes_[head & cq_mask_];
+      Completion completion{cqe.user_data, cqe.res, (cqe.flags & IORING_CQE_F_MORE) != 0};
+      head++;
+      // the entry is released before the callback, which can submit new requests
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      f(completion);
+    }
+  }
+
+ private:
+  static constexpr uint32 SQ_ENTRIES = 1024;
+  static constexpr uint32 CQ_ENTRIES = 16384;
+
+  NativeFd ring_fd_;
+
+  void *sq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = MAP_FAILED;
+  size_t cq_ring_size_ = 0;
+  void *sqes_ = MAP_FAILED;
+  size_t sqes_size_ = 0;
+
+  uint32 *sq_head_ = nullptr;
+  uint32 *sq_tail_ = nullptr;
+  uint32 sq_mask_ = 0;
+  uint32 *sq_array_ = nullptr;
+  uint32 sq_entries_ = 0;
+  uint32 pending_sqe_count_ = 0;
+  uint32 *cq_head_ = nullptr;
+  uint32 *cq_tail_ = nullptr;
+  uint32 cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+
+  Result<void *> map(size_t size, int64 offset) {
+    auto result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_.fd(), offset);
+    if (result == MAP_FAILED) {
+      return OS_ERROR("mmap failed");
+    }
+    return result;
+  }
+
+  static void unmap(void *ptr, size_t size) {
+    if (ptr != MAP_FAILED) {
+      munmap(ptr, size);
+    }
+  }
+
+  bool has_completions() const {
+    return *cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  }
+
+  io_uring_sqe &get_sqe() {
+    // the object is the only producer, so the tail can be read without synchronization
+    auto tail = *sq_tail_;
+    if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+      submit_and_wait(0);
+      CHECK(tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) < sq_entries_);
+    }
+    auto &sqe = static_cast<io_uring_sqe *>(sqes_)[tail & sq_mask_];
+    std::memset(&sqe, 0, sizeof(sqe));
+    return sqe;
+  }
+
+  void push_sqe() {
+    auto tail = *sq_tail_;
+    auto index = tail & sq_mask_;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    pending_sqe_count_++;
+  }
+};
+#else
+class IoUringPoll::Ring {
+ public:
+  struct Completion {
+    uint64 user_data;
+    int32 result;
+    bool has_more;
+  };
+
+  Status init() {
+    return Status::Error("io_uring isn't supported");
+  }
+
+  void add_poll(int native_fd, uint32 events, uint64 user_data) {
+    UNREACHABLE();
+  }
+
+  void remove_poll(uint64 user_data) {
+    UNREACHABLE();
+  }
+
+  void submit_and_wait(int timeout_ms) {
+    UNREACHABLE();
+  }
+
+  template <class F>
+  void for_each_completion(F &&f) {
+    UNREACHABLE();
+  }
+};
+#endif
+
+IoUringPoll::IoUringPoll() = default;
+
+IoUringPoll::~IoUringPoll() = default;
+
+void IoUringPoll::set_io_uring_enabled(bool is_enabled) {
+  is_io_uring_poll_enabled.store(is_enabled, std::memory_order_relaxed);
+}
+
+void IoUringPoll::init() {
+  CHECK(ring_ == nullptr);
+  if (is_io_uring_poll_enabled.load(std::memory_order_relaxed)) {
+    auto ring = make_unique<Ring>();
+    auto status = ring->init();
+    if (status.is_ok()) {
+      ring_ = std::move(ring);
+      return;
+    }
+    LOG(INFO) << "Use epoll instead of io_uring: " << status;
+  }
+  epoll_.init();
+}
+
+void IoUringPoll::clear() {
+  if (ring_ == nullptr) {
+    return epoll_.clear();
+  }
+  ring_ = nullptr;
+  subscriptions_.clear();
+  subscription_ids_.clear();
+
+  for (auto *list_node = list_root_.next; list_node != &list_root_;) {
+    auto pollable_fd = PollableFd::from_list_node(list_node);
+    list_node = list_node->next;
+  }
+}
+
+void IoUringPoll::add_poll(uint64 subscription_id, const Subscription &subscription) {
+  ring_->add_poll(subscription.native_fd, subscription.events, subscription_id);
+}
+
+void IoUringPoll::subscribe(PollableFd fd, PollFlags flags) {
+  if (ring_ == nullptr) {
+    return epoll_.subscribe(std::move(fd), flags);
+  }
+
+  Subscription subscription;
+  subscription.native_fd = fd.native_fd().fd();
+  subscription.events = POLLHUP | POLLERR | POLLRDHUP;
+  if (flags.can_read()) {
+    subscription.events |= POLLIN;
+  }
+  if (flags.can_write()) {
+    subscription.events |= POLLOUT;
+  }
+  subscription.list_node = fd.release_as_list_node();
+  list_root_.put(subscription.list_node);
+
+  // completions are matched by identifiers, because they can arrive after the file descriptor is unsubscribed
+  auto subscription_id = ++max_subscription_id_;
+  subscription_ids_[subscription.list_node] = subscription_id;
+  subscriptions_[subscription_id] = subscription;
+  add_poll(subscription_id, subscription);
+}
+
+void IoUringPoll::unsubscribe(PollableFdRef fd_ref) {
+  if (ring_ == nullptr) {
+    return epoll_.unsubscribe(fd_ref);
+  }
+
+  auto *list_node = fd_ref.lock().release_as_list_node();
+  auto fd = PollableFd::from_list_node(list_node);
+  auto it = subscription_ids_.find(list_node);
+  LOG_CHECK(it != subscription_ids_.end()) << "Unsubscribe not subscribed " << fd.native_fd();
+  auto subscription_id = it->second;
+  subscription_ids_.erase(it);
+  subscriptions_.erase(subscription_id);
+  ring_->remove_poll(subscription_id);
+}
+
+void IoUringPoll::unsubscribe_before_close(PollableFdRef fd) {
+  unsubscribe(fd);
+}
+
+void IoUringPoll::run(int timeout_ms) {
+  if (ring_ == nullptr) {
+    return epoll_.run(timeout_ms);
+  }
+
+  ring_->submit_and_wait(timeout_ms);
+  ring_->for_each_completion([&](const Ring::Completion &completion) {
+    auto it = subscriptions_.find(completion.user_data);
+    if (it == subscriptions_.end()) {
+      // the file descriptor has already been unsubscribed
+      return;
+    }
+
+    PollFlags flags;
+    if (completion.result < 0) {
+      LOG(ERROR) << Status::PosixError(-completion.result, "Poll request failed") << " for "
+                 << tag("fd", it->second.native_fd);
+      flags = PollFlags::Error();
+    } else {
+      auto events = static_cast<uint32>(completion.result);
+      if (events & POLLIN) {
+        flags = flags | PollFlags::Read();
+      }
+      if (events & POLLOUT) {
+        flags = flags | PollFlags::Write();
+      }
+      if (events & (POLLRDHUP | POLLHUP)) {
+        flags = flags | PollFlags::Close();
+      }
+      if (events & POLLERR) {
+        flags = flags | PollFlags::Error();
+      }
+    }
+
+    if (!completion.has_more && completion.result >= 0) {
+      // multishot request can be terminated by the kernel, for example, if completion queue overflows
+      add_poll(it->first, it->second);
+    }
+
+    auto pollable_fd = PollableFd::from_list_node(it->second.list_node);
+    pollable_fd.add_flags(flags);
+    pollable_fd.release_as_list_node();
+  });
+}
+
+}  // namespace detail
+}  // namespace td
+
+#endif
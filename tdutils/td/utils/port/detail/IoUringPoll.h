@@ -0,0 +1,77 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/config.h"
+#include "td/utils/port/config.h"
+
+#if defined(TD_POLL_EPOLL) && TD_USE_IO_URING_POLL
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/List.h"
+#include "td/utils/port/detail/Epoll.h"
+#include "td/utils/port/detail/PollableFd.h"
+#include "td/utils/port/PollBase.h"
+#include "td/utils/port/PollFlags.h"
+
+namespace td {
+namespace detail {
+
+// waits for events with multishot poll requests of Linux io_uring
+// falls back to epoll if io_uring isn't supported by the kernel or is disabled
+class IoUringPoll final : public PollBase {
+ public:
+  IoUringPoll();
+  IoUringPoll(const IoUringPoll &) = delete;
+  IoUringPoll &operator=(const IoUringPoll &) = delete;
+  IoUringPoll(IoUringPoll &&) = delete;
+  IoUringPoll &operator=(IoUringPoll &&) = delete;
+  ~IoUringPoll() final;
+
+  void init() final;
+
+  void clear() final;
+
+  void subscribe(PollableFd fd, PollFlags flags) final;
+
+  void unsubscribe(PollableFdRef fd) final;
+
+  void unsubscribe_before_close(PollableFdRef fd) final;
+
+  void run(int timeout_ms) final;
+
+  static bool is_edge_triggered() {
+    return true;
+  }
+
+  // affects only subsequently inited objects
+  static void set_io_uring_enabled(bool is_enabled);
+
+ private:
+  class Ring;
+  unique_ptr<Ring> ring_;
+
+  struct Subscription {
+    ListNode *list_node = nullptr;
+    int native_fd = -1;
+    uint32 events = 0;
+  };
+  FlatHashMap<uint64, Subscription> subscriptions_;
+  FlatHashMap<const ListNode *, uint64> subscription_ids_;
+  uint64 max_subscription_id_ = 0;
+  ListNode list_root_;
+
+  Epoll epoll_;
+
+  void add_poll(uint64 subscription_id, const Subscription &subscription);
+};
+
+}  // namespace detail
+}  // namespace td
+
+#endif
@@ -140,7 +140,7 @@ class PollableFdInfo final : private ListNode {
   std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
   PollFlagsSet flags_;
 #if TD_PORT_WINDOWS
-  Mutex observer_lock_;
+  Mutex observer_lock_{"PollableFd observer"};
 #endif
   ObserverBase *observer_{nullptr};
 
@@ -0,0 +1,79 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/port/numa.h"
+
+#include "td/utils/port/config.h"
+
+#include "td/utils/misc.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+#if TD_LINUX
+// parses CPU list in the format "0-3,8,10-11"
+static uint64 parse_cpu_list(Slice cpu_list) {
+  uint64 result = 0;
+  for (auto range : full_split(trim(cpu_list), ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    auto bounds = split(range, '-');
+    if (bounds.second.empty()) {
+      bounds.second = bounds.first;
+    }
+    auto r_begin = to_integer_safe<int32>(bounds.first);
+    auto r_end = to_integer_safe<int32>(bounds.second);
+    if (r_begin.is_error() || r_end.is_error() || r_begin.ok() < 0 || r_begin.ok() > r_end.ok() ||
+        r_end.ok() >= 64) {
+      return 0;
+    }
+    for (int32 cpu = r_begin.ok(); cpu <= r_end.ok(); cpu++) {
+      result |= static_cast<uint64>(1) << cpu;
+    }
+  }
+  return result;
+}
+
+// sysfs files have fake size, so read_file_str can't be used
+static Result<string> read_sysfs_file(CSlice path) {
+  TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
+  string content(1 << 12, '\0');
+  TRY_RESULT(size, fd.read(content));
+  fd.close();
+  content.resize(size);
+  return std::move(content);
+}
+#endif
+
+vector<uint64> get_numa_node_cpu_masks() {
+  vector<uint64> result;
+#if TD_LINUX
+  for (int32 node_id = 0; node_id < 64; node_id++) {
+    auto path = PSTRING() << "/sys/devices/system/node/node" << node_id << "/cpulist";
+    auto r_cpu_list = read_sysfs_file(path);
+    if (r_cpu_list.is_error()) {
+      // node identifiers can be sparse
+      continue;
+    }
+    auto mask = parse_cpu_list(r_cpu_list.ok());
+    if (mask == 0) {
+      // a node without CPUs, or CPUs which can't be represented in a mask
+      if (!trim(r_cpu_list.ok()).empty()) {
+        return {};
+      }
+      continue;
+    }
+    result.push_back(mask);
+  }
+#endif
+  return result;
+}
+
+}  // namespace td
@@ -0,0 +1,17 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+namespace td {
+
+// returns thread affinity masks with CPUs of each NUMA node, or an empty vector if the topology is unknown
+// or can't be represented as 64-bit masks
+vector<uint64> get_numa_node_cpu_masks();
+
+}  // namespace td
@@ -92,6 +92,89 @@ class TlStorerUnsafe {
   }
 };
 
+// stores data to a buffer of a fixed size in a single pass
+// if the buffer is too small, only the total length of the data is calculated, so the data can be stored again
+// to a buffer of the exact size
+class TlStorerBounded {
+  unsigned char *buf_;
+  size_t capacity_;
+  size_t length_ = 0;
+
+  unsigned char *prepare_store(size_t size) {
+    auto pos = length_;
+    length_ += size;
+    if (length_ > capacity_) {
+      return nullptr;
+    }
+    return buf_ + pos;
+  }
+
+ public:
+  TlStorerBounded(unsigned char *buf, size_t capacity) : buf_(buf), capacity_(capacity) {
+  }
+
+  TlStorerBounded(const TlStorerBounded &other) = delete;
+  TlStorerBounded &operator=(const TlStorerBounded &other) = delete;
+
+  template <class T>
+  void store_binary(const T &x) {
+    auto ptr = prepare_store(sizeof(T));
+    if (ptr != nullptr) {
+      std::memcpy(ptr, &x, sizeof(T));
+    }
+  }
+
+  void store_int(int32 x) {
+    store_binary<int32>(x);
+  }
+
+  void store_long(int64 x) {
+    store_binary<int64>(x);
+  }
+
+  void store_slice(Slice slice) {
+    auto ptr = prepare_store(slice.size());
+    if (ptr != nullptr) {
+      std::memcpy(ptr, slice.begin(), slice.size());
+    }
+  }
+
+  void store_storer(const Storer &storer) {
+    auto size = storer.size();
+    auto ptr = prepare_store(size);
+    if (ptr != nullptr) {
+      auto stored_size = storer.store(ptr);
+      CHECK(stored_size == size);
+    }
+  }
+
+  template <class T>
+  void store_string(const T &str) {
+    size_t size = str.size();
+    if (size < 254) {
+      size += 1;
+    } else if (size < (1 << 24)) {
+      size += 4;
+    } else {
+      size += 8;
+    }
+    size = (size + 3) & ~static_cast<size_t>(3);
+    auto ptr = prepare_store(size);
+    if (ptr != nullptr) {
+      TlStorerUnsafe storer(ptr);
+      storer.store_string(str);
+    }
+  }
+
+  bool is_complete() const {
+    return length_ <= capacity_;
+  }
+
+  size_t get_length() const {
+    return length_;
+  }
+};
+
 class TlStorerCalcLength {
   size_t length = 0;
 
@@ -6,12 +6,94 @@
 //
 #include "td/utils/utf8.h"
 
+#include "td/utils/bits.h"
 #include "td/utils/misc.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/unicode.h"
 
+#include <array>
+
+#if defined(__SSE2__) || (TD_MSVC && (defined(_M_X64) || (defined(_M_IX86) && _M_IX86_FP >= 2)))
+#define TD_SSE2 1
+#endif
+
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
+#if TD_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace td {
 
+// returns pointer to the first non-ASCII character in [begin, end) or a pointer to less than 16 last characters
+static const char *skip_ascii_characters(const char *begin, const char *end) {
+#if TD_SSE2
+  while (end - begin >= 16) {
+    auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+    auto mask = static_cast<uint32>(_mm_movemask_epi8(chars));
+    if (mask != 0) {
+      return begin + count_trailing_zeroes_non_zero32(mask);
+    }
+    begin += 16;
+  }
+#elif defined(__aarch64__)
+  const auto min_non_ascii = vdupq_n_u8(0x80);
+  while (end - begin >= 16) {
+    auto chars = vld1q_u8(reinterpret_cast<const uint8_t *>(begin));
+    auto matches = vcgeq_u8(chars, min_non_ascii);
+    // each character is represented by 4 bits of the mask
+    auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+    if (mask != 0) {
+      return begin + count_trailing_zeroes_non_zero64(mask) / 4;
+    }
+    begin += 16;
+  }
+#endif
+  return begin;
+}
+
+// counts code units in [begin, begin + size / 16 * 16), which are first code units of a character,
+// and code units, which are first code units of a 4-byte character; returns pointer to the first uncounted code unit
+static const unsigned char *count_utf8_first_code_units(const unsigned char *begin, const unsigned char *end,
+                                                        size_t &first_code_unit_count,
+                                                        size_t &first_4_byte_code_unit_count) {
+#if TD_SSE2
+  // as signed numbers continuation code units 0x80-0xBF are less than -64
+  // and first code units of 4-byte characters 0xF0-0xF7 are between -17 and -8
+  const auto min_first_code_unit = _mm_set1_epi8(-64);
+  const auto before_first_4_byte_code_unit = _mm_set1_epi8(-17);
+  const auto after_first_4_byte_code_unit = _mm_set1_epi8(-8);
+  while (end - begin >= 16) {
+    auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+    auto continuation_mask = static_cast<uint32>(_mm_movemask_epi8(_mm_cmplt_epi8(chars, min_first_code_unit)));
+    auto first_4_byte_mask = static_cast<uint32>(_mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpgt_epi8(chars, before_first_4_byte_code_unit), _mm_cmplt_epi8(chars, after_first_4_byte_code_unit))));
+    first_code_unit_count += 16 - count_bits32(continuation_mask);
+    first_4_byte_code_unit_count += count_bits32(first_4_byte_mask);
+    begin += 16;
+  }
+#elif defined(__aarch64__)
+  const auto min_first_code_unit = vdupq_n_u8(0xC0);
+  const auto min_continuation_code_unit = vdupq_n_u8(0x80);
+  const auto min_first_4_byte_code_unit = vdupq_n_u8(0xF0);
+  const auto max_first_4_byte_code_unit = vdupq_n_u8(0xF7);
+  while (end - begin >= 16) {
+    auto chars = vld1q_u8(begin);
+    // each matching code unit is 0xFF in the masks
+    auto continuation_mask =
+        vandq_u8(vcgeq_u8(chars, min_continuation_code_unit), vcltq_u8(chars, min_first_code_unit));
+    auto first_4_byte_mask =
+        vandq_u8(vcgeq_u8(chars, min_first_4_byte_code_unit), vcleq_u8(chars, max_first_4_byte_code_unit));
+    first_code_unit_count += 16 - vaddvq_u8(vshrq_n_u8(continuation_mask, 7));
+    first_4_byte_code_unit_count += vaddvq_u8(vshrq_n_u8(first_4_byte_mask, 7));
+    begin += 16;
+  }
+#endif
+  return begin;
+}
+
 bool check_utf8(CSlice str) {
   const char *data = str.data();
   const char *data_end = data + str.size();
@@ -21,6 +103,7 @@ bool check_utf8(CSlice str) {
       if (data == data_end + 1) {
         return true;
       }
+      data = skip_ascii_characters(data, data_end);
       continue;
     }
 
@@ -103,9 +186,14 @@ unsigned char *append_utf8_character_unsafe(unsigned char *ptr, uint32 code) {
 
 string utf8_to_lower(Slice str) {
   string result;
+  result.reserve(str.size());
   auto pos = str.ubegin();
   auto end = str.uend();
   while (pos != end) {
+    if (*pos < 0x80) {
+      result.push_back(static_cast<char>(unicode_to_lower(*pos++)));
+      continue;
+    }
     uint32 code;
     pos = next_utf8_unsafe(pos, &code);
     append_utf8_character(result, unicode_to_lower(code));
@@ -113,40 +201,85 @@ string utf8_to_lower(Slice str) {
   return result;
 }
 
-vector<string> utf8_get_search_words(Slice str) {
+// returns prepare_search_character and remove_diacritics results for all ASCII characters
+static const unsigned char *get_ascii_search_characters() {
+  static const auto table = [] {
+    std::array<unsigned char, 128> result;
+    for (uint32 c = 0; c < 128; c++) {
+      auto code = prepare_search_character(c);
+      if (code != 0 && code != ' ') {
+        code = remove_diacritics(code);
+      }
+      CHECK(code < 128);
+      result[c] = static_cast<unsigned char>(code);
+    }
+    return result;
+  }();
+  return table.data();
+}
+
+// calls on_character(code) for each character of every search word and on_word_end() after each word
+template <class F, class G>
+static void for_each_search_word(Slice str, F &&on_character, G &&on_word_end) {
+  const auto *ascii_search_characters = get_ascii_search_characters();
   bool in_word = false;
-  string word;
-  vector<string> words;
   auto pos = str.ubegin();
   auto end = str.uend();
   while (pos != end) {
     uint32 code;
-    pos = next_utf8_unsafe(pos, &code);
+    if (*pos < 0x80) {
+      code = ascii_search_characters[*pos++];
+    } else {
+      pos = next_utf8_unsafe(pos, &code);
+      code = prepare_search_character(code);
+      if (code != 0 && code != ' ') {
+        code = remove_diacritics(code);
+      }
+    }
 
-    code = prepare_search_character(code);
     if (code == 0) {
       continue;
     }
     if (code == ' ') {
       if (in_word) {
-        words.push_back(std::move(word));
-        word.clear();
+        on_word_end();
         in_word = false;
       }
     } else {
       in_word = true;
-      code = remove_diacritics(code);
-      append_utf8_character(word, code);
+      on_character(code);
     }
   }
   if (in_word) {
-    words.push_back(std::move(word));
+    on_word_end();
   }
+}
+
+vector<string> utf8_get_search_words(Slice str) {
+  string word;
+  vector<string> words;
+  for_each_search_word(
+      str, [&word](uint32 code) { append_utf8_character(word, code); },
+      [&] {
+        words.push_back(std::move(word));
+        word.clear();
+      });
   return words;
 }
 
+void utf8_write_search_string(Slice str, string &result) {
+  result.clear();
+  for_each_search_word(
+      str, [&result](uint32 code) { append_utf8_character(result, code); }, [&result] { result += ' '; });
+  if (!result.empty()) {
+    result.pop_back();
+  }
+}
+
 string utf8_prepare_search_string(Slice str) {
-  return implode(utf8_get_search_words(str));
+  string result;
+  utf8_write_search_string(str, result);
+  return result;
 }
 
 string utf8_encode(CSlice data) {
@@ -156,12 +289,27 @@ string utf8_encode(CSlice data) {
   return PSTRING() << "url_decode(" << url_encode(data) << ')';
 }
 
+size_t utf8_length(Slice str) {
+  size_t result = 0;
+  size_t first_4_byte_code_unit_count = 0;
+  auto end = str.uend();
+  auto ptr = count_utf8_first_code_units(str.ubegin(), end, result, first_4_byte_code_unit_count);
+  for (; ptr != end; ++ptr) {
+    result += is_utf8_character_first_code_unit(*ptr);
+  }
+  return result;
+}
+
 size_t utf8_utf16_length(Slice str) {
   size_t result = 0;
-  for (auto c : str) {
+  size_t first_4_byte_code_unit_count = 0;
+  auto end = str.uend();
+  auto ptr = count_utf8_first_code_units(str.ubegin(), end, result, first_4_byte_code_unit_count);
+  for (; ptr != end; ++ptr) {
+    auto c = *ptr;
     result += is_utf8_character_first_code_unit(c) + ((c & 0xf8) == 0xf0);
   }
-  return result;
+  return result + first_4_byte_code_unit_count;
 }
 
 Slice utf8_utf16_truncate(Slice str, size_t length) {
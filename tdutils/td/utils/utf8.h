@@ -20,13 +20,7 @@ inline bool is_utf8_character_first_code_unit(unsigned char c) {
 }
 
 /// returns length of UTF-8 string in characters
-inline size_t utf8_length(Slice str) {
-  size_t result = 0;
-  for (auto c : str) {
-    result += is_utf8_character_first_code_unit(c);
-  }
-  return result;
-}
+size_t utf8_length(Slice str);
 
 /// returns length of UTF-8 string in UTF-16 code units
 size_t utf8_utf16_length(Slice str);
@@ -112,6 +106,9 @@ vector<string> utf8_get_search_words(Slice str);
 /// Returns UTF-8 string prepared for search, leaving only digits and lowercased letters.
 string utf8_prepare_search_string(Slice str);
 
+/// Writes UTF-8 string prepared for search to result, reusing its memory.
+void utf8_write_search_string(Slice str, string &result);
+
 /// Returns valid UTF-8 representation of the string.
 string utf8_encode(CSlice data);
 
@@ -11,6 +11,9 @@
 #include "td/utils/misc.h"
 #include "td/utils/port/Mutex.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/ReadMostlyHashMap.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/SpinLock.h"
 #include "td/utils/tests.h"
 
@@ -249,4 +252,66 @@ TEST(ConcurrentHashMap, Benchmark) {
 #endif
 }
 
+TEST(ReadMostlyHashMap, stress) {
+  td::ReadMostlyHashMap<td::int32, td::string> map;
+  auto get_value = [](td::int32 key, td::int32 version) {
+    return PSTRING() << key << ':' << version;
+  };
+  auto check_value = [](td::int32 key, const td::string &value) {
+    CHECK(value.empty() || td::begins_with(value, PSTRING() << key << ':'));
+  };
+
+  constexpr td::int32 KEY_COUNT = 1000;
+  for (td::int32 key = 1; key <= KEY_COUNT; key += 2) {
+    map.set(key, get_value(key, 0));
+  }
+
+  std::atomic<bool> is_finished{false};
+  td::vector<td::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      while (!is_finished.load(std::memory_order_relaxed)) {
+        auto key = td::Random::fast(1, KEY_COUNT);
+        check_value(key, map.get(key));
+      }
+    });
+  }
+
+  td::vector<td::thread> writers;
+  for (int i = 0; i < 2; i++) {
+    writers.emplace_back([&] {
+      for (td::int32 version = 1; version <= 10000; version++) {
+        auto key = td::Random::fast(1, KEY_COUNT);
+        if (td::Random::fast(0, 3) == 0) {
+          map.erase(key);
+        } else {
+          map.set(key, get_value(key, version));
+        }
+      }
+    });
+  }
+
+  // the main thread has no unique thread identifier, so it reads under a lock
+  for (int i = 0; i < 100000; i++) {
+    auto key = td::Random::fast(1, KEY_COUNT);
+    map.with_value(key, [&](const td::string &value) { check_value(key, value); });
+  }
+
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  is_finished = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  map.set(1, "one");
+  ASSERT_EQ("one", map.get(1));
+  ASSERT_EQ(1u, map.count(1));
+  ASSERT_EQ(1u, map.erase(1));
+  ASSERT_EQ(0u, map.erase(1));
+  ASSERT_EQ(0u, map.count(1));
+  ASSERT_EQ("", map.get(1));
+}
+
 #endif
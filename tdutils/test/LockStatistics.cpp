@@ -0,0 +1,105 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/LockStatistics.h"
+#include "td/utils/port/Mutex.h"
+#include "td/utils/port/RwMutex.h"
+#include "td/utils/port/sleep.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/SpinLock.h"
+#include "td/utils/tests.h"
+
+static const td::LockStatistics::Entry *find_entry(const td::vector<td::LockStatistics::Entry> &statistics,
+                                                   td::Slice name, bool is_shared) {
+  for (auto &entry : statistics) {
+    if (entry.name == name && entry.is_shared == is_shared) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+static td::uint64 get_histogram_total(const td::LockStatistics::Histogram &histogram) {
+  td::uint64 result = 0;
+  for (auto count : histogram) {
+    result += count;
+  }
+  return result;
+}
+
+TEST(LockStatistics, disabled) {
+  td::LockStatistics::clear();
+  td::LockStatistics::set_enabled(false);
+  td::Mutex mutex("test disabled mutex");
+  mutex.lock();
+  ASSERT_TRUE(find_entry(td::LockStatistics::get_statistics(), "test disabled mutex", false) == nullptr);
+}
+
+TEST(LockStatistics, uncontended) {
+  td::LockStatistics::clear();
+  td::LockStatistics::set_enabled(true);
+  td::Mutex mutex("test mutex");
+  td::RwMutex rw_mutex("test rw mutex");
+  td::SpinLock spin_lock("test spin lock");
+  for (int i = 0; i < 3; i++) {
+    auto guard = mutex.lock();
+    auto read_lock = rw_mutex.lock_read().move_as_ok();
+    auto spin_guard = spin_lock.lock();
+  }
+  {
+    auto guard = mutex.lock();
+    guard.reset();
+    auto write_lock = rw_mutex.lock_write().move_as_ok();
+  }
+  td::LockStatistics::set_enabled(false);
+
+  auto statistics = td::LockStatistics::get_statistics();
+  auto mutex_entry = find_entry(statistics, "test mutex", false);
+  ASSERT_TRUE(mutex_entry != nullptr);
+  ASSERT_EQ(4u, mutex_entry->lock_count);
+  ASSERT_EQ(0u, mutex_entry->contended_lock_count);
+  ASSERT_EQ(4u, get_histogram_total(mutex_entry->hold_time));
+
+  auto read_entry = find_entry(statistics, "test rw mutex", true);
+  ASSERT_TRUE(read_entry != nullptr);
+  ASSERT_EQ(3u, read_entry->lock_count);
+  auto write_entry = find_entry(statistics, "test rw mutex", false);
+  ASSERT_TRUE(write_entry != nullptr);
+  ASSERT_EQ(1u, write_entry->lock_count);
+
+  auto spin_lock_entry = find_entry(statistics, "test spin lock", false);
+  ASSERT_TRUE(spin_lock_entry != nullptr);
+  ASSERT_EQ(3u, spin_lock_entry->lock_count);
+  ASSERT_EQ(3u, get_histogram_total(spin_lock_entry->hold_time));
+
+  td::LockStatistics::clear();
+  ASSERT_TRUE(find_entry(td::LockStatistics::get_statistics(), "test mutex", false) == nullptr);
+}
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(LockStatistics, contended) {
+  td::LockStatistics::clear();
+  td::LockStatistics::set_enabled(true);
+  td::Mutex mutex("test contended mutex");
+  {
+    auto guard = mutex.lock();
+    td::thread thread([&mutex] { mutex.lock(); });
+    td::usleep_for(20000);
+    guard.reset();
+    thread.join();
+  }
+  td::LockStatistics::set_enabled(false);
+
+  auto entry = find_entry(td::LockStatistics::get_statistics(), "test contended mutex", false);
+  ASSERT_TRUE(entry != nullptr);
+  ASSERT_EQ(2u, entry->lock_count);
+  ASSERT_EQ(1u, entry->contended_lock_count);
+  ASSERT_TRUE(entry->total_wait_time >= 0.01);
+  ASSERT_EQ(1u, get_histogram_total(entry->wait_time));
+  td::LockStatistics::clear();
+}
+#endif
@@ -0,0 +1,76 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/Metrics.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/tests.h"
+
+TEST(Metrics, disabled) {
+  td::MetricRegistry::set_enabled(false);
+  td::MetricCounter counter("test_disabled_total", "Test counter");
+  counter.add();
+  counter.add(5);
+  ASSERT_EQ(0, counter.get());
+}
+
+TEST(Metrics, prometheus_text) {
+  td::MetricRegistry::set_enabled(true);
+  {
+    td::MetricCounter counter("test_counter_total", "Test counter");
+    td::MetricGauge gauge("test_gauge", "Test gauge", [] { return 2.5; });
+    td::MetricHistogram histogram("test_histogram", "Test histogram", {1.0, 10.0});
+    counter.add(3);
+    histogram.observe(0.5);
+    histogram.observe(1.0);
+    histogram.observe(5.0);
+    histogram.observe(100.0);
+
+    auto text = td::MetricRegistry::get_prometheus_text();
+    auto contains = [&text](td::Slice line) {
+      return text.find(line.str() + "\n") != td::string::npos;
+    };
+    ASSERT_TRUE(contains("# HELP test_counter_total Test counter"));
+    ASSERT_TRUE(contains("# TYPE test_counter_total counter"));
+    ASSERT_TRUE(contains("test_counter_total 3"));
+    ASSERT_TRUE(contains("# TYPE test_gauge gauge"));
+    ASSERT_TRUE(contains("test_gauge 2.500000"));
+    ASSERT_TRUE(contains("# TYPE test_histogram histogram"));
+    ASSERT_TRUE(contains("test_histogram_bucket{le=\"1.000000\"} 2"));
+    ASSERT_TRUE(contains("test_histogram_bucket{le=\"10.000000\"} 3"));
+    ASSERT_TRUE(contains("test_histogram_bucket{le=\"+Inf\"} 4"));
+    ASSERT_TRUE(contains("test_histogram_sum 106.500000"));
+    ASSERT_TRUE(contains("test_histogram_count 4"));
+  }
+  ASSERT_TRUE(td::MetricRegistry::get_prometheus_text().find("test_counter_total") == td::string::npos);
+  td::MetricRegistry::set_enabled(false);
+}
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(Metrics, threads) {
+  td::MetricRegistry::set_enabled(true);
+  td::MetricCounter counter("test_threads_total", "Test counter");
+  td::MetricHistogram histogram("test_threads_histogram", "Test histogram", {1.0});
+  constexpr int THREAD_COUNT = 4;
+  constexpr int ITERATION_COUNT = 10000;
+  td::vector<td::thread> threads;
+  for (int i = 0; i < THREAD_COUNT; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < ITERATION_COUNT; j++) {
+        counter.add();
+        histogram.observe(2.0);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(THREAD_COUNT * ITERATION_COUNT, counter.get());
+  auto text = td::MetricRegistry::get_prometheus_text();
+  ASSERT_TRUE(text.find("test_threads_histogram_count 40000\n") != td::string::npos);
+  td::MetricRegistry::set_enabled(false);
+}
+#endif
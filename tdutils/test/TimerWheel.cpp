@@ -0,0 +1,72 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/Heap.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+#include "td/utils/TimerWheel.h"
+
+#include <cmath>
+#include <set>
+#include <utility>
+
+TEST(TimerWheel, random_events) {
+  struct Node final : public td::HeapNode {
+    int id = 0;
+  };
+
+  td::TimerWheel wheel(1.0);
+  td::vector<Node> nodes(1000);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodes[i].id = static_cast<int>(i);
+  }
+  std::set<std::pair<double, int>> keys;
+  td::vector<double> node_keys(nodes.size());
+
+  double now = 0.0;
+  for (int i = 0; i < 300000; i++) {
+    int id = td::Random::fast(0, static_cast<int>(nodes.size()) - 1);
+    auto &node = nodes[id];
+    int x = td::Random::fast(0, 9);
+    if (x < 4) {
+      static const int max_delays[] = {10, 1000, 1000000, 2000000000};
+      double key = now + td::Random::fast(-10, max_delays[td::Random::fast(0, 3)]);
+      if (node.in_heap()) {
+        ASSERT_EQ(node_keys[id], wheel.get_key(&node));
+        keys.erase(std::make_pair(node_keys[id], id));
+        wheel.fix(key, &node);
+      } else {
+        wheel.insert(key, &node);
+      }
+      node_keys[id] = key;
+      keys.emplace(key, id);
+    } else if (x < 5) {
+      if (node.in_heap()) {
+        wheel.erase(&node);
+        keys.erase(std::make_pair(node_keys[id], id));
+      }
+    } else {
+      now += td::Random::fast(0, 9) == 0 ? td::Random::fast(0, 100000000) : td::Random::fast(0, 100);
+      while (true) {
+        auto expired_node = static_cast<Node *>(wheel.pop_expired(now));
+        if (expired_node == nullptr) {
+          break;
+        }
+        ASSERT_TRUE(!expired_node->in_heap());
+        auto expired_key = node_keys[expired_node->id];
+        ASSERT_TRUE(expired_key < now);
+        ASSERT_EQ(1u, keys.erase(std::make_pair(expired_key, expired_node->id)));
+      }
+      if (!keys.empty()) {
+        // nodes are returned at most one tick late
+        ASSERT_TRUE(keys.begin()->first >= std::floor(now));
+        ASSERT_TRUE(wheel.get_wakeup_at() <= std::floor(keys.begin()->first) + 1);
+      }
+    }
+    ASSERT_EQ(keys.size(), wheel.size());
+  }
+}
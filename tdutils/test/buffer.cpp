@@ -7,7 +7,10 @@
 #include "td/utils/tests.h"
 
 #include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/find_boundary.h"
 #include "td/utils/Random.h"
+#include "td/utils/Slice.h"
 
 TEST(Buffer, buffer_builder) {
   {
@@ -54,3 +57,61 @@ TEST(Buffer, buffer_builder) {
     ASSERT_EQ(builder.extract().as_slice(), str);
   }
 }
+
+TEST(Buffer, size_classes) {
+  auto get_mem = [](size_t size_class) {
+    return td::BufferAllocator::get_size_class_buffer_mem(size_class);
+  };
+  auto start_mem = td::BufferAllocator::get_buffer_mem();
+  auto start_small_mem = get_mem(1);
+  auto start_big_mem = get_mem(td::BufferAllocator::SIZE_CLASS_COUNT);
+  {
+    td::BufferWriter small_writer(1000);
+    td::BufferWriter big_writer(1 << 20);
+    ASSERT_TRUE(get_mem(1) > start_small_mem);
+    ASSERT_TRUE(get_mem(td::BufferAllocator::SIZE_CLASS_COUNT) > start_big_mem);
+  }
+  ASSERT_EQ(start_mem, td::BufferAllocator::get_buffer_mem());
+  ASSERT_EQ(start_small_mem, get_mem(1));
+  ASSERT_EQ(start_big_mem, get_mem(td::BufferAllocator::SIZE_CLASS_COUNT));
+
+  auto cached_mem = td::BufferAllocator::get_cached_buffer_mem();
+  ASSERT_TRUE(cached_mem > 0);
+  {
+    td::BufferWriter writer(1000);
+    ASSERT_TRUE(td::BufferAllocator::get_cached_buffer_mem() < cached_mem);
+    writer.as_mutable_slice().fill('a');
+  }
+  ASSERT_EQ(cached_mem, td::BufferAllocator::get_cached_buffer_mem());
+}
+
+TEST(Buffer, find_boundary) {
+  for (int test = 0; test < 1000; test++) {
+    td::string data;
+    auto size = td::Random::fast(0, 300);
+    for (int i = 0; i < size; i++) {
+      data += "\r\nab"[td::Random::fast(0, 3)];
+    }
+    td::string boundary = td::Random::fast_bool() ? "\r\n\r\n" : "\r\n--ab";
+    auto expected_pos = data.find(boundary);
+
+    td::ChainBufferWriter writer;
+    auto reader = writer.extract_reader();
+    size_t pos = 0;
+    while (pos < data.size()) {
+      auto chunk_size = td::min(static_cast<size_t>(td::Random::fast(1, 40)), data.size() - pos);
+      writer.append(td::BufferSlice(td::Slice(data).substr(pos, chunk_size)));
+      pos += chunk_size;
+    }
+    reader.sync_with_writer();
+
+    size_t already_read = 0;
+    bool is_found = td::find_boundary(reader.clone(), boundary, already_read);
+    ASSERT_EQ(expected_pos != td::string::npos, is_found);
+    if (is_found) {
+      ASSERT_EQ(expected_pos, already_read);
+    } else {
+      ASSERT_TRUE(already_read + boundary.size() > data.size() || data.size() < boundary.size());
+    }
+  }
+}
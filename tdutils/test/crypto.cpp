@@ -8,6 +8,7 @@
 #include "td/utils/benchmark.h"
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
+#include "td/utils/FlatHashSet.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
@@ -217,6 +218,48 @@ TEST(Crypto, AesCbcState) {
 }
 #endif
 
+TEST(Crypto, AesIgeMulti) {
+  for (size_t stream_count = 0; stream_count <= 9; stream_count++) {
+    td::UInt256 key;
+    td::Random::secure_bytes(key.raw, sizeof(key));
+
+    td::vector<td::string> plaintexts;
+    td::vector<td::string> ivs;
+    for (size_t i = 0; i < stream_count; i++) {
+      plaintexts.push_back(td::rand_string(0, 255, 16 * td::Random::fast(0, 100)));
+      ivs.push_back(td::rand_string(0, 255, 32));
+    }
+
+    auto ciphertexts = plaintexts;
+    auto encrypted_ivs = ivs;
+    td::vector<td::MutableSlice> data_slices;
+    td::vector<td::MutableSlice> iv_slices;
+    for (size_t i = 0; i < stream_count; i++) {
+      data_slices.emplace_back(ciphertexts[i]);
+      iv_slices.emplace_back(encrypted_ivs[i]);
+    }
+    td::aes_ige_encrypt_multi(as_slice(key), iv_slices, data_slices);
+
+    for (size_t i = 0; i < stream_count; i++) {
+      td::string expected = plaintexts[i];
+      td::string expected_iv = ivs[i];
+      td::aes_ige_encrypt(as_slice(key), expected_iv, expected, expected);
+      ASSERT_STREQ(td::base64_encode(expected), td::base64_encode(ciphertexts[i]));
+      ASSERT_STREQ(td::base64_encode(expected_iv), td::base64_encode(encrypted_ivs[i]));
+    }
+
+    auto decrypted_ivs = ivs;
+    for (size_t i = 0; i < stream_count; i++) {
+      iv_slices[i] = decrypted_ivs[i];
+    }
+    td::aes_ige_decrypt_multi(as_slice(key), iv_slices, data_slices);
+    for (size_t i = 0; i < stream_count; i++) {
+      ASSERT_STREQ(td::base64_encode(plaintexts[i]), td::base64_encode(ciphertexts[i]));
+      ASSERT_STREQ(td::base64_encode(encrypted_ivs[i]), td::base64_encode(decrypted_ivs[i]));
+    }
+  }
+}
+
 TEST(Crypto, Sha256State) {
   for (auto length : {0, 1, 31, 32, 33, 9999, 10000, 10001, 999999, 1000001}) {
     auto s = td::rand_string(std::numeric_limits<char>::min(), std::numeric_limits<char>::max(), length);
@@ -329,6 +372,25 @@ TEST(Crypto, hmac_sha512) {
     ASSERT_STREQ(answers[i], td::base64_encode(output));
   }
 }
+
+TEST(Crypto, secure_drbg) {
+  for (auto is_drbg_enabled : {true, false}) {
+    td::Random::set_secure_drbg_enabled(is_drbg_enabled);
+    td::FlatHashSet<td::uint64> values;
+    for (int i = 0; i < 100000; i++) {
+      auto value = td::Random::secure_uint64();
+      ASSERT_TRUE(value != 0);
+      ASSERT_TRUE(values.insert(value).second);
+    }
+
+    td::string small(17, '\0');
+    td::Random::secure_bytes(small);
+    td::Random::secure_cleanup();
+    td::string other(17, '\0');
+    td::Random::secure_bytes(other);
+    ASSERT_TRUE(small != other);
+  }
+}
 #endif
 
 #if TD_HAVE_ZLIB
@@ -409,6 +471,13 @@ TEST(Crypto, crc64) {
 
   for (std::size_t i = 0; i < strings.size(); i++) {
     ASSERT_EQ(answers[i], td::crc64(strings[i]));
+
+    auto v = td::rand_split(strings[i]);
+    td::uint64 crc = 0;
+    for (auto &x : v) {
+      crc = td::crc64_extend(crc, td::crc64(x), x.size());
+    }
+    ASSERT_EQ(answers[i], crc);
   }
 }
 
@@ -72,6 +72,8 @@ TEST(Emoji, get_fitzpatrick_modifier) {
 }
 
 static void test_remove_emoji_modifiers(td::string emoji, const td::string &result, bool remove_selectors = true) {
+  ASSERT_TRUE(td::is_emoji_without_modifiers_equal(emoji, result, remove_selectors));
+  ASSERT_TRUE(!td::is_emoji_without_modifiers_equal(emoji, result + "a", remove_selectors));
   ASSERT_STREQ(result, td::remove_emoji_modifiers(emoji, remove_selectors));
   td::remove_emoji_modifiers_in_place(emoji, remove_selectors);
   ASSERT_STREQ(result, emoji);
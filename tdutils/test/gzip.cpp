@@ -29,6 +29,37 @@ TEST(Gzip, gzencode_gzdecode) {
   encode_decode(td::string(1000000, 'a'));
 }
 
+TEST(Gzip, reuse) {
+  auto str = td::rand_string('a', 'z', 100000);
+  auto zip = td::gzencode(str, 0.9).as_slice().str();
+  ASSERT_TRUE(!zip.empty());
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(td::gzencode(td::rand_string(0, 255, 10000), 0.9).empty());
+    ASSERT_EQ(zip, td::gzencode(str, 0.9).as_slice());
+
+    auto broken_zip = zip;
+    broken_zip[broken_zip.size() / 2] ^= 1;
+    ASSERT_TRUE(td::gzdecode(broken_zip).empty());
+    ASSERT_TRUE(td::gzdecode(td::Slice(zip).truncate(zip.size() - 1)).empty());
+    ASSERT_EQ(str, td::gzdecode(zip).as_slice());
+  }
+
+  td::Gzip gzip;
+  gzip.set_reusable(true);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(gzip.reinit(td::Gzip::Mode::Decode).is_ok());
+    td::string result(str.size(), '\0');
+    gzip.set_input(zip);
+    gzip.close_input();
+    gzip.set_output(result);
+    auto r_state = gzip.run();
+    ASSERT_TRUE(r_state.is_ok());
+    ASSERT_TRUE(r_state.ok() == td::Gzip::State::Done);
+    ASSERT_EQ(str.size(), gzip.flush_output());
+    ASSERT_EQ(str, result);
+  }
+}
+
 static void test_gzencode(const td::string &s) {
   auto begin_time = td::Time::now();
   auto r = td::gzencode(s, td::max(2, static_cast<int>(100 / s.size())));
@@ -89,3 +89,29 @@ TEST(JSON, kphp) {
       "{\"keyboard\":[[\"\\u2022 abcdefg\"],[\"\\u2022 hijklmnop\"],[\"\\u2022 "
       "qrstuvwxyz\"]],\"one_time_keyboard\":true}");
 }
+
+TEST(JSON, long_strings) {
+  for (size_t length = 0; length <= 40; length++) {
+    for (size_t escape_pos = 0; escape_pos <= length; escape_pos++) {
+      td::string text(length, 'a');
+      td::string escaped_text = text;
+      if (escape_pos < length) {
+        text[escape_pos] = '"';
+        escaped_text = text.substr(0, escape_pos) + "\\\"" + text.substr(escape_pos + 1);
+      }
+      td::string str = "[\"" + escaped_text + "\",\"" + escaped_text + "\"]";
+      auto str_copy = str;
+      auto r_value = td::json_decode(str_copy);
+      ASSERT_TRUE(r_value.is_ok());
+      auto &array = r_value.ok_ref().get_array();
+      ASSERT_EQ(2u, array.size());
+      ASSERT_EQ(text, array[0].get_string());
+      ASSERT_EQ(text, array[1].get_string());
+
+      str_copy = str;
+      ASSERT_TRUE(td::json_decode(td::MutableSlice(str_copy).substr(0, str.size() - 3)).is_error());
+      str_copy = "\"" + escaped_text + "\\";
+      ASSERT_TRUE(td::json_decode(str_copy).is_error());
+    }
+  }
+}
@@ -13,6 +13,7 @@
 #include "td/utils/MemoryLog.h"
 #include "td/utils/NullLog.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
@@ -91,6 +92,33 @@ class LogBenchmark final : public td::Benchmark {
   std::vector<td::thread> threads_;
 };
 
+TEST(Log, TsFileLog_rotation) {
+  auto log = td::TsFileLog::create("tmplog", 1000, false).move_as_ok();
+  auto paths = log->get_file_paths();
+  for (int i = 0; i < 100; i++) {
+    log->do_append(VERBOSITY_NAME(PLAIN), "test log line\n");
+  }
+  td::thread([&] {
+    for (int i = 0; i < 100; i++) {
+      log->do_append(VERBOSITY_NAME(PLAIN), "test log line from another thread\n");
+    }
+  }).join();
+  log.reset();
+
+  size_t old_file_count = 0;
+  for (auto &path : paths) {
+    auto r_stat = td::stat(path);
+    if (r_stat.is_ok()) {
+      ASSERT_TRUE(r_stat.ok().size_ <= 1100);
+    }
+    if (path.size() > 4 && td::Slice(path).substr(path.size() - 4) == ".old") {
+      old_file_count += static_cast<size_t>(td::stat(path).is_ok());
+    }
+    td::unlink(path).ignore();
+  }
+  ASSERT_TRUE(old_file_count >= 1);
+}
+
 template <class F>
 static void bench_log(std::string name, F &&f) {
   for (auto test_full_logging : {false, true}) {
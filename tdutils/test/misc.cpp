@@ -17,6 +17,7 @@
 #include "td/utils/HashMap.h"
 #include "td/utils/HashSet.h"
 #include "td/utils/HashTableUtils.h"
+#include "td/utils/Hints.h"
 #include "td/utils/invoke.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
@@ -37,6 +38,8 @@
 #include "td/utils/tests.h"
 #include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
+#include "td/utils/tl_storers.h"
+#include "td/utils/TlStorerToString.h"
 #include "td/utils/translit.h"
 #include "td/utils/uint128.h"
 #include "td/utils/unicode.h"
@@ -249,6 +252,25 @@ TEST(Misc, base64) {
       auto decoded_secure = td::base64_decode_secure(encoded);
       ASSERT_TRUE(decoded_secure.is_ok());
       ASSERT_TRUE(decoded_secure.ok().as_slice() == s);
+
+      td::string buffer(td::base64_encoded_size(s.size()) + 1, 'x');
+      auto encoded_slice = td::base64_encode(s, buffer);
+      ASSERT_EQ(encoded, encoded_slice);
+      ASSERT_EQ('x', buffer.back());
+      td::string decoded_buffer(s.size(), '\0');
+      auto r_decoded_slice = td::base64_decode(encoded, decoded_buffer);
+      ASSERT_TRUE(r_decoded_slice.is_ok());
+      ASSERT_EQ(s, r_decoded_slice.ok());
+
+      buffer.assign(td::base64url_encoded_size(s.size()), 'x');
+      encoded_slice = td::base64url_encode(s, buffer);
+      ASSERT_EQ(td::base64url_encode(s), encoded_slice);
+      r_decoded_slice = td::base64url_decode(encoded_slice, decoded_buffer);
+      ASSERT_TRUE(r_decoded_slice.is_ok());
+      ASSERT_EQ(s, r_decoded_slice.ok());
+      if (!s.empty()) {
+        ASSERT_TRUE(td::base64url_decode(encoded_slice, td::MutableSlice(decoded_buffer).remove_suffix(1)).is_error());
+      }
     }
   }
 
@@ -263,6 +285,11 @@ TEST(Misc, base64) {
   ASSERT_TRUE(td::base64url_encode("ab><") == "YWI-PA");
   ASSERT_TRUE(td::base64url_encode("ab><c") == "YWI-PGM");
   ASSERT_TRUE(td::base64url_encode("ab><cd") == "YWI-PGNk");
+  ASSERT_TRUE(td::base64_decode("YW55IGNhcm5hbCBwbGVhc3Vy").ok() == "any carnal pleasur");
+  ASSERT_TRUE(td::base64_decode("YW55IGNhcm5hbC*wbGVhc3Vy").is_error());
+  ASSERT_TRUE(td::base64_decode("YW55IGNhcm5hbCBwbGVhc3V=").is_error());
+  ASSERT_TRUE(td::base64url_decode("YWI-PGM").ok() == "ab><c");
+  ASSERT_TRUE(td::base64url_decode("YWI+PGM").is_error());
 }
 
 template <class T>
@@ -589,6 +616,78 @@ TEST(Misc, to_wstring) {
 }
 #endif
 
+static bool check_utf8_slow(td::Slice str) {
+  size_t i = 0;
+  while (i < str.size()) {
+    auto a = static_cast<unsigned char>(str[i]);
+    size_t length = a < 0x80 ? 1 : (a < 0xC2 ? 0 : (a < 0xE0 ? 2 : (a < 0xF0 ? 3 : (a < 0xF5 ? 4 : 0))));
+    if (length == 0 || i + length > str.size()) {
+      return false;
+    }
+    td::uint32 code = length == 1 ? a : a & (0x7F >> length);
+    for (size_t j = 1; j < length; j++) {
+      auto c = static_cast<unsigned char>(str[i + j]);
+      if ((c & 0xC0) != 0x80) {
+        return false;
+      }
+      code = (code << 6) | (c & 0x3F);
+    }
+    if ((length == 3 && (code < 0x800 || (0xD800 <= code && code <= 0xDFFF))) ||
+        (length == 4 && (code < 0x10000 || code > 0x10FFFF))) {
+      return false;
+    }
+    i += length;
+  }
+  return true;
+}
+
+TEST(Misc, utf8) {
+  const td::vector<td::string> parts{"a", "hello ", "\n", "Ω", "тест", "中文", "日本語", "🏟", "👍🏻", "\xc0",
+                                     "\xff", "\x80", "\xe0\x80\x80", "\xed\xa0\x80", "\xf4\x90\x80\x80"};
+  td::Random::Xorshift128plus rnd(123);
+  for (int i = 0; i < 10000; i++) {
+    td::string str;
+    auto part_count = rnd.fast(0, 100);
+    bool is_ascii = rnd.fast(0, 1) == 0;
+    for (int j = 0; j < part_count; j++) {
+      str += parts[rnd.fast(0, is_ascii ? 2 : static_cast<int>(parts.size()) - 1)];
+    }
+    if (rnd.fast(0, 3) == 0) {
+      str.resize(rnd.fast(0, static_cast<int>(str.size())));
+    }
+
+    size_t length = 0;
+    size_t utf16_length = 0;
+    for (auto c : str) {
+      length += td::is_utf8_character_first_code_unit(c);
+      utf16_length += td::is_utf8_character_first_code_unit(c) + ((c & 0xf8) == 0xf0);
+    }
+    ASSERT_EQ(length, td::utf8_length(str));
+    ASSERT_EQ(utf16_length, td::utf8_utf16_length(str));
+    ASSERT_EQ(check_utf8_slow(str), td::check_utf8(str));
+  }
+}
+
+TEST(Misc, utf8_prepare_search_string) {
+  auto test = [](td::Slice str, td::Slice expected) {
+    ASSERT_STREQ(expected, td::utf8_prepare_search_string(str));
+    td::string result = "garbage";
+    td::utf8_write_search_string(str, result);
+    ASSERT_STREQ(expected, result);
+    ASSERT_STREQ(expected, td::implode(td::utf8_get_search_words(str)));
+  };
+  test("", "");
+  test(" ,. ", "");
+  test("Hello, World!", "hello world");
+  test("  Ёлка  Straße ", "елка straße");
+  test("Ça va?", "ca va");
+  test("ΣΊΣΥΦΟΣ", "σισυφοσ");
+  test("a-b_c #tag @user 100%", "a b c tag user 100");
+
+  ASSERT_STREQ("hello, world!", td::utf8_to_lower("Hello, World!"));
+  ASSERT_STREQ("ça va? σίσυφοσ", td::utf8_to_lower("Ça va? ΣΊΣΥΦΟΣ"));
+}
+
 static void test_translit(const td::string &word, const td::vector<td::string> &result, bool allow_partial = true) {
   ASSERT_EQ(result, td::get_word_transliterations(word, allow_partial));
 }
@@ -993,6 +1092,43 @@ TEST(Misc, Time) {
     thread.join();
   }
 }
+
+TEST(Misc, TimeCached) {
+  td::Stage run;
+  td::Stage check;
+  td::Stage finish;
+
+  std::size_t threads_n = 3;
+  td::vector<td::thread> threads;
+  td::vector<std::atomic<double>> ts(threads_n);
+  for (std::size_t i = 0; i < threads_n; i++) {
+    threads.emplace_back([&, thread_id = i] {
+      td::Time::update_cached();
+      for (td::uint64 round = 1; round < 10000; round++) {
+        ts[thread_id] = 0;
+        run.wait(round * threads_n);
+        auto cached_ts = td::Time::now_cached();
+        ts[thread_id] = td::Time::now();
+        ASSERT_TRUE(cached_ts <= ts[thread_id].load());
+        check.wait(round * threads_n);
+        for (auto &ts_ref : ts) {
+          auto other_ts = ts_ref.load();
+          if (other_ts != 0) {
+            ASSERT_TRUE(other_ts <= td::Time::now_cached());
+          }
+        }
+
+        finish.wait(round * threads_n);
+        if (round % 16 == 0) {
+          td::Time::update_cached();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
 #endif
 
 TEST(Misc, uint128) {
@@ -1245,10 +1381,94 @@ TEST(Misc, serialize) {
   ASSERT_EQ(td::base64_encode(td::serialize(y)), td::base64_encode(td::string("\xfe\xff\xff\xff\xff\xff\xff\xff", 8)));
 }
 
+namespace {
+struct TlStorerBoundedTestObject {
+  td::vector<td::string> strings;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    storer.store_int(static_cast<td::int32>(strings.size()));
+    for (auto &str : strings) {
+      storer.store_string(str);
+      storer.store_long(static_cast<td::int64>(str.size()) * 1000000007);
+    }
+  }
+};
+}  // namespace
+
+TEST(Misc, TlStorerBounded) {
+  TlStorerBoundedTestObject object;
+  for (size_t size : {0, 1, 2, 3, 4, 253, 254, 255, 1000}) {
+    object.strings.push_back(td::string(size, static_cast<char>('a' + size % 26)));
+  }
+  auto length = td::tl_calc_length(object);
+  td::string expected(length, '\0');
+  ASSERT_EQ(length, td::tl_store_unsafe(object, td::MutableSlice(expected).ubegin()));
+
+  for (size_t capacity = 0; capacity <= length + 8; capacity++) {
+    td::string buf(capacity, '\0');
+    td::TlStorerBounded storer(td::MutableSlice(buf).ubegin(), capacity);
+    object.store(storer);
+    ASSERT_EQ(length, storer.get_length());
+    ASSERT_EQ(capacity >= length, storer.is_complete());
+    if (storer.is_complete()) {
+      ASSERT_EQ(expected, buf.substr(0, length));
+    }
+  }
+}
+
 TEST(Misc, check_reset_guard) {
   CheckExitGuard check_exit_guard{false};
 }
 
+class TestTlObject {
+ public:
+  td::int32 id_ = 5;
+  td::string name_ = "name";
+  td::vector<td::int64> values_{1, -2};
+  td::unique_ptr<TestTlObject> child_;
+
+  void store(td::TlStorerToString &s, const char *field_name) const {
+    s.store_class_begin(field_name, "testTlObject");
+    s.store_field("id", id_);
+    s.store_field("name", name_);
+    s.store_vector_begin("values", values_.size());
+    for (auto value : values_) {
+      s.store_field("", value);
+    }
+    s.store_class_end();
+    s.store_object_field("child", child_.get());
+    if (child_ != nullptr) {
+      // nested serialization must not use the same thread-local buffer
+      s.store_field("child_string", to_string(*child_));
+    }
+    s.store_class_end();
+  }
+
+  static td::string to_string(const TestTlObject &object) {
+    td::TlStorerToString storer;
+    object.store(storer, "");
+    return storer.move_as_string();
+  }
+};
+
+TEST(Misc, TlStorerToString) {
+  TestTlObject object;
+  td::string expected =
+      "testTlObject {\n  id = 5\n  name = \"name\"\n  values = vector[2] {\n    1\n    -2\n  }\n  child = null\n}\n";
+  ASSERT_EQ(expected, TestTlObject::to_string(object));
+  ASSERT_EQ(expected, TestTlObject::to_string(object));
+  ASSERT_EQ(expected, PSTRING() << td::lazy_to_string(&object));
+
+  object.child_ = td::make_unique<TestTlObject>();
+  auto str = TestTlObject::to_string(object);
+  ASSERT_EQ(str, PSTRING() << td::lazy_to_string(&object));
+  ASSERT_TRUE(str.find("  child_string = \"testTlObject {\n  id = 5\n") != td::string::npos);
+
+  td::unique_ptr<TestTlObject> null_object;
+  ASSERT_EQ("null", PSTRING() << td::lazy_to_string(null_object));
+}
+
 TEST(FloodControl, Fast) {
   td::FloodControlFast fc;
   fc.add_limit(1, 5);
@@ -1291,3 +1511,79 @@ TEST(UniqueValuePtr, Basic) {
   ASSERT_TRUE(c == d);
   ASSERT_TRUE(6 == **d);
 }
+
+TEST(Hints, Stress) {
+  td::Random::Xorshift128plus rnd(123);
+  auto gen_word = [&] {
+    td::string word;
+    auto length = rnd.fast(1, 4);
+    for (int i = 0; i < length; i++) {
+      word += static_cast<char>('a' + rnd.fast(0, 3));
+    }
+    return word;
+  };
+
+  td::Hints hints;
+  std::unordered_map<td::int64, td::vector<td::string>> key_to_words;
+  std::unordered_map<td::int64, td::int64> key_to_rating;
+  for (int i = 0; i < 20000; i++) {
+    auto key = static_cast<td::int64>(rnd.fast(1, 1000));
+    auto type = rnd.fast(0, 9);
+    if (type <= 4) {
+      td::vector<td::string> words;
+      auto word_count = rnd.fast(1, 3);
+      for (int j = 0; j < word_count; j++) {
+        words.push_back(gen_word());
+      }
+      hints.add(key, td::implode(words));
+      key_to_words[key] = std::move(words);
+    } else if (type == 5) {
+      hints.remove(key);
+      key_to_words.erase(key);
+      key_to_rating.erase(key);
+    } else if (type == 6) {
+      auto rating = static_cast<td::int64>(rnd.fast(-10, 10));
+      hints.set_rating(key, rating);
+      key_to_rating[key] = rating;
+    } else {
+      td::vector<td::string> query_words;
+      auto word_count = rnd.fast(1, 2);
+      for (int j = 0; j < word_count; j++) {
+        query_words.push_back(gen_word());
+      }
+      auto limit = rnd.fast(1, 100);
+
+      td::vector<std::pair<td::int64, td::int64>> expected;
+      for (auto &it : key_to_words) {
+        bool is_found = true;
+        for (auto &query_word : query_words) {
+          bool is_word_found = false;
+          for (auto &word : it.second) {
+            if (td::begins_with(word, query_word)) {
+              is_word_found = true;
+            }
+          }
+          if (!is_word_found) {
+            is_found = false;
+          }
+        }
+        if (is_found) {
+          expected.emplace_back(key_to_rating[it.first], it.first);
+        }
+      }
+      std::sort(expected.begin(), expected.end());
+      auto expected_total_count = expected.size();
+      if (expected.size() > static_cast<size_t>(limit)) {
+        expected.resize(limit);
+      }
+
+      auto result = hints.search(td::implode(query_words), limit);
+      ASSERT_EQ(expected_total_count, result.first);
+      ASSERT_EQ(expected.size(), result.second.size());
+      for (size_t j = 0; j < expected.size(); j++) {
+        ASSERT_EQ(expected[j].second, result.second[j]);
+      }
+    }
+  }
+  ASSERT_EQ(key_to_words.size(), hints.size());
+}
@@ -5,13 +5,20 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/utils/algorithm.h"
+#include "td/utils/buffer.h"
+#include "td/utils/BufferedFd.h"
 #include "td/utils/common.h"
+#include "td/utils/filesystem.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/EventFd.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/FileIoUring.h"
 #include "td/utils/port/IoSlice.h"
+#include "td/utils/port/numa.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/Poll.h"
+#include "td/utils/port/PollFlags.h"
 #include "td/utils/port/signals.h"
 #include "td/utils/port/sleep.h"
 #include "td/utils/port/Stat.h"
@@ -106,6 +113,14 @@ TEST(Port, files) {
   fd.seek(0).ensure();
   ASSERT_EQ(13u, fd.read(buf_slice.substr(0, 13)).move_as_ok());
   ASSERT_STREQ("Habcd world?!", buf_slice.substr(0, 13));
+  fd.close();
+
+  td::string link_path = PSTRING() << main_dir << TD_DIR_SLASH << "B" << TD_DIR_SLASH << "t3.txt";
+  td::link(fd_path, link_path).ensure();
+  ASSERT_TRUE(td::link(fd_path, link_path).is_error());
+  td::unlink(fd_path).ensure();
+  fd = td::FileFd::open(link_path, td::FileFd::Read).move_as_ok();
+  ASSERT_EQ(13u, fd.get_size().move_as_ok());
 }
 
 TEST(Port, SparseFiles) {
@@ -178,6 +193,135 @@ TEST(Port, Writev) {
   td::unlink(test_file_path).ignore();
 }
 
+TEST(Port, BufferedFdWritev) {
+  td::CSlice test_file_path = "test.txt";
+  td::unlink(test_file_path).ignore();
+  td::BufferedFd<td::FileFd> fd(
+      td::FileFd::open(test_file_path, td::FileFd::Write | td::FileFd::CreateNew).move_as_ok());
+  td::string expected_content;
+  for (int i = 0; i < 100; i++) {
+    auto str = PSTRING() << i << ' ';
+    fd.output_buffer().append(td::BufferSlice(str));
+    expected_content += str;
+  }
+  ASSERT_EQ(expected_content.size(), fd.flush_write().move_as_ok());
+  ASSERT_EQ(1u, fd.get_write_syscall_count());
+  ASSERT_EQ(0u, fd.left_unwritten());
+  fd.close();
+
+  ASSERT_EQ(expected_content, td::read_file_str(test_file_path).move_as_ok());
+  td::unlink(test_file_path).ignore();
+}
+
+TEST(Port, FileIoUring) {
+  td::FileIoUring io;
+  auto status = io.init(4);
+  if (status.is_error()) {
+    LOG(ERROR) << "Asynchronous file I/O isn't supported: " << status;
+    return;
+  }
+
+  td::CSlice path = "io_uring.txt";
+  td::unlink(path).ignore();
+  auto fd = td::FileFd::open(path, td::FileFd::Write | td::FileFd::Read | td::FileFd::CreateNew).move_as_ok();
+  td::vector<td::string> parts{"abc", "defg", "hi", "j"};
+  td::int64 offset = 0;
+  for (size_t i = 0; i < parts.size(); i++) {
+    ASSERT_TRUE(io.can_submit());
+    io.submit_pwrite(fd, parts[i], offset, i).ensure();
+    offset += static_cast<td::int64>(parts[i].size());
+  }
+  ASSERT_TRUE(!io.can_submit());
+  ASSERT_TRUE(io.submit_pwrite(fd, "k", offset, 4).is_error());
+  fd.close();  // submitted queries must not depend on the file descriptor
+
+  io.wait_all();
+  ASSERT_EQ(0u, io.get_pending_query_count());
+  auto completions = io.get_completions();
+  ASSERT_EQ(parts.size(), completions.size());
+  for (auto &completion : completions) {
+    ASSERT_TRUE(completion.token < parts.size());
+    ASSERT_EQ(parts[completion.token].size(), completion.result.ok());
+  }
+
+  fd = td::FileFd::open(path, td::FileFd::Read).move_as_ok();
+  td::string content(static_cast<size_t>(offset), '\0');
+  io.submit_pread(fd, content, 0, 5).ensure();
+  io.wait_all();
+  completions = io.get_completions();
+  ASSERT_EQ(1u, completions.size());
+  ASSERT_EQ(5u, completions[0].token);
+  ASSERT_EQ(content.size(), completions[0].result.ok());
+  ASSERT_STREQ("abcdefghij", content);
+
+  io.submit_pwrite(fd, "k", offset, 6).ensure();  // the file is opened only for reading
+  io.wait_all();
+  completions = io.get_completions();
+  ASSERT_EQ(1u, completions.size());
+  ASSERT_TRUE(completions[0].result.is_error());
+
+  io.close();
+  fd.close();
+  td::unlink(path).ensure();
+}
+
+#if !TD_EVENTFD_UNSUPPORTED
+TEST(Port, Poll) {
+  td::Poll poll;
+  poll.init();
+  td::vector<td::EventFd> event_fds(100);
+  for (auto &event_fd : event_fds) {
+    event_fd.init();
+    poll.subscribe(event_fd.get_poll_info().extract_pollable_fd(nullptr), td::PollFlags::Read());
+  }
+
+  auto check_ready = [&](const td::vector<bool> &expected) {
+    auto end_time = td::Time::now() + 5;
+    while (true) {
+      poll.run(10);
+      bool is_ready = true;
+      for (size_t i = 0; i < event_fds.size(); i++) {
+        if (!event_fds[i].empty() && event_fds[i].get_poll_info().sync_with_poll().can_read() != expected[i]) {
+          is_ready = false;
+        }
+      }
+      if (is_ready) {
+        break;
+      }
+      ASSERT_TRUE(td::Time::now() < end_time);
+    }
+    for (size_t i = 0; i < event_fds.size(); i++) {
+      if (expected[i]) {
+        event_fds[i].acquire();
+      }
+    }
+  };
+
+  td::vector<bool> expected(event_fds.size());
+  for (size_t i = 0; i < event_fds.size(); i += 3) {
+    event_fds[i].release();
+    expected[i] = true;
+  }
+  check_ready(expected);
+
+  for (size_t i = 0; i < event_fds.size(); i++) {
+    if (i % 2 == 0) {
+      poll.unsubscribe_before_close(event_fds[i].get_poll_info().get_pollable_fd_ref());
+      event_fds[i].close();
+    } else {
+      event_fds[i].release();
+    }
+    expected[i] = i % 2 != 0;
+  }
+  check_ready(expected);
+
+  for (size_t i = 1; i < event_fds.size(); i += 2) {
+    poll.unsubscribe(event_fds[i].get_poll_info().get_pollable_fd_ref());
+  }
+  poll.clear();
+}
+#endif
+
 #if TD_PORT_POSIX && !TD_THREAD_UNSUPPORTED
 
 static std::mutex m;
@@ -323,3 +467,15 @@ TEST(Port, ThreadAffinityMask) {
   LOG(INFO) << old_mask;
 }
 #endif
+
+TEST(Port, NumaNodeCpuMasks) {
+  auto masks = td::get_numa_node_cpu_masks();
+  LOG(INFO) << "Have " << masks.size() << " NUMA nodes";
+  td::uint64 all_cpus = 0;
+  for (auto mask : masks) {
+    LOG(INFO) << "NUMA node CPU mask: " << mask;
+    ASSERT_TRUE(mask != 0);
+    ASSERT_EQ(0u, all_cpus & mask);
+    all_cpus |= mask;
+  }
+}
@@ -6,16 +6,21 @@
 //
 #include "data.h"
 
+#include "td/telegram/DbBlobCompression.h"
+
 #include "td/db/binlog/BinlogHelper.h"
 #include "td/db/binlog/ConcurrentBinlog.h"
 #include "td/db/BinlogKeyValue.h"
 #include "td/db/DbKey.h"
 #include "td/db/SeqKeyValue.h"
+#include "td/db/SqliteCacheBudget.h"
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteReadPool.h"
 #include "td/db/TsSeqKeyValue.h"
+#include "td/db/WriteBatcher.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/ConcurrentScheduler.h"
@@ -25,14 +30,21 @@
 #include "td/utils/filesystem.h"
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/Promise.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/Storer.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tests.h"
+#include "td/utils/Time.h"
 
+#include <atomic>
 #include <limits>
 #include <map>
 #include <memory>
@@ -65,6 +77,184 @@ TEST(DB, binlog_encryption_bug) {
   }
 }
 
+TEST(DB, binlog_group_commit) {
+  td::CSlice binlog_name = "test_binlog";
+  td::Binlog::destroy(binlog_name).ignore();
+
+  td::ConcurrentScheduler sched(1, 0);
+  auto binlog = std::make_shared<td::ConcurrentBinlog>();
+  int synced_count = 0;
+  {
+    auto guard = sched.get_main_guard();
+    binlog->init(binlog_name.str(), [](const td::BinlogEvent &) {}).ensure();
+    // the events must be synced because of the size limit long before the delay expires
+    binlog->set_group_commit(1000.0, 100);
+    for (int i = 0; i < 10; i++) {
+      binlog->add(1, td::create_storer(td::Slice("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA")),
+                  td::PromiseCreator::lambda([&synced_count](td::Unit) {
+                    if (++synced_count == 10) {
+                      td::Scheduler::instance()->finish();
+                    }
+                  }));
+    }
+  }
+  sched.start();
+  auto end_time = td::Time::now() + 10;
+  while (sched.run_main(10)) {
+    ASSERT_TRUE(td::Time::now() < end_time);
+  }
+  ASSERT_EQ(10, synced_count);
+  {
+    auto guard = sched.get_main_guard();
+    binlog->close_and_destroy();
+    binlog.reset();
+  }
+  sched.finish();
+}
+
+TEST(DB, binlog_incremental_compaction) {
+  td::CSlice binlog_name = "test_binlog";
+  td::Binlog::destroy(binlog_name).ignore();
+
+  for (auto db_key : {td::DbKey::empty(), td::DbKey::raw_key(td::string(32, 'A'))}) {
+    std::map<td::uint64, td::string> events;
+    bool was_compacting = false;
+    td::int64 compacted_size = 0;
+    {
+      td::Binlog binlog;
+      binlog.init(binlog_name.str(), [](const td::BinlogEvent &) {}, db_key).ensure();
+      binlog.set_incremental_compaction(true);
+      for (int i = 0; i < 50; i++) {
+        auto event_id = binlog.next_event_id();
+        events[event_id] = td::string(4000, static_cast<char>('a' + i % 26));
+        binlog.add_raw_event(td::BinlogEvent::create_raw(event_id, 1, 0, td::create_storer(events[event_id])),
+                             td::BinlogDebugInfo{__FILE__, __LINE__});
+      }
+      auto first_event_id = events.begin()->first;
+      for (int i = 0; i < 1000; i++) {
+        auto event_id = first_event_id + td::Random::fast(0, 49);
+        auto it = events.find(event_id);
+        if (i % 100 == 99 && it != events.end()) {
+          events.erase(it);
+          binlog.add_raw_event(td::BinlogEvent::create_raw(event_id, td::BinlogEvent::ServiceTypes::Empty,
+                                                           td::BinlogEvent::Flags::Rewrite, td::EmptyStorer()),
+                               td::BinlogDebugInfo{__FILE__, __LINE__});
+        } else if (it != events.end()) {
+          it->second = td::string(4000, static_cast<char>('a' + i % 26));
+          binlog.add_raw_event(td::BinlogEvent::create_raw(event_id, 1, td::BinlogEvent::Flags::Rewrite,
+                                                           td::create_storer(it->second)),
+                               td::BinlogDebugInfo{__FILE__, __LINE__});
+        }
+        was_compacting |= binlog.is_compacting();
+      }
+      while (binlog.is_compacting()) {
+        binlog.compaction_step(1 << 12);
+      }
+      auto stats = binlog.get_compaction_stats();
+      ASSERT_TRUE(stats.compaction_count > 0);
+      ASSERT_TRUE(stats.total_reclaimed_size > 0);
+      compacted_size = td::FileFd::open(binlog_name, td::FileFd::Flags::Read).move_as_ok().get_size().move_as_ok();
+      binlog.close().ensure();
+    }
+    ASSERT_TRUE(was_compacting);
+    ASSERT_TRUE(compacted_size < 1000 * 4000);
+
+    std::map<td::uint64, td::string> loaded_events;
+    td::Binlog binlog;
+    binlog
+        .init(
+            binlog_name.str(), [&](const td::BinlogEvent &event) { loaded_events[event.id_] = event.get_data().str(); },
+            db_key)
+        .ensure();
+    ASSERT_TRUE(events == loaded_events);
+    binlog.close_and_destroy().ensure();
+  }
+}
+
+TEST(DB, binlog_reload) {
+  td::CSlice binlog_name = "test_binlog";
+  td::Binlog::destroy(binlog_name).ignore();
+
+  for (auto db_key : {td::DbKey::empty(), td::DbKey::raw_key(td::string(32, 'A'))}) {
+    td::vector<td::string> events;
+    auto add_events = [&](int count) {
+      td::Binlog binlog;
+      binlog.init(binlog_name.str(), [](const td::BinlogEvent &) {}, db_key).ensure();
+      for (int i = 0; i < count; i++) {
+        events.push_back(td::string(td::Random::fast(1, 5000) * 4, static_cast<char>('a' + events.size() % 26)));
+        binlog.add_raw_event(td::BinlogEvent::create_raw(binlog.next_event_id(), 1, 0, td::create_storer(events.back())),
+                             td::BinlogDebugInfo{__FILE__, __LINE__});
+      }
+      binlog.close().ensure();
+    };
+    auto check_events = [&] {
+      td::vector<td::string> loaded_events;
+      td::Binlog binlog;
+      binlog
+          .init(
+              binlog_name.str(), [&](const td::BinlogEvent &event) { loaded_events.push_back(event.get_data().str()); },
+              db_key)
+          .ensure();
+      ASSERT_TRUE(events == loaded_events);
+    };
+
+    add_events(5000);
+    check_events();
+    add_events(10);
+    check_events();
+
+    // a partially written event must be truncated and new events must be appended after the last full event
+    {
+      auto fd = td::FileFd::open(binlog_name, td::FileFd::Flags::Write | td::FileFd::Flags::Append).move_as_ok();
+      fd.write("abacaba").ensure();
+    }
+    add_events(10);
+    check_events();
+
+    td::Binlog::destroy(binlog_name).ignore();
+  }
+}
+
+TEST(DB, binlog_replay_read_only) {
+  td::CSlice binlog_name = "test_binlog";
+  td::Binlog::destroy(binlog_name).ignore();
+
+  for (auto db_key : {td::DbKey::empty(), td::DbKey::raw_key(td::string(32, 'A'))}) {
+    td::vector<td::string> events;
+    td::Binlog binlog;
+    binlog.init(binlog_name.str(), [](const td::BinlogEvent &) {}, db_key).ensure();
+    for (int i = 0; i < 100; i++) {
+      events.push_back(td::string(td::Random::fast(1, 100) * 4, static_cast<char>('a' + i % 26)));
+      binlog.add_raw_event(td::BinlogEvent::create_raw(binlog.next_event_id(), 1, 0, td::create_storer(events.back())),
+                           td::BinlogDebugInfo{__FILE__, __LINE__});
+    }
+    binlog.sync();
+
+    // the binlog is still opened and locked, and a partially written event must be left as is
+    {
+      auto fd = td::FileFd::open(binlog_name, td::FileFd::Flags::Write | td::FileFd::Flags::Append).move_as_ok();
+      fd.write("abacaba").ensure();
+    }
+    auto old_data = td::read_file_str(binlog_name).move_as_ok();
+
+    td::vector<td::string> loaded_events;
+    td::Binlog::replay_read_only(
+        binlog_name.str(), [&](const td::BinlogEvent &event) { loaded_events.push_back(event.get_data().str()); },
+        db_key)
+        .ensure();
+    ASSERT_TRUE(events == loaded_events);
+    ASSERT_TRUE(old_data == td::read_file_str(binlog_name).move_as_ok());
+
+    if (!db_key.is_empty()) {
+      auto status = td::Binlog::replay_read_only(binlog_name.str(), [](const td::BinlogEvent &) {},
+                                                 td::DbKey::raw_key(td::string(32, 'B')));
+      ASSERT_EQ(static_cast<int>(td::Binlog::Error::WrongPassword), status.code());
+    }
+
+    binlog.close_and_destroy().ensure();
+  }
+}
+
 TEST(DB, binlog_encryption) {
   td::CSlice binlog_name = "test_binlog";
   td::Binlog::destroy(binlog_name).ignore();
@@ -143,6 +333,58 @@ TEST(DB, sqlite_lfs) {
   td::SqliteDb::destroy(path).ignore();
 }
 
+TEST(DB, sqlite_cache_budget) {
+  td::string path1 = "test_sqlite_db_cache1";
+  td::string path2 = "test_sqlite_db_cache2";
+  td::SqliteDb::destroy(path1).ignore();
+  td::SqliteDb::destroy(path2).ignore();
+  {
+    auto db1 = td::SqliteDb::open_with_key(path1, true, td::DbKey::empty()).move_as_ok();
+    auto db2 = td::SqliteDb::open_with_key(path2, true, td::DbKey::empty()).move_as_ok();
+    db1.exec("CREATE TABLE t (x INTEGER)").ensure();
+    for (int i = 0; i < 10; i++) {
+      db1.begin_write_transaction().ensure();
+      db1.exec(PSLICE() << "INSERT INTO t VALUES (" << i << ")").ensure();
+      db1.commit_transaction().ensure();
+    }
+
+    auto get_statistics = [&](const td::string &path) {
+      for (auto &statistics : td::SqliteCacheBudget::get_statistics()) {
+        if (statistics.path == path) {
+          return statistics;
+        }
+      }
+      UNREACHABLE();
+      return td::SqliteCacheBudget::ConnectionStatistics();
+    };
+    auto get_cache_size = [&db1] {
+      auto stmt = db1.get_statement("PRAGMA cache_size").move_as_ok();
+      stmt.step().ensure();
+      return stmt.view_int64(0);
+    };
+    ASSERT_TRUE(get_statistics(path1).hit_count + get_statistics(path1).miss_count > 0);
+    ASSERT_EQ(0, get_statistics(path1).cache_size);
+
+    const td::int64 budget = 16 << 20;
+    td::SqliteCacheBudget::set_budget(budget);
+    auto cache_size1 = get_statistics(path1).cache_size;
+    auto cache_size2 = get_statistics(path2).cache_size;
+    ASSERT_TRUE(cache_size1 > cache_size2);
+    ASSERT_TRUE(cache_size2 > 0);
+    ASSERT_TRUE(cache_size1 + cache_size2 <= budget);
+
+    db1.update_cache_size();
+    ASSERT_EQ(-(cache_size1 >> 10), get_cache_size());
+
+    td::SqliteCacheBudget::set_budget(0);
+    ASSERT_EQ(0, get_statistics(path2).cache_size);
+    db1.update_cache_size();
+    ASSERT_EQ(-2000, get_cache_size());
+  }
+  td::SqliteDb::destroy(path1).ignore();
+  td::SqliteDb::destroy(path2).ignore();
+}
+
 TEST(DB, sqlite_encryption) {
   td::string path = "test_sqlite_db";
   td::SqliteDb::destroy(path).ignore();
@@ -198,6 +440,52 @@ TEST(DB, sqlite_encryption) {
   td::SqliteDb::destroy(path).ignore();
 }
 
+TEST(DB, sqlite_encryption_cipher_profile) {
+  td::string path = "test_sqlite_db";
+  td::SqliteDb::destroy(path).ignore();
+
+  auto empty = td::DbKey::empty();
+  auto tomato = td::DbKey::raw_key(td::string(32, 'a'));
+  auto fast_tomato = tomato;
+  td::DbCipherProfile fast_profile;
+  fast_profile.page_size = 8192;
+  fast_profile.hmac = td::DbCipherProfile::Hmac::None;
+  fast_tomato.set_cipher_profile(fast_profile);
+  auto sha1_tomato = tomato;
+  td::DbCipherProfile sha1_profile;
+  sha1_profile.hmac = td::DbCipherProfile::Hmac::Sha1;
+  sha1_tomato.set_cipher_profile(sha1_profile);
+
+  auto check_db = [&](const td::DbKey &key) {
+    auto db = td::SqliteDb::open_with_key(path, false, key).move_as_ok();
+    auto kv = td::SqliteKeyValue();
+    kv.init_with_connection(db.clone(), "kv").ensure();
+    CHECK(kv.get("a") == "b");
+    CHECK(db.user_version().ok() == 123);
+  };
+
+  {
+    auto db = td::SqliteDb::change_key(path, true, fast_tomato, empty).move_as_ok();
+    db.set_user_version(123).ensure();
+    auto kv = td::SqliteKeyValue();
+    kv.init_with_connection(db.clone(), "kv").ensure();
+    kv.set("a", "b");
+  }
+  check_db(fast_tomato);
+  td::SqliteDb::open_with_key(path, false, tomato).ensure_error();
+
+  td::SqliteDb::change_key(path, false, tomato, fast_tomato).ensure();
+  check_db(tomato);
+  td::SqliteDb::open_with_key(path, false, fast_tomato).ensure_error();
+
+  td::SqliteDb::change_key(path, false, sha1_tomato, tomato).ensure();
+  check_db(sha1_tomato);
+
+  td::SqliteDb::change_key(path, false, empty, sha1_tomato).ensure();
+  check_db(empty);
+  td::SqliteDb::destroy(path).ignore();
+}
+
 TEST(DB, sqlite_encryption_migrate_v3) {
   td::string path = "test_sqlite_db";
   td::SqliteDb::destroy(path).ignore();
@@ -263,6 +551,156 @@ TEST(DB, sqlite_encryption_migrate_v4) {
   td::SqliteDb::destroy(path).ignore();
 }
 
+TEST(DB, sqlite_key_value_batch) {
+  td::string path = "test_sqlite_db";
+  td::SqliteDb::destroy(path).ignore();
+  auto db = td::SqliteDb::open_with_key(path, true, td::DbKey::empty()).move_as_ok();
+  td::SqliteKeyValue kv;
+  kv.init_with_connection(db.clone(), "kv").ensure();
+
+  td::FlatHashMap<td::string, td::string> expected;
+  for (int i = 0; i < 100; i++) {
+    expected[PSTRING() << "key" << i] = td::rand_string('a', 'z', td::Random::fast(0, 10));
+  }
+  kv.set_all(expected);
+
+  td::vector<td::string> keys;
+  for (int i = 0; i < 150; i++) {
+    keys.push_back(PSTRING() << "key" << td::Random::fast(0, 120));
+  }
+  auto values = kv.get_many(keys);
+  ASSERT_EQ(keys.size(), values.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto it = expected.find(keys[i]);
+    ASSERT_EQ(it == expected.end() ? td::string() : it->second, values[i]);
+    ASSERT_EQ(kv.get(keys[i]), values[i]);
+  }
+
+  kv.erase_batch(keys);
+  for (auto &key : keys) {
+    expected.erase(key);
+  }
+  auto all = kv.get_all();
+  ASSERT_EQ(expected.size(), all.size());
+  for (auto &it : expected) {
+    ASSERT_EQ(it.second, all[it.first]);
+  }
+  kv.close();
+  td::SqliteDb::destroy(path).ignore();
+}
+
+TEST(DB, sqlite_read_pool) {
+  td::string path = "test_sqlite_db";
+  td::SqliteDb::destroy(path).ignore();
+  {
+    auto db = td::SqliteDb::open_with_key(path, true, td::DbKey::empty()).move_as_ok();
+    td::SqliteKeyValue::init(db, "kv").ensure();
+  }
+
+  td::ConcurrentScheduler sched(2, 0);
+  std::shared_ptr<td::SqliteConnectionSafe> connection;
+  std::shared_ptr<td::SqliteKeyValueSafe> kv_safe;
+  std::atomic<int> read_count{0};
+  std::atomic<int> wrong_count{0};
+  {
+    auto guard = sched.get_main_guard();
+    connection = std::make_shared<td::SqliteConnectionSafe>(path, td::DbKey::empty());
+    kv_safe = std::make_shared<td::SqliteKeyValueSafe>("kv", connection);
+    auto &kv = kv_safe->get();
+    kv.begin_write_transaction().ensure();
+    for (int i = 0; i < 10; i++) {
+      kv.set(PSLICE() << "key" << i, PSLICE() << "value" << i);
+    }
+    kv.commit_transaction().ensure();
+
+    auto read_pool = std::make_shared<td::SqliteReadPool>(td::vector<td::int32>{1, 2});
+    for (int i = 0; i < 10; i++) {
+      read_pool->run([kv_safe, i, &read_count, &wrong_count] {
+        if (td::Scheduler::instance()->sched_id() == 0 ||
+            kv_safe->get().get(PSLICE() << "key" << i) != (PSTRING() << "value" << i)) {
+          wrong_count++;
+        }
+        read_count++;
+      });
+    }
+    read_pool->flush(td::PromiseCreator::lambda([](td::Unit) { td::Scheduler::instance()->finish(); }));
+  }
+  sched.start();
+  auto end_time = td::Time::now() + 10;
+  while (sched.run_main(10)) {
+    ASSERT_TRUE(td::Time::now() < end_time);
+  }
+  ASSERT_EQ(10, read_count.load());
+  ASSERT_EQ(0, wrong_count.load());
+  {
+    auto guard = sched.get_main_guard();
+    kv_safe.reset();
+    connection->close();
+    connection.reset();
+  }
+  sched.finish();
+  td::SqliteDb::destroy(path).ignore();
+}
+
+TEST(DB, db_blob_compression) {
+  td::string data("\x05\x00\x00\x00", 4);
+  for (int i = 0; i < 100; i++) {
+    data += "repeated message text ";
+  }
+
+  td::DbBlobCompression::set_enabled(false);
+  ASSERT_EQ(data, td::DbBlobCompression::compress(td::BufferSlice(data)).as_slice());
+
+  td::DbBlobCompression::set_enabled(true);
+  auto blob = td::DbBlobCompression::compress(td::BufferSlice(data));
+  ASSERT_TRUE(blob.size() < data.size());
+  ASSERT_EQ(data, td::DbBlobCompression::decompress(blob.as_slice()).as_slice());
+
+  td::string small_data = td::string("\x05\x00\x00\x00", 4) + "small";
+  ASSERT_EQ(small_data, td::DbBlobCompression::compress(td::BufferSlice(small_data)).as_slice());
+  ASSERT_EQ(small_data, td::DbBlobCompression::decompress(small_data).as_slice());
+
+  auto random_data = td::rand_string(0, 255, 1000);
+  random_data[3] = '\0';
+  ASSERT_EQ(random_data, td::DbBlobCompression::compress(td::BufferSlice(random_data)).as_slice());
+
+  auto broken_blob = blob.as_slice().str();
+  broken_blob.pop_back();
+  ASSERT_TRUE(td::DbBlobCompression::decompress(broken_blob).empty());
+  td::DbBlobCompression::set_enabled(false);
+}
+
+TEST(DB, write_batcher) {
+  td::WriteBatcher batcher;
+  auto initial_stats = batcher.get_stats();
+  ASSERT_TRUE(batcher.need_flush(initial_stats.max_batch_size));
+  ASSERT_TRUE(!batcher.need_flush(initial_stats.max_batch_size - 1));
+
+  // batch size grows while there is a backlog
+  for (int i = 0; i < 10; i++) {
+    batcher.on_commit(batcher.get_stats().max_batch_size, 0.001);
+  }
+  auto burst_stats = batcher.get_stats();
+  ASSERT_TRUE(burst_stats.max_batch_size > initial_stats.max_batch_size);
+  ASSERT_TRUE(!batcher.need_flush(initial_stats.max_batch_size));
+  ASSERT_EQ(10u, burst_stats.commit_count);
+
+  // and shrinks back for single writes
+  for (int i = 0; i < 100; i++) {
+    batcher.on_commit(1, 0.0001);
+  }
+  auto idle_stats = batcher.get_stats();
+  ASSERT_EQ(initial_stats.max_batch_size, idle_stats.max_batch_size);
+  ASSERT_TRUE(idle_stats.flush_delay < initial_stats.flush_delay);
+  ASSERT_TRUE(batcher.get_flush_time(1.0) < 1.0 + initial_stats.flush_delay);
+
+  // too long commits decrease the batch size
+  batcher.on_commit(idle_stats.max_batch_size, 0.001);
+  auto size = batcher.get_stats().max_batch_size;
+  batcher.on_commit(10, 1.0);
+  ASSERT_TRUE(batcher.get_stats().max_batch_size < size);
+}
+
 using SeqNo = td::uint64;
 struct DbQuery {
   enum class Type { Get, Set, Erase, EraseBatch } type = Type::Get;
@@ -520,7 +958,108 @@ TEST(DB, key_value_set_all) {
   td::SqliteDb::destroy(sqlite_kv_name).ignore();
 }
 
+TEST(DB, binlog_key_value_snapshot) {
+  using KeyValue = td::BinlogKeyValue<td::Binlog>;
+  td::CSlice name = "test_binlog_kv";
+  KeyValue::destroy(name).ignore();
+
+  std::map<td::string, td::string> expected;
+  auto check = [&](KeyValue &kv) {
+    auto all = kv.get_all();
+    ASSERT_EQ(expected.size(), all.size());
+    for (auto &it : expected) {
+      ASSERT_EQ(it.second, kv.get(it.first));
+    }
+  };
+
+  for (int iter = 0; iter < 10; iter++) {
+    KeyValue kv;
+    kv.init(name.str()).ensure();
+    check(kv);
+    for (int i = 0; i < 2000; i++) {
+      auto key = PSTRING() << (td::Random::fast_bool() ? "a" : "b") << td::Random::fast(0, 1000);
+      auto op = td::Random::fast(0, 20);
+      if (op == 0) {
+        td::vector<td::string> keys{key, PSTRING() << key << 'x', PSTRING() << 'a' << td::Random::fast(0, 1000)};
+        kv.erase_batch(keys);
+        for (auto &erased_key : keys) {
+          expected.erase(erased_key);
+        }
+      } else if (op <= 4) {
+        kv.erase(key);
+        expected.erase(key);
+      } else if (op == 5 && iter % 3 == 2) {
+        kv.erase_by_prefix(key);
+        for (auto it = expected.begin(); it != expected.end();) {
+          if (td::begins_with(it->first, key)) {
+            it = expected.erase(it);
+          } else {
+            ++it;
+          }
+        }
+      } else {
+        auto value = td::to_string(td::Random::fast(0, 1000000));
+        kv.set(key, value);
+        expected[key] = value;
+      }
+    }
+    check(kv);
+    if (iter == 5) {
+      kv.save_snapshot().ensure();
+      check(kv);
+    }
+    kv.close();
+  }
+
+  ASSERT_TRUE(td::stat(KeyValue::get_snapshot_path(name)).is_ok());
+  KeyValue::destroy(name).ignore();
+  ASSERT_TRUE(td::stat(KeyValue::get_snapshot_path(name)).is_error());
+}
+
 #if !TD_THREAD_UNSUPPORTED
+TEST(DB, binlog_key_value_concurrent_get) {
+  using KeyValue = td::BinlogKeyValue<td::Binlog>;
+  td::CSlice name = "test_binlog";
+  KeyValue::destroy(name).ignore();
+
+  int keys_n = 100;
+  int writes_n = 20000;
+  int threads_n = 4;
+
+  KeyValue kv;
+  kv.init(name.str()).ensure();
+  std::atomic<bool> is_finished{false};
+  td::vector<td::thread> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&] {
+      // values of each key only increase, so a reader must never see an older value after a newer one
+      td::vector<int> last_values(keys_n, 0);
+      while (!is_finished.load()) {
+        auto key_id = td::Random::fast(0, keys_n - 1);
+        auto value = kv.get(PSTRING() << key_id);
+        if (value.empty()) {
+          continue;
+        }
+        auto int_value = td::to_integer<int>(value);
+        ASSERT_TRUE(int_value >= last_values[key_id]);
+        last_values[key_id] = int_value;
+      }
+    });
+  }
+  for (int i = 1; i <= writes_n; i++) {
+    kv.set(PSTRING() << td::Random::fast(0, keys_n - 1), PSTRING() << i);
+    if (i % 1000 == 0) {
+      kv.erase_by_prefix("1");
+    }
+  }
+  is_finished = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  kv.close();
+  KeyValue::destroy(name).ignore();
+}
+
 TEST(DB, thread_key_value) {
   td::vector<td::string> keys;
   td::vector<td::string> values;
@@ -463,6 +463,23 @@ TEST(Http, gzip_bomb_with_limit) {
   ASSERT_TRUE(ok);
 }
 
+TEST(Http, header_creator) {
+  ASSERT_EQ("Thu, 01 Jan 1970 00:00:00 GMT", td::HttpHeaderCreator::format_http_date(0));
+  ASSERT_EQ("Sun, 06 Nov 1994 08:49:37 GMT", td::HttpHeaderCreator::format_http_date(784111777));
+  ASSERT_EQ("Tue, 29 Feb 2000 23:59:59 GMT", td::HttpHeaderCreator::format_http_date(951868799));
+  ASSERT_EQ("Mon, 01 Jan 2024 12:00:00 GMT", td::HttpHeaderCreator::format_http_date(1704110400));
+
+  auto date_header = td::HttpHeaderCreator::get_date_header();
+  ASSERT_TRUE(td::begins_with(date_header, "Date: "));
+  ASSERT_TRUE(td::ends_with(date_header, " GMT\r\n"));
+
+  td::HttpHeaderCreator hc;
+  hc.init_ok();
+  hc.add_header_lines("Server: TDLib\r\n");
+  hc.set_content_size(2);
+  ASSERT_EQ("HTTP/1.1 200 OK\r\nServer: TDLib\r\nContent-Length: 2\r\n\r\nok", hc.finish("ok").ok());
+}
+
 #if TD_DARWIN_WATCH_OS
 struct Baton {
   std::mutex mutex;
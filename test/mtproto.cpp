@@ -4,6 +4,8 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "mtproto_server.h"
+
 #include "td/telegram/ConfigManager.h"
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/PublicRsaKeyShared.h"
@@ -11,7 +13,9 @@
 #include "td/telegram/NotificationManager.h"
 
 #include "td/mtproto/AuthData.h"
+#include "td/mtproto/CryptoWorkerPool.h"
 #include "td/mtproto/DhCallback.h"
+#include "td/mtproto/DhExponentPool.h"
 #include "td/mtproto/DhHandshake.h"
 #include "td/mtproto/Handshake.h"
 #include "td/mtproto/HandshakeActor.h"
@@ -21,28 +25,36 @@
 #include "td/mtproto/RawConnection.h"
 #include "td/mtproto/RSA.h"
 #include "td/mtproto/TlsInit.h"
+#include "td/mtproto/Transport.h"
 #include "td/mtproto/TransportType.h"
 
 #include "td/net/GetHostByNameActor.h"
 #include "td/net/Socks5.h"
 #include "td/net/TransparentProxy.h"
 
+#include "td/tl/TlArena.h"
+
 #include "td/actor/actor.h"
 #include "td/actor/ConcurrentScheduler.h"
 
+#include "td/utils/algorithm.h"
+#include "td/utils/as.h"
 #include "td/utils/base64.h"
+#include "td/utils/BigNum.h"
 #include "td/utils/BufferedFd.h"
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
 #include "td/utils/port/IPAddress.h"
+#include "td/utils/port/sleep.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Promise.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/Storer.h"
 #include "td/utils/tests.h"
 #include "td/utils/Time.h"
 
@@ -720,6 +732,97 @@ TEST(Mtproto, TlsTransport) {
   sched.finish();
 }
 
+TEST(Mtproto, TransportRead) {
+  td::mtproto::AuthKey auth_key(td::Random::secure_uint64(), td::rand_string(0, 255, 256));
+  for (size_t data_size : {4, 16, 100, 1000, 65536}) {
+    auto data = td::rand_string('a', 'z', data_size);
+    td::string message(4, '\0');
+    td::as<td::uint32>(&message[0]) = static_cast<td::uint32>(data_size);
+    message += data;
+    auto storer = td::create_storer(message);
+
+    td::mtproto::PacketInfo write_info;
+    write_info.type = td::mtproto::PacketInfo::EndToEnd;
+    write_info.version = 2;
+    write_info.is_creator = true;
+    auto packet_size = td::mtproto::Transport::write(storer, auth_key, &write_info);
+    td::string packet(packet_size + 1, '\0');
+    auto encrypted = td::MutableSlice(packet).substr(1);
+    ASSERT_EQ(packet_size, td::mtproto::Transport::write(storer, auth_key, &write_info, encrypted));
+
+    auto read = [&](td::Slice message, td::MutableSlice dest) {
+      td::mtproto::PacketInfo read_info;
+      read_info.type = td::mtproto::PacketInfo::EndToEnd;
+      read_info.version = 2;
+      auto read_result = td::mtproto::Transport::read(message, dest, auth_key, &read_info).move_as_ok();
+      ASSERT_EQ(td::mtproto::Transport::ReadResult::Packet, read_result.type());
+      ASSERT_EQ(data, read_result.packet().substr(4).str());
+    };
+
+    // out of place from an unaligned buffer
+    auto original = encrypted.str();
+    td::string dest(packet_size, '\0');
+    read(encrypted, dest);
+    ASSERT_EQ(original, encrypted.str());
+
+    // in place
+    read(encrypted, encrypted);
+  }
+}
+
+TEST(Mtproto, CryptoWorkerPool) {
+  for (td::int32 worker_count : {0, 1, 3, 0}) {
+    td::mtproto::CryptoWorkerPool::set_worker_count(worker_count);
+    ASSERT_EQ(worker_count > 0, td::mtproto::CryptoWorkerPool::is_enabled());
+    for (size_t task_count : {0, 1, 2, 100}) {
+      td::vector<td::string> hashes(task_count);
+      td::mtproto::CryptoWorkerPool::run(task_count, [&](size_t i) {
+        ASSERT_TRUE(hashes[i].empty());
+        hashes[i] = td::string(32, '\0');
+        td::sha256(td::string(100000, static_cast<char>('a' + i % 26)), hashes[i]);
+      });
+      for (size_t i = 0; i < task_count; i++) {
+        td::string expected(32, '\0');
+        td::sha256(td::string(100000, static_cast<char>('a' + i % 26)), expected);
+        ASSERT_EQ(expected, hashes[i]);
+      }
+    }
+  }
+}
+
+TEST(Mtproto, DhExponentPool) {
+  td::BigNum prime;
+  td::BigNum::random(prime, 2048, 0, 1);
+  auto prime_str = prime.to_binary();
+  td::int32 g_int = 3;
+  td::BigNum g;
+  g.set_value(g_int);
+  td::BigNumContext ctx;
+
+  td::BigNum b;
+  td::BigNum g_b;
+  ASSERT_TRUE(!td::mtproto::DhExponentPool::take(g_int, prime_str, b, g_b));
+  td::mtproto::DhExponentPool::set_max_size(2);
+  ASSERT_TRUE(!td::mtproto::DhExponentPool::take(g_int, prime_str, b, g_b));
+
+  td::vector<td::string> used_b;
+  for (int i = 0; i < 3; i++) {
+    auto end_time = td::Time::now() + 10;
+    while (!td::mtproto::DhExponentPool::take(g_int, prime_str, b, g_b)) {
+      ASSERT_TRUE(td::Time::now() < end_time);
+      td::usleep_for(1000);
+    }
+    td::BigNum expected_g_b;
+    td::BigNum::mod_exp(expected_g_b, g, b, prime, ctx);
+    ASSERT_EQ(expected_g_b.to_binary(), g_b.to_binary());
+    ASSERT_TRUE(!td::contains(used_b, b.to_binary()));
+    used_b.push_back(b.to_binary());
+  }
+
+  td::mtproto::DhExponentPool::set_max_size(0);
+  ASSERT_TRUE(!td::mtproto::DhExponentPool::take(g_int, prime_str, b, g_b));
+}
+
 TEST(Mtproto, RSA) {
   auto pem = td::Slice(
       "-----BEGIN RSA PUBLIC KEY-----\n"
@@ -738,3 +841,97 @@ TEST(Mtproto, RSA) {
   rsa.encrypt(pem.substr(0, 256), to);
   ASSERT_EQ("U2nJEtB2AgpHrm3HB0yhpTQgb0wbesi9Pv/W1v/vULU=", td::base64_encode(td::sha256(to)));
 }
+
+namespace {
+class TlArenaObject final : public td::TlObject {
+ public:
+  td::string data_;
+  td::int64 value_ = 0;
+
+  static void *operator new(std::size_t size) {
+    return td::TlArena::allocate(size);
+  }
+
+  static void operator delete(void *ptr) noexcept {
+    td::TlArena::deallocate(ptr);
+  }
+
+  std::int32_t get_id() const final {
+    return 0;
+  }
+
+  void store(td::TlStorerToString &s, const char *field_name) const final {
+  }
+};
+}  // namespace
+
+TEST(Mtproto, TlArena) {
+  td::vector<td::tl_object_ptr<td::TlObject>> objects;
+  for (int i = 0; i < 3; i++) {
+    {
+      td::TlArena::Scope arena_scope;
+      for (int j = 0; j < 10000; j++) {
+        auto object = td::make_tl_object<TlArenaObject>();
+        object->data_ = td::string(td::Random::fast(0, 100), 'a');
+        object->value_ = j;
+        objects.push_back(std::move(object));
+      }
+    }
+    objects.push_back(td::make_tl_object<TlArenaObject>());
+    for (size_t j = 1; j < objects.size(); j++) {
+      std::swap(objects[j], objects[td::Random::fast(0, static_cast<int>(j))]);
+    }
+    objects.resize(objects.size() / 2);
+  }
+  for (auto &object : objects) {
+    auto &arena_object = static_cast<TlArenaObject &>(*object);
+    ASSERT_TRUE(arena_object.value_ >= 0 && arena_object.value_ < 10000);
+    ASSERT_TRUE(arena_object.data_.size() <= 100u);
+  }
+}
+
+TEST(Mtproto, EmulatedServer) {
+  auto server = std::make_shared<td::MtprotoTestServer>();
+  server->set_query_handler([](td::Slice query) -> td::Result<td::BufferSlice> {
+    if (query.size() < 4) {
+      return td::Status::Error(400, "QUERY_TOO_SHORT");
+    }
+    return td::BufferSlice(PSLICE() << query.substr(0, 4) << query);
+  });
+  server->set_processing_time(0.001);
+  server->set_flood_wait(0.05, 1);
+
+  td::NetworkEmulationOptions options;
+  options.rtt = 0.01;
+  options.bandwidth = 1 << 20;
+  options.loss_rate = 0.01;
+
+  td::vector<td::BufferSlice> queries;
+  for (int i = 0; i < 100; i++) {
+    queries.emplace_back(td::string(4 + 4 * i, static_cast<char>('a' + i % 26)));
+  }
+
+  td::ConcurrentScheduler sched(0, 0);
+  td::Result<td::MtprotoTestClient::Stats> r_stats;
+  {
+    auto guard = sched.get_main_guard();
+    td::create_actor<td::MtprotoTestClient>(
+        "MtprotoTestClient", server, options, std::move(queries), 10,
+        td::PromiseCreator::lambda([&r_stats](td::Result<td::MtprotoTestClient::Stats> result) {
+          r_stats = std::move(result);
+          td::Scheduler::instance()->finish();
+        }))
+        .release();
+  }
+  sched.start();
+  while (sched.run_main(10)) {
+  }
+  sched.finish();
+
+  ASSERT_TRUE(r_stats.is_ok());
+  auto stats = r_stats.move_as_ok();
+  ASSERT_EQ(100u, stats.result_count);
+  ASSERT_EQ(0u, stats.error_count);
+  ASSERT_EQ(stats.flood_wait_count, server->get_stats().flood_wait_count);
+  ASSERT_TRUE(server->get_stats().query_count >= 100u);
+}
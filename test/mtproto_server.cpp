@@ -0,0 +1,745 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "mtproto_server.h"
+
+#include "td/mtproto/DhHandshake.h"
+#include "td/mtproto/mtproto_api.h"
+#include "td/mtproto/PacketInfo.h"
+#include "td/mtproto/TcpTransport.h"
+#include "td/mtproto/Transport.h"
+#include "td/mtproto/TransportType.h"
+#include "td/mtproto/utils.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/as.h"
+#include "td/utils/format.h"
+#include "td/utils/Gzip.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/Clocks.h"
+#include "td/utils/port/EventFd.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Storer.h"
+#include "td/utils/Time.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/VectorQueue.h"
+
+#include <algorithm>
+
+namespace td {
+
+namespace {
+
+string serialize_object(const mtproto_api::Object &object) {
+  auto storer = mtproto::create_storer(object);
+  string result(storer.size(), '\0');
+  auto real_size = storer.store(MutableSlice(result).ubegin());
+  CHECK(real_size == result.size());
+  return result;
+}
+
+// one direction of an emulated TCP connection; data is split into segments, which are delivered in order
+class EmulatedLink {
+ public:
+  explicit EmulatedLink(const NetworkEmulationOptions &options, uint64 seed) : options_(options), random_(seed) {
+    CHECK(options_.segment_size > 0);
+  }
+
+  void send(double send_time, Slice data) {
+    while (!data.empty()) {
+      auto segment = data.substr(0, options_.segment_size);
+      data.remove_prefix(segment.size());
+
+      auto start_time = max(send_time, link_free_time_);
+      link_free_time_ = start_time;
+      if (options_.bandwidth > 0) {
+        link_free_time_ += static_cast<double>(segment.size()) / options_.bandwidth;
+      }
+      auto arrival_time = link_free_time_ + options_.rtt * 0.5;
+      if (options_.loss_rate > 0 && random_.fast(0, 999999) < static_cast<int>(options_.loss_rate * 1e6)) {
+        arrival_time += options_.retransmission_timeout;
+      }
+      // TCP delivers data in order, so a lost segment delays all subsequent segments
+      arrival_time = max(arrival_time, last_arrival_time_);
+      last_arrival_time_ = arrival_time;
+      segments_.push(Segment{arrival_time, BufferSlice(segment)});
+    }
+  }
+
+  double get_next_arrival_time() const {
+    return segments_.empty() ? 0.0 : segments_.front().arrival_time;
+  }
+
+  // returns arrival time of the received segment
+  double receive_segment(ChainBufferWriter &output) {
+    CHECK(!segments_.empty());
+    auto &segment = segments_.front();
+    auto arrival_time = segment.arrival_time;
+    output.append(std::move(segment.data));
+    segments_.pop();
+    return arrival_time;
+  }
+
+ private:
+  struct Segment {
+    double arrival_time;
+    BufferSlice data;
+  };
+
+  NetworkEmulationOptions options_;
+  Random::Xorshift128plus random_;
+  VectorQueue<Segment> segments_;
+  double link_free_time_ = 0.0;
+  double last_arrival_time_ = 0.0;
+};
+
+}  // namespace
+
+// client side of a connection to MtprotoTestServer; uses the same intermediate transport as real TCP connections
+class EmulatedRawConnection final : public mtproto::RawConnection {
+ public:
+  EmulatedRawConnection(MtprotoTestServer *server, const NetworkEmulationOptions &options)
+      : server_(server)
+      , uplink_(options, options.seed)
+      , downlink_(options, options.seed * 2 + 1)
+      , client_input_reader_(client_input_.extract_reader())
+      , client_output_reader_(client_output_.extract_reader())
+      , server_input_reader_(server_input_.extract_reader())
+      , server_transport_(false) {
+    event_fd_.init();
+    client_transport_.init(&client_input_reader_, &client_output_);
+  }
+  EmulatedRawConnection(const EmulatedRawConnection &) = delete;
+  EmulatedRawConnection &operator=(const EmulatedRawConnection &) = delete;
+  EmulatedRawConnection(EmulatedRawConnection &&) = delete;
+  EmulatedRawConnection &operator=(EmulatedRawConnection &&) = delete;
+  ~EmulatedRawConnection() final {
+    close();
+  }
+
+  void set_connection_token(mtproto::ConnectionManager::ConnectionToken connection_token) final {
+    connection_token_ = std::move(connection_token);
+  }
+
+  bool can_send() const final {
+    return true;
+  }
+
+  mtproto::TransportType get_transport_type() const final {
+    return mtproto::TransportType{mtproto::TransportType::Tcp, 0, mtproto::ProxySecret()};
+  }
+
+  size_t send_crypto(const Storer &storer, int64 session_id, int64 salt, const mtproto::AuthKey &auth_key,
+                     uint64 quick_ack_token) final {
+    mtproto::PacketInfo info;
+    info.version = 2;
+    info.salt = salt;
+    info.session_id = session_id;
+
+    auto packet = BufferWriter{mtproto::Transport::write(storer, auth_key, &info),
+                               client_transport_.max_prepend_size(), client_transport_.max_append_size()};
+    mtproto::Transport::write(storer, auth_key, &info, packet.as_mutable_slice());
+
+    auto packet_size = packet.size();
+    client_transport_.write(std::move(packet), false);
+    return packet_size;
+  }
+
+  uint64 send_no_crypto(const Storer &storer) final {
+    LOG(ERROR) << "Key exchange isn't supported by the test server";
+    has_error_ = true;
+    return 0;
+  }
+
+  PollableFdInfo &get_poll_info() final {
+    return event_fd_.get_poll_info();
+  }
+
+  StatsCallback *stats_callback() final {
+    return nullptr;
+  }
+
+  Status flush(const mtproto::AuthKey &auth_key, Callback &callback) final {
+    if (has_error_) {
+      return Status::Error("Connection has already failed");
+    }
+    auto status = do_flush(auth_key, callback);
+    if (status.is_error()) {
+      has_error_ = true;
+    }
+    return status;
+  }
+
+  bool has_error() const final {
+    return has_error_;
+  }
+
+  void close() final {
+    if (server_ != nullptr) {
+      server_->on_connection_closed(this);
+      server_ = nullptr;
+    }
+    if (!event_fd_.empty()) {
+      event_fd_.close();
+    }
+  }
+
+  PublicFields &extra() final {
+    return extra_;
+  }
+  const PublicFields &extra() const final {
+    return extra_;
+  }
+
+  double get_next_event_time() const {
+    auto uplink_time = uplink_.get_next_arrival_time();
+    auto downlink_time = downlink_.get_next_arrival_time();
+    if (uplink_time == 0.0 || (downlink_time != 0.0 && downlink_time < uplink_time)) {
+      return downlink_time;
+    }
+    return uplink_time;
+  }
+
+ private:
+  MtprotoTestServer *server_;
+  PublicFields extra_;
+  EventFd event_fd_;
+  mtproto::ConnectionManager::ConnectionToken connection_token_;
+  bool has_error_ = false;
+
+  EmulatedLink uplink_;
+  EmulatedLink downlink_;
+
+  ChainBufferWriter client_input_;
+  ChainBufferReader client_input_reader_;
+  ChainBufferWriter client_output_;
+  ChainBufferReader client_output_reader_;
+  mtproto::tcp::OldTransport client_transport_;
+
+  ChainBufferWriter server_input_;
+  ChainBufferReader server_input_reader_;
+  mtproto::tcp::IntermediateTransport server_transport_;
+  bool is_server_transport_inited_ = false;
+
+  void send_client_output() {
+    client_output_reader_.sync_with_writer();
+    if (client_output_reader_.empty()) {
+      return;
+    }
+    BufferSlice data(client_output_reader_.size());
+    client_output_reader_.advance(data.size(), data.as_mutable_slice());
+    uplink_.send(Time::now(), data.as_slice());
+  }
+
+  Status run_server(double now) {
+    while (uplink_.get_next_arrival_time() != 0.0 && uplink_.get_next_arrival_time() <= now) {
+      auto arrival_time = uplink_.receive_segment(server_input_);
+      server_input_reader_.sync_with_writer();
+      if (!is_server_transport_inited_) {
+        // skip transport tag
+        if (server_input_reader_.size() < 4) {
+          continue;
+        }
+        server_input_reader_.advance(4);
+        is_server_transport_inited_ = true;
+      }
+      while (true) {
+        BufferSlice packet;
+        uint32 quick_ack = 0;
+        auto wait_size = server_transport_.read_from_stream(&server_input_reader_, &packet, &quick_ack);
+        if (wait_size != 0) {
+          break;
+        }
+        if (quick_ack != 0) {
+          continue;
+        }
+        if (server_ == nullptr) {
+          return Status::Error("Server is closed");
+        }
+        auto send_time = arrival_time + server_->processing_time_;
+        for (auto &answer : server_->on_packet(std::move(packet))) {
+          BufferWriter message(answer.as_slice(), 4, 0);
+          server_transport_.write_prepare_inplace(&message, false);
+          downlink_.send(send_time, message.as_buffer_slice().as_slice());
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  Status do_flush(const mtproto::AuthKey &auth_key, Callback &callback) {
+    auto now = Time::now();
+    send_client_output();
+    TRY_STATUS(run_server(now));
+
+    size_t read_size = 0;
+    while (downlink_.get_next_arrival_time() != 0.0 && downlink_.get_next_arrival_time() <= now) {
+      auto old_size = client_input_reader_.size();
+      downlink_.receive_segment(client_input_);
+      client_input_reader_.sync_with_writer();
+      read_size += client_input_reader_.size() - old_size;
+    }
+    if (read_size != 0) {
+      callback.on_read(read_size);
+    }
+
+    while (true) {
+      BufferSlice packet;
+      uint32 quick_ack = 0;
+      TRY_RESULT(wait_size, client_transport_.read_next(&packet, &quick_ack));
+      if (wait_size != 0) {
+        break;
+      }
+      if (quick_ack != 0) {
+        continue;
+      }
+
+      mtproto::PacketInfo info;
+      info.version = 2;
+      BufferSlice data(packet.size());
+      TRY_RESULT(read_result, mtproto::Transport::read(packet.as_slice(), data.as_mutable_slice(), auth_key, &info));
+      switch (read_result.type()) {
+        case mtproto::Transport::ReadResult::Packet:
+          TRY_STATUS(callback.on_raw_packet(info, data.from_slice(read_result.packet())));
+          break;
+        case mtproto::Transport::ReadResult::Error:
+          return Status::Error(PSLICE() << "MTProto error: " << read_result.error());
+        case mtproto::Transport::ReadResult::Quickack:
+        case mtproto::Transport::ReadResult::Nop:
+          break;
+        default:
+          UNREACHABLE();
+      }
+    }
+
+    TRY_STATUS(callback.before_write());
+    send_client_output();
+    return Status::OK();
+  }
+};
+
+MtprotoTestServer::MtprotoTestServer() {
+  string key(2048 / 8, '\0');
+  Random::secure_bytes(key);
+  auto key_id = static_cast<uint64>(mtproto::DhHandshake::calc_key_id(key));
+  auth_key_ = mtproto::AuthKey(key_id, std::move(key));
+  server_salt_ = Random::secure_uint64();
+  unique_id_ = Random::secure_uint64();
+}
+
+MtprotoTestServer::~MtprotoTestServer() {
+  for (auto connection : connections_) {
+    connection->close();
+  }
+}
+
+void MtprotoTestServer::set_query_handler(QueryHandler query_handler) {
+  query_handler_ = std::move(query_handler);
+}
+
+void MtprotoTestServer::set_processing_time(double processing_time) {
+  processing_time_ = processing_time;
+}
+
+void MtprotoTestServer::set_flood_wait(double flood_wait_rate, int32 flood_wait_time, uint64 seed) {
+  flood_wait_rate_ = flood_wait_rate;
+  flood_wait_time_ = flood_wait_time;
+  flood_wait_random_ = Random::Xorshift128plus(seed);
+}
+
+unique_ptr<mtproto::RawConnection> MtprotoTestServer::create_connection(const NetworkEmulationOptions &options) {
+  auto connection = td::make_unique<EmulatedRawConnection>(this, options);
+  connections_.push_back(connection.get());
+  return std::move(connection);
+}
+
+unique_ptr<mtproto::AuthData> MtprotoTestServer::create_auth_data() const {
+  auto now = Time::now();
+  auto auth_data = td::make_unique<mtproto::AuthData>();
+  auth_data->set_use_pfs(false);
+  auth_data->set_main_auth_key(auth_key_);
+  auth_data->set_server_time_difference(Clocks::system() - now);
+  auth_data->set_server_salt(server_salt_, now);
+  uint64 session_id = 0;
+  do {
+    session_id = Random::secure_uint64();
+  } while (session_id == 0);
+  auth_data->set_session_id(session_id);
+  return auth_data;
+}
+
+double MtprotoTestServer::get_next_event_time() const {
+  double result = 0.0;
+  for (auto connection : connections_) {
+    auto event_time = connection->get_next_event_time();
+    if (event_time != 0.0 && (result == 0.0 || event_time < result)) {
+      result = event_time;
+    }
+  }
+  return result;
+}
+
+void MtprotoTestServer::on_connection_closed(EmulatedRawConnection *connection) {
+  td::remove(connections_, connection);
+}
+
+vector<BufferSlice> MtprotoTestServer::on_packet(BufferSlice packet) {
+  stats_.packet_count++;
+  stats_.received_bytes += packet.size();
+
+  mtproto::PacketInfo info;
+  info.version = 2;
+  info.is_server = true;
+  BufferSlice data(packet.size());
+  auto r_read_result = mtproto::Transport::read(packet.as_slice(), data.as_mutable_slice(), auth_key_, &info);
+  if (r_read_result.is_error()) {
+    LOG(ERROR) << "Receive invalid packet: " << r_read_result.error();
+    return {};
+  }
+  auto read_result = r_read_result.move_as_ok();
+  if (read_result.type() != mtproto::Transport::ReadResult::Packet || info.no_crypto_flag) {
+    LOG(ERROR) << "Receive unsupported packet";
+    return {};
+  }
+
+  vector<OutboundMessage> answers;
+  if (sessions_.count(info.session_id) == 0) {
+    sessions_[info.session_id];
+    answers.push_back(OutboundMessage{
+        true, false, serialize_object(mtproto_api::new_session_created(static_cast<int64>(info.message_id),
+                                                                       static_cast<int64>(unique_id_),
+                                                                       static_cast<int64>(server_salt_)))});
+  }
+  if (info.salt != server_salt_) {
+    answers.push_back(OutboundMessage{
+        false, true,
+        serialize_object(mtproto_api::bad_server_salt(static_cast<int64>(info.message_id), info.seq_no, 48,
+                                                      static_cast<int64>(server_salt_)))});
+  } else {
+    // skip message_id, seq_no and message length
+    auto message = read_result.packet();
+    auto body_size = static_cast<size_t>(as<int32>(message.begin() + sizeof(int64) + sizeof(int32)));
+    on_message(info.message_id, message.substr(sizeof(int64) + 2 * sizeof(int32), body_size), answers);
+  }
+  if (answers.empty()) {
+    return {};
+  }
+
+  vector<BufferSlice> result;
+  result.push_back(create_packet(info.session_id, std::move(answers)));
+  return result;
+}
+
+void MtprotoTestServer::on_message(uint64 message_id, Slice body, vector<OutboundMessage> &answers) {
+  TlParser parser(body);
+  auto constructor_id = static_cast<uint32>(parser.fetch_int());
+  switch (constructor_id) {
+    case 0x73f1f8dc: {  // msg_container
+      auto message_count = parser.fetch_int();
+      for (int32 i = 0; i < message_count && parser.get_error() == nullptr; i++) {
+        auto inner_message_id = static_cast<uint64>(parser.fetch_long());
+        parser.fetch_int();  // seq_no
+        auto size = parser.fetch_int();
+        auto inner_body = parser.fetch_string_raw<Slice>(static_cast<size_t>(size));
+        if (parser.get_error() == nullptr) {
+          on_message(inner_message_id, inner_body, answers);
+        }
+      }
+      break;
+    }
+    case 0xf3427b8c: {  // ping_delay_disconnect
+      auto ping_id = parser.fetch_long();
+      answers.push_back(
+          OutboundMessage{true, true, serialize_object(mtproto_api::pong(static_cast<int64>(message_id), ping_id))});
+      break;
+    }
+    case 0xb921bd04: {  // get_future_salts
+      auto now = static_cast<int32>(Clocks::system());
+      vector<mtproto_api::object_ptr<mtproto_api::future_salt>> salts;
+      salts.push_back(
+          make_tl_object<mtproto_api::future_salt>(now - 60, now + 86400, static_cast<int64>(server_salt_)));
+      answers.push_back(OutboundMessage{
+          true, true,
+          serialize_object(mtproto_api::future_salts(static_cast<int64>(message_id), now, std::move(salts)))});
+      break;
+    }
+    case 0x62d6b459:  // msgs_ack
+    case 0x9299359f:  // http_wait
+    case 0xda69fb52:  // msgs_state_req
+    case 0x7d861a08:  // msg_resend_req
+    case 0x58e4a740:  // rpc_drop_answer
+      break;
+    default:
+      on_query(message_id, body, answers);
+      break;
+  }
+  if (parser.get_error() != nullptr) {
+    LOG(ERROR) << "Failed to parse message: " << parser.get_error();
+  }
+}
+
+void MtprotoTestServer::on_query(uint64 message_id, Slice query, vector<OutboundMessage> &answers) {
+  BufferSlice unpacked_query;
+  while (true) {
+    TlParser parser(query);
+    auto constructor_id = static_cast<uint32>(parser.fetch_int());
+    if (constructor_id == 0xcb9f372d) {  // invokeAfterMsg
+      query.remove_prefix(sizeof(int32) + sizeof(int64));
+    } else if (constructor_id == 0x3dc4b4f0) {  // invokeAfterMsgs
+      parser.fetch_int();
+      auto size = parser.fetch_int();
+      if (parser.get_error() != nullptr || size < 0 || query.size() < 3 * sizeof(int32) + size * sizeof(int64)) {
+        break;
+      }
+      query.remove_prefix(3 * sizeof(int32) + size * sizeof(int64));
+    } else if (constructor_id == static_cast<uint32>(mtproto_api::gzip_packed::ID)) {
+      auto packed_data = parser.fetch_string<Slice>();
+      if (parser.get_error() != nullptr) {
+        break;
+      }
+      auto new_unpacked_query = gzdecode(packed_data);  // packed_data can point to unpacked_query
+      unpacked_query = std::move(new_unpacked_query);
+      query = unpacked_query.as_slice();
+    } else {
+      break;
+    }
+  }
+
+  stats_.query_count++;
+  string result;
+  if (flood_wait_rate_ > 0 && flood_wait_random_.fast(0, 999999) < static_cast<int>(flood_wait_rate_ * 1e6)) {
+    stats_.flood_wait_count++;
+    result = serialize_object(mtproto_api::rpc_error(420, PSTRING() << "FLOOD_WAIT_" << flood_wait_time_));
+  } else if (!query_handler_) {
+    result = serialize_object(mtproto_api::rpc_error(400, "METHOD_NOT_IMPLEMENTED"));
+  } else {
+    auto r_result = query_handler_(query);
+    if (r_result.is_error()) {
+      result = serialize_object(mtproto_api::rpc_error(r_result.error().code(), r_result.error().message().str()));
+    } else {
+      result = r_result.ok().as_slice().str();
+    }
+  }
+
+  // rpc_result#f35c6d01 req_msg_id:long result:Object = RpcResult;
+  string rpc_result(sizeof(int32) + sizeof(int64) + result.size(), '\0');
+  as<int32>(&rpc_result[0]) = static_cast<int32>(0xf35c6d01);
+  as<int64>(&rpc_result[sizeof(int32)]) = static_cast<int64>(message_id);
+  MutableSlice(rpc_result).substr(sizeof(int32) + sizeof(int64)).copy_from(result);
+  answers.push_back(OutboundMessage{true, true, std::move(rpc_result)});
+}
+
+uint64 MtprotoTestServer::next_message_id(bool is_response) {
+  auto time_message_id = static_cast<uint64>(Clocks::system() * static_cast<double>(static_cast<uint64>(1) << 32));
+  auto message_id = max(time_message_id & ~static_cast<uint64>(3), (last_message_id_ & ~static_cast<uint64>(3)) + 4);
+  message_id |= is_response ? 1 : 3;
+  last_message_id_ = message_id;
+  return message_id;
+}
+
+BufferSlice MtprotoTestServer::create_packet(uint64 session_id, vector<OutboundMessage> &&messages) {
+  CHECK(!messages.empty());
+  auto &session = sessions_[session_id];
+  auto get_seq_no = [&session](bool is_content_related) {
+    auto seq_no = 2 * session.content_message_count;
+    if (is_content_related) {
+      seq_no++;
+      session.content_message_count++;
+    }
+    return seq_no;
+  };
+  auto store_message = [](string &data, uint64 message_id, int32 seq_no, Slice body) {
+    auto pos = data.size();
+    data.resize(pos + sizeof(int64) + 2 * sizeof(int32) + body.size());
+    as<int64>(&data[pos]) = static_cast<int64>(message_id);
+    as<int32>(&data[pos + sizeof(int64)]) = seq_no;
+    as<int32>(&data[pos + sizeof(int64) + sizeof(int32)]) = narrow_cast<int32>(body.size());
+    MutableSlice(data).substr(pos + sizeof(int64) + 2 * sizeof(int32)).copy_from(body);
+  };
+
+  string data;
+  if (messages.size() == 1) {
+    auto &message = messages[0];
+    auto message_id = next_message_id(message.is_response);
+    store_message(data, message_id, get_seq_no(message.is_content_related), message.body);
+  } else {
+    // msg_container#73f1f8dc messages:vector<%Message> = MessageContainer;
+    string container(2 * sizeof(int32), '\0');
+    as<int32>(&container[0]) = static_cast<int32>(0x73f1f8dc);
+    as<int32>(&container[sizeof(int32)]) = narrow_cast<int32>(messages.size());
+    for (auto &message : messages) {
+      auto message_id = next_message_id(message.is_response);
+      store_message(container, message_id, get_seq_no(message.is_content_related), message.body);
+    }
+    store_message(data, next_message_id(false), get_seq_no(false), container);
+  }
+
+  mtproto::PacketInfo info;
+  info.version = 2;
+  info.is_server = true;
+  info.salt = server_salt_;
+  info.session_id = session_id;
+  auto storer = create_storer(Slice(data));
+  BufferSlice packet(mtproto::Transport::write(storer, auth_key_, &info));
+  mtproto::Transport::write(storer, auth_key_, &info, packet.as_mutable_slice());
+  stats_.sent_bytes += packet.size();
+  return packet;
+}
+
+MtprotoTestClient::MtprotoTestClient(std::shared_ptr<MtprotoTestServer> server, NetworkEmulationOptions options,
+                                     vector<BufferSlice> queries, size_t max_pending_queries, Promise<Stats> promise)
+    : server_(std::move(server))
+    , options_(options)
+    , queries_(std::move(queries))
+    , max_pending_queries_(max(max_pending_queries, static_cast<size_t>(1)))
+    , promise_(std::move(promise)) {
+}
+
+void MtprotoTestClient::start_up() {
+  start_time_ = Time::now();
+  auth_data_ = server_->create_auth_data();
+  for (size_t i = 0; i < queries_.size(); i++) {
+    delayed_queries_.emplace_back(0.0, PendingQuery{i, 0.0});
+  }
+  loop();
+}
+
+void MtprotoTestClient::loop() {
+  if (!promise_) {
+    return;
+  }
+  if (stats_.result_count + stats_.error_count == queries_.size()) {
+    return finish(Status::OK());
+  }
+
+  if (connection_ != nullptr && is_connection_closed_) {
+    connection_ = nullptr;
+    is_connection_closed_ = false;
+  }
+  if (connection_ == nullptr) {
+    connection_ = make_unique<mtproto::SessionConnection>(mtproto::SessionConnection::Mode::Tcp,
+                                                          server_->create_connection(options_), auth_data_.get());
+    connection_->set_online(true, true);
+  }
+
+  auto now = Time::now();
+  double next_query_time = 0.0;
+  for (size_t i = 0; i < delayed_queries_.size();) {
+    if (pending_queries_.size() >= max_pending_queries_) {
+      break;
+    }
+    if (delayed_queries_[i].first > now) {
+      if (next_query_time == 0.0 || delayed_queries_[i].first < next_query_time) {
+        next_query_time = delayed_queries_[i].first;
+      }
+      i++;
+      continue;
+    }
+    auto query = delayed_queries_[i].second;
+    delayed_queries_.erase(delayed_queries_.begin() + i);
+    if (query.start_time == 0.0) {
+      query.start_time = now;
+    }
+    auto r_message_id = connection_->send_query(queries_[query.query_index].copy(), false);
+    if (r_message_id.is_error()) {
+      return finish(r_message_id.move_as_error());
+    }
+    pending_queries_[r_message_id.ok()] = query;
+  }
+
+  need_loop_ = false;
+  auto wakeup_at = connection_->flush(this);
+  if (need_loop_ || is_connection_closed_) {
+    return yield();
+  }
+
+  for (auto event_time : {server_->get_next_event_time(), next_query_time}) {
+    if (event_time != 0.0 && (wakeup_at == 0.0 || event_time < wakeup_at)) {
+      wakeup_at = event_time;
+    }
+  }
+  if (wakeup_at != 0.0) {
+    set_timeout_at(wakeup_at);
+  }
+}
+
+void MtprotoTestClient::finish(Status status) {
+  if (status.is_error()) {
+    promise_.set_error(std::move(status));
+  } else {
+    stats_.total_time = Time::now() - start_time_;
+    if (stats_.result_count != 0) {
+      stats_.average_latency = total_latency_ / static_cast<double>(stats_.result_count);
+    }
+    promise_.set_value(std::move(stats_));
+  }
+  if (connection_ != nullptr && !is_connection_closed_) {
+    connection_->force_close(this);
+  }
+  connection_ = nullptr;
+  stop();
+}
+
+void MtprotoTestClient::on_closed(Status status) {
+  LOG(INFO) << "Connection closed: " << status;
+  is_connection_closed_ = true;
+  for (auto &it : pending_queries_) {
+    delayed_queries_.emplace_back(0.0, it.second);
+  }
+  pending_queries_.clear();
+}
+
+void MtprotoTestClient::on_session_failed(Status status) {
+  LOG(INFO) << "Session failed: " << status;
+}
+
+Status MtprotoTestClient::on_message_result_ok(uint64 id, BufferSlice packet, size_t original_size) {
+  auto it = pending_queries_.find(id);
+  if (it == pending_queries_.end()) {
+    return Status::OK();
+  }
+  auto latency = Time::now() - it->second.start_time;
+  pending_queries_.erase(it);
+
+  stats_.result_count++;
+  stats_.result_bytes += original_size;
+  total_latency_ += latency;
+  stats_.max_latency = max(stats_.max_latency, latency);
+  need_loop_ = true;
+  return Status::OK();
+}
+
+void MtprotoTestClient::on_message_result_error(uint64 id, int code, string message) {
+  auto it = pending_queries_.find(id);
+  if (it == pending_queries_.end()) {
+    return;
+  }
+  auto query = it->second;
+  pending_queries_.erase(it);
+  need_loop_ = true;
+
+  if (code == 420 && begins_with(message, "FLOOD_WAIT_")) {
+    stats_.flood_wait_count++;
+    auto wait_time = to_integer<int32>(Slice(message).substr(Slice("FLOOD_WAIT_").size()));
+    delayed_queries_.emplace_back(Time::now() + wait_time, query);
+    return;
+  }
+  LOG(INFO) << "Receive error " << code << ": " << message;
+  stats_.error_count++;
+}
+
+void MtprotoTestClient::on_message_failed(uint64 id, Status status) {
+  auto it = pending_queries_.find(id);
+  if (it == pending_queries_.end()) {
+    return;
+  }
+  delayed_queries_.emplace_back(0.0, it->second);
+  pending_queries_.erase(it);
+  need_loop_ = true;
+}
+
+}  // namespace td
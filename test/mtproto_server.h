@@ -0,0 +1,212 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2023
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/mtproto/AuthData.h"
+#include "td/mtproto/AuthKey.h"
+#include "td/mtproto/RawConnection.h"
+#include "td/mtproto/SessionConnection.h"
+
+#include "td/actor/actor.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+#include <functional>
+#include <memory>
+
+namespace td {
+
+// Parameters of an emulated network link. All random decisions are made by a generator initialized with the seed,
+// so a run with the same parameters and the same sequence of sent packets is reproducible.
+struct NetworkEmulationOptions {
+  double rtt = 0.0;                     // round-trip time, in seconds
+  double bandwidth = 0.0;               // in bytes per second in each direction; 0 if unlimited
+  double loss_rate = 0.0;               // probability for a segment to be lost and retransmitted
+  double retransmission_timeout = 0.2;  // additional delay of a lost segment, in seconds
+  size_t segment_size = 1400;           // maximum number of bytes in a segment
+  uint64 seed = 1;
+};
+
+class EmulatedRawConnection;
+
+// In-process MTProto server, which speaks the same transport framing, encryption and message container semantics
+// as Telegram servers, but uses a pre-shared authorization key and answers queries using a scripted handler
+class MtprotoTestServer : public std::enable_shared_from_this<MtprotoTestServer> {
+ public:
+  // returns result of the query or an error, which is sent as rpc_error
+  using QueryHandler = std::function<Result<BufferSlice>(Slice query)>;
+
+  struct Stats {
+    uint64 packet_count = 0;
+    uint64 query_count = 0;
+    uint64 flood_wait_count = 0;
+    uint64 received_bytes = 0;
+    uint64 sent_bytes = 0;
+  };
+
+  MtprotoTestServer();
+  MtprotoTestServer(const MtprotoTestServer &) = delete;
+  MtprotoTestServer &operator=(const MtprotoTestServer &) = delete;
+  MtprotoTestServer(MtprotoTestServer &&) = delete;
+  MtprotoTestServer &operator=(MtprotoTestServer &&) = delete;
+  ~MtprotoTestServer();
+
+  void set_query_handler(QueryHandler query_handler);
+
+  // delay between receiving of a query and sending of the answer
+  void set_processing_time(double processing_time);
+
+  // the given fraction of queries is answered with FLOOD_WAIT_<flood_wait_time> error instead of calling the handler
+  void set_flood_wait(double flood_wait_rate, int32 flood_wait_time, uint64 seed = 1);
+
+  // the returned connection must be used only while the server exists
+  unique_ptr<mtproto::RawConnection> create_connection(const NetworkEmulationOptions &options);
+
+  // returns AuthData, which can be used to create a SessionConnection to the server
+  unique_ptr<mtproto::AuthData> create_auth_data() const;
+
+  // returns the nearest time at which a packet arrives to the server or to a client; 0 if there are no such packets
+  double get_next_event_time() const;
+
+  const Stats &get_stats() const {
+    return stats_;
+  }
+
+ private:
+  friend class EmulatedRawConnection;
+
+  struct SessionState {
+    int32 content_message_count = 0;
+  };
+
+  struct OutboundMessage {
+    bool is_content_related = false;
+    bool is_response = false;
+    string body;
+  };
+
+  mtproto::AuthKey auth_key_;
+  uint64 server_salt_ = 0;
+  uint64 unique_id_ = 0;
+  uint64 last_message_id_ = 0;
+  double processing_time_ = 0.0;
+  double flood_wait_rate_ = 0.0;
+  int32 flood_wait_time_ = 0;
+  Random::Xorshift128plus flood_wait_random_{1};
+  QueryHandler query_handler_;
+  FlatHashMap<uint64, SessionState> sessions_;
+  vector<EmulatedRawConnection *> connections_;
+  Stats stats_;
+
+  // decrypts a packet, received by the server, and returns encrypted answers to it
+  vector<BufferSlice> on_packet(BufferSlice packet);
+
+  void on_message(uint64 message_id, Slice body, vector<OutboundMessage> &answers);
+
+  void on_query(uint64 message_id, Slice query, vector<OutboundMessage> &answers);
+
+  uint64 next_message_id(bool is_response);
+
+  BufferSlice create_packet(uint64 session_id, vector<OutboundMessage> &&messages);
+
+  void on_connection_closed(EmulatedRawConnection *connection);
+};
+
+// Runs a SessionConnection to a test server, keeping up to max_pending_queries queries in flight,
+// and resends queries failed with FLOOD_WAIT after the requested time
+class MtprotoTestClient final
+    : public Actor
+    , private mtproto::SessionConnection::Callback {
+ public:
+  struct Stats {
+    size_t result_count = 0;
+    size_t error_count = 0;
+    size_t flood_wait_count = 0;
+    size_t result_bytes = 0;
+    double total_time = 0.0;
+    double average_latency = 0.0;
+    double max_latency = 0.0;
+  };
+
+  MtprotoTestClient(std::shared_ptr<MtprotoTestServer> server, NetworkEmulationOptions options,
+                    vector<BufferSlice> queries, size_t max_pending_queries, Promise<Stats> promise);
+
+ private:
+  struct PendingQuery {
+    size_t query_index = 0;
+    double start_time = 0.0;
+  };
+
+  std::shared_ptr<MtprotoTestServer> server_;
+  NetworkEmulationOptions options_;
+  vector<BufferSlice> queries_;
+  size_t max_pending_queries_;
+  Promise<Stats> promise_;
+
+  unique_ptr<mtproto::AuthData> auth_data_;
+  unique_ptr<mtproto::SessionConnection> connection_;
+  FlatHashMap<uint64, PendingQuery> pending_queries_;
+  vector<std::pair<double, PendingQuery>> delayed_queries_;
+  bool is_connection_closed_ = false;
+  bool need_loop_ = false;
+  double start_time_ = 0.0;
+  double total_latency_ = 0.0;
+  Stats stats_;
+
+  void start_up() final;
+
+  void loop() final;
+
+  void finish(Status status);
+
+  void on_connected() final {
+  }
+  void on_closed(Status status) final;
+
+  void on_auth_key_updated() final {
+  }
+  void on_tmp_auth_key_updated() final {
+  }
+  void on_server_salt_updated() final {
+  }
+  void on_server_time_difference_updated() final {
+  }
+
+  void on_session_created(uint64 unique_id, uint64 first_id) final {
+  }
+  void on_session_failed(Status status) final;
+
+  void on_container_sent(uint64 container_id, vector<uint64> msgs_id) final {
+  }
+  Status on_pong() final {
+    return Status::OK();
+  }
+
+  Status on_update(BufferSlice packet) final {
+    return Status::OK();
+  }
+
+  void on_message_ack(uint64 id) final {
+  }
+  Status on_message_result_ok(uint64 id, BufferSlice packet, size_t original_size) final;
+  void on_message_result_error(uint64 id, int code, string message) final;
+  void on_message_failed(uint64 id, Status status) final;
+  void on_message_info(uint64 id, int32 state, uint64 answer_id, int32 answer_size) final {
+  }
+
+  Status on_destroy_auth_key() final {
+    return Status::OK();
+  }
+};
+
+}  // namespace td
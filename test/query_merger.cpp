@@ -14,6 +14,7 @@
 #include "td/utils/FlatHashSet.h"
 #include "td/utils/logging.h"
 #include "td/utils/Promise.h"
+#include "td/utils/port/Clocks.h"
 #include "td/utils/Random.h"
 #include "td/utils/Status.h"
 #include "td/utils/tests.h"
@@ -100,3 +101,61 @@ TEST(QueryMerger, stress) {
   }
   sched.finish();
 }
+
+class TestDelayedQueryMerger final : public td::Actor {
+  void start_up() final {
+    query_merger_.set_merge_delay(MERGE_DELAY);
+    query_merger_.set_merge_function([this](td::vector<td::int64> query_ids, td::Promise<td::Unit> &&promise) {
+      merged_query_sizes_.push_back(query_ids.size());
+      if (query_ids.size() != MAX_MERGED_QUERY_COUNT) {
+        ASSERT_TRUE(td::Clocks::monotonic() - start_time_ >= MERGE_DELAY);
+      }
+      promise.set_value(td::Unit());
+    });
+    start_time_ = td::Clocks::monotonic();
+    loop();
+  }
+
+  void loop() final {
+    for (int i = 0; i < 3 && added_query_count_ < MAX_QUERY_COUNT; i++) {
+      query_merger_.add_query(static_cast<td::int64>(++added_query_count_),
+                              td::PromiseCreator::lambda([this](td::Result<td::Unit> result) {
+                                ASSERT_TRUE(result.is_ok());
+                                if (++completed_query_count_ == MAX_QUERY_COUNT) {
+                                  ASSERT_EQ(3u, merged_query_sizes_.size());
+                                  ASSERT_EQ(MAX_MERGED_QUERY_COUNT, merged_query_sizes_[0]);
+                                  ASSERT_EQ(MAX_MERGED_QUERY_COUNT, merged_query_sizes_[1]);
+                                  ASSERT_EQ(1u, merged_query_sizes_[2]);
+                                  td::Scheduler::instance()->finish();
+                                }
+                              }));
+    }
+    if (added_query_count_ < MAX_QUERY_COUNT) {
+      yield();
+    }
+  }
+
+  static constexpr double MERGE_DELAY = 0.05;
+  static constexpr std::size_t MAX_MERGED_QUERY_COUNT = 10;
+  static constexpr std::size_t MAX_QUERY_COUNT = 21;
+
+  td::QueryMerger query_merger_{"DelayedQueryMerger", 100, MAX_MERGED_QUERY_COUNT};
+  double start_time_ = 0.0;
+  std::size_t added_query_count_ = 0;
+  std::size_t completed_query_count_ = 0;
+  td::vector<std::size_t> merged_query_sizes_;
+};
+
+constexpr double TestDelayedQueryMerger::MERGE_DELAY;
+constexpr std::size_t TestDelayedQueryMerger::MAX_MERGED_QUERY_COUNT;
+constexpr std::size_t TestDelayedQueryMerger::MAX_QUERY_COUNT;
+
+TEST(QueryMerger, merge_delay) {
+  td::ConcurrentScheduler sched(0, 0);
+  sched.create_actor_unsafe<TestDelayedQueryMerger>(0, "TestDelayedQueryMerger").release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
@@ -9,7 +9,9 @@
 #include "td/telegram/Client.h"
 #include "td/telegram/ClientActor.h"
 #include "td/telegram/files/PartsManager.h"
+#include "td/telegram/files/ResourceArbiter.h"
 #include "td/telegram/td_api.h"
+#include "td/telegram/td_api.hpp"
 
 #include "td/actor/actor.h"
 #include "td/actor/ConcurrentScheduler.h"
@@ -20,6 +22,7 @@
 #include "td/utils/common.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/format.h"
+#include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/FileFd.h"
@@ -32,6 +35,8 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 #include "td/utils/tests.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/tl_storers.h"
 
 #include <atomic>
 #include <cstdio>
@@ -40,6 +45,7 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <type_traits>
 #include <utility>
 
 template <class T>
@@ -866,6 +872,87 @@ TEST(Client, Simple) {
   }
 }
 
+TEST(Client, FunctionIndex) {
+  td::td_api::testSquareInt request(3);
+  auto function_index = td::td_api::get_function_index(request.get_id());
+  ASSERT_TRUE(0 <= function_index && function_index < td::td_api::FUNCTION_COUNT);
+  ASSERT_STREQ("testSquareInt", td::td_api::get_function_name(function_index));
+  ASSERT_EQ(-1, td::td_api::get_function_index(td::td_api::testInt::ID));
+
+  td::int32 called_id = 0;
+  td::td_api::downcast_call_by_index(function_index, request, [&called_id](auto &function) {
+    called_id = std::decay_t<decltype(function)>::ID;
+  });
+  ASSERT_EQ(td::td_api::testSquareInt::ID, called_id);
+}
+
+TEST(Client, RequestStatistics) {
+  td::Client::execute({1, td::td_api::make_object<td::td_api::getRequestStatistics>(true)});
+  td::Client::execute({1, td::td_api::make_object<td::td_api::toggleRequestStatistics>(true)});
+
+  td::Client client;
+  for (td::uint64 id = 2; id <= 4; id++) {
+    client.send({id, td::make_tl_object<td::td_api::testSquareInt>(3)});
+  }
+  int received_count = 0;
+  while (received_count < 3) {
+    auto result = client.receive(10);
+    if (result.id >= 2 && result.id <= 4) {
+      received_count++;
+    }
+  }
+
+  auto response = td::Client::execute({1, td::td_api::make_object<td::td_api::getRequestStatistics>(true)});
+  td::Client::execute({1, td::td_api::make_object<td::td_api::toggleRequestStatistics>(false)});
+  ASSERT_EQ(td::td_api::requestStatistics::ID, response.object->get_id());
+  const auto &statistics = static_cast<const td::td_api::requestStatistics &>(*response.object);
+  bool is_found = false;
+  for (const auto &entry : statistics.by_type_) {
+    if (entry->request_type_ == "testSquareInt") {
+      is_found = true;
+      ASSERT_EQ(3, entry->request_count_);
+      ASSERT_EQ(0, entry->error_count_);
+      td::int64 latency_count = 0;
+      for (auto count : entry->latency_histogram_) {
+        latency_count += count;
+      }
+      ASSERT_EQ(3, latency_count);
+    }
+  }
+  ASSERT_TRUE(is_found);
+}
+
+TEST(Client, RequestTraces) {
+  td::Client::execute({1, td::td_api::make_object<td::td_api::getRequestTraces>(true)});
+  auto error = td::Client::execute({1, td::td_api::make_object<td::td_api::toggleRequestTracing>(true, 0)});
+  ASSERT_EQ(td::td_api::error::ID, error.object->get_id());
+  td::Client::execute({1, td::td_api::make_object<td::td_api::toggleRequestTracing>(true, 1)});
+
+  td::Client client;
+  for (td::uint64 id = 2; id <= 4; id++) {
+    client.send({id, td::make_tl_object<td::td_api::testSquareInt>(3)});
+  }
+  int received_count = 0;
+  while (received_count < 3) {
+    auto result = client.receive(10);
+    if (result.id >= 2 && result.id <= 4) {
+      received_count++;
+    }
+  }
+
+  auto response = td::Client::execute({1, td::td_api::make_object<td::td_api::getRequestTraces>(true)});
+  td::Client::execute({1, td::td_api::make_object<td::td_api::toggleRequestTracing>(false, 1)});
+  ASSERT_EQ(td::td_api::text::ID, response.object->get_id());
+  auto trace = static_cast<td::td_api::text &>(*response.object).text_;
+  size_t span_count = 0;
+  td::string span_name = "\"name\":\"testSquareInt\"";
+  for (auto pos = trace.find(span_name); pos != td::string::npos; pos = trace.find(span_name, pos + 1)) {
+    span_count++;
+  }
+  ASSERT_EQ(3u, span_count);
+  ASSERT_TRUE(td::json_decode(td::MutableSlice(trace)).is_ok());
+}
+
 TEST(Client, SimpleMulti) {
   std::vector<td::Client> clients(7);
   //for (auto &client : clients) {
@@ -931,6 +1018,51 @@ TEST(Client, Multi) {
   ASSERT_EQ(8 * 1000, ok_count.load());
 }
 
+template <class T>
+static td::string serialize_td_api_object(const T &object) {
+  td::TlStorerCalcLength calc_length;
+  calc_length.store_binary(object.get_id());
+  object.store(calc_length);
+  td::string result(calc_length.get_length(), '\0');
+  td::TlStorerUnsafe storer(td::MutableSlice(result).ubegin());
+  storer.store_binary(object.get_id());
+  object.store(storer);
+  CHECK(storer.get_buf() == td::MutableSlice(result).ubegin() + result.size());
+  return result;
+}
+
+TEST(Client, TlSerialization) {
+  for (bool has_text : {false, true}) {
+    auto content = td::td_api::make_object<td::td_api::inputMessageText>(
+        has_text ? td::td_api::make_object<td::td_api::formattedText>("text", td::Auto()) : nullptr, false, true);
+    auto serialized_content = serialize_td_api_object(*content);
+    ASSERT_EQ(0u, serialized_content.size() % 4);
+
+    td::TlParser parser(serialized_content);
+    auto parsed_content = td::td_api::InputMessageContent::fetch(parser);
+    parser.fetch_end();
+    ASSERT_TRUE(parser.get_error() == nullptr);
+    ASSERT_STREQ(td::td_api::to_string(content), td::td_api::to_string(parsed_content));
+
+    td::TlParser wrong_parser(td::Slice(serialized_content).remove_suffix(4));
+    td::td_api::InputMessageContent::fetch(wrong_parser);
+    wrong_parser.fetch_end();
+    ASSERT_TRUE(wrong_parser.get_error() != nullptr);
+  }
+
+  td::int32 request[] = {td::td_api::testSquareInt::ID, 5};
+  td::TlParser parser(td::Slice(reinterpret_cast<const char *>(request), sizeof(request)));
+  auto function = td::td_api::Function::fetch(parser);
+  parser.fetch_end();
+  ASSERT_TRUE(parser.get_error() == nullptr);
+  ASSERT_EQ(td::td_api::testSquareInt::ID, function->get_id());
+  ASSERT_EQ(5, static_cast<const td::td_api::testSquareInt &>(*function).x_);
+
+  auto result = td::td_api::make_object<td::td_api::testInt>(25);
+  auto serialized_result = serialize_td_api_object(*result);
+  ASSERT_EQ(8u, serialized_result.size());
+}
+
 TEST(Client, Manager) {
   td::vector<td::thread> threads;
   td::ClientManager client;
@@ -971,6 +1103,97 @@ TEST(Client, Manager) {
   }
 }
 
+TEST(Client, ManagerBatch) {
+  td::ClientManager client;
+  int clients_n = 10;
+  int requests_n = 100;
+  td::vector<td::ClientManager::Request> requests;
+  for (int i = 0; i < clients_n; i++) {
+    auto id = client.create_client_id();
+    for (int j = 1; j <= requests_n; j++) {
+      requests.push_back({id, static_cast<td::uint64>(j), td::make_tl_object<td::td_api::testSquareInt>(j)});
+    }
+  }
+  requests.push_back({-1, 1, td::make_tl_object<td::td_api::testSquareInt>(3)});
+  client.send_batch(std::move(requests));
+
+  std::map<td::int32, td::uint64> last_request_ids;
+  int received_n = 0;
+  bool has_error = false;
+  while (received_n != clients_n * requests_n || !has_error) {
+    auto responses = client.receive_batch(50, 10);
+    ASSERT_TRUE(!responses.empty());
+    ASSERT_TRUE(responses.size() <= 50u);
+    for (auto &response : responses) {
+      if (response.client_id == -1) {
+        ASSERT_EQ(td::td_api::error::ID, response.object->get_id());
+        has_error = true;
+        continue;
+      }
+      if (response.request_id == 0) {
+        continue;
+      }
+      ASSERT_EQ(td::td_api::testInt::ID, response.object->get_id());
+      auto value = static_cast<td::td_api::testInt &>(*response.object).value_;
+      ASSERT_EQ(static_cast<td::int32>(response.request_id * response.request_id), value);
+      auto &last_request_id = last_request_ids[response.client_id];
+      ASSERT_EQ(last_request_id + 1, response.request_id);
+      last_request_id = response.request_id;
+      received_n++;
+    }
+  }
+}
+
+TEST(Client, ManagerOwnQueues) {
+  td::ClientManager client;
+#if !TD_EVENTFD_UNSUPPORTED  // Client must be used from a single thread if there is no EventFd
+  int threads_n = 4;
+#else
+  int threads_n = 1;
+#endif
+  int clients_n = 100;
+  td::vector<td::int32> client_ids;
+  for (int i = 0; i < threads_n * clients_n; i++) {
+    auto id = client.create_client_id_with_own_queue();
+    client.send(id, 3, td::make_tl_object<td::td_api::testSquareInt>(3));
+    client_ids.push_back(id);
+  }
+  auto shared_id = client.create_client_id();
+  client.send(shared_id, 3, td::make_tl_object<td::td_api::testSquareInt>(3));
+
+  std::atomic<int> ok_count{0};
+  td::vector<td::thread> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = i * clients_n; j < (i + 1) * clients_n; j++) {
+        while (true) {
+          auto event = client.receive(client_ids[j], 10);
+          ASSERT_TRUE(event.object != nullptr);
+          ASSERT_EQ(client_ids[j], event.client_id);
+          if (event.request_id == 3) {
+            ASSERT_EQ(td::td_api::testInt::ID, event.object->get_id());
+            ok_count++;
+            break;
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(threads_n * clients_n, ok_count.load());
+
+  while (true) {
+    auto event = client.receive(10);
+    ASSERT_TRUE(event.object != nullptr);
+    ASSERT_EQ(shared_id, event.client_id);
+    if (event.request_id == 3) {
+      break;
+    }
+  }
+}
+
 #if !TD_EVENTFD_UNSUPPORTED  // Client must be used from a single thread if there is no EventFd
 TEST(Client, Close) {
   std::atomic<bool> stop_send{false};
@@ -1191,3 +1414,33 @@ TEST(PartsManager, hands) {
     pm.init(1, 100000, true, 10, {0, 1, 2}, false, true).ensure_error();
   }
 }
+
+TEST(ResourceArbiter, fair_share) {
+  td::ResourceArbiter arbiter(100);
+  auto bulk = arbiter.add_flow(1);
+  auto interactive = arbiter.add_flow(2);
+  auto small = arbiter.add_flow(3);
+  ASSERT_EQ(100, arbiter.update_flow(bulk, 1, 1000));
+  ASSERT_EQ(75, arbiter.update_flow(interactive, 3, 1000));
+  ASSERT_EQ(25, arbiter.update_flow(bulk, 1, 1000));
+  ASSERT_EQ(10, arbiter.update_flow(small, 1, 10));
+  ASSERT_EQ(67, arbiter.update_flow(interactive, 3, 1000));
+  ASSERT_EQ(22, arbiter.update_flow(bulk, 1, 1000));
+  arbiter.remove_flow(interactive);
+  ASSERT_EQ(90, arbiter.update_flow(bulk, 1, 1000));
+  ASSERT_EQ(0, arbiter.update_flow(small, 1, 0));
+}
+
+TEST(ResourceArbiter, tenant_fair_share) {
+  td::ResourceArbiter arbiter(100);
+  auto first_dc2 = arbiter.add_flow(1);
+  auto first_dc4 = arbiter.add_flow(1);
+  auto second = arbiter.add_flow(2);
+  ASSERT_EQ(100, arbiter.update_flow(first_dc2, 1, 1000));
+  ASSERT_EQ(50, arbiter.update_flow(first_dc4, 1, 1000));
+  ASSERT_EQ(50, arbiter.update_flow(second, 1, 1000));
+  ASSERT_EQ(25, arbiter.update_flow(first_dc2, 1, 1000));
+  ASSERT_EQ(25, arbiter.update_flow(first_dc4, 1, 1000));
+  ASSERT_EQ(10, arbiter.update_flow(first_dc4, 1, 10));
+  ASSERT_EQ(40, arbiter.update_flow(first_dc2, 1, 1000));
+}
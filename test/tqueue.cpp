@@ -51,6 +51,10 @@ class TestTQueue {
     return td::CSlice("tqueue_binlog");
   }
 
+  static td::CSlice file_storage_path() {
+    return td::CSlice("tqueue_file_storage");
+  }
+
   TestTQueue() {
     baseline_ = td::TQueue::create();
 
@@ -66,6 +70,13 @@ class TestTQueue {
     binlog->init(binlog_path().str(), [&](const td::BinlogEvent &event) { UNREACHABLE(); }).ensure();
     tqueue_binlog->set_binlog(std::move(binlog));
     binlog_->set_callback(std::move(tqueue_binlog));
+
+    file_ = td::TQueue::create();
+    td::TQueueFileStorage::destroy(file_storage_path()).ignore();
+    auto file_storage = td::make_unique<td::TQueueFileStorage>();
+    file_storage->init(file_storage_path().str()).ensure();
+    file_storage->replay(*file_).ensure();
+    file_->set_callback(std::move(file_storage));
   }
 
   void restart(td::Random::Xorshift128plus &rnd, td::int32 now) {
@@ -86,6 +97,17 @@ class TestTQueue {
       return;
     }
 
+    LOG(INFO) << "Restart file storage";
+    file_->close(td::Promise<>());
+    file_ = td::TQueue::create();
+    auto file_storage = td::make_unique<td::TQueueFileStorage>();
+    file_storage->init(file_storage_path().str()).ensure();
+    file_storage->replay(*file_).ensure();
+    file_->set_callback(std::move(file_storage));
+    if (rnd.fast(0, 2) == 0) {
+      file_->run_gc(now);
+    }
+
     LOG(INFO) << "Restart binlog";
     binlog_ = td::TQueue::create();
     auto tqueue_binlog = td::make_unique<td::TQueueBinlog<td::Binlog>>();
@@ -105,8 +127,10 @@ class TestTQueue {
     auto a_id = baseline_->push(queue_id, data, expires_at, 0, new_id).move_as_ok();
     auto b_id = memory_->push(queue_id, data, expires_at, 0, new_id).move_as_ok();
     auto c_id = binlog_->push(queue_id, data, expires_at, 0, new_id).move_as_ok();
+    auto d_id = file_->push(queue_id, data, expires_at, 0, new_id).move_as_ok();
     ASSERT_EQ(a_id, b_id);
     ASSERT_EQ(a_id, c_id);
+    ASSERT_EQ(a_id, d_id);
     return a_id;
   }
 
@@ -115,6 +139,7 @@ class TestTQueue {
     //ASSERT_EQ(baseline_->get_head(qid), binlog_->get_head(qid));
     ASSERT_EQ(baseline_->get_tail(qid), memory_->get_tail(qid));
     ASSERT_EQ(baseline_->get_tail(qid), binlog_->get_tail(qid));
+    ASSERT_EQ(baseline_->get_tail(qid), file_->get_tail(qid));
   }
 
   void check_get(td::TQueue::QueueId qid, td::Random::Xorshift128plus &rnd, td::int32 now) {
@@ -124,6 +149,8 @@ class TestTQueue {
     td::MutableSpan<td::TQueue::Event> b_span(b, 10);
     td::TQueue::Event c[10];
     td::MutableSpan<td::TQueue::Event> c_span(c, 10);
+    td::TQueue::Event d[10];
+    td::MutableSpan<td::TQueue::Event> d_span(d, 10);
 
     auto a_from = baseline_->get_head(qid);
     //auto b_from = memory_->get_head(qid);
@@ -138,13 +165,17 @@ class TestTQueue {
     baseline_->get(qid, a_from, true, now, a_span).move_as_ok();
     memory_->get(qid, a_from, true, now, b_span).move_as_ok();
     binlog_->get(qid, a_from, true, now, c_span).move_as_ok();
+    file_->get(qid, a_from, true, now, d_span).move_as_ok();
     ASSERT_EQ(a_span.size(), b_span.size());
     ASSERT_EQ(a_span.size(), c_span.size());
+    ASSERT_EQ(a_span.size(), d_span.size());
     for (size_t i = 0; i < a_span.size(); i++) {
       ASSERT_EQ(a_span[i].id, b_span[i].id);
       ASSERT_EQ(a_span[i].id, c_span[i].id);
+      ASSERT_EQ(a_span[i].id, d_span[i].id);
       ASSERT_EQ(a_span[i].data, b_span[i].data);
       ASSERT_EQ(a_span[i].data, c_span[i].data);
+      ASSERT_EQ(a_span[i].data, d_span[i].data);
     }
   }
 
@@ -152,6 +183,7 @@ class TestTQueue {
   td::unique_ptr<td::TQueue> baseline_;
   td::unique_ptr<td::TQueue> memory_;
   td::unique_ptr<td::TQueue> binlog_;
+  td::unique_ptr<td::TQueue> file_;
   td::TQueueMemoryStorage *memory_storage_{nullptr};
 };
 
@@ -249,3 +281,77 @@ TEST(TQueue, clear) {
   CHECK(tqueue->get_tail(1) == tail_id);
   CHECK(deleted_events.size() == 100000 - keep_count);
 }
+
+TEST(TQueue, get_batch) {
+  constexpr td::TQueue::QueueId QUEUE_COUNT = 10000;
+  constexpr int EVENT_COUNT = 10;
+  constexpr size_t LIMIT = 5;
+  constexpr int ROUND_COUNT = 10;
+
+  auto tqueue = td::TQueue::create();
+  td::int32 now = 0;
+  for (td::TQueue::QueueId queue_id = 1; queue_id <= QUEUE_COUNT; queue_id++) {
+    for (int i = 0; i < EVENT_COUNT; i++) {
+      tqueue->push(queue_id, PSTRING() << queue_id << ' ' << i, now + 600000, i, {}).ensure();
+    }
+  }
+
+  td::vector<td::TQueue::GetQuery> queries;
+  for (td::TQueue::QueueId queue_id = 0; queue_id <= QUEUE_COUNT + 1; queue_id++) {
+    td::TQueue::GetQuery query;
+    query.queue_id = queue_id;
+    query.from_id = tqueue->get_head(queue_id);
+    query.limit = LIMIT;
+    queries.push_back(query);
+  }
+
+  td::TQueue::Event events[LIMIT];
+  auto start_time = td::Time::now();
+  size_t event_count = 0;
+  for (int round = 0; round < ROUND_COUNT; round++) {
+    for (auto &query : queries) {
+      td::MutableSpan<td::TQueue::Event> events_span(events, LIMIT);
+      tqueue->get(query.queue_id, query.from_id, false, now, events_span).ensure();
+      event_count += events_span.size();
+    }
+  }
+  auto get_time = td::Time::now() - start_time;
+  ASSERT_EQ(static_cast<size_t>(ROUND_COUNT * QUEUE_COUNT * LIMIT), event_count);
+
+  td::vector<td::TQueue::SharedEvent> shared_events;
+  td::vector<td::TQueue::GetQueryResult> results;
+  start_time = td::Time::now();
+  event_count = 0;
+  for (int round = 0; round < ROUND_COUNT; round++) {
+    shared_events.clear();
+    results = tqueue->get_batch(queries, now, shared_events);
+    event_count += shared_events.size();
+  }
+  auto get_batch_time = td::Time::now() - start_time;
+  ASSERT_EQ(static_cast<size_t>(ROUND_COUNT * QUEUE_COUNT * LIMIT), event_count);
+  LOG(INFO) << "Received " << event_count << " TQueue events from " << queries.size() * ROUND_COUNT
+            << " queues in " << get_time << " seconds one by one and in " << get_batch_time << " seconds in batches";
+
+  ASSERT_EQ(queries.size(), results.size());
+  for (size_t i = 0; i < queries.size(); i++) {
+    auto &query = queries[i];
+    auto &result = results[i];
+    ASSERT_TRUE(result.status.is_ok());
+    td::MutableSpan<td::TQueue::Event> events_span(events, LIMIT);
+    ASSERT_EQ(tqueue->get(query.queue_id, query.from_id, false, now, events_span).move_as_ok(), result.queue_size);
+    ASSERT_EQ(events_span.size(), result.event_count);
+    for (size_t j = 0; j < result.event_count; j++) {
+      auto &shared_event = shared_events[result.events_offset + j];
+      ASSERT_EQ(events_span[j].id, shared_event.id);
+      ASSERT_EQ(events_span[j].data, shared_event.data.as_slice());
+      ASSERT_EQ(events_span[j].extra, shared_event.extra);
+    }
+  }
+
+  // shared events remain valid after the queue is changed
+  auto &first_query = queries[1];
+  auto &first_result = results[1];
+  tqueue->clear(first_query.queue_id, 0);
+  ASSERT_EQ(0u, tqueue->get_size(first_query.queue_id));
+  ASSERT_EQ(td::string("1 0"), shared_events[first_result.events_offset].data.as_slice().str());
+}